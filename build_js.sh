@@ -7,6 +7,29 @@ git submodule update --init --recursive
 
 DATA_DIR="$(pwd)/data/"
 
+# --stream-scenes leaves the scenes out of the bundle, for the bindings page to
+# stream them from the server after startup (see bindings_js/scene_loader.js)
+# instead of fetching all of them before the first frame
+# --threads builds with WebAssembly threads and SIMD (BUILD_WEB_THREADS), for
+# browsers with SharedArrayBuffer; the page has to be cross-origin isolated,
+# see bindings_js/serve.py
+PRELOAD_FLAGS="--preload-file $DATA_DIR/scene_datasets/habitat-test-scenes@/"
+WEB_THREADS=OFF
+for arg in "$@"; do
+  case $arg in
+    --stream-scenes)
+      PRELOAD_FLAGS=""
+      ;;
+    --threads)
+      WEB_THREADS=ON
+      ;;
+    *)
+      echo "Unknown option $arg"
+      exit 1
+      ;;
+  esac
+done
+
 mkdir -p build_corrade-rc
 pushd build_corrade-rc
 cmake ../src \
@@ -28,11 +51,12 @@ cmake ../src \
     -DBUILD_ASSIMP_SUPPORT=OFF \
     -DBUILD_DATATOOL=OFF \
     -DBUILD_PTEX_SUPPORT=OFF \
+    -DBUILD_WEB_THREADS=$WEB_THREADS \
     -DCMAKE_BUILD_TYPE=Release \
     -DCMAKE_PREFIX_PATH="$EMSCRIPTEN" \
     -DCMAKE_TOOLCHAIN_FILE="../src/deps/corrade/toolchains/generic/Emscripten-wasm.cmake" \
     -DCMAKE_INSTALL_PREFIX="." \
-    -DCMAKE_CXX_FLAGS="-s FORCE_FILESYSTEM=1 -s ALLOW_MEMORY_GROWTH=1 --preload-file $DATA_DIR/scene_datasets/habitat-test-scenes@/" \
+    -DCMAKE_CXX_FLAGS="-s FORCE_FILESYSTEM=1 -s ALLOW_MEMORY_GROWTH=1 $PRELOAD_FLAGS" \
     -DCMAKE_EXE_LINKER_FLAGS="-s USE_WEBGL2=1"
 
 cmake --build . -- -j 4
@@ -40,10 +64,19 @@ cmake --build . --target install -- -j 4
 
 echo "Done building."
 echo "Run:"
-echo "python2 -m SimpleHTTPServer 8000"
-echo "Or:"
-echo "python3 -m http.server"
+if [ "$WEB_THREADS" == "ON" ]; then
+  # SharedArrayBuffer needs the COOP/COEP headers of a cross-origin isolated
+  # page, which the plain http.server does not send
+  echo "python3 src/esp/bindings_js/serve.py"
+else
+  echo "python2 -m SimpleHTTPServer 8000"
+  echo "Or:"
+  echo "python3 -m http.server"
+fi
 echo "Then open in browser:"
 echo "http://0.0.0.0:8000/build_js/utils/viewer/viewer.html?scene=skokloster-castle.glb"
 echo "Or:"
 echo "http://0.0.0.0:8000/build_js/esp/bindings_js/bindings.html"
+echo "With --stream-scenes the scenes are streamed from data/, which has to be"
+echo "served too, e.g. by running the server in the repository root; the viewer"
+echo "needs the preloaded build."
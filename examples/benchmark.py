@@ -6,6 +6,7 @@
 
 
 import argparse
+import os
 
 import numpy as np
 
@@ -39,6 +40,27 @@ parser.add_argument(
     action="store_true",
     help="Whether to enable benchmarking of semantic sensor.",
 )
+parser.add_argument(
+    "--enable_physics",
+    action="store_true",
+    help="Benchmark rgb frames of a scene with physics objects, once per physics config.",
+)
+parser.add_argument(
+    "--physics_config_files",
+    type=str,
+    nargs="+",
+    default=[
+        "./data/default.phys_scene_config.json",
+        "./data/multithreaded.phys_scene_config.json",
+    ],
+    help="Physics configs to compare, e.g. single and multithreaded worlds.",
+)
+parser.add_argument(
+    "--num_objects",
+    type=int,
+    default=100,
+    help="Number of physics objects added to the scene.",
+)
 parser.add_argument("--seed", type=int, default=1)
 args = parser.parse_args()
 
@@ -64,6 +86,15 @@ benchmark_items = {
 if args.benchmark_semantic_sensor:
     benchmark_items["semantic_only"] = {"color_sensor": False, "semantic_sensor": True}
     benchmark_items["rgbd_semantic"] = {"depth_sensor": True, "semantic_sensor": True}
+if args.enable_physics:
+    default_settings["num_objects"] = args.num_objects
+    benchmark_items = {
+        os.path.basename(config_file).split(".")[0]: {
+            "enable_physics": True,
+            "physics_config_file": config_file,
+        }
+        for config_file in args.physics_config_files
+    }
 
 resolutions = args.resolution
 nprocs_tests = args.num_procs
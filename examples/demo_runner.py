@@ -136,6 +136,9 @@ class DemoRunner:
         object_lib_size = self._sim.get_physics_object_library_size()
         object_init_grid_dim = (3, 1, 3)
         object_init_grid = {}
+        assert num_objects <= np.prod(
+            [2 * d + 1 for d in object_init_grid_dim]
+        ), "too many objects for the initial object grid"
         for obj_id in range(num_objects):
             rand_obj_index = random.randint(0, object_lib_size - 1)
             # rand_obj_index = 0  # overwrite for specific object only
@@ -181,7 +184,9 @@ class DemoRunner:
 
         # load an object and position the agent for physics testing
         if self._sim_settings["enable_physics"]:
-            self.init_physics_test_scene(num_objects=10)
+            self.init_physics_test_scene(
+                num_objects=self._sim_settings["num_objects"]
+            )
             print("active object ids: " + str(self._sim.get_existing_object_ids()))
 
         time_per_step = []
@@ -131,9 +131,13 @@ class Agent(object):
         if reconfigure_sensors:
             self.sensors.clear()
             for spec in self.agent_config.sensor_specifications:
-                self.sensors.add(
-                    hsim.PinholeCamera(self.scene_node.create_child(), spec)
-                )
+                if hsim.NavigationSensor.is_navigation(spec):
+                    sensor_type = hsim.NavigationSensor
+                elif hsim.PanoramicSensor.is_panoramic(spec):
+                    sensor_type = hsim.PanoramicSensor
+                else:
+                    sensor_type = hsim.PinholeCamera
+                self.sensors.add(sensor_type(self.scene_node.create_child(), spec))
 
     def act(self, action_id: Any) -> bool:
         r"""Take the action specified by action_id
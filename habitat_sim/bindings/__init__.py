@@ -5,18 +5,29 @@
 # LICENSE file in the root directory of this source tree.
 
 modules = [
+    "ActionSpacePathFinder",
+    "Buffer",
+    "EpisodeConstraints",
+    "EpisodeSampler",
     "SceneNodeType",
     "GreedyFollowerCodes",
     "GreedyGeodesicFollowerImpl",
+    "MetricsRegistry",
+    "MetricsServer",
     "MultiGoalShortestPath",
+    "NavigationSensor",
+    "Observation",
+    "PanoramicSensor",
     "PathFinder",
     "PinholeCamera",
+    "Profiler",
     "SceneGraph",
     "SceneNode",
     "Sensor",
     "SensorSpec",
     "SensorType",
     "ShortestPath",
+    "SimulatorClient",
     "SimulatorConfiguration",
     "geo",
 ]
@@ -1,4 +1,4 @@
-from typing import Any, Dict, List, Optional
+from typing import Any, Dict, List, Optional, Tuple
 
 import attr
 import numpy as np
@@ -19,17 +19,20 @@ class GreedyGeodesicFollower(object):
             `None` is used to signify that the goal location has been reached
         goal_radius (Optional[float]): Specifies how close the agent must get to the goal in order for it to be considered
             reached.  If `None`, 0.75 times the agents step size is used.
+        optimal (bool): Find the shortest action sequences with a search over a lattice of agent poses,
+            `hsim.ActionSpacePathFinder`, instead of greedily fitting them.  The cost-to-go of the poses
+            along each path is cached, so following a path costs a lookup per step.  Not supported by
+            `find_path_with_states`
     """
 
     pathfinder: hsim.PathFinder
     agent: habitat_sim.agent.Agent
     goal_radius: Optional[float] = attr.ib(default=None)
+    optimal: bool = attr.ib(default=False)
     action_mapping: Dict[hsim.GreedyFollowerCodes, Any] = attr.ib(
         init=False, factory=dict, repr=False
     )
-    impl: hsim.GreedyGeodesicFollowerImpl = attr.ib(
-        init=False, default=None, repr=False
-    )
+    impl: Any = attr.ib(init=False, default=None, repr=False)
     forward_spec: habitat_sim.agent.ActuationSpec = attr.ib(
         init=False, default=None, repr=False
     )
@@ -58,6 +61,15 @@ class GreedyGeodesicFollower(object):
         if self.goal_radius is None:
             self.goal_radius = 0.75 * self.forward_spec.amount
 
+        if self.optimal:
+            self.impl = hsim.ActionSpacePathFinder(
+                self.pathfinder,
+                self.forward_spec.amount,
+                np.deg2rad(self.left_spec.amount),
+                self.goal_radius,
+            )
+            return
+
         self.impl = hsim.GreedyGeodesicFollowerImpl(
             self.pathfinder,
             self._move_forward,
@@ -91,6 +103,44 @@ class GreedyGeodesicFollower(object):
     def _turn_right(self, obj: hsim.SceneNode):
         self.agent.controls(obj, "turn_right", self.right_spec, True)
 
+    def find_path_with_states(
+        self, goal_pos: np.ndarray
+    ) -> Tuple[List[Any], np.ndarray, np.ndarray]:
+        r"""Same as `find_path`, but the whole episode is simulated in C++ and the
+        states of the agent are returned as well, e.g. to record expert
+        trajectories
+
+        Args:
+            goal_pos (np.array): The position of the goal
+
+        Returns:
+            Tuple[List[Any], np.ndarray, np.ndarray]: The list of actions to take,
+            ending with `None`, and the positions (N x 3) and rotation coefficients
+            (N x 4) of the agent before each action
+        """
+        if self.optimal:
+            raise NotImplementedError(
+                "find_path_with_states is only supported by the greedy follower"
+            )
+
+        state = self.agent.state
+        actions, positions, rotations = self.impl.find_path_actions(
+            state.position, utils.quat_to_coeffs(state.rotation), goal_pos
+        )
+
+        if len(actions) == 0:
+            raise errors.GreedyFollowerError()
+
+        actions = list(map(lambda v: self.action_mapping[v], actions))
+
+        return actions, positions, rotations
+
+    def reset(self):
+        r"""Drops the paths cached between calls. Needed if the navmesh of the
+        pathfinder changes, e.g. after it is rebuilt or reloaded
+        """
+        self.impl.reset()
+
     def next_action_along(self, goal_pos: np.ndarray) -> Any:
         r"""Find the next action to greedily follow the geodesic shortest path from the agent's current position
         to get to the goal
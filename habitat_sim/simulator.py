@@ -4,6 +4,7 @@
 # This source code is licensed under the MIT license found in the
 # LICENSE file in the root directory of this source tree.
 
+import copy
 import os.path as osp
 from typing import List, Optional
 
@@ -27,6 +28,9 @@ class Configuration(object):
 @attr.s(auto_attribs=True)
 class Simulator:
     config: Configuration
+    # simulator to share GL objects and assets with, e.g. one per thread; its
+    # sim_cfg needs shareable_context
+    share_with: Optional["Simulator"] = None
     agents: List[Agent] = attr.ib(factory=list, init=False)
     pathfinder: hsim.PathFinder = attr.ib(default=None, init=False)
     _sim: hsim.SimulatorBackend = attr.ib(default=None, init=False)
@@ -46,13 +50,16 @@ class Simulator:
 
     def seed(self, new_seed):
         self._sim.seed(new_seed)
+        self.pathfinder.seed(new_seed)
 
     def reset(self):
         self._sim.reset()
         return self.get_sensor_observations()
 
     def _config_backend(self, config: Configuration):
-        if self._sim is None:
+        if self._sim is None and self.share_with is not None:
+            self._sim = hsim.SimulatorBackend(config.sim_cfg, self.share_with._sim)
+        elif self._sim is None:
             self._sim = hsim.SimulatorBackend(config.sim_cfg)
         else:
             self._sim.reconfigure(config.sim_cfg)
@@ -82,6 +89,8 @@ class Simulator:
             logger.warning(
                 f"Could not find navmesh {navmesh_filenname}, no collision checking will be done"
             )
+        # for the geodesic distance sensors
+        self._sim.pathfinder = self.pathfinder
 
     def reconfigure(self, config: Configuration):
         assert len(config.agents) > 0
@@ -122,6 +131,57 @@ class Simulator:
 
         self.config = config
 
+    def prefetch(self, config: Configuration):
+        r"""Starts loading the scene of config in the background, so that a
+        following reconfigure(config) only has to upload it to the GPU
+        """
+        return self._sim.prefetch_scene(config.sim_cfg.scene)
+
+    def clone(self) -> "Simulator":
+        r"""Fork of the simulator for branching rollouts, e.g. in planning or
+        search. It shares the GL context, renderer, assets and pathfinder of
+        this simulator, and gets copies of the physics objects and the agents
+        in their current states. Costs milliseconds rather than a reconfigure
+        """
+        fork = copy.copy(self)
+        fork.share_with = None
+        fork._sim = self._sim.clone()
+        fork.agents = []
+        for agent in self.agents:
+            fork_agent = Agent(
+                fork._sim.get_active_scene_graph().get_root_node().create_child(),
+                agent.agent_config,
+            )
+            fork_agent.set_state(agent.get_state(), reset_sensors=False)
+            fork_agent.controls.move_filter_fn = fork._step_filter
+            fork.agents.append(fork_agent)
+
+        fork._default_agent = fork.get_agent(self.config.sim_cfg.default_agent_id)
+        fork._sensors = {
+            uuid: Sensor(sim=fork._sim, agent=fork._default_agent, sensor_id=uuid)
+            for uuid in self._sensors
+        }
+        return fork
+
+    def get_memory_stats(self):
+        r"""GPU memory of the loaded meshes and textures, in bytes, with the
+        share of each asset by absolute path in asset_bytes
+        """
+        return self._sim.get_memory_stats()
+
+    def finish_streamed_textures(self):
+        r"""Load the textures streamed in for the frames drawn so far, with
+        ``stream_textures`` set, so that the next observations show them
+        """
+        self._sim.finish_streamed_textures()
+
+    def get_load_trace(self):
+        r"""Seconds spent reading, processing, uploading, compiling shaders,
+        instantiating and building collision meshes while loading the last
+        scene, with the peak resident memory and GPU memory of the load
+        """
+        return self._sim.get_load_trace()
+
     def get_agent(self, agent_id):
         return self.agents[agent_id]
 
@@ -147,21 +207,31 @@ class Simulator:
         return self._sim.semantic_scene
 
     def get_sensor_observations(self):
+        # color sensors draw every attachment, so the depth and semantic
+        # sensors at their pose go after them and keep their frame, see
+        # Renderer.sensor_frame_sharing
+        sensors = sorted(
+            self._sensors.items(),
+            key=lambda item: item[1]._spec.sensor_type != hsim.SensorType.COLOR,
+        )
         observations = {}
-        for sensor_uuid, sensor in self._sensors.items():
+        for sensor_uuid, sensor in sensors:
             observations[sensor_uuid] = sensor.get_observation()
-        return observations
+        return {uuid: observations[uuid] for uuid in self._sensors}
 
     def last_state(self):
         return self._last_state
 
-    def step(self, action, dt=1.0 / 60.0):
+    def step(self, action, dt=1.0 / 60.0, num_physics_steps=1):
+        r"""Acts and steps the physics ``num_physics_steps`` times by ``dt``,
+        in one go for frame skipping
+        """
         self._num_total_frames += 1
         collided = self._default_agent.act(action)
         self._last_state = self._default_agent.get_state()
 
         # step physics by dt
-        self._sim.step_world(dt)
+        self._sim.step_world(dt, num_physics_steps)
         # print("World time is now: " + str(self._sim.get_world_time()))
 
         observations = self.get_sensor_observations()
@@ -170,9 +240,34 @@ class Simulator:
 
         return observations
 
-    def make_greedy_follower(self, agent_id: int = 0, goal_radius: float = None):
+    def render_poses(self, poses, sensor_spec) -> np.ndarray:
+        r"""Render the active scene from many camera poses without an agent,
+        e.g. to export a dataset of images.
+
+        :param poses: N x 4 x 4 array of camera transformations, looking
+            along -Z
+        :param sensor_spec: resolution, projection and type of the images
+        :return: N images, as the observations of a sensor of sensor_spec
+        """
+        poses = np.asarray(poses, dtype=np.float32)
+        if sensor_spec.sensor_type == hsim.SensorType.SEMANTIC:
+            scene = self._sim.get_active_semantic_scene_graph()
+        else:
+            scene = self._sim.get_active_scene_graph()
+        frames = _empty_frames(sensor_spec, len(poses))
+
+        if not self._sim.renderer.render_poses(scene, poses, sensor_spec, frames):
+            raise ValueError(
+                "Cannot render poses of sensor type {}".format(sensor_spec.sensor_type)
+            )
+        # the frames are read bottom row first, like the observations
+        return np.flip(frames, axis=1)
+
+    def make_greedy_follower(
+        self, agent_id: int = 0, goal_radius: float = None, optimal: bool = False
+    ):
         return GreedyGeodesicFollower(
-            self.pathfinder, self.get_agent(agent_id), goal_radius
+            self.pathfinder, self.get_agent(agent_id), goal_radius, optimal
         )
 
     def _step_filter(self, start_pos, end_pos):
@@ -194,6 +289,12 @@ class Simulator:
     def remove_object(self, object_id):
         self._sim.remove_object(object_id)
 
+    def add_objects(self, object_lib_indices, scene_id=0):
+        return self._sim.add_objects(object_lib_indices, scene_id)
+
+    def remove_objects(self, object_ids, scene_id=0):
+        self._sim.remove_objects(object_ids, scene_id)
+
     def get_existing_object_ids(self, scene_id=0):
         return self._sim.get_existing_object_ids(scene_id)
 
@@ -209,6 +310,78 @@ class Simulator:
     def get_translation(self, object_id, scene_id=0):
         return self._sim.get_translation(object_id, scene_id)
 
+    def set_transformations(self, transforms, object_ids, scene_id=0):
+        r"""Sets the transformations of many objects at once
+
+        :param transforms: N x 4 x 4 array, one transformation per object
+        :param object_ids: The N object IDs
+        """
+        self._sim.set_transformations(transforms, object_ids, scene_id)
+
+    def get_transformations(self, object_ids, scene_id=0) -> np.ndarray:
+        r"""Transformations of many objects at once, as an N x 4 x 4 array"""
+        return self._sim.get_transformations(object_ids, scene_id)
+
+    def set_translations(self, translations, object_ids, scene_id=0):
+        r"""Sets the translations of many objects at once
+
+        :param translations: N x 3 array, one translation per object
+        :param object_ids: The N object IDs
+        """
+        self._sim.set_translations(translations, object_ids, scene_id)
+
+    def get_translations(self, object_ids, scene_id=0) -> np.ndarray:
+        r"""Translations of many objects at once, as an N x 3 array"""
+        return self._sim.get_translations(object_ids, scene_id)
+
+    def cast_rays(self, origins, directions, max_distance, scene_id=0):
+        r"""Closest hits of many rays at once, without rendering
+
+        :param origins: N x 3 array, one ray origin per ray
+        :param directions: N x 3 array of ray directions
+        :param max_distance: Length of the rays
+        :return: Dict of N entry arrays: ``hit``, ``object_id`` (-1 for the
+            scene), ``distance``, and N x 3 ``point`` and ``normal``
+        """
+        return self._sim.cast_rays(origins, directions, max_distance, scene_id)
+
+    def sweep_shapes(self, shape, origins, directions, max_distance, scene_id=0):
+        r"""Like :py:meth:`cast_rays`, for a :py:class:`SweepShape` swept
+        along the rays, e.g. to check a grasp or an agent's path
+        """
+        return self._sim.sweep_shapes(
+            shape, origins, directions, max_distance, scene_id
+        )
+
+    def contact_test(self, object_id, scene_id=0):
+        r"""Contacts of an object where it stands now, without stepping the
+        world, e.g. to reject a spawn placement that collides
+
+        :return: Dict of N entry arrays: ``object_id_a``, ``object_id_b``
+            (-1 for the scene), ``distance`` (negative when penetrating),
+            and N x 3 ``position_on_a``, ``position_on_b`` and ``normal_on_b``
+        """
+        return self._sim.contact_test(object_id, scene_id)
+
+    def overlap_aabb(self, box_min, box_max, scene_id=0) -> List[int]:
+        r"""IDs of the objects whose collision bounds overlap the box from
+        box_min to box_max, with -1 first if the scene does
+        """
+        return self._sim.overlap_aabb(box_min, box_max, scene_id)
+
+    def save_physics_state(self, scene_id=0) -> bytes:
+        r"""Snapshot of the physics world: poses, velocities and activation
+        states of all objects. Restoring it is much cheaper than removing
+        and re-adding objects, e.g. to reset an episode.
+        """
+        return self._sim.save_physics_state(scene_id)
+
+    def restore_physics_state(self, state: bytes, scene_id=0) -> bool:
+        r"""Restores a snapshot of :py:meth:`save_physics_state` in place.
+        The objects of the snapshot have to still exist.
+        """
+        return self._sim.restore_physics_state(state, scene_id)
+
     def set_rotation(self, rotation, object_id, scene_id=0):
         self._sim.set_rotation(rotation, object_id, scene_id)
 
@@ -222,6 +395,30 @@ class Simulator:
         self._sim.apply_torque(torque, object_id, scene_id)
 
 
+# numpy element type and channels of frames read in each format
+_frame_layouts = {
+    hsim.FrameFormat.RGBA8: (np.uint8, 4),
+    hsim.FrameFormat.RGB8: (np.uint8, 3),
+    hsim.FrameFormat.DEPTH32F: (np.float32, 1),
+    hsim.FrameFormat.DEPTH16F: (np.float16, 1),
+    hsim.FrameFormat.DEPTH16MM: (np.uint16, 1),
+    hsim.FrameFormat.OBJECT_ID32: (np.uint32, 1),
+}
+
+
+def _empty_frames(spec, count: Optional[int] = None) -> np.ndarray:
+    r"""Buffer for frames of a visual sensor of spec, in the format they are
+    read in: height x width, with a last axis of channels for color
+    """
+    dtype, channels = _frame_layouts[hsim.get_frame_format(spec)]
+    shape = tuple(spec.resolution)
+    if channels > 1:
+        shape += (channels,)
+    if count is not None:
+        shape = (count,) + shape
+    return np.empty(shape, dtype=dtype)
+
+
 class Sensor:
     r"""Wrapper around habitat_sim.Sensor
 
@@ -237,22 +434,12 @@ class Sensor:
         self._sensor_object = self._agent.sensors.get(sensor_id)
 
         self._spec = self._sensor_object.specification()
-        if self._spec.sensor_type == hsim.SensorType.SEMANTIC:
-            self._buffer = np.empty(
-                (self._spec.resolution[0], self._spec.resolution[1]), dtype=np.uint32
-            )
-        elif self._spec.sensor_type == hsim.SensorType.DEPTH:
-            self._buffer = np.empty(
-                (self._spec.resolution[0], self._spec.resolution[1]), dtype=np.float32
-            )
-        else:
-            self._buffer = np.empty(
-                (
-                    self._spec.resolution[0],
-                    self._spec.resolution[1] * self._spec.channels,
-                ),
-                dtype=np.uint8,
-            )
+        if isinstance(self._sensor_object, hsim.NavigationSensor):
+            self._frame_format = None
+            self._buffer = None
+            return
+        self._frame_format = hsim.get_frame_format(self._spec)
+        self._buffer = _empty_frames(self._spec)
 
     def get_observation(self):
         # sanity check:
@@ -264,6 +451,13 @@ class Sensor:
                  (has it been detached from a scene node?)"
             )
 
+        # computed from the pose of the agent, nothing is drawn
+        if isinstance(self._sensor_object, hsim.NavigationSensor):
+            obs = hsim.Observation()
+            if not self._sensor_object.get_observation(self._sim, obs):
+                return None
+            return obs.data.copy()
+
         # get the correct scene graph based on application
         if self._spec.sensor_type == hsim.SensorType.SEMANTIC:
             if self._sim.semantic_scene is None:
@@ -284,28 +478,36 @@ class Sensor:
         agent_node = self._agent.scene_node
         agent_node.parent = scene.get_root_node()
 
+        # the sensor keeps its last frame while nothing it sees changed,
+        # downsamples a supersampled one, or adds its noise to the frame
+        native = (
+            self._spec.frame_reuse
+            or self._spec.supersampling > 1
+            or "noise_model" in self._spec.parameters
+        )
+        if native and not isinstance(self._sensor_object, hsim.PanoramicSensor):
+            obs = hsim.Observation()
+            self._sensor_object.get_observation(self._sim, obs)
+            data = obs.data
+            if self._spec.sensor_type != hsim.SensorType.COLOR:
+                data = data.reshape(data.shape[:2])
+            return np.flip(data, axis=0).copy()
+
         # draw the scene with the visual sensor:
         # it asserts the sensor is a visual sensor;
         # internally it will set the camera parameters (from the sensor) to the
         # default render camera in the scene so that
         # it has correct modelview matrix, projection matrix to render the scene
-        self._sim.renderer.draw(self._sensor_object, scene)
-
-        if self._spec.sensor_type == hsim.SensorType.SEMANTIC:
-            self._sim.renderer.readFrameObjectId(self._buffer)
-            return np.flip(self._buffer, axis=0).copy()
-        elif self._spec.sensor_type == hsim.SensorType.DEPTH:
-            self._sim.renderer.readFrameDepth(self._buffer)
-            return np.flip(self._buffer, axis=0).copy()
+        if isinstance(self._sensor_object, hsim.PanoramicSensor):
+            self._sim.renderer.draw_panorama(
+                self._sensor_object,
+                scene,
+                self._sensor_object.face_size,
+                self._sensor_object.projection,
+            )
         else:
-            self._sim.renderer.readFrameRgba(self._buffer)
-            return np.flip(
-                self._buffer.reshape(
-                    (
-                        self._spec.resolution[0],
-                        self._spec.resolution[1],
-                        self._spec.channels,
-                    )
-                ),
-                axis=0,
-            ).copy()
+            self._sim.renderer.draw(self._sensor_object, scene)
+
+        # converted to the format of the spec on the GPU
+        self._sim.renderer.read_frame(self._frame_format, self._buffer)
+        return np.flip(self._buffer, axis=0).copy()
@@ -59,6 +59,12 @@ Use "HEADLESS=True pip install ." to build in headless mode with pip""",
         action="store_true",
         help="Build data tool",
     )
+    parser.add_argument(
+        "--build-benchmarks",
+        dest="build_benchmarks",
+        action="store_true",
+        help="Build the native simulator throughput benchmark",
+    )
     parser.add_argument(
         "--cmake-args",
         type=str,
@@ -241,6 +247,9 @@ class CMakeBuild(build_ext):
         cmake_args += [
             "-DBUILD_DATATOOL={}".format("ON" if args.build_datatool else "OFF")
         ]
+        cmake_args += [
+            "-DBUILD_BENCHMARKS={}".format("ON" if args.build_benchmarks else "OFF")
+        ]
 
         env = os.environ.copy()
         env["CXXFLAGS"] = '{} -DVERSION_INFO=\\"{}\\"'.format(
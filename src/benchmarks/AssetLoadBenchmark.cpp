@@ -0,0 +1,219 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+// Where the time of loading a scene goes: each scene file, of any asset type
+// (PTex, instance mesh, GLB, SUNCG house, ...), is loaded into a fresh
+// ResourceManager on a fresh GL context, so that nothing is cached but what
+// is on disk, and the LoadTrace of each load is reported: reading and
+// parsing, CPU processing, GPU upload, shader compilation, instantiation and
+// collision meshes, with the time the GPU takes to finish the uploads, the
+// peak resident memory and the GPU memory of the scene. Prints a table and
+// optionally writes the results as JSON for regression tracking.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <Corrade/Utility/Arguments.h>
+#include <Corrade/Utility/Directory.h>
+#include <Corrade/Utility/String.h>
+#include <Magnum/GL/Renderer.h>
+#include <rapidjson/prettywriter.h>
+#include <rapidjson/stringbuffer.h>
+
+#include "esp/assets/LoadTrace.h"
+#include "esp/assets/ResourceManager.h"
+#include "esp/core/esp.h"
+#include "esp/gfx/WindowlessContext.h"
+#include "esp/physics/PhysicsManager.h"
+#include "esp/scene/SceneGraph.h"
+
+namespace Cr = Corrade;
+
+using namespace esp;
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+struct BenchmarkResult {
+  std::string scene;
+  std::string assetType;
+  // trace of the fastest load
+  assets::LoadTrace trace;
+  // seconds for the GPU to finish the work the load submitted
+  double gpuFinishSeconds = 0.0;
+};
+
+const char* assetTypeName(assets::AssetType type) {
+  switch (type) {
+    case assets::AssetType::FRL_PTEX_MESH:
+      return "ptex";
+    case assets::AssetType::FRL_INSTANCE_MESH:
+      return "frl_instance_mesh";
+    case assets::AssetType::INSTANCE_MESH:
+      return "instance_mesh";
+    case assets::AssetType::MP3D_MESH:
+      return "mp3d_glb";
+    case assets::AssetType::SUNCG_SCENE:
+      return "suncg";
+    default:
+      return "general";
+  }
+}
+
+// Load scene into a fresh ResourceManager on a fresh context, false if the
+// load failed
+bool loadOnce(const assets::AssetInfo& info,
+              const std::string& physicsConfig,
+              int gpuDevice,
+              BenchmarkResult& result) {
+  gfx::WindowlessContext context{gpuDevice};
+  assets::ResourceManager resourceManager;
+  scene::SceneGraph sceneGraph;
+  std::shared_ptr<physics::PhysicsManager> physicsManager;
+  bool loaded;
+  if (physicsConfig.empty()) {
+    loaded = resourceManager.loadScene(info, &sceneGraph.getRootNode(),
+                                       &sceneGraph.getDrawables());
+  } else {
+    loaded = resourceManager.loadScene(info, physicsManager,
+                                       &sceneGraph.getRootNode(),
+                                       &sceneGraph.getDrawables(),
+                                       physicsConfig);
+  }
+  const Clock::time_point start = Clock::now();
+  Magnum::GL::Renderer::finish();
+  result.gpuFinishSeconds =
+      std::chrono::duration<double>(Clock::now() - start).count();
+  result.trace = resourceManager.getLoadTrace();
+  return loaded;
+}
+
+void printResults(const std::vector<BenchmarkResult>& results) {
+  std::printf("%-28s %-18s", "scene", "type");
+  for (int i = 0; i < assets::numLoadStages; ++i) {
+    std::printf(" %11s",
+                (std::string{assets::loadStageName(
+                     static_cast<assets::LoadStage>(i))} +
+                 " ms")
+                    .c_str());
+  }
+  std::printf(" %11s %11s %9s %9s\n", "gpu ms", "total ms", "RSS MB",
+              "GPU MB");
+  for (const BenchmarkResult& result : results) {
+    std::printf("%-28s %-18s",
+                Cr::Utility::Directory::filename(result.scene).c_str(),
+                result.assetType.c_str());
+    for (double seconds : result.trace.stageSeconds) {
+      std::printf(" %11.1f", 1000.0 * seconds);
+    }
+    std::printf(" %11.1f %11.1f %9.1f %9.1f\n",
+                1000.0 * result.gpuFinishSeconds,
+                1000.0 * result.trace.totalSeconds,
+                result.trace.peakResidentBytes / 1048576.0,
+                result.trace.gpuBytes / 1048576.0);
+  }
+}
+
+bool writeJson(const std::string& file,
+               const std::vector<BenchmarkResult>& results) {
+  rapidjson::StringBuffer buffer;
+  rapidjson::PrettyWriter<rapidjson::StringBuffer> writer{buffer};
+  writer.StartObject();
+  writer.Key("results");
+  writer.StartArray();
+  for (const BenchmarkResult& result : results) {
+    writer.StartObject();
+    writer.Key("scene");
+    writer.String(result.scene.c_str());
+    writer.Key("type");
+    writer.String(result.assetType.c_str());
+    writer.Key("stages_ms");
+    writer.StartObject();
+    for (int i = 0; i < assets::numLoadStages; ++i) {
+      writer.Key(assets::loadStageName(static_cast<assets::LoadStage>(i)));
+      writer.Double(1000.0 * result.trace.stageSeconds[i]);
+    }
+    writer.EndObject();
+    writer.Key("gpu_finish_ms");
+    writer.Double(1000.0 * result.gpuFinishSeconds);
+    writer.Key("total_ms");
+    writer.Double(1000.0 * result.trace.totalSeconds);
+    writer.Key("peak_resident_bytes");
+    writer.Uint64(result.trace.peakResidentBytes);
+    writer.Key("gpu_bytes");
+    writer.Uint64(result.trace.gpuBytes);
+    writer.EndObject();
+  }
+  writer.EndArray();
+  writer.EndObject();
+
+  std::ofstream out{file};
+  if (!(out << buffer.GetString() << std::endl)) {
+    LOG(ERROR) << "Cannot write benchmark results to " << file;
+    return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Cr::Utility::Arguments args;
+  args.addArgument("scenes")
+      .setHelp("scenes",
+               "comma-separated scene files, e.g. a .glb, a PTex or "
+               "instance mesh .ply and a SUNCG house .json")
+      .addOption("repeats", "3")
+      .setHelp("repeats", "loads of each scene to report the fastest of")
+      .addOption("physics-config", "")
+      .setHelp("physics-config",
+               "physics scene config file to build the collision meshes "
+               "with, none if empty")
+      .addOption("gpu-device", "0")
+      .setHelp("gpu-device", "CUDA device to load on, -1 picks one")
+      .addOption("json", "")
+      .setHelp("json", "file to write the results to as JSON")
+      .setGlobalHelp(
+          "Measures the time of each stage of loading scenes, along with "
+          "their peak resident and GPU memory")
+      .parse(argc, argv);
+
+  const int repeats = std::max(1, args.value<int>("repeats"));
+  const int gpuDevice = args.value<int>("gpu-device");
+  const std::string physicsConfig = args.value("physics-config");
+
+  std::vector<BenchmarkResult> results;
+  for (const std::string& scene : Cr::Utility::String::splitWithoutEmptyParts(
+           args.value("scenes"), ',')) {
+    const assets::AssetInfo info = assets::AssetInfo::fromPath(scene);
+    LOG(INFO) << "Benchmarking " << scene;
+    BenchmarkResult best;
+    for (int i = 0; i < repeats; ++i) {
+      BenchmarkResult result;
+      result.scene = scene;
+      result.assetType = assetTypeName(info.type);
+      if (!loadOnce(info, physicsConfig, gpuDevice, result)) {
+        LOG(ERROR) << "Cannot load " << scene;
+        return 1;
+      }
+      if (i == 0 || result.trace.totalSeconds < best.trace.totalSeconds) {
+        best = result;
+      }
+    }
+    results.push_back(best);
+  }
+
+  printResults(results);
+  if (!args.value("json").empty() &&
+      !writeJson(args.value("json"), results)) {
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,112 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+// Time of the 2D convex hulls and gravity aligned minimum OBBs of many random
+// point sets, like the floor points of the regions of a house, computed one
+// at a time and batched over threads.
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include <Corrade/Utility/Arguments.h>
+
+#include "esp/core/esp.h"
+#include "esp/geo/OBB.h"
+#include "esp/geo/geo.h"
+
+namespace Cr = Corrade;
+
+using namespace esp;
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+// Best time of repeats runs of f, in seconds
+template <typename F>
+double bestTime(int repeats, F f) {
+  double best = 0.0;
+  for (int i = 0; i < repeats; ++i) {
+    const Clock::time_point start = Clock::now();
+    f();
+    const double time =
+        std::chrono::duration<double>(Clock::now() - start).count();
+    if (i == 0 || time < best) {
+      best = time;
+    }
+  }
+  return best;
+}
+
+void printRow(const char* name, double serial, double batched) {
+  std::printf("%-10s %12.3f %12.3f %8.2fx\n", name, 1000.0 * serial,
+              1000.0 * batched, batched > 0.0 ? serial / batched : 0.0);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Cr::Utility::Arguments args;
+  args.addOption("sets", "2000")
+      .setHelp("sets", "number of point sets")
+      .addOption("points", "256")
+      .setHelp("points", "points per set")
+      .addOption("threads", "0")
+      .setHelp("threads", "threads of the batched runs, 0 for all")
+      .addOption("repeats", "5")
+      .setHelp("repeats", "runs to take the best time of")
+      .addOption("seed", "0")
+      .setGlobalHelp(
+          "Measures convexHull2D and computeGravityAlignedMOBB one set at a "
+          "time and batched")
+      .parse(argc, argv);
+
+  const int numSets = args.value<int>("sets");
+  const int numPoints = args.value<int>("points");
+  const int numThreads = args.value<int>("threads");
+  const int repeats = args.value<int>("repeats");
+
+  std::mt19937 rng(args.value<uint32_t>("seed"));
+  std::uniform_real_distribution<float> uniform(-5.0f, 5.0f);
+  std::vector<std::vector<vec2f>> pointSets2D(numSets);
+  std::vector<std::vector<vec3f>> pointSets3D(numSets);
+  for (int i = 0; i < numSets; ++i) {
+    for (int j = 0; j < numPoints; ++j) {
+      const vec3f point(uniform(rng), uniform(rng) * 0.3f, uniform(rng));
+      pointSets2D[i].emplace_back(point.x(), point.z());
+      pointSets3D[i].push_back(point);
+    }
+  }
+
+  std::printf("%d sets of %d points\n", numSets, numPoints);
+  std::printf("%-10s %12s %12s %9s\n", "", "serial ms", "batched ms",
+              "speedup");
+
+  std::vector<std::vector<vec2f>> hulls(numSets);
+  const double hullSerial = bestTime(repeats, [&]() {
+    for (int i = 0; i < numSets; ++i) {
+      hulls[i] = geo::convexHull2D(pointSets2D[i]);
+    }
+  });
+  const double hullBatched = bestTime(repeats, [&]() {
+    hulls = geo::convexHull2DBatch(pointSets2D, numThreads);
+  });
+  printRow("hull2D", hullSerial, hullBatched);
+
+  std::vector<geo::OBB> obbs(numSets);
+  const double obbSerial = bestTime(repeats, [&]() {
+    for (int i = 0; i < numSets; ++i) {
+      obbs[i] =
+          geo::computeGravityAlignedMOBB(geo::ESP_GRAVITY, pointSets3D[i]);
+    }
+  });
+  const double obbBatched = bestTime(repeats, [&]() {
+    obbs = geo::computeGravityAlignedMOBBBatch(geo::ESP_GRAVITY, pointSets3D,
+                                               numThreads);
+  });
+  printRow("MOBB", obbSerial, obbBatched);
+  return 0;
+}
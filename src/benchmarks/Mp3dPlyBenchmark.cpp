@@ -0,0 +1,96 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+// Time of the steps of datatool create_mp3d_semantic_mesh on an MP3D house:
+// loading its segmentations PLY and saving the semantic mesh PLY.
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+
+#include <Corrade/Utility/Arguments.h>
+
+#include "esp/assets/Mp3dInstanceMeshData.h"
+#include "esp/core/esp.h"
+#include "esp/io/io.h"
+#include "esp/scene/SemanticScene.h"
+
+namespace Cr = Corrade;
+
+using namespace esp;
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+// Best time of repeats runs of f, in seconds
+template <typename F>
+double bestTime(int repeats, F f) {
+  double best = 0.0;
+  for (int i = 0; i < repeats; ++i) {
+    const Clock::time_point start = Clock::now();
+    f();
+    const double time =
+        std::chrono::duration<double>(Clock::now() - start).count();
+    if (i == 0 || time < best) {
+      best = time;
+    }
+  }
+  return best;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Cr::Utility::Arguments args;
+  args.addArgument("ply")
+      .setHelp("ply", "house segmentations PLY, e.g. <scan>_semantic.ply")
+      .addArgument("house")
+      .setHelp("house", ".house file of the scan")
+      .addOption("output", "/tmp/Mp3dPlyBenchmark.ply")
+      .setHelp("output", "semantic mesh PLY to write")
+      .addOption("repeats", "5")
+      .setHelp("repeats", "runs to take the best time of")
+      .setGlobalHelp(
+          "Measures Mp3dInstanceMeshData::loadMp3dPLY and saveSemMeshPLY")
+      .parse(argc, argv);
+
+  const std::string plyFile = args.value("ply");
+  const std::string output = args.value("output");
+  const int repeats = args.value<int>("repeats");
+
+  scene::SemanticScene semanticScene;
+  if (!scene::SemanticScene::loadMp3dHouse(args.value("house"),
+                                           semanticScene)) {
+    return 1;
+  }
+  const std::unordered_map<int, int>& objectIdMap =
+      semanticScene.getSemanticIndexMap();
+
+  assets::Mp3dInstanceMeshData mesh;
+  bool success = true;
+  const double loadTime = bestTime(repeats, [&]() {
+    assets::Mp3dInstanceMeshData loaded;
+    success = success && loaded.loadMp3dPLY(plyFile);
+  });
+  if (!success || !mesh.loadMp3dPLY(plyFile)) {
+    return 1;
+  }
+  const double saveTime = bestTime(repeats, [&]() {
+    success = success && mesh.saveSemMeshPLY(output, objectIdMap);
+  });
+  if (!success) {
+    return 1;
+  }
+
+  const double megabytes = io::fileSize(plyFile) / double(1 << 20);
+  std::printf("%-6s %10s %10s\n", "", "ms", "MB/s");
+  std::printf("%-6s %10.1f %10.1f\n", "load", 1000.0 * loadTime,
+              megabytes / loadTime);
+  const double outputMegabytes = io::fileSize(output) / double(1 << 20);
+  std::printf("%-6s %10.1f %10.1f\n", "save", 1000.0 * saveTime,
+              outputMegabytes / saveTime);
+  return 0;
+}
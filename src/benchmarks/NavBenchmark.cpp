@@ -0,0 +1,358 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+// Latency and throughput of the PathFinder queries on real navmeshes, e.g.
+// the ones of the test scenes: every query is timed on its own, on one
+// thread or on several threads with a PathFinder each, as parallel
+// environments use them. Building the islands of each navmesh and, if asked
+// for, the navmesh of its scene are timed as well. Prints a table and
+// optionally writes the results as JSON for regression tracking.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <Corrade/Utility/Arguments.h>
+#include <Corrade/Utility/Directory.h>
+#include <Corrade/Utility/String.h>
+#include <rapidjson/prettywriter.h>
+#include <rapidjson/stringbuffer.h>
+
+#include "SceneLoader.h"
+
+#include "esp/core/ThreadPool.h"
+#include "esp/core/esp.h"
+#include "esp/nav/PathFinder.h"
+
+namespace Cr = Corrade;
+
+using namespace esp;
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+// goals of each multi-goal path
+constexpr int numGoals = 5;
+// length of the steps tried, about a forward action
+constexpr float stepLength = 0.25f;
+
+struct BenchmarkResult {
+  std::string navmesh;
+  std::string query;
+  int threads = 1;
+  // seconds of each call
+  std::vector<double> times;
+  // seconds from the first call starting to the last one returning
+  double wallTime = 0.0;
+
+  double callsPerSecond() const {
+    return wallTime > 0.0 ? times.size() / wallTime : 0.0;
+  }
+};
+
+double percentile(std::vector<double> times, double p) {
+  if (times.empty()) {
+    return 0.0;
+  }
+  const size_t n = std::min(times.size() - 1, size_t(p * times.size()));
+  std::nth_element(times.begin(), times.begin() + n, times.end());
+  return times[n];
+}
+
+double mean(const std::vector<double>& times) {
+  return times.empty() ? 0.0
+                       : std::accumulate(times.begin(), times.end(), 0.0) /
+                             times.size();
+}
+
+// Run task(pathfinder, i) for i in [0, count), on the PathFinder of each
+// thread, timing each call
+BenchmarkResult runQueries(
+    const std::string& navmesh,
+    const std::string& query,
+    std::vector<nav::PathFinder::ptr>& pathfinders,
+    size_t count,
+    const std::function<void(nav::PathFinder&, size_t)>& task) {
+  BenchmarkResult result;
+  result.navmesh = navmesh;
+  result.query = query;
+  result.threads = pathfinders.size();
+  result.times.resize(count);
+  auto timed = [&](size_t i, int slot) {
+    const Clock::time_point start = Clock::now();
+    task(*pathfinders[slot], i);
+    result.times[i] =
+        std::chrono::duration<double>(Clock::now() - start).count();
+  };
+  const Clock::time_point start = Clock::now();
+  if (pathfinders.size() == 1) {
+    for (size_t i = 0; i < count; ++i) {
+      timed(i, 0);
+    }
+  } else {
+    core::parallelForWithSlots(count, pathfinders.size(), timed);
+  }
+  result.wallTime = std::chrono::duration<double>(Clock::now() - start).count();
+  return result;
+}
+
+// Time repeats runs of f one after another
+BenchmarkResult runRepeated(const std::string& navmesh,
+                            const std::string& query,
+                            int repeats,
+                            const std::function<bool()>& f) {
+  BenchmarkResult result;
+  result.navmesh = navmesh;
+  result.query = query;
+  for (int i = 0; i < repeats; ++i) {
+    const Clock::time_point start = Clock::now();
+    if (!f()) {
+      LOG(ERROR) << query << " failed on " << navmesh;
+    }
+    result.times.push_back(
+        std::chrono::duration<double>(Clock::now() - start).count());
+  }
+  result.wallTime = std::accumulate(result.times.begin(), result.times.end(),
+                                    0.0);
+  return result;
+}
+
+// The queries of all the navmesh points, sampled once so that every thread
+// count runs the same ones
+struct QueryPoints {
+  std::vector<vec3f> starts;
+  std::vector<vec3f> ends;
+  // ends of the steps tried from starts
+  std::vector<vec3f> stepEnds;
+  // navigable points moved up to a meter, so that some are not navigable
+  std::vector<vec3f> probes;
+};
+
+QueryPoints sampleQueryPoints(nav::PathFinder& pathfinder,
+                              size_t count,
+                              uint32_t seed) {
+  pathfinder.seed(seed);
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+  QueryPoints points;
+  for (size_t i = 0; i < count; ++i) {
+    points.starts.push_back(pathfinder.getRandomNavigablePoint());
+    points.ends.push_back(pathfinder.getRandomNavigablePoint());
+    const float angle = float(M_PI) * uniform(rng);
+    points.stepEnds.push_back(
+        points.starts.back() +
+        stepLength * vec3f(std::cos(angle), 0.0f, std::sin(angle)));
+    points.probes.push_back(points.starts.back() +
+                            vec3f(uniform(rng), uniform(rng), uniform(rng)));
+  }
+  return points;
+}
+
+std::vector<BenchmarkResult> runQueryBenchmarks(
+    const std::string& navmesh,
+    const QueryPoints& points,
+    std::vector<nav::PathFinder::ptr>& pathfinders,
+    uint32_t seed) {
+  const size_t count = points.starts.size();
+  std::vector<BenchmarkResult> results;
+  results.push_back(runQueries(
+      navmesh, "findPath", pathfinders, count,
+      [&](nav::PathFinder& pathfinder, size_t i) {
+        nav::ShortestPath path;
+        path.requestedStart = points.starts[i];
+        path.requestedEnd = points.ends[i];
+        pathfinder.findPath(path);
+      }));
+  results.push_back(runQueries(
+      navmesh, "findPath multi-goal", pathfinders, count,
+      [&](nav::PathFinder& pathfinder, size_t i) {
+        nav::MultiGoalShortestPath path;
+        path.requestedStart = points.starts[i];
+        for (int j = 0; j < numGoals; ++j) {
+          path.requestedEnds.push_back(points.ends[(i + j) % count]);
+        }
+        pathfinder.findPath(path);
+      }));
+  results.push_back(runQueries(navmesh, "tryStep", pathfinders, count,
+                               [&](nav::PathFinder& pathfinder, size_t i) {
+                                 pathfinder.tryStep(points.starts[i],
+                                                    points.stepEnds[i]);
+                               }));
+  for (size_t i = 0; i < pathfinders.size(); ++i) {
+    pathfinders[i]->seed(seed + i);
+  }
+  results.push_back(runQueries(navmesh, "getRandomNavigablePoint",
+                               pathfinders, count,
+                               [&](nav::PathFinder& pathfinder, size_t) {
+                                 pathfinder.getRandomNavigablePoint();
+                               }));
+  results.push_back(runQueries(navmesh, "distanceToClosestObstacle",
+                               pathfinders, count,
+                               [&](nav::PathFinder& pathfinder, size_t i) {
+                                 pathfinder.distanceToClosestObstacle(
+                                     points.starts[i]);
+                               }));
+  results.push_back(runQueries(navmesh, "isNavigable", pathfinders, count,
+                               [&](nav::PathFinder& pathfinder, size_t i) {
+                                 pathfinder.isNavigable(points.probes[i]);
+                               }));
+  return results;
+}
+
+void printResults(const std::vector<BenchmarkResult>& results) {
+  std::printf("%-28s %-26s %7s %12s %10s %10s %10s\n", "navmesh", "query",
+              "threads", "calls/s", "p50 us", "p90 us", "p99 us");
+  for (const BenchmarkResult& result : results) {
+    std::printf("%-28s %-26s %7d %12.0f %10.1f %10.1f %10.1f\n",
+                Cr::Utility::Directory::filename(result.navmesh).c_str(),
+                result.query.c_str(), result.threads,
+                result.callsPerSecond(), 1e6 * percentile(result.times, 0.5),
+                1e6 * percentile(result.times, 0.9),
+                1e6 * percentile(result.times, 0.99));
+  }
+}
+
+bool writeJson(const std::string& file,
+               const std::vector<BenchmarkResult>& results) {
+  rapidjson::StringBuffer buffer;
+  rapidjson::PrettyWriter<rapidjson::StringBuffer> writer{buffer};
+  writer.StartObject();
+  writer.Key("results");
+  writer.StartArray();
+  for (const BenchmarkResult& result : results) {
+    writer.StartObject();
+    writer.Key("navmesh");
+    writer.String(result.navmesh.c_str());
+    writer.Key("query");
+    writer.String(result.query.c_str());
+    writer.Key("threads");
+    writer.Int(result.threads);
+    writer.Key("calls");
+    writer.Int(result.times.size());
+    writer.Key("calls_per_second");
+    writer.Double(result.callsPerSecond());
+    writer.Key("mean_us");
+    writer.Double(1e6 * mean(result.times));
+    writer.Key("p50_us");
+    writer.Double(1e6 * percentile(result.times, 0.5));
+    writer.Key("p90_us");
+    writer.Double(1e6 * percentile(result.times, 0.9));
+    writer.Key("p99_us");
+    writer.Double(1e6 * percentile(result.times, 0.99));
+    writer.EndObject();
+  }
+  writer.EndArray();
+  writer.EndObject();
+
+  std::ofstream out{file};
+  if (!(out << buffer.GetString() << std::endl)) {
+    LOG(ERROR) << "Cannot write benchmark results to " << file;
+    return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Cr::Utility::Arguments args;
+  args.addArgument("navmeshes")
+      .setHelp("navmeshes", "comma-separated navmesh files")
+      .addOption("queries", "10000")
+      .setHelp("queries", "calls of each query")
+      .addOption("threads", "1,0")
+      .setHelp("threads",
+               "comma-separated thread counts, each thread with its own "
+               "PathFinder, 0 for all cores")
+      .addOption("repeats", "10")
+      .setHelp("repeats", "times to build the islands of each navmesh")
+      .addBooleanOption("build")
+      .setHelp("build",
+               "build each navmesh from the .glb of its scene next to it too")
+      .addOption("build-repeats", "3")
+      .setHelp("build-repeats", "times to build each navmesh")
+      .addOption("seed", "0")
+      .addOption("json", "")
+      .setHelp("json", "file to write the results to as JSON")
+      .setGlobalHelp(
+          "Measures the latency and throughput of the PathFinder queries, "
+          "island and navmesh building on navmesh files")
+      .parse(argc, argv);
+
+  const size_t numQueries = args.value<size_t>("queries");
+  const int repeats = args.value<int>("repeats");
+  const int buildRepeats = args.value<int>("build-repeats");
+  const uint32_t seed = args.value<uint32_t>("seed");
+  std::vector<int> threadCounts;
+  for (const std::string& threads :
+       Cr::Utility::String::splitWithoutEmptyParts(args.value("threads"),
+                                                   ',')) {
+    const int numThreads = std::stoi(threads);
+    threadCounts.push_back(
+        numThreads > 0 ? numThreads
+                       : core::ThreadPool::global().getNumThreads());
+  }
+
+  std::vector<BenchmarkResult> results;
+  for (const std::string& navmesh :
+       Cr::Utility::String::splitWithoutEmptyParts(args.value("navmeshes"),
+                                                   ',')) {
+    LOG(INFO) << "Benchmarking " << navmesh;
+    nav::PathFinder::ptr pathfinder = nav::PathFinder::create();
+    if (!pathfinder->loadNavMesh(navmesh)) {
+      LOG(ERROR) << "Cannot load navmesh " << navmesh;
+      return 1;
+    }
+    const QueryPoints points =
+        sampleQueryPoints(*pathfinder, numQueries, seed);
+
+    for (int numThreads : threadCounts) {
+      std::vector<nav::PathFinder::ptr> pathfinders{pathfinder};
+      while (int(pathfinders.size()) < numThreads) {
+        pathfinders.push_back(nav::PathFinder::create());
+        if (!pathfinders.back()->loadNavMesh(navmesh)) {
+          LOG(ERROR) << "Cannot load navmesh " << navmesh;
+          return 1;
+        }
+      }
+      for (BenchmarkResult& result :
+           runQueryBenchmarks(navmesh, points, pathfinders, seed)) {
+        results.push_back(std::move(result));
+      }
+    }
+
+    results.push_back(runRepeated(navmesh, "IslandSystem", repeats, [&]() {
+      return pathfinder->rebuildIslands();
+    }));
+
+    if (args.isSet("build")) {
+      const std::string sceneFile =
+          Cr::Utility::Directory::splitExtension(navmesh).first + ".glb";
+      assets::SceneLoader loader;
+      const assets::MeshData mesh = loader.loadCollisionMesh(
+          assets::AssetInfo::fromPath(sceneFile));
+      nav::NavMeshSettings settings;
+      settings.setDefaults();
+      nav::PathFinder builder;
+      results.push_back(
+          runRepeated(navmesh, "PathFinder::build", buildRepeats,
+                      [&]() { return builder.build(settings, mesh); }));
+    }
+  }
+
+  printResults(results);
+  if (!args.value("json").empty() &&
+      !writeJson(args.value("json"), results)) {
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,340 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+// Scaling of the Bullet physics of a scene with the number of objects: for
+// each object count asked for, objects of the library of the physics config
+// are spawned above the navmesh one at a time, the world is stepped while
+// they fall and collide and again once they have settled and sleep, their
+// transforms are read and written one at a time and batched, and they are
+// removed one at a time. Prints a table and optionally writes the results as
+// JSON for regression tracking.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <Corrade/Utility/Arguments.h>
+#include <Corrade/Utility/String.h>
+#include <Magnum/EigenIntegration/Integration.h>
+#include <rapidjson/prettywriter.h>
+#include <rapidjson/stringbuffer.h>
+
+#include "esp/core/esp.h"
+#include "esp/gfx/Simulator.h"
+#include "esp/nav/PathFinder.h"
+#include "esp/physics/PhysicsManager.h"
+#include "esp/sim/SimulatorWithAgents.h"
+
+namespace Cr = Corrade;
+namespace Mn = Magnum;
+
+using namespace esp;
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+// heights objects are dropped from above the navmesh, in meters
+constexpr float minDropHeight = 0.5f;
+constexpr float maxDropHeight = 2.0f;
+
+double seconds(const Clock::time_point& start) {
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+double mean(const std::vector<double>& values) {
+  return values.empty() ? 0.0
+                        : std::accumulate(values.begin(), values.end(), 0.0) /
+                              values.size();
+}
+
+double percentile(std::vector<double> times, double p) {
+  if (times.empty()) {
+    return 0.0;
+  }
+  const size_t n = std::min(times.size() - 1, size_t(p * times.size()));
+  std::nth_element(times.begin(), times.begin() + n, times.end());
+  return times[n];
+}
+
+// Time steps steps of the world, along with the objects awake after each
+void measureSteps(gfx::Simulator& simulator,
+                  int steps,
+                  double dt,
+                  std::vector<double>& times,
+                  std::vector<double>& activeObjects) {
+  physics::PhysicsManager& physics = *simulator.getPhysicsManager();
+  for (int step = 0; step < steps; ++step) {
+    const Clock::time_point start = Clock::now();
+    simulator.stepWorld(dt);
+    times.push_back(seconds(start));
+    activeObjects.push_back(physics.checkActiveObjects());
+  }
+}
+
+// Seconds per object of calling f(i) for each object i, taking the best of
+// repeats runs
+double timePerObject(size_t numObjects,
+                     int repeats,
+                     const std::function<void(size_t)>& f) {
+  double best = 0.0;
+  for (int i = 0; i < repeats; ++i) {
+    const Clock::time_point start = Clock::now();
+    for (size_t j = 0; j < numObjects; ++j) {
+      f(j);
+    }
+    const double time = seconds(start);
+    if (i == 0 || time < best) {
+      best = time;
+    }
+  }
+  return numObjects > 0 ? best / numObjects : 0.0;
+}
+
+// Seconds per object of calling f() for all objects at once
+double timeBatched(size_t numObjects,
+                   int repeats,
+                   const std::function<void()>& f) {
+  return timePerObject(1, repeats, [&](size_t) { f(); }) /
+         std::max<size_t>(numObjects, 1);
+}
+
+struct BenchmarkResult {
+  int objects = 0;
+  // seconds of each addObject() and removeObject()
+  std::vector<double> addTimes;
+  std::vector<double> removeTimes;
+  // seconds of each step and objects awake after it, right after spawning
+  // and once settled
+  std::vector<double> activeStepTimes;
+  std::vector<double> activeObjects;
+  std::vector<double> sleepingStepTimes;
+  std::vector<double> sleepingObjects;
+  // steps it took for all objects to fall asleep, -1 if they did not
+  int settleSteps = -1;
+  // seconds per object of the transform accessors
+  double getTransformation = 0.0;
+  double setTransformation = 0.0;
+  double getTransformations = 0.0;
+  double setTransformations = 0.0;
+};
+
+BenchmarkResult runBenchmark(gfx::Simulator& simulator,
+                             int numObjects,
+                             int steps,
+                             int maxSettleSteps,
+                             int repeats,
+                             double dt,
+                             uint32_t seed) {
+  BenchmarkResult result;
+  result.objects = numObjects;
+  nav::PathFinder::ptr pathfinder = simulator.getPathFinder();
+  pathfinder->seed(seed);
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<float> dropHeight(minDropHeight,
+                                                   maxDropHeight);
+  std::uniform_real_distribution<float> offset(-1.0f, 1.0f);
+  const int librarySize = simulator.getPhysicsObjectLibrarySize();
+
+  std::vector<int> objectIDs;
+  for (int i = 0; i < numObjects; ++i) {
+    const Mn::Vector3 ground =
+        pathfinder->isLoaded()
+            ? Mn::Vector3(pathfinder->getRandomNavigablePoint())
+            : Mn::Vector3{offset(rng), 0.0f, offset(rng)};
+    const Clock::time_point start = Clock::now();
+    const int objectID = simulator.addObject(i % librarySize);
+    result.addTimes.push_back(seconds(start));
+    simulator.setTranslation(ground + Mn::Vector3::yAxis(dropHeight(rng)),
+                             objectID);
+    objectIDs.push_back(objectID);
+  }
+
+  measureSteps(simulator, steps, dt, result.activeStepTimes,
+               result.activeObjects);
+  physics::PhysicsManager& physics = *simulator.getPhysicsManager();
+  for (int step = 0; step < maxSettleSteps; ++step) {
+    if (physics.checkActiveObjects() == 0) {
+      result.settleSteps = steps + step;
+      break;
+    }
+    simulator.stepWorld(dt);
+  }
+  measureSteps(simulator, steps, dt, result.sleepingStepTimes,
+               result.sleepingObjects);
+
+  // writing the transforms they have wakes the objects up but moves none
+  std::vector<Mn::Matrix4> transforms(numObjects);
+  result.getTransformation =
+      timePerObject(numObjects, repeats, [&](size_t i) {
+        transforms[i] = simulator.getTransformation(objectIDs[i]);
+      });
+  result.setTransformation =
+      timePerObject(numObjects, repeats, [&](size_t i) {
+        simulator.setTransformation(transforms[i], objectIDs[i]);
+      });
+  result.getTransformations = timeBatched(numObjects, repeats, [&]() {
+    transforms = simulator.getTransformations(objectIDs);
+  });
+  result.setTransformations = timeBatched(numObjects, repeats, [&]() {
+    simulator.setTransformations(transforms, objectIDs);
+  });
+
+  for (const int objectID : objectIDs) {
+    const Clock::time_point start = Clock::now();
+    simulator.removeObject(objectID);
+    result.removeTimes.push_back(seconds(start));
+  }
+  return result;
+}
+
+void printResults(const std::vector<BenchmarkResult>& results) {
+  std::printf("%8s %10s %10s %12s %8s %12s %8s %8s %10s %10s %10s %10s\n",
+              "objects", "add us", "remove us", "active ms", "awake",
+              "sleeping ms", "awake", "settle", "get us", "set us",
+              "gets us", "sets us");
+  for (const BenchmarkResult& result : results) {
+    std::printf(
+        "%8d %10.1f %10.1f %12.3f %8.1f %12.3f %8.1f %8d %10.3f %10.3f "
+        "%10.3f %10.3f\n",
+        result.objects, 1e6 * mean(result.addTimes),
+        1e6 * mean(result.removeTimes), 1000.0 * mean(result.activeStepTimes),
+        mean(result.activeObjects), 1000.0 * mean(result.sleepingStepTimes),
+        mean(result.sleepingObjects), result.settleSteps,
+        1e6 * result.getTransformation, 1e6 * result.setTransformation,
+        1e6 * result.getTransformations, 1e6 * result.setTransformations);
+  }
+}
+
+template <typename Writer>
+void writeTimes(Writer& writer,
+                const char* name,
+                const std::vector<double>& times,
+                double scale) {
+  writer.Key(name);
+  writer.StartObject();
+  writer.Key("mean");
+  writer.Double(scale * mean(times));
+  writer.Key("median");
+  writer.Double(scale * percentile(times, 0.5));
+  writer.Key("p90");
+  writer.Double(scale * percentile(times, 0.9));
+  writer.Key("p99");
+  writer.Double(scale * percentile(times, 0.99));
+  writer.EndObject();
+}
+
+bool writeJson(const std::string& file,
+               const std::string& scene,
+               const std::vector<BenchmarkResult>& results) {
+  rapidjson::StringBuffer buffer;
+  rapidjson::PrettyWriter<rapidjson::StringBuffer> writer{buffer};
+  writer.StartObject();
+  writer.Key("scene");
+  writer.String(scene.c_str());
+  writer.Key("results");
+  writer.StartArray();
+  for (const BenchmarkResult& result : results) {
+    writer.StartObject();
+    writer.Key("objects");
+    writer.Int(result.objects);
+    writeTimes(writer, "add_object_us", result.addTimes, 1e6);
+    writeTimes(writer, "remove_object_us", result.removeTimes, 1e6);
+    writeTimes(writer, "active_step_ms", result.activeStepTimes, 1000.0);
+    writer.Key("active_step_awake_objects");
+    writer.Double(mean(result.activeObjects));
+    writeTimes(writer, "sleeping_step_ms", result.sleepingStepTimes, 1000.0);
+    writer.Key("sleeping_step_awake_objects");
+    writer.Double(mean(result.sleepingObjects));
+    writer.Key("settle_steps");
+    writer.Int(result.settleSteps);
+    writer.Key("get_transformation_us");
+    writer.Double(1e6 * result.getTransformation);
+    writer.Key("set_transformation_us");
+    writer.Double(1e6 * result.setTransformation);
+    writer.Key("get_transformations_us");
+    writer.Double(1e6 * result.getTransformations);
+    writer.Key("set_transformations_us");
+    writer.Double(1e6 * result.setTransformations);
+    writer.EndObject();
+  }
+  writer.EndArray();
+  writer.EndObject();
+
+  std::ofstream out{file};
+  if (!(out << buffer.GetString() << std::endl)) {
+    LOG(ERROR) << "Cannot write benchmark results to " << file;
+    return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Cr::Utility::Arguments args;
+  args.addArgument("scene")
+      .setHelp("scene", "scene file to load, with a navmesh to drop over")
+      .addOption("physics-config", "./data/default.phys_scene_config.json")
+      .setHelp("physics-config", "physics scene config file, its rigid "
+                                 "objects are the ones spawned")
+      .addOption("objects", "1,10,100,1000")
+      .setHelp("objects", "comma-separated object counts")
+      .addOption("steps", "200")
+      .setHelp("steps", "measured steps, active and sleeping, per count")
+      .addOption("settle-steps", "2000")
+      .setHelp("settle-steps", "steps to wait at most for objects to sleep")
+      .addOption("repeats", "5")
+      .setHelp("repeats", "runs of the transform accessors to take the best "
+                          "time of")
+      .addOption("timestep", "0.016666667")
+      .setHelp("timestep", "seconds of each step")
+      .addOption("gpu-device", "0")
+      .setHelp("gpu-device", "CUDA device to render on, -1 picks one")
+      .addOption("seed", "0")
+      .addOption("json", "")
+      .setHelp("json", "file to write the results to as JSON")
+      .setGlobalHelp(
+          "Measures adding, stepping, moving and removing physics objects "
+          "for growing object counts")
+      .parse(argc, argv);
+
+  gfx::SimulatorConfiguration cfg;
+  cfg.scene.id = args.value("scene");
+  cfg.gpuDeviceId = args.value<int>("gpu-device");
+  cfg.enablePhysics = true;
+  cfg.physicsConfigFile = args.value("physics-config");
+  cfg.createRenderer = false;
+  sim::SimulatorWithAgents simulator{cfg};
+  if (simulator.getPhysicsManager() == nullptr ||
+      simulator.getPhysicsObjectLibrarySize() == 0) {
+    LOG(ERROR) << "No physics objects to spawn from "
+               << cfg.physicsConfigFile;
+    return 1;
+  }
+
+  std::vector<BenchmarkResult> results;
+  for (const std::string& objects :
+       Cr::Utility::String::splitWithoutEmptyParts(args.value("objects"),
+                                                   ',')) {
+    LOG(INFO) << "Benchmarking " << objects << " objects";
+    results.push_back(runBenchmark(
+        simulator, std::stoi(objects), args.value<int>("steps"),
+        args.value<int>("settle-steps"), args.value<int>("repeats"),
+        args.value<double>("timestep"), args.value<uint32_t>("seed")));
+  }
+
+  printResults(results);
+  if (!args.value("json").empty() &&
+      !writeJson(args.value("json"), cfg.scene.id, results)) {
+    return 1;
+  }
+  return 0;
+}
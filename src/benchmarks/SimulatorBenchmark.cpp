@@ -0,0 +1,317 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+// End-to-end throughput of SimulatorWithAgents without Python in the loop:
+// for every sensor type and resolution asked for, an agent takes random
+// actions and observes, timing each stage of a step. Prints a table and
+// optionally writes the results as JSON for regression tracking.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include <Corrade/Utility/Arguments.h>
+#include <Corrade/Utility/String.h>
+#include <Magnum/GL/Renderer.h>
+#include <rapidjson/prettywriter.h>
+#include <rapidjson/stringbuffer.h>
+
+#include "esp/agent/Agent.h"
+#include "esp/core/Buffer.h"
+#include "esp/core/esp.h"
+#include "esp/core/random.h"
+#include "esp/gfx/Renderer.h"
+#include "esp/nav/PathFinder.h"
+#include "esp/sensor/Sensor.h"
+#include "esp/sim/SimulatorWithAgents.h"
+
+namespace Cr = Corrade;
+
+using namespace esp;
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+// the stages of a step, in the order they run
+const char* const stageNames[] = {"act", "draw", "readback", "physics",
+                                  "pathfinding"};
+enum Stage { Act, Draw, Readback, Physics, Pathfinding, StageCount };
+
+struct BenchmarkResult {
+  std::string sensor;
+  int resolution = 0;
+  int steps = 0;
+  // seconds per step, only of the stages that ran
+  std::vector<double> stageTimes[StageCount];
+
+  // steps per second over all stages
+  double fps() const {
+    double total = 0.0;
+    for (const std::vector<double>& times : stageTimes) {
+      total += std::accumulate(times.begin(), times.end(), 0.0);
+    }
+    return total > 0.0 ? steps / total : 0.0;
+  }
+};
+
+double mean(const std::vector<double>& times) {
+  return times.empty() ? 0.0
+                       : std::accumulate(times.begin(), times.end(), 0.0) /
+                             times.size();
+}
+
+double percentile(std::vector<double> times, double p) {
+  if (times.empty()) {
+    return 0.0;
+  }
+  const size_t n = std::min(times.size() - 1, size_t(p * times.size()));
+  std::nth_element(times.begin(), times.begin() + n, times.end());
+  return times[n];
+}
+
+bool parseSensorType(const std::string& name, sensor::SensorType& type) {
+  const std::map<std::string, sensor::SensorType> types = {
+      {"color", sensor::SensorType::COLOR},
+      {"depth", sensor::SensorType::DEPTH},
+      {"semantic", sensor::SensorType::SEMANTIC}};
+  auto it = types.find(name);
+  if (it == types.end()) {
+    LOG(ERROR) << "Unknown sensor type " << name
+               << ", expected color, depth or semantic";
+    return false;
+  }
+  type = it->second;
+  return true;
+}
+
+BenchmarkResult runBenchmark(const gfx::SimulatorConfiguration& simConfig,
+                             const std::string& sensorName,
+                             sensor::SensorType sensorType,
+                             int resolution,
+                             int warmupSteps,
+                             int steps,
+                             uint32_t seed) {
+  gfx::SimulatorConfiguration cfg = simConfig;
+  cfg.width = resolution;
+  cfg.height = resolution;
+  sim::SimulatorWithAgents simulator{cfg};
+
+  agent::AgentConfiguration agentConfig;
+  sensor::SensorSpec::ptr spec = agentConfig.sensorSpecifications[0];
+  spec->uuid = sensorName;
+  spec->sensorType = sensorType;
+  spec->resolution = {resolution, resolution};
+  spec->channels = sensorType == sensor::SensorType::COLOR ? 4 : 1;
+  agent::Agent::ptr agent = simulator.addAgent(agentConfig);
+  simulator.seed(seed);
+  simulator.reset();
+
+  sensor::Sensor::ptr visualSensor = agent->getSensorSuite().get(sensorName);
+  sensor::ObservationSpace space;
+  visualSensor->getObservationSpace(space);
+  core::Buffer::ptr buffer = core::Buffer::create(space.shape, space.dataType);
+  scene::SceneGraph& sceneGraph =
+      sensorType == sensor::SensorType::SEMANTIC
+          ? simulator.getActiveSemanticSceneGraph()
+          : simulator.getActiveSceneGraph();
+  std::shared_ptr<gfx::Renderer> renderer = simulator.getRenderer();
+  renderer->setSize(resolution, resolution);
+
+  nav::PathFinder::ptr pathfinder = simulator.getPathFinder();
+  const bool physics = simulator.getPhysicsManager() != nullptr;
+  const std::vector<std::string> actions = {"moveForward", "lookLeft",
+                                            "lookRight"};
+  core::Random random{seed};
+  agent::AgentState::ptr state = agent::AgentState::create();
+
+  BenchmarkResult result;
+  result.sensor = sensorName;
+  result.resolution = resolution;
+  result.steps = steps;
+  for (int step = 0; step < warmupSteps + steps; ++step) {
+    const bool measured = step >= warmupSteps;
+    Clock::time_point start = Clock::now();
+    auto lap = [&](Stage stage) {
+      const Clock::time_point end = Clock::now();
+      if (measured) {
+        result.stageTimes[stage].push_back(
+            std::chrono::duration<double>(end - start).count());
+      }
+      start = end;
+    };
+
+    agent->act(actions[random.uniform_int() % actions.size()]);
+    lap(Act);
+
+    // GL calls return before the GPU is done; finishing makes draw the
+    // time to the complete frame rather than to its submission
+    renderer->draw(*visualSensor, sceneGraph);
+    Magnum::GL::Renderer::finish();
+    lap(Draw);
+
+    if (sensorType == sensor::SensorType::SEMANTIC) {
+      renderer->readFrameObjectId(static_cast<uint32_t*>(buffer->data));
+    } else if (sensorType == sensor::SensorType::DEPTH) {
+      renderer->readFrameDepth(static_cast<float*>(buffer->data));
+    } else {
+      renderer->readFrameRgba(static_cast<uint8_t*>(buffer->data));
+    }
+    lap(Readback);
+
+    if (physics) {
+      simulator.stepWorld();
+      lap(Physics);
+    }
+
+    if (pathfinder->isLoaded()) {
+      agent->getState(state);
+      nav::ShortestPath path;
+      path.requestedStart = state->position;
+      path.requestedEnd = pathfinder->getRandomNavigablePoint();
+      pathfinder->findPath(path);
+      lap(Pathfinding);
+    }
+  }
+  return result;
+}
+
+void printResults(const std::vector<BenchmarkResult>& results) {
+  std::printf("%-10s %6s %10s", "sensor", "res", "fps");
+  for (const char* name : stageNames) {
+    std::printf(" %12s", (std::string{name} + " ms").c_str());
+  }
+  std::printf("\n");
+  for (const BenchmarkResult& result : results) {
+    std::printf("%-10s %6d %10.1f", result.sensor.c_str(), result.resolution,
+                result.fps());
+    for (const std::vector<double>& times : result.stageTimes) {
+      if (times.empty()) {
+        std::printf(" %12s", "-");
+      } else {
+        std::printf(" %12.3f", 1000.0 * mean(times));
+      }
+    }
+    std::printf("\n");
+  }
+}
+
+bool writeJson(const std::string& file,
+               const std::string& scene,
+               const std::vector<BenchmarkResult>& results) {
+  rapidjson::StringBuffer buffer;
+  rapidjson::PrettyWriter<rapidjson::StringBuffer> writer{buffer};
+  writer.StartObject();
+  writer.Key("scene");
+  writer.String(scene.c_str());
+  writer.Key("results");
+  writer.StartArray();
+  for (const BenchmarkResult& result : results) {
+    writer.StartObject();
+    writer.Key("sensor");
+    writer.String(result.sensor.c_str());
+    writer.Key("resolution");
+    writer.Int(result.resolution);
+    writer.Key("steps");
+    writer.Int(result.steps);
+    writer.Key("fps");
+    writer.Double(result.fps());
+    writer.Key("stages");
+    writer.StartObject();
+    for (int stage = 0; stage < StageCount; ++stage) {
+      const std::vector<double>& times = result.stageTimes[stage];
+      if (times.empty()) {
+        continue;
+      }
+      writer.Key(stageNames[stage]);
+      writer.StartObject();
+      writer.Key("mean_ms");
+      writer.Double(1000.0 * mean(times));
+      writer.Key("median_ms");
+      writer.Double(1000.0 * percentile(times, 0.5));
+      writer.Key("p90_ms");
+      writer.Double(1000.0 * percentile(times, 0.9));
+      writer.EndObject();
+    }
+    writer.EndObject();
+    writer.EndObject();
+  }
+  writer.EndArray();
+  writer.EndObject();
+
+  std::ofstream out{file};
+  if (!(out << buffer.GetString() << std::endl)) {
+    LOG(ERROR) << "Cannot write benchmark results to " << file;
+    return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Cr::Utility::Arguments args;
+  args.addArgument("scene")
+      .setHelp("scene", "scene file to load")
+      .addOption("sensors", "color,depth,semantic")
+      .setHelp("sensors", "comma-separated sensor types to benchmark")
+      .addOption("resolutions", "128,256,512")
+      .setHelp("resolutions", "comma-separated square sensor resolutions")
+      .addOption("steps", "1000")
+      .setHelp("steps", "measured steps per configuration")
+      .addOption("warmup", "50")
+      .setHelp("warmup", "steps to take before measuring")
+      .addOption("gpu-device", "0")
+      .setHelp("gpu-device", "CUDA device to render on, -1 picks one")
+      .addOption("seed", "0")
+      .addBooleanOption("enable-physics")
+      .addOption("physics-config", "./data/default.phys_scene_config.json")
+      .setHelp("physics-config", "physics scene config file")
+      .addOption("json", "")
+      .setHelp("json", "file to write the results to as JSON")
+      .setGlobalHelp(
+          "Measures simulator throughput per sensor type and resolution "
+          "and the time of each stage of a step")
+      .parse(argc, argv);
+
+  gfx::SimulatorConfiguration cfg;
+  cfg.scene.id = args.value("scene");
+  cfg.gpuDeviceId = args.value<int>("gpu-device");
+  cfg.enablePhysics = args.isSet("enable-physics");
+  cfg.physicsConfigFile = args.value("physics-config");
+  const int steps = args.value<int>("steps");
+  const int warmupSteps = args.value<int>("warmup");
+  const uint32_t seed = args.value<uint32_t>("seed");
+
+  std::vector<BenchmarkResult> results;
+  for (const std::string& sensorName :
+       Cr::Utility::String::splitWithoutEmptyParts(args.value("sensors"),
+                                                   ',')) {
+    sensor::SensorType sensorType;
+    if (!parseSensorType(sensorName, sensorType)) {
+      return 1;
+    }
+    for (const std::string& resolution :
+         Cr::Utility::String::splitWithoutEmptyParts(
+             args.value("resolutions"), ',')) {
+      LOG(INFO) << "Benchmarking " << sensorName << " at " << resolution;
+      results.push_back(runBenchmark(cfg, sensorName, sensorType,
+                                     std::stoi(resolution), warmupSteps,
+                                     steps, seed));
+    }
+  }
+
+  printResults(results);
+  if (!args.value("json").empty() &&
+      !writeJson(args.value("json"), cfg.scene.id, results)) {
+    return 1;
+  }
+  return 0;
+}
@@ -14,8 +14,6 @@ if(NOT USE_SYSTEM_MAGNUM)
 endif()
 find_package(Corrade REQUIRED Utility)
 
-# OpenMP
-find_package(OpenMP)
 # We don't find_package(OpenGL REQUIRED) here, but let Magnum do that instead
 # as it sets up various things related to GLVND.
 
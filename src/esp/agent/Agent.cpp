@@ -4,10 +4,16 @@
 
 #include "Agent.h"
 
+#include <algorithm>
+#include <cmath>
+
 #include <Magnum/EigenIntegration/GeometryIntegration.h>
 #include <Magnum/EigenIntegration/Integration.h>
 
+#include "esp/core/Profiling.h"
 #include "esp/scene/ObjectControls.h"
+#include "esp/sensor/NavigationSensor.h"
+#include "esp/sensor/PanoramicSensor.h"
 #include "esp/sensor/PinholeCamera.h"
 #include "esp/sensor/Sensor.h"
 
@@ -16,12 +22,28 @@ using Magnum::EigenIntegration::cast;
 namespace esp {
 namespace agent {
 
+namespace {
+// velocity changed towards target by at most maxChange, or set to it if
+// maxChange is not positive
+vec3f approach(const vec3f& velocity, const vec3f& target, float maxChange) {
+  const vec3f change = target - velocity;
+  const float norm = change.norm();
+  if (maxChange <= 0.0f || norm <= maxChange) {
+    return target;
+  }
+  return velocity + change * (maxChange / norm);
+}
+}  // namespace
+
 const std::set<std::string> Agent::BodyActions = {
     "moveRight", "moveLeft", "moveForward", "moveBackward", "turnLeft",
     "turnRight",
     // TODO lookLeft and lookRight should not be body actions
     // turnLeft and turnRight will take their place
-    "lookLeft", "lookRight"};
+    "lookLeft", "lookRight",
+    // see NoisyControls.h
+    "pyrobotNoisyMoveForward", "pyrobotNoisyMoveBackward",
+    "pyrobotNoisyTurnLeft", "pyrobotNoisyTurnRight"};
 
 Agent::Agent(scene::SceneNode& agentNode, const AgentConfiguration& cfg)
     : Magnum::SceneGraph::AbstractFeature3D(agentNode),
@@ -34,8 +56,36 @@ Agent::Agent(scene::SceneNode& agentNode, const AgentConfiguration& cfg)
     // sensor
 
     auto& sensorNode = agentNode.createChild();
-    sensors_.add(
-        sensor::PinholeCamera::create(sensorNode, spec));  // transformed within
+    if (sensor::NavigationSensor::isNavigation(*spec)) {
+      sensors_.add(sensor::NavigationSensor::create(sensorNode, spec));
+    } else if (sensor::PanoramicSensor::isPanoramic(*spec)) {
+      sensors_.add(sensor::PanoramicSensor::create(sensorNode, spec));
+    } else {
+      sensors_.add(sensor::PinholeCamera::create(
+          sensorNode, spec));  // transformed within
+    }
+  }
+  for (const auto& action : cfg.actionSpace) {
+    const ActionSpec& actionSpec = *action.second;
+    CompiledAction compiled;
+    compiled.move = scene::ObjectControls::getMovePointer(actionSpec.name);
+    compiled.noisyMove = scene::getNoisyMovePointer(actionSpec.name);
+    if (compiled.noisyMove != nullptr &&
+        !scene::NoisyActuationSpec::fromActuation(actionSpec.actuation,
+                                                  compiled.noisySpec)) {
+      LOG(WARNING) << "Action " << action.first
+                   << " has invalid noise parameters, it will do nothing";
+      compiled.noisyMove = nullptr;
+    } else if (compiled.move == nullptr && compiled.noisyMove == nullptr) {
+      LOG(WARNING) << "Action " << action.first << " has unknown move "
+                   << actionSpec.name << ", it will do nothing";
+    }
+    auto amount = actionSpec.actuation.find("amount");
+    compiled.amount =
+        amount != actionSpec.actuation.end() ? amount->second : 0.0f;
+    compiled.isBodyAction = BodyActions.count(actionSpec.name) > 0;
+    actions_.push_back(compiled);
+    actionNames_.push_back(action.first);
   }
 }
 
@@ -45,12 +95,25 @@ Agent::~Agent() {
 }
 
 bool Agent::act(const std::string& actionName) {
+  ESP_PROFILE_SCOPE("Agent::act");
   if (hasAction(actionName)) {
     const ActionSpec& actionSpec = *configuration_.actionSpace.at(actionName);
-    if (BodyActions.find(actionSpec.name) != BodyActions.end()) {
+    collided_ = false;
+    const scene::NoisyMovePointer noisyMove =
+        scene::getNoisyMovePointer(actionSpec.name);
+    scene::NoisyActuationSpec noisySpec;
+    if (noisyMove != nullptr) {
+      if (scene::NoisyActuationSpec::fromActuation(actionSpec.actuation,
+                                                   noisySpec)) {
+        controls_->action(object(), noisyMove, noisySpec,
+                          /*applyFilter=*/true);
+        collided_ = controls_->lastMoveCollided();
+      }
+    } else if (BodyActions.find(actionSpec.name) != BodyActions.end()) {
       controls_->action(object(), actionSpec.name,
                         actionSpec.actuation.at("amount"),
                         /*applyFilter=*/true);
+      collided_ = controls_->lastMoveCollided();
     } else {
       for (auto p : sensors_.getSensors()) {
         controls_->action(p.second->object(), actionSpec.name,
@@ -64,6 +127,77 @@ bool Agent::act(const std::string& actionName) {
   }
 }
 
+bool Agent::act(int actionId) {
+  ESP_PROFILE_SCOPE("Agent::act");
+  if (actionId < 0 || actionId >= actions_.size()) {
+    return false;
+  }
+  const CompiledAction& action = actions_[actionId];
+  collided_ = false;
+  if (action.noisyMove != nullptr) {
+    controls_->action(object(), action.noisyMove, action.noisySpec,
+                      /*applyFilter=*/true);
+    collided_ = controls_->lastMoveCollided();
+    return true;
+  }
+  if (action.move == nullptr) {
+    return true;
+  }
+  if (action.isBodyAction) {
+    controls_->action(object(), action.move, action.amount,
+                      /*applyFilter=*/true);
+    collided_ = controls_->lastMoveCollided();
+  } else {
+    for (auto& p : sensors_.getSensors()) {
+      controls_->action(p.second->object(), action.move, action.amount,
+                        /*applyFilter=*/false);
+    }
+  }
+  return true;
+}
+
+bool Agent::actVelocity(const vec3f& linearVelocity,
+                        const vec3f& angularVelocity,
+                        float dt,
+                        float substepTime /* = 1/60 */) {
+  ESP_PROFILE_SCOPE("Agent::actVelocity");
+  collided_ = false;
+  if (dt <= 0.0f) {
+    return false;
+  }
+  const int numSubsteps =
+      substepTime > 0.0f ? std::max(1, int(std::ceil(dt / substepTime))) : 1;
+  const float h = dt / numSubsteps;
+  for (int i = 0; i < numSubsteps; ++i) {
+    velocity_ = approach(velocity_, linearVelocity,
+                         configuration_.linearAcceleration * h);
+    angularVelocity_ = approach(angularVelocity_, angularVelocity,
+                                configuration_.angularAcceleration * h);
+    const Magnum::Vector3 start = node().translation();
+    const Magnum::Quaternion rotation = node().rotation();
+    controls_->velocityStep(node(), velocity_, angularVelocity_, h,
+                            /*applyFilter=*/true);
+    if (controls_->lastMoveCollided()) {
+      collided_ = true;
+      // keep what is left of the velocity after sliding along the obstacle
+      velocity_ = cast<vec3f>(rotation.inverted().transformVector(
+                      node().translation() - start)) /
+                  h;
+    }
+  }
+  return collided_;
+}
+
+int Agent::getActionId(const std::string& actionName) const {
+  // sorted, like the keys of the ActionSpace map
+  auto it =
+      std::lower_bound(actionNames_.begin(), actionNames_.end(), actionName);
+  if (it == actionNames_.end() || *it != actionName) {
+    return ID_UNDEFINED;
+  }
+  return it - actionNames_.begin();
+}
+
 bool Agent::hasAction(const std::string& actionName) {
   auto actionSpace = configuration_.actionSpace;
   return !(actionSpace.find(actionName) == actionSpace.end());
@@ -73,6 +207,9 @@ void Agent::getState(AgentState::ptr state) const {
   // TODO this should be done less hackishly
   state->position = cast<vec3f>(node().absoluteTransformation().translation());
   state->rotation = quatf(node().rotation()).coeffs();
+  state->velocity = velocity_;
+  state->angularVelocity = angularVelocity_;
+  state->collided = collided_;
   // TODO other state members when implemented
 }
 
@@ -85,6 +222,9 @@ void Agent::setState(const AgentState& state,
            2.0 * Magnum::Math::TypeTraits<float>::epsilon())
       << state.rotation << " not a valid rotation";
   node().setRotation(Magnum::Quaternion(quatf(rot)).normalized());
+  velocity_ = state.velocity;
+  angularVelocity_ = state.angularVelocity;
+  collided_ = false;
 
   if (resetSensors) {
     for (auto p : sensors_.getSensors()) {
@@ -94,6 +234,16 @@ void Agent::setState(const AgentState& state,
   // TODO other state members when implemented
 }
 
+void Agent::setPosition(const vec3f& position) {
+  node().setTranslation(Magnum::Vector3(position));
+  collided_ = false;
+}
+
+void Agent::resolveMove(const vec3f& position, bool collided) {
+  node().setTranslation(Magnum::Vector3(position));
+  collided_ = collided_ || collided;
+}
+
 bool operator==(const ActionSpec& a, const ActionSpec& b) {
   return a.name == b.name && a.actuation == b.actuation;
 }
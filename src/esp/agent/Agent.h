@@ -7,6 +7,7 @@
 #include <map>
 #include <set>
 #include <string>
+#include <vector>
 
 #include "esp/core/esp.h"
 #include "esp/scene/ObjectControls.h"
@@ -23,10 +24,13 @@ struct AgentState {
   // interop, replace with quatf when we have custom pybind11 type conversion
   // for quaternions
   vec4f rotation;
-  vec3f velocity;
-  vec3f angularVelocity;
-  vec3f force;
-  vec3f torque;
+  // of actVelocity(), along and about the axes of the agent
+  vec3f velocity = vec3f::Zero();
+  vec3f angularVelocity = vec3f::Zero();
+  vec3f force = vec3f::Zero();
+  vec3f torque = vec3f::Zero();
+  // whether the move filter cut the last body action short
+  bool collided = false;
   ESP_SMART_POINTERS(AgentState)
 };
 
@@ -101,12 +105,48 @@ class Agent : public Magnum::SceneGraph::AbstractFeature3D {
 
   bool act(const std::string& actionName);
 
+  //! Take the action of index actionId, see getActionId(). Skips the name
+  //! lookups of act(const std::string&); false if there is no such action
+  bool act(int actionId);
+
   bool hasAction(const std::string& actionName);
 
+  //! Drive the body for dt seconds with continuous velocity commands:
+  //! linearVelocity in m/s along the axes of the agent (-Z is forward) and
+  //! angularVelocity in rad/s about them. The motion is integrated in equal
+  //! substeps of at most substepTime seconds. In each, the velocities
+  //! approach the commands by at most linearAcceleration and
+  //! angularAcceleration of the configuration per second (at once if those
+  //! are not positive), and the body moves through the move filter of the
+  //! controls, so it slides along the navmesh where the simulator filters
+  //! with tryStep. A collision leaves the velocity it actually moved with.
+  //! The velocities persist across calls, see AgentState; returns whether
+  //! any substep collided
+  bool actVelocity(const vec3f& linearVelocity,
+                   const vec3f& angularVelocity,
+                   float dt,
+                   float substepTime = 1.0f / 60.0f);
+
+  //! Index of an action into the actions of the ActionSpace at construction
+  //! in name order, ID_UNDEFINED if there is no such action
+  int getActionId(const std::string& actionName) const;
+
+  //! Number of valid action indices
+  int getNumActions() const { return actions_.size(); }
+
   void getState(AgentState::ptr state) const;
 
   void setState(const AgentState& state, const bool resetSensors = true);
 
+  // Teleport to position keeping the rotation, and the sensors where they
+  // are relative to the agent, so they need no reset
+  void setPosition(const vec3f& position);
+
+  //! Put the body where the physics stopped its last move, see
+  //! SimulatorConfiguration::agentPhysicsBodies; collided adds to whether the
+  //! move filter cut the move short
+  void resolveMove(const vec3f& position, bool collided);
+
   scene::ObjectControls::ptr getControls() { return controls_; }
 
   const sensor::SensorSuite& getSensorSuite() const { return sensors_; }
@@ -125,6 +165,25 @@ class Agent : public Magnum::SceneGraph::AbstractFeature3D {
   AgentConfiguration configuration_;
   sensor::SensorSuite sensors_;
   scene::ObjectControls::ptr controls_;
+  // an action of the ActionSpace resolved at construction
+  struct CompiledAction {
+    // nullptr for actions ObjectControls does not know
+    scene::ObjectControls::MovePointer move;
+    float amount;
+    // for noisy moves instead of move, see NoisyControls.h
+    scene::NoisyMovePointer noisyMove;
+    scene::NoisyActuationSpec noisySpec;
+    // moves the body rather than the sensors, see BodyActions
+    bool isBodyAction;
+  };
+  // by action index, along with the names of the actions in the ActionSpace
+  std::vector<CompiledAction> actions_;
+  std::vector<std::string> actionNames_;
+  // whether the last action collided, see AgentState::collided
+  bool collided_ = false;
+  // of actVelocity(), see AgentState
+  vec3f velocity_ = vec3f::Zero();
+  vec3f angularVelocity_ = vec3f::Zero();
 
   ESP_SMART_POINTERS(Agent)
 };
@@ -259,6 +259,11 @@ PhysicsManagerAttributes::PhysicsManagerAttributes() {
   setString("simulator", "none");
   setDouble("timestep", 0.01);
   setInt("maxSubsteps", 10);
+  // worlds with more than one thread step with Bullet's multithreaded world
+  setInt("numThreads", 1);
+  // managers with several worlds step them on this many threads, 0 for one
+  // per hardware thread
+  setInt("numWorldThreads", 0);
 }
 }  // namespace assets
 }  // namespace esp
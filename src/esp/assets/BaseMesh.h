@@ -37,9 +37,18 @@ class BaseMesh {
 
   virtual void uploadBuffersToGPU(bool){};
 
+  //! Bytes of the GPU buffers and textures of the mesh, 0 before upload
+  size_t getGPUMemoryBytes() const { return gpuMemoryBytes_; }
+
   virtual Magnum::GL::Mesh* getMagnumGLMesh() { return nullptr; }
   virtual Magnum::GL::Mesh* getMagnumGLMesh(int) { return nullptr; }
 
+  //! The mesh on the CPU, kept after upload; nullptr for meshes that do not
+  //! keep one
+  const Magnum::Trade::MeshData3D* getMeshData() const {
+    return meshData_ ? &*meshData_ : nullptr;
+  }
+
   // Accessing non-render mesh data
   // Usage: (1) physics simulation
   virtual CollisionMeshData& getCollisionMeshData() {
@@ -53,6 +62,8 @@ class BaseMesh {
  protected:
   SupportedMeshType type_ = SupportedMeshType::NOT_DEFINED;
   bool buffersOnGPU_ = false;
+  //! counted by each upload as it allocates, see getGPUMemoryBytes()
+  size_t gpuMemoryBytes_ = 0;
 
   // ==== rendering ===
   Corrade::Containers::Optional<Magnum::Trade::MeshData3D> meshData_;
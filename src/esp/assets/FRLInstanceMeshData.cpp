@@ -14,6 +14,10 @@
 #include <Magnum/PixelFormat.h>
 #include <Magnum/Trade/Trade.h>
 
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
 #include <fcntl.h>
 #include <sys/mman.h>
 #include <tinyply.h>
@@ -26,6 +30,7 @@
 
 #include "esp/core/esp.h"
 #include "esp/geo/geo.h"
+#include "esp/io/cache.h"
 #include "esp/io/io.h"
 #include "esp/io/json.h"
 
@@ -33,128 +38,111 @@ namespace esp {
 namespace assets {
 
 bool FRLInstanceMeshData::loadPLY(const std::string& ply_file) {
-  std::ifstream ifs(ply_file, std::ios::in);
-  if (!ifs.good()) {
+  const io::MappedFile file(ply_file);
+  if (!file.isValid()) {
     return false;
   }
 
   /* Read the header and make sure it is what we expect */
-  std::string line, token;
-  std::istringstream iss;
-  std::getline(ifs, line);
-  if (line != "ply") {
+  const std::string endHeader = "end_header\n";
+  const char* const fileEnd = file.data() + file.size();
+  const char* data =
+      std::search(file.data(), fileEnd, endHeader.begin(), endHeader.end());
+  if (data == fileEnd) {
     return false;
   }
-
-  std::getline(ifs, line);
-  if (line != "comment etw-instance-mesh-format v1") {
+  const std::string header(file.data(), data);
+  data += endHeader.size();
+  if (header.compare(0, 40, "ply\ncomment etw-instance-mesh-format v1\n") !=
+      0) {
     return false;
   }
-
-  // Trash format line, element mappings, and the two mappings lines
-  for (int i = 0; i < 4; ++i) {
-    std::getline(ifs, line);
-  }
-
-  std::getline(ifs, line);
-  iss.str(line);
-  iss >> token;
-  if (token != "element") {
+  const size_t vertexElement = header.find("\nelement vertex ");
+  if (vertexElement == std::string::npos) {
     return false;
   }
-  int nVertex;
-  iss >> token >> nVertex;
-
-  // For now, just trash the header because I am lazy and I know what it is
-  while (true) {
-    std::getline(ifs, line);
-    if (line == "end_header") {
-      break;
+  const int nVertex = std::atoi(header.c_str() + vertexElement + 16);
+
+  // reads size bytes from the records, false past the end of the file
+  auto read = [&](void* destination, size_t size) {
+    if (size_t(fileEnd - data) < size) {
+      return false;
     }
+    std::memcpy(destination, data, size);
+    data += size;
+    return true;
+  };
+  int num_instances = 0;
+  if (!read(&num_instances, sizeof(num_instances)) || num_instances < 0) {
+    return false;
   }
-
-  int num_instances;
-  ifs.read(reinterpret_cast<char*>(&num_instances), sizeof(num_instances));
   id_to_node.resize(num_instances);
-  ifs.read(reinterpret_cast<char*>(id_to_node.data()),
-           num_instances * sizeof(int));
-
-  ifs.read(reinterpret_cast<char*>(&num_instances), sizeof(num_instances));
+  if (!read(id_to_node.data(), num_instances * sizeof(int)) ||
+      !read(&num_instances, sizeof(num_instances)) || num_instances < 0) {
+    return false;
+  }
   id_to_label.resize(num_instances);
-  ifs.read(reinterpret_cast<char*>(id_to_label.data()),
-           num_instances * sizeof(int));
-
-  cpu_cbo_.clear();
-  cpu_cbo_.reserve(nVertex);
-  cpu_vbo_.clear();
-  cpu_vbo_.reserve(nVertex);
-
-  for (int i = 0; i < nVertex; ++i) {
-    vec3f xyz;
-    vec3uc rgb;
-
-    ifs.read(reinterpret_cast<char*>(xyz.data()), 3 * sizeof(float));
-    ifs.read(reinterpret_cast<char*>(rgb.data()), 3 * sizeof(uint8_t));
-
-    int instance_id;
-    ifs.read(reinterpret_cast<char*>(&instance_id), sizeof(instance_id));
-
-    cpu_cbo_.emplace_back(rgb);
-
-    vec4f xyzid;
-    xyzid.head<3>() = xyz;
-    xyzid[3] = static_cast<float>(instance_id);
-
-    cpu_vbo_.emplace_back(xyzid);
+  if (!read(id_to_label.data(), num_instances * sizeof(int))) {
+    return false;
   }
 
-  int grav_size;
-  ifs.read(reinterpret_cast<char*>(&grav_size), sizeof(grav_size));
-  ifs.read(reinterpret_cast<char*>(gravity_dir.data()),
-           sizeof(float) * grav_size);
-
+  // the gravity needed to align the vertices follows them
+  constexpr size_t vertexSize = 3 * sizeof(float) + 3 + sizeof(int);
+  const char* vertices = data;
+  if (nVertex < 0 || size_t(fileEnd - data) < nVertex * vertexSize) {
+    return false;
+  }
+  data += nVertex * vertexSize;
+  int grav_size = 0;
+  if (!read(&grav_size, sizeof(grav_size)) || grav_size != 3 ||
+      !read(gravity_dir.data(), sizeof(float) * grav_size)) {
+    return false;
+  }
   this->orig_gravity_dir = this->gravity_dir;
-
   const Sophus::SO3f T_esp_scene(
       quatf::FromTwoVectors(this->gravity_dir, geo::ESP_GRAVITY));
-
   this->gravity_dir = esp::geo::ESP_GRAVITY;
-  for (auto& xyzid : this->cpu_vbo_) {
-    const vec3f xyz_scene = xyzid.head<3>();
-    const vec3f xyz_esp = T_esp_scene * xyz_scene;
-
-    xyzid.head<3>() = xyz_esp;
-  }
-
-  // Store vertex buffer without instance id
-  cpu_vbo_3_ = new std::vector<vec3f>(cpu_vbo_.size());
-  for (int i = 0; i < cpu_vbo_.size(); ++i) {
-    (*cpu_vbo_3_)[i] = cpu_vbo_[i].head<3>();
-  }
 
-  // create ibo converting quads to tris [0, 1, 2, 3] -> [0, 1, 2],[0,2,3]
-  const size_t numQuads = cpu_vbo_.size() / 4;
-  tri_ibo_ = new std::vector<uint32_t>(numQuads * 6);
-  for (uint32_t iQuad = 0; iQuad < numQuads; ++iQuad) {
-    const uint32_t triIdx = 6 * iQuad;
-    const uint32_t quadIdx = 4 * iQuad;
-    (*tri_ibo_)[triIdx + 0] = quadIdx + 0;
-    (*tri_ibo_)[triIdx + 1] = quadIdx + 1;
-    (*tri_ibo_)[triIdx + 2] = quadIdx + 2;
-    (*tri_ibo_)[triIdx + 3] = quadIdx + 0;
-    (*tri_ibo_)[triIdx + 4] = quadIdx + 2;
-    (*tri_ibo_)[triIdx + 5] = quadIdx + 3;
+  // one pass over the vertices fills all the buffers, with the quads
+  // [0, 1, 2, 3] split into the triangles [0, 1, 2], [0, 2, 3]
+  cpu_vbo_.resize(nVertex);
+  cpu_cbo_.resize(nVertex);
+  cpu_vbo_3_.resize(nVertex);
+  const size_t numQuads = nVertex / 4;
+  tri_ibo_.resize(numQuads * 6);
+  for (int i = 0; i < nVertex; ++i, vertices += vertexSize) {
+    vec3f xyz;
+    int instance_id;
+    std::memcpy(xyz.data(), vertices, 3 * sizeof(float));
+    std::memcpy(cpu_cbo_[i].data(), vertices + 3 * sizeof(float), 3);
+    std::memcpy(&instance_id, vertices + 3 * sizeof(float) + 3,
+                sizeof(instance_id));
+
+    cpu_vbo_3_[i] = T_esp_scene * xyz;
+    cpu_vbo_[i].head<3>() = cpu_vbo_3_[i];
+    cpu_vbo_[i][3] = static_cast<float>(instance_id);
+
+    if (i % 4 == 3 && i / 4 < numQuads) {
+      const uint32_t quadIdx = i - 3;
+      uint32_t* tri = &tri_ibo_[6 * (i / 4)];
+      tri[0] = quadIdx + 0;
+      tri[1] = quadIdx + 1;
+      tri[2] = quadIdx + 2;
+      tri[3] = quadIdx + 0;
+      tri[4] = quadIdx + 2;
+      tri[5] = quadIdx + 3;
+    }
   }
 
   // Construct collision meshData
   collisionMeshData_.primitive = Magnum::MeshPrimitive::Triangles;
   collisionMeshData_.positions =
       Corrade::Containers::arrayCast<Magnum::Vector3>(
-          Corrade::Containers::arrayView(cpu_vbo_3_->data(),
-                                         cpu_vbo_3_->size()));
+          Corrade::Containers::arrayView(cpu_vbo_3_.data(),
+                                         cpu_vbo_3_.size()));
   collisionMeshData_.indices =
       Corrade::Containers::arrayCast<Magnum::UnsignedInt>(
-          Corrade::Containers::arrayView(tri_ibo_->data(), tri_ibo_->size()));
+          Corrade::Containers::arrayView(tri_ibo_.data(), tri_ibo_.size()));
 
   return true;
 }
@@ -216,13 +204,6 @@ void FRLInstanceMeshData::to_ply(const std::string& ply_file) const {
           sizeof(float) * grav_size);
 }
 
-Magnum::GL::Mesh* FRLInstanceMeshData::getMagnumGLMesh() {
-  if (renderingBuffer_ == nullptr) {
-    return nullptr;
-  }
-  return &(renderingBuffer_->mesh);
-}
-
 void FRLInstanceMeshData::uploadBuffersToGPU(bool forceReload) {
   if (forceReload) {
     buffersOnGPU_ = false;
@@ -234,41 +215,45 @@ void FRLInstanceMeshData::uploadBuffersToGPU(bool forceReload) {
   renderingBuffer_.reset();
   renderingBuffer_ = std::make_unique<FRLInstanceMeshData::RenderingBuffer>();
 
-  const size_t numQuads = cpu_vbo_.size() / 4;
-
-  cbo_float_ = new std::vector<float>(cpu_cbo_.size() * 3);
-  for (int iVert = 0; iVert < cpu_cbo_.size(); ++iVert) {
-    const uint32_t idx = 3 * iVert;
-    (*cbo_float_)[idx + 0] = cpu_cbo_[iVert][0] / 255.0f;
-    (*cbo_float_)[idx + 1] = cpu_cbo_[iVert][1] / 255.0f;
-    (*cbo_float_)[idx + 2] = cpu_cbo_[iVert][2] / 255.0f;
+  // the vertices of each quad are its own, so its object id can be flat per
+  // vertex instead of looked up by primitive id in a texture; -1 wraps and is
+  // read back as -1 by the shader
+  std::vector<uint32_t> objectIds(cpu_vbo_.size());
+  for (size_t i = 0; i < cpu_vbo_.size(); ++i) {
+    objectIds[i] =
+        static_cast<uint32_t>(static_cast<int32_t>(cpu_vbo_[i][3]));
   }
 
-  // See code for GenericInstanceMeshData::uploadBuffersToGPU for comments about
-  // what's going on with this image/texture
-  const size_t numTris = numQuads * 2;
-  const int texSize = std::pow(2, std::ceil(std::log2(std::sqrt(numTris))));
-  obj_id_tex_data_ = new float[texSize * texSize]();
-
-  for (size_t i = 0; i < numQuads; ++i) {
-    obj_id_tex_data_[2 * i] = cpu_vbo_[4 * i][3];
-    obj_id_tex_data_[2 * i + 1] = cpu_vbo_[4 * i][3];
-  }
-
-  renderingBuffer_->tex = createInstanceTexture(obj_id_tex_data_, texSize);
-  renderingBuffer_->vbo.setData(*cpu_vbo_3_,
-                                Magnum::GL::BufferUsage::StaticDraw);
-  renderingBuffer_->cbo.setData(*cbo_float_,
+  // the other buffers are uploaded straight from the loaded arrays, the colors
+  // as normalized bytes
+  renderingBuffer_->vbo.setData(cpu_vbo_3_,
                                 Magnum::GL::BufferUsage::StaticDraw);
-  renderingBuffer_->ibo.setData(*tri_ibo_, Magnum::GL::BufferUsage::StaticDraw);
-  renderingBuffer_->mesh.setPrimitive(Magnum::GL::MeshPrimitive::Triangles)
-      .setCount(tri_ibo_->size())  // Set vertex/index count (numQuads * 6)
+  renderingBuffer_->cbo.setData(cpu_cbo_, Magnum::GL::BufferUsage::StaticDraw);
+  renderingBuffer_->idbo.setData(objectIds,
+                                 Magnum::GL::BufferUsage::StaticDraw);
+  renderingBuffer_->ibo.setData(tri_ibo_, Magnum::GL::BufferUsage::StaticDraw);
+  gpuMemoryBytes_ = cpu_vbo_3_.size() * sizeof(cpu_vbo_3_[0]) +
+                    cpu_cbo_.size() * sizeof(cpu_cbo_[0]) +
+                    objectIds.size() * sizeof(uint32_t) +
+                    tri_ibo_.size() * sizeof(tri_ibo_[0]);
+  typedef Magnum::GL::Attribute<1, Magnum::Color3> Color;
+  Magnum::GL::Mesh mesh;
+  mesh.setPrimitive(Magnum::GL::MeshPrimitive::Triangles)
+      .setCount(tri_ibo_.size())  // Set vertex/index count (numQuads * 6)
       .addVertexBuffer(renderingBuffer_->vbo, 0,
                        Magnum::GL::Attribute<0, Magnum::Vector3>{})
-      .addVertexBuffer(renderingBuffer_->cbo, 0,
-                       Magnum::GL::Attribute<1, Magnum::Color3>{})
+      .addVertexBuffer(
+          renderingBuffer_->cbo, 0,
+          Color{Color::DataType::UnsignedByte, Color::DataOption::Normalized})
+      .addVertexBuffer(renderingBuffer_->idbo, 0,
+                       Magnum::GL::Attribute<2, Magnum::UnsignedInt>{})
       .setIndexBuffer(renderingBuffer_->ibo, 0,
                       Magnum::GL::MeshIndexType::UnsignedInt);
+  // drawn as a single chunk
+  renderingBuffer_->chunks.push_back(std::move(mesh));
+  chunkBoundingBoxes_.assign(
+      1, Magnum::Range3D{Magnum::Math::minmax<Magnum::Vector3>(
+             collisionMeshData_.positions)});
 
   buffersOnGPU_ = true;
 }
@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include <Corrade/Containers/ArrayView.h>
 #include <Magnum/Trade/MeshData3D.h>
 #include <memory>
 #include <string>
@@ -25,12 +26,7 @@ class FRLInstanceMeshData : public GenericInstanceMeshData {
  public:
   FRLInstanceMeshData()
       : GenericInstanceMeshData(SupportedMeshType::INSTANCE_MESH){};
-  virtual ~FRLInstanceMeshData() {
-    delete cpu_vbo_3_;
-    delete tri_ibo_;
-    delete cbo_float_;
-    delete obj_id_tex_data_;
-  };
+  virtual ~FRLInstanceMeshData(){};
 
   void to_ply(const std::string& ply_file) const;
   virtual bool loadPLY(const std::string& plyFile) override;
@@ -51,19 +47,21 @@ class FRLInstanceMeshData : public GenericInstanceMeshData {
   virtual void uploadBuffersToGPU(bool forceReload = false) override;
   RenderingBuffer* getRenderingBuffer() { return renderingBuffer_.get(); }
 
-  virtual Magnum::GL::Mesh* getMagnumGLMesh() override;
-
-  const std::vector<vec3f> get_vbo();
-  const std::vector<int> get_ibo();
+  //! Positions without the instance ids, and the triangles of the quads,
+  //! as uploaded to the GPU
+  Corrade::Containers::ArrayView<const vec3f> get_vbo() const {
+    return {cpu_vbo_3_.data(), cpu_vbo_3_.size()};
+  }
+  Corrade::Containers::ArrayView<const uint32_t> get_ibo() const {
+    return {tri_ibo_.data(), tri_ibo_.size()};
+  }
 
  protected:
   std::vector<vec4f> cpu_vbo_;
   std::vector<vec3uc> cpu_cbo_;
 
-  std::vector<vec3f>* cpu_vbo_3_ = nullptr;
-  std::vector<uint32_t>* tri_ibo_ = nullptr;
-  std::vector<float>* cbo_float_ = nullptr;
-  float* obj_id_tex_data_ = nullptr;
+  std::vector<vec3f> cpu_vbo_3_;
+  std::vector<uint32_t> tri_ibo_;
 
   vecXi id_to_label;
   vecXi id_to_node;
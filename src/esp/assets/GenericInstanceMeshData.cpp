@@ -15,6 +15,8 @@
 #include <Magnum/PixelFormat.h>
 #include <Magnum/Trade/Trade.h>
 
+#include <algorithm>
+
 #include <fcntl.h>
 #include <sys/mman.h>
 #include <tinyply.h>
@@ -26,14 +28,21 @@
 #include <vector>
 
 #include "esp/core/esp.h"
+#include "esp/geo/MeshOptimization.h"
 #include "esp/geo/geo.h"
+#include "esp/io/cache.h"
 #include "esp/io/io.h"
 #include "esp/io/json.h"
 
+#include "LoadTrace.h"
+
 namespace esp {
 namespace assets {
 
 namespace {
+// bump whenever the layout of the cached buffers changes
+const uint32_t cacheVersion = 1;
+
 template <typename T>
 void copyTo(std::shared_ptr<tinyply::PlyData> data, std::vector<T>& dst) {
   dst.resize(data->count);
@@ -71,6 +80,55 @@ Magnum::GL::Texture2D createInstanceTexture(float* data, const int texSize) {
   return tex;
 }
 
+void buildInstanceMeshChunks(const std::vector<vec3f>& positions,
+                             const std::vector<vec3uc>& colors,
+                             const std::vector<vec3ui>& triangles,
+                             const std::vector<uint32_t>& objectIds,
+                             std::vector<InstanceMeshVertex>& vertices,
+                             std::vector<uint16_t>& indices,
+                             std::vector<InstanceMeshChunk>& chunks) {
+  constexpr size_t maxChunkVertices = 1 << 16;
+  vertices.clear();
+  indices.clear();
+  chunks.clear();
+  vertices.reserve(positions.size());
+  indices.reserve(3 * triangles.size());
+
+  // maps: (vertex, object id) -> index in the current chunk
+  std::unordered_map<uint64_t, uint16_t> chunkVertices;
+  for (size_t t = 0; t < triangles.size(); ++t) {
+    const uint32_t objectId = objectIds[t];
+    uint64_t keys[3];
+    int numNewVertices = 0;
+    for (int k = 0; k < 3; ++k) {
+      keys[k] = (uint64_t(triangles[t][k]) << 32) | objectId;
+      numNewVertices += chunkVertices.count(keys[k]) == 0;
+    }
+    if (chunks.empty() ||
+        chunkVertices.size() + numNewVertices > maxChunkVertices) {
+      chunks.push_back({vertices.size(), indices.size(), 0});
+      chunkVertices.clear();
+    }
+    InstanceMeshChunk& chunk = chunks.back();
+    for (int k = 0; k < 3; ++k) {
+      auto inserted = chunkVertices.emplace(
+          keys[k], uint16_t(vertices.size() - chunk.firstVertex));
+      if (inserted.second) {
+        const uint32_t v = triangles[t][k];
+        InstanceMeshVertex vertex;
+        std::copy(positions[v].data(), positions[v].data() + 3,
+                  vertex.position);
+        std::copy(colors[v].data(), colors[v].data() + 3, vertex.color);
+        vertex.padding = 0;
+        vertex.objectId = objectId;
+        vertices.push_back(vertex);
+      }
+      indices.push_back(inserted.first->second);
+    }
+    chunk.numIndices += 3;
+  }
+}
+
 bool GenericInstanceMeshData::loadPLY(const std::string& plyFile) {
   cpu_vbo_.clear();
   cpu_cbo_.clear();
@@ -127,6 +185,8 @@ bool GenericInstanceMeshData::loadPLY(const std::string& plyFile) {
   }
 
   file.read(ifs);
+  // the rest converts what tinyply read
+  LoadStageTimer stageTimer(LoadStage::Process);
 
   CHECK(vertices->t == tinyply::Type::FLOAT32) << "x,y,z must be floats";
   // copyTo is a helper function to get stuff out of tinyply's format into our
@@ -201,6 +261,52 @@ bool GenericInstanceMeshData::loadPLY(const std::string& plyFile) {
     xyz = T_esp_scene * xyz;
   }
 
+  updateCollisionMeshData();
+
+  return true;
+}
+
+bool GenericInstanceMeshData::saveCache(const std::string& plyFile,
+                                        const std::string& cacheFile) const {
+  // buffers are stored as they are after loadPLY(): triangulated, with
+  // positions already rotated into the habitat frame
+  io::CacheWriter writer(SupportedMeshType::INSTANCE_MESH, cacheVersion,
+                         plyFile);
+  writer.addSection(cpu_vbo_);
+  writer.addSection(cpu_cbo_);
+  writer.addSection(cpu_ibo_);
+  writer.addSection(objectIds_);
+  if (!writer.write(cacheFile)) {
+    LOG(ERROR) << "Cannot write cache file " << cacheFile;
+    return false;
+  }
+  return true;
+}
+
+bool GenericInstanceMeshData::loadCache(const std::string& plyFile,
+                                        const std::string& cacheFile) {
+  const io::CacheReader reader(cacheFile, SupportedMeshType::INSTANCE_MESH,
+                               cacheVersion, plyFile);
+  if (!reader.isValid() || reader.getNumSections() != 4) {
+    return false;
+  }
+  if (!reader.readSection(0, cpu_vbo_) || !reader.readSection(1, cpu_cbo_) ||
+      !reader.readSection(2, cpu_ibo_) || !reader.readSection(3, objectIds_) ||
+      cpu_cbo_.size() != cpu_vbo_.size() ||
+      objectIds_.size() != cpu_ibo_.size()) {
+    LOG(ERROR) << "Corrupt cache file " << cacheFile;
+    cpu_vbo_.clear();
+    cpu_cbo_.clear();
+    cpu_ibo_.clear();
+    objectIds_.clear();
+    return false;
+  }
+
+  updateCollisionMeshData();
+  return true;
+}
+
+void GenericInstanceMeshData::updateCollisionMeshData() {
   // Construct vertices for collsion meshData
   // Store indices, facd_ids in Magnum MeshData3D format such that
   // later they can be accessed.
@@ -212,8 +318,31 @@ bool GenericInstanceMeshData::loadPLY(const std::string& plyFile) {
   collisionMeshData_.indices =
       Corrade::Containers::arrayCast<Magnum::UnsignedInt>(
           Corrade::Containers::arrayView(cpu_ibo_.data(), cpu_ibo_.size()));
+}
 
-  return true;
+void GenericInstanceMeshData::optimizeTriangleOrder() {
+  std::vector<uint32_t> indices;
+  indices.reserve(cpu_ibo_.size() * 3);
+  for (const vec3ui& triangle : cpu_ibo_) {
+    indices.insert(indices.end(), triangle.data(), triangle.data() + 3);
+  }
+  std::vector<uint32_t> triangleOrder =
+      geo::vertexCacheTriangleOrder(indices, cpu_vbo_.size());
+  triangleOrder = geo::overdrawTriangleOrder(indices, cpu_vbo_, triangleOrder);
+
+  // the object ids are per triangle, so they follow their triangles
+  std::vector<vec3ui> triangles;
+  std::vector<uint32_t> objectIds;
+  triangles.reserve(cpu_ibo_.size());
+  objectIds.reserve(objectIds_.size());
+  for (uint32_t t : triangleOrder) {
+    triangles.push_back(cpu_ibo_[t]);
+    objectIds.push_back(objectIds_[t]);
+  }
+  cpu_ibo_ = std::move(triangles);
+  objectIds_ = std::move(objectIds);
+  updateCollisionMeshData();
+  buffersOnGPU_ = false;
 }
 
 void GenericInstanceMeshData::uploadBuffersToGPU(bool forceReload) {
@@ -228,52 +357,61 @@ void GenericInstanceMeshData::uploadBuffersToGPU(bool forceReload) {
   renderingBuffer_ =
       std::make_unique<GenericInstanceMeshData::RenderingBuffer>();
 
-  // convert uchar rgb to float rgb
-  std::vector<vec3f> cbo_float_;
-  cbo_float_.reserve(cpu_cbo_.size());
-  for (const auto& c : cpu_cbo_) {
-    cbo_float_.emplace_back(c.cast<float>() / 255.0f);
-  }
-
-  /*
-   * Textures in OpenGL must be square and must have a sizes that are powers of
-   * 2, so first compute the size of the smallest texture that can contain our
-   * array.  Then copy the object id's buffer into the texture data buffer as
-   * floats.
-   */
-  const int nPrims = cpu_ibo_.size();
-  const int texSize = std::pow(2, std::ceil(std::log2(std::sqrt(nPrims))));
-  // The image takes ownership over the obj_id_tex_data array, so there is no
-  // delete
-  float* obj_id_tex_data = new float[texSize * texSize]();
-  for (size_t i = 0; i < nPrims; ++i) {
-    obj_id_tex_data[i] = static_cast<float>(objectIds_[i]);
+  std::vector<InstanceMeshVertex> vertices;
+  std::vector<uint16_t> indices;
+  std::vector<InstanceMeshChunk> chunks;
+  buildInstanceMeshChunks(cpu_vbo_, cpu_cbo_, cpu_ibo_, objectIds_, vertices,
+                          indices, chunks);
+
+  renderingBuffer_->vbo.setData(vertices, Magnum::GL::BufferUsage::StaticDraw);
+  renderingBuffer_->ibo.setData(indices, Magnum::GL::BufferUsage::StaticDraw);
+  gpuMemoryBytes_ = vertices.size() * sizeof(InstanceMeshVertex) +
+                    indices.size() * sizeof(uint16_t);
+  typedef Magnum::GL::Attribute<1, Magnum::Color3> Color;
+  chunkBoundingBoxes_.clear();
+  for (size_t i = 0; i < chunks.size(); ++i) {
+    const InstanceMeshChunk& chunk = chunks[i];
+    Magnum::GL::Mesh mesh;
+    mesh.setPrimitive(Magnum::GL::MeshPrimitive::Triangles)
+        .setCount(chunk.numIndices)
+        .addVertexBuffer(
+            renderingBuffer_->vbo,
+            chunk.firstVertex * sizeof(InstanceMeshVertex),
+            Magnum::GL::Attribute<0, Magnum::Vector3>{},
+            Color{Color::DataType::UnsignedByte, Color::DataOption::Normalized},
+            sizeof(uint8_t), Magnum::GL::Attribute<2, Magnum::UnsignedInt>{})
+        .setIndexBuffer(renderingBuffer_->ibo,
+                        chunk.firstIndex * sizeof(uint16_t),
+                        Magnum::GL::MeshIndexType::UnsignedShort);
+    renderingBuffer_->chunks.push_back(std::move(mesh));
+
+    // for culling the chunks one by one
+    const size_t endVertex =
+        i + 1 < chunks.size() ? chunks[i + 1].firstVertex : vertices.size();
+    const Magnum::Vector3& first =
+        Magnum::Vector3::from(vertices[chunk.firstVertex].position);
+    Magnum::Range3D box{first, first};
+    for (size_t v = chunk.firstVertex + 1; v < endVertex; ++v) {
+      const Magnum::Vector3& position =
+          Magnum::Vector3::from(vertices[v].position);
+      box = Magnum::Math::join(box, Magnum::Range3D{position, position});
+    }
+    chunkBoundingBoxes_.push_back(box);
   }
 
-  // Takes ownership of the data pointer
-  renderingBuffer_->tex = createInstanceTexture(obj_id_tex_data, texSize);
-
-  renderingBuffer_->vbo.setData(cpu_vbo_, Magnum::GL::BufferUsage::StaticDraw);
-  renderingBuffer_->cbo.setData(cbo_float_,
-                                Magnum::GL::BufferUsage::StaticDraw);
-  renderingBuffer_->ibo.setData(cpu_ibo_, Magnum::GL::BufferUsage::StaticDraw);
-  renderingBuffer_->mesh.setPrimitive(Magnum::GL::MeshPrimitive::Triangles)
-      .setCount(nPrims * 3)
-      .addVertexBuffer(renderingBuffer_->vbo, 0,
-                       Magnum::GL::Attribute<0, Magnum::Vector3>{})
-      .addVertexBuffer(renderingBuffer_->cbo, 0,
-                       Magnum::GL::Attribute<1, Magnum::Color3>{})
-      .setIndexBuffer(renderingBuffer_->ibo, 0,
-                      Magnum::GL::MeshIndexType::UnsignedInt);
-
   buffersOnGPU_ = true;
 }
 
 Magnum::GL::Mesh* GenericInstanceMeshData::getMagnumGLMesh() {
-  if (renderingBuffer_ == nullptr) {
+  return getMagnumGLMesh(0);
+}
+
+Magnum::GL::Mesh* GenericInstanceMeshData::getMagnumGLMesh(int chunk) {
+  if (renderingBuffer_ == nullptr || chunk < 0 ||
+      chunk >= renderingBuffer_->chunks.size()) {
     return nullptr;
   }
-  return &(renderingBuffer_->mesh);
+  return &(renderingBuffer_->chunks[chunk]);
 }
 
 }  // namespace assets
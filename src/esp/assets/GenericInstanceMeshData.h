@@ -8,6 +8,7 @@
 #include <Magnum/GL/Buffer.h>
 #include <Magnum/GL/Mesh.h>
 #include <Magnum/GL/Texture.h>
+#include <Magnum/Math/Range.h>
 #include <Magnum/Trade/MeshData3D.h>
 #include <memory>
 #include <string>
@@ -25,6 +26,34 @@ namespace assets {
  */
 Magnum::GL::Texture2D createInstanceTexture(float* data, const int texSize);
 
+//! Interleaved vertex of an instance mesh, with the object id of its
+//! triangles; padded to keep the id aligned
+struct InstanceMeshVertex {
+  float position[3];
+  uint8_t color[3];
+  uint8_t padding;
+  uint32_t objectId;
+};
+
+//! Range of an instance mesh small enough for 16-bit indices
+struct InstanceMeshChunk {
+  size_t firstVertex;
+  size_t firstIndex;
+  size_t numIndices;
+};
+
+//! Split the triangles of an instance mesh, in order, into chunks of at most
+//! 65536 vertices indexed relative to their first vertex. Vertices shared by
+//! triangles of different objects are copied, so that every vertex carries the
+//! object id of its triangles
+void buildInstanceMeshChunks(const std::vector<vec3f>& positions,
+                             const std::vector<vec3uc>& colors,
+                             const std::vector<vec3ui>& triangles,
+                             const std::vector<uint32_t>& objectIds,
+                             std::vector<InstanceMeshVertex>& vertices,
+                             std::vector<uint16_t>& indices,
+                             std::vector<InstanceMeshChunk>& chunks);
+
 class GenericInstanceMeshData : public BaseMesh {
  public:
   struct RenderingBuffer {
@@ -32,7 +61,12 @@ class GenericInstanceMeshData : public BaseMesh {
     Magnum::GL::Buffer vbo;
     Magnum::GL::Buffer cbo;
     Magnum::GL::Buffer ibo;
+    //! object ids per vertex, if they are not interleaved into vbo
+    Magnum::GL::Buffer idbo;
     Magnum::GL::Texture2D tex;
+    //! meshes of the chunks of the buffers, if the object ids are in the
+    //! vertices instead of tex
+    std::vector<Magnum::GL::Mesh> chunks;
   };
 
   explicit GenericInstanceMeshData(SupportedMeshType type) : BaseMesh{type} {};
@@ -43,6 +77,17 @@ class GenericInstanceMeshData : public BaseMesh {
 
   virtual bool loadPLY(const std::string& plyFile);
 
+  //! Save the loaded mesh to a binary cache file for plyFile, see io::cache.h
+  bool saveCache(const std::string& plyFile,
+                 const std::string& cacheFile) const;
+  //! Load the mesh from a binary cache file written by saveCache(); returns
+  //! false if there is none or it is out of date with plyFile
+  bool loadCache(const std::string& plyFile, const std::string& cacheFile);
+
+  //! Reorder the triangles for the post-transform vertex cache and less
+  //! overdraw, along with their object ids
+  void optimizeTriangleOrder();
+
   virtual Magnum::GL::Texture2D* getSemanticTexture() {
     return &renderingBuffer_->tex;
   };
@@ -51,8 +96,20 @@ class GenericInstanceMeshData : public BaseMesh {
   virtual void uploadBuffersToGPU(bool forceReload = false) override;
   RenderingBuffer* getRenderingBuffer() { return renderingBuffer_.get(); }
 
+  //! The first chunk, see getMagnumGLMesh(int)
   virtual Magnum::GL::Mesh* getMagnumGLMesh() override;
 
+  //! Number of meshes the mesh is drawn as with object ids in the vertices,
+  //! 0 if it is drawn as getMagnumGLMesh() with getSemanticTexture()
+  virtual int getNumChunks() const {
+    return renderingBuffer_ ? renderingBuffer_->chunks.size() : 0;
+  }
+  virtual Magnum::GL::Mesh* getMagnumGLMesh(int chunk) override;
+  //! Bounds of the vertices of a chunk
+  Magnum::Range3D getChunkBoundingBox(int chunk) const {
+    return chunkBoundingBoxes_[chunk];
+  }
+
   const std::vector<vec3f>& getVertexBufferObjectCPU() const {
     return cpu_vbo_;
   }
@@ -65,6 +122,9 @@ class GenericInstanceMeshData : public BaseMesh {
   }
 
  protected:
+  // point the collision mesh data at the CPU buffers
+  void updateCollisionMeshData();
+
   // ==== rendering ====
   std::unique_ptr<RenderingBuffer> renderingBuffer_ = nullptr;
 
@@ -72,6 +132,7 @@ class GenericInstanceMeshData : public BaseMesh {
   std::vector<vec3uc> cpu_cbo_;
   std::vector<vec3ui> cpu_ibo_;
   std::vector<uint32_t> objectIds_;
+  std::vector<Magnum::Range3D> chunkBoundingBoxes_;
 };
 }  // namespace assets
 }  // namespace esp
@@ -3,11 +3,272 @@
 // LICENSE file in the root directory of this source tree.
 
 #include "GltfMeshData.h"
+
+#include <cmath>
+#include <cstring>
+
 #include <Corrade/Containers/ArrayViewStl.h>
-#include <Magnum/MeshTools/Compile.h>
+#include <Magnum/GL/Buffer.h>
+#include <Magnum/Math/Functions.h>
+#include <Magnum/Math/Range.h>
+#include <Magnum/Shaders/Generic.h>
+
+#include "MeshUploader.h"
+#include "esp/geo/MeshOptimization.h"
 
 namespace esp {
 namespace assets {
+
+namespace {
+// positions are only quantized if that moves them by at most this much
+const float maxQuantizationError = 0.5e-3f;
+
+using Vector4s = Magnum::Math::Vector4<Magnum::Short>;
+
+// 16-bit normalized integers of v, which is in [-1, 1]
+Vector4s packSnorm16(const Magnum::Vector3& v) {
+  Vector4s packed;
+  for (int k = 0; k < 3; ++k) {
+    packed[k] = std::round(Magnum::Math::clamp(v[k], -1.0f, 1.0f) * 32767);
+  }
+  return packed;
+}
+
+template <typename T>
+void permuteVertices(std::vector<T>& attribute,
+                     const std::vector<uint32_t>& order) {
+  std::vector<T> permuted;
+  permuted.reserve(order.size());
+  for (uint32_t v : order) {
+    permuted.push_back(attribute[v]);
+  }
+  attribute = std::move(permuted);
+}
+
+// Interleaved vertices of a mesh in a shared buffer. Positions, relative to
+// the box of center and halfSize, and normals are 16-bit normalized integers
+// if quantized, padded to 8 bytes
+struct VertexLayout {
+  bool quantized = false;
+  Magnum::Vector3 center;
+  Magnum::Vector3 halfSize;
+  size_t normalOffset = 0;
+  size_t textureCoordOffset = 0;
+  size_t colorOffset = 0;
+  size_t stride = 0;
+};
+
+VertexLayout vertexLayout(const Magnum::Trade::MeshData3D& meshData,
+                          bool quantized,
+                          const Magnum::Vector3& center,
+                          const Magnum::Vector3& halfSize) {
+  VertexLayout layout;
+  layout.quantized = quantized;
+  layout.center = center;
+  layout.halfSize = halfSize;
+  const size_t vectorSize =
+      quantized ? sizeof(Vector4s) : sizeof(Magnum::Vector3);
+  layout.stride = vectorSize;
+  if (meshData.hasNormals()) {
+    layout.normalOffset = layout.stride;
+    layout.stride += vectorSize;
+  }
+  if (meshData.hasTextureCoords2D()) {
+    layout.textureCoordOffset = layout.stride;
+    layout.stride += sizeof(Magnum::Vector2);
+  }
+  if (meshData.hasColors()) {
+    layout.colorOffset = layout.stride;
+    layout.stride += sizeof(Magnum::Color4);
+  }
+  return layout;
+}
+
+// bytes of an index of meshData, 0 if it is not indexed
+size_t indexSize(const Magnum::Trade::MeshData3D& meshData) {
+  if (!meshData.isIndexed()) {
+    return 0;
+  }
+  return meshData.positions(0).size() <= 65536 ? sizeof(Magnum::UnsignedShort)
+                                               : sizeof(Magnum::UnsignedInt);
+}
+
+// offsets in the shared buffers are kept 4-byte aligned
+size_t alignedSize(size_t size) {
+  return (size + 3) & ~size_t{3};
+}
+
+template <typename T>
+void writeAttribute(char* vertices,
+                    const VertexLayout& layout,
+                    size_t offset,
+                    const std::vector<T>& attribute) {
+  for (size_t v = 0; v < attribute.size(); ++v) {
+    std::memcpy(vertices + v * layout.stride + offset, &attribute[v],
+                sizeof(T));
+  }
+}
+
+void writeVectors(char* vertices,
+                  const VertexLayout& layout,
+                  size_t offset,
+                  const std::vector<Magnum::Vector3>& vectors,
+                  bool positions) {
+  if (!layout.quantized) {
+    writeAttribute(vertices, layout, offset, vectors);
+    return;
+  }
+  for (size_t v = 0; v < vectors.size(); ++v) {
+    const Vector4s packed = packSnorm16(
+        positions ? (vectors[v] - layout.center) / layout.halfSize
+                  : vectors[v]);
+    std::memcpy(vertices + v * layout.stride + offset, &packed,
+                sizeof(Vector4s));
+  }
+}
+
+// Write the vertices and indices of meshData in layout, touches no GL state
+void writeMeshData(const Magnum::Trade::MeshData3D& meshData,
+                   const VertexLayout& layout,
+                   char* vertices,
+                   char* indices) {
+  writeVectors(vertices, layout, 0, meshData.positions(0), true);
+  if (meshData.hasNormals()) {
+    writeVectors(vertices, layout, layout.normalOffset, meshData.normals(0),
+                 false);
+  }
+  if (meshData.hasTextureCoords2D()) {
+    writeAttribute(vertices, layout, layout.textureCoordOffset,
+                   meshData.textureCoords2D(0));
+  }
+  if (meshData.hasColors()) {
+    writeAttribute(vertices, layout, layout.colorOffset, meshData.colors(0));
+  }
+
+  if (indexSize(meshData) == sizeof(Magnum::UnsignedShort)) {
+    for (Magnum::UnsignedInt index : meshData.indices()) {
+      const Magnum::UnsignedShort shortIndex = index;
+      std::memcpy(indices, &shortIndex, sizeof(shortIndex));
+      indices += sizeof(shortIndex);
+    }
+  } else if (meshData.isIndexed()) {
+    std::memcpy(indices, meshData.indices().data(),
+                meshData.indices().size() * sizeof(Magnum::UnsignedInt));
+  }
+}
+
+// Mesh of meshData written in layout at vertexOffset and indexOffset of the
+// shared buffers, with the attributes MeshTools::compile() would bind
+Magnum::GL::Mesh bindMeshData(const Magnum::Trade::MeshData3D& meshData,
+                              const VertexLayout& layout,
+                              GltfMeshData::SharedBuffers& buffers,
+                              size_t vertexOffset,
+                              size_t indexOffset) {
+  using Magnum::Shaders::Generic3D;
+  Magnum::GL::Mesh mesh;
+  mesh.setPrimitive(meshData.primitive());
+
+  // each attribute is bound on its own, padded to the stride
+  const size_t vectorSize = layout.quantized ? 3 * sizeof(Magnum::Short)
+                                             : sizeof(Magnum::Vector3);
+  if (layout.quantized) {
+    mesh.addVertexBuffer(
+        buffers.vertices, vertexOffset,
+        Generic3D::Position{Generic3D::Position::Components::Three,
+                            Generic3D::Position::DataType::Short,
+                            Generic3D::Position::DataOption::Normalized},
+        layout.stride - vectorSize);
+  } else {
+    mesh.addVertexBuffer(buffers.vertices, vertexOffset, Generic3D::Position{},
+                         layout.stride - vectorSize);
+  }
+  if (meshData.hasNormals()) {
+    if (layout.quantized) {
+      mesh.addVertexBuffer(
+          buffers.vertices, vertexOffset + layout.normalOffset,
+          Generic3D::Normal{Generic3D::Normal::Components::Three,
+                            Generic3D::Normal::DataType::Short,
+                            Generic3D::Normal::DataOption::Normalized},
+          layout.stride - vectorSize);
+    } else {
+      mesh.addVertexBuffer(buffers.vertices,
+                           vertexOffset + layout.normalOffset,
+                           Generic3D::Normal{}, layout.stride - vectorSize);
+    }
+  }
+  if (meshData.hasTextureCoords2D()) {
+    mesh.addVertexBuffer(buffers.vertices,
+                         vertexOffset + layout.textureCoordOffset,
+                         Generic3D::TextureCoordinates{},
+                         layout.stride - sizeof(Magnum::Vector2));
+  }
+  if (meshData.hasColors()) {
+    mesh.addVertexBuffer(buffers.vertices, vertexOffset + layout.colorOffset,
+                         Generic3D::Color4{},
+                         layout.stride - sizeof(Magnum::Color4));
+  }
+
+  if (!meshData.isIndexed()) {
+    mesh.setCount(meshData.positions(0).size());
+    return mesh;
+  }
+  mesh.setCount(meshData.indices().size())
+      .setIndexBuffer(buffers.indices, indexOffset,
+                      indexSize(meshData) == sizeof(Magnum::UnsignedShort)
+                          ? Magnum::GL::MeshIndexType::UnsignedShort
+                          : Magnum::GL::MeshIndexType::UnsignedInt);
+  return mesh;
+}
+
+template <typename T>
+std::vector<std::vector<T>> gatherVertices(
+    const std::vector<T>& attribute,
+    const std::vector<Magnum::UnsignedInt>& vertices) {
+  std::vector<T> gathered;
+  gathered.reserve(vertices.size());
+  for (Magnum::UnsignedInt v : vertices) {
+    gathered.push_back(attribute[v]);
+  }
+  return {std::move(gathered)};
+}
+
+// mesh data of a level of detail, holding only the vertices it references
+Magnum::Trade::MeshData3D lodMeshData(
+    const Magnum::Trade::MeshData3D& meshData,
+    const std::vector<uint32_t>& lodIndices) {
+  const Magnum::UnsignedInt unused = ~0u;
+  std::vector<Magnum::UnsignedInt> newIndices(meshData.positions(0).size(),
+                                              unused);
+  std::vector<Magnum::UnsignedInt> vertices;
+  std::vector<Magnum::UnsignedInt> indices;
+  indices.reserve(lodIndices.size());
+  for (uint32_t v : lodIndices) {
+    if (newIndices[v] == unused) {
+      newIndices[v] = vertices.size();
+      vertices.push_back(v);
+    }
+    indices.push_back(newIndices[v]);
+  }
+
+  std::vector<std::vector<Magnum::Vector3>> normals;
+  std::vector<std::vector<Magnum::Vector2>> textureCoords2D;
+  std::vector<std::vector<Magnum::Color4>> colors;
+  if (meshData.hasNormals()) {
+    normals = gatherVertices(meshData.normals(0), vertices);
+  }
+  if (meshData.hasTextureCoords2D()) {
+    textureCoords2D = gatherVertices(meshData.textureCoords2D(0), vertices);
+  }
+  if (meshData.hasColors()) {
+    colors = gatherVertices(meshData.colors(0), vertices);
+  }
+  return Magnum::Trade::MeshData3D{
+      meshData.primitive(), std::move(indices),
+      gatherVertices(meshData.positions(0), vertices), std::move(normals),
+      std::move(textureCoords2D), std::move(colors)};
+}
+}  // namespace
+
 void GltfMeshData::uploadBuffersToGPU(bool forceReload) {
   if (forceReload) {
     buffersOnGPU_ = false;
@@ -15,11 +276,108 @@ void GltfMeshData::uploadBuffersToGPU(bool forceReload) {
   if (buffersOnGPU_) {
     return;
   }
+  // a batch of one, in buffers of its own
+  MeshUploader uploader;
+  uploader.add(*this);
+  uploader.upload(1);
+}
+
+void GltfMeshData::prepareUpload(size_t& vertexBytes, size_t& indexBytes) {
+  uploadParts_.clear();
+  vertexBytes = 0;
+  indexBytes = 0;
+  if (!meshData_) {
+    return;
+  }
+  // quantize within the bounds of the mesh if that is precise enough, the
+  // levels of detail within the same bounds so that they share the
+  // dequantization
+  positionDequantization_ = Magnum::Matrix4{};
+  bool quantized = false;
+  Magnum::Vector3 center;
+  Magnum::Vector3 halfSize{1.0f};
+  if (quantize_ && !meshData_->positions(0).empty()) {
+    Magnum::Range3D bounds{meshData_->positions(0)[0],
+                           meshData_->positions(0)[0]};
+    for (const Magnum::Vector3& position : meshData_->positions(0)) {
+      bounds.min() = Magnum::Math::min(bounds.min(), position);
+      bounds.max() = Magnum::Math::max(bounds.max(), position);
+    }
+    center = bounds.center();
+    // flat meshes are quantized by a unit scale along their flat axes
+    halfSize = bounds.size() / 2;
+    for (int k = 0; k < 3; ++k) {
+      if (!(halfSize[k] > 0)) {
+        halfSize[k] = 1;
+      }
+    }
+    // rounding moves a coordinate by at most half a step of 1/32767
+    quantized = (halfSize / 65534).max() <= maxQuantizationError;
+    if (quantized) {
+      positionDequantization_ = Magnum::Matrix4::translation(center) *
+                                Magnum::Matrix4::scaling(halfSize);
+    }
+  }
 
+  uploadParts_.resize(1 + lods_.size());
+  for (size_t i = 0; i < lods_.size(); ++i) {
+    uploadParts_[i + 1].lodData = lodMeshData(*meshData_, lods_[i].indices);
+  }
+  for (UploadPart& part : uploadParts_) {
+    const Magnum::Trade::MeshData3D& data =
+        part.lodData ? *part.lodData : *meshData_;
+    const VertexLayout layout =
+        vertexLayout(data, quantized, center, halfSize);
+    part.quantized = quantized;
+    part.center = center;
+    part.halfSize = halfSize;
+    part.vertexOffset = vertexBytes;
+    part.indexOffset = indexBytes;
+    vertexBytes += alignedSize(data.positions(0).size() * layout.stride);
+    indexBytes += alignedSize(data.isIndexed()
+                                  ? data.indices().size() * indexSize(data)
+                                  : 0);
+    part.bytes =
+        vertexBytes - part.vertexOffset + indexBytes - part.indexOffset;
+  }
+}
+
+void GltfMeshData::writeUpload(char* vertices, char* indices) const {
+  for (const UploadPart& part : uploadParts_) {
+    const Magnum::Trade::MeshData3D& data =
+        part.lodData ? *part.lodData : *meshData_;
+    writeMeshData(data,
+                  vertexLayout(data, part.quantized, part.center,
+                               part.halfSize),
+                  vertices + part.vertexOffset, indices + part.indexOffset);
+  }
+}
+
+void GltfMeshData::finishUpload(std::shared_ptr<SharedBuffers> buffers,
+                                size_t vertexOffset,
+                                size_t indexOffset) {
   renderingBuffer_.reset();
   renderingBuffer_ = std::make_unique<GltfMeshData::RenderingBuffer>();
-  // position, normals, uv, colors are bound to corresponding attributes
-  renderingBuffer_->mesh = Magnum::MeshTools::compile(*meshData_);
+  renderingBuffer_->buffers = std::move(buffers);
+  gpuMemoryBytes_ = 0;
+  for (size_t i = 0; i < uploadParts_.size(); ++i) {
+    const UploadPart& part = uploadParts_[i];
+    const Magnum::Trade::MeshData3D& data =
+        part.lodData ? *part.lodData : *meshData_;
+    Magnum::GL::Mesh mesh = bindMeshData(
+        data,
+        vertexLayout(data, part.quantized, part.center, part.halfSize),
+        *renderingBuffer_->buffers, vertexOffset + part.vertexOffset,
+        indexOffset + part.indexOffset);
+    gpuMemoryBytes_ += part.bytes;
+    if (i == 0) {
+      renderingBuffer_->mesh = std::move(mesh);
+    } else {
+      renderingBuffer_->lodMeshes.push_back(std::move(mesh));
+    }
+  }
+  // the levels of detail are only kept on the GPU
+  uploadParts_.clear();
   buffersOnGPU_ = true;
 }
 
@@ -31,6 +389,78 @@ Magnum::GL::Mesh* GltfMeshData::getMagnumGLMesh() {
   return &(renderingBuffer_->mesh);
 }
 
+void GltfMeshData::setLODs(std::vector<geo::MeshLOD> lods) {
+  lods_ = std::move(lods);
+  buffersOnGPU_ = false;
+}
+
+Magnum::GL::Mesh* GltfMeshData::getLODMesh(int level) {
+  if (renderingBuffer_ == nullptr ||
+      level >= static_cast<int>(renderingBuffer_->lodMeshes.size())) {
+    return nullptr;
+  }
+  return &renderingBuffer_->lodMeshes[level];
+}
+
+void GltfMeshData::optimize() {
+  if (!meshData_ || !meshData_->isIndexed() ||
+      meshData_->primitive() != Magnum::MeshPrimitive::Triangles) {
+    return;
+  }
+  std::vector<Magnum::UnsignedInt>& indices = meshData_->indices();
+  std::vector<vec3f> positions;
+  positions.reserve(meshData_->positions(0).size());
+  for (const Magnum::Vector3& position : meshData_->positions(0)) {
+    positions.emplace_back(position.x(), position.y(), position.z());
+  }
+
+  std::vector<uint32_t> triangleOrder =
+      geo::vertexCacheTriangleOrder(indices, positions.size());
+  triangleOrder = geo::overdrawTriangleOrder(indices, positions, triangleOrder);
+  indices = geo::reorderTriangles(indices, triangleOrder);
+  // levels of detail are drawn from afar, where overdraw matters less
+  for (geo::MeshLOD& lod : lods_) {
+    lod.indices = geo::reorderTriangles(
+        lod.indices, geo::vertexCacheTriangleOrder(lod.indices,
+                                                   positions.size()));
+  }
+
+  // vertices in the order the full mesh first uses them
+  const std::vector<uint32_t> vertexOrder =
+      geo::vertexFetchOrder(indices, positions.size());
+  std::vector<uint32_t> newIndices(vertexOrder.size());
+  for (size_t i = 0; i < vertexOrder.size(); ++i) {
+    newIndices[vertexOrder[i]] = i;
+  }
+  for (Magnum::UnsignedInt& index : indices) {
+    index = newIndices[index];
+  }
+  for (geo::MeshLOD& lod : lods_) {
+    for (uint32_t& index : lod.indices) {
+      index = newIndices[index];
+    }
+  }
+  for (Magnum::UnsignedInt i = 0; i < meshData_->positionArrayCount(); ++i) {
+    permuteVertices(meshData_->positions(i), vertexOrder);
+  }
+  for (Magnum::UnsignedInt i = 0; i < meshData_->normalArrayCount(); ++i) {
+    permuteVertices(meshData_->normals(i), vertexOrder);
+  }
+  for (Magnum::UnsignedInt i = 0; i < meshData_->textureCoords2DArrayCount();
+       ++i) {
+    permuteVertices(meshData_->textureCoords2D(i), vertexOrder);
+  }
+  for (Magnum::UnsignedInt i = 0; i < meshData_->colorArrayCount(); ++i) {
+    permuteVertices(meshData_->colors(i), vertexOrder);
+  }
+
+  // the collision mesh views the reallocated arrays
+  collisionMeshData_.positions = meshData_->positions(0);
+  collisionMeshData_.indices = meshData_->indices();
+  quantize_ = true;
+  buffersOnGPU_ = false;
+}
+
 void GltfMeshData::setMeshData(Magnum::Trade::AbstractImporter& importer,
                                int meshID) {
   ASSERT(0 <= meshID && meshID < importer.mesh3DCount());
@@ -41,5 +471,15 @@ void GltfMeshData::setMeshData(Magnum::Trade::AbstractImporter& importer,
   collisionMeshData_.indices = meshData_->indices();
 }
 
+void GltfMeshData::remapTextureCoordinates(const TextureAtlas& atlas,
+                                           int texture) {
+  if (!meshData_ || !meshData_->hasTextureCoords2D()) {
+    return;
+  }
+  for (Magnum::Vector2& textureCoordinates : meshData_->textureCoords2D(0)) {
+    textureCoordinates = atlas.remap(texture, textureCoordinates);
+  }
+}
+
 }  // namespace assets
 }  // namespace esp
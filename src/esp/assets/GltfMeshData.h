@@ -4,19 +4,36 @@
 
 #pragma once
 #include <Corrade/Containers/Optional.h>
+#include <Magnum/GL/Buffer.h>
 #include <Magnum/GL/Mesh.h>
 #include <Magnum/Trade/AbstractImporter.h>
 #include <Magnum/Trade/MeshData3D.h>
+#include <memory>
+#include <vector>
 
 #include "BaseMesh.h"
+#include "TextureAtlas.h"
 #include "esp/core/esp.h"
+#include "esp/geo/MeshSimplification.h"
 
 namespace esp {
 namespace assets {
 class GltfMeshData : public BaseMesh {
  public:
+  //! Interleaved vertices and indices of meshes uploaded together, see
+  //! MeshUploader
+  struct SharedBuffers {
+    Magnum::GL::Buffer vertices;
+    Magnum::GL::Buffer indices;
+  };
+
   struct RenderingBuffer {
+    //! buffers the meshes are suballocated from, declared first so that they
+    //! outlive them
+    std::shared_ptr<SharedBuffers> buffers;
     Magnum::GL::Mesh mesh;
+    //! levels of detail, finest first
+    std::vector<Magnum::GL::Mesh> lodMeshes;
   };
   GltfMeshData() : BaseMesh(SupportedMeshType::GLTF_MESH){};
 
@@ -24,18 +41,82 @@ class GltfMeshData : public BaseMesh {
 
   virtual void uploadBuffersToGPU(bool forceReload = false) override;
 
+  // The stages of an upload, see MeshUploader
+
+  //! Lay out the vertices and indices of the mesh and its levels of detail,
+  //! returning their bytes in vertexBytes and indexBytes. Touches no GL state
+  void prepareUpload(size_t& vertexBytes, size_t& indexBytes);
+
+  //! Write the laid out vertices and indices to vertices and indices, which
+  //! hold vertexBytes and indexBytes. Touches no GL state and is safe to call
+  //! for many meshes at once
+  void writeUpload(char* vertices, char* indices) const;
+
+  //! Create the GL meshes from the vertices and indices written at
+  //! vertexOffset and indexOffset of buffers
+  void finishUpload(std::shared_ptr<SharedBuffers> buffers,
+                    size_t vertexOffset,
+                    size_t indexOffset);
+
   void setMeshData(Magnum::Trade::AbstractImporter& importer, int meshID);
 
+  //! Move the texture coordinates of the mesh into the placement of texture
+  //! in atlas, before upload, see TextureAtlas
+  void remapTextureCoordinates(const TextureAtlas& atlas, int texture);
+
+  //! Reorder the triangles of the mesh and its levels of detail for the
+  //! post-transform vertex cache and less overdraw, and its vertices by first
+  //! use. Positions and normals are then uploaded as 16-bit integers where
+  //! that is precise enough, see getPositionDequantization()
+  void optimize();
+
+  //! Transformation from the positions of the uploaded mesh to the frame of
+  //! the mesh, identity unless they are quantized
+  const Magnum::Matrix4& getPositionDequantization() const {
+    return positionDequantization_;
+  }
+
   virtual RenderingBuffer* getRenderingBuffer() {
     return renderingBuffer_.get();
   }
 
   virtual Magnum::GL::Mesh* getMagnumGLMesh() override;
 
+  //! Set the coarser levels of detail of the mesh, finest first; they are
+  //! uploaded along with the mesh
+  void setLODs(std::vector<geo::MeshLOD> lods);
+
+  int getNumLODs() const { return lods_.size(); }
+
+  //! Mesh of a level of detail, nullptr before upload
+  Magnum::GL::Mesh* getLODMesh(int level);
+
+  float getLODError(int level) const { return lods_[level].error; }
+
  protected:
   // we will have to use smart pointer here since each item within the structure
   // (e.g., Magnum::GL::Mesh) does NOT have copy constructor
   std::unique_ptr<RenderingBuffer> renderingBuffer_ = nullptr;
+
+  std::vector<geo::MeshLOD> lods_;
+
+  bool quantize_ = false;
+  Magnum::Matrix4 positionDequantization_;
+
+  //! The mesh or a level of detail laid out by prepareUpload()
+  struct UploadPart {
+    //! data of a level of detail, empty for the mesh itself
+    Corrade::Containers::Optional<Magnum::Trade::MeshData3D> lodData;
+    bool quantized = false;
+    Magnum::Vector3 center;
+    Magnum::Vector3 halfSize;
+    //! offsets from those of the mesh in the shared buffers
+    size_t vertexOffset = 0;
+    size_t indexOffset = 0;
+    //! bytes of the part in the shared buffers, with alignment
+    size_t bytes = 0;
+  };
+  std::vector<UploadPart> uploadParts_;
 };
 }  // namespace assets
 }  // namespace esp
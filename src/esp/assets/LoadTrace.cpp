@@ -0,0 +1,109 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#include "LoadTrace.h"
+
+#include <sys/resource.h>
+
+namespace esp {
+namespace assets {
+
+namespace {
+typedef std::chrono::steady_clock Clock;
+
+// the trace the calling thread records into and the stage it is in since
+struct ThreadTrace {
+  LoadTrace* trace = nullptr;
+  LoadStage stage = LoadStage::Other;
+  Clock::time_point since;
+};
+
+thread_local ThreadTrace threadTrace;
+
+// count the time since the last switch towards the current stage
+void lap(ThreadTrace& state) {
+  const Clock::time_point now = Clock::now();
+  state.trace->stageSeconds[static_cast<int>(state.stage)] +=
+      std::chrono::duration<double>(now - state.since).count();
+  state.since = now;
+}
+}  // namespace
+
+const char* loadStageName(LoadStage stage) {
+  switch (stage) {
+    case LoadStage::Read:
+      return "read";
+    case LoadStage::Process:
+      return "process";
+    case LoadStage::Upload:
+      return "upload";
+    case LoadStage::Shaders:
+      return "shaders";
+    case LoadStage::Instantiate:
+      return "instantiate";
+    case LoadStage::Collision:
+      return "collision";
+    case LoadStage::Other:
+      return "other";
+  }
+  return "";
+}
+
+size_t peakResidentBytes() {
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return 0;
+  }
+#ifdef __APPLE__
+  return usage.ru_maxrss;
+#else
+  // in kilobytes on Linux
+  return size_t(usage.ru_maxrss) * 1024;
+#endif
+}
+
+LoadTraceScope::LoadTraceScope(LoadTrace& trace, const std::string& asset) {
+  if (threadTrace.trace != nullptr) {
+    return;
+  }
+  trace = LoadTrace{};
+  trace.asset = asset;
+  trace_ = &trace;
+  start_ = Clock::now();
+  threadTrace.trace = trace_;
+  threadTrace.stage = LoadStage::Other;
+  threadTrace.since = start_;
+}
+
+LoadTraceScope::~LoadTraceScope() {
+  if (trace_ == nullptr) {
+    return;
+  }
+  lap(threadTrace);
+  trace_->totalSeconds =
+      std::chrono::duration<double>(Clock::now() - start_).count();
+  trace_->peakResidentBytes = peakResidentBytes();
+  threadTrace.trace = nullptr;
+}
+
+LoadStageTimer::LoadStageTimer(LoadStage stage) {
+  if (threadTrace.trace == nullptr) {
+    return;
+  }
+  active_ = true;
+  lap(threadTrace);
+  interrupted_ = threadTrace.stage;
+  threadTrace.stage = stage;
+}
+
+LoadStageTimer::~LoadStageTimer() {
+  if (!active_ || threadTrace.trace == nullptr) {
+    return;
+  }
+  lap(threadTrace);
+  threadTrace.stage = interrupted_;
+}
+
+}  // namespace assets
+}  // namespace esp
@@ -0,0 +1,91 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+namespace esp {
+namespace assets {
+
+//! Stages of loading a scene asset, timed by a LoadTrace
+enum class LoadStage {
+  //! reading and parsing files: PLY, glTF, images, caches
+  Read,
+  //! CPU work on the parsed data, e.g. splitting, adjacency, translation
+  Process,
+  //! creating GL buffers and textures
+  Upload,
+  //! compiling and linking shaders
+  Shaders,
+  //! creating the scene graph nodes and drawables of the asset
+  Instantiate,
+  //! building the collision meshes of physics
+  Collision,
+  //! anything in none of the above
+  Other,
+};
+
+constexpr int numLoadStages = static_cast<int>(LoadStage::Other) + 1;
+
+//! Lowercase name of stage, e.g. for JSON keys
+const char* loadStageName(LoadStage stage);
+
+//! Time spent in each stage of loading a scene asset, each second counted
+//! towards the innermost stage running on the loading thread. Work handed to
+//! worker threads counts towards the stage waiting for it
+struct LoadTrace {
+  //! absolute path of the asset
+  std::string asset;
+  double stageSeconds[numLoadStages] = {};
+  double totalSeconds = 0.0;
+  //! peak resident memory of the process once loaded
+  size_t peakResidentBytes = 0;
+  //! GPU memory of the asset, see ResourceManager::getMemoryStats()
+  size_t gpuBytes = 0;
+
+  double seconds(LoadStage stage) const {
+    return stageSeconds[static_cast<int>(stage)];
+  }
+};
+
+//! Peak resident memory of the process so far, 0 where unknown
+size_t peakResidentBytes();
+
+//! Records the stages timed on the calling thread into trace while it lives,
+//! resetting it for asset first. Only the outermost scope of a thread
+//! records, so that loads calling other loads make one trace
+class LoadTraceScope {
+ public:
+  LoadTraceScope(LoadTrace& trace, const std::string& asset);
+  ~LoadTraceScope();
+
+  LoadTraceScope(const LoadTraceScope&) = delete;
+  LoadTraceScope& operator=(const LoadTraceScope&) = delete;
+
+ private:
+  LoadTrace* trace_ = nullptr;
+  std::chrono::steady_clock::time_point start_;
+};
+
+//! Counts the time until it is destroyed towards stage, pausing the stage it
+//! interrupts, if the calling thread is recording a LoadTrace. Costs nothing
+//! otherwise
+class LoadStageTimer {
+ public:
+  explicit LoadStageTimer(LoadStage stage);
+  ~LoadStageTimer();
+
+  LoadStageTimer(const LoadStageTimer&) = delete;
+  LoadStageTimer& operator=(const LoadStageTimer&) = delete;
+
+ private:
+  bool active_ = false;
+  LoadStage interrupted_ = LoadStage::Other;
+};
+
+}  // namespace assets
+}  // namespace esp
@@ -0,0 +1,118 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#include "MeshUploader.h"
+
+#include <memory>
+
+#include <Magnum/GL/Buffer.h>
+
+#include "esp/geo/geo.h"
+
+namespace esp {
+namespace assets {
+
+namespace {
+// Allocate size bytes of buffer for its single write, nullptr if it cannot be
+// mapped and has to be filled by setData() instead
+char* mapForWrite(Magnum::GL::Buffer& buffer, size_t size) {
+  buffer.setData({nullptr, size}, Magnum::GL::BufferUsage::StaticDraw);
+#ifndef MAGNUM_TARGET_WEBGL
+  return buffer.map(0, size,
+                    Magnum::GL::Buffer::MapFlag::Write |
+                        Magnum::GL::Buffer::MapFlag::InvalidateBuffer);
+#else
+  return nullptr;
+#endif
+}
+
+// Unmap buffer after mapForWrite(), or upload staging if it was not mapped.
+// False if the data was lost while mapped and has to be uploaded again
+bool finishWrite(Magnum::GL::Buffer& buffer,
+                 char* mapped,
+                 const std::vector<char>& staging) {
+  if (mapped == nullptr) {
+    buffer.setData(staging, Magnum::GL::BufferUsage::StaticDraw);
+    return true;
+  }
+#ifndef MAGNUM_TARGET_WEBGL
+  return buffer.unmap();
+#else
+  return true;
+#endif
+}
+}  // namespace
+
+void MeshUploader::upload(int numThreads /* = 0 */) {
+  if (meshes_.empty()) {
+    return;
+  }
+  // offsets of the meshes in the shared buffers
+  std::vector<size_t> vertexOffsets(meshes_.size() + 1, 0);
+  std::vector<size_t> indexOffsets(meshes_.size() + 1, 0);
+  geo::parallelFor(meshes_.size(), numThreads, [&](size_t i) {
+    meshes_[i]->prepareUpload(vertexOffsets[i + 1], indexOffsets[i + 1]);
+  });
+  for (size_t i = 0; i < meshes_.size(); ++i) {
+    vertexOffsets[i + 1] += vertexOffsets[i];
+    indexOffsets[i + 1] += indexOffsets[i];
+  }
+  const size_t vertexBytes = vertexOffsets.back();
+  const size_t indexBytes = indexOffsets.back();
+
+  auto buffers = std::make_shared<GltfMeshData::SharedBuffers>();
+  std::vector<char> vertexStaging;
+  std::vector<char> indexStaging;
+  char* vertices = vertexBytes > 0
+                       ? mapForWrite(buffers->vertices, vertexBytes)
+                       : nullptr;
+  char* indices =
+      indexBytes > 0 ? mapForWrite(buffers->indices, indexBytes) : nullptr;
+  const bool verticesMapped = vertices != nullptr;
+  const bool indicesMapped = indices != nullptr;
+  // write the meshes to CPU memory if the buffers cannot be mapped
+  if (!verticesMapped) {
+    vertexStaging.resize(vertexBytes);
+    vertices = vertexStaging.data();
+  }
+  if (!indicesMapped) {
+    indexStaging.resize(indexBytes);
+    indices = indexStaging.data();
+  }
+  geo::parallelFor(meshes_.size(), numThreads, [&](size_t i) {
+    meshes_[i]->writeUpload(vertices + vertexOffsets[i],
+                            indices + indexOffsets[i]);
+  });
+
+  bool lost = vertexBytes > 0 &&
+              !finishWrite(buffers->vertices,
+                           verticesMapped ? vertices : nullptr, vertexStaging);
+  lost = (indexBytes > 0 &&
+          !finishWrite(buffers->indices, indicesMapped ? indices : nullptr,
+                       indexStaging)) ||
+         lost;
+  if (lost) {
+    // the GL may discard mapped data, e.g. on a mode switch; write the meshes
+    // again and upload them from CPU memory
+    LOG(WARNING) << "Mapped mesh buffers were lost, uploading them again";
+    vertexStaging.resize(vertexBytes);
+    indexStaging.resize(indexBytes);
+    geo::parallelFor(meshes_.size(), numThreads, [&](size_t i) {
+      meshes_[i]->writeUpload(vertexStaging.data() + vertexOffsets[i],
+                              indexStaging.data() + indexOffsets[i]);
+    });
+    buffers->vertices.setData(vertexStaging,
+                              Magnum::GL::BufferUsage::StaticDraw);
+    buffers->indices.setData(indexStaging,
+                             Magnum::GL::BufferUsage::StaticDraw);
+  }
+
+  for (size_t i = 0; i < meshes_.size(); ++i) {
+    meshes_[i]->finishUpload(buffers, vertexOffsets[i], indexOffsets[i]);
+  }
+  meshes_.clear();
+}
+
+}  // namespace assets
+}  // namespace esp
@@ -0,0 +1,39 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#pragma once
+
+#include <vector>
+
+#include "GltfMeshData.h"
+#include "esp/core/esp.h"
+
+namespace esp {
+namespace assets {
+
+// Uploads many meshes at once, like the thousands of meshes of some glTF
+// scenes. Instead of allocating and filling GL buffers mesh by mesh, the
+// meshes are suballocated from one vertex and one index buffer, which are
+// mapped and filled on worker threads and then unmapped once
+class MeshUploader {
+ public:
+  //! Add mesh to the next upload, it has to outlive it
+  void add(GltfMeshData& mesh) { meshes_.push_back(&mesh); }
+
+  //! Meshes added since the last upload
+  size_t size() const { return meshes_.size(); }
+
+  //! Upload the added meshes, writing their vertices and indices on
+  //! numThreads threads, 0 for all of the core::ThreadPool. Has to be called on
+  //! the thread of the GL context
+  void upload(int numThreads = 0);
+
+ private:
+  std::vector<GltfMeshData*> meshes_;
+
+  ESP_SMART_POINTERS(MeshUploader)
+};
+
+}  // namespace assets
+}  // namespace esp
@@ -4,6 +4,8 @@
 
 #include "Mp3dInstanceMeshData.h"
 
+#include <algorithm>
+#include <cstring>
 #include <fstream>
 #include <sstream>
 #include <vector>
@@ -22,99 +24,200 @@
 
 #include "esp/core/esp.h"
 #include "esp/geo/geo.h"
+#include "esp/io/cache.h"
 #include "esp/io/io.h"
 
 namespace esp {
 namespace assets {
 
-bool Mp3dInstanceMeshData::loadMp3dPLY(const std::string& plyFile) {
-  std::ifstream ifs(plyFile);
-  if (!ifs.good()) {
-    LOG(ERROR) << "Cannot open file at " << plyFile;
+namespace {
+
+// Bytes of a scalar PLY property type, 0 if unknown
+size_t plyTypeSize(const std::string& type) {
+  if (type == "char" || type == "uchar" || type == "int8" || type == "uint8") {
+    return 1;
+  }
+  if (type == "short" || type == "ushort" || type == "int16" ||
+      type == "uint16") {
+    return 2;
+  }
+  if (type == "int" || type == "uint" || type == "int32" || type == "uint32" ||
+      type == "float" || type == "float32") {
+    return 4;
+  }
+  if (type == "double" || type == "float64") {
+    return 8;
+  }
+  return 0;
+}
+
+// An element of a binary PLY header, with the offsets of its scalar
+// properties in its records
+struct PlyElement {
+  std::string name;
+  int count = 0;
+  size_t stride = 0;
+  std::vector<std::pair<std::string, size_t>> offsets;
+  // whether the element starts with a list of 3 uchar counted ints, like
+  // vertex_indices
+  bool hasTriangleList = false;
+
+  // offset of property name, or of the ordinal-th scalar property if there is
+  // no such name; false if there is neither
+  bool offset(const std::string& name, size_t ordinal, size_t& result) const {
+    for (const auto& property : offsets) {
+      if (property.first == name) {
+        result = property.second;
+        return true;
+      }
+    }
+    if (ordinal < offsets.size()) {
+      result = offsets[ordinal].second;
+      return true;
+    }
+    return false;
+  }
+};
+
+// Parse the header of a binary little endian PLY, setting dataOffset to the
+// start of the records
+bool parsePlyHeader(const char* data,
+                    size_t size,
+                    std::vector<PlyElement>& elements,
+                    size_t& dataOffset) {
+  const std::string endHeader = "end_header\n";
+  const char* end =
+      std::search(data, data + size, endHeader.begin(), endHeader.end());
+  if (end == data + size) {
+    LOG(ERROR) << "Invalid ply file header";
     return false;
   }
+  dataOffset = end - data + endHeader.size();
 
+  std::istringstream header(std::string(data, end));
   std::string line, token;
-  std::istringstream iss;
-  std::getline(ifs, line);
+  std::getline(header, line);
   if (line != "ply") {
     LOG(ERROR) << "Invalid ply file header";
     return false;
   }
-  std::getline(ifs, line);
+  std::getline(header, line);
   if (line != "format binary_little_endian 1.0") {
     LOG(ERROR) << "Invalid ply file header";
     return false;
   }
+  while (std::getline(header, line)) {
+    std::istringstream iss(line);
+    iss >> token;
+    if (token == "element") {
+      elements.emplace_back();
+      iss >> elements.back().name >> elements.back().count;
+    } else if (token == "property") {
+      if (elements.empty()) {
+        LOG(ERROR) << "Ply property outside of an element: " << line;
+        return false;
+      }
+      PlyElement& element = elements.back();
+      std::string type, name;
+      iss >> type;
+      if (type == "list") {
+        std::string countType, indexType;
+        iss >> countType >> indexType;
+        // only fixed size triangle lists can be read as records
+        if (element.stride != 0 || plyTypeSize(countType) != 1 ||
+            plyTypeSize(indexType) != 4) {
+          LOG(ERROR) << "Unsupported ply list property: " << line;
+          return false;
+        }
+        element.hasTriangleList = true;
+        element.stride = 1 + 3 * 4;
+        continue;
+      }
+      iss >> name;
+      const size_t typeSize = plyTypeSize(type);
+      if (typeSize == 0) {
+        LOG(ERROR) << "Unknown ply property type: " << line;
+        return false;
+      }
+      element.offsets.emplace_back(name, element.stride);
+      element.stride += typeSize;
+    }
+  }
+  return true;
+}
 
-  // element vertex nVertex
-  std::getline(ifs, line);
-  iss.str(line);
-  iss >> token;
-  if (token != "element") {
-    LOG(ERROR) << "Invalid element vertex header line";
+template <typename T>
+T readPly(const char* record, size_t offset) {
+  T value;
+  std::memcpy(&value, record + offset, sizeof(T));
+  return value;
+}
+
+}  // namespace
+
+bool Mp3dInstanceMeshData::loadMp3dPLY(const std::string& plyFile) {
+  const io::MappedFile file(plyFile);
+  if (!file.isValid()) {
+    LOG(ERROR) << "Cannot open file at " << plyFile;
+    return false;
+  }
+  std::vector<PlyElement> elements;
+  size_t dataOffset = 0;
+  if (!parsePlyHeader(file.data(), file.size(), elements, dataOffset)) {
+    return false;
+  }
+  if (elements.size() < 2 || elements[0].name != "vertex" ||
+      elements[1].name != "face" || !elements[1].hasTriangleList) {
+    LOG(ERROR) << "Expected vertex and triangle elements in " << plyFile;
+    return false;
+  }
+  const PlyElement& vertices = elements[0];
+  const PlyElement& faces = elements[1];
+  size_t x, y, z, red, green, blue, materialId, segmentId, categoryId;
+  if (!vertices.offset("x", 0, x) || !vertices.offset("y", 1, y) ||
+      !vertices.offset("z", 2, z) || !vertices.offset("red", 8, red) ||
+      !vertices.offset("green", 9, green) ||
+      !vertices.offset("blue", 10, blue) ||
+      !faces.offset("material_id", 0, materialId) ||
+      !faces.offset("segment_id", 1, segmentId) ||
+      !faces.offset("category_id", 2, categoryId)) {
+    LOG(ERROR) << "Missing vertex or face properties in " << plyFile;
     return false;
   }
-  int nVertex;
-  iss >> token >> nVertex;
-
-  // we know the header is fixed so skip until face count
-  do {
-    std::getline(ifs, line);
-  } while ((line.substr(0, 12) != "element face") && !ifs.eof());
-  std::stringstream iss2;
-  iss2.str(line);
-  iss2 >> token;
-  if (token != "element") {
-    LOG(ERROR) << "Invalid element face header line";
+  const int nVertex = vertices.count;
+  const int nFace = faces.count;
+  if (nVertex < 0 || nFace < 0 ||
+      dataOffset + size_t(nVertex) * vertices.stride +
+              size_t(nFace) * faces.stride >
+          file.size()) {
+    LOG(ERROR) << "Truncated ply file " << plyFile;
     return false;
   }
-  int nFace;
-  iss2 >> token >> nFace;
-
-  // ignore rest of header
-  do {
-    std::getline(ifs, line);
-  } while ((line != "end_header") && !ifs.eof());
-
-  cpu_cbo_.clear();
-  cpu_cbo_.reserve(nVertex);
-  cpu_vbo_.clear();
-  cpu_vbo_.reserve(nVertex);
-  cpu_ibo_.clear();
-  cpu_ibo_.reserve(nFace);
-
-  for (int i = 0; i < nVertex; ++i) {
-    vec3f position;
-    vec3f normal;
-    vec2f texCoords;
-    vec3uc rgb;
-
-    ifs.read(reinterpret_cast<char*>(position.data()), 3 * sizeof(float));
-    ifs.read(reinterpret_cast<char*>(normal.data()), 3 * sizeof(float));
-    ifs.read(reinterpret_cast<char*>(texCoords.data()), 2 * sizeof(float));
-    ifs.read(reinterpret_cast<char*>(rgb.data()), 3 * sizeof(uint8_t));
-    cpu_vbo_.emplace_back(position);
-    cpu_cbo_.emplace_back(rgb);
-  }
-
-  for (int i = 0; i < nFace; ++i) {
-    uint8_t nIndices;
-    vec3ui indices;
-    int32_t materialId;
-    int32_t segmentId;
-    int32_t categoryId;
-
-    ifs.read(reinterpret_cast<char*>(&nIndices), sizeof(nIndices));
-    ASSERT(nIndices == 3);
-    ifs.read(reinterpret_cast<char*>(indices.data()), 3 * sizeof(int));
-    ifs.read(reinterpret_cast<char*>(&materialId), sizeof(materialId));
-    ifs.read(reinterpret_cast<char*>(&segmentId), sizeof(segmentId));
-    ifs.read(reinterpret_cast<char*>(&categoryId), sizeof(categoryId));
-    cpu_ibo_.emplace_back(indices);
-    materialIds_.emplace_back(materialId);
-    segmentIds_.emplace_back(segmentId);
-    categoryIds_.emplace_back(categoryId);
+
+  cpu_cbo_.resize(nVertex);
+  cpu_vbo_.resize(nVertex);
+  const char* record = file.data() + dataOffset;
+  for (int i = 0; i < nVertex; ++i, record += vertices.stride) {
+    cpu_vbo_[i] = vec3f(readPly<float>(record, x), readPly<float>(record, y),
+                        readPly<float>(record, z));
+    cpu_cbo_[i] = vec3uc(readPly<uint8_t>(record, red),
+                         readPly<uint8_t>(record, green),
+                         readPly<uint8_t>(record, blue));
+  }
+
+  cpu_ibo_.resize(nFace);
+  materialIds_.resize(nFace);
+  segmentIds_.resize(nFace);
+  categoryIds_.resize(nFace);
+  for (int i = 0; i < nFace; ++i, record += faces.stride) {
+    if (static_cast<uint8_t>(record[0]) != 3) {
+      LOG(ERROR) << "Face " << i << " of " << plyFile << " is not a triangle";
+      return false;
+    }
+    std::memcpy(cpu_ibo_[i].data(), record + 1, 3 * sizeof(uint32_t));
+    materialIds_[i] = readPly<int32_t>(record, materialId);
+    segmentIds_[i] = readPly<int32_t>(record, segmentId);
+    categoryIds_[i] = readPly<int32_t>(record, categoryId);
   }
 
   // Construct vertices for meshData
@@ -138,43 +241,57 @@ bool Mp3dInstanceMeshData::saveSemMeshPLY(
   const int nVertex = cpu_vbo_.size();
   const int nFace = cpu_ibo_.size();
 
-  std::ofstream f(plyFile, std::ios::out | std::ios::binary);
-  f << "ply" << std::endl;
-  f << "format binary_little_endian 1.0" << std::endl;
-  f << "element vertex " << nVertex << std::endl;
-  f << "property float x" << std::endl;
-  f << "property float y" << std::endl;
-  f << "property float z" << std::endl;
-  f << "property uchar red" << std::endl;
-  f << "property uchar green" << std::endl;
-  f << "property uchar blue" << std::endl;
-  f << "element face " << nFace << std::endl;
-  f << "property list uchar int vertex_indices" << std::endl;
-  f << "property int object_id" << std::endl;
-  f << "end_header" << std::endl;
+  std::ostringstream header;
+  header << "ply\n"
+         << "format binary_little_endian 1.0\n"
+         << "element vertex " << nVertex << "\n"
+         << "property float x\n"
+         << "property float y\n"
+         << "property float z\n"
+         << "property uchar red\n"
+         << "property uchar green\n"
+         << "property uchar blue\n"
+         << "element face " << nFace << "\n"
+         << "property list uchar int vertex_indices\n"
+         << "property int object_id\n"
+         << "end_header\n";
 
+  // pack all records, to be written at once
+  constexpr size_t vertexSize = 3 * sizeof(float) + 3 * sizeof(uint8_t);
+  constexpr size_t faceSize =
+      sizeof(uint8_t) + 3 * sizeof(uint32_t) + sizeof(int32_t);
+  std::vector<char> records(size_t(nVertex) * vertexSize +
+                            size_t(nFace) * faceSize);
+  char* record = records.data();
   for (int iVertex = 0; iVertex < nVertex; ++iVertex) {
-    const vec3f& xyz = cpu_vbo_[iVertex].head<3>();
-    const vec3uc& rgb = cpu_cbo_[iVertex];
-    f.write(reinterpret_cast<const char*>(xyz.data()), 3 * sizeof(float));
-    f.write(reinterpret_cast<const char*>(rgb.data()), 3 * sizeof(uint8_t));
+    std::memcpy(record, cpu_vbo_[iVertex].data(), 3 * sizeof(float));
+    std::memcpy(record + 3 * sizeof(float), cpu_cbo_[iVertex].data(),
+                3 * sizeof(uint8_t));
+    record += vertexSize;
   }
-
-  for (int iFace = 0; iFace < cpu_ibo_.size(); ++iFace) {
-    const uint8_t nIndices = 3;
-    const vec3ui& indices = cpu_ibo_[iFace];
+  for (int iFace = 0; iFace < nFace; ++iFace) {
     // The materialId corresponds to the segmentId from the .house file
     const int32_t segmentId = materialIds_[iFace];
     int32_t objectId = ID_UNDEFINED;
     if (segmentId >= 0) {
       objectId = segmentIdToObjectIdMap.at(segmentId);
     }
-    f.write(reinterpret_cast<const char*>(&nIndices), sizeof(nIndices));
-    f.write(reinterpret_cast<const char*>(indices.data()),
-            3 * sizeof(uint32_t));
-    f.write(reinterpret_cast<const char*>(&objectId), sizeof(objectId));
+    record[0] = 3;
+    std::memcpy(record + 1, cpu_ibo_[iFace].data(), 3 * sizeof(uint32_t));
+    std::memcpy(record + 1 + 3 * sizeof(uint32_t), &objectId,
+                sizeof(objectId));
+    record += faceSize;
   }
+
+  std::ofstream f(plyFile, std::ios::out | std::ios::binary);
+  const std::string headerString = header.str();
+  f.write(headerString.data(), headerString.size());
+  f.write(records.data(), records.size());
   f.close();
+  if (!f) {
+    LOG(ERROR) << "Failed to write " << plyFile;
+    return false;
+  }
 
   return true;
 }
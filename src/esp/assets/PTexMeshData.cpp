@@ -4,6 +4,7 @@
 
 #include "PTexMeshData.h"
 
+#include <algorithm>
 #include <fstream>
 #include <sstream>
 #include <unordered_map>
@@ -14,16 +15,24 @@
 #include <Corrade/Containers/ArrayViewStl.h>
 #include <Corrade/Utility/Directory.h>
 #include <Magnum/GL/BufferTextureFormat.h>
+#include <Magnum/GL/TextureFormat.h>
 #include <Magnum/ImageView.h>
+#include <Magnum/Math/Functions.h>
 #include <Magnum/PixelFormat.h>
 
+#include "esp/core/ThreadPool.h"
 #include "esp/core/esp.h"
 #include "esp/gfx/PTexMeshShader.h"
+#include "esp/io/cache.h"
 #include "esp/io/io.h"
 #include "esp/io/json.h"
+#include "LoadTrace.h"
+#include "TextureCompression.h"
 
 static constexpr int ROTATION_SHIFT = 30;
 static constexpr int FACE_MASK = 0x3FFFFFFF;
+// bump whenever the layout of the cached submeshes changes
+static constexpr uint32_t CACHE_VERSION = 2;
 
 namespace Cr = Corrade;
 
@@ -43,7 +52,70 @@ void PTexMeshData::load(const std::string& meshFile,
   tileSize_ = json["tileSize"].GetInt();
   atlasFolder_ = atlasFolder;
 
-  loadMeshData(meshFile);
+  const std::string cacheFile = io::cacheFilename(meshFile);
+  io::CacheLock cacheLock(cacheFile);
+  if (!loadCache(meshFile, cacheFile)) {
+    loadMeshData(meshFile);
+    if (!io::getSharedCacheDir().empty()) {
+      saveCache(meshFile, cacheFile);
+    }
+  }
+}
+
+bool PTexMeshData::saveCache(const std::string& meshFile,
+                             const std::string& cacheFile) const {
+  // the split size the submeshes were made with comes first, then the
+  // vbo, nbo, cbo, ibo and face adjacency of each submesh
+  const std::vector<std::vector<uint32_t>> adjFaces =
+      adjFaces_.size() == submeshes_.size() ? adjFaces_
+                                            : calculateAdjacency(submeshes_);
+  io::CacheWriter writer(SupportedMeshType::PTEX_MESH, CACHE_VERSION,
+                         meshFile);
+  writer.addSection(&splitSize_, sizeof(splitSize_));
+  for (size_t i = 0; i < submeshes_.size(); ++i) {
+    writer.addSection(submeshes_[i].vbo);
+    writer.addSection(submeshes_[i].nbo);
+    writer.addSection(submeshes_[i].cbo);
+    writer.addSection(submeshes_[i].ibo);
+    writer.addSection(adjFaces[i]);
+  }
+  if (!writer.write(cacheFile)) {
+    LOG(ERROR) << "Cannot write cache file " << cacheFile;
+    return false;
+  }
+  return true;
+}
+
+bool PTexMeshData::loadCache(const std::string& meshFile,
+                             const std::string& cacheFile) {
+  const io::CacheReader reader(cacheFile, SupportedMeshType::PTEX_MESH,
+                               CACHE_VERSION, meshFile);
+  if (!reader.isValid() || reader.getNumSections() % 5 != 1) {
+    return false;
+  }
+  std::vector<float> splitSize;
+  if (!reader.readSection(0, splitSize) || splitSize.size() != 1 ||
+      splitSize[0] != splitSize_) {
+    return false;
+  }
+
+  std::vector<MeshData> submeshes(reader.getNumSections() / 5);
+  std::vector<std::vector<uint32_t>> adjFaces(submeshes.size());
+  for (size_t i = 0; i < submeshes.size(); ++i) {
+    MeshData& submesh = submeshes[i];
+    if (!reader.readSection(5 * i + 1, submesh.vbo) ||
+        !reader.readSection(5 * i + 2, submesh.nbo) ||
+        !reader.readSection(5 * i + 3, submesh.cbo) ||
+        !reader.readSection(5 * i + 4, submesh.ibo) ||
+        !reader.readSection(5 * i + 5, adjFaces[i]) ||
+        adjFaces[i].size() != submesh.ibo.size()) {
+      LOG(ERROR) << "Corrupt cache file " << cacheFile;
+      return false;
+    }
+  }
+  submeshes_ = std::move(submeshes);
+  adjFaces_ = std::move(adjFaces);
+  return true;
 }
 
 float PTexMeshData::exposure() const {
@@ -88,13 +160,18 @@ std::vector<PTexMeshData::MeshData> splitMesh(
     boundingBox.extend(mesh.vbo[i].head<3>());
   }
 
-// calculate vertex grid position and code
-#pragma omp parallel for
-  for (size_t i = 0; i < mesh.vbo.size(); i++) {
-    const vec3f p = mesh.vbo[i].head<3>();
-    vec3f pi = (p - boundingBox.min()) / splitSize;
-    verts[i] = EncodeMorton3(pi.cast<int>());
-  }
+  // vertices and faces handed out to a thread at a time
+  const size_t grainSize = 1 << 14;
+
+  // calculate vertex grid position and code
+  core::parallelForRange(
+      mesh.vbo.size(), grainSize, 0, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+          const vec3f p = mesh.vbo[i].head<3>();
+          vec3f pi = (p - boundingBox.min()) / splitSize;
+          verts[i] = EncodeMorton3(pi.cast<int>());
+        }
+      });
 
   // data structure for sorting faces
   struct SortFace {
@@ -108,17 +185,19 @@ std::vector<PTexMeshData::MeshData> splitMesh(
   std::vector<SortFace> faces;
   faces.resize(numFaces);
 
-#pragma omp parallel for
-  for (size_t i = 0; i < numFaces; i++) {
-    faces[i].originalFace = i;
-    faces[i].code = std::numeric_limits<uint32_t>::max();
-    for (int j = 0; j < 4; j++) {
-      faces[i].index[j] = mesh.ibo[i * 4 + j];
+  core::parallelForRange(
+      numFaces, grainSize, 0, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+          faces[i].originalFace = i;
+          faces[i].code = std::numeric_limits<uint32_t>::max();
+          for (int j = 0; j < 4; j++) {
+            faces[i].index[j] = mesh.ibo[i * 4 + j];
 
-      // face code is minimum of referenced vertices codes
-      faces[i].code = std::min(faces[i].code, verts[faces[i].index[j]]);
-    }
-  }
+            // face code is minimum of referenced vertices codes
+            faces[i].code = std::min(faces[i].code, verts[faces[i].index[j]]);
+          }
+        }
+      });
 
   // sort faces by code
   std::sort(faces.begin(), faces.end(),
@@ -154,8 +233,7 @@ std::vector<PTexMeshData::MeshData> splitMesh(
     subMeshes.emplace_back();
   }
 
-#pragma omp parallel for
-  for (size_t i = 0; i < numChunks; i++) {
+  core::parallelFor(numChunks, 0, [&](size_t i) {
     uint32_t chunkSize = chunkStart[i + 1] - chunkStart[i];
 
     std::vector<uint32_t> refdVerts;
@@ -191,95 +269,84 @@ std::vector<PTexMeshData::MeshData> splitMesh(
       subMeshes[i].vbo[j] = mesh.vbo[index];
       subMeshes[i].nbo[j] = mesh.nbo[index];
     }
-  }
+  });
 
   return subMeshes;
 }
 
 void PTexMeshData::calculateAdjacency(const PTexMeshData::MeshData& mesh,
                                       std::vector<uint32_t>& adjFaces) {
-  struct EdgeData {
-    int face;
-    int edge;
+  // every edge of every face, sorted so that the edges shared by faces are
+  // next to each other; the index keeps the faces of an edge in order
+  struct Edge {
+    uint64_t key;
+    uint32_t index;  // face * 4 + edge
+    bool operator<(const Edge& other) const {
+      return key < other.key || (key == other.key && index < other.index);
+    }
   };
 
-  std::unordered_map<uint64_t, std::vector<EdgeData>> edgeMap;
-
-  size_t numFaces = mesh.ibo.size() / 4;
-
-  typedef std::unordered_map<uint64_t, std::vector<EdgeData>>::iterator
-      EdgeIter;
-  std::vector<EdgeIter> edgeIterators(numFaces * 4);
-
-  // for each face
-  for (int f = 0; f < numFaces; f++) {
-    // for each edge
+  const size_t numFaces = mesh.ibo.size() / 4;
+  std::vector<Edge> edges(numFaces * 4);
+  for (size_t f = 0; f < numFaces; f++) {
     for (int e = 0; e < 4; e++) {
-      // add to edge to face map
-      const int e_index = f * 4 + e;
-      const uint32_t i0 = mesh.ibo[e_index];
+      const uint32_t i0 = mesh.ibo[f * 4 + e];
       const uint32_t i1 = mesh.ibo[f * 4 + ((e + 1) % 4)];
-      const uint64_t key =
-          (uint64_t)std::min(i0, i1) << 32 | (uint32_t)std::max(i0, i1);
-
-      const EdgeData edgeData{f, e};
-
-      auto it = edgeMap.find(key);
-
-      if (it == edgeMap.end()) {
-        it = edgeMap.emplace(key, std::vector<EdgeData>()).first;
-        it->second.reserve(4);
-        it->second.push_back(edgeData);
-      } else {
-        it->second.push_back(edgeData);
-      }
-
-      edgeIterators[e_index] = it;
+      edges[f * 4 + e] = {
+          (uint64_t)std::min(i0, i1) << 32 | (uint32_t)std::max(i0, i1),
+          uint32_t(f * 4 + e)};
     }
   }
+  std::sort(edges.begin(), edges.end());
 
   adjFaces.resize(numFaces * 4);
+  for (size_t begin = 0, end = 0; begin < edges.size(); begin = end) {
+    while (end < edges.size() && edges[end].key == edges[begin].key) {
+      ++end;
+    }
+    for (size_t i = begin; i < end; ++i) {
+      const int f = edges[i].index / 4;
+      const int e = edges[i].index % 4;
 
-  for (int f = 0; f < numFaces; f++) {
-    for (int e = 0; e < 4; e++) {
-      const int e_index = f * 4 + e;
-      auto it = edgeIterators[e_index];
-      const std::vector<EdgeData>& adj = it->second;
-
-      // find adjacent face
+      // find adjacent face, the last other one if the edge is not manifold
       int adjFace = -1;
-      for (size_t i = 0; i < adj.size(); i++) {
-        if (adj[i].face != (int)f)
-          adjFace = adj[i].face;
+      for (size_t j = begin; j < end; ++j) {
+        if (int(edges[j].index / 4) != f) {
+          adjFace = edges[j].index / 4;
+        }
       }
 
       // find number of 90 degree rotation steps between faces
       int rot = 0;
-      if (adj.size() == 2) {
-        int edge0 = 0, edge1 = 0;
-        if (adj[0].edge == e) {
-          edge0 = adj[0].edge;
-          edge1 = adj[1].edge;
-        } else if (adj[1].edge == e) {
-          edge0 = adj[1].edge;
-          edge1 = adj[0].edge;
-        }
-
-        rot = (edge0 - edge1 + 2) & 3;
+      if (end - begin == 2) {
+        const int otherEdge = edges[i == begin ? begin + 1 : begin].index % 4;
+        rot = (e - otherEdge + 2) & 3;
       }
 
       // pack adjacent face and rotation into 32-bit int
-      adjFaces[f * 4 + e] = (rot << ROTATION_SHIFT) | (adjFace & FACE_MASK);
+      adjFaces[edges[i].index] =
+          (rot << ROTATION_SHIFT) | (adjFace & FACE_MASK);
     }
   }
 }
 
+std::vector<std::vector<uint32_t>> PTexMeshData::calculateAdjacency(
+    const std::vector<MeshData>& submeshes) {
+  std::vector<std::vector<uint32_t>> adjFaces(submeshes.size());
+  core::parallelFor(submeshes.size(), 0, [&](size_t iMesh) {
+    calculateAdjacency(submeshes[iMesh], adjFaces[iMesh]);
+  });
+  return adjFaces;
+}
+
 void PTexMeshData::loadMeshData(const std::string& meshFile) {
   PTexMeshData::MeshData originalMesh;
   parsePLY(meshFile, originalMesh);
 
   submeshes_.clear();
+  adjFaces_.clear();
   if (splitSize_ > 0.0f) {
+    LoadStageTimer stageTimer(LoadStage::Process);
     LOG(INFO) << "Splitting mesh... ";
     submeshes_ = splitMesh(originalMesh, splitSize_);
     LOG(INFO) << "done" << std::endl;
@@ -571,6 +638,7 @@ void PTexMeshData::uploadBuffersToGPU(bool forceReload) {
     return;
   }
 
+  gpuMemoryBytes_ = 0;
   for (int iMesh = 0; iMesh < submeshes_.size(); ++iMesh) {
     LOG(INFO) << "\rLoading mesh " << iMesh + 1 << "/" << submeshes_.size()
               << "... ";
@@ -583,16 +651,17 @@ void PTexMeshData::uploadBuffersToGPU(bool forceReload) {
                              Magnum::GL::BufferUsage::StaticDraw);
     currentMesh->ibo.setData(submeshes_[iMesh].ibo,
                              Magnum::GL::BufferUsage::StaticDraw);
+    gpuMemoryBytes_ +=
+        submeshes_[iMesh].vbo.size() * sizeof(submeshes_[iMesh].vbo[0]) +
+        submeshes_[iMesh].ibo.size() * sizeof(submeshes_[iMesh].ibo[0]);
   }
   LOG(INFO) << "... done" << std::endl;
 
-  LOG(INFO) << "Calculating mesh adjacency... ";
-
-  std::vector<std::vector<uint32_t>> adjFaces(submeshes_.size());
-
-#pragma omp parallel for
-  for (int iMesh = 0; iMesh < submeshes_.size(); ++iMesh) {
-    calculateAdjacency(submeshes_[iMesh], adjFaces[iMesh]);
+  // the binary cache of the mesh comes with the adjacency
+  if (adjFaces_.size() != submeshes_.size()) {
+    LoadStageTimer stageTimer(LoadStage::Process);
+    LOG(INFO) << "Calculating mesh adjacency... ";
+    adjFaces_ = calculateAdjacency(submeshes_);
   }
 
   for (int iMesh = 0; iMesh < submeshes_.size(); ++iMesh) {
@@ -600,8 +669,9 @@ void PTexMeshData::uploadBuffersToGPU(bool forceReload) {
 
     currentMesh->adjTex.setBuffer(Magnum::GL::BufferTextureFormat::R32UI,
                                   currentMesh->abo);
-    currentMesh->abo.setData(adjFaces[iMesh],
+    currentMesh->abo.setData(adjFaces_[iMesh],
                              Magnum::GL::BufferUsage::StaticDraw);
+    gpuMemoryBytes_ += adjFaces_[iMesh].size() * sizeof(adjFaces_[iMesh][0]);
     currentMesh->mesh.setPrimitive(Magnum::GL::MeshPrimitive::LinesAdjacency)
         .setCount(currentMesh->ibo.size() / 2)
         .addVertexBuffer(currentMesh->vbo, 0, gfx::PTexMeshShader::Position{})
@@ -609,30 +679,74 @@ void PTexMeshData::uploadBuffersToGPU(bool forceReload) {
                         Magnum::GL::MeshIndexType::UnsignedInt);
   }
 
-  for (size_t iMesh = 0; iMesh < renderingBuffers_.size(); ++iMesh) {
-    const std::string rgbFile =
-        atlasFolder_ + "/" + std::to_string(iMesh) + "-color-ptex.rgb";
-    if (!io::exists(rgbFile)) {
-      ASSERT(false, "Can't find " + rgbFile);
+  if (!atlasStreaming_) {
+    for (size_t iMesh = 0; iMesh < renderingBuffers_.size(); ++iMesh) {
+      LOG(INFO) << "\rLoading atlas " << iMesh + 1 << "/"
+                << renderingBuffers_.size() << "... ";
+      LOG(INFO).flush();
+      uploadAtlas(iMesh);
     }
-    LOG(INFO) << "\rLoading atlas " << iMesh + 1 << "/"
-              << renderingBuffers_.size() << "... ";
-    LOG(INFO).flush();
+    LOG(INFO) << "... done" << std::endl;
+  }
 
+  buffersOnGPU_ = true;
+}
+
+void PTexMeshData::uploadAtlas(int submeshID) {
+  RenderingBuffer& buffer = *getRenderingBuffer(submeshID);
+  if (buffer.atlasLoaded) {
+    return;
+  }
+  const std::string rgbFile =
+      atlasFolder_ + "/" + std::to_string(submeshID) + "-color-ptex.rgb";
+  if (!io::exists(rgbFile)) {
+    ASSERT(false, "Can't find " + rgbFile);
+  }
+  buffer.tex.setWrapping(Magnum::GL::SamplerWrapping::ClampToEdge)
+      .setMagnificationFilter(Magnum::GL::SamplerFilter::Linear)
+      .setMinificationFilter(Magnum::GL::SamplerFilter::Linear);
+
+  std::vector<uint8_t> blocks;
+  int width = 0;
+  int height = 0;
+  if (loadCompressedAtlas(compressedAtlasFilename(rgbFile), rgbFile, blocks,
+                          width, height)) {
+    Magnum::CompressedImageView2D image(
+        Magnum::CompressedPixelFormat::Bc1RGBUnorm, {width, height},
+        Cr::Containers::arrayView(blocks));
+    buffer.tex
+        .setStorage(1, Magnum::GL::TextureFormat::CompressedRGBS3tcDxt1,
+                    image.size())
+        .setCompressedSubImage(0, {}, image);
+    gpuMemoryBytes_ += blocks.size();
+  } else {
     Cr::Containers::Array<const char, Cr::Utility::Directory::MapDeleter> data =
         Cr::Utility::Directory::mapRead(rgbFile);
     const int dim = static_cast<int>(std::sqrt(data.size() / 3));  // square
     Magnum::ImageView2D image(Magnum::PixelFormat::RGB8UI, {dim, dim}, data);
-    renderingBuffers_[iMesh]
-        ->tex.setWrapping(Magnum::GL::SamplerWrapping::ClampToEdge)
-        .setMagnificationFilter(Magnum::GL::SamplerFilter::Linear)
-        .setMinificationFilter(Magnum::GL::SamplerFilter::Linear)
+    buffer.tex
         // .setStorage(1, GL::TextureFormat::RGB8UI, image.size())
         .setSubImage(0, {}, image);
+    // RGB texels are padded to 4 bytes by most drivers
+    gpuMemoryBytes_ += 4 * data.size() / 3;
   }
-  LOG(INFO) << "... done" << std::endl;
+  buffer.atlasLoaded = true;
+}
 
-  buffersOnGPU_ = true;
+Magnum::Range3D PTexMeshData::getBoundingBox(int submeshID) const {
+  ASSERT(submeshID >= 0 && submeshID < submeshes_.size());
+  const std::vector<vec4f>& vbo = submeshes_[submeshID].vbo;
+  if (vbo.empty()) {
+    return {};
+  }
+  Magnum::Vector3 min{vbo[0][0], vbo[0][1], vbo[0][2]};
+  Magnum::Vector3 max = min;
+  for (const vec4f& v : vbo) {
+    const Magnum::Vector3 position{v[0], v[1], v[2]};
+    min = Magnum::Math::min(min, position);
+    max = Magnum::Math::max(max, position);
+  }
+  return {min, max};
 }
 
 PTexMeshData::RenderingBuffer* PTexMeshData::getRenderingBuffer(int submeshID) {
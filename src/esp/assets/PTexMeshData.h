@@ -12,6 +12,7 @@
 #include <Magnum/GL/BufferTexture.h>
 #include <Magnum/GL/Mesh.h>
 #include <Magnum/GL/Texture.h>
+#include <Magnum/Math/Range.h>
 
 #include "BaseMesh.h"
 #include "esp/core/esp.h"
@@ -35,32 +36,66 @@ class PTexMeshData : public BaseMesh {
     Magnum::GL::Buffer ibo;
     Magnum::GL::Buffer abo;
     Magnum::GL::BufferTexture adjTex;
+    // whether tex holds the atlas, see uploadAtlas()
+    bool atlasLoaded = false;
   };
 
   PTexMeshData() : BaseMesh(SupportedMeshType::PTEX_MESH) {}
   virtual ~PTexMeshData(){};
 
   // ==== geometry ====
+  // uses the binary cache of meshFile at io::cacheFilename() if it is up to
+  // date, instead of parsing and splitting the PLY. With a shared cache
+  // directory, the cache is stored there after parsing
   void load(const std::string& meshFile, const std::string& atlasFolder);
+
+  //! Save the loaded submeshes to a binary cache file for meshFile, see
+  //! io::cache.h
+  bool saveCache(const std::string& meshFile,
+                 const std::string& cacheFile) const;
+  //! Load the submeshes from a binary cache file written by saveCache();
+  //! returns false if there is none or it is out of date with meshFile or the
+  //! split size of the atlas
+  bool loadCache(const std::string& meshFile, const std::string& cacheFile);
   float exposure() const;
   void setExposure(const float& val);
   uint32_t tileSize() const { return tileSize_; }
 
   const std::vector<MeshData>& meshes() const;
   std::string atlasFolder() const;
-  void resize(size_t n) { submeshes_.resize(n); }
+  void resize(size_t n) {
+    submeshes_.resize(n);
+    adjFaces_.clear();
+  }
 
   int getSize() { return submeshes_.size(); }
 
   static void parsePLY(const std::string& filename, MeshData& meshData);
   static void calculateAdjacency(const MeshData& mesh,
                                  std::vector<uint32_t>& adjFaces);
+  //! Adjacency of all submeshes, computed in parallel
+  static std::vector<std::vector<uint32_t>> calculateAdjacency(
+      const std::vector<MeshData>& submeshes);
 
   // ==== rendering ====
   RenderingBuffer* getRenderingBuffer(int submeshID);
   virtual void uploadBuffersToGPU(bool forceReload = false) override;
   virtual Magnum::GL::Mesh* getMagnumGLMesh(int submeshID) override;
 
+  //! With atlas streaming, uploadBuffersToGPU() leaves out the atlas
+  //! textures and each is only uploaded by uploadAtlas() when its submesh is
+  //! first drawn, so atlases of submeshes never in view take no memory
+  void setAtlasStreaming(bool enabled) { atlasStreaming_ = enabled; }
+  bool isAtlasStreaming() const { return atlasStreaming_; }
+
+  //! Upload the atlas of a submesh unless it is already, from the BC1
+  //! compressed atlas made by datatool if there is one, see
+  //! TextureCompression.h
+  void uploadAtlas(int submeshID);
+
+  //! Bounding box of the vertices of a submesh
+  Magnum::Range3D getBoundingBox(int submeshID) const;
+
  protected:
   void loadMeshData(const std::string& meshFile);
 
@@ -69,6 +104,9 @@ class PTexMeshData : public BaseMesh {
   float exposure_ = 1.0f;
   std::string atlasFolder_;
   std::vector<MeshData> submeshes_;
+  // face adjacency per submesh, from the binary cache or computed on upload
+  std::vector<std::vector<uint32_t>> adjFaces_;
+  bool atlasStreaming_ = false;
 
   // ==== rendering ====
   // we will have to use smart pointer here since each item within the structure
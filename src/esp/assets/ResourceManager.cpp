@@ -2,7 +2,11 @@
 // This source code is licensed under the MIT license found in the
 // LICENSE file in the root directory of this source tree.
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <functional>
+#include <thread>
 
 #include <Corrade/Containers/ArrayViewStl.h>
 #include <Corrade/PluginManager/Manager.h>
@@ -10,6 +14,7 @@
 #include <Corrade/Utility/String.h>
 #include <Magnum/EigenIntegration/GeometryIntegration.h>
 #include <Magnum/EigenIntegration/Integration.h>
+#include <Magnum/GL/Context.h>
 #include <Magnum/ImageView.h>
 #include <Magnum/Math/FunctionsBatch.h>
 #include <Magnum/Math/Range.h>
@@ -23,10 +28,16 @@
 #include <Magnum/Trade/SceneData.h>
 #include <Magnum/Trade/TextureData.h>
 
+#include "esp/core/Metrics.h"
+#include "esp/core/ThreadPool.h"
+#include "esp/geo/ConvexDecomposition.h"
+#include "esp/geo/MeshSimplification.h"
 #include "esp/geo/geo.h"
 #include "esp/gfx/GenericDrawable.h"
 #include "esp/gfx/PrimitiveIDTexturedDrawable.h"
 #include "esp/gfx/PrimitiveIDTexturedShader.h"
+#include "esp/gfx/ShaderCache.h"
+#include "esp/io/cache.h"
 #include "esp/io/io.h"
 #include "esp/io/json.h"
 #include "esp/scene/SceneConfiguration.h"
@@ -36,9 +47,14 @@
 #include "FRLInstanceMeshData.h"
 #include "GenericInstanceMeshData.h"
 #include "GltfMeshData.h"
+#include "LoadTrace.h"
 #include "MeshData.h"
+#include "MeshUploader.h"
 #include "Mp3dInstanceMeshData.h"
 #include "ResourceManager.h"
+#include "StreamedTexture.h"
+#include "TextureAtlas.h"
+#include "TextureCompression.h"
 #include "esp/physics/PhysicsManager.h"
 
 #ifdef PHYSICS_WITH_BULLET
@@ -56,9 +72,98 @@ namespace Cr = Corrade;
 namespace esp {
 namespace assets {
 
-bool ResourceManager::loadScene(const AssetInfo& info,
+namespace {
+// scene assets are cached by their absolute path
+AssetInfo withAbsolutePath(const AssetInfo& info) {
+  AssetInfo absoluteInfo = info;
+  if (info.filepath.compare(EMPTY_SCENE) != 0) {
+    absoluteInfo.filepath = io::absolutePath(info.filepath);
+  }
+  return absoluteInfo;
+}
+
+#ifdef ESP_BUILD_PTEX_SUPPORT
+std::string ptexAtlasFolder(const std::string& filename) {
+  return Cr::Utility::String::stripSuffix(filename, "ptex_quad_mesh.ply") +
+         "ptex_textures";
+}
+#endif
+
+// binary glTF files are self-contained and can be opened from memory
+bool isBinaryGltf(const std::string& filename) {
+  return Cr::Utility::String::endsWith(filename, ".glb");
+}
+
+// decode the CPU-side mesh data of PTex and instance meshes, touches no GL
+// state so that it can run on a worker thread
+std::unique_ptr<BaseMesh> decodeSceneMesh(const AssetInfo& info) {
+  LoadStageTimer stageTimer(LoadStage::Read);
+  if (info.type == AssetType::FRL_INSTANCE_MESH ||
+      info.type == AssetType::INSTANCE_MESH) {
+    std::unique_ptr<GenericInstanceMeshData> instanceMeshData;
+    if (info.type == AssetType::FRL_INSTANCE_MESH) {
+      instanceMeshData = std::make_unique<FRLInstanceMeshData>();
+    } else {
+      instanceMeshData = std::make_unique<GenericInstanceMeshData>();
+    }
+    if (info.type == AssetType::FRL_INSTANCE_MESH) {
+      instanceMeshData->loadPLY(info.filepath);
+      return std::move(instanceMeshData);
+    }
+    // generic instance meshes prefer their binary cache, if up to date. With
+    // a shared cache directory the first process to parse a mesh stores its
+    // cache there, while the others wait for it
+    const std::string cacheFile = io::cacheFilename(info.filepath);
+    io::CacheLock cacheLock(cacheFile);
+    if (!instanceMeshData->loadCache(info.filepath, cacheFile)) {
+      instanceMeshData->loadPLY(info.filepath);
+      if (!io::getSharedCacheDir().empty()) {
+        instanceMeshData->saveCache(info.filepath, cacheFile);
+      }
+    }
+    return std::move(instanceMeshData);
+  }
+#ifdef ESP_BUILD_PTEX_SUPPORT
+  if (info.type == AssetType::FRL_PTEX_MESH) {
+    auto pTexMeshData = std::make_unique<PTexMeshData>();
+    pTexMeshData->load(info.filepath, ptexAtlasFolder(info.filepath));
+    return std::move(pTexMeshData);
+  }
+#endif
+  return nullptr;
+}
+
+// scene loads and the asset cache in the metrics of the process
+struct LoadMetrics {
+  core::Counter& loads;
+  core::Counter& cacheHits;
+  core::Counter& cacheMisses;
+  core::Counter& evictions;
+  core::Histogram& loadSeconds;
+};
+
+LoadMetrics& loadMetrics() {
+  core::MetricsRegistry& registry = core::MetricsRegistry::get();
+  static LoadMetrics metrics{
+      registry.counter("habitat_scene_loads_total", "Scenes loaded"),
+      registry.counter("habitat_asset_cache_hits_total",
+                       "Scene loads whose meshes were loaded already"),
+      registry.counter("habitat_asset_cache_misses_total",
+                       "Scene loads reading their meshes from disk"),
+      registry.counter("habitat_asset_cache_evictions_total",
+                       "Assets evicted from the asset cache"),
+      registry.histogram("habitat_scene_load_seconds",
+                         "Time of loading the meshes of a scene")};
+  return metrics;
+}
+}  // namespace
+
+bool ResourceManager::loadScene(const AssetInfo& sceneInfo,
                                 scene::SceneNode* parent, /* = nullptr */
                                 DrawableGroup* drawables /* = nullptr */) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  const AssetInfo info = withAbsolutePath(sceneInfo);
+  LoadTraceScope traceScope(loadTrace_, info.filepath);
   // scene mesh loading
   bool meshSuccess = true;
   if (info.filepath.compare(EMPTY_SCENE) != 0) {
@@ -66,6 +171,15 @@ bool ResourceManager::loadScene(const AssetInfo& info,
       LOG(ERROR) << "Cannot load from file " << info.filepath;
       meshSuccess = false;
     } else {
+      core::HistogramTimer loadTimer(loadMetrics().loadSeconds);
+      if (core::MetricsRegistry::get().isEnabled()) {
+        loadMetrics().loads.add();
+        if (resourceDict_.count(info.filepath) > 0) {
+          loadMetrics().cacheHits.add();
+        } else {
+          loadMetrics().cacheMisses.add();
+        }
+      }
       if (info.type == AssetType::FRL_INSTANCE_MESH ||
           info.type == AssetType::INSTANCE_MESH) {
         meshSuccess = loadInstanceMeshData(info, parent, drawables);
@@ -83,6 +197,9 @@ bool ResourceManager::loadScene(const AssetInfo& info,
       if (meshSuccess) {
         physicsSceneLibrary_[info.filepath].setString("renderMeshHandle",
                                                       info.filepath);
+        if (parent) {
+          acquireScene(info.filepath);
+        }
       }
     }
   } else {
@@ -104,6 +221,7 @@ bool ResourceManager::loadScene(
     scene::SceneNode* parent, /* = nullptr */
     DrawableGroup* drawables, /* = nullptr */
     std::string physicsFilename /* data/default.phys_scene_config.json */) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
   // In-memory representation of scene meta data
   PhysicsManagerAttributes physicsManagerAttributes =
       loadPhysicsConfig(physicsFilename);
@@ -120,11 +238,14 @@ bool ResourceManager::loadScene(
 //! (3) consume PhysicsSceneMetaData to initialize physics simulator
 //! (4) create scene collision mesh if possible
 bool ResourceManager::loadScene(
-    const AssetInfo& info,
+    const AssetInfo& sceneInfo,
     std::shared_ptr<physics::PhysicsManager>& _physicsManager,
     PhysicsManagerAttributes physicsManagerAttributes,
     scene::SceneNode* parent, /* = nullptr */
     DrawableGroup* drawables /* = nullptr */) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  const AssetInfo info = withAbsolutePath(sceneInfo);
+  LoadTraceScope traceScope(loadTrace_, info.filepath);
   // default scene mesh loading
   bool meshSuccess = loadScene(info, parent, drawables);
 
@@ -147,16 +268,15 @@ bool ResourceManager::loadScene(
   }
 
   // load objects from sceneMetaData list...
-  for (auto objPhysPropertiesFilename :
-       physicsManagerAttributes.getVecStrings("objectLibraryPaths")) {
-    LOG(INFO) << "loading object: " << objPhysPropertiesFilename;
-    int objID = loadObject(objPhysPropertiesFilename);
-  }
+  preloadObjectLibrary(
+      physicsManagerAttributes.getVecStrings("objectLibraryPaths"));
   LOG(INFO) << "loaded objects: "
             << std::to_string(physicsObjectLibrary_.size());
 
   // initialize the physics simulator
   _physicsManager->initPhysics(parent, physicsManagerAttributes);
+  _physicsManager->setNumWorldThreads(
+      physicsManagerAttributes.getInt("numWorldThreads"));
 
   if (!meshSuccess) {
     LOG(ERROR) << "Physics manager loaded. Scene mesh load failed, aborting "
@@ -164,6 +284,51 @@ bool ResourceManager::loadScene(
     return meshSuccess;
   }
 
+  return addPhysicsScene(info, physicsManagerAttributes, *_physicsManager);
+}
+
+bool ResourceManager::loadSceneIntoWorld(
+    const AssetInfo& sceneInfo,
+    physics::PhysicsManager& physicsManager,
+    int& worldID,
+    scene::SceneNode* parent, /* = nullptr */
+    DrawableGroup* drawables, /* = nullptr */
+    std::string physicsFilename /* data/default.phys_scene_config.json */) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  const AssetInfo info = withAbsolutePath(sceneInfo);
+  LoadTraceScope traceScope(loadTrace_, info.filepath);
+  worldID = ID_UNDEFINED;
+  if (!loadScene(info, parent, drawables)) {
+    return false;
+  }
+
+  auto attributes = physicsManagerLibrary_.find(physicsFilename);
+  if (attributes == physicsManagerLibrary_.end()) {
+    attributes =
+        physicsManagerLibrary_
+            .emplace(physicsFilename, loadPhysicsConfig(physicsFilename))
+            .first;
+    preloadObjectLibrary(
+        attributes->second.getVecStrings("objectLibraryPaths"));
+  }
+  worldID = physicsManager.addWorld(parent, attributes->second);
+  if (worldID == ID_UNDEFINED) {
+    return false;
+  }
+  if (!addPhysicsScene(info, attributes->second,
+                       physicsManager.getWorld(worldID))) {
+    physicsManager.removeWorld(worldID);
+    worldID = ID_UNDEFINED;
+    return false;
+  }
+  return true;
+}
+
+bool ResourceManager::addPhysicsScene(
+    const AssetInfo& info,
+    const PhysicsManagerAttributes& physicsManagerAttributes,
+    physics::PhysicsManager& world) {
+  LoadStageTimer stageTimer(LoadStage::Collision);
   // TODO: enable loading of multiple scenes from file and storing individual
   // parameters instead of scene properties in manager global config
   physicsSceneLibrary_[info.filepath].setDouble(
@@ -220,21 +385,82 @@ bool ResourceManager::loadScene(
       }
     }
 
+    //! Use the simplified collision meshes of the scene instead of its render
+    //! meshes (datatool create_collision_mesh), if there are some for it
+    if (info.type == AssetType::MP3D_MESH &&
+        loadSceneCollisionMeshes(info, end - start + 1)) {
+      meshGroup.clear();
+      for (CollisionHull& collisionMesh : sceneCollisionMeshes_.at(filename)) {
+        if (collisionMesh.indices.empty()) {
+          continue;
+        }
+        CollisionMeshData meshData;
+        meshData.primitive = Magnum::MeshPrimitive::Triangles;
+        meshData.positions = {collisionMesh.positions.data(),
+                              collisionMesh.positions.size()};
+        meshData.indices = {collisionMesh.indices.data(),
+                            collisionMesh.indices.size()};
+        meshGroup.push_back(meshData);
+      }
+    }
+
     //! Initialize collision mesh
-    bool sceneSuccess = _physicsManager->addScene(
+    bool sceneSuccess = world.addScene(
         info, physicsSceneLibrary_.at(info.filepath), meshGroup);
     if (!sceneSuccess) {
       return false;
     }
   }
 
-  return meshSuccess;
+  return true;
+}
+
+bool ResourceManager::loadSceneCollisionMeshes(const AssetInfo& info,
+                                               int numMeshes) {
+  const std::string& filename = info.filepath;
+  if (sceneCollisionMeshes_.count(filename) > 0) {
+    return true;
+  }
+  const std::string collisionFile = geo::collisionMeshesFilename(filename);
+  if (!io::exists(collisionFile)) {
+    return false;
+  }
+  std::vector<geo::CollisionMesh> collisionMeshes;
+  if (!geo::loadCollisionMeshes(collisionFile, filename, collisionMeshes) ||
+      collisionMeshes.size() != numMeshes) {
+    LOG(WARNING) << "Ignoring collision meshes " << collisionFile
+                 << ", they were made from another scene";
+    return false;
+  }
+  // rotated once into the frame of the scene, like the render meshes are
+  quatf quatFront = quatf::FromTwoVectors(info.frame.front(), geo::ESP_FRONT);
+  Magnum::Quaternion quat = Magnum::Quaternion(quatFront);
+  Magnum::Matrix4 transform =
+      Magnum::Matrix4::rotation(quat.angle(), quat.axis().normalized());
+  std::vector<CollisionHull>& sceneCollisionMeshes =
+      sceneCollisionMeshes_[filename];
+  for (const geo::CollisionMesh& collisionMesh : collisionMeshes) {
+    sceneCollisionMeshes.emplace_back();
+    CollisionHull& sceneCollisionMesh = sceneCollisionMeshes.back();
+    for (const vec3f& position : collisionMesh.positions) {
+      sceneCollisionMesh.positions.push_back(
+          transform.transformPoint(Magnum::Vector3(position)));
+    }
+    sceneCollisionMesh.indices.assign(collisionMesh.indices.begin(),
+                                      collisionMesh.indices.end());
+  }
+  return true;
 }
 
 PhysicsManagerAttributes ResourceManager::loadPhysicsConfig(
     std::string physicsFilename) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
   // Load the global scene config JSON here
-  io::JsonDocument scenePhysicsConfig = io::parseJsonFile(physicsFilename);
+  io::JsonDocument scenePhysicsConfig = io::parseJsonFile(
+      physicsFilename,
+      {"physics simulator", "timestep", "num threads", "num world threads",
+       "friction coefficient", "restitution coefficient", "gravity",
+       "rigid object paths"});
   // In-memory representation of scene meta data
   PhysicsManagerAttributes physicsManagerAttributes;
 
@@ -255,6 +481,26 @@ PhysicsManagerAttributes ResourceManager::loadPhysicsConfig(
     }
   }
 
+  // load the number of threads the physics world is stepped on
+  if (scenePhysicsConfig.HasMember("num threads")) {
+    if (scenePhysicsConfig["num threads"].IsInt()) {
+      physicsManagerAttributes.setInt(
+          "numThreads", scenePhysicsConfig["num threads"].GetInt());
+    } else {
+      LOG(ERROR) << " Invalid value in scene config - num threads";
+    }
+  }
+
+  // load the number of threads the worlds of a manager are stepped on
+  if (scenePhysicsConfig.HasMember("num world threads")) {
+    if (scenePhysicsConfig["num world threads"].IsInt()) {
+      physicsManagerAttributes.setInt(
+          "numWorldThreads", scenePhysicsConfig["num world threads"].GetInt());
+    } else {
+      LOG(ERROR) << " Invalid value in scene config - num world threads";
+    }
+  }
+
   if (scenePhysicsConfig.HasMember("friction coefficient") &&
       scenePhysicsConfig["friction coefficient"].IsNumber()) {
     physicsManagerAttributes.setDouble(
@@ -327,6 +573,7 @@ PhysicsManagerAttributes ResourceManager::loadPhysicsConfig(
 int ResourceManager::loadObject(const std::string& objPhysConfigFilename,
                                 scene::SceneNode* parent,
                                 DrawableGroup* drawables) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
   // Load Object from config
   const bool objectIsLoaded =
       physicsObjectLibrary_.count(objPhysConfigFilename) > 0;
@@ -344,7 +591,7 @@ int ResourceManager::loadObject(const std::string& objPhysConfigFilename,
     objectID = std::distance(physicsObjectConfigList_.begin(), itr);
   }
 
-  if (parent != nullptr and drawables != nullptr) {
+  if (gpuEnabled_ && parent != nullptr && drawables != nullptr) {
     //! Add mesh to rendering stack
 
     // Meta data and collision mesh
@@ -356,17 +603,12 @@ int ResourceManager::loadObject(const std::string& objPhysConfigFilename,
     const std::string& filename =
         physicsObjectAttributes.getString("renderMeshHandle");
 
+    uploadCpuOnlyAsset(filename);
     MeshMetaData meshMetaData = resourceDict_[filename];
     scene::SceneNode& newNode = parent->createChild();
-    AssetInfo renderMeshinfo = AssetInfo::fromPath(filename);
-    Magnum::PluginManager::Manager<Importer> manager;
-    std::unique_ptr<Importer> importer =
-        manager.loadAndInstantiate("AnySceneImporter");
-    manager.setPreferredPlugins("GltfImporter", {"TinyGltfImporter"});
-    manager.setPreferredPlugins("ObjImporter", {"AssimpImporter"});
-    for (auto componentID : magnumMeshDict_[filename]) {
-      addComponent(*importer, renderMeshinfo, meshMetaData, newNode, drawables,
-                   componentID);
+    const MeshHierarchy& hierarchy = magnumMeshDict_[filename];
+    for (int component : hierarchy.roots) {
+      addComponent(hierarchy, component, meshMetaData, newNode, drawables);
     }
   }
 
@@ -375,11 +617,13 @@ int ResourceManager::loadObject(const std::string& objPhysConfigFilename,
 
 PhysicsObjectAttributes& ResourceManager::getPhysicsObjectAttributes(
     const std::string& objectName) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
   return physicsObjectLibrary_[objectName];
 }
 
 // load object from config filename
 int ResourceManager::loadObject(const std::string& objPhysConfigFilename) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
   // check for duplicate load
   const bool objExists = physicsObjectLibrary_.count(objPhysConfigFilename) > 0;
   if (objExists) {
@@ -394,20 +638,32 @@ int ResourceManager::loadObject(const std::string& objPhysConfigFilename) {
 
   // 1. parse the config file
   io::JsonDocument objPhysicsConfig;
-  if (io::exists(objPhysConfigFilename)) {
-    try {
-      objPhysicsConfig = io::parseJsonFile(objPhysConfigFilename);
-    } catch (...) {
-      LOG(ERROR) << "Failed to parse JSON: " << objPhysConfigFilename
-                 << ". Aborting loadObject.";
-      return ID_UNDEFINED;
-    }
-  } else {
+  if (!parseObjectConfig(objPhysConfigFilename, objPhysicsConfig)) {
+    return ID_UNDEFINED;
+  }
+  return loadObject(objPhysConfigFilename, objPhysicsConfig);
+}
+
+bool ResourceManager::parseObjectConfig(
+    const std::string& objPhysConfigFilename,
+    io::JsonDocument& objPhysicsConfig) {
+  if (!io::exists(objPhysConfigFilename)) {
     LOG(ERROR) << "File " << objPhysConfigFilename
                << " does not exist. Aborting loadObject.";
-    return ID_UNDEFINED;
+    return false;
   }
+  try {
+    objPhysicsConfig = io::parseJsonFile(objPhysConfigFilename);
+  } catch (...) {
+    LOG(ERROR) << "Failed to parse JSON: " << objPhysConfigFilename
+               << ". Aborting loadObject.";
+    return false;
+  }
+  return true;
+}
 
+int ResourceManager::loadObject(const std::string& objPhysConfigFilename,
+                                const io::JsonDocument& objPhysicsConfig) {
   // 2. construct a physicsObjectMetaData
   PhysicsObjectAttributes physicsObjectAttributes;
 
@@ -600,6 +856,44 @@ int ResourceManager::loadObject(const std::string& objPhysConfigFilename) {
     CollisionMeshData& meshData = gltfMeshData->getCollisionMeshData();
     meshGroup.push_back(meshData);
   }
+  //! Use the convex decomposition of the collision mesh instead of its
+  //! components (datatool create_collision_hulls), if there is one for it
+  const std::string hullsFile =
+      geo::convexHullsFilename(objPhysConfigFilename);
+  if (io::exists(hullsFile)) {
+    const std::string& collisionMeshHandle =
+        physicsObjectAttributes.getString("collisionMeshHandle");
+    std::vector<geo::ConvexHull> hulls;
+    if (geo::loadConvexHulls(hullsFile, collisionMeshHandle, hulls)) {
+      // the hulls are in the frame of the mesh file, move them along with
+      // the mesh origin
+      const Magnum::Matrix4& meshTransform = meshes_[start]->meshTransform_;
+      std::vector<CollisionHull>& collisionHulls =
+          collisionHulls_[objPhysConfigFilename];
+      meshGroup.clear();
+      for (const geo::ConvexHull& hull : hulls) {
+        collisionHulls.emplace_back();
+        CollisionHull& collisionHull = collisionHulls.back();
+        for (const vec3f& vertex : hull.vertices) {
+          collisionHull.positions.push_back(
+              meshTransform.transformPoint(Magnum::Vector3(vertex)));
+        }
+        collisionHull.indices.assign(hull.indices.begin(), hull.indices.end());
+      }
+      for (CollisionHull& collisionHull : collisionHulls) {
+        CollisionMeshData meshData;
+        meshData.primitive = Magnum::MeshPrimitive::Triangles;
+        meshData.positions = {collisionHull.positions.data(),
+                              collisionHull.positions.size()};
+        meshData.indices = {collisionHull.indices.data(),
+                            collisionHull.indices.size()};
+        meshGroup.push_back(meshData);
+      }
+    } else {
+      LOG(WARNING) << "Ignoring collision hulls " << hullsFile
+                   << ", they were made from another collision mesh";
+    }
+  }
   //! Properly align axis direction
   // NOTE: this breaks the collision properties of some files
   collisionMeshGroups_.emplace(objPhysConfigFilename, meshGroup);
@@ -609,18 +903,425 @@ int ResourceManager::loadObject(const std::string& objPhysConfigFilename) {
   return objectID;
 }
 
+std::vector<int> ResourceManager::preloadObjectLibrary(
+    const std::vector<std::string>& objPhysConfigFilenames,
+    int numThreads /* = 0 */) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  // 1. parse the configs of the objects not loaded yet in parallel
+  std::vector<io::JsonDocument> configs(objPhysConfigFilenames.size());
+  std::vector<char> parsed(objPhysConfigFilenames.size(), false);
+  std::vector<size_t> toParse;
+  for (size_t i = 0; i < objPhysConfigFilenames.size(); ++i) {
+    if (physicsObjectLibrary_.count(objPhysConfigFilenames[i]) == 0) {
+      toParse.push_back(i);
+    }
+  }
+  geo::parallelFor(toParse.size(), numThreads, [&](size_t j) {
+    const size_t i = toParse[j];
+    parsed[i] = parseObjectConfig(objPhysConfigFilenames[i], configs[i]);
+  });
+
+  // 2. read their mesh files on worker threads while the meshes are imported
+  // and uploaded here, in order, as loadObject() would
+  std::vector<std::string> meshFiles;
+  for (size_t i : toParse) {
+    if (!parsed[i]) {
+      continue;
+    }
+    const std::string& filename = objPhysConfigFilenames[i];
+    const std::string directory =
+        filename.substr(0, filename.find_last_of("/"));
+    for (const char* key : {"render mesh", "collision mesh"}) {
+      if (configs[i].HasMember(key) && configs[i][key].IsString()) {
+        meshFiles.push_back(directory + "/" + configs[i][key].GetString());
+      }
+    }
+  }
+  std::vector<std::thread> readers = prefetchFiles(meshFiles, numThreads);
+
+  std::vector<int> objectIDs;
+  for (size_t i = 0; i < objPhysConfigFilenames.size(); ++i) {
+    const std::string& filename = objPhysConfigFilenames[i];
+    LOG(INFO) << "loading object: " << filename;
+    if (physicsObjectLibrary_.count(filename) > 0) {
+      // loaded before, or listed twice
+      objectIDs.push_back(loadObject(filename));
+    } else if (parsed[i]) {
+      objectIDs.push_back(loadObject(filename, configs[i]));
+    } else {
+      objectIDs.push_back(ID_UNDEFINED);
+    }
+  }
+
+  for (std::thread& thread : readers) {
+    thread.join();
+  }
+  // drop reads of meshes that failed to load before their import
+  for (const std::string& file : meshFiles) {
+    if (resourceDict_.count(file) == 0) {
+      takePrefetchedScene(file);
+    }
+  }
+  return objectIDs;
+}
+
+std::vector<std::thread> ResourceManager::prefetchFiles(
+    const std::vector<std::string>& files,
+    int numThreads /* = 0 */) {
+  struct Reads {
+    std::vector<std::string> files;
+    std::vector<std::promise<PrefetchedScene>> promises;
+    std::atomic<size_t> next{0};
+  };
+  auto reads = std::make_shared<Reads>();
+  for (const std::string& file : files) {
+    if (isBinaryGltf(file) && resourceDict_.count(file) == 0 &&
+        prefetchedScenes_.count(file) == 0 && io::exists(file)) {
+      reads->promises.emplace_back();
+      prefetchedScenes_.emplace(file, reads->promises.back().get_future());
+      reads->files.push_back(file);
+    }
+  }
+  if (numThreads <= 0) {
+    numThreads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  const int numReaders =
+      std::min(static_cast<int>(reads->files.size()), numThreads);
+  std::vector<std::thread> readers;
+  for (int i = 0; i < numReaders; ++i) {
+    readers.emplace_back([reads]() {
+      for (size_t i = reads->next++; i < reads->files.size();
+           i = reads->next++) {
+        PrefetchedScene prefetched;
+        prefetched.fileData = Cr::Utility::Directory::read(reads->files[i]);
+        reads->promises[i].set_value(std::move(prefetched));
+      }
+    });
+  }
+  return readers;
+}
+
+bool ResourceManager::prefetchScene(const AssetInfo& sceneInfo) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  const AssetInfo info = withAbsolutePath(sceneInfo);
+  const std::string& filename = info.filepath;
+  // already resident or in flight
+  if (resourceDict_.count(filename) > 0 ||
+      prefetchedScenes_.count(filename) > 0) {
+    return true;
+  }
+  if (filename.compare(EMPTY_SCENE) == 0 || !io::exists(filename)) {
+    return false;
+  }
+
+  const bool decodeMesh = info.type == AssetType::FRL_INSTANCE_MESH ||
+                          info.type == AssetType::INSTANCE_MESH
+#ifdef ESP_BUILD_PTEX_SUPPORT
+                          || info.type == AssetType::FRL_PTEX_MESH
+#endif
+      ;
+  while (!prefetchOrder_.empty() &&
+         prefetchOrder_.size() >= maxPrefetchedScenes_) {
+    LOG(INFO) << "Dropping the unused prefetch of " << prefetchOrder_.front();
+    prefetchedScenes_.erase(prefetchOrder_.front());
+    prefetchOrder_.pop_front();
+  }
+  // decoding is CPU-bound and shares the cores with the other loaders on the
+  // global pool; reading a file blocks on the disk, on a thread of its own
+  if (decodeMesh) {
+    prefetchedScenes_.emplace(
+        filename, core::ThreadPool::global().async([info]() {
+          PrefetchedScene prefetched;
+          prefetched.mesh = decodeSceneMesh(info);
+          return prefetched;
+        }));
+  } else if (isBinaryGltf(filename)) {
+    prefetchedScenes_.emplace(
+        filename, std::async(std::launch::async, [filename]() {
+          PrefetchedScene prefetched;
+          prefetched.fileData = Cr::Utility::Directory::read(filename);
+          return prefetched;
+        }));
+  } else {
+    return false;
+  }
+  prefetchOrder_.push_back(filename);
+  return true;
+}
+
+bool ResourceManager::cancelPrefetch(const AssetInfo& info) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  const std::string filename = withAbsolutePath(info).filepath;
+  prefetchOrder_.erase(
+      std::remove(prefetchOrder_.begin(), prefetchOrder_.end(), filename),
+      prefetchOrder_.end());
+  return prefetchedScenes_.erase(filename) > 0;
+}
+
+void ResourceManager::cancelPrefetches() {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  prefetchOrder_.clear();
+  prefetchedScenes_.clear();
+}
+
+void ResourceManager::setMaxPrefetchedScenes(int maxPrefetchedScenes) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  maxPrefetchedScenes_ = std::max(1, maxPrefetchedScenes);
+  while (prefetchOrder_.size() > maxPrefetchedScenes_) {
+    prefetchedScenes_.erase(prefetchOrder_.front());
+    prefetchOrder_.pop_front();
+  }
+}
+
+ResourceManager::PrefetchedScene ResourceManager::takePrefetchedScene(
+    const std::string& filepath) {
+  auto it = prefetchedScenes_.find(filepath);
+  if (it == prefetchedScenes_.end()) {
+    return {};
+  }
+  // a decode still queued on the pool runs here rather than waiting for a
+  // worker
+  core::ThreadPool& pool = core::ThreadPool::global();
+  while (it->second.wait_for(std::chrono::seconds(0)) !=
+         std::future_status::ready) {
+    if (!pool.runPendingTask()) {
+      it->second.wait_for(std::chrono::microseconds(200));
+    }
+  }
+  PrefetchedScene prefetched = it->second.get();
+  prefetchedScenes_.erase(it);
+  prefetchOrder_.erase(
+      std::remove(prefetchOrder_.begin(), prefetchOrder_.end(), filepath),
+      prefetchOrder_.end());
+  return prefetched;
+}
+
+void ResourceManager::acquireScene(const std::string& filepath) {
+  CachedScene& cached = sceneCache_[filepath];
+  // measured on every acquire, streamed PTex atlases grow as they load
+  auto dictIt = resourceDict_.find(filepath);
+  cached.sizeInBytes = dictIt != resourceDict_.end()
+                           ? getAssetMemoryBytes(dictIt->second)
+                           : 0;
+  if (cached.sizeInBytes == 0) {
+    cached.sizeInBytes = io::fileSize(filepath);
+  }
+  ++cached.refCount;
+  cached.lastUsed = ++sceneCacheClock_;
+  evictUnusedScenes();
+}
+
+void ResourceManager::releaseScene(const AssetInfo& info) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  auto it = sceneCache_.find(withAbsolutePath(info).filepath);
+  if (it == sceneCache_.end() || it->second.refCount == 0) {
+    LOG(WARNING) << "ResourceManager::releaseScene: " << info.filepath
+                 << " is not referenced";
+    return;
+  }
+  --it->second.refCount;
+  it->second.lastUsed = ++sceneCacheClock_;
+  evictUnusedScenes();
+}
+
+void ResourceManager::setAssetCacheBudget(size_t budgetInBytes) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  assetCacheBudget_ = budgetInBytes;
+  evictUnusedScenes();
+}
+
+size_t ResourceManager::getAssetCacheSize() const {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  size_t cacheSize = 0;
+  for (const auto& cached : sceneCache_) {
+    cacheSize += cached.second.sizeInBytes;
+  }
+  return cacheSize;
+}
+
+size_t ResourceManager::getAssetMemoryBytes(
+    const MeshMetaData& metaData) const {
+  size_t bytes = 0;
+  for (int i = metaData.meshIndex.first;
+       i >= 0 && i <= metaData.meshIndex.second; ++i) {
+    if (meshes_[i]) {
+      bytes += meshes_[i]->getGPUMemoryBytes();
+    }
+  }
+  for (int i = metaData.textureIndex.first;
+       i >= 0 && i <= metaData.textureIndex.second; ++i) {
+    bytes += getTextureMemoryBytes(i);
+  }
+  return bytes;
+}
+
+size_t ResourceManager::getTextureMemoryBytes(int textureID) const {
+  return streamedTextures_[textureID]
+             ? streamedTextures_[textureID]->getMemoryBytes()
+             : textureMemoryBytes_[textureID];
+}
+
+void ResourceManager::finishStreamedTextures() {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  for (const std::shared_ptr<StreamedTexture>& texture : streamedTextures_) {
+    if (texture) {
+      texture->finish();
+    }
+  }
+}
+
+ResourceManager::MemoryStats ResourceManager::getMemoryStats() const {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  MemoryStats stats;
+  for (const std::shared_ptr<BaseMesh>& mesh : meshes_) {
+    if (mesh) {
+      stats.meshBytes += mesh->getGPUMemoryBytes();
+    }
+  }
+  for (int i = 0; i < textures_.size(); ++i) {
+    stats.textureBytes += getTextureMemoryBytes(i);
+  }
+  for (const auto& asset : resourceDict_) {
+    stats.assetBytes[asset.first] = getAssetMemoryBytes(asset.second);
+  }
+  return stats;
+}
+
+LoadTrace ResourceManager::getLoadTrace() const {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  LoadTrace trace = loadTrace_;
+  auto asset = resourceDict_.find(trace.asset);
+  if (asset != resourceDict_.end()) {
+    trace.gpuBytes = getAssetMemoryBytes(asset->second);
+  }
+  return trace;
+}
+
+void ResourceManager::evictUnusedScenes() {
+  if (assetCacheBudget_ == 0) {
+    return;
+  }
+  size_t cacheSize = getAssetCacheSize();
+  while (cacheSize > assetCacheBudget_) {
+    auto lru = sceneCache_.end();
+    for (auto it = sceneCache_.begin(); it != sceneCache_.end(); ++it) {
+      if (it->second.refCount == 0 && !isObjectAsset(it->first) &&
+          (lru == sceneCache_.end() ||
+           it->second.lastUsed < lru->second.lastUsed)) {
+        lru = it;
+      }
+    }
+    if (lru == sceneCache_.end()) {
+      // everything left is in use
+      break;
+    }
+
+    if (core::MetricsRegistry::get().isEnabled()) {
+      loadMetrics().evictions.add();
+    }
+    // indices of other assets must stay valid, so only clear the slots, and
+    // hand them to the next loads
+    auto dictIt = resourceDict_.find(lru->first);
+    if (dictIt != resourceDict_.end()) {
+      const MeshMetaData& metaData = dictIt->second;
+      for (int i = metaData.meshIndex.first;
+           i >= 0 && i <= metaData.meshIndex.second; ++i) {
+        meshes_[i] = nullptr;
+      }
+      for (int i = metaData.textureIndex.first;
+           i >= 0 && i <= metaData.textureIndex.second; ++i) {
+        streamedTextures_[i] = nullptr;
+        textures_[i] = nullptr;
+        textureMemoryBytes_[i] = 0;
+      }
+      for (int i = metaData.materialIndex.first;
+           i >= 0 && i <= metaData.materialIndex.second; ++i) {
+        materials_[i] = nullptr;
+      }
+      releaseSlots(freeMeshSlots_, metaData.meshIndex);
+      releaseSlots(freeTextureSlots_, metaData.textureIndex);
+      releaseSlots(freeMaterialSlots_, metaData.materialIndex);
+      resourceDict_.erase(dictIt);
+    }
+    magnumMeshDict_.erase(lru->first);
+    cpuOnlyAssets_.erase(lru->first);
+    // the collision data of the scene goes with its meshes, the colliders
+    // made from it went with the worlds of the released scene
+    sceneCollisionMeshes_.erase(lru->first);
+    collisionMeshGroups_.erase(lru->first);
+    collisionHulls_.erase(lru->first);
+    physicsSceneLibrary_.erase(lru->first);
+
+    LOG(INFO) << "Evicted " << lru->first << " from the asset cache";
+    cacheSize -= lru->second.sizeInBytes;
+    sceneCache_.erase(lru);
+  }
+}
+
+bool ResourceManager::isObjectAsset(const std::string& filepath) const {
+  for (const auto& object : physicsObjectLibrary_) {
+    if (object.second.getString("renderMeshHandle") == filepath ||
+        object.second.getString("collisionMeshHandle") == filepath) {
+      return true;
+    }
+  }
+  return false;
+}
+
+int ResourceManager::allocateSlots(std::vector<std::pair<int, int>>& freeSlots,
+                                   int size,
+                                   int count) {
+  if (count > 0) {
+    // first fit, splitting the range
+    for (auto it = freeSlots.begin(); it != freeSlots.end(); ++it) {
+      const int first = it->first;
+      const int freeCount = it->second - it->first + 1;
+      if (freeCount == count) {
+        freeSlots.erase(it);
+        return first;
+      }
+      if (freeCount > count) {
+        it->first += count;
+        return first;
+      }
+    }
+  }
+  return size;
+}
+
+void ResourceManager::releaseSlots(std::vector<std::pair<int, int>>& freeSlots,
+                                   const std::pair<int, int>& slots) {
+  if (slots.first < 0 || slots.second < slots.first) {
+    return;
+  }
+  // sorted by the first slot, adjacent ranges merged
+  auto it = freeSlots.insert(
+      std::lower_bound(freeSlots.begin(), freeSlots.end(), slots), slots);
+  if (it + 1 != freeSlots.end() && it->second + 1 == (it + 1)->first) {
+    it->second = (it + 1)->second;
+    freeSlots.erase(it + 1);
+  }
+  if (it != freeSlots.begin() && (it - 1)->second + 1 == it->first) {
+    (it - 1)->second = it->second;
+    freeSlots.erase(it);
+  }
+}
+
 const std::vector<assets::CollisionMeshData>& ResourceManager::getCollisionMesh(
     const int objectID) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
   std::string configFile = getObjectConfig(objectID);
   return collisionMeshGroups_[configFile];
 }
 
 const std::vector<assets::CollisionMeshData>& ResourceManager::getCollisionMesh(
     const std::string configFile) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
   return collisionMeshGroups_[configFile];
 }
 
 int ResourceManager::getObjectID(const std::string& configFile) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
   std::vector<std::string>::iterator itr =
       std::find(physicsObjectConfigList_.begin(),
                 physicsObjectConfigList_.end(), configFile);
@@ -633,14 +1334,25 @@ int ResourceManager::getObjectID(const std::string& configFile) {
 }
 
 std::string ResourceManager::getObjectConfig(const int objectID) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
   return physicsObjectConfigList_[objectID];
 }
 
 Magnum::Vector3 ResourceManager::computeMeshBBCenter(GltfMeshData* meshDataGL) {
+  return computeMeshBB(meshDataGL).center();
+}
+
+Magnum::Range3D ResourceManager::computeMeshBB(BaseMesh* meshDataGL) {
   CollisionMeshData& meshData = meshDataGL->getCollisionMeshData();
   return Magnum::Range3D{
-      Magnum::Math::minmax<Magnum::Vector3>(meshData.positions)}
-      .center();
+      Magnum::Math::minmax<Magnum::Vector3>(meshData.positions)};
+}
+
+void ResourceManager::setDrawableBB(gfx::Drawable& drawable,
+                                    BaseMesh* meshDataGL) {
+  if (!meshDataGL->getCollisionMeshData().positions.empty()) {
+    drawable.setLocalBoundingBox(computeMeshBB(meshDataGL));
+  }
 }
 
 void ResourceManager::translateMesh(GltfMeshData* meshDataGL,
@@ -655,38 +1367,49 @@ void ResourceManager::translateMesh(GltfMeshData* meshDataGL,
 
 Magnum::GL::AbstractShaderProgram* ResourceManager::getShaderProgram(
     ShaderType type) {
-  if (shaderPrograms_.count(type) == 0) {
+  const auto key = std::make_pair(&Magnum::GL::Context::current(), type);
+  if (shaderPrograms_.count(key) == 0) {
+    LoadStageTimer stageTimer(LoadStage::Shaders);
+    // programs are shared with the other ResourceManagers of the GL context,
+    // one specialized variant per combination of flags
     switch (type) {
       case INSTANCE_MESH_SHADER: {
-        shaderPrograms_[INSTANCE_MESH_SHADER] =
-            std::make_shared<gfx::PrimitiveIDTexturedShader>();
+        shaderPrograms_[key] =
+            gfx::getShaderVariant<gfx::PrimitiveIDTexturedShader>(
+                "primitive-id-textured", {});
+      } break;
+
+      case INSTANCE_MESH_VERTEX_ID_SHADER: {
+        shaderPrograms_[key] =
+            gfx::getShaderVariant<gfx::PrimitiveIDTexturedShader>(
+                "primitive-id-textured",
+                gfx::PrimitiveIDTexturedShader::Flag::ObjectIdAttribute);
       } break;
 
 #ifdef ESP_BUILD_PTEX_SUPPORT
       case PTEX_MESH_SHADER: {
-        shaderPrograms_[PTEX_MESH_SHADER] =
-            std::make_shared<gfx::PTexMeshShader>();
+        shaderPrograms_[key] =
+            gfx::getSharedShaderProgram("ptex-default", []() {
+              return std::make_shared<gfx::PTexMeshShader>();
+            });
       } break;
 #endif
 
       case COLORED_SHADER: {
-        shaderPrograms_[COLORED_SHADER] =
-            std::make_shared<Magnum::Shaders::Flat3D>(
-                Magnum::Shaders::Flat3D::Flag::ObjectId);
+        shaderPrograms_[key] = gfx::getShaderVariant<Magnum::Shaders::Flat3D>(
+            "flat", Magnum::Shaders::Flat3D::Flag::ObjectId);
       } break;
 
       case VERTEX_COLORED_SHADER: {
-        shaderPrograms_[VERTEX_COLORED_SHADER] =
-            std::make_shared<Magnum::Shaders::Flat3D>(
-                Magnum::Shaders::Flat3D::Flag::ObjectId |
-                Magnum::Shaders::Flat3D::Flag::VertexColor);
+        shaderPrograms_[key] = gfx::getShaderVariant<Magnum::Shaders::Flat3D>(
+            "flat", Magnum::Shaders::Flat3D::Flag::ObjectId |
+                        Magnum::Shaders::Flat3D::Flag::VertexColor);
       } break;
 
       case TEXTURED_SHADER: {
-        shaderPrograms_[TEXTURED_SHADER] =
-            std::make_shared<Magnum::Shaders::Flat3D>(
-                Magnum::Shaders::Flat3D::Flag::ObjectId |
-                Magnum::Shaders::Flat3D::Flag::Textured);
+        shaderPrograms_[key] = gfx::getShaderVariant<Magnum::Shaders::Flat3D>(
+            "flat", Magnum::Shaders::Flat3D::Flag::ObjectId |
+                        Magnum::Shaders::Flat3D::Flag::Textured);
       } break;
 
       default:
@@ -694,7 +1417,7 @@ Magnum::GL::AbstractShaderProgram* ResourceManager::getShaderProgram(
         break;
     }
   }
-  return shaderPrograms_[type].get();
+  return shaderPrograms_[key].get();
 }
 
 bool ResourceManager::loadPTexMeshData(const AssetInfo& info,
@@ -704,21 +1427,20 @@ bool ResourceManager::loadPTexMeshData(const AssetInfo& info,
   // if this is a new file, load it and add it to the dictionary
   const std::string& filename = info.filepath;
   if (resourceDict_.count(filename) == 0) {
-    const std::string atlasDir =
-        Corrade::Utility::String::stripSuffix(filename, "ptex_quad_mesh.ply") +
-        "ptex_textures";
-
-    meshes_.emplace_back(std::make_unique<PTexMeshData>());
-    int index = meshes_.size() - 1;
-    auto* pTexMeshData = dynamic_cast<PTexMeshData*>(meshes_[index].get());
-    pTexMeshData->load(filename, atlasDir);
+    std::unique_ptr<BaseMesh> mesh = takePrefetchedScene(filename).mesh;
+    if (!mesh) {
+      mesh = decodeSceneMesh(info);
+    }
+    int index = allocateSlots(freeMeshSlots_, meshes_.size(), 1);
+    meshes_.resize(std::max<size_t>(meshes_.size(), index + 1));
+    meshes_[index] = std::move(mesh);
 
     // update the dictionary
     resourceDict_.emplace(filename, MeshMetaData(index, index));
   }
 
-  // create the scene graph by request
-  if (parent) {
+  // create the scene graph by request; the atlases are uploaded here
+  if (parent && gpuEnabled_) {
     auto* ptexShader =
         dynamic_cast<gfx::PTexMeshShader*>(getShaderProgram(PTEX_MESH_SHADER));
 
@@ -729,12 +1451,20 @@ bool ResourceManager::loadPTexMeshData(const AssetInfo& info,
     for (int iMesh = start; iMesh <= end; ++iMesh) {
       auto* pTexMeshData = dynamic_cast<PTexMeshData*>(meshes_[iMesh].get());
 
-      pTexMeshData->uploadBuffersToGPU(false);
+      pTexMeshData->setAtlasStreaming(streamPTexAtlases_);
+      {
+        LoadStageTimer stageTimer(LoadStage::Upload);
+        pTexMeshData->uploadBuffersToGPU(false);
+      }
 
+      LoadStageTimer stageTimer(LoadStage::Instantiate);
       for (int jSubmesh = 0; jSubmesh < pTexMeshData->getSize(); ++jSubmesh) {
         scene::SceneNode& node = parent->createChild();
-        new gfx::PTexMeshDrawable{node, *ptexShader, *pTexMeshData, jSubmesh,
-                                  drawables};
+        auto* drawable = new gfx::PTexMeshDrawable{
+            node, *ptexShader, *pTexMeshData, jSubmesh, drawables};
+        // culled submeshes are not drawn, so neither are their atlases
+        // streamed in
+        drawable->setLocalBoundingBox(pTexMeshData->getBoundingBox(jSubmesh));
       }
     }
   }
@@ -755,25 +1485,37 @@ bool ResourceManager::loadInstanceMeshData(const AssetInfo& info,
   // and add it to the shaderPrograms_
   const std::string& filename = info.filepath;
   if (resourceDict_.count(filename) == 0) {
-    if (info.type == AssetType::FRL_INSTANCE_MESH) {
-      meshes_.emplace_back(std::make_unique<FRLInstanceMeshData>());
-    } else if (info.type == AssetType::INSTANCE_MESH) {
-      meshes_.emplace_back(std::make_unique<GenericInstanceMeshData>());
+    std::unique_ptr<BaseMesh> mesh = takePrefetchedScene(filename).mesh;
+    if (!mesh) {
+      mesh = decodeSceneMesh(info);
     }
-    int index = meshes_.size() - 1;
+    int index = allocateSlots(freeMeshSlots_, meshes_.size(), 1);
+    meshes_.resize(std::max<size_t>(meshes_.size(), index + 1));
+    meshes_[index] = std::move(mesh);
     auto* instanceMeshData =
         dynamic_cast<GenericInstanceMeshData*>(meshes_[index].get());
 
-    instanceMeshData->loadPLY(filename);
-    instanceMeshData->uploadBuffersToGPU(false);
+    // FRL instance meshes upload buffers of their own
+    if (optimizeMeshes_ && info.type == AssetType::INSTANCE_MESH) {
+      LoadStageTimer stageTimer(LoadStage::Process);
+      instanceMeshData->optimizeTriangleOrder();
+    }
+    if (gpuEnabled_) {
+      LoadStageTimer stageTimer(LoadStage::Upload);
+      instanceMeshData->uploadBuffersToGPU(false);
+      instance_mesh_ = instanceMeshData->getMagnumGLMesh();
+    } else {
+      cpuOnlyAssets_[filename] = info.type;
+    }
 
-    instance_mesh_ = &(instanceMeshData->getRenderingBuffer()->mesh);
     // update the dictionary
     resourceDict_.emplace(filename, MeshMetaData(index, index));
   }
 
   // create the scene graph by request
-  if (parent) {
+  if (parent && gpuEnabled_) {
+    uploadCpuOnlyAsset(filename);
+    LoadStageTimer stageTimer(LoadStage::Instantiate);
     auto indexPair = resourceDict_.at(filename).meshIndex;
     int start = indexPair.first;
     int end = indexPair.second;
@@ -781,9 +1523,23 @@ bool ResourceManager::loadInstanceMeshData(const AssetInfo& info,
     for (int iMesh = start; iMesh <= end; ++iMesh) {
       auto* instanceMeshData =
           dynamic_cast<GenericInstanceMeshData*>(meshes_[iMesh].get());
-      scene::SceneNode& node = parent->createChild();
-      createDrawable(INSTANCE_MESH_SHADER, *instanceMeshData->getMagnumGLMesh(),
-                     node, drawables, instanceMeshData->getSemanticTexture());
+      const int numChunks = instanceMeshData->getNumChunks();
+      if (numChunks == 0) {
+        scene::SceneNode& node = parent->createChild();
+        gfx::Drawable& drawable = createDrawable(
+            INSTANCE_MESH_SHADER, *instanceMeshData->getMagnumGLMesh(), node,
+            drawables, instanceMeshData->getSemanticTexture());
+        setDrawableBB(drawable, instanceMeshData);
+      }
+      // object ids in the vertices, one drawable per 16-bit indexed chunk
+      for (int iChunk = 0; iChunk < numChunks; ++iChunk) {
+        scene::SceneNode& node = parent->createChild();
+        gfx::Drawable& drawable = createDrawable(
+            INSTANCE_MESH_VERTEX_ID_SHADER,
+            *instanceMeshData->getMagnumGLMesh(iChunk), node, drawables);
+        drawable.setLocalBoundingBox(
+            instanceMeshData->getChunkBoundingBox(iChunk));
+      }
     }
   }
 
@@ -798,34 +1554,47 @@ bool ResourceManager::loadGeneralMeshData(
     Magnum::Vector3 translation /* [0,0,0] */) {
   const std::string& filename = info.filepath;
   const bool fileIsLoaded = resourceDict_.count(filename) > 0;
-  const bool drawData = parent != nullptr && drawables != nullptr;
+  const bool drawData =
+      gpuEnabled_ && parent != nullptr && drawables != nullptr;
 
   // Mesh & metaData container
   MeshMetaData metaData;
   std::vector<Magnum::UnsignedInt> magnumData;
 
-  Magnum::PluginManager::Manager<Importer> manager;
-  std::unique_ptr<Importer> importer =
-      manager.loadAndInstantiate("AnySceneImporter");
-  manager.setPreferredPlugins("GltfImporter", {"TinyGltfImporter"});
+  // Optional File loading; loaded files are instantiated from their cached
+  // hierarchy and need no importer
+  if (!fileIsLoaded) {
+    // prefetched file contents have to outlive the importer using them
+    PrefetchedScene prefetched = takePrefetchedScene(filename);
+    Magnum::PluginManager::Manager<Importer> manager;
+    std::unique_ptr<Importer> importer =
+        manager.loadAndInstantiate("AnySceneImporter");
+    manager.setPreferredPlugins("GltfImporter", {"TinyGltfImporter"});
 #ifdef ESP_BUILD_ASSIMP_SUPPORT
-  manager.setPreferredPlugins("ObjImporter", {"AssimpImporter"});
+    manager.setPreferredPlugins("ObjImporter", {"AssimpImporter"});
 #endif
 
-  // Optional File loading
-  if (!fileIsLoaded) {
-    if (!importer->openFile(filename)) {
-      LOG(ERROR) << "Cannot open file " << filename;
+    TextureAtlas atlas;
+    bool atlased = false;
+    if (!openSceneFile(*importer, filename, prefetched.fileData, atlas,
+                       atlased)) {
       return false;
     }
 
-    // if this is a new file, load it and add it to the dictionary
-    loadTextures(*importer, &metaData);
+    // if this is a new file, load it and add it to the dictionary; without
+    // the GPU, the textures are left for uploadCpuOnlyAsset()
+    if (gpuEnabled_) {
+      loadTextures(*importer, &metaData, filename, atlased ? &atlas : nullptr);
+    } else {
+      cpuOnlyAssets_[filename] = info.type;
+    }
     loadMaterials(*importer, &metaData);
-    loadMeshes(*importer, &metaData, shiftOrigin, translation);
+    loadMeshes(*importer, &metaData, filename, shiftOrigin, translation,
+               atlased ? &atlas : nullptr);
     resourceDict_.emplace(filename, metaData);
 
     // Register magnum mesh
+    LoadStageTimer stageTimer(LoadStage::Read);
     if (importer->defaultScene() != -1) {
       Corrade::Containers::Optional<Magnum::Trade::SceneData> sceneData =
           importer->scene(importer->defaultScene());
@@ -845,7 +1614,7 @@ bool ResourceManager::loadGeneralMeshData(
       LOG(ERROR) << "No default scene available and no meshes found, exiting";
       return false;
     }
-    magnumMeshDict_.emplace(filename, magnumData);
+    loadMeshHierarchy(*importer, magnumData, magnumMeshDict_[filename]);
   } else {
     metaData = resourceDict_[filename];
   }
@@ -855,11 +1624,13 @@ bool ResourceManager::loadGeneralMeshData(
     //! Do not instantiate object
     return true;
   } else {
+    LoadStageTimer stageTimer(LoadStage::Instantiate);
     // intercept nullptr scene graph nodes (default) to add mesh to
     // metadata list without adding it to scene graph
     scene::SceneNode& newNode = parent->createChild();
 
     //! Do instantiate object
+    uploadCpuOnlyAsset(filename);
     MeshMetaData& metaData = resourceDict_[filename];
     const bool forceReload = false;
     // re-bind position, normals, uv, colors etc. to the corresponding buffers
@@ -877,23 +1648,107 @@ bool ResourceManager::loadGeneralMeshData(
     const quatf transform = info.frame.rotationFrameToWorld();
     newNode.setRotation(Magnum::Quaternion(transform));
     // Recursively add all children
-    for (auto sceneDataID : magnumMeshDict_[filename]) {
-      addComponent(*importer, info, metaData, newNode, drawables, sceneDataID);
+    const MeshHierarchy& hierarchy = magnumMeshDict_[filename];
+    for (int component : hierarchy.roots) {
+      addComponent(hierarchy, component, metaData, newNode, drawables);
     }
     return true;
   }
 }
 
+bool ResourceManager::openSceneFile(
+    Importer& importer,
+    const std::string& filename,
+    const Corrade::Containers::Array<char>& fileData,
+    TextureAtlas& atlas,
+    bool& atlased) {
+  {
+    LoadStageTimer stageTimer(LoadStage::Read);
+    bool opened = false;
+    if (fileData) {
+      opened = importer.openData(fileData);
+    }
+    if (!opened && !importer.openFile(filename)) {
+      LOG(ERROR) << "Cannot open file " << filename;
+      return false;
+    }
+
+    // the atlas datatool packed the textures of the file into, which the
+    // textures and the texture coordinates of the meshes both move to
+    atlased = loadTextureAtlas(textureAtlasFilename(filename), filename,
+                               atlas) &&
+              atlas.placements.size() == importer.textureCount() &&
+              atlas.meshTextures.size() == importer.mesh3DCount() &&
+              atlas.hasPackedTextures();
+  }
+  if (!atlased && atlas.hasPackedTextures()) {
+    LOG(WARNING) << "Texture atlas of " << filename
+                 << " does not match its textures, ignoring it";
+  }
+  return true;
+}
+
+void ResourceManager::uploadCpuOnlyAsset(const std::string& filename) {
+  auto cpuOnly = cpuOnlyAssets_.find(filename);
+  if (!gpuEnabled_ || cpuOnly == cpuOnlyAssets_.end()) {
+    return;
+  }
+  const AssetType type = cpuOnly->second;
+  cpuOnlyAssets_.erase(cpuOnly);
+  LOG(INFO) << "Uploading " << filename << ", loaded without the GPU";
+  MeshMetaData& metaData = resourceDict_.at(filename);
+  const int start = metaData.meshIndex.first;
+  const int end = metaData.meshIndex.second;
+
+  if (type == AssetType::FRL_INSTANCE_MESH ||
+      type == AssetType::INSTANCE_MESH) {
+    LoadStageTimer stageTimer(LoadStage::Upload);
+    for (int iMesh = start; iMesh <= end; ++iMesh) {
+      meshes_[iMesh]->uploadBuffersToGPU(false);
+      instance_mesh_ = meshes_[iMesh]->getMagnumGLMesh();
+    }
+    return;
+  }
+
+  // general meshes, processed already; only their textures are read from the
+  // file again
+  {
+    LoadStageTimer stageTimer(LoadStage::Upload);
+    MeshUploader uploader;
+    for (int iMesh = start; 0 <= start && iMesh <= end; ++iMesh) {
+      uploader.add(static_cast<GltfMeshData&>(*meshes_[iMesh]));
+    }
+    uploader.upload();
+  }
+  Magnum::PluginManager::Manager<Importer> manager;
+  std::unique_ptr<Importer> importer =
+      manager.loadAndInstantiate("AnySceneImporter");
+  manager.setPreferredPlugins("GltfImporter", {"TinyGltfImporter"});
+#ifdef ESP_BUILD_ASSIMP_SUPPORT
+  manager.setPreferredPlugins("ObjImporter", {"AssimpImporter"});
+#endif
+  TextureAtlas atlas;
+  bool atlased = false;
+  if (!openSceneFile(*importer, filename, {}, atlas, atlased)) {
+    LOG(ERROR) << "Cannot load the textures of " << filename
+               << ", it is drawn without them";
+    return;
+  }
+  loadTextures(*importer, &metaData, filename, atlased ? &atlas : nullptr);
+}
+
 void ResourceManager::loadMaterials(Importer& importer,
                                     MeshMetaData* metaData) {
-  int materialStart = materials_.size();
+  int materialStart = allocateSlots(freeMaterialSlots_, materials_.size(),
+                                    importer.materialCount());
   int materialEnd = materialStart + importer.materialCount() - 1;
   metaData->setMaterialIndices(materialStart, materialEnd);
+  materials_.resize(std::max<size_t>(materials_.size(), materialEnd + 1));
 
   for (int iMaterial = 0; iMaterial < importer.materialCount(); ++iMaterial) {
     // default null material
-    materials_.emplace_back(nullptr);
-    auto& currentMaterial = materials_.back();
+    auto& currentMaterial = materials_[materialStart + iMaterial];
+    currentMaterial = nullptr;
 
     // TODO:
     // it seems we have a way to just load the material once in this case,
@@ -916,18 +1771,51 @@ void ResourceManager::loadMaterials(Importer& importer,
 
 void ResourceManager::loadMeshes(Importer& importer,
                                  MeshMetaData* metaData,
+                                 const std::string& filename,
                                  bool shiftOrigin /*=false*/,
-                                 Magnum::Vector3 offset /* [0,0,0] */
+                                 Magnum::Vector3 offset /* [0,0,0] */,
+                                 const TextureAtlas* atlas /* = nullptr */
 ) {
-  int meshStart = meshes_.size();
+  int meshStart =
+      allocateSlots(freeMeshSlots_, meshes_.size(), importer.mesh3DCount());
   int meshEnd = meshStart + importer.mesh3DCount() - 1;
   metaData->setMeshIndices(meshStart, meshEnd);
+  meshes_.resize(std::max<size_t>(meshes_.size(), meshEnd + 1));
+
+  LoadStageTimer stageTimer(LoadStage::Process);
+  std::vector<std::vector<geo::MeshLOD>> meshLODs;
+  bool hasLODs = false;
+  {
+    LoadStageTimer readTimer(LoadStage::Read);
+    hasLODs = geo::loadMeshLODs(geo::meshLODsFilename(filename), filename,
+                                meshLODs);
+  }
+  if (hasLODs && meshLODs.size() != importer.mesh3DCount()) {
+    LOG(WARNING) << "Levels of detail of " << filename
+                 << " do not match its meshes, ignoring them";
+    meshLODs.clear();
+  }
 
+  // the meshes are uploaded together once all are imported
+  MeshUploader uploader;
   for (int iMesh = 0; iMesh < importer.mesh3DCount(); ++iMesh) {
-    meshes_.emplace_back(std::make_unique<GltfMeshData>());
-    auto& currentMesh = meshes_.back();
+    auto& currentMesh = meshes_[meshStart + iMesh];
+    currentMesh = std::make_unique<GltfMeshData>();
     auto* gltfMeshData = static_cast<GltfMeshData*>(currentMesh.get());
-    gltfMeshData->setMeshData(importer, iMesh);
+    {
+      LoadStageTimer readTimer(LoadStage::Read);
+      gltfMeshData->setMeshData(importer, iMesh);
+    }
+    if (atlas && atlas->meshTextures[iMesh] >= 0) {
+      gltfMeshData->remapTextureCoordinates(*atlas,
+                                            atlas->meshTextures[iMesh]);
+    }
+    if (iMesh < meshLODs.size()) {
+      gltfMeshData->setLODs(std::move(meshLODs[iMesh]));
+    }
+    if (optimizeMeshes_) {
+      gltfMeshData->optimize();
+    }
 
     // see if the mesh needs to be shifted
     if (shiftOrigin) {
@@ -939,19 +1827,97 @@ void ResourceManager::loadMeshes(Importer& importer,
         translateMesh(gltfMeshData, offset);
     }
 
-    CollisionMeshData& meshData = gltfMeshData->getCollisionMeshData();
-    gltfMeshData->uploadBuffersToGPU(false);
+    uploader.add(*gltfMeshData);
+  }
+  if (gpuEnabled_) {
+    LoadStageTimer uploadTimer(LoadStage::Upload);
+    uploader.upload();
   }
 }
 
-void ResourceManager::loadTextures(Importer& importer, MeshMetaData* metaData) {
-  int textureStart = textures_.size();
+void ResourceManager::loadTextures(Importer& importer,
+                                   MeshMetaData* metaData,
+                                   const std::string& filename,
+                                   const TextureAtlas* atlas /* = nullptr */) {
+  int textureStart = allocateSlots(freeTextureSlots_, textures_.size(),
+                                   importer.textureCount());
   int textureEnd = textureStart + importer.textureCount() - 1;
   metaData->setTextureIndices(textureStart, textureEnd);
+  if (textureEnd >= textures_.size()) {
+    textures_.resize(textureEnd + 1);
+    textureMemoryBytes_.resize(textureEnd + 1);
+    streamedTextures_.resize(textureEnd + 1);
+  }
+
+  LoadStageTimer stageTimer(LoadStage::Upload);
+  std::vector<CompressedTexture> compressedTextures;
+  bool hasCompressedTextures = false;
+  if (compressTextures_) {
+    LoadStageTimer readTimer(LoadStage::Read);
+    hasCompressedTextures =
+        loadCompressedTextures(compressedTexturesFilename(filename), filename,
+                               compressedTextures);
+  }
+  if (hasCompressedTextures &&
+      compressedTextures.size() != importer.textureCount()) {
+    LOG(WARNING) << "Compressed textures of " << filename
+                 << " do not match its textures, ignoring them";
+    compressedTextures.clear();
+  }
+
+  // one texture for all packed textures, counted with the first of them
+  std::shared_ptr<Magnum::GL::Texture2D> atlasTexture;
+  size_t atlasMemoryBytes = 0;
+  if (atlas) {
+    const Magnum::Vector2i size{atlas->width, atlas->height};
+    const bool rgba = atlas->channels == 4;
+    Magnum::GL::TextureFormat format;
+    if (compressTextures_) {
+      format = rgba ? Magnum::GL::TextureFormat::CompressedRGBAS3tcDxt1
+                    : Magnum::GL::TextureFormat::CompressedRGBS3tcDxt1;
+    } else {
+      format = rgba ? Magnum::GL::TextureFormat::RGBA8
+                    : Magnum::GL::TextureFormat::RGB8;
+    }
+    // the sampling of the packed textures cannot differ, and repeating
+    // textures are not packed
+    atlasTexture = std::make_shared<Magnum::GL::Texture2D>();
+    atlasTexture->setMagnificationFilter(Magnum::GL::SamplerFilter::Linear)
+        .setMinificationFilter(Magnum::GL::SamplerFilter::Linear,
+                               Magnum::GL::SamplerMipmap::Linear)
+        .setWrapping(Magnum::GL::SamplerWrapping::ClampToEdge)
+        .setStorage(atlas->levels(), format, size)
+        .setSubImage(
+            0, {},
+            Magnum::ImageView2D{
+                Magnum::PixelStorage{}.setAlignment(1),
+                rgba ? Magnum::PixelFormat::RGBA8Unorm
+                     : Magnum::PixelFormat::RGB8Unorm,
+                size, Corrade::Containers::arrayView(atlas->pixels)})
+        .generateMipmap();
+    atlasMemoryBytes = textureMemoryBytes(format, size, atlas->levels());
+  }
+
+  // streamed textures of the file decode their images with an importer of
+  // their own, opened by the first of them that is drawn
+  StreamedTextureSource::ptr streamSource;
+  if (streamTextures_) {
+    streamSource = StreamedTextureSource::create(filename);
+  }
 
   for (int iTexture = 0; iTexture < importer.textureCount(); ++iTexture) {
-    textures_.emplace_back(std::make_shared<Magnum::GL::Texture2D>());
-    auto& currentTexture = textures_.back();
+    const int textureID = textureStart + iTexture;
+    auto& currentTexture = textures_[textureID];
+    currentTexture = std::make_shared<Magnum::GL::Texture2D>();
+    textureMemoryBytes_[textureID] = 0;
+    streamedTextures_[textureID] = nullptr;
+
+    if (atlas && atlas->placements[iTexture].isPacked()) {
+      currentTexture = atlasTexture;
+      textureMemoryBytes_[textureID] = atlasMemoryBytes;
+      atlasMemoryBytes = 0;
+      continue;
+    }
 
     auto textureData = importer.texture(iTexture);
     if (!textureData ||
@@ -961,11 +1927,56 @@ void ResourceManager::loadTextures(Importer& importer, MeshMetaData* metaData) {
       continue;
     }
 
+    // a placeholder now, the full texture once a drawable using it is drawn
+    if (streamTextures_) {
+      const StreamedTexture::Sampling sampling{
+          textureData->magnificationFilter(), textureData->minificationFilter(),
+          textureData->mipmapFilter(), textureData->wrapping().xy()};
+      if (iTexture < compressedTextures.size() &&
+          !compressedTextures[iTexture].levels.empty()) {
+        streamedTextures_[textureID] = StreamedTexture::create(
+            currentTexture, sampling, std::move(compressedTextures[iTexture]));
+      } else {
+        streamedTextures_[textureID] =
+            StreamedTexture::create(currentTexture, sampling, streamSource,
+                                    textureData->image(), compressTextures_);
+      }
+      continue;
+    }
+
+    // precompressed mip chain, no image decoding or mip generation needed
+    if (iTexture < compressedTextures.size() &&
+        !compressedTextures[iTexture].levels.empty()) {
+      const CompressedTexture& compressed = compressedTextures[iTexture];
+      currentTexture
+          ->setMagnificationFilter(textureData->magnificationFilter())
+          .setMinificationFilter(textureData->minificationFilter(),
+                                 textureData->mipmapFilter())
+          .setWrapping(textureData->wrapping().xy())
+          .setStorage(compressed.levels.size(),
+                      Magnum::GL::TextureFormat::CompressedRGBS3tcDxt1,
+                      {compressed.width, compressed.height});
+      for (size_t level = 0; level < compressed.levels.size(); ++level) {
+        const Magnum::Vector2i size{std::max(1, compressed.width >> level),
+                                    std::max(1, compressed.height >> level)};
+        currentTexture->setCompressedSubImage(
+            level, {},
+            Magnum::CompressedImageView2D{
+                Magnum::CompressedPixelFormat::Bc1RGBUnorm, size,
+                Corrade::Containers::arrayView(compressed.levels[level])});
+        textureMemoryBytes_[textureID] += compressed.levels[level].size();
+      }
+      continue;
+    }
+
     // TODO:
     // it seems we have a way to just load the image once in this case,
     // as long as the image2DName include the full path to the image
-    Corrade::Containers::Optional<Magnum::Trade::ImageData2D> imageData =
-        importer.image2D(textureData->image());
+    Corrade::Containers::Optional<Magnum::Trade::ImageData2D> imageData;
+    {
+      LoadStageTimer readTimer(LoadStage::Read);
+      imageData = importer.image2D(textureData->image());
+    }
     Magnum::GL::TextureFormat format;
     if (imageData && imageData->format() == Magnum::PixelFormat::RGB8Unorm)
       format = compressTextures_
@@ -993,47 +2004,84 @@ void ResourceManager::loadTextures(Importer& importer, MeshMetaData* metaData) {
                     imageData->size())
         .setSubImage(0, {}, *imageData)
         .generateMipmap();
+    textureMemoryBytes_[textureID] =
+        textureMemoryBytes(format, imageData->size(),
+                           Magnum::Math::log2(imageData->size().max()) + 1);
   }
 }
 
 //! Add component to rendering stack, based on importer loading
 //! TODO (JH): decouple importer part, so that objects can be
 //! instantiated any time after initial loading
-void ResourceManager::addComponent(Importer& importer,
-                                   const AssetInfo& info,
+void ResourceManager::loadMeshHierarchy(
+    Importer& importer,
+    const std::vector<Magnum::UnsignedInt>& rootIDs,
+    MeshHierarchy& hierarchy) {
+  // objects to read as (importer id, index of the parent component)
+  std::vector<std::pair<Magnum::UnsignedInt, int>> pending;
+  for (auto it = rootIDs.rbegin(); it != rootIDs.rend(); ++it) {
+    pending.emplace_back(*it, ID_UNDEFINED);
+  }
+  while (!pending.empty()) {
+    const Magnum::UnsignedInt componentID = pending.back().first;
+    const int parent = pending.back().second;
+    pending.pop_back();
+    std::unique_ptr<Magnum::Trade::ObjectData3D> objectData =
+        importer.object3D(componentID);
+    if (!objectData) {
+      LOG(ERROR) << "Cannot import object "
+                 << importer.object3DName(componentID) << ", skipping";
+      continue;
+    }
+
+    const int index = hierarchy.components.size();
+    hierarchy.components.emplace_back();
+    MeshComponent& component = hierarchy.components.back();
+    component.componentID = componentID;
+    component.transformation = objectData->transformation();
+    if (objectData->instanceType() ==
+            Magnum::Trade::ObjectInstanceType3D::Mesh &&
+        objectData->instance() != ID_UNDEFINED) {
+      component.meshIDLocal = objectData->instance();
+      component.materialIDLocal =
+          static_cast<Magnum::Trade::MeshObjectData3D*>(objectData.get())
+              ->material();
+    }
+    if (parent == ID_UNDEFINED) {
+      hierarchy.roots.push_back(index);
+    } else {
+      hierarchy.components[parent].children.push_back(index);
+    }
+    // depth first in child order, like instantiation walks them
+    const std::vector<Magnum::UnsignedInt>& children = objectData->children();
+    for (auto it = children.rbegin(); it != children.rend(); ++it) {
+      pending.emplace_back(*it, index);
+    }
+  }
+}
+
+void ResourceManager::addComponent(const MeshHierarchy& hierarchy,
+                                   int component,
                                    const MeshMetaData& metaData,
                                    scene::SceneNode& parent,
-                                   DrawableGroup* drawables,
-                                   int componentID) {
-  importer.openFile(info.filepath);
-  std::unique_ptr<Magnum::Trade::ObjectData3D> objectData =
-      importer.object3D(componentID);
-  if (!objectData) {
-    LOG(ERROR) << "Cannot import object " << importer.object3DName(componentID)
-               << ", skipping";
-    return;
-  }
+                                   DrawableGroup* drawables) {
+  const MeshComponent& meshComponent = hierarchy.components[component];
 
   // Add the object to the scene and set its transformation
   scene::SceneNode& node = parent.createChild();
-  node.MagnumObject::setTransformation(objectData->transformation());
-
-  const int meshIDLocal = objectData->instance();
-  const int meshID = metaData.meshIndex.first + meshIDLocal;
+  node.MagnumObject::setTransformation(meshComponent.transformation);
 
   // Add a drawable if the object has a mesh and the mesh is loaded
-  if (objectData->instanceType() == Magnum::Trade::ObjectInstanceType3D::Mesh &&
-      meshIDLocal != ID_UNDEFINED && meshes_[meshID]) {
-    const int materialIDLocal =
-        static_cast<Magnum::Trade::MeshObjectData3D*>(objectData.get())
-            ->material();
-    addMeshToDrawables(metaData, node, drawables, componentID, meshIDLocal,
-                       materialIDLocal);
+  const int meshID = metaData.meshIndex.first + meshComponent.meshIDLocal;
+  if (meshComponent.meshIDLocal != ID_UNDEFINED && meshes_[meshID]) {
+    addMeshToDrawables(metaData, node, drawables, meshComponent.componentID,
+                       meshComponent.meshIDLocal,
+                       meshComponent.materialIDLocal);
   }
 
   // Recursively add children
-  for (auto childObjectID : objectData->children()) {
-    addComponent(importer, info, metaData, node, drawables, childObjectID);
+  for (int child : meshComponent.children) {
+    addComponent(hierarchy, child, metaData, node, drawables);
   }
 }
 
@@ -1051,33 +2099,55 @@ void ResourceManager::addMeshToDrawables(const MeshMetaData& metaData,
   const int materialID = materialStart + materialIDLocal;
 
   Magnum::GL::Texture2D* texture = nullptr;
+  gfx::Drawable* drawable = nullptr;
   // Material not set / not available / not loaded, use a default material
   if (materialIDLocal == ID_UNDEFINED ||
       metaData.materialIndex.second == ID_UNDEFINED ||
       !materials_[materialID]) {
-    createDrawable(COLORED_SHADER, mesh, node, drawables, texture, componentID);
+    drawable = &createDrawable(COLORED_SHADER, mesh, node, drawables, texture,
+                               componentID);
   } else {
     if (materials_[materialID]->flags() &
         Magnum::Trade::PhongMaterialData::Flag::DiffuseTexture) {
       // Textured material. If the texture failed to load, again just use
       // a default colored material.
+      // none loaded if uploadCpuOnlyAsset() could not reopen the file
       const int textureStart = metaData.textureIndex.first;
       const int textureIndex = materials_[materialID]->diffuseTexture();
-      texture = textures_[textureStart + textureIndex].get();
+      if (textureStart != ID_UNDEFINED) {
+        texture = textures_[textureStart + textureIndex].get();
+      }
       if (texture) {
-        createDrawable(TEXTURED_SHADER, mesh, node, drawables, texture,
-                       componentID);
+        drawable = &createDrawable(TEXTURED_SHADER, mesh, node, drawables,
+                                   texture, componentID);
+        static_cast<gfx::GenericDrawable*>(drawable)->setStreamedTexture(
+            streamedTextures_[textureStart + textureIndex].get());
       } else {
         // Color-only material
-        createDrawable(COLORED_SHADER, mesh, node, drawables, texture,
-                       componentID, materials_[materialID]->diffuseColor());
+        drawable = &createDrawable(COLORED_SHADER, mesh, node, drawables,
+                                   texture, componentID,
+                                   materials_[materialID]->diffuseColor());
       }
     } else {
       // Color-only material
-      createDrawable(COLORED_SHADER, mesh, node, drawables, texture,
-                     componentID, materials_[materialID]->diffuseColor());
+      drawable = &createDrawable(COLORED_SHADER, mesh, node, drawables,
+                                 texture, componentID,
+                                 materials_[materialID]->diffuseColor());
     }
   }  // else
+  setDrawableBB(*drawable, meshes_[meshID].get());
+
+  auto* gltfMeshData = dynamic_cast<GltfMeshData*>(meshes_[meshID].get());
+  if (gltfMeshData != nullptr) {
+    static_cast<gfx::GenericDrawable*>(drawable)->setPositionDequantization(
+        gltfMeshData->getPositionDequantization());
+    static_cast<gfx::GenericDrawable*>(drawable)->setMeshData(
+        gltfMeshData->getMeshData());
+    for (int level = 0; level < gltfMeshData->getNumLODs(); ++level) {
+      drawable->addLOD(*gltfMeshData->getLODMesh(level),
+                       gltfMeshData->getLODError(level));
+    }
+  }
 }
 
 gfx::Drawable& ResourceManager::createDrawable(
@@ -1095,7 +2165,8 @@ gfx::Drawable& ResourceManager::createDrawable(
     ASSERT(shaderType != PTEX_MESH_SHADER);
     // NOTE: this is a runtime error and will never return
     return *drawable;
-  } else if (shaderType == INSTANCE_MESH_SHADER) {
+  } else if (shaderType == INSTANCE_MESH_SHADER ||
+             shaderType == INSTANCE_MESH_VERTEX_ID_SHADER) {
     auto* shader = static_cast<gfx::PrimitiveIDTexturedShader*>(
         getShaderProgram(shaderType));
     drawable = new gfx::PrimitiveIDTexturedDrawable{node, *shader, mesh, group,
@@ -1125,8 +2196,14 @@ bool ResourceManager::loadSUNCGHouseFile(const AssetInfo& houseInfo,
   pathTokens.pop_back();  // house
   const std::string basePath = Corrade::Utility::String::join(pathTokens, '/');
 
-  // store nodeIds to obtain linearized index for semantic masks
-  std::vector<std::string> nodeIds;
+  // objects of the house in node order, which is also the order of their
+  // ids in the semantic masks
+  struct HouseObject {
+    AssetInfo info;
+    std::string id;
+    Magnum::Matrix4 transformation;
+  };
+  std::vector<HouseObject> objects;
 
   for (const auto& level : levels) {
     const auto& nodes = level["nodes"].GetArray();
@@ -1138,19 +2215,6 @@ bool ResourceManager::loadSUNCGHouseFile(const AssetInfo& houseInfo,
         continue;
       }
 
-      // helper for creating object nodes
-      auto createObjectFunc = [&](const AssetInfo& info,
-                                  const std::string& id) -> scene::SceneNode& {
-        scene::SceneNode& objectNode = parent->createChild();
-        const int nodeIndex = nodeIds.size();
-        nodeIds.push_back(id);
-        objectNode.setId(nodeIndex);
-        if (info.type == AssetType::SUNCG_OBJECT) {
-          loadGeneralMeshData(info, &objectNode, drawables);
-        }
-        return objectNode;
-      };
-
       const std::string roomPath = basePath + "/room/" + houseId + "/";
       if (nodeType == "Room") {
         const std::string roomBase = roomPath + node["modelId"].GetString();
@@ -1158,16 +2222,16 @@ bool ResourceManager::loadSUNCGHouseFile(const AssetInfo& houseInfo,
         const int hideFloor = node["hideFloor"].GetInt();
         const int hideWalls = node["hideWalls"].GetInt();
         if (hideCeiling != 1) {
-          createObjectFunc({AssetType::SUNCG_OBJECT, roomBase + "c.glb"},
-                           nodeId + "c");
+          objects.push_back(
+              {{AssetType::SUNCG_OBJECT, roomBase + "c.glb"}, nodeId + "c"});
         }
         if (hideWalls != 1) {
-          createObjectFunc({AssetType::SUNCG_OBJECT, roomBase + "w.glb"},
-                           nodeId + "w");
+          objects.push_back(
+              {{AssetType::SUNCG_OBJECT, roomBase + "w.glb"}, nodeId + "w"});
         }
         if (hideFloor != 1) {
-          createObjectFunc({AssetType::SUNCG_OBJECT, roomBase + "f.glb"},
-                           nodeId + "f");
+          objects.push_back(
+              {{AssetType::SUNCG_OBJECT, roomBase + "f.glb"}, nodeId + "f"});
         }
       } else if (nodeType == "Object") {
         const std::string modelId = node["modelId"].GetString();
@@ -1180,20 +2244,45 @@ bool ResourceManager::loadSUNCGHouseFile(const AssetInfo& houseInfo,
         const AssetInfo info{
             AssetType::SUNCG_OBJECT,
             basePath + "/object/" + modelId + "/" + modelId + ".glb"};
-        createObjectFunc(info, nodeId)
-            .setTransformation(Magnum::Matrix4{transform});
+        objects.push_back({info, nodeId, Magnum::Matrix4{transform}});
       } else if (nodeType == "Box") {
         // TODO(MS): create Box geometry
-        createObjectFunc({}, nodeId);
+        objects.push_back({{}, nodeId});
       } else if (nodeType == "Ground") {
         const std::string roomBase = roomPath + node["modelId"].GetString();
         const AssetInfo info{AssetType::SUNCG_OBJECT, roomBase + "f.glb"};
-        createObjectFunc(info, nodeId);
+        objects.push_back({info, nodeId});
       } else {
         LOG(ERROR) << "Unrecognized SUNCG house node type " << nodeType;
       }
     }
   }
+
+  // Models repeat across the house but are loaded once, by
+  // loadGeneralMeshData(); read the files of the ones not loaded yet on
+  // worker threads while they are imported and uploaded here in order
+  std::vector<std::string> modelFiles;
+  for (const HouseObject& object : objects) {
+    if (object.info.type == AssetType::SUNCG_OBJECT) {
+      modelFiles.push_back(object.info.filepath);
+    }
+  }
+  std::vector<std::thread> readers = prefetchFiles(modelFiles);
+
+  for (size_t i = 0; i < objects.size(); ++i) {
+    const HouseObject& object = objects[i];
+    scene::SceneNode& objectNode = parent->createChild();
+    // linearized index for semantic masks
+    objectNode.setId(i);
+    if (object.info.type == AssetType::SUNCG_OBJECT) {
+      loadGeneralMeshData(object.info, &objectNode, drawables);
+    }
+    objectNode.setTransformation(object.transformation);
+  }
+
+  for (std::thread& thread : readers) {
+    thread.join();
+  }
   return true;
 }
 
@@ -4,12 +4,18 @@
 
 #pragma once
 
+#include <deque>
+#include <future>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
+#include <Corrade/Containers/Array.h>
 #include <Corrade/Containers/Optional.h>
+#include <Magnum/GL/GL.h>
 #include <Magnum/GL/TextureFormat.h>
 #include <Magnum/MeshTools/Compile.h>
 #include <Magnum/MeshTools/Transform.h>
@@ -20,8 +26,11 @@
 #include "BaseMesh.h"
 #include "CollisionMeshData.h"
 #include "GltfMeshData.h"
+#include "LoadTrace.h"
 #include "MeshData.h"
 #include "MeshMetaData.h"
+#include "esp/core/MemoryTracking.h"
+#include "esp/io/json.h"
 #include "esp/physics/PhysicsManager.h"
 #include "esp/scene/SceneNode.h"
 
@@ -46,7 +55,12 @@ class PhysicsManager;
 class RigidObject;
 }  // namespace physics
 namespace assets {
+class StreamedTexture;
+struct TextureAtlas;
 
+// The public functions may be called from several threads, e.g. by
+// simulators sharing the ResourceManager (and, through shared GL contexts, its
+// GPU assets), each loading and drawing on its own thread and context
 class ResourceManager {
  public:
   // Singleton
@@ -62,6 +76,26 @@ class ResourceManager {
   using Importer = Magnum::Trade::AbstractImporter;
 
   inline void compressTextures(bool newVal) { compressTextures_ = newVal; };
+  //! Reorder mesh triangles for the vertex cache and overdraw and quantize
+  //! vertex positions on load, see GltfMeshData::optimize()
+  inline void optimizeMeshes(bool newVal) { optimizeMeshes_ = newVal; };
+  //! Only upload the atlas of a PTex submesh when it is first drawn, see
+  //! PTexMeshData::setAtlasStreaming()
+  inline void streamPTexAtlases(bool newVal) { streamPTexAtlases_ = newVal; };
+  //! Load the textures of scenes as placeholders and decode and upload each
+  //! the first time a drawable using it is drawn, see StreamedTexture
+  inline void streamTextures(bool newVal) { streamTextures_ = newVal; };
+  //! Load without a GL context when disabled: meshes are decoded and
+  //! processed for their collision meshes only, nothing is uploaded, no
+  //! textures or shaders are created and loads instantiate nothing. Assets
+  //! loaded so are uploaded in place when next instantiated with the GPU
+  //! enabled. Enabled by default
+  inline void setGpuEnabled(bool enabled) { gpuEnabled_ = enabled; };
+  inline bool isGpuEnabled() const { return gpuEnabled_; };
+
+  //! Wait for the streamed textures drawn so far to load and upload them, so
+  //! that the next frame shows them all
+  void finishStreamedTextures();
 
   //! Load Scene data + instantiate scene
   //! Both load + instantiate scene
@@ -94,6 +128,19 @@ class ResourceManager {
       DrawableGroup* drawables = nullptr,
       std::string physicsFilename = "data/default.phys_scene_config.json");
 
+  //! Load Scene data + instantiate scene into a new world of physicsManager
+  //! (see physics::PhysicsManager::addWorld()), configured by the physics
+  //! config file physicsFilename, whose objects are added to the library the
+  //! first time. worldID receives the ID of the world, ID_UNDEFINED if the
+  //! scene cannot be loaded
+  bool loadSceneIntoWorld(
+      const AssetInfo& info,
+      physics::PhysicsManager& physicsManager,
+      int& worldID,
+      scene::SceneNode* parent = nullptr,
+      DrawableGroup* drawables = nullptr,
+      std::string physicsFilename = "data/default.phys_scene_config.json");
+
   // load a PhysicsSceneMetaData object from a config file
   PhysicsManagerAttributes loadPhysicsConfig(
       std::string physicsFilename = "data/default.phys_scene_config.json");
@@ -109,6 +156,37 @@ class ResourceManager {
   // filename
   int loadObject(const std::string& objPhysConfigFilename);
 
+  //! Load many objects like loadObject(), parsing their configs on up to
+  //! numThreads threads (0 for all of the pool) and reading their
+  //! mesh files in the background while earlier objects are imported and
+  //! uploaded on the calling thread, which has to hold the GL context.
+  //! Return the index in physicsObjectList_ of each, or ID_UNDEFINED
+  std::vector<int> preloadObjectLibrary(
+      const std::vector<std::string>& objPhysConfigFilenames,
+      int numThreads = 0);
+
+  //! Start decoding the CPU-side data of a scene asset in the background, so
+  //! that a later loadScene() of the same asset only has to upload it to the
+  //! GPU. PTex and instance meshes are fully decoded on
+  //! core::ThreadPool::global(); binary glTF files are read into memory on a
+  //! thread of their own. The prefetched data is held until the asset is loaded
+  //! or the prefetch is cancelled; beyond getMaxPrefetchedScenes() prefetches
+  //! in flight or unconsumed, the oldest is cancelled.
+  //! Returns false if the asset cannot be prefetched.
+  bool prefetchScene(const AssetInfo& info);
+
+  //! Drop the prefetched data of an asset, false if it was not prefetched.
+  //! Waits for a file read in flight; a decode in flight is dropped once done
+  bool cancelPrefetch(const AssetInfo& info);
+  //! Drop the prefetched data of all assets
+  void cancelPrefetches();
+
+  //! Most prefetchScene() prefetches in flight or unconsumed at once, at
+  //! least 1; 4 by default, so that two scenes with their semantic meshes can
+  //! be ahead
+  void setMaxPrefetchedScenes(int maxPrefetchedScenes);
+  int getMaxPrefetchedScenes() const { return maxPrefetchedScenes_; }
+
   //======== Accessor functions ========
   const std::vector<assets::CollisionMeshData>& getCollisionMesh(
       const std::string configFile);
@@ -128,31 +206,111 @@ class ResourceManager {
     return meshes_[meshIndex]->meshTransform_;
   }
 
+  //======== Scene asset cache ========
+  //! Scenes are cached by the absolute path of their asset. Loading a scene
+  //! with a parent node holds a reference on its assets until the matching
+  //! releaseScene(). Unreferenced scenes stay resident, so that switching back
+  //! to them costs no reload, until the cached scenes exceed the budget; then
+  //! the least recently used unreferenced scenes are evicted from the GPU.
+  //! The size of a scene is the GPU memory of its meshes and textures, see
+  //! getMemoryStats(), or the size of its asset file if it has none.
+  void releaseScene(const AssetInfo& info);
+
+  //! Budget of the scene asset cache in bytes, 0 (default) is unlimited
+  void setAssetCacheBudget(size_t budgetInBytes);
+  size_t getAssetCacheBudget() const { return assetCacheBudget_; }
+
+  //! Total size of the cached scenes, referenced or not
+  size_t getAssetCacheSize() const;
+
+  //======== GPU memory ========
+  //! GPU memory of the loaded assets, counted as their buffers and textures
+  //! are allocated
+  struct MemoryStats {
+    //! buffers and mesh textures, e.g. PTex atlases, of all meshes
+    size_t meshBytes = 0;
+    //! material textures
+    size_t textureBytes = 0;
+    //! meshes and textures of each loaded asset, by absolute path
+    std::map<std::string, size_t> assetBytes;
+  };
+  MemoryStats getMemoryStats() const;
+
+  //======== Load trace ========
+  //! Time of each stage of the last loadScene() or loadSceneIntoWorld(),
+  //! physics included, with the GPU memory of its asset
+  LoadTrace getLoadTrace() const;
+
  protected:
   //======== Scene Functions ========
-  //! Instantiate Scene:
+  //! Object of the scene hierarchy of an asset, kept from loading so that
+  //! the asset can be instantiated again without its importer
+  struct MeshComponent {
+    //! object id in the importer, which drawables use as object id
+    int componentID = ID_UNDEFINED;
+    Magnum::Matrix4 transformation;
+    //! mesh and material of the object in the asset, ID_UNDEFINED without
+    int meshIDLocal = ID_UNDEFINED;
+    int materialIDLocal = ID_UNDEFINED;
+    //! indices of the children in MeshHierarchy::components
+    std::vector<int> children;
+  };
+
+  struct MeshHierarchy {
+    std::vector<MeshComponent> components;
+    //! indices of the top level objects in components
+    std::vector<int> roots;
+  };
+
+  //! Read the objects under rootIDs from importer into hierarchy, skipping
+  //! those the importer cannot load
+  void loadMeshHierarchy(Importer& importer,
+                         const std::vector<Magnum::UnsignedInt>& rootIDs,
+                         MeshHierarchy& hierarchy);
+
+  //! Instantiate a component of an asset and its children:
   //! (1) create scene node
-  //! (2) upload mesh to gpu and drawables
-  //! (optional reload of GPU-side assets)
-  void addComponent(Importer& importer,
-                    const AssetInfo& info,
+  //! (2) add drawables of the meshes uploaded to the gpu
+  void addComponent(const MeshHierarchy& hierarchy,
+                    int component,
                     const MeshMetaData& metaData,
                     scene::SceneNode& parent,
-                    DrawableGroup* drawables,
-                    int objectID);
-
-  //! Load textures from importer into assets, and update metaData
-  void loadTextures(Importer& importer, MeshMetaData* metaData);
-
-  //! Load meshes from importer into assets, and update metaData
+                    DrawableGroup* drawables);
+
+  //! Load textures from importer into assets, and update metaData. With
+  //! compressTextures, the compressed mip chains datatool made for filename
+  //! are uploaded as they are, see TextureCompression.h. The textures packed
+  //! into atlas share its texture
+  void loadTextures(Importer& importer,
+                    MeshMetaData* metaData,
+                    const std::string& filename,
+                    const TextureAtlas* atlas = nullptr);
+
+  //! Load meshes from importer into assets, and update metaData. The levels
+  //! of detail datatool made for filename are uploaded with the meshes, see
+  //! MeshSimplification.h. Texture coordinates of meshes with a texture
+  //! packed into atlas are moved into it
   void loadMeshes(Importer& importer,
                   MeshMetaData* metaData,
+                  const std::string& filename,
                   bool shiftOrigin = false,
-                  Magnum::Vector3 offset = Magnum::Vector3(0, 0, 0));
+                  Magnum::Vector3 offset = Magnum::Vector3(0, 0, 0),
+                  const TextureAtlas* atlas = nullptr);
 
   //! Load materials from importer into assets, and update metaData
   void loadMaterials(Importer& importer, MeshMetaData* metaData);
 
+  //! Add the collision mesh of the loaded scene info to world, with the scene
+  //! properties of physicsManagerAttributes
+  bool addPhysicsScene(const AssetInfo& info,
+                       const PhysicsManagerAttributes& physicsManagerAttributes,
+                       physics::PhysicsManager& world);
+
+  //! Load the simplified collision meshes of the scene info into
+  //! sceneCollisionMeshes_, once; false if there are none of its numMeshes
+  //! meshes
+  bool loadSceneCollisionMeshes(const AssetInfo& info, int numMeshes);
+
   bool loadPTexMeshData(const AssetInfo& info,
                         scene::SceneNode* parent,
                         DrawableGroup* drawables);
@@ -178,6 +336,19 @@ class ResourceManager {
                           scene::SceneNode* parent,
                           DrawableGroup* drawables);
 
+  // upload the meshes and load the textures of filename if it was loaded
+  // with the GPU disabled and the GPU is enabled now, see setGpuEnabled()
+  void uploadCpuOnlyAsset(const std::string& filename);
+
+  // open filename with importer, from fileData if it was prefetched, along
+  // with the texture atlas of its textures if it has a matching one; false
+  // if it cannot be opened
+  bool openSceneFile(Importer& importer,
+                     const std::string& filename,
+                     const Corrade::Containers::Array<char>& fileData,
+                     TextureAtlas& atlas,
+                     bool& atlased);
+
   // ======== Geometry helper functions ========
   // void shiftMeshDataToOrigin(GltfMeshData* meshDataGL);
 
@@ -186,22 +357,113 @@ class ResourceManager {
   // compute center of axis aligned mesh bounding box
   Magnum::Vector3 computeMeshBBCenter(GltfMeshData* meshDataGL);
 
+  //! Bounding box of the (collision) vertex positions of a mesh
+  Magnum::Range3D computeMeshBB(BaseMesh* meshDataGL);
+
+  //! Give a drawable of meshDataGL its bounding box for frustum culling
+  void setDrawableBB(gfx::Drawable& drawable, BaseMesh* meshDataGL);
+
   // ======== General geometry data ========
   // shared_ptr is used here, instead of Corrade::Containers::Optional, or
   // std::optional because shared_ptr is reference type, not value type, and
   // thus we can avoiding duplicated loading
   std::vector<std::shared_ptr<BaseMesh>> meshes_;
   std::vector<std::shared_ptr<Magnum::GL::Texture2D>> textures_;
+  //! GPU bytes of each of textures_
+  std::vector<size_t> textureMemoryBytes_;
+  //! streaming state of each of textures_, nullptr for textures loaded whole
+  std::vector<std::shared_ptr<StreamedTexture>> streamedTextures_;
+  //! GPU bytes of textures_[textureID], placeholder or whole
+  size_t getTextureMemoryBytes(int textureID) const;
   std::vector<std::shared_ptr<Magnum::Trade::PhongMaterialData>> materials_;
+  // slots of meshes_, textures_ (and its parallel vectors) and materials_
+  // freed by evicted scenes, as sorted [first, last] ranges like those of
+  // MeshMetaData. Loads take their slots from them before appending, so the
+  // vectors grow to the most slots live at once plus fragmentation, not with
+  // every scene a worker cycles through
+  std::vector<std::pair<int, int>> freeMeshSlots_;
+  std::vector<std::pair<int, int>> freeTextureSlots_;
+  std::vector<std::pair<int, int>> freeMaterialSlots_;
+  //! First of count contiguous slots, from the first large enough range of
+  //! freeSlots, or size if none is, in which case the slots are appended
+  static int allocateSlots(std::vector<std::pair<int, int>>& freeSlots,
+                           int size,
+                           int count);
+  //! Give the [first, last] slots back to freeSlots
+  static void releaseSlots(std::vector<std::pair<int, int>>& freeSlots,
+                           const std::pair<int, int>& slots);
 
   Magnum::GL::Mesh* instance_mesh_;
 
   // a dictionary to check if a mesh has been loaded
   // maps: absolutePath -> meshMetaData
   std::map<std::string, MeshMetaData> resourceDict_;  // meshes
-  std::map<std::string, std::vector<Magnum::UnsignedInt>>
-      magnumMeshDict_;  // IDs for object mesh hierarchies NOTE: needed? to
-                        // bypass "importer" reload
+  // maps: absolutePath -> object hierarchy, to instantiate loaded assets
+  // without reopening them
+  std::map<std::string, MeshHierarchy> magnumMeshDict_;
+  // maps: absolutePath -> type, of the assets loaded with the GPU disabled
+  // and not uploaded yet, see uploadCpuOnlyAsset()
+  std::map<std::string, AssetType> cpuOnlyAssets_;
+
+  // ======== Scene asset cache ========
+  struct CachedScene {
+    //! number of loadScene() instantiations not yet released
+    int refCount = 0;
+    //! value of sceneCacheClock_ at the last acquire or release
+    uint64_t lastUsed = 0;
+    size_t sizeInBytes = 0;
+  };
+  // maps: absolutePath -> cache entry, only for scenes loaded with a parent
+  std::map<std::string, CachedScene> sceneCache_;
+  uint64_t sceneCacheClock_ = 0;
+  size_t assetCacheBudget_ = 0;
+
+  void acquireScene(const std::string& filepath);
+
+  //! GPU bytes of the meshes and textures of an asset
+  size_t getAssetMemoryBytes(const MeshMetaData& metaData) const;
+
+  //! Free the GPU assets and collision data of least recently used
+  //! unreferenced scenes until the cache fits into the budget. Scenes that
+  //! are also the mesh of a library object stay, object IDs stay valid
+  void evictUnusedScenes();
+
+  //! Whether filepath is the render or collision mesh of a library object
+  bool isObjectAsset(const std::string& filepath) const;
+
+  // ======== Scene prefetching ========
+  struct PrefetchedScene {
+    //! decoded mesh, for PTex and instance meshes
+    std::unique_ptr<BaseMesh> mesh;
+    //! file contents, for binary glTF files
+    Corrade::Containers::Array<char> fileData;
+  };
+  // maps: absolutePath -> prefetch in flight or done
+  std::map<std::string, std::future<PrefetchedScene>> prefetchedScenes_;
+  // paths of the prefetchScene() entries of prefetchedScenes_, oldest first
+  std::deque<std::string> prefetchOrder_;
+  int maxPrefetchedScenes_ = 4;
+
+  //! Wait for and take the prefetched data of an asset; returns an empty
+  //! PrefetchedScene if the asset was not prefetched
+  PrefetchedScene takePrefetchedScene(const std::string& filepath);
+
+  //! Read the binary glTF files among files that are neither loaded nor in
+  //! flight into prefetchedScenes_, on up to numThreads threads (0 for one
+  //! per hardware thread). The caller joins the returned threads
+  std::vector<std::thread> prefetchFiles(const std::vector<std::string>& files,
+                                         int numThreads = 0);
+
+  // ======== Physical objects ========
+  //! Parse the physics properties file of an object, false if it is missing
+  //! or malformed. Touches no state, so that it can run on worker threads
+  static bool parseObjectConfig(const std::string& objPhysConfigFilename,
+                                io::JsonDocument& objPhysicsConfig);
+
+  //! Load an object from its parsed physics properties, the part of
+  //! loadObject() after parsing
+  int loadObject(const std::string& objPhysConfigFilename,
+                 const io::JsonDocument& objPhysicsConfig);
 
   // ======== Physical geometry data ========
   // library of physics object parameters mapped from config filename (used by
@@ -217,6 +479,21 @@ class ResourceManager {
   // maps: "data/objects/cheezit.phys_properties.json" -> collesionMesh group
   std::map<std::string, std::vector<CollisionMeshData>>
       collisionMeshGroups_;  // meshes for the object hierarchies
+  // convex decompositions of object collision meshes, referenced by
+  // collisionMeshGroups_ instead of the mesh components
+  struct CollisionHull {
+    std::vector<Magnum::Vector3,
+                core::TrackedAllocator<Magnum::Vector3, core::MemoryTag::Assets>>
+        positions;
+    std::vector<
+        Magnum::UnsignedInt,
+        core::TrackedAllocator<Magnum::UnsignedInt, core::MemoryTag::Assets>>
+        indices;
+  };
+  std::map<std::string, std::vector<CollisionHull>> collisionHulls_;
+  // simplified static collision meshes of scenes, by scene file, referenced
+  // by the scene colliders instead of the render meshes
+  std::map<std::string, std::vector<CollisionHull>> sceneCollisionMeshes_;
   // vector of "data/objects/cheezit.phys_properties.json"
   std::vector<std::string>
       physicsObjectConfigList_;  // NOTE: can't get keys from the map (easily),
@@ -243,13 +520,19 @@ class ResourceManager {
     COLORED_SHADER = 2,
     VERTEX_COLORED_SHADER = 3,
     TEXTURED_SHADER = 4,
+    //! instance meshes with the object ids in their vertices
+    INSTANCE_MESH_VERTEX_ID_SHADER = 5,
   };
 
-  // maps a name to the shader program
-  std::map<ShaderType, std::shared_ptr<Magnum::GL::AbstractShaderProgram>>
+  // maps: current GL context, shader type -> shader program. Contexts sharing
+  // objects could share programs too, but not their uniforms, which every
+  // draw sets
+  std::map<std::pair<Magnum::GL::Context*, ShaderType>,
+           std::shared_ptr<Magnum::GL::AbstractShaderProgram>>
       shaderPrograms_;
 
-  //! Return Shader of given type, creating if necessary
+  //! Return Shader of given type for the current GL context, creating if
+  //! necessary
   Magnum::GL::AbstractShaderProgram* getShaderProgram(ShaderType type);
 
   //! Create a Drawable with given ShaderType for the given Mesh and SceneNode
@@ -266,6 +549,16 @@ class ResourceManager {
       const Magnum::Color4& color = Magnum::Color4{1});
 
   bool compressTextures_ = false;
+  bool optimizeMeshes_ = false;
+  bool streamPTexAtlases_ = false;
+  bool streamTextures_ = false;
+  bool gpuEnabled_ = true;
+
+  //! Written by the outermost load, see getLoadTrace()
+  LoadTrace loadTrace_;
+
+  //! Held by the public functions, which call each other
+  mutable std::recursive_mutex mutex_;
 };
 
 }  // namespace assets
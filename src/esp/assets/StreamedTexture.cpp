@@ -0,0 +1,216 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#include "StreamedTexture.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include <Corrade/Containers/ArrayViewStl.h>
+#include <Magnum/GL/Texture.h>
+#include <Magnum/ImageView.h>
+#include <Magnum/Math/Color.h>
+#include <Magnum/Math/Functions.h>
+#include <Magnum/PixelFormat.h>
+
+#include "esp/core/ThreadPool.h"
+
+namespace Cr = Corrade;
+namespace Mn = Magnum;
+
+namespace esp {
+namespace assets {
+
+namespace {
+// sides of the largest precompressed level a placeholder has, in texels
+constexpr int placeholderSize = 16;
+}  // namespace
+
+size_t textureMemoryBytes(Mn::GL::TextureFormat format,
+                          const Mn::Vector2i& size,
+                          int levels) {
+  const bool dxt1 = format == Mn::GL::TextureFormat::CompressedRGBS3tcDxt1 ||
+                    format == Mn::GL::TextureFormat::CompressedRGBAS3tcDxt1;
+  size_t bytes = 0;
+  for (int level = 0; level < levels; ++level) {
+    const size_t width = std::max(1, size.x() >> level);
+    const size_t height = std::max(1, size.y() >> level);
+    // DXT1 stores blocks of 4x4 texels in 8 bytes
+    bytes += dxt1 ? ((width + 3) / 4) * ((height + 3) / 4) * 8
+                  : width * height * 4;
+  }
+  return bytes;
+}
+
+int placeholderLevel(int width, int height, int maxSize) {
+  int level = 0;
+  while (std::max(width >> level, height >> level) > maxSize) {
+    ++level;
+  }
+  return level;
+}
+
+Cr::Containers::Optional<Mn::Trade::ImageData2D>
+StreamedTextureSource::image2D(unsigned int image) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!opened_) {
+    opened_ = true;
+    manager_.setPreferredPlugins("GltfImporter", {"TinyGltfImporter"});
+#ifdef ESP_BUILD_ASSIMP_SUPPORT
+    manager_.setPreferredPlugins("ObjImporter", {"AssimpImporter"});
+#endif
+    importer_ = manager_.loadAndInstantiate("AnySceneImporter");
+    if (importer_ && !importer_->openFile(filename_)) {
+      LOG(ERROR) << "Cannot open file " << filename_ << " to stream textures";
+      importer_ = nullptr;
+    }
+  }
+  if (!importer_) {
+    return Cr::Containers::NullOpt;
+  }
+  return importer_->image2D(image);
+}
+
+StreamedTexture::StreamedTexture(std::shared_ptr<Mn::GL::Texture2D> texture,
+                                 const Sampling& sampling,
+                                 StreamedTextureSource::ptr source,
+                                 unsigned int image,
+                                 bool compress)
+    : texture_(std::move(texture)),
+      sampling_(sampling),
+      source_(std::move(source)),
+      image_(image),
+      compress_(compress) {
+  // a single grey texel, the mean of no information
+  const Mn::Color4ub grey{128, 128, 128, 255};
+  texture_->setMagnificationFilter(sampling_.magnificationFilter)
+      .setMinificationFilter(sampling_.minificationFilter,
+                             sampling_.mipmapFilter)
+      .setWrapping(sampling_.wrapping)
+      .setStorage(1, Mn::GL::TextureFormat::RGBA8, {1, 1})
+      .setSubImage(0, {},
+                   Mn::ImageView2D{Mn::PixelFormat::RGBA8Unorm,
+                                   {1, 1},
+                                   Cr::Containers::ArrayView<const void>{
+                                       &grey, sizeof(grey)}});
+  memoryBytes_ = textureMemoryBytes(Mn::GL::TextureFormat::RGBA8, {1, 1}, 1);
+}
+
+StreamedTexture::StreamedTexture(std::shared_ptr<Mn::GL::Texture2D> texture,
+                                 const Sampling& sampling,
+                                 CompressedTexture compressed)
+    : texture_(std::move(texture)),
+      sampling_(sampling),
+      compressed_(std::move(compressed)) {
+  CORRADE_INTERNAL_ASSERT(!compressed_.levels.empty());
+  const int level =
+      std::min(placeholderLevel(compressed_.width, compressed_.height,
+                                placeholderSize),
+               static_cast<int>(compressed_.levels.size()) - 1);
+  *texture_ = createCompressed(level);
+}
+
+Mn::GL::Texture2D StreamedTexture::createCompressed(int level) {
+  const int numLevels = compressed_.levels.size();
+  const Mn::Vector2i size{std::max(1, compressed_.width >> level),
+                          std::max(1, compressed_.height >> level)};
+  Mn::GL::Texture2D texture;
+  texture.setMagnificationFilter(sampling_.magnificationFilter)
+      .setMinificationFilter(sampling_.minificationFilter,
+                             sampling_.mipmapFilter)
+      .setWrapping(sampling_.wrapping)
+      .setStorage(numLevels - level,
+                  Mn::GL::TextureFormat::CompressedRGBS3tcDxt1, size);
+  memoryBytes_ = 0;
+  for (int i = level; i < numLevels; ++i) {
+    const Mn::Vector2i levelSize{std::max(1, compressed_.width >> i),
+                                 std::max(1, compressed_.height >> i)};
+    texture.setCompressedSubImage(
+        i - level, {},
+        Mn::CompressedImageView2D{
+            Mn::CompressedPixelFormat::Bc1RGBUnorm, levelSize,
+            Cr::Containers::arrayView(compressed_.levels[i])});
+    memoryBytes_ += compressed_.levels[i].size();
+  }
+  return texture;
+}
+
+bool StreamedTexture::request() {
+  if (resident_) {
+    return true;
+  }
+  if (!requested_) {
+    requested_ = true;
+    if (source_ == nullptr) {
+      // the precompressed chain is in memory already, no decoding needed
+      uploadCompressed();
+      return true;
+    }
+    StreamedTextureSource::ptr source = source_;
+    const unsigned int image = image_;
+    decoded_ = core::ThreadPool::global().async(
+        [source, image]() { return source->image2D(image); });
+    return false;
+  }
+  if (decoded_.wait_for(std::chrono::seconds(0)) !=
+      std::future_status::ready) {
+    return false;
+  }
+  finish();
+  return true;
+}
+
+void StreamedTexture::finish() {
+  if (resident_ || !requested_) {
+    return;
+  }
+  Cr::Containers::Optional<Mn::Trade::ImageData2D> image = decoded_.get();
+  // the source is only needed until the image is decoded
+  source_ = nullptr;
+  resident_ = true;
+  if (!image) {
+    LOG(ERROR) << "Cannot load texture image " << image_
+               << ", keeping its placeholder";
+    return;
+  }
+  upload(*image);
+}
+
+void StreamedTexture::uploadCompressed() {
+  *texture_ = createCompressed(0);
+  // the chain is on the GPU now
+  compressed_ = CompressedTexture{};
+  resident_ = true;
+}
+
+void StreamedTexture::upload(Mn::Trade::ImageData2D& image) {
+  Mn::GL::TextureFormat format;
+  if (image.format() == Mn::PixelFormat::RGB8Unorm) {
+    format = compress_ ? Mn::GL::TextureFormat::CompressedRGBS3tcDxt1
+                       : Mn::GL::TextureFormat::RGB8;
+  } else if (image.format() == Mn::PixelFormat::RGBA8Unorm) {
+    format = compress_ ? Mn::GL::TextureFormat::CompressedRGBAS3tcDxt1
+                       : Mn::GL::TextureFormat::RGBA8;
+  } else {
+    LOG(ERROR) << "Cannot load texture image " << image_
+               << ", keeping its placeholder";
+    return;
+  }
+
+  const int levels = Mn::Math::log2(image.size().max()) + 1;
+  Mn::GL::Texture2D texture;
+  texture.setMagnificationFilter(sampling_.magnificationFilter)
+      .setMinificationFilter(sampling_.minificationFilter,
+                             sampling_.mipmapFilter)
+      .setWrapping(sampling_.wrapping)
+      .setStorage(levels, format, image.size())
+      .setSubImage(0, {}, image)
+      .generateMipmap();
+  // moving into the shared texture deletes the placeholder
+  *texture_ = std::move(texture);
+  memoryBytes_ = textureMemoryBytes(format, image.size(), levels);
+}
+
+}  // namespace assets
+}  // namespace esp
@@ -0,0 +1,133 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#pragma once
+
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include <Corrade/Containers/Optional.h>
+#include <Corrade/PluginManager/Manager.h>
+#include <Magnum/Array.h>
+#include <Magnum/GL/GL.h>
+#include <Magnum/GL/TextureFormat.h>
+#include <Magnum/Math/Vector2.h>
+#include <Magnum/Sampler.h>
+#include <Magnum/Trade/AbstractImporter.h>
+#include <Magnum/Trade/ImageData.h>
+
+#include "TextureCompression.h"
+#include "esp/core/esp.h"
+
+namespace esp {
+namespace assets {
+
+//! GPU bytes of a texture of format with levels mip levels from size down;
+//! uncompressed RGB texels are padded to 4 bytes by most drivers
+size_t textureMemoryBytes(Magnum::GL::TextureFormat format,
+                          const Magnum::Vector2i& size,
+                          int levels);
+
+//! Largest mip level of a width x height texture whose sides are at most
+//! maxSize, the level streamed textures start out with
+int placeholderLevel(int width, int height, int maxSize);
+
+//! Importer of a scene file of its own, shared by its streamed textures, so
+//! that their images decode on worker threads while the ResourceManager
+//! imports other files. The file is opened by the first decode. Importers
+//! are not thread safe, so one image of the file decodes at a time
+class StreamedTextureSource {
+ public:
+  explicit StreamedTextureSource(const std::string& filename)
+      : filename_(filename) {}
+
+  //! Decode image of the file, on any thread
+  Corrade::Containers::Optional<Magnum::Trade::ImageData2D> image2D(
+      unsigned int image);
+
+ protected:
+  std::string filename_;
+  // the manager has to outlive its importer
+  Corrade::PluginManager::Manager<Magnum::Trade::AbstractImporter> manager_;
+  std::unique_ptr<Magnum::Trade::AbstractImporter> importer_;
+  bool opened_ = false;
+  std::mutex mutex_;
+
+  ESP_SMART_POINTERS(StreamedTextureSource)
+};
+
+/**
+@brief Texture of a scene that is drawn with a placeholder until it is seen
+
+The texture starts with a placeholder: the levels of its precompressed mip
+chain up to 16 texels, or a single grey texel without one. The first
+@ref request(), from a drawable that passed culling, decodes the image on
+@ref core::ThreadPool::global(), or takes the precompressed chain, which
+needs no decoding. A later request uploads it on the thread of the GL
+context, replacing the placeholder in the same @ref Magnum::GL::Texture2D, so
+that drawables keep their texture pointer.
+*/
+class StreamedTexture {
+ public:
+  //! Sampling of the texture, from its Magnum::Trade::TextureData
+  struct Sampling {
+    Magnum::SamplerFilter magnificationFilter;
+    Magnum::SamplerFilter minificationFilter;
+    Magnum::SamplerMipmap mipmapFilter;
+    Magnum::Array2D<Magnum::SamplerWrapping> wrapping;
+  };
+
+  //! Stream image of source into texture, compressed by the driver if
+  //! compress is set
+  StreamedTexture(std::shared_ptr<Magnum::GL::Texture2D> texture,
+                  const Sampling& sampling,
+                  StreamedTextureSource::ptr source,
+                  unsigned int image,
+                  bool compress);
+
+  //! Stream a precompressed mip chain into texture
+  StreamedTexture(std::shared_ptr<Magnum::GL::Texture2D> texture,
+                  const Sampling& sampling,
+                  CompressedTexture compressed);
+
+  //! Start loading the full texture the first time, upload it once it is
+  //! loaded. True once the full texture is uploaded; the texture drawables
+  //! bound before may be deleted by the upload
+  bool request();
+
+  //! Wait for a requested texture to load and upload it
+  void finish();
+
+  bool isRequested() const { return requested_; }
+  bool isResident() const { return resident_; }
+
+  //! GPU bytes of the placeholder or the full texture
+  size_t getMemoryBytes() const { return memoryBytes_; }
+
+ protected:
+  void upload(Magnum::Trade::ImageData2D& image);
+  void uploadCompressed();
+  // a texture with the levels of compressed_ from level on
+  Magnum::GL::Texture2D createCompressed(int level);
+
+  std::shared_ptr<Magnum::GL::Texture2D> texture_;
+  Sampling sampling_;
+  StreamedTextureSource::ptr source_;
+  unsigned int image_ = 0;
+  bool compress_ = false;
+  CompressedTexture compressed_;
+
+  bool requested_ = false;
+  bool resident_ = false;
+  std::future<Corrade::Containers::Optional<Magnum::Trade::ImageData2D>>
+      decoded_;
+  size_t memoryBytes_ = 0;
+
+  ESP_SMART_POINTERS(StreamedTexture)
+};
+
+}  // namespace assets
+}  // namespace esp
@@ -0,0 +1,197 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#include "TextureAtlas.h"
+
+#include <algorithm>
+#include <numeric>
+
+#include <Magnum/Math/Functions.h>
+
+#include "esp/io/cache.h"
+
+namespace Mn = Magnum;
+
+namespace esp {
+namespace assets {
+
+namespace {
+const uint32_t textureAtlasCacheKind = 109;
+const uint32_t textureAtlasCacheVersion = 1;
+
+int roundUpToPadding(int size) {
+  return (size + textureAtlasPadding - 1) / textureAtlasPadding *
+         textureAtlasPadding;
+}
+
+// shelf packing of the padded sizes in order into an atlas width wide,
+// returning its height
+int packShelves(const std::vector<Mn::Vector2i>& paddedSizes,
+                const std::vector<size_t>& order,
+                int width,
+                std::vector<AtlasPlacement>& placements) {
+  int x = 0, shelfY = 0, shelfHeight = 0;
+  for (size_t i : order) {
+    const Mn::Vector2i& size = paddedSizes[i];
+    if (x + size.x() > width) {
+      x = 0;
+      shelfY += shelfHeight;
+      shelfHeight = 0;
+    }
+    placements[i].x = x + textureAtlasPadding;
+    placements[i].y = shelfY + textureAtlasPadding;
+    x += size.x();
+    shelfHeight = std::max(shelfHeight, size.y());
+  }
+  return shelfY + shelfHeight;
+}
+}  // namespace
+
+Mn::Vector2 TextureAtlas::remap(int texture,
+                                const Mn::Vector2& textureCoordinates) const {
+  const AtlasPlacement& placement = placements[texture];
+  return {(placement.x + textureCoordinates.x() * placement.width) / width,
+          (placement.y + textureCoordinates.y() * placement.height) / height};
+}
+
+int TextureAtlas::levels() const {
+  return std::min(Mn::Math::log2(std::max(width, height)),
+                  Mn::Math::log2(textureAtlasPadding)) +
+         1;
+}
+
+bool TextureAtlas::hasPackedTextures() const {
+  return std::any_of(
+      placements.begin(), placements.end(),
+      [](const AtlasPlacement& placement) { return placement.isPacked(); });
+}
+
+bool packTextureAtlas(const std::vector<Mn::Vector2i>& sizes,
+                      int maxSize,
+                      std::vector<AtlasPlacement>& placements,
+                      Mn::Vector2i& atlasSize) {
+  std::vector<Mn::Vector2i> paddedSizes;
+  size_t area = 0;
+  int minWidth = textureAtlasPadding;
+  for (const Mn::Vector2i& size : sizes) {
+    paddedSizes.emplace_back(
+        roundUpToPadding(size.x() + 2 * textureAtlasPadding),
+        roundUpToPadding(size.y() + 2 * textureAtlasPadding));
+    area += size_t(paddedSizes.back().product());
+    minWidth = std::max(minWidth, paddedSizes.back().x());
+  }
+  std::vector<size_t> order(sizes.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    return paddedSizes[a].y() > paddedSizes[b].y();
+  });
+
+  placements.assign(sizes.size(), AtlasPlacement{});
+  for (size_t i = 0; i < sizes.size(); ++i) {
+    placements[i].width = sizes[i].x();
+    placements[i].height = sizes[i].y();
+  }
+  // the narrowest power of two width the shelves fit in square or shorter
+  int width = 1;
+  while (width < minWidth || size_t(width) * width < area) {
+    width *= 2;
+  }
+  for (; width <= maxSize; width *= 2) {
+    const int height = packShelves(paddedSizes, order, width, placements);
+    if (height <= width) {
+      atlasSize = {width, std::max(height, textureAtlasPadding)};
+      return true;
+    }
+  }
+  return false;
+}
+
+void copyIntoTextureAtlas(TextureAtlas& atlas,
+                          const AtlasPlacement& placement,
+                          const uint8_t* pixels,
+                          int channels) {
+  const int p = textureAtlasPadding;
+  for (int y = -p; y < placement.height + p; ++y) {
+    const int sourceY = std::min(std::max(y, 0), placement.height - 1);
+    for (int x = -p; x < placement.width + p; ++x) {
+      const int sourceX = std::min(std::max(x, 0), placement.width - 1);
+      const uint8_t* source =
+          pixels + (size_t(sourceY) * placement.width + sourceX) * channels;
+      uint8_t* target =
+          &atlas.pixels[(size_t(placement.y + y) * atlas.width +
+                         placement.x + x) *
+                        atlas.channels];
+      for (int k = 0; k < atlas.channels; ++k) {
+        // opaque where the texture has no alpha
+        target[k] = k < channels ? source[k] : 255;
+      }
+    }
+  }
+}
+
+std::string textureAtlasFilename(const std::string& sceneFile) {
+  return io::cacheFilename(sceneFile + ".atlas");
+}
+
+bool saveTextureAtlas(const std::string& file,
+                      const TextureAtlas& atlas,
+                      const std::string& sourceFile) {
+  // (width, height, channels), the placements as (x, y, width, height), the
+  // textures of the meshes, then the pixels
+  const std::vector<int32_t> header{atlas.width, atlas.height,
+                                    atlas.channels};
+  std::vector<int32_t> placements;
+  for (const AtlasPlacement& placement : atlas.placements) {
+    placements.insert(placements.end(), {placement.x, placement.y,
+                                         placement.width, placement.height});
+  }
+  io::CacheWriter writer(textureAtlasCacheKind, textureAtlasCacheVersion,
+                         sourceFile);
+  writer.addSection(header);
+  writer.addSection(placements);
+  writer.addSection(atlas.meshTextures);
+  writer.addSection(atlas.pixels);
+  return writer.write(file);
+}
+
+bool loadTextureAtlas(const std::string& file,
+                      const std::string& sourceFile,
+                      TextureAtlas& atlas) {
+  const io::CacheReader reader(file, textureAtlasCacheKind,
+                               textureAtlasCacheVersion, sourceFile);
+  std::vector<int32_t> header;
+  std::vector<int32_t> placements;
+  TextureAtlas loaded;
+  if (!reader.isValid() || !reader.readSection(0, header) ||
+      header.size() != 3 || !reader.readSection(1, placements) ||
+      placements.size() % 4 != 0 ||
+      !reader.readSection(2, loaded.meshTextures) ||
+      !reader.readSection(3, loaded.pixels)) {
+    return false;
+  }
+  loaded.width = header[0];
+  loaded.height = header[1];
+  loaded.channels = header[2];
+  if (loaded.width <= 0 || loaded.height <= 0 ||
+      (loaded.channels != 3 && loaded.channels != 4) ||
+      loaded.pixels.size() !=
+          size_t(loaded.width) * loaded.height * loaded.channels) {
+    return false;
+  }
+  for (size_t i = 0; i < placements.size(); i += 4) {
+    loaded.placements.push_back({placements[i], placements[i + 1],
+                                 placements[i + 2], placements[i + 3]});
+  }
+  for (int32_t texture : loaded.meshTextures) {
+    if (texture >= int32_t(loaded.placements.size()) ||
+        (texture >= 0 && !loaded.placements[texture].isPacked())) {
+      return false;
+    }
+  }
+  atlas = std::move(loaded);
+  return true;
+}
+
+}  // namespace assets
+}  // namespace esp
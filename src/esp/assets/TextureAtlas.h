@@ -0,0 +1,92 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <Magnum/Math/Vector2.h>
+
+namespace esp {
+namespace assets {
+
+// Texture atlases of objects with many small textures, made ahead of time by
+// datatool create_texture_atlas. The textures of an object are packed into
+// one image and the texture coordinates of its meshes are remapped into it,
+// so that all its drawables share one texture and batch together.
+
+//! Texels of edge-extended border around each texture of an atlas. Textures
+//! start at multiples of it and the atlas has mip levels down to 1/padding,
+//! so that texels of a level never mix two textures
+constexpr int textureAtlasPadding = 8;
+
+//! Rectangle of a texture in an atlas, in texels, without the padding
+struct AtlasPlacement {
+  int x = 0;
+  int y = 0;
+  int width = 0;
+  int height = 0;
+
+  bool isPacked() const { return width > 0; }
+};
+
+//! The atlas of the textures of a scene file, rows bottom first like Magnum
+//! images, with the placement of each texture in the order of its importer,
+//! not packed for textures left out
+struct TextureAtlas {
+  int width = 0;
+  int height = 0;
+  //! 3 for RGB8, 4 for RGBA8
+  int channels = 0;
+  std::vector<uint8_t> pixels;
+  std::vector<AtlasPlacement> placements;
+  //! texture each mesh of the file samples, whose placement its texture
+  //! coordinates are remapped into, -1 for meshes left as they are
+  std::vector<int32_t> meshTextures;
+
+  //! Texture coordinates of textureCoordinates of texture in the atlas
+  Magnum::Vector2 remap(int texture,
+                        const Magnum::Vector2& textureCoordinates) const;
+
+  //! Mip levels the atlas has, see textureAtlasPadding
+  int levels() const;
+
+  //! False for the atlas of an object with too few textures to pack
+  bool hasPackedTextures() const;
+};
+
+//! Pack rectangles of sizes into an atlas at most maxSize wide and high, with
+//! textureAtlasPadding around each, by shelves of decreasing height. False
+//! if they do not fit
+bool packTextureAtlas(const std::vector<Magnum::Vector2i>& sizes,
+                      int maxSize,
+                      std::vector<AtlasPlacement>& placements,
+                      Magnum::Vector2i& atlasSize);
+
+//! Copy a width x height image with channels per texel, rows stored
+//! consecutively without padding, into atlas at placement, extending its
+//! edges over the padding around it
+void copyIntoTextureAtlas(TextureAtlas& atlas,
+                          const AtlasPlacement& placement,
+                          const uint8_t* pixels,
+                          int channels);
+
+//! File the texture atlas of a scene is stored in, next to it
+std::string textureAtlasFilename(const std::string& sceneFile);
+
+//! Save atlas, sourceFile is the scene file it was made from
+bool saveTextureAtlas(const std::string& file,
+                      const TextureAtlas& atlas,
+                      const std::string& sourceFile);
+
+//! Load an atlas saved by saveTextureAtlas(), false if the file is missing
+//! or was made from other contents of the scene file
+bool loadTextureAtlas(const std::string& file,
+                      const std::string& sourceFile,
+                      TextureAtlas& atlas);
+
+}  // namespace assets
+}  // namespace esp
@@ -0,0 +1,323 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#include "TextureCompression.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "esp/core/ThreadPool.h"
+#include "esp/io/cache.h"
+#include "esp/io/io.h"
+
+namespace esp {
+namespace assets {
+
+namespace {
+// kind of the compressed atlas files, distinct from the other cache kinds
+const uint32_t atlasCacheKind = 103;
+const uint32_t atlasCacheVersion = 1;
+const uint32_t texturesCacheKind = 104;
+const uint32_t texturesCacheVersion = 1;
+
+constexpr int blockSize = 8;
+
+int quantize(float value, int max) {
+  return std::min(max, std::max(0, int(std::lround(value * max / 255))));
+}
+
+uint16_t toRGB565(const float* color) {
+  return uint16_t(quantize(color[0], 31) << 11 | quantize(color[1], 63) << 5 |
+                  quantize(color[2], 31));
+}
+
+void fromRGB565(uint16_t c, int* color) {
+  const int r = c >> 11 & 31;
+  const int g = c >> 5 & 63;
+  const int b = c & 31;
+  color[0] = r << 3 | r >> 2;
+  color[1] = g << 2 | g >> 4;
+  color[2] = b << 3 | b >> 2;
+}
+
+// palette of a block in four color mode, in index order
+void palette(uint16_t c0, uint16_t c1, int colors[4][3]) {
+  fromRGB565(c0, colors[0]);
+  fromRGB565(c1, colors[1]);
+  for (int k = 0; k < 3; ++k) {
+    colors[2][k] = (2 * colors[0][k] + colors[1][k]) / 3;
+    colors[3][k] = (colors[0][k] + 2 * colors[1][k]) / 3;
+  }
+}
+
+void compressBlock(const float texels[16][3], uint8_t* block) {
+  // endpoints are the extremes of the texels along their principal axis
+  float mean[3] = {0, 0, 0};
+  for (int i = 0; i < 16; ++i) {
+    for (int k = 0; k < 3; ++k) {
+      mean[k] += texels[i][k] / 16;
+    }
+  }
+  float cov[3][3] = {};
+  for (int i = 0; i < 16; ++i) {
+    for (int a = 0; a < 3; ++a) {
+      for (int b = 0; b < 3; ++b) {
+        cov[a][b] += (texels[i][a] - mean[a]) * (texels[i][b] - mean[b]);
+      }
+    }
+  }
+  // power iteration, starting from the covariance of the channel varying the
+  // most so that the start is not orthogonal to the axis
+  int channel = 0;
+  for (int a = 1; a < 3; ++a) {
+    if (cov[a][a] > cov[channel][channel]) {
+      channel = a;
+    }
+  }
+  float axis[3] = {cov[channel][0], cov[channel][1], cov[channel][2]};
+  for (int iteration = 0; iteration < 8; ++iteration) {
+    float next[3];
+    for (int a = 0; a < 3; ++a) {
+      next[a] = cov[a][0] * axis[0] + cov[a][1] * axis[1] + cov[a][2] * axis[2];
+    }
+    const float length =
+        std::sqrt(next[0] * next[0] + next[1] * next[1] + next[2] * next[2]);
+    if (length < 1e-6f) {
+      break;
+    }
+    for (int a = 0; a < 3; ++a) {
+      axis[a] = next[a] / length;
+    }
+  }
+  float minT = 0, maxT = 0;
+  for (int i = 0; i < 16; ++i) {
+    const float t = (texels[i][0] - mean[0]) * axis[0] +
+                    (texels[i][1] - mean[1]) * axis[1] +
+                    (texels[i][2] - mean[2]) * axis[2];
+    minT = std::min(minT, t);
+    maxT = std::max(maxT, t);
+  }
+  float high[3], low[3];
+  for (int k = 0; k < 3; ++k) {
+    high[k] = mean[k] + axis[k] * maxT;
+    low[k] = mean[k] + axis[k] * minT;
+  }
+  uint16_t c0 = toRGB565(high);
+  uint16_t c1 = toRGB565(low);
+  // c0 > c1 selects the four color mode, c0 == c1 is a single color anyway
+  if (c0 < c1) {
+    std::swap(c0, c1);
+  }
+
+  int colors[4][3];
+  palette(c0, c1, colors);
+  uint32_t indices = 0;
+  for (int i = 0; i < 16; ++i) {
+    int best = 0;
+    float bestDistance = 0;
+    for (int j = 0; j < (c0 == c1 ? 1 : 4); ++j) {
+      float distance = 0;
+      for (int k = 0; k < 3; ++k) {
+        const float d = texels[i][k] - colors[j][k];
+        distance += d * d;
+      }
+      if (j == 0 || distance < bestDistance) {
+        best = j;
+        bestDistance = distance;
+      }
+    }
+    indices |= uint32_t(best) << (2 * i);
+  }
+
+  block[0] = c0 & 0xff;
+  block[1] = c0 >> 8;
+  block[2] = c1 & 0xff;
+  block[3] = c1 >> 8;
+  for (int k = 0; k < 4; ++k) {
+    block[4 + k] = indices >> (8 * k) & 0xff;
+  }
+}
+}  // namespace
+
+std::vector<uint8_t> compressBC1(const uint8_t* rgb, int width, int height) {
+  const int blocksX = (width + 3) / 4;
+  const int blocksY = (height + 3) / 4;
+  std::vector<uint8_t> blocks(size_t(blocksX) * blocksY * blockSize);
+
+  core::parallelFor(blocksY, 0, [&](size_t row) {
+    const int by = row;
+    for (int bx = 0; bx < blocksX; ++bx) {
+      float texels[16][3];
+      for (int y = 0; y < 4; ++y) {
+        for (int x = 0; x < 4; ++x) {
+          const int ix = std::min(bx * 4 + x, width - 1);
+          const int iy = std::min(by * 4 + y, height - 1);
+          const uint8_t* texel = rgb + 3 * (size_t(iy) * width + ix);
+          for (int k = 0; k < 3; ++k) {
+            texels[4 * y + x][k] = texel[k];
+          }
+        }
+      }
+      compressBlock(texels,
+                    &blocks[(size_t(by) * blocksX + bx) * blockSize]);
+    }
+  });
+  return blocks;
+}
+
+std::vector<uint8_t> decompressBC1(const std::vector<uint8_t>& blocks,
+                                   int width,
+                                   int height) {
+  const int blocksX = (width + 3) / 4;
+  std::vector<uint8_t> rgb(size_t(width) * height * 3);
+  for (int iy = 0; iy < height; ++iy) {
+    for (int ix = 0; ix < width; ++ix) {
+      const uint8_t* block =
+          &blocks[(size_t(iy / 4) * blocksX + ix / 4) * blockSize];
+      const uint16_t c0 = block[0] | block[1] << 8;
+      const uint16_t c1 = block[2] | block[3] << 8;
+      int colors[4][3];
+      palette(c0, c1, colors);
+      const int i = 4 * (iy % 4) + ix % 4;
+      const int index = block[4 + i / 4] >> (2 * (i % 4)) & 3;
+      for (int k = 0; k < 3; ++k) {
+        rgb[3 * (size_t(iy) * width + ix) + k] = colors[index][k];
+      }
+    }
+  }
+  return rgb;
+}
+
+CompressedTexture compressBC1MipChain(const uint8_t* rgb,
+                                      int width,
+                                      int height) {
+  CompressedTexture texture;
+  texture.width = width;
+  texture.height = height;
+  texture.levels.push_back(compressBC1(rgb, width, height));
+
+  std::vector<uint8_t> level(rgb, rgb + size_t(width) * height * 3);
+  while (width > 1 || height > 1) {
+    // average 2x2 texels, the last row or column of odd sizes counts twice
+    const int nextWidth = std::max(1, width / 2);
+    const int nextHeight = std::max(1, height / 2);
+    std::vector<uint8_t> next(size_t(nextWidth) * nextHeight * 3);
+    for (int y = 0; y < nextHeight; ++y) {
+      for (int x = 0; x < nextWidth; ++x) {
+        const int x0 = std::min(2 * x, width - 1);
+        const int x1 = std::min(2 * x + 1, width - 1);
+        const int y0 = std::min(2 * y, height - 1);
+        const int y1 = std::min(2 * y + 1, height - 1);
+        for (int k = 0; k < 3; ++k) {
+          const int sum = level[3 * (size_t(y0) * width + x0) + k] +
+                          level[3 * (size_t(y0) * width + x1) + k] +
+                          level[3 * (size_t(y1) * width + x0) + k] +
+                          level[3 * (size_t(y1) * width + x1) + k];
+          next[3 * (size_t(y) * nextWidth + x) + k] = (sum + 2) / 4;
+        }
+      }
+    }
+    level = std::move(next);
+    width = nextWidth;
+    height = nextHeight;
+    texture.levels.push_back(compressBC1(level.data(), width, height));
+  }
+  return texture;
+}
+
+std::string compressedAtlasFilename(const std::string& atlasFile) {
+  return io::changeExtension(atlasFile, ".bc1");
+}
+
+bool saveCompressedAtlas(const std::string& file,
+                         const std::vector<uint8_t>& blocks,
+                         int width,
+                         int height,
+                         const std::string& sourceFile) {
+  const std::vector<int32_t> size{width, height};
+  io::CacheWriter writer(atlasCacheKind, atlasCacheVersion, sourceFile);
+  writer.addSection(size);
+  writer.addSection(blocks);
+  return writer.write(file);
+}
+
+bool loadCompressedAtlas(const std::string& file,
+                         const std::string& sourceFile,
+                         std::vector<uint8_t>& blocks,
+                         int& width,
+                         int& height) {
+  const io::CacheReader reader(file, atlasCacheKind, atlasCacheVersion,
+                               sourceFile);
+  std::vector<int32_t> size;
+  if (!reader.isValid() || !reader.readSection(0, size) || size.size() != 2 ||
+      !reader.readSection(1, blocks)) {
+    return false;
+  }
+  width = size[0];
+  height = size[1];
+  return blocks.size() ==
+         size_t((width + 3) / 4) * ((height + 3) / 4) * blockSize;
+}
+
+std::string compressedTexturesFilename(const std::string& sceneFile) {
+  return io::cacheFilename(sceneFile + ".textures");
+}
+
+bool saveCompressedTextures(const std::string& file,
+                            const std::vector<CompressedTexture>& textures,
+                            const std::string& sourceFile) {
+  // (width, height, number of levels) of each texture, then the levels of
+  // all textures in order
+  std::vector<int32_t> header;
+  for (const CompressedTexture& texture : textures) {
+    header.push_back(texture.width);
+    header.push_back(texture.height);
+    header.push_back(texture.levels.size());
+  }
+  io::CacheWriter writer(texturesCacheKind, texturesCacheVersion, sourceFile);
+  writer.addSection(header);
+  for (const CompressedTexture& texture : textures) {
+    for (const std::vector<uint8_t>& level : texture.levels) {
+      writer.addSection(level);
+    }
+  }
+  return writer.write(file);
+}
+
+bool loadCompressedTextures(const std::string& file,
+                            const std::string& sourceFile,
+                            std::vector<CompressedTexture>& textures) {
+  const io::CacheReader reader(file, texturesCacheKind, texturesCacheVersion,
+                               sourceFile);
+  std::vector<int32_t> header;
+  if (!reader.isValid() || !reader.readSection(0, header) ||
+      header.size() % 3 != 0) {
+    return false;
+  }
+  std::vector<CompressedTexture> loaded(header.size() / 3);
+  size_t section = 1;
+  for (size_t i = 0; i < loaded.size(); ++i) {
+    CompressedTexture& texture = loaded[i];
+    texture.width = header[3 * i];
+    texture.height = header[3 * i + 1];
+    if (header[3 * i + 2] < 0 || header[3 * i + 2] > 32) {
+      return false;
+    }
+    texture.levels.resize(header[3 * i + 2]);
+    for (size_t level = 0; level < texture.levels.size(); ++level) {
+      const int width = std::max(1, texture.width >> level);
+      const int height = std::max(1, texture.height >> level);
+      if (!reader.readSection(section++, texture.levels[level]) ||
+          texture.levels[level].size() !=
+              size_t((width + 3) / 4) * ((height + 3) / 4) * blockSize) {
+        return false;
+      }
+    }
+  }
+  textures = std::move(loaded);
+  return true;
+}
+
+}  // namespace assets
+}  // namespace esp
@@ -0,0 +1,78 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace esp {
+namespace assets {
+
+// Block compression of textures ahead of time, for textures too large to let
+// the driver compress them at upload, such as PTex atlases. BC1 (S3TC DXT1)
+// stores every 4x4 texel block in 8 bytes, a sixth of RGB8, and is supported
+// by all desktop GPUs.
+
+//! Compress an RGB8 image, rows stored consecutively without padding, into
+//! BC1 blocks in row-major block order. Blocks at the right and bottom edge
+//! of images with sizes not divisible by 4 repeat the last column and row
+std::vector<uint8_t> compressBC1(const uint8_t* rgb, int width, int height);
+
+//! Decompress BC1 blocks made by compressBC1() into an RGB8 image
+std::vector<uint8_t> decompressBC1(const std::vector<uint8_t>& blocks,
+                                   int width,
+                                   int height);
+
+//! Texture compressed to BC1 with its full mip chain, level 0 first
+struct CompressedTexture {
+  int width = 0;
+  int height = 0;
+  std::vector<std::vector<uint8_t>> levels;
+};
+
+//! Box filtered mip chain of an RGB8 image down to 1x1, each level
+//! compressed to BC1
+CompressedTexture compressBC1MipChain(const uint8_t* rgb,
+                                      int width,
+                                      int height);
+
+//! File the compressed version of a PTex atlas is stored in, next to it
+std::string compressedAtlasFilename(const std::string& atlasFile);
+
+//! Save BC1 blocks of a width x height atlas, sourceFile is the atlas file
+//! they were made from
+bool saveCompressedAtlas(const std::string& file,
+                         const std::vector<uint8_t>& blocks,
+                         int width,
+                         int height,
+                         const std::string& sourceFile);
+
+//! Load blocks saved by saveCompressedAtlas(), false if the file is missing
+//! or was made from other contents of the atlas
+bool loadCompressedAtlas(const std::string& file,
+                         const std::string& sourceFile,
+                         std::vector<uint8_t>& blocks,
+                         int& width,
+                         int& height);
+
+//! File the compressed textures of a scene are stored in, next to it
+std::string compressedTexturesFilename(const std::string& sceneFile);
+
+//! Save the compressed textures of a scene, in the order of its importer.
+//! Textures that could not be compressed have no levels. sourceFile is the
+//! scene file
+bool saveCompressedTextures(const std::string& file,
+                            const std::vector<CompressedTexture>& textures,
+                            const std::string& sourceFile);
+
+//! Load textures saved by saveCompressedTextures(), false if the file is
+//! missing or was made from other contents of the scene file
+bool loadCompressedTextures(const std::string& file,
+                            const std::string& sourceFile,
+                            std::vector<CompressedTexture>& textures);
+
+}  // namespace assets
+}  // namespace esp
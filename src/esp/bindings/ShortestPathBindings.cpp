@@ -4,6 +4,7 @@
 
 #include <pybind11/eigen.h>
 #include <pybind11/functional.h>
+#include <pybind11/numpy.h>
 #include <pybind11/stl.h>
 #include "esp/bindings/OpaqueTypes.h"
 
@@ -12,6 +13,9 @@
 
 #include "esp/agent/Agent.h"
 #include "esp/core/esp.h"
+#include "esp/nav/ActionSpacePathFinder.h"
+#include "esp/nav/EpisodeSampler.h"
+#include "esp/nav/GeodesicDistanceField.h"
 #include "esp/nav/GreedyFollower.h"
 #include "esp/nav/PathFinder.h"
 #include "esp/scene/ObjectControls.h"
@@ -28,6 +32,18 @@ void initShortestPathBindings(py::module& m) {
       .def_readwrite("hit_normal", &HitRecord::hitNormal)
       .def_readwrite("hit_dist", &HitRecord::hitDist);
 
+  py::class_<TopDownView, TopDownView::ptr>(m, "TopDownView")
+      .def_readonly("origin", &TopDownView::origin)
+      .def_readonly("meters_per_pixel", &TopDownView::metersPerPixel)
+      .def_readonly("navigable", &TopDownView::navigable)
+      .def_readonly("islands", &TopDownView::islands)
+      .def_readonly("obstacle_distance", &TopDownView::obstacleDistance);
+
+  py::class_<PathCacheStats>(m, "PathCacheStats")
+      .def_readonly("hits", &PathCacheStats::hits)
+      .def_readonly("misses", &PathCacheStats::misses)
+      .def_readonly("size", &PathCacheStats::size);
+
   py::class_<ShortestPath, ShortestPath::ptr>(m, "ShortestPath")
       .def(py::init(&ShortestPath::create<>))
       .def_readwrite("requested_start", &ShortestPath::requestedStart)
@@ -47,17 +63,105 @@ void initShortestPathBindings(py::module& m) {
   py::class_<PathFinder, PathFinder::ptr>(m, "PathFinder")
       .def(py::init(&PathFinder::create<>))
       .def("get_random_navigable_point", &PathFinder::getRandomNavigablePoint)
+      .def("get_random_navigable_points",
+           &PathFinder::getRandomNavigablePoints,
+           R"(Samples num_points random navigable points on islands with a radius
+           of at least min_island_radius. May return fewer points if they are
+           too hard to find)",
+           "num_points"_a, "min_island_radius"_a = 0,
+           py::call_guard<py::gil_scoped_release>())
+      .def("seed", &PathFinder::seed, R"()", "new_seed"_a)
       .def("find_path", py::overload_cast<ShortestPath&>(&PathFinder::findPath),
-           "path"_a)
+           "path"_a, py::call_guard<py::gil_scoped_release>())
       .def("find_path",
            py::overload_cast<MultiGoalShortestPath&>(&PathFinder::findPath),
-           "path"_a)
+           "path"_a, py::call_guard<py::gil_scoped_release>())
+      .def("register_goal_set", &PathFinder::registerGoalSet,
+           R"(Registers goals, e.g. the view points of an object, once for distance_to_goal_set and find_path_to_goal_set. Returns the id of the set)",
+           "goals"_a, py::call_guard<py::gil_scoped_release>())
+      .def("unregister_goal_set", &PathFinder::unregisterGoalSet,
+           "goal_set_id"_a)
+      .def("distance_to_goal_set", &PathFinder::distanceToGoalSet,
+           R"(Geodesic distance from pt to the closest goal of the set, infinity if none can be reached)",
+           "pt"_a, "goal_set_id"_a)
+      .def("find_path_to_goal_set", &PathFinder::findPathToGoalSet,
+           R"(Finds the path from path.requested_start to the closest goal of the set and sets path.requested_end to it)",
+           "path"_a, "goal_set_id"_a,
+           py::call_guard<py::gil_scoped_release>())
+      .def(
+          "find_paths",
+          [](PathFinder& self, const std::vector<ShortestPath::ptr>& paths,
+             int numThreads) {
+            std::vector<ShortestPath> batch;
+            batch.reserve(paths.size());
+            for (const auto& path : paths) {
+              batch.emplace_back(*path);
+            }
+            std::vector<bool> found;
+            {
+              py::gil_scoped_release release;
+              found = self.findPaths(batch, numThreads);
+            }
+            for (size_t i = 0; i < paths.size(); ++i) {
+              *paths[i] = std::move(batch[i]);
+            }
+            return found;
+          },
+          R"(Finds all paths in place, spread over num_threads threads (0 uses all cores).
+          Returns whether each path was found)",
+          "paths"_a, "num_threads"_a = 0)
+      .def_property(
+          "path_cache_capacity", &PathFinder::getPathCacheCapacity,
+          &PathFinder::setPathCacheCapacity,
+          R"(Number of single goal paths kept by find_path and find_paths, 0 disables the cache)")
+      .def_property(
+          "path_cache_quantization", &PathFinder::getPathCacheQuantization,
+          [](PathFinder& self, float meters) {
+            if (meters <= 0) {
+              throw py::value_error("path_cache_quantization must be positive");
+            }
+            self.setPathCacheQuantization(meters);
+          },
+          R"(Meters the endpoints of cached paths are rounded to)")
+      .def_property_readonly("path_cache_stats", &PathFinder::getPathCacheStats)
+      .def("reset_path_cache_stats", &PathFinder::resetPathCacheStats)
+      .def("clear_path_cache", &PathFinder::clearPathCache)
+      .def(
+          "set_path_hierarchy",
+          [](PathFinder& self, float clusterSize,
+             const std::vector<box3f>& regions) {
+            if (clusterSize < 0) {
+              throw py::value_error("cluster_size must not be negative");
+            }
+            self.setPathHierarchy(clusterSize, regions);
+          },
+          R"(Plan find_path over clusters of the navmesh polygons first, one per region box, e.g. the aabb of each semantic region, or x-z square of cluster_size meters outside of them, then search only the polygons along the way. 0 turns it off)",
+          "cluster_size"_a, "regions"_a = std::vector<box3f>())
+      .def_property_readonly("path_hierarchy_cluster_size",
+                             &PathFinder::getPathHierarchyClusterSize)
+      .def_property_readonly("path_hierarchy_num_clusters",
+                             &PathFinder::getPathHierarchyNumClusters)
       .def("try_step", &PathFinder::tryStep<Magnum::Vector3>, R"()", "start"_a,
            "end"_a)
       .def("try_step", &PathFinder::tryStep<vec3f>, R"()", "start"_a, "end"_a)
+      .def(
+          "try_step_batch",
+          [](PathFinder& self, const std::vector<vec3f>& starts,
+             const std::vector<vec3f>& ends, int numThreads) {
+            if (starts.size() != ends.size()) {
+              throw std::invalid_argument(
+                  "starts and ends must have the same length");
+            }
+            py::gil_scoped_release release;
+            return self.tryStepBatch(starts, ends, numThreads);
+          },
+          R"(try_step for each pair of starts and ends, spread over num_threads
+          threads (0 uses all cores). Returns the end point of each step)",
+          "starts"_a, "ends"_a, "num_threads"_a = 0)
       .def("island_radius", &PathFinder::islandRadius, R"()", "pt"_a)
       .def_property_readonly("is_loaded", &PathFinder::isLoaded)
-      .def("load_nav_mesh", &PathFinder::loadNavMesh)
+      .def("load_nav_mesh", &PathFinder::loadNavMesh,
+           py::call_guard<py::gil_scoped_release>())
       .def("distance_to_closest_obstacle",
            &PathFinder::distanceToClosestObstacle,
            R"(Returns the distance to the closest obstacle.
@@ -71,6 +175,18 @@ void initShortestPathBindings(py::module& m) {
            If the returned hit_dist is equal to :py:attr:`max_search_radius`,
            no obstacle was found.)",
           "pt"_a, "max_search_radius"_a = 2.0)
+      .def("distances_to_closest_obstacle",
+           &PathFinder::distancesToClosestObstacle,
+           R"(distance_to_closest_obstacle for each of pts, spread over
+          num_threads threads (0 uses all cores))",
+           "pts"_a, "max_search_radius"_a = 2.0, "num_threads"_a = 0,
+           py::call_guard<py::gil_scoped_release>())
+      .def("closest_obstacle_surface_points",
+           &PathFinder::closestObstacleSurfacePoints,
+           R"(closest_obstacle_surface_point for each of pts, spread over
+          num_threads threads (0 uses all cores))",
+           "pts"_a, "max_search_radius"_a = 2.0, "num_threads"_a = 0,
+           py::call_guard<py::gil_scoped_release>())
       .def("is_navigable", &PathFinder::isNavigable,
            R"(Checks to see if the agent can stand at the specified point.
           To check navigability, the point is snapped to the nearest polygon and
@@ -78,7 +194,73 @@ void initShortestPathBindings(py::module& m) {
           Any amount of x-z translation indicates that the given point is not navigable.
           The amount of y-translation allowed is specified by max_y_delta to account
           for slight differences in floor height)",
-           "pt"_a, "max_y_delta"_a = 0.5);
+           "pt"_a, "max_y_delta"_a = 0.5)
+      .def("get_top_down_view", &PathFinder::getTopDownView,
+           R"(Rasterizes the navmesh at height into top-down maps of cells of
+          meters_per_pixel, rows along +z and columns along +x. The maps are
+          Buffers, whose data property is a numpy view: navigable, and if
+          asked for islands and obstacle_distance. None if no navmesh is
+          loaded)",
+           "meters_per_pixel"_a, "height"_a, "compute_islands"_a = false,
+           "compute_obstacle_distance"_a = false, "max_y_delta"_a = 0.5,
+           py::call_guard<py::gil_scoped_release>());
+
+  py::class_<EpisodeConstraints>(m, "EpisodeConstraints")
+      .def(py::init())
+      .def_readwrite("min_geodesic_distance",
+                     &EpisodeConstraints::minGeodesicDistance)
+      .def_readwrite("max_geodesic_distance",
+                     &EpisodeConstraints::maxGeodesicDistance)
+      .def_readwrite("min_geodesic_to_euclidean_ratio",
+                     &EpisodeConstraints::minGeodesicToEuclideanRatio)
+      .def_readwrite("min_island_radius", &EpisodeConstraints::minIslandRadius)
+      .def_readwrite("max_height_difference",
+                     &EpisodeConstraints::maxHeightDifference);
+
+  py::class_<EpisodeSampler, EpisodeSampler::ptr>(m, "EpisodeSampler")
+      .def(py::init(&EpisodeSampler::create<PathFinder::ptr&, uint32_t>),
+           "pathfinder"_a, "seed"_a = 0)
+      .def("seed", &EpisodeSampler::seed, "new_seed"_a)
+      .def(
+          "sample",
+          [](EpisodeSampler& self, int numEpisodes,
+             const EpisodeConstraints& constraints, int numThreads,
+             int maxTriesPerEpisode) {
+            EpisodeBatch batch;
+            {
+              py::gil_scoped_release release;
+              batch = self.sample(numEpisodes, constraints, numThreads,
+                                  maxTriesPerEpisode);
+            }
+            const py::ssize_t numEpisodesFound = batch.size();
+            // vec3f is unpadded, so the points are contiguous
+            py::array_t<float> starts(
+                {numEpisodesFound, py::ssize_t{3}},
+                reinterpret_cast<const float*>(batch.starts.data()));
+            py::array_t<float> goals(
+                {numEpisodesFound, py::ssize_t{3}},
+                reinterpret_cast<const float*>(batch.goals.data()));
+            py::array_t<float> headings(numEpisodesFound,
+                                        batch.startHeadings.data());
+            py::array_t<float> distances(numEpisodesFound,
+                                         batch.geodesicDistances.data());
+            return py::make_tuple(starts, goals, headings, distances);
+          },
+          R"(Samples up to num_episodes PointNav episodes meeting constraints. Returns the starts (N x 3), goals (N x 3), start headings in radians about the up axis (N) and geodesic distances (N))",
+          "num_episodes"_a, "constraints"_a = EpisodeConstraints(),
+          "num_threads"_a = 0, "max_tries_per_episode"_a = 100)
+      .def("reset", &EpisodeSampler::reset,
+           R"(Drops the cached navmesh polygons, needed if the navmesh changes)");
+
+  py::class_<GeodesicDistanceField, GeodesicDistanceField::ptr>(
+      m, "GeodesicDistanceField")
+      .def(py::init(&GeodesicDistanceField::create<PathFinder::ptr,
+                                                   const std::vector<vec3f>&>),
+           "pathfinder"_a, "goals"_a)
+      .def("distance_from", &GeodesicDistanceField::distanceFrom,
+           R"(Returns the geodesic distance from pt to the closest goal, or infinity if no goal can be reached)",
+           "pt"_a)
+      .def_property_readonly("goals", &GeodesicDistanceField::getGoals);
 
   // this enum is used by GreedyGeodesicFollowerImpl so it needs to be defined
   // before it
@@ -106,5 +288,46 @@ void initShortestPathBindings(py::module& m) {
       .def("find_path",
            py::overload_cast<const vec3f&, const vec4f&, const vec3f&>(
                &GreedyGeodesicFollowerImpl::findPath),
-           py::return_value_policy::move);
+           py::return_value_policy::move)
+      .def(
+          "find_path_actions",
+          [](GreedyGeodesicFollowerImpl& self, const vec3f& startPos,
+             const vec4f& startRot, const vec3f& end) {
+            GreedyGeodesicFollowerImpl::PathActions path =
+                self.findPathActions(startPos, startRot, end);
+            const py::ssize_t numStates = path.positions.size();
+            // vec3f and vec4f are unpadded, so the states are contiguous
+            py::array_t<float> positions(
+                {numStates, py::ssize_t{3}},
+                reinterpret_cast<const float*>(path.positions.data()));
+            py::array_t<float> rotations(
+                {numStates, py::ssize_t{4}},
+                reinterpret_cast<const float*>(path.rotations.data()));
+            return py::make_tuple(std::move(path.actions), positions,
+                                  rotations);
+          },
+          R"(Simulates the whole episode. Returns the actions, and the positions
+          (N x 3) and rotation coefficients (N x 4) of the agent before each
+          action. The actions are empty if the goal cannot be reached)",
+          "start_pos"_a, "start_rot"_a, "end"_a)
+      .def("reset", &GreedyGeodesicFollowerImpl::reset,
+           R"(Drops cached paths, needed if the navmesh changes)");
+
+  py::class_<ActionSpacePathFinder, ActionSpacePathFinder::ptr>(
+      m, "ActionSpacePathFinder")
+      .def(py::init(&ActionSpacePathFinder::create<PathFinder::ptr&, float,
+                                                   float, float, float>),
+           "pathfinder"_a, "forward_amount"_a, "turn_amount"_a,
+           "goal_radius"_a, "cell_size"_a = 0.0f)
+      .def("next_action_along", &ActionSpacePathFinder::nextActionAlong,
+           "current_pos"_a, "current_rot"_a, "end"_a)
+      .def("find_path", &ActionSpacePathFinder::findPath,
+           R"(Shortest actions to within goal_radius of end, ending with STOP, over a
+          lattice of poses. Empty if end cannot be reached)",
+           "start_pos"_a, "start_rot"_a, "end"_a)
+      .def_property_readonly("num_nodes", &ActionSpacePathFinder::getNumNodes)
+      .def_property_readonly("num_goals", &ActionSpacePathFinder::getNumGoals)
+      .def("reset", &ActionSpacePathFinder::reset,
+           R"(Drops the pose graph and the cost-to-go tables, needed if the navmesh
+          changes)");
 }
@@ -4,24 +4,36 @@
 
 #include "esp/bindings/OpaqueTypes.h"
 
+#include <pybind11/numpy.h>
+
 namespace py = pybind11;
 using namespace py::literals;
 
 #include "esp/core/Configuration.h"
+#include "esp/core/Metrics.h"
+#include "esp/core/Profiling.h"
+#include "esp/core/ThreadPool.h"
 #include "esp/geo/OBB.h"
+#include "esp/gfx/BatchSimulator.h"
 #include "esp/gfx/RenderCamera.h"
 #include "esp/gfx/Renderer.h"
 #include "esp/gfx/Simulator.h"
+#include "esp/io/io.h"
 #include "esp/nav/PathFinder.h"
 #include "esp/physics/PhysicsManager.h"
 #include "esp/scene/Mp3dSemanticScene.h"
 #include "esp/scene/ObjectControls.h"
+#include "esp/scene/RegionVisibility.h"
 #include "esp/scene/SceneGraph.h"
 #include "esp/scene/SceneNode.h"
 #include "esp/scene/SemanticScene.h"
+#include "esp/scene/SemanticSceneIndex.h"
 #include "esp/scene/SuncgSemanticScene.h"
+#include "esp/sensor/NavigationSensor.h"
+#include "esp/sensor/PanoramicSensor.h"
 #include "esp/sensor/PinholeCamera.h"
 #include "esp/sensor/Sensor.h"
+#include "esp/sim/SimulatorClient.h"
 
 #include <Magnum/SceneGraph/Python.h>
 
@@ -44,6 +56,148 @@ SceneNode* nodeGetter(T& self) {
     throw py::value_error{"feature not valid"};
   return &self.node();
 };
+
+// N x columns view of an array of vectors, kept alive by owner
+template <class T>
+py::array_t<float> vectorArrayView(const std::vector<T>& vectors,
+                                   py::handle owner) {
+  return py::array_t<float>(
+      {static_cast<py::ssize_t>(vectors.size()),
+       static_cast<py::ssize_t>(T::RowsAtCompileTime)},
+      reinterpret_cast<const float*>(vectors.data()), owner);
+}
+
+py::array_t<int> indexArrayView(const std::vector<int>& indices,
+                                py::handle owner) {
+  return py::array_t<int>({static_cast<py::ssize_t>(indices.size())},
+                          indices.data(), owner);
+}
+
+// origins and directions of the rays of a collision query, N x 3 arrays
+void raysFromArrays(
+    const py::array_t<float, py::array::c_style | py::array::forcecast>&
+        origins,
+    const py::array_t<float, py::array::c_style | py::array::forcecast>&
+        directions,
+    std::vector<Magnum::Vector3>& originVectors,
+    std::vector<Magnum::Vector3>& directionVectors) {
+  if (origins.ndim() != 2 || origins.shape(1) != 3 ||
+      directions.ndim() != 2 || directions.shape(1) != 3 ||
+      origins.shape(0) != directions.shape(0)) {
+    throw py::value_error{
+        "origins and directions must be N x 3 arrays of the same size"};
+  }
+  originVectors.resize(origins.shape(0));
+  directionVectors.resize(directions.shape(0));
+  std::copy_n(origins.data(), 3 * originVectors.size(),
+              reinterpret_cast<float*>(originVectors.data()));
+  std::copy_n(directions.data(), 3 * directionVectors.size(),
+              reinterpret_cast<float*>(directionVectors.data()));
+}
+
+// hits of a collision query as a dict of arrays, one entry per ray
+py::dict raycastHitArrays(const std::vector<RaycastHit>& hits) {
+  const py::ssize_t numHits = hits.size();
+  py::array_t<bool> hit(numHits);
+  py::array_t<int> objectIDs(numHits);
+  py::array_t<float> distances(numHits);
+  py::array_t<float> points({numHits, py::ssize_t{3}});
+  py::array_t<float> normals({numHits, py::ssize_t{3}});
+  for (py::ssize_t i = 0; i < numHits; ++i) {
+    hit.mutable_at(i) = hits[i].hit;
+    objectIDs.mutable_at(i) = hits[i].objectID;
+    distances.mutable_at(i) = hits[i].distance;
+    for (int j = 0; j < 3; ++j) {
+      points.mutable_at(i, j) = hits[i].point[j];
+      normals.mutable_at(i, j) = hits[i].normal[j];
+    }
+  }
+  return py::dict("hit"_a = hit, "object_id"_a = objectIDs,
+                  "distance"_a = distances, "point"_a = points,
+                  "normal"_a = normals);
+}
+
+// contacts of a contact test as a dict of arrays, one entry per contact
+py::dict contactArrays(const std::vector<ContactPoint>& contacts) {
+  const py::ssize_t numContacts = contacts.size();
+  py::array_t<int> objectIDsA(numContacts);
+  py::array_t<int> objectIDsB(numContacts);
+  py::array_t<float> positionsOnA({numContacts, py::ssize_t{3}});
+  py::array_t<float> positionsOnB({numContacts, py::ssize_t{3}});
+  py::array_t<float> normalsOnB({numContacts, py::ssize_t{3}});
+  py::array_t<float> distances(numContacts);
+  for (py::ssize_t i = 0; i < numContacts; ++i) {
+    objectIDsA.mutable_at(i) = contacts[i].objectIDA;
+    objectIDsB.mutable_at(i) = contacts[i].objectIDB;
+    distances.mutable_at(i) = contacts[i].distance;
+    for (int j = 0; j < 3; ++j) {
+      positionsOnA.mutable_at(i, j) = contacts[i].positionOnA[j];
+      positionsOnB.mutable_at(i, j) = contacts[i].positionOnB[j];
+      normalsOnB.mutable_at(i, j) = contacts[i].normalOnB[j];
+    }
+  }
+  return py::dict("object_id_a"_a = objectIDsA, "object_id_b"_a = objectIDsB,
+                  "position_on_a"_a = positionsOnA,
+                  "position_on_b"_a = positionsOnB,
+                  "normal_on_b"_a = normalsOnB, "distance"_a = distances);
+}
+
+// buffer protocol format of the elements of a core::Buffer
+std::string bufferFormat(DataType dataType) {
+  switch (dataType) {
+    case DataType::DT_INT8:
+      return py::format_descriptor<int8_t>::format();
+    case DataType::DT_UINT8:
+      return py::format_descriptor<uint8_t>::format();
+    case DataType::DT_INT16:
+      return py::format_descriptor<int16_t>::format();
+    case DataType::DT_UINT16:
+      return py::format_descriptor<uint16_t>::format();
+    case DataType::DT_INT32:
+      return py::format_descriptor<int32_t>::format();
+    case DataType::DT_UINT32:
+      return py::format_descriptor<uint32_t>::format();
+    case DataType::DT_INT64:
+      return py::format_descriptor<int64_t>::format();
+    case DataType::DT_UINT64:
+      return py::format_descriptor<uint64_t>::format();
+    case DataType::DT_FLOAT:
+      return py::format_descriptor<float>::format();
+    case DataType::DT_DOUBLE:
+      return py::format_descriptor<double>::format();
+    case DataType::DT_FLOAT16:
+      return "e";
+    default:
+      throw py::value_error{"buffer has no data type"};
+  }
+}
+
+// C-contiguous description of the data of buffer, which is not copied
+py::buffer_info bufferInfo(const Buffer& buffer) {
+  if (buffer.data == nullptr) {
+    throw py::value_error{"buffer has no data"};
+  }
+  const py::ssize_t itemSize = getDataTypeByteSize(buffer.dataType);
+  std::vector<py::ssize_t> shape(buffer.shape.begin(), buffer.shape.end());
+  std::vector<py::ssize_t> strides(shape.size());
+  py::ssize_t stride = itemSize;
+  for (int i = shape.size() - 1; i >= 0; --i) {
+    strides[i] = stride;
+    stride *= shape[i];
+  }
+  return py::buffer_info(buffer.data, itemSize, bufferFormat(buffer.dataType),
+                         shape.size(), shape, strides);
+}
+
+// numpy view of the data of buffer, which keeps the buffer alive
+py::array bufferArrayView(const Buffer::ptr& buffer) {
+  if (buffer == nullptr) {
+    throw py::value_error{"observation has no buffer"};
+  }
+  const py::buffer_info info = bufferInfo(*buffer);
+  return py::array(py::dtype(info), info.shape, info.strides, info.ptr,
+                   py::cast(buffer));
+}
 }  // namespace
 
 PYBIND11_MODULE(habitat_sim_bindings, m) {
@@ -65,6 +219,76 @@ PYBIND11_MODULE(habitat_sim_bindings, m) {
       .def("set", &Configuration::set<float>)
       .def("set", &Configuration::set<bool>);
 
+  // ==== Profiler ====
+  py::class_<ProfileEvent>(m, "ProfileEvent")
+      .def_property_readonly("name",
+                             [](const ProfileEvent& self) {
+                               return std::string{self.name};
+                             })
+      .def_readonly("start_ns", &ProfileEvent::startNs)
+      .def_readonly("duration_ns", &ProfileEvent::durationNs)
+      .def_readonly("thread_id", &ProfileEvent::threadId);
+
+  py::class_<ProfileSummary>(m, "ProfileSummary")
+      .def_readonly("count", &ProfileSummary::count)
+      .def_readonly("total_ms", &ProfileSummary::totalMs);
+
+  py::class_<Profiler, std::unique_ptr<Profiler, py::nodelete>>(
+      m, "Profiler", R"(
+      Timings of the hot paths, recorded when built with BUILD_WITH_PROFILING
+      and enabled. GPU time is on the thread with id GPU_THREAD_ID.
+      )")
+      .def_static("get", &Profiler::get, py::return_value_policy::reference)
+      .def_property_readonly_static(
+          "compiled_in", [](py::object) { return Profiler::isCompiledIn(); })
+      .def_property_readonly_static(
+          "GPU_THREAD_ID", [](py::object) { return Profiler::GpuThreadId; })
+      .def_property("enabled", &Profiler::isEnabled, &Profiler::setEnabled)
+      .def_property("buffer_capacity", &Profiler::getBufferCapacity,
+                    &Profiler::setBufferCapacity,
+                    R"(Events kept per thread, the oldest are overwritten)")
+      .def("events", &Profiler::getEvents,
+           R"(Recorded events of all threads, sorted by start)")
+      .def("summary", &Profiler::getSummary,
+           R"(Count and total time of the recorded events by name)")
+      .def("clear", &Profiler::clear)
+      .def("chrome_trace", &Profiler::getChromeTrace,
+           R"(The events as JSON in the Chrome trace event format)")
+      .def("save_chrome_trace", &Profiler::saveChromeTrace, "file"_a);
+
+  // ==== Metrics ====
+  py::class_<MetricSample>(m, "MetricSample")
+      .def_readonly("name", &MetricSample::name)
+      .def_readonly("labels", &MetricSample::labels)
+      .def_readonly("value", &MetricSample::value);
+
+  py::class_<MetricsRegistry, std::unique_ptr<MetricsRegistry, py::nodelete>>(
+      m, "MetricsRegistry", R"(
+      Counters, gauges and latency histograms of the process: steps, render
+      and readback latency, scene loads, asset cache hits and memory.
+      Collected once enabled.
+      )")
+      .def_static("get", &MetricsRegistry::get,
+                  py::return_value_policy::reference)
+      .def_property("enabled", &MetricsRegistry::isEnabled,
+                    &MetricsRegistry::setEnabled)
+      .def("collect", &MetricsRegistry::collect,
+           R"(All samples, histograms as cumulative _bucket, _sum and _count)")
+      .def("prometheus_text", &MetricsRegistry::getPrometheusText,
+           R"(The samples in the Prometheus text exposition format)")
+      .def("reset", &MetricsRegistry::reset);
+
+  py::class_<MetricsServer>(m, "MetricsServer", R"(
+      Serves the metrics for Prometheus to scrape at http://host:port/metrics
+      until it is garbage collected. Port 0 picks a free one.
+      )")
+      .def(py::init([](int port) {
+             return std::make_unique<MetricsServer>(port);
+           }),
+           "port"_a)
+      .def_property_readonly("running", &MetricsServer::isRunning)
+      .def_property_readonly("port", &MetricsServer::getPort);
+
   // !!Warning!!
   // CANNOT apply smart pointers to "SceneNode" or ANY its descendant classes,
   // namely, any class whose instance can be a node in the scene graph. Reason:
@@ -165,6 +389,13 @@ PYBIND11_MODULE(habitat_sim_bindings, m) {
       .def("init_scene_graph", &scene::SceneManager::initSceneGraph,
            R"(
           Initialize a new scene graph, and return its ID.)")
+      .def("release_scene_graph", &scene::SceneManager::releaseSceneGraph,
+           R"(
+          Delete a scene graph and all of its nodes; its ID may be reused by
+          a later init_scene_graph.)",
+           "sceneGraphID"_a)
+      .def("has_scene_graph", &scene::SceneManager::hasSceneGraph,
+           "sceneGraphID"_a)
       .def("get_scene_graph",
            py::overload_cast<int>(&scene::SceneManager::getSceneGraph),
            R"(
@@ -268,22 +499,110 @@ PYBIND11_MODULE(habitat_sim_bindings, m) {
       .def_property_readonly("obb", &SuncgSemanticObject::obb)
       .def_property_readonly("category", &SuncgSemanticObject::category);
 
+  py::enum_<SemanticIdMapping>(m, "SemanticIdMapping")
+      .value("SEGMENT", SemanticIdMapping::Segment)
+      .value("OBJECT", SemanticIdMapping::Object)
+      .value("CATEGORY", SemanticIdMapping::Category);
+
+  // ==== SemanticObjectArrays ====
+  // the arrays are views into the object, the query results are copies
+  py::class_<SemanticObjectArrays>(m, "SemanticObjectArrays")
+      .def("__len__", &SemanticObjectArrays::size)
+      .def_property_readonly(
+          "category_index",
+          [](py::object self) {
+            return indexArrayView(
+                self.cast<const SemanticObjectArrays&>().categoryIndex, self);
+          })
+      .def_property_readonly(
+          "region_index",
+          [](py::object self) {
+            return indexArrayView(
+                self.cast<const SemanticObjectArrays&>().regionIndex, self);
+          })
+      .def_property_readonly(
+          "obb_center",
+          [](py::object self) {
+            return vectorArrayView(
+                self.cast<const SemanticObjectArrays&>().obbCenter, self);
+          })
+      .def_property_readonly(
+          "obb_half_extents",
+          [](py::object self) {
+            const SemanticObjectArrays& arrays =
+                self.cast<const SemanticObjectArrays&>();
+            return vectorArrayView(arrays.obbHalfExtents, self);
+          })
+      .def_property_readonly(
+          "obb_rotation",
+          [](py::object self) {
+            return vectorArrayView(
+                self.cast<const SemanticObjectArrays&>().obbRotation, self);
+          },
+          R"(Rotation coefficients x, y, z, w of each OBB)")
+      .def_property_readonly(
+          "aabb_min",
+          [](py::object self) {
+            return vectorArrayView(
+                self.cast<const SemanticObjectArrays&>().aabbMin, self);
+          })
+      .def_property_readonly(
+          "aabb_max",
+          [](py::object self) {
+            return vectorArrayView(
+                self.cast<const SemanticObjectArrays&>().aabbMax, self);
+          })
+      .def(
+          "distances",
+          [](const SemanticObjectArrays& self, const vec3f& point) {
+            const std::vector<float> distances = self.distances(point);
+            return py::array_t<float>(distances.size(), distances.data());
+          },
+          "point"_a)
+      .def(
+          "objects_within_radius",
+          [](const SemanticObjectArrays& self, const vec3f& point,
+             float radius, int category) {
+            const std::vector<int> objects =
+                self.objectsWithinRadius(point, radius, category);
+            return py::array_t<int>(objects.size(), objects.data());
+          },
+          R"(Indices of the objects of category (any for -1) within radius of
+          point)",
+          "point"_a, "radius"_a, "category"_a = ID_UNDEFINED)
+      .def(
+          "objects_of_category",
+          [](const SemanticObjectArrays& self, int category) {
+            const std::vector<int> objects = self.objectsOfCategory(category);
+            return py::array_t<int>(objects.size(), objects.data());
+          },
+          "category"_a)
+      .def(
+          "objects_in_region",
+          [](const SemanticObjectArrays& self, int region) {
+            const std::vector<int> objects = self.objectsInRegion(region);
+            return py::array_t<int>(objects.size(), objects.data());
+          },
+          "region"_a);
+
   // ==== SemanticScene ====
   py::class_<SemanticScene, SemanticScene::ptr>(m, "SemanticScene")
       .def(py::init(&SemanticScene::create<>))
       .def_static(
           "load_mp3d_house",
           [](const std::string& filename, SemanticScene& scene,
-             const vec4f& rotation) {
+             const vec4f& rotation, int numThreads) {
             // numpy doesn't have a quaternion equivalent, use vec4 instead
             return SemanticScene::loadMp3dHouse(
-                filename, scene, Eigen::Map<const quatf>(rotation.data()));
+                filename, scene, Eigen::Map<const quatf>(rotation.data()),
+                numThreads);
           },
           R"(
         Loads a SemanticScene from a Matterport3D House format file into passed
-        :py:class:`SemanticScene`'.
+        :py:class:`SemanticScene`'. Objects and segments are parsed on up to
+        num_threads threads, 0 for one per hardware thread.
       )",
-          "file"_a, "scene"_a, "rotation"_a)
+          "file"_a, "scene"_a, "rotation"_a, "num_threads"_a = 0)
       .def_property_readonly("aabb", &SemanticScene::aabb)
       .def_property_readonly("categories", &SemanticScene::categories)
       .def_property_readonly("levels", &SemanticScene::levels)
@@ -292,21 +611,142 @@ PYBIND11_MODULE(habitat_sim_bindings, m) {
       .def_property_readonly("semantic_index_map",
                              &SemanticScene::getSemanticIndexMap)
       .def("semantic_index_to_object_index",
-           &SemanticScene::semanticIndexToObjectIndex);
+           &SemanticScene::semanticIndexToObjectIndex)
+      .def("semantic_index_remap", &SemanticScene::semanticIndexRemap,
+           "mapping"_a, "category_mapping"_a = "")
+      .def("object_arrays", &SemanticScene::objectArrays,
+           R"(The objects as :py:class:`SemanticObjectArrays`, with category
+           indices under category_mapping)",
+           "category_mapping"_a = "");
+
+  // ==== SemanticSceneIndex ====
+  py::class_<SemanticRayHit>(m, "SemanticRayHit")
+      .def_readonly("object_index", &SemanticRayHit::objectIndex)
+      .def_readonly("distance", &SemanticRayHit::distance);
+
+  py::class_<SemanticSceneIndex, SemanticSceneIndex::ptr>(m,
+                                                          "SemanticSceneIndex")
+      .def(py::init(&SemanticSceneIndex::create<const SemanticScene&>),
+           R"(Index of the objects and regions the scene has now)", "scene"_a)
+      .def_property_readonly("num_objects", &SemanticSceneIndex::getNumObjects)
+      .def_property_readonly("num_regions", &SemanticSceneIndex::getNumRegions)
+      .def("regions_containing", &SemanticSceneIndex::regionsContaining,
+           R"(Indices of the regions containing point, the smallest first)",
+           "point"_a)
+      .def("region_at", &SemanticSceneIndex::regionAt,
+           R"(Index of the smallest region containing point, -1 if none)",
+           "point"_a)
+      .def("objects_containing", &SemanticSceneIndex::objectsContaining,
+           "point"_a)
+      .def("nearest_objects", &SemanticSceneIndex::nearestObjects,
+           R"(Indices of up to k objects nearest to point, nearest first)",
+           "point"_a, "k"_a,
+           "max_distance"_a = std::numeric_limits<float>::infinity())
+      .def("pick_object", &SemanticSceneIndex::pickObject,
+           R"(First object hit by the ray origin + t * direction)",
+           "origin"_a, "direction"_a,
+           "max_distance"_a = std::numeric_limits<float>::infinity());
+
+  // ==== RegionVisibility ====
+  py::class_<RegionVisibility, RegionVisibility::ptr>(m, "RegionVisibility")
+      .def_static(
+          "load",
+          [](const std::string& houseFile) {
+            return RegionVisibility::load(regionVisibilityFilename(houseFile),
+                                          houseFile);
+          },
+          R"(Region visibility made by the datatool for a house file, None if
+          there is none or it is outdated)",
+          "house_file"_a)
+      .def_property_readonly("num_regions", &RegionVisibility::getNumRegions)
+      .def("region_at", &RegionVisibility::regionAt,
+           R"(Index of the smallest region containing point, -1 if none)",
+           "point"_a)
+      .def("is_visible", &RegionVisibility::isVisible, "from_region"_a,
+           "to_region"_a)
+      .def("visible_regions", &RegionVisibility::visibleRegions,
+           R"(Indices of the regions potentially visible from a region)",
+           "from_region"_a);
 
   // ==== ObjectControls ====
   py::class_<ObjectControls, ObjectControls::ptr>(m, "ObjectControls")
       .def(py::init(&ObjectControls::create<>))
-      .def("action", &ObjectControls::action, R"(
+      .def("action",
+           py::overload_cast<SceneNode&, const std::string&, float, bool>(
+               &ObjectControls::action),
+           R"(
         Take action using this :py:class:`ObjectControls`.
       )",
-           "object"_a, "name"_a, "amount"_a, "apply_filter"_a = true);
+           "object"_a, "name"_a, "amount"_a, "apply_filter"_a = true)
+      .def(
+          "noisy_action",
+          [](ObjectControls& self, SceneNode& object, const std::string& name,
+             const std::map<std::string, float>& actuation, bool applyFilter) {
+            NoisyMovePointer move = getNoisyMovePointer(name);
+            NoisyActuationSpec spec;
+            if (move == nullptr ||
+                !NoisyActuationSpec::fromActuation(actuation, spec)) {
+              throw py::value_error{"unknown noisy action " + name};
+            }
+            self.action(object, move, spec, applyFilter);
+          },
+          R"(
+        Take a PyRobot noisy action (pyrobotNoisyMoveForward,
+        pyrobotNoisyMoveBackward, pyrobotNoisyTurnLeft or
+        pyrobotNoisyTurnRight) natively, with the noise drawn from the random
+        generator of these controls. actuation holds amount, noise_multiplier,
+        robot (0 LoCoBot, 1 LoCoBot-Lite) and controller (0 ILQR,
+        1 Proportional, 2 Movebase).
+      )",
+          "object"_a, "name"_a, "actuation"_a, "apply_filter"_a = true)
+      .def("seed", &ObjectControls::seed,
+           R"(Seed the random generator of noisy actions)", "new_seed"_a);
+
+  py::enum_<PanoramaProjection>(m, "PanoramaProjection")
+      .value("CUBE_MAP", PanoramaProjection::CubeMap)
+      .value("EQUIRECTANGULAR", PanoramaProjection::Equirectangular);
+
+  py::class_<RenderStats>(m, "RenderStats")
+      .def_readonly("gpu_time_ns", &RenderStats::gpuTimeNs)
+      .def_readonly("triangle_count", &RenderStats::triangleCount)
+      .def_readonly("draw_call_count", &RenderStats::drawCallCount)
+      .def_readonly("visible_drawable_count",
+                    &RenderStats::visibleDrawableCount)
+      .def_readonly("region_culled_drawable_count",
+                    &RenderStats::regionCulledDrawableCount)
+      .def_readonly("occluded_drawable_count",
+                    &RenderStats::occludedDrawableCount);
+
+  py::enum_<FrameFormat>(m, "FrameFormat")
+      .value("RGBA8", FrameFormat::Rgba8)
+      .value("RGB8", FrameFormat::Rgb8)
+      .value("DEPTH32F", FrameFormat::Depth32F)
+      .value("DEPTH16F", FrameFormat::Depth16F)
+      .value("DEPTH16MM", FrameFormat::Depth16Mm)
+      .value("OBJECT_ID32", FrameFormat::ObjectId32);
+
+  m.def("get_frame_format", &getFrameFormat, "spec"_a,
+        R"(Format the frames of a visual sensor of spec are read in, by its
+        type, channels and encoding)");
+
+  m.def("set_num_threads", &core::ThreadPool::setGlobalNumThreads,
+        "num_threads"_a,
+        R"(Size the thread pool of the process, 0 for one thread per core.
+        The first call or simulator configuration wins; returns False if
+        num_threads disagrees with it)");
 
   // ==== Renderer ====
   py::class_<Renderer, Renderer::ptr>(m, "Renderer")
       .def(py::init(&Renderer::create<int, int>))
       .def("set_size", &Renderer::setSize, R"(Set the size of the canvas)",
            "width"_a, "height"_a)
+      .def_property("render_stats_frames", &Renderer::getRenderStatsFrames,
+                    &Renderer::setRenderStatsFrames,
+                    R"(Number of frames to keep RenderStats of, 0 is off)")
+      .def("get_render_stats", &Renderer::getRenderStats, "wait"_a = true,
+           R"(RenderStats of the last render_stats_frames frames, oldest
+           first; waits for the frames still on the GPU unless wait is
+           False, which leaves those out)")
       .def(
           "readFrameRgba",
           [](Renderer& self,
@@ -325,15 +765,38 @@ PYBIND11_MODULE(habitat_sim_bindings, m) {
            Memory is NOT allocated to this array.
            Assume that ``m = height`` and ``n = width * 4``.
       )")
+      .def(
+          "read_frame",
+          [](Renderer& self, FrameFormat format, py::array img) {
+            py::buffer_info info = img.request(/* writable = */ true);
+            const vec3i size = self.getSize();
+            if (!(img.flags() & py::array::c_style) ||
+                info.size * info.itemsize !=
+                    size[0] * size[1] * getFrameFormatPixelBytes(format)) {
+              throw py::value_error{
+                  "img must be a C-contiguous array of the frame size"};
+            }
+            self.readFrame(format, info.ptr);
+          },
+          "format"_a, "img"_a.noconvert(),
+          R"(
+      Read the frame in format, converted on the GPU, into img, a writeable
+      C-contiguous numpy array of the bytes of the frame in that format.
+      )")
       .def("draw",
            py::overload_cast<sensor::Sensor&, scene::SceneGraph&>(
                &Renderer::draw),
            R"(Draw given scene using the visual sensor)", "visualSensor"_a,
-           "scene"_a)
+           "scene"_a, py::call_guard<py::gil_scoped_release>())
       .def("draw",
            py::overload_cast<gfx::RenderCamera&, scene::SceneGraph&>(
                &Renderer::draw),
-           R"(Draw given scene using the camera)", "camera"_a, "scene"_a)
+           R"(Draw given scene using the camera)", "camera"_a, "scene"_a,
+           py::call_guard<py::gil_scoped_release>())
+      .def("draw_panorama", &Renderer::drawPanorama,
+           R"(Draw the full sphere around the visual sensor from six faces)",
+           "visualSensor"_a, "scene"_a, "face_size"_a, "projection"_a,
+           py::call_guard<py::gil_scoped_release>())
       .def(
           "readFrameDepth",
           [](Renderer& self,
@@ -349,7 +812,160 @@ PYBIND11_MODULE(habitat_sim_bindings, m) {
                                       Eigen::RowMajor>>& img) {
             self.readFrameObjectId(img.data());
           },
-          py::arg("img").noconvert(), R"()");
+          py::arg("img").noconvert(), R"()")
+      .def(
+          "render_poses",
+          [](Renderer& self, scene::SceneGraph& sceneGraph,
+             py::array_t<float, py::array::c_style | py::array::forcecast>
+                 poses,
+             const SensorSpec& spec, py::array output) {
+            if (poses.ndim() != 3 || poses.shape(1) != 4 ||
+                poses.shape(2) != 4) {
+              throw py::value_error{"poses must be an N x 4 x 4 array"};
+            }
+            py::buffer_info info = output.request(/* writable = */ true);
+            if (!(output.flags() & py::array::c_style) ||
+                info.size * info.itemsize !=
+                    poses.shape(0) *
+                        getFrameFormatPixelBytes(getFrameFormat(spec)) *
+                        spec.resolution.prod()) {
+              throw py::value_error{
+                  "output must be a C-contiguous array of N frames"};
+            }
+            auto t = poses.unchecked<3>();
+            std::vector<Magnum::Matrix4> matrices(poses.shape(0));
+            for (size_t i = 0; i < matrices.size(); ++i) {
+              for (int row = 0; row < 4; ++row) {
+                for (int col = 0; col < 4; ++col) {
+                  matrices[i][col][row] = t(i, row, col);
+                }
+              }
+            }
+            py::gil_scoped_release release;
+            return self.renderPoses(sceneGraph, matrices, spec, info.ptr);
+          },
+          "scene"_a, "poses"_a, "spec"_a, "output"_a.noconvert(),
+          R"(
+      Render scene from each of poses, an N x 4 x 4 array of camera
+      transformations, at the resolution and projection of spec into
+      output, N frames in the FrameFormat of spec,
+      pipelining the readbacks. Returns False for an unsupported type.
+      )")
+      .def("read_frame_rgba_async", &Renderer::readFrameRgbaAsync,
+           R"(Queue an asynchronous readback of the RGBA frame, returns a ticket)")
+      .def("read_frame_depth_async", &Renderer::readFrameDepthAsync,
+           R"(Queue an asynchronous readback of the depth frame, returns a ticket)")
+      .def("read_frame_object_id_async", &Renderer::readFrameObjectIdAsync,
+           R"(Queue an asynchronous readback of the object id frame, returns a ticket)")
+      .def("is_frame_ready", &Renderer::isFrameReady, "ticket"_a)
+      .def(
+          "wait_frame",
+          [](Renderer& self, int ticket,
+             Eigen::Ref<Eigen::Matrix<uint8_t, Eigen::Dynamic, Eigen::Dynamic,
+                                      Eigen::RowMajor>>& img) {
+            return self.waitFrame(ticket, img.data());
+          },
+          "ticket"_a, py::arg("img").noconvert())
+      .def(
+          "wait_frame",
+          [](Renderer& self, int ticket,
+             Eigen::Ref<Eigen::Matrix<float, Eigen::Dynamic, Eigen::Dynamic,
+                                      Eigen::RowMajor>>& img) {
+            return self.waitFrame(ticket, img.data());
+          },
+          "ticket"_a, py::arg("img").noconvert())
+      .def(
+          "wait_frame",
+          [](Renderer& self, int ticket,
+             Eigen::Ref<Eigen::Matrix<uint32_t, Eigen::Dynamic, Eigen::Dynamic,
+                                      Eigen::RowMajor>>& img) {
+            return self.waitFrame(ticket, img.data());
+          },
+          "ticket"_a, py::arg("img").noconvert(),
+          R"(
+      Wait for the readback identified by ticket and copy it into img.
+      Returns False if the ticket is unknown or its buffer has been recycled.
+      )")
+      .def(
+          "read_batch_frame_rgba",
+          [](Renderer& self, int index,
+             Eigen::Ref<Eigen::Matrix<uint8_t, Eigen::Dynamic, Eigen::Dynamic,
+                                      Eigen::RowMajor>>& img) {
+            self.readBatchFrameRgba(index, img.data());
+          },
+          "index"_a, py::arg("img").noconvert(),
+          R"(Reads the RGBA frame of the index-th sensor of the last batch)")
+      .def(
+          "read_batch_frame_depth",
+          [](Renderer& self, int index,
+             Eigen::Ref<Eigen::Matrix<float, Eigen::Dynamic, Eigen::Dynamic,
+                                      Eigen::RowMajor>>& img) {
+            self.readBatchFrameDepth(index, img.data());
+          },
+          "index"_a, py::arg("img").noconvert(), R"()")
+      .def(
+          "read_batch_frame_object_id",
+          [](Renderer& self, int index,
+             Eigen::Ref<Eigen::Matrix<uint32_t, Eigen::Dynamic, Eigen::Dynamic,
+                                      Eigen::RowMajor>>& img) {
+            self.readBatchFrameObjectId(index, img.data());
+          },
+          "index"_a, py::arg("img").noconvert(), R"()")
+      .def_property("async_readback_frames",
+                    &Renderer::getAsyncReadbackFrames,
+                    &Renderer::setAsyncReadbackFrames)
+      .def_property("instanced_drawing", &Renderer::isInstancedDrawing,
+                    &Renderer::setInstancedDrawing)
+      .def_property("multi_draw_batching", &Renderer::isMultiDrawBatching,
+                    &Renderer::setMultiDrawBatching,
+                    R"(Submit the drawables of glTF meshes with
+                    multi-draw-indirect calls, with bindless textures or
+                    texture arrays)")
+      .def_property("frustum_culling", &Renderer::isFrustumCulling,
+                    &Renderer::setFrustumCulling)
+      .def_property("occlusion_culling", &Renderer::isOcclusionCulling,
+                    &Renderer::setOcclusionCulling,
+                    R"(Skip drawables hidden behind the largest drawables in
+                    view, tested against a hierarchical depth buffer)")
+      .def_property("region_culling", &Renderer::isRegionCulling,
+                    &Renderer::setRegionCulling,
+                    R"(Skip drawables in regions of the house not visible from
+                    the region of the camera, by the sets of the datatool
+                    create_region_visibility task)")
+      .def_property("drawable_sorting", &Renderer::isDrawableSorting,
+                    &Renderer::setDrawableSorting)
+      .def_property("sensor_specific_passes", &Renderer::isSensorSpecificPasses,
+                    &Renderer::setSensorSpecificPasses,
+                    R"(Draw only depth for depth sensors and only object ids
+                    for semantic sensors)")
+      .def_property("sensor_frame_sharing", &Renderer::isSensorFrameSharing,
+                    &Renderer::setSensorFrameSharing,
+                    R"(Keep the frame of the previous sensor for a sensor at
+                    the same pose observing the same unchanged scene graph)")
+      .def_property("lod_pixel_error", &Renderer::getLODPixelError,
+                    &Renderer::setLODPixelError)
+      // CUDA-GL interop, dev_ptr is a device address such as
+      // torch.Tensor.data_ptr() of a contiguous tensor on the GPU
+      .def(
+          "read_frame_rgba_cuda",
+          [](Renderer& self, std::uintptr_t devPtr) {
+            return self.readFrameRgbaCuda(reinterpret_cast<void*>(devPtr));
+          },
+          "dev_ptr"_a)
+      .def(
+          "read_frame_depth_cuda",
+          [](Renderer& self, std::uintptr_t devPtr) {
+            return self.readFrameDepthCuda(reinterpret_cast<void*>(devPtr));
+          },
+          "dev_ptr"_a)
+      .def(
+          "read_frame_object_id_cuda",
+          [](Renderer& self, std::uintptr_t devPtr) {
+            return self.readFrameObjectIdCuda(reinterpret_cast<void*>(devPtr));
+          },
+          "dev_ptr"_a)
+      .def_static("is_cuda_interop_available",
+                  &Renderer::isCudaInteropAvailable);
 
   // TODO fill out other SensorTypes
   // ==== enum SensorType ====
@@ -357,7 +973,10 @@ PYBIND11_MODULE(habitat_sim_bindings, m) {
       .value("NONE", SensorType::NONE)
       .value("COLOR", SensorType::COLOR)
       .value("DEPTH", SensorType::DEPTH)
-      .value("SEMANTIC", SensorType::SEMANTIC);
+      .value("SEMANTIC", SensorType::SEMANTIC)
+      .value("PATH", SensorType::PATH)
+      .value("GOAL", SensorType::GOAL)
+      .value("TENSOR", SensorType::TENSOR);
 
   // ==== SensorSpec ====
   py::class_<SensorSpec, SensorSpec::ptr>(m, "SensorSpec")
@@ -371,6 +990,8 @@ PYBIND11_MODULE(habitat_sim_bindings, m) {
       .def_readwrite("resolution", &SensorSpec::resolution)
       .def_readwrite("channels", &SensorSpec::channels)
       .def_readwrite("encoding", &SensorSpec::encoding)
+      .def_readwrite("frame_reuse", &SensorSpec::frameReuse)
+      .def_readwrite("supersampling", &SensorSpec::supersampling)
       .def_readwrite("observation_space", &SensorSpec::observationSpace)
       .def("__eq__",
            [](const SensorSpec& self, const SensorSpec& other) -> bool {
@@ -381,8 +1002,66 @@ PYBIND11_MODULE(habitat_sim_bindings, m) {
              return self != other;
            });
 
+  // ==== Buffer ====
+  py::class_<Buffer, Buffer::ptr>(m, "Buffer", py::buffer_protocol())
+      .def_buffer(&bufferInfo)
+      .def_readonly("shape", &Buffer::shape)
+      .def_readonly("total_bytes", &Buffer::totalBytes)
+      .def_property_readonly(
+          "data", [](const Buffer::ptr& self) { return bufferArrayView(self); },
+          R"(Numpy view of the data, without copying it. The view keeps the
+          buffer alive)");
+
   // ==== Observation ====
-  py::class_<Observation, Observation::ptr>(m, "Observation");
+  py::class_<Observation, Observation::ptr>(m, "Observation")
+      .def(py::init(&Observation::create<>))
+      .def_readonly("buffer", &Observation::buffer)
+      .def_property_readonly(
+          "data",
+          [](const Observation& self) { return bufferArrayView(self.buffer); },
+          R"(Numpy view of the observation, with the dtype of its data type.
+          Sensors reuse their buffer, so the view shows the latest observation
+          of the sensor; copy it to keep an older one)")
+      .def_readonly("encoded", &Observation::encoded)
+      .def_property_readonly(
+          "encoded_bytes",
+          [](const Observation& self) {
+            if (self.encoded == nullptr) {
+              throw py::value_error{"observation is not encoded"};
+            }
+            return py::bytes(static_cast<const char*>(self.encoded->data),
+                             self.encoded->totalBytes);
+          },
+          R"(Copy of the observation compressed by the codec of the encoding
+          of its sensor, to send to another process)");
+
+  // ==== ObservationEncoder ====
+  py::class_<ObservationEncoder, ObservationEncoder::ptr>(m,
+                                                          "ObservationEncoder")
+      .def_static("from_spec", &ObservationEncoder::fromSpec, "spec"_a,
+                  R"(Encoder of the codec of spec, None if its encoding has
+          none)")
+      .def_static("has_codec", &ObservationEncoder::hasCodec, "encoding"_a)
+      .def_property_readonly("shape", &ObservationEncoder::getShape)
+      .def(
+          "decode",
+          [](const ObservationEncoder& self, py::buffer encoded) {
+            py::buffer_info info = encoded.request();
+            Buffer::ptr observation = Buffer::create();
+            bool decoded;
+            {
+              py::gil_scoped_release release;
+              decoded = self.decode(info.ptr, info.size * info.itemsize,
+                                    *observation);
+            }
+            if (!decoded) {
+              throw py::value_error{"corrupted encoded observation"};
+            }
+            return bufferArrayView(observation);
+          },
+          "encoded"_a,
+          R"(Observation of the bytes of Observation.encoded_bytes, as a new
+          numpy array)");
 
   // ==== Sensor ====
   sensor
@@ -391,7 +1070,31 @@ PYBIND11_MODULE(habitat_sim_bindings, m) {
       .def("specification", &Sensor::specification)
       .def("set_transformation_from_spec", &Sensor::setTransformationFromSpec)
       .def("is_visual_sensor", &Sensor::isVisualSensor)
-      .def("get_observation", &Sensor::getObservation)
+      .def("get_observation", &Sensor::getObservation,
+           R"(Render into the buffer of this sensor and point observation at
+          it; observation.data is a view on it, not a copy)",
+           "sim"_a, "observation"_a)
+      .def(
+          "set_observation_buffer",
+          [](Sensor& self, py::array buffer) {
+            py::buffer_info info = buffer.request(/* writable = */ true);
+            if (!(buffer.flags() & py::array::c_style)) {
+              throw py::value_error{"observation buffer must be C-contiguous"};
+            }
+            return self.setObservationBuffer(info.ptr,
+                                             info.size * info.itemsize);
+          },
+          py::keep_alive<1, 2>(), "buffer"_a.noconvert(),
+          R"(
+      Make observations of this sensor be written directly into buffer, a
+      writeable C-contiguous numpy array matching the observation space.
+      The array is kept alive as long as the sensor.
+      )")
+      .def("reset_observation_buffer", &Sensor::resetObservationBuffer)
+      .def("encode_observation", &Sensor::encodeObservation,
+           R"(Compress observation with the codec of the encoding of the spec
+          into observation.encoded, a buffer of this sensor reused every step)",
+           "observation"_a)
       .def_property_readonly("node", nodeGetter<Sensor>,
                              "Node this object is attached to")
       .def_property_readonly("object", nodeGetter<Sensor>, "Alias to node");
@@ -409,6 +1112,42 @@ PYBIND11_MODULE(habitat_sim_bindings, m) {
            R"(Set the width, height, near, far, and hfov,
           stored in pinhole camera to the render camera.)");
 
+  // ==== PanoramicSensor (subclass of PinholeCamera) ====
+  py::class_<sensor::PanoramicSensor,
+             Magnum::SceneGraph::PyFeature<sensor::PanoramicSensor>,
+             sensor::PinholeCamera,
+             Magnum::SceneGraph::PyFeatureHolder<sensor::PanoramicSensor>>(
+      m, "PanoramicSensor")
+      .def(py::init_alias<std::reference_wrapper<scene::SceneNode>,
+                          const sensor::SensorSpec::ptr&>())
+      .def_property_readonly("projection",
+                             &sensor::PanoramicSensor::getProjection)
+      .def_property_readonly("face_size", &sensor::PanoramicSensor::getFaceSize)
+      .def_static(
+          "is_panoramic", &sensor::PanoramicSensor::isPanoramic, "spec"_a,
+          R"(Whether the sensor_subtype of spec is "equirect" or "cubemap")");
+
+  // ==== NavigationSensor (subclass of Sensor) ====
+  py::class_<sensor::NavigationSensor,
+             Magnum::SceneGraph::PyFeature<sensor::NavigationSensor>,
+             sensor::Sensor,
+             Magnum::SceneGraph::PyFeatureHolder<sensor::NavigationSensor>>(
+      m, "NavigationSensor")
+      .def(py::init_alias<std::reference_wrapper<scene::SceneNode>,
+                          const sensor::SensorSpec::ptr&>())
+      .def_property_readonly("goal", &sensor::NavigationSensor::getGoal)
+      .def_property_readonly("has_goal", &sensor::NavigationSensor::hasGoal)
+      .def("set_goal", &sensor::NavigationSensor::setGoal, "goal"_a,
+           R"(Set the goal of the episode, in world coordinates)")
+      .def("reset_episode", &sensor::NavigationSensor::resetEpisode,
+           R"(Take the pose of the agent at the next observation as the
+          start of the episode, which gps and compass sensors are relative
+          to)")
+      .def_static("is_navigation", &sensor::NavigationSensor::isNavigation,
+                  "spec"_a,
+                  R"(Whether spec is of a point goal (GOAL), geodesic
+          distance (PATH), or gps or compass (TENSOR) sensor)");
+
   // ==== SensorSuite ====
   py::class_<SensorSuite, SensorSuite::ptr>(m, "SensorSuite")
       .def(py::init(&SensorSuite::create<>))
@@ -434,6 +1173,7 @@ PYBIND11_MODULE(habitat_sim_bindings, m) {
                -> bool { return self != other; });
 
   // ==== SimulatorConfiguration ====
+  m.attr("AUTO_GPU_DEVICE") = AUTO_GPU_DEVICE;
   py::class_<SimulatorConfiguration, SimulatorConfiguration::ptr>(
       m, "SimulatorConfiguration")
       .def(py::init(&SimulatorConfiguration::create<>))
@@ -447,7 +1187,28 @@ PYBIND11_MODULE(habitat_sim_bindings, m) {
       .def_readwrite("height", &SimulatorConfiguration::height)
       .def_readwrite("compress_textures",
                      &SimulatorConfiguration::compressTextures)
+      .def_readwrite("optimize_meshes",
+                     &SimulatorConfiguration::optimizeMeshes)
+      .def_readwrite("stream_ptex_atlases",
+                     &SimulatorConfiguration::streamPTexAtlases)
+      .def_readwrite("stream_textures", &SimulatorConfiguration::streamTextures)
+      .def_readwrite("asset_cache_budget",
+                     &SimulatorConfiguration::assetCacheBudget)
+      .def_readwrite("shader_cache_dir",
+                     &SimulatorConfiguration::shaderCacheDir)
+      .def_readwrite("shared_cache_dir",
+                     &SimulatorConfiguration::sharedCacheDir)
+      .def_readwrite("num_threads", &SimulatorConfiguration::numThreads)
+      .def_readwrite("shareable_context",
+                     &SimulatorConfiguration::shareableContext)
+      .def_readwrite("semantic_id_mapping",
+                     &SimulatorConfiguration::semanticIdMapping)
+      .def_readwrite("nav_mesh_move_filter",
+                     &SimulatorConfiguration::navMeshMoveFilter)
+      .def_readwrite("agent_physics_bodies",
+                     &SimulatorConfiguration::agentPhysicsBodies)
       .def_readwrite("create_renderer", &SimulatorConfiguration::createRenderer)
+      .def_readwrite("lazy_renderer", &SimulatorConfiguration::lazyRenderer)
       .def_readwrite("enable_physics", &SimulatorConfiguration::enablePhysics)
       .def_readwrite("physics_config_file",
                      &SimulatorConfiguration::physicsConfigFile)
@@ -464,9 +1225,53 @@ PYBIND11_MODULE(habitat_sim_bindings, m) {
 
   initShortestPathBindings(m);
 
+  py::class_<assets::ResourceManager::MemoryStats>(m, "MemoryStats")
+      .def_readonly("mesh_bytes",
+                    &assets::ResourceManager::MemoryStats::meshBytes)
+      .def_readonly("texture_bytes",
+                    &assets::ResourceManager::MemoryStats::textureBytes)
+      .def_readonly("asset_bytes",
+                    &assets::ResourceManager::MemoryStats::assetBytes);
+
+  py::class_<assets::LoadTrace>(m, "LoadTrace")
+      .def_readonly("asset", &assets::LoadTrace::asset)
+      .def_property_readonly(
+          "stage_seconds",
+          [](const assets::LoadTrace& trace) {
+            std::map<std::string, double> seconds;
+            for (int i = 0; i < assets::numLoadStages; ++i) {
+              const auto stage = static_cast<assets::LoadStage>(i);
+              seconds[assets::loadStageName(stage)] = trace.seconds(stage);
+            }
+            return seconds;
+          },
+          R"(Seconds of each stage of the load: read, process, upload,
+          shaders, instantiate, collision and other)")
+      .def_readonly("total_seconds", &assets::LoadTrace::totalSeconds)
+      .def_readonly("peak_resident_bytes",
+                    &assets::LoadTrace::peakResidentBytes)
+      .def_readonly("gpu_bytes", &assets::LoadTrace::gpuBytes);
+
+  py::class_<SweepShape>(m, "SweepShape")
+      .def(py::init([](float radius, float halfHeight) {
+             return SweepShape{radius, halfHeight};
+           }),
+           R"(Capsule along the up axis swept by sweep_shapes, a sphere for
+           half_height 0)",
+           "radius"_a = 0.1f, "half_height"_a = 0.0f)
+      .def_readwrite("radius", &SweepShape::radius)
+      .def_readwrite("half_height", &SweepShape::halfHeight);
+
   // ==== Simulator ====
   py::class_<Simulator, Simulator::ptr>(m, "Simulator")
       .def(py::init(&Simulator::create<const SimulatorConfiguration&>))
+      .def(py::init(
+               &Simulator::create<const SimulatorConfiguration&, Simulator&>),
+           R"(
+      Simulator sharing the GL objects and assets of share_with, e.g. to run on
+      another thread; share_with needs the shareable_context configuration.
+      )",
+           "configuration"_a, "share_with"_a)
       .def("get_active_scene_graph", &Simulator::getActiveSceneGraph,
            R"(PYTHON DOES NOT GET OWNERSHIP)",
            pybind11::return_value_policy::reference)
@@ -476,9 +1281,37 @@ PYBIND11_MODULE(habitat_sim_bindings, m) {
            pybind11::return_value_policy::reference)
       .def_property_readonly("semantic_scene", &Simulator::getSemanticScene)
       .def_property_readonly("renderer", &Simulator::getRenderer)
+      .def_property_readonly("gpu_device", &Simulator::getGpuDevice)
+      .def_property("pathfinder", &Simulator::getPathFinder,
+                    &Simulator::setPathFinder,
+                    R"(Navmesh that geodesic distance sensors measure on)")
+      .def("get_memory_stats", &Simulator::getMemoryStats,
+           R"(GPU memory of the loaded meshes and textures, in bytes)")
+      .def("finish_streamed_textures", &Simulator::finishStreamedTextures,
+           R"(Load the streamed textures drawn so far before the next frame)")
+      .def("get_load_trace", &Simulator::getLoadTrace,
+           R"(Time of each stage of loading the last scene loaded)")
       .def("seed", &Simulator::seed, R"()", "new_seed"_a)
-      .def("reconfigure", &Simulator::reconfigure, R"()", "configuration"_a)
-      .def("reset", &Simulator::reset, R"()")
+      .def("reconfigure", &Simulator::reconfigure, R"()", "configuration"_a,
+           py::call_guard<py::gil_scoped_release>())
+      .def("prefetch_scene",
+           py::overload_cast<const SimulatorConfiguration&>(
+               &Simulator::prefetchScene),
+           R"(Decode the scene of configuration on a worker thread ahead of reconfigure())",
+           "configuration"_a, py::call_guard<py::gil_scoped_release>())
+      .def("prefetch_scene",
+           py::overload_cast<const SceneConfiguration&>(
+               &Simulator::prefetchScene),
+           "scene_configuration"_a, py::call_guard<py::gil_scoped_release>())
+      .def("cancel_prefetches", &Simulator::cancelPrefetches,
+           R"(Drop the prefetched scenes not loaded yet)",
+           py::call_guard<py::gil_scoped_release>())
+      .def("reset", &Simulator::reset, R"()",
+           py::call_guard<py::gil_scoped_release>())
+      .def("clone", &Simulator::clone,
+           R"(Fork sharing the GL context, renderer and assets, with a copy of
+           the physics objects and their states, for branching rollouts)",
+           py::call_guard<py::gil_scoped_release>())
       /* --- Physics functions --- */
       .def("add_object", &Simulator::addObject, "R()", "object_lib_index"_a,
            "scene_id"_a = 0)
@@ -488,8 +1321,38 @@ PYBIND11_MODULE(habitat_sim_bindings, m) {
            "sceneID"_a = 0)
       .def("get_existing_object_ids", &Simulator::getExistingObjectIDs, "R()",
            "sceneID"_a = 0)
-      .def("step_world", &Simulator::stepWorld, "R()", "dt"_a = 1.0 / 60.0)
+      .def("add_objects", &Simulator::addObjects,
+           R"(Adds an object of each of object_lib_indices and returns their
+           IDs, -1 for those that failed)",
+           "object_lib_indices"_a, "scene_id"_a = 0)
+      .def("remove_objects", &Simulator::removeObjects,
+           R"(Removes the objects of object_ids, e.g. on an episode reset)",
+           "object_ids"_a, "scene_id"_a = 0)
+      .def("step_world", &Simulator::stepWorld,
+           R"(Steps the physics num_steps times by dt in one go, e.g. for the
+           frames skipped per action, and returns the new world time)",
+           "dt"_a = 1.0 / 60.0, "num_steps"_a = 1,
+           py::call_guard<py::gil_scoped_release>())
       .def("get_world_time", &Simulator::getWorldTime, "R()")
+      .def(
+          "save_physics_state",
+          [](Simulator& self, int sceneID) {
+            const std::vector<char> state = self.savePhysicsState(sceneID);
+            return py::bytes(state.data(), state.size());
+          },
+          R"(Snapshot of the config files, poses, velocities and activation
+          states of all objects)",
+          "sceneID"_a = 0)
+      .def(
+          "restore_physics_state",
+          [](Simulator& self, const std::string& state, int sceneID) {
+            return self.restorePhysicsState(
+                std::vector<char>(state.begin(), state.end()), sceneID);
+          },
+          R"(Restores a snapshot of save_physics_state in place. Objects
+          added since are removed, objects of the snapshot removed since are
+          added again with their IDs. Returns false on failure)",
+          "state"_a, "sceneID"_a = 0)
       .def("set_transformation", &Simulator::setTransformation, "R()",
            "transform"_a, "object_id"_a, "sceneID"_a = 0)
       .def("get_transformation", &Simulator::getTransformation, "R()",
@@ -498,6 +1361,147 @@ PYBIND11_MODULE(habitat_sim_bindings, m) {
            "translation"_a, "object_id"_a, "sceneID"_a = 0)
       .def("get_translation", &Simulator::getTranslation, "R()", "object_id"_a,
            "sceneID"_a = 0)
+      .def(
+          "get_transformations",
+          [](Simulator& self, const std::vector<int>& objectIDs, int sceneID) {
+            const std::vector<Magnum::Matrix4> transforms =
+                self.getTransformations(objectIDs, sceneID);
+            py::array_t<float> result({static_cast<py::ssize_t>(
+                                           transforms.size()),
+                                       py::ssize_t{4}, py::ssize_t{4}});
+            auto r = result.mutable_unchecked<3>();
+            for (py::ssize_t i = 0; i < r.shape(0); ++i) {
+              // Magnum matrices are column-major
+              for (int row = 0; row < 4; ++row) {
+                for (int col = 0; col < 4; ++col) {
+                  r(i, row, col) = transforms[i][col][row];
+                }
+              }
+            }
+            return result;
+          },
+          R"(Transformations of many objects as an N x 4 x 4 array)",
+          "object_ids"_a, "sceneID"_a = 0)
+      .def(
+          "set_transformations",
+          [](Simulator& self,
+             py::array_t<float, py::array::c_style | py::array::forcecast>
+                 transforms,
+             const std::vector<int>& objectIDs, int sceneID) {
+            if (transforms.ndim() != 3 || transforms.shape(1) != 4 ||
+                transforms.shape(2) != 4 ||
+                transforms.shape(0) !=
+                    static_cast<py::ssize_t>(objectIDs.size())) {
+              throw py::value_error{
+                  "transforms must be an N x 4 x 4 array for N object_ids"};
+            }
+            auto t = transforms.unchecked<3>();
+            std::vector<Magnum::Matrix4> matrices(objectIDs.size());
+            for (size_t i = 0; i < matrices.size(); ++i) {
+              for (int row = 0; row < 4; ++row) {
+                for (int col = 0; col < 4; ++col) {
+                  matrices[i][col][row] = t(i, row, col);
+                }
+              }
+            }
+            self.setTransformations(matrices, objectIDs, sceneID);
+          },
+          R"(Sets the transformations of many objects from an N x 4 x 4 array)",
+          "transforms"_a, "object_ids"_a, "sceneID"_a = 0)
+      .def(
+          "get_translations",
+          [](Simulator& self, const std::vector<int>& objectIDs, int sceneID) {
+            const std::vector<Magnum::Vector3> translations =
+                self.getTranslations(objectIDs, sceneID);
+            // Vector3 is unpadded, so the translations are contiguous
+            return py::array_t<float>(
+                {static_cast<py::ssize_t>(translations.size()), py::ssize_t{3}},
+                reinterpret_cast<const float*>(translations.data()));
+          },
+          R"(Translations of many objects as an N x 3 array)", "object_ids"_a,
+          "sceneID"_a = 0)
+      .def(
+          "set_translations",
+          [](Simulator& self,
+             py::array_t<float, py::array::c_style | py::array::forcecast>
+                 translations,
+             const std::vector<int>& objectIDs, int sceneID) {
+            if (translations.ndim() != 2 || translations.shape(1) != 3 ||
+                translations.shape(0) !=
+                    static_cast<py::ssize_t>(objectIDs.size())) {
+              throw py::value_error{
+                  "translations must be an N x 3 array for N object_ids"};
+            }
+            std::vector<Magnum::Vector3> vectors(objectIDs.size());
+            std::copy_n(translations.data(), 3 * vectors.size(),
+                        reinterpret_cast<float*>(vectors.data()));
+            self.setTranslations(vectors, objectIDs, sceneID);
+          },
+          R"(Sets the translations of many objects from an N x 3 array)",
+          "translations"_a, "object_ids"_a, "sceneID"_a = 0)
+      .def(
+          "cast_rays",
+          [](Simulator& self,
+             py::array_t<float, py::array::c_style | py::array::forcecast>
+                 origins,
+             py::array_t<float, py::array::c_style | py::array::forcecast>
+                 directions,
+             float maxDistance, int sceneID) {
+            std::vector<Magnum::Vector3> originVectors, directionVectors;
+            raysFromArrays(origins, directions, originVectors,
+                           directionVectors);
+            std::vector<RaycastHit> hits;
+            {
+              py::gil_scoped_release release;
+              hits = self.castRays(originVectors, directionVectors,
+                                   maxDistance, sceneID);
+            }
+            return raycastHitArrays(hits);
+          },
+          R"(Closest hits of rays from the N x 3 origins along the N x 3
+          directions up to max_distance, as a dict of arrays: hit, object_id
+          (-1 for the scene), distance, point and normal)",
+          "origins"_a, "directions"_a, "max_distance"_a, "sceneID"_a = 0)
+      .def(
+          "sweep_shapes",
+          [](Simulator& self, const SweepShape& shape,
+             py::array_t<float, py::array::c_style | py::array::forcecast>
+                 origins,
+             py::array_t<float, py::array::c_style | py::array::forcecast>
+                 directions,
+             float maxDistance, int sceneID) {
+            std::vector<Magnum::Vector3> originVectors, directionVectors;
+            raysFromArrays(origins, directions, originVectors,
+                           directionVectors);
+            std::vector<RaycastHit> hits;
+            {
+              py::gil_scoped_release release;
+              hits = self.sweepShapes(shape, originVectors, directionVectors,
+                                      maxDistance, sceneID);
+            }
+            return raycastHitArrays(hits);
+          },
+          R"(Like cast_rays, for shape swept along the rays)", "shape"_a,
+          "origins"_a, "directions"_a, "max_distance"_a, "sceneID"_a = 0)
+      .def(
+          "contact_test",
+          [](Simulator& self, int objectID, int sceneID) {
+            return contactArrays(self.contactTest(objectID, sceneID));
+          },
+          R"(Touching and penetrating contacts of an object where it stands
+          now, without stepping, as a dict of arrays: object_id_a, object_id_b
+          (-1 for the scene), position_on_a, position_on_b, normal_on_b and
+          distance)",
+          "object_id"_a, "sceneID"_a = 0)
+      .def(
+          "overlap_aabb",
+          [](Simulator& self, const Magnum::Vector3& boxMin,
+             const Magnum::Vector3& boxMax, int sceneID) {
+            return self.overlapAABB({boxMin, boxMax}, sceneID);
+          },
+          R"(IDs of the objects whose collision bounds overlap the box from
+          box_min to box_max, -1 first for the scene)",
+          "box_min"_a, "box_max"_a, "sceneID"_a = 0)
       .def("set_rotation", &Simulator::setRotation, "R()", "rotation"_a,
            "object_id"_a, "sceneID"_a = 0)
       .def("get_rotation", &Simulator::getRotation, "R()", "object_id"_a,
@@ -506,4 +1510,126 @@ PYBIND11_MODULE(habitat_sim_bindings, m) {
            "relative_position"_a, "object_id"_a, "sceneID"_a = 0)
       .def("apply_torque", &Simulator::applyTorque, "R()", "torque"_a,
            "object_id"_a, "sceneID"_a = 0);
+
+  // ==== BatchSimulator ====
+  py::class_<BatchSimulator, Simulator, BatchSimulator::ptr>(m,
+                                                             "BatchSimulator")
+      .def(py::init(&BatchSimulator::create<const SimulatorConfiguration&,
+                                            int>),
+           "configuration"_a, "num_environments"_a)
+      .def_property_readonly("num_environments",
+                             &BatchSimulator::getNumEnvironments)
+      .def_property("active_environment", &BatchSimulator::getActiveEnvironment,
+                    &BatchSimulator::setActiveEnvironment)
+      .def("reconfigure_environment", &BatchSimulator::reconfigureEnvironment,
+           "env_index"_a, "scene"_a, py::call_guard<py::gil_scoped_release>())
+      .def("get_scene_id", &BatchSimulator::getSceneID,
+           R"(Scene ID of an environment, the scene_id of its physics
+           functions)",
+           "env_index"_a)
+      .def("get_scene_graph", &BatchSimulator::getSceneGraph,
+           R"(PYTHON DOES NOT GET OWNERSHIP)",
+           pybind11::return_value_policy::reference, "env_index"_a)
+      .def("get_semantic_scene_graph", &BatchSimulator::getSemanticSceneGraph,
+           R"(PYTHON DOES NOT GET OWNERSHIP)",
+           pybind11::return_value_policy::reference, "env_index"_a)
+      .def("get_semantic_scene",
+           py::overload_cast<int>(&BatchSimulator::getSemanticScene),
+           "env_index"_a)
+      .def("draw_batch", &BatchSimulator::drawBatch,
+           R"(Render the sensors of all environments in a single pass, read
+           the results with renderer.read_batch_frame_*())",
+           "visual_sensors"_a, "environment_ids"_a,
+           py::call_guard<py::gil_scoped_release>());
+
+  // ==== SimulatorClient ====
+  py::class_<sim::SimulatorClient, sim::SimulatorClient::ptr>(
+      m, "SimulatorClient",
+      R"(Client of the environments of a habitat-sim-server in another
+      process, exchanging actions and observations through shared memory)")
+      .def(py::init([](const std::string& name, double timeout) {
+             auto client = sim::SimulatorClient::create(
+                 name, static_cast<int64_t>(timeout * 1e6));
+             if (!client->isValid()) {
+               throw py::value_error{"server " + name + " is not serving"};
+             }
+             return client;
+           }),
+           R"(Connect to server name, waiting for at most timeout seconds
+           for it to serve, and for its responses later on)",
+           "name"_a, "timeout"_a = 60.0,
+           py::call_guard<py::gil_scoped_release>())
+      .def_property_readonly("num_envs", &sim::SimulatorClient::getNumEnvs)
+      .def("num_agents", &sim::SimulatorClient::getNumAgents, "env_index"_a)
+      .def("reset", &sim::SimulatorClient::reset,
+           R"(Reset all environments and observe)",
+           py::call_guard<py::gil_scoped_release>())
+      .def("step", &sim::SimulatorClient::step,
+           R"(Take an action with every agent of every environment, by action
+           index, the agents of each environment in turn, and observe)",
+           "action_ids"_a, py::call_guard<py::gil_scoped_release>())
+      .def("seed", &sim::SimulatorClient::seed, "new_seed"_a,
+           py::call_guard<py::gil_scoped_release>())
+      .def("submit_reset", &sim::SimulatorClient::submitReset, "env_index"_a)
+      .def(
+          "submit_step",
+          [](sim::SimulatorClient& self, int env,
+             const std::vector<int>& actionIds) {
+            if (env < 0 || env >= self.getNumEnvs() ||
+                static_cast<int>(actionIds.size()) != self.getNumAgents(env)) {
+              throw py::value_error{"expected an action id per agent"};
+            }
+            return self.submitStep(env, actionIds.data());
+          },
+          R"(Queue a step of an environment without waiting for it)",
+          "env_index"_a, "action_ids"_a)
+      .def("wait", &sim::SimulatorClient::wait,
+           R"(Wait for the oldest submitted request of an environment)",
+           "env_index"_a, py::call_guard<py::gil_scoped_release>())
+      .def(
+          "get_observations",
+          [](py::object self, int env) {
+            const auto& client = self.cast<const sim::SimulatorClient&>();
+            if (env < 0 || env >= client.getNumEnvs()) {
+              throw py::value_error{"no such environment"};
+            }
+            py::list agents;
+            for (int i = 0; i < client.getNumAgents(env); ++i) {
+              agents.append(py::dict());
+            }
+            const auto& observations = client.getObservations(env);
+            for (size_t i = 0; i < observations.size(); ++i) {
+              Buffer::ptr buffer = client.getObservation(env, i);
+              if (buffer == nullptr) {
+                throw py::value_error{"environment has not observed yet"};
+              }
+              const py::buffer_info info = bufferInfo(*buffer);
+              agents[observations[i].agentId][observations[i].sensorUuid] =
+                  py::array(py::dtype(info), info.shape, info.strides,
+                            info.ptr, self);
+            }
+            return agents;
+          },
+          R"(Observations of the last reset or step of an environment, a dict
+          by sensor uuid for each agent. The arrays view the shared frame and
+          are overwritten frames - 1 resets or steps later)",
+          "env_index"_a)
+      .def(
+          "get_agent_states",
+          [](py::object self, int env) {
+            const auto& client = self.cast<const sim::SimulatorClient&>();
+            if (env < 0 || env >= client.getNumEnvs() ||
+                client.getAgentStates(env) == nullptr) {
+              throw py::value_error{"environment has not observed yet"};
+            }
+            return py::array_t<float>(
+                {static_cast<py::ssize_t>(client.getNumAgents(env)),
+                 static_cast<py::ssize_t>(sim::ServerChannel::agentStateSize)},
+                client.getAgentStates(env), self);
+          },
+          R"(Position and rotation (x, y, z, w) of each agent of an
+          environment at its last observation, viewing the shared frame)",
+          "env_index"_a)
+      .def("stop", &sim::SimulatorClient::stop,
+           R"(Ask the server to stop serving every environment)");
 }
@@ -49,6 +49,7 @@ std::map<std::string, ObservationSpace> Simulator_getAgentObservationSpaces(
 EMSCRIPTEN_BINDINGS(habitat_sim_bindings_js) {
   em::register_vector<SensorSpec::ptr>("VectorSensorSpec");
   em::register_vector<size_t>("VectorSizeT");
+  em::register_vector<float>("VectorFloat");
   em::register_vector<std::string>("VectorString");
 
   em::register_map<std::string, float>("MapStringFloat");
@@ -122,7 +123,9 @@ EMSCRIPTEN_BINDINGS(habitat_sim_bindings_js) {
       .property("position", &SensorSpec::position)
       .property("orientation", &SensorSpec::orientation)
       .property("resolution", &SensorSpec::resolution)
-      .property("parameters", &SensorSpec::parameters);
+      .property("parameters", &SensorSpec::parameters)
+      .property("frameReuse", &SensorSpec::frameReuse)
+      .property("supersampling", &SensorSpec::supersampling);
 
   em::class_<Sensor>("Sensor").function("specification",
                                         &Sensor::specification);
@@ -146,7 +149,10 @@ EMSCRIPTEN_BINDINGS(habitat_sim_bindings_js) {
       .property("gpuDeviceId", &SimulatorConfiguration::gpuDeviceId)
       .property("width", &SimulatorConfiguration::width)
       .property("height", &SimulatorConfiguration::height)
-      .property("compressTextures", &SimulatorConfiguration::compressTextures);
+      .property("compressTextures", &SimulatorConfiguration::compressTextures)
+      .property("optimizeMeshes", &SimulatorConfiguration::optimizeMeshes)
+      .property("navMeshMoveFilter",
+                &SimulatorConfiguration::navMeshMoveFilter);
 
   em::class_<AgentState>("AgentState")
       .smart_ptr_constructor("AgentState", &AgentState::create<>)
@@ -155,7 +161,8 @@ EMSCRIPTEN_BINDINGS(habitat_sim_bindings_js) {
       .property("velocity", &AgentState::velocity)
       .property("angularVelocity", &AgentState::angularVelocity)
       .property("force", &AgentState::force)
-      .property("torque", &AgentState::torque);
+      .property("torque", &AgentState::torque)
+      .property("collided", &AgentState::collided);
 
   em::class_<Agent>("Agent")
       .smart_ptr<Agent::ptr>("Agent::ptr")
@@ -167,7 +174,12 @@ EMSCRIPTEN_BINDINGS(habitat_sim_bindings_js) {
       .function("getState", &Agent::getState)
       .function("setState", &Agent::setState)
       .function("hasAction", &Agent::hasAction)
-      .function("act", &Agent::act);
+      .function("act",
+                em::select_overload<bool(const std::string&)>(&Agent::act))
+      .function("actById", em::select_overload<bool(int)>(&Agent::act))
+      .function("actVelocity", &Agent::actVelocity)
+      .function("getActionId", &Agent::getActionId)
+      .function("getNumActions", &Agent::getNumActions);
 
   em::class_<Observation>("Observation")
       .smart_ptr_constructor("Observation", &Observation::create<>)
@@ -193,6 +205,9 @@ EMSCRIPTEN_BINDINGS(habitat_sim_bindings_js) {
                 &Simulator_getAgentObservationSpaces)
       .function("getAgentObservationSpace", &Simulator_getAgentObservationSpace)
       .function("getAgent", &SimulatorWithAgents::getAgent)
+      .function("getAgentStates", &SimulatorWithAgents::getAgentStates)
+      .function("setAgentStates", &SimulatorWithAgents::setAgentStates)
+      .function("setAgentPositions", &SimulatorWithAgents::setAgentPositions)
       .function("addAgent",
                 em::select_overload<Agent::ptr(const AgentConfiguration&)>(
                     &SimulatorWithAgents::addAgent))
@@ -7,16 +7,27 @@ class NavigateTask {
   /**
    * Create navigate task.
    * @param {SimEnv} sim - simulator
-   * @param {Object} components - dictionary with status and canvas elements
+   * @param {Object} components - dictionary with status and canvas elements;
+   *     the canvases may be OffscreenCanvases, and a setStatus(text) function
+   *     may replace the status element, e.g. when running in a worker
    */
   constructor(sim, components) {
     this.sim = sim;
     this.sensorId = 'rgba_camera';
     this.components = components;
     this.imageCtx = components.canvas.getContext("2d");
-    const shape = this.sim.getObservationSpace(this.sensorId).shape;
+    const space = this.sim.getObservationSpace(this.sensorId);
+    const shape = space.shape;
     this.imageData = this.imageCtx.createImageData(shape.get(1), shape.get(0));
+    shape.delete();
+    space.delete();
     this.radarCtx = components.radar.getContext("2d");
+    // linear to sRGB gamma of every 8 bit value, instead of a Math.pow per
+    // pixel and channel every frame
+    this.gammaTable = new Uint8ClampedArray(256);
+    for (let i = 0; i < 256; i++) {
+      this.gammaTable[i] = Math.pow(i/255.0, 2.2) * 255;
+    }
     this.actions = [
       { name: 'moveForward', key: 'w' },
       { name: 'lookLeft', key: 'a', },
@@ -44,22 +55,28 @@ class NavigateTask {
   // PRIVATE methods.
 
   setStatus(text) {
-    this.components.status.innerHTML = text;
+    if (this.components.setStatus) {
+      this.components.setStatus(text);
+    } else {
+      this.components.status.innerHTML = text;
+    }
   }
 
-  applyGamma(data, gamma) {
+  applyGamma(data) {
+    const table = this.gammaTable;
     for (let i = 0; i < data.length; i++) {
-      data[i] = Math.pow(data[i]/255.0, gamma) * 255;
+      data[i] = table[data[i]];
     }
   }
 
   renderImage() {
     const obs = this.sim.getObservation(this.sensorId, null);
+    // a view on the WASM heap, copied once into the image
     this.imageData.data.set(obs.getData());
+    obs.delete();
     // convert from linear to sRGB gamma
-    this.applyGamma(this.imageData.data, 2.2);
+    this.applyGamma(this.imageData.data);
     this.imageCtx.putImageData(this.imageData, 0, 0);
-    this.renderRadar();
   }
 
   renderRadar() {
@@ -106,15 +123,22 @@ class NavigateTask {
     this.render();
   }
 
+  /**
+   * Take the action bound to key, if any.
+   * @param {string} key - lower case key
+   */
+  handleKey(key) {
+    for (let a of this.actions) {
+      if (key === a.key) {
+        this.handleAction(a.name);
+        break;
+      }
+    }
+  }
+
   bindKeys() {
     document.addEventListener('keyup', (event) => {
-      const key = String.fromCharCode(event.which).toLowerCase();
-      for (let a of this.actions) {
-        if (key === a.key) {
-          this.handleAction(a.name);
-          break;
-        }
-      }
+      this.handleKey(String.fromCharCode(event.which).toLowerCase());
     });
   }
 }
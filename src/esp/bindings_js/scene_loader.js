@@ -0,0 +1,119 @@
+/**
+ * SceneLoader class
+ *
+ * Streams scene files from a server into the virtual file system of the
+ * module, for builds that do not --preload-file the scenes. Each file is
+ * written chunk by chunk as it arrives instead of being assembled in memory
+ * first. A coarse version of the scene, e.g. a decimated mesh saved next to
+ * the scene as <name>.coarse.glb, is loaded first if there is one, so that
+ * the first frame only waits for it and the navmesh.
+ */
+class SceneLoader {
+  // PUBLIC methods.
+
+  /**
+   * Create a scene loader.
+   * @param {string} baseUrl - url of the directory of the scenes
+   * @param {string} coarseSuffix - suffix of the coarse version of a scene,
+   *     before its extension, or null to always load the full scene only
+   */
+  constructor(baseUrl, coarseSuffix = '.coarse') {
+    this.baseUrl = baseUrl.endsWith('/') ? baseUrl : baseUrl + '/';
+    this.coarseSuffix = coarseSuffix;
+  }
+
+  /**
+   * Load the scene sceneId and its navmesh, calling onScene(filepaths, final)
+   * with the file system paths of the mesh and the navmesh to load, once with
+   * the coarse mesh if there is one, and with final true once the full mesh
+   * is loaded.
+   * Files already in the file system, e.g. preloaded, are not fetched again.
+   * @param {string} sceneId - path of the scene relative to baseUrl
+   * @param {function} onScene - called as each version of the scene is ready
+   * @param {function} onProgress - called as onProgress(path, loaded, total)
+   *     while files arrive, total is 0 if unknown
+   * @returns {Promise} resolved once the full scene is loaded
+   */
+  load(sceneId, onScene, onProgress = () => {}) {
+    const extension = sceneId.lastIndexOf('.');
+    const name = extension > 0 ? sceneId.substring(0, extension) : sceneId;
+    const navmeshId = name + '.navmesh';
+    const filepaths = mesh => ({ mesh: mesh, navmesh: this.path(navmeshId) });
+    // the navmesh is small and needed from the first frame, a missing one
+    // only disables navigation
+    return this.fetchFile(navmeshId, onProgress)
+      .then(() => {
+        if (this.coarseSuffix === null) {
+          return false;
+        }
+        const coarseId = name + this.coarseSuffix + sceneId.substring(
+            extension > 0 ? extension : sceneId.length);
+        return this.fetchFile(coarseId, onProgress).then(found => {
+          if (found) {
+            onScene(filepaths(this.path(coarseId)), false);
+          }
+          return found;
+        });
+      })
+      .then(() => this.fetchFile(sceneId, onProgress))
+      .then(found => {
+        if (!found) {
+          throw new Error('Scene ' + sceneId + ' not found');
+        }
+        onScene(filepaths(this.path(sceneId)), true);
+      });
+  }
+
+  /**
+   * Fetch baseUrl + id into the file system, skipping it if it already
+   * exists there.
+   * @param {string} id - path of the file relative to baseUrl
+   * @param {function} onProgress - called as onProgress(path, loaded, total)
+   * @returns {Promise} resolved to whether the file is in the file system
+   */
+  fetchFile(id, onProgress) {
+    const path = this.path(id);
+    if (FS.analyzePath(path).exists) {
+      return Promise.resolve(true);
+    }
+    return fetch(this.baseUrl + id).then(response => {
+      if (!response.ok) {
+        return false;
+      }
+      const total = parseInt(response.headers.get('Content-Length')) || 0;
+      const directory = path.substring(0, path.lastIndexOf('/'));
+      if (directory.length > 0) {
+        FS.mkdirTree(directory);
+      }
+      // write to a temporary file, so that a failed download does not leave
+      // a truncated file behind to be skipped as loaded
+      const partial = path + '.part';
+      const stream = FS.open(partial, 'w');
+      const reader = response.body.getReader();
+      let loaded = 0;
+      const pump = () => reader.read().then(chunk => {
+        if (chunk.done) {
+          FS.close(stream);
+          FS.rename(partial, path);
+          return true;
+        }
+        FS.write(stream, chunk.value, 0, chunk.value.length);
+        loaded += chunk.value.length;
+        onProgress(path, loaded, total);
+        return pump();
+      });
+      return pump().catch(error => {
+        FS.close(stream);
+        FS.unlink(partial);
+        throw error;
+      });
+    });
+  }
+
+  // PRIVATE methods.
+
+  // File system path of the file id, where --preload-file puts the scenes.
+  path(id) {
+    return id.startsWith('/') ? id : '/' + id;
+  }
+}
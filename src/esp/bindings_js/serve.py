@@ -0,0 +1,39 @@
+#!/usr/bin/env python3
+
+# Copyright (c) Facebook, Inc. and its affiliates.
+# This source code is licensed under the MIT license found in the
+# LICENSE file in the root directory of this source tree.
+
+# Static file server for the WebAssembly builds, like python3 -m http.server,
+# but sending the headers that make pages cross-origin isolated, which
+# browsers require for the SharedArrayBuffer of the threaded build (see
+# build_js.sh --threads). Serves the current directory, e.g. the root of the
+# repository, so that the pages can also stream scenes from data/
+
+import argparse
+import http.server
+
+
+class CrossOriginIsolatedHandler(http.server.SimpleHTTPRequestHandler):
+    def end_headers(self):
+        self.send_header("Cross-Origin-Opener-Policy", "same-origin")
+        self.send_header("Cross-Origin-Embedder-Policy", "require-corp")
+        self.send_header("Cross-Origin-Resource-Policy", "same-origin")
+        super().end_headers()
+
+
+CrossOriginIsolatedHandler.extensions_map[".wasm"] = "application/wasm"
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--bind", default="0.0.0.0")
+    parser.add_argument("--port", type=int, default=8000)
+    args = parser.parse_args()
+    server = http.server.ThreadingHTTPServer(
+        (args.bind, args.port), CrossOriginIsolatedHandler
+    )
+    print(
+        "Serving cross-origin isolated on http://{}:{}".format(args.bind, args.port)
+    )
+    server.serve_forever()
@@ -0,0 +1,103 @@
+/**
+ * Web Worker running the simulator and the navigate task off the main thread,
+ * rendering into OffscreenCanvases transferred from the page, so that the
+ * page stays responsive while frames are simulated.
+ *
+ * Messages from the page:
+ *   {type: 'init', canvas, canvas2d, radar, sceneId, sceneBaseUrl,
+ *    agentConfig, episode}
+ *       canvas is the WebGL canvas of the simulator, canvas2d and radar are
+ *       the canvases of NavigateTask, all OffscreenCanvases; scenes not in
+ *       the build are streamed from sceneBaseUrl, see SceneLoader
+ *   {type: 'key', key} - a key released on the page
+ *   {type: 'observation', buffer} - post the current observation of the task
+ *       sensor back, into buffer if it is an ArrayBuffer of the right size
+ *
+ * Messages to the page:
+ *   {type: 'status', text} - status of the task
+ *   {type: 'observation', buffer, shape} - the observation, with buffer
+ *       transferred rather than copied; transfer it back with the next
+ *       'observation' request to have it reused
+ */
+
+importScripts('navigate.js', 'simenv_embind.js', 'scene_loader.js');
+
+let task = null;
+
+function init(data) {
+  // the EGL emulation of emscripten creates the WebGL context on
+  // Module.canvas, which may be an OffscreenCanvas
+  self.Module = {
+    canvas: data.canvas,
+    // the web workers of a threaded build load the module from here, as it
+    // is not the script of this worker
+    mainScriptUrlOrBlob: 'hsim_bindings.js',
+    print: text => console.log(text),
+    printErr: text => console.error(text),
+    onRuntimeInitialized: () => {
+      const setStatus =
+          text => self.postMessage({ type: 'status', text: text });
+      let simenv = null;
+      const loader = new SceneLoader(data.sceneBaseUrl);
+      loader.load(data.sceneId, filepaths => {
+        const config = SimEnv.createConfig(data.sceneId, filepaths);
+        if (simenv === null) {
+          simenv = new SimEnv(config, data.episode, 0);
+          simenv.addAgent(data.agentConfig);
+          task = new NavigateTask(simenv, {
+            canvas: data.canvas2d,
+            radar: data.radar,
+            setStatus: setStatus
+          });
+          task.reset();
+        } else {
+          simenv.reconfigure(config);
+          task.render();
+        }
+      }, (path, loaded, total) => {
+        if (task === null) {
+          setStatus('Loading ' + path + ' ' +
+                    (total > 0 ? Math.round(100 * loaded / total) + '%' :
+                                 loaded + ' bytes'));
+        }
+      }).catch(error => setStatus(error.message));
+    }
+  };
+  importScripts('hsim_bindings.js');
+}
+
+function postObservation(buffer) {
+  const obs = task.sim.getObservation(task.sensorId, null);
+  const data = obs.getData();
+  if (!(buffer instanceof ArrayBuffer) ||
+      buffer.byteLength !== data.byteLength) {
+    buffer = new ArrayBuffer(data.byteLength);
+  }
+  // the view on the WASM heap cannot be transferred, so copy it once
+  new Uint8Array(buffer).set(data);
+  obs.delete();
+
+  const space = task.sim.getObservationSpace(task.sensorId);
+  const dims = space.shape;
+  const shape = [];
+  for (let i = 0; i < dims.size(); i++) {
+    shape.push(dims.get(i));
+  }
+  dims.delete();
+  space.delete();
+  self.postMessage({ type: 'observation', buffer: buffer, shape: shape },
+                   [buffer]);
+}
+
+self.onmessage = event => {
+  const data = event.data;
+  if (data.type === 'init') {
+    init(data);
+  } else if (task === null) {
+    // not initialized yet
+  } else if (data.type === 'key') {
+    task.handleKey(data.key);
+  } else if (data.type === 'observation') {
+    postObservation(data.buffer);
+  }
+};
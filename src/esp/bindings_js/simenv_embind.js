@@ -15,6 +15,47 @@ class SimEnv {
     this.episode = episode;
     this.initialAgentState = this.createAgentState(episode.startState);
     this.defaultAgentId = agentId;
+    this.agentConfigs = [];
+  }
+
+  /**
+   * Replace the simulator by one with config, adding the same agents again
+   * and keeping the state of the default agent, e.g. to swap a coarse scene
+   * for the full one once it is loaded.
+   * @param {Object} config - simulator config
+   */
+  reconfigure(config) {
+    const state = new Module.AgentState();
+    this.sim.getAgent(this.defaultAgentId).getState(state);
+    // the renderer of the old simulator has to go before the new one is made
+    this.sim.delete();
+    this.sim = new Module.Simulator(config);
+    for (let agentConfig of this.agentConfigs) {
+      this.sim.addAgent(this.createAgentConfig(agentConfig));
+    }
+    this.sim.getAgent(this.defaultAgentId).setState(state, true);
+    state.delete();
+  }
+
+  /**
+   * Create a simulator config for a scene.
+   * @param {string} sceneId - id of the scene
+   * @param {Object} filepaths - paths of the scene files by type, e.g. mesh
+   *     and navmesh, see SceneLoader
+   * @returns {SimulatorConfiguration} simulator config
+   */
+  static createConfig(sceneId, filepaths = {}) {
+    const sceneConfig = new Module.SceneConfiguration();
+    sceneConfig.id = sceneId;
+    const paths = new Module.MapStringString();
+    for (let key in filepaths) {
+      paths.set(key, filepaths[key]);
+    }
+    sceneConfig.filepaths = paths;
+    paths.delete();
+    const config = new Module.SimulatorConfiguration();
+    config.scene = sceneConfig;
+    return config;
   }
 
   /**
@@ -40,6 +81,7 @@ class SimEnv {
    * @param {Object} config - agent config
    */
   addAgent(config) {
+    this.agentConfigs.push(config);
     return this.sim.addAgent(this.createAgentConfig(config));
   }
 
@@ -53,7 +95,8 @@ class SimEnv {
   }
 
   /**
-   * Get an observation from the given sensorId.
+   * Get an observation from the given sensorId, to be deleted by the caller.
+   * Its getData() is a view on the WASM heap, valid until the next step.
    * @param {number} sensorId - id of sensor
    * @returns {Observation} observation from sensor
    */
@@ -75,6 +118,8 @@ class SimEnv {
     let src = state.position;
     let dv = [dst[0] - src[0], dst[1] - src[1], dst[2] - src[2]];
     dv = this.applyRotation(dv, state.rotation);
+    // embind objects live on the WASM heap until deleted
+    state.delete();
     return this.cartesian_to_polar(-dv[2], dv[0]);
   }
 
@@ -0,0 +1,58 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#include "Arena.h"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace esp {
+namespace core {
+
+Arena& Arena::threadLocal() {
+  thread_local Arena arena;
+  return arena;
+}
+
+void* Arena::allocate(size_t bytes,
+                      size_t alignment /* = alignof(std::max_align_t) */) {
+  // the blocks after the current one are free, take the first that fits
+  for (; block_ < blocks_.size(); ++block_, offset_ = 0) {
+    Block& block = blocks_[block_];
+    const uintptr_t base = reinterpret_cast<uintptr_t>(block.data.get());
+    const size_t begin =
+        ((base + offset_ + alignment - 1) & ~(alignment - 1)) - base;
+    if (begin + bytes <= block.size) {
+      offset_ = begin + bytes;
+      return block.data.get() + begin;
+    }
+  }
+  // new[] of char is aligned for std::max_align_t only
+  const size_t size = std::max(blockBytes_, bytes + alignment);
+  blocks_.push_back({std::unique_ptr<char[]>(new char[size]), size});
+  block_ = blocks_.size() - 1;
+  offset_ = 0;
+  return allocate(bytes, alignment);
+}
+
+void Arena::reset() {
+  if (blocks_.size() > 1) {
+    const size_t capacity = getCapacity();
+    blocks_.clear();
+    blocks_.push_back({std::unique_ptr<char[]>(new char[capacity]), capacity});
+  }
+  block_ = 0;
+  offset_ = 0;
+}
+
+size_t Arena::getCapacity() const {
+  size_t capacity = 0;
+  for (const Block& block : blocks_) {
+    capacity += block.size;
+  }
+  return capacity;
+}
+
+}  // namespace core
+}  // namespace esp
@@ -0,0 +1,130 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "esp/core/esp.h"
+
+namespace esp {
+namespace core {
+
+// Monotonic allocator for the scratch memory of a step: allocations bump a
+// pointer through blocks that are only given back to the system when the
+// arena is destroyed, and all of them are released at once by rewinding.
+// reset() merges the blocks into one of their total size, so that once a
+// step has run, the following ones of up to the same size allocate from the
+// system no more. Not thread safe; Arena::threadLocal() gives each thread,
+// including those of the ThreadPool, its own
+class Arena {
+ public:
+  explicit Arena(size_t blockBytes = size_t(64) << 10)
+      : blockBytes_(blockBytes) {}
+
+  //! The arena of the calling thread
+  static Arena& threadLocal();
+
+  //! bytes aligned to alignment, a power of two, valid until the arena is
+  //! rewound past them
+  void* allocate(size_t bytes, size_t alignment = alignof(std::max_align_t));
+
+  //! Position of the arena, to rewind() to
+  struct Mark {
+    size_t block;
+    size_t offset;
+  };
+  Mark mark() const { return {block_, offset_}; }
+
+  //! Release everything allocated since mark
+  void rewind(const Mark& mark) {
+    block_ = mark.block;
+    offset_ = mark.offset;
+  }
+
+  //! Release everything, merging the blocks into one
+  void reset();
+
+  //! Bytes of the blocks, used or not
+  size_t getCapacity() const;
+  size_t getNumBlocks() const { return blocks_.size(); }
+
+ protected:
+  struct Block {
+    std::unique_ptr<char[]> data;
+    size_t size;
+  };
+  std::vector<Block> blocks_;
+  // next free byte of block_
+  size_t block_ = 0;
+  size_t offset_ = 0;
+  size_t blockBytes_;
+
+  ESP_SMART_POINTERS(Arena)
+};
+
+// Rewinds an arena on destruction to where it was on construction, so that
+// the scratch memory of a function is released when it returns. The
+// outermost scope of an arena resets it
+class ArenaScope {
+ public:
+  explicit ArenaScope(Arena& arena = Arena::threadLocal())
+      : arena_(arena), mark_(arena.mark()) {}
+  ~ArenaScope() {
+    if (mark_.block == 0 && mark_.offset == 0) {
+      arena_.reset();
+    } else {
+      arena_.rewind(mark_);
+    }
+  }
+  ArenaScope(const ArenaScope&) = delete;
+  ArenaScope& operator=(const ArenaScope&) = delete;
+
+ protected:
+  Arena& arena_;
+  Arena::Mark mark_;
+};
+
+// Standard allocator drawing from an Arena; deallocation is a no-op, the
+// memory comes back when the arena is rewound
+template <typename T>
+class ArenaAllocator {
+ public:
+  typedef T value_type;
+
+  ArenaAllocator() noexcept : arena_(&Arena::threadLocal()) {}
+  explicit ArenaAllocator(Arena& arena) noexcept : arena_(&arena) {}
+  template <typename U>
+  ArenaAllocator(const ArenaAllocator<U>& other) noexcept
+      : arena_(other.arena()) {}
+
+  T* allocate(size_t n) {
+    return static_cast<T*>(arena_->allocate(n * sizeof(T), alignof(T)));
+  }
+  void deallocate(T*, size_t) noexcept {}
+
+  Arena* arena() const { return arena_; }
+
+ protected:
+  Arena* arena_;
+};
+
+template <typename T, typename U>
+bool operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) {
+  return a.arena() == b.arena();
+}
+template <typename T, typename U>
+bool operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) {
+  return !(a == b);
+}
+
+//! Vector in the arena of the calling thread, for scratch arrays that must
+//! not be used after the ArenaScope they were created in
+template <typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+}  // namespace core
+}  // namespace esp
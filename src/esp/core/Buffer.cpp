@@ -4,9 +4,100 @@
 
 #include "Buffer.h"
 
+#include <cstdlib>
+#include <map>
+#include <mutex>
+
+#include "esp/core/MemoryTracking.h"
+
 namespace esp {
 namespace core {
 
+namespace {
+// allocations of at most this many times the requested size are taken from
+// the pool
+constexpr size_t maxPoolOvershoot = 2;
+
+size_t getAllocationAlignment(size_t bytes) {
+  return bytes >= bufferPageBytes ? bufferPageBytes : bufferAlignment;
+}
+
+struct BufferPool {
+  std::mutex mutex;
+  // free allocations by their size
+  std::multimap<size_t, void*> allocations;
+  size_t totalBytes = 0;
+};
+
+BufferPool& getBufferPool() {
+  // never destroyed, so that buffers freed during static destruction can
+  // still return their memory
+  static BufferPool* pool = new BufferPool();
+  return *pool;
+}
+
+// aligned memory for at least bytes bytes, from the pool if it has some;
+// capacity receives the size of the allocation. Counted as live buffer
+// memory until freeBufferData(), pooled or not
+void* allocateBufferData(size_t bytes, size_t& capacity) {
+  BufferPool& pool = getBufferPool();
+  {
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    auto it = pool.allocations.lower_bound(bytes);
+    if (it != pool.allocations.end() &&
+        it->first <= maxPoolOvershoot * bytes &&
+        getAllocationAlignment(it->first) >= getAllocationAlignment(bytes)) {
+      void* data = it->second;
+      capacity = it->first;
+      pool.totalBytes -= it->first;
+      pool.allocations.erase(it);
+      trackAllocation(MemoryTag::Buffers, capacity);
+      return data;
+    }
+  }
+  const size_t alignment = getAllocationAlignment(bytes);
+  capacity = (bytes + alignment - 1) / alignment * alignment;
+  void* data = nullptr;
+  if (posix_memalign(&data, alignment, capacity) != 0) {
+    LOG(ERROR) << "Cannot allocate a buffer of " << capacity << " bytes";
+    capacity = 0;
+    return nullptr;
+  }
+  trackAllocation(MemoryTag::Buffers, capacity);
+  return data;
+}
+
+void freeBufferData(void* data, size_t capacity) {
+  trackFree(MemoryTag::Buffers, capacity);
+  BufferPool& pool = getBufferPool();
+  {
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    if (pool.totalBytes + capacity <= bufferPoolBytes) {
+      pool.allocations.emplace(capacity, data);
+      pool.totalBytes += capacity;
+      return;
+    }
+  }
+  free(data);
+}
+}  // namespace
+
+void releaseBufferPool() {
+  BufferPool& pool = getBufferPool();
+  std::lock_guard<std::mutex> lock(pool.mutex);
+  for (const auto& allocation : pool.allocations) {
+    free(allocation.second);
+  }
+  pool.allocations.clear();
+  pool.totalBytes = 0;
+}
+
+size_t getBufferPoolBytes() {
+  BufferPool& pool = getBufferPool();
+  std::lock_guard<std::mutex> lock(pool.mutex);
+  return pool.totalBytes;
+}
+
 size_t getDataTypeByteSize(DataType dt) {
   switch (dt) {
     case DataType::DT_INT8:
@@ -14,6 +105,7 @@ size_t getDataTypeByteSize(DataType dt) {
       return 1;
     case DataType::DT_INT16:
     case DataType::DT_UINT16:
+    case DataType::DT_FLOAT16:
       return 2;
     case DataType::DT_INT32:
     case DataType::DT_UINT32:
@@ -30,6 +122,21 @@ size_t getDataTypeByteSize(DataType dt) {
   }
 }
 
+Buffer::Buffer(void* externalData,
+               const std::vector<size_t> shape,
+               const DataType dataType) {
+  this->shape = shape;
+  this->dataType = dataType;
+  this->ownsData_ = false;
+  this->data = externalData;
+  this->totalSize = 1;
+  for (size_t i = 0; i < this->shape.size(); i++) {
+    this->totalSize *= this->shape[i];
+  }
+  this->totalBytes = this->totalSize * getDataTypeByteSize(this->dataType);
+  this->capacityBytes_ = this->totalBytes;
+}
+
 void Buffer::clear() {
   if (this->data != nullptr) {
     memset(this->data, 0, this->totalBytes);
@@ -46,17 +153,44 @@ void Buffer::alloc() {
     this->totalSize = size;
     this->totalBytes = size * getDataTypeByteSize(this->dataType);
     if (this->totalBytes > 0) {
-      this->data = malloc(this->totalBytes);
+      this->data = allocateBufferData(this->totalBytes, this->capacityBytes_);
     }
   }
 }
 
+bool Buffer::resize(const std::vector<size_t>& shape, DataType dataType) {
+  size_t size = 1;
+  for (size_t i = 0; i < shape.size(); i++) {
+    size *= shape[i];
+  }
+  const size_t bytes = size * getDataTypeByteSize(dataType);
+  if (bytes > this->capacityBytes_) {
+    if (!ownsData_) {
+      LOG(ERROR) << "Cannot resize an external buffer of "
+                 << this->capacityBytes_ << " bytes to " << bytes << " bytes";
+      return false;
+    }
+    dealloc();
+    if (bytes > 0) {
+      this->data = allocateBufferData(bytes, this->capacityBytes_);
+    }
+  }
+  this->shape = shape;
+  this->dataType = dataType;
+  this->totalSize = size;
+  this->totalBytes = bytes;
+  return true;
+}
+
 void Buffer::dealloc() {
   if (this->data != nullptr) {
-    free(this->data);
+    if (ownsData_) {
+      freeBufferData(this->data, this->capacityBytes_);
+    }
     this->data = nullptr;
     this->totalSize = 0;
     this->totalBytes = 0;
+    this->capacityBytes_ = 0;
   }
 }
 
@@ -22,8 +22,29 @@ enum class DataType {
   DT_UINT64 = 8,
   DT_FLOAT = 9,
   DT_DOUBLE = 10,
+  // IEEE 754 half precision float
+  DT_FLOAT16 = 11,
 };
 
+// size in bytes of a single element of the given type
+size_t getDataTypeByteSize(DataType dt);
+
+// Every Buffer owning its data allocates it aligned to bufferAlignment bytes,
+// and buffers of at least bufferPageBytes to whole pages, so that it can be
+// used for SIMD loads and DMA transfers. Freed allocations are kept in a
+// process-wide pool of up to bufferPoolBytes, so that buffers recreated with
+// the same sizes (e.g., by the sensors of a reconfigured simulator) do not go
+// back to the system allocator
+constexpr size_t bufferAlignment = 64;
+constexpr size_t bufferPageBytes = 4096;
+constexpr size_t bufferPoolBytes = size_t(256) << 20;
+
+// free the memory kept in the buffer pool
+void releaseBufferPool();
+
+// total bytes currently kept in the buffer pool
+size_t getBufferPoolBytes();
+
 class Buffer {
  public:
   explicit Buffer(){};
@@ -32,13 +53,33 @@ class Buffer {
     this->dataType = dataType;
     alloc();
   };
+  // wrap externally owned memory (e.g., a numpy array or a pinned host
+  // tensor) without copying; the caller must keep it alive for the lifetime
+  // of this Buffer, which will never free it
+  explicit Buffer(void* externalData,
+                  const std::vector<size_t> shape,
+                  const DataType dataType);
   void clear();
   virtual ~Buffer() { dealloc(); }
 
+  // change the shape and data type, keeping the allocation if it is large
+  // enough, so that the contents are not preserved. Returns false, leaving the
+  // buffer unchanged, if the data is not owned and would not fit
+  bool resize(const std::vector<size_t>& shape, DataType dataType);
+
+  // bytes the current allocation can hold
+  size_t capacityBytes() const { return capacityBytes_; }
+
+  // whether data is owned (allocated and freed) by this Buffer
+  bool ownsData() const { return ownsData_; }
+
  protected:
   void alloc();
   void dealloc();
 
+  bool ownsData_ = true;
+  size_t capacityBytes_ = 0;
+
  public:
   void* data = nullptr;
   size_t totalBytes = 0;
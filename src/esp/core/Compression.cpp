@@ -0,0 +1,196 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#include "Compression.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace esp {
+namespace core {
+
+namespace {
+// limits of the block format: matches are at least minMatch bytes, the last
+// lastLiterals bytes are always literals, and no match starts in the last
+// matchFindLimit bytes
+constexpr size_t minMatch = 4;
+constexpr size_t lastLiterals = 5;
+constexpr size_t matchFindLimit = 12;
+constexpr size_t maxOffset = 65535;
+constexpr int hashBits = 12;
+
+inline uint32_t read32(const uint8_t* p) {
+  uint32_t value;
+  std::memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+inline uint32_t hash32(uint32_t sequence) {
+  return (sequence * 2654435761u) >> (32 - hashBits);
+}
+
+// length of a run of more than 14 bytes, after the 15 in its token
+inline uint8_t* writeLength(uint8_t* out, size_t length) {
+  for (; length >= 255; length -= 255) {
+    *out++ = 255;
+  }
+  *out++ = uint8_t(length);
+  return out;
+}
+
+// bytes a sequence of numLiterals literals and a match of matchLength takes
+// at most, matchLength 0 for the last sequence, which has no match
+inline size_t sequenceBound(size_t numLiterals, size_t matchLength) {
+  return 1 + numLiterals / 255 + 1 + numLiterals +
+         (matchLength > 0 ? 2 + matchLength / 255 + 1 : 0);
+}
+}  // namespace
+
+size_t lz4Compress(const void* src,
+                   size_t srcBytes,
+                   void* dst,
+                   size_t dstCapacity) {
+  const uint8_t* in = static_cast<const uint8_t*>(src);
+  uint8_t* out = static_cast<uint8_t*>(dst);
+  uint8_t* const outEnd = out + dstCapacity;
+  size_t anchor = 0;
+
+  if (srcBytes > matchFindLimit) {
+    // position + 1 of the last occurrence of each hashed 4-byte sequence
+    uint32_t table[1 << hashBits] = {};
+    const size_t findLimit = srcBytes - matchFindLimit;
+    const size_t matchLimit = srcBytes - lastLiterals;
+    size_t i = 0;
+    while (i < findLimit) {
+      const uint32_t sequence = read32(in + i);
+      uint32_t& entry = table[hash32(sequence)];
+      const size_t candidate = size_t(entry) - 1;
+      entry = uint32_t(i + 1);
+      if (candidate >= i || i - candidate > maxOffset ||
+          read32(in + candidate) != sequence) {
+        // skip faster through data that does not compress
+        i += 1 + ((i - anchor) >> 6);
+        continue;
+      }
+
+      size_t start = i;
+      size_t match = candidate;
+      while (start > anchor && match > 0 && in[start - 1] == in[match - 1]) {
+        --start;
+        --match;
+      }
+      size_t length = minMatch + (i - start);
+      while (start + length < matchLimit &&
+             in[match + length] == in[start + length]) {
+        ++length;
+      }
+
+      const size_t numLiterals = start - anchor;
+      if (sequenceBound(numLiterals, length) > size_t(outEnd - out)) {
+        return 0;
+      }
+      const size_t matchCode = length - minMatch;
+      uint8_t* token = out++;
+      *token = uint8_t((std::min<size_t>(numLiterals, 15) << 4) |
+                       std::min<size_t>(matchCode, 15));
+      if (numLiterals >= 15) {
+        out = writeLength(out, numLiterals - 15);
+      }
+      std::memcpy(out, in + anchor, numLiterals);
+      out += numLiterals;
+      const size_t offset = start - match;
+      *out++ = uint8_t(offset);
+      *out++ = uint8_t(offset >> 8);
+      if (matchCode >= 15) {
+        out = writeLength(out, matchCode - 15);
+      }
+
+      i = start + length;
+      anchor = i;
+    }
+  }
+
+  const size_t numLiterals = srcBytes - anchor;
+  if (sequenceBound(numLiterals, 0) > size_t(outEnd - out)) {
+    return 0;
+  }
+  *out++ = uint8_t(std::min<size_t>(numLiterals, 15) << 4);
+  if (numLiterals >= 15) {
+    out = writeLength(out, numLiterals - 15);
+  }
+  std::memcpy(out, in + anchor, numLiterals);
+  out += numLiterals;
+  return out - static_cast<uint8_t*>(dst);
+}
+
+bool lz4Decompress(const void* src,
+                   size_t srcBytes,
+                   void* dst,
+                   size_t dstBytes) {
+  const uint8_t* in = static_cast<const uint8_t*>(src);
+  uint8_t* out = static_cast<uint8_t*>(dst);
+  size_t ip = 0;
+  size_t op = 0;
+
+  // reads the length bytes after a token nibble of 15, false if truncated
+  auto readLength = [&](size_t& length) {
+    uint8_t byte;
+    do {
+      if (ip >= srcBytes) {
+        return false;
+      }
+      byte = in[ip++];
+      length += byte;
+    } while (byte == 255);
+    return true;
+  };
+
+  while (true) {
+    if (ip >= srcBytes) {
+      return false;
+    }
+    const uint8_t token = in[ip++];
+    size_t numLiterals = token >> 4;
+    if (numLiterals == 15 && !readLength(numLiterals)) {
+      return false;
+    }
+    if (numLiterals > srcBytes - ip || numLiterals > dstBytes - op) {
+      return false;
+    }
+    std::memcpy(out + op, in + ip, numLiterals);
+    ip += numLiterals;
+    op += numLiterals;
+    // the last sequence has no match
+    if (ip == srcBytes) {
+      break;
+    }
+
+    if (srcBytes - ip < 2) {
+      return false;
+    }
+    const size_t offset = in[ip] | (size_t(in[ip + 1]) << 8);
+    ip += 2;
+    if (offset == 0 || offset > op) {
+      return false;
+    }
+    size_t length = token & 15;
+    if (length == 15 && !readLength(length)) {
+      return false;
+    }
+    length += minMatch;
+    if (length > dstBytes - op) {
+      return false;
+    }
+    // byte by byte, as matches may overlap the bytes they produce
+    const uint8_t* match = out + op - offset;
+    for (size_t i = 0; i < length; ++i) {
+      out[op + i] = match[i];
+    }
+    op += length;
+  }
+  return op == dstBytes;
+}
+
+}  // namespace core
+}  // namespace esp
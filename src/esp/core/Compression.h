@@ -0,0 +1,42 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace esp {
+namespace core {
+
+// Fast lossless compression in the LZ4 block format, so that the output can
+// be decompressed by any LZ4 implementation (LZ4_decompress_safe, lz4.block
+// in Python). Compression is greedy with a single hash table probe per
+// position, a few hundred MB/s per core, for data that is compressed every
+// step such as observations shipped to other nodes
+
+//! Size of the largest output of lz4Compress() for srcBytes bytes, when the
+//! data does not compress at all
+inline size_t lz4CompressBound(size_t srcBytes) {
+  return srcBytes + srcBytes / 255 + 16;
+}
+
+//! Compress srcBytes bytes of src into dst, which has room for dstCapacity
+//! bytes. Returns the size of the compressed data, or 0 if it did not fit;
+//! dstCapacity of lz4CompressBound(srcBytes) always fits
+size_t lz4Compress(const void* src,
+                   size_t srcBytes,
+                   void* dst,
+                   size_t dstCapacity);
+
+//! Decompress srcBytes bytes of LZ4 block data into dst, which must be
+//! exactly the dstBytes of the original data. Returns false for malformed
+//! data or data of another size, without reading or writing out of bounds
+bool lz4Decompress(const void* src,
+                   size_t srcBytes,
+                   void* dst,
+                   size_t dstBytes);
+
+}  // namespace core
+}  // namespace esp
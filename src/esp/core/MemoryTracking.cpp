@@ -0,0 +1,86 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#include "MemoryTracking.h"
+
+#include <atomic>
+#include <cstdlib>
+
+namespace esp {
+namespace core {
+
+namespace {
+// the size of an allocation of trackedMalloc(), in front of it
+constexpr size_t headerBytes = alignof(std::max_align_t);
+
+// constant initialized, so that allocations during static initialization,
+// e.g. of Bullet, are counted too
+struct TagCounters {
+  std::atomic<uint64_t> liveBytes{0};
+  std::atomic<uint64_t> liveAllocations{0};
+  std::atomic<uint64_t> allocations{0};
+};
+TagCounters counters[numMemoryTags];
+}  // namespace
+
+const char* memoryTagName(MemoryTag tag) {
+  switch (tag) {
+    case MemoryTag::Buffers:
+      return "buffers";
+    case MemoryTag::Assets:
+      return "assets";
+    case MemoryTag::Physics:
+      return "physics";
+    case MemoryTag::Navigation:
+      return "navigation";
+  }
+  return "unknown";
+}
+
+#ifdef ESP_BUILD_WITH_MEMORY_TRACKING
+void trackAllocation(MemoryTag tag, size_t bytes) {
+  TagCounters& tagCounters = counters[static_cast<int>(tag)];
+  tagCounters.liveBytes.fetch_add(bytes, std::memory_order_relaxed);
+  tagCounters.liveAllocations.fetch_add(1, std::memory_order_relaxed);
+  tagCounters.allocations.fetch_add(1, std::memory_order_relaxed);
+}
+
+void trackFree(MemoryTag tag, size_t bytes) {
+  TagCounters& tagCounters = counters[static_cast<int>(tag)];
+  tagCounters.liveBytes.fetch_sub(bytes, std::memory_order_relaxed);
+  tagCounters.liveAllocations.fetch_sub(1, std::memory_order_relaxed);
+}
+#endif
+
+MemoryTagStats getMemoryTagStats(MemoryTag tag) {
+  const TagCounters& tagCounters = counters[static_cast<int>(tag)];
+  MemoryTagStats stats;
+  stats.liveBytes = tagCounters.liveBytes.load(std::memory_order_relaxed);
+  stats.liveAllocations =
+      tagCounters.liveAllocations.load(std::memory_order_relaxed);
+  stats.allocations = tagCounters.allocations.load(std::memory_order_relaxed);
+  return stats;
+}
+
+void* trackedMalloc(MemoryTag tag, size_t bytes) {
+  char* block = static_cast<char*>(std::malloc(headerBytes + bytes));
+  if (block == nullptr) {
+    return nullptr;
+  }
+  *reinterpret_cast<size_t*>(block) = bytes;
+  trackAllocation(tag, bytes);
+  return block + headerBytes;
+}
+
+void trackedFree(MemoryTag tag, void* data) {
+  if (data == nullptr) {
+    return;
+  }
+  char* block = static_cast<char*>(data) - headerBytes;
+  trackFree(tag, *reinterpret_cast<const size_t*>(block));
+  std::free(block);
+}
+
+}  // namespace core
+}  // namespace esp
@@ -0,0 +1,108 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+#include "esp/core/configure.h"
+
+namespace esp {
+namespace core {
+
+//! What tracked memory is for
+enum class MemoryTag {
+  //! data of core::Buffer, e.g. observations
+  Buffers,
+  //! CPU data of the assets of the ResourceManager, e.g. collision meshes
+  Assets,
+  //! Bullet worlds, shapes and bodies
+  Physics,
+  //! navmeshes, their queries and their building (Detour and Recast)
+  Navigation,
+};
+constexpr int numMemoryTags = 4;
+
+//! e.g. "navigation", the label of the tag in the metrics
+const char* memoryTagName(MemoryTag tag);
+
+struct MemoryTagStats {
+  uint64_t liveBytes = 0;
+  uint64_t liveAllocations = 0;
+  //! allocations ever made
+  uint64_t allocations = 0;
+};
+
+// Live bytes and allocation counts of the memory of each subsystem, to tell
+// which one grows, e.g. across reconfigures. The subsystems count their
+// allocations with trackAllocation() and trackFree(), or allocate with
+// trackedMalloc() or a TrackedAllocator; Bullet, Detour and Recast are routed
+// through trackedMalloc(). The stats are part of MetricsRegistry::collect().
+// Only with BUILD_WITH_MEMORY_TRACKING: otherwise none of it is compiled in,
+// the third party libraries keep their allocators and the stats stay 0.
+constexpr bool isMemoryTrackingCompiledIn() {
+#ifdef ESP_BUILD_WITH_MEMORY_TRACKING
+  return true;
+#else
+  return false;
+#endif
+}
+
+#ifdef ESP_BUILD_WITH_MEMORY_TRACKING
+void trackAllocation(MemoryTag tag, size_t bytes);
+void trackFree(MemoryTag tag, size_t bytes);
+#else
+inline void trackAllocation(MemoryTag, size_t) {}
+inline void trackFree(MemoryTag, size_t) {}
+#endif
+
+MemoryTagStats getMemoryTagStats(MemoryTag tag);
+
+//! malloc() keeping the size in front of the allocation, for allocators
+//! whose free gets no size, e.g. dtFree(). Aligned like malloc()
+void* trackedMalloc(MemoryTag tag, size_t bytes);
+//! Free data of trackedMalloc(), which may be nullptr
+void trackedFree(MemoryTag tag, void* data);
+
+//! Allocator of standard containers counting their memory into Tag
+template <typename T, MemoryTag Tag>
+class TrackedAllocator {
+ public:
+  typedef T value_type;
+  template <typename U>
+  struct rebind {
+    typedef TrackedAllocator<U, Tag> other;
+  };
+
+  TrackedAllocator() = default;
+  template <typename U>
+  TrackedAllocator(const TrackedAllocator<U, Tag>&) {}
+
+  T* allocate(size_t n) {
+    trackAllocation(Tag, n * sizeof(T));
+    return static_cast<T*>(::operator new(n * sizeof(T)));
+  }
+
+  void deallocate(T* data, size_t n) {
+    trackFree(Tag, n * sizeof(T));
+    ::operator delete(data);
+  }
+};
+
+template <typename T, typename U, MemoryTag Tag>
+bool operator==(const TrackedAllocator<T, Tag>&,
+                const TrackedAllocator<U, Tag>&) {
+  return true;
+}
+
+template <typename T, typename U, MemoryTag Tag>
+bool operator!=(const TrackedAllocator<T, Tag>&,
+                const TrackedAllocator<U, Tag>&) {
+  return false;
+}
+
+}  // namespace core
+}  // namespace esp
@@ -0,0 +1,445 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#include "Metrics.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "esp/core/MemoryTracking.h"
+#include "esp/core/logging.h"
+
+namespace esp {
+namespace core {
+
+namespace {
+std::string formatValue(double value) {
+  char buffer[32];
+  std::snprintf(buffer, sizeof(buffer), "%.15g", value);
+  return buffer;
+}
+
+// label values are file paths and the like, escaped as the text format says
+std::string escapeLabelValue(const std::string& value) {
+  std::string escaped;
+  for (char c : value) {
+    if (c == '\\' || c == '"') {
+      escaped += '\\';
+      escaped += c;
+    } else if (c == '\n') {
+      escaped += "\\n";
+    } else {
+      escaped += c;
+    }
+  }
+  return escaped;
+}
+
+size_t residentBytes() {
+  std::ifstream statm{"/proc/self/statm"};
+  size_t pages = 0, residentPages = 0;
+  if (!(statm >> pages >> residentPages)) {
+    return 0;
+  }
+  return residentPages * sysconf(_SC_PAGESIZE);
+}
+
+size_t peakResidentBytes() {
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return 0;
+  }
+#ifdef __APPLE__
+  return usage.ru_maxrss;
+#else
+  // in kilobytes on Linux
+  return size_t(usage.ru_maxrss) * 1024;
+#endif
+}
+}  // namespace
+
+Histogram::Histogram(std::vector<double> bounds)
+    : bounds_(std::move(bounds)),
+      buckets_(new std::atomic<uint64_t>[bounds_.size() + 1]) {
+  for (size_t i = 0; i <= bounds_.size(); ++i) {
+    buckets_[i].store(0);
+  }
+}
+
+void Histogram::observe(double value) {
+  const size_t bucket =
+      std::lower_bound(bounds_.begin(), bounds_.end(), value) -
+      bounds_.begin();
+  buckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+  count_.fetch_add(1, std::memory_order_relaxed);
+  double sum = sum_.load(std::memory_order_relaxed);
+  while (!sum_.compare_exchange_weak(sum, sum + value,
+                                     std::memory_order_relaxed)) {
+  }
+}
+
+std::vector<uint64_t> Histogram::getBucketCounts() const {
+  std::vector<uint64_t> counts(bounds_.size() + 1);
+  for (size_t i = 0; i < counts.size(); ++i) {
+    counts[i] = buckets_[i].load(std::memory_order_relaxed);
+  }
+  return counts;
+}
+
+void Histogram::reset() {
+  for (size_t i = 0; i <= bounds_.size(); ++i) {
+    buckets_[i].store(0, std::memory_order_relaxed);
+  }
+  count_.store(0, std::memory_order_relaxed);
+  sum_.store(0.0, std::memory_order_relaxed);
+}
+
+std::vector<double> Histogram::latencyBounds() {
+  std::vector<double> bounds;
+  for (double bound = 1e-4; bound < 200.0; bound *= 2.0) {
+    bounds.push_back(bound);
+  }
+  return bounds;
+}
+
+MetricsRegistry& MetricsRegistry::get() {
+  static MetricsRegistry registry;
+  return registry;
+}
+
+MetricsRegistry::Metric& MetricsRegistry::metric(const std::string& name,
+                                                 const std::string& help,
+                                                 Type type) {
+  auto it = metrics_.find(name);
+  if (it == metrics_.end()) {
+    it = metrics_.emplace(name, Metric{type, help, {}, {}, {}}).first;
+  }
+  CHECK(it->second.type == type)
+      << "MetricsRegistry: " << name << " is registered as another type";
+  return it->second;
+}
+
+Counter& MetricsRegistry::counter(const std::string& name,
+                                  const std::string& help) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Metric& m = metric(name, help, Type::Counter);
+  if (m.counter == nullptr) {
+    m.counter = std::make_unique<Counter>();
+  }
+  return *m.counter;
+}
+
+Gauge& MetricsRegistry::gauge(const std::string& name,
+                              const std::string& help) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Metric& m = metric(name, help, Type::Gauge);
+  if (m.gauge == nullptr) {
+    m.gauge = std::make_unique<Gauge>();
+  }
+  return *m.gauge;
+}
+
+Histogram& MetricsRegistry::histogram(const std::string& name,
+                                      const std::string& help,
+                                      const std::vector<double>& bounds) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Metric& m = metric(name, help, Type::Histogram);
+  if (m.histogram == nullptr) {
+    m.histogram = std::make_unique<Histogram>(bounds);
+  }
+  return *m.histogram;
+}
+
+int MetricsRegistry::addCollector(
+    Collector collector,
+    const std::map<std::string, std::string>& help) {
+  std::lock_guard<std::mutex> lock(collectorsMutex_);
+  const int id = nextCollectorId_++;
+  collectors_[id] = CollectorEntry{std::move(collector), help};
+  return id;
+}
+
+void MetricsRegistry::removeCollector(int id) {
+  // waits for a collect() calling it to finish, so that its owner can go
+  std::lock_guard<std::mutex> lock(collectorsMutex_);
+  collectors_.erase(id);
+}
+
+std::vector<MetricSample> MetricsRegistry::collect() const {
+  std::vector<MetricSample> samples;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& it : metrics_) {
+      const std::string& name = it.first;
+      const Metric& m = it.second;
+      switch (m.type) {
+        case Type::Counter:
+          samples.push_back({name, {}, double(m.counter->value())});
+          break;
+        case Type::Gauge:
+          samples.push_back({name, {}, m.gauge->value()});
+          break;
+        case Type::Histogram: {
+          const std::vector<double>& bounds = m.histogram->getBounds();
+          const std::vector<uint64_t> counts =
+              m.histogram->getBucketCounts();
+          uint64_t cumulative = 0;
+          for (size_t i = 0; i < counts.size(); ++i) {
+            cumulative += counts[i];
+            const std::string bound =
+                i < bounds.size() ? formatValue(bounds[i]) : "+Inf";
+            samples.push_back(
+                {name + "_bucket", {{"le", bound}}, double(cumulative)});
+          }
+          samples.push_back({name + "_sum", {}, m.histogram->getSum()});
+          samples.push_back({name + "_count", {}, double(cumulative)});
+          break;
+        }
+      }
+    }
+  }
+  {
+    std::lock_guard<std::mutex> lock(collectorsMutex_);
+    for (const auto& it : collectors_) {
+      it.second.collect(samples);
+    }
+  }
+  samples.push_back(
+      {"process_resident_memory_bytes", {}, double(residentBytes())});
+  samples.push_back(
+      {"process_peak_resident_memory_bytes", {}, double(peakResidentBytes())});
+  if (isMemoryTrackingCompiledIn()) {
+    // the samples of each metric together, one per tag
+    std::vector<MemoryTagStats> stats;
+    for (int tag = 0; tag < numMemoryTags; ++tag) {
+      stats.push_back(getMemoryTagStats(MemoryTag(tag)));
+    }
+    for (int tag = 0; tag < numMemoryTags; ++tag) {
+      samples.push_back({"habitat_memory_live_bytes",
+                         {{"tag", memoryTagName(MemoryTag(tag))}},
+                         double(stats[tag].liveBytes)});
+    }
+    for (int tag = 0; tag < numMemoryTags; ++tag) {
+      samples.push_back({"habitat_memory_live_allocations",
+                         {{"tag", memoryTagName(MemoryTag(tag))}},
+                         double(stats[tag].liveAllocations)});
+    }
+    for (int tag = 0; tag < numMemoryTags; ++tag) {
+      samples.push_back({"habitat_memory_allocations_total",
+                         {{"tag", memoryTagName(MemoryTag(tag))}},
+                         double(stats[tag].allocations)});
+    }
+  }
+  return samples;
+}
+
+std::string MetricsRegistry::getPrometheusText() const {
+  const std::vector<MetricSample> samples = collect();
+
+  // the HELP and TYPE of each metric, by the name of its samples
+  std::map<std::string, std::pair<std::string, std::string>> headers;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& it : metrics_) {
+      const char* type = it.second.type == Type::Counter ? "counter"
+                         : it.second.type == Type::Gauge ? "gauge"
+                                                         : "histogram";
+      headers[it.first] = {it.second.help, type};
+    }
+  }
+  {
+    std::lock_guard<std::mutex> lock(collectorsMutex_);
+    for (const auto& collector : collectors_) {
+      for (const auto& help : collector.second.help) {
+        headers.emplace(help.first, std::make_pair(help.second, "gauge"));
+      }
+    }
+  }
+  headers["process_resident_memory_bytes"] = {"Resident memory size in bytes",
+                                              "gauge"};
+  headers["process_peak_resident_memory_bytes"] = {
+      "Peak resident memory size in bytes", "gauge"};
+  headers["habitat_memory_live_bytes"] = {
+      "Bytes allocated and not yet freed, by subsystem", "gauge"};
+  headers["habitat_memory_live_allocations"] = {
+      "Allocations not yet freed, by subsystem", "gauge"};
+  headers["habitat_memory_allocations_total"] = {
+      "Allocations made, by subsystem", "counter"};
+
+  // histogram samples belong to the family without their suffix
+  auto familyOf = [&headers](const std::string& name) {
+    for (const std::string suffix : {"_bucket", "_sum", "_count"}) {
+      if (name.size() <= suffix.size() ||
+          name.compare(name.size() - suffix.size(), suffix.size(), suffix) !=
+              0) {
+        continue;
+      }
+      const std::string base = name.substr(0, name.size() - suffix.size());
+      const auto header = headers.find(base);
+      if (header != headers.end() && header->second.second == "histogram") {
+        return base;
+      }
+    }
+    return name;
+  };
+  // the samples of a family have to be together, collectors may interleave
+  std::vector<std::pair<std::string, const MetricSample*>> ordered;
+  ordered.reserve(samples.size());
+  for (const MetricSample& sample : samples) {
+    ordered.emplace_back(familyOf(sample.name), &sample);
+  }
+  std::stable_sort(
+      ordered.begin(), ordered.end(),
+      [](const std::pair<std::string, const MetricSample*>& a,
+         const std::pair<std::string, const MetricSample*>& b) {
+        return a.first < b.first;
+      });
+
+  std::ostringstream out;
+  std::string family;
+  for (const auto& it : ordered) {
+    const MetricSample& sample = *it.second;
+    if (it.first != family) {
+      family = it.first;
+      const auto header = headers.find(family);
+      if (header != headers.end()) {
+        out << "# HELP " << family << " " << header->second.first << "\n"
+            << "# TYPE " << family << " " << header->second.second << "\n";
+      }
+    }
+    out << sample.name;
+    if (!sample.labels.empty()) {
+      out << "{";
+      bool first = true;
+      for (const auto& label : sample.labels) {
+        out << (first ? "" : ",") << label.first << "=\""
+            << escapeLabelValue(label.second) << "\"";
+        first = false;
+      }
+      out << "}";
+    }
+    out << " " << formatValue(sample.value) << "\n";
+  }
+  return out.str();
+}
+
+void MetricsRegistry::reset() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  // the metrics are referenced from the hot paths, zero them in place
+  for (auto& it : metrics_) {
+    Metric& m = it.second;
+    if (m.counter != nullptr) {
+      m.counter->reset();
+    }
+    if (m.gauge != nullptr) {
+      m.gauge->set(0.0);
+    }
+    if (m.histogram != nullptr) {
+      m.histogram->reset();
+    }
+  }
+}
+
+MetricsServer::MetricsServer(int port, MetricsRegistry& registry)
+    : registry_(registry) {
+  socket_ = ::socket(AF_INET, SOCK_STREAM, 0);
+  if (socket_ < 0) {
+    LOG(ERROR) << "MetricsServer: cannot create a socket";
+    return;
+  }
+  const int reuse = 1;
+  setsockopt(socket_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+  sockaddr_in address{};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_ANY);
+  address.sin_port = htons(port);
+  socklen_t length = sizeof(address);
+  if (bind(socket_, reinterpret_cast<sockaddr*>(&address), length) != 0 ||
+      listen(socket_, 8) != 0 ||
+      getsockname(socket_, reinterpret_cast<sockaddr*>(&address), &length) !=
+          0) {
+    LOG(ERROR) << "MetricsServer: cannot listen on port " << port;
+    close(socket_);
+    socket_ = -1;
+    return;
+  }
+  port_ = ntohs(address.sin_port);
+  thread_ = std::thread(&MetricsServer::serve, this);
+}
+
+MetricsServer::~MetricsServer() {
+  stop_ = true;
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+  if (socket_ >= 0) {
+    close(socket_);
+  }
+}
+
+void MetricsServer::serve() {
+  pollfd listening{socket_, POLLIN, 0};
+  while (!stop_) {
+    // wake up now and then to see whether we are stopped
+    if (poll(&listening, 1, 100) <= 0) {
+      continue;
+    }
+    const int client = accept(socket_, nullptr, nullptr);
+    if (client < 0) {
+      continue;
+    }
+    // a scraper that never sends its request does not hold us up for long
+    timeval timeout{1, 0};
+    setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    std::string request;
+    char buffer[1024];
+    while (request.find("\r\n\r\n") == std::string::npos &&
+           request.size() < 8192) {
+      const ssize_t received = recv(client, buffer, sizeof(buffer), 0);
+      if (received <= 0) {
+        break;
+      }
+      request.append(buffer, received);
+    }
+
+    std::string status = "200 OK";
+    std::string body;
+    if (request.compare(0, 13, "GET /metrics ") == 0 ||
+        request.compare(0, 13, "GET /metrics?") == 0) {
+      body = registry_.getPrometheusText();
+    } else {
+      status = "404 Not Found";
+      body = "metrics are at /metrics\n";
+    }
+    const std::string response =
+        "HTTP/1.1 " + status +
+        "\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: " +
+        std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body;
+#ifdef MSG_NOSIGNAL
+    const int flags = MSG_NOSIGNAL;
+#else
+    const int flags = 0;
+#endif
+    for (size_t sent = 0; sent < response.size();) {
+      const ssize_t n =
+          send(client, response.data() + sent, response.size() - sent, flags);
+      if (n <= 0) {
+        break;
+      }
+      sent += n;
+    }
+    close(client);
+  }
+}
+
+}  // namespace core
+}  // namespace esp
@@ -0,0 +1,210 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace esp {
+namespace core {
+
+//! A count that only goes up, e.g. of steps or scene loads
+class Counter {
+ public:
+  void add(uint64_t n = 1) { value_.fetch_add(n, std::memory_order_relaxed); }
+  uint64_t value() const { return value_.load(std::memory_order_relaxed); }
+  void reset() { value_.store(0, std::memory_order_relaxed); }
+
+ private:
+  std::atomic<uint64_t> value_{0};
+};
+
+//! A value that is set, e.g. a number of objects
+class Gauge {
+ public:
+  void set(double value) { value_.store(value, std::memory_order_relaxed); }
+  double value() const { return value_.load(std::memory_order_relaxed); }
+
+ private:
+  std::atomic<double> value_{0.0};
+};
+
+//! Counts of the observed values below each of a fixed set of bounds, with
+//! their count and sum, e.g. of latencies in seconds. Observing takes no lock
+class Histogram {
+ public:
+  //! bounds sorted ascending; values above the last land in an overflow
+  //! bucket
+  explicit Histogram(std::vector<double> bounds);
+
+  void observe(double value);
+
+  const std::vector<double>& getBounds() const { return bounds_; }
+  //! Observations in each bucket, the overflow last; not cumulative
+  std::vector<uint64_t> getBucketCounts() const;
+  uint64_t getCount() const { return count_.load(std::memory_order_relaxed); }
+  double getSum() const { return sum_.load(std::memory_order_relaxed); }
+  void reset();
+
+  //! 100us to ~100s, each bucket twice the previous
+  static std::vector<double> latencyBounds();
+
+ private:
+  const std::vector<double> bounds_;
+  std::unique_ptr<std::atomic<uint64_t>[]> buckets_;
+  std::atomic<uint64_t> count_{0};
+  std::atomic<double> sum_{0.0};
+};
+
+//! One value of a metric, with its labels, e.g. {"asset", "/path/x.glb"}
+struct MetricSample {
+  std::string name;
+  std::map<std::string, std::string> labels;
+  double value = 0.0;
+};
+
+// Process-wide registry of the counters, gauges and histograms of the
+// simulator, for monitoring long-running services: how many steps and how
+// fast, render and readback latency, scene loads and cache hits, memory.
+// Collecting is off until setEnabled(true), and then costs the instrumented
+// paths an atomic add or two. Read by pulling collect() or
+// getPrometheusText(), or by scraping a MetricsServer.
+class MetricsRegistry {
+ public:
+  //! Computes gauges when the metrics are collected, e.g. memory use
+  typedef std::function<void(std::vector<MetricSample>&)> Collector;
+
+  static MetricsRegistry& get();
+
+  void setEnabled(bool enabled) { enabled_.store(enabled); }
+  bool isEnabled() const {
+    return enabled_.load(std::memory_order_relaxed);
+  }
+
+  //! The metric of name, created on first use. References stay valid for
+  //! the life of the process, so that hot paths can keep them
+  Counter& counter(const std::string& name, const std::string& help);
+  Gauge& gauge(const std::string& name, const std::string& help);
+  Histogram& histogram(
+      const std::string& name,
+      const std::string& help,
+      const std::vector<double>& bounds = Histogram::latencyBounds());
+
+  //! Add collector, called by every collect(); help describes the metric of
+  //! each sample name it produces. Returns an id for removeCollector()
+  int addCollector(Collector collector,
+                   const std::map<std::string, std::string>& help);
+  void removeCollector(int id);
+
+  //! All the metrics, with those of the collectors and of the process:
+  //! process_resident_memory_bytes and process_peak_resident_memory_bytes,
+  //! and with BUILD_WITH_MEMORY_TRACKING habitat_memory_live_bytes,
+  //! habitat_memory_live_allocations and habitat_memory_allocations_total
+  //! labeled with their "tag", see MemoryTracking.h.
+  //! Histograms appear as name_bucket samples labeled with their upper
+  //! bound "le", cumulative, and name_sum and name_count
+  std::vector<MetricSample> collect() const;
+
+  //! collect() in the Prometheus text exposition format
+  std::string getPrometheusText() const;
+
+  //! Zero all the counters, gauges and histograms, e.g. between tests
+  void reset();
+
+ private:
+  enum class Type { Counter, Gauge, Histogram };
+
+  struct Metric {
+    Type type;
+    std::string help;
+    std::unique_ptr<Counter> counter;
+    std::unique_ptr<Gauge> gauge;
+    std::unique_ptr<Histogram> histogram;
+  };
+
+  struct CollectorEntry {
+    Collector collect;
+    std::map<std::string, std::string> help;
+  };
+
+  MetricsRegistry() = default;
+
+  Metric& metric(const std::string& name, const std::string& help, Type type);
+
+  std::atomic<bool> enabled_{false};
+
+  mutable std::mutex mutex_;
+  std::map<std::string, Metric> metrics_;
+  // a lock of its own, so that collectors may take the locks of their
+  // owners, which register metrics while holding them
+  mutable std::mutex collectorsMutex_;
+  std::map<int, CollectorEntry> collectors_;
+  int nextCollectorId_ = 0;
+};
+
+//! Observes the seconds until it is destroyed into histogram, if the
+//! registry is enabled when it is created
+class HistogramTimer {
+ public:
+  explicit HistogramTimer(Histogram& histogram)
+      : histogram_(MetricsRegistry::get().isEnabled() ? &histogram : nullptr) {
+    if (histogram_ != nullptr) {
+      start_ = std::chrono::steady_clock::now();
+    }
+  }
+
+  ~HistogramTimer() {
+    if (histogram_ != nullptr) {
+      histogram_->observe(std::chrono::duration<double>(
+                              std::chrono::steady_clock::now() - start_)
+                              .count());
+    }
+  }
+
+  HistogramTimer(const HistogramTimer&) = delete;
+  HistogramTimer& operator=(const HistogramTimer&) = delete;
+
+ private:
+  Histogram* histogram_;
+  std::chrono::steady_clock::time_point start_;
+};
+
+//! Serves the Prometheus text of a registry over HTTP at /metrics on a
+//! thread of its own, until destroyed
+class MetricsServer {
+ public:
+  //! Listen on port of all interfaces, 0 picks a free one; isRunning() is
+  //! false if the port cannot be bound
+  explicit MetricsServer(int port,
+                         MetricsRegistry& registry = MetricsRegistry::get());
+  ~MetricsServer();
+
+  MetricsServer(const MetricsServer&) = delete;
+  MetricsServer& operator=(const MetricsServer&) = delete;
+
+  bool isRunning() const { return socket_ >= 0; }
+  //! the port listened on
+  int getPort() const { return port_; }
+
+ private:
+  void serve();
+
+  MetricsRegistry& registry_;
+  int socket_ = -1;
+  int port_ = 0;
+  std::atomic<bool> stop_{false};
+  std::thread thread_;
+};
+
+}  // namespace core
+}  // namespace esp
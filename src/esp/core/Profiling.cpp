@@ -0,0 +1,173 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#include "Profiling.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+
+#include "esp/core/logging.h"
+
+namespace esp {
+namespace core {
+
+namespace {
+int64_t steadyClockNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// names are string literals in the code, only quotes and backslashes need
+// escaping
+std::string jsonString(const char* s) {
+  std::string escaped = "\"";
+  for (; *s != '\0'; ++s) {
+    if (*s == '"' || *s == '\\') {
+      escaped += '\\';
+    }
+    escaped += *s;
+  }
+  return escaped + "\"";
+}
+}  // namespace
+
+constexpr int Profiler::GpuThreadId;
+
+Profiler& Profiler::get() {
+  static Profiler profiler;
+  return profiler;
+}
+
+Profiler::Profiler() : epochNs_(steadyClockNs()) {}
+
+int64_t Profiler::now() const {
+  return steadyClockNs() - epochNs_;
+}
+
+void Profiler::setBufferCapacity(size_t capacity) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  capacity_ = std::max(capacity, size_t(1));
+  buffers_.clear();
+  ++generation_;
+}
+
+void Profiler::clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  buffers_.clear();
+  ++generation_;
+}
+
+Profiler::ThreadBuffer& Profiler::threadBuffer(int& threadId) {
+  struct Local {
+    std::shared_ptr<ThreadBuffer> buffer;
+    int threadId = 0;
+    int generation = -1;
+  };
+  thread_local Local local;
+  if (local.generation != generation_.load()) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    local.buffer = std::make_shared<ThreadBuffer>(capacity_);
+    buffers_.push_back(local.buffer);
+    local.threadId = buffers_.size();
+    local.generation = generation_.load();
+  }
+  threadId = local.threadId;
+  return *local.buffer;
+}
+
+void Profiler::record(const char* name, int64_t startNs, int64_t durationNs) {
+  record(name, startNs, durationNs, -1);
+}
+
+void Profiler::record(const char* name,
+                      int64_t startNs,
+                      int64_t durationNs,
+                      int threadId) {
+  int ownThreadId;
+  ThreadBuffer& buffer = threadBuffer(ownThreadId);
+  std::lock_guard<std::mutex> lock(buffer.mutex);
+  ProfileEvent& event = buffer.events[buffer.next % buffer.events.size()];
+  event.name = name;
+  event.startNs = startNs;
+  event.durationNs = durationNs;
+  event.threadId = threadId < 0 ? ownThreadId : threadId;
+  ++buffer.next;
+}
+
+std::vector<ProfileEvent> Profiler::getEvents() const {
+  std::vector<ProfileEvent> events;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const std::shared_ptr<ThreadBuffer>& buffer : buffers_) {
+      std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+      const size_t size = std::min(buffer->next, buffer->events.size());
+      events.insert(events.end(), buffer->events.begin(),
+                    buffer->events.begin() + size);
+    }
+  }
+  std::sort(events.begin(), events.end(),
+            [](const ProfileEvent& a, const ProfileEvent& b) {
+              return a.startNs < b.startNs;
+            });
+  return events;
+}
+
+std::map<std::string, ProfileSummary> Profiler::getSummary() const {
+  std::map<std::string, ProfileSummary> summary;
+  for (const ProfileEvent& event : getEvents()) {
+    ProfileSummary& entry = summary[event.name];
+    ++entry.count;
+    entry.totalMs += event.durationNs * 1e-6;
+  }
+  return summary;
+}
+
+std::string Profiler::getChromeTrace() const {
+  const std::vector<ProfileEvent> events = getEvents();
+  std::ostringstream os;
+  os << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  // complete events with timestamps in microseconds
+  std::vector<bool> threads;
+  for (size_t i = 0; i < events.size(); ++i) {
+    const ProfileEvent& event = events[i];
+    os << (i > 0 ? "," : "") << "{\"name\":" << jsonString(event.name)
+       << ",\"ph\":\"X\",\"pid\":0,\"tid\":" << event.threadId
+       << ",\"ts\":" << event.startNs / 1000.0
+       << ",\"dur\":" << event.durationNs / 1000.0 << "}";
+    if (static_cast<size_t>(event.threadId) >= threads.size()) {
+      threads.resize(event.threadId + 1, false);
+    }
+    threads[event.threadId] = true;
+  }
+  // name the tracks
+  for (size_t threadId = 0; threadId < threads.size(); ++threadId) {
+    if (!threads[threadId]) {
+      continue;
+    }
+    os << (events.empty() ? "" : ",")
+       << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":"
+       << threadId << ",\"args\":{\"name\":\""
+       << (static_cast<int>(threadId) == GpuThreadId
+               ? std::string{"GPU"}
+               : "thread " + std::to_string(threadId))
+       << "\"}}";
+  }
+  os << "]}";
+  return os.str();
+}
+
+bool Profiler::saveChromeTrace(const std::string& file) const {
+  std::ofstream out{file};
+  if (!(out << getChromeTrace())) {
+    LOG(ERROR) << "Cannot write the profile to " << file;
+    return false;
+  }
+  return true;
+}
+
+}  // namespace core
+}  // namespace esp
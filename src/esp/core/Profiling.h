@@ -0,0 +1,157 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "esp/core/configure.h"
+
+namespace esp {
+namespace core {
+
+//! A timed scope, in nanoseconds since the profiler was created
+struct ProfileEvent {
+  //! name of the scope, a string literal
+  const char* name = nullptr;
+  int64_t startNs = 0;
+  int64_t durationNs = 0;
+  //! small id of the recording thread, GpuThreadId for GPU time
+  int threadId = 0;
+};
+
+//! Count and total time of the events of one name
+struct ProfileSummary {
+  int count = 0;
+  double totalMs = 0.0;
+};
+
+// Collects the events of the scopes timed with ESP_PROFILE_SCOPE(). Every
+// thread records into its own ring buffer of getBufferCapacity() events,
+// overwriting the oldest, so recording never allocates and threads only
+// contend with an export. Recording is off until setEnabled(true); with
+// BUILD_WITH_PROFILING off the scopes are not compiled in at all and the
+// profiler stays empty.
+class Profiler {
+ public:
+  //! threadId of events timed on the GPU
+  static constexpr int GpuThreadId = 0;
+
+  static Profiler& get();
+
+  //! whether ESP_PROFILE_SCOPE() is compiled in
+  static constexpr bool isCompiledIn() {
+#ifdef ESP_BUILD_WITH_PROFILING
+    return true;
+#else
+    return false;
+#endif
+  }
+
+  void setEnabled(bool enabled) { enabled_.store(enabled); }
+  bool isEnabled() const {
+    return enabled_.load(std::memory_order_relaxed);
+  }
+
+  //! Events kept per thread; applies to the buffers of threads that record
+  //! from now on and clears the others
+  void setBufferCapacity(size_t capacity);
+  size_t getBufferCapacity() const { return capacity_; }
+
+  //! Nanoseconds since the profiler was created, on a monotonic clock
+  int64_t now() const;
+
+  //! Record an event on the calling thread
+  void record(const char* name, int64_t startNs, int64_t durationNs);
+
+  //! Record an event timed elsewhere, e.g. on the GPU
+  void record(const char* name,
+              int64_t startNs,
+              int64_t durationNs,
+              int threadId);
+
+  //! Events of all threads still in their buffers, sorted by start
+  std::vector<ProfileEvent> getEvents() const;
+
+  //! getEvents() summarized by name
+  std::map<std::string, ProfileSummary> getSummary() const;
+
+  void clear();
+
+  //! The events in the Chrome trace event format, for chrome://tracing or
+  //! Perfetto
+  std::string getChromeTrace() const;
+
+  bool saveChromeTrace(const std::string& file) const;
+
+ private:
+  struct ThreadBuffer {
+    explicit ThreadBuffer(size_t capacity) : events(capacity) {}
+
+    // only contended by exports
+    mutable std::mutex mutex;
+    std::vector<ProfileEvent> events;
+    // total number recorded, the next is written at next % events.size()
+    size_t next = 0;
+  };
+
+  Profiler();
+
+  ThreadBuffer& threadBuffer(int& threadId);
+
+  const int64_t epochNs_;
+  std::atomic<bool> enabled_{false};
+  size_t capacity_ = 1 << 16;
+
+  mutable std::mutex mutex_;
+  // per thread, threadId - 1 is the index
+  std::vector<std::shared_ptr<ThreadBuffer>> buffers_;
+  // bumped by setBufferCapacity() and clear() so threads drop their buffers
+  std::atomic<int> generation_{0};
+};
+
+// Times the scope it lives in, if the profiler is enabled when it is created
+class ScopedTimer {
+ public:
+  explicit ScopedTimer(const char* name)
+      : name_(Profiler::get().isEnabled() ? name : nullptr),
+        startNs_(name_ != nullptr ? Profiler::get().now() : 0) {}
+
+  ~ScopedTimer() {
+    if (name_ != nullptr) {
+      Profiler& profiler = Profiler::get();
+      profiler.record(name_, startNs_, profiler.now() - startNs_);
+    }
+  }
+
+  ScopedTimer(const ScopedTimer&) = delete;
+  ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+ private:
+  const char* name_;
+  int64_t startNs_;
+};
+
+}  // namespace core
+}  // namespace esp
+
+#define ESP_PROFILE_CONCAT_IMPL(a, b) a##b
+#define ESP_PROFILE_CONCAT(a, b) ESP_PROFILE_CONCAT_IMPL(a, b)
+
+// Time the rest of the enclosing scope as name, a string literal
+#ifdef ESP_BUILD_WITH_PROFILING
+#define ESP_PROFILE_SCOPE(name)                 \
+  ::esp::core::ScopedTimer ESP_PROFILE_CONCAT( \
+      espProfileScope, __LINE__)(name)
+#else
+#define ESP_PROFILE_SCOPE(name) \
+  do {                          \
+  } while (false)
+#endif
@@ -0,0 +1,250 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#include "SharedMemory.h"
+
+#include <algorithm>
+#include <chrono>
+#include <new>
+#include <thread>
+
+#if !defined(_WIN32) && !defined(__EMSCRIPTEN__)
+#define ESP_SHARED_MEMORY_SUPPORTED
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#endif
+
+namespace esp {
+namespace core {
+
+namespace {
+const size_t cacheLineSize = 64;
+
+size_t alignToCacheLine(size_t bytes) {
+  return (bytes + cacheLineSize - 1) / cacheLineSize * cacheLineSize;
+}
+
+// slots come in powers of two, so that counters wrapping around keep
+// indexing them in order
+uint32_t slotCount(uint32_t numSlots) {
+  uint32_t count = 1;
+  while (count < numSlots) {
+    count <<= 1;
+  }
+  return count;
+}
+
+typedef std::chrono::steady_clock Clock;
+
+// spins before sleeping, about a microsecond: a step of a simulator takes
+// longer, so the sleeping side is woken by the other one rather than spinning
+const int numSpins = 256;
+}  // namespace
+
+SharedMemory::SharedMemory(const std::string& name, size_t size /* = 0 */)
+    : name_(name), owner_(size > 0) {
+#ifdef ESP_SHARED_MEMORY_SUPPORTED
+  int fd = -1;
+  if (owner_) {
+    shm_unlink(name.c_str());
+    fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd >= 0 && ftruncate(fd, size) != 0) {
+      close(fd);
+      shm_unlink(name.c_str());
+      fd = -1;
+    }
+  } else {
+    fd = shm_open(name.c_str(), O_RDWR, 0);
+    struct stat fileStat;
+    if (fd >= 0 && fstat(fd, &fileStat) == 0) {
+      size = fileStat.st_size;
+    }
+  }
+  if (fd < 0 || size == 0) {
+    if (fd >= 0) {
+      close(fd);
+    }
+    if (owner_) {
+      LOG(ERROR) << "Cannot create shared memory " << name;
+    }
+    owner_ = false;
+    return;
+  }
+  void* mapping =
+      mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  // the mapping stays valid after closing the descriptor
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    LOG(ERROR) << "Cannot map shared memory " << name;
+    if (owner_) {
+      shm_unlink(name.c_str());
+      owner_ = false;
+    }
+    return;
+  }
+  data_ = static_cast<char*>(mapping);
+  size_ = size;
+#else
+  LOG(ERROR) << "Shared memory is not supported on this platform";
+  owner_ = false;
+#endif
+}
+
+SharedMemory::~SharedMemory() {
+#ifdef ESP_SHARED_MEMORY_SUPPORTED
+  if (data_ != nullptr) {
+    munmap(data_, size_);
+  }
+  if (owner_) {
+    shm_unlink(name_.c_str());
+  }
+#endif
+}
+
+void waitOnAddress(std::atomic<uint32_t>& word,
+                   uint32_t expected,
+                   int64_t timeoutMicros /* = -1 */) {
+  static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t) &&
+                    ATOMIC_INT_LOCK_FREE == 2,
+                "futexes need plain lock-free 32 bit words");
+#ifdef __linux__
+  struct timespec timeout;
+  timeout.tv_sec = timeoutMicros / 1000000;
+  timeout.tv_nsec = (timeoutMicros % 1000000) * 1000;
+  // not FUTEX_PRIVATE_FLAG, so that it works across processes
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT, expected,
+          timeoutMicros < 0 ? nullptr : &timeout, nullptr, 0);
+#else
+  if (word.load() == expected) {
+    const int64_t sleepMicros = 50;
+    std::this_thread::sleep_for(std::chrono::microseconds(
+        timeoutMicros < 0 ? sleepMicros
+                          : std::min(timeoutMicros, sleepMicros)));
+  }
+#endif
+}
+
+void wakeOnAddress(std::atomic<uint32_t>& word) {
+#ifdef __linux__
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE,
+          INT32_MAX, nullptr, nullptr, 0);
+#else
+  // waiters poll
+  (void)word;
+#endif
+}
+
+size_t SharedRing::memorySize(uint32_t numSlots, uint32_t slotBytes) {
+  return alignToCacheLine(sizeof(Header)) +
+         slotCount(numSlots) * alignToCacheLine(slotBytes);
+}
+
+SharedRing SharedRing::create(void* memory,
+                              uint32_t numSlots,
+                              uint32_t slotBytes) {
+  Header* header = new (memory) Header();
+  header->numSlots = slotCount(numSlots);
+  header->slotBytes = slotBytes;
+  header->head = 0;
+  header->consumerWaiting = 0;
+  header->tail = 0;
+  header->producerWaiting = 0;
+  return SharedRing(memory);
+}
+
+SharedRing::SharedRing(void* memory /* = nullptr */)
+    : header_(static_cast<Header*>(memory)) {}
+
+uint32_t SharedRing::size() const {
+  return header_->head.load(std::memory_order_acquire) -
+         header_->tail.load(std::memory_order_acquire);
+}
+
+char* SharedRing::slot(uint32_t index) const {
+  return reinterpret_cast<char*>(header_) + alignToCacheLine(sizeof(Header)) +
+         (index % header_->numSlots) * alignToCacheLine(header_->slotBytes);
+}
+
+bool SharedRing::waitWhile(std::atomic<uint32_t>& counter,
+                           uint32_t value,
+                           std::atomic<uint32_t>& waiting,
+                           int64_t timeoutMicros) {
+  for (int i = 0; i < numSpins; ++i) {
+    if (counter.load(std::memory_order_acquire) != value) {
+      return true;
+    }
+  }
+  const Clock::time_point deadline =
+      Clock::now() +
+      std::chrono::microseconds(std::max<int64_t>(0, timeoutMicros));
+  while (true) {
+    int64_t remaining = -1;
+    if (timeoutMicros >= 0) {
+      remaining = std::chrono::duration_cast<std::chrono::microseconds>(
+                      deadline - Clock::now())
+                      .count();
+      if (remaining <= 0) {
+        return counter.load(std::memory_order_acquire) != value;
+      }
+    }
+    // either the other side sees waiting set and wakes this one, or this
+    // one sees the counter it changed before, both are sequentially
+    // consistent
+    waiting.store(1);
+    if (counter.load() == value) {
+      waitOnAddress(counter, value, remaining);
+    }
+    waiting.store(0);
+    if (counter.load(std::memory_order_acquire) != value) {
+      return true;
+    }
+  }
+}
+
+void* SharedRing::beginWrite(int64_t timeoutMicros /* = -1 */) {
+  const uint32_t head = header_->head.load(std::memory_order_relaxed);
+  uint32_t tail = header_->tail.load(std::memory_order_acquire);
+  while (head - tail >= header_->numSlots) {
+    if (!waitWhile(header_->tail, tail, header_->producerWaiting,
+                   timeoutMicros)) {
+      return nullptr;
+    }
+    tail = header_->tail.load(std::memory_order_acquire);
+  }
+  return slot(head);
+}
+
+void SharedRing::endWrite() {
+  header_->head.store(header_->head.load(std::memory_order_relaxed) + 1);
+  if (header_->consumerWaiting.load() != 0) {
+    wakeOnAddress(header_->head);
+  }
+}
+
+const void* SharedRing::beginRead(int64_t timeoutMicros /* = -1 */) {
+  const uint32_t tail = header_->tail.load(std::memory_order_relaxed);
+  if (header_->head.load(std::memory_order_acquire) == tail &&
+      !waitWhile(header_->head, tail, header_->consumerWaiting,
+                 timeoutMicros)) {
+    return nullptr;
+  }
+  return slot(tail);
+}
+
+void SharedRing::endRead() {
+  header_->tail.store(header_->tail.load(std::memory_order_relaxed) + 1);
+  if (header_->producerWaiting.load() != 0) {
+    wakeOnAddress(header_->tail);
+  }
+}
+
+}  // namespace core
+}  // namespace esp
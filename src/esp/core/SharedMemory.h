@@ -0,0 +1,119 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "esp/core/esp.h"
+
+namespace esp {
+namespace core {
+
+//! POSIX shared memory segment mapped into this process. The process that
+//! creates a segment owns its name and removes it on destruction; others
+//! open it by name, the mapping staying valid until they unmap it
+class SharedMemory {
+ public:
+  //! Create segment name, a "/" followed by a name without slashes, of size
+  //! bytes, replacing a stale one of the same name, or open the existing one
+  //! if size is 0
+  explicit SharedMemory(const std::string& name, size_t size = 0);
+  ~SharedMemory();
+
+  SharedMemory(const SharedMemory&) = delete;
+  SharedMemory& operator=(const SharedMemory&) = delete;
+
+  //! Whether the segment could be created or opened and mapped
+  bool isValid() const { return data_ != nullptr; }
+  char* data() const { return data_; }
+  size_t size() const { return size_; }
+  const std::string& name() const { return name_; }
+
+ private:
+  std::string name_;
+  char* data_ = nullptr;
+  size_t size_ = 0;
+  bool owner_ = false;
+
+  ESP_SMART_POINTERS(SharedMemory)
+};
+
+//! Block while word holds expected, for at most timeoutMicros microseconds
+//! if it is not negative. Works across processes for words in shared memory
+//! (futexes on Linux, polling elsewhere), and may return spuriously
+void waitOnAddress(std::atomic<uint32_t>& word,
+                   uint32_t expected,
+                   int64_t timeoutMicros = -1);
+
+//! Wake all threads blocked in waitOnAddress() on word
+void wakeOnAddress(std::atomic<uint32_t>& word);
+
+//! Lock-free ring of numSlots messages of slotBytes each between one
+//! producer and one consumer, which may be different processes when its
+//! memory is shared. Both sides spin briefly and then sleep on a futex
+//! while the ring is full or empty, and each side only makes a system call
+//! to wake the other one if it is asleep
+class SharedRing {
+ public:
+  //! Bytes of memory a ring of numSlots messages of slotBytes needs
+  static size_t memorySize(uint32_t numSlots, uint32_t slotBytes);
+
+  //! Lay out an empty ring in memory, which must be aligned to 64 bytes and
+  //! hold memorySize(numSlots, slotBytes). numSlots is rounded up to a power
+  //! of two
+  static SharedRing create(void* memory,
+                           uint32_t numSlots,
+                           uint32_t slotBytes);
+
+  //! Ring laid out by create() in memory, e.g. by another process
+  explicit SharedRing(void* memory = nullptr);
+
+  bool isValid() const { return header_ != nullptr; }
+  uint32_t getNumSlots() const { return header_->numSlots; }
+  uint32_t getSlotBytes() const { return header_->slotBytes; }
+
+  //! Messages written and not read yet
+  uint32_t size() const;
+
+  //! Producer: slot to write the next message into, waiting for at most
+  //! timeoutMicros (indefinitely if negative) while the ring is full; nullptr
+  //! on timeout. The message is sent by endWrite()
+  void* beginWrite(int64_t timeoutMicros = -1);
+  void endWrite();
+
+  //! Consumer: the next message, waiting for at most timeoutMicros
+  //! (indefinitely if negative) while the ring is empty; nullptr on timeout.
+  //! The slot is given back by endRead()
+  const void* beginRead(int64_t timeoutMicros = -1);
+  void endRead();
+
+ protected:
+  struct Header {
+    uint32_t numSlots;
+    uint32_t slotBytes;
+    // messages written and read so far, wrapping around; they are also the
+    // futex words the two sides sleep on
+    alignas(64) std::atomic<uint32_t> head;
+    std::atomic<uint32_t> consumerWaiting;
+    alignas(64) std::atomic<uint32_t> tail;
+    std::atomic<uint32_t> producerWaiting;
+  };
+
+  char* slot(uint32_t index) const;
+
+  // wait until counter is no longer value, announcing it in waiting
+  static bool waitWhile(std::atomic<uint32_t>& counter,
+                        uint32_t value,
+                        std::atomic<uint32_t>& waiting,
+                        int64_t timeoutMicros);
+
+  Header* header_;
+};
+
+}  // namespace core
+}  // namespace esp
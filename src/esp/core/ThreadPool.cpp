@@ -0,0 +1,281 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace esp {
+namespace core {
+
+namespace {
+// pool and queue of the worker running on this thread, if any
+thread_local ThreadPool* currentPool = nullptr;
+thread_local int currentQueue = -1;
+
+int resolveNumThreads(int numThreads) {
+  return numThreads > 0
+             ? numThreads
+             : static_cast<int>(
+                   std::max(1u, std::thread::hardware_concurrency()));
+}
+
+// size of the global pool, fixed by the first setGlobalNumThreads() or by
+// creating the pool, ID_UNDEFINED before either
+std::mutex globalMutex;
+int globalNumThreads = ID_UNDEFINED;
+}  // namespace
+
+ThreadPool::ThreadPool(int numThreads /* = 0 */) {
+  start(numThreads);
+}
+
+ThreadPool::~ThreadPool() {
+  stop();
+}
+
+ThreadPool& ThreadPool::global() {
+  static ThreadPool pool([]() {
+    std::lock_guard<std::mutex> lock(globalMutex);
+    if (globalNumThreads == ID_UNDEFINED) {
+      globalNumThreads = resolveNumThreads(0);
+    }
+    return globalNumThreads;
+  }());
+  return pool;
+}
+
+bool ThreadPool::setGlobalNumThreads(int numThreads) {
+  numThreads = resolveNumThreads(numThreads);
+  std::lock_guard<std::mutex> lock(globalMutex);
+  if (globalNumThreads == ID_UNDEFINED) {
+    globalNumThreads = numThreads;
+    return true;
+  }
+  if (numThreads != globalNumThreads) {
+    LOG(WARNING) << "ThreadPool: the pool of the process already runs "
+                 << globalNumThreads << " tasks at once, ignoring "
+                 << numThreads;
+    return false;
+  }
+  return true;
+}
+
+void ThreadPool::start(int numThreads) {
+  numThreads = resolveNumThreads(numThreads);
+#if defined(__EMSCRIPTEN_PTHREADS__)
+  // workers come from the web workers the page starts with, one per core
+  // (see BUILD_WEB_THREADS); more would only start once the caller yields
+  numThreads = std::min<int>(
+      numThreads, std::max(1u, std::thread::hardware_concurrency()));
+#elif defined(__EMSCRIPTEN__)
+  // single-threaded WebAssembly cannot start threads
+  numThreads = 1;
+#endif
+  const int numWorkers = numThreads - 1;
+  stopping_ = false;
+  queues_.clear();
+  for (int iQueue = 0; iQueue <= numWorkers; ++iQueue) {
+    queues_.emplace_back(new TaskQueue());
+  }
+  for (int iWorker = 0; iWorker < numWorkers; ++iWorker) {
+    workers_.emplace_back(&ThreadPool::workerLoop, this, iWorker);
+  }
+}
+
+void ThreadPool::stop() {
+  {
+    std::lock_guard<std::mutex> lock(sleepMutex_);
+    stopping_ = true;
+  }
+  wake_.notify_all();
+  for (std::thread& worker : workers_) {
+    worker.join();
+  }
+  workers_.clear();
+}
+
+void ThreadPool::setNumThreads(int numThreads) {
+  numThreads = resolveNumThreads(numThreads);
+  if (numThreads == getNumThreads()) {
+    return;
+  }
+  if (currentPool == this) {
+    LOG(ERROR) << "ThreadPool::setNumThreads: cannot resize from a task";
+    return;
+  }
+  stop();
+  start(numThreads);
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+  if (workers_.empty()) {
+    task();
+    return;
+  }
+  const int index = currentPool == this ? currentQueue : queues_.size() - 1;
+  {
+    std::lock_guard<std::mutex> lock(queues_[index]->mutex);
+    queues_[index]->tasks.emplace_back(std::move(task));
+  }
+  ++numQueued_;
+  {
+    // a worker about to sleep has checked numQueued_ under the lock
+    std::lock_guard<std::mutex> lock(sleepMutex_);
+  }
+  wake_.notify_one();
+}
+
+bool ThreadPool::popTask(int index, std::function<void()>& task) {
+  if (numQueued_ == 0) {
+    return false;
+  }
+  const int numQueues = queues_.size();
+  if (index >= 0) {
+    TaskQueue& own = *queues_[index];
+    std::lock_guard<std::mutex> lock(own.mutex);
+    if (!own.tasks.empty()) {
+      task = std::move(own.tasks.back());
+      own.tasks.pop_back();
+      --numQueued_;
+      return true;
+    }
+  }
+  // steal the oldest task, which tends to be the largest piece of work
+  const int first = index >= 0 ? index + 1 : 0;
+  for (int i = 0; i < numQueues; ++i) {
+    TaskQueue& other = *queues_[(first + i) % numQueues];
+    std::lock_guard<std::mutex> lock(other.mutex);
+    if (!other.tasks.empty()) {
+      task = std::move(other.tasks.front());
+      other.tasks.pop_front();
+      --numQueued_;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool ThreadPool::runPendingTask() {
+  std::function<void()> task;
+  if (!popTask(currentPool == this ? currentQueue : -1, task)) {
+    return false;
+  }
+  task();
+  return true;
+}
+
+void ThreadPool::workerLoop(int index) {
+  currentPool = this;
+  currentQueue = index;
+  std::function<void()> task;
+  while (true) {
+    if (popTask(index, task)) {
+      task();
+      task = nullptr;
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(sleepMutex_);
+    wake_.wait(lock, [&]() { return numQueued_ > 0 || stopping_; });
+    if (stopping_ && numQueued_ == 0) {
+      return;
+    }
+  }
+}
+
+TaskGroup::~TaskGroup() {
+  try {
+    wait();
+  } catch (...) {
+  }
+}
+
+void TaskGroup::run(std::function<void()> task) {
+  ++numRunning_;
+  pool_.submit([this, task]() {
+    std::exception_ptr error;
+    try {
+      task();
+    } catch (...) {
+      error = std::current_exception();
+    }
+    finish(error);
+  });
+}
+
+void TaskGroup::finish(std::exception_ptr error) {
+  // under the lock, so that wait() cannot return and destroy the group
+  // before this is done with it
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (error && !error_) {
+    error_ = error;
+  }
+  if (--numRunning_ == 0) {
+    done_.notify_all();
+  }
+}
+
+void TaskGroup::wait() {
+  while (numRunning_ > 0) {
+    if (!pool_.runPendingTask()) {
+      // the remaining tasks run elsewhere; wake up now and then to help
+      // with tasks they submit
+      std::unique_lock<std::mutex> lock(mutex_);
+      done_.wait_for(lock, std::chrono::microseconds(200),
+                     [&]() { return numRunning_ == 0; });
+    }
+  }
+  std::exception_ptr error;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::swap(error, error_);
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+int parallelForWithSlots(size_t count,
+                         int numSlots,
+                         const std::function<void(size_t, int)>& task) {
+  ThreadPool& pool = ThreadPool::global();
+  if (numSlots <= 0 || numSlots > pool.getNumThreads()) {
+    numSlots = pool.getNumThreads();
+  }
+  numSlots = std::max(1, std::min(numSlots, static_cast<int>(count)));
+  std::atomic<size_t> next{0};
+  auto runner = [&](int slot) {
+    for (size_t i = next++; i < count; i = next++) {
+      task(i, slot);
+    }
+  };
+  TaskGroup group(pool);
+  for (int iSlot = 1; iSlot < numSlots; ++iSlot) {
+    group.run([&runner, iSlot]() { runner(iSlot); });
+  }
+  runner(0);
+  group.wait();
+  return numSlots;
+}
+
+void parallelFor(size_t count,
+                 int maxThreads,
+                 const std::function<void(size_t)>& task) {
+  parallelForWithSlots(count, maxThreads, [&](size_t i, int) { task(i); });
+}
+
+void parallelForRange(size_t count,
+                      size_t grainSize,
+                      int maxThreads,
+                      const std::function<void(size_t, size_t)>& task) {
+  grainSize = std::max<size_t>(1, grainSize);
+  const size_t numRanges = (count + grainSize - 1) / grainSize;
+  parallelFor(numRanges, maxThreads, [&](size_t i) {
+    task(i * grainSize, std::min(count, (i + 1) * grainSize));
+  });
+}
+
+}  // namespace core
+}  // namespace esp
@@ -0,0 +1,147 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "esp/core/esp.h"
+
+namespace esp {
+namespace core {
+
+//! Work-stealing task scheduler. Each worker runs the tasks it submits itself
+//! last in first out from its own queue, and when that is empty steals the
+//! oldest task of another worker or of the queue of outside submissions.
+//! Threads waiting for a TaskGroup run pending tasks meanwhile, so nested
+//! parallel loops neither deadlock nor add threads.
+//! ThreadPool::global() is shared by the loaders, the pathfinder batches,
+//! physics world stepping and sensor post-processing, so that subsystems
+//! parallelizing at once do not oversubscribe the cores
+class ThreadPool {
+ public:
+  //! Pool running numThreads tasks at once including the calling thread, so
+  //! with numThreads - 1 workers; 0 for one per hardware thread
+  explicit ThreadPool(int numThreads = 0);
+  ~ThreadPool();
+
+  //! The pool of the process, see SimulatorConfiguration::numThreads
+  static ThreadPool& global();
+
+  //! Size global() to run numThreads tasks at once, 0 for one per hardware
+  //! thread. Simulators of one process share the pool, so the first call
+  //! wins and the pool is never resized underneath them: false, with a
+  //! warning, if numThreads disagrees with an earlier call or, without one,
+  //! with the pool already in use
+  static bool setGlobalNumThreads(int numThreads);
+
+  //! Tasks run at once including the calling thread
+  int getNumThreads() const { return workers_.size() + 1; }
+
+  //! Restart with numThreads, 0 for one per hardware thread, after running
+  //! the pending tasks. No tasks may be submitted meanwhile, so call it
+  //! only while no other thread uses the pool; see setGlobalNumThreads()
+  //! for global()
+  void setNumThreads(int numThreads);
+
+  //! Queue task, or run it right away if there are no workers
+  void submit(std::function<void()> task);
+
+  //! Run f on the pool, its result or exception in the future
+  template <typename F>
+  std::future<typename std::result_of<F()>::type> async(F&& f) {
+    typedef typename std::result_of<F()>::type Result;
+    auto task =
+        std::make_shared<std::packaged_task<Result()>>(std::forward<F>(f));
+    std::future<Result> result = task->get_future();
+    submit([task]() { (*task)(); });
+    return result;
+  }
+
+  //! Run one pending task on the calling thread, false if there is none
+  bool runPendingTask();
+
+ protected:
+  struct TaskQueue {
+    std::mutex mutex;
+    std::deque<std::function<void()>> tasks;
+  };
+
+  void start(int numThreads);
+  void stop();
+  void workerLoop(int index);
+  // pop from the back of queue index, else the front of any other one
+  bool popTask(int index, std::function<void()>& task);
+
+  // a queue per worker, then the one of other threads
+  std::vector<std::unique_ptr<TaskQueue>> queues_;
+  std::vector<std::thread> workers_;
+  std::atomic<size_t> numQueued_{0};
+  std::mutex sleepMutex_;
+  std::condition_variable wake_;
+  bool stopping_ = false;
+
+  ESP_SMART_POINTERS(ThreadPool)
+};
+
+//! Tasks run on a ThreadPool that can be waited for together. The first
+//! exception of a task is rethrown by wait()
+class TaskGroup {
+ public:
+  explicit TaskGroup(ThreadPool& pool = ThreadPool::global()) : pool_(pool) {}
+  //! Waits for the tasks, dropping their exceptions
+  ~TaskGroup();
+
+  void run(std::function<void()> task);
+
+  //! Wait for the tasks run so far, running pending tasks of the pool
+  //! meanwhile
+  void wait();
+
+ protected:
+  void finish(std::exception_ptr error);
+
+  ThreadPool& pool_;
+  std::atomic<int> numRunning_{0};
+  std::mutex mutex_;
+  std::condition_variable done_;
+  std::exception_ptr error_;
+
+  ESP_SMART_POINTERS(TaskGroup)
+};
+
+//! Run task(i) for i in [0, count) on up to maxThreads threads of the global
+//! pool (0 for all of them) including the calling one, handing out one i at
+//! a time so that uneven tasks balance
+void parallelFor(size_t count,
+                 int maxThreads,
+                 const std::function<void(size_t)>& task);
+
+//! parallelFor() giving each task the slot of the thread running it as well,
+//! unique among the threads running at once and in [0, numSlots), e.g. to
+//! index per-thread scratch state. The calling thread has slot 0. Returns
+//! the number of slots used, at most the threads of the global pool
+int parallelForWithSlots(size_t count,
+                         int numSlots,
+                         const std::function<void(size_t, int)>& task);
+
+//! parallelFor() over ranges [begin, end) of up to grainSize indices, for
+//! loops whose individual iterations are too cheap to hand out one by one
+void parallelForRange(size_t count,
+                      size_t grainSize,
+                      int maxThreads,
+                      const std::function<void(size_t, size_t)>& task);
+
+}  // namespace core
+}  // namespace esp
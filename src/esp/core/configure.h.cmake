@@ -11,3 +11,9 @@
 #cmakedefine ESP_BUILD_PTEX_SUPPORT
 
 #cmakedefine ESP_BUILD_GLOG_SHIM
+
+#cmakedefine ESP_BUILD_WITH_CUDA
+
+#cmakedefine ESP_BUILD_WITH_PROFILING
+
+#cmakedefine ESP_BUILD_WITH_MEMORY_TRACKING
@@ -4,40 +4,151 @@
 
 #pragma once
 
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
 #include <random>
 
 namespace esp {
 namespace core {
 
+//! Counter-based generator Philox4x32-10 (Salmon et al., "Parallel Random
+//! Numbers: As Easy as 1, 2, 3"). The n-th block of 4 numbers of a stream is a
+//! function of the key, the stream and n only, so generators are a few words
+//! that are cheap to copy, split into independent streams and skip ahead.
+//! Satisfies UniformRandomBitGenerator, e.g. for the std distributions
+class Philox4x32 {
+ public:
+  typedef uint32_t result_type;
+
+  explicit Philox4x32(uint64_t key = 0, uint64_t stream = 0)
+      : key_(key), stream_(stream) {}
+
+  static constexpr result_type min() { return 0; }
+  static constexpr result_type max() {
+    return std::numeric_limits<result_type>::max();
+  }
+
+  result_type operator()() {
+    if (index_ == 4) {
+      generateBlock();
+    }
+    return block_[index_++];
+  }
+
+  //! Skip n numbers
+  void discard(uint64_t n) {
+    const uint64_t position = 4 * counter_ - (4 - index_) + n;
+    counter_ = position / 4;
+    index_ = 4;
+    if (position % 4 != 0) {
+      generateBlock();
+      index_ = position % 4;
+    }
+  }
+
+  uint64_t key() const { return key_; }
+  uint64_t stream() const { return stream_; }
+
+  //! Generator of stream streamId of this one: same key, and a stream mixed
+  //! from both ids, starting at its first number. Splitting again splits
+  //! further, e.g. by environment and then by subsystem
+  Philox4x32 split(uint64_t streamId) const {
+    return Philox4x32(key_, mix(stream_ ^ mix(streamId + 1)));
+  }
+
+ private:
+  // SplitMix64 finalizer
+  static uint64_t mix(uint64_t x) {
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+  }
+
+  static uint32_t mulhilo(uint32_t a, uint32_t b, uint32_t& lo) {
+    const uint64_t product = static_cast<uint64_t>(a) * b;
+    lo = static_cast<uint32_t>(product);
+    return static_cast<uint32_t>(product >> 32);
+  }
+
+  // block counter_ of the stream, then the next counter
+  void generateBlock() {
+    uint32_t x[4] = {static_cast<uint32_t>(counter_),
+                     static_cast<uint32_t>(counter_ >> 32),
+                     static_cast<uint32_t>(stream_),
+                     static_cast<uint32_t>(stream_ >> 32)};
+    uint32_t k[2] = {static_cast<uint32_t>(key_),
+                     static_cast<uint32_t>(key_ >> 32)};
+    for (int round = 0; round < 10; ++round) {
+      uint32_t lo0, lo1;
+      const uint32_t hi0 = mulhilo(0xD2511F53u, x[0], lo0);
+      const uint32_t hi1 = mulhilo(0xCD9E8D57u, x[2], lo1);
+      x[0] = hi1 ^ x[1] ^ k[0];
+      x[1] = lo1;
+      x[2] = hi0 ^ x[3] ^ k[1];
+      x[3] = lo0;
+      k[0] += 0x9E3779B9u;
+      k[1] += 0xBB67AE85u;
+    }
+    std::copy(x, x + 4, block_);
+    ++counter_;
+    index_ = 0;
+  }
+
+  uint64_t key_;
+  uint64_t stream_;
+  uint64_t counter_ = 0;
+  uint32_t block_[4] = {0, 0, 0, 0};
+  // next number of block_, 4 if it is used up
+  int index_ = 4;
+};
+
+//! Random numbers of a Philox4x32 stream. The distributions are computed
+//! here rather than with the std ones, so that a seed gives the same numbers
+//! on every platform
 class Random {
  public:
-  explicit Random(unsigned int seed = std::random_device()())
-      : gen_(seed),
-        uniform_float_01_(0, 1),
-        uniform_int_(),
-        uniform_uint32_(),
-        normal_float_01_(0, 1) {}
+  explicit Random(unsigned int seed = std::random_device()()) : gen_(seed) {}
 
   //! Seed the random generator state with the given number
-  void seed(uint32_t newSeed) { gen_.seed(newSeed); }
+  void seed(uint32_t newSeed) {
+    gen_ = Philox4x32(newSeed);
+    hasNormal_ = false;
+  }
+
+  //! Independent, reproducible generator for stream streamId of this one,
+  //! e.g. for each thread, environment or subsystem. It only depends on the
+  //! seed and the ids, not on how many numbers this generator has drawn
+  Random split(uint64_t streamId) const { return Random(gen_.split(streamId)); }
 
   //! Return randomly sampled int distributed uniformly in [0,
   //! std::numeric_limits<int>::max()]
-  int uniform_int() { return uniform_int_(gen_); }
+  int uniform_int() { return static_cast<int>(gen_() >> 1); }
 
   //! Return randomly sampled uint32_t distributed uniformly in [0,
   //! std::numeric_limits<uint32_t>::max()]
-  uint32_t uniform_uint() { return uniform_uint32_(gen_); }
+  uint32_t uniform_uint() { return gen_(); }
 
   //! Return randomly sampled float distributed uniformly in [0, 1)
-  float uniform_float_01() { return uniform_float_01_(gen_); }
+  float uniform_float_01() { return toFloat01(gen_()); }
 
   //! Return randomly sampled float distributed normally (mean=0, std=1)
-  float normal_float_01() { return normal_float_01_(gen_); }
+  float normal_float_01() {
+    if (hasNormal_) {
+      hasNormal_ = false;
+      return normal_;
+    }
+    float first;
+    boxMuller(first, normal_);
+    hasNormal_ = true;
+    return first;
+  }
 
   //! Return randomly sampled float distributed uniformly in [a, b)
   float uniform_float(float a, float b) {
-    return uniform_float_01_(gen_) * (b - a) + a;
+    return uniform_float_01() * (b - a) + a;
   }
 
   //! Return randomly sampled int distributed uniformly in [a, b)
@@ -46,12 +157,61 @@ class Random {
         uniform_float(static_cast<float>(a), static_cast<float>(b)));
   }
 
+  //! Fill out with count numbers of uniform_uint()
+  void fill_uniform_uint(uint32_t* out, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+      out[i] = gen_();
+    }
+  }
+
+  //! Fill out with count numbers of uniform_float(a, b)
+  void fill_uniform_float(float* out, size_t count, float a = 0, float b = 1) {
+    for (size_t i = 0; i < count; ++i) {
+      out[i] = toFloat01(gen_()) * (b - a) + a;
+    }
+  }
+
+  //! Fill out with count numbers of normal_float_01(), generated in pairs
+  void fill_normal_float_01(float* out, size_t count) {
+    size_t i = 0;
+    if (hasNormal_ && count > 0) {
+      out[i++] = normal_;
+      hasNormal_ = false;
+    }
+    for (; i + 1 < count; i += 2) {
+      boxMuller(out[i], out[i + 1]);
+    }
+    if (i < count) {
+      out[i] = normal_float_01();
+    }
+  }
+
+  //! The underlying generator, e.g. for other std distributions
+  Philox4x32& generator() { return gen_; }
+
  protected:
-  std::default_random_engine gen_;
-  std::uniform_real_distribution<float> uniform_float_01_;
-  std::uniform_int_distribution<int> uniform_int_;
-  std::uniform_int_distribution<uint32_t> uniform_uint32_;
-  std::normal_distribution<float> normal_float_01_;
+  explicit Random(const Philox4x32& gen) : gen_(gen) {}
+
+  // the top 24 bits, which a float holds exactly
+  static float toFloat01(uint32_t x) {
+    return static_cast<float>(x >> 8) * (1.0f / 16777216.0f);
+  }
+
+  // two independent standard normals
+  void boxMuller(float& first, float& second) {
+    // in (0, 1], so that the log is finite
+    const float u1 = 1.0f - toFloat01(gen_());
+    const float u2 = toFloat01(gen_());
+    const float radius = std::sqrt(-2.0f * std::log(u1));
+    const float angle = 6.2831853f * u2;
+    first = radius * std::cos(angle);
+    second = radius * std::sin(angle);
+  }
+
+  Philox4x32 gen_;
+  // the second number of the last Box-Muller pair
+  bool hasNormal_ = false;
+  float normal_ = 0.0f;
 };
 
 }  // namespace core
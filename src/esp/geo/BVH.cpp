@@ -0,0 +1,92 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#include "BVH.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace esp {
+namespace geo {
+
+constexpr int BVH::maxStackSize;
+
+void BVH::build(const std::vector<box3f>& boxes, int maxLeafSize /* = 4 */) {
+  nodes_.clear();
+  items_.clear();
+  for (int i = 0; i < static_cast<int>(boxes.size()); ++i) {
+    if (!boxes[i].isEmpty()) {
+      items_.push_back(i);
+    }
+  }
+  if (!items_.empty()) {
+    build(boxes, std::max(maxLeafSize, 1), 0, items_.size());
+  }
+}
+
+void BVH::build(const std::vector<box3f>& boxes,
+                int maxLeafSize,
+                int begin,
+                int end) {
+  const int index = nodes_.size();
+  nodes_.emplace_back();
+  box3f box;
+  box3f centers;
+  for (int i = begin; i < end; ++i) {
+    box.extend(boxes[items_[i]]);
+    centers.extend(boxes[items_[i]].center());
+  }
+  nodes_[index].box = box;
+  nodes_[index].first = begin;
+  if (end - begin <= maxLeafSize) {
+    nodes_[index].count = end - begin;
+    nodes_[index].second = ID_UNDEFINED;
+    return;
+  }
+
+  int axis;
+  centers.sizes().maxCoeff(&axis);
+  const int middle = (begin + end) / 2;
+  std::nth_element(items_.begin() + begin, items_.begin() + middle,
+                   items_.begin() + end, [&](int a, int b) {
+                     return boxes[a].center()[axis] < boxes[b].center()[axis];
+                   });
+  nodes_[index].count = 0;
+  build(boxes, maxLeafSize, begin, middle);
+  nodes_[index].second = nodes_.size();
+  build(boxes, maxLeafSize, middle, end);
+}
+
+bool intersectRayBox(const box3f& box,
+                     const vec3f& origin,
+                     const vec3f& inverseDirection,
+                     float maxDistance,
+                     float& near) {
+  float tNear = 0.0f;
+  float tFar = maxDistance;
+  for (int i = 0; i < 3; ++i) {
+    // infinite inverse components give +-inf or nan for axis parallel rays,
+    // and the comparisons below skip nans
+    float t0 = (box.min()[i] - origin[i]) * inverseDirection[i];
+    float t1 = (box.max()[i] - origin[i]) * inverseDirection[i];
+    if (std::isnan(t0) || std::isnan(t1)) {
+      // parallel to the slab, and on its boundary plane
+      continue;
+    }
+    if (t0 > t1) {
+      std::swap(t0, t1);
+    }
+    tNear = std::max(tNear, t0);
+    tFar = std::min(tFar, t1);
+    if (tNear > tFar) {
+      return false;
+    }
+  }
+  near = tNear;
+  return true;
+}
+
+}  // namespace geo
+}  // namespace esp
@@ -0,0 +1,98 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#pragma once
+
+#include <vector>
+
+#include "esp/core/esp.h"
+
+namespace esp {
+namespace geo {
+
+// Bounding volume hierarchy over a list of axis-aligned boxes, split at the
+// median along the longest axis of the box centers. Items are the indices of
+// the boxes it was built from; what they stand for (drawables, objects,
+// triangles) is up to the user, who tests them in the callbacks of
+// traverse() or walks nodes() for other traversal orders
+class BVH {
+ public:
+  struct Node {
+    box3f box;
+    // leaves hold items [first, first + count), inner nodes have count 0 and
+    // their children at the next index and at second
+    int first;
+    int count;
+    int second;
+  };
+
+  //! Build over boxes, leaving out the empty ones, with up to maxLeafSize
+  //! items per leaf
+  void build(const std::vector<box3f>& boxes, int maxLeafSize = 4);
+
+  bool empty() const { return nodes_.empty(); }
+  //! Root first
+  const std::vector<Node>& nodes() const { return nodes_; }
+  //! Indices of the boxes, leaves reference consecutive ones
+  const std::vector<int>& items() const { return items_; }
+
+  //! Depth first traversal: descends into the nodes whose box enters(box)
+  //! accepts and calls visit(item) for the items of the leaves reached.
+  //! Stops as soon as visit returns true, returning true as well
+  template <typename EntersFn, typename VisitFn>
+  bool traverse(EntersFn enters, VisitFn visit) const {
+    if (nodes_.empty()) {
+      return false;
+    }
+    int stack[maxStackSize];
+    int stackSize = 0;
+    stack[stackSize++] = 0;
+    while (stackSize > 0) {
+      const int index = stack[--stackSize];
+      const Node& node = nodes_[index];
+      if (!enters(node.box)) {
+        continue;
+      }
+      if (node.count == 0) {
+        stack[stackSize++] = node.second;
+        stack[stackSize++] = index + 1;
+        continue;
+      }
+      for (int i = node.first; i < node.first + node.count; ++i) {
+        if (visit(items_[i])) {
+          return true;
+        }
+      }
+    }
+    return false;
+  }
+
+ protected:
+  // median splits keep trees of any realistic size far shallower than this,
+  // so traversals can use a fixed stack
+  static constexpr int maxStackSize = 64;
+
+  void build(const std::vector<box3f>& boxes,
+             int maxLeafSize,
+             int begin,
+             int end);
+
+  std::vector<Node> nodes_;
+  std::vector<int> items_;
+
+  ESP_SMART_POINTERS(BVH)
+};
+
+//! Slab test of the ray origin + t * direction through box, given the
+//! componentwise inverse of direction. Writes the entry distance t to near
+//! and returns true if the ray enters the box for t in [0, maxDistance]; a
+//! ray starting inside the box enters it at 0
+bool intersectRayBox(const box3f& box,
+                     const vec3f& origin,
+                     const vec3f& inverseDirection,
+                     float maxDistance,
+                     float& near);
+
+}  // namespace geo
+}  // namespace esp
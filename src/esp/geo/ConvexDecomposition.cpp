@@ -0,0 +1,503 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#include "esp/geo/ConvexDecomposition.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <utility>
+
+#include "esp/io/cache.h"
+
+namespace esp {
+namespace geo {
+
+namespace {
+// kind of the convex hull files, distinct from the mesh and BVH cache kinds
+const uint32_t hullsCacheKind = 101;
+const uint32_t hullsCacheVersion = 1;
+
+struct HullFace {
+  int a, b, c;
+  vec3f normal;
+  float offset;
+  bool alive;
+};
+
+// Directions the hull of a voxel part is sampled along: the boundary of a
+// 5x5x5 lattice, i.e. the axes, diagonals and 92 directions in between
+const std::vector<vec3f>& supportDirections() {
+  static const std::vector<vec3f> directions = []() {
+    std::vector<vec3f> directions;
+    for (int x = -2; x <= 2; ++x) {
+      for (int y = -2; y <= 2; ++y) {
+        for (int z = -2; z <= 2; ++z) {
+          if (std::max({std::abs(x), std::abs(y), std::abs(z)}) == 2) {
+            directions.emplace_back(vec3f(x, y, z).normalized());
+          }
+        }
+      }
+    }
+    return directions;
+  }();
+  return directions;
+}
+
+// Solid voxelization of a closed mesh with at least one voxel of empty
+// padding
+class VoxelGrid {
+ public:
+  VoxelGrid(const std::vector<vec3f>& vertices,
+            const std::vector<uint32_t>& indices,
+            int resolution);
+
+  bool isEmpty() const { return voxelSize_ <= 0; }
+  float voxelSize() const { return voxelSize_; }
+
+  //! Position of the minimum corner of voxel v
+  vec3f corner(const vec3i& v) const {
+    return origin_ + v.cast<float>() * voxelSize_;
+  }
+
+  std::vector<vec3i> solidVoxels() const;
+
+ private:
+  enum Cell : uint8_t { Unknown = 0, Surface = 1, Exterior = 2 };
+
+  int index(const vec3i& v) const {
+    return (v[2] * dims_[1] + v[1]) * dims_[0] + v[0];
+  }
+
+  vec3f origin_;
+  float voxelSize_ = 0;
+  vec3i dims_;
+  std::vector<uint8_t> cells_;
+};
+
+VoxelGrid::VoxelGrid(const std::vector<vec3f>& vertices,
+                     const std::vector<uint32_t>& indices,
+                     int resolution) {
+  box3f bounds;
+  for (const uint32_t i : indices) {
+    bounds.extend(vertices[i]);
+  }
+  if (bounds.isEmpty() || bounds.sizes().maxCoeff() <= 0 || resolution < 1) {
+    return;
+  }
+  voxelSize_ = bounds.sizes().maxCoeff() / resolution;
+  // offset by half a voxel, so that faces on the bounds (e.g. of boxes) fall
+  // in the middle of a voxel and the solid grows by the same on all sides
+  origin_ = bounds.min() - vec3f::Constant(1.5f * voxelSize_);
+  for (int a = 0; a < 3; ++a) {
+    dims_[a] = static_cast<int>(bounds.sizes()[a] / voxelSize_) + 4;
+  }
+  cells_.assign(dims_.prod(), Unknown);
+
+  // Mark the voxels touched by the surface by sampling every triangle at half
+  // the voxel size
+  auto voxelOf = [&](const vec3f& p) -> vec3i {
+    vec3i v = ((p - origin_) / voxelSize_).array().floor().cast<int>();
+    return v.cwiseMax(vec3i::Ones()).cwiseMin(dims_ - 2 * vec3i::Ones());
+  };
+  for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+    const vec3f& a = vertices[indices[t]];
+    const vec3f& b = vertices[indices[t + 1]];
+    const vec3f& c = vertices[indices[t + 2]];
+    const float longestEdge =
+        std::max({(b - a).norm(), (c - b).norm(), (a - c).norm()});
+    const int steps =
+        std::max(1, static_cast<int>(std::ceil(longestEdge / voxelSize_ * 2)));
+    for (int i = 0; i <= steps; ++i) {
+      for (int j = 0; i + j <= steps; ++j) {
+        const vec3f p = a + (b - a) * i / steps + (c - a) * j / steps;
+        cells_[index(voxelOf(p))] = Surface;
+      }
+    }
+  }
+
+  // Flood fill the outside from a padding voxel; whatever is not reached is
+  // on or inside the surface
+  std::vector<vec3i> stack{vec3i::Zero()};
+  cells_[0] = Exterior;
+  while (!stack.empty()) {
+    const vec3i v = stack.back();
+    stack.pop_back();
+    for (int a = 0; a < 3; ++a) {
+      for (int step : {-1, 1}) {
+        vec3i n = v;
+        n[a] += step;
+        if (n[a] < 0 || n[a] >= dims_[a] || cells_[index(n)] != Unknown) {
+          continue;
+        }
+        cells_[index(n)] = Exterior;
+        stack.push_back(n);
+      }
+    }
+  }
+}
+
+std::vector<vec3i> VoxelGrid::solidVoxels() const {
+  std::vector<vec3i> voxels;
+  for (int z = 0; z < dims_[2]; ++z) {
+    for (int y = 0; y < dims_[1]; ++y) {
+      for (int x = 0; x < dims_[0]; ++x) {
+        const vec3i v(x, y, z);
+        if (cells_[index(v)] != Exterior) {
+          voxels.push_back(v);
+        }
+      }
+    }
+  }
+  return voxels;
+}
+
+// Corners of voxel v that are extreme along direction d
+void addSupportCorners(const VoxelGrid& grid,
+                       const vec3i& v,
+                       const vec3f& d,
+                       std::vector<vec3f>& points) {
+  for (int corner = 0; corner < 8; ++corner) {
+    vec3i offset;
+    bool extreme = true;
+    for (int a = 0; a < 3; ++a) {
+      offset[a] = (corner >> a) & 1;
+      extreme = extreme && !(d[a] > 0 && offset[a] == 0) &&
+                !(d[a] < 0 && offset[a] == 1);
+    }
+    if (extreme) {
+      points.push_back(grid.corner(v + offset));
+    }
+  }
+}
+
+struct VoxelPart {
+  std::vector<vec3i> voxels;
+  ConvexHull hull;
+  float concavity = 0;
+};
+
+VoxelPart makePart(const VoxelGrid& grid, std::vector<vec3i> voxels) {
+  VoxelPart part;
+  part.voxels = std::move(voxels);
+  std::vector<vec3f> points;
+  for (const vec3f& d : supportDirections()) {
+    const vec3i* best = nullptr;
+    float bestValue = -std::numeric_limits<float>::infinity();
+    for (const vec3i& v : part.voxels) {
+      const float value = d.dot(v.cast<float>());
+      if (value > bestValue) {
+        bestValue = value;
+        best = &v;
+      }
+    }
+    addSupportCorners(grid, *best, d, points);
+  }
+  part.hull = convexHull(points);
+  const float hullVolume = convexHullVolume(part.hull);
+  const float solidVolume = part.voxels.size() * std::pow(grid.voxelSize(), 3);
+  part.concavity = hullVolume > 0 ? 1 - solidVolume / hullVolume : 0;
+  return part;
+}
+
+// Best axis-aligned split of a part, as (axis, first voxel index of the second
+// half); axis is -1 if the part cannot be split. The extreme voxel of every
+// slice along every support direction is found once per axis, so that the
+// hulls of both halves at every plane follow from prefix/suffix maxima.
+std::pair<int, int> bestSplit(const VoxelGrid& grid, const VoxelPart& part) {
+  const std::vector<vec3f>& directions = supportDirections();
+  const int numDirections = directions.size();
+  std::pair<int, int> best{-1, 0};
+  float bestVolume = std::numeric_limits<float>::infinity();
+
+  for (int axis = 0; axis < 3; ++axis) {
+    int minSlice = std::numeric_limits<int>::max();
+    int maxSlice = std::numeric_limits<int>::min();
+    for (const vec3i& v : part.voxels) {
+      minSlice = std::min(minSlice, v[axis]);
+      maxSlice = std::max(maxSlice, v[axis]);
+    }
+    const int numSlices = maxSlice - minSlice + 1;
+    if (numSlices < 2) {
+      continue;
+    }
+
+    // extreme[slice * numDirections + d], nullptr for empty slices
+    std::vector<const vec3i*> extreme(numSlices * numDirections, nullptr);
+    std::vector<float> extremeValue(numSlices * numDirections,
+                                    -std::numeric_limits<float>::infinity());
+    for (const vec3i& v : part.voxels) {
+      const int slice = v[axis] - minSlice;
+      for (int d = 0; d < numDirections; ++d) {
+        const float value = directions[d].dot(v.cast<float>());
+        const int i = slice * numDirections + d;
+        if (value > extremeValue[i]) {
+          extremeValue[i] = value;
+          extreme[i] = &v;
+        }
+      }
+    }
+
+    auto hullVolume = [&](int beginSlice, int endSlice) {
+      std::vector<vec3f> points;
+      for (int d = 0; d < numDirections; ++d) {
+        const vec3i* bestVoxel = nullptr;
+        float bestValue = -std::numeric_limits<float>::infinity();
+        for (int s = beginSlice; s < endSlice; ++s) {
+          const int i = s * numDirections + d;
+          if (extreme[i] != nullptr && extremeValue[i] > bestValue) {
+            bestValue = extremeValue[i];
+            bestVoxel = extreme[i];
+          }
+        }
+        if (bestVoxel != nullptr) {
+          addSupportCorners(grid, *bestVoxel, directions[d], points);
+        }
+      }
+      return points.empty() ? 0 : convexHullVolume(convexHull(points));
+    };
+
+    for (int split = 1; split < numSlices; ++split) {
+      const float volume =
+          hullVolume(0, split) + hullVolume(split, numSlices);
+      if (volume < bestVolume) {
+        bestVolume = volume;
+        best = {axis, minSlice + split};
+      }
+    }
+  }
+  return best;
+}
+
+}  // namespace
+
+ConvexHull convexHull(const std::vector<vec3f>& points) {
+  ConvexHull hull;
+  if (points.size() < 4) {
+    return hull;
+  }
+  box3f bounds;
+  for (const vec3f& p : points) {
+    bounds.extend(p);
+  }
+  const float eps = 1e-5f * bounds.diagonal().norm();
+
+  // Initial tetrahedron from extreme points
+  int i0 = 0;
+  for (size_t i = 1; i < points.size(); ++i) {
+    if (points[i][0] < points[i0][0]) {
+      i0 = i;
+    }
+  }
+  auto farthest = [&](auto distance) {
+    int best = i0;
+    float bestDistance = 0;
+    for (size_t i = 0; i < points.size(); ++i) {
+      const float d = distance(points[i]);
+      if (d > bestDistance) {
+        bestDistance = d;
+        best = i;
+      }
+    }
+    return std::make_pair(best, bestDistance);
+  };
+  const vec3f& p0 = points[i0];
+  const auto f1 = farthest([&](const vec3f& p) { return (p - p0).norm(); });
+  const vec3f line = (points[f1.first] - p0).normalized();
+  const auto f2 = farthest(
+      [&](const vec3f& p) { return (p - p0).cross(line).norm(); });
+  const vec3f planeNormal =
+      line.cross(points[f2.first] - p0).normalized();
+  const auto f3 = farthest(
+      [&](const vec3f& p) { return std::abs(planeNormal.dot(p - p0)); });
+  if (f1.second <= eps || f2.second <= eps || f3.second <= eps) {
+    return hull;
+  }
+  int i1 = f1.first;
+  int i2 = f2.first;
+  const int i3 = f3.first;
+  if (planeNormal.dot(points[i3] - p0) > 0) {
+    std::swap(i1, i2);
+  }
+
+  std::vector<HullFace> faces;
+  // face each directed edge belongs to
+  std::map<std::pair<int, int>, int> edgeFaces;
+  auto addFace = [&](int a, int b, int c) {
+    HullFace face{a, b, c, vec3f::Zero(), 0, true};
+    face.normal =
+        (points[b] - points[a]).cross(points[c] - points[a]).normalized();
+    face.offset = face.normal.dot(points[a]);
+    edgeFaces[{a, b}] = edgeFaces[{b, c}] = edgeFaces[{c, a}] = faces.size();
+    faces.push_back(face);
+  };
+  addFace(i0, i1, i2);
+  addFace(i0, i3, i1);
+  addFace(i1, i3, i2);
+  addFace(i2, i3, i0);
+
+  std::vector<char> visible;
+  std::vector<std::pair<int, int>> horizon;
+  for (size_t i = 0; i < points.size(); ++i) {
+    if (static_cast<int>(i) == i0 || static_cast<int>(i) == i1 ||
+        static_cast<int>(i) == i2 || static_cast<int>(i) == i3) {
+      continue;
+    }
+    const vec3f& p = points[i];
+    visible.assign(faces.size(), false);
+    bool anyVisible = false;
+    for (size_t f = 0; f < faces.size(); ++f) {
+      if (faces[f].alive && faces[f].normal.dot(p) - faces[f].offset > eps) {
+        visible[f] = anyVisible = true;
+      }
+    }
+    if (!anyVisible) {
+      continue;
+    }
+
+    // Replace the visible faces by a cone from p to their horizon
+    horizon.clear();
+    for (size_t f = 0; f < faces.size(); ++f) {
+      if (!visible[f]) {
+        continue;
+      }
+      const HullFace& face = faces[f];
+      for (const auto& edge : {std::make_pair(face.a, face.b),
+                               std::make_pair(face.b, face.c),
+                               std::make_pair(face.c, face.a)}) {
+        if (!visible[edgeFaces[{edge.second, edge.first}]]) {
+          horizon.push_back(edge);
+        }
+      }
+    }
+    for (size_t f = 0; f < faces.size(); ++f) {
+      if (visible[f]) {
+        faces[f].alive = false;
+      }
+    }
+    for (const auto& edge : horizon) {
+      addFace(edge.first, edge.second, i);
+    }
+  }
+
+  std::map<int, uint32_t> vertexIndices;
+  auto vertexIndex = [&](int i) {
+    auto it = vertexIndices.find(i);
+    if (it != vertexIndices.end()) {
+      return it->second;
+    }
+    const uint32_t index = hull.vertices.size();
+    hull.vertices.push_back(points[i]);
+    vertexIndices.emplace(i, index);
+    return index;
+  };
+  for (const HullFace& face : faces) {
+    if (face.alive) {
+      hull.indices.push_back(vertexIndex(face.a));
+      hull.indices.push_back(vertexIndex(face.b));
+      hull.indices.push_back(vertexIndex(face.c));
+    }
+  }
+  return hull;
+}
+
+float convexHullVolume(const ConvexHull& hull) {
+  float volume = 0;
+  for (size_t i = 0; i + 2 < hull.indices.size(); i += 3) {
+    const vec3f& a = hull.vertices[hull.indices[i]];
+    const vec3f& b = hull.vertices[hull.indices[i + 1]];
+    const vec3f& c = hull.vertices[hull.indices[i + 2]];
+    volume += a.dot(b.cross(c));
+  }
+  return volume / 6;
+}
+
+std::vector<ConvexHull> convexDecomposition(
+    const std::vector<vec3f>& vertices,
+    const std::vector<uint32_t>& indices,
+    const ConvexDecompositionSettings& settings) {
+  const VoxelGrid grid(vertices, indices, settings.resolution);
+  if (grid.isEmpty()) {
+    LOG(WARNING) << "convexDecomposition: mesh has no volume";
+    return {};
+  }
+
+  std::vector<VoxelPart> parts;
+  parts.emplace_back(makePart(grid, grid.solidVoxels()));
+  while (static_cast<int>(parts.size()) < settings.maxHulls) {
+    auto worst = std::max_element(parts.begin(), parts.end(),
+                                  [](const VoxelPart& a, const VoxelPart& b) {
+                                    return a.concavity < b.concavity;
+                                  });
+    if (worst->concavity <= settings.maxConcavity) {
+      break;
+    }
+    const std::pair<int, int> split = bestSplit(grid, *worst);
+    if (split.first < 0) {
+      worst->concavity = 0;
+      continue;
+    }
+    std::vector<vec3i> first, second;
+    for (const vec3i& v : worst->voxels) {
+      (v[split.first] < split.second ? first : second).push_back(v);
+    }
+    *worst = makePart(grid, std::move(first));
+    parts.emplace_back(makePart(grid, std::move(second)));
+  }
+
+  if (parts.size() == 1) {
+    std::vector<vec3f> points;
+    for (const uint32_t i : indices) {
+      points.push_back(vertices[i]);
+    }
+    ConvexHull hull = convexHull(points);
+    if (!hull.indices.empty()) {
+      return {hull};
+    }
+  }
+  std::vector<ConvexHull> hulls;
+  for (VoxelPart& part : parts) {
+    hulls.emplace_back(std::move(part.hull));
+  }
+  return hulls;
+}
+
+std::string convexHullsFilename(const std::string& objectConfigFile) {
+  return io::cacheFilename(objectConfigFile + ".hulls");
+}
+
+bool saveConvexHulls(const std::string& file,
+                     const std::vector<ConvexHull>& hulls,
+                     const std::string& sourceFile) {
+  // two sections per hull: vertices, then indices
+  io::CacheWriter writer(hullsCacheKind, hullsCacheVersion, sourceFile);
+  for (const ConvexHull& hull : hulls) {
+    writer.addSection(hull.vertices);
+    writer.addSection(hull.indices);
+  }
+  return writer.write(file);
+}
+
+bool loadConvexHulls(const std::string& file,
+                     const std::string& sourceFile,
+                     std::vector<ConvexHull>& hulls) {
+  const io::CacheReader reader(file, hullsCacheKind, hullsCacheVersion,
+                               sourceFile);
+  if (!reader.isValid() || reader.getNumSections() % 2 != 0) {
+    return false;
+  }
+  hulls.resize(reader.getNumSections() / 2);
+  for (size_t i = 0; i < hulls.size(); ++i) {
+    if (!reader.readSection(2 * i, hulls[i].vertices) ||
+        !reader.readSection(2 * i + 1, hulls[i].indices)) {
+      hulls.clear();
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace geo
+}  // namespace esp
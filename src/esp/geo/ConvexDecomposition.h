@@ -0,0 +1,67 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "esp/core/esp.h"
+
+namespace esp {
+namespace geo {
+
+//! Closed convex triangle mesh, faces wound counter-clockwise seen from
+//! outside
+struct ConvexHull {
+  std::vector<vec3f> vertices;
+  std::vector<uint32_t> indices;
+};
+
+struct ConvexDecompositionSettings {
+  //! number of voxels along the longest side of the mesh bounds
+  int resolution = 32;
+  //! parts are split until 1 - (part volume / hull volume) is at most this
+  float maxConcavity = 0.05f;
+  //! upper bound on the number of hulls
+  int maxHulls = 16;
+};
+
+//! Convex hull of 3D points; empty if the points are (nearly) coplanar
+ConvexHull convexHull(const std::vector<vec3f>& points);
+
+//! Volume enclosed by a closed convex hull
+float convexHullVolume(const ConvexHull& hull);
+
+// Approximate convex decomposition of a closed triangle mesh, in the spirit of
+// V-HACD: the mesh is voxelized, its interior filled, and parts are split
+// recursively by the axis-aligned plane that minimizes the summed volume of
+// the convex hulls of both sides, until every part is close enough to its
+// hull. A mesh that needs no split gets the exact hull of its vertices,
+// otherwise the hulls are built from voxel corners and so may exceed the mesh
+// by up to one voxel. Meshes with holes are treated as if they were hollow.
+std::vector<ConvexHull> convexDecomposition(
+    const std::vector<vec3f>& vertices,
+    const std::vector<uint32_t>& indices,
+    const ConvexDecompositionSettings& settings = {});
+
+//! File the convex decomposition of an object collision mesh is stored in,
+//! next to the object config
+std::string convexHullsFilename(const std::string& objectConfigFile);
+
+//! Save hulls to file, sourceFile is the collision mesh file they were made
+//! from
+bool saveConvexHulls(const std::string& file,
+                     const std::vector<ConvexHull>& hulls,
+                     const std::string& sourceFile);
+
+//! Load hulls saved by saveConvexHulls(), false if the file is missing or was
+//! made from other contents of the collision mesh
+bool loadConvexHulls(const std::string& file,
+                     const std::string& sourceFile,
+                     std::vector<ConvexHull>& hulls);
+
+}  // namespace geo
+}  // namespace esp
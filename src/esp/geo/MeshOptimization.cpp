@@ -0,0 +1,309 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#include "esp/geo/MeshOptimization.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace esp {
+namespace geo {
+
+namespace {
+// size of the LRU cache the triangle order is scored against; orders good
+// for it are good for the smaller FIFO caches of actual GPUs too
+const int scoredCacheSize = 32;
+
+// cache the overdraw clusters are measured against
+const int fifoCacheSize = 16;
+
+// clusters are split further where their miss ratio is within this factor
+// of the miss ratio of the whole cluster
+const float overdrawThreshold = 1.05f;
+
+float vertexScore(int cachePosition, int remainingTriangles) {
+  if (remainingTriangles == 0) {
+    return -1;
+  }
+  float score = 0;
+  if (cachePosition >= 0) {
+    // the vertices of the last triangle score lower than the ones before,
+    // else the same triangle's neighbours keep winning and strips form
+    score = cachePosition < 3
+                ? 0.75f
+                : std::pow(1 - float(cachePosition - 3) / (scoredCacheSize - 3),
+                           1.5f);
+  }
+  // vertices with few triangles left are best finished off
+  return score + 2.0f / std::sqrt(float(remainingTriangles));
+}
+
+// FIFO post-transform cache: a vertex is cached if it was transformed less
+// than size misses ago
+class FifoCache {
+ public:
+  FifoCache(size_t numVertices, int size)
+      : timestamps_(numVertices, std::numeric_limits<int64_t>::min() / 2),
+        size_(size) {}
+
+  //! Number of vertices of triangle t of indices that miss the cache
+  int draw(const std::vector<uint32_t>& indices, uint32_t t) {
+    int misses = 0;
+    for (int k = 0; k < 3; ++k) {
+      const uint32_t v = indices[3 * t + k];
+      if (time_ - timestamps_[v] >= size_) {
+        timestamps_[v] = time_++;
+        ++misses;
+      }
+    }
+    return misses;
+  }
+
+  void clear() { time_ += size_; }
+
+ private:
+  std::vector<int64_t> timestamps_;
+  int64_t time_ = 0;
+  int size_;
+};
+}  // namespace
+
+std::vector<uint32_t> vertexCacheTriangleOrder(
+    const std::vector<uint32_t>& indices,
+    size_t numVertices) {
+  const size_t numTriangles = indices.size() / 3;
+
+  // triangles of each vertex
+  std::vector<uint32_t> offsets(numVertices + 1, 0);
+  for (size_t i = 0; i < numTriangles * 3; ++i) {
+    ++offsets[indices[i] + 1];
+  }
+  for (size_t v = 0; v < numVertices; ++v) {
+    offsets[v + 1] += offsets[v];
+  }
+  std::vector<uint32_t> vertexTriangles(numTriangles * 3);
+  std::vector<uint32_t> remaining(numVertices);
+  for (size_t i = 0; i < numTriangles * 3; ++i) {
+    const uint32_t v = indices[i];
+    vertexTriangles[offsets[v] + remaining[v]++] = i / 3;
+  }
+
+  std::vector<int> cachePositions(numVertices, -1);
+  std::vector<float> vertexScores(numVertices);
+  for (size_t v = 0; v < numVertices; ++v) {
+    vertexScores[v] = vertexScore(-1, remaining[v]);
+  }
+  std::vector<float> triangleScores(numTriangles, 0);
+  for (size_t i = 0; i < numTriangles * 3; ++i) {
+    triangleScores[i / 3] += vertexScores[indices[i]];
+  }
+  std::vector<bool> emitted(numTriangles, false);
+
+  std::vector<uint32_t> order;
+  order.reserve(numTriangles);
+  std::vector<uint32_t> cache, newCache;
+  int64_t best = -1;
+  if (numTriangles > 0) {
+    best = std::max_element(triangleScores.begin(), triangleScores.end()) -
+           triangleScores.begin();
+  }
+  size_t nextUnemitted = 0;
+  while (order.size() < numTriangles) {
+    // at a dead end, where no cached vertex has triangles left, continue in
+    // input order
+    if (best < 0) {
+      while (emitted[nextUnemitted]) {
+        ++nextUnemitted;
+      }
+      best = nextUnemitted;
+    }
+
+    emitted[best] = true;
+    order.push_back(best);
+    newCache.assign(indices.begin() + 3 * best, indices.begin() + 3 * best + 3);
+    for (uint32_t v : newCache) {
+      --remaining[v];
+    }
+    for (uint32_t v : cache) {
+      if (std::find(newCache.begin(), newCache.begin() + 3, v) ==
+          newCache.begin() + 3) {
+        newCache.push_back(v);
+      }
+    }
+
+    // rescore the cached vertices and the ones just evicted, with their
+    // triangles
+    for (size_t i = 0; i < newCache.size(); ++i) {
+      const uint32_t v = newCache[i];
+      cachePositions[v] = i < scoredCacheSize ? i : -1;
+      const float score = vertexScore(cachePositions[v], remaining[v]);
+      const float delta = score - vertexScores[v];
+      vertexScores[v] = score;
+      for (uint32_t k = offsets[v]; k < offsets[v + 1]; ++k) {
+        triangleScores[vertexTriangles[k]] += delta;
+      }
+    }
+    if (newCache.size() > scoredCacheSize) {
+      newCache.resize(scoredCacheSize);
+    }
+    std::swap(cache, newCache);
+
+    best = -1;
+    float bestScore = -std::numeric_limits<float>::infinity();
+    for (uint32_t v : cache) {
+      for (uint32_t k = offsets[v]; k < offsets[v + 1]; ++k) {
+        const uint32_t t = vertexTriangles[k];
+        if (!emitted[t] && triangleScores[t] > bestScore) {
+          bestScore = triangleScores[t];
+          best = t;
+        }
+      }
+    }
+  }
+  return order;
+}
+
+std::vector<uint32_t> overdrawTriangleOrder(
+    const std::vector<uint32_t>& indices,
+    const std::vector<vec3f>& positions,
+    const std::vector<uint32_t>& triangleOrder) {
+  // hard boundaries where the cache starts over, i.e. a triangle misses with
+  // all of its vertices
+  std::vector<size_t> hardBoundaries;
+  FifoCache cache(positions.size(), fifoCacheSize);
+  for (size_t i = 0; i < triangleOrder.size(); ++i) {
+    if (cache.draw(indices, triangleOrder[i]) == 3) {
+      hardBoundaries.push_back(i);
+    }
+  }
+  hardBoundaries.push_back(triangleOrder.size());
+
+  // soft boundaries within, where splitting costs few extra misses
+  std::vector<size_t> boundaries;
+  for (size_t c = 0; c + 1 < hardBoundaries.size(); ++c) {
+    const size_t begin = hardBoundaries[c], end = hardBoundaries[c + 1];
+    cache.clear();
+    int clusterMisses = 0;
+    for (size_t i = begin; i < end; ++i) {
+      clusterMisses += cache.draw(indices, triangleOrder[i]);
+    }
+    const float clusterRatio = float(clusterMisses) / (end - begin);
+
+    boundaries.push_back(begin);
+    cache.clear();
+    int misses = 0;
+    size_t start = begin;
+    for (size_t i = begin; i + 1 < end; ++i) {
+      misses += cache.draw(indices, triangleOrder[i]);
+      if (float(misses) / (i + 1 - start) <= clusterRatio * overdrawThreshold) {
+        boundaries.push_back(i + 1);
+        cache.clear();
+        misses = 0;
+        start = i + 1;
+      }
+    }
+  }
+  boundaries.push_back(triangleOrder.size());
+
+  // area weighted centroids and normals of the mesh and of each cluster
+  const size_t numClusters = boundaries.size() - 1;
+  std::vector<vec3f> centroids(numClusters, vec3f::Zero());
+  std::vector<vec3f> normals(numClusters, vec3f::Zero());
+  vec3f meshCentroid = vec3f::Zero();
+  float meshArea = 0;
+  for (size_t c = 0; c < numClusters; ++c) {
+    float area = 0;
+    for (size_t i = boundaries[c]; i < boundaries[c + 1]; ++i) {
+      const uint32_t t = triangleOrder[i];
+      const vec3f& a = positions[indices[3 * t]];
+      const vec3f& b = positions[indices[3 * t + 1]];
+      const vec3f& d = positions[indices[3 * t + 2]];
+      const vec3f normal = (b - a).cross(d - a);
+      const float triangleArea = normal.norm();
+      centroids[c] += (a + b + d) / 3 * triangleArea;
+      normals[c] += normal;
+      area += triangleArea;
+    }
+    meshCentroid += centroids[c];
+    meshArea += area;
+    if (area > 0) {
+      centroids[c] /= area;
+    }
+  }
+  if (meshArea > 0) {
+    meshCentroid /= meshArea;
+  }
+
+  std::vector<float> keys(numClusters);
+  for (size_t c = 0; c < numClusters; ++c) {
+    const float length = normals[c].norm();
+    keys[c] = length > 0
+                  ? (centroids[c] - meshCentroid).dot(normals[c]) / length
+                  : 0;
+  }
+  std::vector<uint32_t> clusters(numClusters);
+  for (size_t c = 0; c < numClusters; ++c) {
+    clusters[c] = c;
+  }
+  std::stable_sort(clusters.begin(), clusters.end(),
+                   [&](uint32_t a, uint32_t b) { return keys[a] > keys[b]; });
+
+  std::vector<uint32_t> order;
+  order.reserve(triangleOrder.size());
+  for (uint32_t c : clusters) {
+    order.insert(order.end(), triangleOrder.begin() + boundaries[c],
+                 triangleOrder.begin() + boundaries[c + 1]);
+  }
+  return order;
+}
+
+std::vector<uint32_t> reorderTriangles(
+    const std::vector<uint32_t>& indices,
+    const std::vector<uint32_t>& triangleOrder) {
+  std::vector<uint32_t> reordered;
+  reordered.reserve(triangleOrder.size() * 3);
+  for (uint32_t t : triangleOrder) {
+    reordered.insert(reordered.end(), indices.begin() + 3 * t,
+                     indices.begin() + 3 * t + 3);
+  }
+  return reordered;
+}
+
+std::vector<uint32_t> vertexFetchOrder(const std::vector<uint32_t>& indices,
+                                       size_t numVertices) {
+  std::vector<bool> used(numVertices, false);
+  std::vector<uint32_t> order;
+  order.reserve(numVertices);
+  for (uint32_t v : indices) {
+    if (!used[v]) {
+      used[v] = true;
+      order.push_back(v);
+    }
+  }
+  for (size_t v = 0; v < numVertices; ++v) {
+    if (!used[v]) {
+      order.push_back(v);
+    }
+  }
+  return order;
+}
+
+float vertexCacheMissRatio(const std::vector<uint32_t>& indices,
+                           size_t numVertices,
+                           int cacheSize) {
+  const size_t numTriangles = indices.size() / 3;
+  if (numTriangles == 0) {
+    return 0;
+  }
+  FifoCache cache(numVertices, cacheSize);
+  size_t misses = 0;
+  for (size_t t = 0; t < numTriangles; ++t) {
+    misses += cache.draw(indices, t);
+  }
+  return float(misses) / numTriangles;
+}
+
+}  // namespace geo
+}  // namespace esp
@@ -0,0 +1,53 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "esp/core/esp.h"
+
+namespace esp {
+namespace geo {
+
+// Order of the triangles of an indexed triangle mesh that reuses the
+// post-transform vertex cache of the GPU well, by Tom Forsyth's "Linear-speed
+// vertex cache optimisation": triangles are emitted greedily by a score that
+// favours vertices recently used and vertices with few triangles left.
+// Returns the triangle indices in draw order.
+std::vector<uint32_t> vertexCacheTriangleOrder(
+    const std::vector<uint32_t>& indices,
+    size_t numVertices);
+
+// Refine a vertex cache friendly triangle order to reduce overdraw, after
+// Sander et al. "Fast triangle reordering for vertex locality and reduced
+// overdraw": the order is split into clusters where the cache starts over,
+// and clusters facing away from the center of the mesh, which tend to occlude
+// the rest, are drawn first. Within a cluster the order is kept.
+std::vector<uint32_t> overdrawTriangleOrder(
+    const std::vector<uint32_t>& indices,
+    const std::vector<vec3f>& positions,
+    const std::vector<uint32_t>& triangleOrder);
+
+//! Indices of the triangles of indices in triangleOrder
+std::vector<uint32_t> reorderTriangles(
+    const std::vector<uint32_t>& indices,
+    const std::vector<uint32_t>& triangleOrder);
+
+//! Order of the vertices by their first use in indices, unused ones last, so
+//! that vertex fetches go through memory in order. Returns the old index of
+//! each new vertex
+std::vector<uint32_t> vertexFetchOrder(const std::vector<uint32_t>& indices,
+                                       size_t numVertices);
+
+//! Average number of vertices transformed per triangle when drawing indices
+//! through a FIFO post-transform cache of cacheSize vertices; 3 is no reuse,
+//! about 0.5 is the best a regular grid can do
+float vertexCacheMissRatio(const std::vector<uint32_t>& indices,
+                           size_t numVertices,
+                           int cacheSize = 16);
+
+}  // namespace geo
+}  // namespace esp
@@ -0,0 +1,276 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#include "esp/geo/MeshSimplification.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <unordered_map>
+
+#include "esp/io/cache.h"
+
+namespace esp {
+namespace geo {
+
+namespace {
+// kind of the mesh levels of detail files, distinct from the other cache kinds
+const uint32_t meshLODsCacheKind = 105;
+const uint32_t meshLODsCacheVersion = 1;
+// kind of the simplified collision mesh files
+const uint32_t collisionMeshesCacheKind = 106;
+const uint32_t collisionMeshesCacheVersion = 1;
+
+// finest grid tried, in cells along the longest side of the mesh bounds
+const int maxGridResolution = 1 << 12;
+
+// Cluster the vertices into cubic cells of cellSize starting at origin and
+// write the triangles that survive into clustered, returns their number
+size_t clusterMesh(const std::vector<vec3f>& positions,
+                   const std::vector<uint32_t>& indices,
+                   const vec3f& origin,
+                   float cellSize,
+                   std::vector<uint32_t>& clustered) {
+  std::unordered_map<uint64_t, uint32_t> cellClusters;
+  std::vector<uint32_t> vertexClusters(positions.size());
+  std::vector<vec3f> clusterSums;
+  std::vector<int> clusterSizes;
+  for (size_t v = 0; v < positions.size(); ++v) {
+    const vec3f cell = ((positions[v] - origin) / cellSize).array().floor();
+    const uint64_t key = (uint64_t(cell[0]) << 42) | (uint64_t(cell[1]) << 21) |
+                         uint64_t(cell[2]);
+    auto inserted = cellClusters.emplace(key, clusterSums.size());
+    if (inserted.second) {
+      clusterSums.emplace_back(vec3f::Zero());
+      clusterSizes.push_back(0);
+    }
+    vertexClusters[v] = inserted.first->second;
+    clusterSums[vertexClusters[v]] += positions[v];
+    ++clusterSizes[vertexClusters[v]];
+  }
+
+  // each cluster is represented by its vertex closest to the cluster mean
+  std::vector<uint32_t> representatives(clusterSums.size());
+  std::vector<float> distances(clusterSums.size(),
+                               std::numeric_limits<float>::infinity());
+  for (size_t v = 0; v < positions.size(); ++v) {
+    const uint32_t c = vertexClusters[v];
+    const float distance =
+        (positions[v] - clusterSums[c] / clusterSizes[c]).squaredNorm();
+    if (distance < distances[c]) {
+      distances[c] = distance;
+      representatives[c] = v;
+    }
+  }
+
+  std::vector<std::array<uint32_t, 3>> triangles;
+  for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+    std::array<uint32_t, 3> t;
+    for (int k = 0; k < 3; ++k) {
+      t[k] = representatives[vertexClusters[indices[i + k]]];
+    }
+    if (t[0] == t[1] || t[1] == t[2] || t[2] == t[0]) {
+      continue;
+    }
+    // rotate the smallest index first, keeping the winding, so that copies of
+    // a triangle compare equal
+    std::rotate(t.begin(), std::min_element(t.begin(), t.end()), t.end());
+    triangles.push_back(t);
+  }
+  std::sort(triangles.begin(), triangles.end());
+  triangles.erase(std::unique(triangles.begin(), triangles.end()),
+                  triangles.end());
+
+  clustered.clear();
+  clustered.reserve(triangles.size() * 3);
+  for (const std::array<uint32_t, 3>& t : triangles) {
+    clustered.insert(clustered.end(), t.begin(), t.end());
+  }
+  return triangles.size();
+}
+}  // namespace
+
+MeshLOD simplifyMesh(const std::vector<vec3f>& positions,
+                     const std::vector<uint32_t>& indices,
+                     float targetRatio) {
+  MeshLOD lod;
+  const size_t numTriangles = indices.size() / 3;
+  const size_t targetTriangles = size_t(numTriangles * targetRatio);
+  if (targetTriangles >= numTriangles || positions.empty()) {
+    lod.indices = indices;
+    return lod;
+  }
+
+  box3f bounds;
+  for (const vec3f& position : positions) {
+    bounds.extend(position);
+  }
+  const float extent = bounds.sizes().maxCoeff();
+  if (!(extent > 0)) {
+    return lod;
+  }
+
+  // the number of triangles grows with the grid resolution, find the finest
+  // grid that meets the target; a single cell collapses every triangle
+  int lowerResolution = 1;
+  int upperResolution = maxGridResolution;
+  std::vector<uint32_t> clustered;
+  while (lowerResolution < upperResolution) {
+    const int middle = (lowerResolution + upperResolution + 1) / 2;
+    if (clusterMesh(positions, indices, bounds.min(), extent / middle,
+                    clustered) <= targetTriangles) {
+      lowerResolution = middle;
+    } else {
+      upperResolution = middle - 1;
+    }
+  }
+
+  const float cellSize = extent / lowerResolution;
+  clusterMesh(positions, indices, bounds.min(), cellSize, lod.indices);
+  // a vertex moves at most to the far corner of its cell
+  lod.error = cellSize * std::sqrt(3.0f);
+  return lod;
+}
+
+CollisionMesh simplifyCollisionMesh(const std::vector<vec3f>& positions,
+                                    const std::vector<uint32_t>& indices,
+                                    float maxError) {
+  CollisionMesh simplified;
+  if (positions.empty() || indices.size() < 3) {
+    return simplified;
+  }
+  box3f bounds;
+  for (const vec3f& position : positions) {
+    bounds.extend(position);
+  }
+  // a vertex moves at most to the far corner of its cell; the cells are
+  // numbered with 21 bits per axis
+  const float extent = bounds.sizes().maxCoeff();
+  const float cellSize = std::max(maxError / std::sqrt(3.0f),
+                                  extent / float((1 << 21) - 1));
+  std::vector<uint32_t> clustered;
+  clusterMesh(positions, indices, bounds.min(), cellSize, clustered);
+
+  // slivers have no area to collide with, but make the BVH and the
+  // narrowphase pay for their bounds
+  const float minDoubleArea = 1e-4f * cellSize * cellSize;
+  std::unordered_map<uint32_t, uint32_t> compacted;
+  for (size_t i = 0; i + 2 < clustered.size(); i += 3) {
+    const vec3f& a = positions[clustered[i]];
+    const vec3f& b = positions[clustered[i + 1]];
+    const vec3f& c = positions[clustered[i + 2]];
+    if ((b - a).cross(c - a).norm() < minDoubleArea) {
+      continue;
+    }
+    for (int k = 0; k < 3; ++k) {
+      auto inserted =
+          compacted.emplace(clustered[i + k], simplified.positions.size());
+      if (inserted.second) {
+        simplified.positions.push_back(positions[clustered[i + k]]);
+      }
+      simplified.indices.push_back(inserted.first->second);
+    }
+  }
+  return simplified;
+}
+
+std::string collisionMeshesFilename(const std::string& sceneFile) {
+  return io::cacheFilename(sceneFile + ".collision");
+}
+
+bool saveCollisionMeshes(const std::string& file,
+                         const std::vector<CollisionMesh>& meshes,
+                         const std::string& sourceFile) {
+  // two sections per mesh: positions, then indices
+  io::CacheWriter writer(collisionMeshesCacheKind, collisionMeshesCacheVersion,
+                         sourceFile);
+  for (const CollisionMesh& mesh : meshes) {
+    writer.addSection(mesh.positions);
+    writer.addSection(mesh.indices);
+  }
+  return writer.write(file);
+}
+
+bool loadCollisionMeshes(const std::string& file,
+                         const std::string& sourceFile,
+                         std::vector<CollisionMesh>& meshes) {
+  const io::CacheReader reader(file, collisionMeshesCacheKind,
+                               collisionMeshesCacheVersion, sourceFile);
+  if (!reader.isValid() || reader.getNumSections() % 2 != 0) {
+    return false;
+  }
+  meshes.resize(reader.getNumSections() / 2);
+  for (size_t i = 0; i < meshes.size(); ++i) {
+    if (!reader.readSection(2 * i, meshes[i].positions) ||
+        !reader.readSection(2 * i + 1, meshes[i].indices)) {
+      meshes.clear();
+      return false;
+    }
+  }
+  return true;
+}
+
+std::string meshLODsFilename(const std::string& sceneFile) {
+  return io::cacheFilename(sceneFile + ".lods");
+}
+
+bool saveMeshLODs(const std::string& file,
+                  const std::vector<std::vector<MeshLOD>>& meshLODs,
+                  const std::string& sourceFile) {
+  // the number of levels of each mesh, the errors of all levels, then a
+  // section of indices per level
+  std::vector<uint32_t> numLevels;
+  std::vector<float> errors;
+  for (const std::vector<MeshLOD>& lods : meshLODs) {
+    numLevels.push_back(lods.size());
+    for (const MeshLOD& lod : lods) {
+      errors.push_back(lod.error);
+    }
+  }
+  io::CacheWriter writer(meshLODsCacheKind, meshLODsCacheVersion, sourceFile);
+  writer.addSection(numLevels);
+  writer.addSection(errors);
+  for (const std::vector<MeshLOD>& lods : meshLODs) {
+    for (const MeshLOD& lod : lods) {
+      writer.addSection(lod.indices);
+    }
+  }
+  return writer.write(file);
+}
+
+bool loadMeshLODs(const std::string& file,
+                  const std::string& sourceFile,
+                  std::vector<std::vector<MeshLOD>>& meshLODs) {
+  const io::CacheReader reader(file, meshLODsCacheKind, meshLODsCacheVersion,
+                               sourceFile);
+  std::vector<uint32_t> numLevels;
+  std::vector<float> errors;
+  if (!reader.isValid() || !reader.readSection(0, numLevels) ||
+      !reader.readSection(1, errors) ||
+      reader.getNumSections() != 2 + errors.size()) {
+    return false;
+  }
+
+  meshLODs.assign(numLevels.size(), {});
+  size_t level = 0;
+  for (size_t i = 0; i < numLevels.size(); ++i) {
+    if (numLevels[i] > errors.size() - level) {
+      meshLODs.clear();
+      return false;
+    }
+    meshLODs[i].resize(numLevels[i]);
+    for (MeshLOD& lod : meshLODs[i]) {
+      if (!reader.readSection(2 + level, lod.indices)) {
+        meshLODs.clear();
+        return false;
+      }
+      lod.error = errors[level++];
+    }
+  }
+  return level == errors.size();
+}
+
+}  // namespace geo
+}  // namespace esp
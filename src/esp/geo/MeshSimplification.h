@@ -0,0 +1,84 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "esp/core/esp.h"
+
+namespace esp {
+namespace geo {
+
+//! Simplified level of detail of a triangle mesh. The indices refer to the
+//! vertices of the original mesh, so that a level can share its vertex data
+struct MeshLOD {
+  std::vector<uint32_t> indices;
+  //! upper bound on the distance a surface point moves, in mesh units
+  float error = 0;
+};
+
+// Simplify a triangle mesh to at most targetRatio of its triangles by vertex
+// clustering, in the spirit of meshoptimizer's meshopt_simplifySloppy: the
+// mesh bounds are divided into a grid of cubic cells, the vertices of each
+// cell are merged into the one closest to their mean, and the triangles that
+// collapse are dropped. The grid is the finest that meets targetRatio. Unlike
+// edge collapse this ignores topology and may close small holes and merge
+// nearby parts, which is invisible once a cell projects to about a pixel.
+MeshLOD simplifyMesh(const std::vector<vec3f>& positions,
+                     const std::vector<uint32_t>& indices,
+                     float targetRatio);
+
+//! Triangle mesh with vertices of its own, e.g. a simplified static collider
+struct CollisionMesh {
+  std::vector<vec3f> positions;
+  std::vector<uint32_t> indices;
+};
+
+// Simplify a static collision mesh by clustering its vertices into cubic
+// cells like simplifyMesh(), but of a fixed size such that no surface point
+// moves further than maxError, then clean it up: drop the triangles that
+// collapse to slivers or duplicate others, and keep only the vertices still
+// used. The fixed cell size keeps the openings wider than about two cells,
+// e.g. doors and passages, open; holes are never filled.
+CollisionMesh simplifyCollisionMesh(const std::vector<vec3f>& positions,
+                                    const std::vector<uint32_t>& indices,
+                                    float maxError);
+
+//! File the simplified collision meshes of a scene are stored in, next to the
+//! scene
+std::string collisionMeshesFilename(const std::string& sceneFile);
+
+//! Save the simplified collision mesh of each mesh of a scene, empty for
+//! meshes without one; sourceFile is the scene file they were made from
+bool saveCollisionMeshes(const std::string& file,
+                         const std::vector<CollisionMesh>& meshes,
+                         const std::string& sourceFile);
+
+//! Load collision meshes saved by saveCollisionMeshes(), false if the file is
+//! missing or was made from other contents of the scene file
+bool loadCollisionMeshes(const std::string& file,
+                         const std::string& sourceFile,
+                         std::vector<CollisionMesh>& meshes);
+
+//! File the levels of detail of the meshes of a scene are stored in, next to
+//! the scene
+std::string meshLODsFilename(const std::string& sceneFile);
+
+//! Save the levels of detail of each mesh of a scene, finest first;
+//! sourceFile is the scene file they were made from
+bool saveMeshLODs(const std::string& file,
+                  const std::vector<std::vector<MeshLOD>>& meshLODs,
+                  const std::string& sourceFile);
+
+//! Load levels of detail saved by saveMeshLODs(), false if the file is
+//! missing or was made from other contents of the scene file
+bool loadMeshLODs(const std::string& file,
+                  const std::string& sourceFile,
+                  std::vector<std::vector<MeshLOD>>& meshLODs);
+
+}  // namespace geo
+}  // namespace esp
@@ -128,11 +128,14 @@ OBB computeGravityAlignedMOBB(const vec3f& gravity,
            (upper_left - bottom_left).norm();
   };
 
-  std::vector<vec2f> in_plane_points;
-  for (const auto& pt : points) {
-    vec3f aligned_pt = align_gravity * pt;
-    in_plane_points.emplace_back(aligned_pt[0], aligned_pt[1]);
-  }
+  // vec2f and vec3f are unpadded, so the points can be projected as one
+  // matrix product
+  const Eigen::Map<const Eigen::Matrix<float, 3, Eigen::Dynamic>> world_points(
+      points.data()->data(), 3, points.size());
+  std::vector<vec2f> in_plane_points(points.size());
+  Eigen::Map<Eigen::Matrix<float, 2, Eigen::Dynamic>>(
+      in_plane_points.data()->data(), 2, points.size()) =
+      align_gravity.toRotationMatrix().topRows<2>() * world_points;
 
   const auto hull = convexHull2D(in_plane_points);
 
@@ -234,14 +237,24 @@ OBB computeGravityAlignedMOBB(const vec3f& gravity,
                             vec3f::UnitX()) *
       align_gravity;
 
-  box3f aabb;
-  aabb.setEmpty();
-  for (auto& pt : points) {
-    aabb.extend(T_w2b * pt);
-  }
+  const Eigen::Matrix<float, 3, Eigen::Dynamic> box_points =
+      T_w2b.toRotationMatrix() * world_points;
+  const box3f aabb(box_points.rowwise().minCoeff(),
+                   box_points.rowwise().maxCoeff());
 
   return OBB{aabb.center(), aabb.sizes(), T_w2b.inverse()};
 }
 
+std::vector<OBB> computeGravityAlignedMOBBBatch(
+    const vec3f& gravity,
+    const std::vector<std::vector<vec3f>>& pointSets,
+    int numThreads /* = 0 */) {
+  std::vector<OBB> obbs(pointSets.size());
+  parallelFor(pointSets.size(), numThreads, [&](size_t i) {
+    obbs[i] = computeGravityAlignedMOBB(gravity, pointSets[i]);
+  });
+  return obbs;
+}
+
 }  // namespace geo
 }  // namespace esp
@@ -74,5 +74,12 @@ inline std::ostream& operator<<(std::ostream& os, const OBB& obb) {
 OBB computeGravityAlignedMOBB(const vec3f& gravity,
                               const std::vector<vec3f>& points);
 
+// computeGravityAlignedMOBB() of each of pointSets, on up to numThreads
+// threads (0 for all threads of the shared pool)
+std::vector<OBB> computeGravityAlignedMOBBBatch(
+    const vec3f& gravity,
+    const std::vector<std::vector<vec3f>>& pointSets,
+    int numThreads = 0);
+
 }  // namespace geo
 }  // namespace esp
@@ -4,7 +4,9 @@
 
 #include "esp/geo/geo.h"
 
-#include <numeric>
+#include <algorithm>
+
+#include "esp/core/ThreadPool.h"
 
 namespace esp {
 namespace geo {
@@ -16,46 +18,51 @@ std::vector<vec2f> convexHull2D(const std::vector<vec2f>& points) {
     return (a(0) - o(0)) * (b(1) - o(1)) - (a(1) - o(1)) * (b(0) - o(0));
   };
 
-  // Sort indices of points lexicographically
-  std::vector<size_t> idx(points.size());
-  std::iota(idx.begin(), idx.end(), 0);
-  std::sort(
-      idx.begin(), idx.end(), [&points](const size_t& a, const size_t& b) {
-        return points[a](0) < points[b](0) ||
-               (points[a](0) == points[b](0) && points[a](1) < points[b](1));
-      });
+  // Sort a copy of the points lexicographically, which keeps the hull
+  // construction below on contiguous memory
+  std::vector<vec2f> sorted(points);
+  std::sort(sorted.begin(), sorted.end(), [](const vec2f& a, const vec2f& b) {
+    return a(0) < b(0) || (a(0) == b(0) && a(1) < b(1));
+  });
 
-  std::vector<size_t> hullIdx(2 * idx.size());
+  std::vector<vec2f> hull(2 * sorted.size());
 
   // Build lower hull
   int k = 0;
-  for (int i = 0; i < (int)idx.size(); ++i) {
-    while (k >= 2 && cross(points[hullIdx[k - 2]], points[hullIdx[k - 1]],
-                           points[idx[i]]) <= 0) {
+  for (int i = 0; i < (int)sorted.size(); ++i) {
+    while (k >= 2 && cross(hull[k - 2], hull[k - 1], sorted[i]) <= 0) {
       k--;
     }
 
-    hullIdx[k++] = idx[i];
+    hull[k++] = sorted[i];
   }
 
   // Build upper hull
-  for (int i = (int)idx.size() - 2, t = k + 1; i >= 0; i--) {
-    while (k >= t && cross(points[hullIdx[k - 2]], points[hullIdx[k - 1]],
-                           points[idx[i]]) <= 0) {
+  for (int i = (int)sorted.size() - 2, t = k + 1; i >= 0; i--) {
+    while (k >= t && cross(hull[k - 2], hull[k - 1], sorted[i]) <= 0) {
       k--;
     }
 
-    hullIdx[k++] = idx[i];
+    hull[k++] = sorted[i];
   }
 
-  hullIdx.resize(k - 1);
+  hull.resize(k - 1);
+  return hull;
+}
 
-  std::vector<vec2f> hull;
-  for (auto& ix : hullIdx) {
-    hull.emplace_back(points[ix]);
-  }
+std::vector<std::vector<vec2f>> convexHull2DBatch(
+    const std::vector<std::vector<vec2f>>& pointSets,
+    int numThreads /* = 0 */) {
+  std::vector<std::vector<vec2f>> hulls(pointSets.size());
+  parallelFor(pointSets.size(), numThreads,
+              [&](size_t i) { hulls[i] = convexHull2D(pointSets[i]); });
+  return hulls;
+}
 
-  return hull;
+void parallelFor(size_t count,
+                 int numThreads,
+                 const std::function<void(size_t)>& task) {
+  core::parallelFor(count, numThreads, task);
 }
 
 }  // namespace geo
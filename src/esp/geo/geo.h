@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include <functional>
 #include <vector>
 
 #include "esp/core/esp.h"
@@ -25,6 +26,19 @@ typedef Eigen::Transform<float, 3, Eigen::Affine, Eigen::DontAlign> Transform;
 // compute convex hull of 2D points and return as vector of vertices
 std::vector<vec2f> convexHull2D(const std::vector<vec2f>& points);
 
+// convexHull2D() of each of pointSets, on up to numThreads threads (0 for all
+// threads of the pool)
+std::vector<std::vector<vec2f>> convexHull2DBatch(
+    const std::vector<std::vector<vec2f>>& pointSets,
+    int numThreads = 0);
+
+// Run task(i) for i in [0, count) on up to numThreads threads of the shared
+// core::ThreadPool (0 for all of them), handing out one i at a time so that
+// uneven tasks balance
+void parallelFor(size_t count,
+                 int numThreads,
+                 const std::function<void(size_t)>& task);
+
 template <typename T>
 T clamp(const T& n, const T& low, const T& high) {
   return std::max(low, std::min(n, high));
@@ -0,0 +1,151 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#include "BatchSimulator.h"
+
+#include "esp/core/ThreadPool.h"
+#include "esp/gfx/Renderer.h"
+#include "esp/scene/SemanticScene.h"
+
+namespace esp {
+namespace gfx {
+
+BatchSimulator::BatchSimulator(const SimulatorConfiguration& cfg,
+                               int numEnvironments)
+    : Simulator() {
+  CHECK_GT(numEnvironments, 0);
+  environments_.resize(numEnvironments);
+  reconfigure(cfg);
+}
+
+BatchSimulator::~BatchSimulator() {
+  LOG(INFO) << "Deconstructing BatchSimulator";
+}
+
+void BatchSimulator::reconfigure(const SimulatorConfiguration& cfg) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  resourceManager_->setAssetCacheBudget(cfg.assetCacheBudget);
+  core::ThreadPool::setGlobalNumThreads(cfg.numThreads);
+  if (cfg == config_ && activeEnvironment_ != ID_UNDEFINED) {
+    resourceManager_->cancelPrefetches();
+    reset();
+    return;
+  }
+  config_ = cfg;
+
+  // one context and one renderer for all environments
+  renderer_ = nullptr;
+  if (config_.createRenderer && (!config_.lazyRenderer || context_)) {
+    initRenderer();
+  } else {
+    resourceManager_->setGpuEnabled(false);
+    resourceManager_->optimizeMeshes(config_.optimizeMeshes);
+  }
+
+  for (int iEnv = 0; iEnv < environments_.size(); ++iEnv) {
+    reconfigureEnvironment(iEnv, config_.scene);
+  }
+  resourceManager_->cancelPrefetches();
+  setActiveEnvironment(0);
+
+  reset();
+}
+
+void BatchSimulator::reconfigureEnvironment(
+    int envIndex,
+    const scene::SceneConfiguration& sceneConfig) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  Environment& env = getEnvironment(envIndex);
+  if (env.sceneID != ID_UNDEFINED && env.scene == sceneConfig) {
+    return;
+  }
+  env.scene = sceneConfig;
+  // ResourceManager keeps meshes and textures of files it has already loaded,
+  // so environments showing the same scene only instantiate new drawables
+  loadScene(sceneConfig, env.sceneID, env.semanticSceneID, env.semanticScene);
+
+  if (envIndex == activeEnvironment_) {
+    setActiveEnvironment(envIndex);
+  }
+}
+
+void BatchSimulator::setActiveEnvironment(int envIndex) {
+  const Environment& env = getEnvironment(envIndex);
+  activeEnvironment_ = envIndex;
+  activeSceneID_ = env.sceneID;
+  activeSemanticSceneID_ = env.semanticSceneID;
+  semanticScene_ = env.semanticScene;
+}
+
+BatchSimulator::Environment& BatchSimulator::getEnvironment(int envIndex) {
+  CHECK_GE(envIndex, 0);
+  CHECK_LT(envIndex, environments_.size());
+  return environments_[envIndex];
+}
+
+int BatchSimulator::getSceneID(int envIndex) {
+  return getEnvironment(envIndex).sceneID;
+}
+
+scene::SceneGraph& BatchSimulator::getSceneGraph(int envIndex) {
+  return sceneManager_.getSceneGraph(getEnvironment(envIndex).sceneID);
+}
+
+scene::SceneGraph& BatchSimulator::getSemanticSceneGraph(int envIndex) {
+  const int semanticSceneID = getEnvironment(envIndex).semanticSceneID;
+  CHECK_GE(semanticSceneID, 0);
+  loadSemanticMesh(semanticSceneID);
+  return sceneManager_.getSceneGraph(semanticSceneID);
+}
+
+std::shared_ptr<scene::SemanticScene> BatchSimulator::getSemanticScene(
+    int envIndex) {
+  return getEnvironment(envIndex).semanticScene;
+}
+
+void BatchSimulator::drawBatch(
+    const std::vector<sensor::Sensor*>& visualSensors,
+    const std::vector<int>& environmentIds) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  CHECK(getRenderer() != nullptr)
+      << "BatchSimulator was created without renderer";
+  CHECK_EQ(visualSensors.size(), environmentIds.size());
+
+  // the sensors pick their scene graph (e.g., semantic or not) from the active
+  // environment, so switch to each sensor's environment while collecting them
+  const int previousEnvironment = activeEnvironment_;
+  std::vector<scene::SceneGraph*> sceneGraphs(visualSensors.size(), nullptr);
+  for (int iSensor = 0; iSensor < visualSensors.size(); ++iSensor) {
+    setActiveEnvironment(environmentIds[iSensor]);
+    sceneGraphs[iSensor] =
+        visualSensors[iSensor]->getObservedSceneGraph(*this);
+    CHECK(sceneGraphs[iSensor] != nullptr)
+        << "Sensor " << iSensor << " has nothing to render";
+  }
+  setActiveEnvironment(previousEnvironment);
+
+  renderer_->drawBatch(visualSensors, sceneGraphs);
+}
+
+int BatchSimulator::getBatchObservations(
+    const std::vector<sensor::Sensor*>& visualSensors,
+    const std::vector<int>& environmentIds,
+    std::vector<sensor::Observation>& observations) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  drawBatch(visualSensors, environmentIds);
+
+  observations.clear();
+  observations.resize(visualSensors.size());
+  int numObservations = 0;
+  for (int iSensor = 0; iSensor < visualSensors.size(); ++iSensor) {
+    if (visualSensors[iSensor]->readBatchObservation(*this, iSensor,
+                                                     observations[iSensor])) {
+      ++numObservations;
+    }
+  }
+  return numObservations;
+}
+
+}  // namespace gfx
+}  // namespace esp
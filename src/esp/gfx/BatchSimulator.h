@@ -0,0 +1,83 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#pragma once
+
+#include <vector>
+
+#include "esp/gfx/Simulator.h"
+#include "esp/sensor/Sensor.h"
+
+namespace esp {
+namespace gfx {
+
+// Runs several environments in one simulator: all of them share a single GL
+// context, Renderer and ResourceManager, so a mesh used by more than one
+// environment lives in VRAM only once. Every environment has its own scene
+// graph (and semantic scene graph) in the shared SceneManager.
+// The Simulator interface (getActiveSceneGraph() etc.) refers to the active
+// environment, see setActiveEnvironment(). With physics enabled, every
+// environment has its own world in the physics manager and the physics
+// functions of Simulator take the scene ID of the environment, see
+// getSceneID(); stepWorld() steps the worlds of all environments in parallel.
+// Agents that act in the environments are added by
+// sim::BatchSimulatorWithAgents, which steps all environments in one call.
+class BatchSimulator : public Simulator {
+ public:
+  // create numEnvironments environments, all loading cfg.scene
+  BatchSimulator(const SimulatorConfiguration& cfg, int numEnvironments);
+  virtual ~BatchSimulator();
+
+  // reload every environment with cfg.scene
+  virtual void reconfigure(const SimulatorConfiguration& cfg) override;
+
+  // load a different scene into a single environment; the other environments
+  // are left untouched and already loaded meshes are not loaded again
+  virtual void reconfigureEnvironment(
+      int envIndex,
+      const scene::SceneConfiguration& sceneConfig);
+
+  int getNumEnvironments() const { return environments_.size(); }
+
+  void setActiveEnvironment(int envIndex);
+  int getActiveEnvironment() const { return activeEnvironment_; }
+
+  // ID of the scene graph of an environment, the sceneID of the physics
+  // functions
+  int getSceneID(int envIndex);
+  scene::SceneGraph& getSceneGraph(int envIndex);
+  scene::SceneGraph& getSemanticSceneGraph(int envIndex);
+  using Simulator::getSemanticScene;
+  std::shared_ptr<scene::SemanticScene> getSemanticScene(int envIndex);
+
+  // render visual sensors of any number of environments in a single batched
+  // pass, visualSensors[i] observing environment environmentIds[i]; read the
+  // results back with the readBatchFrame* functions of getRenderer()
+  void drawBatch(const std::vector<sensor::Sensor*>& visualSensors,
+                 const std::vector<int>& environmentIds);
+
+  // drawBatch() followed by reading observations[i] of every visualSensors[i];
+  // returns the number of observations read
+  int getBatchObservations(const std::vector<sensor::Sensor*>& visualSensors,
+                           const std::vector<int>& environmentIds,
+                           std::vector<sensor::Observation>& observations);
+
+ protected:
+  struct Environment {
+    scene::SceneConfiguration scene;
+    int sceneID = ID_UNDEFINED;
+    int semanticSceneID = ID_UNDEFINED;
+    std::shared_ptr<scene::SemanticScene> semanticScene = nullptr;
+  };
+
+  Environment& getEnvironment(int envIndex);
+
+  std::vector<Environment> environments_;
+  int activeEnvironment_ = ID_UNDEFINED;
+
+  ESP_SMART_POINTERS(BatchSimulator)
+};
+
+}  // namespace gfx
+}  // namespace esp
@@ -0,0 +1,69 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#include "CudaInterop.h"
+
+// Magnum's GL headers must come before cuda_gl_interop.h so that it does not
+// pull in the system GL headers
+#include <Magnum/GL/Buffer.h>
+
+#include <cuda_gl_interop.h>
+#include <cuda_runtime_api.h>
+
+#include "esp/core/esp.h"
+
+#define CHECK_CUDA_ERROR(call)                                        \
+  do {                                                                \
+    const cudaError_t err = (call);                                   \
+    CHECK(err == cudaSuccess) << "CUDA error: " << cudaGetErrorString(err); \
+  } while (0)
+
+namespace esp {
+namespace gfx {
+
+CudaGLBuffer::~CudaGLBuffer() {
+  unregisterBuffer();
+}
+
+void CudaGLBuffer::registerBuffer(Magnum::GL::Buffer& buffer,
+                                  std::size_t dataSize) {
+  if (resource_ != nullptr && bufferId_ == buffer.id() &&
+      dataSize_ == dataSize) {
+    return;
+  }
+  // the buffer storage was reallocated, the old registration is stale
+  unregisterBuffer();
+  CHECK_CUDA_ERROR(cudaGraphicsGLRegisterBuffer(
+      &resource_, buffer.id(), cudaGraphicsRegisterFlagsReadOnly));
+  bufferId_ = buffer.id();
+  dataSize_ = dataSize;
+}
+
+void CudaGLBuffer::unregisterBuffer() {
+  if (resource_ != nullptr) {
+    CHECK_CUDA_ERROR(cudaGraphicsUnregisterResource(resource_));
+    resource_ = nullptr;
+  }
+  bufferId_ = 0;
+  dataSize_ = 0;
+}
+
+void CudaGLBuffer::copyToDevice(void* devPtr, std::size_t sizeInBytes) {
+  CHECK(resource_ != nullptr) << "No buffer registered with CUDA";
+  CHECK_LE(sizeInBytes, dataSize_);
+
+  // mapping synchronizes with the GL commands that wrote the buffer
+  CHECK_CUDA_ERROR(cudaGraphicsMapResources(1, &resource_));
+  void* mappedPtr = nullptr;
+  std::size_t mappedSize = 0;
+  CHECK_CUDA_ERROR(
+      cudaGraphicsResourceGetMappedPointer(&mappedPtr, &mappedSize, resource_));
+  CHECK_LE(sizeInBytes, mappedSize);
+  CHECK_CUDA_ERROR(
+      cudaMemcpy(devPtr, mappedPtr, sizeInBytes, cudaMemcpyDeviceToDevice));
+  CHECK_CUDA_ERROR(cudaGraphicsUnmapResources(1, &resource_));
+}
+
+}  // namespace gfx
+}  // namespace esp
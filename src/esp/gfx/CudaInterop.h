@@ -0,0 +1,48 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#pragma once
+
+// Only compiled when building with BUILD_WITH_CUDA
+
+#include <cstddef>
+
+struct cudaGraphicsResource;
+
+namespace Magnum {
+namespace GL {
+class Buffer;
+}
+}  // namespace Magnum
+
+namespace esp {
+namespace gfx {
+
+// An OpenGL buffer registered with CUDA so that its contents can be copied to
+// device memory without a round trip through host memory
+class CudaGLBuffer {
+ public:
+  CudaGLBuffer() = default;
+  ~CudaGLBuffer();
+
+  CudaGLBuffer(const CudaGLBuffer&) = delete;
+  CudaGLBuffer& operator=(const CudaGLBuffer&) = delete;
+
+  // register buffer with CUDA; registration is kept as long as the buffer id
+  // and its data size do not change, so calling this every frame is cheap
+  void registerBuffer(Magnum::GL::Buffer& buffer, std::size_t dataSize);
+
+  void unregisterBuffer();
+
+  // copy the first sizeInBytes of the registered buffer to device memory
+  void copyToDevice(void* devPtr, std::size_t sizeInBytes);
+
+ private:
+  cudaGraphicsResource* resource_ = nullptr;
+  unsigned int bufferId_ = 0;
+  std::size_t dataSize_ = 0;
+};
+
+}  // namespace gfx
+}  // namespace esp
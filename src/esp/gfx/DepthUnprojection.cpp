@@ -13,6 +13,16 @@
 #include <Magnum/Math/Functions.h>
 #include <Magnum/Math/Matrix4.h>
 
+#if defined(CORRADE_TARGET_X86) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#elif defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#endif
+
+#include "ShaderCache.h"
+
 namespace Cr = Corrade;
 namespace Mn = Magnum;
 
@@ -40,25 +50,37 @@ DepthShader::DepthShader(Flags flags) : flags_{flags} {
   Mn::GL::Version glVersion = Mn::GL::Version::GL410;
 #endif
 
-  Mn::GL::Shader vert{glVersion, Mn::GL::Shader::Type::Vertex};
-  Mn::GL::Shader frag{glVersion, Mn::GL::Shader::Type::Fragment};
+  std::string vertSource;
+  std::string fragSource;
 
   if (flags & Flag::UnprojectExistingDepth) {
-    vert.addSource("#define UNPROJECT_EXISTING_DEPTH\n");
-    frag.addSource("#define UNPROJECT_EXISTING_DEPTH\n");
+    vertSource += "#define UNPROJECT_EXISTING_DEPTH\n";
+    fragSource += "#define UNPROJECT_EXISTING_DEPTH\n";
   }
 
   if (flags & Flag::NoFarPlanePatching)
-    frag.addSource("#define NO_FAR_PLANE_PATCHING\n");
+    fragSource += "#define NO_FAR_PLANE_PATCHING\n";
 
-  vert.addSource(rs.get("depth.vert"));
-  frag.addSource(rs.get("depth.frag"));
+  vertSource += rs.get("depth.vert");
+  fragSource += rs.get("depth.frag");
+  const std::string binaryKey =
+      programBinaryKey("depth", {vertSource, fragSource});
 
-  CORRADE_INTERNAL_ASSERT_OUTPUT(Mn::GL::Shader::compile({vert, frag}));
+  if (!loadProgramBinary(*this, binaryKey)) {
+    Mn::GL::Shader vert{glVersion, Mn::GL::Shader::Type::Vertex};
+    Mn::GL::Shader frag{glVersion, Mn::GL::Shader::Type::Fragment};
 
-  attachShaders({vert, frag});
+    vert.addSource(vertSource);
+    frag.addSource(fragSource);
 
-  CORRADE_INTERNAL_ASSERT_OUTPUT(link());
+    CORRADE_INTERNAL_ASSERT_OUTPUT(Mn::GL::Shader::compile({vert, frag}));
+
+    attachShaders({vert, frag});
+
+    prepareProgramBinary(*this);
+    CORRADE_INTERNAL_ASSERT_OUTPUT(link());
+    saveProgramBinary(*this, binaryKey);
+  }
 
   if (flags & Flag::UnprojectExistingDepth) {
     projectionMatrixOrDepthUnprojectionUniform_ =
@@ -87,6 +109,13 @@ DepthShader& DepthShader::setProjectionMatrix(const Mn::Matrix4& matrix) {
   return *this;
 }
 
+DepthShader& DepthShader::setDepthUnprojection(
+    const Mn::Vector2& unprojection) {
+  CORRADE_INTERNAL_ASSERT(flags_ & Flag::UnprojectExistingDepth);
+  setUniform(projectionMatrixOrDepthUnprojectionUniform_, unprojection);
+  return *this;
+}
+
 DepthShader& DepthShader::bindDepthTexture(Mn::GL::Texture2D& texture) {
   texture.bind(DepthTextureUnit);
   return *this;
@@ -97,27 +126,143 @@ Mn::Vector2 calculateDepthUnprojection(const Mn::Matrix4& projectionMatrix) {
          0.5f;
 }
 
-/* Clang doesn't have target_clones yet: https://reviews.llvm.org/D51650 */
-#if defined(CORRADE_TARGET_X86) && defined(__GNUC__) && __GNUC__ >= 6
-__attribute__((target_clones("default", "sse4.2", "avx2")))
-#endif
-void unprojectDepth(const Mn::Vector2& unprojection,
-                    Cr::Containers::ArrayView<Mn::Float> depth) {
+void unprojectDepthScalar(const Mn::Vector2& unprojection,
+                          Cr::Containers::ArrayView<Mn::Float> depth) {
   for (Mn::Float& d : depth) {
-    d = unprojection[1] / (d + unprojection[0]);
+    /* We can afford using == for comparison as 1.0f has an exact
+       representation and the depth was cleared to exactly this value. The
+       select compiles to a blend, not a branch. */
+    d = d == 1.0f ? 0.0f : unprojection[1] / (d + unprojection[0]);
   }
+}
 
-  /* Change pixels on the far plane to be 0. Done in a separate loop to allow
-     the optimizer to vectorize the above better.  */
-  const Mn::Float farDepth = unprojection[1] / (1.0f + unprojection[0]);
-  for (Mn::Float& d : depth) {
-    /* We can afford using == for comparison as 1.0f has an exact
-       representation, the depth was cleared to exactly this value and the
-       calculation is done exactly the same way in both cases -- thus the
-       result should be bit-exact. */
-    if (d == farDepth)
-      d = 0.0f;
+namespace {
+
+using UnprojectDepthFn = void (*)(const Mn::Vector2&,
+                                  Cr::Containers::ArrayView<Mn::Float>);
+
+/* All SIMD variants patch the far plane by masking the result with a
+   depth != 1.0 comparison, so there are no branches in the inner loop. The
+   remainder that doesn't fill a whole vector goes through the scalar code,
+   which gives bit-identical results as IEEE division is exact-rounded. */
+#if defined(CORRADE_TARGET_X86) && (defined(__GNUC__) || defined(__clang__))
+#define ESP_UNPROJECT_DEPTH_X86
+
+__attribute__((target("sse2"))) void unprojectDepthSse2(
+    const Mn::Vector2& unprojection,
+    Cr::Containers::ArrayView<Mn::Float> depth) {
+  const __m128 a = _mm_set1_ps(unprojection[0]);
+  const __m128 b = _mm_set1_ps(unprojection[1]);
+  const __m128 one = _mm_set1_ps(1.0f);
+  Mn::Float* data = depth.data();
+  const std::size_t vectorEnd = depth.size() & ~std::size_t(3);
+  for (std::size_t i = 0; i != vectorEnd; i += 4) {
+    const __m128 d = _mm_loadu_ps(data + i);
+    const __m128 linear = _mm_div_ps(b, _mm_add_ps(d, a));
+    _mm_storeu_ps(data + i, _mm_and_ps(linear, _mm_cmpneq_ps(d, one)));
+  }
+  unprojectDepthScalar(unprojection, depth.slice(vectorEnd, depth.size()));
+}
+
+__attribute__((target("avx2"))) void unprojectDepthAvx2(
+    const Mn::Vector2& unprojection,
+    Cr::Containers::ArrayView<Mn::Float> depth) {
+  const __m256 a = _mm256_set1_ps(unprojection[0]);
+  const __m256 b = _mm256_set1_ps(unprojection[1]);
+  const __m256 one = _mm256_set1_ps(1.0f);
+  Mn::Float* data = depth.data();
+  const std::size_t vectorEnd = depth.size() & ~std::size_t(7);
+  for (std::size_t i = 0; i != vectorEnd; i += 8) {
+    const __m256 d = _mm256_loadu_ps(data + i);
+    const __m256 linear = _mm256_div_ps(b, _mm256_add_ps(d, a));
+    const __m256 notFar = _mm256_cmp_ps(d, one, _CMP_NEQ_UQ);
+    _mm256_storeu_ps(data + i, _mm256_and_ps(linear, notFar));
   }
+  unprojectDepthScalar(unprojection, depth.slice(vectorEnd, depth.size()));
+}
+#endif
+
+/* AArch64 only, ARMv7 NEON has no vector division and the reciprocal
+   estimate would not match the scalar results */
+#if defined(__aarch64__)
+#define ESP_UNPROJECT_DEPTH_NEON
+
+void unprojectDepthNeon(const Mn::Vector2& unprojection,
+                        Cr::Containers::ArrayView<Mn::Float> depth) {
+  const float32x4_t a = vdupq_n_f32(unprojection[0]);
+  const float32x4_t b = vdupq_n_f32(unprojection[1]);
+  const float32x4_t one = vdupq_n_f32(1.0f);
+  Mn::Float* data = depth.data();
+  const std::size_t vectorEnd = depth.size() & ~std::size_t(3);
+  for (std::size_t i = 0; i != vectorEnd; i += 4) {
+    const float32x4_t d = vld1q_f32(data + i);
+    const float32x4_t linear = vdivq_f32(b, vaddq_f32(d, a));
+    /* bic clears the lanes where depth == 1.0 */
+    const uint32x4_t far = vceqq_f32(d, one);
+    vst1q_f32(data + i, vreinterpretq_f32_u32(
+                            vbicq_u32(vreinterpretq_u32_f32(linear), far)));
+  }
+  unprojectDepthScalar(unprojection, depth.slice(vectorEnd, depth.size()));
+}
+#endif
+
+/* WebAssembly has no runtime feature detection, so this is compiled in when
+   building with -msimd128 (BUILD_WEB_THREADS) and taken unconditionally */
+#if defined(__wasm_simd128__)
+#define ESP_UNPROJECT_DEPTH_WASM_SIMD
+
+void unprojectDepthWasmSimd(const Mn::Vector2& unprojection,
+                            Cr::Containers::ArrayView<Mn::Float> depth) {
+  const v128_t a = wasm_f32x4_splat(unprojection[0]);
+  const v128_t b = wasm_f32x4_splat(unprojection[1]);
+  const v128_t one = wasm_f32x4_splat(1.0f);
+  Mn::Float* data = depth.data();
+  const std::size_t vectorEnd = depth.size() & ~std::size_t(3);
+  for (std::size_t i = 0; i != vectorEnd; i += 4) {
+    const v128_t d = wasm_v128_load(data + i);
+    const v128_t linear = wasm_f32x4_div(b, wasm_f32x4_add(d, a));
+    wasm_v128_store(data + i, wasm_v128_and(linear, wasm_f32x4_ne(d, one)));
+  }
+  unprojectDepthScalar(unprojection, depth.slice(vectorEnd, depth.size()));
+}
+#endif
+
+struct UnprojectDepthImplementation {
+  const char* name;
+  UnprojectDepthFn fn;
+};
+
+UnprojectDepthImplementation selectUnprojectDepthImplementation() {
+#ifdef ESP_UNPROJECT_DEPTH_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
+    return {"avx2", unprojectDepthAvx2};
+  if (__builtin_cpu_supports("sse2"))
+    return {"sse2", unprojectDepthSse2};
+#elif defined(ESP_UNPROJECT_DEPTH_NEON)
+  return {"neon", unprojectDepthNeon};
+#elif defined(ESP_UNPROJECT_DEPTH_WASM_SIMD)
+  return {"wasm-simd128", unprojectDepthWasmSimd};
+#endif
+  return {"scalar", unprojectDepthScalar};
+}
+
+/* Picked once, on first use */
+const UnprojectDepthImplementation& unprojectDepthImplementation() {
+  static const UnprojectDepthImplementation implementation =
+      selectUnprojectDepthImplementation();
+  return implementation;
+}
+
+}  // namespace
+
+const char* unprojectDepthImplementationName() {
+  return unprojectDepthImplementation().name;
+}
+
+void unprojectDepth(const Mn::Vector2& unprojection,
+                    Cr::Containers::ArrayView<Mn::Float> depth) {
+  unprojectDepthImplementation().fn(unprojection, depth);
 }
 
 }  // namespace gfx
@@ -24,7 +24,9 @@ class DepthShader : public Magnum::GL::AbstractShaderProgram {
      * of rendering particular polygons bind a depth texture with
      * @ref bindDepthTexture(). The shader will then render a full-screen
      * triangle and unprojects the depth using an inverse of the matrix
-     * passed in @ref setProjectionMatrix().
+     * passed in @ref setProjectionMatrix(). The depth texture is fetched at
+     * the fragment position, so restricting the viewport unprojects only
+     * that region of a texture of the same size as the framebuffer.
      */
     UnprojectExistingDepth = 1 << 0,
 
@@ -57,6 +59,16 @@ class DepthShader : public Magnum::GL::AbstractShaderProgram {
    */
   DepthShader& setProjectionMatrix(const Magnum::Matrix4& matrix);
 
+  /**
+   * @brief Set depth unprojection coefficients directly
+   * @return Reference to self (for method chaining)
+   *
+   * Equivalent to @ref setProjectionMatrix() with a matrix the coefficients
+   * were calculated from using @ref calculateDepthUnprojection(). Expects
+   * that @ref Flag::UnprojectExistingDepth is set.
+   */
+  DepthShader& setDepthUnprojection(const Magnum::Vector2& unprojection);
+
   /**
    * @brief Bind depth texture
    * @return Reference to self (for method chaining)
@@ -133,9 +145,32 @@ See @ref calculateDepthUnprojection() for the full algorithm explanation.
 Additionally to applying that calculation, if the input depth is at the far
 plane (of value @cpp 1.0f @ce), it's set to @cpp 0.0f @ce on output as
 consumers expect zeros for things that are too far.
+
+Dispatches at runtime to an AVX2, SSE2 or NEON implementation, depending on
+what the CPU supports, falling back to @ref unprojectDepthScalar(). WebAssembly
+builds with SIMD enabled always use WebAssembly SIMD. All implementations give
+bit-identical results.
+@see @ref unprojectDepthImplementationName()
 */
 void unprojectDepth(const Magnum::Vector2& unprojection,
                     Corrade::Containers::ArrayView<Magnum::Float> depth);
 
+/**
+@brief Scalar reference implementation of @ref unprojectDepth()
+
+Used for the remainder of the SIMD implementations and as a baseline for
+testing and benchmarking.
+*/
+void unprojectDepthScalar(const Magnum::Vector2& unprojection,
+                          Corrade::Containers::ArrayView<Magnum::Float> depth);
+
+/**
+@brief Name of the implementation @ref unprojectDepth() dispatches to
+
+One of @cpp "avx2" @ce, @cpp "sse2" @ce, @cpp "neon" @ce,
+@cpp "wasm-simd128" @ce or @cpp "scalar" @ce.
+*/
+const char* unprojectDepthImplementationName();
+
 }  // namespace gfx
 }  // namespace esp
@@ -4,11 +4,19 @@
 
 #include "Drawable.h"
 
+#include <cmath>
+
+#include <Magnum/Shaders/Flat.h>
+
 #include "esp/scene/SceneNode.h"
 
 namespace esp {
 namespace gfx {
 
+namespace {
+float lodPixelError = 1.0f;
+}  // namespace
+
 Drawable::Drawable(scene::SceneNode& node,
                    Magnum::GL::AbstractShaderProgram& shader,
                    Magnum::GL::Mesh& mesh,
@@ -18,5 +26,55 @@ Drawable::Drawable(scene::SceneNode& node,
       shader_(shader),
       mesh_(mesh) {}
 
+void Drawable::drawDepth(const Magnum::Matrix4& transformationMatrix,
+                         Magnum::SceneGraph::Camera3D& camera,
+                         Magnum::Shaders::Flat3D& shader) {
+  shader.setTransformationProjectionMatrix(camera.projectionMatrix() *
+                                           transformationMatrix);
+  getLODMesh(transformationMatrix, camera).draw(shader);
+}
+
+void Drawable::setLODPixelError(float pixels) {
+  lodPixelError = pixels;
+}
+
+float Drawable::getLODPixelError() {
+  return lodPixelError;
+}
+
+Magnum::GL::Mesh& Drawable::getLODMesh(
+    const Magnum::Matrix4& transformationMatrix,
+    Magnum::SceneGraph::Camera3D& camera) {
+  if (lods_.empty() || !localBoundingBox_ || !(lodPixelError > 0)) {
+    return mesh_;
+  }
+
+  // pixels per unit of the node frame at the point of the bounding box
+  // closest to the camera, bounded by the bounding sphere
+  const Magnum::Matrix4& projection = camera.projectionMatrix();
+  const float scale = std::sqrt(transformationMatrix.scalingSquared().max());
+  float pixelsPerUnit = scale * projection[1][1] * camera.viewport().y() / 2;
+  // perspective projections have w = -z, orthographic ones w = 1
+  if (projection[2][3] != 0) {
+    const Magnum::Vector3 center =
+        transformationMatrix.transformPoint(localBoundingBox_->center());
+    const float distance =
+        center.length() - scale * localBoundingBox_->size().length() / 2;
+    if (!(distance > 0)) {
+      return mesh_;
+    }
+    pixelsPerUnit /= distance;
+  }
+
+  Magnum::GL::Mesh* mesh = &mesh_;
+  for (const LOD& lod : lods_) {
+    if (lod.error * pixelsPerUnit >= lodPixelError) {
+      break;
+    }
+    mesh = lod.mesh;
+  }
+  return *mesh;
+}
+
 }  // namespace gfx
 }  // namespace esp
@@ -4,6 +4,13 @@
 
 #pragma once
 
+#include <vector>
+
+#include <Corrade/Containers/Optional.h>
+#include <Magnum/Math/Color.h>
+#include <Magnum/Math/Range.h>
+#include <Magnum/Shaders/Shaders.h>
+
 #include "esp/core/esp.h"
 #include "magnum.h"
 
@@ -13,6 +20,16 @@ class SceneNode;
 }
 namespace gfx {
 
+//! GL state left by the drawables drawn before, so that the next one can skip
+//! setting it again; see RenderQueue. A drawable drawing with another shader
+//! than state.shader starts from a cleared state
+struct DrawState {
+  Magnum::GL::AbstractShaderProgram* shader = nullptr;
+  //! texture last bound by a drawable of shader
+  Magnum::GL::AbstractTexture* texture = nullptr;
+  Corrade::Containers::Optional<Magnum::Color4> color;
+};
+
 class Drawable : public Magnum::SceneGraph::Drawable3D {
  public:
   Drawable(scene::SceneNode& node,
@@ -23,15 +40,75 @@ class Drawable : public Magnum::SceneGraph::Drawable3D {
 
   virtual scene::SceneNode& getSceneNode() { return node_; }
 
+  //! Bounding box of the mesh in the frame of the node, used for frustum
+  //! culling. Drawables without one are never culled
+  void setLocalBoundingBox(const Magnum::Range3D& box) {
+    localBoundingBox_ = box;
+  }
+  const Corrade::Containers::Optional<Magnum::Range3D>& getLocalBoundingBox()
+      const {
+    return localBoundingBox_;
+  }
+
+  //! Add a coarser level of detail of the mesh, drawn instead of it when
+  //! error, the most its surface deviates from the mesh in the frame of the
+  //! node, projects to less than getLODPixelError() pixels. Levels are added
+  //! finest first. Needs a local bounding box
+  void addLOD(Magnum::GL::Mesh& mesh, float error) {
+    lods_.push_back({&mesh, error});
+  }
+
+  // Screen-space error in pixels that levels of detail may show (default 1),
+  // 0 always draws the full meshes. Shared by the drawables of all renderers
+  static void setLODPixelError(float pixels);
+
+  static float getLODPixelError();
+
+  //! Program draw() uses; drawables are sorted by it
+  virtual Magnum::GL::AbstractShaderProgram& getShader() { return shader_; }
+  Magnum::GL::Mesh& getMesh() { return mesh_; }
+  //! Texture bound by draw(), if any; drawables are sorted by it
+  virtual Magnum::GL::AbstractTexture* getTexture() { return nullptr; }
+
+  //! Draw only the depth of the mesh with shader, which has no outputs other
+  //! than the position; the depth-only pass of depth sensors draws all
+  //! drawables with it. The default draws the mesh as positioned by the
+  //! node, drawables that position their vertices otherwise override it
+  virtual void drawDepth(const Magnum::Matrix4& transformationMatrix,
+                         Magnum::SceneGraph::Camera3D& camera,
+                         Magnum::Shaders::Flat3D& shader);
+
+  //! Draw like draw(transformationMatrix, camera), but skip the uniforms and
+  //! bindings state says are set already, and update state to what is set
+  //! after the draw. The default draws as usual and clears state
+  virtual void draw(const Magnum::Matrix4& transformationMatrix,
+                    Magnum::SceneGraph::Camera3D& camera,
+                    DrawState& state) {
+    draw(transformationMatrix, camera);
+    state = DrawState{};
+  }
+
  protected:
   // Each derived drawable class needs to implement this draw() function. It's
   // nothing more than setting up shader parameters and drawing the mesh.
   virtual void draw(const Magnum::Matrix4& transformationMatrix,
                     Magnum::SceneGraph::Camera3D& camera) = 0;
 
+  //! Mesh to draw at transformationMatrix: the coarsest level of detail whose
+  //! error projects to less than getLODPixelError(), or the full mesh
+  Magnum::GL::Mesh& getLODMesh(const Magnum::Matrix4& transformationMatrix,
+                               Magnum::SceneGraph::Camera3D& camera);
+
   scene::SceneNode& node_;
   Magnum::GL::AbstractShaderProgram& shader_;
   Magnum::GL::Mesh& mesh_;
+  Corrade::Containers::Optional<Magnum::Range3D> localBoundingBox_;
+
+  struct LOD {
+    Magnum::GL::Mesh* mesh;
+    float error;
+  };
+  std::vector<LOD> lods_;
 };
 
 }  // namespace gfx
@@ -0,0 +1,131 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#include "DrawableBVH.h"
+
+#include <cmath>
+
+#include <Magnum/EigenIntegration/Integration.h>
+#include <Magnum/Math/Intersection.h>
+#include <Magnum/Math/Matrix4.h>
+
+#include "Drawable.h"
+
+namespace Mn = Magnum;
+
+namespace esp {
+namespace gfx {
+
+namespace {
+// Axis-aligned box containing box transformed by the affine transformation
+Mn::Range3D transformBox(const Mn::Matrix4& transformation,
+                         const Mn::Range3D& box) {
+  const Mn::Vector3 center = transformation.transformPoint(box.center());
+  const Mn::Vector3 halfSize = box.size() * 0.5f;
+  Mn::Vector3 extent;
+  for (int i = 0; i < 3; ++i) {
+    extent[i] = std::abs(transformation[0][i]) * halfSize[0] +
+                std::abs(transformation[1][i]) * halfSize[1] +
+                std::abs(transformation[2][i]) * halfSize[2];
+  }
+  return {center - extent, center + extent};
+}
+}  // namespace
+
+void DrawableBVH::update(MagnumDrawableGroup& drawables) {
+  bool changed = drawables.size() != drawables_.size();
+  drawables_.resize(drawables.size(), nullptr);
+  boxes_.resize(drawables.size());
+
+  // check all dirty flags before cleaning any, a node may have several
+  // drawables
+  std::vector<char> dirty(drawables.size(), false);
+  for (size_t i = 0; i < drawables.size(); ++i) {
+    MagnumDrawable* drawable = &drawables[i];
+    if (drawables_[i] != drawable || drawable->object().isDirty()) {
+      drawables_[i] = drawable;
+      dirty[i] = changed = true;
+    }
+  }
+  if (!changed) {
+    return;
+  }
+  ++revision_;
+
+  for (size_t i = 0; i < drawables_.size(); ++i) {
+    const Drawable* drawable = dynamic_cast<const Drawable*>(drawables_[i]);
+    if (dirty[i] && drawable && drawable->getLocalBoundingBox()) {
+      boxes_[i] =
+          transformBox(drawables_[i]->object().absoluteTransformationMatrix(),
+                       *drawable->getLocalBoundingBox());
+    }
+  }
+  for (size_t i = 0; i < drawables_.size(); ++i) {
+    if (dirty[i]) {
+      drawables_[i]->object().setClean();
+    }
+  }
+
+  // the hierarchy leaves out the empty boxes of the unbounded drawables
+  std::vector<box3f> boxes(drawables_.size());
+  unbounded_.clear();
+  for (size_t i = 0; i < drawables_.size(); ++i) {
+    const Drawable* drawable = dynamic_cast<const Drawable*>(drawables_[i]);
+    if (drawable && drawable->getLocalBoundingBox()) {
+      boxes[i] = box3f(Mn::EigenIntegration::cast<vec3f>(boxes_[i].min()),
+                       Mn::EigenIntegration::cast<vec3f>(boxes_[i].max()));
+    } else {
+      unbounded_.push_back(drawables_[i]);
+    }
+  }
+  bvh_.build(boxes);
+}
+
+void DrawableBVH::cull(const Mn::Frustum& frustum,
+                       std::vector<MagnumDrawable*>& visible) const {
+  visible.insert(visible.end(), unbounded_.begin(), unbounded_.end());
+  bvh_.traverse(
+      [&frustum](const box3f& box) {
+        return Mn::Math::Intersection::rangeFrustum(
+            Mn::Range3D{Mn::Vector3{box.min()}, Mn::Vector3{box.max()}},
+            frustum);
+      },
+      [&](int i) {
+        if (Mn::Math::Intersection::rangeFrustum(boxes_[i], frustum)) {
+          visible.push_back(drawables_[i]);
+        }
+        return false;
+      });
+}
+
+MagnumDrawableTransformations DrawableBVH::visibleDrawableTransformations(
+    MagnumCamera& camera) const {
+  std::vector<MagnumDrawable*> visible;
+  cull(Mn::Frustum::fromMatrix(camera.projectionMatrix() *
+                               camera.cameraMatrix()),
+       visible);
+
+  // same as Camera3D::drawableTransformations(), for the visible ones only
+  std::vector<std::reference_wrapper<Mn::SceneGraph::AbstractObject3D>>
+      objects;
+  objects.reserve(visible.size());
+  for (MagnumDrawable* drawable : visible) {
+    objects.push_back(drawable->object());
+  }
+  MagnumDrawableTransformations transformations;
+  if (objects.empty()) {
+    return transformations;
+  }
+  const std::vector<Mn::Matrix4> matrices =
+      camera.object().scene()->transformationMatrices(objects,
+                                                      camera.cameraMatrix());
+  transformations.reserve(visible.size());
+  for (size_t i = 0; i < visible.size(); ++i) {
+    transformations.emplace_back(*visible[i], matrices[i]);
+  }
+  return transformations;
+}
+
+}  // namespace gfx
+}  // namespace esp
@@ -0,0 +1,58 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#pragma once
+
+#include <vector>
+
+#include <Magnum/Math/Frustum.h>
+#include <Magnum/Math/Range.h>
+
+#include "esp/core/esp.h"
+#include "esp/geo/BVH.h"
+#include "magnum.h"
+
+namespace esp {
+namespace gfx {
+
+// Bounding volume hierarchy over the world space bounding boxes of the
+// drawables of a group, to only traverse the drawables in view of a camera.
+// Bounding boxes come from Drawable::getLocalBoundingBox(); drawables without
+// one are kept aside and always considered visible.
+// The hierarchy is rebuilt on update() when drawables were added to or removed
+// from the group or any of them moved, which is detected through the dirty
+// flag of their scene nodes: update() marks the nodes clean again.
+class DrawableBVH {
+ public:
+  // Bring the hierarchy up to date with the drawables of group
+  void update(MagnumDrawableGroup& drawables);
+
+  // Incremented by every update() that found the drawables changed
+  uint64_t revision() const { return revision_; }
+
+  // Drawables of the last update() intersecting the view frustum of camera,
+  // with their transformation relative to the camera like
+  // Camera3D::drawableTransformations() returns
+  MagnumDrawableTransformations visibleDrawableTransformations(
+      MagnumCamera& camera) const;
+
+  // Drawables of the last update() intersecting frustum (in world space)
+  void cull(const Magnum::Frustum& frustum,
+            std::vector<MagnumDrawable*>& visible) const;
+
+ protected:
+  // group order, to detect changes to the group
+  std::vector<MagnumDrawable*> drawables_;
+  // world space box per drawable of drawables_, valid for bounded ones
+  std::vector<Magnum::Range3D> boxes_;
+  std::vector<MagnumDrawable*> unbounded_;
+  // over boxes_, whose items index drawables_
+  geo::BVH bvh_;
+  uint64_t revision_ = 0;
+
+  ESP_SMART_POINTERS(DrawableBVH)
+};
+
+}  // namespace gfx
+}  // namespace esp
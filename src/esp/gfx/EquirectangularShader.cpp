@@ -0,0 +1,124 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#include "EquirectangularShader.h"
+
+#include <Corrade/Containers/ArrayView.h>
+#include <Corrade/Containers/Reference.h>
+#include <Corrade/Utility/Assert.h>
+#include <Corrade/Utility/Resource.h>
+#include <Magnum/GL/Shader.h>
+#include <Magnum/GL/TextureArray.h>
+#include <Magnum/GL/Version.h>
+#include <Magnum/Math/Matrix3.h>
+
+#include "ShaderCache.h"
+
+namespace Mn = Magnum;
+
+static void importShaderResources() {
+  CORRADE_RESOURCE_INITIALIZE(ShaderResources)
+}
+
+namespace esp {
+namespace gfx {
+
+namespace {
+enum { ColorTextureUnit = 0, ObjectIdTextureUnit = 1, DepthTextureUnit = 2 };
+}
+
+Mn::Matrix4 cubeMapFaceRotation(CubeMapFace face) {
+  using namespace Mn::Math::Literals;
+  switch (face) {
+    case CubeMapFace::Front:
+      return Mn::Matrix4{};
+    case CubeMapFace::Right:
+      return Mn::Matrix4::rotationY(-90.0_degf);
+    case CubeMapFace::Back:
+      return Mn::Matrix4::rotationY(180.0_degf);
+    case CubeMapFace::Left:
+      return Mn::Matrix4::rotationY(90.0_degf);
+    case CubeMapFace::Up:
+      return Mn::Matrix4::rotationX(90.0_degf);
+    case CubeMapFace::Down:
+      return Mn::Matrix4::rotationX(-90.0_degf);
+  }
+  CORRADE_ASSERT_UNREACHABLE();
+}
+
+EquirectangularShader::EquirectangularShader() {
+  if (!Corrade::Utility::Resource::hasGroup("default-shaders")) {
+    importShaderResources();
+  }
+
+  const Corrade::Utility::Resource rs{"default-shaders"};
+
+#ifdef MAGNUM_TARGET_WEBGL
+  Mn::GL::Version glVersion = Mn::GL::Version::GLES300;
+#else
+  Mn::GL::Version glVersion = Mn::GL::Version::GL410;
+#endif
+
+  const std::string vertSource = rs.get("equirectangular.vert");
+  const std::string fragSource = rs.get("equirectangular.frag");
+  const std::string binaryKey =
+      programBinaryKey("equirectangular", {vertSource, fragSource});
+
+  if (!loadProgramBinary(*this, binaryKey)) {
+    Mn::GL::Shader vert{glVersion, Mn::GL::Shader::Type::Vertex};
+    Mn::GL::Shader frag{glVersion, Mn::GL::Shader::Type::Fragment};
+
+    vert.addSource(vertSource);
+    frag.addSource(fragSource);
+
+    CORRADE_INTERNAL_ASSERT_OUTPUT(Mn::GL::Shader::compile({vert, frag}));
+
+    attachShaders({vert, frag});
+
+    prepareProgramBinary(*this);
+    CORRADE_INTERNAL_ASSERT_OUTPUT(link());
+    saveProgramBinary(*this, binaryKey);
+  }
+
+  viewportSizeUniform_ = uniformLocation("viewportSize");
+  depthUnprojectionUniform_ = uniformLocation("depthUnprojection");
+  setUniform(uniformLocation("colorTexture"), ColorTextureUnit);
+  setUniform(uniformLocation("objectIdTexture"), ObjectIdTextureUnit);
+  setUniform(uniformLocation("depthTexture"), DepthTextureUnit);
+
+  // the shader takes directions into the faces, the inverse of the rotations
+  // the faces are drawn with
+  Mn::Matrix3x3 faceRotations[CubeMapFaceCount];
+  for (int face = 0; face < CubeMapFaceCount; ++face) {
+    faceRotations[face] =
+        cubeMapFaceRotation(CubeMapFace(face)).rotationScaling().transposed();
+  }
+  setUniform(uniformLocation("faceRotations"),
+             Corrade::Containers::arrayView(faceRotations));
+}
+
+EquirectangularShader& EquirectangularShader::setViewportSize(
+    const Mn::Vector2i& size) {
+  setUniform(viewportSizeUniform_, Mn::Vector2{size});
+  return *this;
+}
+
+EquirectangularShader& EquirectangularShader::setDepthUnprojection(
+    const Mn::Vector2& unprojection) {
+  setUniform(depthUnprojectionUniform_, unprojection);
+  return *this;
+}
+
+EquirectangularShader& EquirectangularShader::bindTextures(
+    Mn::GL::Texture2DArray& color,
+    Mn::GL::Texture2DArray& objectId,
+    Mn::GL::Texture2DArray& depth) {
+  color.bind(ColorTextureUnit);
+  objectId.bind(ObjectIdTextureUnit);
+  depth.bind(DepthTextureUnit);
+  return *this;
+}
+
+}  // namespace gfx
+}  // namespace esp
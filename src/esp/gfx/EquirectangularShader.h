@@ -0,0 +1,76 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#pragma once
+
+#include <Magnum/GL/AbstractShaderProgram.h>
+#include <Magnum/GL/GL.h>
+#include <Magnum/Math/Matrix4.h>
+
+#include "esp/core/esp.h"
+
+namespace esp {
+namespace gfx {
+
+//! Faces of a cube map, in the order they are stored in
+enum class CubeMapFace { Front, Right, Back, Left, Up, Down };
+
+constexpr int CubeMapFaceCount = 6;
+
+//! Rotation from a camera into the 90 degree camera of face, which shares its
+//! position
+Magnum::Matrix4 cubeMapFaceRotation(CubeMapFace face);
+
+/**
+@brief Resamples the faces of a cube map into an equirectangular panorama
+
+Renders a full-screen triangle; every fragment of the viewport samples the
+face its direction falls on. The faces are layers of texture arrays drawn
+with the rotations of @ref cubeMapFaceRotation(). Writes color and object id
+like the other shaders, and depth such that it unprojects to the distance
+along the ray with the depth unprojection coefficients of the faces.
+*/
+class EquirectangularShader : public Magnum::GL::AbstractShaderProgram {
+ public:
+  /** @brief Constructor */
+  explicit EquirectangularShader();
+
+  //! Color attachment location per output type
+  enum : uint8_t {
+    //! color output
+    ColorOutput = 0,
+    //! object id output
+    ObjectIdOutput = 1
+  };
+
+  /**
+   * @brief Set the size of the viewport the panorama is drawn into
+   * @return Reference to self (for method chaining)
+   */
+  EquirectangularShader& setViewportSize(const Magnum::Vector2i& size);
+
+  /**
+   * @brief Set depth unprojection coefficients of the faces
+   * @return Reference to self (for method chaining)
+   *
+   * See @ref calculateDepthUnprojection().
+   */
+  EquirectangularShader& setDepthUnprojection(
+      const Magnum::Vector2& unprojection);
+
+  /**
+   * @brief Bind the face textures, one layer per @ref CubeMapFace
+   * @return Reference to self (for method chaining)
+   */
+  EquirectangularShader& bindTextures(Magnum::GL::Texture2DArray& color,
+                                      Magnum::GL::Texture2DArray& objectId,
+                                      Magnum::GL::Texture2DArray& depth);
+
+ private:
+  int viewportSizeUniform_;
+  int depthUnprojectionUniform_;
+};
+
+}  // namespace gfx
+}  // namespace esp
@@ -6,6 +6,7 @@
 
 #include <Magnum/Shaders/Flat.h>
 
+#include "esp/assets/StreamedTexture.h"
 #include "esp/scene/SceneNode.h"
 
 namespace esp {
@@ -24,23 +25,64 @@ GenericDrawable::GenericDrawable(
       objectId_(objectId),
       color_{color} {}
 
+Magnum::GL::AbstractTexture* GenericDrawable::getTexture() {
+  Magnum::Shaders::Flat3D& shader =
+      static_cast<Magnum::Shaders::Flat3D&>(shader_);
+  return shader.flags() & Magnum::Shaders::Flat3D::Flag::Textured ? texture_
+                                                                  : nullptr;
+}
+
+bool GenericDrawable::requestTexture() {
+  return streamedTexture_ == nullptr || streamedTexture_->request();
+}
+
 void GenericDrawable::draw(const Magnum::Matrix4& transformationMatrix,
                            Magnum::SceneGraph::Camera3D& camera) {
+  DrawState state;
+  draw(transformationMatrix, camera, state);
+}
+
+void GenericDrawable::draw(const Magnum::Matrix4& transformationMatrix,
+                           Magnum::SceneGraph::Camera3D& camera,
+                           DrawState& state) {
   Magnum::Shaders::Flat3D& shader =
       static_cast<Magnum::Shaders::Flat3D&>(shader_);
-  shader.setTransformationProjectionMatrix(camera.projectionMatrix() *
-                                           transformationMatrix);
+  if (state.shader != &shader_) {
+    state = DrawState{};
+    state.shader = &shader_;
+  }
+  shader.setTransformationProjectionMatrix(
+      camera.projectionMatrix() * transformationMatrix *
+      positionDequantization_);
 
-  if ((shader.flags() & Magnum::Shaders::Flat3D::Flag::Textured) && texture_) {
+  if (streamedTexture_ && !streamedTexture_->isResident() &&
+      requestTexture() && state.texture == texture_) {
+    // the upload replaced the placeholder bound by a drawable before
+    state.texture = nullptr;
+  }
+  if ((shader.flags() & Magnum::Shaders::Flat3D::Flag::Textured) && texture_ &&
+      state.texture != texture_) {
     shader.bindTexture(*texture_);
+    state.texture = texture_;
   }
 
-  if (!(shader.flags() & Magnum::Shaders::Flat3D::Flag::VertexColor)) {
+  if (!(shader.flags() & Magnum::Shaders::Flat3D::Flag::VertexColor) &&
+      (!state.color || *state.color != color_)) {
     shader.setColor(color_);
+    state.color = color_;
   }
 
   shader.setObjectId(node_.getId());
-  mesh_.draw(shader_);
+  getLODMesh(transformationMatrix, camera).draw(shader_);
+}
+
+void GenericDrawable::drawDepth(const Magnum::Matrix4& transformationMatrix,
+                                Magnum::SceneGraph::Camera3D& camera,
+                                Magnum::Shaders::Flat3D& shader) {
+  shader.setTransformationProjectionMatrix(camera.projectionMatrix() *
+                                           transformationMatrix *
+                                           positionDequantization_);
+  getLODMesh(transformationMatrix, camera).draw(shader);
 }
 
 }  // namespace gfx
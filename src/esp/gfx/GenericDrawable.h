@@ -5,10 +5,14 @@
 #pragma once
 
 #include <Magnum/Shaders/Shaders.h>
+#include <Magnum/Trade/Trade.h>
 
 #include "Drawable.h"
 
 namespace esp {
+namespace assets {
+class StreamedTexture;
+}
 namespace gfx {
 
 class GenericDrawable : public Drawable {
@@ -24,6 +28,39 @@ class GenericDrawable : public Drawable {
                            int objectId = ID_UNDEFINED,
                            const Magnum::Color4& color = Magnum::Color4{1});
 
+  virtual Magnum::GL::AbstractTexture* getTexture() override;
+
+  //! Transformation from the vertex positions of the mesh to the frame of the
+  //! node, for meshes with quantized positions
+  void setPositionDequantization(const Magnum::Matrix4& dequantization) {
+    positionDequantization_ = dequantization;
+  }
+
+  //! The mesh on the CPU, for MultiDrawBatch to pack it with other meshes;
+  //! nullptr, the default, leaves the drawable out of batches
+  void setMeshData(const Magnum::Trade::MeshData3D* meshData) {
+    meshData_ = meshData;
+  }
+
+  //! Streaming state of the texture, see ResourceManager::streamTextures();
+  //! nullptr, the default, for a texture loaded whole
+  void setStreamedTexture(assets::StreamedTexture* streamedTexture) {
+    streamedTexture_ = streamedTexture;
+  }
+
+  //! Ask for the full texture of a streamed texture, as the drawable passed
+  //! culling. False while it still has its placeholder
+  bool requestTexture();
+
+  virtual void draw(const Magnum::Matrix4& transformationMatrix,
+                    Magnum::SceneGraph::Camera3D& camera,
+                    DrawState& state) override;
+
+  //! Draws the depth with the position dequantization
+  virtual void drawDepth(const Magnum::Matrix4& transformationMatrix,
+                         Magnum::SceneGraph::Camera3D& camera,
+                         Magnum::Shaders::Flat3D& shader) override;
+
  protected:
   virtual void draw(const Magnum::Matrix4& transformationMatrix,
                     Magnum::SceneGraph::Camera3D& camera) override;
@@ -31,6 +68,14 @@ class GenericDrawable : public Drawable {
   Magnum::GL::Texture2D* texture_;
   int objectId_;
   Magnum::Color4 color_;
+  Magnum::Matrix4 positionDequantization_;
+  const Magnum::Trade::MeshData3D* meshData_ = nullptr;
+  assets::StreamedTexture* streamedTexture_ = nullptr;
+
+  // draws GenericDrawables sharing a mesh and texture in one call
+  friend class InstancedDrawer;
+  // packs the meshes of GenericDrawables into one multi-draw
+  friend class MultiDrawBatch;
 };
 
 }  // namespace gfx
@@ -0,0 +1,69 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#include "GpuProfiler.h"
+
+#include <Magnum/Magnum.h>
+
+namespace Mn = Magnum;
+
+namespace esp {
+namespace gfx {
+
+namespace {
+// scopes waiting for their results before the oldest are dropped, in case
+// collect() is never called
+const size_t maxPendingScopes = 256;
+}  // namespace
+
+bool GpuProfiler::begin(const char* name) {
+#ifndef MAGNUM_TARGET_WEBGL
+  core::Profiler& profiler = core::Profiler::get();
+  if (open_ || !profiler.isEnabled()) {
+    return false;
+  }
+  collect();
+  if (pending_.size() >= maxPendingScopes) {
+    free_.push_back(std::move(pending_.front().query));
+    pending_.pop_front();
+  }
+  if (free_.empty()) {
+    free_.emplace_back(Mn::GL::TimeQuery::Target::TimeElapsed);
+  }
+  pending_.push_back({name, profiler.now(), std::move(free_.back())});
+  free_.pop_back();
+  pending_.back().query.begin();
+  open_ = true;
+  return true;
+#else
+  return false;
+#endif
+}
+
+void GpuProfiler::end() {
+#ifndef MAGNUM_TARGET_WEBGL
+  CORRADE_INTERNAL_ASSERT(open_);
+  pending_.back().query.end();
+  open_ = false;
+#endif
+}
+
+void GpuProfiler::collect() {
+#ifndef MAGNUM_TARGET_WEBGL
+  // results arrive in submission order
+  while (!pending_.empty() && !(open_ && pending_.size() == 1) &&
+         pending_.front().query.resultAvailable()) {
+    Scope& scope = pending_.front();
+    core::Profiler::get().record(
+        scope.name, scope.startNs,
+        static_cast<int64_t>(scope.query.result<Mn::UnsignedLong>()),
+        core::Profiler::GpuThreadId);
+    free_.push_back(std::move(scope.query));
+    pending_.pop_front();
+  }
+#endif
+}
+
+}  // namespace gfx
+}  // namespace esp
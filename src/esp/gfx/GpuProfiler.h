@@ -0,0 +1,83 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#pragma once
+
+#include <deque>
+#include <vector>
+
+#include <Magnum/GL/TimeQuery.h>
+
+#include "esp/core/Profiling.h"
+#include "esp/core/esp.h"
+
+namespace esp {
+namespace gfx {
+
+// Times scopes on the GPU with GL timer queries and records them into
+// core::Profiler on its GPU track once the results are available, so timing
+// never waits for the GPU. An event starts when its commands were submitted.
+// Queries belong to a GL context, so every Renderer has its own. GL cannot
+// nest timer queries; scopes begun while another is open are not timed.
+// Does nothing on WebGL, which has no timer queries.
+class GpuProfiler {
+ public:
+  //! Start timing name, false if another scope is open or the profiler is
+  //! disabled
+  bool begin(const char* name);
+
+  void end();
+
+  //! Record the scopes whose results have arrived, without waiting
+  void collect();
+
+ private:
+#ifndef MAGNUM_TARGET_WEBGL
+  struct Scope {
+    const char* name;
+    int64_t startNs;
+    Magnum::GL::TimeQuery query;
+  };
+
+  std::deque<Scope> pending_;
+  // queries of collected scopes, for reuse
+  std::vector<Magnum::GL::TimeQuery> free_;
+#endif
+  bool open_ = false;
+};
+
+// Times the scope it lives in on the GPU, see GpuProfiler
+class GpuProfileScope {
+ public:
+  GpuProfileScope(GpuProfiler& profiler, const char* name)
+      : profiler_(profiler.begin(name) ? &profiler : nullptr) {}
+
+  ~GpuProfileScope() {
+    if (profiler_ != nullptr) {
+      profiler_->end();
+    }
+  }
+
+  GpuProfileScope(const GpuProfileScope&) = delete;
+  GpuProfileScope& operator=(const GpuProfileScope&) = delete;
+
+ private:
+  GpuProfiler* profiler_;
+};
+
+}  // namespace gfx
+}  // namespace esp
+
+// Time the rest of the enclosing scope on the CPU and, through gpuProfiler,
+// on the GPU as name, a string literal
+#ifdef ESP_BUILD_WITH_PROFILING
+#define ESP_PROFILE_GPU_SCOPE(gpuProfiler, name)  \
+  ESP_PROFILE_SCOPE(name);                        \
+  ::esp::gfx::GpuProfileScope ESP_PROFILE_CONCAT( \
+      espGpuProfileScope, __LINE__)(gpuProfiler, name)
+#else
+#define ESP_PROFILE_GPU_SCOPE(gpuProfiler, name) \
+  do {                                           \
+  } while (false)
+#endif
@@ -0,0 +1,279 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#include "GpuScheduler.h"
+
+#include <cerrno>
+#include <cstdlib>
+#include <limits>
+#include <sstream>
+#include <tuple>
+
+#ifndef _WIN32
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/file.h>
+#include <unistd.h>
+#endif
+
+namespace esp {
+namespace gfx {
+
+namespace {
+// devices with less free memory only get contexts if all do
+const size_t minFreeMemory = size_t(1) << 30;
+
+struct RegistryEntry {
+  long pid;
+  int cudaDevice;
+};
+
+#ifndef _WIN32
+// NVML, the management library that comes with the NVIDIA driver, loaded at
+// runtime so that building does not depend on it
+class Nvml {
+ public:
+  static Nvml& get() {
+    static Nvml nvml;
+    return nvml;
+  }
+
+  //! Fill in memory and utilization of status from NVML, false if it has no
+  //! device at pciBusId
+  bool query(const std::string& pciBusId, GpuDeviceStatus& status) {
+    void* device = nullptr;
+    if (library_ == nullptr || pciBusId.empty() ||
+        getHandleByPciBusId_(pciBusId.c_str(), &device) != 0) {
+      return false;
+    }
+    Memory memory;
+    if (getMemoryInfo_(device, &memory) == 0) {
+      status.freeMemory = memory.free;
+      status.totalMemory = memory.total;
+    }
+    Utilization utilization;
+    if (getUtilizationRates_(device, &utilization) == 0) {
+      status.utilization = utilization.gpu;
+    }
+    return true;
+  }
+
+ private:
+  // the layouts of nvmlMemory_t and nvmlUtilization_t
+  struct Memory {
+    unsigned long long total, free, used;
+  };
+  struct Utilization {
+    unsigned int gpu, memory;
+  };
+
+  Nvml() {
+    library_ = dlopen("libnvidia-ml.so.1", RTLD_NOW | RTLD_LOCAL);
+    if (library_ == nullptr) {
+      return;
+    }
+    init_ = reinterpret_cast<int (*)()>(dlsym(library_, "nvmlInit_v2"));
+    shutdown_ = reinterpret_cast<int (*)()>(dlsym(library_, "nvmlShutdown"));
+    getHandleByPciBusId_ = reinterpret_cast<int (*)(const char*, void**)>(
+        dlsym(library_, "nvmlDeviceGetHandleByPciBusId_v2"));
+    getMemoryInfo_ = reinterpret_cast<int (*)(void*, Memory*)>(
+        dlsym(library_, "nvmlDeviceGetMemoryInfo"));
+    getUtilizationRates_ = reinterpret_cast<int (*)(void*, Utilization*)>(
+        dlsym(library_, "nvmlDeviceGetUtilizationRates"));
+    if (!init_ || !shutdown_ || !getHandleByPciBusId_ || !getMemoryInfo_ ||
+        !getUtilizationRates_ || init_() != 0) {
+      LOG(WARNING) << "Cannot initialize NVML, scheduling GPUs by their "
+                      "number of contexts only";
+      dlclose(library_);
+      library_ = nullptr;
+    }
+  }
+
+  ~Nvml() {
+    if (library_ != nullptr) {
+      shutdown_();
+      dlclose(library_);
+    }
+  }
+
+  void* library_ = nullptr;
+  int (*init_)() = nullptr;
+  int (*shutdown_)() = nullptr;
+  int (*getHandleByPciBusId_)(const char*, void**) = nullptr;
+  int (*getMemoryInfo_)(void*, Memory*) = nullptr;
+  int (*getUtilizationRates_)(void*, Utilization*) = nullptr;
+};
+
+// Entries of the registry open at fd, without those of processes that are
+// gone
+std::vector<RegistryEntry> readRegistry(int fd) {
+  std::string contents;
+  char buffer[4096];
+  lseek(fd, 0, SEEK_SET);
+  ssize_t n;
+  while ((n = read(fd, buffer, sizeof(buffer))) > 0) {
+    contents.append(buffer, n);
+  }
+
+  std::vector<RegistryEntry> entries;
+  std::istringstream is(contents);
+  RegistryEntry entry;
+  while (is >> entry.pid >> entry.cudaDevice) {
+    if (kill(entry.pid, 0) == 0 || errno == EPERM) {
+      entries.push_back(entry);
+    }
+  }
+  return entries;
+}
+
+bool writeRegistry(int fd, const std::vector<RegistryEntry>& entries) {
+  std::ostringstream os;
+  for (const RegistryEntry& entry : entries) {
+    os << entry.pid << " " << entry.cudaDevice << "\n";
+  }
+  const std::string contents = os.str();
+  return ftruncate(fd, 0) == 0 && lseek(fd, 0, SEEK_SET) == 0 &&
+         write(fd, contents.data(), contents.size()) ==
+             static_cast<ssize_t>(contents.size());
+}
+
+// Open and exclusively lock the registry, -1 if it cannot be
+int lockRegistry(const std::string& file) {
+  const int fd = open(file.c_str(), O_RDWR | O_CREAT, 0644);
+  if (fd < 0) {
+    return -1;
+  }
+  if (flock(fd, LOCK_EX) != 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+void unlockRegistry(int fd) {
+  flock(fd, LOCK_UN);
+  close(fd);
+}
+#endif
+
+std::vector<GpuDeviceStatus> queryGpuDevices(
+    const std::vector<GpuDevice>& devices,
+    const std::vector<RegistryEntry>& entries) {
+  std::vector<GpuDeviceStatus> status(devices.size());
+  for (size_t i = 0; i < devices.size(); ++i) {
+    status[i].device = devices[i];
+#ifndef _WIN32
+    Nvml::get().query(devices[i].pciBusId, status[i]);
+#endif
+    for (const RegistryEntry& entry : entries) {
+      if (entry.cudaDevice == devices[i].cudaDevice) {
+        ++status[i].numContexts;
+      }
+    }
+  }
+  return status;
+}
+}  // namespace
+
+int pickGpuDevice(const std::vector<GpuDeviceStatus>& devices) {
+  auto key = [](const GpuDeviceStatus& status) {
+    const bool lowOnMemory =
+        status.totalMemory > 0 && status.freeMemory < minFreeMemory;
+    return std::make_tuple(
+        lowOnMemory, status.numContexts, status.utilization / 10,
+        std::numeric_limits<size_t>::max() - status.freeMemory);
+  };
+  int best = ID_UNDEFINED;
+  for (int i = 0; i < static_cast<int>(devices.size()); ++i) {
+    if (best == ID_UNDEFINED || key(devices[i]) < key(devices[best])) {
+      best = i;
+    }
+  }
+  return best;
+}
+
+std::vector<GpuDeviceStatus> queryGpuDevices(
+    const std::vector<GpuDevice>& devices,
+    const std::string& registryFile) {
+  std::vector<RegistryEntry> entries;
+#ifndef _WIN32
+  const int fd = open(registryFile.c_str(), O_RDONLY);
+  if (fd >= 0) {
+    entries = readRegistry(fd);
+    close(fd);
+  }
+#endif
+  return queryGpuDevices(devices, entries);
+}
+
+std::string defaultGpuRegistryFile() {
+  const char* file = std::getenv("HABITAT_SIM_GPU_REGISTRY");
+  if (file != nullptr) {
+    return file;
+  }
+#ifndef _WIN32
+  return "/tmp/habitat-sim-gpus-" + std::to_string(getuid());
+#else
+  return "";
+#endif
+}
+
+GpuDeviceClaim::GpuDeviceClaim(const std::vector<GpuDevice>& devices,
+                               const std::string& registryFile)
+    : registryFile_(registryFile) {
+  if (devices.empty()) {
+    return;
+  }
+#ifndef _WIN32
+  const int fd = lockRegistry(registryFile_);
+  if (fd < 0) {
+    LOG(WARNING) << "Cannot open GPU registry " << registryFile_
+                 << ", placing the context without the other processes";
+  }
+  std::vector<RegistryEntry> entries;
+  if (fd >= 0) {
+    entries = readRegistry(fd);
+  }
+  const std::vector<GpuDeviceStatus> status =
+      queryGpuDevices(devices, entries);
+  const GpuDeviceStatus& picked = status[pickGpuDevice(status)];
+  cudaDevice_ = picked.device.cudaDevice;
+  if (fd >= 0) {
+    entries.push_back({static_cast<long>(getpid()), cudaDevice_});
+    registered_ = writeRegistry(fd, entries);
+    unlockRegistry(fd);
+  }
+  LOG(INFO) << "Scheduled on CUDA device " << cudaDevice_ << " of "
+            << devices.size() << ", with " << picked.numContexts
+            << " other contexts, " << picked.freeMemory / (1 << 20)
+            << " MiB free and " << picked.utilization << "% utilization";
+#else
+  cudaDevice_ = devices[0].cudaDevice;
+#endif
+}
+
+GpuDeviceClaim::~GpuDeviceClaim() {
+#ifndef _WIN32
+  if (!registered_) {
+    return;
+  }
+  const int fd = lockRegistry(registryFile_);
+  if (fd < 0) {
+    return;
+  }
+  std::vector<RegistryEntry> entries = readRegistry(fd);
+  for (auto it = entries.begin(); it != entries.end(); ++it) {
+    if (it->pid == getpid() && it->cudaDevice == cudaDevice_) {
+      entries.erase(it);
+      break;
+    }
+  }
+  writeRegistry(fd, entries);
+  unlockRegistry(fd);
+#endif
+}
+
+}  // namespace gfx
+}  // namespace esp
@@ -0,0 +1,79 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "esp/core/esp.h"
+
+namespace esp {
+namespace gfx {
+
+//! GPU device id that has the GPU scheduler pick the device
+constexpr int AUTO_GPU_DEVICE = -1;
+
+//! GPU a context can be created on
+struct GpuDevice {
+  //! CUDA device id, which is what gpuDeviceId refers to
+  int cudaDevice = ID_UNDEFINED;
+  //! PCI bus id as in "0000:3b:00.0", empty if unknown
+  std::string pciBusId;
+};
+
+struct GpuDeviceStatus {
+  GpuDevice device;
+  //! free and total memory in bytes, 0 if unknown
+  size_t freeMemory = 0;
+  size_t totalMemory = 0;
+  //! percent of time the GPU was busy over the last sample period
+  int utilization = 0;
+  //! contexts the scheduler placed on the device on this node
+  int numContexts = 0;
+};
+
+// Index of the device to place another context on: among the devices with
+// enough free memory (or all, if none or unknown), the one with the fewest
+// contexts, then the least busy one in steps of 10%, then the one with the
+// most free memory. Counting contexts keeps workers that start together from
+// all picking the same device before any of them has allocated memory.
+int pickGpuDevice(const std::vector<GpuDeviceStatus>& devices);
+
+//! Status of devices: memory and utilization from NVML where the driver has
+//! it, context counts from registryFile. Does not lock registryFile
+std::vector<GpuDeviceStatus> queryGpuDevices(
+    const std::vector<GpuDevice>& devices,
+    const std::string& registryFile);
+
+//! Node-wide file the scheduler registers contexts in, per user; set
+//! HABITAT_SIM_GPU_REGISTRY to override
+std::string defaultGpuRegistryFile();
+
+// Claim on a device for a context: picks one of devices by pickGpuDevice()
+// and registers the claim in a file shared by the processes of the node,
+// locked while picking. The claim is released on destruction; claims of
+// processes that exited without releasing are dropped on the next pick.
+class GpuDeviceClaim {
+ public:
+  explicit GpuDeviceClaim(
+      const std::vector<GpuDevice>& devices,
+      const std::string& registryFile = defaultGpuRegistryFile());
+  ~GpuDeviceClaim();
+
+  GpuDeviceClaim(const GpuDeviceClaim&) = delete;
+  GpuDeviceClaim& operator=(const GpuDeviceClaim&) = delete;
+
+  //! CUDA device id of the claimed device, ID_UNDEFINED if there were none
+  int getCudaDevice() const { return cudaDevice_; }
+
+ private:
+  std::string registryFile_;
+  int cudaDevice_ = ID_UNDEFINED;
+  bool registered_ = false;
+};
+
+}  // namespace gfx
+}  // namespace esp
@@ -0,0 +1,164 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#include "InstancedDrawer.h"
+
+#include <tuple>
+
+#include <Corrade/Containers/ArrayView.h>
+#include <Magnum/Shaders/Flat.h>
+
+#include "GenericDrawable.h"
+#include "esp/scene/SceneNode.h"
+
+namespace Mn = Magnum;
+
+namespace esp {
+namespace gfx {
+
+namespace {
+// per-instance attributes of InstancedFlatShader
+struct InstanceData {
+  Mn::Matrix4 transformation;
+  Mn::Vector4 color;
+  Mn::UnsignedInt objectId;
+  Mn::UnsignedInt padding[3];
+};
+
+struct InstanceGroup {
+  InstancedFlatShader::Flags flags;
+  Mn::GL::Texture2D* texture = nullptr;
+  // indices into the drawable transformations
+  std::vector<size_t> drawables;
+};
+}  // namespace
+
+void InstancedDrawer::draw(MagnumCamera& camera,
+                           MagnumDrawableGroup& drawables) {
+  draw(camera, camera.drawableTransformations(drawables));
+}
+
+void InstancedDrawer::draw(
+    MagnumCamera& camera,
+    const MagnumDrawableTransformations& transformations) {
+  for (auto& transformation : drawInstances(camera, transformations)) {
+    transformation.first.get().draw(transformation.second, camera);
+  }
+}
+
+MagnumDrawableTransformations InstancedDrawer::drawInstances(
+    MagnumCamera& camera,
+    const MagnumDrawableTransformations& transformations) {
+  using Flat3D = Mn::Shaders::Flat3D;
+
+  // group the drawables that the instanced shader can draw exactly like their
+  // own shader does, the others are left to draw themselves
+  MagnumDrawableTransformations remaining;
+  std::map<std::tuple<Mn::GL::Mesh*, Mn::GL::Texture2D*, int>, InstanceGroup>
+      groups;
+  for (size_t i = 0; i < transformations.size(); ++i) {
+    MagnumDrawable& drawable = transformations[i].first.get();
+    GenericDrawable* generic = dynamic_cast<GenericDrawable*>(&drawable);
+    if (generic == nullptr) {
+      remaining.push_back(transformations[i]);
+      continue;
+    }
+    const Flat3D::Flags shaderFlags =
+        static_cast<Flat3D&>(generic->shader_).flags();
+    const bool textured =
+        (shaderFlags & Flat3D::Flag::Textured) && generic->texture_;
+    if (!(shaderFlags & Flat3D::Flag::ObjectId) ||
+        (shaderFlags & ~(Flat3D::Flag::ObjectId | Flat3D::Flag::Textured |
+                         Flat3D::Flag::VertexColor)) ||
+        ((shaderFlags & Flat3D::Flag::Textured) && !textured)) {
+      remaining.push_back(transformations[i]);
+      continue;
+    }
+
+    // a streamed texture may replace its placeholder here, before it is
+    // bound for the instances
+    if (textured) {
+      generic->requestTexture();
+    }
+
+    InstancedFlatShader::Flags flags;
+    if (textured) {
+      flags |= InstancedFlatShader::Flag::Textured;
+    }
+    if (shaderFlags & Flat3D::Flag::VertexColor) {
+      flags |= InstancedFlatShader::Flag::VertexColor;
+    }
+    InstanceGroup& group =
+        groups[std::make_tuple(&generic->mesh_, generic->texture_, int(flags))];
+    group.flags = flags;
+    group.texture = textured ? generic->texture_ : nullptr;
+    group.drawables.push_back(i);
+  }
+
+  size_t numInstanceBuffers = 0;
+  std::vector<InstanceData> instances;
+  for (auto& entry : groups) {
+    const InstanceGroup& group = entry.second;
+    if (static_cast<int>(group.drawables.size()) < minInstances_) {
+      for (const size_t i : group.drawables) {
+        remaining.push_back(transformations[i]);
+      }
+      continue;
+    }
+
+    instances.resize(group.drawables.size());
+    for (size_t k = 0; k < group.drawables.size(); ++k) {
+      const auto& transformation = transformations[group.drawables[k]];
+      GenericDrawable& drawable =
+          static_cast<GenericDrawable&>(transformation.first.get());
+      instances[k].transformation =
+          transformation.second * drawable.positionDequantization_;
+      // GenericDrawable leaves the (white) shader color for vertex colors
+      instances[k].color = group.flags & InstancedFlatShader::Flag::VertexColor
+                               ? Mn::Color4{1}
+                               : drawable.color_;
+      instances[k].objectId = drawable.node_.getId();
+    }
+
+    if (numInstanceBuffers == instanceBuffers_.size()) {
+      instanceBuffers_.emplace_back();
+    }
+    Mn::GL::Buffer& buffer = instanceBuffers_[numInstanceBuffers++];
+    buffer.setData(
+        Corrade::Containers::arrayView(instances.data(), instances.size()),
+        Mn::GL::BufferUsage::StreamDraw);
+
+    // the mesh is shared with the drawables drawing it one by one, whose
+    // shaders do not read the instance attribute locations
+    Mn::GL::Mesh& mesh = *std::get<0>(entry.first);
+    mesh.addVertexBufferInstanced(buffer, 1, 0,
+                                  InstancedFlatShader::TransformationMatrix{},
+                                  InstancedFlatShader::Color{},
+                                  InstancedFlatShader::ObjectId{},
+                                  sizeof(InstanceData::padding));
+    mesh.setInstanceCount(instances.size());
+
+    InstancedFlatShader& shader = getShader(group.flags);
+    shader.setProjectionMatrix(camera.projectionMatrix());
+    if (group.texture) {
+      shader.bindTexture(*group.texture);
+    }
+    mesh.draw(shader);
+    mesh.setInstanceCount(1);
+  }
+  lastInstancedDrawCount_ = numInstanceBuffers;
+  return remaining;
+}
+
+InstancedFlatShader& InstancedDrawer::getShader(
+    InstancedFlatShader::Flags flags) {
+  std::unique_ptr<InstancedFlatShader>& shader = shaders_[int(flags)];
+  if (!shader) {
+    shader = std::make_unique<InstancedFlatShader>(flags);
+  }
+  return *shader;
+}
+
+}  // namespace gfx
+}  // namespace esp
@@ -0,0 +1,64 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#pragma once
+
+#include <map>
+#include <memory>
+#include <vector>
+
+#include <Magnum/GL/Buffer.h>
+
+#include "esp/core/esp.h"
+#include "esp/gfx/InstancedFlatShader.h"
+#include "magnum.h"
+
+namespace esp {
+namespace gfx {
+
+class GenericDrawable;
+
+// Draws a drawable group like Camera3D::draw(), but GenericDrawables that
+// share a mesh and texture (e.g. the same physics object added many times)
+// are merged into a single instanced draw call with their transformations,
+// colors and object IDs in a per-instance buffer. Other drawables draw
+// themselves as usual, after the instanced ones.
+class InstancedDrawer {
+ public:
+  void draw(MagnumCamera& camera, MagnumDrawableGroup& drawables);
+
+  // draw a subset of drawables, e.g. the visible ones, with transformations
+  // relative to camera
+  void draw(MagnumCamera& camera,
+            const MagnumDrawableTransformations& transformations);
+
+  // only draw the instanced groups and return the drawables left to draw one
+  // by one
+  MagnumDrawableTransformations drawInstances(
+      MagnumCamera& camera,
+      const MagnumDrawableTransformations& transformations);
+
+  // groups with fewer drawables are drawn one by one
+  void setMinInstances(int minInstances) { minInstances_ = minInstances; }
+  int getMinInstances() const { return minInstances_; }
+
+  // instanced draw calls of the last drawInstances()
+  int getLastInstancedDrawCount() const { return lastInstancedDrawCount_; }
+
+ protected:
+  InstancedFlatShader& getShader(InstancedFlatShader::Flags flags);
+
+  int minInstances_ = 2;
+  int lastInstancedDrawCount_ = 0;
+  // created with the first instanced draw needing them
+  std::map<int, std::unique_ptr<InstancedFlatShader>> shaders_;
+  // one buffer per instanced draw of a frame, so that filling the next one
+  // does not wait for the previous draw
+  std::vector<Magnum::GL::Buffer> instanceBuffers_;
+
+  ESP_SMART_POINTERS(InstancedDrawer)
+};
+
+}  // namespace gfx
+}  // namespace esp
@@ -0,0 +1,108 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#include "InstancedFlatShader.h"
+
+#include <Corrade/Containers/Reference.h>
+#include <Corrade/Utility/Resource.h>
+#include <Magnum/GL/Shader.h>
+#include <Magnum/GL/Texture.h>
+#include <Magnum/GL/Version.h>
+#include <Magnum/Shaders/Generic.h>
+
+#include "ShaderCache.h"
+
+namespace Mn = Magnum;
+
+static void importShaderResources() {
+  CORRADE_RESOURCE_INITIALIZE(ShaderResources)
+}
+
+namespace esp {
+namespace gfx {
+
+namespace {
+enum { TextureLayer = 0 };
+}
+
+InstancedFlatShader::InstancedFlatShader(Flags flags) : flags_{flags} {
+  if (!Corrade::Utility::Resource::hasGroup("default-shaders")) {
+    importShaderResources();
+  }
+
+  const Corrade::Utility::Resource rs{"default-shaders"};
+
+#ifdef MAGNUM_TARGET_WEBGL
+  Mn::GL::Version glVersion = Mn::GL::Version::GLES300;
+#else
+  Mn::GL::Version glVersion = Mn::GL::Version::GL410;
+#endif
+
+  std::string defines;
+  if (flags & Flag::Textured) {
+    defines += "#define TEXTURED\n";
+  }
+  if (flags & Flag::VertexColor) {
+    defines += "#define VERTEX_COLOR\n";
+  }
+
+  const std::string vertSource = defines + rs.get("flat-instanced.vert");
+  const std::string fragSource = defines + rs.get("flat-instanced.frag");
+  const std::string binaryKey =
+      programBinaryKey("flat-instanced", {vertSource, fragSource});
+
+  if (!loadProgramBinary(*this, binaryKey)) {
+    Mn::GL::Shader vert{glVersion, Mn::GL::Shader::Type::Vertex};
+    Mn::GL::Shader frag{glVersion, Mn::GL::Shader::Type::Fragment};
+
+    vert.addSource(vertSource);
+    frag.addSource(fragSource);
+
+    CORRADE_INTERNAL_ASSERT_OUTPUT(Mn::GL::Shader::compile({vert, frag}));
+
+    attachShaders({vert, frag});
+
+    // meshes are compiled for the Magnum shaders, so take their locations
+    bindAttributeLocation(Mn::Shaders::Generic3D::Position::Location,
+                          "position");
+    if (flags & Flag::Textured) {
+      bindAttributeLocation(
+          Mn::Shaders::Generic3D::TextureCoordinates::Location,
+          "textureCoordinates");
+    }
+    if (flags & Flag::VertexColor) {
+      bindAttributeLocation(Mn::Shaders::Generic3D::Color4::Location,
+                            "vertexColor");
+    }
+    bindAttributeLocation(TransformationMatrix::Location,
+                          "instanceTransformationMatrix");
+    bindAttributeLocation(Color::Location, "instanceColor");
+    bindAttributeLocation(ObjectId::Location, "instanceObjectId");
+
+    prepareProgramBinary(*this);
+    CORRADE_INTERNAL_ASSERT_OUTPUT(link());
+    saveProgramBinary(*this, binaryKey);
+  }
+
+  projectionMatrixUniform_ = uniformLocation("projectionMatrix");
+  if (flags & Flag::Textured) {
+    setUniform(uniformLocation("textureData"), TextureLayer);
+  }
+}
+
+InstancedFlatShader& InstancedFlatShader::setProjectionMatrix(
+    const Mn::Matrix4& matrix) {
+  setUniform(projectionMatrixUniform_, matrix);
+  return *this;
+}
+
+InstancedFlatShader& InstancedFlatShader::bindTexture(
+    Mn::GL::Texture2D& texture) {
+  CORRADE_INTERNAL_ASSERT(flags_ & Flag::Textured);
+  texture.bind(TextureLayer);
+  return *this;
+}
+
+}  // namespace gfx
+}  // namespace esp
@@ -0,0 +1,80 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#pragma once
+
+#include <Corrade/Containers/EnumSet.h>
+#include <Magnum/GL/AbstractShaderProgram.h>
+#include <Magnum/GL/Attribute.h>
+#include <Magnum/Math/Matrix4.h>
+#include <Magnum/Math/Vector4.h>
+
+namespace esp {
+namespace gfx {
+
+/**
+@brief Flat shader drawing many instances of a mesh in one call
+
+Gives the same output as @ref Magnum::Shaders::Flat3D with
+@ref Magnum::Shaders::Flat3D::Flag::ObjectId enabled, but the transformation,
+color and object ID come from per-instance attributes instead of uniforms.
+Mesh attributes use the @ref Magnum::Shaders::Generic3D locations.
+*/
+class InstancedFlatShader : public Magnum::GL::AbstractShaderProgram {
+ public:
+  //! Per-instance transformation (relative to the camera), occupies four
+  //! consecutive locations
+  typedef Magnum::GL::Attribute<8, Magnum::Matrix4> TransformationMatrix;
+  //! Per-instance color
+  typedef Magnum::GL::Attribute<12, Magnum::Vector4> Color;
+  //! Per-instance object ID
+  typedef Magnum::GL::Attribute<13, Magnum::UnsignedInt> ObjectId;
+
+  //! Color attachment location per output type
+  enum : uint8_t {
+    //! color output
+    ColorOutput = 0,
+    //! object id output
+    ObjectIdOutput = 1
+  };
+
+  /** @brief Flag */
+  enum class Flag {
+    //! Multiply the color with a texture
+    Textured = 1 << 0,
+    //! Multiply the color with a vertex color
+    VertexColor = 1 << 1
+  };
+
+  /** @brief Flags */
+  typedef Corrade::Containers::EnumSet<Flag> Flags;
+
+  /** @brief Constructor */
+  explicit InstancedFlatShader(Flags flags = {});
+
+  Flags flags() const { return flags_; }
+
+  /**
+   * @brief Set projection matrix
+   * @return Reference to self (for method chaining)
+   */
+  InstancedFlatShader& setProjectionMatrix(const Magnum::Matrix4& matrix);
+
+  /**
+   * @brief Bind a color texture
+   * @return Reference to self (for method chaining)
+   *
+   * Expects that the shader was created with @ref Flag::Textured enabled.
+   */
+  InstancedFlatShader& bindTexture(Magnum::GL::Texture2D& texture);
+
+ private:
+  Flags flags_;
+  int projectionMatrixUniform_;
+};
+
+CORRADE_ENUMSET_OPERATORS(InstancedFlatShader::Flags)
+
+}  // namespace gfx
+}  // namespace esp
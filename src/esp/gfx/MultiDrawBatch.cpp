@@ -0,0 +1,423 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#include "MultiDrawBatch.h"
+
+#include <algorithm>
+#include <map>
+#include <numeric>
+
+#include <Corrade/Containers/ArrayView.h>
+#include <Magnum/GL/Context.h>
+#include <Magnum/GL/Extensions.h>
+#include <Magnum/GL/OpenGL.h>
+#include <Magnum/GL/Texture.h>
+#include <Magnum/GL/TextureFormat.h>
+#include <Magnum/GL/Version.h>
+#include <Magnum/Shaders/Flat.h>
+#include <Magnum/Shaders/Generic.h>
+#include <Magnum/Trade/MeshData3D.h>
+
+#include "GenericDrawable.h"
+#include "esp/scene/SceneNode.h"
+
+namespace Mn = Magnum;
+
+namespace esp {
+namespace gfx {
+
+namespace {
+// a command of glMultiDrawElementsIndirect()
+struct DrawCommand {
+  Mn::UnsignedInt count;
+  Mn::UnsignedInt instanceCount;
+  Mn::UnsignedInt firstIndex;
+  Mn::Int baseVertex;
+  Mn::UnsignedInt baseInstance;
+};
+
+#ifndef MAGNUM_TARGET_GLES
+// the sampling of a texture array, see MultiDrawBatch::TextureArray
+const GLenum samplingParameters[]{GL_TEXTURE_MAG_FILTER,
+                                  GL_TEXTURE_MIN_FILTER, GL_TEXTURE_WRAP_S,
+                                  GL_TEXTURE_WRAP_T};
+#endif
+}  // namespace
+
+bool MultiDrawBatch::isSupported() {
+#ifdef MAGNUM_TARGET_GLES
+  return false;
+#else
+  return Mn::GL::Context::current().isVersionSupported(
+      Mn::GL::Version::GL430);
+#endif
+}
+
+void MultiDrawBatch::draw(MagnumCamera& camera,
+                          MagnumDrawableGroup& drawables) {
+  draw(camera, camera.drawableTransformations(drawables));
+}
+
+void MultiDrawBatch::draw(
+    MagnumCamera& camera,
+    const MagnumDrawableTransformations& transformations) {
+  for (auto& transformation : drawBatched(camera, transformations)) {
+    transformation.first.get().draw(transformation.second, camera);
+  }
+}
+
+void MultiDrawBatch::setBindlessTextures(bool enabled) {
+  if (enabled != bindlessTextures_) {
+    clear();
+    bindlessTextures_ = enabled;
+  }
+}
+
+void MultiDrawBatch::clear() {
+  meshes_.clear();
+  vertices_.clear();
+  indices_.clear();
+  meshesDirty_ = true;
+#ifndef MAGNUM_TARGET_GLES
+  for (const auto& texture : textures_) {
+    if (texture.second.handle != 0) {
+      glMakeTextureHandleNonResidentARB(texture.second.handle);
+    }
+  }
+#endif
+  textures_.clear();
+  textureArrays_.clear();
+}
+
+const MultiDrawBatch::MeshRange* MultiDrawBatch::getMeshRange(
+    const Mn::Trade::MeshData3D& meshData) {
+  // a mesh at the address of a destroyed one is packed again, if it can be
+  // told apart by its vertex count
+  auto found = meshes_.find(&meshData);
+  if (found != meshes_.end() &&
+      found->second.vertexCount == meshData.positions(0).size()) {
+    return found->second.indexCount > 0 ? &found->second : nullptr;
+  }
+
+  // meshes that cannot be batched are remembered with no indices
+  MeshRange& range = meshes_[&meshData];
+  range = MeshRange{};
+  range.vertexCount = meshData.positions(0).size();
+  if (meshData.primitive() != Mn::MeshPrimitive::Triangles ||
+      !meshData.isIndexed() || meshData.indices().empty() ||
+      meshData.positions(0).empty()) {
+    return nullptr;
+  }
+
+  const std::vector<Mn::Vector3>& positions = meshData.positions(0);
+  range.firstIndex = indices_.size();
+  range.indexCount = meshData.indices().size();
+  range.baseVertex = vertices_.size();
+  const size_t first = vertices_.size();
+  vertices_.resize(first + positions.size());
+  for (size_t v = 0; v < positions.size(); ++v) {
+    vertices_[first + v].position = positions[v];
+    vertices_[first + v].color = Mn::Color4{1};
+  }
+  if (meshData.hasTextureCoords2D()) {
+    const std::vector<Mn::Vector2>& textureCoordinates =
+        meshData.textureCoords2D(0);
+    for (size_t v = 0; v < textureCoordinates.size(); ++v) {
+      vertices_[first + v].textureCoordinates = textureCoordinates[v];
+    }
+  }
+  if (meshData.hasColors()) {
+    const std::vector<Mn::Color4>& colors = meshData.colors(0);
+    for (size_t v = 0; v < colors.size(); ++v) {
+      vertices_[first + v].color = colors[v];
+    }
+  }
+  indices_.insert(indices_.end(), meshData.indices().begin(),
+                  meshData.indices().end());
+  meshesDirty_ = true;
+  return &range;
+}
+
+const MultiDrawBatch::TextureSlot* MultiDrawBatch::getTextureSlot(
+    Mn::GL::Texture2D& texture) {
+#ifdef MAGNUM_TARGET_GLES
+  return nullptr;
+#else
+  auto found = textures_.find(&texture);
+  if (found != textures_.end()) {
+    return found->second.handle != 0 || found->second.array >= 0
+               ? &found->second
+               : nullptr;
+  }
+
+  // textures that cannot be batched are remembered with neither
+  TextureSlot& slot = textures_[&texture];
+  const bool bindless =
+      bindlessTextures_ &&
+      Mn::GL::Context::current()
+          .isExtensionSupported<Mn::GL::Extensions::ARB::bindless_texture>();
+  if (bindless) {
+    slot.handle = glGetTextureHandleARB(texture.id());
+    glMakeTextureHandleResidentARB(slot.handle);
+    return &slot;
+  }
+
+  // Magnum does not tell the format, levels and sampling of a texture
+  GLint format = 0;
+  GLint levels = 0;
+  GLint sampling[4]{};
+  Mn::GL::Context::current().resetState(
+      Mn::GL::Context::State::EnterExternal);
+  glBindTexture(GL_TEXTURE_2D, texture.id());
+  glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_INTERNAL_FORMAT,
+                           &format);
+  glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_IMMUTABLE_LEVELS, &levels);
+  for (int i = 0; i < 4; ++i) {
+    glGetTexParameteriv(GL_TEXTURE_2D, samplingParameters[i], &sampling[i]);
+  }
+  glBindTexture(GL_TEXTURE_2D, 0);
+  Mn::GL::Context::current().resetState(Mn::GL::Context::State::ExitExternal);
+  if (levels == 0) {
+    return nullptr;
+  }
+
+  const Mn::Vector2i size = texture.imageSize(0);
+  for (size_t i = 0; i <= textureArrays_.size(); ++i) {
+    if (i == textureArrays_.size()) {
+      textureArrays_.emplace_back();
+      textureArrays_.back().format = format;
+      textureArrays_.back().size = size;
+      textureArrays_.back().levels = levels;
+      std::copy(sampling, sampling + 4, textureArrays_.back().sampling);
+    }
+    TextureArray& array = textureArrays_[i];
+    if (array.format == Mn::UnsignedInt(format) && array.size == size &&
+        array.levels == levels &&
+        std::equal(sampling, sampling + 4, array.sampling)) {
+      slot.array = i;
+      slot.layer = array.layers.size();
+      array.layers.push_back(&texture);
+      array.dirty = true;
+      break;
+    }
+  }
+  return &slot;
+#endif
+}
+
+void MultiDrawBatch::uploadTextureArray(TextureArray& array) {
+#ifndef MAGNUM_TARGET_GLES
+  array.texture = Mn::GL::Texture2DArray{};
+  array.texture.setStorage(array.levels, Mn::GL::TextureFormat(array.format),
+                           {array.size, Mn::Int(array.layers.size())});
+  Mn::GL::Context::current().resetState(
+      Mn::GL::Context::State::EnterExternal);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, array.texture.id());
+  for (int i = 0; i < 4; ++i) {
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, samplingParameters[i],
+                    array.sampling[i]);
+  }
+  glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+  Mn::GL::Context::current().resetState(Mn::GL::Context::State::ExitExternal);
+  for (size_t layer = 0; layer < array.layers.size(); ++layer) {
+    for (int level = 0; level < array.levels; ++level) {
+      const Mn::Vector2i size = Mn::Math::max(array.size >> level, 1);
+      glCopyImageSubData(array.layers[layer]->id(), GL_TEXTURE_2D, level, 0, 0,
+                         0, array.texture.id(), GL_TEXTURE_2D_ARRAY, level, 0,
+                         0, layer, size.x(), size.y(), 1);
+    }
+  }
+  array.dirty = false;
+#endif
+}
+
+void MultiDrawBatch::uploadMeshes() {
+  vertexBuffer_.setData(
+      Corrade::Containers::arrayView(vertices_.data(), vertices_.size()),
+      Mn::GL::BufferUsage::StaticDraw);
+  indexBuffer_.setData(
+      Corrade::Containers::arrayView(indices_.data(), indices_.size()),
+      Mn::GL::BufferUsage::StaticDraw);
+  meshesDirty_ = false;
+}
+
+MagnumDrawableTransformations MultiDrawBatch::drawBatched(
+    MagnumCamera& camera,
+    const MagnumDrawableTransformations& transformations) {
+  lastMultiDrawCount_ = 0;
+  lastBatchedDrawableCount_ = 0;
+#ifdef MAGNUM_TARGET_GLES
+  return transformations;
+#else
+  using Flat3D = Mn::Shaders::Flat3D;
+
+  const bool bindless =
+      bindlessTextures_ &&
+      Mn::GL::Context::current()
+          .isExtensionSupported<Mn::GL::Extensions::ARB::bindless_texture>();
+
+  // the drawables the batch draws exactly like their own shader does, by
+  // texture array, -1 for none and for all bindless textures; the others are
+  // left to draw themselves
+  struct BatchedDrawable {
+    size_t index;
+    const MeshRange* mesh;
+    const TextureSlot* texture;
+  };
+  MagnumDrawableTransformations remaining;
+  std::map<int, std::vector<BatchedDrawable>> groups;
+  for (size_t i = 0; i < transformations.size(); ++i) {
+    MagnumDrawable& drawable = transformations[i].first.get();
+    GenericDrawable* generic = dynamic_cast<GenericDrawable*>(&drawable);
+    if (generic == nullptr || generic->meshData_ == nullptr) {
+      remaining.push_back(transformations[i]);
+      continue;
+    }
+    const Flat3D::Flags shaderFlags =
+        static_cast<Flat3D&>(generic->shader_).flags();
+    const bool textured =
+        (shaderFlags & Flat3D::Flag::Textured) && generic->texture_;
+    if (!(shaderFlags & Flat3D::Flag::ObjectId) ||
+        (shaderFlags & ~(Flat3D::Flag::ObjectId | Flat3D::Flag::Textured |
+                         Flat3D::Flag::VertexColor)) ||
+        ((shaderFlags & Flat3D::Flag::Textured) && !textured)) {
+      remaining.push_back(transformations[i]);
+      continue;
+    }
+    // the batch keeps the GL texture it was given, so placeholders of
+    // streamed textures draw themselves until the full texture replaces them
+    if (textured && !generic->requestTexture()) {
+      remaining.push_back(transformations[i]);
+      continue;
+    }
+    const MeshRange* range = getMeshRange(*generic->meshData_);
+    const TextureSlot* slot =
+        textured ? getTextureSlot(*generic->texture_) : nullptr;
+    if (range == nullptr || (textured && slot == nullptr)) {
+      remaining.push_back(transformations[i]);
+      continue;
+    }
+    groups[slot ? slot->array : -1].push_back({i, range, slot});
+  }
+  if (groups.empty()) {
+    return remaining;
+  }
+
+  if (!mesh_) {
+    vertexBuffer_ = Mn::GL::Buffer{Mn::GL::Buffer::TargetHint::Array};
+    indexBuffer_ = Mn::GL::Buffer{Mn::GL::Buffer::TargetHint::ElementArray};
+    drawIndexBuffer_ = Mn::GL::Buffer{Mn::GL::Buffer::TargetHint::Array};
+    drawBuffer_ = Mn::GL::Buffer{};
+    commandBuffer_ = Mn::GL::Buffer{};
+    mesh_ = std::make_unique<Mn::GL::Mesh>();
+    mesh_->setPrimitive(Mn::MeshPrimitive::Triangles)
+        .addVertexBuffer(vertexBuffer_, 0, Mn::Shaders::Generic3D::Position{},
+                         Mn::Shaders::Generic3D::TextureCoordinates{},
+                         Mn::Shaders::Generic3D::Color4{})
+        .addVertexBufferInstanced(drawIndexBuffer_, 1, 0,
+                                  MultiDrawFlatShader::DrawIndex{})
+        .setIndexBuffer(indexBuffer_, 0, Mn::MeshIndexType::UnsignedInt);
+  }
+  if (meshesDirty_) {
+    uploadMeshes();
+  }
+  for (TextureArray& array : textureArrays_) {
+    if (array.dirty) {
+      uploadTextureArray(array);
+    }
+  }
+  std::unique_ptr<MultiDrawFlatShader>& shader = shaders_[bindless];
+  if (!shader) {
+    shader = std::make_unique<MultiDrawFlatShader>(
+        bindless ? MultiDrawFlatShader::Flag::Bindless
+                 : MultiDrawFlatShader::Flags{});
+  }
+
+  std::vector<MultiDrawFlatShader::DrawData> draws;
+  std::vector<DrawCommand> commands;
+  for (const auto& group : groups) {
+    for (const BatchedDrawable& entry : group.second) {
+      const auto& transformation = transformations[entry.index];
+      GenericDrawable& drawable =
+          static_cast<GenericDrawable&>(transformation.first.get());
+      const bool vertexColor =
+          static_cast<Flat3D&>(drawable.shader_).flags() &
+          Flat3D::Flag::VertexColor;
+      MultiDrawFlatShader::DrawData draw{};
+      // the positions of the CPU mesh are not quantized
+      draw.transformation = transformation.second;
+      // GenericDrawable leaves the (white) shader color for vertex colors,
+      // which are white for meshes without them, like Flat3D's default
+      draw.color = vertexColor ? Mn::Color4{1} : drawable.color_;
+      draw.objectId = drawable.node_.getId();
+      if (vertexColor) {
+        draw.flags |= MultiDrawFlatShader::DrawVertexColor;
+      }
+      if (entry.texture) {
+        draw.flags |= MultiDrawFlatShader::DrawTextured;
+        if (bindless) {
+          draw.texture[0] = Mn::UnsignedInt(entry.texture->handle);
+          draw.texture[1] = Mn::UnsignedInt(entry.texture->handle >> 32);
+        } else {
+          draw.texture[0] = entry.texture->layer;
+        }
+      }
+      const Mn::UnsignedInt drawIndex = draws.size();
+      draws.push_back(draw);
+      commands.push_back({entry.mesh->indexCount, 1, entry.mesh->firstIndex,
+                          entry.mesh->baseVertex, drawIndex});
+    }
+  }
+
+  if (numDrawIndices_ < draws.size()) {
+    numDrawIndices_ = std::max(draws.size(), 2 * numDrawIndices_);
+    std::vector<Mn::UnsignedInt> drawIndices(numDrawIndices_);
+    std::iota(drawIndices.begin(), drawIndices.end(), 0);
+    drawIndexBuffer_.setData(
+        Corrade::Containers::arrayView(drawIndices.data(), drawIndices.size()),
+        Mn::GL::BufferUsage::StaticDraw);
+  }
+  drawBuffer_.setData(
+      Corrade::Containers::arrayView(draws.data(), draws.size()),
+      Mn::GL::BufferUsage::StreamDraw);
+  commandBuffer_.setData(
+      Corrade::Containers::arrayView(commands.data(), commands.size()),
+      Mn::GL::BufferUsage::StreamDraw);
+  shader->setProjectionMatrix(camera.projectionMatrix());
+
+  // Magnum has no multi-draw-indirect, so submit it directly with the
+  // vertex array of mesh_, telling Magnum to forget the state it tracks
+  Mn::GL::Context::current().resetState(
+      Mn::GL::Context::State::EnterExternal);
+  glUseProgram(shader->id());
+  glBindVertexArray(mesh_->id());
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer_.id());
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER,
+                   MultiDrawFlatShader::DrawBufferBinding, drawBuffer_.id());
+  glActiveTexture(GL_TEXTURE0);
+  size_t firstCommand = 0;
+  for (const auto& group : groups) {
+    if (group.first >= 0) {
+      glBindTexture(GL_TEXTURE_2D_ARRAY,
+                    textureArrays_[group.first].texture.id());
+    }
+    glMultiDrawElementsIndirect(
+        GL_TRIANGLES, GL_UNSIGNED_INT,
+        reinterpret_cast<const void*>(firstCommand * sizeof(DrawCommand)),
+        group.second.size(), 0);
+    firstCommand += group.second.size();
+  }
+  glBindVertexArray(0);
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+  Mn::GL::Context::current().resetState(Mn::GL::Context::State::ExitExternal);
+
+  lastMultiDrawCount_ = groups.size();
+  lastBatchedDrawableCount_ = draws.size();
+  return remaining;
+#endif
+}
+
+}  // namespace gfx
+}  // namespace esp
@@ -0,0 +1,154 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#pragma once
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include <Magnum/GL/Buffer.h>
+#include <Magnum/GL/Mesh.h>
+#include <Magnum/GL/TextureArray.h>
+#include <Magnum/Math/Color.h>
+#include <Magnum/Trade/Trade.h>
+
+#include "esp/core/esp.h"
+#include "esp/gfx/MultiDrawFlatShader.h"
+#include "magnum.h"
+
+namespace esp {
+namespace gfx {
+
+// Draws a drawable group like Camera3D::draw(), but submits the
+// GenericDrawables whose meshes have CPU geometry (see
+// GenericDrawable::setMeshData()) with glMultiDrawElementsIndirect(), however
+// many there are. Their meshes are packed once into shared vertex and index
+// buffers, and the transformations, colors, object IDs and textures of a
+// frame go into a shader storage buffer the shader reads per draw, so the
+// cost on the CPU and in the driver does not grow with the number of
+// drawables. With ARB_bindless_texture, textures are referenced by their
+// bindless handles and everything is a single multi-draw. Otherwise the
+// textures are copied into texture arrays of textures of the same format,
+// size and mip levels, with a multi-draw per array. Other drawables draw
+// themselves as usual, after the batched ones. Batched meshes are drawn at
+// full detail. Needs GL 4.3, see isSupported(); on GLES and WebGL nothing is
+// batched.
+class MultiDrawBatch {
+ public:
+  // whether the current context can draw batches
+  static bool isSupported();
+
+  void draw(MagnumCamera& camera, MagnumDrawableGroup& drawables);
+
+  // draw a subset of drawables, e.g. the visible ones, with transformations
+  // relative to camera
+  void draw(MagnumCamera& camera,
+            const MagnumDrawableTransformations& transformations);
+
+  // only draw the batched drawables and return the drawables left to draw
+  // one by one
+  MagnumDrawableTransformations drawBatched(
+      MagnumCamera& camera,
+      const MagnumDrawableTransformations& transformations);
+
+  // multi-draw calls and drawables they drew in the last drawBatched()
+  int getLastMultiDrawCount() const { return lastMultiDrawCount_; }
+  int getLastBatchedDrawableCount() const { return lastBatchedDrawableCount_; }
+
+  // meshes packed into the shared buffers
+  int getNumMeshes() const { return meshes_.size(); }
+
+  // use bindless texture handles when the context supports them (default
+  // on), otherwise texture arrays
+  void setBindlessTextures(bool enabled);
+  bool isBindlessTextures() const { return bindlessTextures_; }
+
+  // texture arrays the textures were copied into, 0 when they are bindless
+  int getNumTextureArrays() const { return textureArrays_.size(); }
+
+  // forget the packed meshes and textures, which has to be done before the
+  // mesh data or textures are destroyed and another may take their address
+  void clear();
+
+  ESP_SMART_POINTERS(MultiDrawBatch)
+
+ protected:
+  // a mesh in the shared buffers
+  struct MeshRange {
+    Magnum::UnsignedInt firstIndex = 0;
+    Magnum::UnsignedInt indexCount = 0;
+    Magnum::Int baseVertex = 0;
+    Magnum::UnsignedInt vertexCount = 0;
+  };
+
+  // the attributes of all meshes, white for meshes without vertex colors
+  struct Vertex {
+    Magnum::Vector3 position;
+    Magnum::Vector2 textureCoordinates;
+    Magnum::Color4 color;
+  };
+
+  // where the shader finds a texture: its bindless handle, or a layer of a
+  // texture array
+  struct TextureSlot {
+    Magnum::UnsignedLong handle = 0;
+    int array = -1;
+    Magnum::UnsignedInt layer = 0;
+  };
+
+  // textures of the same format, size, mip levels and sampling, copied into
+  // layers
+  struct TextureArray {
+    Magnum::UnsignedInt format = 0;
+    Magnum::Vector2i size;
+    int levels = 0;
+    // magnification and minification filter, wrapping in x and y
+    Magnum::Int sampling[4]{};
+    std::vector<Magnum::GL::Texture2D*> layers;
+    // recreated with all layers when layers are added
+    Magnum::GL::Texture2DArray texture{Magnum::NoCreate};
+    bool dirty = true;
+  };
+
+  // range of meshData in the shared buffers, packing it if it is new;
+  // nullptr for meshes that cannot be batched
+  const MeshRange* getMeshRange(const Magnum::Trade::MeshData3D& meshData);
+
+  // slot of texture, making it resident or adding it to an array if it is
+  // new; nullptr for textures without immutable storage, which cannot be
+  // copied
+  const TextureSlot* getTextureSlot(Magnum::GL::Texture2D& texture);
+
+  void uploadMeshes();
+
+  void uploadTextureArray(TextureArray& array);
+
+  std::unordered_map<const Magnum::Trade::MeshData3D*, MeshRange> meshes_;
+  // CPU copies of the shared buffers, uploaded again as meshes are added
+  std::vector<Vertex> vertices_;
+  std::vector<Magnum::UnsignedInt> indices_;
+  bool meshesDirty_ = false;
+
+  bool bindlessTextures_ = true;
+  std::unordered_map<Magnum::GL::Texture2D*, TextureSlot> textures_;
+  std::vector<TextureArray> textureArrays_;
+
+  int lastMultiDrawCount_ = 0;
+  int lastBatchedDrawableCount_ = 0;
+
+  // created with the first batch needing them
+  std::unique_ptr<MultiDrawFlatShader> shaders_[2];
+  std::unique_ptr<Magnum::GL::Mesh> mesh_;
+  Magnum::GL::Buffer vertexBuffer_{Magnum::NoCreate};
+  Magnum::GL::Buffer indexBuffer_{Magnum::NoCreate};
+  // 0, 1, 2, ..., the instanced draw index attribute
+  Magnum::GL::Buffer drawIndexBuffer_{Magnum::NoCreate};
+  size_t numDrawIndices_ = 0;
+  Magnum::GL::Buffer drawBuffer_{Magnum::NoCreate};
+  Magnum::GL::Buffer commandBuffer_{Magnum::NoCreate};
+};
+
+}  // namespace gfx
+}  // namespace esp
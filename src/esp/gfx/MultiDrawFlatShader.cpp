@@ -0,0 +1,94 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#include "MultiDrawFlatShader.h"
+
+#include <Corrade/Containers/Reference.h>
+#include <Corrade/Utility/Resource.h>
+#include <Magnum/GL/Shader.h>
+#include <Magnum/GL/TextureArray.h>
+#include <Magnum/GL/Version.h>
+#include <Magnum/Shaders/Generic.h>
+
+#include "ShaderCache.h"
+
+namespace Mn = Magnum;
+
+static void importShaderResources() {
+  CORRADE_RESOURCE_INITIALIZE(ShaderResources)
+}
+
+namespace esp {
+namespace gfx {
+
+namespace {
+enum { TextureLayer = 0 };
+}
+
+MultiDrawFlatShader::MultiDrawFlatShader(Flags flags) : flags_{flags} {
+  if (!Corrade::Utility::Resource::hasGroup("default-shaders")) {
+    importShaderResources();
+  }
+
+  const Corrade::Utility::Resource rs{"default-shaders"};
+
+  // the extension directive has to come before anything but the version
+  std::string defines;
+  if (flags & Flag::Bindless) {
+    defines +=
+        "#extension GL_ARB_bindless_texture : require\n"
+        "#define BINDLESS\n";
+  }
+
+  const std::string vertSource = defines + rs.get("flat-multidraw.vert");
+  const std::string fragSource = defines + rs.get("flat-multidraw.frag");
+  const std::string binaryKey =
+      programBinaryKey("flat-multidraw", {vertSource, fragSource});
+
+  if (!loadProgramBinary(*this, binaryKey)) {
+    Mn::GL::Shader vert{Mn::GL::Version::GL430, Mn::GL::Shader::Type::Vertex};
+    Mn::GL::Shader frag{Mn::GL::Version::GL430,
+                        Mn::GL::Shader::Type::Fragment};
+
+    vert.addSource(vertSource);
+    frag.addSource(fragSource);
+
+    CORRADE_INTERNAL_ASSERT_OUTPUT(Mn::GL::Shader::compile({vert, frag}));
+
+    attachShaders({vert, frag});
+
+    bindAttributeLocation(Mn::Shaders::Generic3D::Position::Location,
+                          "position");
+    bindAttributeLocation(Mn::Shaders::Generic3D::TextureCoordinates::Location,
+                          "textureCoordinates");
+    bindAttributeLocation(Mn::Shaders::Generic3D::Color4::Location,
+                          "vertexColor");
+    bindAttributeLocation(DrawIndex::Location, "drawIndex");
+
+    prepareProgramBinary(*this);
+    CORRADE_INTERNAL_ASSERT_OUTPUT(link());
+    saveProgramBinary(*this, binaryKey);
+  }
+
+  projectionMatrixUniform_ = uniformLocation("projectionMatrix");
+  if (!(flags & Flag::Bindless)) {
+    setUniform(uniformLocation("textureData"), TextureLayer);
+  }
+}
+
+MultiDrawFlatShader& MultiDrawFlatShader::setProjectionMatrix(
+    const Mn::Matrix4& matrix) {
+  setUniform(projectionMatrixUniform_, matrix);
+  return *this;
+}
+
+MultiDrawFlatShader& MultiDrawFlatShader::bindTexture(
+    Mn::GL::Texture2DArray& texture) {
+  CORRADE_INTERNAL_ASSERT(!(flags_ & Flag::Bindless));
+  texture.bind(TextureLayer);
+  return *this;
+}
+
+}  // namespace gfx
+}  // namespace esp
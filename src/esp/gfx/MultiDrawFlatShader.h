@@ -0,0 +1,101 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#pragma once
+
+#include <Corrade/Containers/EnumSet.h>
+#include <Magnum/GL/AbstractShaderProgram.h>
+#include <Magnum/GL/Attribute.h>
+#include <Magnum/Math/Matrix4.h>
+
+namespace esp {
+namespace gfx {
+
+/**
+@brief Flat shader drawing the meshes of a multi-draw in one call
+
+Gives the same output as @ref Magnum::Shaders::Flat3D with
+@ref Magnum::Shaders::Flat3D::Flag::ObjectId enabled, for each draw of a
+@cpp glMultiDrawElementsIndirect() @ce. The transformation, color, object ID,
+texture and flags of a draw are read from a shader storage buffer of
+@ref DrawData, at the index of the @ref DrawIndex attribute, which is an
+instanced attribute advanced by the base instance of the draw. Textures are
+bindless handles with @ref Flag::Bindless, layers of the bound texture array
+otherwise. Mesh attributes use the @ref Magnum::Shaders::Generic3D locations.
+Requires GL 4.3, and @gl_extension{ARB,bindless_texture} for
+@ref Flag::Bindless.
+*/
+class MultiDrawFlatShader : public Magnum::GL::AbstractShaderProgram {
+ public:
+  //! Index of the draw into the draw buffer
+  typedef Magnum::GL::Attribute<8, Magnum::UnsignedInt> DrawIndex;
+
+  //! Shader storage binding of the draw buffer
+  enum : uint8_t { DrawBufferBinding = 0 };
+
+  //! Color attachment location per output type
+  enum : uint8_t {
+    //! color output
+    ColorOutput = 0,
+    //! object id output
+    ObjectIdOutput = 1
+  };
+
+  //! Flags of a draw
+  enum : Magnum::UnsignedInt {
+    //! Multiply the color with the vertex color
+    DrawVertexColor = 1 << 0,
+    //! Multiply the color with the bound texture
+    DrawTextured = 1 << 1
+  };
+
+  //! A draw in the draw buffer, in std430 layout
+  struct DrawData {
+    //! Transformation relative to the camera
+    Magnum::Matrix4 transformation;
+    Magnum::Vector4 color;
+    Magnum::UnsignedInt objectId;
+    Magnum::UnsignedInt flags;
+    //! Bindless handle of the texture, low bits first, or its layer in the
+    //! texture array first
+    Magnum::UnsignedInt texture[2];
+  };
+
+  /** @brief Flag */
+  enum class Flag {
+    //! Textures are bindless handles rather than texture array layers
+    Bindless = 1 << 0
+  };
+
+  /** @brief Flags */
+  typedef Corrade::Containers::EnumSet<Flag> Flags;
+
+  /** @brief Constructor */
+  explicit MultiDrawFlatShader(Flags flags = {});
+
+  Flags flags() const { return flags_; }
+
+  /**
+   * @brief Set projection matrix
+   * @return Reference to self (for method chaining)
+   */
+  MultiDrawFlatShader& setProjectionMatrix(const Magnum::Matrix4& matrix);
+
+  /**
+   * @brief Bind the texture array of draws with @ref DrawTextured
+   * @return Reference to self (for method chaining)
+   *
+   * Expects that the shader was created without @ref Flag::Bindless.
+   */
+  MultiDrawFlatShader& bindTexture(Magnum::GL::Texture2DArray& texture);
+
+ private:
+  Flags flags_;
+  int projectionMatrixUniform_;
+};
+
+CORRADE_ENUMSET_OPERATORS(MultiDrawFlatShader::Flags)
+
+}  // namespace gfx
+}  // namespace esp
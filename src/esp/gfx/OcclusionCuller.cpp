@@ -0,0 +1,280 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#include "OcclusionCuller.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <Corrade/Containers/Reference.h>
+#include <Corrade/Utility/Resource.h>
+#include <Magnum/GL/Context.h>
+#include <Magnum/GL/OpenGL.h>
+#include <Magnum/GL/Shader.h>
+#include <Magnum/GL/TextureFormat.h>
+#include <Magnum/GL/Version.h>
+#include <Magnum/Image.h>
+#include <Magnum/PixelFormat.h>
+
+#include "Drawable.h"
+#include "ShaderCache.h"
+
+namespace Mn = Magnum;
+
+static void importShaderResources() {
+  CORRADE_RESOURCE_INITIALIZE(ShaderResources)
+}
+
+namespace esp {
+namespace gfx {
+
+namespace {
+enum { SourceTextureUnit = 0 };
+}
+
+HiZShader::HiZShader() {
+  if (!Corrade::Utility::Resource::hasGroup("default-shaders")) {
+    importShaderResources();
+  }
+
+  const Corrade::Utility::Resource rs{"default-shaders"};
+
+  const std::string vertSource = rs.get("hiz.vert");
+  const std::string fragSource = rs.get("hiz.frag");
+  const std::string binaryKey =
+      programBinaryKey("hiz", {vertSource, fragSource});
+
+  if (!loadProgramBinary(*this, binaryKey)) {
+    Mn::GL::Shader vert{Mn::GL::Version::GL410, Mn::GL::Shader::Type::Vertex};
+    Mn::GL::Shader frag{Mn::GL::Version::GL410,
+                        Mn::GL::Shader::Type::Fragment};
+
+    vert.addSource(vertSource);
+    frag.addSource(fragSource);
+
+    CORRADE_INTERNAL_ASSERT_OUTPUT(Mn::GL::Shader::compile({vert, frag}));
+
+    attachShaders({vert, frag});
+
+    prepareProgramBinary(*this);
+    CORRADE_INTERNAL_ASSERT_OUTPUT(link());
+    saveProgramBinary(*this, binaryKey);
+  }
+
+  setUniform(uniformLocation("sourceTexture"), SourceTextureUnit);
+}
+
+HiZShader& HiZShader::bindSourceTexture(Mn::GL::Texture2D& texture) {
+  texture.bind(SourceTextureUnit);
+  return *this;
+}
+
+bool OcclusionCuller::isSupported() {
+#ifdef MAGNUM_TARGET_GLES
+  return false;
+#else
+  return true;
+#endif
+}
+
+OcclusionCuller::Footprint OcclusionCuller::footprint(
+    const Mn::Matrix4& transformationProjection,
+    const Mn::Range3D& box) {
+  Footprint footprint;
+  footprint.bounded = true;
+  Mn::Vector2 min{1.0f};
+  Mn::Vector2 max{0.0f};
+  float depth = 1.0f;
+  for (int corner = 0; corner < 8; ++corner) {
+    const Mn::Vector3 point{corner & 1 ? box.max().x() : box.min().x(),
+                            corner & 2 ? box.max().y() : box.min().y(),
+                            corner & 4 ? box.max().z() : box.min().z()};
+    const Mn::Vector4 clip =
+        transformationProjection * Mn::Vector4{point, 1.0f};
+    if (clip.w() <= 1.0e-6f) {
+      // behind the camera, where projecting folds the box over
+      footprint.clipsNear = true;
+      footprint.rect = {{0.0f, 0.0f}, {1.0f, 1.0f}};
+      footprint.area = 1.0f;
+      return footprint;
+    }
+    const Mn::Vector3 ndc = clip.xyz() / clip.w();
+    min = Mn::Math::min(min, ndc.xy() * 0.5f + Mn::Vector2{0.5f});
+    max = Mn::Math::max(max, ndc.xy() * 0.5f + Mn::Vector2{0.5f});
+    depth = std::min(depth, ndc.z() * 0.5f + 0.5f);
+  }
+  footprint.rect = {Mn::Math::clamp(min, 0.0f, 1.0f),
+                    Mn::Math::clamp(max, 0.0f, 1.0f)};
+  footprint.depth = std::max(depth, 0.0f);
+  footprint.area = footprint.rect.size().product();
+  return footprint;
+}
+
+void OcclusionCuller::resize(const Mn::Vector2i& size) {
+  size_ = size;
+  depthTexture_ = Mn::GL::Texture2D{};
+  depthTexture_.setMinificationFilter(Mn::GL::SamplerFilter::Nearest)
+      .setMagnificationFilter(Mn::GL::SamplerFilter::Nearest)
+      .setStorage(1, Mn::GL::TextureFormat::DepthComponent32F, size);
+  framebuffer_ = Mn::GL::Framebuffer{{{}, size}};
+  framebuffer_
+      .attachTexture(Mn::GL::Framebuffer::BufferAttachment::Depth,
+                     depthTexture_, 0)
+      .mapForDraw(Mn::GL::Framebuffer::DrawAttachment::None);
+  CORRADE_INTERNAL_ASSERT(
+      framebuffer_.checkStatus(Mn::GL::FramebufferTarget::Draw) ==
+      Mn::GL::Framebuffer::Status::Complete);
+
+  levels_.clear();
+  Mn::Vector2i levelSize = size;
+  while (levelSize.max() > 1) {
+    levelSize = (levelSize + Mn::Vector2i{1}) / 2;
+    levels_.emplace_back();
+    Level& level = levels_.back();
+    level.size = levelSize;
+    level.texture = Mn::GL::Texture2D{};
+    level.texture.setMinificationFilter(Mn::GL::SamplerFilter::Nearest)
+        .setMagnificationFilter(Mn::GL::SamplerFilter::Nearest)
+        .setStorage(1, Mn::GL::TextureFormat::R32F, levelSize);
+    level.framebuffer = Mn::GL::Framebuffer{{{}, levelSize}};
+    level.framebuffer
+        .attachTexture(Mn::GL::Framebuffer::ColorAttachment{0}, level.texture,
+                       0)
+        .mapForDraw(Mn::GL::Framebuffer::ColorAttachment{0})
+        .mapForRead(Mn::GL::Framebuffer::ColorAttachment{0});
+    CORRADE_INTERNAL_ASSERT(
+        level.framebuffer.checkStatus(Mn::GL::FramebufferTarget::Draw) ==
+        Mn::GL::Framebuffer::Status::Complete);
+  }
+}
+
+bool OcclusionCuller::occluded(const Footprint& footprint) const {
+  if (!footprint.bounded || footprint.clipsNear || levels_.empty()) {
+    return false;
+  }
+  // the covered texels of the depth buffer, then of the first level where
+  // they are at most 4x4
+  const Mn::Vector2i last = size_ - Mn::Vector2i{1};
+  Mn::Vector2i min = Mn::Math::clamp(
+      Mn::Vector2i{footprint.rect.min() * Mn::Vector2{size_}}, {}, last);
+  Mn::Vector2i max = Mn::Math::clamp(
+      Mn::Vector2i{footprint.rect.max() * Mn::Vector2{size_}}, {}, last);
+  size_t index = 0;
+  for (;; ++index) {
+    min /= 2;
+    max /= 2;
+    if ((max - min).max() < 4 || index + 1 == levels_.size()) {
+      break;
+    }
+  }
+  const Level& level = levels_[index];
+  for (int y = min.y(); y <= max.y(); ++y) {
+    for (int x = min.x(); x <= max.x(); ++x) {
+      if (footprint.depth <= level.depths[y * level.size.x() + x]) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+int OcclusionCuller::cull(MagnumCamera& camera,
+                          MagnumDrawableTransformations& transformations) {
+  lastOccluderCount_ = 0;
+#ifdef MAGNUM_TARGET_GLES
+  return 0;
+#else
+  const Mn::Matrix4& projection = camera.projectionMatrix();
+  std::vector<Footprint> footprints(transformations.size());
+  std::vector<size_t> occluders;
+  for (size_t i = 0; i < transformations.size(); ++i) {
+    Drawable* drawable =
+        dynamic_cast<Drawable*>(&transformations[i].first.get());
+    if (drawable == nullptr || !drawable->getLocalBoundingBox()) {
+      continue;
+    }
+    footprints[i] = footprint(projection * transformations[i].second,
+                              *drawable->getLocalBoundingBox());
+    if (footprints[i].area >= minOccluderArea_) {
+      occluders.push_back(i);
+    }
+  }
+  if (occluders.empty()) {
+    return 0;
+  }
+  std::stable_sort(occluders.begin(), occluders.end(),
+                   [&footprints](size_t a, size_t b) {
+                     return footprints[a].area > footprints[b].area;
+                   });
+  if (occluders.size() > size_t(maxOccluders_)) {
+    occluders.resize(maxOccluders_);
+  }
+
+  // the pass draws into framebuffers of its own, which Magnum would not
+  // rebind the caller's from
+  GLint boundFramebuffer = 0;
+  GLint boundViewport[4]{};
+  glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &boundFramebuffer);
+  glGetIntegerv(GL_VIEWPORT, boundViewport);
+
+  const Mn::Vector2i size =
+      Mn::Math::max(camera.viewport() / 4, Mn::Vector2i{1});
+  if (size != size_) {
+    resize(size);
+  }
+  if (!depthShader_) {
+    depthShader_ = std::make_unique<Mn::Shaders::Flat3D>();
+    hiZShader_ = std::make_unique<HiZShader>();
+    fullScreenTriangle_ = Mn::GL::Mesh{};
+    fullScreenTriangle_.setCount(3);
+  }
+
+  framebuffer_.clearDepth(1.0f).bind();
+  for (const size_t i : occluders) {
+    static_cast<Drawable&>(transformations[i].first.get())
+        .drawDepth(transformations[i].second, camera, *depthShader_);
+  }
+  lastOccluderCount_ = occluders.size();
+
+  // reduce, then read the levels back, which waits for the GPU only once
+  for (size_t i = 0; i < levels_.size(); ++i) {
+    levels_[i].framebuffer.bind();
+    hiZShader_->bindSourceTexture(i == 0 ? depthTexture_
+                                         : levels_[i - 1].texture);
+    fullScreenTriangle_.draw(*hiZShader_);
+  }
+  for (Level& level : levels_) {
+    Mn::Image2D image =
+        level.framebuffer.read({{}, level.size}, {Mn::PixelFormat::R32F});
+    const auto pixels = image.pixels<Mn::Float>();
+    level.depths.resize(level.size.product());
+    for (int y = 0; y < level.size.y(); ++y) {
+      for (int x = 0; x < level.size.x(); ++x) {
+        level.depths[y * level.size.x() + x] = pixels[y][x];
+      }
+    }
+  }
+
+  Mn::GL::Context::current().resetState(
+      Mn::GL::Context::State::EnterExternal);
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, boundFramebuffer);
+  glViewport(boundViewport[0], boundViewport[1], boundViewport[2],
+             boundViewport[3]);
+  Mn::GL::Context::current().resetState(Mn::GL::Context::State::ExitExternal);
+
+  MagnumDrawableTransformations visible;
+  visible.reserve(transformations.size());
+  for (size_t i = 0; i < transformations.size(); ++i) {
+    if (!occluded(footprints[i])) {
+      visible.push_back(transformations[i]);
+    }
+  }
+  const int numOccluded = transformations.size() - visible.size();
+  transformations = std::move(visible);
+  return numOccluded;
+#endif
+}
+
+}  // namespace gfx
+}  // namespace esp
@@ -0,0 +1,121 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include <Magnum/GL/AbstractShaderProgram.h>
+#include <Magnum/GL/Framebuffer.h>
+#include <Magnum/GL/Mesh.h>
+#include <Magnum/GL/Texture.h>
+#include <Magnum/Shaders/Flat.h>
+
+#include "esp/core/esp.h"
+#include "magnum.h"
+
+namespace esp {
+namespace gfx {
+
+/**
+@brief Hierarchical-Z reduction shader
+
+Draws a full-screen triangle into a level of half the size of the bound
+source texture, rounded up, writing the maximum of the 2x2 texels below each
+fragment.
+*/
+class HiZShader : public Magnum::GL::AbstractShaderProgram {
+ public:
+  /** @brief Constructor */
+  explicit HiZShader();
+
+  /**
+   * @brief Bind the level below, a depth or R32F texture
+   * @return Reference to self (for method chaining)
+   */
+  HiZShader& bindSourceTexture(Magnum::GL::Texture2D& texture);
+};
+
+// Hierarchical-Z occlusion culling. The depth of the drawables covering most
+// of the view, the occluders, is drawn into a depth buffer of a quarter of
+// the frame resolution and reduced on the GPU into a pyramid of farthest
+// depths, which is read back. A drawable is culled when the nearest depth of
+// its bounding box lies behind the farthest occluder depth over the area the
+// box covers, looked up at the level where that area spans a few texels.
+// Occluders come from the frame itself, so sensors that jump between poses
+// need no history of frames. Drawables without a bounding box, and boxes
+// reaching behind the near plane, are never culled. The lower resolution can
+// cull objects seen only through gaps of less than 4 pixels. Not available on
+// OpenGL ES and WebGL.
+class OcclusionCuller {
+ public:
+  static bool isSupported();
+
+  // Remove the drawables hidden behind occluders from transformations, which
+  // are relative to camera, keeping the order of the others. Draws the frame
+  // at the size of the camera viewport, and leaves the bound framebuffer and
+  // its viewport as they were. Returns the number of drawables removed
+  int cull(MagnumCamera& camera,
+           MagnumDrawableTransformations& transformations);
+
+  // The most drawables drawn as occluders (default 32), largest on screen
+  // first
+  void setMaxOccluders(int maxOccluders) { maxOccluders_ = maxOccluders; }
+  int getMaxOccluders() const { return maxOccluders_; }
+
+  // Fraction of the frame the bounding box of a drawable has to cover for it
+  // to be an occluder (default 0.02)
+  void setMinOccluderArea(float area) { minOccluderArea_ = area; }
+  float getMinOccluderArea() const { return minOccluderArea_; }
+
+  // occluders drawn by the last cull()
+  int getLastOccluderCount() const { return lastOccluderCount_; }
+
+ protected:
+  // where a bounding box lands on screen
+  struct Footprint {
+    bool bounded = false;
+    bool clipsNear = false;
+    // in [0, 1] of the frame, y up
+    Magnum::Range2D rect;
+    // window depth of the nearest corner
+    float depth = 0.0f;
+    float area = 0.0f;
+  };
+
+  struct Level {
+    Magnum::Vector2i size;
+    Magnum::GL::Texture2D texture{Magnum::NoCreate};
+    Magnum::GL::Framebuffer framebuffer{Magnum::NoCreate};
+    // farthest depths read back, rows bottom up
+    std::vector<float> depths;
+  };
+
+  static Footprint footprint(const Magnum::Matrix4& transformationProjection,
+                             const Magnum::Range3D& box);
+
+  void resize(const Magnum::Vector2i& size);
+
+  bool occluded(const Footprint& footprint) const;
+
+  int maxOccluders_ = 32;
+  float minOccluderArea_ = 0.02f;
+  int lastOccluderCount_ = 0;
+
+  // occluder depth and the levels reduced from it, each half the size of
+  // the one before down to 1x1, created with the first cull()
+  Magnum::Vector2i size_;
+  Magnum::GL::Texture2D depthTexture_{Magnum::NoCreate};
+  Magnum::GL::Framebuffer framebuffer_{Magnum::NoCreate};
+  std::vector<Level> levels_;
+  std::unique_ptr<Magnum::Shaders::Flat3D> depthShader_;
+  std::unique_ptr<HiZShader> hiZShader_;
+  Magnum::GL::Mesh fullScreenTriangle_{Magnum::NoCreate};
+
+  ESP_SMART_POINTERS(OcclusionCuller)
+};
+
+}  // namespace gfx
+}  // namespace esp
@@ -17,6 +17,8 @@ PTexMeshDrawable::PTexMeshDrawable(
     Magnum::SceneGraph::DrawableGroup3D* group /* = nullptr */)
     : Drawable{node, shader, ptexMeshData.getRenderingBuffer(submeshID)->mesh,
                group},
+      ptexMeshData_(ptexMeshData),
+      submeshID_(submeshID),
       tex_(ptexMeshData.getRenderingBuffer(submeshID)->tex),
       adjTex_(ptexMeshData.getRenderingBuffer(submeshID)->adjTex),
       tileSize_(ptexMeshData.tileSize()),
@@ -24,11 +26,28 @@ PTexMeshDrawable::PTexMeshDrawable(
 
 void PTexMeshDrawable::draw(const Magnum::Matrix4& transformationMatrix,
                             Magnum::SceneGraph::Camera3D& camera) {
-  adjTex_.bind(1);
+  DrawState state;
+  draw(transformationMatrix, camera, state);
+}
+
+void PTexMeshDrawable::draw(const Magnum::Matrix4& transformationMatrix,
+                            Magnum::SceneGraph::Camera3D& camera,
+                            DrawState& state) {
+  // streamed atlases are uploaded once their submesh is first in view
+  ptexMeshData_.uploadAtlas(submeshID_);
   PTexMeshShader& ptexMeshShader = static_cast<PTexMeshShader&>(shader_);
-  ptexMeshShader.bindTexture(tex_, 0)
-      .setPTexUniforms(tex_, tileSize_, exposure_)
-      .setMVPMatrix(camera.projectionMatrix() * transformationMatrix);
+  if (state.shader != &shader_) {
+    state = DrawState{};
+    state.shader = &shader_;
+  }
+  // the adjacency texture and the uniforms belong to the atlas texture
+  if (state.texture != &tex_) {
+    adjTex_.bind(1);
+    ptexMeshShader.bindTexture(tex_, 0).setPTexUniforms(tex_, tileSize_,
+                                                        exposure_);
+    state.texture = &tex_;
+  }
+  ptexMeshShader.setMVPMatrix(camera.projectionMatrix() * transformationMatrix);
   mesh_.draw(ptexMeshShader);
 }
 
@@ -24,10 +24,28 @@ class PTexMeshDrawable : public Drawable {
       int submeshID,
       Magnum::SceneGraph::DrawableGroup3D* group = nullptr);
 
+  virtual Magnum::GL::AbstractTexture* getTexture() override {
+    return &tex_;
+  }
+
+  virtual void draw(const Magnum::Matrix4& transformationMatrix,
+                    Magnum::SceneGraph::Camera3D& camera,
+                    DrawState& state) override;
+
+  //! The adjacency primitives need the geometry shader of PTexMeshShader, so
+  //! PTex meshes draw as usual
+  virtual void drawDepth(const Magnum::Matrix4& transformationMatrix,
+                         Magnum::SceneGraph::Camera3D& camera,
+                         Magnum::Shaders::Flat3D&) override {
+    draw(transformationMatrix, camera);
+  }
+
  protected:
   virtual void draw(const Magnum::Matrix4& transformationMatrix,
                     Magnum::SceneGraph::Camera3D& camera) override;
 
+  assets::PTexMeshData& ptexMeshData_;
+  int submeshID_;
   Magnum::GL::Texture2D& tex_;
   Magnum::GL::BufferTexture& adjTex_;
   uint32_t tileSize_;
@@ -20,6 +20,7 @@
 #include "esp/assets/PTexMeshData.h"
 #include "esp/core/esp.h"
 #include "esp/io/io.h"
+#include "esp/gfx/ShaderCache.h"
 
 // This is to import the "resources" at runtime. // When the resource is
 // compiled into static library, it must be explicitly initialized via this
@@ -43,19 +44,35 @@ PTexMeshShader::PTexMeshShader() {
   // this is not the file name, but the group name in the config file
   const Corrade::Utility::Resource rs{"default-shaders"};
 
-  GL::Shader vert{GL::Version::GL410, GL::Shader::Type::Vertex};
-  GL::Shader geom{GL::Version::GL410, GL::Shader::Type::Geometry};
-  GL::Shader frag{GL::Version::GL410, GL::Shader::Type::Fragment};
+  const std::string vertSource = rs.get("ptex-default-gl410.vert");
+  const std::string geomSource = rs.get("ptex-default-gl410.geom");
+  const std::string fragSource = rs.get("ptex-default-gl410.frag");
+  const std::string binaryKey =
+      programBinaryKey("ptex-default", {vertSource, geomSource, fragSource});
 
-  vert.addSource(rs.get("ptex-default-gl410.vert"));
-  geom.addSource(rs.get("ptex-default-gl410.geom"));
-  frag.addSource(rs.get("ptex-default-gl410.frag"));
+  if (!loadProgramBinary(*this, binaryKey)) {
+    GL::Shader vert{GL::Version::GL410, GL::Shader::Type::Vertex};
+    GL::Shader geom{GL::Version::GL410, GL::Shader::Type::Geometry};
+    GL::Shader frag{GL::Version::GL410, GL::Shader::Type::Fragment};
 
-  CORRADE_INTERNAL_ASSERT_OUTPUT(GL::Shader::compile({vert, geom, frag}));
+    vert.addSource(vertSource);
+    geom.addSource(geomSource);
+    frag.addSource(fragSource);
 
-  attachShaders({vert, geom, frag});
+    CORRADE_INTERNAL_ASSERT_OUTPUT(GL::Shader::compile({vert, geom, frag}));
 
-  CORRADE_INTERNAL_ASSERT_OUTPUT(link());
+    attachShaders({vert, geom, frag});
+
+    prepareProgramBinary(*this);
+    CORRADE_INTERNAL_ASSERT_OUTPUT(link());
+    saveProgramBinary(*this, binaryKey);
+  }
+
+  mvpUniform_ = uniformLocation("MVP");
+  atlasTexUniform_ = uniformLocation("atlasTex");
+  tileSizeUniform_ = uniformLocation("tileSize");
+  widthInTilesUniform_ = uniformLocation("widthInTiles");
+  exposureUniform_ = uniformLocation("exposure");
 }
 
 }  // namespace gfx
@@ -34,7 +34,7 @@ class PTexMeshShader : public Magnum::GL::AbstractShaderProgram {
   }
 
   PTexMeshShader& setMVPMatrix(const Magnum::Matrix4& matrix) {
-    setUniform(uniformLocation("MVP"), matrix);
+    setUniform(mvpUniform_, matrix);
     return *this;
   }
 
@@ -50,18 +50,25 @@ class PTexMeshShader : public Magnum::GL::AbstractShaderProgram {
   PTexMeshShader& setPTexUniforms(Magnum::GL::Texture2D& tex,
                                   uint32_t tileSize,
                                   float exposure) {
-    setUniform(uniformLocation("atlasTex"), 0);
-    setUniform(uniformLocation("tileSize"), static_cast<int>(tileSize));
+    setUniform(atlasTexUniform_, 0);
+    setUniform(tileSizeUniform_, static_cast<int>(tileSize));
     // Image size in given mip level 0
     {
       int mipLevel = 0;
       int widthEntry = 0;
       const auto width = tex.imageSize(mipLevel)[widthEntry];
-      setUniform(uniformLocation("widthInTiles"), int(width / tileSize));
+      setUniform(widthInTilesUniform_, int(width / tileSize));
     }
-    setUniform(uniformLocation("exposure"), exposure);
+    setUniform(exposureUniform_, exposure);
     return *this;
   }
+
+ private:
+  int mvpUniform_;
+  int atlasTexUniform_;
+  int tileSizeUniform_;
+  int widthInTilesUniform_;
+  int exposureUniform_;
 };
 
 }  // namespace gfx
@@ -0,0 +1,152 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#include "PerfHud.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <utility>
+
+#include <Magnum/GL/Renderer.h>
+#include <Magnum/Math/Color.h>
+
+namespace Mn = Magnum;
+using namespace Mn::Math::Literals;
+
+namespace esp {
+namespace gfx {
+
+namespace {
+// frame time at the top of the graph, which takes a quarter of the window
+constexpr double graphFullScaleMs = 50.0;
+constexpr float graphHeight = 0.5f;
+
+// y of ms in normalized device coordinates
+float graphY(double ms) {
+  return -1.0f + graphHeight * float(std::min(ms, graphFullScaleMs) /
+                                     graphFullScaleMs);
+}
+
+void addQuad(std::vector<Mn::Vector2>& vertices,
+             float x0,
+             float y0,
+             float x1,
+             float y1) {
+  if (y1 <= y0) {
+    return;
+  }
+  vertices.insert(vertices.end(), {{x0, y0},
+                                   {x1, y0},
+                                   {x1, y1},
+                                   {x0, y0},
+                                   {x1, y1},
+                                   {x0, y1}});
+}
+}  // namespace
+
+PerfHud::PerfHud(int numFrames) : numFrames_(std::max(numFrames, 1)) {
+  for (int layer = 0; layer < NumLayers; ++layer) {
+    meshes_[layer]
+        .setPrimitive(Mn::GL::MeshPrimitive::Triangles)
+        .addVertexBuffer(buffers_[layer], 0, Mn::Shaders::Flat2D::Position{});
+  }
+}
+
+void PerfHud::addFrame(const FrameTiming& frame) {
+  frames_.push_back(frame);
+  while (frames_.size() > numFrames_) {
+    frames_.pop_front();
+  }
+}
+
+FrameTiming PerfHud::getAverage(int numFrames) const {
+  FrameTiming average;
+  const int count = std::min<int>(numFrames, frames_.size());
+  int gpuCount = 0;
+  for (auto it = frames_.end() - count; it != frames_.end(); ++it) {
+    average.cpuMs += it->cpuMs;
+    average.physicsMs += it->physicsMs;
+    average.navMs += it->navMs;
+    average.drawMs += it->drawMs;
+    average.gpuMs += it->gpuMs;
+    gpuCount += it->gpuMs > 0.0;
+    average.drawCalls += it->drawCalls;
+    average.triangles += it->triangles;
+    average.activeBodies += it->activeBodies;
+  }
+  if (count > 0) {
+    average.cpuMs /= count;
+    average.physicsMs /= count;
+    average.navMs /= count;
+    average.drawMs /= count;
+    average.drawCalls /= count;
+    average.triangles /= count;
+    average.activeBodies /= count;
+  }
+  // the latest frames have no GPU time yet
+  if (gpuCount > 0) {
+    average.gpuMs /= gpuCount;
+  }
+  return average;
+}
+
+std::string PerfHud::getSummary() const {
+  const FrameTiming average = getAverage();
+  char summary[256];
+  std::snprintf(summary, sizeof(summary),
+                "CPU %.1f ms (physics %.1f, nav %.2f, draw %.1f) | GPU %.1f "
+                "ms | %d draws, %.2fM triangles | %d active bodies",
+                average.cpuMs, average.physicsMs, average.navMs,
+                average.drawMs, average.gpuMs, average.drawCalls,
+                average.triangles / 1e6, average.activeBodies);
+  return summary;
+}
+
+void PerfHud::draw(const Mn::Vector2i& framebufferSize) {
+  std::vector<Mn::Vector2> vertices[NumLayers];
+  const float slot = 2.0f / numFrames_;
+  // the newest frame is on the right
+  float x = 1.0f - slot * frames_.size();
+  for (const FrameTiming& frame : frames_) {
+    // CPU time stacked in the left half of the slot, GPU time to its right
+    const double otherMs = std::max(
+        frame.cpuMs - frame.physicsMs - frame.navMs - frame.drawMs, 0.0);
+    double ms = 0.0;
+    const std::pair<Layer, double> stack[] = {{Physics, frame.physicsMs},
+                                              {Nav, frame.navMs},
+                                              {Draw, frame.drawMs},
+                                              {OtherCpu, otherMs}};
+    for (const auto& part : stack) {
+      addQuad(vertices[part.first], x, graphY(ms), x + 0.5f * slot,
+              graphY(ms + part.second));
+      ms += part.second;
+    }
+    addQuad(vertices[Gpu], x + 0.5f * slot, graphY(0.0), x + 0.9f * slot,
+            graphY(frame.gpuMs));
+    x += slot;
+  }
+  const float lineHeight = 2.0f / std::max(framebufferSize.y(), 1);
+  for (double ms : {1000.0 / 60.0, 1000.0 / 30.0}) {
+    addQuad(vertices[Guides], -1.0f, graphY(ms), 1.0f,
+            graphY(ms) + lineHeight);
+  }
+
+  const Mn::Color3 colors[NumLayers] = {0xff8800_rgbf, 0x33cc33_rgbf,
+                                        0x3399ff_rgbf, 0x999999_rgbf,
+                                        0xcc44cc_rgbf, 0xffffff_rgbf};
+  Mn::GL::Renderer::disable(Mn::GL::Renderer::Feature::DepthTest);
+  for (int layer = 0; layer < NumLayers; ++layer) {
+    if (vertices[layer].empty()) {
+      continue;
+    }
+    buffers_[layer].setData(vertices[layer], Mn::GL::BufferUsage::StreamDraw);
+    meshes_[layer].setCount(vertices[layer].size());
+    shader_.setColor(colors[layer]);
+    meshes_[layer].draw(shader_);
+  }
+  Mn::GL::Renderer::enable(Mn::GL::Renderer::Feature::DepthTest);
+}
+
+}  // namespace gfx
+}  // namespace esp
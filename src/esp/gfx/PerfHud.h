@@ -0,0 +1,71 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include <Magnum/GL/Buffer.h>
+#include <Magnum/GL/Mesh.h>
+#include <Magnum/Shaders/Flat.h>
+
+#include "esp/core/esp.h"
+
+namespace esp {
+namespace gfx {
+
+//! Where the time of one frame of the viewer went
+struct FrameTiming {
+  //! the whole frame on the CPU, the others included
+  double cpuMs = 0.0;
+  double physicsMs = 0.0;
+  //! pathfinding queries of the frame, e.g. moves snapped to the navmesh
+  double navMs = 0.0;
+  //! culling and submitting the draws
+  double drawMs = 0.0;
+  //! 0 until the GPU timer query of the frame arrived, see RenderStats
+  double gpuMs = 0.0;
+  int drawCalls = 0;
+  uint64_t triangles = 0;
+  int activeBodies = 0;
+};
+
+// Heads-up display of the frame timings of the viewer: a graph of the last
+// frames along the bottom of the window, one bar per frame stacking its
+// physics, pathfinding, drawing and other CPU time, next to a bar of its GPU
+// time, under lines at 60 and 30 frames per second. Drawn with a flat
+// shader, so it needs no fonts; getSummary() gives the numbers as text,
+// e.g. for the title bar.
+class PerfHud {
+ public:
+  explicit PerfHud(int numFrames = 240);
+
+  void addFrame(const FrameTiming& frame);
+
+  //! The mean of the last numFrames frames
+  FrameTiming getAverage(int numFrames = 30) const;
+
+  //! getAverage() as one line of text
+  std::string getSummary() const;
+
+  //! Draw over the default framebuffer, which must be bound
+  void draw(const Magnum::Vector2i& framebufferSize);
+
+ private:
+  enum Layer { Physics, Nav, Draw, OtherCpu, Gpu, Guides, NumLayers };
+
+  int numFrames_;
+  std::deque<FrameTiming> frames_;
+  Magnum::Shaders::Flat2D shader_;
+  Magnum::GL::Buffer buffers_[NumLayers];
+  Magnum::GL::Mesh meshes_[NumLayers];
+
+  ESP_SMART_POINTERS(PerfHud)
+};
+
+}  // namespace gfx
+}  // namespace esp
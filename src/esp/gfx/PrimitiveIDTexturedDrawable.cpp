@@ -4,6 +4,7 @@
 
 #include "PrimitiveIDTexturedDrawable.h"
 #include "PrimitiveIDTexturedShader.h"
+#include "ShaderCache.h"
 #include "esp/scene/SceneNode.h"
 
 namespace esp {
@@ -17,17 +18,52 @@ PrimitiveIDTexturedDrawable::PrimitiveIDTexturedDrawable(
     Magnum::GL::Texture2D* texture /* = nullptr */)
     : Drawable{node, shader, mesh, group}, texture_(texture) {}
 
+void PrimitiveIDTexturedDrawable::setIdRemap(IdRemap* idRemap) {
+  idRemap_ = idRemap;
+  remapShader_ = nullptr;
+  if (idRemap_ != nullptr) {
+    remapShader_ = getShaderVariant<PrimitiveIDTexturedShader>(
+        "primitive-id-textured",
+        static_cast<PrimitiveIDTexturedShader&>(shader_).flags() |
+            PrimitiveIDTexturedShader::Flag::IdRemap);
+  }
+}
+
+Magnum::GL::AbstractShaderProgram& PrimitiveIDTexturedDrawable::getShader() {
+  if (remapShader_) {
+    return *remapShader_;
+  }
+  return shader_;
+}
+
 void PrimitiveIDTexturedDrawable::draw(
     const Magnum::Matrix4& transformationMatrix,
     Magnum::SceneGraph::Camera3D& camera) {
+  DrawState state;
+  draw(transformationMatrix, camera, state);
+}
+
+void PrimitiveIDTexturedDrawable::draw(
+    const Magnum::Matrix4& transformationMatrix,
+    Magnum::SceneGraph::Camera3D& camera,
+    DrawState& state) {
   PrimitiveIDTexturedShader& shader =
-      static_cast<PrimitiveIDTexturedShader&>(shader_);
-  shader
-      .setTransformationProjectionMatrix(camera.projectionMatrix() *
-                                         transformationMatrix)
-      .bindTexture(*texture_);
+      static_cast<PrimitiveIDTexturedShader&>(getShader());
+  if (state.shader != &shader) {
+    state = DrawState{};
+    state.shader = &shader;
+  }
+  shader.setTransformationProjectionMatrix(camera.projectionMatrix() *
+                                           transformationMatrix);
+  if (texture_ != nullptr && state.texture != texture_) {
+    shader.bindTexture(*texture_);
+    state.texture = texture_;
+  }
+  if (idRemap_ != nullptr) {
+    shader.bindIdRemap(*idRemap_);
+  }
 
-  mesh_.draw(shader_);
+  mesh_.draw(shader);
 }
 
 }  // namespace gfx
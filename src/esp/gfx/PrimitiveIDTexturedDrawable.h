@@ -4,12 +4,15 @@
 
 #pragma once
 
+#include <memory>
+
 #include "Drawable.h"
 
 namespace esp {
 namespace gfx {
 
 class PrimitiveIDTexturedShader;
+struct IdRemap;
 
 class PrimitiveIDTexturedDrawable : public Drawable {
  public:
@@ -24,11 +27,30 @@ class PrimitiveIDTexturedDrawable : public Drawable {
       Magnum::SceneGraph::DrawableGroup3D* group = nullptr,
       Magnum::GL::Texture2D* texture = nullptr);
 
+  virtual Magnum::GL::AbstractTexture* getTexture() override {
+    return texture_;
+  }
+
+  virtual void draw(const Magnum::Matrix4& transformationMatrix,
+                    Magnum::SceneGraph::Camera3D& camera,
+                    DrawState& state) override;
+
+  //! Write the object ids mapped through idRemap, which has to outlive the
+  //! drawable; nullptr (default) writes them as they are. Remapped ids are
+  //! drawn with the shader variant with PrimitiveIDTexturedShader::IdRemap,
+  //! so has to be called with the GL context of the drawable current
+  void setIdRemap(IdRemap* idRemap);
+
+  virtual Magnum::GL::AbstractShaderProgram& getShader() override;
+
  protected:
   virtual void draw(const Magnum::Matrix4& transformationMatrix,
                     Magnum::SceneGraph::Camera3D& camera) override;
 
   Magnum::GL::Texture2D* texture_;
+  IdRemap* idRemap_ = nullptr;
+  //! variant of the shader mapping the ids, while there is an idRemap_
+  std::shared_ptr<PrimitiveIDTexturedShader> remapShader_;
 };
 
 }  // namespace gfx
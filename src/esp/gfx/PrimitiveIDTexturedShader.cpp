@@ -4,12 +4,19 @@
 
 #include "PrimitiveIDTexturedShader.h"
 
+#include <algorithm>
+
 #include <Corrade/Containers/Reference.h>
 #include <Corrade/Utility/Resource.h>
 #include <Magnum/GL/Context.h>
 #include <Magnum/GL/Shader.h>
 #include <Magnum/GL/Texture.h>
+#include <Magnum/GL/TextureFormat.h>
 #include <Magnum/GL/Version.h>
+#include <Magnum/ImageView.h>
+#include <Magnum/PixelFormat.h>
+
+#include "ShaderCache.h"
 
 // This is to import the "resources" at runtime.
 // When the resource is compiled into static library,
@@ -23,10 +30,29 @@ namespace esp {
 namespace gfx {
 
 namespace {
-enum { TextureLayer = 0 };
+enum { TextureLayer = 0, IdRemapLayer = 1 };
+
+// width of the id remap tables, the height grows with their size
+const int idRemapWidth = 1024;
+}  // namespace
+
+IdRemap::IdRemap(const std::vector<int>& ids) : size(ids.size()) {
+  const int height = std::max(1, (size + idRemapWidth - 1) / idRemapWidth);
+  std::vector<Magnum::Int> data(idRemapWidth * height, ID_UNDEFINED);
+  std::copy(ids.begin(), ids.end(), data.begin());
+  texture.setMinificationFilter(Magnum::GL::SamplerFilter::Nearest)
+      .setMagnificationFilter(Magnum::GL::SamplerFilter::Nearest)
+      .setWrapping(Magnum::GL::SamplerWrapping::ClampToEdge)
+      .setStorage(1, Magnum::GL::TextureFormat::R32I, {idRemapWidth, height})
+      .setSubImage(0, {},
+                   Magnum::ImageView2D{
+                       Magnum::PixelFormat::R32I, {idRemapWidth, height},
+                       Corrade::Containers::arrayView(data.data(),
+                                                      data.size())});
 }
 
-PrimitiveIDTexturedShader::PrimitiveIDTexturedShader() {
+PrimitiveIDTexturedShader::PrimitiveIDTexturedShader(Flags flags)
+    : flags_{flags} {
 #ifndef MAGNUM_TARGET_WEBGL
   MAGNUM_ASSERT_GL_VERSION_SUPPORTED(Magnum::GL::Version::GL410);
 #endif
@@ -44,30 +70,65 @@ PrimitiveIDTexturedShader::PrimitiveIDTexturedShader() {
   Magnum::GL::Version glVersion = Magnum::GL::Version::GL410;
 #endif
 
-  Magnum::GL::Shader vert{glVersion, Magnum::GL::Shader::Type::Vertex};
-  Magnum::GL::Shader frag{glVersion, Magnum::GL::Shader::Type::Fragment};
+  std::string defines;
+  if (flags & Flag::ObjectIdAttribute) {
+    defines += "#define OBJECT_ID_ATTRIBUTE\n";
+  }
+  if (flags & Flag::IdRemap) {
+    defines += "#define ID_REMAP\n";
+  }
+  const std::string vertSource =
+      defines + rs.get("primitive-id-textured-gl410.vert");
+  const std::string fragSource =
+      defines + rs.get("primitive-id-textured-gl410.frag");
+  const std::string binaryKey =
+      programBinaryKey("primitive-id-textured", {vertSource, fragSource});
+
+  if (!loadProgramBinary(*this, binaryKey)) {
+    Magnum::GL::Shader vert{glVersion, Magnum::GL::Shader::Type::Vertex};
+    Magnum::GL::Shader frag{glVersion, Magnum::GL::Shader::Type::Fragment};
 
-  vert.addSource(rs.get("primitive-id-textured-gl410.vert"));
-  frag.addSource(rs.get("primitive-id-textured-gl410.frag"));
+    vert.addSource(vertSource);
+    frag.addSource(fragSource);
 
-  CORRADE_INTERNAL_ASSERT_OUTPUT(Magnum::GL::Shader::compile({vert, frag}));
+    CORRADE_INTERNAL_ASSERT_OUTPUT(Magnum::GL::Shader::compile({vert, frag}));
 
-  attachShaders({vert, frag});
+    attachShaders({vert, frag});
 
-  CORRADE_INTERNAL_ASSERT_OUTPUT(link());
+    prepareProgramBinary(*this);
+    CORRADE_INTERNAL_ASSERT_OUTPUT(link());
+    saveProgramBinary(*this, binaryKey);
+  }
 
-  setUniform(uniformLocation("primTexture"), TextureLayer);
+  transformationProjectionMatrixUniform_ =
+      uniformLocation("transformationProjectionMatrix");
+  if (!(flags & Flag::ObjectIdAttribute)) {
+    setUniform(uniformLocation("primTexture"), TextureLayer);
+  }
+  if (flags & Flag::IdRemap) {
+    idRemapSizeUniform_ = uniformLocation("idRemapSize");
+    setUniform(uniformLocation("idRemapTexture"), IdRemapLayer);
+    setUniform(uniformLocation("idRemapWidth"), idRemapWidth);
+  }
 }
 
 PrimitiveIDTexturedShader& PrimitiveIDTexturedShader::bindTexture(
     Magnum::GL::Texture2D& texture) {
+  if (flags_ & Flag::ObjectIdAttribute) {
+    return *this;
+  }
+  // the shader reads the size of the texture with textureSize()
   texture.bind(TextureLayer);
+  return *this;
+}
 
-// TODO this is a hack and terrible! Properly set texSize for WebGL builds
-#ifndef MAGNUM_TARGET_WEBGL
-  setUniform(uniformLocation("texSize"), texture.imageSize(0).x());
-#endif
-
+PrimitiveIDTexturedShader& PrimitiveIDTexturedShader::bindIdRemap(
+    IdRemap& remap) {
+  if (!(flags_ & Flag::IdRemap)) {
+    return *this;
+  }
+  remap.texture.bind(IdRemapLayer);
+  setUniform(idRemapSizeUniform_, remap.size);
   return *this;
 }
 
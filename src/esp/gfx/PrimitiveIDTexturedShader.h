@@ -10,6 +10,7 @@
 #include <Corrade/Containers/EnumSet.h>
 
 #include <Magnum/GL/AbstractShaderProgram.h>
+#include <Magnum/GL/Texture.h>
 #include <Magnum/Math/Color.h>
 #include <Magnum/Math/Matrix4.h>
 
@@ -18,17 +19,46 @@
 namespace esp {
 namespace gfx {
 
+//! Table on the GPU mapping the object ids of a PrimitiveIDTexturedShader
+//! before they are written, e.g. semantic mesh indices to object indices
+struct IdRemap {
+  //! ids[i] is written for id i, ID_UNDEFINED for ids past the table
+  explicit IdRemap(const std::vector<int>& ids);
+
+  Magnum::GL::Texture2D texture;
+  int size;
+
+  ESP_SMART_POINTERS(IdRemap)
+};
+
 class PrimitiveIDTexturedShader : public Magnum::GL::AbstractShaderProgram {
  public:
+  /** @brief Flag */
+  enum class Flag {
+    //! Read the object ids from the ObjectId vertex attribute instead of a
+    //! texture indexed by primitive id
+    ObjectIdAttribute = 1 << 0,
+    //! Map the object ids through an IdRemap, see bindIdRemap(); without it
+    //! the lookup is compiled out
+    IdRemap = 1 << 1
+  };
+
+  /** @brief Flags */
+  typedef Corrade::Containers::EnumSet<Flag> Flags;
+
   /**
    * @brief Constructor
    */
-  explicit PrimitiveIDTexturedShader();
+  explicit PrimitiveIDTexturedShader(Flags flags = {});
+
+  Flags flags() const { return flags_; }
 
   //! @brief vertex positions
   typedef Magnum::GL::Attribute<0, Magnum::Vector4> Position;
   //! @brief vertex colors
   typedef Magnum::GL::Attribute<3, Magnum::Vector3> Color;
+  //! @brief vertex object ids, with @ref Flag::ObjectIdAttribute
+  typedef Magnum::GL::Attribute<2, Magnum::UnsignedInt> ObjectId;
 
   //! Color attachment location per output type
   enum : uint8_t {
@@ -44,7 +74,7 @@ class PrimitiveIDTexturedShader : public Magnum::GL::AbstractShaderProgram {
    */
   PrimitiveIDTexturedShader& setTransformationProjectionMatrix(
       const Magnum::Matrix4& matrix) {
-    setUniform(uniformLocation("transformationProjectionMatrix"), matrix);
+    setUniform(transformationProjectionMatrixUniform_, matrix);
     return *this;
   }
 
@@ -52,11 +82,25 @@ class PrimitiveIDTexturedShader : public Magnum::GL::AbstractShaderProgram {
    * @brief Bind a color texture
    * @return Reference to self (for method chaining)
    *
-   * Expects that the shader was created with @ref Flag::Textured enabled.
-   * @see @ref setColor()
+   * Does nothing with @ref Flag::ObjectIdAttribute.
    */
   PrimitiveIDTexturedShader& bindTexture(Magnum::GL::Texture2D& texture);
+
+  /**
+   * @brief Map the object ids through remap
+   * @return Reference to self (for method chaining)
+   *
+   * Does nothing without @ref Flag::IdRemap.
+   */
+  PrimitiveIDTexturedShader& bindIdRemap(IdRemap& remap);
+
+ private:
+  Flags flags_;
+  int transformationProjectionMatrixUniform_;
+  int idRemapSizeUniform_ = -1;
 };
 
+CORRADE_ENUMSET_OPERATORS(PrimitiveIDTexturedShader::Flags)
+
 }  // namespace gfx
 }  // namespace esp
@@ -6,6 +6,8 @@
 
 #include <Magnum/EigenIntegration/Integration.h>
 
+#include "DepthUnprojection.h"
+
 using namespace Magnum;
 
 namespace esp {
@@ -37,6 +39,27 @@ void RenderCamera::setProjectionMatrix(int width,
       .setProjectionMatrix(
           Matrix4::perspectiveProjection(Deg{hfov}, aspectRatio, znear, zfar))
       .setViewport(Magnum::Vector2i(width, height));
+  depthUnprojection_ = Corrade::Containers::NullOpt;
+}
+
+void RenderCamera::setProjection(const Matrix4& projection,
+                                 const Vector2i& viewport,
+                                 const Vector2& depthUnprojection) {
+  // e.g. the same sensor drawn again, or sensors sharing their projection
+  if (!depthUnprojection_ || camera_->projectionMatrix() != projection) {
+    camera_->setAspectRatioPolicy(SceneGraph::AspectRatioPolicy::NotPreserved)
+        .setProjectionMatrix(projection);
+    depthUnprojection_ = depthUnprojection;
+  }
+  camera_->setViewport(viewport);
+}
+
+const Vector2& RenderCamera::getDepthUnprojection() {
+  if (!depthUnprojection_) {
+    depthUnprojection_ =
+        calculateDepthUnprojection(camera_->projectionMatrix());
+  }
+  return *depthUnprojection_;
 }
 
 mat4f RenderCamera::getProjectionMatrix() {
@@ -4,6 +4,8 @@
 
 #pragma once
 
+#include <Corrade/Containers/Optional.h>
+
 #include "magnum.h"
 
 #include "esp/core/esp.h"
@@ -43,6 +45,17 @@ class RenderCamera : public Magnum::SceneGraph::AbstractFeature3D {
                            float zfar,
                            float hfov);
 
+  //! Set a projection computed already, e.g. cached by a sensor, with its
+  //! viewport and calculateDepthUnprojection() of it; the projection is only
+  //! updated when it differs from the current one
+  void setProjection(const Magnum::Matrix4& projection,
+                     const Magnum::Vector2i& viewport,
+                     const Magnum::Vector2& depthUnprojection);
+
+  //! calculateDepthUnprojection() of the projection matrix, calculated again
+  //! only after the projection changed
+  const Magnum::Vector2& getDepthUnprojection();
+
   mat4f getProjectionMatrix();
 
   mat4f getCameraMatrix();
@@ -53,6 +66,8 @@ class RenderCamera : public Magnum::SceneGraph::AbstractFeature3D {
 
  protected:
   MagnumCamera* camera_ = nullptr;
+  // of the projection of camera_, empty until getDepthUnprojection()
+  Corrade::Containers::Optional<Magnum::Vector2> depthUnprojection_;
 
   ESP_SMART_POINTERS(RenderCamera)
 };
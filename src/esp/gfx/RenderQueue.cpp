@@ -0,0 +1,43 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#include "RenderQueue.h"
+
+#include <algorithm>
+#include <tuple>
+
+#include "Drawable.h"
+
+namespace esp {
+namespace gfx {
+
+void RenderQueue::draw(MagnumCamera& camera,
+                       const MagnumDrawableTransformations& transformations) {
+  entries_.clear();
+  for (size_t i = 0; i < transformations.size(); ++i) {
+    MagnumDrawable& magnumDrawable = transformations[i].first.get();
+    Drawable* drawable = dynamic_cast<Drawable*>(&magnumDrawable);
+    if (drawable == nullptr) {
+      magnumDrawable.draw(transformations[i].second, camera);
+      continue;
+    }
+    entries_.push_back({&drawable->getShader(), drawable->getTexture(),
+                        &drawable->getMesh(), drawable, i});
+  }
+
+  // the index keeps the order of drawables with the same state deterministic
+  std::sort(entries_.begin(), entries_.end(),
+            [](const Entry& a, const Entry& b) {
+              return std::tie(a.shader, a.texture, a.mesh, a.index) <
+                     std::tie(b.shader, b.texture, b.mesh, b.index);
+            });
+
+  DrawState state;
+  for (const Entry& entry : entries_) {
+    entry.drawable->draw(transformations[entry.index].second, camera, state);
+  }
+}
+
+}  // namespace gfx
+}  // namespace esp
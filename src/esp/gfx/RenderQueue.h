@@ -0,0 +1,44 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#pragma once
+
+#include <vector>
+
+#include "esp/core/esp.h"
+#include "magnum.h"
+
+namespace esp {
+namespace gfx {
+
+class Drawable;
+
+// Draws drawables sorted by (shader, texture, mesh) instead of in group order,
+// so that consecutive draws share their program and texture bindings, and
+// passes a DrawState from one draw to the next so that drawables skip the
+// uniforms and bindings already set. Drawables that are not a gfx::Drawable
+// are drawn first, in their original order.
+class RenderQueue {
+ public:
+  void draw(MagnumCamera& camera,
+            const MagnumDrawableTransformations& transformations);
+
+ protected:
+  struct Entry {
+    Magnum::GL::AbstractShaderProgram* shader;
+    Magnum::GL::AbstractTexture* texture;
+    Magnum::GL::Mesh* mesh;
+    Drawable* drawable;
+    // into the drawable transformations
+    size_t index;
+  };
+
+  // kept to reuse the allocation between frames
+  std::vector<Entry> entries_;
+
+  ESP_SMART_POINTERS(RenderQueue)
+};
+
+}  // namespace gfx
+}  // namespace esp
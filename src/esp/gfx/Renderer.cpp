@@ -4,80 +4,814 @@
 
 #include "Renderer.h"
 
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <memory>
+
+#include <Corrade/Containers/Optional.h>
 #include <Corrade/Containers/StridedArrayView.h>
 #include <Magnum/GL/Buffer.h>
+#include <Magnum/GL/BufferImage.h>
 #include <Magnum/GL/DefaultFramebuffer.h>
 #include <Magnum/GL/Framebuffer.h>
+#include <Magnum/GL/Mesh.h>
+#include <Magnum/GL/PrimitiveQuery.h>
+#include <Magnum/GL/OpenGL.h>
 #include <Magnum/GL/PixelFormat.h>
 #include <Magnum/GL/Renderbuffer.h>
 #include <Magnum/GL/RenderbufferFormat.h>
+#include <Magnum/GL/Sampler.h>
 #include <Magnum/GL/Renderer.h>
 #include <Magnum/GL/Texture.h>
+#include <Magnum/GL/TextureArray.h>
 #include <Magnum/GL/TextureFormat.h>
+#include <Magnum/GL/TimeQuery.h>
 #include <Magnum/Image.h>
+#include <Magnum/ImageView.h>
+#include <Magnum/Math/Functions.h>
+#include <Magnum/Math/Packing.h>
 #include <Magnum/PixelFormat.h>
+#include <Magnum/PixelStorage.h>
+#include <Magnum/Shaders/Flat.h>
 
+#include "esp/core/Metrics.h"
 #include "esp/gfx/DepthUnprojection.h"
+#include "esp/gfx/Drawable.h"
+#include "esp/gfx/DrawableBVH.h"
+#include "esp/gfx/EquirectangularShader.h"
+#include "esp/gfx/GpuProfiler.h"
+#include "esp/gfx/InstancedDrawer.h"
+#include "esp/gfx/MultiDrawBatch.h"
+#include "esp/gfx/OcclusionCuller.h"
+#include "esp/gfx/RenderQueue.h"
+#include "esp/gfx/SensorNoise.h"
 #include "esp/gfx/magnum.h"
 
+#ifdef ESP_BUILD_WITH_CUDA
+#include "esp/gfx/CudaInterop.h"
+#endif
+
 using namespace Magnum;
 
 namespace esp {
 namespace gfx {
 
+namespace {
+// CPU time of the calls, in the metrics of the process
+core::Histogram& renderSeconds() {
+  static core::Histogram& histogram = core::MetricsRegistry::get().histogram(
+      "habitat_render_seconds", "Time of drawing a frame or a batch");
+  return histogram;
+}
+
+core::Histogram& readbackSeconds() {
+  static core::Histogram& histogram = core::MetricsRegistry::get().histogram(
+      "habitat_readback_seconds",
+      "Time of reading a frame back, or of waiting for an async one");
+  return histogram;
+}
+}  // namespace
+
+size_t getFrameFormatPixelBytes(FrameFormat format) {
+  switch (format) {
+    case FrameFormat::Rgba8:
+    case FrameFormat::Depth32F:
+    case FrameFormat::ObjectId32:
+      return 4;
+    case FrameFormat::Rgb8:
+      return 3;
+    case FrameFormat::Depth16F:
+    case FrameFormat::Depth16Mm:
+      return 2;
+  }
+  return 0;
+}
+
+core::DataType getFrameFormatDataType(FrameFormat format) {
+  switch (format) {
+    case FrameFormat::Rgba8:
+    case FrameFormat::Rgb8:
+      return core::DataType::DT_UINT8;
+    case FrameFormat::Depth32F:
+      return core::DataType::DT_FLOAT;
+    case FrameFormat::Depth16F:
+      return core::DataType::DT_FLOAT16;
+    case FrameFormat::Depth16Mm:
+      return core::DataType::DT_UINT16;
+    case FrameFormat::ObjectId32:
+      return core::DataType::DT_UINT32;
+  }
+  return core::DataType::DT_NONE;
+}
+
+FrameFormat getFrameFormat(const sensor::SensorSpec& spec) {
+  // the encoding may carry a codec suffix, see sensor::ObservationEncoder
+  auto hasEncoding = [&spec](const std::string& encoding) {
+    return spec.encoding.compare(0, encoding.size(), encoding) == 0;
+  };
+  switch (spec.sensorType) {
+    case sensor::SensorType::SEMANTIC:
+      return FrameFormat::ObjectId32;
+    case sensor::SensorType::DEPTH:
+      if (hasEncoding("depth_float16")) {
+        return FrameFormat::Depth16F;
+      }
+      if (hasEncoding("depth_uint16_mm")) {
+        return FrameFormat::Depth16Mm;
+      }
+      return FrameFormat::Depth32F;
+    default:
+      return spec.channels == 3 || hasEncoding("rgb_uint8")
+                 ? FrameFormat::Rgb8
+                 : FrameFormat::Rgba8;
+  }
+}
+
 struct Renderer::Impl {
-  Impl(int width, int height)
-      : framebufferSize_(width, height),
-        colorBuffer_(),
-        objectIdBuffer_(),
-        depthRenderbuffer_(),
-        framebuffer_({{}, framebufferSize_}) {
+  // what a draw writes: everything, or only what a depth or semantic sensor
+  // reads. Depth-only draws all drawables with a trivial shader and no color
+  // outputs, object-id-only keeps their shaders but only the id attachment.
+  // Color-only is for passes post-processing the color of a frame
+  enum class RenderPass { Full, DepthOnly, ObjectIdOnly, ColorOnly };
+
+  // a region of the batch framebuffer holding the image of one or more
+  // sensors with identical pose, projection and scene graph
+  struct BatchTile {
+    scene::SceneGraph* sceneGraph = nullptr;
+    // first sensor in the batch mapped to this tile
+    int sensorIndex = ID_UNDEFINED;
+    Magnum::Vector2i size;
+    Matrix4 transformation;
+    Matrix4 projection;
+    Range2Di viewport;
+    Vector2 depthUnprojection;
+    // scale the depth of this tile was unprojected at on the GPU, 0 if it
+    // was not, see depthUnprojectionScale()
+    float depthUnprojectedScale = 0.0f;
+  };
+
+  // the attachments drawn into at one size: the depth attachment is a
+  // texture so that it can be sampled by the unprojection pass, which writes
+  // linear depth into the separate R32F unprojectedDepthFramebuffer
+  struct RenderTarget {
+    Magnum::Vector2i size;
+    GL::Renderbuffer colorBuffer;
+    GL::Renderbuffer objectIdBuffer;
+    GL::Texture2D depthTexture{NoCreate};
+    GL::Framebuffer framebuffer{NoCreate};
+    GL::Renderbuffer unprojectedDepthBuffer;
+    GL::Framebuffer unprojectedDepthFramebuffer{NoCreate};
+    //! value of targetClock_ when the target was last selected
+    uint64_t lastUsed = 0;
+    //! pass the color attachments are mapped for
+    RenderPass mappedPass = RenderPass::Full;
+  };
+
+  // the faces of a panorama as layers of texture arrays the resampling pass
+  // samples from, one framebuffer per face. Color is not sRGB so that it is
+  // sampled exactly as it was written
+  struct CubeMapTarget {
+    int faceSize = 0;
+    GL::Texture2DArray colorTexture{NoCreate};
+    GL::Texture2DArray objectIdTexture{NoCreate};
+    GL::Texture2DArray depthTexture{NoCreate};
+    std::vector<GL::Framebuffer> framebuffers;
+  };
+
+  // a color-only level of the chain that downsamples a frame
+  struct DownsampleTarget {
+    GL::Renderbuffer colorBuffer;
+    GL::Framebuffer framebuffer{NoCreate};
+  };
+
+  // the copy of the color of a frame that color noise is computed from. Not
+  // sRGB, like the faces of a panorama, so that it is sampled exactly as it
+  // was written
+  struct NoiseSourceTarget {
+    Magnum::Vector2i size;
+    GL::Texture2D colorTexture{NoCreate};
+    GL::Framebuffer framebuffer{NoCreate};
+  };
+
+  // the queries measuring the RenderStats of one frame
+  struct FrameStatsQueries {
+    RenderStats stats;
+#ifndef MAGNUM_TARGET_WEBGL
+    GL::TimeQuery start{GL::TimeQuery::Target::Timestamp};
+    GL::TimeQuery end{GL::TimeQuery::Target::Timestamp};
+#endif
+#ifndef MAGNUM_TARGET_GLES
+    GL::PrimitiveQuery primitives{
+        GL::PrimitiveQuery::Target::PrimitivesGenerated};
+#endif
+  };
+
+  // one slot of the asynchronous readback ring
+  struct AsyncReadback {
+    int ticket = ID_UNDEFINED;
+    FrameFormat format = FrameFormat::Rgba8;
+    // format transferred, which waitFrame() converts to format if it differs
+    FrameFormat readFormat = FrameFormat::Rgba8;
+    std::size_t numPixels = 0;
+#ifndef MAGNUM_TARGET_WEBGL
+    GL::BufferImage2D image{GL::PixelFormat::RGBA, GL::PixelType::UnsignedByte};
+    GLsync fence = nullptr;
+#else
+    // WebGL cannot map buffers, so the transfer happens synchronously
+    Containers::Optional<Image2D> image;
+#endif
+  };
+
+  Impl(int width, int height) {
     GL::Renderer::enable(GL::Renderer::Feature::DepthTest);
     GL::Renderer::enable(GL::Renderer::Feature::FaceCulling);
+    fullScreenTriangle_.setCount(3);
     setSize(width, height);
+    // double buffered by default: frame k transfers while k+1 renders
+    setAsyncReadbackFrames(2);
+  }
+  ~Impl() {
+    setAsyncReadbackFrames(0);
+    LOG(INFO) << "Deconstructing Renderer";
   }
-  ~Impl() { LOG(INFO) << "Deconstructing Renderer"; }
 
+  // Sensors of different resolutions take turns, so instead of reallocating
+  // the attachments on every change of size, a target per size is kept in a
+  // pool, the least recently used evicted beyond maxPooledTargets
   void setSize(int width, int height) {
-    framebufferSize_[0] = width;
-    framebufferSize_[1] = height;
-    colorBuffer_.setStorage(GL::RenderbufferFormat::SRGB8Alpha8,
-                            framebufferSize_);
-    objectIdBuffer_.setStorage(GL::RenderbufferFormat::R32UI, framebufferSize_);
-    depthRenderbuffer_.setStorage(GL::RenderbufferFormat::DepthComponent32F,
-                                  framebufferSize_);
-    framebuffer_ = GL::Framebuffer{{{}, framebufferSize_}};
-    framebuffer_
-        .attachRenderbuffer(GL::Framebuffer::ColorAttachment{0}, colorBuffer_)
+    framebufferSize_ = {width, height};
+    std::unique_ptr<RenderTarget>& target = targetPool_[{width, height}];
+    if (!target) {
+      target = std::make_unique<RenderTarget>();
+      attachBuffers(framebufferSize_, *target);
+    }
+    target_ = target.get();
+    target_->lastUsed = ++targetClock_;
+
+    while (targetPool_.size() > maxPooledTargets) {
+      auto lru = targetPool_.end();
+      for (auto it = targetPool_.begin(); it != targetPool_.end(); ++it) {
+        if (it->second.get() != target_ &&
+            (lru == targetPool_.end() ||
+             it->second->lastUsed < lru->second->lastUsed)) {
+          lru = it;
+        }
+      }
+      targetPool_.erase(lru);
+    }
+  }
+
+  static void attachBuffers(const Magnum::Vector2i& size,
+                            RenderTarget& target) {
+    target.size = size;
+    target.colorBuffer.setStorage(GL::RenderbufferFormat::SRGB8Alpha8, size);
+    target.objectIdBuffer.setStorage(GL::RenderbufferFormat::R32UI, size);
+    // texture storage is immutable, a resize needs a new texture
+    target.depthTexture = GL::Texture2D{};
+    target.depthTexture.setMinificationFilter(GL::SamplerFilter::Nearest)
+        .setMagnificationFilter(GL::SamplerFilter::Nearest)
+        .setWrapping(GL::SamplerWrapping::ClampToEdge)
+        .setStorage(1, GL::TextureFormat::DepthComponent32F, size);
+    target.framebuffer = GL::Framebuffer{{{}, size}};
+    target.framebuffer
+        .attachRenderbuffer(GL::Framebuffer::ColorAttachment{0},
+                            target.colorBuffer)
         .attachRenderbuffer(GL::Framebuffer::ColorAttachment{1},
-                            objectIdBuffer_)
-        .attachRenderbuffer(GL::Framebuffer::BufferAttachment::Depth,
-                            depthRenderbuffer_)
+                            target.objectIdBuffer)
+        .attachTexture(GL::Framebuffer::BufferAttachment::Depth,
+                       target.depthTexture, 0)
         .mapForDraw({{0, GL::Framebuffer::ColorAttachment{0}},
                      {1, GL::Framebuffer::ColorAttachment{1}}});
     CORRADE_INTERNAL_ASSERT(
-        framebuffer_.checkStatus(GL::FramebufferTarget::Draw) ==
+        target.framebuffer.checkStatus(GL::FramebufferTarget::Draw) ==
         GL::Framebuffer::Status::Complete);
+
+    target.unprojectedDepthBuffer.setStorage(GL::RenderbufferFormat::R32F,
+                                             size);
+    target.unprojectedDepthFramebuffer = GL::Framebuffer{{{}, size}};
+    target.unprojectedDepthFramebuffer
+        .attachRenderbuffer(GL::Framebuffer::ColorAttachment{0},
+                            target.unprojectedDepthBuffer)
+        .mapForDraw(GL::Framebuffer::ColorAttachment{0})
+        .mapForRead(GL::Framebuffer::ColorAttachment{0});
+    CORRADE_INTERNAL_ASSERT(target.unprojectedDepthFramebuffer.checkStatus(
+                                GL::FramebufferTarget::Draw) ==
+                            GL::Framebuffer::Status::Complete);
+  }
+
+  static void attachCubeMap(int faceSize, CubeMapTarget& target) {
+    target.faceSize = faceSize;
+    const Vector3i size{faceSize, faceSize, CubeMapFaceCount};
+    target.colorTexture = GL::Texture2DArray{};
+    target.colorTexture.setMinificationFilter(GL::SamplerFilter::Linear)
+        .setMagnificationFilter(GL::SamplerFilter::Linear)
+        .setWrapping(GL::SamplerWrapping::ClampToEdge)
+        .setStorage(1, GL::TextureFormat::RGBA8, size);
+    target.objectIdTexture = GL::Texture2DArray{};
+    target.objectIdTexture.setMinificationFilter(GL::SamplerFilter::Nearest)
+        .setMagnificationFilter(GL::SamplerFilter::Nearest)
+        .setWrapping(GL::SamplerWrapping::ClampToEdge)
+        .setStorage(1, GL::TextureFormat::R32UI, size);
+    target.depthTexture = GL::Texture2DArray{};
+    target.depthTexture.setMinificationFilter(GL::SamplerFilter::Nearest)
+        .setMagnificationFilter(GL::SamplerFilter::Nearest)
+        .setWrapping(GL::SamplerWrapping::ClampToEdge)
+        .setStorage(1, GL::TextureFormat::DepthComponent32F, size);
+
+    target.framebuffers.clear();
+    for (int face = 0; face < CubeMapFaceCount; ++face) {
+      target.framebuffers.emplace_back(Range2Di{{}, size.xy()});
+      GL::Framebuffer& framebuffer = target.framebuffers.back();
+      framebuffer
+          .attachTextureLayer(GL::Framebuffer::ColorAttachment{0},
+                              target.colorTexture, 0, face)
+          .attachTextureLayer(GL::Framebuffer::ColorAttachment{1},
+                              target.objectIdTexture, 0, face)
+          .attachTextureLayer(GL::Framebuffer::BufferAttachment::Depth,
+                              target.depthTexture, 0, face)
+          .mapForDraw({{0, GL::Framebuffer::ColorAttachment{0}},
+                       {1, GL::Framebuffer::ColorAttachment{1}}});
+      CORRADE_INTERNAL_ASSERT(
+          framebuffer.checkStatus(GL::FramebufferTarget::Draw) ==
+          GL::Framebuffer::Status::Complete);
+    }
+  }
+
+  // full-screen pass writing linear depth times scale of the viewport region
+  // of depthTexture into target, so depth readback is a single transfer and
+  // no per-pixel work is left for the CPU
+  void unprojectDepthOnGpu(GL::Texture2D& depthTexture,
+                           GL::Framebuffer& target,
+                           const Range2Di& viewport,
+                           const Vector2& depthUnprojection,
+                           float scale) {
+    target.setViewport(viewport).bind();
+    // the depth is depthUnprojection[1] / (z + depthUnprojection[0])
+    depthShader_
+        .setDepthUnprojection({depthUnprojection[0],
+                               depthUnprojection[1] * scale})
+        .bindDepthTexture(depthTexture);
+    fullScreenTriangle_.draw(depthShader_);
   }
 
-  inline void renderEnter() {
-    framebuffer_.clearDepth(1.0);
-    framebuffer_.clearColor(0, Color4{});
-    framebuffer_.clearColor(1, Vector4ui{});
-    framebuffer_.bind();
+  // depth is only unprojected when it is actually read, RGB-only draws do not
+  // pay for the extra pass
+  void ensureDepthUnprojected(FrameFormat format) {
+    const float scale = depthUnprojectionScale(format);
+    if (depthUnprojectedScale_ != scale) {
+      if (depthNoise_.type != SensorNoiseType::None) {
+        unprojectNoisyDepth(scale);
+      } else {
+        unprojectDepthOnGpu(target_->depthTexture,
+                            target_->unprojectedDepthFramebuffer,
+                            Range2Di::fromSize({0, 0}, framebufferSize_),
+                            depthUnprojection_, scale);
+      }
+      depthUnprojectedScale_ = scale;
+    }
+  }
+
+  SensorNoiseShader& noiseShader(SensorNoiseType type) {
+    std::unique_ptr<SensorNoiseShader>& shader = noiseShaders_[type];
+    if (!shader) {
+      shader = std::make_unique<SensorNoiseShader>(type);
+    }
+    return *shader;
+  }
+
+  // the unprojection pass of the frame with depthNoise_ added
+  void unprojectNoisyDepth(float scale) {
+    target_->unprojectedDepthFramebuffer
+        .setViewport(Range2Di::fromSize({0, 0}, framebufferSize_))
+        .bind();
+    SensorNoiseShader& shader = noiseShader(depthNoise_.type);
+    shader.setNoiseModel(depthNoise_)
+        .setFrameSeed(depthNoiseSeed_)
+        .setDepthUnprojection(depthUnprojection_, scale)
+        .bindSourceTexture(target_->depthTexture);
+    fullScreenTriangle_.draw(shader);
+  }
+
+  void applySensorNoise(const SensorNoiseModel& model, uint32_t frameSeed) {
+    if (model.type == SensorNoiseType::None) {
+      return;
+    }
+    // the frame is no longer what its drawables look like
+    lastSensorFrame_.target = nullptr;
+    if (model.isDepth()) {
+      depthNoise_ = model;
+      depthNoiseSeed_ = frameSeed;
+      depthUnprojectedScale_ = 0.0f;
+      return;
+    }
+
+    // the pass cannot read the attachment it writes, so it reads a copy
+    if (noiseSource_.size != framebufferSize_) {
+      noiseSource_.size = framebufferSize_;
+      noiseSource_.colorTexture = GL::Texture2D{};
+      noiseSource_.colorTexture
+          .setMinificationFilter(GL::SamplerFilter::Nearest)
+          .setMagnificationFilter(GL::SamplerFilter::Nearest)
+          .setWrapping(GL::SamplerWrapping::ClampToEdge)
+          .setStorage(1, GL::TextureFormat::RGBA8, framebufferSize_);
+      noiseSource_.framebuffer = GL::Framebuffer{{{}, framebufferSize_}};
+      noiseSource_.framebuffer
+          .attachTexture(GL::Framebuffer::ColorAttachment{0},
+                         noiseSource_.colorTexture, 0)
+          .mapForDraw(GL::Framebuffer::ColorAttachment{0});
+      CORRADE_INTERNAL_ASSERT(
+          noiseSource_.framebuffer.checkStatus(GL::FramebufferTarget::Draw) ==
+          GL::Framebuffer::Status::Complete);
+    }
+    const Range2Di frame = Range2Di::fromSize({0, 0}, framebufferSize_);
+    target_->framebuffer.mapForRead(GL::Framebuffer::ColorAttachment{0});
+    GL::Framebuffer::blit(target_->framebuffer, noiseSource_.framebuffer,
+                          frame, GL::FramebufferBlit::Color);
+
+    // every pixel is written, whatever the depth of the frame there
+    mapForPass(*target_, RenderPass::ColorOnly);
+    target_->framebuffer.setViewport(frame).bind();
+    GL::Renderer::disable(GL::Renderer::Feature::DepthTest);
+    SensorNoiseShader& shader = noiseShader(model.type);
+    shader.setNoiseModel(model)
+        .setFrameSeed(frameSeed)
+        .bindSourceTexture(noiseSource_.colorTexture);
+    fullScreenTriangle_.draw(shader);
+    GL::Renderer::enable(GL::Renderer::Feature::DepthTest);
+  }
+
+  static bool isDepthFormat(FrameFormat format) {
+    return format == FrameFormat::Depth32F || format == FrameFormat::Depth16F ||
+           format == FrameFormat::Depth16Mm;
+  }
+
+  // format of the attachment a frame of format is read from
+  static FrameFormat attachmentFormat(FrameFormat format) {
+    if (format == FrameFormat::Rgb8) {
+      return FrameFormat::Rgba8;
+    }
+    return isDepthFormat(format) ? FrameFormat::Depth32F : format;
+  }
+
+  // whether GL converts the attachment to format while reading it; OpenGL ES
+  // and WebGL only read the formats of the attachments
+  static bool isReadConverted(FrameFormat format) {
+#ifdef MAGNUM_TARGET_GLES
+    return format == attachmentFormat(format);
+#else
+    return true;
+#endif
+  }
+
+  // GL reads float into uint16 normalized, as 65535 times the value clamped
+  // to [0, 1], so millimeters are unprojected in units of 65.535 m
+  static float depthUnprojectionScale(FrameFormat format) {
+    return format == FrameFormat::Depth16Mm && isReadConverted(format)
+               ? 1000.0f / 65535.0f
+               : 1.0f;
+  }
+
+  static PixelFormat framePixelFormat(FrameFormat format) {
+    switch (format) {
+      case FrameFormat::Rgba8:
+        return PixelFormat::RGBA8Unorm;
+      case FrameFormat::Rgb8:
+        return PixelFormat::RGB8Unorm;
+      case FrameFormat::Depth32F:
+        return PixelFormat::R32F;
+      case FrameFormat::Depth16F:
+        return PixelFormat::R16F;
+      case FrameFormat::Depth16Mm:
+        return PixelFormat::R16Unorm;
+      case FrameFormat::ObjectId32:
+        return PixelFormat::R32UI;
+    }
+    CORRADE_ASSERT_UNREACHABLE();
+  }
+
+  // convert numPixels pixels read in attachmentFormat(format) to format
+  static void convertFramePixels(const void* src,
+                                 FrameFormat format,
+                                 std::size_t numPixels,
+                                 void* dst) {
+    if (format == attachmentFormat(format)) {
+      std::memcpy(dst, src, numPixels * getFrameFormatPixelBytes(format));
+      return;
+    }
+    const uint8_t* rgba = static_cast<const uint8_t*>(src);
+    const float* depth = static_cast<const float*>(src);
+    switch (format) {
+      case FrameFormat::Rgb8:
+        for (std::size_t i = 0; i < numPixels; ++i) {
+          std::memcpy(static_cast<uint8_t*>(dst) + 3 * i, rgba + 4 * i, 3);
+        }
+        break;
+      case FrameFormat::Depth16F:
+        for (std::size_t i = 0; i < numPixels; ++i) {
+          static_cast<UnsignedShort*>(dst)[i] = Math::packHalf(depth[i]);
+        }
+        break;
+      case FrameFormat::Depth16Mm:
+        for (std::size_t i = 0; i < numPixels; ++i) {
+          static_cast<UnsignedShort*>(dst)[i] = UnsignedShort(
+              Math::clamp(depth[i] * 1000.0f + 0.5f, 0.0f, 65535.0f));
+        }
+        break;
+      default:
+        CORRADE_ASSERT_UNREACHABLE();
+    }
+  }
+
+  // the framebuffer of target a frame of format is read from, mapped for
+  // reading it. Depth has to be unprojected already
+  static GL::Framebuffer& frameSource(RenderTarget& target,
+                                      FrameFormat format) {
+    if (isDepthFormat(format)) {
+      return target.unprojectedDepthFramebuffer;
+    }
+    target.framebuffer.mapForRead(GL::Framebuffer::ColorAttachment{
+        format == FrameFormat::ObjectId32 ? 1 : 0});
+    return target.framebuffer;
+  }
+
+  // map only the color attachments pass writes for drawing, fragment outputs
+  // without an attachment are discarded
+  static void mapForPass(RenderTarget& target, RenderPass pass) {
+    if (target.mappedPass == pass) {
+      return;
+    }
+    const GL::Framebuffer::DrawAttachment none =
+        GL::Framebuffer::DrawAttachment::None;
+    switch (pass) {
+      case RenderPass::Full:
+        target.framebuffer.mapForDraw(
+            {{0, GL::Framebuffer::ColorAttachment{0}},
+             {1, GL::Framebuffer::ColorAttachment{1}}});
+        break;
+      case RenderPass::DepthOnly:
+        target.framebuffer.mapForDraw({{0, none}, {1, none}});
+        break;
+      case RenderPass::ObjectIdOnly:
+        target.framebuffer.mapForDraw(
+            {{0, none}, {1, GL::Framebuffer::ColorAttachment{1}}});
+        break;
+      case RenderPass::ColorOnly:
+        target.framebuffer.mapForDraw(
+            {{0, GL::Framebuffer::ColorAttachment{0}}, {1, none}});
+        break;
+    }
+    target.mappedPass = pass;
+  }
+
+  inline void renderEnter(RenderPass pass = RenderPass::Full) {
+    // whatever a sensor drew before is overwritten, with its noise
+    lastSensorFrame_.target = nullptr;
+    depthNoise_ = SensorNoiseModel{};
+    mapForPass(*target_, pass);
+    target_->framebuffer.clearDepth(1.0);
+    if (pass == RenderPass::Full) {
+      target_->framebuffer.clearColor(0, Color4{});
+    }
+    if (pass != RenderPass::DepthOnly) {
+      target_->framebuffer.clearColor(1, Vector4ui{});
+    }
+    target_->framebuffer.bind();
   }
 
   inline void renderExit() {}
 
-  void draw(RenderCamera& camera, MagnumDrawableGroup& drawables) {
-    renderEnter();
+  // Timestamps rather than an elapsed time query, as GL cannot nest those
+  // and the GpuProfiler may have one open around the frame
+  void beginFrameStats() {
+    if (renderStatsFrames_ == 0) {
+      return;
+    }
+    collectRenderStats(false);
+    if (freeStatsQueries_.empty()) {
+      freeStatsQueries_.push_back(std::make_unique<FrameStatsQueries>());
+    }
+    frameStats_ = std::move(freeStatsQueries_.back());
+    freeStatsQueries_.pop_back();
+    frameStats_->stats = RenderStats{};
+#ifndef MAGNUM_TARGET_WEBGL
+    frameStats_->start.timestamp();
+#endif
+#ifndef MAGNUM_TARGET_GLES
+    frameStats_->primitives.begin();
+#endif
+  }
+
+  void endFrameStats() {
+    if (!frameStats_) {
+      return;
+    }
+#ifndef MAGNUM_TARGET_GLES
+    frameStats_->primitives.end();
+#endif
+#ifndef MAGNUM_TARGET_WEBGL
+    frameStats_->end.timestamp();
+#endif
+    pendingStats_.push_back(std::move(frameStats_));
+  }
+
+  // move the frames whose query results arrived (all if wait) to
+  // renderStats_, keeping the last renderStatsFrames_
+  void collectRenderStats(bool wait) {
+    while (!pendingStats_.empty()) {
+      FrameStatsQueries& frame = *pendingStats_.front();
+#ifndef MAGNUM_TARGET_WEBGL
+      // the end timestamp is the last result of the frame to arrive
+      if (!wait && !frame.end.resultAvailable()) {
+        break;
+      }
+      frame.stats.gpuTimeNs = frame.end.result<UnsignedLong>() -
+                              frame.start.result<UnsignedLong>();
+#endif
+#ifndef MAGNUM_TARGET_GLES
+      frame.stats.triangleCount = frame.primitives.result<UnsignedInt>();
+#endif
+      renderStats_.push_back(frame.stats);
+      freeStatsQueries_.push_back(std::move(pendingStats_.front()));
+      pendingStats_.pop_front();
+    }
+    while (renderStats_.size() > renderStatsFrames_) {
+      renderStats_.pop_front();
+    }
+  }
+
+  void setRenderStatsFrames(int numFrames) {
+    ASSERT(numFrames >= 0);
+    collectRenderStats(true);
+    renderStatsFrames_ = numFrames;
+    collectRenderStats(false);
+  }
+
+  std::vector<RenderStats> getRenderStats(bool wait) {
+    collectRenderStats(wait);
+    return {renderStats_.begin(), renderStats_.end()};
+  }
+
+  void blitFrameToDefaultFramebuffer() {
+    target_->framebuffer.mapForRead(GL::Framebuffer::ColorAttachment{0});
+    GL::Framebuffer::blit(
+        target_->framebuffer, GL::defaultFramebuffer,
+        Range2Di::fromSize({0, 0}, framebufferSize_),
+        GL::defaultFramebuffer.viewport(), GL::FramebufferBlit::Color,
+        GL::FramebufferBlitFilter::Nearest);
+  }
+
+  uint64_t getDrawablesRevision(MagnumDrawableGroup& drawables) {
+    // the culling hierarchy tracks exactly these changes
+    DrawableBVH& bvh = drawableBVHs_[&drawables];
+    bvh.update(drawables);
+    return bvh.revision();
+  }
+
+  void countDrawCalls(int drawCalls) {
+    if (frameStats_) {
+      frameStats_->stats.drawCallCount += drawCalls;
+    }
+  }
+
+  // Remove the drawables of transformations, relative to camera, that only
+  // overlap regions not visible from the one of the camera, keeping the
+  // order of the others. Returns the number removed
+  int cullRegions(MagnumCamera& camera,
+                  MagnumDrawableGroup& drawables,
+                  MagnumDrawableTransformations& transformations) {
+    auto found = regionVisibilities_.find(&drawables);
+    if (found == regionVisibilities_.end()) {
+      return 0;
+    }
+    const scene::RegionVisibility& visibility = *found->second;
+    const Matrix4 cameraMatrix = camera.object().absoluteTransformationMatrix();
+    const Vector3 position = cameraMatrix.translation();
+    const int region =
+        visibility.regionAt(vec3f(position.x(), position.y(), position.z()));
+    if (region == ID_UNDEFINED) {
+      return 0;
+    }
+    size_t numKept = 0;
+    for (size_t i = 0; i < transformations.size(); ++i) {
+      Drawable* drawable =
+          dynamic_cast<Drawable*>(&transformations[i].first.get());
+      if (drawable != nullptr && drawable->getLocalBoundingBox()) {
+        // the axis-aligned world box around the transformed local box
+        const Matrix4 transformation =
+            cameraMatrix * transformations[i].second;
+        const Range3D& local = *drawable->getLocalBoundingBox();
+        const Vector3 center = transformation.transformPoint(local.center());
+        const Vector3 halfSize = local.size() * 0.5f;
+        Vector3 extent;
+        for (int k = 0; k < 3; ++k) {
+          extent[k] = std::abs(transformation[0][k]) * halfSize[0] +
+                      std::abs(transformation[1][k]) * halfSize[1] +
+                      std::abs(transformation[2][k]) * halfSize[2];
+        }
+        const Vector3 min = center - extent;
+        const Vector3 max = center + extent;
+        if (!visibility.isBoxVisible(
+                region, box3f(vec3f(min.x(), min.y(), min.z()),
+                              vec3f(max.x(), max.y(), max.z())))) {
+          continue;
+        }
+      }
+      transformations[numKept++] = transformations[i];
+    }
+    const int numCulled = transformations.size() - numKept;
+    transformations.erase(transformations.begin() + numKept,
+                          transformations.end());
+    return numCulled;
+  }
+
+  void drawDrawables(RenderCamera& camera,
+                     MagnumDrawableGroup& drawables,
+                     RenderPass pass = RenderPass::Full) {
+    MagnumCamera& magnumCamera = camera.getMagnumCamera();
+    MagnumDrawableTransformations transformations;
+    if (frustumCulling_) {
+      DrawableBVH& bvh = drawableBVHs_[&drawables];
+      bvh.update(drawables);
+      transformations = bvh.visibleDrawableTransformations(magnumCamera);
+    } else {
+      transformations = magnumCamera.drawableTransformations(drawables);
+    }
+
+    if (frameStats_) {
+      frameStats_->stats.visibleDrawableCount += transformations.size();
+    }
+    if (regionCulling_) {
+      const int numCulled =
+          cullRegions(magnumCamera, drawables, transformations);
+      if (frameStats_) {
+        frameStats_->stats.regionCulledDrawableCount += numCulled;
+      }
+    }
+    if (occlusionCulling_ && OcclusionCuller::isSupported()) {
+      const int numOccluded =
+          occlusionCuller_.cull(magnumCamera, transformations);
+      countDrawCalls(occlusionCuller_.getLastOccluderCount());
+      if (frameStats_) {
+        frameStats_->stats.occludedDrawableCount += numOccluded;
+      }
+    }
+
+    if (pass == RenderPass::DepthOnly) {
+      // a single program, so neither instancing nor sorting pays off
+      if (!depthOnlyShader_) {
+        depthOnlyShader_ = std::make_unique<Shaders::Flat3D>();
+      }
+      countDrawCalls(transformations.size());
+      for (auto& transformation : transformations) {
+        Drawable* drawable =
+            dynamic_cast<Drawable*>(&transformation.first.get());
+        if (drawable) {
+          drawable->drawDepth(transformation.second, magnumCamera,
+                              *depthOnlyShader_);
+        } else {
+          transformation.first.get().draw(transformation.second, magnumCamera);
+        }
+      }
+      return;
+    }
+
+    if (multiDrawBatching_ && MultiDrawBatch::isSupported()) {
+      transformations =
+          multiDrawBatch_.drawBatched(magnumCamera, transformations);
+      countDrawCalls(multiDrawBatch_.getLastMultiDrawCount());
+    }
+    if (instancedDrawing_) {
+      transformations =
+          instancedDrawer_.drawInstances(magnumCamera, transformations);
+      countDrawCalls(instancedDrawer_.getLastInstancedDrawCount());
+    }
+    // each of the rest is a draw call of its own
+    countDrawCalls(transformations.size());
+    if (drawableSorting_) {
+      renderQueue_.draw(magnumCamera, transformations);
+    } else {
+      for (auto& transformation : transformations) {
+        transformation.first.get().draw(transformation.second, magnumCamera);
+      }
+    }
+  }
+
+  void draw(RenderCamera& camera,
+            MagnumDrawableGroup& drawables,
+            RenderPass pass = RenderPass::Full) {
+    beginFrameStats();
+    renderEnter(pass);
     camera.getMagnumCamera().setViewport(framebufferSize_);
 
-    depthUnprojection_ =
-        calculateDepthUnprojection(camera.getMagnumCamera().projectionMatrix());
+    depthUnprojection_ = camera.getDepthUnprojection();
+    depthUnprojectedScale_ = 0.0f;
 
-    camera.draw(drawables);
+    drawDrawables(camera, drawables, pass);
     renderExit();
+    endFrameStats();
   }
 
   void draw(sensor::Sensor& visualSensor, scene::SceneGraph& sceneGraph) {
@@ -86,71 +820,935 @@ struct Renderer::Impl {
     // set the modelview matrix, projection matrix of the render camera;
     sceneGraph.setDefaultRenderCamera(visualSensor);
 
-    draw(sceneGraph.getDefaultRenderCamera(), sceneGraph.getDrawables());
+    // depth and semantic sensors only read their attachment
+    RenderPass pass = RenderPass::Full;
+    if (sensorSpecificPasses_) {
+      switch (visualSensor.specification()->sensorType) {
+        case sensor::SensorType::DEPTH:
+          pass = RenderPass::DepthOnly;
+          break;
+        case sensor::SensorType::SEMANTIC:
+          pass = RenderPass::ObjectIdOnly;
+          break;
+        default:
+          break;
+      }
+    }
+    RenderCamera& camera = sceneGraph.getDefaultRenderCamera();
+    MagnumDrawableGroup& drawables = sceneGraph.getDrawables();
+    SensorFrame frame;
+    frame.target = target_;
+    frame.drawables = &drawables;
+    frame.transformation = camera.node().transformation();
+    frame.projection = camera.getMagnumCamera().projectionMatrix();
+    frame.pass = pass;
+    if (sensorFrameSharing_) {
+      frame.revision = getDrawablesRevision(drawables);
+      if (lastSensorFrame_.covers(frame)) {
+        return;
+      }
+    }
+    draw(camera, drawables, pass);
+    if (sensorFrameSharing_) {
+      lastSensorFrame_ = frame;
+    }
   }
 
-  void readFrameRgba(uint8_t* ptr) {
-    framebuffer_.mapForRead(GL::Framebuffer::ColorAttachment{0});
-    Image2D rgbaImage =
-        framebuffer_.read(Range2Di::fromSize({0, 0}, framebufferSize_),
-                          {PixelFormat::RGBA8Unorm});
-    std::memcpy(ptr, rgbaImage.data(), rgbaImage.data().size());
+  void drawPanorama(sensor::Sensor& visualSensor,
+                    scene::SceneGraph& sceneGraph,
+                    int faceSize,
+                    PanoramaProjection projection) {
+    ASSERT(visualSensor.isVisualSensor());
+    beginFrameStats();
+    sceneGraph.setDefaultRenderCamera(visualSensor);
+    RenderCamera& camera = sceneGraph.getDefaultRenderCamera();
+    camera.getMagnumCamera().setViewport({faceSize, faceSize});
+    const Matrix4 transformation = camera.node().transformation();
+
+    // the faces share the projection, and so the depth unprojection
+    depthUnprojection_ = camera.getDepthUnprojection();
+    depthUnprojectedScale_ = 0.0f;
+
+    if (projection == PanoramaProjection::CubeMap) {
+      // the faces are pinhole images already, drawn straight into their
+      // tiles of the frame
+      ASSERT(framebufferSize_ ==
+             Magnum::Vector2i(CubeMapFaceCount * faceSize, faceSize));
+      renderEnter();
+      for (int face = 0; face < CubeMapFaceCount; ++face) {
+        camera.node().setTransformation(
+            transformation * cubeMapFaceRotation(CubeMapFace(face)));
+        target_->framebuffer.setViewport(
+            Range2Di::fromSize({face * faceSize, 0}, {faceSize, faceSize}));
+        drawDrawables(camera, sceneGraph.getDrawables());
+      }
+      target_->framebuffer.setViewport({{}, framebufferSize_});
+    } else {
+      if (cubeMapTarget_.faceSize != faceSize) {
+        attachCubeMap(faceSize, cubeMapTarget_);
+      }
+      for (int face = 0; face < CubeMapFaceCount; ++face) {
+        GL::Framebuffer& framebuffer = cubeMapTarget_.framebuffers[face];
+        framebuffer.clearDepth(1.0);
+        framebuffer.clearColor(0, Color4{});
+        framebuffer.clearColor(1, Vector4ui{});
+        framebuffer.bind();
+        camera.node().setTransformation(
+            transformation * cubeMapFaceRotation(CubeMapFace(face)));
+        drawDrawables(camera, sceneGraph.getDrawables());
+      }
+
+      // every fragment of the frame samples the face it looks at; depth is
+      // written by the shader, so it has to pass against the cleared buffer
+      if (!equirectangularShader_) {
+        equirectangularShader_ = std::make_unique<EquirectangularShader>();
+      }
+      renderEnter();
+      GL::Renderer::setDepthFunction(GL::Renderer::DepthFunction::Always);
+      equirectangularShader_->setViewportSize(framebufferSize_)
+          .setDepthUnprojection(depthUnprojection_)
+          .bindTextures(cubeMapTarget_.colorTexture,
+                        cubeMapTarget_.objectIdTexture,
+                        cubeMapTarget_.depthTexture);
+      fullScreenTriangle_.draw(*equirectangularShader_);
+      countDrawCalls(1);
+      GL::Renderer::setDepthFunction(GL::Renderer::DepthFunction::Less);
+    }
+    camera.node().setTransformation(transformation);
+    renderExit();
+    endFrameStats();
   }
 
-  void readFrameDepth(float* ptr) {
-    Image2D depthImage = framebuffer_.read(
-        Range2Di::fromSize({0, 0}, framebufferSize_),
-        {GL::PixelFormat::DepthComponent, GL::PixelType::Float});
+  bool renderPoses(scene::SceneGraph& sceneGraph,
+                   const std::vector<Matrix4>& poses,
+                   const sensor::SensorSpec& spec,
+                   void* output) {
+    if (spec.sensorType != sensor::SensorType::COLOR &&
+        spec.sensorType != sensor::SensorType::DEPTH &&
+        spec.sensorType != sensor::SensorType::SEMANTIC) {
+      LOG(ERROR) << "Cannot render poses of sensor type "
+                 << int(spec.sensorType);
+      return false;
+    }
+    const FrameFormat format = getFrameFormat(spec);
+    // projection parameters as PinholeCamera reads them
+    auto parameter = [&](const char* name, float defaultValue) {
+      auto it = spec.parameters.find(name);
+      return it != spec.parameters.end() ? float(std::atof(it->second.c_str()))
+                                         : defaultValue;
+    };
+    const Magnum::Vector2i previousSize = framebufferSize_;
+    const Magnum::Vector2i size{spec.resolution[1], spec.resolution[0]};
+    if (size != framebufferSize_) {
+      setSize(size.x(), size.y());
+    }
+    RenderCamera& camera = sceneGraph.getDefaultRenderCamera();
+    const Matrix4 cameraTransformation = camera.node().transformation();
+    camera.setProjectionMatrix(size.x(), size.y(), parameter("near", 0.01f),
+                               parameter("far", 1000.0f),
+                               parameter("hfov", 90.0f));
+
+    const std::size_t frameSize =
+        getFrameFormatPixelBytes(format) * size.product();
+    char* frames = static_cast<char*>(output);
+    // tickets and poses in flight, oldest first; the ring recycles the
+    // oldest slot on every readback, so that one is collected first
+    std::deque<std::pair<int, int>> inFlight;
+    for (int i = 0; i < poses.size(); ++i) {
+      camera.node().setTransformation(poses[i]);
+      draw(camera, sceneGraph.getDrawables());
+      char* frame = frames + i * frameSize;
+      if (readbackRing_.empty()) {
+        readFrame(format, frame);
+        continue;
+      }
+      if (inFlight.size() == readbackRing_.size()) {
+        waitFrame(inFlight.front().first,
+                  frames + inFlight.front().second * frameSize);
+        inFlight.pop_front();
+      }
+      inFlight.emplace_back(readFrameAsync(format), i);
+    }
+    for (const auto& frame : inFlight) {
+      waitFrame(frame.first, frames + frame.second * frameSize);
+    }
+
+    camera.node().setTransformation(cameraTransformation);
+    if (size != previousSize) {
+      setSize(previousSize.x(), previousSize.y());
+    }
+    return true;
+  }
+
+  // read straight into the caller's memory, no intermediate image or copy
+  void readFrame(FrameFormat format, void* ptr) {
+    if (isDepthFormat(format)) {
+      ensureDepthUnprojected(format);
+    }
+    readFramePixels(frameSource(*target_, format), format,
+                    Range2Di::fromSize({0, 0}, framebufferSize_), ptr);
+  }
+
+  // read range of framebuffer, mapped for reading the attachment of format,
+  // in format into ptr
+  static void readFramePixels(GL::Framebuffer& framebuffer,
+                              FrameFormat format,
+                              const Range2Di& range,
+                              void* ptr) {
+    const std::size_t numPixels = range.size().product();
+    if (!isReadConverted(format)) {
+      const Image2D image =
+          framebuffer.read(range, {framePixelFormat(attachmentFormat(format))});
+      convertFramePixels(image.data(), format, numPixels, ptr);
+      return;
+    }
+    // rows of RGB or 16-bit pixels are not a multiple of 4 bytes
+    framebuffer.read(
+        range, MutableImageView2D{
+                   PixelStorage{}.setAlignment(1), framePixelFormat(format),
+                   range.size(),
+                   Containers::arrayView(
+                       static_cast<char*>(ptr),
+                       numPixels * getFrameFormatPixelBytes(format))});
+  }
+
+  // every linear blit to half the size averages 2x2 blocks exactly, so
+  // halving log2(factor) times box-filters by factor
+  void readFrameDownsampled(int factor, FrameFormat format, void* ptr) {
+    ASSERT(factor >= 1 && (factor & (factor - 1)) == 0);
+    ASSERT(attachmentFormat(format) == FrameFormat::Rgba8);
+    GL::Framebuffer* source = &target_->framebuffer;
+    source->mapForRead(GL::Framebuffer::ColorAttachment{0});
+    Magnum::Vector2i size = framebufferSize_;
+    for (; factor > 1; factor /= 2) {
+      const Magnum::Vector2i halfSize = size / 2;
+      GL::Framebuffer& target = downsampleTarget(halfSize).framebuffer;
+      GL::Framebuffer::blit(*source, target, {{}, halfSize * 2}, {{}, halfSize},
+                            GL::FramebufferBlit::Color,
+                            GL::FramebufferBlitFilter::Linear);
+      source = &target;
+      size = halfSize;
+    }
+    readFramePixels(*source, format, Range2Di::fromSize({0, 0}, size), ptr);
+  }
+
+  DownsampleTarget& downsampleTarget(const Magnum::Vector2i& size) {
+    std::unique_ptr<DownsampleTarget>& target =
+        downsampleTargets_[{size.x(), size.y()}];
+    if (!target) {
+      target = std::make_unique<DownsampleTarget>();
+      // the format of the frame, so the bytes read back are the same
+      target->colorBuffer.setStorage(GL::RenderbufferFormat::SRGB8Alpha8,
+                                     size);
+      target->framebuffer = GL::Framebuffer{{{}, size}};
+      target->framebuffer
+          .attachRenderbuffer(GL::Framebuffer::ColorAttachment{0},
+                              target->colorBuffer)
+          .mapForDraw(GL::Framebuffer::ColorAttachment{0})
+          .mapForRead(GL::Framebuffer::ColorAttachment{0});
+      CORRADE_INTERNAL_ASSERT(
+          target->framebuffer.checkStatus(GL::FramebufferTarget::Draw) ==
+          GL::Framebuffer::Status::Complete);
+    }
+    return *target;
+  }
+
+  void setAsyncReadbackFrames(int numFrames) {
+    ASSERT(numFrames >= 0);
+    for (auto& slot : readbackRing_) {
+      releaseReadback(*slot);
+    }
+    readbackRing_.clear();
+    for (int i = 0; i < numFrames; ++i) {
+      readbackRing_.emplace_back(std::make_unique<AsyncReadback>());
+    }
+  }
+
+  void releaseReadback(AsyncReadback& slot) {
+#ifndef MAGNUM_TARGET_WEBGL
+    if (slot.fence != nullptr) {
+      glDeleteSync(slot.fence);
+      slot.fence = nullptr;
+    }
+#else
+    slot.image = Containers::NullOpt;
+#endif
+    slot.ticket = ID_UNDEFINED;
+  }
+
+  int readFrameAsync(FrameFormat format) {
+    if (isDepthFormat(format)) {
+      ensureDepthUnprojected(format);
+    }
+    return readFrameAsync(format, *target_,
+                          Range2Di::fromSize({0, 0}, framebufferSize_));
+  }
+
+  // queue the transfer of range of target, whose depth must already be
+  // unprojected for format if it is a depth format
+  int readFrameAsync(FrameFormat format,
+                     RenderTarget& target,
+                     const Range2Di& range) {
+    ASSERT(!readbackRing_.empty());
+    const int ticket = nextReadbackTicket_++;
+    AsyncReadback& slot = *readbackRing_[ticket % readbackRing_.size()];
+    releaseReadback(slot);
+    slot.ticket = ticket;
+    slot.format = format;
+    slot.readFormat =
+        isReadConverted(format) ? format : attachmentFormat(format);
+    slot.numPixels = range.size().product();
+    const PixelFormat pixelFormat = framePixelFormat(slot.readFormat);
+    GL::Framebuffer& source = frameSource(target, format);
+
+#ifndef MAGNUM_TARGET_WEBGL
+    slot.image.setData(PixelStorage{}.setAlignment(1),
+                       GL::pixelFormat(pixelFormat), GL::pixelType(pixelFormat),
+                       range.size(), nullptr, GL::BufferUsage::StreamRead);
+    // the read into a pixel buffer returns immediately; the fence tells us
+    // when the transfer has actually finished
+    source.read(range, slot.image, GL::BufferUsage::StreamRead);
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+#else
+    slot.image = source.read(range, {pixelFormat});
+#endif
+    return ticket;
+  }
+
+#ifdef ESP_BUILD_WITH_CUDA
+  // CUDA cannot register the sRGB color or the depth renderbuffer, so the
+  // frame goes through a pixel buffer that stays registered with CUDA and is
+  // only re-registered when a resize reallocates its storage
+  void readFrameCuda(GL::Framebuffer& framebuffer,
+                     GL::BufferImage2D& image,
+                     CudaGLBuffer& cudaBuffer,
+                     void* devPtr) {
+    framebuffer.read(Range2Di::fromSize({0, 0}, framebufferSize_), image,
+                     GL::BufferUsage::StreamRead);
+    cudaBuffer.registerBuffer(image.buffer(), image.dataSize());
+    cudaBuffer.copyToDevice(devPtr,
+                            image.pixelSize() * framebufferSize_.product());
+  }
+
+  void readFrameRgbaCuda(void* devPtr) {
+    target_->framebuffer.mapForRead(GL::Framebuffer::ColorAttachment{0});
+    readFrameCuda(target_->framebuffer, cudaRgbaImage_, cudaRgbaBuffer_,
+                  devPtr);
+  }
+
+  void readFrameDepthCuda(void* devPtr) {
+    ensureDepthUnprojected(FrameFormat::Depth32F);
+    readFrameCuda(target_->unprojectedDepthFramebuffer, cudaDepthImage_,
+                  cudaDepthBuffer_, devPtr);
+  }
+
+  void readFrameObjectIdCuda(void* devPtr) {
+    target_->framebuffer.mapForRead(GL::Framebuffer::ColorAttachment{1});
+    readFrameCuda(target_->framebuffer, cudaObjectIdImage_,
+                  cudaObjectIdBuffer_, devPtr);
+  }
+#endif
+
+  AsyncReadback* findReadback(int ticket) {
+    if (ticket < 0 || readbackRing_.empty()) {
+      return nullptr;
+    }
+    AsyncReadback& slot = *readbackRing_[ticket % readbackRing_.size()];
+    return slot.ticket == ticket ? &slot : nullptr;
+  }
+
+  bool isFrameReady(int ticket) {
+    AsyncReadback* slot = findReadback(ticket);
+    if (slot == nullptr) {
+      return false;
+    }
+#ifndef MAGNUM_TARGET_WEBGL
+    GLint status = GL_UNSIGNALED;
+    glGetSynciv(slot->fence, GL_SYNC_STATUS, 1, nullptr, &status);
+    return status == GL_SIGNALED;
+#else
+    return true;
+#endif
+  }
+
+  bool waitFrame(int ticket, void* ptr) {
+    AsyncReadback* slot = findReadback(ticket);
+    if (slot == nullptr) {
+      LOG(ERROR) << "Readback ticket " << ticket
+                 << " is unknown or has already been recycled";
+      return false;
+    }
+#ifndef MAGNUM_TARGET_WEBGL
+    // flush on the first wait so the fence is guaranteed to be signaled
+    GLenum result = glClientWaitSync(slot->fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+                                     kReadbackWaitTimeoutNs);
+    while (result == GL_TIMEOUT_EXPIRED) {
+      result = glClientWaitSync(slot->fence, 0, kReadbackWaitTimeoutNs);
+    }
+    CORRADE_INTERNAL_ASSERT(result != GL_WAIT_FAILED);
+
+    GL::Buffer& buffer = slot->image.buffer();
+    const std::size_t size = slot->image.dataSize();
+    Containers::ArrayView<const char> data =
+        buffer.map(0, size, GL::Buffer::MapFlag::Read);
+    CORRADE_INTERNAL_ASSERT(data);
+    if (slot->readFormat == slot->format) {
+      std::memcpy(ptr, data.data(), size);
+    } else {
+      convertFramePixels(data.data(), slot->format, slot->numPixels, ptr);
+    }
+    buffer.unmap();
+#else
+    if (slot->readFormat == slot->format) {
+      std::memcpy(ptr, slot->image->data(), slot->image->data().size());
+    } else {
+      convertFramePixels(slot->image->data(), slot->format, slot->numPixels,
+                         ptr);
+    }
+#endif
+    releaseReadback(*slot);
+    return true;
+  }
+
+  void drawBatch(const std::vector<sensor::Sensor*>& visualSensors,
+                 const std::vector<scene::SceneGraph*>& sceneGraphs) {
+    ASSERT(visualSensors.size() == sceneGraphs.size());
+    batchTiles_.clear();
+    batchSensorToTile_.assign(visualSensors.size(), ID_UNDEFINED);
+
+    // assign a tile to every sensor, reusing the tile of an earlier sensor
+    // that sees exactly the same image
+    Magnum::Vector2i cellSize;
+    for (int iSensor = 0; iSensor < visualSensors.size(); ++iSensor) {
+      sensor::Sensor& visualSensor = *visualSensors[iSensor];
+      scene::SceneGraph& sceneGraph = *sceneGraphs[iSensor];
+      ASSERT(visualSensor.isVisualSensor());
+
+      sceneGraph.setDefaultRenderCamera(visualSensor);
+      RenderCamera& camera = sceneGraph.getDefaultRenderCamera();
+      const vec2i& resolution = visualSensor.specification()->resolution;
+      BatchTile tile;
+      tile.sceneGraph = &sceneGraph;
+      tile.sensorIndex = iSensor;
+      tile.size = {resolution[1], resolution[0]};
+      tile.transformation = camera.node().transformation();
+      tile.projection = camera.getMagnumCamera().projectionMatrix();
+
+      for (int iTile = 0; iTile < batchTiles_.size(); ++iTile) {
+        const BatchTile& other = batchTiles_[iTile];
+        if (other.sceneGraph == tile.sceneGraph && other.size == tile.size &&
+            other.transformation == tile.transformation &&
+            other.projection == tile.projection) {
+          batchSensorToTile_[iSensor] = iTile;
+          break;
+        }
+      }
+      if (batchSensorToTile_[iSensor] == ID_UNDEFINED) {
+        batchSensorToTile_[iSensor] = batchTiles_.size();
+        cellSize = Math::max(cellSize, tile.size);
+        batchTiles_.push_back(tile);
+      }
+    }
+    if (batchTiles_.empty()) {
+      return;
+    }
+    beginFrameStats();
+
+    // lay the tiles out on a square-ish grid of equally sized cells and only
+    // ever grow the shared framebuffer, so repeated batches of the same
+    // sensors do not reallocate any GPU storage
+    const int numCols = std::ceil(std::sqrt(float(batchTiles_.size())));
+    const int numRows = (batchTiles_.size() + numCols - 1) / numCols;
+    const Magnum::Vector2i requiredSize{numCols * cellSize.x(),
+                                        numRows * cellSize.y()};
+    if (requiredSize.x() > batchFramebufferSize_.x() ||
+        requiredSize.y() > batchFramebufferSize_.y()) {
+      batchFramebufferSize_ = Math::max(batchFramebufferSize_, requiredSize);
+      attachBuffers(batchFramebufferSize_, batchTarget_);
+    }
+
+    batchTarget_.framebuffer.setViewport({{}, batchFramebufferSize_});
+    batchTarget_.framebuffer.clearDepth(1.0);
+    batchTarget_.framebuffer.clearColor(0, Color4{});
+    batchTarget_.framebuffer.clearColor(1, Vector4ui{});
+    batchTarget_.framebuffer.bind();
+
+    for (int iTile = 0; iTile < batchTiles_.size(); ++iTile) {
+      BatchTile& tile = batchTiles_[iTile];
+      const Magnum::Vector2i offset{(iTile % numCols) * cellSize.x(),
+                                    (iTile / numCols) * cellSize.y()};
+      tile.viewport = Range2Di::fromSize(offset, tile.size);
 
-    /* Unproject the Z */
-    unprojectDepth(depthUnprojection_,
-                   Containers::arrayCast<Float>(depthImage.data()));
-    std::memcpy(ptr, depthImage.data(), depthImage.data().size());
+      tile.sceneGraph->setDefaultRenderCamera(
+          *visualSensors[tile.sensorIndex]);
+      RenderCamera& camera = tile.sceneGraph->getDefaultRenderCamera();
+      camera.getMagnumCamera().setViewport(tile.size);
+      tile.depthUnprojection = camera.getDepthUnprojection();
+
+      // the framebuffer is bound, so the new viewport takes effect right away
+      batchTarget_.framebuffer.setViewport(tile.viewport);
+      drawDrawables(camera, tile.sceneGraph->getDrawables());
+    }
+    renderExit();
+    endFrameStats();
   }
 
-  void readFrameObjectId(uint32_t* ptr) {
-    framebuffer_.mapForRead(GL::Framebuffer::ColorAttachment{1});
-    Image2D objectImage = framebuffer_.read(
-        Range2Di::fromSize({0, 0}, framebufferSize_), {PixelFormat::R32UI});
-    std::memcpy(ptr, objectImage.data(), objectImage.data().size());
+  BatchTile& getBatchTile(int index) {
+    ASSERT(index >= 0 && index < batchSensorToTile_.size());
+    return batchTiles_[batchSensorToTile_[index]];
+  }
+
+  void ensureBatchDepthUnprojected(BatchTile& tile, FrameFormat format) {
+    const float scale = depthUnprojectionScale(format);
+    if (tile.depthUnprojectedScale != scale) {
+      unprojectDepthOnGpu(batchTarget_.depthTexture,
+                          batchTarget_.unprojectedDepthFramebuffer,
+                          tile.viewport, tile.depthUnprojection, scale);
+      tile.depthUnprojectedScale = scale;
+    }
+  }
+
+  void readBatchFrame(int index, FrameFormat format, void* ptr) {
+    BatchTile& tile = getBatchTile(index);
+    if (isDepthFormat(format)) {
+      ensureBatchDepthUnprojected(tile, format);
+    }
+    readFramePixels(frameSource(batchTarget_, format), format, tile.viewport,
+                    ptr);
+  }
+
+  // the tiles of the batch framebuffer are read into the ring like whole
+  // frames, so that the next batch can be drawn while they transfer
+  int readBatchFrameAsync(int index, FrameFormat format) {
+    BatchTile& tile = getBatchTile(index);
+    if (isDepthFormat(format)) {
+      ensureBatchDepthUnprojected(tile, format);
+    }
+    return readFrameAsync(format, batchTarget_, tile.viewport);
   }
 
   Magnum::Vector2i framebufferSize_;
-  GL::Renderbuffer colorBuffer_;
-  GL::Renderbuffer objectIdBuffer_;
-  GL::Renderbuffer depthRenderbuffer_;
-  GL::Framebuffer framebuffer_;
+  // maps: (width, height) -> target of that size
+  std::map<std::pair<int, int>, std::unique_ptr<RenderTarget>> targetPool_;
+  // the target of framebufferSize_
+  RenderTarget* target_ = nullptr;
+  uint64_t targetClock_ = 0;
+  static constexpr size_t maxPooledTargets = 8;
+  // maps: (width, height) -> level of that size of the downsampling chains
+  std::map<std::pair<int, int>, std::unique_ptr<DownsampleTarget>>
+      downsampleTargets_;
 
   Vector2 depthUnprojection_;
+  // scale the depth of the frame was unprojected at, 0 if it was not
+  float depthUnprojectedScale_ = 0.0f;
+  DepthShader depthShader_{DepthShader::Flag::UnprojectExistingDepth};
+  GL::Mesh fullScreenTriangle_;
+
+  // noise of the depth of the frame, applied by the unprojection pass
+  SensorNoiseModel depthNoise_;
+  uint32_t depthNoiseSeed_ = 0;
+  std::map<SensorNoiseType, std::unique_ptr<SensorNoiseShader>> noiseShaders_;
+  NoiseSourceTarget noiseSource_;
+
+  bool occlusionCulling_ = false;
+  OcclusionCuller occlusionCuller_;
+  bool regionCulling_ = false;
+  std::map<MagnumDrawableGroup*,
+           std::shared_ptr<const scene::RegionVisibility>>
+      regionVisibilities_;
+
+  bool multiDrawBatching_ = false;
+  MultiDrawBatch multiDrawBatch_;
+
+  bool instancedDrawing_ = true;
+  InstancedDrawer instancedDrawer_;
+
+  bool drawableSorting_ = true;
+  RenderQueue renderQueue_;
+
+  bool sensorSpecificPasses_ = true;
+
+  // what the last draw(visualSensor, sceneGraph) left in target_, for the
+  // next sensor at the same pose to read instead of drawing again
+  struct SensorFrame {
+    // null once anything else was drawn into the target
+    RenderTarget* target = nullptr;
+    MagnumDrawableGroup* drawables = nullptr;
+    uint64_t revision = 0;
+    Matrix4 transformation;
+    Matrix4 projection;
+    RenderPass pass = RenderPass::Full;
+
+    // whether this frame holds everything frame would draw
+    bool covers(const SensorFrame& frame) const {
+      return target != nullptr && target == frame.target &&
+             drawables == frame.drawables && revision == frame.revision &&
+             transformation == frame.transformation &&
+             projection == frame.projection &&
+             (pass == RenderPass::Full || pass == frame.pass);
+    }
+  };
+  bool sensorFrameSharing_ = true;
+  SensorFrame lastSensorFrame_;
+  // created with the first depth-only pass
+  std::unique_ptr<Shaders::Flat3D> depthOnlyShader_;
+
+  bool frustumCulling_ = true;
+  // per drawable group, i.e. per scene graph drawn
+  std::map<MagnumDrawableGroup*, DrawableBVH> drawableBVHs_;
+
+  // ==== panoramas ====
+  CubeMapTarget cubeMapTarget_;
+  // compiled on the first equirectangular panorama
+  std::unique_ptr<EquirectangularShader> equirectangularShader_;
+
+  // GPU time of the draws and readbacks, see ESP_PROFILE_GPU_SCOPE()
+  GpuProfiler gpuProfiler_;
+
+  // ==== render stats ====
+  size_t renderStatsFrames_ = 0;
+  // the frame being drawn, null if stats are off
+  std::unique_ptr<FrameStatsQueries> frameStats_;
+  std::deque<std::unique_ptr<FrameStatsQueries>> pendingStats_;
+  std::vector<std::unique_ptr<FrameStatsQueries>> freeStatsQueries_;
+  std::deque<RenderStats> renderStats_;
+
+  // ==== asynchronous readback ====
+#ifndef MAGNUM_TARGET_WEBGL
+  // how long a single glClientWaitSync blocks before we check again
+  static constexpr GLuint64 kReadbackWaitTimeoutNs = 1000000;
+#endif
+  std::vector<std::unique_ptr<AsyncReadback>> readbackRing_;
+  int nextReadbackTicket_ = 0;
+
+#ifdef ESP_BUILD_WITH_CUDA
+  // ==== CUDA-GL interop ====
+  GL::BufferImage2D cudaRgbaImage_{GL::PixelFormat::RGBA,
+                                   GL::PixelType::UnsignedByte};
+  GL::BufferImage2D cudaDepthImage_{GL::PixelFormat::Red,
+                                    GL::PixelType::Float};
+  GL::BufferImage2D cudaObjectIdImage_{GL::PixelFormat::RedInteger,
+                                       GL::PixelType::UnsignedInt};
+  CudaGLBuffer cudaRgbaBuffer_;
+  CudaGLBuffer cudaDepthBuffer_;
+  CudaGLBuffer cudaObjectIdBuffer_;
+#endif
+
+  // ==== batched rendering ====
+  Magnum::Vector2i batchFramebufferSize_;
+  RenderTarget batchTarget_;
+  std::vector<BatchTile> batchTiles_;
+  std::vector<int> batchSensorToTile_;
 };
 
 Renderer::Renderer(int width, int height)
     : pimpl_(spimpl::make_unique_impl<Impl>(width, height)) {}
 
 void Renderer::draw(RenderCamera& camera, scene::SceneGraph& sceneGraph) {
+  ESP_PROFILE_GPU_SCOPE(pimpl_->gpuProfiler_, "Renderer::draw");
+  core::HistogramTimer timer(renderSeconds());
   pimpl_->draw(camera, sceneGraph.getDrawables());
 }
 
 void Renderer::draw(sensor::Sensor& visualSensor,
                     scene::SceneGraph& sceneGraph) {
+  ESP_PROFILE_GPU_SCOPE(pimpl_->gpuProfiler_, "Renderer::draw");
+  core::HistogramTimer timer(renderSeconds());
   pimpl_->draw(visualSensor, sceneGraph);
 }
 
+void Renderer::drawPanorama(sensor::Sensor& visualSensor,
+                            scene::SceneGraph& sceneGraph,
+                            int faceSize,
+                            PanoramaProjection projection) {
+  ESP_PROFILE_GPU_SCOPE(pimpl_->gpuProfiler_, "Renderer::drawPanorama");
+  core::HistogramTimer timer(renderSeconds());
+  pimpl_->drawPanorama(visualSensor, sceneGraph, faceSize, projection);
+}
+
+bool Renderer::renderPoses(scene::SceneGraph& sceneGraph,
+                           const std::vector<Magnum::Matrix4>& poses,
+                           const sensor::SensorSpec& spec,
+                           void* output) {
+  ESP_PROFILE_GPU_SCOPE(pimpl_->gpuProfiler_, "Renderer::renderPoses");
+  core::HistogramTimer timer(renderSeconds());
+  return pimpl_->renderPoses(sceneGraph, poses, spec, output);
+}
+
 void Renderer::setSize(int width, int height) {
   pimpl_->setSize(width, height);
 }
 
 void Renderer::readFrameRgba(uint8_t* ptr) {
-  pimpl_->readFrameRgba(ptr);
+  ESP_PROFILE_GPU_SCOPE(pimpl_->gpuProfiler_, "Renderer::readFrameRgba");
+  core::HistogramTimer timer(readbackSeconds());
+  pimpl_->readFrame(FrameFormat::Rgba8, ptr);
+}
+
+void Renderer::readFrameRgbaDownsampled(int factor, uint8_t* ptr) {
+  ESP_PROFILE_GPU_SCOPE(pimpl_->gpuProfiler_,
+                        "Renderer::readFrameRgbaDownsampled");
+  core::HistogramTimer timer(readbackSeconds());
+  pimpl_->readFrameDownsampled(factor, FrameFormat::Rgba8, ptr);
 }
 
 void Renderer::readFrameDepth(float* ptr) {
-  pimpl_->readFrameDepth(ptr);
+  ESP_PROFILE_GPU_SCOPE(pimpl_->gpuProfiler_, "Renderer::readFrameDepth");
+  core::HistogramTimer timer(readbackSeconds());
+  pimpl_->readFrame(FrameFormat::Depth32F, ptr);
 }
 
 void Renderer::readFrameObjectId(uint32_t* ptr) {
-  pimpl_->readFrameObjectId(ptr);
+  ESP_PROFILE_GPU_SCOPE(pimpl_->gpuProfiler_, "Renderer::readFrameObjectId");
+  core::HistogramTimer timer(readbackSeconds());
+  pimpl_->readFrame(FrameFormat::ObjectId32, ptr);
+}
+
+void Renderer::readFrame(FrameFormat format, void* ptr) {
+  ESP_PROFILE_GPU_SCOPE(pimpl_->gpuProfiler_, "Renderer::readFrame");
+  core::HistogramTimer timer(readbackSeconds());
+  pimpl_->readFrame(format, ptr);
+}
+
+void Renderer::readFrameDownsampled(int factor,
+                                    FrameFormat format,
+                                    void* ptr) {
+  ESP_PROFILE_GPU_SCOPE(pimpl_->gpuProfiler_,
+                        "Renderer::readFrameDownsampled");
+  core::HistogramTimer timer(readbackSeconds());
+  pimpl_->readFrameDownsampled(factor, format, ptr);
+}
+
+void Renderer::applySensorNoise(const SensorNoiseModel& model,
+                                uint32_t frameSeed) {
+  ESP_PROFILE_GPU_SCOPE(pimpl_->gpuProfiler_, "Renderer::applySensorNoise");
+  pimpl_->applySensorNoise(model, frameSeed);
+}
+
+void Renderer::drawBatch(const std::vector<sensor::Sensor*>& visualSensors,
+                         const std::vector<scene::SceneGraph*>& sceneGraphs) {
+  ESP_PROFILE_GPU_SCOPE(pimpl_->gpuProfiler_, "Renderer::drawBatch");
+  core::HistogramTimer timer(renderSeconds());
+  pimpl_->drawBatch(visualSensors, sceneGraphs);
+}
+
+void Renderer::readBatchFrameRgba(int index, uint8_t* ptr) {
+  ESP_PROFILE_GPU_SCOPE(pimpl_->gpuProfiler_, "Renderer::readBatchFrameRgba");
+  core::HistogramTimer timer(readbackSeconds());
+  pimpl_->readBatchFrame(index, FrameFormat::Rgba8, ptr);
+}
+
+void Renderer::readBatchFrameDepth(int index, float* ptr) {
+  ESP_PROFILE_GPU_SCOPE(pimpl_->gpuProfiler_, "Renderer::readBatchFrameDepth");
+  core::HistogramTimer timer(readbackSeconds());
+  pimpl_->readBatchFrame(index, FrameFormat::Depth32F, ptr);
+}
+
+void Renderer::readBatchFrameObjectId(int index, uint32_t* ptr) {
+  ESP_PROFILE_GPU_SCOPE(pimpl_->gpuProfiler_,
+                        "Renderer::readBatchFrameObjectId");
+  core::HistogramTimer timer(readbackSeconds());
+  pimpl_->readBatchFrame(index, FrameFormat::ObjectId32, ptr);
+}
+
+void Renderer::readBatchFrame(int index, FrameFormat format, void* ptr) {
+  ESP_PROFILE_GPU_SCOPE(pimpl_->gpuProfiler_, "Renderer::readBatchFrame");
+  core::HistogramTimer timer(readbackSeconds());
+  pimpl_->readBatchFrame(index, format, ptr);
+}
+
+int Renderer::readBatchFrameRgbaAsync(int index) {
+  return pimpl_->readBatchFrameAsync(index, FrameFormat::Rgba8);
+}
+
+int Renderer::readBatchFrameDepthAsync(int index) {
+  return pimpl_->readBatchFrameAsync(index, FrameFormat::Depth32F);
+}
+
+int Renderer::readBatchFrameObjectIdAsync(int index) {
+  return pimpl_->readBatchFrameAsync(index, FrameFormat::ObjectId32);
+}
+
+int Renderer::readBatchFrameAsync(int index, FrameFormat format) {
+  return pimpl_->readBatchFrameAsync(index, format);
+}
+
+int Renderer::readFrameRgbaAsync() {
+  return pimpl_->readFrameAsync(FrameFormat::Rgba8);
+}
+
+int Renderer::readFrameDepthAsync() {
+  return pimpl_->readFrameAsync(FrameFormat::Depth32F);
+}
+
+int Renderer::readFrameObjectIdAsync() {
+  return pimpl_->readFrameAsync(FrameFormat::ObjectId32);
+}
+
+int Renderer::readFrameAsync(FrameFormat format) {
+  return pimpl_->readFrameAsync(format);
+}
+
+bool Renderer::isFrameReady(int ticket) {
+  return pimpl_->isFrameReady(ticket);
+}
+
+bool Renderer::waitFrame(int ticket, void* ptr) {
+  core::HistogramTimer timer(readbackSeconds());
+  return pimpl_->waitFrame(ticket, ptr);
+}
+
+void Renderer::setAsyncReadbackFrames(int numFrames) {
+  pimpl_->setAsyncReadbackFrames(numFrames);
+}
+
+int Renderer::getAsyncReadbackFrames() {
+  return pimpl_->readbackRing_.size();
+}
+
+void Renderer::setRenderStatsFrames(int numFrames) {
+  pimpl_->setRenderStatsFrames(numFrames);
+}
+
+int Renderer::getRenderStatsFrames() {
+  return pimpl_->renderStatsFrames_;
+}
+
+std::vector<RenderStats> Renderer::getRenderStats(bool wait) {
+  return pimpl_->getRenderStats(wait);
+}
+
+void Renderer::blitFrameToDefaultFramebuffer() {
+  pimpl_->blitFrameToDefaultFramebuffer();
+}
+
+uint64_t Renderer::getDrawablesRevision(scene::SceneGraph& sceneGraph) {
+  return pimpl_->getDrawablesRevision(sceneGraph.getDrawables());
+}
+
+void Renderer::setInstancedDrawing(bool enabled) {
+  pimpl_->instancedDrawing_ = enabled;
+}
+
+bool Renderer::isInstancedDrawing() {
+  return pimpl_->instancedDrawing_;
+}
+
+void Renderer::setMultiDrawBatching(bool enabled) {
+  pimpl_->multiDrawBatching_ = enabled;
+}
+
+bool Renderer::isMultiDrawBatching() {
+  return pimpl_->multiDrawBatching_;
+}
+
+void Renderer::setFrustumCulling(bool enabled) {
+  pimpl_->frustumCulling_ = enabled;
+}
+
+bool Renderer::isFrustumCulling() {
+  return pimpl_->frustumCulling_;
+}
+
+void Renderer::setOcclusionCulling(bool enabled) {
+  pimpl_->occlusionCulling_ = enabled;
+}
+
+bool Renderer::isOcclusionCulling() {
+  return pimpl_->occlusionCulling_;
+}
+
+void Renderer::setRegionCulling(bool enabled) {
+  pimpl_->regionCulling_ = enabled;
+}
+
+bool Renderer::isRegionCulling() {
+  return pimpl_->regionCulling_;
+}
+
+void Renderer::setRegionVisibility(
+    scene::SceneGraph& sceneGraph,
+    std::shared_ptr<const scene::RegionVisibility> visibility) {
+  if (visibility) {
+    pimpl_->regionVisibilities_[&sceneGraph.getDrawables()] =
+        std::move(visibility);
+  } else {
+    pimpl_->regionVisibilities_.erase(&sceneGraph.getDrawables());
+  }
+}
+
+void Renderer::setSensorSpecificPasses(bool enabled) {
+  pimpl_->sensorSpecificPasses_ = enabled;
+}
+
+bool Renderer::isSensorSpecificPasses() {
+  return pimpl_->sensorSpecificPasses_;
+}
+
+void Renderer::setSensorFrameSharing(bool enabled) {
+  pimpl_->sensorFrameSharing_ = enabled;
+  pimpl_->lastSensorFrame_.target = nullptr;
+}
+
+bool Renderer::isSensorFrameSharing() {
+  return pimpl_->sensorFrameSharing_;
+}
+
+void Renderer::setDrawableSorting(bool enabled) {
+  pimpl_->drawableSorting_ = enabled;
+}
+
+bool Renderer::isDrawableSorting() {
+  return pimpl_->drawableSorting_;
+}
+
+void Renderer::setLODPixelError(float pixels) {
+  Drawable::setLODPixelError(pixels);
+}
+
+float Renderer::getLODPixelError() {
+  return Drawable::getLODPixelError();
+}
+
+#ifdef ESP_BUILD_WITH_CUDA
+bool Renderer::readFrameRgbaCuda(void* devPtr) {
+  pimpl_->readFrameRgbaCuda(devPtr);
+  return true;
+}
+
+bool Renderer::readFrameDepthCuda(void* devPtr) {
+  pimpl_->readFrameDepthCuda(devPtr);
+  return true;
+}
+
+bool Renderer::readFrameObjectIdCuda(void* devPtr) {
+  pimpl_->readFrameObjectIdCuda(devPtr);
+  return true;
+}
+
+bool Renderer::isCudaInteropAvailable() {
+  return true;
+}
+#else
+bool Renderer::readFrameRgbaCuda(void*) {
+  LOG(ERROR) << "Renderer::readFrameRgbaCuda: built without CUDA support";
+  return false;
+}
+
+bool Renderer::readFrameDepthCuda(void*) {
+  LOG(ERROR) << "Renderer::readFrameDepthCuda: built without CUDA support";
+  return false;
+}
+
+bool Renderer::readFrameObjectIdCuda(void*) {
+  LOG(ERROR) << "Renderer::readFrameObjectIdCuda: built without CUDA support";
+  return false;
+}
+
+bool Renderer::isCudaInteropAvailable() {
+  return false;
 }
+#endif
 
 vec3i Renderer::getSize() {
   return vec3i(pimpl_->framebufferSize_[0], pimpl_->framebufferSize_[1], 4);
@@ -4,14 +4,76 @@
 
 #pragma once
 
+#include <vector>
+
+#include "esp/core/Buffer.h"
 #include "esp/core/esp.h"
 #include "esp/gfx/RenderCamera.h"
+#include "esp/gfx/SensorNoise.h"
+#include "esp/scene/RegionVisibility.h"
 #include "esp/scene/SceneGraph.h"
 #include "esp/sensor/Sensor.h"
 
 namespace esp {
 namespace gfx {
 
+// how Renderer::drawPanorama arranges the cube of faces around a sensor
+enum class PanoramaProjection {
+  // the six faces side by side: front, right, back, left, up, down
+  CubeMap,
+  // longitude from -180 to 180 degrees along x, latitude along y
+  Equirectangular,
+};
+
+// what the GPU did for one frame, i.e. one draw(), drawBatch() or
+// drawPanorama() call
+struct RenderStats {
+  // GPU time from the first to the last command of the frame in nanoseconds,
+  // 0 on WebGL
+  uint64_t gpuTimeNs = 0;
+  // triangles the GPU drew, after levels of detail and instancing; counted
+  // with a primitives generated query, so 0 on OpenGL ES and WebGL
+  uint64_t triangleCount = 0;
+  int drawCallCount = 0;
+  // drawables that passed frustum culling
+  int visibleDrawableCount = 0;
+  // of those, drawables in regions not visible from the region of the
+  // camera, skipped by region culling
+  int regionCulledDrawableCount = 0;
+  // of the rest, drawables occlusion culling found hidden and skipped
+  int occludedDrawableCount = 0;
+};
+
+// pixel formats frames are read back in. The GPU converts the frame while
+// reading it, so that only the bytes of the format are transferred; OpenGL
+// ES and WebGL, which read only the formats of the attachments, convert on
+// the CPU after reading those
+enum class FrameFormat {
+  // color, 4 x uint8 per pixel
+  Rgba8,
+  // color without alpha, 3 x uint8 per pixel
+  Rgb8,
+  // depth in meters as float
+  Depth32F,
+  // depth in meters as half float
+  Depth16F,
+  // depth in millimeters as uint16, saturating at 65.535 m
+  Depth16Mm,
+  // semantic object ids as uint32
+  ObjectId32,
+};
+
+// bytes of a pixel of format
+size_t getFrameFormatPixelBytes(FrameFormat format);
+
+// data type of the values of a pixel of format
+core::DataType getFrameFormatDataType(FrameFormat format);
+
+// format the frames of a visual sensor of spec are read in: by its type, for
+// color RGB if it has 3 channels or the encoding "rgb_uint8", and for depth
+// by its encoding, "depth_float16", "depth_uint16_mm" or else float
+FrameFormat getFrameFormat(const sensor::SensorSpec& spec);
+
 class Renderer {
  public:
   Renderer(int width, int height);
@@ -22,6 +84,33 @@ class Renderer {
   // draw the scene graph with the visual sensor provided by user
   void draw(sensor::Sensor& visualSensor, scene::SceneGraph& sceneGraph);
 
+  // draw the full sphere around visualSensor: the six 90 degree faces of a
+  // cube, faceSize x faceSize each, culled separately but drawn into a
+  // single cube map target, then arranged as projection on the GPU into the
+  // frame of the size set by setSize(), for CubeMap (6 * faceSize) x
+  // faceSize. visualSensor has to set a 90 degree square projection. Read
+  // with the readFrame* functions; depth is the distance along the ray for
+  // Equirectangular and the depth along the face axis for CubeMap
+  void drawPanorama(sensor::Sensor& visualSensor,
+                    scene::SceneGraph& sceneGraph,
+                    int faceSize,
+                    PanoramaProjection projection);
+
+  // render sceneGraph from each of poses, absolute camera transformations
+  // looking along -Z, with the resolution and projection of spec, into
+  // output: poses.size() frames one after another, each in the layout of
+  // the readFrame* function of the type of spec (readFrameRgba for COLOR,
+  // readFrameDepth for DEPTH and readFrameObjectId for SEMANTIC). No agent
+  // or sensor is involved, and the readback of every frame overlaps the
+  // drawing of the next ones through the asynchronous readback ring, whose
+  // outstanding tickets this recycles (synchronous if the ring is empty).
+  // The size set by setSize() is kept. Returns false for a spec of another
+  // type
+  bool renderPoses(scene::SceneGraph& sceneGraph,
+                   const std::vector<Magnum::Matrix4>& poses,
+                   const sensor::SensorSpec& spec,
+                   void* output);
+
   // draw the scene graph with the default camera in scene graph
   // user needs to set the default camera so that it has correct
   // modelview matrix, projection matrix to render the scene
@@ -34,6 +123,207 @@ class Renderer {
 
   void readFrameObjectId(uint32_t* ptr);
 
+  // box-filter the RGBA frame down by factor, a power of two, on the GPU and
+  // read only the result, of the frame size divided by factor; e.g. to
+  // anti-alias a small sensor drawn at factor times its resolution
+  void readFrameRgbaDownsampled(int factor, uint8_t* ptr);
+
+  // read the frame in format, converted on the GPU, into ptr, which must
+  // hold the pixels of the format; readFrameRgba(), readFrameDepth() and
+  // readFrameObjectId() read the Rgba8, Depth32F and ObjectId32 formats
+  void readFrame(FrameFormat format, void* ptr);
+
+  // readFrameRgbaDownsampled() in format, Rgba8 or Rgb8
+  void readFrameDownsampled(int factor, FrameFormat format, void* ptr);
+
+  // add the noise of model to the frame of the last draw on the GPU, drawn
+  // from frameSeed, so that the same seed gives the same noise. Color models
+  // change the color of the frame in place, before any readback of it, depth
+  // models the depth the readFrame* functions read until the next draw. A
+  // sensor drawing the frame again, instead of sharing it, sees no noise
+  void applySensorNoise(const SensorNoiseModel& model, uint32_t frameSeed);
+
+  // Asynchronous readback through a ring of pixel buffer objects.
+  // readFrame*Async() queues the transfer of the current frame and returns
+  // right away with a ticket, so the next frame can be drawn while this one is
+  // in flight. waitFrame() blocks until the transfer of the given ticket is
+  // complete and copies the pixels into ptr, which must be large enough for
+  // the frame (same layout as the synchronous readFrame* functions).
+  // At most getAsyncReadbackFrames() transfers are in flight; queueing one
+  // more recycles the buffer of the oldest, whose ticket then becomes invalid.
+  int readFrameRgbaAsync();
+
+  int readFrameDepthAsync();
+
+  int readFrameObjectIdAsync();
+
+  // asynchronous readFrame(); waitFrame() copies the pixels of format
+  int readFrameAsync(FrameFormat format);
+
+  // returns true if the transfer of ticket has completed, without blocking
+  bool isFrameReady(int ticket);
+
+  // returns false if ticket is unknown or its buffer has been recycled
+  bool waitFrame(int ticket, void* ptr);
+
+  void setAsyncReadbackFrames(int numFrames);
+
+  int getAsyncReadbackFrames();
+
+  // Draw generic drawables sharing a mesh and texture, such as many copies of
+  // the same physics object, in a single instanced draw call (default on).
+  // The images are the same either way.
+  void setInstancedDrawing(bool enabled);
+
+  bool isInstancedDrawing();
+
+  // Submit the generic drawables of glTF meshes with multi-draw-indirect
+  // calls, their meshes packed into shared buffers and their textures
+  // referenced by bindless handles, or copied into texture arrays without
+  // ARB_bindless_texture, so that the cost of a frame does not grow with the
+  // number of drawables or textures (default off). Needs GL 4.3 and is
+  // ignored otherwise; drawables drawn this way use the full detail of their
+  // meshes. The images are the same otherwise.
+  void setMultiDrawBatching(bool enabled);
+
+  bool isMultiDrawBatching();
+
+  // Skip drawables whose bounding box is outside of the view frustum (default
+  // on). The bounding boxes of a scene graph are kept in a hierarchy that is
+  // rebuilt when drawables are added, removed or moved.
+  void setFrustumCulling(bool enabled);
+
+  bool isFrustumCulling();
+
+  // Also skip drawables hidden behind the largest drawables in view, e.g. the
+  // walls of the room the camera is in, through a hierarchical-Z test of
+  // their bounding boxes against the depth of those drawables, drawn at a
+  // quarter of the resolution first (default off). Objects seen only through
+  // gaps of a few pixels may be culled. Not available on OpenGL ES and WebGL
+  void setOcclusionCulling(bool enabled);
+
+  bool isOcclusionCulling();
+
+  // Skip drawables that only overlap regions of the house not visible from
+  // the region the camera is in, by the potentially visible sets set for the
+  // scene graph with setRegionVisibility() (default off). Drawables without a
+  // bounding box or outside of all regions are always drawn, and so is
+  // everything while the camera is outside of all regions
+  void setRegionCulling(bool enabled);
+
+  bool isRegionCulling();
+
+  // Use visibility, made offline by the datatool create_region_visibility
+  // task, for region culling of sceneGraph; nullptr, e.g. before the scene
+  // graph is released, stops culling it
+  void setRegionVisibility(
+      scene::SceneGraph& sceneGraph,
+      std::shared_ptr<const scene::RegionVisibility> visibility);
+
+  // A number that changes whenever drawables of sceneGraph were added,
+  // removed or moved since the previous call or draw, through the dirty
+  // flags of their nodes, for sensors to reuse the frame of an unchanged
+  // scene. Changes that leave the nodes alone, like new textures, are not
+  // detected
+  uint64_t getDrawablesRevision(scene::SceneGraph& sceneGraph);
+
+  // Draw drawables sorted by shader, texture and mesh rather than in scene
+  // graph order, skipping texture binds and uniform sets that the previous
+  // drawable already did (default on).
+  void setDrawableSorting(bool enabled);
+
+  bool isDrawableSorting();
+
+  // Draw for a depth sensor only depth, with a trivial shader and no color
+  // writes, and for a semantic sensor only the object ids (default on). The
+  // other attachments of such a frame are left undefined.
+  void setSensorSpecificPasses(bool enabled);
+
+  bool isSensorSpecificPasses();
+
+  // Let draw(visualSensor, sceneGraph) keep the frame of the previous sensor
+  // instead of drawing again if it has the same pose and projection, the
+  // same scene graph with no drawable added, removed or moved since, and a
+  // pass that drew what it needs (default on). E.g. the color, depth and
+  // semantic sensors of an agent in an instance mesh scene, whose semantic
+  // scene graph is its scene graph, read one frame if the color sensor
+  // draws first. Anything else drawn in between forces a new draw
+  void setSensorFrameSharing(bool enabled);
+
+  bool isSensorFrameSharing();
+
+  // Draw the coarsest level of detail of a mesh whose error projects to less
+  // than pixels (default 1), 0 always draws the full meshes. Levels of detail
+  // are made offline by the datatool create_mesh_lods task. Shared by all
+  // renderers.
+  void setLODPixelError(float pixels);
+
+  float getLODPixelError();
+
+  // Keep the RenderStats of the last numFrames frames, measured with GL
+  // timer and primitive queries around every frame (default 0, off). The
+  // query results are picked up as they arrive, without stalling the draws
+  void setRenderStatsFrames(int numFrames);
+
+  int getRenderStatsFrames();
+
+  // stats of the last getRenderStatsFrames() frames, oldest first; waits for
+  // the GPU to finish the frames still in flight, or with wait false leaves
+  // those out, e.g. to show the stats while drawing
+  std::vector<RenderStats> getRenderStats(bool wait = true);
+
+  // Copy the color of the frame drawn last to the viewport of the default
+  // framebuffer, e.g. to show it in a window
+  void blitFrameToDefaultFramebuffer();
+
+  // CUDA-GL interop (requires building with BUILD_WITH_CUDA): copy the current
+  // frame straight into CUDA device memory at devPtr (same layout as the
+  // readFrame* functions) without a round trip through host memory, e.g. into
+  // the storage of a torch tensor on the GPU the GL context was created on.
+  // Returns false if CUDA interop support was not built.
+  bool readFrameRgbaCuda(void* devPtr);
+
+  bool readFrameDepthCuda(void* devPtr);
+
+  bool readFrameObjectIdCuda(void* devPtr);
+
+  static bool isCudaInteropAvailable();
+
+  // draw a batch of visual sensors in a single pass: visualSensors[i] observes
+  // sceneGraphs[i]. Every sensor is rendered into its own tile of one shared
+  // framebuffer, and sensors with the same pose, projection and scene graph
+  // (e.g., the RGB and depth sensors of an agent) share a single tile and
+  // thus a single traversal of the scene graph.
+  // The results stay available until the next call to drawBatch and are read
+  // back with the readBatchFrame* functions below.
+  void drawBatch(const std::vector<sensor::Sensor*>& visualSensors,
+                 const std::vector<scene::SceneGraph*>& sceneGraphs);
+
+  // read the frame of the index-th sensor of the last drawBatch call
+  void readBatchFrameRgba(int index, uint8_t* ptr);
+
+  void readBatchFrameDepth(int index, float* ptr);
+
+  void readBatchFrameObjectId(int index, uint32_t* ptr);
+
+  // read the frame of the index-th sensor in format, see readFrame()
+  void readBatchFrame(int index, FrameFormat format, void* ptr);
+
+  // queue the transfer of the frame of the index-th sensor of the last
+  // drawBatch call into the asynchronous readback ring, see
+  // readFrameRgbaAsync(); collect it with waitFrame(). Each sensor takes a
+  // slot of the ring, and the transfers stay valid across later batches
+  int readBatchFrameRgbaAsync(int index);
+
+  int readBatchFrameDepthAsync(int index);
+
+  int readBatchFrameObjectIdAsync(int index);
+
+  int readBatchFrameAsync(int index, FrameFormat format);
+
+  // render at width x height from now on; every size keeps its framebuffer,
+  // so sensors of different resolutions switching between sizes do not
+  // reallocate any GPU storage. Only the most recently used sizes are kept
   void setSize(int width, int height);
 
   vec3i getSize();
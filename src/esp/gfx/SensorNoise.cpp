@@ -0,0 +1,184 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#include "SensorNoise.h"
+
+#include <Corrade/Containers/Reference.h>
+#include <Corrade/Utility/Assert.h>
+#include <Corrade/Utility/Resource.h>
+#include <Magnum/GL/Shader.h>
+#include <Magnum/GL/Texture.h>
+#include <Magnum/GL/Version.h>
+
+#include "ShaderCache.h"
+#include "esp/sensor/Sensor.h"
+
+namespace Mn = Magnum;
+
+static void importShaderResources() {
+  CORRADE_RESOURCE_INITIALIZE(ShaderResources)
+}
+
+namespace esp {
+namespace gfx {
+
+namespace {
+enum { SourceTextureUnit = 0 };
+
+// the parameter key of spec as a float, defaultValue if it has none
+float noiseParameter(const sensor::SensorSpec& spec,
+                     const std::string& key,
+                     float defaultValue) {
+  auto found = spec.parameters.find(key);
+  return found == spec.parameters.end() ? defaultValue
+                                        : std::stof(found->second);
+}
+}  // namespace
+
+SensorNoiseModel getSensorNoiseModel(const sensor::SensorSpec& spec) {
+  SensorNoiseModel model;
+  auto found = spec.parameters.find("noise_model");
+  if (found == spec.parameters.end() || found->second.empty()) {
+    return model;
+  }
+  const std::string& name = found->second;
+  if (name == "gaussian") {
+    model.type = SensorNoiseType::Gaussian;
+  } else if (name == "speckle") {
+    model.type = SensorNoiseType::Speckle;
+  } else if (name == "salt_and_pepper") {
+    model.type = SensorNoiseType::SaltAndPepper;
+  } else if (name == "redwood") {
+    model.type = SensorNoiseType::Redwood;
+  } else {
+    LOG(ERROR) << "Unknown noise model " << name << " of sensor " << spec.uuid;
+    return model;
+  }
+  const bool depthSensor = spec.sensorType == sensor::SensorType::DEPTH;
+  if ((spec.sensorType != sensor::SensorType::COLOR && !depthSensor) ||
+      model.isDepth() != depthSensor) {
+    LOG(ERROR) << "Noise model " << name << " does not apply to sensor "
+               << spec.uuid;
+    return SensorNoiseModel{};
+  }
+
+  model.mean = noiseParameter(spec, "noise_mean", model.mean);
+  model.sigma = noiseParameter(spec, "noise_sigma", model.sigma);
+  model.intensity = noiseParameter(spec, "noise_intensity", model.intensity);
+  model.amount = noiseParameter(spec, "noise_amount", model.amount);
+  model.saltRatio = noiseParameter(spec, "noise_salt_ratio", model.saltRatio);
+  model.multiplier =
+      noiseParameter(spec, "noise_multiplier", model.multiplier);
+  found = spec.parameters.find("noise_seed");
+  if (found != spec.parameters.end()) {
+    model.seed = std::stoul(found->second);
+  }
+  return model;
+}
+
+SensorNoiseShader::SensorNoiseShader(SensorNoiseType type) : type_(type) {
+  CORRADE_INTERNAL_ASSERT(type != SensorNoiseType::None);
+  if (!Corrade::Utility::Resource::hasGroup("default-shaders")) {
+    importShaderResources();
+  }
+
+  const Corrade::Utility::Resource rs{"default-shaders"};
+
+#ifdef MAGNUM_TARGET_WEBGL
+  Mn::GL::Version glVersion = Mn::GL::Version::GLES300;
+#else
+  Mn::GL::Version glVersion = Mn::GL::Version::GL410;
+#endif
+
+  std::string define;
+  switch (type) {
+    case SensorNoiseType::Gaussian:
+      define = "#define GAUSSIAN\n";
+      break;
+    case SensorNoiseType::Speckle:
+      define = "#define SPECKLE\n";
+      break;
+    case SensorNoiseType::SaltAndPepper:
+      define = "#define SALT_AND_PEPPER\n";
+      break;
+    case SensorNoiseType::Redwood:
+      define = "#define REDWOOD\n";
+      break;
+    case SensorNoiseType::None:
+      CORRADE_ASSERT_UNREACHABLE();
+  }
+  const std::string vertSource = rs.get("sensor-noise.vert");
+  const std::string fragSource = define + rs.get("sensor-noise.frag");
+  const std::string binaryKey =
+      programBinaryKey("sensor-noise", {vertSource, fragSource});
+
+  if (!loadProgramBinary(*this, binaryKey)) {
+    Mn::GL::Shader vert{glVersion, Mn::GL::Shader::Type::Vertex};
+    Mn::GL::Shader frag{glVersion, Mn::GL::Shader::Type::Fragment};
+
+    vert.addSource(vertSource);
+    frag.addSource(fragSource);
+
+    CORRADE_INTERNAL_ASSERT_OUTPUT(Mn::GL::Shader::compile({vert, frag}));
+
+    attachShaders({vert, frag});
+
+    prepareProgramBinary(*this);
+    CORRADE_INTERNAL_ASSERT_OUTPUT(link());
+    saveProgramBinary(*this, binaryKey);
+  }
+
+  setUniform(uniformLocation("sourceTexture"), SourceTextureUnit);
+  seedUniform_ = uniformLocation("seed");
+  if (type == SensorNoiseType::Redwood) {
+    multiplierUniform_ = uniformLocation("multiplier");
+    depthUnprojectionUniform_ = uniformLocation("depthUnprojection");
+    depthScaleUniform_ = uniformLocation("depthScale");
+  } else {
+    // the uniforms the model does not use are optimized out, at location -1,
+    // which setUniform() ignores
+    meanUniform_ = uniformLocation("mean");
+    sigmaUniform_ = uniformLocation("sigma");
+    intensityUniform_ = uniformLocation("intensity");
+    amountUniform_ = uniformLocation("amount");
+    saltRatioUniform_ = uniformLocation("saltRatio");
+  }
+}
+
+SensorNoiseShader& SensorNoiseShader::setNoiseModel(
+    const SensorNoiseModel& model) {
+  CORRADE_INTERNAL_ASSERT(model.type == type_);
+  if (type_ == SensorNoiseType::Redwood) {
+    setUniform(multiplierUniform_, model.multiplier);
+  } else {
+    setUniform(meanUniform_, model.mean);
+    setUniform(sigmaUniform_, model.sigma);
+    setUniform(intensityUniform_, model.intensity);
+    setUniform(amountUniform_, model.amount);
+    setUniform(saltRatioUniform_, model.saltRatio);
+  }
+  return *this;
+}
+
+SensorNoiseShader& SensorNoiseShader::setFrameSeed(uint32_t seed) {
+  setUniform(seedUniform_, Mn::UnsignedInt(seed));
+  return *this;
+}
+
+SensorNoiseShader& SensorNoiseShader::setDepthUnprojection(
+    const Mn::Vector2& unprojection,
+    float scale) {
+  setUniform(depthUnprojectionUniform_, unprojection);
+  setUniform(depthScaleUniform_, scale);
+  return *this;
+}
+
+SensorNoiseShader& SensorNoiseShader::bindSourceTexture(
+    Mn::GL::Texture2D& texture) {
+  texture.bind(SourceTextureUnit);
+  return *this;
+}
+
+}  // namespace gfx
+}  // namespace esp
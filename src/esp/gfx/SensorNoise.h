@@ -0,0 +1,125 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#pragma once
+
+#include <Magnum/GL/AbstractShaderProgram.h>
+#include <Magnum/GL/GL.h>
+#include <Magnum/Math/Vector2.h>
+
+#include "esp/core/esp.h"
+
+namespace esp {
+namespace sensor {
+struct SensorSpec;
+}
+namespace gfx {
+
+// noise models of the frames of visual sensors
+enum class SensorNoiseType {
+  None,
+  // color plus intensity times normal noise
+  Gaussian,
+  // color times 1 plus intensity times normal noise
+  Speckle,
+  // a fraction of the pixels set to white or black
+  SaltAndPepper,
+  // the depth noise of the Redwood indoor dataset: pixels jittered, depth
+  // sampled at half the resolution and quantized in disparity with noise
+  Redwood,
+};
+
+// A noise model and its parameters, from SensorSpec::parameters:
+//   - "noise_model": "gaussian", "speckle" or "salt_and_pepper" for color
+//     sensors, "redwood" for depth sensors; none without it
+//   - "noise_mean", "noise_sigma" (0, 1): normal distribution of gaussian and
+//     speckle noise
+//   - "noise_intensity" (0.2): scale of gaussian and speckle noise, in units
+//     of the full color range
+//   - "noise_amount" (0.05): fraction of the pixels salt and pepper noise
+//     replaces, "noise_salt_ratio" (0.5) of them with white
+//   - "noise_multiplier" (1): scale of the jitter and disparity noise of
+//     redwood noise
+//   - "noise_seed" (0): seed of the core::Random stream of the sensor that
+//     the noise of each frame is drawn from
+// Noise is added to the frame as drawn, so SensorSpec::supersampling averages
+// color noise down with the frame
+struct SensorNoiseModel {
+  SensorNoiseType type = SensorNoiseType::None;
+  float mean = 0.0f;
+  float sigma = 1.0f;
+  float intensity = 0.2f;
+  float amount = 0.05f;
+  float saltRatio = 0.5f;
+  float multiplier = 1.0f;
+  uint32_t seed = 0;
+
+  bool isDepth() const { return type == SensorNoiseType::Redwood; }
+};
+
+// the noise model of spec; none, with an error logged, for an unknown model
+// or a model for another type of sensor than spec
+SensorNoiseModel getSensorNoiseModel(const sensor::SensorSpec& spec);
+
+/**
+@brief Post-processing pass adding the noise of a @ref SensorNoiseModel
+
+Renders a full-screen triangle. Color models read the frame from a copy bound
+with @ref bindSourceTexture() and write the noisy color; the depth model reads
+the depth texture of the frame and writes the noisy depth unprojected, in
+place of the unprojection pass. Random numbers are hashed from the pixel and
+the seed of the frame, so the same seed gives the same noise.
+*/
+class SensorNoiseShader : public Magnum::GL::AbstractShaderProgram {
+ public:
+  /** @brief Constructor */
+  explicit SensorNoiseShader(SensorNoiseType type);
+
+  /**
+   * @brief Set the parameters of model, which has to be of the type of the
+   *    shader
+   * @return Reference to self (for method chaining)
+   */
+  SensorNoiseShader& setNoiseModel(const SensorNoiseModel& model);
+
+  /**
+   * @brief Set the seed of the noise of the frame
+   * @return Reference to self (for method chaining)
+   */
+  SensorNoiseShader& setFrameSeed(uint32_t seed);
+
+  /**
+   * @brief Set depth unprojection coefficients and the scale of the depth
+   *    written, for the depth model
+   * @return Reference to self (for method chaining)
+   *
+   * See @ref calculateDepthUnprojection().
+   */
+  SensorNoiseShader& setDepthUnprojection(const Magnum::Vector2& unprojection,
+                                          float scale);
+
+  /**
+   * @brief Bind the copy of the color of the frame, or its depth texture for
+   *    the depth model
+   * @return Reference to self (for method chaining)
+   */
+  SensorNoiseShader& bindSourceTexture(Magnum::GL::Texture2D& texture);
+
+  SensorNoiseType getType() const { return type_; }
+
+ private:
+  SensorNoiseType type_;
+  int meanUniform_ = -1;
+  int sigmaUniform_ = -1;
+  int intensityUniform_ = -1;
+  int amountUniform_ = -1;
+  int saltRatioUniform_ = -1;
+  int multiplierUniform_ = -1;
+  int seedUniform_ = -1;
+  int depthUnprojectionUniform_ = -1;
+  int depthScaleUniform_ = -1;
+};
+
+}  // namespace gfx
+}  // namespace esp
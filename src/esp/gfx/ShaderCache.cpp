@@ -0,0 +1,168 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#include "ShaderCache.h"
+
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+#include <Magnum/GL/AbstractShaderProgram.h>
+#include <Magnum/GL/Context.h>
+#include <Magnum/GL/OpenGL.h>
+
+#include "esp/io/cache.h"
+
+namespace Mn = Magnum;
+
+namespace esp {
+namespace gfx {
+
+namespace {
+// kind of the program binary files, distinct from the other cache kinds
+const uint32_t programBinaryCacheKind = 102;
+const uint32_t programBinaryCacheVersion = 1;
+
+struct ShaderCache {
+  std::mutex mutex;
+  std::map<std::pair<Mn::GL::Context*, std::string>,
+           std::weak_ptr<MagnumShaderProgram>>
+      programs;
+  std::string programBinaryDir;
+};
+
+ShaderCache& shaderCache() {
+  static ShaderCache cache;
+  return cache;
+}
+
+std::string programBinaryFile(const std::string& key) {
+  const std::string dir = getProgramBinaryCacheDir();
+  return dir.empty() ? dir : dir + "/" + key + ".glprogram";
+}
+}  // namespace
+
+std::shared_ptr<MagnumShaderProgram> getSharedShaderProgram(
+    const std::string& key,
+    const std::function<std::shared_ptr<MagnumShaderProgram>()>& create) {
+  ShaderCache& cache = shaderCache();
+  const auto cacheKey = std::make_pair(&Mn::GL::Context::current(), key);
+  {
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    auto it = cache.programs.find(cacheKey);
+    if (it != cache.programs.end()) {
+      if (std::shared_ptr<MagnumShaderProgram> program = it->second.lock()) {
+        return program;
+      }
+    }
+  }
+
+  // a context is current on one thread only, so no one else creates the same
+  // program meanwhile
+  std::shared_ptr<MagnumShaderProgram> program = create();
+  std::lock_guard<std::mutex> lock(cache.mutex);
+  cache.programs[cacheKey] = program;
+  return program;
+}
+
+void setProgramBinaryCacheDir(const std::string& dir) {
+  ShaderCache& cache = shaderCache();
+  std::lock_guard<std::mutex> lock(cache.mutex);
+  cache.programBinaryDir = dir;
+}
+
+std::string getProgramBinaryCacheDir() {
+  ShaderCache& cache = shaderCache();
+  std::lock_guard<std::mutex> lock(cache.mutex);
+  return cache.programBinaryDir;
+}
+
+std::string programBinaryKey(const std::string& name,
+                             std::initializer_list<std::string> sources) {
+  Mn::GL::Context& context = Mn::GL::Context::current();
+  uint32_t hash = 0;
+  for (const std::string& driver :
+       {context.vendorString(), context.rendererString(),
+        context.versionString()}) {
+    hash = io::crc32(driver.data(), driver.size(), hash);
+  }
+  for (const std::string& source : sources) {
+    hash = io::crc32(source.data(), source.size(), hash);
+  }
+  std::ostringstream key;
+  key << name << "-" << std::hex << std::setw(8) << std::setfill('0') << hash;
+  return key.str();
+}
+
+bool loadProgramBinary(MagnumShaderProgram& program, const std::string& key) {
+#ifndef MAGNUM_TARGET_WEBGL
+  const std::string file = programBinaryFile(key);
+  if (file.empty()) {
+    return false;
+  }
+  const io::CacheReader reader(file, programBinaryCacheKind,
+                               programBinaryCacheVersion, "");
+  std::vector<GLenum> format;
+  std::vector<char> binary;
+  if (!reader.isValid() || !reader.readSection(0, format) ||
+      format.size() != 1 || !reader.readSection(1, binary)) {
+    return false;
+  }
+  glProgramBinary(program.id(), format[0], binary.data(), binary.size());
+  GLint linked = GL_FALSE;
+  glGetProgramiv(program.id(), GL_LINK_STATUS, &linked);
+  // drivers may reject binaries, e.g. after an update of the same version
+  if (linked != GL_TRUE) {
+    LOG(INFO) << "Program binary " << file << " rejected by the driver";
+    return false;
+  }
+  return true;
+#else
+  return false;
+#endif
+}
+
+void prepareProgramBinary(MagnumShaderProgram& program) {
+#ifndef MAGNUM_TARGET_WEBGL
+  if (!getProgramBinaryCacheDir().empty()) {
+    glProgramParameteri(program.id(), GL_PROGRAM_BINARY_RETRIEVABLE_HINT,
+                        GL_TRUE);
+  }
+#endif
+}
+
+void saveProgramBinary(MagnumShaderProgram& program, const std::string& key) {
+#ifndef MAGNUM_TARGET_WEBGL
+  const std::string file = programBinaryFile(key);
+  if (file.empty()) {
+    return;
+  }
+  GLint length = 0;
+  glGetProgramiv(program.id(), GL_PROGRAM_BINARY_LENGTH, &length);
+  if (length <= 0) {
+    return;
+  }
+  std::vector<char> binary(length);
+  std::vector<GLenum> format(1);
+  GLsizei written = 0;
+  glGetProgramBinary(program.id(), length, &written, format.data(),
+                     binary.data());
+  binary.resize(written);
+
+  io::CacheWriter writer(programBinaryCacheKind, programBinaryCacheVersion, "");
+  writer.addSection(format);
+  writer.addSection(binary);
+  // other processes may be loading the same file, which write() replaces
+  // at once
+  if (!writer.write(file)) {
+    LOG(WARNING) << "Could not write program binary " << file;
+  }
+#endif
+}
+
+}  // namespace gfx
+}  // namespace esp
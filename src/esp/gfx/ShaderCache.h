@@ -0,0 +1,71 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#pragma once
+
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <string>
+
+#include <Magnum/GL/GL.h>
+
+#include "esp/core/esp.h"
+#include "magnum.h"
+
+namespace esp {
+namespace gfx {
+
+// Shader programs are expensive to compile and link, so they are shared in two
+// ways:
+// - in memory, by everything drawing into the same GL context, e.g. the
+//   ResourceManagers of several simulators: getSharedShaderProgram()
+// - on disk, across processes, as program binaries of the driver
+//   (glGetProgramBinary), if a cache directory is set: the shaders of this
+//   module link with loadProgramBinary() / saveProgramBinary()
+
+//! Program for key in the current GL context, created with create() if no
+//! program of that key is alive. The cache does not keep programs alive
+std::shared_ptr<MagnumShaderProgram> getSharedShaderProgram(
+    const std::string& key,
+    const std::function<std::shared_ptr<MagnumShaderProgram>()>& create);
+
+//! Program of Shader specialized for flags, i.e. compiled with only the
+//! inputs, outputs and branches the flags enable, shared like
+//! getSharedShaderProgram() under name and the flags. Every combination of
+//! flags in use gets a program of its own instead of switching at runtime
+template <class Shader>
+std::shared_ptr<Shader> getShaderVariant(const std::string& name,
+                                         typename Shader::Flags flags) {
+  const auto bits =
+      static_cast<typename Shader::Flags::UnderlyingType>(flags);
+  return std::static_pointer_cast<Shader>(getSharedShaderProgram(
+      name + "#" + std::to_string(bits),
+      [flags]() { return std::make_shared<Shader>(flags); }));
+}
+
+//! Directory program binaries are stored in, empty (the default) disables the
+//! program binary cache
+void setProgramBinaryCacheDir(const std::string& dir);
+std::string getProgramBinaryCacheDir();
+
+//! Key of a program binary: name and a hash of the sources (including
+//! defines and flags) and of the vendor, renderer and version of the driver,
+//! as binaries are only valid for the driver that made them
+std::string programBinaryKey(const std::string& name,
+                             std::initializer_list<std::string> sources);
+
+//! Load the binary stored under key into program, false if there is none or
+//! the driver rejects it; then the program has to be compiled and linked
+bool loadProgramBinary(MagnumShaderProgram& program, const std::string& key);
+
+//! To be called before linking a program that is saved afterwards, so that
+//! the driver keeps its binary retrievable
+void prepareProgramBinary(MagnumShaderProgram& program);
+
+//! Store the binary of the linked program under key
+void saveProgramBinary(MagnumShaderProgram& program, const std::string& key);
+
+}  // namespace gfx
+}  // namespace esp
@@ -4,23 +4,33 @@
 
 #include "Simulator.h"
 
+#include <algorithm>
+#include <atomic>
 #include <string>
 
 #include <Corrade/Containers/Pointer.h>
 #include <Corrade/Utility/String.h>
 
+#include <Magnum/GL/Renderer.h>
 #include <Magnum/ImageView.h>
 #include <Magnum/PixelFormat.h>
 #include <Magnum/Trade/AbstractImageConverter.h>
 
 #include "Drawable.h"
+#include "PrimitiveIDTexturedDrawable.h"
+#include "PrimitiveIDTexturedShader.h"
 
+#include "esp/core/Metrics.h"
+#include "esp/core/ThreadPool.h"
 #include "esp/core/esp.h"
 #include "esp/gfx/RenderCamera.h"
 #include "esp/gfx/Renderer.h"
+#include "esp/gfx/ShaderCache.h"
+#include "esp/io/cache.h"
 #include "esp/io/io.h"
 #include "esp/nav/PathFinder.h"
 #include "esp/scene/ObjectControls.h"
+#include "esp/scene/RegionVisibility.h"
 #include "esp/scene/SemanticScene.h"
 #include "esp/sensor/PinholeCamera.h"
 
@@ -31,20 +41,86 @@ using namespace Corrade;
 namespace esp {
 namespace gfx {
 
+namespace {
+// resolve the mesh and house files of a scene
+void getSceneFilenames(const scene::SceneConfiguration& sceneConfig,
+                       std::string& sceneFilename,
+                       std::string& houseFilename) {
+  sceneFilename = sceneConfig.id;
+  if (sceneConfig.filepaths.count("mesh")) {
+    sceneFilename = sceneConfig.filepaths.at("mesh");
+  }
+
+  houseFilename = io::changeExtension(sceneFilename, ".house");
+  if (sceneConfig.filepaths.count("house")) {
+    houseFilename = sceneConfig.filepaths.at("house");
+  }
+}
+}  // namespace
+
 Simulator::Simulator(const SimulatorConfiguration& cfg) {
   // initalize members according to cfg
   // NOTE: NOT SO GREAT NOW THAT WE HAVE virtual functions
   //       Maybe better not to do this reconfigure
   reconfigure(cfg);
+  addMetricsCollector();
+}
+
+Simulator::Simulator(const SimulatorConfiguration& cfg,
+                     Simulator& shareSimulator) {
+  // a lazy shareSimulator creates its context now
+  shareSimulator.getRenderer();
+  CHECK(shareSimulator.context_ != nullptr)
+      << "Simulator: cannot share the context of a simulator without renderer";
+  context_ = std::make_unique<gfx::WindowlessContext>(*shareSimulator.context_);
+  resourceManager_ = shareSimulator.resourceManager_;
+  reconfigure(cfg);
+  addMetricsCollector();
 }
 
 Simulator::~Simulator() {
   LOG(INFO) << "Deconstructing Simulator";
+  core::MetricsRegistry::get().removeCollector(metricsCollectorId_);
+}
+
+void Simulator::addMetricsCollector() {
+  static std::atomic<int> numSimulators{0};
+  const std::string simulator = std::to_string(numSimulators++);
+  metricsCollectorId_ = core::MetricsRegistry::get().addCollector(
+      [this, simulator](std::vector<core::MetricSample>& samples) {
+        // clones and reconfigures reseat the resource manager
+        std::lock_guard<std::recursive_mutex> lock(mutex_);
+        const assets::ResourceManager::MemoryStats stats = getMemoryStats();
+        samples.push_back({"habitat_gpu_mesh_bytes",
+                           {{"simulator", simulator}},
+                           double(stats.meshBytes)});
+        samples.push_back({"habitat_gpu_texture_bytes",
+                           {{"simulator", simulator}},
+                           double(stats.textureBytes)});
+        samples.push_back({"habitat_asset_cache_bytes",
+                           {{"simulator", simulator}},
+                           double(resourceManager_->getAssetCacheSize())});
+        for (const auto& asset : stats.assetBytes) {
+          samples.push_back({"habitat_asset_gpu_bytes",
+                             {{"simulator", simulator}, {"asset", asset.first}},
+                             double(asset.second)});
+        }
+      },
+      {{"habitat_gpu_mesh_bytes", "GPU memory of the loaded meshes"},
+       {"habitat_gpu_texture_bytes", "GPU memory of the material textures"},
+       {"habitat_asset_cache_bytes", "Size of the assets in the asset cache"},
+       {"habitat_asset_gpu_bytes", "GPU memory of each loaded asset"}});
 }
 
 void Simulator::reconfigure(const SimulatorConfiguration& cfg) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
   // if configuration is unchanged, just reset and return
+  resourceManager_->setAssetCacheBudget(cfg.assetCacheBudget);
+  setProgramBinaryCacheDir(cfg.shaderCacheDir);
+  io::setSharedCacheDir(cfg.sharedCacheDir);
+  core::ThreadPool::setGlobalNumThreads(cfg.numThreads);
   if (cfg == config_) {
+    resourceManager_->cancelPrefetches();
     reset();
     return;
   }
@@ -52,64 +128,198 @@ void Simulator::reconfigure(const SimulatorConfiguration& cfg) {
   // TODO can optimize to do partial re-initialization instead of from-scratch
   config_ = cfg;
 
-  const int height = cfg.height;
-  const int width = cfg.width;
+  // reinitalize members
+  renderer_ = nullptr;
+  if (cfg.createRenderer && (!cfg.lazyRenderer || context_)) {
+    initRenderer();
+  } else {
+    // scenes are loaded without the GPU until getRenderer() creates the
+    // renderer, if ever
+    resourceManager_->setGpuEnabled(false);
+    resourceManager_->optimizeMeshes(cfg.optimizeMeshes);
+  }
 
-  // load scene
-  std::string sceneFilename = cfg.scene.id;
-  if (cfg.scene.filepaths.count("mesh")) {
-    sceneFilename = cfg.scene.filepaths.at("mesh");
+  loadScene(cfg.scene, activeSceneID_, activeSemanticSceneID_, semanticScene_);
+  // prefetches are for the following reconfigure, those it did not use are
+  // stale
+  resourceManager_->cancelPrefetches();
+
+  // now reset to sample agent state
+  reset();
+}
+
+void Simulator::initRenderer() {
+  if (!context_) {
+    context_ = std::make_unique<gfx::WindowlessContext>(
+        config_.gpuDeviceId, config_.shareableContext);
+  }
+
+  renderer_ = nullptr;
+  renderer_ = Renderer::create(config_.width, config_.height);
+  resourceManager_->setGpuEnabled(true);
+  resourceManager_->compressTextures(config_.compressTextures);
+  resourceManager_->optimizeMeshes(config_.optimizeMeshes);
+  // streamed atlases are uploaded while drawing, which the threads of a
+  // share group do at once
+  resourceManager_->streamPTexAtlases(config_.streamPTexAtlases &&
+                                      !context_->isShareable());
+  resourceManager_->streamTextures(config_.streamTextures &&
+                                   !context_->isShareable());
+}
+
+Simulator::ptr Simulator::clone() {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  // the fork shares the context, which has to exist by then
+  getRenderer();
+  Simulator::ptr fork{new Simulator()};
+  fork->cloneFrom(*this);
+  return fork;
+}
+
+void Simulator::cloneFrom(Simulator& source) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  context_ = source.context_;
+  renderer_ = source.renderer_;
+  resourceManager_ = source.resourceManager_;
+  pathFinder_ = source.pathFinder_;
+  config_ = source.config_;
+  random_ = source.random_;
+  // the assets of the scene are cached by the shared resource manager, and
+  // the BVH of its collision mesh on disk, so this only creates nodes,
+  // drawables and an empty physics world
+  loadScene(config_.scene, activeSceneID_, activeSemanticSceneID_,
+            semanticScene_);
+
+  physics::PhysicsManager* sourceWorld =
+      source.getPhysicsWorld(source.activeSceneID_);
+  physics::PhysicsManager* world = getPhysicsWorld(activeSceneID_);
+  if (sourceWorld != nullptr && world != nullptr &&
+      !world->copyObjectsFrom(*sourceWorld,
+                              &getActiveSceneGraph().getDrawables())) {
+    LOG(ERROR) << "Simulator::clone: cannot copy the physics objects";
   }
+}
 
-  std::string houseFilename = io::changeExtension(sceneFilename, ".house");
-  if (cfg.scene.filepaths.count("house")) {
-    houseFilename = cfg.scene.filepaths.at("house");
+bool Simulator::prefetchScene(const SimulatorConfiguration& cfg) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  // scenes are only loaded into memory for rendering
+  if (!cfg.createRenderer) {
+    return false;
   }
+  return prefetchScene(cfg.scene);
+}
 
-  const assets::AssetInfo sceneInfo =
-      assets::AssetInfo::fromPath(sceneFilename);
+bool Simulator::prefetchScene(const scene::SceneConfiguration& sceneConfig) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  std::string sceneFilename;
+  std::string houseFilename;
+  getSceneFilenames(sceneConfig, sceneFilename, houseFilename);
+
+  bool prefetched = resourceManager_->prefetchScene(
+      assets::AssetInfo::fromPath(sceneFilename));
+  // same semantic mesh lookup as in loadScene()
+  const std::string semanticMeshFilename =
+      io::removeExtension(houseFilename) + "_semantic.ply";
+  if (io::exists(houseFilename) && io::exists(semanticMeshFilename)) {
+    prefetched = resourceManager_->prefetchScene(
+                     assets::AssetInfo::fromPath(semanticMeshFilename)) ||
+                 prefetched;
+  }
+  return prefetched;
+}
 
-  // initalize scene graph
-  // CAREFUL!
-  // previous scene graph is not deleted!
-  // TODO:
-  // We need to make a design decision here:
-  // when doing reconfigure, shall we delete all of the previous scene graphs
-  activeSceneID_ = sceneManager_.initSceneGraph();
+void Simulator::cancelPrefetches() {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  resourceManager_->cancelPrefetches();
+}
 
-  // LOG(INFO) << "Active scene graph ID = " << activeSceneID_;
-  sceneID_.push_back(activeSceneID_);
+void Simulator::loadScene(
+    const scene::SceneConfiguration& sceneConfig,
+    int& sceneID,
+    int& semanticSceneID,
+    std::shared_ptr<scene::SemanticScene>& semanticScene) {
+  // load scene
+  std::string sceneFilename;
+  std::string houseFilename;
+  getSceneFilenames(sceneConfig, sceneFilename, houseFilename);
 
-  if (cfg.createRenderer) {
-    if (!context_) {
-      context_ = std::make_unique<gfx::WindowlessContext>(config_.gpuDeviceId);
-    }
+  const assets::AssetInfo sceneInfo =
+      assets::AssetInfo::fromPath(sceneFilename);
 
-    // reinitalize members
-    renderer_ = nullptr;
-    renderer_ = Renderer::create(width, height);
+  // initalize scene graph, or reuse it; nodes attached to the root outside of
+  // the scene (e.g., agents) survive. Scenes previously loaded into the graphs
+  // are only unloaded once the new one is in, so that assets they share are
+  // not evicted from the cache in between
+  std::vector<LoadedScene> previousScenes;
+  prepareSceneGraph(sceneID, previousScenes);
+  if (semanticSceneID != ID_UNDEFINED && semanticSceneID != sceneID) {
+    prepareSceneGraph(semanticSceneID, previousScenes);
+  }
+
+  // LOG(INFO) << "Active scene graph ID = " << sceneID;
 
-    auto& sceneGraph = sceneManager_.getSceneGraph(activeSceneID_);
+  // a separate semantic scene graph the new scene has no use for, released
+  // once the scene previously loaded into it is unloaded
+  int unusedSemanticSceneID = ID_UNDEFINED;
+  // without the renderer, the scene mesh is only loaded for the collision
+  // meshes of physics, without the GPU; getRenderer() draws it later
+  if (renderer_ || config_.enablePhysics) {
+    auto& sceneGraph = sceneManager_.getSceneGraph(sceneID);
 
-    auto& rootNode = sceneGraph.getRootNode();
+    auto& rootNode = sceneGraph.getRootNode().createChild();
     auto& drawables = sceneGraph.getDrawables();
-    resourceManager_.compressTextures(cfg.compressTextures);
+    loadedScenes_[sceneID] = {&rootNode, sceneInfo};
 
     bool loadSuccess = false;
     if (config_.enablePhysics) {
-      loadSuccess =
-          resourceManager_.loadScene(sceneInfo, physicsManager_, &rootNode,
-                                     &drawables, cfg.physicsConfigFile);
+      auto world = physicsWorldIDs_.find(sceneID);
+      if (physicsManager_ == nullptr || physicsWorldIDs_.empty() ||
+          (world != physicsWorldIDs_.end() && world->second == 0)) {
+        // the scene is the world of a new manager
+        if (physicsWorldIDs_.size() > 1) {
+          LOG(WARNING) << "Simulator::loadScene: reloading the first physics "
+                          "scene also resets the physics of the other "
+                       << physicsWorldIDs_.size() - 1 << " scenes";
+        }
+        physicsWorldIDs_.clear();
+        loadSuccess =
+            resourceManager_->loadScene(sceneInfo, physicsManager_, &rootNode,
+                                        &drawables, config_.physicsConfigFile);
+        physicsWorldIDs_[sceneID] = 0;
+      } else {
+        // replace the world of the scene previously in the graph, before the
+        // scene nodes its objects live in are unloaded
+        if (world != physicsWorldIDs_.end()) {
+          physicsManager_->removeWorld(world->second);
+          physicsWorldIDs_.erase(world);
+        }
+        int worldID = ID_UNDEFINED;
+        loadSuccess = resourceManager_->loadSceneIntoWorld(
+            sceneInfo, *physicsManager_, worldID, &rootNode, &drawables,
+            config_.physicsConfigFile);
+        if (worldID != ID_UNDEFINED) {
+          physicsWorldIDs_[sceneID] = worldID;
+        }
+      }
     } else {
       loadSuccess =
-          resourceManager_.loadScene(sceneInfo, &rootNode, &drawables);
+          resourceManager_->loadScene(sceneInfo, &rootNode, &drawables);
     }
     if (!loadSuccess) {
       LOG(ERROR) << "cannot load " << sceneFilename;
+      delete &rootNode;
+      loadedScenes_.erase(sceneID);
+      for (const LoadedScene& previous : previousScenes) {
+        unloadScene(previous);
+      }
       // Pass the error to the python through pybind11 allowing graceful exit
       throw std::invalid_argument("Cannot load: " + sceneFilename);
     }
+    loadTrace_ = resourceManager_->getLoadTrace();
+  }
 
+  if (config_.createRenderer) {
+    bool semanticMeshLoaded = false;
     if (io::exists(houseFilename)) {
       LOG(INFO) << "Loading house from " << houseFilename;
       // if semantic mesh exists, load it as well
@@ -117,45 +327,200 @@ void Simulator::reconfigure(const SimulatorConfiguration& cfg) {
       const std::string semanticMeshFilename =
           io::removeExtension(houseFilename) + "_semantic.ply";
       if (io::exists(semanticMeshFilename)) {
-        LOG(INFO) << "Loading semantic mesh " << semanticMeshFilename;
-        activeSemanticSceneID_ = sceneManager_.initSceneGraph();
-        sceneID_.push_back(activeSemanticSceneID_);
-        auto& semanticSceneGraph =
-            sceneManager_.getSceneGraph(activeSemanticSceneID_);
-        auto& semanticRootNode = semanticSceneGraph.getRootNode();
-        auto& semanticDrawables = semanticSceneGraph.getDrawables();
-        const assets::AssetInfo semanticSceneInfo =
-            assets::AssetInfo::fromPath(semanticMeshFilename);
-        resourceManager_.loadScene(semanticSceneInfo, &semanticRootNode,
-                                   &semanticDrawables);
+        // only loaded into its graph once a semantic sensor observes it, see
+        // loadSemanticMesh()
+        semanticMeshLoaded = true;
+        if (semanticSceneID == sceneID) {
+          semanticSceneID = ID_UNDEFINED;
+        }
+        prepareSceneGraph(semanticSceneID, previousScenes);
+        pendingSemanticMeshes_[semanticSceneID] = {
+            assets::AssetInfo::fromPath(semanticMeshFilename), nullptr};
       }
       LOG(INFO) << "Loaded.";
     }
 
+    // scenes without semantics leave no semantic scene graph, like in a
+    // newly created simulator
+    if (!semanticMeshLoaded) {
+      if (semanticSceneID != sceneID) {
+        unusedSemanticSceneID = semanticSceneID;
+      }
+      semanticSceneID = ID_UNDEFINED;
+    }
+
     // instance meshes and suncg houses contain their semantic annotations
     if (sceneInfo.type == assets::AssetType::FRL_INSTANCE_MESH ||
         sceneInfo.type == assets::AssetType::SUNCG_SCENE ||
         sceneInfo.type == assets::AssetType::INSTANCE_MESH) {
-      activeSemanticSceneID_ = activeSceneID_;
+      semanticSceneID = sceneID;
     }
   }
 
-  semanticScene_ = nullptr;
-  semanticScene_ = scene::SemanticScene::create();
+  for (const LoadedScene& previous : previousScenes) {
+    unloadScene(previous);
+  }
+  if (unusedSemanticSceneID != ID_UNDEFINED) {
+    releaseSceneGraph(unusedSemanticSceneID);
+  }
+  // other contexts of the share group only see the uploads once they are done
+  if (context_ && context_->isShareable()) {
+    Magnum::GL::Renderer::finish();
+  }
+
+  semanticScene = nullptr;
+  semanticScene = scene::SemanticScene::create();
   if (io::exists(houseFilename)) {
-    scene::SemanticScene::loadMp3dHouse(houseFilename, *semanticScene_);
+    scene::SemanticScene::loadMp3dHouse(houseFilename, *semanticScene);
   }
 
   // also load SemanticScene for SUNCG house file
   if (sceneInfo.type == assets::AssetType::SUNCG_SCENE) {
-    scene::SemanticScene::loadSuncgHouse(sceneFilename, *semanticScene_);
+    scene::SemanticScene::loadSuncgHouse(sceneFilename, *semanticScene);
   }
 
-  // now reset to sample agent state
-  reset();
+  // the potentially visible sets of the regions of the house, made offline,
+  // for Renderer::setRegionCulling()
+  if (config_.createRenderer) {
+    std::shared_ptr<scene::RegionVisibility> regionVisibility = nullptr;
+    if (io::exists(houseFilename)) {
+      regionVisibility = scene::RegionVisibility::load(
+          scene::regionVisibilityFilename(houseFilename), houseFilename);
+    }
+    if (renderer_) {
+      for (int id : {sceneID, semanticSceneID}) {
+        if (id != ID_UNDEFINED) {
+          renderer_->setRegionVisibility(sceneManager_.getSceneGraph(id),
+                                         regionVisibility);
+        }
+      }
+    } else {
+      undrawnScenes_[sceneID] = {true, sceneInfo, regionVisibility};
+      if (semanticSceneID != ID_UNDEFINED && semanticSceneID != sceneID) {
+        undrawnScenes_[semanticSceneID] = {false, {}, regionVisibility};
+      }
+    }
+  }
+
+  auto pending = pendingSemanticMeshes_.find(semanticSceneID);
+  if (pending != pendingSemanticMeshes_.end()) {
+    pending->second.semanticScene = semanticScene;
+  } else {
+    applySemanticIdMapping(semanticSceneID, *semanticScene);
+  }
+}
+
+void Simulator::loadSemanticMesh(int semanticSceneID) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  auto pending = pendingSemanticMeshes_.find(semanticSceneID);
+  if (pending == pendingSemanticMeshes_.end()) {
+    return;
+  }
+  const PendingSemanticMesh semanticMesh = std::move(pending->second);
+  pendingSemanticMeshes_.erase(pending);
+  LOG(INFO) << "Loading semantic mesh " << semanticMesh.info.filepath;
+  auto& semanticSceneGraph = sceneManager_.getSceneGraph(semanticSceneID);
+  auto& semanticRootNode = semanticSceneGraph.getRootNode().createChild();
+  loadedScenes_[semanticSceneID] = {&semanticRootNode, semanticMesh.info};
+  if (!resourceManager_->loadScene(semanticMesh.info, &semanticRootNode,
+                                   &semanticSceneGraph.getDrawables())) {
+    LOG(ERROR) << "Simulator: cannot load semantic mesh "
+               << semanticMesh.info.filepath;
+  }
+  if (context_ && context_->isShareable()) {
+    Magnum::GL::Renderer::finish();
+  }
+  if (semanticMesh.semanticScene != nullptr) {
+    applySemanticIdMapping(semanticSceneID, *semanticMesh.semanticScene);
+  }
+}
+
+void Simulator::applySemanticIdMapping(
+    int semanticSceneID,
+    const scene::SemanticScene& semanticScene) {
+  if (!config_.createRenderer || semanticSceneID == ID_UNDEFINED) {
+    return;
+  }
+  std::shared_ptr<IdRemap> idRemap = nullptr;
+  if (config_.semanticIdMapping != scene::SemanticIdMapping::Segment) {
+    const std::vector<int> remap =
+        semanticScene.semanticIndexRemap(config_.semanticIdMapping);
+    if (remap.empty()) {
+      LOG(WARNING) << "Simulator: the semantic scene has no semantic mesh "
+                      "indices, object ids are not mapped";
+    } else {
+      idRemap = std::make_shared<IdRemap>(remap);
+    }
+  }
+
+  MagnumDrawableGroup& drawables =
+      sceneManager_.getSceneGraph(semanticSceneID).getDrawables();
+  for (size_t i = 0; i < drawables.size(); ++i) {
+    auto* drawable = dynamic_cast<PrimitiveIDTexturedDrawable*>(&drawables[i]);
+    if (drawable != nullptr) {
+      drawable->setIdRemap(idRemap.get());
+    }
+  }
+  if (idRemap) {
+    idRemaps_[semanticSceneID] = idRemap;
+  } else {
+    idRemaps_.erase(semanticSceneID);
+  }
+}
+
+void Simulator::prepareSceneGraph(int& sceneID,
+                                  std::vector<LoadedScene>& previousScenes) {
+  if (sceneID == ID_UNDEFINED) {
+    sceneID = sceneManager_.initSceneGraph();
+    sceneID_.push_back(sceneID);
+    return;
+  }
+  pendingSemanticMeshes_.erase(sceneID);
+  undrawnScenes_.erase(sceneID);
+  auto it = loadedScenes_.find(sceneID);
+  if (it != loadedScenes_.end()) {
+    previousScenes.push_back(it->second);
+    loadedScenes_.erase(it);
+  }
+}
+
+void Simulator::releaseSceneGraph(int sceneID) {
+  // physics objects live in the scene nodes, so their world goes first
+  auto world = physicsWorldIDs_.find(sceneID);
+  if (world != physicsWorldIDs_.end()) {
+    if (world->second == 0) {
+      physicsManager_ = nullptr;
+      physicsWorldIDs_.clear();
+    } else {
+      physicsManager_->removeWorld(world->second);
+      physicsWorldIDs_.erase(world);
+    }
+  }
+  auto it = loadedScenes_.find(sceneID);
+  if (it != loadedScenes_.end()) {
+    unloadScene(it->second);
+    loadedScenes_.erase(it);
+  }
+  idRemaps_.erase(sceneID);
+  pendingSemanticMeshes_.erase(sceneID);
+  undrawnScenes_.erase(sceneID);
+  if (renderer_) {
+    renderer_->setRegionVisibility(sceneManager_.getSceneGraph(sceneID),
+                                   nullptr);
+  }
+  sceneID_.erase(std::remove(sceneID_.begin(), sceneID_.end(), sceneID),
+                 sceneID_.end());
+  sceneManager_.releaseSceneGraph(sceneID);
+}
+
+void Simulator::unloadScene(const LoadedScene& loadedScene) {
+  // deleting the node also deletes its children and their drawables
+  delete loadedScene.node;
+  resourceManager_->releaseScene(loadedScene.info);
 }
 
 void Simulator::reset() {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
   if (physicsManager_ != nullptr)
     physicsManager_
         ->reset();  // TODO: this does nothing yet... desired reset behavior?
@@ -166,9 +531,79 @@ void Simulator::seed(uint32_t newSeed) {
 }
 
 std::shared_ptr<Renderer> Simulator::getRenderer() {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  if (renderer_ == nullptr && config_.createRenderer) {
+    LOG(INFO) << "Simulator: creating the renderer for the first observation";
+    initRenderer();
+    for (const auto& undrawn : undrawnScenes_) {
+      drawScene(undrawn.first, undrawn.second);
+    }
+    undrawnScenes_.clear();
+    if (context_->isShareable()) {
+      Magnum::GL::Renderer::finish();
+    }
+  }
   return renderer_;
 }
 
+void Simulator::drawScene(int sceneID, const UndrawnScene& undrawn) {
+  scene::SceneGraph& sceneGraph = sceneManager_.getSceneGraph(sceneID);
+  auto& drawables = sceneGraph.getDrawables();
+  if (undrawn.hasMesh) {
+    auto loaded = loadedScenes_.find(sceneID);
+    if (loaded != loadedScenes_.end()) {
+      // loaded without the GPU for physics, which acquired the asset in the
+      // cache already
+      if (resourceManager_->loadScene(undrawn.info, loaded->second.node,
+                                      &drawables)) {
+        if (undrawn.info.filepath != assets::EMPTY_SCENE) {
+          resourceManager_->releaseScene(undrawn.info);
+        }
+      } else {
+        LOG(ERROR) << "Simulator: cannot draw " << undrawn.info.filepath;
+      }
+    } else {
+      auto& rootNode = sceneGraph.getRootNode().createChild();
+      loadedScenes_[sceneID] = {&rootNode, undrawn.info};
+      if (!resourceManager_->loadScene(undrawn.info, &rootNode, &drawables)) {
+        LOG(ERROR) << "Simulator: cannot draw " << undrawn.info.filepath;
+      }
+    }
+    loadTrace_ = resourceManager_->getLoadTrace();
+
+    // instance meshes map the object ids of their own semantics, which
+    // loadScene() computed already
+    auto idRemap = idRemaps_.find(sceneID);
+    if (idRemap != idRemaps_.end()) {
+      for (size_t i = 0; i < drawables.size(); ++i) {
+        auto* drawable =
+            dynamic_cast<PrimitiveIDTexturedDrawable*>(&drawables[i]);
+        if (drawable != nullptr) {
+          drawable->setIdRemap(idRemap->second.get());
+        }
+      }
+    }
+  }
+
+  physics::PhysicsManager* world = getPhysicsWorld(sceneID);
+  if (world != nullptr) {
+    world->addObjectDrawables(&drawables);
+  }
+  renderer_->setRegionVisibility(sceneGraph, undrawn.regionVisibility);
+}
+
+assets::ResourceManager::MemoryStats Simulator::getMemoryStats() const {
+  return resourceManager_->getMemoryStats();
+}
+
+void Simulator::finishStreamedTextures() {
+  resourceManager_->finishStreamedTextures();
+}
+
+int Simulator::getGpuDevice() const {
+  return context_ ? context_->getGpuDevice() : ID_UNDEFINED;
+}
+
 std::shared_ptr<physics::PhysicsManager> Simulator::getPhysicsManager() {
   return physicsManager_;
 }
@@ -178,15 +613,14 @@ std::shared_ptr<scene::SemanticScene> Simulator::getSemanticScene() {
 }
 
 scene::SceneGraph& Simulator::getActiveSceneGraph() {
-  CHECK_GE(activeSceneID_, 0);
-  CHECK_LT(activeSceneID_, sceneID_.size());
+  CHECK(sceneManager_.hasSceneGraph(activeSceneID_));
   return sceneManager_.getSceneGraph(activeSceneID_);
 }
 
 //! return the semantic scene's SceneGraph for rendering
 scene::SceneGraph& Simulator::getActiveSemanticSceneGraph() {
-  CHECK_GE(activeSemanticSceneID_, 0);
-  CHECK_LT(activeSemanticSceneID_, sceneID_.size());
+  CHECK(sceneManager_.hasSceneGraph(activeSemanticSceneID_));
+  loadSemanticMesh(activeSemanticSceneID_);
   return sceneManager_.getSceneGraph(activeSemanticSceneID_);
 }
 
@@ -195,7 +629,15 @@ bool operator==(const SimulatorConfiguration& a,
   return a.scene == b.scene && a.defaultAgentId == b.defaultAgentId &&
          a.defaultCameraUuid == b.defaultCameraUuid &&
          a.compressTextures == b.compressTextures &&
+         a.optimizeMeshes == b.optimizeMeshes &&
+         a.shareableContext == b.shareableContext &&
+         a.semanticIdMapping == b.semanticIdMapping &&
+         a.streamPTexAtlases == b.streamPTexAtlases &&
+         a.streamTextures == b.streamTextures &&
+         a.navMeshMoveFilter == b.navMeshMoveFilter &&
+         a.agentPhysicsBodies == b.agentPhysicsBodies &&
          a.createRenderer == b.createRenderer &&
+         a.lazyRenderer == b.lazyRenderer &&
          a.enablePhysics == b.enablePhysics &&
          a.physicsConfigFile.compare(b.physicsConfigFile) == 0;
 }
@@ -207,13 +649,24 @@ bool operator!=(const SimulatorConfiguration& a,
 
 // === Physics Simulator Functions ===
 
+physics::PhysicsManager* Simulator::getPhysicsWorld(int sceneID) {
+  auto world = physicsWorldIDs_.find(sceneID);
+  if (physicsManager_ == nullptr || world == physicsWorldIDs_.end() ||
+      !sceneManager_.hasSceneGraph(sceneID) ||
+      !physicsManager_->hasWorld(world->second)) {
+    return nullptr;
+  }
+  return &physicsManager_->getWorld(world->second);
+}
+
 const int Simulator::addObject(const int objectLibIndex, const int sceneID) {
-  if (physicsManager_ != nullptr && sceneID >= 0 && sceneID < sceneID_.size()) {
-    // TODO: change implementation to support multi-world and physics worlds to
-    // own reference to a sceneGraph to avoid this.
+  physics::PhysicsManager* world = getPhysicsWorld(sceneID);
+  if (world != nullptr) {
+    // TODO: physics worlds could own a reference to their sceneGraph to
+    // avoid this.
     auto& sceneGraph_ = sceneManager_.getSceneGraph(sceneID);
     auto& drawables = sceneGraph_.getDrawables();
-    return physicsManager_->addObject(objectLibIndex, &drawables);
+    return world->addObject(objectLibIndex, &drawables);
   }
   return ID_UNDEFINED;
 }
@@ -221,21 +674,41 @@ const int Simulator::addObject(const int objectLibIndex, const int sceneID) {
 // return the current size of the physics object library (objects [0,size) can
 // be instanced)
 const int Simulator::getPhysicsObjectLibrarySize() {
-  return resourceManager_.getNumLibraryObjects();
+  return resourceManager_->getNumLibraryObjects();
 }
 
 // return a list of existing objected IDs in a physical scene
 const std::vector<int> Simulator::getExistingObjectIDs(const int sceneID) {
-  if (physicsManager_ != nullptr && sceneID >= 0 && sceneID < sceneID_.size()) {
-    return physicsManager_->getExistingObjectIDs();
+  physics::PhysicsManager* world = getPhysicsWorld(sceneID);
+  if (world != nullptr) {
+    return world->getExistingObjectIDs();
   }
   return std::vector<int>();  // empty if no simulator exists
 }
 
 // remove object objectID instance in sceneID
 void Simulator::removeObject(const int objectID, const int sceneID) {
-  if (physicsManager_ != nullptr && sceneID >= 0 && sceneID < sceneID_.size()) {
-    physicsManager_->removeObject(objectID);
+  physics::PhysicsManager* world = getPhysicsWorld(sceneID);
+  if (world != nullptr) {
+    world->removeObject(objectID);
+  }
+}
+
+std::vector<int> Simulator::addObjects(const std::vector<int>& objectLibIndices,
+                                       const int sceneID) {
+  physics::PhysicsManager* world = getPhysicsWorld(sceneID);
+  if (world != nullptr) {
+    auto& drawables = sceneManager_.getSceneGraph(sceneID).getDrawables();
+    return world->addObjects(objectLibIndices, &drawables);
+  }
+  return std::vector<int>(objectLibIndices.size(), ID_UNDEFINED);
+}
+
+void Simulator::removeObjects(const std::vector<int>& objectIDs,
+                              const int sceneID) {
+  physics::PhysicsManager* world = getPhysicsWorld(sceneID);
+  if (world != nullptr) {
+    world->removeObjects(objectIDs);
   }
 }
 
@@ -243,8 +716,9 @@ void Simulator::removeObject(const int objectID, const int sceneID) {
 void Simulator::applyTorque(const Magnum::Vector3& tau,
                             const int objectID,
                             const int sceneID) {
-  if (physicsManager_ != nullptr && sceneID >= 0 && sceneID < sceneID_.size()) {
-    physicsManager_->applyTorque(objectID, tau);
+  physics::PhysicsManager* world = getPhysicsWorld(sceneID);
+  if (world != nullptr) {
+    world->applyTorque(objectID, tau);
   }
 }
 
@@ -252,8 +726,9 @@ void Simulator::applyForce(const Magnum::Vector3& force,
                            const Magnum::Vector3& relPos,
                            const int objectID,
                            const int sceneID) {
-  if (physicsManager_ != nullptr && sceneID >= 0 && sceneID < sceneID_.size()) {
-    physicsManager_->applyForce(objectID, force, relPos);
+  physics::PhysicsManager* world = getPhysicsWorld(sceneID);
+  if (world != nullptr) {
+    world->applyForce(objectID, force, relPos);
   }
 }
 
@@ -261,15 +736,17 @@ void Simulator::applyForce(const Magnum::Vector3& force,
 void Simulator::setTransformation(const Magnum::Matrix4& transform,
                                   const int objectID,
                                   const int sceneID) {
-  if (physicsManager_ != nullptr && sceneID >= 0 && sceneID < sceneID_.size()) {
-    physicsManager_->setTransformation(objectID, transform);
+  physics::PhysicsManager* world = getPhysicsWorld(sceneID);
+  if (world != nullptr) {
+    world->setTransformation(objectID, transform);
   }
 }
 
 const Magnum::Matrix4 Simulator::getTransformation(const int objectID,
                                                    const int sceneID) {
-  if (physicsManager_ != nullptr && sceneID >= 0 && sceneID < sceneID_.size()) {
-    return physicsManager_->getTransformation(objectID);
+  physics::PhysicsManager* world = getPhysicsWorld(sceneID);
+  if (world != nullptr) {
+    return world->getTransformation(objectID);
   }
   return Magnum::Matrix4::fromDiagonal(Magnum::Vector4(1));
 }
@@ -278,8 +755,9 @@ const Magnum::Matrix4 Simulator::getTransformation(const int objectID,
 void Simulator::setTranslation(const Magnum::Vector3& translation,
                                const int objectID,
                                const int sceneID) {
-  if (physicsManager_ != nullptr && sceneID >= 0 && sceneID < sceneID_.size()) {
-    physicsManager_->setTranslation(objectID, translation);
+  physics::PhysicsManager* world = getPhysicsWorld(sceneID);
+  if (world != nullptr) {
+    world->setTranslation(objectID, translation);
   }
 }
 
@@ -287,32 +765,119 @@ const Magnum::Vector3 Simulator::getTranslation(const int objectID,
                                                 const int sceneID) {
   // can throw if physicsManager is not initialized or either objectID/sceneID
   // is invalid
-  if (physicsManager_ != nullptr && sceneID >= 0 && sceneID < sceneID_.size()) {
-    return physicsManager_->getTranslation(objectID);
+  physics::PhysicsManager* world = getPhysicsWorld(sceneID);
+  if (world != nullptr) {
+    return world->getTranslation(objectID);
   }
   return Magnum::Vector3();
 }
 
+std::vector<Magnum::Matrix4> Simulator::getTransformations(
+    const std::vector<int>& objectIDs,
+    const int sceneID) {
+  physics::PhysicsManager* world = getPhysicsWorld(sceneID);
+  if (world != nullptr) {
+    return world->getTransformations(objectIDs);
+  }
+  return std::vector<Magnum::Matrix4>(objectIDs.size());
+}
+
+void Simulator::setTransformations(
+    const std::vector<Magnum::Matrix4>& transforms,
+    const std::vector<int>& objectIDs,
+    const int sceneID) {
+  physics::PhysicsManager* world = getPhysicsWorld(sceneID);
+  if (world != nullptr) {
+    world->setTransformations(objectIDs, transforms);
+  }
+}
+
+std::vector<Magnum::Vector3> Simulator::getTranslations(
+    const std::vector<int>& objectIDs,
+    const int sceneID) {
+  physics::PhysicsManager* world = getPhysicsWorld(sceneID);
+  if (world != nullptr) {
+    return world->getTranslations(objectIDs);
+  }
+  return std::vector<Magnum::Vector3>(objectIDs.size());
+}
+
+void Simulator::setTranslations(
+    const std::vector<Magnum::Vector3>& translations,
+    const std::vector<int>& objectIDs,
+    const int sceneID) {
+  physics::PhysicsManager* world = getPhysicsWorld(sceneID);
+  if (world != nullptr) {
+    world->setTranslations(objectIDs, translations);
+  }
+}
+
+std::vector<physics::RaycastHit> Simulator::castRays(
+    const std::vector<Magnum::Vector3>& origins,
+    const std::vector<Magnum::Vector3>& directions,
+    const float maxDistance,
+    const int sceneID) {
+  physics::PhysicsManager* world = getPhysicsWorld(sceneID);
+  if (world != nullptr) {
+    return world->castRays(origins, directions, maxDistance);
+  }
+  return std::vector<physics::RaycastHit>(origins.size());
+}
+
+std::vector<physics::RaycastHit> Simulator::sweepShapes(
+    const physics::SweepShape& shape,
+    const std::vector<Magnum::Vector3>& origins,
+    const std::vector<Magnum::Vector3>& directions,
+    const float maxDistance,
+    const int sceneID) {
+  physics::PhysicsManager* world = getPhysicsWorld(sceneID);
+  if (world != nullptr) {
+    return world->sweepShapes(shape, origins, directions, maxDistance);
+  }
+  return std::vector<physics::RaycastHit>(origins.size());
+}
+
+std::vector<physics::ContactPoint> Simulator::contactTest(const int objectID,
+                                                          const int sceneID) {
+  physics::PhysicsManager* world = getPhysicsWorld(sceneID);
+  if (world != nullptr) {
+    return world->contactTest(objectID);
+  }
+  return {};
+}
+
+std::vector<int> Simulator::overlapAABB(const Magnum::Range3D& box,
+                                        const int sceneID) {
+  physics::PhysicsManager* world = getPhysicsWorld(sceneID);
+  if (world != nullptr) {
+    return world->overlapAABB(box);
+  }
+  return {};
+}
+
 // set object orientation directly
 void Simulator::setRotation(const Magnum::Quaternion& rotation,
                             const int objectID,
                             const int sceneID) {
-  if (physicsManager_ != nullptr && sceneID >= 0 && sceneID < sceneID_.size()) {
-    physicsManager_->setRotation(objectID, rotation);
+  physics::PhysicsManager* world = getPhysicsWorld(sceneID);
+  if (world != nullptr) {
+    world->setRotation(objectID, rotation);
   }
 }
 
 const Magnum::Quaternion Simulator::getRotation(const int objectID,
                                                 const int sceneID) {
-  if (physicsManager_ != nullptr && sceneID >= 0 && sceneID < sceneID_.size()) {
-    return physicsManager_->getRotation(objectID);
+  physics::PhysicsManager* world = getPhysicsWorld(sceneID);
+  if (world != nullptr) {
+    return world->getRotation(objectID);
   }
   return Magnum::Quaternion();
 }
 
-const double Simulator::stepWorld(const double dt) {
+const double Simulator::stepWorld(const double dt, const int numSteps) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
   if (physicsManager_ != nullptr) {
-    physicsManager_->stepPhysics(dt);
+    physicsManager_->stepPhysics(dt, numSteps);
   }
   return getWorldTime();
 }
@@ -325,5 +890,24 @@ const double Simulator::getWorldTime() {
   return NO_TIME;
 }
 
+std::vector<char> Simulator::savePhysicsState(const int sceneID) {
+  physics::PhysicsManager* world = getPhysicsWorld(sceneID);
+  if (world != nullptr) {
+    return world->saveState();
+  }
+  return {};
+}
+
+bool Simulator::restorePhysicsState(const std::vector<char>& state,
+                                    const int sceneID) {
+  physics::PhysicsManager* world = getPhysicsWorld(sceneID);
+  if (world != nullptr) {
+    // objects of the snapshot removed since are added again
+    auto& drawables = sceneManager_.getSceneGraph(sceneID).getDrawables();
+    return world->restoreState(state, &drawables);
+  }
+  return false;
+}
+
 }  // namespace gfx
 }  // namespace esp
@@ -4,12 +4,15 @@
 
 #pragma once
 
+#include <mutex>
+
 #include "WindowlessContext.h"
 #include "esp/core/esp.h"
 #include "esp/core/random.h"
 #include "esp/scene/SceneConfiguration.h"
 #include "esp/scene/SceneManager.h"
 #include "esp/scene/SceneNode.h"
+#include "esp/scene/SemanticScene.h"
 
 #include "esp/assets/ResourceManager.h"
 
@@ -19,20 +22,73 @@ class PathFinder;
 class ActionSpacePathFinder;
 }  // namespace nav
 namespace scene {
-class SemanticScene;
+class RegionVisibility;
 }  // namespace scene
 namespace gfx {
 
 // forward declarations
 class Renderer;
+struct IdRemap;
 
 struct SimulatorConfiguration {
   scene::SceneConfiguration scene;
   int defaultAgentId = 0;
+  // CUDA device to render on, AUTO_GPU_DEVICE lets the GPU scheduler pick
+  // one by load, see GpuScheduler.h
   int gpuDeviceId = 0;
   std::string defaultCameraUuid = "rgba_camera";
   bool compressTextures = false;
+  // reorder mesh triangles for the vertex cache and quantize vertex
+  // positions when loading, see ResourceManager::optimizeMeshes()
+  bool optimizeMeshes = false;
+  // upload PTex atlases as their submeshes come into view instead of all
+  // when loading the scene
+  bool streamPTexAtlases = false;
+  // load the textures of glTF and other scenes as placeholders, and decode
+  // each on a worker thread once something using it is drawn, see
+  // ResourceManager::streamTextures()
+  bool streamTextures = false;
+  // budget in bytes for keeping assets of scenes no longer in use resident,
+  // see ResourceManager::setAssetCacheBudget(); 0 is unlimited
+  size_t assetCacheBudget = 0;
+  // directory to keep linked shader program binaries in across processes,
+  // see gfx::setProgramBinaryCacheDir(); empty disables it
+  std::string shaderCacheDir = "";
+  // directory on a memory file system, e.g. /dev/shm/habitat-sim, for the
+  // processes of a node to share decoded meshes and navmeshes in, see
+  // io::setSharedCacheDir(); empty disables it
+  std::string sharedCacheDir = "";
+  // tasks the shared core::ThreadPool runs at once, for loading, pathfinder
+  // batches and physics world stepping; 0 for one per hardware thread. The
+  // pool is process-wide and never resized once in use, so the first
+  // simulator configured sizes it and later disagreeing values are ignored
+  // with a warning, see core::ThreadPool::setGlobalNumThreads()
+  int numThreads = 0;
+  // create the GL context shareable, so that simulators on other threads can
+  // share it and the ResourceManager, see Simulator(cfg, shareSimulator).
+  // Disables PTex atlas streaming
+  bool shareableContext = false;
+  // what the object ids of semantic sensors are, mapped on the GPU
+  scene::SemanticIdMapping semanticIdMapping =
+      scene::SemanticIdMapping::Segment;
+  // filter the body moves of the agents of a SimulatorWithAgents by its
+  // navmesh with PathFinder::tryStep, in C++ so that no step goes through
+  // Python
+  bool navMeshMoveFilter = true;
+  // with physics enabled, also resolve the body moves of the agents of
+  // SimulatorWithAgents::stepAgents() against the physics objects, as
+  // kinematic capsules of the radius and height of the agents that push the
+  // dynamic objects, in one batched sweep pass per step
+  bool agentPhysicsBodies = false;
+  // without a renderer, no GL context is created and the scene is loaded
+  // without the GPU: its navmesh and semantic scene, and its collision
+  // meshes if physics is enabled, see ResourceManager::setGpuEnabled()
   bool createRenderer = true;
+  // create the GL context and the renderer, and upload the scene, on the
+  // first observation (the first getRenderer()) instead of when configured,
+  // so that jobs that only query the navmesh or physics never pay for them.
+  // No effect when a context is at hand, e.g. shared
+  bool lazyRenderer = false;
   int width = 256, height = 256;
 
   bool enablePhysics = false;
@@ -51,25 +107,78 @@ bool operator!=(const SimulatorConfiguration& a,
 class Simulator {
  public:
   explicit Simulator(const SimulatorConfiguration& cfg);
+  // Simulator with a GL context on the GPU of shareSimulator, sharing its
+  // GL objects and its ResourceManager, so that assets both load are loaded
+  // once. shareSimulator has to be configured with shareableContext; its
+  // gpuDeviceId applies. Either simulator is to be driven from a single thread
+  // (the one that created it), each from its own
+  Simulator(const SimulatorConfiguration& cfg, Simulator& shareSimulator);
   virtual ~Simulator();
 
   virtual void reconfigure(const SimulatorConfiguration& cfg);
 
+  // Fork of this simulator for branching rollouts, e.g. in planning or
+  // search. The fork shares the GL context, the renderer and the
+  // ResourceManager, so the meshes, textures and collision shapes of the
+  // scene are not loaded again: its own scene graph only holds nodes and
+  // drawables of the cached assets. It gets a copy of the mutable state: the
+  // physics objects of the active scene with their states (see
+  // physics::PhysicsManager::copyObjectsFrom()) and the random generator.
+  // The fork is driven from the thread of this simulator. Other scene graphs
+  // than the active one are not forked
+  virtual std::shared_ptr<Simulator> clone();
+
+  // Start decoding the scene of cfg on a worker thread while the current
+  // episode runs, so that a following reconfigure(cfg) only has to upload it
+  // to the GPU. Returns false if nothing could be prefetched. The next
+  // reconfigure() drops the prefetches it did not use
+  bool prefetchScene(const SimulatorConfiguration& cfg);
+  bool prefetchScene(const scene::SceneConfiguration& sceneConfig);
+  // Drop the prefetched scenes not loaded yet
+  void cancelPrefetches();
+
   virtual void reset();
 
   virtual void seed(uint32_t newSeed);
 
+  //! The renderer, created here on first use with lazyRenderer; nullptr
+  //! without createRenderer
   std::shared_ptr<Renderer> getRenderer();
+  //! CUDA device the simulator renders on, ID_UNDEFINED without a renderer
+  int getGpuDevice() const;
   std::shared_ptr<physics::PhysicsManager> getPhysicsManager();
   std::shared_ptr<scene::SemanticScene> getSemanticScene();
 
+  //! navmesh of the scene, for the sensors that measure paths on it, see
+  //! sensor::NavigationSensor; the one set with setPathFinder(), none by
+  //! default. sim::SimulatorWithAgents has its own
+  virtual std::shared_ptr<nav::PathFinder> getPathFinder() {
+    return pathFinder_;
+  }
+  void setPathFinder(std::shared_ptr<nav::PathFinder> pathFinder) {
+    pathFinder_ = std::move(pathFinder);
+  }
+
+  //! GPU memory of the assets loaded by this simulator and the simulators
+  //! sharing them
+  assets::ResourceManager::MemoryStats getMemoryStats() const;
+
+  //! Wait for the streamed textures drawn so far and upload them, so that
+  //! the next observations show them, see SimulatorConfiguration
+  void finishStreamedTextures();
+
+  //! Time of each stage of loading the last scene loaded, physics included,
+  //! see ResourceManager::getLoadTrace()
+  assets::LoadTrace getLoadTrace() const { return loadTrace_; }
+
   scene::SceneGraph& getActiveSceneGraph();
   scene::SceneGraph& getActiveSemanticSceneGraph();
 
   void saveFrame(const std::string& filename);
 
   // === Physics Simulator Functions ===
-  // TODO: support multi-scene physics (default sceneID=0 currently).
+  // every scene graph with a scene loaded with physics has its own world in
+  // the physics manager, the functions taking a sceneID act on that world.
   // create an object instance from ResourceManager
   // physicsObjectLibrary_[objectLibIndex] in scene sceneID. return the objectID
   // for the new object instance.
@@ -82,6 +191,12 @@ class Simulator {
   // remove object objectID instance in sceneID
   void removeObject(const int objectID, const int sceneID = 0);
 
+  // addObject() of each of objectLibIndices, and removeObject() of each of
+  // objectIDs, in one call, e.g. to populate or reset an episode
+  std::vector<int> addObjects(const std::vector<int>& objectLibIndices,
+                              const int sceneID = 0);
+  void removeObjects(const std::vector<int>& objectIDs, const int sceneID = 0);
+
   // return a list of existing objected IDs in a physical scene
   const std::vector<int> getExistingObjectIDs(const int sceneID = 0);
 
@@ -114,6 +229,44 @@ class Simulator {
   const Magnum::Vector3 getTranslation(const int objectID,
                                        const int sceneID = 0);
 
+  // batched versions of the above for many objects at once, one entry per ID
+  // of objectIDs
+  std::vector<Magnum::Matrix4> getTransformations(
+      const std::vector<int>& objectIDs,
+      const int sceneID = 0);
+  void setTransformations(const std::vector<Magnum::Matrix4>& transforms,
+                          const std::vector<int>& objectIDs,
+                          const int sceneID = 0);
+  std::vector<Magnum::Vector3> getTranslations(
+      const std::vector<int>& objectIDs,
+      const int sceneID = 0);
+  void setTranslations(const std::vector<Magnum::Vector3>& translations,
+                       const std::vector<int>& objectIDs,
+                       const int sceneID = 0);
+
+  // closest hits of rays and of a swept shape from origins along directions
+  // up to maxDistance, one per origin, see physics::PhysicsManager::castRays().
+  // Only misses if physics is not enabled
+  std::vector<physics::RaycastHit> castRays(
+      const std::vector<Magnum::Vector3>& origins,
+      const std::vector<Magnum::Vector3>& directions,
+      const float maxDistance,
+      const int sceneID = 0);
+  std::vector<physics::RaycastHit> sweepShapes(
+      const physics::SweepShape& shape,
+      const std::vector<Magnum::Vector3>& origins,
+      const std::vector<Magnum::Vector3>& directions,
+      const float maxDistance,
+      const int sceneID = 0);
+
+  // contacts of object objectID where it stands now and the objects whose
+  // bounds overlap box, without stepping, see
+  // physics::PhysicsManager::contactTest(). Empty if physics is not enabled
+  std::vector<physics::ContactPoint> contactTest(const int objectID,
+                                                 const int sceneID = 0);
+  std::vector<int> overlapAABB(const Magnum::Range3D& box,
+                               const int sceneID = 0);
+
   // set object rotation directly
   void setRotation(const Magnum::Quaternion& rotation,
                    const int objectID,
@@ -123,14 +276,47 @@ class Simulator {
 
   // the physical world has a notion of time which passes during
   // animation/simulation/action/etc... return the new world time after stepping
-  const double stepWorld(const double dt = 1.0 / 60.0);
+  // the worlds of all scenes together numSteps times by dt. Several steps are
+  // taken in one go, with the scene graphs updated once at the end, see
+  // physics::PhysicsManager::stepPhysics(double, int)
+  const double stepWorld(const double dt = 1.0 / 60.0, const int numSteps = 1);
 
   // get the simulated world time (0 if no physics enabled)
   const double getWorldTime();
 
+  // snapshot of the physics world, restored in place by restorePhysicsState,
+  // e.g. to reset an episode without re-adding its objects; objects added
+  // after the snapshot are removed and removed ones added again, see
+  // PhysicsManager::restoreState(). Empty if physics is not enabled
+  std::vector<char> savePhysicsState(const int sceneID = 0);
+  bool restorePhysicsState(const std::vector<char>& state,
+                           const int sceneID = 0);
+
  protected:
-  Simulator() {}
-  std::unique_ptr<WindowlessContext> context_ = nullptr;
+  Simulator() { addMetricsCollector(); }
+
+  // make this newly constructed simulator a fork of source, see clone()
+  virtual void cloneFrom(Simulator& source);
+
+  // load the scene described by sceneConfig into a new scene graph of
+  // sceneManager_ (plus a separate semantic scene graph if the scene has a
+  // semantic mesh, which is only loaded into it once observed, see
+  // loadSemanticMesh()) using the renderer settings of config_; sceneID and
+  // semanticSceneID receive the graph ids, semanticScene the annotations.
+  // Throws std::invalid_argument if the scene cannot be loaded
+  // If sceneID or semanticSceneID already refer to a scene graph, the scene
+  // previously loaded into it is unloaded and the graph is reused.
+  void loadScene(const scene::SceneConfiguration& sceneConfig,
+                 int& sceneID,
+                 int& semanticSceneID,
+                 std::shared_ptr<scene::SemanticScene>& semanticScene);
+
+  // create the context if there is none, the renderer, and enable the GPU
+  // of resourceManager_ with the renderer settings of config_
+  void initRenderer();
+
+  // shared with the forks of clone()
+  std::shared_ptr<WindowlessContext> context_ = nullptr;
   std::shared_ptr<Renderer> renderer_ = nullptr;
   // CANNOT make the specification of resourceManager_ above the context_!
   // Because when deconstructing the resourceManager_, it needs
@@ -138,19 +324,102 @@ class Simulator {
   // If you switch the order, you will have the error:
   // GL::Context::current(): no current context from Magnum
   // during the deconstruction
-  assets::ResourceManager resourceManager_;
+  // Shared with the simulators sharing the context, the last one deletes it
+  std::shared_ptr<assets::ResourceManager> resourceManager_ =
+      std::make_shared<assets::ResourceManager>();
+  // see setPathFinder(), shared with the forks of clone()
+  std::shared_ptr<nav::PathFinder> pathFinder_ = nullptr;
 
   scene::SceneManager sceneManager_;
   int activeSceneID_ = ID_UNDEFINED;
   int activeSemanticSceneID_ = ID_UNDEFINED;
   std::vector<int> sceneID_;
 
+  // the node holding everything loadScene() created in a scene graph, and the
+  // asset it came from
+  struct LoadedScene {
+    scene::SceneNode* node = nullptr;
+    assets::AssetInfo info;
+  };
+  // maps: scene graph ID -> scene loaded into it
+  std::map<int, LoadedScene> loadedScenes_;
+
+  // a semantic mesh loadScene() left for loadSemanticMesh(), and the
+  // annotations to map its object ids with
+  struct PendingSemanticMesh {
+    assets::AssetInfo info;
+    std::shared_ptr<scene::SemanticScene> semanticScene;
+  };
+  // maps: semantic scene graph ID -> semantic mesh not loaded into it yet
+  std::map<int, PendingSemanticMesh> pendingSemanticMeshes_;
+
+  // what is left to draw of a scene graph loadScene() filled before the
+  // renderer was created, see getRenderer()
+  struct UndrawnScene {
+    // the scene mesh to load with drawables, none for semantic scene graphs
+    // (see loadSemanticMesh())
+    bool hasMesh = false;
+    assets::AssetInfo info;
+    std::shared_ptr<scene::RegionVisibility> regionVisibility;
+  };
+  // maps: scene graph ID -> what is left to draw of it
+  std::map<int, UndrawnScene> undrawnScenes_;
+
+  // load the drawables of sceneID and of the physics objects in it, for
+  // getRenderer()
+  void drawScene(int sceneID, const UndrawnScene& undrawn);
+
+  // load the semantic mesh of the semantic scene graph semanticSceneID, if it
+  // is still pending. Semantic meshes are only loaded once observed, so that
+  // simulators without semantic sensors never pay for them
+  void loadSemanticMesh(int semanticSceneID);
+
+  // create a scene graph if sceneID is ID_UNDEFINED, otherwise move the scene
+  // loaded into it to previousScenes
+  void prepareSceneGraph(int& sceneID,
+                         std::vector<LoadedScene>& previousScenes);
+
+  // delete the nodes of loadedScene and release its assets in
+  // resourceManager_
+  void unloadScene(const LoadedScene& loadedScene);
+
+  // unload the scene loaded into scene graph sceneID, if any, and release the
+  // graph so that its slot in sceneManager_ is reused
+  void releaseSceneGraph(int sceneID);
+
+  // map the object ids of the semantic mesh drawables in the semantic scene
+  // graph as config_.semanticIdMapping asks, see SemanticIdMapping
+  void applySemanticIdMapping(int semanticSceneID,
+                              const scene::SemanticScene& semanticScene);
+  // maps: semantic scene graph ID -> id remap its drawables use
+  std::map<int, std::shared_ptr<IdRemap>> idRemaps_;
+
   std::shared_ptr<scene::SemanticScene> semanticScene_ = nullptr;
 
   std::shared_ptr<physics::PhysicsManager> physicsManager_ = nullptr;
+  // maps: scene graph ID -> ID of its world in physicsManager_. The first
+  // scene loaded with physics is the world of the manager itself, loading a
+  // scene into its graph again creates a new manager
+  std::map<int, int> physicsWorldIDs_;
+
+  // the physics world of the scene in scene graph sceneID, nullptr if there is
+  // none
+  physics::PhysicsManager* getPhysicsWorld(int sceneID);
 
   core::Random random_;
   SimulatorConfiguration config_;
+  assets::LoadTrace loadTrace_;
+
+  // reports the memory of the assets to core::MetricsRegistry, labeled with
+  // a number unique to this simulator
+  void addMetricsCollector();
+  int metricsCollectorId_ = ID_UNDEFINED;
+
+  // held while reconfiguring, resetting, prefetching and stepping, so that
+  // threads sharing a simulator (e.g., Python threads running with the GIL
+  // released) do not interleave these; recursive since overrides call the
+  // functions of the base class
+  std::recursive_mutex mutex_;
 
   ESP_SMART_POINTERS(Simulator)
 };
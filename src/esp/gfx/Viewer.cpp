@@ -6,12 +6,17 @@
 
 #include "Viewer.h"
 
+#include <algorithm>
+#include <chrono>
+#include <string>
+
 #include <Corrade/Utility/Arguments.h>
 #include <Magnum/EigenIntegration/GeometryIntegration.h>
 #include <Magnum/GL/DefaultFramebuffer.h>
 #include <Magnum/GL/Renderer.h>
 #include <sophus/so3.hpp>
 #include "Drawable.h"
+#include "esp/core/Profiling.h"
 #include "esp/io/io.h"
 
 #include "esp/gfx/Simulator.h"
@@ -25,6 +30,15 @@ constexpr float moveSensitivity = 0.1f;
 constexpr float lookSensitivity = 11.25f;
 constexpr float cameraHeight = 1.5f;
 
+namespace {
+typedef std::chrono::steady_clock Clock;
+
+double millisecondsSince(Clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - start)
+      .count();
+}
+}  // namespace
+
 namespace esp {
 namespace gfx {
 
@@ -49,15 +63,27 @@ Viewer::Viewer(const Arguments& arguments)
       .addBooleanOption("enable-physics")
       .addOption("physicsConfig", "./data/default.phys_scene_config.json")
       .setHelp("physicsConfig", "physics scene config file")
+      .addBooleanOption("navmesh-movement")
+      .setHelp("navmesh-movement",
+               "keep the agent on the navmesh, if the scene has one")
+      .addOption("trace-frames", "60")
+      .setHelp("trace-frames",
+               "frames of the Chrome trace the C key captures, see "
+               "BUILD_WITH_PROFILING")
       .parse(arguments.argc, arguments.argv);
 
   const auto viewportSize = GL::defaultFramebuffer.viewport().size();
   enablePhysics_ = args.isSet("enable-physics");
   std::string physicsConfigFilename = args.value("physicsConfig");
+  traceFrames_ = std::max(args.value<int>("trace-frames"), 1);
 
   // Setup renderer and shader defaults
   GL::Renderer::enable(GL::Renderer::Feature::DepthTest);
   GL::Renderer::enable(GL::Renderer::Feature::FaceCulling);
+  renderer_ = Renderer::create(viewportSize[0], viewportSize[1]);
+  // a few frames, the GPU is that far behind at most
+  renderer_->setRenderStatsFrames(4);
+  perfHud_ = PerfHud::create_unique();
 
   int sceneID = sceneManager_.initSceneGraph();
   sceneID_.push_back(sceneID);
@@ -108,19 +134,16 @@ Viewer::Viewer(const Arguments& arguments)
     agentBodyNode_->setTranslation(Vector3(position));
   }
 
-  // connect controls to navmesh if loaded
-  /*
-  if (pathfinder_->isLoaded()) {
-      controls_.setMoveFilterFunction([&](const vec3f& start, const vec3f& end)
-  { vec3f currentPosition = pathfinder_->tryStep(start, end); LOG(INFO) <<
-  "position=" << currentPosition.transpose() << " rotation="
-                  << quatf(agentBodyNode_->rotation()).coeffs().transpose();
-        LOG(INFO) << "Distance to closest obstacle: "
-                  << pathfinder_->distanceToClosestObstacle(currentPosition);
-        return currentPosition;
-      });
-    }
-    */
+  // keep the agent on the navmesh, timing the pathfinding for the HUD
+  if (args.isSet("navmesh-movement") && pathfinder_->isLoaded()) {
+    controls_.setMoveFilterFunction(
+        [this](const vec3f& start, const vec3f& end) {
+          const Clock::time_point navStart = Clock::now();
+          const vec3f position = pathfinder_->tryStep(start, end);
+          frameNavMs_ += millisecondsSince(navStart);
+          return position;
+        });
+  }
 
   renderCamera_->node().setTransformation(
       cameraNode_->absoluteTransformation());
@@ -244,18 +267,58 @@ Vector3 Viewer::positionOnSphere(Magnum::SceneGraph::Camera3D& camera,
 }
 
 void Viewer::drawEvent() {
+  const Clock::time_point frameStart = Clock::now();
+  core::ScopedTimer frameTimer{"Viewer::frame"};
   GL::defaultFramebuffer.clear(GL::FramebufferClear::Color |
                                GL::FramebufferClear::Depth);
   if (sceneID_.size() <= 0)
     return;
 
-  if (physicsManager_ != nullptr)
+  FrameTiming timing;
+  if (physicsManager_ != nullptr) {
+    core::ScopedTimer physicsTimer{"Viewer::physics"};
+    const Clock::time_point physicsStart = Clock::now();
     physicsManager_->stepPhysics(timeline_.previousFrameDuration());
+    timing.physicsMs = millisecondsSince(physicsStart);
+    timing.activeBodies = physicsManager_->checkActiveObjects();
+  }
 
   int DEFAULT_SCENE = 0;
   int sceneID = sceneID_[DEFAULT_SCENE];
   auto& sceneGraph = sceneManager_.getSceneGraph(sceneID);
-  renderCamera_->getMagnumCamera().draw(sceneGraph.getDrawables());
+  {
+    core::ScopedTimer drawTimer{"Viewer::draw"};
+    const Clock::time_point drawStart = Clock::now();
+    renderer_->draw(*renderCamera_, sceneGraph);
+    GL::defaultFramebuffer.bind();
+    renderer_->blitFrameToDefaultFramebuffer();
+    timing.drawMs = millisecondsSince(drawStart);
+  }
+
+  // the counts of this frame, and the GPU time of the latest frame the GPU
+  // finished, without waiting for it
+  const std::vector<RenderStats> renderStats =
+      renderer_->getRenderStats(false);
+  if (!renderStats.empty()) {
+    timing.gpuMs = renderStats.back().gpuTimeNs / 1e6;
+    timing.drawCalls = renderStats.back().drawCallCount;
+    timing.triangles = renderStats.back().triangleCount;
+  }
+  timing.navMs = frameNavMs_;
+  frameNavMs_ = 0.0;
+  timing.cpuMs = millisecondsSince(frameStart);
+  perfHud_->addFrame(timing);
+  if (showPerfHud_) {
+    perfHud_->draw(framebufferSize());
+    if (++framesSinceSummary_ >= 30) {
+      framesSinceSummary_ = 0;
+#ifdef MAGNUM_TARGET_WEBGL
+      LOG(INFO) << perfHud_->getSummary();
+#else
+      setWindowTitle("Viewer | " + perfHud_->getSummary());
+#endif
+    }
+  }
 
   swapBuffers();
   timeline_.nextFrame();
@@ -263,10 +326,41 @@ void Viewer::drawEvent() {
   if (physicsManager_ != nullptr)
     LOG(INFO) << "end drawEvent world time: "
               << physicsManager_->getWorldTime();
+  if (traceFramesLeft_ > 0 && --traceFramesLeft_ == 0) {
+    finishTrace();
+  }
+}
+
+void Viewer::startTrace() {
+  if (traceFramesLeft_ > 0) {
+    return;
+  }
+  if (!core::Profiler::isCompiledIn()) {
+    LOG(WARNING) << "Built without BUILD_WITH_PROFILING, the trace only has "
+                    "the frames of the viewer";
+  }
+  core::Profiler& profiler = core::Profiler::get();
+  profiler.clear();
+  profiler.setEnabled(true);
+  traceFramesLeft_ = traceFrames_;
+  LOG(INFO) << "Tracing the next " << traceFrames_ << " frames";
+}
+
+void Viewer::finishTrace() {
+  core::Profiler& profiler = core::Profiler::get();
+  profiler.setEnabled(false);
+  const std::string file =
+      "viewer_trace_" + std::to_string(numTraces_++) + ".json";
+  if (profiler.saveChromeTrace(file)) {
+    LOG(INFO) << "Saved the trace of " << traceFrames_ << " frames to "
+              << file << ", open it in chrome://tracing or Perfetto";
+  }
+  profiler.clear();
 }
 
 void Viewer::viewportEvent(ViewportEvent& event) {
   GL::defaultFramebuffer.setViewport({{}, framebufferSize()});
+  renderer_->setSize(framebufferSize().x(), framebufferSize().y());
   renderCamera_->getMagnumCamera().setViewport(event.windowSize());
 }
 
@@ -397,6 +491,12 @@ void Viewer::keyPressEvent(KeyEvent& event) {
       // Test key. Put what you want here...
       torqueLastObject();
       break;
+    case KeyEvent::Key::H:
+      showPerfHud_ = !showPerfHud_;
+      break;
+    case KeyEvent::Key::C:
+      startTrace();
+      break;
     default:
       break;
   }
@@ -15,7 +15,9 @@
 
 #include "esp/agent/Agent.h"
 #include "esp/assets/ResourceManager.h"
+#include "esp/gfx/PerfHud.h"
 #include "esp/gfx/RenderCamera.h"
+#include "esp/gfx/Renderer.h"
 #include "esp/nav/PathFinder.h"
 #include "esp/physics/PhysicsManager.h"
 #include "esp/physics/RigidObject.h"
@@ -60,6 +62,10 @@ class Viewer : public Magnum::Platform::Application {
   Magnum::Vector3 positionOnSphere(Magnum::SceneGraph::Camera3D& camera,
                                    const Magnum::Vector2i& position);
 
+  // Chrome trace of the next traceFrames_ frames, saved when they are done
+  void startTrace();
+  void finishTrace();
+
   assets::ResourceManager resourceManager_;
   std::shared_ptr<physics::PhysicsManager> physicsManager_;
   scene::SceneManager sceneManager_;
@@ -82,6 +88,19 @@ class Viewer : public Magnum::Platform::Application {
   std::vector<int> objectIDs_;
 
   Magnum::Timeline timeline_;
+
+  // draws the frames, so that they are culled and timed like the sensors do
+  Renderer::ptr renderer_;
+  PerfHud::uptr perfHud_;
+  bool showPerfHud_ = true;
+  // pathfinding of the frame so far, for the HUD
+  double frameNavMs_ = 0.0;
+  // frames since the title bar showed the HUD summary
+  int framesSinceSummary_ = 0;
+
+  int traceFrames_ = 60;
+  int traceFramesLeft_ = 0;
+  int numTraces_ = 0;
 };
 
 }  // namespace gfx
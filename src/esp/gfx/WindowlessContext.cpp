@@ -20,6 +20,9 @@
 #endif
 
 #include <fcntl.h>
+#include <limits.h>
+#include <map>
+#include <mutex>
 #include <sys/stat.h>
 #include <unistd.h>
 #elif defined(CORRADE_TARGET_WINDOWS)
@@ -41,9 +44,20 @@ namespace gfx {
 
 namespace {
 
+// arguments of the Magnum contexts of a share group: meshes are drawn
+// without vertex array objects, which are the one kind of GL object contexts
+// do not share
+const char* shareableContextArgs[] = {"", "--magnum-disable-extensions",
+                                      "GL_ARB_vertex_array_object"};
+
+int magnumArgc(bool shareable) {
+  return shareable ? 3 : 1;
+}
+
 struct ESPContext {
   virtual void makeCurrent() = 0;
   virtual bool isValid() = 0;
+  virtual bool isShareable() = 0;
 
   virtual ~ESPContext(){};
 
@@ -69,8 +83,71 @@ bool isNvidiaGpuReadable(int device) {
   return true;
 }
 
+// PCI bus id of the GPU behind a DRM device file such as /dev/dri/card1, as
+// sysfs links it, empty if unknown
+std::string drmPciBusId(const char* deviceFile) {
+  if (deviceFile == nullptr) {
+    return "";
+  }
+  const std::string file = deviceFile;
+  const std::string card = file.substr(file.rfind('/') + 1);
+  char link[PATH_MAX];
+  const ssize_t size = readlink(("/sys/class/drm/" + card + "/device").c_str(),
+                                link, sizeof(link) - 1);
+  if (size <= 0) {
+    return "";
+  }
+  const std::string target(link, size);
+  return target.substr(target.rfind('/') + 1);
+}
+
+// CUDA devices a context can be created on, i.e. with a readable EGL device
+std::vector<GpuDevice> readableGpuDevices() {
+  CHECK(gladLoadEGL()) << "Failed to load EGL";
+
+  EGLDeviceEXT eglDevices[MAX_DEVICES];
+  EGLint numDevices;
+  eglQueryDevicesEXT(MAX_DEVICES, eglDevices, &numDevices);
+  CHECK_EGL_ERROR();
+
+  std::vector<GpuDevice> devices;
+  for (int eglDevId = 0; eglDevId < numDevices; ++eglDevId) {
+    EGLAttrib cudaDevNumber;
+    if (eglQueryDeviceAttribEXT(eglDevices[eglDevId], EGL_CUDA_DEVICE_NV,
+                                &cudaDevNumber) == EGL_FALSE ||
+        !isNvidiaGpuReadable(eglDevId)) {
+      continue;
+    }
+    devices.push_back({static_cast<int>(cudaDevNumber),
+                       drmPciBusId(eglQueryDeviceStringEXT(
+                           eglDevices[eglDevId], EGL_DRM_DEVICE_FILE_EXT))});
+  }
+  return devices;
+}
+
+// eglTerminate() is not reference counted, yet all contexts of a device share
+// its display, so the display is only terminated with its last context
+std::mutex displayMutex;
+std::map<EGLDisplay, int> displayRefCounts;
+
+void acquireDisplay(EGLDisplay display) {
+  std::lock_guard<std::mutex> lock(displayMutex);
+  ++displayRefCounts[display];
+}
+
+void releaseDisplay(EGLDisplay display) {
+  std::lock_guard<std::mutex> lock(displayMutex);
+  if (--displayRefCounts[display] == 0) {
+    displayRefCounts.erase(display);
+    eglTerminate(display);
+  }
+}
+
 struct ESPEGLContext : ESPContext {
-  ESPEGLContext(int device) : magnumGlContext_{NoCreate} {
+  ESPEGLContext(int device, bool shareable, ESPEGLContext* shareContext)
+      : magnumGlContext_{NoCreate, magnumArgc(shareable),
+                         shareableContextArgs},
+        shareable_{shareable} {
     CHECK(gladLoadEGL()) << "Failed to load EGL";
 
     static const EGLint configAttribs[] = {EGL_SURFACE_TYPE,
@@ -87,8 +164,10 @@ struct ESPEGLContext : ESPContext {
                                            EGL_OPENGL_BIT,
                                            EGL_NONE};
 
-    // 1. Initialize EGL
-    {
+    // 1. Initialize EGL, with the display of the shared context if any
+    if (shareContext != nullptr) {
+      display_ = shareContext->display_;
+    } else {
       EGLDeviceEXT eglDevices[MAX_DEVICES];
       EGLint numDevices;
       eglQueryDevicesEXT(MAX_DEVICES, eglDevices, &numDevices);
@@ -129,6 +208,7 @@ struct ESPEGLContext : ESPContext {
       LOG(ERROR) << "[EGL] Failed to initialize.";
     }
     CHECK_EGL_ERROR();
+    acquireDisplay(display_);
 
     LOG(INFO) << "[EGL] Version: " << eglQueryString(display_, EGL_VERSION);
     LOG(INFO) << "[EGL] Vendor: " << eglQueryString(display_, EGL_VENDOR);
@@ -151,8 +231,11 @@ struct ESPEGLContext : ESPContext {
     }
     CHECK_EGL_ERROR();
 
-    // 4. Create a context
-    context_ = eglCreateContext(display_, eglConfig, EGL_NO_CONTEXT, NULL);
+    // 4. Create a context, in the share group of shareContext if any
+    context_ = eglCreateContext(
+        display_, eglConfig,
+        shareContext != nullptr ? shareContext->context_ : EGL_NO_CONTEXT,
+        NULL);
     CHECK_EGL_ERROR();
 
     // 5. Make context current and create Magnum context
@@ -170,19 +253,23 @@ struct ESPEGLContext : ESPContext {
       LOG(ERROR) << "[EGL] Failed to make EGL context current";
     }
     CHECK_EGL_ERROR();
+    // Magnum tracks the current context per thread as well
+    GL::Context::makeCurrent(isValid_ ? &magnumGlContext_ : nullptr);
   };
 
   bool isValid() { return isValid_; };
+  bool isShareable() { return shareable_; };
 
   ~ESPEGLContext() {
     eglDestroyContext(display_, context_);
-    eglTerminate(display_);
+    releaseDisplay(display_);
   }
 
  private:
   EGLDisplay display_;
   EGLContext context_;
   Platform::GLContext magnumGlContext_;
+  bool shareable_;
   bool isValid_ = false;
 
   ESP_SMART_POINTERS(ESPEGLContext);
@@ -191,9 +278,11 @@ struct ESPEGLContext : ESPContext {
 #else  // ESP_BUILD_EGL_SUPPORT not defined
 
 struct ESPGLXContext : ESPContext {
-  ESPGLXContext()
+  ESPGLXContext(bool shareable)
       : glxCtx_{Platform::WindowlessGlxContext::Configuration()},
-        magnumGlContext_{NoCreate} {
+        magnumGlContext_{NoCreate, magnumArgc(shareable),
+                         shareableContextArgs},
+        shareable_{shareable} {
     CHECK(glxCtx_.isCreated())
         << "[GLX] Failed to created headless glX context";
 
@@ -204,12 +293,17 @@ struct ESPGLXContext : ESPContext {
     isValid_ = true;
   };
 
-  void makeCurrent() { glxCtx_.makeCurrent(); };
+  void makeCurrent() {
+    glxCtx_.makeCurrent();
+    GL::Context::makeCurrent(isValid_ ? &magnumGlContext_ : nullptr);
+  };
   bool isValid() { return isValid_; };
+  bool isShareable() { return shareable_; };
 
  private:
   Platform::WindowlessGlxContext glxCtx_;
   Platform::GLContext magnumGlContext_;
+  bool shareable_;
   bool isValid_ = false;
 
   ESP_SMART_POINTERS(ESPGLXContext);
@@ -220,10 +314,32 @@ struct ESPGLXContext : ESPContext {
 };  // namespace
 
 struct WindowlessContext::Impl {
-  Impl(int device) {
+  Impl(int device, bool shareable, Impl* shareContext) {
 #ifdef ESP_BUILD_EGL_SUPPORT
-    glContext_ = ESPEGLContext::create_unique(device);
+    if (shareContext != nullptr) {
+      CHECK(shareContext->glContext_->isShareable())
+          << "[EGL] Only a shareable context can be shared";
+      glContext_ = ESPEGLContext::create_unique(
+          shareContext->gpuDevice_, true,
+          static_cast<ESPEGLContext*>(shareContext->glContext_.get()));
+      gpuDevice_ = shareContext->gpuDevice_;
+      makeCurrent();
+      return;
+    }
+    if (device == AUTO_GPU_DEVICE) {
+      gpuDeviceClaim_ = std::make_unique<GpuDeviceClaim>(readableGpuDevices());
+      device = gpuDeviceClaim_->getCudaDevice();
+      CHECK(device != ID_UNDEFINED)
+          << "[EGL] No readable GPU to schedule the context on";
+    }
+    glContext_ = ESPEGLContext::create_unique(device, shareable, nullptr);
 #else
+    CHECK(shareContext == nullptr)
+        << "glX contexts cannot be shared. Please compile with "
+           "BUILD_GUI_VIEWERS=0 for shared contexts via EGL";
+    if (device == AUTO_GPU_DEVICE) {
+      device = 0;
+    }
     CHECK_EQ(device, 0)
         << "glX context does not support multiple GPUs. Please compile with "
            "BUILD_GUI_VIEWERS=0 for multi-gpu support via EGL";
@@ -231,8 +347,9 @@ struct WindowlessContext::Impl {
         << "DISPLAY not detected. For headless systems, compile with "
            "--headless for EGL support";
 
-    glContext_ = ESPGLXContext::create_unique();
+    glContext_ = ESPGLXContext::create_unique(shareable);
 #endif
+    gpuDevice_ = device;
 
     makeCurrent();
   }
@@ -240,14 +357,21 @@ struct WindowlessContext::Impl {
   ~Impl() { LOG(INFO) << "Deconstructing GL context"; }
 
   void makeCurrent() { glContext_->makeCurrent(); }
+  bool isShareable() const { return glContext_->isShareable(); }
 
+  // released after the context is destroyed
+  std::unique_ptr<GpuDeviceClaim> gpuDeviceClaim_;
   ESPContext::uptr glContext_ = nullptr;
+  int gpuDevice_ = 0;
 };
 
 #else  // not defined(CORRADE_TARGET_UNIX) && !defined(CORRADE_TARGET_APPLE)
 
 struct WindowlessContext::Impl {
-  Impl(int device) : glContext_({}), magnumGlContext_(NoCreate) {
+  Impl(int device, bool shareable, Impl* shareContext)
+      : glContext_({}), magnumGlContext_(NoCreate) {
+    CHECK(shareContext == nullptr)
+        << "Shared contexts are only supported with EGL";
     glContext_.makeCurrent();
     if (!magnumGlContext_.tryCreate()) {
       LOG(ERROR) << "Failed to create GL context";
@@ -256,20 +380,40 @@ struct WindowlessContext::Impl {
 
   ~Impl() { LOG(INFO) << "Deconstructing GL context"; }
 
-  void makeCurrent() { glContext_.makeCurrent(); }
+  void makeCurrent() {
+    glContext_.makeCurrent();
+    GL::Context::makeCurrent(&magnumGlContext_);
+  }
+  bool isShareable() const { return false; }
 
   Platform::WindowlessGLContext glContext_;
   Platform::GLContext magnumGlContext_;
+  // a single GPU
+  int gpuDevice_ = 0;
 };
 
 #endif
 
-WindowlessContext::WindowlessContext(int device /* = 0 */)
-    : pimpl_(spimpl::make_unique_impl<Impl>(device)) {}
+WindowlessContext::WindowlessContext(int device /* = 0 */,
+                                     bool shareable /* = false */)
+    : pimpl_(spimpl::make_unique_impl<Impl>(device, shareable, nullptr)) {}
+
+WindowlessContext::WindowlessContext(WindowlessContext& shareContext)
+    : pimpl_(spimpl::make_unique_impl<Impl>(shareContext.getGpuDevice(),
+                                            true,
+                                            shareContext.pimpl_.get())) {}
 
 void WindowlessContext::makeCurrent() {
   pimpl_->makeCurrent();
 }
 
+bool WindowlessContext::isShareable() const {
+  return pimpl_->isShareable();
+}
+
+int WindowlessContext::getGpuDevice() const {
+  return pimpl_->gpuDevice_;
+}
+
 }  // namespace gfx
 }  // namespace esp
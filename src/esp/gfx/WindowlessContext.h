@@ -5,16 +5,35 @@
 #pragma once
 
 #include "esp/core/esp.h"
+#include "esp/gfx/GpuScheduler.h"
 
 namespace esp {
 namespace gfx {
 
 class WindowlessContext {
  public:
-  explicit WindowlessContext(int gpuDevice = 0);
+  //! Create a context on CUDA device gpuDevice, or on the one the GPU
+  //! scheduler picks for AUTO_GPU_DEVICE, see GpuScheduler.h. Only a
+  //! shareable context can be shared with other contexts, see below
+  explicit WindowlessContext(int gpuDevice = 0, bool shareable = false);
 
+  //! Create a context on the device of shareContext that shares its GL
+  //! objects (buffers, textures, programs), e.g. to render on another thread
+  //! what was loaded on this one. shareContext has to be shareable; all
+  //! contexts of a share group draw meshes without vertex array objects, as
+  //! those cannot be shared. Needs EGL
+  explicit WindowlessContext(WindowlessContext& shareContext);
+
+  //! Make the context current on the calling thread. A context can be
+  //! current on one thread at a time, contexts sharing objects can be current
+  //! on different threads at once
   void makeCurrent();
 
+  bool isShareable() const;
+
+  //! CUDA device the context was created on
+  int getGpuDevice() const;
+
   ESP_SMART_POINTERS_WITH_UNIQUE_PIMPL(WindowlessContext)
 };
 
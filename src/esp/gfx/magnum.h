@@ -4,8 +4,13 @@
 
 #pragma once
 
+#include <functional>
+#include <utility>
+#include <vector>
+
 #include <Magnum/GL/Mesh.h>
 #include <Magnum/GL/Texture.h>
+#include <Magnum/Math/Matrix4.h>
 #include <Magnum/Mesh.h>
 #include <Magnum/SceneGraph/Camera.h>
 #include <Magnum/SceneGraph/Drawable.h>
@@ -26,5 +31,10 @@ typedef Magnum::SceneGraph::Scene<
 typedef Magnum::SceneGraph::Camera3D MagnumCamera;
 typedef Magnum::SceneGraph::Drawable3D MagnumDrawable;
 typedef Magnum::SceneGraph::DrawableGroup3D MagnumDrawableGroup;
+// drawables with their transformation relative to the camera, as returned by
+// Camera3D::drawableTransformations()
+typedef std::vector<
+    std::pair<std::reference_wrapper<MagnumDrawable>, Magnum::Matrix4>>
+    MagnumDrawableTransformations;
 typedef Magnum::GL::AbstractShaderProgram MagnumShaderProgram;
 typedef Magnum::Trade::PhongMaterialData MagnumMaterialData;
@@ -0,0 +1,88 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#include <string>
+
+#include <Corrade/Containers/Array.h>
+#include <Corrade/TestSuite/Compare/Numeric.h>
+#include <Corrade/TestSuite/Tester.h>
+#include <Magnum/Math/FunctionsBatch.h>
+#include <Magnum/Math/Matrix4.h>
+
+#include "esp/gfx/DepthUnprojection.h"
+
+namespace Cr = Corrade;
+namespace Mn = Magnum;
+
+namespace esp {
+namespace gfx {
+namespace test {
+namespace {
+
+// CPU-only throughput comparison of the scalar and the runtime-dispatched
+// SIMD depth unprojection, no GL context needed
+struct DepthUnprojectionBenchmark : Cr::TestSuite::Tester {
+  explicit DepthUnprojectionBenchmark();
+
+  void scalar();
+  void simd();
+};
+
+using namespace Mn::Math::Literals;
+
+const struct {
+  const char* name;
+  Mn::Vector2i size;
+} BenchmarkData[]{
+    {"256x256", Mn::Vector2i{256}},
+    {"1024x1024", Mn::Vector2i{1024}},
+};
+
+Cr::Containers::Array<float> benchmarkDepth(const Mn::Vector2i& size) {
+  Cr::Containers::Array<float> depth{Cr::Containers::NoInit,
+                                     std::size_t(size.product())};
+  // every 10000th value is on the far plane
+  for (std::size_t i = 0; i != depth.size(); ++i)
+    depth[i] = float(i % 10000) / float(10000 - 1);
+  return depth;
+}
+
+const Mn::Vector2 BenchmarkUnprojection = calculateDepthUnprojection(
+    Mn::Matrix4::perspectiveProjection(60.0_degf, 1.0f, 0.001f, 100.0f));
+
+DepthUnprojectionBenchmark::DepthUnprojectionBenchmark() {
+  addInstancedBenchmarks({&DepthUnprojectionBenchmark::scalar,
+                          &DepthUnprojectionBenchmark::simd},
+                         50, Cr::Containers::arraySize(BenchmarkData));
+}
+
+void DepthUnprojectionBenchmark::scalar() {
+  auto&& data = BenchmarkData[testCaseInstanceId()];
+  setTestCaseDescription(data.name);
+
+  Cr::Containers::Array<float> depth = benchmarkDepth(data.size);
+  CORRADE_BENCHMARK(1) { unprojectDepthScalar(BenchmarkUnprojection, depth); }
+
+  CORRADE_COMPARE_AS(Mn::Math::max<float>(depth), 9.0f,
+                     Cr::TestSuite::Compare::Greater);
+}
+
+void DepthUnprojectionBenchmark::simd() {
+  auto&& data = BenchmarkData[testCaseInstanceId()];
+  setTestCaseDescription(
+      std::string{data.name} + ", " + unprojectDepthImplementationName());
+
+  Cr::Containers::Array<float> depth = benchmarkDepth(data.size);
+  CORRADE_BENCHMARK(1) { unprojectDepth(BenchmarkUnprojection, depth); }
+
+  CORRADE_COMPARE_AS(Mn::Math::max<float>(depth), 9.0f,
+                     Cr::TestSuite::Compare::Greater);
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace gfx
+}  // namespace esp
+
+CORRADE_TEST_MAIN(esp::gfx::test::DepthUnprojectionBenchmark)
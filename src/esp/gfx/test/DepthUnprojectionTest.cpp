@@ -33,6 +33,7 @@ struct DepthUnprojectionTest : Mn::GL::OpenGLTester {
   explicit DepthUnprojectionTest();
 
   void testCpu();
+  void testCpuSimdMatchesScalar();
   void testGpuDirect();
   void testGpuUnprojectExisting();
 
@@ -141,6 +142,8 @@ DepthUnprojectionTest::DepthUnprojectionTest() {
        &DepthUnprojectionTest::testGpuUnprojectExisting},
       Cr::Containers::arraySize(TestData));
 
+  addTests({&DepthUnprojectionTest::testCpuSimdMatchesScalar});
+
   addInstancedBenchmarks({&DepthUnprojectionTest::benchmarkBaseline}, 50,
                          Cr::Containers::arraySize(UnprojectBenchmarkData));
 
@@ -172,6 +175,29 @@ void DepthUnprojectionTest::testCpu() {
                        Cr::TestSuite::Compare::around(data.depth * 0.0002f));
 }
 
+void DepthUnprojectionTest::testCpuSimdMatchesScalar() {
+  Mn::Debug{} << "Implementation:" << unprojectDepthImplementationName();
+
+  const Mn::Vector2 unprojection = calculateDepthUnprojection(
+      Mn::Matrix4::perspectiveProjection(60.0_degf, 1.0f, 0.01f, 100.0f));
+
+  /* Not a multiple of any vector width to exercise the scalar remainder, with
+     far plane values sprinkled in */
+  Cr::Containers::Array<float> expected{Cr::Containers::NoInit, 1027};
+  for (std::size_t i = 0; i != expected.size(); ++i)
+    expected[i] = i % 7 == 0 ? 1.0f : float(i) / float(expected.size());
+  Cr::Containers::Array<float> actual{Cr::Containers::NoInit, expected.size()};
+  for (std::size_t i = 0; i != expected.size(); ++i)
+    actual[i] = expected[i];
+
+  unprojectDepthScalar(unprojection, expected);
+  unprojectDepth(unprojection, actual);
+
+  for (std::size_t i = 0; i != expected.size(); ++i)
+    CORRADE_COMPARE(actual[i], expected[i]);
+  CORRADE_COMPARE(actual[0], 0.0f);
+}
+
 void DepthUnprojectionTest::testGpuDirect() {
   auto&& data = TestData[testCaseInstanceId()];
   setTestCaseDescription(data.name);
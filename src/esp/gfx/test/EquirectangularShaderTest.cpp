@@ -0,0 +1,55 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#include <Corrade/TestSuite/Tester.h>
+#include <Magnum/Math/Matrix4.h>
+
+#include "esp/gfx/EquirectangularShader.h"
+
+namespace Cr = Corrade;
+namespace Mn = Magnum;
+
+namespace esp {
+namespace gfx {
+namespace test {
+namespace {
+
+// face layout only, no GPU needed
+struct EquirectangularShaderTest : Cr::TestSuite::Tester {
+  explicit EquirectangularShaderTest();
+
+  void testFaceRotations();
+};
+
+EquirectangularShaderTest::EquirectangularShaderTest() {
+  addTests({&EquirectangularShaderTest::testFaceRotations});
+}
+
+void EquirectangularShaderTest::testFaceRotations() {
+  const Mn::Vector3 forward{0.0f, 0.0f, -1.0f};
+  const Mn::Vector3 up{0.0f, 1.0f, 0.0f};
+  auto rotate = [](CubeMapFace face, const Mn::Vector3& v) {
+    return cubeMapFaceRotation(face).transformVector(v);
+  };
+
+  CORRADE_COMPARE(rotate(CubeMapFace::Front, forward), forward);
+  CORRADE_COMPARE(rotate(CubeMapFace::Right, forward), Mn::Vector3::xAxis());
+  CORRADE_COMPARE(rotate(CubeMapFace::Back, forward), Mn::Vector3::zAxis());
+  CORRADE_COMPARE(rotate(CubeMapFace::Left, forward), -Mn::Vector3::xAxis());
+  CORRADE_COMPARE(rotate(CubeMapFace::Up, forward), Mn::Vector3::yAxis());
+  CORRADE_COMPARE(rotate(CubeMapFace::Down, forward), -Mn::Vector3::yAxis());
+
+  // the faces around the horizon stay upright
+  for (CubeMapFace face : {CubeMapFace::Front, CubeMapFace::Right,
+                           CubeMapFace::Back, CubeMapFace::Left}) {
+    CORRADE_COMPARE(rotate(face, up), up);
+  }
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace gfx
+}  // namespace esp
+
+CORRADE_TEST_MAIN(esp::gfx::test::EquirectangularShaderTest)
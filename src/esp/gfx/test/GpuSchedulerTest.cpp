@@ -0,0 +1,104 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#include <cstdio>
+#include <memory>
+#include <string>
+
+#include <Corrade/TestSuite/Tester.h>
+#include <Corrade/Utility/Directory.h>
+
+#include "esp/gfx/GpuScheduler.h"
+
+namespace Cr = Corrade;
+
+namespace esp {
+namespace gfx {
+namespace test {
+namespace {
+
+// scheduling policy and the registry, no GPU needed
+struct GpuSchedulerTest : Cr::TestSuite::Tester {
+  explicit GpuSchedulerTest();
+
+  void testPick();
+  void testClaim();
+};
+
+GpuSchedulerTest::GpuSchedulerTest() {
+  addTests({&GpuSchedulerTest::testPick, &GpuSchedulerTest::testClaim});
+}
+
+GpuDeviceStatus status(int numContexts,
+                       int utilization,
+                       size_t freeMemory,
+                       size_t totalMemory = size_t(16) << 30) {
+  GpuDeviceStatus s;
+  s.numContexts = numContexts;
+  s.utilization = utilization;
+  s.freeMemory = freeMemory;
+  s.totalMemory = totalMemory;
+  return s;
+}
+
+void GpuSchedulerTest::testPick() {
+  const size_t gib = size_t(1) << 30;
+  CORRADE_COMPARE(pickGpuDevice({}), ID_UNDEFINED);
+
+  // fewest contexts first
+  CORRADE_COMPARE(pickGpuDevice({status(2, 0, 8 * gib), status(1, 90, gib)}),
+                  1);
+  // then the least busy, with small differences in utilization ignored
+  CORRADE_COMPARE(pickGpuDevice({status(1, 80, 8 * gib), status(1, 10, gib)}),
+                  1);
+  CORRADE_COMPARE(
+      pickGpuDevice({status(1, 12, 8 * gib), status(1, 15, 4 * gib)}), 0);
+  // then the most free memory
+  CORRADE_COMPARE(
+      pickGpuDevice({status(1, 10, 2 * gib), status(1, 10, 4 * gib)}), 1);
+  // devices about to run out of memory come last
+  CORRADE_COMPARE(pickGpuDevice({status(0, 0, gib / 2), status(3, 90, gib)}),
+                  1);
+  CORRADE_COMPARE(
+      pickGpuDevice({status(0, 0, gib / 2), status(1, 0, gib / 4)}), 0);
+  // unknown memory is not low
+  CORRADE_COMPARE(pickGpuDevice({status(1, 0, 0, 0), status(2, 0, 0, 0)}), 0);
+}
+
+void GpuSchedulerTest::testClaim() {
+  const std::string registry = Cr::Utility::Directory::join(
+      Cr::Utility::Directory::tmp(), "GpuSchedulerTest.registry");
+  std::remove(registry.c_str());
+  const std::vector<GpuDevice> devices = {{3, ""}, {5, ""}};
+
+  // without memory information contexts are spread evenly
+  std::unique_ptr<GpuDeviceClaim> a =
+      std::make_unique<GpuDeviceClaim>(devices, registry);
+  std::unique_ptr<GpuDeviceClaim> b =
+      std::make_unique<GpuDeviceClaim>(devices, registry);
+  CORRADE_COMPARE(a->getCudaDevice(), 3);
+  CORRADE_COMPARE(b->getCudaDevice(), 5);
+  std::vector<GpuDeviceStatus> s = queryGpuDevices(devices, registry);
+  CORRADE_COMPARE(s[0].numContexts, 1);
+  CORRADE_COMPARE(s[1].numContexts, 1);
+
+  // a released device is picked again
+  a = nullptr;
+  s = queryGpuDevices(devices, registry);
+  CORRADE_COMPARE(s[0].numContexts, 0);
+  GpuDeviceClaim c{devices, registry};
+  CORRADE_COMPARE(c.getCudaDevice(), 3);
+
+  CORRADE_COMPARE(GpuDeviceClaim({}, registry).getCudaDevice(), ID_UNDEFINED);
+
+  b = nullptr;
+  std::remove(registry.c_str());
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace gfx
+}  // namespace esp
+
+CORRADE_TEST_MAIN(esp::gfx::test::GpuSchedulerTest)
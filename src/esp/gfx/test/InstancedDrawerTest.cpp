@@ -0,0 +1,144 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#include <Corrade/Containers/StridedArrayView.h>
+#include <Magnum/GL/Framebuffer.h>
+#include <Magnum/GL/Mesh.h>
+#include <Magnum/GL/OpenGLTester.h>
+#include <Magnum/GL/Renderbuffer.h>
+#include <Magnum/GL/Renderer.h>
+#include <Magnum/GL/RenderbufferFormat.h>
+#include <Magnum/Image.h>
+#include <Magnum/Math/Color.h>
+#include <Magnum/Math/Matrix4.h>
+#include <Magnum/MeshTools/Compile.h>
+#include <Magnum/PixelFormat.h>
+#include <Magnum/Primitives/Cube.h>
+#include <Magnum/Primitives/Icosphere.h>
+#include <Magnum/Shaders/Flat.h>
+#include <Magnum/Trade/MeshData3D.h>
+
+#include "esp/gfx/GenericDrawable.h"
+#include "esp/gfx/InstancedDrawer.h"
+#include "esp/scene/SceneGraph.h"
+
+namespace Cr = Corrade;
+namespace Mn = Magnum;
+
+namespace esp {
+namespace gfx {
+namespace test {
+namespace {
+
+struct InstancedDrawerTest : Mn::GL::OpenGLTester {
+  explicit InstancedDrawerTest();
+
+  void testMatchesDrawables();
+};
+
+using namespace Mn::Math::Literals;
+
+InstancedDrawerTest::InstancedDrawerTest() {
+  addTests({&InstancedDrawerTest::testMatchesDrawables});
+}
+
+void InstancedDrawerTest::testMatchesDrawables() {
+  const Mn::Vector2i size{64, 64};
+  Mn::GL::Renderbuffer color, objectId, depth;
+  color.setStorage(Mn::GL::RenderbufferFormat::RGBA8, size);
+  objectId.setStorage(Mn::GL::RenderbufferFormat::R32UI, size);
+  depth.setStorage(Mn::GL::RenderbufferFormat::DepthComponent24, size);
+  Mn::GL::Framebuffer framebuffer{{{}, size}};
+  framebuffer
+      .attachRenderbuffer(Mn::GL::Framebuffer::ColorAttachment{0}, color)
+      .attachRenderbuffer(Mn::GL::Framebuffer::ColorAttachment{1}, objectId)
+      .attachRenderbuffer(Mn::GL::Framebuffer::BufferAttachment::Depth, depth)
+      .mapForDraw({{Mn::Shaders::Flat3D::ColorOutput,
+                    Mn::GL::Framebuffer::ColorAttachment{0}},
+                   {Mn::Shaders::Flat3D::ObjectIdOutput,
+                    Mn::GL::Framebuffer::ColorAttachment{1}}});
+  CORRADE_COMPARE(framebuffer.checkStatus(Mn::GL::FramebufferTarget::Draw),
+                  Mn::GL::Framebuffer::Status::Complete);
+  Mn::GL::Renderer::enable(Mn::GL::Renderer::Feature::DepthTest);
+
+  Mn::Shaders::Flat3D shader{Mn::Shaders::Flat3D::Flag::ObjectId};
+  Mn::GL::Mesh cube = Mn::MeshTools::compile(Mn::Primitives::cubeSolid());
+  Mn::GL::Mesh sphere =
+      Mn::MeshTools::compile(Mn::Primitives::icosphereSolid(1));
+
+  // a row of cubes in different colors, which get instanced, and one sphere,
+  // which does not
+  scene::SceneGraph sceneGraph;
+  scene::SceneNode& root = sceneGraph.getRootNode();
+  for (int i = 0; i < 5; ++i) {
+    scene::SceneNode& node = root.createChild();
+    node.setId(i + 1);
+    node.translate({float(i) * 2.5f - 5.0f, 0.0f, 0.0f});
+    node.rotateY(Mn::Deg(15.0f * i));
+    new GenericDrawable{node,
+                        shader,
+                        cube,
+                        &sceneGraph.getDrawables(),
+                        nullptr,
+                        ID_UNDEFINED,
+                        Mn::Color4::fromHsv({Mn::Deg(60.0f * i), 1.0f, 1.0f})};
+  }
+  scene::SceneNode& sphereNode = root.createChild();
+  sphereNode.setId(10);
+  sphereNode.translate({0.0f, 2.5f, 0.0f});
+  new GenericDrawable{sphereNode, shader, sphere, &sceneGraph.getDrawables()};
+
+  scene::SceneNode& cameraNode = root.createChild();
+  cameraNode.translate({0.0f, 0.0f, 12.0f});
+  MagnumCamera camera{cameraNode};
+  camera.setProjectionMatrix(
+      Mn::Matrix4::perspectiveProjection(60.0_degf, 1.0f, 0.1f, 100.0f));
+  camera.setViewport(size);
+
+  auto render = [&](bool instanced) {
+    framebuffer.clearDepth(1.0f)
+        .clearColor(0, Mn::Color4{})
+        .clearColor(1, Mn::Vector4ui{})
+        .bind();
+    if (instanced) {
+      InstancedDrawer drawer;
+      drawer.draw(camera, sceneGraph.getDrawables());
+    } else {
+      camera.draw(sceneGraph.getDrawables());
+    }
+    framebuffer.mapForRead(Mn::GL::Framebuffer::ColorAttachment{0});
+    Mn::Image2D colorImage =
+        framebuffer.read({{}, size}, {Mn::PixelFormat::RGBA8Unorm});
+    framebuffer.mapForRead(Mn::GL::Framebuffer::ColorAttachment{1});
+    Mn::Image2D objectIdImage =
+        framebuffer.read({{}, size}, {Mn::PixelFormat::R32UI});
+    return std::make_pair(std::move(colorImage), std::move(objectIdImage));
+  };
+
+  const auto expected = render(false);
+  const auto actual = render(true);
+  MAGNUM_VERIFY_NO_GL_ERROR();
+
+  const auto expectedColor = expected.first.pixels<Mn::Color4ub>();
+  const auto actualColor = actual.first.pixels<Mn::Color4ub>();
+  const auto expectedId = expected.second.pixels<Mn::UnsignedInt>();
+  const auto actualId = actual.second.pixels<Mn::UnsignedInt>();
+  int numCovered = 0;
+  for (int y = 0; y < size.y(); ++y) {
+    for (int x = 0; x < size.x(); ++x) {
+      CORRADE_COMPARE(actualColor[y][x], expectedColor[y][x]);
+      CORRADE_COMPARE(actualId[y][x], expectedId[y][x]);
+      numCovered += expectedId[y][x] != 0;
+    }
+  }
+  // the objects are actually in view
+  CORRADE_VERIFY(numCovered > 0);
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace gfx
+}  // namespace esp
+
+CORRADE_TEST_MAIN(esp::gfx::test::InstancedDrawerTest)
@@ -0,0 +1,254 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#include <Corrade/Containers/StridedArrayView.h>
+#include <Magnum/GL/Context.h>
+#include <Magnum/GL/Extensions.h>
+#include <Magnum/GL/Framebuffer.h>
+#include <Magnum/GL/Mesh.h>
+#include <Magnum/GL/OpenGLTester.h>
+#include <Magnum/GL/Renderbuffer.h>
+#include <Magnum/GL/Renderer.h>
+#include <Magnum/GL/RenderbufferFormat.h>
+#include <Magnum/GL/Texture.h>
+#include <Magnum/GL/TextureFormat.h>
+#include <Magnum/Image.h>
+#include <Magnum/ImageView.h>
+#include <Magnum/Math/Color.h>
+#include <Magnum/Math/Matrix4.h>
+#include <Magnum/MeshTools/Compile.h>
+#include <Magnum/PixelFormat.h>
+#include <Magnum/Primitives/Cube.h>
+#include <Magnum/Primitives/Icosphere.h>
+#include <Magnum/Primitives/Plane.h>
+#include <Magnum/Shaders/Flat.h>
+#include <Magnum/Trade/MeshData3D.h>
+
+#include "esp/gfx/GenericDrawable.h"
+#include "esp/gfx/MultiDrawBatch.h"
+#include "esp/scene/SceneGraph.h"
+
+namespace Cr = Corrade;
+namespace Mn = Magnum;
+
+namespace esp {
+namespace gfx {
+namespace test {
+namespace {
+
+struct MultiDrawBatchTest : Mn::GL::OpenGLTester {
+  explicit MultiDrawBatchTest();
+
+  void testMatchesDrawables();
+  void testTextures();
+
+  // draw sceneGraph through camera with batch, or one by one without, and
+  // compare against the other
+  void compareDraws(scene::SceneGraph& sceneGraph,
+                    MagnumCamera& camera,
+                    MultiDrawBatch& batch);
+
+  const Mn::Vector2i size_{64, 64};
+};
+
+using namespace Mn::Math::Literals;
+
+MultiDrawBatchTest::MultiDrawBatchTest() {
+  addTests({&MultiDrawBatchTest::testMatchesDrawables,
+            &MultiDrawBatchTest::testTextures});
+}
+
+void MultiDrawBatchTest::compareDraws(scene::SceneGraph& sceneGraph,
+                                      MagnumCamera& camera,
+                                      MultiDrawBatch& batch) {
+  Mn::GL::Renderbuffer color, objectId, depth;
+  color.setStorage(Mn::GL::RenderbufferFormat::RGBA8, size_);
+  objectId.setStorage(Mn::GL::RenderbufferFormat::R32UI, size_);
+  depth.setStorage(Mn::GL::RenderbufferFormat::DepthComponent24, size_);
+  Mn::GL::Framebuffer framebuffer{{{}, size_}};
+  framebuffer
+      .attachRenderbuffer(Mn::GL::Framebuffer::ColorAttachment{0}, color)
+      .attachRenderbuffer(Mn::GL::Framebuffer::ColorAttachment{1}, objectId)
+      .attachRenderbuffer(Mn::GL::Framebuffer::BufferAttachment::Depth, depth)
+      .mapForDraw({{Mn::Shaders::Flat3D::ColorOutput,
+                    Mn::GL::Framebuffer::ColorAttachment{0}},
+                   {Mn::Shaders::Flat3D::ObjectIdOutput,
+                    Mn::GL::Framebuffer::ColorAttachment{1}}});
+  CORRADE_COMPARE(framebuffer.checkStatus(Mn::GL::FramebufferTarget::Draw),
+                  Mn::GL::Framebuffer::Status::Complete);
+  Mn::GL::Renderer::enable(Mn::GL::Renderer::Feature::DepthTest);
+
+  auto render = [&](bool batched) {
+    framebuffer.clearDepth(1.0f)
+        .clearColor(0, Mn::Color4{})
+        .clearColor(1, Mn::Vector4ui{})
+        .bind();
+    if (batched) {
+      batch.draw(camera, sceneGraph.getDrawables());
+    } else {
+      camera.draw(sceneGraph.getDrawables());
+    }
+    framebuffer.mapForRead(Mn::GL::Framebuffer::ColorAttachment{0});
+    Mn::Image2D colorImage =
+        framebuffer.read({{}, size_}, {Mn::PixelFormat::RGBA8Unorm});
+    framebuffer.mapForRead(Mn::GL::Framebuffer::ColorAttachment{1});
+    Mn::Image2D objectIdImage =
+        framebuffer.read({{}, size_}, {Mn::PixelFormat::R32UI});
+    return std::make_pair(std::move(colorImage), std::move(objectIdImage));
+  };
+
+  const auto expected = render(false);
+  const auto actual = render(true);
+  MAGNUM_VERIFY_NO_GL_ERROR();
+
+  const auto expectedColor = expected.first.pixels<Mn::Color4ub>();
+  const auto actualColor = actual.first.pixels<Mn::Color4ub>();
+  const auto expectedId = expected.second.pixels<Mn::UnsignedInt>();
+  const auto actualId = actual.second.pixels<Mn::UnsignedInt>();
+  int numCovered = 0;
+  for (int y = 0; y < size_.y(); ++y) {
+    for (int x = 0; x < size_.x(); ++x) {
+      CORRADE_COMPARE(actualColor[y][x], expectedColor[y][x]);
+      CORRADE_COMPARE(actualId[y][x], expectedId[y][x]);
+      numCovered += expectedId[y][x] != 0;
+    }
+  }
+  // the objects are actually in view
+  CORRADE_VERIFY(numCovered > 0);
+}
+
+void MultiDrawBatchTest::testMatchesDrawables() {
+  if (!MultiDrawBatch::isSupported()) {
+    CORRADE_SKIP("GL 4.3 is not supported.");
+  }
+
+  Mn::Shaders::Flat3D shader{Mn::Shaders::Flat3D::Flag::ObjectId};
+  const Mn::Trade::MeshData3D cubeData = Mn::Primitives::cubeSolid();
+  const Mn::Trade::MeshData3D sphereData = Mn::Primitives::icosphereSolid(1);
+  Mn::GL::Mesh cube = Mn::MeshTools::compile(cubeData);
+  Mn::GL::Mesh sphere = Mn::MeshTools::compile(sphereData);
+
+  // a row of cubes in different colors and a sphere, packed into one batch,
+  // and a sphere without mesh data, which draws itself
+  scene::SceneGraph sceneGraph;
+  scene::SceneNode& root = sceneGraph.getRootNode();
+  for (int i = 0; i < 5; ++i) {
+    scene::SceneNode& node = root.createChild();
+    node.setId(i + 1);
+    node.translate({float(i) * 2.5f - 5.0f, 0.0f, 0.0f});
+    node.rotateY(Mn::Deg(15.0f * i));
+    auto* drawable = new GenericDrawable{
+        node,
+        shader,
+        cube,
+        &sceneGraph.getDrawables(),
+        nullptr,
+        ID_UNDEFINED,
+        Mn::Color4::fromHsv({Mn::Deg(60.0f * i), 1.0f, 1.0f})};
+    drawable->setMeshData(&cubeData);
+  }
+  for (int i = 0; i < 2; ++i) {
+    scene::SceneNode& sphereNode = root.createChild();
+    sphereNode.setId(10 + i);
+    sphereNode.translate({i * 4.0f - 2.0f, 2.5f, 0.0f});
+    auto* drawable = new GenericDrawable{sphereNode, shader, sphere,
+                                         &sceneGraph.getDrawables()};
+    if (i == 0) {
+      drawable->setMeshData(&sphereData);
+    }
+  }
+
+  scene::SceneNode& cameraNode = root.createChild();
+  cameraNode.translate({0.0f, 0.0f, 12.0f});
+  MagnumCamera camera{cameraNode};
+  camera.setProjectionMatrix(
+      Mn::Matrix4::perspectiveProjection(60.0_degf, 1.0f, 0.1f, 100.0f));
+  camera.setViewport(size_);
+
+  MultiDrawBatch batch;
+  compareDraws(sceneGraph, camera, batch);
+  // all untextured, so a single multi-draw
+  CORRADE_COMPARE(batch.getLastMultiDrawCount(), 1);
+  CORRADE_COMPARE(batch.getLastBatchedDrawableCount(), 6);
+  CORRADE_COMPARE(batch.getNumMeshes(), 2);
+}
+
+void MultiDrawBatchTest::testTextures() {
+  if (!MultiDrawBatch::isSupported()) {
+    CORRADE_SKIP("GL 4.3 is not supported.");
+  }
+
+  Mn::Shaders::Flat3D shader{Mn::Shaders::Flat3D::Flag::ObjectId |
+                             Mn::Shaders::Flat3D::Flag::Textured};
+  const Mn::Trade::MeshData3D planeData =
+      Mn::Primitives::planeSolid(Mn::Primitives::PlaneTextureCoords::Generate);
+  Mn::GL::Mesh plane = Mn::MeshTools::compile(planeData);
+
+  // two checkerboards of the same size and format, which share an array, and
+  // a smaller one, which gets one of its own
+  auto makeTexture = [](const Mn::Color4ub& a, const Mn::Color4ub& b,
+                        int size) {
+    std::vector<Mn::Color4ub> pixels(size * size);
+    for (int i = 0; i < size * size; ++i) {
+      pixels[i] = (i / size + i % size) % 2 ? a : b;
+    }
+    Mn::GL::Texture2D texture;
+    texture.setMagnificationFilter(Mn::GL::SamplerFilter::Nearest)
+        .setMinificationFilter(Mn::GL::SamplerFilter::Nearest,
+                               Mn::GL::SamplerMipmap::Base)
+        .setStorage(1, Mn::GL::TextureFormat::RGBA8, {size, size})
+        .setSubImage(0, {},
+                     Mn::ImageView2D{Mn::PixelFormat::RGBA8Unorm,
+                                     {size, size},
+                                     Cr::Containers::arrayView(pixels)});
+    return texture;
+  };
+  Mn::GL::Texture2D textures[]{
+      makeTexture(0xff0000ff_rgba, 0x00ff00ff_rgba, 4),
+      makeTexture(0x0000ffff_rgba, 0xffffffff_rgba, 4),
+      makeTexture(0xffff00ff_rgba, 0x000000ff_rgba, 2)};
+
+  scene::SceneGraph sceneGraph;
+  scene::SceneNode& root = sceneGraph.getRootNode();
+  for (int i = 0; i < 3; ++i) {
+    scene::SceneNode& node = root.createChild();
+    node.setId(i + 1);
+    node.translate({float(i) * 2.5f - 2.5f, 0.0f, 0.0f});
+    auto* drawable = new GenericDrawable{
+        node, shader, plane, &sceneGraph.getDrawables(), &textures[i]};
+    drawable->setMeshData(&planeData);
+  }
+
+  scene::SceneNode& cameraNode = root.createChild();
+  cameraNode.translate({0.0f, 0.0f, 6.0f});
+  MagnumCamera camera{cameraNode};
+  camera.setProjectionMatrix(
+      Mn::Matrix4::perspectiveProjection(60.0_degf, 1.0f, 0.1f, 100.0f));
+  camera.setViewport(size_);
+
+  MultiDrawBatch arrayBatch;
+  arrayBatch.setBindlessTextures(false);
+  compareDraws(sceneGraph, camera, arrayBatch);
+  CORRADE_COMPARE(arrayBatch.getLastBatchedDrawableCount(), 3);
+  CORRADE_COMPARE(arrayBatch.getNumTextureArrays(), 2);
+  CORRADE_COMPARE(arrayBatch.getLastMultiDrawCount(), 2);
+
+  if (!Mn::GL::Context::current()
+           .isExtensionSupported<Mn::GL::Extensions::ARB::bindless_texture>()) {
+    CORRADE_SKIP("ARB_bindless_texture is not supported.");
+  }
+  MultiDrawBatch bindlessBatch;
+  compareDraws(sceneGraph, camera, bindlessBatch);
+  CORRADE_COMPARE(bindlessBatch.getNumTextureArrays(), 0);
+  CORRADE_COMPARE(bindlessBatch.getLastMultiDrawCount(), 1);
+  // made resident, the textures are freed with their handles
+  bindlessBatch.clear();
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace gfx
+}  // namespace esp
+
+CORRADE_TEST_MAIN(esp::gfx::test::MultiDrawBatchTest)
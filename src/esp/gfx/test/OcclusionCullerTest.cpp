@@ -0,0 +1,106 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#include <Magnum/GL/Framebuffer.h>
+#include <Magnum/GL/Mesh.h>
+#include <Magnum/GL/OpenGLTester.h>
+#include <Magnum/GL/Renderbuffer.h>
+#include <Magnum/GL/RenderbufferFormat.h>
+#include <Magnum/GL/Renderer.h>
+#include <Magnum/Math/Matrix4.h>
+#include <Magnum/MeshTools/Compile.h>
+#include <Magnum/Primitives/Cube.h>
+#include <Magnum/Shaders/Flat.h>
+
+#include "esp/gfx/GenericDrawable.h"
+#include "esp/gfx/OcclusionCuller.h"
+#include "esp/scene/SceneGraph.h"
+
+namespace Mn = Magnum;
+
+namespace esp {
+namespace gfx {
+namespace test {
+namespace {
+
+struct OcclusionCullerTest : Mn::GL::OpenGLTester {
+  explicit OcclusionCullerTest();
+
+  void testCullsHidden();
+};
+
+using namespace Mn::Math::Literals;
+
+OcclusionCullerTest::OcclusionCullerTest() {
+  addTests({&OcclusionCullerTest::testCullsHidden});
+}
+
+void OcclusionCullerTest::testCullsHidden() {
+  if (!OcclusionCuller::isSupported()) {
+    CORRADE_SKIP("Occlusion culling is not supported.");
+  }
+
+  const Mn::Vector2i size{128, 128};
+  Mn::GL::Renderbuffer depth;
+  depth.setStorage(Mn::GL::RenderbufferFormat::DepthComponent24, size);
+  Mn::GL::Framebuffer framebuffer{{{}, size}};
+  framebuffer.attachRenderbuffer(
+      Mn::GL::Framebuffer::BufferAttachment::Depth, depth);
+  Mn::GL::Renderer::enable(Mn::GL::Renderer::Feature::DepthTest);
+
+  Mn::Shaders::Flat3D shader{Mn::Shaders::Flat3D::Flag::ObjectId};
+  Mn::GL::Mesh cube = Mn::MeshTools::compile(Mn::Primitives::cubeSolid());
+
+  // a wall filling the left half of the view, a box behind it, one behind
+  // it but peeking out on the right and one in front of it
+  scene::SceneGraph sceneGraph;
+  scene::SceneNode& root = sceneGraph.getRootNode();
+  auto addBox = [&](const Mn::Vector3& translation, const Mn::Vector3& scaling,
+                    int id) {
+    scene::SceneNode& node = root.createChild();
+    node.setId(id);
+    node.translate(translation);
+    node.scale(scaling);
+    auto* drawable =
+        new GenericDrawable{node, shader, cube, &sceneGraph.getDrawables()};
+    drawable->setLocalBoundingBox({Mn::Vector3{-1.0f}, Mn::Vector3{1.0f}});
+  };
+  addBox({-5.0f, 0.0f, 0.0f}, {5.0f, 5.0f, 0.1f}, 1);
+  addBox({-3.0f, 0.0f, -4.0f}, Mn::Vector3{0.5f}, 2);
+  addBox({0.0f, 0.0f, -4.0f}, Mn::Vector3{0.5f}, 3);
+  addBox({-3.0f, 0.0f, 2.0f}, Mn::Vector3{0.5f}, 4);
+
+  scene::SceneNode& cameraNode = root.createChild();
+  cameraNode.translate({0.0f, 0.0f, 8.0f});
+  MagnumCamera camera{cameraNode};
+  camera.setProjectionMatrix(
+      Mn::Matrix4::perspectiveProjection(60.0_degf, 1.0f, 0.1f, 100.0f));
+  camera.setViewport(size);
+
+  framebuffer.setViewport({{8, 8}, {64, 64}}).bind();
+  MagnumDrawableTransformations transformations =
+      camera.drawableTransformations(sceneGraph.getDrawables());
+  OcclusionCuller culler;
+  CORRADE_COMPARE(culler.cull(camera, transformations), 1);
+  MAGNUM_VERIFY_NO_GL_ERROR();
+  // only the wall is large enough to occlude
+  CORRADE_COMPARE(culler.getLastOccluderCount(), 1);
+  std::vector<int> ids;
+  for (const auto& transformation : transformations) {
+    ids.push_back(static_cast<Drawable&>(transformation.first.get())
+                      .getSceneNode()
+                      .getId());
+  }
+  CORRADE_COMPARE(ids, (std::vector<int>{1, 3, 4}));
+  // the bound framebuffer and its viewport are left alone
+  CORRADE_COMPARE(framebuffer.viewport(),
+                  (Mn::Range2Di{{8, 8}, {64, 64}}));
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace gfx
+}  // namespace esp
+
+CORRADE_TEST_MAIN(esp::gfx::test::OcclusionCullerTest)
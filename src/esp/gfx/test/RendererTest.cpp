@@ -0,0 +1,225 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <Magnum/GL/Mesh.h>
+#include <Magnum/GL/OpenGLTester.h>
+#include <Magnum/GL/Renderer.h>
+#include <Magnum/Math/Color.h>
+#include <Magnum/MeshTools/Compile.h>
+#include <Magnum/Primitives/Cube.h>
+#include <Magnum/Shaders/Flat.h>
+#include <Magnum/Trade/MeshData3D.h>
+
+#include "esp/gfx/GenericDrawable.h"
+#include "esp/gfx/Renderer.h"
+#include "esp/scene/SceneGraph.h"
+#include "esp/sensor/PinholeCamera.h"
+
+namespace Cr = Corrade;
+namespace Mn = Magnum;
+
+namespace esp {
+namespace gfx {
+namespace test {
+namespace {
+
+struct RendererTest : Mn::GL::OpenGLTester {
+  explicit RendererTest();
+
+  void testDrawBatchMatchesDraw();
+  void testAsyncReadbackRing();
+};
+
+RendererTest::RendererTest() {
+  addTests({&RendererTest::testDrawBatchMatchesDraw,
+            &RendererTest::testAsyncReadbackRing});
+}
+
+// a row of cubes of different colors and object ids around the origin
+void addCubes(scene::SceneGraph& sceneGraph,
+              Mn::Shaders::Flat3D& shader,
+              Mn::GL::Mesh& cube,
+              float rotation) {
+  for (int i = 0; i < 5; ++i) {
+    scene::SceneNode& node = sceneGraph.getRootNode().createChild();
+    node.translate({float(i) * 2.5f - 5.0f, 0.0f, float(i % 2) * -2.0f});
+    node.rotateY(Mn::Deg(rotation + 15.0f * i));
+    new GenericDrawable{node,
+                        shader,
+                        cube,
+                        &sceneGraph.getDrawables(),
+                        nullptr,
+                        i + 1,
+                        Mn::Color4::fromHsv({Mn::Deg(60.0f * i), 1.0f, 1.0f})};
+  }
+}
+
+sensor::SensorSpec::ptr sensorSpec(const std::string& uuid,
+                                   sensor::SensorType type,
+                                   int width,
+                                   int height,
+                                   const vec3f& position) {
+  sensor::SensorSpec::ptr spec = sensor::SensorSpec::create();
+  spec->uuid = uuid;
+  spec->sensorType = type;
+  spec->resolution = {height, width};
+  spec->position = position;
+  spec->parameters["hfov"] = "60";
+  return spec;
+}
+
+std::vector<char> framePixels(sensor::Sensor& visualSensor) {
+  const sensor::SensorSpec& spec = *visualSensor.specification();
+  return std::vector<char>(spec.resolution[0] * spec.resolution[1] *
+                           getFrameFormatPixelBytes(getFrameFormat(spec)));
+}
+
+void RendererTest::testDrawBatchMatchesDraw() {
+  Mn::Shaders::Flat3D shader{Mn::Shaders::Flat3D::Flag::ObjectId};
+  Mn::GL::Mesh cube = Mn::MeshTools::compile(Mn::Primitives::cubeSolid());
+  scene::SceneGraph first, second;
+  addCubes(first, shader, cube, 0.0f);
+  addCubes(second, shader, cube, 45.0f);
+
+  // RGB, depth and semantic sensors of different resolutions; the RGB and
+  // semantic sensors of the first scene share their pose and size, and so a
+  // tile, the others get tiles of their own
+  const vec3f front{0.0f, 0.0f, 12.0f};
+  const vec3f side{3.0f, 1.0f, 10.0f};
+  std::vector<sensor::SensorSpec::ptr> specs{
+      sensorSpec("rgb", sensor::SensorType::COLOR, 64, 48, front),
+      sensorSpec("semantic", sensor::SensorType::SEMANTIC, 64, 48, front),
+      sensorSpec("depth", sensor::SensorType::DEPTH, 32, 32, front),
+      sensorSpec("rgb", sensor::SensorType::COLOR, 40, 56, side),
+      sensorSpec("depth", sensor::SensorType::DEPTH, 40, 56, side),
+      sensorSpec("semantic", sensor::SensorType::SEMANTIC, 24, 16, front)};
+  std::vector<scene::SceneGraph*> sceneGraphs{&first,  &first,  &first,
+                                              &second, &second, &second};
+  std::vector<sensor::PinholeCamera::ptr> sensors;
+  std::vector<sensor::Sensor*> visualSensors;
+  for (int i = 0; i < specs.size(); ++i) {
+    scene::SceneNode& node = sceneGraphs[i]->getRootNode().createChild();
+    sensors.push_back(sensor::PinholeCamera::create(node, specs[i]));
+    visualSensors.push_back(sensors.back().get());
+  }
+
+  Renderer::ptr renderer = Renderer::create(64, 64);
+  std::vector<std::vector<char>> expected;
+  for (int i = 0; i < sensors.size(); ++i) {
+    const sensor::SensorSpec& spec = *specs[i];
+    renderer->setSize(spec.resolution[1], spec.resolution[0]);
+    renderer->draw(*sensors[i], *sceneGraphs[i]);
+    expected.push_back(framePixels(*sensors[i]));
+    renderer->readFrame(getFrameFormat(spec), expected.back().data());
+  }
+  MAGNUM_VERIFY_NO_GL_ERROR();
+
+  // twice, the second time into the framebuffer of the first
+  for (int iBatch = 0; iBatch < 2; ++iBatch) {
+    renderer->drawBatch(visualSensors, sceneGraphs);
+    for (int i = 0; i < sensors.size(); ++i) {
+      const FrameFormat format = getFrameFormat(*specs[i]);
+      std::vector<char> actual = framePixels(*sensors[i]);
+      renderer->readBatchFrame(i, format, actual.data());
+      CORRADE_VERIFY(actual == expected[i]);
+      // the asynchronous readback of the tile reads the same
+      std::fill(actual.begin(), actual.end(), 0);
+      const int ticket = renderer->readBatchFrameAsync(i, format);
+      CORRADE_VERIFY(renderer->waitFrame(ticket, actual.data()));
+      CORRADE_VERIFY(actual == expected[i]);
+    }
+    MAGNUM_VERIFY_NO_GL_ERROR();
+  }
+
+  // the scenes are actually in view of every sensor
+  for (int i = 0; i < expected.size(); ++i) {
+    CORRADE_VERIFY(std::any_of(expected[i].begin(), expected[i].end(),
+                               [](char c) { return c != 0; }));
+  }
+}
+
+void RendererTest::testAsyncReadbackRing() {
+  Mn::Shaders::Flat3D shader{Mn::Shaders::Flat3D::Flag::ObjectId};
+  Mn::GL::Mesh cube = Mn::MeshTools::compile(Mn::Primitives::cubeSolid());
+  scene::SceneGraph sceneGraph;
+  addCubes(sceneGraph, shader, cube, 0.0f);
+
+  // frames from sensors along the row of cubes, which all differ
+  const int numFrames = 7;
+  std::vector<sensor::PinholeCamera::ptr> sensors;
+  for (int i = 0; i < numFrames; ++i) {
+    scene::SceneNode& node = sceneGraph.getRootNode().createChild();
+    sensors.push_back(sensor::PinholeCamera::create(
+        node, sensorSpec("rgb", sensor::SensorType::COLOR, 32, 32,
+                         {float(i) - 3.0f, 0.0f, 8.0f})));
+  }
+  Renderer::ptr renderer = Renderer::create(32, 32);
+  std::vector<std::vector<char>> expected;
+  for (int i = 0; i < numFrames; ++i) {
+    renderer->draw(*sensors[i], sceneGraph);
+    expected.push_back(framePixels(*sensors[i]));
+    renderer->readFrame(FrameFormat::Rgba8, expected.back().data());
+  }
+  for (int i = 1; i < numFrames; ++i) {
+    CORRADE_VERIFY(expected[i] != expected[i - 1]);
+  }
+
+  // draw and queue every frame; the ring wraps around, so only the last
+  // ring size frames are still in flight, and each of them is the frame it
+  // was queued for
+  auto queueFrames = [&](int count) {
+    std::vector<int> tickets;
+    for (int i = 0; i < count; ++i) {
+      renderer->draw(*sensors[i], sceneGraph);
+      tickets.push_back(renderer->readFrameRgbaAsync());
+    }
+    return tickets;
+  };
+  auto checkFrames = [&](const std::vector<int>& tickets, int ringSize) {
+    std::vector<char> actual = framePixels(*sensors[0]);
+    for (int i = 0; i < tickets.size(); ++i) {
+      const bool inFlight = i >= int(tickets.size()) - ringSize;
+      CORRADE_COMPARE(renderer->waitFrame(tickets[i], actual.data()),
+                      inFlight);
+      if (inFlight) {
+        CORRADE_VERIFY(actual == expected[i]);
+      }
+    }
+  };
+
+  renderer->setAsyncReadbackFrames(3);
+  CORRADE_COMPARE(renderer->getAsyncReadbackFrames(), 3);
+  std::vector<int> tickets = queueFrames(numFrames);
+  // waiting for the newest first does not disturb the older ones
+  std::vector<char> newest = framePixels(*sensors[0]);
+  CORRADE_VERIFY(renderer->waitFrame(tickets.back(), newest.data()));
+  CORRADE_VERIFY(newest == expected.back());
+  CORRADE_VERIFY(!renderer->waitFrame(tickets.back(), newest.data()));
+  tickets.pop_back();
+  checkFrames(tickets, 2);
+
+  // a resized ring drops the frames in flight, and then holds the new size
+  tickets = queueFrames(3);
+  renderer->setAsyncReadbackFrames(5);
+  CORRADE_COMPARE(renderer->getAsyncReadbackFrames(), 5);
+  for (int ticket : tickets) {
+    CORRADE_VERIFY(!renderer->isFrameReady(ticket));
+    CORRADE_VERIFY(!renderer->waitFrame(ticket, newest.data()));
+  }
+  checkFrames(queueFrames(numFrames), 5);
+  renderer->setAsyncReadbackFrames(1);
+  checkFrames(queueFrames(numFrames), 1);
+  MAGNUM_VERIFY_NO_GL_ERROR();
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace gfx
+}  // namespace esp
+
+CORRADE_TEST_MAIN(esp::gfx::test::RendererTest)
@@ -0,0 +1,79 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#include <Corrade/TestSuite/Tester.h>
+
+#include "esp/gfx/SensorNoise.h"
+#include "esp/sensor/Sensor.h"
+
+namespace Cr = Corrade;
+
+namespace esp {
+namespace gfx {
+namespace test {
+namespace {
+
+// parsing of the specs only, no GPU needed
+struct SensorNoiseTest : Cr::TestSuite::Tester {
+  explicit SensorNoiseTest();
+
+  void testNoModel();
+  void testColorModel();
+  void testDepthModel();
+  void testMismatchedModel();
+};
+
+SensorNoiseTest::SensorNoiseTest() {
+  addTests({&SensorNoiseTest::testNoModel, &SensorNoiseTest::testColorModel,
+            &SensorNoiseTest::testDepthModel,
+            &SensorNoiseTest::testMismatchedModel});
+}
+
+void SensorNoiseTest::testNoModel() {
+  sensor::SensorSpec spec;
+  CORRADE_VERIFY(getSensorNoiseModel(spec).type == SensorNoiseType::None);
+  spec.parameters["noise_model"] = "blur";
+  CORRADE_VERIFY(getSensorNoiseModel(spec).type == SensorNoiseType::None);
+}
+
+void SensorNoiseTest::testColorModel() {
+  sensor::SensorSpec spec;
+  spec.sensorType = sensor::SensorType::COLOR;
+  spec.parameters["noise_model"] = "salt_and_pepper";
+  spec.parameters["noise_amount"] = "0.25";
+  spec.parameters["noise_seed"] = "7";
+  const SensorNoiseModel model = getSensorNoiseModel(spec);
+  CORRADE_VERIFY(model.type == SensorNoiseType::SaltAndPepper);
+  CORRADE_VERIFY(!model.isDepth());
+  CORRADE_COMPARE(model.amount, 0.25f);
+  CORRADE_COMPARE(model.saltRatio, 0.5f);
+  CORRADE_COMPARE(model.seed, 7u);
+}
+
+void SensorNoiseTest::testDepthModel() {
+  sensor::SensorSpec spec;
+  spec.sensorType = sensor::SensorType::DEPTH;
+  spec.parameters["noise_model"] = "redwood";
+  spec.parameters["noise_multiplier"] = "2";
+  const SensorNoiseModel model = getSensorNoiseModel(spec);
+  CORRADE_VERIFY(model.isDepth());
+  CORRADE_COMPARE(model.multiplier, 2.0f);
+}
+
+void SensorNoiseTest::testMismatchedModel() {
+  sensor::SensorSpec spec;
+  spec.sensorType = sensor::SensorType::DEPTH;
+  spec.parameters["noise_model"] = "gaussian";
+  CORRADE_VERIFY(getSensorNoiseModel(spec).type == SensorNoiseType::None);
+  spec.sensorType = sensor::SensorType::SEMANTIC;
+  spec.parameters["noise_model"] = "redwood";
+  CORRADE_VERIFY(getSensorNoiseModel(spec).type == SensorNoiseType::None);
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace gfx
+}  // namespace esp
+
+CORRADE_TEST_MAIN(esp::gfx::test::SensorNoiseTest)
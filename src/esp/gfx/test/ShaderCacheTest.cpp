@@ -0,0 +1,111 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#include <Corrade/Utility/Directory.h>
+#include <Magnum/GL/AbstractShaderProgram.h>
+#include <Magnum/GL/OpenGL.h>
+#include <Magnum/GL/OpenGLTester.h>
+
+#include "esp/gfx/DepthUnprojection.h"
+#include "esp/gfx/ShaderCache.h"
+
+namespace Cr = Corrade;
+namespace Mn = Magnum;
+
+namespace esp {
+namespace gfx {
+namespace test {
+namespace {
+
+struct ShaderCacheTest : Mn::GL::OpenGLTester {
+  explicit ShaderCacheTest();
+
+  void testSharedProgram();
+  void testShaderVariant();
+  void testProgramBinary();
+};
+
+// a program without shaders, to link from a binary only
+struct EmptyProgram : Mn::GL::AbstractShaderProgram {};
+
+ShaderCacheTest::ShaderCacheTest() {
+  addTests({&ShaderCacheTest::testSharedProgram,
+            &ShaderCacheTest::testShaderVariant,
+            &ShaderCacheTest::testProgramBinary});
+}
+
+void ShaderCacheTest::testSharedProgram() {
+  int created = 0;
+  auto create = [&created]() {
+    ++created;
+    return std::make_shared<DepthShader>();
+  };
+
+  std::shared_ptr<MagnumShaderProgram> a =
+      getSharedShaderProgram("depth", create);
+  std::shared_ptr<MagnumShaderProgram> b =
+      getSharedShaderProgram("depth", create);
+  CORRADE_COMPARE(a, b);
+  CORRADE_COMPARE(created, 1);
+
+  // the cache does not keep released programs
+  a = nullptr;
+  b = nullptr;
+  b = getSharedShaderProgram("depth", create);
+  CORRADE_COMPARE(created, 2);
+}
+
+void ShaderCacheTest::testShaderVariant() {
+  std::shared_ptr<DepthShader> a = getShaderVariant<DepthShader>("depth", {});
+  std::shared_ptr<DepthShader> b = getShaderVariant<DepthShader>("depth", {});
+  CORRADE_COMPARE(a, b);
+
+  // each combination of flags is a program of its own
+  std::shared_ptr<DepthShader> unprojecting = getShaderVariant<DepthShader>(
+      "depth", DepthShader::Flag::UnprojectExistingDepth);
+  CORRADE_VERIFY(unprojecting != a);
+  CORRADE_COMPARE(getShaderVariant<DepthShader>(
+                      "depth", DepthShader::Flag::UnprojectExistingDepth),
+                  unprojecting);
+}
+
+void ShaderCacheTest::testProgramBinary() {
+  GLint numFormats = 0;
+  glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+  if (numFormats == 0) {
+    CORRADE_SKIP("The driver has no program binary formats");
+  }
+
+  const std::string dir =
+      Cr::Utility::Directory::join(Cr::Utility::Directory::tmp(),
+                                   "ShaderCacheTest");
+  CORRADE_VERIFY(Cr::Utility::Directory::mkpath(dir));
+  setProgramBinaryCacheDir(dir);
+
+  const std::string key = programBinaryKey("test", {"void main() {}"});
+  CORRADE_COMPARE(key, programBinaryKey("test", {"void main() {}"}));
+  CORRADE_VERIFY(key != programBinaryKey("test", {"void main() { }"}));
+
+  // nothing cached yet
+  EmptyProgram empty;
+  CORRADE_VERIFY(!loadProgramBinary(empty, key));
+
+  // a linked program saved under the key loads into another program
+  DepthShader depth;
+  saveProgramBinary(depth, key);
+  EmptyProgram loaded;
+  CORRADE_VERIFY(loadProgramBinary(loaded, key));
+
+  setProgramBinaryCacheDir("");
+  CORRADE_VERIFY(!loadProgramBinary(loaded, key));
+  Cr::Utility::Directory::rm(
+      Cr::Utility::Directory::join(dir, key + ".glprogram"));
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace gfx
+}  // namespace esp
+
+CORRADE_TEST_MAIN(esp::gfx::test::ShaderCacheTest)
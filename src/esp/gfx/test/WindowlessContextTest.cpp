@@ -0,0 +1,81 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#include <thread>
+#include <vector>
+
+#include <Corrade/Containers/Array.h>
+#include <Corrade/TestSuite/Compare/Container.h>
+#include <Corrade/TestSuite/Tester.h>
+#include <Magnum/GL/Buffer.h>
+#include <Magnum/GL/Context.h>
+#include <Magnum/GL/Renderer.h>
+
+#include "esp/gfx/WindowlessContext.h"
+
+namespace Cr = Corrade;
+namespace Mn = Magnum;
+
+namespace esp {
+namespace gfx {
+namespace test {
+namespace {
+
+struct WindowlessContextTest : Cr::TestSuite::Tester {
+  explicit WindowlessContextTest();
+
+  void testSharedContexts();
+};
+
+WindowlessContextTest::WindowlessContextTest() {
+  addTests({&WindowlessContextTest::testSharedContexts});
+}
+
+void WindowlessContextTest::testSharedContexts() {
+#ifndef ESP_BUILD_EGL_SUPPORT
+  CORRADE_SKIP("Shared contexts need EGL");
+#else
+  WindowlessContext context{0, true};
+  CORRADE_VERIFY(context.isShareable());
+  Mn::GL::Context* magnumContext = &Mn::GL::Context::current();
+
+  const std::vector<Mn::UnsignedInt> data{3, 1, 4, 1, 5, 9};
+  Mn::GL::Buffer buffer;
+  buffer.setData(data);
+  Mn::GL::Renderer::finish();
+  const Mn::GLuint id = buffer.id();
+
+  // every thread reads the buffer with its own context
+  std::vector<std::vector<Mn::UnsignedInt>> read(2);
+  std::vector<char> otherContext(read.size(), false);
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < read.size(); ++i) {
+    threads.emplace_back([&, i]() {
+      WindowlessContext shared{context};
+      otherContext[i] = &Mn::GL::Context::current() != magnumContext;
+      Mn::GL::Buffer wrapped = Mn::GL::Buffer::wrap(id);
+      Cr::Containers::Array<Mn::UnsignedInt> contents =
+          wrapped.data<Mn::UnsignedInt>();
+      read[i].assign(contents.begin(), contents.end());
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  for (size_t i = 0; i < read.size(); ++i) {
+    CORRADE_VERIFY(otherContext[i]);
+    CORRADE_COMPARE_AS(read[i], data, Cr::TestSuite::Compare::Container);
+  }
+  // still current on this thread
+  CORRADE_VERIFY(&Mn::GL::Context::current() == magnumContext);
+#endif
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace gfx
+}  // namespace esp
+
+CORRADE_TEST_MAIN(esp::gfx::test::WindowlessContextTest)
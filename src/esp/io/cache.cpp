@@ -0,0 +1,335 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#include "cache.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <random>
+#include <sstream>
+
+#ifdef _WIN32
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <iterator>
+#else
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "esp/core/esp.h"
+#include "esp/io/io.h"
+
+namespace esp {
+namespace io {
+
+namespace {
+// changed with the layout of the header, so that older caches are rejected
+const char cacheMagic[8] = {'E', 'S', 'P', 'C', 'A', 'C', 'H', '2'};
+const uint64_t sectionAlignment = 16;
+
+struct CacheHeader {
+  char magic[8];
+  uint32_t kind;
+  uint32_t version;
+  uint64_t sourceSize;
+  int64_t sourceMtime;
+  uint32_t sourceCrc;
+  uint32_t padding;
+  uint64_t numSections;
+};
+
+struct CacheSection {
+  uint64_t offset;
+  uint64_t size;
+};
+
+uint64_t alignSection(uint64_t offset) {
+  return (offset + sectionAlignment - 1) / sectionAlignment * sectionAlignment;
+}
+
+struct SharedCacheDir {
+  std::mutex mutex;
+  std::string dir;
+};
+
+SharedCacheDir& sharedCacheDir() {
+  static SharedCacheDir shared;
+  return shared;
+}
+}  // namespace
+
+MappedFile::MappedFile(const std::string& file, bool copyOnWrite)
+    : copyOnWrite_(copyOnWrite) {
+#ifdef _WIN32
+  std::ifstream ifs(file, std::ios::binary);
+  if (!ifs.good()) {
+    return;
+  }
+  buffer_.assign(std::istreambuf_iterator<char>(ifs),
+                 std::istreambuf_iterator<char>());
+  if (!buffer_.empty()) {
+    data_ = buffer_.data();
+    size_ = buffer_.size();
+  }
+#else
+  const int fd = open(file.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return;
+  }
+  struct stat fileStat;
+  if (fstat(fd, &fileStat) == 0 && fileStat.st_size > 0) {
+    const int protection = copyOnWrite ? PROT_READ | PROT_WRITE : PROT_READ;
+    void* mapping =
+        mmap(nullptr, fileStat.st_size, protection, MAP_PRIVATE, fd, 0);
+    if (mapping != MAP_FAILED) {
+      data_ = static_cast<char*>(mapping);
+      size_ = fileStat.st_size;
+    }
+  }
+  // the mapping stays valid after closing the descriptor
+  close(fd);
+#endif
+}
+
+MappedFile::~MappedFile() {
+#ifndef _WIN32
+  if (data_ != nullptr) {
+    munmap(data_, size_);
+  }
+#endif
+}
+
+uint32_t crc32(const void* data, size_t sizeInBytes, uint32_t crc) {
+  static const std::vector<uint32_t> table = []() {
+    std::vector<uint32_t> table(256);
+    for (uint32_t i = 0; i < table.size(); ++i) {
+      uint32_t c = i;
+      for (int k = 0; k < 8; ++k) {
+        c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+      }
+      table[i] = c;
+    }
+    return table;
+  }();
+
+  const unsigned char* bytes = static_cast<const unsigned char*>(data);
+  crc = ~crc;
+  for (size_t i = 0; i < sizeInBytes; ++i) {
+    crc = table[(crc ^ bytes[i]) & 0xff] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+SourceStamp getSourceStamp(const std::string& file, bool withCrc) {
+  SourceStamp stamp;
+  struct stat fileStat;
+  if (stat(file.c_str(), &fileStat) != 0) {
+    return stamp;
+  }
+  stamp.size = fileStat.st_size;
+#if defined(_WIN32)
+  stamp.mtime = int64_t(fileStat.st_mtime) * 1000000000;
+#elif defined(__APPLE__)
+  stamp.mtime = int64_t(fileStat.st_mtimespec.tv_sec) * 1000000000 +
+                fileStat.st_mtimespec.tv_nsec;
+#else
+  stamp.mtime =
+      int64_t(fileStat.st_mtim.tv_sec) * 1000000000 + fileStat.st_mtim.tv_nsec;
+#endif
+  if (withCrc) {
+    std::ifstream ifs(file, std::ios::binary);
+    std::vector<char> buffer(1 << 20);
+    while (ifs.read(buffer.data(), buffer.size()) || ifs.gcount() > 0) {
+      stamp.crc = crc32(buffer.data(), ifs.gcount(), stamp.crc);
+    }
+  }
+  return stamp;
+}
+
+std::string cacheFilename(const std::string& source) {
+  const std::string localFile = source + ".cache";
+  const std::string dir = getSharedCacheDir();
+  // caches shipped with the assets are mapped from where they are
+  if (dir.empty() || exists(localFile)) {
+    return localFile;
+  }
+  const std::string path = absolutePath(source);
+  const size_t slash = path.find_last_of('/');
+  const std::string name =
+      slash == std::string::npos ? path : path.substr(slash + 1);
+  std::ostringstream file;
+  file << dir << "/" << name << "-" << std::hex << std::setw(8)
+       << std::setfill('0') << crc32(path.data(), path.size()) << ".cache";
+  return file.str();
+}
+
+void setSharedCacheDir(const std::string& dir) {
+#ifndef _WIN32
+  if (!dir.empty() && mkdir(dir.c_str(), 0777) != 0 && errno != EEXIST) {
+    LOG(ERROR) << "Cannot create shared cache directory " << dir;
+    return;
+  }
+#endif
+  SharedCacheDir& shared = sharedCacheDir();
+  std::lock_guard<std::mutex> lock(shared.mutex);
+  shared.dir = dir;
+}
+
+std::string getSharedCacheDir() {
+  SharedCacheDir& shared = sharedCacheDir();
+  std::lock_guard<std::mutex> lock(shared.mutex);
+  return shared.dir;
+}
+
+CacheLock::CacheLock(const std::string& cacheFile) {
+#ifndef _WIN32
+  if (getSharedCacheDir().empty()) {
+    return;
+  }
+  fd_ = open((cacheFile + ".lock").c_str(), O_RDWR | O_CREAT, 0666);
+  if (fd_ >= 0 && flock(fd_, LOCK_EX) != 0) {
+    close(fd_);
+    fd_ = -1;
+  }
+#endif
+}
+
+CacheLock::~CacheLock() {
+#ifndef _WIN32
+  // closing the descriptor releases the lock
+  if (fd_ >= 0) {
+    close(fd_);
+  }
+#endif
+}
+
+CacheWriter::CacheWriter(uint32_t kind,
+                         uint32_t version,
+                         const std::string& sourceFile)
+    : kind_(kind), version_(version) {
+  if (!sourceFile.empty()) {
+    source_ = getSourceStamp(sourceFile, true);
+  }
+}
+
+void CacheWriter::addSection(const void* data, size_t sizeInBytes) {
+  sections_.emplace_back(data, sizeInBytes);
+}
+
+bool CacheWriter::write(const std::string& file) const {
+  const std::string tmpFile =
+      file + "." + std::to_string(std::random_device{}()) + ".tmp";
+  std::ofstream ofs(tmpFile, std::ios::binary | std::ios::trunc);
+  if (!ofs.good()) {
+    return false;
+  }
+
+  CacheHeader header;
+  std::memcpy(header.magic, cacheMagic, sizeof(cacheMagic));
+  header.kind = kind_;
+  header.version = version_;
+  header.sourceSize = source_.size;
+  header.sourceMtime = source_.mtime;
+  header.sourceCrc = source_.crc;
+  header.padding = 0;
+  header.numSections = sections_.size();
+
+  std::vector<CacheSection> table(sections_.size());
+  uint64_t offset = sizeof(CacheHeader) + table.size() * sizeof(CacheSection);
+  for (size_t i = 0; i < sections_.size(); ++i) {
+    offset = alignSection(offset);
+    table[i].offset = offset;
+    table[i].size = sections_[i].second;
+    offset += sections_[i].second;
+  }
+
+  ofs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  ofs.write(reinterpret_cast<const char*>(table.data()),
+            table.size() * sizeof(CacheSection));
+  uint64_t written = sizeof(CacheHeader) + table.size() * sizeof(CacheSection);
+  const char padding[sectionAlignment] = {};
+  for (size_t i = 0; i < sections_.size(); ++i) {
+    ofs.write(padding, table[i].offset - written);
+    ofs.write(static_cast<const char*>(sections_[i].first), table[i].size);
+    written = table[i].offset + table[i].size;
+  }
+  ofs.close();
+#ifdef _WIN32
+  // rename does not replace existing files there
+  std::remove(file.c_str());
+#endif
+  if (!ofs.good() || std::rename(tmpFile.c_str(), file.c_str()) != 0) {
+    std::remove(tmpFile.c_str());
+    return false;
+  }
+  return true;
+}
+
+CacheReader::CacheReader(const std::string& file,
+                         uint32_t kind,
+                         uint32_t version,
+                         const std::string& sourceFile)
+    : file_(file) {
+  if (!file_.isValid() || file_.size() < sizeof(CacheHeader)) {
+    return;
+  }
+  CacheHeader header;
+  std::memcpy(&header, file_.data(), sizeof(header));
+  if (std::memcmp(header.magic, cacheMagic, sizeof(cacheMagic)) != 0 ||
+      header.kind != kind || header.version != version) {
+    return;
+  }
+  if (!sourceFile.empty()) {
+    const SourceStamp source = getSourceStamp(sourceFile, false);
+    if (source.size != header.sourceSize) {
+      return;
+    }
+    // the same time is taken for the same contents, another one, e.g. of a
+    // copy or an edit of the same size, only if the contents hash the same
+    if (source.mtime != header.sourceMtime &&
+        getSourceStamp(sourceFile, true).crc != header.sourceCrc) {
+      return;
+    }
+  }
+  if (header.numSections >
+      (file_.size() - sizeof(CacheHeader)) / sizeof(CacheSection)) {
+    return;
+  }
+
+  sections_.resize(header.numSections);
+  for (size_t i = 0; i < sections_.size(); ++i) {
+    CacheSection section;
+    std::memcpy(&section,
+                file_.data() + sizeof(CacheHeader) + i * sizeof(CacheSection),
+                sizeof(section));
+    if (section.offset > file_.size() ||
+        section.size > file_.size() - section.offset) {
+      sections_.clear();
+      return;
+    }
+    sections_[i] = {section.offset, section.size};
+  }
+  valid_ = true;
+}
+
+bool CacheReader::getSection(size_t index,
+                             const char*& data,
+                             size_t& sizeInBytes) const {
+  if (!valid_ || index >= sections_.size()) {
+    return false;
+  }
+  data = file_.data() + sections_[index].first;
+  sizeInBytes = sections_[index].second;
+  return true;
+}
+
+}  // namespace io
+}  // namespace esp
@@ -0,0 +1,172 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace esp {
+namespace io {
+
+//! Memory mapping of a whole file. The mapping is read-only, unless it is
+//! copy-on-write: then it can be written through mutableData(), and only the
+//! pages written to are copied, the rest stays shared with the page cache
+class MappedFile {
+ public:
+  explicit MappedFile(const std::string& file, bool copyOnWrite = false);
+  ~MappedFile();
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  //! Whether the file could be opened and mapped
+  bool isValid() const { return data_ != nullptr; }
+  const char* data() const { return data_; }
+  size_t size() const { return size_; }
+
+  //! Writable view of a copy-on-write mapping, nullptr otherwise
+  char* mutableData() { return copyOnWrite_ ? data_ : nullptr; }
+
+ private:
+  char* data_ = nullptr;
+  bool copyOnWrite_ = false;
+  size_t size_ = 0;
+#ifdef _WIN32
+  std::vector<char> buffer_;
+#endif
+};
+
+//! CRC-32 (the zlib polynomial) of sizeInBytes bytes of data, continuing
+//! from the crc of preceding data
+uint32_t crc32(const void* data, size_t sizeInBytes, uint32_t crc = 0);
+
+//! What identifies the contents of a source file a cache is derived from
+struct SourceStamp {
+  uint64_t size = 0;
+  //! modification time in nanoseconds since the epoch
+  int64_t mtime = 0;
+  //! crc32() of the whole file, 0 unless asked for
+  uint32_t crc = 0;
+};
+
+//! Stamp of file, with the CRC-32 of its contents if withCrc, which reads
+//! all of it; all 0 if file does not exist
+SourceStamp getSourceStamp(const std::string& file, bool withCrc);
+
+//! File the binary cache of a source asset is stored in: next to the source,
+//! unless a shared cache directory is set and there is no cache there yet
+std::string cacheFilename(const std::string& source);
+
+// The shared cache directory is a store of binary caches on a memory file
+// system such as /dev/shm, for the worker processes of a node: the first one
+// to load an asset writes its caches there, and the others map them instead
+// of parsing the source, so the decoded data is held once in the page cache.
+// Caches are stored under the name of the source and a hash of its absolute
+// path, and are replaced atomically, so that readers never see partial files
+
+//! Directory of the cache store, created if missing; empty (the default)
+//! keeps caches next to their sources only
+void setSharedCacheDir(const std::string& dir);
+std::string getSharedCacheDir();
+
+//! Exclusive lock of the cache file of a source while it is created, so that
+//! the other processes wait and then use it rather than creating it as well.
+//! Blocks until the lock is held; a no-op without a shared cache directory
+class CacheLock {
+ public:
+  explicit CacheLock(const std::string& cacheFile);
+  ~CacheLock();
+
+  CacheLock(const CacheLock&) = delete;
+  CacheLock& operator=(const CacheLock&) = delete;
+
+ private:
+  int fd_ = -1;
+};
+
+// Binary cache files hold data derived from a source asset in the layout it
+// is used in at runtime, so that loading is a plain copy instead of parsing.
+// A header identifies the kind and version of the payload and the stamp of
+// the source file it was created from, followed by a table of sections.
+// A cache is used as long as its source has the same size and modification
+// time, or, once the time changed, e.g. after a copy, the same CRC-32, so
+// that a source edited in place is never served from a stale cache. Section
+// data is 16-byte aligned. Data is stored in native byte order.
+
+//! Writes a binary cache file by sections
+class CacheWriter {
+ public:
+  //! sourceFile is the file the cache is derived from, stamped with its
+  //! CRC-32 here; empty for caches without a source
+  CacheWriter(uint32_t kind, uint32_t version, const std::string& sourceFile);
+
+  //! Add a section; the data is referenced, not copied, until write()
+  void addSection(const void* data, size_t sizeInBytes);
+
+  template <typename T>
+  void addSection(const std::vector<T>& data) {
+    addSection(data.data(), data.size() * sizeof(T));
+  }
+
+  //! Write to a temporary file replacing file once complete, so that
+  //! processes mapping file meanwhile see the old or the new cache
+  bool write(const std::string& file) const;
+
+ private:
+  uint32_t kind_;
+  uint32_t version_;
+  SourceStamp source_;
+  std::vector<std::pair<const void*, size_t>> sections_;
+};
+
+//! Maps a binary cache file and gives access to its sections
+class CacheReader {
+ public:
+  //! Maps file; the reader is only valid if the file exists, matches kind
+  //! and version, and was written from the current contents of sourceFile
+  //! (empty for caches without a source)
+  CacheReader(const std::string& file,
+              uint32_t kind,
+              uint32_t version,
+              const std::string& sourceFile);
+
+  bool isValid() const { return valid_; }
+
+  size_t getNumSections() const { return sections_.size(); }
+
+  //! Get a view of a section into the mapping, false if index is out of range
+  bool getSection(size_t index,
+                  const char*& data,
+                  size_t& sizeInBytes) const;
+
+  //! Copy a section into data, false if index is out of range or the section
+  //! size is not a multiple of sizeof(T)
+  template <typename T>
+  bool readSection(size_t index, std::vector<T>& data) const {
+    const char* sectionData = nullptr;
+    size_t sizeInBytes = 0;
+    if (!getSection(index, sectionData, sizeInBytes) ||
+        sizeInBytes % sizeof(T) != 0) {
+      return false;
+    }
+    data.resize(sizeInBytes / sizeof(T));
+    if (sizeInBytes > 0) {
+      std::memcpy(static_cast<void*>(data.data()), sectionData, sizeInBytes);
+    }
+    return true;
+  }
+
+ private:
+  MappedFile file_;
+  bool valid_ = false;
+  // (offset, size) of each section in file_
+  std::vector<std::pair<uint64_t, uint64_t>> sections_;
+};
+
+}  // namespace io
+}  // namespace esp
@@ -3,6 +3,8 @@
 // LICENSE file in the root directory of this source tree.
 
 #include "io.h"
+#include <climits>
+#include <cstdlib>
 #include <fstream>
 #include <set>
 
@@ -44,6 +46,21 @@ size_t fileSize(const std::string& filename) {
   return (size <= 0 ? 0 : size);
 }
 
+std::string absolutePath(const std::string& filename) {
+#ifdef _WIN32
+  char resolved[_MAX_PATH];
+  if (_fullpath(resolved, filename.c_str(), _MAX_PATH) != nullptr) {
+    return resolved;
+  }
+#else
+  char resolved[PATH_MAX];
+  if (realpath(filename.c_str(), resolved) != nullptr) {
+    return resolved;
+  }
+#endif
+  return filename;
+}
+
 // TODO:
 // a corner case it will fail to match the replace_extension in c++17:
 // filename = "foo"
@@ -14,6 +14,10 @@ bool exists(const std::string& file);
 
 size_t fileSize(const std::string& file);
 
+// returns the canonical absolute path of an existing file, or file unchanged
+// if it cannot be resolved
+std::string absolutePath(const std::string& file);
+
 std::string removeExtension(const std::string& file);
 
 std::string changeExtension(const std::string& file, const std::string& ext);
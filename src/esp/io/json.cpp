@@ -29,6 +29,24 @@ JsonDocument parseJsonFile(const std::string& file) {
   return d;
 }
 
+JsonDocument parseJsonFile(const std::string& file,
+                           const std::unordered_set<std::string>& keys) {
+  // the document allocates what the filter forwards from its memory pool, in
+  // a few large chunks rather than per value
+  bool parsed = false;
+  auto generator = [&](JsonDocument& d) {
+    JsonKeyFilter<JsonDocument> filter(d, keys);
+    parsed = streamJsonFile(file, filter);
+    return parsed;
+  };
+  JsonDocument d;
+  d.Populate(generator);
+  if (!parsed) {
+    throw std::runtime_error("JSON parse error");
+  }
+  return d;
+}
+
 JsonDocument parseJsonString(const std::string& jsonString) {
   JsonDocument d;
   d.Parse(jsonString.c_str());
@@ -41,6 +59,16 @@ JsonDocument parseJsonString(const std::string& jsonString) {
   return d;
 }
 
+void logJsonParseError(const std::string& file,
+                       const rapidjson::ParseResult& result) {
+  if (!result.IsError()) {
+    LOG(ERROR) << "Could not open " << file;
+  } else {
+    LOG(ERROR) << "Parse error reading " << file << " Error code "
+               << result.Code() << " at " << result.Offset();
+  }
+}
+
 std::string jsonToString(const JsonDocument& d) {
   rapidjson::StringBuffer buffer{};
   rapidjson::Writer<rapidjson::StringBuffer> writer{buffer};
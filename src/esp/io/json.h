@@ -7,9 +7,13 @@
 #include <cstdint>
 #define RAPIDJSON_NO_INT64DEFINE
 #include <rapidjson/document.h>
+#include <rapidjson/filereadstream.h>
+#include <rapidjson/reader.h>
 
+#include <cstdio>
 #include <functional>
 #include <string>
+#include <unordered_set>
 #include <vector>
 
 namespace esp {
@@ -23,9 +27,158 @@ JsonDocument parseJsonFile(const std::string& file);
 //! Parse JSON string and return as JsonDocument object
 JsonDocument parseJsonString(const std::string& jsonString);
 
+//! Parse JSON file keeping only the object members named in keys, at any
+//! depth, along with everything inside them. Skipped members are never
+//! allocated, so this is much lighter than parseJsonFile() for large files of
+//! which few fields are used
+JsonDocument parseJsonFile(const std::string& file,
+                           const std::unordered_set<std::string>& keys);
+
 //! Return string representation of given JsonDocument
 std::string jsonToString(const JsonDocument& d);
 
+//! Log the error parsing file, or failing to open it if result holds no
+//! error, used by streamJsonFile()
+void logJsonParseError(const std::string& file,
+                       const rapidjson::ParseResult& result);
+
+//! Stream JSON file through a rapidjson SAX handler, reading it in fixed size
+//! chunks without building a document. Return false if the file does not
+//! open or does not parse
+template <typename Handler>
+bool streamJsonFile(const std::string& file, Handler& handler) {
+  FILE* pFile = fopen(file.c_str(), "rb");
+  if (pFile == nullptr) {
+    logJsonParseError(file, rapidjson::ParseResult());
+    return false;
+  }
+  char buffer[65536];
+  rapidjson::FileReadStream is(pFile, buffer, sizeof(buffer));
+  rapidjson::Reader reader;
+  const rapidjson::ParseResult result = reader.Parse(is, handler);
+  fclose(pFile);
+  if (result.IsError()) {
+    logJsonParseError(file, result);
+    return false;
+  }
+  return true;
+}
+
+//! SAX handler forwarding to handler only the object members named in keys,
+//! at any depth, along with everything inside them. Object and array sizes
+//! passed on are those of what was forwarded
+template <typename Handler>
+class JsonKeyFilter {
+ public:
+  JsonKeyFilter(Handler& handler, const std::unordered_set<std::string>& keys)
+      : handler_(handler), keys_(keys) {}
+
+  bool Null() { return skipValue() || handler_.Null(); }
+  bool Bool(bool b) { return skipValue() || handler_.Bool(b); }
+  bool Int(int i) { return skipValue() || handler_.Int(i); }
+  bool Uint(unsigned u) { return skipValue() || handler_.Uint(u); }
+  bool Int64(int64_t i) { return skipValue() || handler_.Int64(i); }
+  bool Uint64(uint64_t u) { return skipValue() || handler_.Uint64(u); }
+  bool Double(double d) { return skipValue() || handler_.Double(d); }
+  bool RawNumber(const char* str, rapidjson::SizeType length, bool copy) {
+    return skipValue() || handler_.RawNumber(str, length, copy);
+  }
+  bool String(const char* str, rapidjson::SizeType length, bool copy) {
+    return skipValue() || handler_.String(str, length, copy);
+  }
+
+  bool StartObject() {
+    if (skipContainer()) {
+      return true;
+    }
+    countValue();
+    containers_.push_back({false, 0});
+    return handler_.StartObject();
+  }
+  bool Key(const char* str, rapidjson::SizeType length, bool copy) {
+    if (skipDepth_ > 0) {
+      return true;
+    }
+    if (keys_.count(std::string(str, length)) == 0) {
+      skipNext_ = true;
+      return true;
+    }
+    ++containers_.back().count;
+    return handler_.Key(str, length, copy);
+  }
+  bool EndObject(rapidjson::SizeType) {
+    if (skipDepth_ > 0) {
+      --skipDepth_;
+      return true;
+    }
+    const rapidjson::SizeType count = containers_.back().count;
+    containers_.pop_back();
+    return handler_.EndObject(count);
+  }
+
+  bool StartArray() {
+    if (skipContainer()) {
+      return true;
+    }
+    countValue();
+    containers_.push_back({true, 0});
+    return handler_.StartArray();
+  }
+  bool EndArray(rapidjson::SizeType) {
+    if (skipDepth_ > 0) {
+      --skipDepth_;
+      return true;
+    }
+    const rapidjson::SizeType count = containers_.back().count;
+    containers_.pop_back();
+    return handler_.EndArray(count);
+  }
+
+ protected:
+  struct Container {
+    bool isArray;
+    rapidjson::SizeType count;
+  };
+
+  // true if the scalar value at hand is skipped, else it is counted
+  bool skipValue() {
+    if (skipDepth_ > 0) {
+      return true;
+    }
+    if (skipNext_) {
+      skipNext_ = false;
+      return true;
+    }
+    countValue();
+    return false;
+  }
+
+  // true if the object or array starting is skipped, or inside a skipped one
+  bool skipContainer() {
+    if (skipDepth_ > 0 || skipNext_) {
+      skipNext_ = false;
+      ++skipDepth_;
+      return true;
+    }
+    return false;
+  }
+
+  // count a forwarded value as an element of the array it is in
+  void countValue() {
+    if (!containers_.empty() && containers_.back().isArray) {
+      ++containers_.back().count;
+    }
+  }
+
+  Handler& handler_;
+  const std::unordered_set<std::string> keys_;
+  std::vector<Container> containers_;
+  // depth inside a skipped object or array, 0 outside of any
+  int skipDepth_ = 0;
+  // the value of a skipped key comes next
+  bool skipNext_ = false;
+};
+
 template <typename GV, typename T>
 void toVector(const GV& arr,
               std::vector<T>* vec,
@@ -0,0 +1,275 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#include "ActionSpacePathFinder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <queue>
+
+#include "esp/geo/geo.h"
+
+namespace esp {
+namespace nav {
+
+namespace {
+// height cells, so that poses on floors above each other stay apart
+constexpr float heightCellSize = 0.5f;
+
+// give up a search after expanding this many poses
+constexpr int maxExpansions = 200000;
+
+constexpr float twoPi = static_cast<float>(2.0 * M_PI);
+}  // namespace
+
+namespace impl {
+
+ActionSpaceGraph::ActionSpaceGraph(PathFinder::ptr pathFinder,
+                                   float forwardAmount,
+                                   float turnAmount,
+                                   float cellSize)
+    : pathFinder(std::move(pathFinder)),
+      forwardAmount(forwardAmount),
+      numHeadings(
+          std::max(1, static_cast<int>(std::round(twoPi / turnAmount)))),
+      cellSize(cellSize) {
+  if (std::abs(numHeadings * turnAmount - twoPi) > 1e-3f) {
+    LOG(WARNING) << "ActionSpaceGraph: turns of " << turnAmount
+                 << " radians do not divide a full turn, using "
+                 << numHeadings << " headings";
+  }
+}
+
+std::unique_lock<std::recursive_mutex> ActionSpaceGraph::lock() const {
+  return std::unique_lock<std::recursive_mutex>(pathFinder->mutex_);
+}
+
+int ActionSpaceGraph::findOrAddNode(const vec3f& position, int heading) {
+  const Key key{static_cast<int>(std::floor(position[0] / cellSize)),
+                static_cast<int>(std::floor(position[1] / heightCellSize)),
+                static_cast<int>(std::floor(position[2] / cellSize)), heading};
+  auto it = index_.find(key);
+  if (it != index_.end()) {
+    return it->second;
+  }
+  const int node = nodes.size();
+  nodes.push_back({position, heading, {-2, -2, -2}});
+  index_.emplace(key, node);
+  return node;
+}
+
+int ActionSpaceGraph::successor(int node, int action) {
+  if (nodes[node].successors[action] != -2) {
+    return nodes[node].successors[action];
+  }
+  // nodes may grow below
+  const vec3f position = nodes[node].position;
+  const int heading = nodes[node].heading;
+  int next = -1;
+  switch (static_cast<ActionSpacePathFinder::CODES>(action)) {
+    case ActionSpacePathFinder::CODES::LEFT:
+      next = findOrAddNode(position, (heading + 1) % numHeadings);
+      break;
+    case ActionSpacePathFinder::CODES::RIGHT:
+      next = findOrAddNode(position, (heading + numHeadings - 1) % numHeadings);
+      break;
+    default: {
+      // turning left rotates the front (0, 0, -1) towards -x
+      const float angle = heading * twoPi / numHeadings;
+      const vec3f end =
+          position +
+          forwardAmount * vec3f(-std::sin(angle), 0.0f, -std::cos(angle));
+      next = findOrAddNode(pathFinder->tryStep(position, end), heading);
+      if (next == node) {
+        next = -1;
+      }
+    }
+  }
+  nodes[node].successors[action] = next;
+  return next;
+}
+
+int ActionSpaceGraph::headingOf(const quatf& rotation) const {
+  const vec3f front = rotation * geo::ESP_FRONT;
+  const float angle = std::atan2(-front[0], -front[2]);
+  const int heading =
+      static_cast<int>(std::round(angle * numHeadings / twoPi)) % numHeadings;
+  return heading < 0 ? heading + numHeadings : heading;
+}
+
+}  // namespace impl
+
+ActionSpacePathFinder::ActionSpacePathFinder(PathFinder::ptr pathFinder,
+                                             float forwardAmount,
+                                             float turnAmount,
+                                             float goalDist,
+                                             float cellSize /* = 0 */)
+    : forwardAmount_(forwardAmount),
+      turnAmount_(turnAmount),
+      goalDist_(goalDist),
+      cellSize_(cellSize > 0 ? cellSize : 0.25f * forwardAmount) {
+  ASSERT(pathFinder != nullptr);
+  ASSERT(forwardAmount > 0 && turnAmount > 0);
+  graph_.reset(new impl::ActionSpaceGraph(std::move(pathFinder), forwardAmount_,
+                                          turnAmount_, cellSize_));
+}
+
+ActionSpacePathFinder::~ActionSpacePathFinder() = default;
+
+void ActionSpacePathFinder::reset() {
+  graph_.reset(new impl::ActionSpaceGraph(graph_->pathFinder, forwardAmount_,
+                                          turnAmount_, cellSize_));
+  goals_.clear();
+}
+
+ActionSpacePathFinder::Goal& ActionSpacePathFinder::goal(const vec3f& end) {
+  Goal& goal = goals_[std::make_tuple(end[0], end[1], end[2])];
+  if (!goal.distance) {
+    goal.distance = GeodesicDistanceField::create(
+        graph_->pathFinder, std::vector<vec3f>{end});
+  }
+  return goal;
+}
+
+bool ActionSpacePathFinder::search(int start, Goal& goal) {
+  if (goal.costToGo.count(start)) {
+    return true;
+  }
+  std::vector<impl::ActionSpaceGraph::Node>& nodes = graph_->nodes;
+
+  // actions from each pose to the goal if known without searching: none
+  // within goalDist, the table for the poses of earlier paths; -1 otherwise
+  auto remaining = [&](int node) {
+    if (goal.distance->distanceFrom(nodes[node].position) < goalDist_) {
+      return 0;
+    }
+    auto it = goal.costToGo.find(node);
+    return it != goal.costToGo.end() ? it->second.cost : -1;
+  };
+  // each forward move gets at most forwardAmount closer to the goal, so this
+  // never overestimates; infinite off the island of the goal
+  auto heuristic = [&](int node) {
+    const float distance = goal.distance->distanceFrom(nodes[node].position);
+    if (distance == std::numeric_limits<float>::infinity()) {
+      return -1;
+    }
+    return static_cast<int>(
+        std::ceil(std::max(0.0f, distance - goalDist_) / forwardAmount_));
+  };
+
+  // estimated total cost, cost so far, node and whether the rest of the way
+  // from the node is known
+  typedef std::tuple<int, int, int, bool> QueueEntry;
+  std::priority_queue<QueueEntry, std::vector<QueueEntry>,
+                      std::greater<QueueEntry>>
+      queue;
+  std::unordered_map<int, int> costs;
+  // parent and the action from it
+  std::unordered_map<int, std::pair<int, CODES>> parents;
+  auto push = [&](int node, int cost) {
+    auto it = costs.find(node);
+    if (it != costs.end() && it->second <= cost) {
+      return false;
+    }
+    const int known = remaining(node);
+    const int estimate = known >= 0 ? known : heuristic(node);
+    if (estimate < 0) {
+      return false;
+    }
+    costs[node] = cost;
+    queue.emplace(cost + estimate, cost, node, known >= 0);
+    return true;
+  };
+
+  push(start, 0);
+  int expansions = 0;
+  while (!queue.empty() && expansions < maxExpansions) {
+    const QueueEntry top = queue.top();
+    queue.pop();
+    const int cost = std::get<1>(top);
+    const int node = std::get<2>(top);
+    if (cost > costs[node]) {
+      continue;
+    }
+    if (std::get<3>(top)) {
+      // the poses back to the start get their cost-to-go and first action
+      int toGo = std::get<0>(top) - cost;
+      if (!goal.costToGo.count(node)) {
+        goal.costToGo[node] = {toGo, CODES::STOP};
+      }
+      for (int child = node; child != start;) {
+        const std::pair<int, CODES>& parent = parents[child];
+        goal.costToGo[parent.first] = {++toGo, parent.second};
+        child = parent.first;
+      }
+      return true;
+    }
+    ++expansions;
+    for (CODES action : {CODES::FORWARD, CODES::LEFT, CODES::RIGHT}) {
+      const int next = graph_->successor(node, static_cast<int>(action));
+      if (next >= 0 && push(next, cost + 1)) {
+        parents[next] = {node, action};
+      }
+    }
+  }
+  if (expansions >= maxExpansions) {
+    LOG(WARNING) << "ActionSpacePathFinder: gave up after " << expansions
+                 << " poses";
+  }
+  return false;
+}
+
+std::vector<ActionSpacePathFinder::CODES> ActionSpacePathFinder::findPath(
+    const vec3f& startPos,
+    const vec4f& startRot,
+    const vec3f& end) {
+  auto lock = graph_->lock();
+  std::vector<CODES> actions;
+  if (!graph_->pathFinder->isLoaded()) {
+    LOG(ERROR) << "ActionSpacePathFinder: no navmesh loaded";
+    return actions;
+  }
+  const quatf rotation = Eigen::Map<const quatf>(startRot.data());
+  int node = graph_->findOrAddNode(startPos, graph_->headingOf(rotation));
+  Goal& target = goal(end);
+  if (!search(node, target)) {
+    return actions;
+  }
+  // every pose along the path has its cost-to-go now
+  for (auto it = target.costToGo.find(node); it != target.costToGo.end();
+       it = target.costToGo.find(node)) {
+    actions.push_back(it->second.action);
+    if (it->second.action == CODES::STOP) {
+      return actions;
+    }
+    node = graph_->successor(node, static_cast<int>(it->second.action));
+  }
+  // not reached, the table only holds poses of complete paths
+  actions.clear();
+  return actions;
+}
+
+ActionSpacePathFinder::CODES ActionSpacePathFinder::nextActionAlong(
+    const vec3f& currentPos,
+    const vec4f& currentRot,
+    const vec3f& end) {
+  auto lock = graph_->lock();
+  if (!graph_->pathFinder->isLoaded()) {
+    LOG(ERROR) << "ActionSpacePathFinder: no navmesh loaded";
+    return CODES::ERROR;
+  }
+  const quatf rotation = Eigen::Map<const quatf>(currentRot.data());
+  const int node =
+      graph_->findOrAddNode(currentPos, graph_->headingOf(rotation));
+  Goal& target = goal(end);
+  if (!search(node, target)) {
+    return CODES::ERROR;
+  }
+  return target.costToGo[node].action;
+}
+
+}  // namespace nav
+}  // namespace esp
@@ -0,0 +1,157 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#pragma once
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include "esp/core/esp.h"
+#include "esp/nav/GeodesicDistanceField.h"
+#include "esp/nav/GreedyFollower.h"
+#include "esp/nav/PathFinder.h"
+
+namespace esp {
+namespace nav {
+
+namespace impl {
+
+// Poses reachable from each other with a forward move and left and right
+// turns, on a lattice of x-z cells of cellSize, height cells and headings at
+// multiples of the turn. Forward moves run through PathFinder::tryStep, so
+// they slide along the navmesh like the moves of the agent. The successors of
+// a pose are only computed the first time a search expands it, and kept
+struct ActionSpaceGraph {
+  ActionSpaceGraph(PathFinder::ptr pathFinder,
+                   float forwardAmount,
+                   float turnAmount,
+                   float cellSize);
+
+  // Index of the pose at position with heading, creating it if it is new
+  int findOrAddNode(const vec3f& position, int heading);
+
+  // Successor of node after action FORWARD, LEFT or RIGHT, -1 if a forward
+  // move does not leave the cell
+  int successor(int node, int action);
+
+  // Heading index of a rotation about the up axis
+  int headingOf(const quatf& rotation) const;
+
+  // Lock of the PathFinder, so that its navmesh does not change during a
+  // search
+  std::unique_lock<std::recursive_mutex> lock() const;
+
+  PathFinder::ptr pathFinder;
+  float forwardAmount;
+  int numHeadings;
+  float cellSize;
+
+  struct Node {
+    // of the first move that reached the pose
+    vec3f position;
+    int heading;
+    // by action, -2 until computed
+    int successors[3];
+  };
+  std::vector<Node> nodes;
+
+ private:
+  typedef std::tuple<int, int, int, int> Key;
+  std::map<Key, int> index_;
+};
+
+}  // namespace impl
+
+// Shortest sequences of discrete actions (move forward, turn left, turn
+// right) to the goals of a PathFinder, searched with A* over an
+// impl::ActionSpaceGraph instead of the greedy simulation of
+// GreedyGeodesicFollowerImpl. The geodesic distance to each goal is a
+// GeodesicDistanceField, and the cost-to-go of every pose on a found path is
+// kept per goal, so that following a path, or asking again from any pose on
+// it, is a lookup. Poses snap to the lattice, so the actions are optimal up
+// to cell size.
+// The graph and the tables refer to the navmesh at the time of the search;
+// call reset() if the navmesh of the PathFinder changes
+class ActionSpacePathFinder {
+ public:
+  typedef GreedyGeodesicFollowerImpl::CODES CODES;
+
+  /**
+   * @param[in] pathFinder Pathfinder with the navmesh to move on
+   * @param[in] forwardAmount The amount "move_forward" moves the agent
+   * @param[in] turnAmount The amount "turn_left"/"turn_right" turns the agent
+   * in radians
+   * @param[in] goalDist How close the agent needs to get to the goal before
+   * calling stop
+   * @param[in] cellSize Size of the x-z cells of the lattice, 0 (default) for
+   * a quarter of forwardAmount
+   **/
+  ActionSpacePathFinder(PathFinder::ptr pathFinder,
+                        float forwardAmount,
+                        float turnAmount,
+                        float goalDist,
+                        float cellSize = 0.0f);
+
+  ~ActionSpacePathFinder();
+
+  /**
+   * Shortest action sequence from the start pose to within goalDist of end,
+   * ending with STOP. Empty if the goal cannot be reached
+   *
+   * @param[in] startPos The starting position
+   * @param[in] startRot The starting rotation, as quaternion coefficients
+   * (x, y, z, w)
+   * @param[in] end The end location of the path
+   **/
+  std::vector<CODES> findPath(const vec3f& startPos,
+                              const vec4f& startRot,
+                              const vec3f& end);
+
+  /**
+   * First action of findPath(), ERROR if the goal cannot be reached
+   **/
+  CODES nextActionAlong(const vec3f& currentPos,
+                        const vec4f& currentRot,
+                        const vec3f& end);
+
+  //! Poses expanded so far
+  size_t getNumNodes() const { return graph_->nodes.size(); }
+
+  //! Goals with a cost-to-go table
+  size_t getNumGoals() const { return goals_.size(); }
+
+  //! Drops the graph and the tables, needed if the navmesh changes
+  void reset();
+
+ private:
+  // by node, actions to the goal and the first of them, for the poses on the
+  // paths found to a goal
+  struct CostToGo {
+    int cost;
+    CODES action;
+  };
+  struct Goal {
+    GeodesicDistanceField::ptr distance;
+    std::unordered_map<int, CostToGo> costToGo;
+  };
+
+  // Table of end, created on first use
+  Goal& goal(const vec3f& end);
+
+  // Search from node to goal, filling in its table; false if there is no path
+  bool search(int start, Goal& goal);
+
+  float forwardAmount_, turnAmount_, goalDist_, cellSize_;
+  std::unique_ptr<impl::ActionSpaceGraph> graph_;
+  std::map<std::tuple<float, float, float>, Goal> goals_;
+
+  ESP_SMART_POINTERS(ActionSpacePathFinder)
+};
+
+}  // namespace nav
+}  // namespace esp
@@ -0,0 +1,202 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#include "EpisodeSampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+
+#include "DetourNavMesh.h"
+#include "DetourNavMeshQuery.h"
+
+namespace esp {
+namespace nav {
+
+namespace {
+// candidates of a round beyond the episodes still missing, so that a round
+// usually has enough after the rejections
+constexpr int minRoundSize = 64;
+}  // namespace
+
+EpisodeSampler::EpisodeSampler(PathFinder::ptr pathFinder,
+                               uint32_t seed /* = 0 */)
+    : pathFinder_(std::move(pathFinder)), random_(seed) {
+  ASSERT(pathFinder_ != nullptr);
+}
+
+void EpisodeSampler::buildTable(float minIslandRadius) {
+  polys_.clear();
+  islandFirstPoly_.clear();
+  polyAreas_.clear();
+  tableRadius_ = minIslandRadius;
+
+  const dtNavMesh* navMesh = pathFinder_->navMesh_;
+  const dtQueryFilter* filter = pathFinder_->filter_;
+  std::map<int, std::vector<Poly>> islands;
+  for (int iTile = 0; iTile < navMesh->getMaxTiles(); ++iTile) {
+    const dtMeshTile* tile = navMesh->getTile(iTile);
+    if (!tile || !tile->header)
+      continue;
+    for (int jPoly = 0; jPoly < tile->header->polyCount; ++jPoly) {
+      const dtPoly* poly = &tile->polys[jPoly];
+      const dtPolyRef ref = navMesh->getPolyRefBase(tile) | jPoly;
+      if (poly->getType() != DT_POLYTYPE_GROUND ||
+          !filter->passFilter(ref, tile, poly))
+        continue;
+      const int island = pathFinder_->polyIslandIndex(ref);
+      if (island < 0 || pathFinder_->polyIslandRadius(ref) < minIslandRadius)
+        continue;
+
+      Poly entry;
+      entry.ref = ref;
+      for (int iVert = 0; iVert < poly->vertCount; ++iVert) {
+        entry.vertices.emplace_back(
+            Eigen::Map<const vec3f>(&tile->verts[poly->verts[iVert] * 3]));
+      }
+      float area = 0.0f;
+      for (size_t k = 2; k < entry.vertices.size(); ++k) {
+        const vec3f& origin = entry.vertices[0];
+        area += 0.5f * (entry.vertices[k - 1] - origin)
+                           .cross(entry.vertices[k] - origin)
+                           .norm();
+        entry.triangleAreas.push_back(area);
+      }
+      if (area > 0.0f) {
+        islands[island].emplace_back(std::move(entry));
+      }
+    }
+  }
+
+  float area = 0.0f;
+  for (auto& island : islands) {
+    islandFirstPoly_.push_back(polys_.size());
+    for (Poly& poly : island.second) {
+      area += poly.triangleAreas.back();
+      polyAreas_.push_back(area);
+      polys_.emplace_back(std::move(poly));
+    }
+  }
+  islandFirstPoly_.push_back(polys_.size());
+}
+
+std::pair<int, int> EpisodeSampler::samplePoly(int island) {
+  const int first = island < 0 ? 0 : islandFirstPoly_[island];
+  const int last = island < 0 ? polys_.size() : islandFirstPoly_[island + 1];
+  const float base = first > 0 ? polyAreas_[first - 1] : 0.0f;
+  const float area =
+      base + random_.uniform_float_01() * (polyAreas_[last - 1] - base);
+  const int poly =
+      std::min<int>(std::upper_bound(polyAreas_.begin() + first,
+                                     polyAreas_.begin() + last, area) -
+                        polyAreas_.begin(),
+                    last - 1);
+  if (island < 0) {
+    island = std::upper_bound(islandFirstPoly_.begin(), islandFirstPoly_.end(),
+                              poly) -
+             islandFirstPoly_.begin() - 1;
+  }
+  return std::make_pair(poly, island);
+}
+
+vec3f EpisodeSampler::samplePoint(int poly) {
+  const Poly& entry = polys_[poly];
+  const float area = random_.uniform_float_01() * entry.triangleAreas.back();
+  const size_t triangle = std::min<size_t>(
+      std::upper_bound(entry.triangleAreas.begin(), entry.triangleAreas.end(),
+                       area) -
+          entry.triangleAreas.begin(),
+      entry.triangleAreas.size() - 1);
+  float s = random_.uniform_float_01();
+  float t = random_.uniform_float_01();
+  if (s + t > 1.0f) {
+    s = 1.0f - s;
+    t = 1.0f - t;
+  }
+  const vec3f& origin = entry.vertices[0];
+  return origin + s * (entry.vertices[triangle + 1] - origin) +
+         t * (entry.vertices[triangle + 2] - origin);
+}
+
+EpisodeBatch EpisodeSampler::sample(int numEpisodes,
+                                    const EpisodeConstraints& constraints,
+                                    int numThreads /* = 0 */,
+                                    int maxTriesPerEpisode /* = 100 */) {
+  std::lock_guard<std::recursive_mutex> lock(pathFinder_->mutex_);
+  EpisodeBatch batch;
+  if (!pathFinder_->isLoaded()) {
+    LOG(ERROR) << "EpisodeSampler::sample: no navmesh loaded";
+    return batch;
+  }
+  if (polys_.empty() || tableRadius_ != constraints.minIslandRadius) {
+    buildTable(constraints.minIslandRadius);
+  }
+  if (polys_.empty()) {
+    LOG(ERROR) << "EpisodeSampler::sample: no islands of radius >= "
+               << constraints.minIslandRadius;
+    return batch;
+  }
+
+  const int maxCandidates = maxTriesPerEpisode * numEpisodes;
+  int numCandidates = 0;
+  std::vector<ShortestPath> paths;
+  std::vector<float> headings;
+  while (static_cast<int>(batch.size()) < numEpisodes &&
+         numCandidates < maxCandidates) {
+    const int missing = numEpisodes - batch.size();
+    const int roundSize = std::min(maxCandidates - numCandidates,
+                                   std::max(minRoundSize, 2 * missing));
+    paths.clear();
+    headings.clear();
+    for (int i = 0; i < roundSize; ++i) {
+      ++numCandidates;
+      const std::pair<int, int> start = samplePoly(-1);
+      const vec3f startPoint = samplePoint(start.first);
+      const vec3f goalPoint = samplePoint(samplePoly(start.second).first);
+      const float heading = random_.uniform_float(0.0f, 2.0f * M_PI);
+      // the geodesic distance is at least the euclidean one
+      if (std::abs(goalPoint[1] - startPoint[1]) >
+              constraints.maxHeightDifference ||
+          (goalPoint - startPoint).norm() > constraints.maxGeodesicDistance)
+        continue;
+      paths.emplace_back();
+      paths.back().requestedStart = startPoint;
+      paths.back().requestedEnd = goalPoint;
+      headings.push_back(heading);
+    }
+
+    const std::vector<bool> found = pathFinder_->findPaths(paths, numThreads);
+    for (size_t i = 0; i < paths.size() &&
+                       static_cast<int>(batch.size()) < numEpisodes;
+         ++i) {
+      const ShortestPath& path = paths[i];
+      if (!found[i] || path.points.empty() ||
+          path.geodesicDistance < constraints.minGeodesicDistance ||
+          path.geodesicDistance > constraints.maxGeodesicDistance)
+        continue;
+      // the ends of the path are snapped to the navmesh
+      const vec3f& start = path.points.front();
+      const vec3f& goal = path.points.back();
+      const float euclidean = (goal - start).norm();
+      if (std::abs(goal[1] - start[1]) > constraints.maxHeightDifference ||
+          path.geodesicDistance <
+              constraints.minGeodesicToEuclideanRatio * euclidean)
+        continue;
+      batch.starts.push_back(start);
+      batch.goals.push_back(goal);
+      batch.startHeadings.push_back(headings[i]);
+      batch.geodesicDistances.push_back(path.geodesicDistance);
+    }
+  }
+
+  if (static_cast<int>(batch.size()) < numEpisodes) {
+    LOG(WARNING) << "EpisodeSampler::sample: only found " << batch.size()
+                 << " of " << numEpisodes << " episodes in " << numCandidates
+                 << " candidates";
+  }
+  return batch;
+}
+
+}  // namespace nav
+}  // namespace esp
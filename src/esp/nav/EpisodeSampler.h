@@ -0,0 +1,103 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#pragma once
+
+#include <limits>
+#include <vector>
+
+#include "esp/core/esp.h"
+#include "esp/core/random.h"
+#include "esp/nav/PathFinder.h"
+
+namespace esp {
+namespace nav {
+
+//! What PointNav episodes an EpisodeSampler accepts
+struct EpisodeConstraints {
+  float minGeodesicDistance = 1.0f;
+  float maxGeodesicDistance = 30.0f;
+  //! pairs with a geodesic over euclidean distance ratio below this are too
+  //! easy
+  float minGeodesicToEuclideanRatio = 1.1f;
+  //! start and goal are on islands of at least this radius
+  float minIslandRadius = 1.5f;
+  //! most height between start and goal, e.g. 0.5 to keep them on one floor
+  float maxHeightDifference = std::numeric_limits<float>::infinity();
+};
+
+//! Episodes as arrays, one entry per episode
+struct EpisodeBatch {
+  std::vector<vec3f> starts;
+  std::vector<vec3f> goals;
+  //! rotations of the start about the up axis, in radians
+  std::vector<float> startHeadings;
+  std::vector<float> geodesicDistances;
+
+  size_t size() const { return starts.size(); }
+};
+
+// Generates PointNav episodes on the navmesh of a PathFinder in bulk. Start
+// and goal pairs are drawn on the same island, with islands and points
+// weighted by area, from a table of the navmesh polygons on islands large
+// enough built once per constraint radius. The paths of each round of
+// candidates are found in parallel with PathFinder::findPaths(), and the
+// constraints are applied in-process. Candidates are drawn serially from the
+// generator of the sampler, so the episodes only depend on its seed and not
+// on the number of threads.
+// Like GeodesicDistanceField, the table refers to the navmesh at the time it
+// is built; call reset() if the navmesh of the PathFinder changes
+class EpisodeSampler {
+ public:
+  explicit EpisodeSampler(PathFinder::ptr pathFinder, uint32_t seed = 0);
+
+  void seed(uint32_t newSeed) { random_.seed(newSeed); }
+
+  // Sample up to numEpisodes episodes meeting constraints, finding the paths
+  // on numThreads threads (0 uses all cores). Gives up after
+  // maxTriesPerEpisode candidates per episode on average and returns the
+  // episodes found so far
+  EpisodeBatch sample(int numEpisodes,
+                      const EpisodeConstraints& constraints,
+                      int numThreads = 0,
+                      int maxTriesPerEpisode = 100);
+
+  // Drops the polygon table, needed if the navmesh changes
+  void reset() { polys_.clear(); }
+
+ protected:
+  struct Poly {
+    uint64_t ref;
+    // vertices of the polygon, a triangle fan around the first one
+    std::vector<vec3f> vertices;
+    // of the fan, cumulative
+    std::vector<float> triangleAreas;
+  };
+  // polygons of the islands of radius at least tableRadius_, grouped by
+  // island
+  std::vector<Poly> polys_;
+  // island i holds polys_[islandFirstPoly_[i]] up to
+  // polys_[islandFirstPoly_[i + 1]], and polyAreas_ are their cumulative
+  // areas over all islands
+  std::vector<int> islandFirstPoly_;
+  std::vector<float> polyAreas_;
+  float tableRadius_ = -1.0f;
+
+  void buildTable(float minIslandRadius);
+
+  // random point on polygon poly, uniform by area
+  vec3f samplePoint(int poly);
+
+  // random polygon of island, or of any island if island is -1, by area;
+  // returns the polygon and its island
+  std::pair<int, int> samplePoly(int island);
+
+  PathFinder::ptr pathFinder_;
+  core::Random random_;
+
+  ESP_SMART_POINTERS(EpisodeSampler)
+};
+
+}  // namespace nav
+}  // namespace esp
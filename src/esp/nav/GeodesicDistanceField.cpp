@@ -0,0 +1,225 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#include "GeodesicDistanceField.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <map>
+#include <queue>
+#include <tuple>
+
+#include "DetourNavMesh.h"
+#include "DetourNavMeshQuery.h"
+
+namespace esp {
+namespace nav {
+
+namespace {
+// same search box as PathFinder uses to snap points to the navmesh
+constexpr float polyPickExt[3] = {2, 4, 2};
+
+// vertices closer than this are considered the same, e.g. across tiles
+constexpr float vertexMergeEpsilon = 1e-3f;
+}  // namespace
+
+GeodesicDistanceField::GeodesicDistanceField(PathFinder::ptr pathFinder,
+                                             const std::vector<vec3f>& goals)
+    : pathFinderOwner_(std::move(pathFinder)),
+      pathFinder_(pathFinderOwner_.get()),
+      goals_(goals) {
+  ASSERT(pathFinder_ != nullptr);
+  build();
+}
+
+GeodesicDistanceField::GeodesicDistanceField(const PathFinder& pathFinder,
+                                             const std::vector<vec3f>& goals)
+    : pathFinder_(&pathFinder), goals_(goals) {
+  build();
+}
+
+void GeodesicDistanceField::build() {
+  if (!pathFinder_->navMesh_) {
+    LOG(ERROR) << "GeodesicDistanceField: no navmesh loaded";
+    return;
+  }
+  const dtNavMesh* navMesh = pathFinder_->navMesh_;
+  const dtQueryFilter* filter = pathFinder_->filter_;
+
+  // Collect the walkable polygons and merge their vertices by position
+  std::map<std::tuple<int, int, int>, int> vertexIds;
+  auto quantize = [](float x) {
+    return static_cast<int>(std::round(x / vertexMergeEpsilon));
+  };
+  auto vertexId = [&](const float* v) {
+    const auto key =
+        std::make_tuple(quantize(v[0]), quantize(v[1]), quantize(v[2]));
+    auto it = vertexIds.find(key);
+    if (it != vertexIds.end()) {
+      return it->second;
+    }
+    const int id = vertices_.size();
+    vertices_.emplace_back(v[0], v[1], v[2]);
+    vertexIds.emplace(key, id);
+    return id;
+  };
+
+  tileFirstPoly_.assign(navMesh->getMaxTiles(), -1);
+  polyFirstVertex_.push_back(0);
+  for (int iTile = 0; iTile < navMesh->getMaxTiles(); ++iTile) {
+    const dtMeshTile* tile = navMesh->getTile(iTile);
+    if (!tile || !tile->header)
+      continue;
+
+    tileFirstPoly_[iTile] = polyFirstVertex_.size() - 1;
+    for (int jPoly = 0; jPoly < tile->header->polyCount; ++jPoly) {
+      const dtPoly* poly = &tile->polys[jPoly];
+      const dtPolyRef ref = navMesh->getPolyRefBase(tile) | jPoly;
+      if (poly->getType() == DT_POLYTYPE_GROUND &&
+          filter->passFilter(ref, tile, poly)) {
+        for (int iVert = 0; iVert < poly->vertCount; ++iVert) {
+          const float* v = &tile->verts[poly->verts[iVert] * 3];
+          polyVertices_.push_back(vertexId(v));
+        }
+      }
+      polyFirstVertex_.push_back(polyVertices_.size());
+    }
+  }
+
+  // Polygons are convex, so all vertex pairs of a polygon are connected by a
+  // straight walkable segment
+  std::vector<std::vector<std::pair<int, float>>> edges(vertices_.size());
+  for (size_t iPoly = 0; iPoly + 1 < polyFirstVertex_.size(); ++iPoly) {
+    for (int a = polyFirstVertex_[iPoly]; a < polyFirstVertex_[iPoly + 1];
+         ++a) {
+      for (int b = a + 1; b < polyFirstVertex_[iPoly + 1]; ++b) {
+        const int va = polyVertices_[a];
+        const int vb = polyVertices_[b];
+        const float length = (vertices_[va] - vertices_[vb]).norm();
+        edges[va].emplace_back(vb, length);
+        edges[vb].emplace_back(va, length);
+      }
+    }
+  }
+
+  // Seed with the vertices of each goal polygon and run Dijkstra
+  using QueueEntry = std::pair<float, int>;
+  std::priority_queue<QueueEntry, std::vector<QueueEntry>,
+                      std::greater<QueueEntry>>
+      queue;
+  vertexDistance_.assign(vertices_.size(),
+                         std::numeric_limits<float>::infinity());
+  vertexGoal_.assign(vertices_.size(), -1);
+  const dtNavMeshQuery* navQuery = pathFinder_->navQuery_;
+  for (int iGoal = 0; iGoal < goals_.size(); ++iGoal) {
+    const vec3f& goal = goals_[iGoal];
+    dtPolyRef goalRef = 0;
+    vec3f snappedGoal;
+    dtStatus status = navQuery->findNearestPoly(
+        goal.data(), polyPickExt, filter, &goalRef, snappedGoal.data());
+    const int goalPoly = polyIndex(goalRef);
+    if (dtStatusFailed(status) || goalRef == 0 || goalPoly < 0) {
+      LOG(WARNING) << "GeodesicDistanceField: goal " << goal.transpose()
+                   << " is not on the navmesh";
+      continue;
+    }
+    polyGoals_.emplace(goalRef, snappedGoals_.size());
+    snappedGoals_.emplace_back(snappedGoal);
+    goalIndices_.emplace_back(iGoal);
+    for (int i = polyFirstVertex_[goalPoly];
+         i < polyFirstVertex_[goalPoly + 1]; ++i) {
+      const int v = polyVertices_[i];
+      const float distance = (vertices_[v] - snappedGoal).norm();
+      if (distance < vertexDistance_[v]) {
+        vertexDistance_[v] = distance;
+        vertexGoal_[v] = iGoal;
+        queue.emplace(distance, v);
+      }
+    }
+  }
+
+  while (!queue.empty()) {
+    const QueueEntry top = queue.top();
+    queue.pop();
+    if (top.first > vertexDistance_[top.second])
+      continue;
+    for (const auto& edge : edges[top.second]) {
+      const float distance = top.first + edge.second;
+      if (distance < vertexDistance_[edge.first]) {
+        vertexDistance_[edge.first] = distance;
+        vertexGoal_[edge.first] = vertexGoal_[top.second];
+        queue.emplace(distance, edge.first);
+      }
+    }
+  }
+}
+
+int GeodesicDistanceField::polyIndex(uint64_t ref) const {
+  if (ref == 0 || !pathFinder_->navMesh_) {
+    return -1;
+  }
+  const unsigned int iTile = pathFinder_->navMesh_->decodePolyIdTile(ref);
+  const unsigned int iPoly = pathFinder_->navMesh_->decodePolyIdPoly(ref);
+  if (iTile >= tileFirstPoly_.size() || tileFirstPoly_[iTile] < 0) {
+    return -1;
+  }
+  const int index = tileFirstPoly_[iTile] + iPoly;
+  if (index + 1 >= static_cast<int>(polyFirstVertex_.size())) {
+    return -1;
+  }
+  return index;
+}
+
+float GeodesicDistanceField::distanceFrom(const vec3f& pt) const {
+  return closest(pt, nullptr);
+}
+
+int GeodesicDistanceField::closestGoal(const vec3f& pt) const {
+  int goal = -1;
+  closest(pt, &goal);
+  return goal;
+}
+
+float GeodesicDistanceField::closest(const vec3f& pt, int* goal) const {
+  float distance = std::numeric_limits<float>::infinity();
+  if (!pathFinder_->navMesh_) {
+    return distance;
+  }
+
+  dtPolyRef ref = 0;
+  vec3f snapped;
+  dtStatus status = pathFinder_->navQuery_->findNearestPoly(
+      pt.data(), polyPickExt, pathFinder_->filter_, &ref, snapped.data());
+  const int poly = polyIndex(ref);
+  if (dtStatusFailed(status) || poly < 0) {
+    return distance;
+  }
+
+  for (int i = polyFirstVertex_[poly]; i < polyFirstVertex_[poly + 1]; ++i) {
+    const int v = polyVertices_[i];
+    const float throughVertex =
+        vertexDistance_[v] + (vertices_[v] - snapped).norm();
+    if (throughVertex < distance) {
+      distance = throughVertex;
+      if (goal)
+        *goal = vertexGoal_[v];
+    }
+  }
+  // goals on the same polygon are reachable in a straight line
+  const auto range = polyGoals_.equal_range(ref);
+  for (auto it = range.first; it != range.second; ++it) {
+    const float direct = (snappedGoals_[it->second] - snapped).norm();
+    if (direct < distance) {
+      distance = direct;
+      if (goal)
+        *goal = goalIndices_[it->second];
+    }
+  }
+  return distance;
+}
+
+}  // namespace nav
+}  // namespace esp
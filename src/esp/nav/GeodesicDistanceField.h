@@ -0,0 +1,81 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+#include "esp/core/esp.h"
+#include "esp/nav/PathFinder.h"
+
+namespace esp {
+namespace nav {
+
+// Geodesic distance to the closest of a fixed set of goals, precomputed for
+// the whole navmesh of a PathFinder by a single Dijkstra run over the
+// navmesh polygon vertices. Within a convex polygon every vertex is directly
+// reachable, so a lookup only snaps the point to its polygon and takes the
+// best of its vertices; this replaces a findPath() search per query.
+// Distances are an upper bound of the true geodesic distance, close to what
+// findPath() returns.
+// The field refers to the navmesh at construction time and has to be rebuilt
+// if the navmesh of the PathFinder is rebuilt or reloaded.
+class GeodesicDistanceField {
+ public:
+  GeodesicDistanceField(PathFinder::ptr pathFinder,
+                        const std::vector<vec3f>& goals);
+
+  // Field on the navmesh of pathFinder without keeping it alive, for the
+  // goal sets of the PathFinder itself
+  GeodesicDistanceField(const PathFinder& pathFinder,
+                        const std::vector<vec3f>& goals);
+
+  // Distance from pt to the closest goal, infinity if pt is not on the
+  // navmesh or cannot reach any goal
+  float distanceFrom(const vec3f& pt) const;
+
+  // Index into getGoals() of the closest goal to pt, the one distanceFrom()
+  // measures to; -1 if pt cannot reach any goal
+  int closestGoal(const vec3f& pt) const;
+
+  const std::vector<vec3f>& getGoals() const { return goals_; }
+
+ protected:
+  // owns the pathfinder if constructed from a pointer
+  PathFinder::ptr pathFinderOwner_;
+  const PathFinder* pathFinder_;
+  std::vector<vec3f> goals_;
+  // goals snapped to the navmesh and their indices into goals_
+  std::vector<vec3f> snappedGoals_;
+  std::vector<int> goalIndices_;
+  // snapped goals by polygon, so that lookups do not go over all goals
+  std::unordered_multimap<uint64_t, int> polyGoals_;
+
+  // dense polygon index: tileFirstPoly_[tile] + poly, -1 for empty tiles
+  std::vector<int> tileFirstPoly_;
+  // vertices of polygon i are polyVertices_[polyFirstVertex_[i]] up to
+  // polyVertices_[polyFirstVertex_[i + 1]]
+  std::vector<int> polyFirstVertex_;
+  std::vector<int> polyVertices_;
+
+  // vertices shared between polygons (and tiles) are merged
+  std::vector<vec3f> vertices_;
+  std::vector<float> vertexDistance_;
+  // index into goals_ of the goal each vertex is closest to, -1 if none
+  std::vector<int> vertexGoal_;
+
+  void build();
+
+  // distanceFrom() and closestGoal()
+  float closest(const vec3f& pt, int* goal) const;
+
+  // dense index of the polygon ref, -1 if it does not belong to the field
+  int polyIndex(uint64_t ref) const;
+
+  ESP_SMART_POINTERS(GeodesicDistanceField)
+};
+
+}  // namespace nav
+}  // namespace esp
@@ -10,19 +10,63 @@ namespace esp {
 
 using Magnum::EigenIntegration::cast;
 
+constexpr size_t nav::GreedyGeodesicFollowerImpl::pathCacheSize;
+
+void nav::GreedyGeodesicFollowerImpl::reset() {
+  pathCache_.clear();
+  hasForwardMove_ = false;
+  navMeshRevision_ = pathfinder_->getNavMeshRevision();
+}
+
+void nav::GreedyGeodesicFollowerImpl::dropStaleCaches() {
+  if (pathfinder_->getNavMeshRevision() != navMeshRevision_) {
+    reset();
+  }
+}
+
+const nav::ShortestPath& nav::GreedyGeodesicFollowerImpl::cachedPath(
+    const vec3f& start,
+    const vec3f& end) {
+  for (const ShortestPath& path : pathCache_) {
+    if (path.requestedStart == start && path.requestedEnd == end) {
+      return path;
+    }
+  }
+
+  if (pathCache_.size() == pathCacheSize) {
+    pathCache_.pop_back();
+  }
+  pathCache_.emplace_front();
+  ShortestPath& path = pathCache_.front();
+  path.requestedStart = start;
+  path.requestedEnd = end;
+  pathfinder_->findPath(path);
+  return path;
+}
+
+const vec3f& nav::GreedyGeodesicFollowerImpl::forwardPosition(
+    const State& state) {
+  if (hasForwardMove_ && std::get<0>(forwardFrom_) == std::get<0>(state) &&
+      std::get<1>(forwardFrom_).coeffs() == std::get<1>(state).coeffs()) {
+    return forwardTo_;
+  }
+
+  dummyNode_.setTranslation(Magnum::Vector3{std::get<0>(state)});
+  dummyNode_.setRotation(Magnum::Quaternion{std::get<1>(state)});
+  moveForward_(&dummyNode_);
+  forwardFrom_ = state;
+  forwardTo_ = cast<vec3f>(dummyNode_.absoluteTransformation().translation());
+  hasForwardMove_ = true;
+  return forwardTo_;
+}
+
 // There are some cases were we can't perfectly align along the shortest path
 // and the agent will get stuck, so we need to check that forward will actually
 // move us forward, if it doesn't, we will check to see if either of the turn
 // directions + forward will make progress, if neither do, return an error
 nav::GreedyGeodesicFollowerImpl::CODES
 nav::GreedyGeodesicFollowerImpl::checkForward(const State& state) {
-  dummyNode_.setTranslation(Magnum::Vector3{std::get<0>(state)});
-  dummyNode_.setRotation(Magnum::Quaternion{std::get<1>(state)});
-
-  moveForward_(&dummyNode_);
-  float dist_travelled = (Magnum::Vector3{std::get<0>(state)} -
-                          dummyNode_.absoluteTransformation().translation())
-                             .length();
+  float dist_travelled = (std::get<0>(state) - forwardPosition(state)).norm();
 
   const float minTravel = 1e-1 * forwardAmount_;
 
@@ -90,12 +134,8 @@ nav::GreedyGeodesicFollowerImpl::calcStepAlong(
   if (alpha <= turnAmount_ + 1e-3)
     return CODES::FORWARD;
 
-  dummyNode_.setTranslation(Magnum::Vector3{std::get<0>(state)});
-  dummyNode_.setRotation(Magnum::Quaternion{std::get<1>(state)});
-  moveForward_(&dummyNode_);
-  const float newGeoDist = this->geoDist(
-      cast<vec3f>(dummyNode_.absoluteTransformation().translation()),
-      path.requestedEnd);
+  const float newGeoDist =
+      this->geoDist(forwardPosition(state), path.requestedEnd);
   // There are some edge cases where the gradient doesn't line up with what
   // makes progress the fastest, so we will always try forward.  This also helps
   // reduce the amount of jittering in the path for small turn angles
@@ -117,10 +157,9 @@ nav::GreedyGeodesicFollowerImpl::CODES
 nav::GreedyGeodesicFollowerImpl::nextActionAlong(
     const std::tuple<vec3f, quatf>& start,
     const vec3f& end) {
-  nav::ShortestPath path;
-  path.requestedStart = std::get<0>(start);
-  path.requestedEnd = end;
-  pathfinder_->findPath(path);
+  dropStaleCaches();
+  // copied, as calcStepAlong may push it out of the cache
+  const nav::ShortestPath path = cachedPath(std::get<0>(start), end);
 
   CODES action = calcStepAlong(start, path);
   if (action == CODES::FORWARD)
@@ -133,14 +172,39 @@ std::vector<nav::GreedyGeodesicFollowerImpl::CODES>
 nav::GreedyGeodesicFollowerImpl::findPath(
     const std::tuple<vec3f, quatf>& startState,
     const vec3f& end) {
+  return simulatePath(startState, end, nullptr);
+}
+
+nav::GreedyGeodesicFollowerImpl::PathActions
+nav::GreedyGeodesicFollowerImpl::findPathActions(
+    const std::tuple<vec3f, quatf>& startState,
+    const vec3f& end) {
+  std::vector<State> states;
+  PathActions result;
+  result.actions = simulatePath(startState, end, &states);
+  if (result.actions.empty()) {
+    return result;
+  }
+  result.positions.reserve(states.size());
+  result.rotations.reserve(states.size());
+  for (const State& state : states) {
+    result.positions.emplace_back(std::get<0>(state));
+    result.rotations.emplace_back(std::get<1>(state).coeffs());
+  }
+  return result;
+}
+
+std::vector<nav::GreedyGeodesicFollowerImpl::CODES>
+nav::GreedyGeodesicFollowerImpl::simulatePath(
+    const std::tuple<vec3f, quatf>& startState,
+    const vec3f& end,
+    std::vector<State>* states) {
+  dropStaleCaches();
   constexpr int maxActions = 1e4;
   std::vector<CODES> actions;
 
   std::tuple<vec3f, quatf> state = startState;
-  nav::ShortestPath path;
-  path.requestedStart = std::get<0>(state);
-  path.requestedEnd = end;
-  pathfinder_->findPath(path);
+  nav::ShortestPath path = cachedPath(std::get<0>(state), end);
 
   do {
     CODES nextAction = calcStepAlong(state, path);
@@ -148,19 +212,21 @@ nav::GreedyGeodesicFollowerImpl::findPath(
       nextAction = checkForward(state);
 
     actions.push_back(nextAction);
+    if (states) {
+      states->push_back(state);
+    }
+
+    if (nextAction == CODES::FORWARD) {
+      // usually both the move and the path from its end are cached already
+      state = std::make_tuple(forwardPosition(state), std::get<1>(state));
+      path = cachedPath(std::get<0>(state), end);
+      continue;
+    }
 
     dummyNode_.setTranslation(Magnum::Vector3{std::get<0>(state)});
     dummyNode_.setRotation(Magnum::Quaternion{std::get<1>(state)});
 
     switch (nextAction) {
-      case CODES::FORWARD:
-        moveForward_(&dummyNode_);
-
-        path.requestedStart =
-            cast<vec3f>(dummyNode_.absoluteTransformation().translation());
-        pathfinder_->findPath(path);
-        break;
-
       case CODES::LEFT:
         turnLeft_(&dummyNode_);
         break;
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <deque>
+
 #include "esp/core/esp.h"
 #include "esp/nav/PathFinder.h"
 #include "esp/scene/SceneGraph.h"
@@ -94,6 +96,41 @@ class GreedyGeodesicFollowerImpl {
     return findPath(std::make_tuple(startPos, rot), end);
   }
 
+  /**
+   * Actions of a whole episode along with the state of the agent before each
+   *action, with rotations as quaternion coefficients (x, y, z, w)
+   **/
+  struct PathActions {
+    std::vector<CODES> actions;
+    std::vector<vec3f> positions;
+    std::vector<vec4f> rotations;
+  };
+
+  PathActions findPathActions(const State& start, const vec3f& end);
+
+  /**
+   * Simulates the whole episode from the start state to the end location and
+   *returns its actions and states. Same as findPath but also returns the
+   *states, so no per-step calls are needed to record a trajectory
+   *
+   * Params
+   * @param[in] startPos The starting position
+   * @param[in] startRot The starting rotation
+   * @param[in] end The end location of the path
+   **/
+  inline PathActions findPathActions(const vec3f& startPos,
+                                     const vec4f& startRot,
+                                     const vec3f& end) {
+    quatf rot = Eigen::Map<const quatf>(startRot.data());
+    return findPathActions(std::make_tuple(startPos, rot), end);
+  }
+
+  /**
+   * Drops the cached paths and moves. They are also dropped when the navmesh
+   * of the pathfinder changes, see PathFinder::getNavMeshRevision()
+   **/
+  void reset();
+
  private:
   PathFinder::ptr pathfinder_;
   MoveFn moveForward_, turnLeft_, turnRight_;
@@ -102,18 +139,45 @@ class GreedyGeodesicFollowerImpl {
   scene::SceneGraph dummyScene_;
   scene::SceneNode dummyNode_{dummyScene_.getRootNode()};
 
+  // The trial forward move of calcStepAlong ends where the agent goes if it
+  // does move forward, so the path searched from there is also the path of
+  // the next step. The most recent paths are kept and reused when a path
+  // with the same start and end is requested again, also across calls of
+  // nextActionAlong
+  static constexpr size_t pathCacheSize = 4;
+  std::deque<ShortestPath> pathCache_;
+
+  // The forward move from forwardFrom_ ends at forwardTo_, shared by
+  // calcStepAlong, checkForward and findPath
+  bool hasForwardMove_ = false;
+  State forwardFrom_;
+  vec3f forwardTo_;
+
+  // navmesh revision of the pathfinder the caches above were made on
+  uint64_t navMeshRevision_ = 0;
+
+  // reset() if the navmesh changed since the caches were made
+  void dropStaleCaches();
+
   CODES calcStepAlong(const State& start, const ShortestPath& path);
 
+  const ShortestPath& cachedPath(const vec3f& start, const vec3f& end);
+
   inline float geoDist(const vec3f& start, const vec3f& end) {
-    ShortestPath path;
-    path.requestedStart = start;
-    path.requestedEnd = end;
-    pathfinder_->findPath(path);
-    return path.geodesicDistance;
+    return cachedPath(start, end).geodesicDistance;
   }
 
+  // position reached by moving forward from state
+  const vec3f& forwardPosition(const State& state);
+
   CODES checkForward(const State& state);
 
+  // Simulate the episode from start to end; the state before each action is
+  // appended to states if it is not null. Actions are empty on failure
+  std::vector<CODES> simulatePath(const State& start,
+                                  const vec3f& end,
+                                  std::vector<State>* states);
+
   ESP_SMART_POINTERS(GreedyGeodesicFollowerImpl)
 };
 
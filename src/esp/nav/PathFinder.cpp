@@ -3,7 +3,16 @@
 // LICENSE file in the root directory of this source tree.
 
 #include "PathFinder.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <list>
+#include <map>
+#include <memory>
+#include <queue>
+#include <random>
 #include <stack>
+#include <tuple>
 #include <unordered_map>
 
 #include <Magnum/Magnum.h>
@@ -18,8 +27,17 @@
 #include <limits>
 
 #include "esp/assets/MeshData.h"
+#include "esp/core/Arena.h"
+#include "esp/core/Profiling.h"
+#include "esp/core/ThreadPool.h"
 #include "esp/core/esp.h"
+#include "esp/io/cache.h"
+#include "esp/io/io.h"
+#include "esp/core/MemoryTracking.h"
+#include "esp/nav/GeodesicDistanceField.h"
 
+#include "DetourAlloc.h"
+#include "DetourCommon.h"
 #include "DetourNavMesh.h"
 #include "DetourNavMeshBuilder.h"
 #include "DetourNavMeshQuery.h"
@@ -32,6 +50,27 @@ namespace esp {
 namespace nav {
 namespace {
 
+#ifdef ESP_BUILD_WITH_MEMORY_TRACKING
+void* navAlloc(size_t size, dtAllocHint) {
+  return core::trackedMalloc(core::MemoryTag::Navigation, size);
+}
+
+void* recastAlloc(size_t size, rcAllocHint) {
+  return core::trackedMalloc(core::MemoryTag::Navigation, size);
+}
+
+void navFree(void* ptr) {
+  core::trackedFree(core::MemoryTag::Navigation, ptr);
+}
+
+// installed during static initialization, before any navmesh is allocated
+const bool navAllocatorsInstalled = [] {
+  dtAllocSetCustom(navAlloc, navFree);
+  rcAllocSetCustom(recastAlloc, navFree);
+  return true;
+}();
+#endif
+
 template <typename T>
 std::tuple<dtStatus, dtPolyRef, vec3f> projectToPoly(
     const T& pt,
@@ -48,6 +87,52 @@ std::tuple<dtStatus, dtPolyRef, vec3f> projectToPoly(
 
   return std::make_tuple(status, polyRef, polyXYZ);
 }
+
+// Squared distance transform of the n samples of f at stride, in place,
+// after Felzenszwalb and Huttenlocher, "Distance Transforms of Sampled
+// Functions"; v and z are scratch space of n and n + 1 elements
+void distanceTransform1D(float* f,
+                         int n,
+                         int stride,
+                         std::vector<float>& d,
+                         std::vector<int>& v,
+                         std::vector<float>& z) {
+  constexpr float inf = std::numeric_limits<float>::infinity();
+  int k = -1;
+  for (int q = 0; q < n; ++q) {
+    const float fq = f[q * stride];
+    if (fq == inf) {
+      continue;
+    }
+    float s = -inf;
+    while (k >= 0) {
+      const int p = v[k];
+      s = ((fq + q * q) - (f[p * stride] + p * p)) / (2.0f * (q - p));
+      if (s > z[k]) {
+        break;
+      }
+      --k;
+    }
+    ++k;
+    v[k] = q;
+    z[k] = k == 0 ? -inf : s;
+    z[k + 1] = inf;
+  }
+  if (k < 0) {
+    // no finite sample, nothing to propagate
+    return;
+  }
+  for (int q = 0, j = 0; q < n; ++q) {
+    while (z[j + 1] < q) {
+      ++j;
+    }
+    const int p = v[j];
+    d[q] = (q - p) * (q - p) + f[p * stride];
+  }
+  for (int q = 0; q < n; ++q) {
+    f[q * stride] = d[q];
+  }
+}
 }  // namespace
 
 namespace impl {
@@ -55,29 +140,41 @@ namespace impl {
 // Runs connected component analysis on the navmesh to figure out which polygons
 // are connected This gives O(1) lookup for if a path between two polygons
 // exists or not
-// Takes O(npolys) to construct
+// Takes O(npolys) to construct, or can be saved and loaded with the navmesh
 class IslandSystem {
  public:
-  IslandSystem(const dtNavMesh* navMesh, const dtQueryFilter* filter) {
+  explicit IslandSystem(const dtNavMesh* navMesh) : navMesh_(navMesh) {
+    // Poly refs decompose into (tile, poly) indices, keep a dense table of
+    // islands for the polygons of each tile
+    tilePolyToIsland_.resize(navMesh->getMaxTiles());
+    for (int iTile = 0; iTile < navMesh->getMaxTiles(); ++iTile) {
+      const dtMeshTile* tile = navMesh->getTile(iTile);
+      if (!tile || !tile->header)
+        continue;
+      tilePolyToIsland_[iTile].assign(tile->header->polyCount, NO_ISLAND);
+    }
+  }
+
+  void build(const dtQueryFilter* filter) {
     std::vector<vec3f> islandVerts;
 
     // Iterate over all tiles
-    for (int iTile = 0; iTile < navMesh->getMaxTiles(); ++iTile) {
-      const dtMeshTile* tile = navMesh->getTile(iTile);
-      if (!tile)
+    for (int iTile = 0; iTile < navMesh_->getMaxTiles(); ++iTile) {
+      const dtMeshTile* tile = navMesh_->getTile(iTile);
+      if (!tile || !tile->header)
         continue;
 
       // Iterate over all polygons in a tile
       for (int jPoly = 0; jPoly < tile->header->polyCount; ++jPoly) {
         // Get the polygon reference from the tile and polygon id
-        dtPolyRef startRef = navMesh->encodePolyId(iTile, tile->salt, jPoly);
+        dtPolyRef startRef = navMesh_->getPolyRefBase(tile) | jPoly;
 
         // If the polygon ref is valid, and we haven't seen it yet,
         // start connected component analysis from this polygon
-        if (navMesh->isValidPolyRef(startRef) &&
-            (polyToIsland_.find(startRef) == polyToIsland_.end())) {
+        if (navMesh_->isValidPolyRef(startRef) &&
+            tilePolyToIsland_[iTile][jPoly] == NO_ISLAND) {
           uint32_t newIslandId = islandRadius_.size();
-          expandFrom(navMesh, filter, newIslandId, startRef, islandVerts);
+          expandFrom(filter, newIslandId, startRef, islandVerts);
 
           // The radius is calculated as the max deviation from the mean for all
           // points in the island
@@ -98,38 +195,134 @@ class IslandSystem {
     }
   }
 
+  // island index of the polygon, -1 if it is on none
+  inline int islandIndex(dtPolyRef ref) const {
+    const uint32_t island = islandOf(ref);
+    return island == NO_ISLAND ? -1 : static_cast<int>(island);
+  }
+
   inline bool hasConnection(dtPolyRef startRef, dtPolyRef endRef) const {
     // If both polygons are on the same island, there must be a path between
     // them
-    auto itStart = polyToIsland_.find(startRef);
-    if (itStart == polyToIsland_.end())
-      return false;
-
-    auto itEnd = polyToIsland_.find(endRef);
-    if (itEnd == polyToIsland_.end())
+    const uint32_t startIsland = islandOf(startRef);
+    if (startIsland == NO_ISLAND)
       return false;
 
-    return itStart->second == itEnd->second;
+    return startIsland == islandOf(endRef);
   }
 
   inline float islandRadius(dtPolyRef ref) const {
-    auto itRef = polyToIsland_.find(ref);
-    if (itRef == polyToIsland_.end())
+    const uint32_t island = islandOf(ref);
+    if (island == NO_ISLAND)
       return 0.0;
 
-    return islandRadius_[itRef->second];
+    return islandRadius_[island];
+  }
+
+  // Layout: ISLANDS_MAGIC, ISLANDS_VERSION, number of tiles, per tile the
+  // number of polygons and their islands, number of islands and their radii
+  bool save(FILE* fp) const {
+    const int header[3] = {ISLANDS_MAGIC, ISLANDS_VERSION,
+                           static_cast<int>(tilePolyToIsland_.size())};
+    bool ok = fwrite(header, sizeof(header), 1, fp) == 1;
+    for (const auto& polyToIsland : tilePolyToIsland_) {
+      const int numPolys = polyToIsland.size();
+      ok = ok && fwrite(&numPolys, sizeof(numPolys), 1, fp) == 1;
+      ok = ok && writeArray(polyToIsland, fp);
+    }
+    const int numIslands = islandRadius_.size();
+    ok = ok && fwrite(&numIslands, sizeof(numIslands), 1, fp) == 1;
+    ok = ok && writeArray(islandRadius_, fp);
+    return ok;
+  }
+
+  // Returns false, leaving the system empty, if fp holds no islands or they
+  // do not match the navmesh
+  bool load(FILE* fp) {
+    int header[3];
+    if (fread(header, sizeof(header), 1, fp) != 1 ||
+        header[0] != ISLANDS_MAGIC || header[1] != ISLANDS_VERSION ||
+        header[2] != static_cast<int>(tilePolyToIsland_.size())) {
+      return false;
+    }
+    for (auto& polyToIsland : tilePolyToIsland_) {
+      int numPolys = 0;
+      if (fread(&numPolys, sizeof(numPolys), 1, fp) != 1 ||
+          numPolys != static_cast<int>(polyToIsland.size()) ||
+          !readArray(polyToIsland, fp)) {
+        clear();
+        return false;
+      }
+    }
+    int numIslands = 0;
+    if (fread(&numIslands, sizeof(numIslands), 1, fp) != 1 || numIslands < 0) {
+      clear();
+      return false;
+    }
+    islandRadius_.resize(numIslands);
+    if (!readArray(islandRadius_, fp)) {
+      clear();
+      return false;
+    }
+    for (const auto& polyToIsland : tilePolyToIsland_) {
+      for (uint32_t island : polyToIsland) {
+        if (island != NO_ISLAND && island >= islandRadius_.size()) {
+          clear();
+          return false;
+        }
+      }
+    }
+    return true;
   }
 
  private:
-  std::unordered_map<dtPolyRef, uint32_t> polyToIsland_;
+  static constexpr uint32_t NO_ISLAND = std::numeric_limits<uint32_t>::max();
+  static constexpr int ISLANDS_MAGIC =
+      'I' << 24 | 'S' << 16 | 'L' << 8 | 'D';  //'ISLD';
+  static constexpr int ISLANDS_VERSION = 1;
+
+  const dtNavMesh* navMesh_;
+  std::vector<std::vector<uint32_t>> tilePolyToIsland_;
   std::vector<float> islandRadius_;
 
-  void expandFrom(const dtNavMesh* navMesh,
-                  const dtQueryFilter* filter,
+  inline uint32_t islandOf(dtPolyRef ref) const {
+    const unsigned int iTile = navMesh_->decodePolyIdTile(ref);
+    const unsigned int iPoly = navMesh_->decodePolyIdPoly(ref);
+    if (iTile >= tilePolyToIsland_.size() ||
+        iPoly >= tilePolyToIsland_[iTile].size())
+      return NO_ISLAND;
+    return tilePolyToIsland_[iTile][iPoly];
+  }
+
+  template <typename T>
+  static bool writeArray(const std::vector<T>& data, FILE* fp) {
+    return data.empty() ||
+           fwrite(data.data(), sizeof(T), data.size(), fp) == data.size();
+  }
+
+  template <typename T>
+  static bool readArray(std::vector<T>& data, FILE* fp) {
+    return data.empty() ||
+           fread(data.data(), sizeof(T), data.size(), fp) == data.size();
+  }
+
+  inline uint32_t& islandOfUnsafe(dtPolyRef ref) {
+    return tilePolyToIsland_[navMesh_->decodePolyIdTile(ref)]
+                            [navMesh_->decodePolyIdPoly(ref)];
+  }
+
+  void clear() {
+    for (auto& polyToIsland : tilePolyToIsland_) {
+      std::fill(polyToIsland.begin(), polyToIsland.end(), NO_ISLAND);
+    }
+    islandRadius_.clear();
+  }
+
+  void expandFrom(const dtQueryFilter* filter,
                   const uint32_t newIslandId,
                   const dtPolyRef& startRef,
                   std::vector<vec3f>& islandVerts) {
-    polyToIsland_.emplace(startRef, newIslandId);
+    islandOfUnsafe(startRef) = newIslandId;
     islandVerts.clear();
 
     // Force std::stack to be implemented via an std::vector as linked
@@ -144,7 +337,7 @@ class IslandSystem {
 
       const dtMeshTile* tile = 0;
       const dtPoly* poly = 0;
-      navMesh->getTileAndPolyByRefUnsafe(ref, &tile, &poly);
+      navMesh_->getTileAndPolyByRefUnsafe(ref, &tile, &poly);
 
       for (int iVert = 0; iVert < poly->vertCount; ++iVert) {
         islandVerts.emplace_back(
@@ -156,24 +349,250 @@ class IslandSystem {
            iLink = tile->links[iLink].next) {
         dtPolyRef neighbourRef = tile->links[iLink].ref;
         // If we've already visited this poly, skip it!
-        if (polyToIsland_.find(neighbourRef) != polyToIsland_.end())
+        if (islandOf(neighbourRef) != NO_ISLAND)
           continue;
 
         const dtMeshTile* neighbourTile = 0;
         const dtPoly* neighbourPoly = 0;
-        navMesh->getTileAndPolyByRefUnsafe(neighbourRef, &neighbourTile,
-                                           &neighbourPoly);
+        navMesh_->getTileAndPolyByRefUnsafe(neighbourRef, &neighbourTile,
+                                            &neighbourPoly);
 
         // If a neighbour isn't walkable, don't add it
         if (!filter->passFilter(neighbourRef, neighbourTile, neighbourPoly))
           continue;
 
-        polyToIsland_.emplace(neighbourRef, newIslandId);
+        islandOfUnsafe(neighbourRef) = newIslandId;
         stack.push(neighbourRef);
       }
     }
   }
 };
+
+constexpr uint32_t IslandSystem::NO_ISLAND;
+constexpr int IslandSystem::ISLANDS_MAGIC;
+constexpr int IslandSystem::ISLANDS_VERSION;
+
+// Rasterized heightfields of the tiles of navmesh builds, before the
+// filtering that depends on the agent. The spans of each heightfield are kept
+// column by column like rcSpan, packed into 32 bits each
+class HeightfieldCache {
+ public:
+  // What rasterizing a tile depends on, besides its border. All fields are
+  // 4 bytes, so keys compare and hash as bytes
+  struct Key {
+    // CRC of the vertices and triangles of the source mesh
+    uint32_t geometry;
+    float cs;
+    float ch;
+    float walkableSlopeAngle;
+    int32_t walkableClimb;
+    // origin of the tile grid, and top of the heightfield
+    float orig[3];
+    float maxY;
+    int32_t tileX;
+    int32_t tileY;
+    // cells of a tile, without border
+    int32_t width;
+    int32_t height;
+
+    bool operator==(const Key& other) const {
+      return std::memcmp(this, &other, sizeof(Key)) == 0;
+    }
+  };
+
+  struct KeyHash {
+    size_t operator()(const Key& key) const {
+      return io::crc32(&key, sizeof(Key));
+    }
+  };
+
+  struct Entry {
+    // border cells around the tile, included in width and height
+    int32_t border = 0;
+    int32_t width = 0;
+    int32_t height = 0;
+    // spans of column x + y * width are [columns[i], columns[i + 1])
+    std::vector<uint32_t> columns;
+    std::vector<uint32_t> spans;
+
+    size_t bytes() const {
+      return (columns.size() + spans.size()) * sizeof(uint32_t);
+    }
+  };
+
+  // Cached heightfield of key with a border of at least border, null if
+  // there is none. Counts a hit or a miss
+  std::shared_ptr<const Entry> find(const Key& key, int border) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(key);
+    if (it == entries_.end() || it->second->border < border) {
+      ++stats_.misses;
+      return nullptr;
+    }
+    ++stats_.hits;
+    return it->second;
+  }
+
+  void insert(const Key& key, std::shared_ptr<const Entry> entry) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& cached = entries_[key];
+    if (!cached || cached->border < entry->border) {
+      cached = std::move(entry);
+      dirty_ = true;
+    }
+  }
+
+  static void pack(const rcHeightfield& hf, int border, Entry& entry) {
+    entry.border = border;
+    entry.width = hf.width;
+    entry.height = hf.height;
+    entry.columns.resize(hf.width * hf.height + 1);
+    entry.spans.clear();
+    for (int i = 0; i < hf.width * hf.height; ++i) {
+      entry.columns[i] = entry.spans.size();
+      for (const rcSpan* s = hf.spans[i]; s; s = s->next) {
+        entry.spans.push_back(uint32_t(s->smin) |
+                              uint32_t(s->smax) << RC_SPAN_HEIGHT_BITS |
+                              uint32_t(s->area) << (2 * RC_SPAN_HEIGHT_BITS));
+      }
+    }
+    entry.columns.back() = entry.spans.size();
+  }
+
+  // Add the spans of entry to the empty heightfield hf, whose border is
+  // offset cells narrower
+  static bool unpack(rcContext& ctx,
+                     const Entry& entry,
+                     int offset,
+                     rcHeightfield& hf) {
+    constexpr uint32_t heightMask = (1 << RC_SPAN_HEIGHT_BITS) - 1;
+    if (hf.width + 2 * offset > entry.width ||
+        hf.height + 2 * offset > entry.height) {
+      return false;
+    }
+    for (int y = 0; y < hf.height; ++y) {
+      for (int x = 0; x < hf.width; ++x) {
+        const int column = (x + offset) + (y + offset) * entry.width;
+        for (uint32_t i = entry.columns[column]; i < entry.columns[column + 1];
+             ++i) {
+          const uint32_t span = entry.spans[i];
+          // spans of a column never touch, so nothing is merged
+          if (!rcAddSpan(&ctx, hf, x, y, span & heightMask,
+                         (span >> RC_SPAN_HEIGHT_BITS) & heightMask,
+                         span >> (2 * RC_SPAN_HEIGHT_BITS), 0)) {
+            return false;
+          }
+        }
+      }
+    }
+    return true;
+  }
+
+  HeightfieldCacheStats getStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    HeightfieldCacheStats stats = stats_;
+    stats.size = entries_.size();
+    for (const auto& entry : entries_) {
+      stats.bytes += entry.second->bytes();
+    }
+    return stats;
+  }
+
+  // Three sections per heightfield: key, then border, width and height, then
+  // columns and spans
+  bool save(const std::string& file) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<Key> keys;
+    std::vector<int32_t> sizes;
+    std::vector<const Entry*> entries;
+    for (const auto& entry : entries_) {
+      keys.push_back(entry.first);
+      sizes.insert(sizes.end(), {entry.second->border, entry.second->width,
+                                 entry.second->height});
+      entries.push_back(entry.second.get());
+    }
+    io::CacheWriter writer(cacheKind, cacheVersion, "");
+    writer.addSection(keys);
+    writer.addSection(sizes);
+    for (const Entry* entry : entries) {
+      writer.addSection(entry->columns);
+      writer.addSection(entry->spans);
+    }
+    if (!writer.write(file)) {
+      return false;
+    }
+    dirty_ = false;
+    return true;
+  }
+
+  // Adds the heightfields of a file written by save(), false if it is
+  // missing or corrupted
+  bool load(const std::string& file) {
+    const io::CacheReader reader(file, cacheKind, cacheVersion, "");
+    std::vector<Key> keys;
+    std::vector<int32_t> sizes;
+    if (!reader.isValid() || !reader.readSection(0, keys) ||
+        !reader.readSection(1, sizes) || sizes.size() != 3 * keys.size() ||
+        reader.getNumSections() != 2 + 2 * keys.size()) {
+      return false;
+    }
+    std::vector<std::shared_ptr<const Entry>> entries;
+    for (size_t i = 0; i < keys.size(); ++i) {
+      auto entry = std::make_shared<Entry>();
+      entry->border = sizes[3 * i];
+      entry->width = sizes[3 * i + 1];
+      entry->height = sizes[3 * i + 2];
+      if (entry->border < 0 || entry->width <= 0 || entry->height <= 0 ||
+          !reader.readSection(2 + 2 * i, entry->columns) ||
+          !reader.readSection(3 + 2 * i, entry->spans) ||
+          entry->columns.size() !=
+              size_t(entry->width) * entry->height + 1 ||
+          entry->columns.front() != 0 ||
+          entry->columns.back() != entry->spans.size() ||
+          !std::is_sorted(entry->columns.begin(), entry->columns.end())) {
+        return false;
+      }
+      entries.emplace_back(std::move(entry));
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < keys.size(); ++i) {
+      entries_[keys[i]] = std::move(entries[i]);
+    }
+    return true;
+  }
+
+  // whether heightfields were added since the last save()
+  bool isDirty() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return dirty_;
+  }
+
+  // file the heightfields are saved to, empty if none
+  std::string file;
+
+ private:
+  static constexpr uint32_t cacheKind = 107;
+  static constexpr uint32_t cacheVersion = 1;
+
+  mutable std::mutex mutex_;
+  std::unordered_map<Key, std::shared_ptr<const Entry>, KeyHash> entries_;
+  HeightfieldCacheStats stats_;
+  bool dirty_ = false;
+};
+
+static_assert(sizeof(HeightfieldCache::Key) == 13 * 4,
+              "heightfield cache keys must not have padding");
+constexpr uint32_t HeightfieldCache::cacheKind;
+constexpr uint32_t HeightfieldCache::cacheVersion;
+
+// Where buildNavMeshData() takes the heightfield of a tile from
+struct HeightfieldSource {
+  HeightfieldCache* cache;
+  HeightfieldCache::Key key;
+  // border cells to rasterize the tile with if it is not cached, at least
+  // the border of its config
+  int rasterBorder;
+};
 }  // namespace impl
 }  // namespace nav
 }  // namespace esp
@@ -205,76 +624,15 @@ enum PolyFlags {
   POLYFLAGS_ALL = 0xffff      // all abilities
 };
 
-esp::nav::PathFinder::PathFinder() : navMesh_(0), navQuery_(0), filter_(0) {
-  filter_ = new dtQueryFilter();
-  filter_->setIncludeFlags(POLYFLAGS_WALK);
-  filter_->setExcludeFlags(0);
-}
-
-void esp::nav::PathFinder::free() {
-  if (navMesh_) {
-    dtFreeNavMesh(navMesh_);
-    navMesh_ = 0;
-  }
-  if (navQuery_) {
-    dtFreeNavMeshQuery(navQuery_);
-    navQuery_ = 0;
-  }
-  if (filter_) {
-    delete filter_;
-  }
-
-  if (islandSystem_) {
-    delete islandSystem_;
-  }
-}
-
-bool esp::nav::PathFinder::build(const NavMeshSettings& bs,
-                                 const float* verts,
-                                 const int nverts,
-                                 const int* tris,
-                                 const int ntris,
-                                 const float* bmin,
-                                 const float* bmax) {
-  Workspace ws;
-  rcContext ctx;
-
-  //
-  // Step 1. Initialize build config.
-  //
-
-  // Init build configuration from GUI
-  rcConfig cfg;
-  memset(&cfg, 0, sizeof(cfg));
-  cfg.cs = bs.cellSize;
-  cfg.ch = bs.cellHeight;
-  cfg.walkableSlopeAngle = bs.agentMaxSlope;
-  cfg.walkableHeight = (int)ceilf(bs.agentHeight / cfg.ch);
-  cfg.walkableClimb = (int)floorf(bs.agentMaxClimb / cfg.ch);
-  cfg.walkableRadius = (int)ceilf(bs.agentRadius / cfg.cs);
-  cfg.maxEdgeLen = (int)(bs.edgeMaxLen / bs.cellSize);
-  cfg.maxSimplificationError = bs.edgeMaxError;
-  cfg.minRegionArea = (int)rcSqr(bs.regionMinSize);  // Note: area = size*size
-  cfg.mergeRegionArea =
-      (int)rcSqr(bs.regionMergeSize);  // Note: area = size*size
-  cfg.maxVertsPerPoly = (int)bs.vertsPerPoly;
-  cfg.detailSampleDist =
-      bs.detailSampleDist < 0.9f ? 0 : bs.cellSize * bs.detailSampleDist;
-  cfg.detailSampleMaxError = bs.cellHeight * bs.detailSampleMaxError;
-
-  // Set the area where the navigation will be build.
-  // Here the bounds of the input mesh are used, but the
-  // area could be specified by an user defined box, etc.
-  rcVcopy(cfg.bmin, bmin);
-  rcVcopy(cfg.bmax, bmax);
-  rcCalcGridSize(cfg.bmin, cfg.bmax, cfg.cs, &cfg.width, &cfg.height);
-  LOG(INFO) << "Building navmesh with " << cfg.width << "x" << cfg.height
-            << " cells";
-
-  //
-  // Step 2. Rasterize input polygon soup.
-  //
-
+// Rasterizes the triangles into a new heightfield of cfg, ws.solid, marking
+// the walkable ones by their slope
+bool rasterizeTriangles(rcContext& ctx,
+                        const rcConfig& cfg,
+                        const float* verts,
+                        const int nverts,
+                        const int* tris,
+                        const int ntris,
+                        Workspace& ws) {
   // Allocate voxel heightfield where we rasterize our input data to.
   ws.solid = rcAllocHeightfield();
   if (!ws.solid) {
@@ -307,6 +665,95 @@ bool esp::nav::PathFinder::build(const NavMeshSettings& bs,
     LOG(ERROR) << "Could not rasterize triangles.";
     return false;
   }
+  return true;
+}
+
+// ws.solid of cfg from the cache of source, rasterizing the tile with the
+// border of source first if it is not cached
+bool cachedHeightfield(rcContext& ctx,
+                       const rcConfig& cfg,
+                       const float* verts,
+                       const int nverts,
+                       const int* tris,
+                       const int ntris,
+                       const esp::nav::impl::HeightfieldSource& source,
+                       Workspace& ws) {
+  using esp::nav::impl::HeightfieldCache;
+  std::shared_ptr<const HeightfieldCache::Entry> entry =
+      source.cache->find(source.key, cfg.borderSize);
+  if (!entry) {
+    // grow the tile by the extra border, in whole cells
+    const int extra = source.rasterBorder - cfg.borderSize;
+    rcConfig rasterCfg = cfg;
+    rasterCfg.borderSize = source.rasterBorder;
+    rasterCfg.width += 2 * extra;
+    rasterCfg.height += 2 * extra;
+    rasterCfg.bmin[0] -= extra * cfg.cs;
+    rasterCfg.bmin[2] -= extra * cfg.cs;
+    rasterCfg.bmax[0] += extra * cfg.cs;
+    rasterCfg.bmax[2] += extra * cfg.cs;
+    Workspace raster;
+    if (!rasterizeTriangles(ctx, rasterCfg, verts, nverts, tris, ntris,
+                            raster)) {
+      return false;
+    }
+    auto rasterized = std::make_shared<HeightfieldCache::Entry>();
+    HeightfieldCache::pack(*raster.solid, source.rasterBorder, *rasterized);
+    source.cache->insert(source.key, rasterized);
+    entry = std::move(rasterized);
+  }
+
+  ws.solid = rcAllocHeightfield();
+  if (!ws.solid) {
+    LOG(ERROR) << "Out of memory for heightfield allocation";
+    return false;
+  }
+  if (!rcCreateHeightfield(&ctx, *ws.solid, cfg.width, cfg.height, cfg.bmin,
+                           cfg.bmax, cfg.cs, cfg.ch) ||
+      !HeightfieldCache::unpack(ctx, *entry, entry->border - cfg.borderSize,
+                                *ws.solid)) {
+    LOG(ERROR) << "Could not create solid heightfield";
+    return false;
+  }
+  return true;
+}
+
+// Runs the Recast pipeline on the triangles of one tile of the navmesh (or on
+// the whole mesh for a solo navmesh) and creates its Detour data. Tiles
+// without walkable area succeed with navData == nullptr. With a source, the
+// heightfield is taken from its cache instead of rasterized, and the
+// triangles have to cover the raster border of the source
+bool buildNavMeshData(const esp::nav::NavMeshSettings& bs,
+                      const rcConfig& cfg,
+                      const float* verts,
+                      const int nverts,
+                      const int* tris,
+                      const int ntris,
+                      const int tileX,
+                      const int tileY,
+                      unsigned char*& navData,
+                      int& navDataSize,
+                      int& numPolys,
+                      const esp::nav::impl::HeightfieldSource* source =
+                          nullptr) {
+  Workspace ws;
+  rcContext ctx;
+  navData = nullptr;
+  navDataSize = 0;
+  numPolys = 0;
+
+  //
+  // Step 2. Rasterize input polygon soup.
+  //
+
+  if (source) {
+    if (!cachedHeightfield(ctx, cfg, verts, nverts, tris, ntris, *source,
+                           ws)) {
+      return false;
+    }
+  } else if (!rasterizeTriangles(ctx, cfg, verts, nverts, tris, ntris, ws)) {
+    return false;
+  }
 
   //
   // Step 3. Filter walkables surfaces.
@@ -393,7 +840,7 @@ bool esp::nav::PathFinder::build(const NavMeshSettings& bs,
     return false;
   }
   // Partition the walkable surface into simple regions without holes.
-  if (!rcBuildRegions(&ctx, *ws.chf, 0, cfg.minRegionArea,
+  if (!rcBuildRegions(&ctx, *ws.chf, cfg.borderSize, cfg.minRegionArea,
                       cfg.mergeRegionArea)) {
     LOG(ERROR) << "Could not build watershed regions";
     return false;
@@ -461,12 +908,12 @@ bool esp::nav::PathFinder::build(const NavMeshSettings& bs,
   // (Optional) Step 8. Create Detour data from Recast poly mesh.
   //
 
-  // The GUI may allow more max points per polygon than Detour can handle.
-  // Only build the detour navmesh if we do not exceed the limit.
-  if (cfg.maxVertsPerPoly <= DT_VERTS_PER_POLYGON) {
-    unsigned char* navData = 0;
-    int navDataSize = 0;
+  // Tiles without walkable area produce no data
+  if (ws.pmesh->nverts == 0 || ws.pmesh->npolys == 0) {
+    return true;
+  }
 
+  {
     // Update poly flags from areas.
     for (int i = 0; i < ws.pmesh->npolys; ++i) {
       if (ws.pmesh->areas[i] == RC_WALKABLE_AREA) {
@@ -508,66 +955,1136 @@ bool esp::nav::PathFinder::build(const NavMeshSettings& bs,
     params.cs = cfg.cs;
     params.ch = cfg.ch;
     params.buildBvTree = true;
+    params.tileX = tileX;
+    params.tileY = tileY;
 
     if (!dtCreateNavMeshData(&params, &navData, &navDataSize)) {
       LOG(ERROR) << "Could not build Detour navmesh";
       return false;
     }
-
-    navMesh_ = 0;
-    navMesh_ = dtAllocNavMesh();
-    if (!navMesh_) {
-      dtFree(navData);
-      LOG(ERROR) << "Could not allocate Detour navmesh";
-      return false;
-    }
-
-    dtStatus status;
-    status = navMesh_->init(navData, navDataSize, DT_TILE_FREE_DATA);
-    if (dtStatusFailed(status)) {
-      dtFree(navData);
-      LOG(ERROR) << "Could not init Detour navmesh";
-      return false;
-    }
-    if (!initNavQuery()) {
-      return false;
-    }
+    numPolys = ws.pmesh->npolys;
   }
 
-  LOG(INFO) << "Created navmesh with " << ws.pmesh->nverts << " vertices "
-            << ws.pmesh->npolys << " polygons";
-
   return true;
 }
 
-bool esp::nav::PathFinder::initNavQuery() {
-  navQuery_ = dtAllocNavMeshQuery();
-  dtStatus status = navQuery_->init(navMesh_, 2048);
-  if (dtStatusFailed(status)) {
-    LOG(ERROR) << "Could not init Detour navmesh query";
-    return false;
+// Builds a navmesh of a single tile, from the heightfield cache of source if
+// it is not null
+dtNavMesh* buildSoloNavMesh(const esp::nav::NavMeshSettings& bs,
+                            const rcConfig& cfg,
+                            const float* verts,
+                            const int nverts,
+                            const int* tris,
+                            const int ntris,
+                            const esp::nav::impl::HeightfieldSource* source) {
+  unsigned char* navData = nullptr;
+  int navDataSize = 0;
+  int numPolys = 0;
+  if (!buildNavMeshData(bs, cfg, verts, nverts, tris, ntris, 0, 0, navData,
+                        navDataSize, numPolys, source)) {
+    return nullptr;
+  }
+  if (!navData) {
+    LOG(ERROR) << "Navmesh has no walkable area";
+    return nullptr;
+  }
+
+  dtNavMesh* navMesh = dtAllocNavMesh();
+  if (!navMesh) {
+    dtFree(navData);
+    LOG(ERROR) << "Could not allocate Detour navmesh";
+    return nullptr;
   }
 
-  islandSystem_ = new impl::IslandSystem(navMesh_, filter_);
+  dtStatus status = navMesh->init(navData, navDataSize, DT_TILE_FREE_DATA);
+  if (dtStatusFailed(status)) {
+    dtFree(navData);
+    dtFreeNavMesh(navMesh);
+    LOG(ERROR) << "Could not init Detour navmesh";
+    return nullptr;
+  }
 
-  return true;
+  LOG(INFO) << "Created navmesh with " << numPolys << " polygons";
+  return navMesh;
 }
 
-bool esp::nav::PathFinder::build(const NavMeshSettings& bs,
-                                 const esp::assets::MeshData& mesh) {
-  const int numVerts = mesh.vbo.size();
-  const int numIndices = mesh.ibo.size();
-  const float mf = std::numeric_limits<float>::max();
-  vec3f bmin(mf, mf, mf);
-  vec3f bmax(-mf, -mf, -mf);
+namespace esp {
+namespace nav {
+namespace impl {
 
-  for (int i = 0; i < numVerts; i++) {
-    const vec3f& p = mesh.vbo[i];
-    bmin = bmin.cwiseMin(p);
-    bmax = bmax.cwiseMax(p);
+// Source geometry and tile layout of a tiled navmesh, kept so that single
+// tiles can be rebuilt when obstacles are added, moved or removed
+struct TileBuilder {
+  struct TileData {
+    unsigned char* navData = nullptr;
+    int navDataSize = 0;
+    int numPolys = 0;
+  };
+
+  // Triangles in world space, rasterized together with the source mesh
+  struct Obstacle {
+    std::vector<float> verts;
+    std::vector<int> tris;
+    vec3f bmin;
+    vec3f bmax;
+  };
+
+  TileBuilder(const NavMeshSettings& bs,
+              const rcConfig& cfg,
+              const float* sourceVerts,
+              const int nverts,
+              const int* sourceTris,
+              const int ntris)
+      : settings(bs),
+        verts(sourceVerts, sourceVerts + nverts * 3),
+        tris(sourceTris, sourceTris + ntris * 3),
+        numSourceVerts(nverts),
+        numSourceTris(ntris) {
+    tileSize = static_cast<int>(bs.tileSize);
+    tilesX = (cfg.width + tileSize - 1) / tileSize;
+    tilesY = (cfg.height + tileSize - 1) / tileSize;
+    tileWorldSize = tileSize * cfg.cs;
+    rcVcopy(orig, cfg.bmin);
+    sourceMinY = minY = cfg.bmin[1];
+    sourceMaxY = maxY = cfg.bmax[1];
+
+    // Tiles overlap their neighbours by a border, so that regions and
+    // contours match up at the tile edges
+    tileCfg = cfg;
+    tileCfg.tileSize = tileSize;
+    tileCfg.borderSize = cfg.walkableRadius + 3;
+    tileCfg.width = tileSize + tileCfg.borderSize * 2;
+    tileCfg.height = tileSize + tileCfg.borderSize * 2;
+    border = tileCfg.borderSize * cfg.cs;
   }
 
-  int* indices = new int[numIndices];
+  // Rebuild verts, tris and the height range from the source mesh and all
+  // obstacles
+  void updateGeometry() {
+    verts.resize(numSourceVerts * 3);
+    tris.resize(numSourceTris * 3);
+    minY = sourceMinY;
+    maxY = sourceMaxY;
+    for (const auto& obstacle : obstacles) {
+      minY = rcMin(minY, obstacle.second.bmin[1]);
+      maxY = rcMax(maxY, obstacle.second.bmax[1]);
+      const int firstVert = verts.size() / 3;
+      verts.insert(verts.end(), obstacle.second.verts.begin(),
+                   obstacle.second.verts.end());
+      for (int index : obstacle.second.tris) {
+        tris.push_back(firstVert + index);
+      }
+    }
+  }
+
+  // Range of the tiles whose bounds, including the border, overlap the x-z
+  // extent of [bmin, bmax]
+  void tileRange(const vec3f& bmin,
+                 const vec3f& bmax,
+                 int& minTileX,
+                 int& minTileY,
+                 int& maxTileX,
+                 int& maxTileY) const {
+    auto tileIndex = [&](float x, float origin, int numTiles) {
+      const int index = static_cast<int>(floorf((x - origin) / tileWorldSize));
+      return rcClamp(index, 0, numTiles - 1);
+    };
+    minTileX = tileIndex(bmin[0] - border, orig[0], tilesX);
+    minTileY = tileIndex(bmin[2] - border, orig[2], tilesY);
+    maxTileX = tileIndex(bmax[0] + border, orig[0], tilesX);
+    maxTileY = tileIndex(bmax[2] + border, orig[2], tilesY);
+  }
+
+  // Build the given tiles (x, y) on the shared thread pool. Tiles without
+  // walkable area have no navData
+  // have no navData
+  bool buildTiles(const std::vector<std::pair<int, int>>& tiles,
+                  std::vector<TileData>& tileData) const {
+    tileData.assign(tiles.size(), TileData());
+    std::atomic<bool> failed{false};
+    // triangles of the tile being built, by slot
+    std::vector<std::vector<int>> slotTris(
+        core::ThreadPool::global().getNumThreads());
+
+    // Tiles are built independently, only adding them to the navmesh is
+    // serial
+    // cached heightfields are of the source mesh alone
+    const bool cached = heightfields && obstacles.empty();
+    const int rasterBorder = cached ? 2 * tileCfg.borderSize : 0;
+    const float rasterExtra = (rasterBorder - tileCfg.borderSize) * tileCfg.cs;
+
+    core::parallelForWithSlots(tiles.size(), 0, [&](size_t iTile, int slot) {
+      if (failed)
+        return;
+      std::vector<int>& tileTris = slotTris[slot];
+      const int tileX = tiles[iTile].first;
+      const int tileY = tiles[iTile].second;
+      rcConfig config = tileCfg;
+      config.bmin[1] = minY;
+      config.bmax[1] = maxY;
+      config.bmin[0] = orig[0] + tileX * tileWorldSize - border;
+      config.bmin[2] = orig[2] + tileY * tileWorldSize - border;
+      config.bmax[0] = orig[0] + (tileX + 1) * tileWorldSize + border;
+      config.bmax[2] = orig[2] + (tileY + 1) * tileWorldSize + border;
+
+      HeightfieldSource source;
+      float rasterMin[2] = {config.bmin[0], config.bmin[2]};
+      float rasterMax[2] = {config.bmax[0], config.bmax[2]};
+      if (cached) {
+        source.cache = heightfields;
+        source.key = heightfieldKey(tileX, tileY);
+        source.rasterBorder = rasterBorder;
+        // a cache miss rasterizes the wider border
+        for (int k = 0; k < 2; ++k) {
+          rasterMin[k] -= rasterExtra;
+          rasterMax[k] += rasterExtra;
+        }
+      }
+
+      // Only rasterize the triangles overlapping the tile in x-z
+      tileTris.clear();
+      const int ntris = tris.size() / 3;
+      for (int iTri = 0; iTri < ntris; ++iTri) {
+        float triMin[2] = {std::numeric_limits<float>::max(),
+                           std::numeric_limits<float>::max()};
+        float triMax[2] = {-std::numeric_limits<float>::max(),
+                           -std::numeric_limits<float>::max()};
+        for (int k = 0; k < 3; ++k) {
+          const float* v = &verts[tris[iTri * 3 + k] * 3];
+          triMin[0] = rcMin(triMin[0], v[0]);
+          triMin[1] = rcMin(triMin[1], v[2]);
+          triMax[0] = rcMax(triMax[0], v[0]);
+          triMax[1] = rcMax(triMax[1], v[2]);
+        }
+        if (triMax[0] >= rasterMin[0] && triMin[0] <= rasterMax[0] &&
+            triMax[1] >= rasterMin[1] && triMin[1] <= rasterMax[1]) {
+          tileTris.insert(tileTris.end(), &tris[iTri * 3],
+                          &tris[iTri * 3 + 3]);
+        }
+      }
+      if (tileTris.empty())
+        return;
+
+      TileData& tile = tileData[iTile];
+      if (!buildNavMeshData(settings, config, verts.data(), verts.size() / 3,
+                            tileTris.data(), tileTris.size() / 3, tileX,
+                            tileY, tile.navData, tile.navDataSize,
+                            tile.numPolys, cached ? &source : nullptr)) {
+        LOG(ERROR) << "Could not build navmesh tile " << tileX << ","
+                   << tileY;
+        failed = true;
+      }
+    });
+
+    if (failed) {
+      for (TileData& tile : tileData) {
+        dtFree(tile.navData);
+      }
+      tileData.clear();
+      return false;
+    }
+    return true;
+  }
+
+  // Key of tile (tileX, tileY) in the heightfield cache
+  HeightfieldCache::Key heightfieldKey(int tileX, int tileY) const {
+    HeightfieldCache::Key key;
+    key.geometry = geometry;
+    key.cs = tileCfg.cs;
+    key.ch = tileCfg.ch;
+    key.walkableSlopeAngle = tileCfg.walkableSlopeAngle;
+    key.walkableClimb = tileCfg.walkableClimb;
+    rcVcopy(key.orig, orig);
+    key.maxY = sourceMaxY;
+    key.tileX = tileX;
+    key.tileY = tileY;
+    key.width = tileSize;
+    key.height = tileSize;
+    return key;
+  }
+
+  NavMeshSettings settings;
+  // config of a single tile including its border
+  rcConfig tileCfg;
+  float orig[3];
+  // height range of the source mesh, and including the obstacles
+  float sourceMinY;
+  float sourceMaxY;
+  float minY;
+  float maxY;
+  float border;
+  float tileWorldSize;
+  int tileSize;
+  int tilesX;
+  int tilesY;
+
+  // source mesh followed by the triangles of all obstacles
+  std::vector<float> verts;
+  std::vector<int> tris;
+  int numSourceVerts;
+  int numSourceTris;
+
+  // maps: obstacle ID -> obstacle
+  std::map<int, Obstacle> obstacles;
+
+  // heightfields of the tiles of the source mesh, used while there are no
+  // obstacles, and the CRC of the source mesh they are keyed by
+  HeightfieldCache* heightfields = nullptr;
+  uint32_t geometry = 0;
+};
+
+// LRU cache of single goal shortest paths
+class PathCache {
+ public:
+  struct Key {
+    dtPolyRef startRef;
+    dtPolyRef endRef;
+    // positions in multiples of the quantization
+    int32_t start[3];
+    int32_t end[3];
+
+    bool operator==(const Key& other) const {
+      return startRef == other.startRef && endRef == other.endRef &&
+             std::equal(start, start + 3, other.start) &&
+             std::equal(end, end + 3, other.end);
+    }
+  };
+
+  struct KeyHash {
+    size_t operator()(const Key& key) const {
+      size_t hash = std::hash<uint64_t>()(key.startRef);
+      auto combine = [&hash](uint64_t value) {
+        hash ^= std::hash<uint64_t>()(value) + 0x9e3779b9 + (hash << 6) +
+                (hash >> 2);
+      };
+      combine(key.endRef);
+      for (int i = 0; i < 3; ++i) {
+        combine(static_cast<uint32_t>(key.start[i]));
+        combine(static_cast<uint32_t>(key.end[i]));
+      }
+      return hash;
+    }
+  };
+
+  struct Entry {
+    std::vector<vec3f> points;
+    float geodesicDistance;
+    bool found;
+  };
+
+  Key makeKey(dtPolyRef startRef,
+              dtPolyRef endRef,
+              const vec3f& start,
+              const vec3f& end) {
+    std::lock_guard<std::mutex> lock(mutex);
+    Key key;
+    key.startRef = startRef;
+    key.endRef = endRef;
+    for (int i = 0; i < 3; ++i) {
+      key.start[i] = static_cast<int32_t>(std::round(start[i] / quantization));
+      key.end[i] = static_cast<int32_t>(std::round(end[i] / quantization));
+    }
+    return key;
+  }
+
+  // Copies the entry of key into entry, counting a hit or a miss
+  bool find(const Key& key, Entry& entry) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = index_.find(key);
+    if (it == index_.end()) {
+      ++stats.misses;
+      return false;
+    }
+    ++stats.hits;
+    entries_.splice(entries_.begin(), entries_, it->second);
+    entry = it->second->second;
+    return true;
+  }
+
+  void insert(const Key& key, Entry entry) {
+    std::lock_guard<std::mutex> lock(mutex);
+    // another thread may have computed the same path meanwhile
+    if (capacity == 0 || index_.count(key)) {
+      return;
+    }
+    entries_.emplace_front(key, std::move(entry));
+    index_[key] = entries_.begin();
+    evict();
+  }
+
+  void clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    entries_.clear();
+    index_.clear();
+  }
+
+  // Drops the least recently used entries beyond the capacity, with the mutex
+  // locked
+  void evict() {
+    while (entries_.size() > capacity) {
+      index_.erase(entries_.back().first);
+      entries_.pop_back();
+    }
+  }
+
+  size_t size() const { return entries_.size(); }
+
+  size_t capacity = 0;
+  float quantization = 1e-3;
+  PathCacheStats stats;
+  std::mutex mutex;
+
+ private:
+  typedef std::list<std::pair<Key, Entry>> EntryList;
+  EntryList entries_;
+  std::unordered_map<Key, EntryList::iterator, KeyHash> index_;
+};
+
+// Clusters of connected polygons of the navmesh and the graph of their
+// adjacency, to plan long paths over the clusters before searching the
+// polygons. The polygons whose centers fall in the same region box, e.g. a
+// room, or outside of all of them in the same x-z square of clusterSize make
+// up the clusters
+class PathHierarchy {
+ public:
+  PathHierarchy(const dtNavMesh* navMesh,
+                const dtQueryFilter* filter,
+                float clusterSize,
+                const std::vector<box3f>& regions)
+      : navMesh_(navMesh), clusterSize_(clusterSize) {
+    // region of the polygon, or -1 and its square
+    typedef std::tuple<int, int, int> Key;
+    std::vector<std::vector<Key>> tilePolyKeys(navMesh->getMaxTiles());
+    std::vector<std::vector<vec3f>> tilePolyCenters(navMesh->getMaxTiles());
+    tilePolyToCluster_.resize(navMesh->getMaxTiles());
+    for (int iTile = 0; iTile < navMesh->getMaxTiles(); ++iTile) {
+      const dtMeshTile* tile = navMesh->getTile(iTile);
+      if (!tile || !tile->header)
+        continue;
+      tilePolyToCluster_[iTile].assign(tile->header->polyCount, NO_CLUSTER);
+      for (int jPoly = 0; jPoly < tile->header->polyCount; ++jPoly) {
+        const dtPoly& poly = tile->polys[jPoly];
+        vec3f center = vec3f::Zero();
+        for (int iVert = 0; iVert < poly.vertCount; ++iVert) {
+          center += Eigen::Map<vec3f>(&tile->verts[poly.verts[iVert] * 3]);
+        }
+        center /= std::max<int>(poly.vertCount, 1);
+        tilePolyCenters[iTile].push_back(center);
+
+        int region = 0;
+        while (region < regions.size() && !regions[region].contains(center))
+          ++region;
+        if (region < regions.size()) {
+          tilePolyKeys[iTile].emplace_back(region, 0, 0);
+        } else {
+          tilePolyKeys[iTile].emplace_back(
+              -1, static_cast<int>(std::floor(center[0] / clusterSize)),
+              static_cast<int>(std::floor(center[2] / clusterSize)));
+        }
+      }
+    }
+
+    // flood fill the polygons of each key that pass the filter
+    std::stack<dtPolyRef, std::vector<dtPolyRef>> stack;
+    for (int iTile = 0; iTile < navMesh->getMaxTiles(); ++iTile) {
+      const dtMeshTile* tile = navMesh->getTile(iTile);
+      if (!tile || !tile->header)
+        continue;
+      for (int jPoly = 0; jPoly < tile->header->polyCount; ++jPoly) {
+        const dtPolyRef startRef = navMesh->getPolyRefBase(tile) | jPoly;
+        if (tilePolyToCluster_[iTile][jPoly] != NO_CLUSTER ||
+            !navMesh->isValidPolyRef(startRef) ||
+            !filter->passFilter(startRef, tile, &tile->polys[jPoly]))
+          continue;
+
+        const uint32_t cluster = centers_.size();
+        const Key& key = tilePolyKeys[iTile][jPoly];
+        vec3f center = vec3f::Zero();
+        int numPolys = 0;
+        clusterOfUnsafe(startRef) = cluster;
+        stack.push(startRef);
+        while (!stack.empty()) {
+          const dtPolyRef ref = stack.top();
+          stack.pop();
+          center += tilePolyCenters[navMesh->decodePolyIdTile(ref)]
+                                   [navMesh->decodePolyIdPoly(ref)];
+          ++numPolys;
+
+          const dtMeshTile* polyTile = 0;
+          const dtPoly* poly = 0;
+          navMesh->getTileAndPolyByRefUnsafe(ref, &polyTile, &poly);
+          for (unsigned int iLink = poly->firstLink; iLink != DT_NULL_LINK;
+               iLink = polyTile->links[iLink].next) {
+            const dtPolyRef neighbourRef = polyTile->links[iLink].ref;
+            if (clusterOf(neighbourRef) != NO_CLUSTER ||
+                tilePolyKeys[navMesh->decodePolyIdTile(neighbourRef)]
+                            [navMesh->decodePolyIdPoly(neighbourRef)] != key)
+              continue;
+            const dtMeshTile* neighbourTile = 0;
+            const dtPoly* neighbourPoly = 0;
+            navMesh->getTileAndPolyByRefUnsafe(neighbourRef, &neighbourTile,
+                                               &neighbourPoly);
+            if (!filter->passFilter(neighbourRef, neighbourTile,
+                                    neighbourPoly))
+              continue;
+            clusterOfUnsafe(neighbourRef) = cluster;
+            stack.push(neighbourRef);
+          }
+        }
+        centers_.push_back(center / numPolys);
+      }
+    }
+
+    // clusters are adjacent where any of their polygons are, at the distance
+    // of their centers
+    std::vector<std::vector<uint32_t>> neighbours(centers_.size());
+    for (int iTile = 0; iTile < navMesh->getMaxTiles(); ++iTile) {
+      const dtMeshTile* tile = navMesh->getTile(iTile);
+      if (!tile || !tile->header)
+        continue;
+      for (int jPoly = 0; jPoly < tile->header->polyCount; ++jPoly) {
+        const uint32_t cluster = tilePolyToCluster_[iTile][jPoly];
+        if (cluster == NO_CLUSTER)
+          continue;
+        const dtPoly& poly = tile->polys[jPoly];
+        for (unsigned int iLink = poly.firstLink; iLink != DT_NULL_LINK;
+             iLink = tile->links[iLink].next) {
+          const uint32_t neighbour = clusterOf(tile->links[iLink].ref);
+          if (neighbour != NO_CLUSTER && neighbour != cluster)
+            neighbours[cluster].push_back(neighbour);
+        }
+      }
+    }
+    edges_.resize(centers_.size());
+    for (uint32_t cluster = 0; cluster < centers_.size(); ++cluster) {
+      std::vector<uint32_t>& adjacent = neighbours[cluster];
+      std::sort(adjacent.begin(), adjacent.end());
+      adjacent.erase(std::unique(adjacent.begin(), adjacent.end()),
+                     adjacent.end());
+      for (uint32_t neighbour : adjacent) {
+        edges_[cluster].emplace_back(
+            neighbour, (centers_[cluster] - centers_[neighbour]).norm());
+      }
+    }
+  }
+
+  float clusterSize() const { return clusterSize_; }
+
+  size_t numClusters() const { return centers_.size(); }
+
+  // Marks in allowed the clusters along the shortest route over the clusters
+  // from startRef at start to the nearest of endRefs at ends, along the
+  // routes to the other ends that are not much longer, and the clusters next
+  // to them. False if no end can be reached
+  bool corridor(dtPolyRef startRef,
+                const vec3f& start,
+                const core::ArenaVector<dtPolyRef>& endRefs,
+                const core::ArenaVector<vec3f>& ends,
+                std::vector<char>& allowed) const {
+    const uint32_t startCluster = clusterOf(startRef);
+    if (startCluster == NO_CLUSTER)
+      return false;
+    // scratch of the search, released on return
+    core::ArenaScope scope;
+    // cost from the center of each cluster with ends to its nearest end; few
+    // goals share a query, so a list is enough
+    core::ArenaVector<std::pair<uint32_t, float>> endCosts;
+    for (size_t i = 0; i < endRefs.size(); ++i) {
+      const uint32_t cluster = clusterOf(endRefs[i]);
+      if (cluster == NO_CLUSTER)
+        continue;
+      const float cost = (centers_[cluster] - ends[i]).norm();
+      auto it = std::find_if(
+          endCosts.begin(), endCosts.end(),
+          [cluster](const std::pair<uint32_t, float>& endCost) {
+            return endCost.first == cluster;
+          });
+      if (it == endCosts.end()) {
+        endCosts.emplace_back(cluster, cost);
+      } else {
+        it->second = std::min(it->second, cost);
+      }
+    }
+    if (endCosts.empty())
+      return false;
+
+    core::ArenaVector<float> costs(centers_.size(),
+                                   std::numeric_limits<float>::infinity());
+    core::ArenaVector<uint32_t> parents(centers_.size(), NO_CLUSTER);
+    typedef std::pair<float, uint32_t> QueueEntry;
+    std::priority_queue<QueueEntry, core::ArenaVector<QueueEntry>,
+                        std::greater<QueueEntry>>
+        queue;
+    costs[startCluster] = (start - centers_[startCluster]).norm();
+    queue.emplace(costs[startCluster], startCluster);
+    float bestCost = std::numeric_limits<float>::infinity();
+    core::ArenaVector<uint32_t> reached;
+    while (!queue.empty()) {
+      const QueueEntry top = queue.top();
+      queue.pop();
+      if (top.first > costs[top.second])
+        continue;
+      if (top.first > bestCost * corridorSlack + clusterSize_)
+        break;
+      auto end = std::find_if(
+          endCosts.begin(), endCosts.end(),
+          [&top](const std::pair<uint32_t, float>& endCost) {
+            return endCost.first == top.second;
+          });
+      if (end != endCosts.end()) {
+        bestCost = std::min(bestCost, top.first + end->second);
+        reached.push_back(top.second);
+      }
+      for (const Edge& edge : edges_[top.second]) {
+        const float cost = top.first + edge.second;
+        if (cost < costs[edge.first]) {
+          costs[edge.first] = cost;
+          parents[edge.first] = top.second;
+          queue.emplace(cost, edge.first);
+        }
+      }
+    }
+    if (reached.empty())
+      return false;
+
+    allowed.assign(centers_.size(), 0);
+    for (uint32_t cluster : reached) {
+      for (; cluster != NO_CLUSTER && !allowed[cluster];
+           cluster = parents[cluster]) {
+        allowed[cluster] = 1;
+      }
+    }
+    // the route through the cluster centers only approximates the path, let
+    // it cut corners through the neighbouring clusters
+    const core::ArenaVector<char> route(allowed.begin(), allowed.end());
+    for (uint32_t cluster = 0; cluster < centers_.size(); ++cluster) {
+      if (!route[cluster])
+        continue;
+      for (const Edge& edge : edges_[cluster]) {
+        allowed[edge.first] = 1;
+      }
+    }
+    return true;
+  }
+
+  inline bool isAllowed(dtPolyRef ref, const std::vector<char>& allowed) const {
+    const uint32_t cluster = clusterOf(ref);
+    return cluster != NO_CLUSTER && allowed[cluster];
+  }
+
+ private:
+  static constexpr uint32_t NO_CLUSTER = std::numeric_limits<uint32_t>::max();
+  // routes to further ends are kept up to this many times the shortest one
+  static constexpr float corridorSlack = 1.5f;
+
+  // neighbour and distance between the centers
+  typedef std::pair<uint32_t, float> Edge;
+
+  const dtNavMesh* navMesh_;
+  float clusterSize_;
+  std::vector<std::vector<uint32_t>> tilePolyToCluster_;
+  std::vector<vec3f> centers_;
+  std::vector<std::vector<Edge>> edges_;
+
+  inline uint32_t clusterOf(dtPolyRef ref) const {
+    const unsigned int iTile = navMesh_->decodePolyIdTile(ref);
+    const unsigned int iPoly = navMesh_->decodePolyIdPoly(ref);
+    if (iTile >= tilePolyToCluster_.size() ||
+        iPoly >= tilePolyToCluster_[iTile].size())
+      return NO_CLUSTER;
+    return tilePolyToCluster_[iTile][iPoly];
+  }
+
+  inline uint32_t& clusterOfUnsafe(dtPolyRef ref) {
+    return tilePolyToCluster_[navMesh_->decodePolyIdTile(ref)]
+                             [navMesh_->decodePolyIdPoly(ref)];
+  }
+};
+
+constexpr uint32_t PathHierarchy::NO_CLUSTER;
+constexpr float PathHierarchy::corridorSlack;
+
+// The filter of a PathFinder, restricted to the clusters of a corridor of its
+// PathHierarchy
+class CorridorFilter : public dtQueryFilter {
+ public:
+  CorridorFilter(const dtQueryFilter& filter,
+                 const PathHierarchy& hierarchy,
+                 const std::vector<char>& allowed)
+      : dtQueryFilter(filter), hierarchy_(hierarchy), allowed_(allowed) {}
+
+  bool passFilter(const dtPolyRef ref,
+                  const dtMeshTile* tile,
+                  const dtPoly* poly) const override {
+    return hierarchy_.isAllowed(ref, allowed_) &&
+           dtQueryFilter::passFilter(ref, tile, poly);
+  }
+
+ private:
+  const PathHierarchy& hierarchy_;
+  const std::vector<char>& allowed_;
+};
+
+}  // namespace impl
+}  // namespace nav
+}  // namespace esp
+
+// Builds a navmesh of bs.tileSize x bs.tileSize cell tiles
+dtNavMesh* buildTiledNavMesh(const esp::nav::impl::TileBuilder& builder) {
+  // Poly refs have 22 bits for tile and polygon indices
+  const int tileBits = rcMin(
+      static_cast<int>(dtIlog2(dtNextPow2(builder.tilesX * builder.tilesY))),
+      14);
+  const int polyBits = 22 - tileBits;
+
+  dtNavMeshParams navMeshParams;
+  memset(&navMeshParams, 0, sizeof(navMeshParams));
+  rcVcopy(navMeshParams.orig, builder.orig);
+  navMeshParams.tileWidth = builder.tileWorldSize;
+  navMeshParams.tileHeight = builder.tileWorldSize;
+  navMeshParams.maxTiles = 1 << tileBits;
+  navMeshParams.maxPolys = 1 << polyBits;
+
+  dtNavMesh* navMesh = dtAllocNavMesh();
+  if (!navMesh) {
+    LOG(ERROR) << "Could not allocate Detour navmesh";
+    return nullptr;
+  }
+  if (dtStatusFailed(navMesh->init(&navMeshParams))) {
+    dtFreeNavMesh(navMesh);
+    LOG(ERROR) << "Could not init Detour navmesh";
+    return nullptr;
+  }
+
+  std::vector<std::pair<int, int>> tiles;
+  for (int tileY = 0; tileY < builder.tilesY; ++tileY) {
+    for (int tileX = 0; tileX < builder.tilesX; ++tileX) {
+      tiles.emplace_back(tileX, tileY);
+    }
+  }
+  std::vector<esp::nav::impl::TileBuilder::TileData> tileData;
+  if (!builder.buildTiles(tiles, tileData)) {
+    LOG(ERROR) << "Could not build tiled navmesh";
+    dtFreeNavMesh(navMesh);
+    return nullptr;
+  }
+
+  bool failed = false;
+  int numTiles = 0;
+  int numPolys = 0;
+  for (auto& tile : tileData) {
+    if (!tile.navData)
+      continue;
+    if (failed || dtStatusFailed(navMesh->addTile(tile.navData,
+                                                  tile.navDataSize,
+                                                  DT_TILE_FREE_DATA, 0, 0))) {
+      dtFree(tile.navData);
+      failed = true;
+      continue;
+    }
+    ++numTiles;
+    numPolys += tile.numPolys;
+  }
+  if (failed || numTiles == 0) {
+    LOG(ERROR) << "Could not build tiled navmesh";
+    dtFreeNavMesh(navMesh);
+    return nullptr;
+  }
+
+  LOG(INFO) << "Created navmesh with " << numPolys << " polygons in "
+            << numTiles << " tiles of " << builder.tilesX << "x"
+            << builder.tilesY;
+  return navMesh;
+}
+
+esp::nav::PathFinder::PathFinder() : navMesh_(0), navQuery_(0), filter_(0) {
+  filter_ = new dtQueryFilter();
+  filter_->setIncludeFlags(POLYFLAGS_WALK);
+  filter_->setExcludeFlags(0);
+  pathCache_ = new impl::PathCache();
+}
+
+esp::nav::PathFinder::~PathFinder() {
+  free();
+  delete heightfieldCache_;
+  delete pathCache_;
+  LOG(INFO) << "Deconstructing PathFinder";
+}
+
+void esp::nav::PathFinder::setHeightfieldCache(bool enabled,
+                                               const std::string& file) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  if (tileBuilder_) {
+    tileBuilder_->heightfields = nullptr;
+  }
+  delete heightfieldCache_;
+  heightfieldCache_ = nullptr;
+  if (!enabled) {
+    return;
+  }
+  heightfieldCache_ = new impl::HeightfieldCache();
+  heightfieldCache_->file = file;
+  if (!file.empty() && io::exists(file) && !heightfieldCache_->load(file)) {
+    LOG(WARNING) << "Ignoring invalid heightfield cache " << file;
+  }
+}
+
+bool esp::nav::PathFinder::isHeightfieldCacheEnabled() const {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  return heightfieldCache_ != nullptr;
+}
+
+esp::nav::HeightfieldCacheStats esp::nav::PathFinder::getHeightfieldCacheStats()
+    const {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  return heightfieldCache_ ? heightfieldCache_->getStats()
+                           : HeightfieldCacheStats();
+}
+
+void esp::nav::PathFinder::setPathCacheCapacity(size_t capacity) {
+  std::lock_guard<std::mutex> lock(pathCache_->mutex);
+  pathCache_->capacity = capacity;
+  pathCache_->evict();
+}
+
+size_t esp::nav::PathFinder::getPathCacheCapacity() const {
+  std::lock_guard<std::mutex> lock(pathCache_->mutex);
+  return pathCache_->capacity;
+}
+
+void esp::nav::PathFinder::setPathCacheQuantization(float meters) {
+  if (meters <= 0) {
+    LOG(ERROR) << "Path cache quantization must be positive, got " << meters;
+    return;
+  }
+  // keys made with the old quantization would not match any more
+  clearPathCache();
+  std::lock_guard<std::mutex> lock(pathCache_->mutex);
+  pathCache_->quantization = meters;
+}
+
+void esp::nav::PathFinder::setPathHierarchy(
+    float clusterSize,
+    const std::vector<box3f>& regions /* = {} */) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  if (clusterSize < 0) {
+    LOG(ERROR) << "Path hierarchy cluster size must not be negative, got "
+               << clusterSize;
+    return;
+  }
+  pathHierarchyClusterSize_ = clusterSize;
+  pathHierarchyRegions_ = regions;
+  delete pathHierarchy_;
+  pathHierarchy_ = nullptr;
+  if (clusterSize > 0 && navMesh_) {
+    pathHierarchy_ =
+        new impl::PathHierarchy(navMesh_, filter_, clusterSize, regions);
+  }
+  // paths searched over the corridors may differ from the cached ones
+  clearPathCache();
+}
+
+float esp::nav::PathFinder::getPathHierarchyClusterSize() const {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  return pathHierarchyClusterSize_;
+}
+
+size_t esp::nav::PathFinder::getPathHierarchyNumClusters() const {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  return pathHierarchy_ ? pathHierarchy_->numClusters() : 0;
+}
+
+int esp::nav::PathFinder::registerGoalSet(const std::vector<vec3f>& goals) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  const int goalSetId = nextGoalSetId_++;
+  goalSets_[goalSetId] = std::make_shared<GeodesicDistanceField>(*this, goals);
+  return goalSetId;
+}
+
+void esp::nav::PathFinder::unregisterGoalSet(int goalSetId) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  goalSets_.erase(goalSetId);
+}
+
+float esp::nav::PathFinder::distanceToGoalSet(const vec3f& pt,
+                                              int goalSetId) const {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  auto it = goalSets_.find(goalSetId);
+  if (it == goalSets_.end()) {
+    LOG(ERROR) << "PathFinder::distanceToGoalSet: no goal set " << goalSetId;
+    return std::numeric_limits<float>::infinity();
+  }
+  return it->second->distanceFrom(pt);
+}
+
+bool esp::nav::PathFinder::findPathToGoalSet(ShortestPath& path,
+                                             int goalSetId) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  path.points.clear();
+  path.geodesicDistance = std::numeric_limits<float>::infinity();
+  auto it = goalSets_.find(goalSetId);
+  if (it == goalSets_.end()) {
+    LOG(ERROR) << "PathFinder::findPathToGoalSet: no goal set " << goalSetId;
+    return false;
+  }
+  // the field picks the goal, so only one end is searched for
+  const int goal = it->second->closestGoal(path.requestedStart);
+  if (goal < 0) {
+    return false;
+  }
+  path.requestedEnd = it->second->getGoals()[goal];
+  return findPathWithQuery(path, navQuery_);
+}
+
+float esp::nav::PathFinder::getPathCacheQuantization() const {
+  std::lock_guard<std::mutex> lock(pathCache_->mutex);
+  return pathCache_->quantization;
+}
+
+esp::nav::PathCacheStats esp::nav::PathFinder::getPathCacheStats() const {
+  std::lock_guard<std::mutex> lock(pathCache_->mutex);
+  PathCacheStats stats = pathCache_->stats;
+  stats.size = pathCache_->size();
+  return stats;
+}
+
+void esp::nav::PathFinder::resetPathCacheStats() {
+  std::lock_guard<std::mutex> lock(pathCache_->mutex);
+  pathCache_->stats = PathCacheStats();
+}
+
+void esp::nav::PathFinder::clearPathCache() {
+  pathCache_->clear();
+}
+
+void esp::nav::PathFinder::free() {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  ++navMeshRevision_;
+  if (navMesh_) {
+    dtFreeNavMesh(navMesh_);
+    navMesh_ = 0;
+  }
+  if (navQuery_) {
+    dtFreeNavMeshQuery(navQuery_);
+    navQuery_ = 0;
+  }
+  freeQueryPool();
+  if (filter_) {
+    delete filter_;
+  }
+
+  // tiles may point into the mapped navmesh file
+  navMeshFile_.reset();
+
+  if (islandSystem_) {
+    delete islandSystem_;
+    islandSystem_ = nullptr;
+  }
+
+  delete pathHierarchy_;
+  pathHierarchy_ = nullptr;
+  maxPathPolys_ = 0;
+
+  delete tileBuilder_;
+  tileBuilder_ = nullptr;
+
+  // the cached paths are on the freed navmesh
+  clearPathCache();
+}
+
+bool esp::nav::PathFinder::build(const NavMeshSettings& bs,
+                                 const float* verts,
+                                 const int nverts,
+                                 const int* tris,
+                                 const int ntris,
+                                 const float* bmin,
+                                 const float* bmax) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  //
+  // Step 1. Initialize build config.
+  //
+
+  // Init build configuration from GUI
+  rcConfig cfg;
+  memset(&cfg, 0, sizeof(cfg));
+  cfg.cs = bs.cellSize;
+  cfg.ch = bs.cellHeight;
+  cfg.walkableSlopeAngle = bs.agentMaxSlope;
+  cfg.walkableHeight = (int)ceilf(bs.agentHeight / cfg.ch);
+  cfg.walkableClimb = (int)floorf(bs.agentMaxClimb / cfg.ch);
+  cfg.walkableRadius = (int)ceilf(bs.agentRadius / cfg.cs);
+  cfg.maxEdgeLen = (int)(bs.edgeMaxLen / bs.cellSize);
+  cfg.maxSimplificationError = bs.edgeMaxError;
+  cfg.minRegionArea = (int)rcSqr(bs.regionMinSize);  // Note: area = size*size
+  cfg.mergeRegionArea =
+      (int)rcSqr(bs.regionMergeSize);  // Note: area = size*size
+  cfg.maxVertsPerPoly = (int)bs.vertsPerPoly;
+  cfg.detailSampleDist =
+      bs.detailSampleDist < 0.9f ? 0 : bs.cellSize * bs.detailSampleDist;
+  cfg.detailSampleMaxError = bs.cellHeight * bs.detailSampleMaxError;
+
+  // Set the area where the navigation will be build.
+  // Here the bounds of the input mesh are used, but the
+  // area could be specified by an user defined box, etc.
+  rcVcopy(cfg.bmin, bmin);
+  rcVcopy(cfg.bmax, bmax);
+  rcCalcGridSize(cfg.bmin, cfg.bmax, cfg.cs, &cfg.width, &cfg.height);
+  LOG(INFO) << "Building navmesh with " << cfg.width << "x" << cfg.height
+            << " cells";
+
+  // The GUI may allow more max points per polygon than Detour can handle.
+  // Only build the detour navmesh if we do not exceed the limit.
+  if (cfg.maxVertsPerPoly > DT_VERTS_PER_POLYGON) {
+    LOG(ERROR) << "Cannot build a Detour navmesh with more than "
+               << DT_VERTS_PER_POLYGON << " vertices per polygon";
+    return false;
+  }
+
+  uint32_t geometry = 0;
+  if (heightfieldCache_) {
+    geometry = io::crc32(verts, nverts * 3 * sizeof(float));
+    geometry = io::crc32(tris, ntris * 3 * sizeof(int), geometry);
+  }
+
+  dtNavMesh* navMesh = nullptr;
+  impl::TileBuilder* tileBuilder = nullptr;
+  if (bs.tileSize > 0) {
+    tileBuilder = new impl::TileBuilder(bs, cfg, verts, nverts, tris, ntris);
+    tileBuilder->heightfields = heightfieldCache_;
+    tileBuilder->geometry = geometry;
+    navMesh = buildTiledNavMesh(*tileBuilder);
+  } else if (heightfieldCache_) {
+    // a solo navmesh is a single tile without border
+    impl::HeightfieldSource source;
+    source.cache = heightfieldCache_;
+    source.key.geometry = geometry;
+    source.key.cs = cfg.cs;
+    source.key.ch = cfg.ch;
+    source.key.walkableSlopeAngle = cfg.walkableSlopeAngle;
+    source.key.walkableClimb = cfg.walkableClimb;
+    rcVcopy(source.key.orig, cfg.bmin);
+    source.key.maxY = cfg.bmax[1];
+    source.key.tileX = 0;
+    source.key.tileY = 0;
+    source.key.width = cfg.width;
+    source.key.height = cfg.height;
+    source.rasterBorder = 0;
+    navMesh = buildSoloNavMesh(bs, cfg, verts, nverts, tris, ntris, &source);
+  } else {
+    navMesh = buildSoloNavMesh(bs, cfg, verts, nverts, tris, ntris, nullptr);
+  }
+  if (heightfieldCache_ && !heightfieldCache_->file.empty() &&
+      heightfieldCache_->isDirty() &&
+      !heightfieldCache_->save(heightfieldCache_->file)) {
+    LOG(WARNING) << "Could not write heightfield cache "
+                 << heightfieldCache_->file;
+  }
+  if (!navMesh) {
+    delete tileBuilder;
+    return false;
+  }
+
+  if (navMesh_) {
+    dtFreeNavMesh(navMesh_);
+  }
+  navMesh_ = navMesh;
+  navMeshFile_.reset();
+  delete tileBuilder_;
+  tileBuilder_ = tileBuilder;
+  delete islandSystem_;
+  islandSystem_ = nullptr;
+  return initNavQuery();
+}
+
+int esp::nav::PathFinder::growQueryPool(int numThreads, size_t numTasks) {
+  const int poolThreads = core::ThreadPool::global().getNumThreads();
+  if (numThreads <= 0 || numThreads > poolThreads) {
+    numThreads = poolThreads;
+  }
+  numThreads = std::max(1, std::min(numThreads, static_cast<int>(numTasks)));
+
+  // the calling thread uses navQuery_, every other thread gets one from the
+  // pool; detour queries hold per-search state while the navmesh, filter and
+  // island system are only read
+  while (static_cast<int>(queryPool_.size()) + 1 < numThreads) {
+    dtNavMeshQuery* navQuery = dtAllocNavMeshQuery();
+    if (!navQuery || dtStatusFailed(navQuery->init(navMesh_, 2048))) {
+      LOG(ERROR) << "Could not init Detour navmesh query";
+      dtFreeNavMeshQuery(navQuery);
+      break;
+    }
+    queryPool_.emplace_back(navQuery);
+  }
+  return std::min(numThreads, static_cast<int>(queryPool_.size()) + 1);
+}
+
+void esp::nav::PathFinder::freeQueryPool() {
+  for (dtNavMeshQuery* navQuery : queryPool_) {
+    dtFreeNavMeshQuery(navQuery);
+  }
+  queryPool_.clear();
+}
+
+bool esp::nav::PathFinder::initNavQuery() {
+  ++navMeshRevision_;
+  // pooled queries refer to the previous navmesh
+  freeQueryPool();
+  // and so do the cached paths
+  clearPathCache();
+  if (navQuery_) {
+    dtFreeNavMeshQuery(navQuery_);
+  }
+  navQuery_ = dtAllocNavMeshQuery();
+  dtStatus status = navQuery_->init(navMesh_, 2048);
+  if (dtStatusFailed(status)) {
+    LOG(ERROR) << "Could not init Detour navmesh query";
+    return false;
+  }
+
+  // islands may already have been loaded along with the navmesh
+  if (!islandSystem_) {
+    islandSystem_ = new impl::IslandSystem(navMesh_);
+    islandSystem_->build(filter_);
+  }
+
+  maxPathPolys_ = 0;
+  for (int iTile = 0; iTile < navMesh_->getMaxTiles(); ++iTile) {
+    const dtMeshTile* tile = navMesh_->getTile(iTile);
+    if (tile && tile->header)
+      maxPathPolys_ += tile->header->polyCount;
+  }
+
+  delete pathHierarchy_;
+  pathHierarchy_ = nullptr;
+  if (pathHierarchyClusterSize_ > 0) {
+    pathHierarchy_ = new impl::PathHierarchy(
+        navMesh_, filter_, pathHierarchyClusterSize_, pathHierarchyRegions_);
+  }
+
+  for (auto& goalSet : goalSets_) {
+    goalSet.second = std::make_shared<GeodesicDistanceField>(
+        *this, goalSet.second->getGoals());
+  }
+
+  return true;
+}
+
+bool esp::nav::PathFinder::build(const NavMeshSettings& bs,
+                                 const esp::assets::MeshData& mesh) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  const int numVerts = mesh.vbo.size();
+  const int numIndices = mesh.ibo.size();
+  const float mf = std::numeric_limits<float>::max();
+  vec3f bmin(mf, mf, mf);
+  vec3f bmax(-mf, -mf, -mf);
+
+  for (int i = 0; i < numVerts; i++) {
+    const vec3f& p = mesh.vbo[i];
+    bmin = bmin.cwiseMin(p);
+    bmax = bmax.cwiseMax(p);
+  }
+
+  int* indices = new int[numIndices];
   for (int i = 0; i < numIndices; i++) {
     indices[i] = static_cast<int>(mesh.ibo[i]);
   }
@@ -578,9 +2095,114 @@ bool esp::nav::PathFinder::build(const NavMeshSettings& bs,
   return success;
 }
 
+bool esp::nav::PathFinder::updateObstacle(const int obstacleId,
+                                          const esp::assets::MeshData& mesh) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  if (!tileBuilder_) {
+    LOG(ERROR) << "Obstacles need a tiled navmesh built by this PathFinder";
+    return false;
+  }
+  if (mesh.vbo.empty() || mesh.ibo.size() % 3 != 0) {
+    LOG(ERROR) << "Obstacle " << obstacleId << " has no triangles";
+    return false;
+  }
+
+  impl::TileBuilder::Obstacle obstacle;
+  obstacle.bmin = mesh.vbo[0];
+  obstacle.bmax = mesh.vbo[0];
+  for (const vec3f& p : mesh.vbo) {
+    obstacle.verts.insert(obstacle.verts.end(), p.data(), p.data() + 3);
+    obstacle.bmin = obstacle.bmin.cwiseMin(p);
+    obstacle.bmax = obstacle.bmax.cwiseMax(p);
+  }
+  for (uint32_t index : mesh.ibo) {
+    if (index >= mesh.vbo.size()) {
+      LOG(ERROR) << "Obstacle " << obstacleId << " has an invalid index";
+      return false;
+    }
+    obstacle.tris.push_back(index);
+  }
+
+  // rebuild where the obstacle was and where it is now
+  vec3f bmin = obstacle.bmin;
+  vec3f bmax = obstacle.bmax;
+  auto it = tileBuilder_->obstacles.find(obstacleId);
+  if (it != tileBuilder_->obstacles.end()) {
+    bmin = bmin.cwiseMin(it->second.bmin);
+    bmax = bmax.cwiseMax(it->second.bmax);
+  }
+  tileBuilder_->obstacles[obstacleId] = std::move(obstacle);
+  tileBuilder_->updateGeometry();
+  return rebuildTiles(bmin, bmax);
+}
+
+bool esp::nav::PathFinder::removeObstacle(const int obstacleId) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  if (!tileBuilder_) {
+    return false;
+  }
+  auto it = tileBuilder_->obstacles.find(obstacleId);
+  if (it == tileBuilder_->obstacles.end()) {
+    return false;
+  }
+  const vec3f bmin = it->second.bmin;
+  const vec3f bmax = it->second.bmax;
+  tileBuilder_->obstacles.erase(it);
+  tileBuilder_->updateGeometry();
+  return rebuildTiles(bmin, bmax);
+}
+
+bool esp::nav::PathFinder::rebuildTiles(const vec3f& bmin, const vec3f& bmax) {
+  int minX, minY, maxX, maxY;
+  tileBuilder_->tileRange(bmin, bmax, minX, minY, maxX, maxY);
+  std::vector<std::pair<int, int>> tiles;
+  for (int tileY = minY; tileY <= maxY; ++tileY) {
+    for (int tileX = minX; tileX <= maxX; ++tileX) {
+      tiles.emplace_back(tileX, tileY);
+    }
+  }
+  std::vector<impl::TileBuilder::TileData> tileData;
+  if (!tileBuilder_->buildTiles(tiles, tileData)) {
+    return false;
+  }
+
+  bool success = true;
+  for (size_t i = 0; i < tiles.size(); ++i) {
+    const dtTileRef tileRef =
+        navMesh_->getTileRefAt(tiles[i].first, tiles[i].second, 0);
+    if (tileRef) {
+      navMesh_->removeTile(tileRef, 0, 0);
+    }
+    if (tileData[i].navData &&
+        dtStatusFailed(navMesh_->addTile(tileData[i].navData,
+                                         tileData[i].navDataSize,
+                                         DT_TILE_FREE_DATA, 0, 0))) {
+      dtFree(tileData[i].navData);
+      LOG(ERROR) << "Could not add navmesh tile " << tiles[i].first << ","
+                 << tiles[i].second;
+      success = false;
+    }
+  }
+  LOG(INFO) << "Rebuilt " << tiles.size() << " navmesh tiles";
+
+  // islands may have been split or joined
+  delete islandSystem_;
+  islandSystem_ = nullptr;
+  return initNavQuery() && success;
+}
+
 static const int NAVMESHSET_MAGIC =
     'M' << 24 | 'S' << 16 | 'E' << 8 | 'T';  //'MSET';
-static const int NAVMESHSET_VERSION = 1;
+// version 1 stores the tiles one after another, each behind a
+// NavMeshTileHeader. Version 2 stores an index of all tiles after the header,
+// with aligned tile data that can be used straight from a memory mapping
+static const int NAVMESHSET_STREAMED_VERSION = 1;
+static const int NAVMESHSET_VERSION = 2;
+static const uint64_t NAVMESHSET_TILE_ALIGNMENT = 16;
+// the stamp of the source of a shared copy of a navmesh is an io cache file
+// without sections next to it
+static const uint32_t NAVMESH_SOURCE_CACHE_KIND = 110;
+static const uint32_t NAVMESH_SOURCE_CACHE_VERSION = 1;
 
 struct NavMeshSetHeader {
   int magic;
@@ -594,7 +2216,22 @@ struct NavMeshTileHeader {
   int dataSize;
 };
 
+struct NavMeshTileIndexEntry {
+  uint64_t tileRef;
+  // offset of the tile data in the file
+  uint64_t offset;
+  uint32_t dataSize;
+  // io::crc32 of the tile data
+  uint32_t checksum;
+};
+
+// the version 2 header is followed by the offset of the islands, 0 if there
+// are none, and then the tile index
+static const size_t NAVMESHSET_INDEX_OFFSET =
+    sizeof(NavMeshSetHeader) + sizeof(uint64_t);
+
 bool esp::nav::PathFinder::loadNavMesh(const std::string& path) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
   FILE* fp = fopen(path.c_str(), "rb");
   if (!fp)
     return false;
@@ -610,11 +2247,34 @@ bool esp::nav::PathFinder::loadNavMesh(const std::string& path) {
     fclose(fp);
     return false;
   }
-  if (header.version != NAVMESHSET_VERSION) {
+  if (header.version == NAVMESHSET_VERSION) {
+    fclose(fp);
+    return loadMappedNavMesh(path);
+  }
+  if (header.version != NAVMESHSET_STREAMED_VERSION) {
     fclose(fp);
     return false;
   }
 
+  // Navmeshes of the streamed format are stored in the current one in the
+  // shared cache directory, if set, for all processes to map. The mapped
+  // format does not record its source, so the copy is only used while the
+  // stamp stored next to it matches the current contents of the source
+  std::string sharedFile;
+  if (!io::getSharedCacheDir().empty()) {
+    sharedFile = io::cacheFilename(path + ".navmesh");
+  }
+  const std::string sharedStampFile = sharedFile + ".source";
+  io::CacheLock cacheLock(sharedFile);
+  if (!sharedFile.empty() && io::exists(sharedFile) &&
+      io::CacheReader(sharedStampFile, NAVMESH_SOURCE_CACHE_KIND,
+                      NAVMESH_SOURCE_CACHE_VERSION, path)
+          .isValid() &&
+      loadMappedNavMesh(sharedFile)) {
+    fclose(fp);
+    return true;
+  }
+
   dtNavMesh* mesh = dtAllocNavMesh();
   if (!mesh) {
     fclose(fp);
@@ -654,91 +2314,365 @@ bool esp::nav::PathFinder::loadNavMesh(const std::string& path) {
                   tileHeader.tileRef, 0);
   }
 
+  // The navmesh may be followed by its islands, otherwise they are rebuilt
+  impl::IslandSystem* islandSystem = new impl::IslandSystem(mesh);
+  if (!islandSystem->load(fp)) {
+    delete islandSystem;
+    islandSystem = nullptr;
+  }
+
   fclose(fp);
 
+  if (navMesh_) {
+    dtFreeNavMesh(navMesh_);
+  }
   navMesh_ = mesh;
+  navMeshFile_.reset();
+  delete islandSystem_;
+  islandSystem_ = islandSystem;
+  // the source geometry of a loaded navmesh is unknown
+  delete tileBuilder_;
+  tileBuilder_ = nullptr;
+  if (!initNavQuery()) {
+    return false;
+  }
+  // this process maps the shared copy as well, keeping its own tiles if it
+  // cannot be written. The stamp follows the copy, so that a copy is never
+  // stamped with a source it was not converted from
+  if (!sharedFile.empty() && saveNavMesh(sharedFile) &&
+      io::CacheWriter(NAVMESH_SOURCE_CACHE_KIND, NAVMESH_SOURCE_CACHE_VERSION,
+                      path)
+          .write(sharedStampFile)) {
+    loadMappedNavMesh(sharedFile);
+  }
+  return true;
+}
+
+bool esp::nav::PathFinder::loadMappedNavMesh(const std::string& path) {
+  // Detour links the polygons of a tile by writing into its data, so the
+  // mapping is copy-on-write: only those pages are copied, while vertices,
+  // detail meshes and BV trees stay shared between all processes
+  auto file = std::make_shared<io::MappedFile>(path, /*copyOnWrite=*/true);
+  if (!file->isValid() || file->size() < NAVMESHSET_INDEX_OFFSET) {
+    LOG(ERROR) << "Could not map navmesh " << path;
+    return false;
+  }
+  NavMeshSetHeader header;
+  memcpy(&header, file->data(), sizeof(header));
+  uint64_t islandsOffset = 0;
+  memcpy(&islandsOffset, file->data() + sizeof(header), sizeof(islandsOffset));
+  if (header.numTiles < 0 ||
+      static_cast<size_t>(header.numTiles) >
+          (file->size() - NAVMESHSET_INDEX_OFFSET) /
+              sizeof(NavMeshTileIndexEntry)) {
+    LOG(ERROR) << "Navmesh " << path << " has an invalid tile index";
+    return false;
+  }
+  std::vector<NavMeshTileIndexEntry> index(header.numTiles);
+  if (!index.empty()) {
+    memcpy(index.data(), file->data() + NAVMESHSET_INDEX_OFFSET,
+           index.size() * sizeof(NavMeshTileIndexEntry));
+  }
+
+  dtNavMesh* mesh = dtAllocNavMesh();
+  if (!mesh) {
+    return false;
+  }
+  if (dtStatusFailed(mesh->init(&header.params))) {
+    dtFreeNavMesh(mesh);
+    return false;
+  }
+
+  for (size_t i = 0; i < index.size(); ++i) {
+    const NavMeshTileIndexEntry& entry = index[i];
+    if (entry.offset > file->size() ||
+        entry.dataSize > file->size() - entry.offset ||
+        io::crc32(file->data() + entry.offset, entry.dataSize) !=
+            entry.checksum) {
+      LOG(ERROR) << "Tile " << i << " of navmesh " << path << " is corrupted";
+      dtFreeNavMesh(mesh);
+      return false;
+    }
+
+    unsigned char* data =
+        reinterpret_cast<unsigned char*>(file->mutableData() + entry.offset);
+    int flags = 0;
+    // tile data is only used in place if it is aligned for Detour's structs
+    if (reinterpret_cast<uintptr_t>(data) % NAVMESHSET_TILE_ALIGNMENT != 0) {
+      unsigned char* copy =
+          static_cast<unsigned char*>(dtAlloc(entry.dataSize, DT_ALLOC_PERM));
+      if (!copy) {
+        dtFreeNavMesh(mesh);
+        return false;
+      }
+      memcpy(copy, data, entry.dataSize);
+      data = copy;
+      flags = DT_TILE_FREE_DATA;
+    }
+    if (dtStatusFailed(
+            mesh->addTile(data, entry.dataSize, flags, entry.tileRef, 0))) {
+      if (flags & DT_TILE_FREE_DATA) {
+        dtFree(data);
+      }
+      LOG(ERROR) << "Could not add tile " << i << " of navmesh " << path;
+      dtFreeNavMesh(mesh);
+      return false;
+    }
+  }
+
+  // The navmesh may be followed by its islands, otherwise they are rebuilt
+  impl::IslandSystem* islandSystem = nullptr;
+  if (islandsOffset > 0) {
+    islandSystem = new impl::IslandSystem(mesh);
+    FILE* fp = fopen(path.c_str(), "rb");
+    if (!fp || fseek(fp, islandsOffset, SEEK_SET) != 0 ||
+        !islandSystem->load(fp)) {
+      delete islandSystem;
+      islandSystem = nullptr;
+    }
+    if (fp) {
+      fclose(fp);
+    }
+  }
+
+  // the previous navmesh may still use the previous mapping
+  if (navMesh_) {
+    dtFreeNavMesh(navMesh_);
+  }
+  navMesh_ = mesh;
+  navMeshFile_ = std::move(file);
+  delete islandSystem_;
+  islandSystem_ = islandSystem;
+  // the source geometry of a loaded navmesh is unknown
+  delete tileBuilder_;
+  tileBuilder_ = nullptr;
   return initNavQuery();
 }
 
 bool esp::nav::PathFinder::saveNavMesh(const std::string& path) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
   if (!navMesh_)
     return false;
 
-  FILE* fp = fopen(path.c_str(), "wb");
+  // other processes may be mapping the same file, so write a temporary one
+  // that replaces it once complete
+  const std::string tmpPath =
+      path + "." + std::to_string(std::random_device{}()) + ".tmp";
+  FILE* fp = fopen(tmpPath.c_str(), "wb");
   if (!fp)
     return false;
 
-  // Store header.
-  NavMeshSetHeader header;
-  header.magic = NAVMESHSET_MAGIC;
-  header.version = NAVMESHSET_VERSION;
-  header.numTiles = 0;
+  std::vector<const dtMeshTile*> tiles;
   for (int i = 0; i < navMesh_->getMaxTiles(); ++i) {
     const dtMeshTile* tile = ((const dtNavMesh*)navMesh_)->getTile(i);
     if (!tile || !tile->header || !tile->dataSize)
       continue;
-    header.numTiles++;
+    tiles.push_back(tile);
   }
-  memcpy(&header.params, navMesh_->getParams(), sizeof(dtNavMeshParams));
-  fwrite(&header, sizeof(NavMeshSetHeader), 1, fp);
 
-  // Store tiles.
-  for (int i = 0; i < navMesh_->getMaxTiles(); ++i) {
-    const dtMeshTile* tile = ((const dtNavMesh*)navMesh_)->getTile(i);
-    if (!tile || !tile->header || !tile->dataSize)
-      continue;
+  // Lay out the tile data at aligned offsets after the header and the index
+  std::vector<NavMeshTileIndexEntry> index(tiles.size());
+  uint64_t offset =
+      NAVMESHSET_INDEX_OFFSET + index.size() * sizeof(NavMeshTileIndexEntry);
+  for (size_t i = 0; i < tiles.size(); ++i) {
+    offset = (offset + NAVMESHSET_TILE_ALIGNMENT - 1) /
+             NAVMESHSET_TILE_ALIGNMENT * NAVMESHSET_TILE_ALIGNMENT;
+    index[i].tileRef = navMesh_->getTileRef(tiles[i]);
+    index[i].offset = offset;
+    index[i].dataSize = tiles[i]->dataSize;
+    index[i].checksum = io::crc32(tiles[i]->data, tiles[i]->dataSize);
+    offset += tiles[i]->dataSize;
+  }
+  // Islands, if any, follow the tiles, so that loading does not have to
+  // recompute them
+  const uint64_t islandsOffset = islandSystem_ ? offset : 0;
 
-    NavMeshTileHeader tileHeader;
-    tileHeader.tileRef = navMesh_->getTileRef(tile);
-    tileHeader.dataSize = tile->dataSize;
-    fwrite(&tileHeader, sizeof(tileHeader), 1, fp);
+  // Store header and index.
+  NavMeshSetHeader header;
+  header.magic = NAVMESHSET_MAGIC;
+  header.version = NAVMESHSET_VERSION;
+  header.numTiles = tiles.size();
+  memcpy(&header.params, navMesh_->getParams(), sizeof(dtNavMeshParams));
+  bool ok = fwrite(&header, sizeof(NavMeshSetHeader), 1, fp) == 1;
+  ok = ok && fwrite(&islandsOffset, sizeof(islandsOffset), 1, fp) == 1;
+  ok = ok && (index.empty() ||
+              fwrite(index.data(), sizeof(NavMeshTileIndexEntry),
+                     index.size(), fp) == index.size());
 
-    fwrite(tile->data, tile->dataSize, 1, fp);
+  // Store tiles.
+  uint64_t written =
+      NAVMESHSET_INDEX_OFFSET + index.size() * sizeof(NavMeshTileIndexEntry);
+  const char padding[NAVMESHSET_TILE_ALIGNMENT] = {};
+  for (size_t i = 0; i < tiles.size() && ok; ++i) {
+    const size_t paddingSize = index[i].offset - written;
+    ok = paddingSize == 0 || fwrite(padding, paddingSize, 1, fp) == 1;
+    ok = ok && fwrite(tiles[i]->data, tiles[i]->dataSize, 1, fp) == 1;
+    written = index[i].offset + index[i].dataSize;
   }
 
-  fclose(fp);
+  if (ok && islandSystem_) {
+    ok = islandSystem_->save(fp);
+  }
 
-  return true;
+  ok = fclose(fp) == 0 && ok;
+#ifdef _WIN32
+  // rename does not replace existing files there
+  ok = ok && (!io::exists(path) || std::remove(path.c_str()) == 0);
+#endif
+  ok = ok && std::rename(tmpPath.c_str(), path.c_str()) == 0;
+  if (!ok) {
+    std::remove(tmpPath.c_str());
+  }
+  return ok;
 }
 
 void esp::nav::PathFinder::seed(uint32_t newSeed) {
-  // TODO: this should be using core::Random instead, but passing function
-  // to navQuery_->findRandomPoint needs to be figured out first
-  srand(newSeed);
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  random_.seed(newSeed);
 }
 
-// Returns a random number [0..1]
+// navQuery_->findRandomPoint takes a plain function, so the generator of the
+// sampling PathFinder is passed to it through a thread-local pointer
+static thread_local esp::core::Random* frandGenerator = nullptr;
+
+// Returns a random number [0..1)
 static float frand() {
-  return (float)rand() / (float)RAND_MAX;
+  return frandGenerator->uniform_float_01();
 }
 
 vec3f esp::nav::PathFinder::getRandomNavigablePoint() {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
   dtPolyRef ref;
   vec3f pt;
+  frandGenerator = &random_;
   dtStatus status = navQuery_->findRandomPoint(filter_, frand, &ref, pt.data());
+  frandGenerator = nullptr;
   if (!dtStatusSucceed(status)) {
     LOG(ERROR) << "Failed to getRandomNavigablePoint";
   }
   return pt;
 }
 
+std::vector<esp::vec3f> esp::nav::PathFinder::getRandomNavigablePoints(
+    const int numPoints,
+    const float minIslandRadius /* = 0 */) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  std::vector<vec3f> points;
+  if (!isLoaded()) {
+    LOG(ERROR) << "PathFinder::getRandomNavigablePoints: no navmesh loaded";
+    return points;
+  }
+  points.reserve(numPoints);
+
+  // give up if the islands that are large enough are only a tiny part of the
+  // navmesh
+  const int maxTries = 100 * numPoints;
+  frandGenerator = &random_;
+  for (int iTry = 0;
+       iTry < maxTries && static_cast<int>(points.size()) < numPoints;
+       ++iTry) {
+    dtPolyRef ref;
+    vec3f pt;
+    dtStatus status =
+        navQuery_->findRandomPoint(filter_, frand, &ref, pt.data());
+    if (dtStatusSucceed(status) &&
+        islandSystem_->islandRadius(ref) >= minIslandRadius) {
+      points.emplace_back(pt);
+    }
+  }
+  frandGenerator = nullptr;
+
+  if (static_cast<int>(points.size()) < numPoints) {
+    LOG(ERROR) << "Only found " << points.size() << " of " << numPoints
+               << " random navigable points on islands of radius >= "
+               << minIslandRadius;
+  }
+  return points;
+}
+
 bool esp::nav::PathFinder::findPath(ShortestPath& path) {
-  MultiGoalShortestPath tmp;
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  ESP_PROFILE_SCOPE("PathFinder::findPath");
+  return findPathWithQuery(path, navQuery_);
+}
+
+bool esp::nav::PathFinder::findPath(MultiGoalShortestPath& path) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  ESP_PROFILE_SCOPE("PathFinder::findPath");
+  return findPathWithQuery(path, navQuery_);
+}
+
+template <typename Task>
+void esp::nav::PathFinder::runQueries(size_t numTasks,
+                                      int numThreads,
+                                      Task task) {
+  numThreads = growQueryPool(numThreads, numTasks);
+  // the calling thread has slot 0
+  core::parallelForWithSlots(numTasks, numThreads, [&](size_t i, int slot) {
+    task(i, slot == 0 ? navQuery_ : queryPool_[slot - 1]);
+  });
+}
+
+std::vector<bool> esp::nav::PathFinder::findPaths(
+    std::vector<ShortestPath>& paths,
+    int numThreads /* = 0 */) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  if (!isLoaded()) {
+    LOG(ERROR) << "PathFinder::findPaths: no navmesh loaded";
+    return std::vector<bool>(paths.size(), false);
+  }
+  // std::vector<bool> packs bits, so threads cannot write it concurrently
+  std::vector<char> found(paths.size(), 0);
+  runQueries(paths.size(), numThreads,
+             [&](size_t i, dtNavMeshQuery* navQuery) {
+               found[i] = findPathWithQuery(paths[i], navQuery);
+             });
+  return std::vector<bool>(found.begin(), found.end());
+}
+
+bool esp::nav::PathFinder::findPathWithQuery(ShortestPath& path,
+                                             dtNavMeshQuery* navQuery) {
+  const bool cached = getPathCacheCapacity() > 0;
+  impl::PathCache::Key key;
+  if (cached) {
+    dtPolyRef startRef, endRef;
+    std::tie(std::ignore, startRef, std::ignore) =
+        projectToPoly(path.requestedStart, navQuery, filter_);
+    std::tie(std::ignore, endRef, std::ignore) =
+        projectToPoly(path.requestedEnd, navQuery, filter_);
+    key = pathCache_->makeKey(startRef, endRef, path.requestedStart,
+                              path.requestedEnd);
+    impl::PathCache::Entry entry;
+    if (pathCache_->find(key, entry)) {
+      path.points = std::move(entry.points);
+      path.geodesicDistance = entry.geodesicDistance;
+      return entry.found;
+    }
+  }
+
+  // kept per thread, so that its vectors keep their capacity across calls
+  thread_local MultiGoalShortestPath tmp;
   tmp.requestedStart = path.requestedStart;
   tmp.requestedEnds.assign({path.requestedEnd});
 
-  bool status = findPath(tmp);
+  bool status = findPathWithQuery(tmp, navQuery);
 
   path.points.assign(tmp.points.begin(), tmp.points.end());
   path.geodesicDistance = tmp.geodesicDistance;
+  if (cached) {
+    pathCache_->insert(key, {path.points, path.geodesicDistance, status});
+  }
 
   return status;
 }
 
-bool esp::nav::PathFinder::findPath(MultiGoalShortestPath& path) {
-  // initialize
-  static const int MAX_POLYS = 256;
-  dtPolyRef polys[MAX_POLYS];
+bool esp::nav::PathFinder::findPathWithQuery(MultiGoalShortestPath& path,
+                                             dtNavMeshQuery* navQuery) {
+  // initialize, the polygons of a path are only bounded by those of the
+  // navmesh; kept per thread so that concurrent searches do not share them
+  thread_local std::vector<dtPolyRef> polys;
+  const int maxPolys = std::max(maxPathPolys_, 1);
+  polys.resize(maxPolys);
   path.geodesicDistance = std::numeric_limits<float>::infinity();
   dtPolyRef startRef;
 
@@ -748,20 +2682,25 @@ bool esp::nav::PathFinder::findPath(MultiGoalShortestPath& path) {
   int numPolys = 0;
   dtStatus status;
   std::tie(status, startRef, pathStart) =
-      projectToPoly(path.requestedStart, navQuery_, filter_);
+      projectToPoly(path.requestedStart, navQuery, filter_);
 
   if (status != DT_SUCCESS || startRef == 0) {
     return false;
   }
 
-  std::vector<vec3f> pathEnds;
-  std::vector<float> pathEndsCoords;
-  std::vector<dtPolyRef> endRefs;
+  // scratch of the query, released on return
+  core::ArenaScope scope;
+  core::ArenaVector<vec3f> pathEnds;
+  core::ArenaVector<float> pathEndsCoords;
+  core::ArenaVector<dtPolyRef> endRefs;
+  pathEnds.reserve(path.requestedEnds.size());
+  pathEndsCoords.reserve(3 * path.requestedEnds.size());
+  endRefs.reserve(path.requestedEnds.size());
   for (const auto& rqEnd : path.requestedEnds) {
     pathEnds.emplace_back();
     endRefs.emplace_back();
     std::tie(status, endRefs.back(), pathEnds.back()) =
-        projectToPoly(rqEnd, navQuery_, filter_);
+        projectToPoly(rqEnd, navQuery, filter_);
 
     pathEndsCoords.emplace_back(pathEnds.back()[0]);
     pathEndsCoords.emplace_back(pathEnds.back()[1]);
@@ -790,10 +2729,24 @@ bool esp::nav::PathFinder::findPath(MultiGoalShortestPath& path) {
   }
 
   int goalFoundIdx;
-  status = navQuery_->findBidirPathToAny(
-      endRefs.size(), startRef, endRefs.data(), path.requestedStart.data(),
-      pathEndsCoords.data(), filter_, polys, &numPolys, MAX_POLYS,
-      &goalFoundIdx);
+  status = DT_FAILURE;
+  // search the corridor over the clusters first
+  thread_local std::vector<char> allowedClusters;
+  if (pathHierarchy_ && pathHierarchy_->corridor(startRef, pathStart, endRefs,
+                                                 pathEnds, allowedClusters)) {
+    const impl::CorridorFilter corridorFilter(*filter_, *pathHierarchy_,
+                                              allowedClusters);
+    status = navQuery->findBidirPathToAny(
+        endRefs.size(), startRef, endRefs.data(), path.requestedStart.data(),
+        pathEndsCoords.data(), &corridorFilter, polys.data(), &numPolys,
+        maxPolys, &goalFoundIdx);
+  }
+  if (status != DT_SUCCESS) {
+    status = navQuery->findBidirPathToAny(
+        endRefs.size(), startRef, endRefs.data(), path.requestedStart.data(),
+        pathEndsCoords.data(), filter_, polys.data(), &numPolys, maxPolys,
+        &goalFoundIdx);
+  }
   if (status != DT_SUCCESS) {
     return false;
   }
@@ -801,10 +2754,12 @@ bool esp::nav::PathFinder::findPath(MultiGoalShortestPath& path) {
   if (numPolys) {
     const vec3f& closestRequestedEnd = path.requestedEnds[goalFoundIdx];
 
-    path.points.resize(MAX_POLYS);
-    status = navQuery_->findStraightPath(
-        path.requestedStart.data(), closestRequestedEnd.data(), polys, numPolys,
-        path.points[0].data(), 0, 0, &numPoints, MAX_POLYS);
+    // a straight path has at most a corner per polygon, plus both ends
+    const int maxPoints = numPolys + 2;
+    path.points.resize(maxPoints);
+    status = navQuery->findStraightPath(
+        path.requestedStart.data(), closestRequestedEnd.data(), polys.data(),
+        numPolys, path.points[0].data(), 0, 0, &numPoints, maxPoints);
 
     if (status != DT_SUCCESS) {
       return false;
@@ -831,20 +2786,48 @@ bool esp::nav::PathFinder::findPath(MultiGoalShortestPath& path) {
 
 template <typename T>
 T esp::nav::PathFinder::tryStep(const T& start, const T& end) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  return tryStepWithQuery(start, end, navQuery_);
+}
+
+std::vector<esp::vec3f> esp::nav::PathFinder::tryStepBatch(
+    const std::vector<vec3f>& starts,
+    const std::vector<vec3f>& ends,
+    int numThreads /* = 0 */) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  ASSERT(starts.size() == ends.size());
+  if (!isLoaded()) {
+    LOG(ERROR) << "PathFinder::tryStepBatch: no navmesh loaded";
+    return ends;
+  }
+  std::vector<vec3f> results(starts.size());
+  runQueries(starts.size(), numThreads,
+             [&](size_t i, dtNavMeshQuery* navQuery) {
+               results[i] = tryStepWithQuery(starts[i], ends[i], navQuery);
+             });
+  return results;
+}
+
+template <typename T>
+T esp::nav::PathFinder::tryStepWithQuery(const T& start,
+                                         const T& end,
+                                         dtNavMeshQuery* navQuery) {
+  // polygons visited by moveAlongSurface, kept per thread so that concurrent
+  // steps do not share it
   static const int MAX_POLYS = 256;
-  dtPolyRef polys[MAX_POLYS];
+  thread_local std::vector<dtPolyRef> polys(MAX_POLYS);
 
   dtPolyRef startRef, endRef;
   vec3f pathStart, pathEnd;
   std::tie(std::ignore, startRef, pathStart) =
-      projectToPoly(start, navQuery_, filter_);
+      projectToPoly(start, navQuery, filter_);
   std::tie(std::ignore, endRef, pathEnd) =
-      projectToPoly(end, navQuery_, filter_);
+      projectToPoly(end, navQuery, filter_);
   vec3f endPoint;
   int numPolys;
-  navQuery_->moveAlongSurface(startRef, pathStart.data(), pathEnd.data(),
-                              filter_, endPoint.data(), polys, &numPolys,
-                              MAX_POLYS);
+  navQuery->moveAlongSurface(startRef, pathStart.data(), pathEnd.data(),
+                             filter_, endPoint.data(), polys.data(), &numPolys,
+                             MAX_POLYS);
 
   // Hack to deal with infinitely thin walls in recast allowing you to
   // transition between two different connected components
@@ -852,7 +2835,7 @@ T esp::nav::PathFinder::tryStep(const T& start, const T& end) {
   // is in the same connected component as the startRef according to
   // findNearestPoly
   std::tie(std::ignore, endRef, std::ignore) =
-      projectToPoly(endPoint, navQuery_, filter_);
+      projectToPoly(endPoint, navQuery, filter_);
   if (!this->islandSystem_->hasConnection(startRef, endRef)) {
     // There isn't a connection!  This happens when endPoint is on an edge
     // shared between two different connected components (aka infinitely thin
@@ -884,7 +2867,28 @@ template Magnum::Vector3 esp::nav::PathFinder::tryStep<Magnum::Vector3>(
     const Magnum::Vector3&,
     const Magnum::Vector3&);
 
+int esp::nav::PathFinder::polyIslandIndex(uint64_t ref) const {
+  return islandSystem_ ? islandSystem_->islandIndex(ref) : -1;
+}
+
+float esp::nav::PathFinder::polyIslandRadius(uint64_t ref) const {
+  return islandSystem_ ? islandSystem_->islandRadius(ref) : 0.0f;
+}
+
+bool esp::nav::PathFinder::rebuildIslands() {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  if (!navMesh_) {
+    return false;
+  }
+  impl::IslandSystem* islandSystem = new impl::IslandSystem(navMesh_);
+  islandSystem->build(filter_);
+  delete islandSystem_;
+  islandSystem_ = islandSystem;
+  return true;
+}
+
 float esp::nav::PathFinder::islandRadius(const vec3f& pt) const {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
   dtPolyRef ptRef;
   dtStatus status;
   std::tie(status, ptRef, std::ignore) = projectToPoly(pt, navQuery_, filter_);
@@ -898,31 +2902,75 @@ float esp::nav::PathFinder::islandRadius(const vec3f& pt) const {
 float esp::nav::PathFinder::distanceToClosestObstacle(
     const vec3f& pt,
     const float maxSearchRadius /*= 2.0*/) const {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
   return closestObstacleSurfacePoint(pt, maxSearchRadius).hitDist;
 }
 
 esp::nav::HitRecord esp::nav::PathFinder::closestObstacleSurfacePoint(
     const vec3f& pt,
     const float maxSearchRadius /*= 2.0*/) const {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  return closestObstacleSurfacePointWithQuery(pt, maxSearchRadius, navQuery_);
+}
+
+esp::nav::HitRecord esp::nav::PathFinder::closestObstacleSurfacePointWithQuery(
+    const vec3f& pt,
+    const float maxSearchRadius,
+    const dtNavMeshQuery* navQuery) const {
   dtPolyRef ptRef;
   dtStatus status;
   vec3f polyPt;
-  std::tie(status, ptRef, polyPt) = projectToPoly(pt, navQuery_, filter_);
+  std::tie(status, ptRef, polyPt) = projectToPoly(pt, navQuery, filter_);
   if (status != DT_SUCCESS || ptRef == 0) {
     return {vec3f(0, 0, 0), vec3f(0, 0, 0),
             std::numeric_limits<float>::infinity()};
   } else {
     vec3f hitPos, hitNormal;
     float hitDist;
-    navQuery_->findDistanceToWall(ptRef, polyPt.data(), maxSearchRadius,
-                                  filter_, &hitDist, hitPos.data(),
-                                  hitNormal.data());
+    navQuery->findDistanceToWall(ptRef, polyPt.data(), maxSearchRadius,
+                                 filter_, &hitDist, hitPos.data(),
+                                 hitNormal.data());
     return {hitPos, hitNormal, hitDist};
   }
 }
 
+std::vector<float> esp::nav::PathFinder::distancesToClosestObstacle(
+    const std::vector<vec3f>& pts,
+    const float maxSearchRadius /*= 2.0*/,
+    int numThreads /* = 0 */) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  std::vector<HitRecord> hits =
+      closestObstacleSurfacePoints(pts, maxSearchRadius, numThreads);
+  std::vector<float> distances(hits.size());
+  for (size_t i = 0; i < hits.size(); ++i) {
+    distances[i] = hits[i].hitDist;
+  }
+  return distances;
+}
+
+std::vector<esp::nav::HitRecord>
+esp::nav::PathFinder::closestObstacleSurfacePoints(
+    const std::vector<vec3f>& pts,
+    const float maxSearchRadius /*= 2.0*/,
+    int numThreads /* = 0 */) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  if (!isLoaded()) {
+    LOG(ERROR) << "PathFinder::closestObstacleSurfacePoints: no navmesh loaded";
+    return std::vector<HitRecord>(
+        pts.size(), {vec3f(0, 0, 0), vec3f(0, 0, 0),
+                     std::numeric_limits<float>::infinity()});
+  }
+  std::vector<HitRecord> hits(pts.size());
+  runQueries(pts.size(), numThreads, [&](size_t i, dtNavMeshQuery* navQuery) {
+    hits[i] =
+        closestObstacleSurfacePointWithQuery(pts[i], maxSearchRadius, navQuery);
+  });
+  return hits;
+}
+
 bool esp::nav::PathFinder::isNavigable(const vec3f& pt,
                                        const float maxYDelta /*= 0.5*/) const {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
   dtPolyRef ptRef;
   dtStatus status;
   vec3f polyPt;
@@ -938,3 +2986,172 @@ bool esp::nav::PathFinder::isNavigable(const vec3f& pt,
 
   return true;
 }
+
+esp::nav::TopDownView::ptr esp::nav::PathFinder::getTopDownView(
+    const float metersPerPixel,
+    const float height,
+    const bool computeIslands /* = false */,
+    const bool computeObstacleDistance /* = false */,
+    const float maxYDelta /* = 0.5 */) const {
+  ESP_PROFILE_SCOPE("PathFinder::getTopDownView");
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  if (!navMesh_ || metersPerPixel <= 0) {
+    LOG(ERROR) << "Cannot make a top-down view without a navmesh, or with "
+               << metersPerPixel << " meters per pixel";
+    return nullptr;
+  }
+
+  const dtNavMesh* navMesh = navMesh_;
+  vec3f bmin = vec3f::Constant(std::numeric_limits<float>::max());
+  vec3f bmax = -bmin;
+  for (int iTile = 0; iTile < navMesh->getMaxTiles(); ++iTile) {
+    const dtMeshTile* tile = navMesh->getTile(iTile);
+    if (!tile || !tile->header)
+      continue;
+    bmin = bmin.cwiseMin(Eigen::Map<const vec3f>(tile->header->bmin));
+    bmax = bmax.cwiseMax(Eigen::Map<const vec3f>(tile->header->bmax));
+  }
+  auto view = TopDownView::create();
+  view->metersPerPixel = metersPerPixel;
+  if (bmin.x() > bmax.x()) {
+    // no tiles
+    bmin = bmax = vec3f::Zero();
+  }
+  view->origin = vec3f(bmin.x(), height, bmin.z());
+  const int cols = std::max(
+      1, static_cast<int>(std::ceil((bmax.x() - bmin.x()) / metersPerPixel)));
+  const int rows = std::max(
+      1, static_cast<int>(std::ceil((bmax.z() - bmin.z()) / metersPerPixel)));
+  const std::vector<size_t> shape = {static_cast<size_t>(rows),
+                                     static_cast<size_t>(cols)};
+  view->navigable = core::Buffer::create(shape, core::DataType::DT_UINT8);
+  uint8_t* navigable = static_cast<uint8_t*>(view->navigable->data);
+  std::fill(navigable, navigable + rows * cols, 0);
+  int32_t* islands = nullptr;
+  if (computeIslands) {
+    view->islands = core::Buffer::create(shape, core::DataType::DT_INT32);
+    islands = static_cast<int32_t*>(view->islands->data);
+    std::fill(islands, islands + rows * cols, -1);
+  }
+  // height difference of the surface drawn into each cell, the closest to
+  // height wins where storeys overlap
+  std::vector<float> cellDelta(rows * cols, maxYDelta);
+
+  // the detail triangles follow the surface more closely than the polygons
+  for (int iTile = 0; iTile < navMesh->getMaxTiles(); ++iTile) {
+    const dtMeshTile* tile = navMesh->getTile(iTile);
+    if (!tile || !tile->header || !tile->detailMeshes)
+      continue;
+    for (int iPoly = 0; iPoly < tile->header->polyCount; ++iPoly) {
+      const dtPoly* poly = &tile->polys[iPoly];
+      if (poly->getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
+        continue;
+      const dtPolyRef ref = navMesh->getPolyRefBase(tile) | iPoly;
+      if (!filter_->passFilter(ref, tile, poly))
+        continue;
+      const int island = islands ? islandSystem_->islandIndex(ref) : -1;
+      const dtPolyDetail& detail = tile->detailMeshes[iPoly];
+      for (int iTri = 0; iTri < detail.triCount; ++iTri) {
+        const unsigned char* tri =
+            &tile->detailTris[(detail.triBase + iTri) * 4];
+        vec3f v[3];
+        for (int k = 0; k < 3; ++k) {
+          v[k] = Eigen::Map<const vec3f>(
+              tri[k] < poly->vertCount
+                  ? &tile->verts[poly->verts[tri[k]] * 3]
+                  : &tile->detailVerts[(detail.vertBase + tri[k] -
+                                        poly->vertCount) *
+                                       3]);
+        }
+        const float minY = std::min({v[0].y(), v[1].y(), v[2].y()});
+        const float maxY = std::max({v[0].y(), v[1].y(), v[2].y()});
+        if (minY > height + maxYDelta || maxY < height - maxYDelta)
+          continue;
+
+        // cells whose center is inside the triangle, in x-z
+        const float area = (v[1].x() - v[0].x()) * (v[2].z() - v[0].z()) -
+                           (v[2].x() - v[0].x()) * (v[1].z() - v[0].z());
+        if (std::abs(area) < 1e-12f)
+          continue;
+        // range of the cells with their centers in the bounds of the triangle
+        auto cellCoordinate = [&](float x, float origin) {
+          return (x - origin) / metersPerPixel - 0.5f;
+        };
+        const int col0 = std::max(
+            0, static_cast<int>(std::ceil(cellCoordinate(
+                   std::min({v[0].x(), v[1].x(), v[2].x()}), bmin.x()))));
+        const int col1 = std::min(
+            cols - 1, static_cast<int>(std::floor(cellCoordinate(
+                          std::max({v[0].x(), v[1].x(), v[2].x()}),
+                          bmin.x()))));
+        const int row0 = std::max(
+            0, static_cast<int>(std::ceil(cellCoordinate(
+                   std::min({v[0].z(), v[1].z(), v[2].z()}), bmin.z()))));
+        const int row1 = std::min(
+            rows - 1, static_cast<int>(std::floor(cellCoordinate(
+                          std::max({v[0].z(), v[1].z(), v[2].z()}),
+                          bmin.z()))));
+        for (int row = row0; row <= row1; ++row) {
+          const float z = bmin.z() + (row + 0.5f) * metersPerPixel;
+          for (int col = col0; col <= col1; ++col) {
+            const float x = bmin.x() + (col + 0.5f) * metersPerPixel;
+            // barycentric coordinates of (x, z), inclusive of the edges so
+            // that cells on edges shared by two triangles are not lost
+            const float b1 = ((x - v[0].x()) * (v[2].z() - v[0].z()) -
+                              (v[2].x() - v[0].x()) * (z - v[0].z())) /
+                             area;
+            const float b2 = ((v[1].x() - v[0].x()) * (z - v[0].z()) -
+                              (x - v[0].x()) * (v[1].z() - v[0].z())) /
+                             area;
+            const float b0 = 1.0f - b1 - b2;
+            constexpr float edgeEpsilon = -1e-5f;
+            if (b0 < edgeEpsilon || b1 < edgeEpsilon || b2 < edgeEpsilon)
+              continue;
+            const float y = b0 * v[0].y() + b1 * v[1].y() + b2 * v[2].y();
+            const float delta = std::abs(y - height);
+            const int cell = row * cols + col;
+            if (delta > cellDelta[cell] ||
+                (navigable[cell] && delta == cellDelta[cell]))
+              continue;
+            cellDelta[cell] = delta;
+            navigable[cell] = 1;
+            if (islands) {
+              islands[cell] = island;
+            }
+          }
+        }
+      }
+    }
+  }
+
+  if (computeObstacleDistance) {
+    view->obstacleDistance =
+        core::Buffer::create(shape, core::DataType::DT_FLOAT);
+    float* distance = static_cast<float*>(view->obstacleDistance->data);
+    for (int cell = 0; cell < rows * cols; ++cell) {
+      distance[cell] =
+          navigable[cell] ? std::numeric_limits<float>::infinity() : 0.0f;
+    }
+    // separable in columns and then rows
+    const int n = std::max(rows, cols);
+    std::vector<float> d(n), z(n + 1);
+    std::vector<int> v(n);
+    for (int col = 0; col < cols; ++col) {
+      distanceTransform1D(distance + col, rows, cols, d, v, z);
+    }
+    for (int row = 0; row < rows; ++row) {
+      distanceTransform1D(distance + row * cols, cols, 1, d, v, z);
+    }
+    // beyond the map is not navigable either
+    for (int row = 0; row < rows; ++row) {
+      for (int col = 0; col < cols; ++col) {
+        const int border =
+            std::min({row + 1, rows - row, col + 1, cols - col});
+        float& cell = distance[row * cols + col];
+        cell = std::min(std::sqrt(cell), static_cast<float>(border)) *
+               metersPerPixel;
+      }
+    }
+  }
+  return view;
+}
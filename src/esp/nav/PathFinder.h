@@ -4,10 +4,16 @@
 
 #pragma once
 
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
+#include "esp/core/Buffer.h"
 #include "esp/core/esp.h"
+#include "esp/core/random.h"
 
 // forward declarations
 class dtNavMesh;
@@ -20,6 +26,9 @@ namespace esp {
 namespace assets {
 class MeshData;
 }
+namespace io {
+class MappedFile;
+}
 namespace nav {
 
 struct HitRecord {
@@ -28,11 +37,53 @@ struct HitRecord {
   float hitDist;
 };
 
+// Top-down map of a navmesh at one height, see PathFinder::getTopDownView().
+// The maps have rows along +z and columns along +x; the center of cell
+// (row, col) is at origin + metersPerPixel * (col + 0.5, 0, row + 0.5)
+struct TopDownView {
+  vec3f origin = vec3f::Zero();
+  float metersPerPixel = 0;
+  // DT_UINT8, 1 where navigable and 0 elsewhere
+  core::Buffer::ptr navigable;
+  // DT_INT32 island of every navigable cell and -1 elsewhere, if requested
+  core::Buffer::ptr islands;
+  // DT_FLOAT distance from every navigable cell to the center of the closest
+  // one that is not, 0 elsewhere, if requested
+  core::Buffer::ptr obstacleDistance;
+  ESP_SMART_POINTERS(TopDownView)
+};
+
+// Counters of the path cache of a PathFinder
+struct PathCacheStats {
+  size_t hits = 0;
+  size_t misses = 0;
+  // paths in the cache
+  size_t size = 0;
+};
+
+// Counters of the heightfield cache of a PathFinder
+struct HeightfieldCacheStats {
+  // tiles (or solo navmeshes) built from a cached heightfield
+  size_t hits = 0;
+  // tiles rasterized
+  size_t misses = 0;
+  // heightfields in the cache, and their bytes
+  size_t size = 0;
+  size_t bytes = 0;
+};
+
 namespace impl {
 struct ActionSpaceGraph;
+class HeightfieldCache;
 class IslandSystem;
+class PathCache;
+class PathHierarchy;
+struct TileBuilder;
 }  // namespace impl
 
+class EpisodeSampler;
+class GeodesicDistanceField;
+
 struct ShortestPath {
   vec3f requestedStart;
   vec3f requestedEnd;
@@ -77,6 +128,9 @@ struct NavMeshSettings {
   float detailSampleDist;
   //! Detail sample max error in voxel heights.
   float detailSampleMaxError;
+  //! Tile size in voxels, 0 builds a single tile navmesh. Tiles are built
+  //! in parallel
+  float tileSize;
   //! Bounds of the area to mesh
   vec3f navMeshBMin;
   vec3f navMeshBMax;
@@ -99,19 +153,20 @@ struct NavMeshSettings {
     vertsPerPoly = 6.0f;
     detailSampleDist = 6.0f;
     detailSampleMaxError = 1.0f;
+    tileSize = 0;
     filterLowHangingObstacles = true;
     filterLedgeSpans = true;
     filterWalkableLowHeightSpans = true;
   }
 };
 
+// The public functions of a PathFinder lock it, so it can be used by several
+// threads at once (e.g., Python threads running with the GIL released), which
+// are served one at a time
 class PathFinder : public std::enable_shared_from_this<PathFinder> {
  public:
   PathFinder();
-  ~PathFinder() {
-    free();
-    LOG(INFO) << "Deconstructing PathFinder";
-  }
+  ~PathFinder();
 
   bool build(const NavMeshSettings& bs,
              const float* verts,
@@ -122,14 +177,103 @@ class PathFinder : public std::enable_shared_from_this<PathFinder> {
              const float* bmax);
   bool build(const NavMeshSettings& bs, const esp::assets::MeshData& mesh);
 
+  // Keep the heightfields build() rasterizes the scene into, before they are
+  // filtered and eroded for the agent, so that building again over the same
+  // geometry with the same cellSize, cellHeight, agentMaxSlope and
+  // agentMaxClimb (in cells) skips rasterization, e.g. for the navmeshes of a
+  // sweep of agentRadius and agentHeight values. Tiles are rasterized with
+  // twice the border their agent needs, so agents of up to about twice the
+  // radius reuse them. With a file, the heightfields in it are loaded now and
+  // all of them are written to it after every build() that rasterized new
+  // ones. Off by default; turning it off drops the heightfields
+  void setHeightfieldCache(bool enabled, const std::string& file = "");
+  bool isHeightfieldCacheEnabled() const;
+  HeightfieldCacheStats getHeightfieldCacheStats() const;
+
+  // Add obstacle obstacleId, or move it if it exists, as mesh in world space.
+  // Only the navmesh tiles overlapping the old and new bounds of the obstacle
+  // are rebuilt, so this requires a tiled navmesh (NavMeshSettings::tileSize
+  // > 0) built by this PathFinder. Obstacles are dropped by the next build()
+  // or loadNavMesh()
+  bool updateObstacle(const int obstacleId, const esp::assets::MeshData& mesh);
+  bool removeObstacle(const int obstacleId);
+
+  // Changes whenever the navmesh does (build(), loadNavMesh(), obstacles,
+  // free()), for users caching paths or moves to tell theirs are stale
+  uint64_t getNavMeshRevision() const { return navMeshRevision_; }
+
+  // Random points are sampled with the generator of this PathFinder, set by
+  // seed(), so PathFinders on different threads sample independently
   vec3f getRandomNavigablePoint();
 
+  // Sample numPoints random navigable points on islands with a radius of at
+  // least minIslandRadius. Returns fewer points if they are too hard to find
+  std::vector<vec3f> getRandomNavigablePoints(const int numPoints,
+                                              const float minIslandRadius = 0);
+
   bool findPath(ShortestPath& path);
   bool findPath(MultiGoalShortestPath& path);
 
+  // Find many shortest paths at once, spread over numThreads threads of the
+  // shared core::ThreadPool (0 uses all of them), each with its own query on
+  // the shared navmesh. Returns whether each path was found, same as
+  // findPath()
+  std::vector<bool> findPaths(std::vector<ShortestPath>& paths,
+                              int numThreads = 0);
+
+  // Keep the results of findPath() and findPaths() for single goals in an
+  // LRU cache of up to capacity paths (default 0, off), keyed by the
+  // polygons of the start and the end and by their positions rounded to
+  // multiples of quantization meters (default 1e-3). A hit returns the path
+  // of the first request with the same key. The cache is cleared whenever the
+  // navmesh changes
+  void setPathCacheCapacity(size_t capacity);
+  size_t getPathCacheCapacity() const;
+  void setPathCacheQuantization(float meters);
+  float getPathCacheQuantization() const;
+  PathCacheStats getPathCacheStats() const;
+  void resetPathCacheStats();
+  void clearPathCache();
+
+  // Plan findPath() over clusters of polygons first, then only search the
+  // polygons of the clusters along the way and next to them, falling back to
+  // the whole navmesh if there is no path through them. Clusters are the
+  // connected polygons with centers in the same box of regions, e.g. the
+  // rooms of a house, or outside of all in the same x-z square of clusterSize
+  // meters. Paths found this way may be slightly longer than the shortest.
+  // A clusterSize of 0 (default) turns it off
+  void setPathHierarchy(float clusterSize,
+                        const std::vector<box3f>& regions = {});
+  float getPathHierarchyClusterSize() const;
+  // clusters of the current navmesh, 0 if off
+  size_t getPathHierarchyNumClusters() const;
+
+  // Goal sets, e.g. the view points of the objects of an ObjectNav episode,
+  // are registered once: their projections to the navmesh and polygons are
+  // kept along with a GeodesicDistanceField seeded from all of them, so a
+  // query costs about the same for hundreds of goals as for one. They are
+  // recomputed whenever the navmesh changes. Returns the id of the set
+  int registerGoalSet(const std::vector<vec3f>& goals);
+  void unregisterGoalSet(int goalSetId);
+
+  // Geodesic distance from pt to the closest goal of the set, as
+  // GeodesicDistanceField::distanceFrom(); infinity if none can be reached
+  // or there is no such set
+  float distanceToGoalSet(const vec3f& pt, int goalSetId) const;
+
+  // findPath() from path.requestedStart to the closest goal of the set, which
+  // it sets path.requestedEnd to. False if no goal can be reached
+  bool findPathToGoalSet(ShortestPath& path, int goalSetId);
+
   template <typename T>
   T tryStep(const T& start, const T& end);
 
+  // tryStep() for many agents at once, spread over numThreads threads (0 uses
+  // all cores) like findPaths(). Returns the end point of each step
+  std::vector<vec3f> tryStepBatch(const std::vector<vec3f>& starts,
+                                  const std::vector<vec3f>& ends,
+                                  int numThreads = 0);
+
   bool loadNavMesh(const std::string& path);
 
   bool saveNavMesh(const std::string& path);
@@ -142,25 +286,113 @@ class PathFinder : public std::enable_shared_from_this<PathFinder> {
 
   float islandRadius(const vec3f& pt) const;
 
+  // Recompute the islands of the loaded navmesh. build() and loadNavMesh()
+  // keep them up to date already, this is for timing their construction
+  bool rebuildIslands();
+
   float distanceToClosestObstacle(const vec3f& pt,
                                   const float maxSearchRadius = 2.0) const;
   HitRecord closestObstacleSurfacePoint(
       const vec3f& pt,
       const float maxSearchRadius = 2.0) const;
 
+  // distanceToClosestObstacle() and closestObstacleSurfacePoint() for many
+  // points at once, spread over numThreads threads (0 uses all cores) like
+  // findPaths(). For dense queries over a whole floor, the obstacle distance
+  // of getTopDownView() is a single pass instead
+  std::vector<float> distancesToClosestObstacle(
+      const std::vector<vec3f>& pts,
+      const float maxSearchRadius = 2.0,
+      int numThreads = 0);
+  std::vector<HitRecord> closestObstacleSurfacePoints(
+      const std::vector<vec3f>& pts,
+      const float maxSearchRadius = 2.0,
+      int numThreads = 0);
+
   bool isNavigable(const vec3f& pt, const float maxYDelta = 0.5) const;
 
+  // Rasterize the polygons of the navmesh into a top-down map of its x-z
+  // bounds, in square cells of metersPerPixel. A cell is navigable if the
+  // navmesh at its center is within maxYDelta of height, as in isNavigable().
+  // Islands and, through an exact Euclidean distance transform of the map,
+  // obstacle distances are only computed if asked for. Null if no navmesh is
+  // loaded or metersPerPixel is not positive
+  TopDownView::ptr getTopDownView(const float metersPerPixel,
+                                  const float height,
+                                  const bool computeIslands = false,
+                                  const bool computeObstacleDistance = false,
+                                  const float maxYDelta = 0.5) const;
+
   friend impl::ActionSpaceGraph;
+  friend EpisodeSampler;
+  friend GeodesicDistanceField;
 
  protected:
   bool initNavQuery();
-  std::vector<vec3f> prevEnds;
+
+  // island index, -1 if none, and radius of the polygon ref, for the friends
+  // outside of PathFinder.cpp
+  int polyIslandIndex(uint64_t ref) const;
+  float polyIslandRadius(uint64_t ref) const;
+
+  // load a navmesh of the current version in place from a memory mapping
+  bool loadMappedNavMesh(const std::string& path);
+
+  bool findPathWithQuery(MultiGoalShortestPath& path,
+                         dtNavMeshQuery* navQuery);
+  bool findPathWithQuery(ShortestPath& path, dtNavMeshQuery* navQuery);
+
+  template <typename T>
+  T tryStepWithQuery(const T& start, const T& end, dtNavMeshQuery* navQuery);
+
+  // make sure there are queries for numThreads threads (0 uses all threads of
+  // the pool) to run numTasks tasks, returns how many threads can be used
+  int growQueryPool(int numThreads, size_t numTasks);
+
+  void freeQueryPool();
+
+  // run task(i, navQuery) for i in [0, numTasks) on numThreads threads of the
+  // pool (0 uses all of them), each with its own query
+  template <typename Task>
+  void runQueries(size_t numTasks, int numThreads, Task task);
+
+  HitRecord closestObstacleSurfacePointWithQuery(
+      const vec3f& pt,
+      const float maxSearchRadius,
+      const dtNavMeshQuery* navQuery) const;
+
+  // rebuild the tiles overlapping the x-z extent of [bmin, bmax]
+  bool rebuildTiles(const vec3f& bmin, const vec3f& bmax);
 
   impl::IslandSystem* islandSystem_ = nullptr;
+  // shared by the threads of findPaths(), locks itself
+  impl::PathCache* pathCache_ = nullptr;
+  // built for each navmesh from the settings below, null if off
+  impl::PathHierarchy* pathHierarchy_ = nullptr;
+  float pathHierarchyClusterSize_ = 0.0f;
+  std::vector<box3f> pathHierarchyRegions_;
+  // bound on the polygons of a path, the polygons of the navmesh
+  int maxPathPolys_ = 0;
+  // by id, see registerGoalSet()
+  std::map<int, std::shared_ptr<GeodesicDistanceField>> goalSets_;
+  int nextGoalSetId_ = 0;
+  // source geometry of a tiled navmesh, null for solo or loaded navmeshes
+  impl::TileBuilder* tileBuilder_ = nullptr;
+  // rasterized heightfields of build(), null if off
+  impl::HeightfieldCache* heightfieldCache_ = nullptr;
+  // file the tiles of a loaded navmesh point into, if it is mapped
+  std::shared_ptr<io::MappedFile> navMeshFile_;
+  // see getNavMeshRevision(), bumped by initNavQuery() and free()
+  std::atomic<uint64_t> navMeshRevision_{0};
 
   dtNavMesh* navMesh_;
   dtNavMeshQuery* navQuery_;
+  // additional queries for findPaths(), one per thread, allocated on demand
+  std::vector<dtNavMeshQuery*> queryPool_;
   dtQueryFilter* filter_;
+  core::Random random_;
+  // held by every public function; recursive since they call each other
+  mutable std::recursive_mutex mutex_;
   ESP_SMART_POINTERS(PathFinder)
 };
 
@@ -3,8 +3,15 @@
 // LICENSE file in the root directory of this source tree.
 
 #include "PhysicsManager.h"
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+
 #include "esp/assets/CollisionMeshData.h"
 #include "esp/assets/ResourceManager.h"
+#include "esp/core/Profiling.h"
+#include "esp/geo/geo.h"
 
 namespace esp {
 namespace physics {
@@ -74,8 +81,10 @@ int PhysicsManager::addObject(const int objectLibIndex,
 
   //! Draw object via resource manager
   //! Render node as child of physics node
-  resourceManager_->loadObject(configFile, existingObjects_.at(nextObjectID_),
+  resourceManager_->loadObject(configFile, existingObjects_[nextObjectID_],
                                drawables);
+  existingObjectConfigs_[nextObjectID_] = configFile;
+  activeObjectIDs_.insert(nextObjectID_);
 
   return nextObjectID_;
 }
@@ -88,29 +97,93 @@ int PhysicsManager::addObject(const std::string& configFile,
   return physObjectID;
 }
 
+std::vector<int> PhysicsManager::addObjects(
+    const std::vector<int>& objectLibIndices,
+    DrawableGroup* drawables) {
+  const size_t numFreeSlots = recycledObjectIDs_.size();
+  if (objectLibIndices.size() > numFreeSlots) {
+    const size_t numSlots =
+        existingObjects_.size() + objectLibIndices.size() - numFreeSlots;
+    existingObjects_.reserve(numSlots);
+    existingObjectConfigs_.reserve(numSlots);
+  }
+  std::vector<int> physObjectIDs;
+  physObjectIDs.reserve(objectLibIndices.size());
+  for (const int objectLibIndex : objectLibIndices) {
+    physObjectIDs.push_back(addObject(objectLibIndex, drawables));
+  }
+  return physObjectIDs;
+}
+
+int PhysicsManager::removeObjects(const std::vector<int>& physObjectIDs) {
+  // highest ID first, so that the next objects added get the lowest free IDs
+  // first, like in a fresh world
+  std::vector<int> sortedIDs = physObjectIDs;
+  std::sort(sortedIDs.begin(), sortedIDs.end(), std::greater<int>());
+  int numRemoved = 0;
+  for (size_t i = 0; i < sortedIDs.size(); ++i) {
+    if ((i > 0 && sortedIDs[i] == sortedIDs[i - 1]) ||
+        !hasObject(sortedIDs[i])) {
+      continue;
+    }
+    removeObject(sortedIDs[i]);
+    ++numRemoved;
+  }
+  return numRemoved;
+}
+
 int PhysicsManager::removeObject(const int physObjectID) {
-  if (existingObjects_.count(physObjectID) == 0) {
+  if (!hasObject(physObjectID)) {
     LOG(ERROR) << "Failed to remove object: no object with ID " << physObjectID;
     return -1;
   }
-  existingObjects_.at(physObjectID)->removeObject();
-  delete existingObjects_.at(physObjectID);
-  existingObjects_.erase(physObjectID);
+  existingObjects_[physObjectID]->removeObject();
+  delete existingObjects_[physObjectID];
+  existingObjects_[physObjectID] = nullptr;
+  existingObjectConfigs_[physObjectID].clear();
+  activeObjectIDs_.erase(physObjectID);
   deallocateObjectID(physObjectID);
   return physObjectID;
 }
 
+bool PhysicsManager::getObjectCollisionMesh(const int physObjectID,
+                                            assets::MeshData& mesh) {
+  if (!hasObject(physObjectID)) {
+    LOG(ERROR) << "No object with ID " << physObjectID;
+    return false;
+  }
+  const std::vector<assets::CollisionMeshData>& meshGroup =
+      resourceManager_->getCollisionMesh(
+          existingObjectConfigs_[physObjectID]);
+  const Magnum::Matrix4 transform =
+      existingObjects_[physObjectID]->absoluteTransformation();
+
+  mesh = assets::MeshData();
+  for (const assets::CollisionMeshData& meshData : meshGroup) {
+    const uint32_t firstVertex = mesh.vbo.size();
+    for (const Magnum::Vector3& position : meshData.positions) {
+      const Magnum::Vector3 p = transform.transformPoint(position);
+      mesh.vbo.emplace_back(p.x(), p.y(), p.z());
+    }
+    for (const Magnum::UnsignedInt index : meshData.indices) {
+      mesh.ibo.push_back(firstVertex + index);
+    }
+  }
+  return true;
+}
+
 bool PhysicsManager::setObjectMotionType(const int physObjectID,
                                          MotionType mt) {
-  if (existingObjects_.count(physObjectID) == 0) {
+  if (!hasObject(physObjectID)) {
     return false;
   } else {
+    activeObjectIDs_.insert(physObjectID);
     return existingObjects_[physObjectID]->setMotionType(mt);
   }
 }
 
 MotionType PhysicsManager::getObjectMotionType(const int physObjectID) {
-  if (existingObjects_.count(physObjectID) > 0) {
+  if (hasObject(physObjectID)) {
     return existingObjects_[physObjectID]->getMotionType();
   }
   return ERROR_MOTIONTYPE;
@@ -123,6 +196,8 @@ int PhysicsManager::allocateObjectID() {
     return recycledID;
   }
 
+  existingObjects_.push_back(nullptr);
+  existingObjectConfigs_.emplace_back();
   return nextObjectID_++;
 }
 
@@ -142,13 +217,12 @@ int PhysicsManager::makeRigidObject(
 
   //! Instantiate with mesh pointer
   bool objectSuccess =
-      existingObjects_.at(newObjectID)
-          ->initializeObject(physicsObjectAttributes, meshGroup);
+      existingObjects_[newObjectID]->initializeObject(physicsObjectAttributes,
+                                                      meshGroup);
   if (!objectSuccess) {
     deallocateObjectID(newObjectID);
-    delete existingObjects_.at(newObjectID);  // TODO: check this. Could be
-                                              // null?
-    existingObjects_.erase(newObjectID);
+    delete existingObjects_[newObjectID];
+    existingObjects_[newObjectID] = nullptr;
     return -1;
   }
   return newObjectID;
@@ -178,6 +252,31 @@ void PhysicsManager::stepPhysics() {
 }
 
 void PhysicsManager::stepPhysics(double dt) {
+  stepPhysics(dt, 1);
+}
+
+void PhysicsManager::stepPhysics(double dt, int numSteps) {
+  ESP_PROFILE_SCOPE("PhysicsManager::stepPhysics");
+  if (numSteps <= 0) {
+    return;
+  }
+  if (worlds_.empty()) {
+    stepWorld(dt, numSteps);
+    return;
+  }
+  std::vector<PhysicsManager*> worlds{this};
+  bool serial = usesTaskScheduler();
+  for (const std::unique_ptr<PhysicsManager>& world : worlds_) {
+    if (world != nullptr) {
+      worlds.push_back(world.get());
+      serial = serial || world->usesTaskScheduler();
+    }
+  }
+  geo::parallelFor(worlds.size(), serial ? 1 : numWorldThreads_,
+                   [&](size_t i) { worlds[i]->stepWorld(dt, numSteps); });
+}
+
+void PhysicsManager::stepWorld(double dt, int numSteps) {
   // We don't step uninitialized physics sim...
   if (!initialized_) {
     return;
@@ -192,12 +291,280 @@ void PhysicsManager::stepPhysics(double dt) {
 
   // handle in-between step times? Ideally dt is a multiple of
   // sceneMetaData_.timestep
-  double targetTime = worldTime_ + dt;
+  double targetTime = worldTime_ + dt * numSteps;
   while (worldTime_ < targetTime)  // per fixed-step operations can be added
                                    // here
     worldTime_ += fixedTimeStep_;
 }
 
+std::unique_ptr<PhysicsManager> PhysicsManager::createWorld() {
+  return std::make_unique<PhysicsManager>(resourceManager_);
+}
+
+int PhysicsManager::addWorld(
+    scene::SceneNode* node,
+    const assets::PhysicsManagerAttributes& physicsManagerAttributes) {
+  std::unique_ptr<PhysicsManager> world = createWorld();
+  if (!world->initPhysics(node, physicsManagerAttributes)) {
+    LOG(ERROR) << "PhysicsManager::addWorld: cannot initialize the world";
+    return ID_UNDEFINED;
+  }
+  world->setTimestep(fixedTimeStep_);
+  world->maxSubSteps_ = maxSubSteps_;
+
+  // reuse the slot of a removed world, if any
+  auto slot = std::find(worlds_.begin(), worlds_.end(), nullptr);
+  if (slot == worlds_.end()) {
+    slot = worlds_.insert(worlds_.end(), nullptr);
+  }
+  *slot = std::move(world);
+  return static_cast<int>(slot - worlds_.begin()) + 1;
+}
+
+bool PhysicsManager::removeWorld(const int worldID) {
+  if (worldID == 0 || !hasWorld(worldID)) {
+    LOG(ERROR) << "PhysicsManager::removeWorld: no added world " << worldID;
+    return false;
+  }
+  worlds_[worldID - 1] = nullptr;
+  while (!worlds_.empty() && worlds_.back() == nullptr) {
+    worlds_.pop_back();
+  }
+  return true;
+}
+
+PhysicsManager& PhysicsManager::getWorld(const int worldID) {
+  ASSERT(hasWorld(worldID));
+  return worldID == 0 ? *this : *worlds_[worldID - 1];
+}
+
+int PhysicsManager::getNumWorlds() const {
+  return 1 + std::count_if(worlds_.begin(), worlds_.end(),
+                           [](const std::unique_ptr<PhysicsManager>& world) {
+                             return world != nullptr;
+                           });
+}
+
+namespace {
+// layout of a saveState() blob: the header, then numObjects records, then
+// the config file of each object in the order of the records, of the length
+// in its record
+struct PhysicsStateHeader {
+  uint32_t version;
+  uint32_t numObjects;
+  double worldTime;
+};
+struct PhysicsStateRecord {
+  int32_t objectID;
+  uint32_t configLength;
+  RigidObjectState state;
+};
+const uint32_t physicsStateVersion = 2;
+}  // namespace
+
+std::vector<char> PhysicsManager::saveState() {
+  const std::vector<int> objectIDs = getExistingObjectIDs();
+  PhysicsStateHeader header;
+  header.version = physicsStateVersion;
+  header.numObjects = objectIDs.size();
+  header.worldTime = worldTime_;
+
+  size_t size = sizeof(header) + objectIDs.size() * sizeof(PhysicsStateRecord);
+  for (const int physObjectID : objectIDs) {
+    size += existingObjectConfigs_[physObjectID].size();
+  }
+  std::vector<char> state(size);
+  std::memcpy(state.data(), &header, sizeof(header));
+  char* records = state.data() + sizeof(header);
+  char* configs = records + objectIDs.size() * sizeof(PhysicsStateRecord);
+  for (const int physObjectID : objectIDs) {
+    const std::string& configFile = existingObjectConfigs_[physObjectID];
+    PhysicsStateRecord record;
+    record.objectID = physObjectID;
+    record.configLength = configFile.size();
+    record.state = existingObjects_[physObjectID]->getState();
+    std::memcpy(records, &record, sizeof(record));
+    records += sizeof(record);
+    std::memcpy(configs, configFile.data(), configFile.size());
+    configs += configFile.size();
+  }
+  return state;
+}
+
+bool PhysicsManager::restoreState(const std::vector<char>& state,
+                                  DrawableGroup* drawables) {
+  PhysicsStateHeader header;
+  if (state.size() < sizeof(header)) {
+    LOG(ERROR) << "Invalid physics state";
+    return false;
+  }
+  std::memcpy(&header, state.data(), sizeof(header));
+  if (header.version != physicsStateVersion ||
+      (state.size() - sizeof(header)) / sizeof(PhysicsStateRecord) <
+          header.numObjects) {
+    LOG(ERROR) << "Invalid physics state";
+    return false;
+  }
+
+  std::vector<PhysicsStateRecord> records(header.numObjects);
+  if (!records.empty()) {
+    std::memcpy(records.data(), state.data() + sizeof(header),
+                records.size() * sizeof(PhysicsStateRecord));
+  }
+  std::vector<std::string> configFiles;
+  configFiles.reserve(records.size());
+  size_t offset = sizeof(header) + records.size() * sizeof(PhysicsStateRecord);
+  for (const PhysicsStateRecord& record : records) {
+    if (record.objectID < 0 || record.configLength > state.size() - offset) {
+      LOG(ERROR) << "Invalid physics state";
+      return false;
+    }
+    configFiles.emplace_back(state.data() + offset, record.configLength);
+    offset += record.configLength;
+  }
+  std::vector<int> objectIDs;
+  objectIDs.reserve(records.size());
+  for (const PhysicsStateRecord& record : records) {
+    objectIDs.push_back(record.objectID);
+  }
+  std::sort(objectIDs.begin(), objectIDs.end());
+  if (offset != state.size() ||
+      std::adjacent_find(objectIDs.begin(), objectIDs.end()) !=
+          objectIDs.end()) {
+    LOG(ERROR) << "Invalid physics state";
+    return false;
+  }
+  for (const std::string& configFile : configFiles) {
+    if (resourceManager_->getObjectID(configFile) == ID_UNDEFINED) {
+      LOG(ERROR) << "Cannot restore physics state: " << configFile
+                 << " is not in the object library";
+      return false;
+    }
+  }
+
+  // objects added since the snapshot go, and so do those whose ID was taken
+  // by an object of another config after the one of the snapshot was removed
+  std::vector<bool> inSnapshot(existingObjects_.size(), false);
+  std::vector<size_t> missingRecords;
+  for (size_t i = 0; i < records.size(); ++i) {
+    const int physObjectID = records[i].objectID;
+    if (hasObject(physObjectID) &&
+        existingObjectConfigs_[physObjectID] == configFiles[i]) {
+      inSnapshot[physObjectID] = true;
+    } else {
+      missingRecords.push_back(i);
+    }
+  }
+  std::vector<int> staleObjectIDs;
+  for (const int physObjectID : getExistingObjectIDs()) {
+    if (!inSnapshot[physObjectID]) {
+      staleObjectIDs.push_back(physObjectID);
+    }
+  }
+  removeObjects(staleObjectIDs);
+
+  // and the objects of the snapshot that are gone come back with their IDs
+  for (const size_t i : missingRecords) {
+    if (addObjectWithID(records[i].objectID, configFiles[i], drawables) ==
+        ID_UNDEFINED) {
+      LOG(ERROR) << "Cannot restore physics state: cannot add object "
+                 << records[i].objectID << " from " << configFiles[i];
+      return false;
+    }
+  }
+
+  for (const PhysicsStateRecord& record : records) {
+    existingObjects_[record.objectID]->setState(record.state);
+  }
+  worldTime_ = header.worldTime;
+  updateActiveObjects();
+  return true;
+}
+
+int PhysicsManager::addObjectWithID(const int physObjectID,
+                                    const std::string& configFile,
+                                    DrawableGroup* drawables) {
+  if (hasObject(physObjectID)) {
+    return ID_UNDEFINED;
+  }
+  // free slots up to physObjectID, then hand out only physObjectID
+  while (nextObjectID_ <= physObjectID) {
+    existingObjects_.push_back(nullptr);
+    existingObjectConfigs_.emplace_back();
+    recycledObjectIDs_.push_back(nextObjectID_++);
+  }
+  std::vector<int> recycledObjectIDs;
+  recycledObjectIDs.swap(recycledObjectIDs_);
+  recycledObjectIDs.erase(std::remove(recycledObjectIDs.begin(),
+                                      recycledObjectIDs.end(), physObjectID),
+                          recycledObjectIDs.end());
+  recycledObjectIDs_.assign(1, physObjectID);
+  const int addedID = addObject(configFile, drawables);
+  recycledObjectIDs_.swap(recycledObjectIDs);
+  if (addedID != physObjectID || !hasObject(physObjectID)) {
+    // the slot stays free
+    recycledObjectIDs_.push_back(physObjectID);
+    return ID_UNDEFINED;
+  }
+  return addedID;
+}
+
+bool PhysicsManager::copyObjectsFrom(PhysicsManager& source,
+                                     DrawableGroup* drawables) {
+  if (getNumRigidObjects() > 0) {
+    LOG(ERROR) << "PhysicsManager::copyObjectsFrom: the world has objects";
+    return false;
+  }
+  if (source.activePhysSimLib_ == activePhysSimLib_) {
+    shareCachesWith(source);
+  }
+  // every object takes its ID from the recycled ones, so that the IDs are
+  // those of source, holes included
+  existingObjects_.assign(source.existingObjects_.size(), nullptr);
+  existingObjectConfigs_.assign(source.existingObjectConfigs_.size(), {});
+  nextObjectID_ = source.nextObjectID_;
+  for (int physObjectID = 0;
+       physObjectID < static_cast<int>(source.existingObjects_.size());
+       ++physObjectID) {
+    if (!source.hasObject(physObjectID)) {
+      continue;
+    }
+    const std::string& configFile =
+        source.existingObjectConfigs_[physObjectID];
+    recycledObjectIDs_.assign(1, physObjectID);
+    if (addObject(configFile, drawables) != physObjectID) {
+      LOG(ERROR) << "PhysicsManager::copyObjectsFrom: cannot add object "
+                 << physObjectID << " from " << configFile;
+      return false;
+    }
+  }
+  recycledObjectIDs_ = source.recycledObjectIDs_;
+  return restoreState(source.saveState());
+}
+
+void PhysicsManager::addObjectDrawables(DrawableGroup* drawables) {
+  for (int physObjectID = 0;
+       physObjectID < static_cast<int>(existingObjects_.size());
+       ++physObjectID) {
+    if (hasObject(physObjectID)) {
+      resourceManager_->loadObject(existingObjectConfigs_[physObjectID],
+                                   existingObjects_[physObjectID], drawables);
+    }
+  }
+}
+
+void PhysicsManager::updateActiveObjects() {
+  activeObjectIDs_.clear();
+  for (int physObjectID = 0;
+       physObjectID < static_cast<int>(existingObjects_.size());
+       ++physObjectID) {
+    if (existingObjects_[physObjectID] != nullptr &&
+        existingObjects_[physObjectID]->isActive()) {
+      activeObjectIDs_.insert(physObjectID);
+    }
+  }
+}
+
 //! Profile function. In BulletPhysics stationery objects are
 //! marked as inactive to speed up simulation. This function
 //! helps checking how many objects are active/inactive at any
@@ -212,16 +579,11 @@ int PhysicsManager::checkActiveObjects() {
     return 0;
   }
 
+  // only objects in the active set can be awake
   int numActive = 0;
-  int numTotal = 0;
-  for (auto& child : sceneNode_->children()) {
-    physics::RigidObject* childNode =
-        static_cast<physics::RigidObject*>(&child);
-    if (childNode != nullptr) {
-      numTotal += 1;
-      if (childNode->isActive()) {
-        numActive += 1;
-      }
+  for (const int physObjectID : activeObjectIDs_) {
+    if (existingObjects_[physObjectID]->isActive()) {
+      numActive += 1;
     }
   }
   return numActive;
@@ -230,114 +592,131 @@ int PhysicsManager::checkActiveObjects() {
 void PhysicsManager::applyForce(const int physObjectID,
                                 const Magnum::Vector3& force,
                                 const Magnum::Vector3& relPos) {
-  if (existingObjects_.count(physObjectID) > 0) {
+  if (hasObject(physObjectID)) {
     existingObjects_[physObjectID]->applyForce(force, relPos);
+    activeObjectIDs_.insert(physObjectID);
   }
 }
 
 void PhysicsManager::applyImpulse(const int physObjectID,
                                   const Magnum::Vector3& impulse,
                                   const Magnum::Vector3& relPos) {
-  if (existingObjects_.count(physObjectID) > 0) {
+  if (hasObject(physObjectID)) {
     existingObjects_[physObjectID]->applyImpulse(impulse, relPos);
+    activeObjectIDs_.insert(physObjectID);
   }
 }
 
 void PhysicsManager::applyTorque(const int physObjectID,
                                  const Magnum::Vector3& torque) {
-  if (existingObjects_.count(physObjectID) > 0) {
+  if (hasObject(physObjectID)) {
     existingObjects_[physObjectID]->applyTorque(torque);
+    activeObjectIDs_.insert(physObjectID);
   }
 }
 
 void PhysicsManager::applyImpulseTorque(const int physObjectID,
                                         const Magnum::Vector3& impulse) {
-  if (existingObjects_.count(physObjectID) > 0) {
+  if (hasObject(physObjectID)) {
     existingObjects_[physObjectID]->applyImpulseTorque(impulse);
+    activeObjectIDs_.insert(physObjectID);
   }
 }
 
 void PhysicsManager::setTransformation(const int physObjectID,
                                        const Magnum::Matrix4& trans) {
-  if (existingObjects_.count(physObjectID) > 0) {
+  if (hasObject(physObjectID)) {
     existingObjects_[physObjectID]->setTransformation(trans);
+    activeObjectIDs_.insert(physObjectID);
   }
 }
 void PhysicsManager::setTranslation(const int physObjectID,
                                     const Magnum::Vector3& vector) {
-  if (existingObjects_.count(physObjectID) > 0) {
+  if (hasObject(physObjectID)) {
     existingObjects_[physObjectID]->setTranslation(vector);
+    activeObjectIDs_.insert(physObjectID);
   }
 }
 void PhysicsManager::setRotation(const int physObjectID,
                                  const Magnum::Quaternion& quaternion) {
-  if (existingObjects_.count(physObjectID) > 0) {
+  if (hasObject(physObjectID)) {
     existingObjects_[physObjectID]->setRotation(quaternion);
+    activeObjectIDs_.insert(physObjectID);
   }
 }
 void PhysicsManager::resetTransformation(const int physObjectID) {
-  if (existingObjects_.count(physObjectID) > 0) {
+  if (hasObject(physObjectID)) {
     existingObjects_[physObjectID]->resetTransformation();
+    activeObjectIDs_.insert(physObjectID);
   }
 }
 void PhysicsManager::translate(const int physObjectID,
                                const Magnum::Vector3& vector) {
-  if (existingObjects_.count(physObjectID) > 0) {
+  if (hasObject(physObjectID)) {
     existingObjects_[physObjectID]->translate(vector);
+    activeObjectIDs_.insert(physObjectID);
   }
 }
 void PhysicsManager::translateLocal(const int physObjectID,
                                     const Magnum::Vector3& vector) {
-  if (existingObjects_.count(physObjectID) > 0) {
+  if (hasObject(physObjectID)) {
     existingObjects_[physObjectID]->translateLocal(vector);
+    activeObjectIDs_.insert(physObjectID);
   }
 }
 void PhysicsManager::rotate(const int physObjectID,
                             const Magnum::Rad angleInRad,
                             const Magnum::Vector3& normalizedAxis) {
-  if (existingObjects_.count(physObjectID) > 0) {
+  if (hasObject(physObjectID)) {
     existingObjects_[physObjectID]->rotate(angleInRad, normalizedAxis);
+    activeObjectIDs_.insert(physObjectID);
   }
 }
 void PhysicsManager::rotateX(const int physObjectID,
                              const Magnum::Rad angleInRad) {
-  if (existingObjects_.count(physObjectID) > 0) {
+  if (hasObject(physObjectID)) {
     existingObjects_[physObjectID]->rotateX(angleInRad);
+    activeObjectIDs_.insert(physObjectID);
   }
 }
 void PhysicsManager::rotateY(const int physObjectID,
                              const Magnum::Rad angleInRad) {
-  if (existingObjects_.count(physObjectID) > 0) {
+  if (hasObject(physObjectID)) {
     existingObjects_[physObjectID]->rotateY(angleInRad);
+    activeObjectIDs_.insert(physObjectID);
   }
 }
 void PhysicsManager::rotateXLocal(const int physObjectID,
                                   const Magnum::Rad angleInRad) {
-  if (existingObjects_.count(physObjectID) > 0) {
+  if (hasObject(physObjectID)) {
     existingObjects_[physObjectID]->rotateXLocal(angleInRad);
+    activeObjectIDs_.insert(physObjectID);
   }
 }
 void PhysicsManager::rotateYLocal(const int physObjectID,
                                   const Magnum::Rad angleInRad) {
-  if (existingObjects_.count(physObjectID) > 0) {
+  if (hasObject(physObjectID)) {
     existingObjects_[physObjectID]->rotateYLocal(angleInRad);
+    activeObjectIDs_.insert(physObjectID);
   }
 }
 void PhysicsManager::rotateZ(const int physObjectID,
                              const Magnum::Rad angleInRad) {
-  if (existingObjects_.count(physObjectID) > 0) {
+  if (hasObject(physObjectID)) {
     existingObjects_[physObjectID]->rotateZ(angleInRad);
+    activeObjectIDs_.insert(physObjectID);
   }
 }
 void PhysicsManager::rotateZLocal(const int physObjectID,
                                   const Magnum::Rad angleInRad) {
-  if (existingObjects_.count(physObjectID) > 0) {
+  if (hasObject(physObjectID)) {
     existingObjects_[physObjectID]->rotateZLocal(angleInRad);
+    activeObjectIDs_.insert(physObjectID);
   }
 }
 
 Magnum::Matrix4 PhysicsManager::getTransformation(const int physObjectID) {
-  if (existingObjects_.count(physObjectID) > 0) {
+  if (hasObject(physObjectID)) {
     return existingObjects_[physObjectID]->transformation();
   } else {
     return Magnum::Matrix4();
@@ -345,7 +724,7 @@ Magnum::Matrix4 PhysicsManager::getTransformation(const int physObjectID) {
 }
 
 Magnum::Vector3 PhysicsManager::getTranslation(const int physObjectID) {
-  if (existingObjects_.count(physObjectID) > 0) {
+  if (hasObject(physObjectID)) {
     return existingObjects_[physObjectID]->translation();
   } else {
     return Magnum::Vector3();
@@ -353,75 +732,190 @@ Magnum::Vector3 PhysicsManager::getTranslation(const int physObjectID) {
 }
 
 Magnum::Quaternion PhysicsManager::getRotation(const int physObjectID) {
-  if (existingObjects_.count(physObjectID) > 0) {
+  if (hasObject(physObjectID)) {
     return existingObjects_[physObjectID]->rotation();
   } else {
     return Magnum::Quaternion();
   }
 }
 
+void PhysicsManager::castRays(const Magnum::Vector3*,
+                              const Magnum::Vector3*,
+                              size_t numRays,
+                              float,
+                              RaycastHit* hits,
+                              int) {
+  std::fill_n(hits, numRays, RaycastHit{});
+}
+
+void PhysicsManager::sweepShapes(const SweepShape&,
+                                 const Magnum::Vector3*,
+                                 const Magnum::Vector3*,
+                                 size_t numRays,
+                                 float,
+                                 RaycastHit* hits,
+                                 int) {
+  std::fill_n(hits, numRays, RaycastHit{});
+}
+
+void PhysicsManager::moveCharacters(CharacterMove* moves,
+                                    size_t numMoves,
+                                    double,
+                                    int) {
+  for (size_t i = 0; i < numMoves; ++i) {
+    moves[i].position = moves[i].end;
+    moves[i].collided = false;
+    moves[i].objectID = ID_UNDEFINED;
+  }
+}
+
+void PhysicsManager::moveCharacters(std::vector<CharacterMove>& moves,
+                                    double dt,
+                                    int numThreads) {
+  moveCharacters(moves.data(), moves.size(), dt, numThreads);
+}
+
+std::vector<ContactPoint> PhysicsManager::contactTest(const int) {
+  return {};
+}
+
+std::vector<int> PhysicsManager::overlapAABB(const Magnum::Range3D&) {
+  return {};
+}
+
+std::vector<RaycastHit> PhysicsManager::castRays(
+    const std::vector<Magnum::Vector3>& origins,
+    const std::vector<Magnum::Vector3>& directions,
+    float maxDistance,
+    int numThreads) {
+  ASSERT(origins.size() == directions.size());
+  std::vector<RaycastHit> hits(origins.size());
+  castRays(origins.data(), directions.data(), origins.size(), maxDistance,
+           hits.data(), numThreads);
+  return hits;
+}
+
+std::vector<RaycastHit> PhysicsManager::sweepShapes(
+    const SweepShape& shape,
+    const std::vector<Magnum::Vector3>& origins,
+    const std::vector<Magnum::Vector3>& directions,
+    float maxDistance,
+    int numThreads) {
+  ASSERT(origins.size() == directions.size());
+  std::vector<RaycastHit> hits(origins.size());
+  sweepShapes(shape, origins.data(), directions.data(), origins.size(),
+              maxDistance, hits.data(), numThreads);
+  return hits;
+}
+
+std::vector<Magnum::Matrix4> PhysicsManager::getTransformations(
+    const std::vector<int>& physObjectIDs) {
+  std::vector<Magnum::Matrix4> transformations;
+  transformations.reserve(physObjectIDs.size());
+  for (const int physObjectID : physObjectIDs) {
+    transformations.push_back(getTransformation(physObjectID));
+  }
+  return transformations;
+}
+
+void PhysicsManager::setTransformations(
+    const std::vector<int>& physObjectIDs,
+    const std::vector<Magnum::Matrix4>& transformations) {
+  ASSERT(physObjectIDs.size() == transformations.size());
+  for (size_t i = 0; i < physObjectIDs.size(); ++i) {
+    setTransformation(physObjectIDs[i], transformations[i]);
+  }
+}
+
+std::vector<Magnum::Vector3> PhysicsManager::getTranslations(
+    const std::vector<int>& physObjectIDs) {
+  std::vector<Magnum::Vector3> translations;
+  translations.reserve(physObjectIDs.size());
+  for (const int physObjectID : physObjectIDs) {
+    translations.push_back(getTranslation(physObjectID));
+  }
+  return translations;
+}
+
+void PhysicsManager::setTranslations(
+    const std::vector<int>& physObjectIDs,
+    const std::vector<Magnum::Vector3>& translations) {
+  ASSERT(physObjectIDs.size() == translations.size());
+  for (size_t i = 0; i < physObjectIDs.size(); ++i) {
+    setTranslation(physObjectIDs[i], translations[i]);
+  }
+}
+
 //============ Object Setter functions =============
 void PhysicsManager::setMass(const int physObjectID, const double mass) {
   // TODO: talk to property library
-  if (existingObjects_.count(physObjectID) > 0) {
+  if (hasObject(physObjectID)) {
     existingObjects_[physObjectID]->setMass(mass);
+    activeObjectIDs_.insert(physObjectID);
   }
 }
 void PhysicsManager::setCOM(const int physObjectID,
                             const Magnum::Vector3& COM) {
   // TODO: talk to property library
-  if (existingObjects_.count(physObjectID) > 0) {
+  if (hasObject(physObjectID)) {
     existingObjects_[physObjectID]->setCOM(COM);
+    activeObjectIDs_.insert(physObjectID);
   }
 }
 void PhysicsManager::setInertia(const int physObjectID,
                                 const Magnum::Vector3& inertia) {
   // TODO: talk to property library
-  if (existingObjects_.count(physObjectID) > 0) {
+  if (hasObject(physObjectID)) {
     existingObjects_[physObjectID]->setInertia(inertia);
+    activeObjectIDs_.insert(physObjectID);
   }
 }
 void PhysicsManager::setScale(const int physObjectID, const double scale) {
   // TODO: talk to property library
-  if (existingObjects_.count(physObjectID) > 0) {
+  if (hasObject(physObjectID)) {
     existingObjects_[physObjectID]->setScale(scale);
+    activeObjectIDs_.insert(physObjectID);
   }
 }
 void PhysicsManager::setFrictionCoefficient(const int physObjectID,
                                             const double frictionCoefficient) {
   // TODO: talk to property library
-  if (existingObjects_.count(physObjectID) > 0) {
+  if (hasObject(physObjectID)) {
     existingObjects_[physObjectID]->setFrictionCoefficient(frictionCoefficient);
+    activeObjectIDs_.insert(physObjectID);
   }
 }
 void PhysicsManager::setRestitutionCoefficient(
     const int physObjectID,
     const double restitutionCoefficient) {
   // TODO: talk to property library
-  if (existingObjects_.count(physObjectID) > 0) {
+  if (hasObject(physObjectID)) {
     existingObjects_[physObjectID]->setRestitutionCoefficient(
         restitutionCoefficient);
+    activeObjectIDs_.insert(physObjectID);
   }
 }
 void PhysicsManager::setLinearDamping(const int physObjectID,
                                       const double linDamping) {
   // TODO: talk to property library
-  if (existingObjects_.count(physObjectID) > 0) {
+  if (hasObject(physObjectID)) {
     existingObjects_[physObjectID]->setLinearDamping(linDamping);
+    activeObjectIDs_.insert(physObjectID);
   }
 }
 void PhysicsManager::setAngularDamping(const int physObjectID,
                                        const double angDamping) {
   // TODO: talk to property library
-  if (existingObjects_.count(physObjectID) > 0) {
+  if (hasObject(physObjectID)) {
     existingObjects_[physObjectID]->setAngularDamping(angDamping);
+    activeObjectIDs_.insert(physObjectID);
   }
 }
 
 //============ Object Getter functions =============
 double PhysicsManager::getMass(const int physObjectID) {
   // TODO: talk to property library
-  if (existingObjects_.count(physObjectID) > 0) {
+  if (hasObject(physObjectID)) {
     return existingObjects_[physObjectID]->getMass();
   } else {
     return PHYSICS_ATTR_UNDEFINED;
@@ -430,7 +924,7 @@ double PhysicsManager::getMass(const int physObjectID) {
 
 Magnum::Vector3 PhysicsManager::getCOM(const int physObjectID) {
   // TODO: talk to property library
-  if (existingObjects_.count(physObjectID) > 0) {
+  if (hasObject(physObjectID)) {
     return existingObjects_[physObjectID]->getCOM();
   } else {
     return Magnum::Vector3();
@@ -439,7 +933,7 @@ Magnum::Vector3 PhysicsManager::getCOM(const int physObjectID) {
 
 Magnum::Vector3 PhysicsManager::getInertiaVector(const int physObjectID) {
   // TODO: talk to property library
-  if (existingObjects_.count(physObjectID) > 0) {
+  if (hasObject(physObjectID)) {
     return existingObjects_[physObjectID]->getInertiaVector();
   } else {
     return Magnum::Vector3();
@@ -448,7 +942,7 @@ Magnum::Vector3 PhysicsManager::getInertiaVector(const int physObjectID) {
 
 Magnum::Matrix3 PhysicsManager::getInertiaMatrix(const int physObjectID) {
   // TODO: talk to property library
-  if (existingObjects_.count(physObjectID) > 0) {
+  if (hasObject(physObjectID)) {
     return existingObjects_[physObjectID]->getInertiaMatrix();
   } else {
     return Magnum::Matrix3();
@@ -457,7 +951,7 @@ Magnum::Matrix3 PhysicsManager::getInertiaMatrix(const int physObjectID) {
 
 double PhysicsManager::getScale(const int physObjectID) {
   // TODO: talk to property library
-  if (existingObjects_.count(physObjectID) > 0) {
+  if (hasObject(physObjectID)) {
     return existingObjects_[physObjectID]->getScale();
   } else {
     return PHYSICS_ATTR_UNDEFINED;
@@ -466,7 +960,7 @@ double PhysicsManager::getScale(const int physObjectID) {
 
 double PhysicsManager::getFrictionCoefficient(const int physObjectID) {
   // TODO: talk to property library
-  if (existingObjects_.count(physObjectID) > 0) {
+  if (hasObject(physObjectID)) {
     return existingObjects_[physObjectID]->getFrictionCoefficient();
   } else {
     return PHYSICS_ATTR_UNDEFINED;
@@ -475,7 +969,7 @@ double PhysicsManager::getFrictionCoefficient(const int physObjectID) {
 
 double PhysicsManager::getRestitutionCoefficient(const int physObjectID) {
   // TODO: talk to property library
-  if (existingObjects_.count(physObjectID) > 0) {
+  if (hasObject(physObjectID)) {
     return existingObjects_[physObjectID]->getRestitutionCoefficient();
   } else {
     return PHYSICS_ATTR_UNDEFINED;
@@ -484,7 +978,7 @@ double PhysicsManager::getRestitutionCoefficient(const int physObjectID) {
 
 double PhysicsManager::getLinearDamping(const int physObjectID) {
   // TODO: talk to property library
-  if (existingObjects_.count(physObjectID) > 0) {
+  if (hasObject(physObjectID)) {
     return existingObjects_[physObjectID]->getLinearDamping();
   } else {
     return PHYSICS_ATTR_UNDEFINED;
@@ -493,7 +987,7 @@ double PhysicsManager::getLinearDamping(const int physObjectID) {
 
 double PhysicsManager::getAngularDamping(const int physObjectID) {
   // TODO: talk to property library
-  if (existingObjects_.count(physObjectID) > 0) {
+  if (hasObject(physObjectID)) {
     return existingObjects_[physObjectID]->getAngularDamping();
   } else {
     return PHYSICS_ATTR_UNDEFINED;
@@ -6,6 +6,7 @@
 
 #include <map>
 #include <memory>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -29,8 +30,62 @@ class ResourceManager;
 
 namespace physics {
 
-// TODO: repurpose to manage multiple physical worlds. Currently represents
-// exactly 1 world.
+//! Closest hit of a ray or a swept shape, see PhysicsManager::castRays() and
+//! PhysicsManager::sweepShapes()
+struct RaycastHit {
+  //! Whether anything is hit within the maximum distance
+  bool hit = false;
+  //! ID of the object hit, ID_UNDEFINED for the scene
+  int objectID = ID_UNDEFINED;
+  //! Distance to the hit along the normalized direction
+  float distance = 0.0f;
+  //! Hit point and surface normal in world space
+  Magnum::Vector3 point;
+  Magnum::Vector3 normal;
+};
+
+//! Shape swept by PhysicsManager::sweepShapes(): a capsule along the up axis
+//! with a cylinder halfHeight high above and below its center, a sphere for
+//! halfHeight 0
+struct SweepShape {
+  float radius = 0.1f;
+  float halfHeight = 0.0f;
+};
+
+//! Move of a kinematic character, see PhysicsManager::moveCharacters()
+struct CharacterMove {
+  //! Shape of the character, centered on its position
+  SweepShape shape;
+  //! Mass the character pushes dynamic objects with, 0 to push none
+  float mass = 0.0f;
+  //! Where the center of the shape starts and where the move would take it
+  Magnum::Vector3 start;
+  Magnum::Vector3 end;
+  //! Where the move stops, whether anything blocked it and the last object
+  //! that did, ID_UNDEFINED for the scene
+  Magnum::Vector3 position;
+  bool collided = false;
+  int objectID = ID_UNDEFINED;
+};
+
+//! Contact between an object and another object or the scene, see
+//! PhysicsManager::contactTest()
+struct ContactPoint {
+  //! The object tested, and the one it touches, ID_UNDEFINED for the scene
+  int objectIDA = ID_UNDEFINED;
+  int objectIDB = ID_UNDEFINED;
+  //! Closest points of the two objects and the contact normal on object B,
+  //! in world space
+  Magnum::Vector3 positionOnA;
+  Magnum::Vector3 positionOnB;
+  Magnum::Vector3 normalOnB;
+  //! Distance between the points, negative while they penetrate
+  float distance = 0.0f;
+};
+
+// A physical world, which can own further independent worlds, e.g. one per
+// scene of a batch of environments, see addWorld(). The manager itself is
+// world 0.
 class PhysicsManager {
  public:
   explicit PhysicsManager(assets::ResourceManager* _resourceManager) {
@@ -49,6 +104,63 @@ class PhysicsManager {
   virtual void reset(){
       /* TODO: reset object states or clear them? Reset worldTime? Other? */};
 
+  //! Snapshot of the world time and the config file and state of all
+  //! objects (see RigidObjectState) as a compact blob
+  std::vector<char> saveState();
+  //! Restore a snapshot of saveState() in place. Objects of the snapshot that
+  //! still exist with the same ID and config keep their instances; objects
+  //! added since, including those that took the ID of a removed object of
+  //! the snapshot, are removed, and removed objects of the snapshot are
+  //! added again with their IDs, their drawables into drawables. So
+  //! restoring a snapshot taken at the start of an episode resets it.
+  //! Returns false, without changing anything, if the snapshot is invalid
+  //! or one of its configs is not in the object library, and also if adding
+  //! one of its objects again fails
+  bool restoreState(const std::vector<char>& state,
+                    DrawableGroup* drawables = nullptr);
+
+  //! Add the objects of source, a world of another manager of the same
+  //! object library, with the same IDs, and restore their states and the
+  //! world time from it, e.g. to fork a simulator. Collision shapes the
+  //! engine caches are shared with source. Properties changed since an
+  //! object was added, like its mass, are not copied. This world has to have
+  //! no objects. Returns false if an object cannot be added
+  bool copyObjectsFrom(PhysicsManager& source, DrawableGroup* drawables);
+
+  //! Add drawables of the objects to drawables, for objects added while the
+  //! resource manager had the GPU disabled, see
+  //! assets::ResourceManager::setGpuEnabled()
+  void addObjectDrawables(DrawableGroup* drawables);
+
+  //============ Multiple worlds =============
+  //! Add an independent world with its own scene, objects and time, whose
+  //! objects are instanced from the same object library. Bullet worlds also
+  //! share the collision shapes of the objects. The world is initialized
+  //! like initPhysics(node, physicsManagerAttributes) and takes the timestep
+  //! of this one. Returns its world ID, ID_UNDEFINED if it cannot be
+  //! initialized
+  int addWorld(
+      scene::SceneNode* node,
+      const assets::PhysicsManagerAttributes& physicsManagerAttributes);
+  //! Remove an added world with its objects; false if there is none, or for
+  //! world 0
+  bool removeWorld(const int worldID);
+  //! Whether worldID refers to this world (0) or an added one
+  bool hasWorld(const int worldID) const {
+    return worldID == 0 ||
+           (worldID > 0 && worldID <= static_cast<int>(worlds_.size()) &&
+            worlds_[worldID - 1] != nullptr);
+  }
+  //! The world worldID, which has to exist
+  PhysicsManager& getWorld(const int worldID);
+  //! Number of worlds, this one included
+  int getNumWorlds() const;
+  //! Threads stepPhysics() steps the worlds on, 0 (default) for all threads
+  //! of the shared core::ThreadPool
+  void setNumWorldThreads(const int numThreads) {
+    numWorldThreads_ = numThreads;
+  }
+
   // Stores references to a set of drawable elements
   using DrawableGroup = Magnum::SceneGraph::DrawableGroup3D;
 
@@ -68,26 +180,117 @@ class PhysicsManager {
   int addObject(const int objectLibIndex, DrawableGroup* drawables);
   //! Remove added object by physics object ID
   virtual int removeObject(const int physObjectID);
+  //! Add an object of each of objectLibIndices, e.g. when populating an
+  //! episode. Returns their IDs in order, -1 for those that failed
+  std::vector<int> addObjects(const std::vector<int>& objectLibIndices,
+                              DrawableGroup* drawables);
+  //! Remove the objects of physObjectIDs, e.g. all of them on an episode
+  //! reset. Returns how many there were
+  int removeObjects(const std::vector<int>& physObjectIDs);
 
   // return the number of tracked existingObjects_
-  int getNumRigidObjects() { return existingObjects_.size(); };
+  int getNumRigidObjects() {
+    return existingObjects_.size() - recycledObjectIDs_.size();
+  };
 
   // return a vector of ints listing all existing object IDs
   std::vector<int> getExistingObjectIDs() {
     std::vector<int> v;
-    for (auto& bro : existingObjects_) {
-      v.push_back(bro.first);
+    for (int physObjectID = 0;
+         physObjectID < static_cast<int>(existingObjects_.size());
+         ++physObjectID) {
+      if (existingObjects_[physObjectID] != nullptr) {
+        v.push_back(physObjectID);
+      }
     }
     return v;
   };
 
+  //! Whether physObjectID refers to an existing object
+  bool hasObject(const int physObjectID) const {
+    return physObjectID >= 0 &&
+           physObjectID < static_cast<int>(existingObjects_.size()) &&
+           existingObjects_[physObjectID] != nullptr;
+  }
+
+  //! Get the collision mesh of an object, transformed into world space.
+  //! Returns false if there is no object with ID physObjectID
+  bool getObjectCollisionMesh(const int physObjectID, assets::MeshData& mesh);
+
+  //============ Collision queries =============
+  //! Closest hits of numRays rays from origins along directions, up to
+  //! maxDistance, into the preallocated hits; on up to numThreads threads (0
+  //! for all of the pool). The queries only read the world, which
+  //! must not change while they run. This world has no collision geometry,
+  //! so nothing is hit
+  virtual void castRays(const Magnum::Vector3* origins,
+                        const Magnum::Vector3* directions,
+                        size_t numRays,
+                        float maxDistance,
+                        RaycastHit* hits,
+                        int numThreads = 0);
+  //! Like castRays(), for shape swept from origins along directions
+  virtual void sweepShapes(const SweepShape& shape,
+                           const Magnum::Vector3* origins,
+                           const Magnum::Vector3* directions,
+                           size_t numRays,
+                           float maxDistance,
+                           RaycastHit* hits,
+                           int numThreads = 0);
+  //! One hit per entry of origins and directions, which have the same size
+  std::vector<RaycastHit> castRays(
+      const std::vector<Magnum::Vector3>& origins,
+      const std::vector<Magnum::Vector3>& directions,
+      float maxDistance,
+      int numThreads = 0);
+  std::vector<RaycastHit> sweepShapes(
+      const SweepShape& shape,
+      const std::vector<Magnum::Vector3>& origins,
+      const std::vector<Magnum::Vector3>& directions,
+      float maxDistance,
+      int numThreads = 0);
+
+  //! Resolve the moves of many kinematic characters in one pass, on up to
+  //! numThreads threads: each sweeps its shape from start towards end, stops
+  //! short of what it hits and slides the rest of the move along the surface
+  //! hit, a few times at most. The characters do not block each other. Then
+  //! each dynamic object a character ran into is pushed with the momentum of
+  //! the part of the move it blocked, as if over dt seconds. In this world the
+  //! characters move freely
+  virtual void moveCharacters(CharacterMove* moves,
+                              size_t numMoves,
+                              double dt,
+                              int numThreads = 0);
+  void moveCharacters(std::vector<CharacterMove>& moves,
+                      double dt,
+                      int numThreads = 0);
+
+  //! Contacts of object physObjectID with the scene and the other objects
+  //! where it stands now, without stepping the world, e.g. to check that a
+  //! placement is free of collisions: only points that touch or penetrate,
+  //! empty if there is no such object. This world has no collision geometry
+  virtual std::vector<ContactPoint> contactTest(const int physObjectID);
+  //! IDs of the objects whose collision bounds overlap box in world space,
+  //! in increasing order and ID_UNDEFINED first if the scene does. A broad
+  //! test, to narrow down with contactTest()
+  virtual std::vector<int> overlapAABB(const Magnum::Range3D& box);
+
   // get/set MotionType
   bool setObjectMotionType(const int physObjectID, MotionType mt);
   MotionType getObjectMotionType(const int physObjectID);
 
   //============ Simulator functions =============
-  virtual void stepPhysics();
-  virtual void stepPhysics(double dt);
+  //! Step this world and all added worlds by dt, the worlds in parallel.
+  //! Worlds stepped on Bullet's task scheduler are stepped one at a time,
+  //! since it runs one parallel section at a time
+  void stepPhysics();
+  void stepPhysics(double dt);
+  //! Step all worlds numSteps times by dt in one go, e.g. the frames skipped
+  //! per action: the fixed substeps of all of them are taken at once and
+  //! the scene nodes and active objects updated only after the last. Takes
+  //! the substeps of numSteps calls of stepPhysics(dt), up to the rounding
+  //! of the time accumulated between substeps
+  void stepPhysics(double dt, int numSteps);
 
   // =========== Global Setter functions ===========
   virtual void setTimestep(double dt);
@@ -128,6 +331,19 @@ class PhysicsManager {
   Magnum::Vector3 getTranslation(const int physObjectID);
   Magnum::Quaternion getRotation(const int physObjectID);
 
+  // ============ Batched transformation functions =============
+  //! One entry per ID of physObjectIDs; like their single object versions,
+  //! unknown IDs are skipped by the setters and give default values in the
+  //! getters
+  std::vector<Magnum::Matrix4> getTransformations(
+      const std::vector<int>& physObjectIDs);
+  void setTransformations(const std::vector<int>& physObjectIDs,
+                          const std::vector<Magnum::Matrix4>& transformations);
+  std::vector<Magnum::Vector3> getTranslations(
+      const std::vector<int>& physObjectIDs);
+  void setTranslations(const std::vector<int>& physObjectIDs,
+                       const std::vector<Magnum::Vector3>& translations);
+
   // ============ Object Setter functions =============
   // Setters that interface with physics need to take
   void setMass(const int physObjectID, const double mass);
@@ -185,11 +401,35 @@ class PhysicsManager {
   // recycle an physObjectID
   int deallocateObjectID(int physObjectID);
 
+  //! Add an object of configFile with the free ID physObjectID, e.g. to
+  //! bring back a removed object of a snapshot. ID_UNDEFINED if it fails
+  int addObjectWithID(const int physObjectID,
+                      const std::string& configFile,
+                      DrawableGroup* drawables);
+
+  //! Rebuild activeObjectIDs_ from the objects that are awake, e.g. after
+  //! stepping the world
+  void updateActiveObjects();
+
   //! Create and initialize rigid object
   virtual int makeRigidObject(
       const std::vector<assets::CollisionMeshData>& meshGroup,
       assets::PhysicsObjectAttributes physicsObjectAttributes);
 
+  //! Step only this world numSteps times by dt, see stepPhysics()
+  virtual void stepWorld(double dt, int numSteps = 1);
+
+  //! Create an uninitialized world for addWorld() of the same engine, sharing
+  //! whatever the engine caches across worlds
+  virtual std::unique_ptr<PhysicsManager> createWorld();
+
+  //! Share whatever the engine caches across worlds with source, a world of
+  //! the same engine, like createWorld() does
+  virtual void shareCachesWith(const PhysicsManager& source) {}
+
+  //! Whether stepWorld() runs on Bullet's process-wide task scheduler
+  virtual bool usesTaskScheduler() const { return false; }
+
   // use this to instantiate physics objects from the physicsObjectLibrary_
   assets::ResourceManager* resourceManager_;
 
@@ -202,23 +442,36 @@ class PhysicsManager {
   physics::RigidObject* sceneNode_ = nullptr;
 
   //! ==== dynamic object resources ===
-  std::map<int, physics::RigidObject*> existingObjects_;
+  // dense slots indexed by object ID, nullptr for the IDs in
+  // recycledObjectIDs_, so that adding and removing an object takes
+  // constant time
+  std::vector<physics::RigidObject*> existingObjects_;
+  // config file each object was created from, by the slots of
+  // existingObjects_; empty for free slots
+  std::vector<std::string> existingObjectConfigs_;
   int nextObjectID_ = 0;
   std::vector<int>
       recycledObjectIDs_;  // removed object IDs are pushed here and popped
                            // first when constructing new objects.
+  //! Objects which may be awake: those awake after the last step, and those
+  //! added or changed through the manager since. An object outside of it is
+  //! asleep, so while it is empty stepping has nothing to simulate
+  std::set<int> activeObjectIDs_;
 
   //! ==== Rigid object memory management ====
 
   //! Utilities
   bool initialized_ = false;
-  float total_time_ = 0.0f;
-  int total_frames_ = 0;
   int maxSubSteps_ = 10;
   double fixedTimeStep_ = 1.0 / 240.0;
   // assets::PhysicsSceneMetaData sceneMetaData_;
   double worldTime_ = 0.0;
 
+  //! ==== Added worlds ====
+  // slots indexed by world ID - 1, nullptr for removed worlds
+  std::vector<std::unique_ptr<PhysicsManager>> worlds_;
+  int numWorldThreads_ = 0;
+
   ESP_SMART_POINTERS(PhysicsManager)
 };
 
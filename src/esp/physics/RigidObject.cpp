@@ -90,6 +90,18 @@ void RigidObject::syncPose() {
   return;
 }
 
+RigidObjectState RigidObject::getState() {
+  RigidObjectState state;
+  state.transformation = transformation();
+  state.motionType = objectMotionType_;
+  return state;
+}
+
+void RigidObject::setState(const RigidObjectState& state) {
+  setMotionType(state.motionType);
+  setTransformation(state.transformation);
+}
+
 scene::SceneNode& RigidObject::setTransformation(
     const Magnum::Matrix4& transformation) {
   if (objectMotionType_ != STATIC) {
@@ -25,6 +25,18 @@ enum MotionType { ERROR_MOTIONTYPE, STATIC, KINEMATIC, DYNAMIC };
 
 enum RigidObjectType { NONE, SCENE, OBJECT };
 
+// dynamic state of an object, as saved and restored by the PhysicsManager.
+// Plain data, so that states can be copied as bytes
+struct RigidObjectState {
+  Magnum::Matrix4 transformation;
+  Magnum::Vector3 linearVelocity;
+  Magnum::Vector3 angularVelocity;
+  MotionType motionType = ERROR_MOTIONTYPE;
+  // engine specific sleeping state of the object
+  int activationState = 0;
+  float deactivationTime = 0.0f;
+};
+
 class RigidObject : public scene::SceneNode {
  public:
   RigidObject(scene::SceneNode* parent);
@@ -69,6 +81,10 @@ class RigidObject : public scene::SceneNode {
 
   virtual bool removeObject();
 
+  //! Save and restore the pose, velocities and activation of the object
+  virtual RigidObjectState getState();
+  virtual void setState(const RigidObjectState& state);
+
   // ==== Transformations ===
   //! Need to overwrite a bunch of functions to update physical states
   virtual SceneNode& setTransformation(const Magnum::Matrix4& transformation);
@@ -5,13 +5,234 @@
 //#include "BulletCollision/Gimpact/btGImpactCollisionAlgorithm.h"
 //#include "BulletCollision/Gimpact/btGImpactShape.h"
 
+#include <algorithm>
+
+#include <LinearMath/btAlignedAllocator.h>
+
 #include "BulletPhysicsManager.h"
 #include "BulletRigidObject.h"
 #include "esp/assets/ResourceManager.h"
+#include "esp/core/MemoryTracking.h"
+#include "esp/core/Profiling.h"
+#include "esp/geo/geo.h"
 
 namespace esp {
 namespace physics {
 
+namespace {
+
+#ifdef ESP_BUILD_WITH_MEMORY_TRACKING
+void* physicsAlloc(size_t size) {
+  return core::trackedMalloc(core::MemoryTag::Physics, size);
+}
+
+void physicsFree(void* ptr) {
+  core::trackedFree(core::MemoryTag::Physics, ptr);
+}
+
+// installed during static initialization, before any world is created;
+// btAlignedAlloc() aligns on top of it
+const bool physicsAllocatorInstalled = [] {
+  btAlignedAllocSetCustom(physicsAlloc, physicsFree);
+  return true;
+}();
+#endif
+
+// rays and sweeps are handed out to the threads in blocks of this many,
+// single rays are too cheap to be handed out one at a time
+constexpr size_t queryBlockSize = 64;
+
+// Run policy on the leaves of the broadphase trees crossed by the box
+// [aabbMin, aabbMax] around the origin moving from `from` to `to`, like
+// btDbvtBroadphase::rayTest() but with a traversal stack per thread instead
+// of one shared by all queries
+void rayTestBroadphase(btDbvtBroadphase& broadphase,
+                       const btVector3& from,
+                       const btVector3& to,
+                       const btVector3& aabbMin,
+                       const btVector3& aabbMax,
+                       btDbvt::ICollide& policy) {
+  thread_local btAlignedObjectArray<const btDbvtNode*> stack;
+  const btVector3 direction = (to - from).normalized();
+  btVector3 directionInverse;
+  unsigned int signs[3];
+  for (int i = 0; i < 3; ++i) {
+    directionInverse[i] = direction[i] == btScalar(0.0)
+                              ? btScalar(BT_LARGE_FLOAT)
+                              : btScalar(1.0) / direction[i];
+    signs[i] = directionInverse[i] < btScalar(0.0);
+  }
+  const btScalar lambdaMax = direction.dot(to - from);
+  // the trees of the moving and of the fixed objects
+  for (btDbvt& tree : broadphase.m_sets) {
+    tree.rayTestInternal(tree.m_root, from, to, directionInverse, signs,
+                         lambdaMax, aabbMin, aabbMax, stack, policy);
+  }
+}
+
+btCollisionObject* leafObject(const btDbvtNode* leaf) {
+  return static_cast<btCollisionObject*>(
+      static_cast<btBroadphaseProxy*>(leaf->data)->m_clientObject);
+}
+
+// Closest hit of a ray with the objects of the leaves it crosses, as
+// btCollisionWorld::rayTest() tests them
+struct RayQuery : btDbvt::ICollide {
+  RayQuery(const btVector3& from, const btVector3& to)
+      : fromTransform{btQuaternion::getIdentity(), from},
+        toTransform{btQuaternion::getIdentity(), to},
+        callback{from, to} {}
+
+  void Process(const btDbvtNode* leaf) {
+    btCollisionObject* object = leafObject(leaf);
+    if (callback.m_closestHitFraction == btScalar(0.0) ||
+        !callback.needsCollision(object->getBroadphaseHandle())) {
+      return;
+    }
+    btCollisionWorld::rayTestSingle(fromTransform, toTransform, object,
+                                    object->getCollisionShape(),
+                                    object->getWorldTransform(), callback);
+  }
+
+  btTransform fromTransform, toTransform;
+  btCollisionWorld::ClosestRayResultCallback callback;
+};
+
+// Closest hit of a swept convex shape, as btCollisionWorld::convexSweepTest()
+// tests the objects
+struct SweepQuery : btDbvt::ICollide {
+  SweepQuery(const btConvexShape& shape,
+             const btVector3& from,
+             const btVector3& to)
+      : shape(shape),
+        fromTransform{btQuaternion::getIdentity(), from},
+        toTransform{btQuaternion::getIdentity(), to},
+        callback{from, to} {}
+
+  void Process(const btDbvtNode* leaf) {
+    btCollisionObject* object = leafObject(leaf);
+    if (callback.m_closestHitFraction == btScalar(0.0) ||
+        !callback.needsCollision(object->getBroadphaseHandle())) {
+      return;
+    }
+    btCollisionWorld::objectQuerySingle(
+        &shape, fromTransform, toTransform, object,
+        object->getCollisionShape(), object->getWorldTransform(), callback,
+        btScalar(0.0));
+  }
+
+  const btConvexShape& shape;
+  btTransform fromTransform, toTransform;
+  btCollisionWorld::ClosestConvexResultCallback callback;
+};
+
+// Run query(i, from, to) for the rays of castRays() and sweepShapes() which
+// have a direction, in blocks over numThreads threads; the other hits stay
+// misses
+template <class Query>
+void forEachRay(const Magnum::Vector3* origins,
+                const Magnum::Vector3* directions,
+                size_t numRays,
+                float maxDistance,
+                RaycastHit* hits,
+                int numThreads,
+                const Query& query) {
+  std::fill_n(hits, numRays, RaycastHit{});
+  if (maxDistance <= 0.0f) {
+    return;
+  }
+  geo::parallelFor(
+      (numRays + queryBlockSize - 1) / queryBlockSize, numThreads,
+      [&](size_t block) {
+        const size_t end = std::min(numRays, (block + 1) * queryBlockSize);
+        for (size_t i = block * queryBlockSize; i < end; ++i) {
+          const float length = directions[i].length();
+          if (length > 0.0f) {
+            query(i, btVector3(origins[i]),
+                  btVector3(origins[i] +
+                            directions[i] * (maxDistance / length)));
+          }
+        }
+      });
+}
+
+// a character stops this far short of what it hits, so that the sweep of its
+// slide does not start touching it
+constexpr btScalar characterSkin = 1e-3f;
+// times the rest of a blocked character move slides along what blocked it
+constexpr int maxCharacterSlides = 3;
+
+// The touching and penetrating points of the contacts of object, with object
+// as A
+struct ContactQuery : btCollisionWorld::ContactResultCallback {
+  explicit ContactQuery(const btCollisionObject* object) : object(object) {}
+
+  btScalar addSingleResult(btManifoldPoint& point,
+                           const btCollisionObjectWrapper* wrapper0,
+                           int,
+                           int,
+                           const btCollisionObjectWrapper* wrapper1,
+                           int,
+                           int) {
+    if (point.getDistance() > btScalar(0.0)) {
+      return 0;
+    }
+    ContactPoint contact;
+    contact.objectIDA = object->getUserIndex();
+    contact.positionOnA = Magnum::Vector3(point.getPositionWorldOnA());
+    contact.positionOnB = Magnum::Vector3(point.getPositionWorldOnB());
+    contact.normalOnB = Magnum::Vector3(point.m_normalWorldOnB);
+    contact.distance = point.getDistance();
+    if (wrapper0->getCollisionObject() == object) {
+      contact.objectIDB = wrapper1->getCollisionObject()->getUserIndex();
+    } else {
+      contact.objectIDB = wrapper0->getCollisionObject()->getUserIndex();
+      std::swap(contact.positionOnA, contact.positionOnB);
+      contact.normalOnB = -contact.normalOnB;
+    }
+    contacts.push_back(contact);
+    return 0;
+  }
+
+  const btCollisionObject* object;
+  std::vector<ContactPoint> contacts;
+};
+
+// IDs of the objects of the broadphase proxies overlapping a box
+struct OverlapQuery : btBroadphaseAabbCallback {
+  bool process(const btBroadphaseProxy* proxy) {
+    objectIDs.push_back(
+        static_cast<const btCollisionObject*>(proxy->m_clientObject)
+            ->getUserIndex());
+    return true;
+  }
+
+  std::vector<int> objectIDs;
+};
+}  // namespace
+
+#if BT_THREADSAFE
+namespace {
+// Bullet has a single, process-wide task scheduler. It is created on first
+// use and shared by the multithreaded worlds of all physics managers, the
+// most recently initialized one sets its number of threads
+btITaskScheduler* setupTaskScheduler(int numThreads) {
+  static btITaskScheduler* scheduler = []() {
+    btITaskScheduler* defaultScheduler = btCreateDefaultTaskScheduler();
+    if (defaultScheduler) {
+      btSetTaskScheduler(defaultScheduler);
+    }
+    return defaultScheduler;
+  }();
+  if (scheduler) {
+    scheduler->setNumThreads(
+        std::min(numThreads, scheduler->getMaxNumThreads()));
+  }
+  return scheduler;
+}
+}  // namespace
+#endif
+
 bool BulletPhysicsManager::initPhysics(
     scene::SceneNode* node,
     const assets::PhysicsManagerAttributes& physicsManagerAttributes) {
@@ -20,8 +241,36 @@ bool BulletPhysicsManager::initPhysics(
   //! We can potentially use other collision checking algorithms, by
   //! uncommenting the line below
   // btGImpactCollisionAlgorithm::registerAlgorithm(&bDispatcher_);
-  bWorld_ = std::make_shared<btDiscreteDynamicsWorld>(
-      &bDispatcher_, &bBroadphase_, &bSolver_, &bCollisionConfig_);
+  const int numThreads = physicsManagerAttributes.getInt("numThreads");
+  multithreaded_ = false;
+  if (numThreads > 1) {
+#if BT_THREADSAFE
+    btITaskScheduler* scheduler = setupTaskScheduler(numThreads);
+    if (scheduler) {
+      // one solver per thread solves the islands in parallel, the Mt solver
+      // handles the constraints of large islands
+      bDispatcherMt_ =
+          std::make_unique<btCollisionDispatcherMt>(&bCollisionConfig_);
+      bSolverPoolMt_ = std::make_unique<btConstraintSolverPoolMt>(
+          scheduler->getNumThreads());
+      bSolverMt_ = std::make_unique<btSequentialImpulseConstraintSolverMt>();
+      bWorld_ = std::make_shared<btDiscreteDynamicsWorldMt>(
+          bDispatcherMt_.get(), &bBroadphase_, bSolverPoolMt_.get(),
+          bSolverMt_.get(), &bCollisionConfig_);
+      multithreaded_ = true;
+    }
+#endif
+    if (!multithreaded_) {
+      LOG(WARNING) << "BulletPhysicsManager::initPhysics: Bullet has no "
+                      "multithreading support, stepping the world on a "
+                      "single thread instead of "
+                   << numThreads;
+    }
+  }
+  if (!multithreaded_) {
+    bWorld_ = std::make_shared<btDiscreteDynamicsWorld>(
+        &bDispatcher_, &bBroadphase_, &bSolver_, &bCollisionConfig_);
+  }
   // currently GLB meshes are y-up
   bWorld_->setGravity(
       btVector3(physicsManagerAttributes.getMagnumVec3("gravity")));
@@ -34,10 +283,24 @@ bool BulletPhysicsManager::initPhysics(
   return true;
 }
 
+std::unique_ptr<PhysicsManager> BulletPhysicsManager::createWorld() {
+  std::unique_ptr<BulletPhysicsManager> world =
+      std::make_unique<BulletPhysicsManager>(resourceManager_);
+  world->objectShapes_ = objectShapes_;
+  return world;
+}
+
+void BulletPhysicsManager::shareCachesWith(const PhysicsManager& source) {
+  objectShapes_ =
+      static_cast<const BulletPhysicsManager&>(source).objectShapes_;
+}
+
 BulletPhysicsManager::~BulletPhysicsManager() {
   // remove all leftover physical objects
-  for (auto& bro : existingObjects_) {
-    bro.second->removeObject();
+  for (physics::RigidObject* bro : existingObjects_) {
+    if (bro != nullptr) {
+      bro->removeObject();
+    }
   }
   // remove the physical scene from the world
   sceneNode_->removeObject();
@@ -46,7 +309,7 @@ BulletPhysicsManager::~BulletPhysicsManager() {
 // Bullet Mesh conversion adapted from:
 // https://github.com/mosra/magnum-integration/issues/20
 bool BulletPhysicsManager::addScene(
-    const assets::AssetInfo&,
+    const assets::AssetInfo& info,
     const assets::PhysicsSceneAttributes& physicsSceneAttributes,
     const std::vector<assets::CollisionMeshData>& meshGroup) {
   // Test Mesh primitive is valid
@@ -59,7 +322,8 @@ bool BulletPhysicsManager::addScene(
   //! Initialize scene
   bool sceneSuccess =
       static_cast<BulletRigidObject*>(sceneNode_)
-          ->initializeScene(physicsSceneAttributes, meshGroup, bWorld_);
+          ->initializeScene(physicsSceneAttributes, meshGroup, bWorld_,
+                            info.filepath);
 
   return sceneSuccess;
 }
@@ -67,20 +331,34 @@ bool BulletPhysicsManager::addScene(
 int BulletPhysicsManager::makeRigidObject(
     const std::vector<assets::CollisionMeshData>& meshGroup,
     assets::PhysicsObjectAttributes physicsObjectAttributes) {
+  //! Instances of the same collision mesh share its shape
+  const auto shapeKey =
+      std::make_pair(physicsObjectAttributes.getString("collisionMeshHandle"),
+                     physicsObjectAttributes.getDouble("margin"));
+  std::shared_ptr<BulletObjectShape>& shape = (*objectShapes_)[shapeKey];
+  if (!shape) {
+    shape = BulletObjectShape::create(meshGroup, shapeKey.second);
+  }
+
   //! Create new physics object (child node of sceneNode_)
   int newObjectID = allocateObjectID();
   existingObjects_[newObjectID] = new BulletRigidObject(sceneNode_);
 
   //! Instantiate with mesh pointer
   bool objectSuccess =
-      static_cast<BulletRigidObject*>(existingObjects_.at(newObjectID))
-          ->initializeObject(physicsObjectAttributes, meshGroup, bWorld_);
+      static_cast<BulletRigidObject*>(existingObjects_[newObjectID])
+          ->initializeObject(physicsObjectAttributes, shape, bWorld_);
   if (!objectSuccess) {
     LOG(ERROR) << "Object load failed";
     deallocateObjectID(newObjectID);
-    existingObjects_.erase(newObjectID);
+    existingObjects_[newObjectID] = nullptr;
     return -1;
   }
+  //! Collision queries report the object by its ID, the scene keeps the
+  //! default user index of -1, ID_UNDEFINED
+  static_cast<BulletRigidObject*>(existingObjects_[newObjectID])
+      ->getCollisionObject()
+      ->setUserIndex(newObjectID);
   return newObjectID;
 }
 
@@ -121,18 +399,20 @@ bool BulletPhysicsManager::isMeshPrimitiveValid(
 void BulletPhysicsManager::setGravity(const Magnum::Vector3& gravity) {
   bWorld_->setGravity(btVector3(gravity));
   // After gravity change, need to reactive all bullet objects
-  for (std::map<int, physics::RigidObject*>::iterator it =
-           existingObjects_.begin();
-       it != existingObjects_.end(); ++it) {
-    it->second->setActive();
+  for (physics::RigidObject* bro : existingObjects_) {
+    if (bro != nullptr) {
+      bro->setActive();
+    }
   }
+  updateActiveObjects();
 }
 
 Magnum::Vector3 BulletPhysicsManager::getGravity() {
   return Magnum::Vector3(bWorld_->getGravity());
 }
 
-void BulletPhysicsManager::stepPhysics(double dt) {
+void BulletPhysicsManager::stepWorld(double dt, int numSteps) {
+  ESP_PROFILE_SCOPE("BulletPhysicsManager::stepWorld");
   // We don't step uninitialized physics sim...
   if (!initialized_) {
     return;
@@ -143,17 +423,208 @@ void BulletPhysicsManager::stepPhysics(double dt) {
 
   // ==== Physics stepforward ======
 
+  // Sleeping objects are only woken by awake ones, so without any of them the
+  // step would not change the world: only advance the clock, by the same
+  // fixed substeps Bullet would take
+  if (activeObjectIDs_.empty()) {
+    sleepingTime_ += dt * numSteps;
+    const int numSubSteps = static_cast<int>(sleepingTime_ / fixedTimeStep_);
+    sleepingTime_ -= numSubSteps * fixedTimeStep_;
+    worldTime_ +=
+        std::min(numSubSteps, maxSubSteps_ * numSteps) * fixedTimeStep_;
+    return;
+  }
+  sleepingTime_ = 0.0;
+
   // NOTE: worldTime_ will always be a multiple of sceneMetaData_.timestep
-  int numSubStepsTaken =
-      bWorld_->stepSimulation(dt, maxSubSteps_, fixedTimeStep_);
+  // Bullet only syncs the scene nodes of awake bodies. Its accumulator
+  // carries the time that is not a whole substep yet over to the next call,
+  // each of the numSteps steps may take up to maxSubSteps_ substeps
+  int numSubStepsTaken = bWorld_->stepSimulation(
+      dt * numSteps, maxSubSteps_ * numSteps, fixedTimeStep_);
   worldTime_ += numSubStepsTaken * fixedTimeStep_;
+  updateActiveObjects();
+}
+
+void BulletPhysicsManager::castRays(const Magnum::Vector3* origins,
+                                    const Magnum::Vector3* directions,
+                                    size_t numRays,
+                                    float maxDistance,
+                                    RaycastHit* hits,
+                                    int numThreads) {
+  ESP_PROFILE_SCOPE("BulletPhysicsManager::castRays");
+  const btVector3 point{0.0, 0.0, 0.0};
+  forEachRay(origins, directions, numRays, maxDistance, hits, numThreads,
+             [&](size_t i, const btVector3& from, const btVector3& to) {
+               RayQuery query{from, to};
+               rayTestBroadphase(bBroadphase_, from, to, point, point, query);
+               if (query.callback.hasHit()) {
+                 hits[i].hit = true;
+                 hits[i].objectID =
+                     query.callback.m_collisionObject->getUserIndex();
+                 hits[i].distance =
+                     query.callback.m_closestHitFraction * maxDistance;
+                 hits[i].point =
+                     Magnum::Vector3(query.callback.m_hitPointWorld);
+                 hits[i].normal =
+                     Magnum::Vector3(query.callback.m_hitNormalWorld);
+               }
+             });
+}
+
+void BulletPhysicsManager::sweepShapes(const SweepShape& shape,
+                                       const Magnum::Vector3* origins,
+                                       const Magnum::Vector3* directions,
+                                       size_t numRays,
+                                       float maxDistance,
+                                       RaycastHit* hits,
+                                       int numThreads) {
+  ESP_PROFILE_SCOPE("BulletPhysicsManager::sweepShapes");
+  // only read by the queries, so shared by all threads
+  btCapsuleShape capsule{shape.radius, 2.0f * shape.halfHeight};
+  btSphereShape sphere{shape.radius};
+  const btConvexShape& castShape =
+      shape.halfHeight > 0.0f ? static_cast<btConvexShape&>(capsule)
+                              : static_cast<btConvexShape&>(sphere);
+  btVector3 aabbMin, aabbMax;
+  castShape.getAabb(btTransform::getIdentity(), aabbMin, aabbMax);
+  forEachRay(origins, directions, numRays, maxDistance, hits, numThreads,
+             [&](size_t i, const btVector3& from, const btVector3& to) {
+               SweepQuery query{castShape, from, to};
+               rayTestBroadphase(bBroadphase_, from, to, aabbMin, aabbMax,
+                                 query);
+               if (query.callback.hasHit()) {
+                 hits[i].hit = true;
+                 hits[i].objectID =
+                     query.callback.m_hitCollisionObject->getUserIndex();
+                 hits[i].distance =
+                     query.callback.m_closestHitFraction * maxDistance;
+                 hits[i].point =
+                     Magnum::Vector3(query.callback.m_hitPointWorld);
+                 hits[i].normal =
+                     Magnum::Vector3(query.callback.m_hitNormalWorld);
+               }
+             });
+}
+
+void BulletPhysicsManager::moveCharacters(CharacterMove* moves,
+                                          size_t numMoves,
+                                          double dt,
+                                          int numThreads) {
+  ESP_PROFILE_SCOPE("BulletPhysicsManager::moveCharacters");
+  // the last dynamic object each move ran into, where, and the part of the
+  // move it blocked
+  struct Push {
+    btRigidBody* body = nullptr;
+    btVector3 point;
+    btVector3 blocked;
+  };
+  std::vector<Push> pushes(numMoves);
+  geo::parallelFor(
+      (numMoves + queryBlockSize - 1) / queryBlockSize, numThreads,
+      [&](size_t block) {
+        const size_t end = std::min(numMoves, (block + 1) * queryBlockSize);
+        for (size_t i = block * queryBlockSize; i < end; ++i) {
+          CharacterMove& move = moves[i];
+          btCapsuleShape capsule{move.shape.radius,
+                                 2.0f * move.shape.halfHeight};
+          btSphereShape sphere{move.shape.radius};
+          const btConvexShape& castShape =
+              move.shape.halfHeight > 0.0f
+                  ? static_cast<btConvexShape&>(capsule)
+                  : static_cast<btConvexShape&>(sphere);
+          btVector3 aabbMin, aabbMax;
+          castShape.getAabb(btTransform::getIdentity(), aabbMin, aabbMax);
+
+          btVector3 position(move.start);
+          btVector3 remaining = btVector3(move.end) - position;
+          move.collided = false;
+          move.objectID = ID_UNDEFINED;
+          for (int slide = 0; slide <= maxCharacterSlides; ++slide) {
+            const btScalar length = remaining.length();
+            if (length == btScalar(0.0)) {
+              break;
+            }
+            const btVector3 to = position + remaining;
+            SweepQuery query{castShape, position, to};
+            rayTestBroadphase(bBroadphase_, position, to, aabbMin, aabbMax,
+                              query);
+            if (!query.callback.hasHit()) {
+              position = to;
+              break;
+            }
+            move.collided = true;
+            const btCollisionObject* hitObject =
+                query.callback.m_hitCollisionObject;
+            move.objectID = hitObject->getUserIndex();
+            const btScalar moved = std::max(
+                btScalar(0.0),
+                query.callback.m_closestHitFraction * length - characterSkin);
+            position += remaining * (moved / length);
+            remaining *= btScalar(1.0) - moved / length;
+            // the normal points out of the object hit, towards the character
+            const btVector3& normal = query.callback.m_hitNormalWorld;
+            const btScalar into = remaining.dot(normal);
+            if (into >= btScalar(0.0)) {
+              continue;
+            }
+            const btRigidBody* body = btRigidBody::upcast(hitObject);
+            if (body != nullptr && !body->isStaticOrKinematicObject()) {
+              pushes[i] = {const_cast<btRigidBody*>(body),
+                           query.callback.m_hitPointWorld, normal * into};
+            }
+            remaining -= normal * into;
+          }
+          move.position = Magnum::Vector3(position);
+        }
+      });
+
+  // pushing changes the world, so not while the sweeps read it
+  if (dt <= 0.0) {
+    return;
+  }
+  for (size_t i = 0; i < numMoves; ++i) {
+    const Push& push = pushes[i];
+    if (push.body == nullptr || moves[i].mass <= 0.0f) {
+      continue;
+    }
+    push.body->activate(true);
+    push.body->applyImpulse(push.blocked * btScalar(moves[i].mass / dt),
+                            push.point - push.body->getCenterOfMassPosition());
+  }
+}
+
+std::vector<ContactPoint> BulletPhysicsManager::contactTest(
+    const int physObjectID) {
+  if (!hasObject(physObjectID)) {
+    return {};
+  }
+  btCollisionObject* object =
+      static_cast<BulletRigidObject*>(existingObjects_[physObjectID])
+          ->getCollisionObject();
+  ContactQuery query{object};
+  bWorld_->contactTest(object, query);
+  return std::move(query.contacts);
+}
+
+std::vector<int> BulletPhysicsManager::overlapAABB(
+    const Magnum::Range3D& box) {
+  OverlapQuery query;
+  bBroadphase_.aabbTest(btVector3(box.min()), btVector3(box.max()), query);
+  // the scene has one collision object per mesh component
+  std::sort(query.objectIDs.begin(), query.objectIDs.end());
+  query.objectIDs.erase(
+      std::unique(query.objectIDs.begin(), query.objectIDs.end()),
+      query.objectIDs.end());
+  return std::move(query.objectIDs);
 }
 
 void BulletPhysicsManager::setMargin(const int physObjectID,
                                      const double margin) {
-  if (existingObjects_.count(physObjectID) > 0) {
-    static_cast<BulletRigidObject*>(existingObjects_.at(physObjectID))
+  if (hasObject(physObjectID)) {
+    static_cast<BulletRigidObject*>(existingObjects_[physObjectID])
         ->setMargin(margin);
+    activeObjectIDs_.insert(physObjectID);
   }
 }
 
@@ -170,8 +641,8 @@ void BulletPhysicsManager::setSceneRestitutionCoefficient(
 }
 
 double BulletPhysicsManager::getMargin(const int physObjectID) {
-  if (existingObjects_.count(physObjectID) > 0) {
-    return static_cast<BulletRigidObject*>(existingObjects_.at(physObjectID))
+  if (hasObject(physObjectID)) {
+    return static_cast<BulletRigidObject*>(existingObjects_[physObjectID])
         ->getMargin();
   } else {
     return PHYSICS_ATTR_UNDEFINED;
@@ -9,6 +9,11 @@
 #include <Magnum/BulletIntegration/Integration.h>
 #include <Magnum/BulletIntegration/MotionState.h>
 #include <btBulletDynamicsCommon.h>
+#if BT_THREADSAFE
+#include <BulletCollision/CollisionDispatch/btCollisionDispatcherMt.h>
+#include <BulletDynamics/ConstraintSolver/btSequentialImpulseConstraintSolverMt.h>
+#include <BulletDynamics/Dynamics/btDiscreteDynamicsWorldMt.h>
+#endif
 
 #include "BulletRigidObject.h"
 #include "esp/physics/PhysicsManager.h"
@@ -26,6 +31,10 @@ class BulletPhysicsManager : public PhysicsManager {
   //============ Initialization =============
   // load physical properties and setup the world
   // do_profile indicates timing for FPS
+  // With "numThreads" > 1 in physicsManagerAttributes, the world is a
+  // btDiscreteDynamicsWorldMt stepped on that many threads. This needs a
+  // Bullet built with multithreading (BT_THREADSAFE), otherwise the world
+  // falls back to a single thread.
   bool initPhysics(
       scene::SceneNode* node,
       const assets::PhysicsManagerAttributes& physicsManagerAttributes);
@@ -38,13 +47,41 @@ class BulletPhysicsManager : public PhysicsManager {
                 const assets::PhysicsSceneAttributes& physicsSceneAttributes,
                 const std::vector<assets::CollisionMeshData>& meshGroup);
 
-  //============ Simulator functions =============
-  void stepPhysics(double dt);
-
   void setGravity(const Magnum::Vector3& gravity);
 
   Magnum::Vector3 getGravity();
 
+  //============ Collision queries =============
+  //! The rays and sweeps traverse the broadphase with a stack per thread, so
+  //! unlike btCollisionWorld::rayTest() they can run on many threads at once
+  void castRays(const Magnum::Vector3* origins,
+                const Magnum::Vector3* directions,
+                size_t numRays,
+                float maxDistance,
+                RaycastHit* hits,
+                int numThreads = 0);
+  void sweepShapes(const SweepShape& shape,
+                   const Magnum::Vector3* origins,
+                   const Magnum::Vector3* directions,
+                   size_t numRays,
+                   float maxDistance,
+                   RaycastHit* hits,
+                   int numThreads = 0);
+  using PhysicsManager::castRays;
+  using PhysicsManager::sweepShapes;
+
+  //! The sweeps run like the ones of sweepShapes(), the pushes after all of
+  //! them as impulses at the points hit
+  void moveCharacters(CharacterMove* moves,
+                      size_t numMoves,
+                      double dt,
+                      int numThreads = 0);
+  using PhysicsManager::moveCharacters;
+
+  //! With btCollisionWorld::contactTest() and the broadphase
+  std::vector<ContactPoint> contactTest(const int physObjectID);
+  std::vector<int> overlapAABB(const Magnum::Range3D& box);
+
   //============ Interact with objects =============
   // NOTE: engine specifics handled by objects themselves...
 
@@ -59,6 +96,16 @@ class BulletPhysicsManager : public PhysicsManager {
   double getSceneRestitutionCoefficient();
 
  protected:
+  //! All substeps are taken by a single stepSimulation(), which syncs the
+  //! motion states of the objects once at the end
+  void stepWorld(double dt, int numSteps = 1);
+
+  //! The world shares objectShapes_ with this one
+  std::unique_ptr<PhysicsManager> createWorld();
+  void shareCachesWith(const PhysicsManager& source);
+
+  bool usesTaskScheduler() const { return multithreaded_; }
+
   //! The world has to live longer than the scene because RigidBody
   //! instances have to remove themselves from it on destruction
   btDbvtBroadphase bBroadphase_;
@@ -66,9 +113,31 @@ class BulletPhysicsManager : public PhysicsManager {
   btSequentialImpulseConstraintSolver bSolver_;
   btCollisionDispatcher bDispatcher_{&bCollisionConfig_};
 
+#if BT_THREADSAFE
+  //! Only created for a multithreaded world, which uses them instead of
+  //! bSolver_ and bDispatcher_
+  std::unique_ptr<btCollisionDispatcherMt> bDispatcherMt_;
+  std::unique_ptr<btConstraintSolverPoolMt> bSolverPoolMt_;
+  std::unique_ptr<btSequentialImpulseConstraintSolverMt> bSolverMt_;
+#endif
+
   //! The following are made ptr because we need to intialize them in
   //! constructor, potentially with different world configurations
   std::shared_ptr<btDiscreteDynamicsWorld> bWorld_;
+  //! Whether bWorld_ is a btDiscreteDynamicsWorldMt
+  bool multithreaded_ = false;
+
+  //! Time stepped while all objects sleep which is not a whole substep yet
+  double sleepingTime_ = 0.0;
+
+  //! Collision shapes shared by the objects, by collision mesh and margin.
+  //! Objects keep a reference to their shape, so it may outlive the cache.
+  //! Added worlds share the cache, which is only used while adding objects
+  using ObjectShapeCache =
+      std::map<std::pair<std::string, double>,
+               std::shared_ptr<BulletObjectShape>>;
+  std::shared_ptr<ObjectShapeCache> objectShapes_ =
+      std::make_shared<ObjectShapeCache>();
 
  private:
   bool isMeshPrimitiveValid(const assets::CollisionMeshData& meshData);
@@ -2,6 +2,8 @@
 // This source code is licensed under the MIT license found in the
 // LICENSE file in the root directory of this source tree.
 
+#include <cstring>
+
 #include <Magnum/BulletIntegration/DebugDraw.h>
 #include <Magnum/BulletIntegration/Integration.h>
 #include <Magnum/BulletIntegration/MotionState.h>
@@ -12,6 +14,8 @@
 #include "BulletCollision/Gimpact/btGImpactShape.h"
 #include "BulletCollision/NarrowPhaseCollision/btRaycastCallback.h"
 #include "BulletRigidObject.h"
+#include "esp/io/cache.h"
+#include "esp/io/io.h"
 
 //!  A Few considerations in construction
 //!  Bullet Mesh conversion adapted from:
@@ -29,6 +33,69 @@
 namespace esp {
 namespace physics {
 
+namespace {
+// kind of the scene BVH cache files, distinct from the mesh cache kinds
+const uint32_t bvhCacheKind = 100;
+// the serialized BVH layout depends on the Bullet version and precision
+const uint32_t bvhCacheVersion =
+    BT_BULLET_VERSION * 2 + (sizeof(btScalar) == 8 ? 1 : 0);
+
+bool saveSceneBvhs(
+    const std::string& cacheFile,
+    const std::string& sourceFile,
+    const std::vector<std::unique_ptr<btBvhTriangleMeshShape>>& shapes) {
+  io::CacheWriter writer(bvhCacheKind, bvhCacheVersion, sourceFile);
+  std::vector<BulletAlignedBuffer> buffers;
+  for (const auto& shape : shapes) {
+    const btOptimizedBvh* bvh = shape->getOptimizedBvh();
+    const unsigned int size = bvh->calculateSerializeBufferSize();
+    buffers.emplace_back(btAlignedAlloc(size, 16));
+    if (!bvh->serializeInPlace(buffers.back().get(), size, false)) {
+      return false;
+    }
+    writer.addSection(buffers.back().get(), size);
+  }
+  return writer.write(cacheFile);
+}
+}  // namespace
+
+std::shared_ptr<BulletObjectShape> BulletObjectShape::create(
+    const std::vector<assets::CollisionMeshData>& meshGroup,
+    double margin) {
+  auto shape = std::make_shared<BulletObjectShape>();
+  shape->compoundShape = std::make_unique<btCompoundShape>();
+  btTransform t;  // position and rotation
+  t.setIdentity();
+  for (const assets::CollisionMeshData& meshData : meshGroup) {
+    //! Create convex component
+    shape->convexShapes.emplace_back(std::make_unique<btConvexHullShape>(
+        static_cast<const btScalar*>(meshData.positions.data()->data()),
+        meshData.positions.size(), sizeof(Magnum::Vector3)));
+    shape->convexShapes.back()->setMargin(margin);
+    //! Add to compound shape stucture
+    shape->compoundShape->addChildShape(t, shape->convexShapes.back().get());
+  }
+  shape->compoundShape->setMargin(margin);
+  return shape;
+}
+
+std::shared_ptr<BulletObjectShape> BulletObjectShape::copyWithMargin(
+    double margin) const {
+  auto shape = std::make_shared<BulletObjectShape>();
+  shape->compoundShape = std::make_unique<btCompoundShape>();
+  btTransform t;
+  t.setIdentity();
+  for (const auto& hull : convexShapes) {
+    shape->convexShapes.emplace_back(std::make_unique<btConvexHullShape>(
+        hull->getUnscaledPoints()->m_floats, hull->getNumPoints(),
+        sizeof(btVector3)));
+    shape->convexShapes.back()->setMargin(margin);
+    shape->compoundShape->addChildShape(t, shape->convexShapes.back().get());
+  }
+  shape->compoundShape->setMargin(margin);
+  return shape;
+}
+
 BulletRigidObject::BulletRigidObject(scene::SceneNode* parent)
     : RigidObject{parent} {};
 
@@ -37,7 +104,8 @@ BulletRigidObject::~BulletRigidObject() {}
 bool BulletRigidObject::initializeScene(
     const assets::PhysicsSceneAttributes& physicsSceneAttributes,
     const std::vector<assets::CollisionMeshData>& meshGroup,
-    std::shared_ptr<btDiscreteDynamicsWorld> bWorld) {
+    std::shared_ptr<btDiscreteDynamicsWorld> bWorld,
+    const std::string& sourceFile) {
   if (rigidObjectType_ != NONE) {
     LOG(ERROR) << "Cannot initialized a RigidObject more than once";
     return false;
@@ -53,6 +121,12 @@ bool BulletRigidObject::initializeScene(
   //! Iterate through all mesh components for one scene
   //! All components are registered as static objects
   bSceneArray_ = std::make_unique<btTriangleIndexVertexArray>();
+  const std::string cacheFile =
+      sourceFile.empty() ? "" : io::cacheFilename(sourceFile + ".bvh");
+  const io::CacheReader bvhCache(cacheFile, bvhCacheKind, bvhCacheVersion,
+                                 sourceFile);
+  bool bvhsFromCache =
+      bvhCache.isValid() && bvhCache.getNumSections() == meshGroup.size();
   for (const assets::CollisionMeshData& meshData : meshGroup) {
     //! Here we convert Magnum's unsigned int indices to
     //! signed indices in bullet. Assuming that it's save to
@@ -77,8 +151,29 @@ bool BulletRigidObject::initializeScene(
 
     //! Embed 3D mesh into bullet shape
     //! btBvhTriangleMeshShape is the most generic/slow choice
-    bSceneShapes_.emplace_back(
-        std::make_unique<btBvhTriangleMeshShape>(bSceneArray_.get(), true));
+    //! The BVH is the expensive part, it is loaded from cache if possible.
+    //! Deserialized BVHs live in place in their buffer
+    btOptimizedBvh* bvh = nullptr;
+    const char* bvhData = nullptr;
+    size_t bvhSize = 0;
+    if (bvhsFromCache &&
+        bvhCache.getSection(bSceneShapes_.size(), bvhData, bvhSize)) {
+      BulletAlignedBuffer buffer(btAlignedAlloc(bvhSize, 16));
+      std::memcpy(buffer.get(), bvhData, bvhSize);
+      bvh = btOptimizedBvh::deSerializeInPlace(buffer.get(), bvhSize, false);
+      if (bvh) {
+        bSceneBvhBuffers_.emplace_back(std::move(buffer));
+      }
+    }
+    if (bvh) {
+      bSceneShapes_.emplace_back(std::make_unique<btBvhTriangleMeshShape>(
+          bSceneArray_.get(), true, false));
+      bSceneShapes_.back()->setOptimizedBvh(bvh);
+    } else {
+      bvhsFromCache = false;
+      bSceneShapes_.emplace_back(
+          std::make_unique<btBvhTriangleMeshShape>(bSceneArray_.get(), true));
+    }
     // double mass = 0.0;
     // btVector3 bInertia(0.0, 0.0, 0.0);
     // bSceneShapes_.back()->calculateLocalInertia(mass, bInertia);
@@ -98,6 +193,11 @@ bool BulletRigidObject::initializeScene(
     bWorld->addCollisionObject(bSceneCollisionObjects_.back().get());
   }
 
+  if (!sourceFile.empty() && !bvhsFromCache &&
+      !saveSceneBvhs(cacheFile, sourceFile, bSceneShapes_)) {
+    LOG(WARNING) << "Cannot write BVH cache file " << cacheFile;
+  }
+
   bWorld_ = bWorld;
   syncPose();
   return true;
@@ -105,7 +205,7 @@ bool BulletRigidObject::initializeScene(
 
 bool BulletRigidObject::initializeObject(
     const assets::PhysicsObjectAttributes& physicsObjectAttributes,
-    const std::vector<assets::CollisionMeshData>& meshGroup,
+    std::shared_ptr<BulletObjectShape> shape,
     std::shared_ptr<btDiscreteDynamicsWorld> bWorld) {
   // TODO (JH): Handling static/kinematic object type
   if (rigidObjectType_ != NONE) {
@@ -117,54 +217,16 @@ bool BulletRigidObject::initializeObject(
   rigidObjectType_ = OBJECT;
   objectMotionType_ = DYNAMIC;
 
-  //! Create Bullet Object
-  btIndexedMesh bulletMesh;
-
-  //! Physical parameters
-  double margin = physicsObjectAttributes.getDouble("margin");
-
-  //! Iterate through all mesh components for one object
-  //! The components are combined into a convex compound shape
-  bObjectShape_ = std::make_unique<btCompoundShape>();
-  for (const assets::CollisionMeshData& meshData : meshGroup) {
-    Corrade::Containers::ArrayView<Magnum::Vector3> v_data = meshData.positions;
-    Corrade::Containers::ArrayView<Magnum::UnsignedInt> ui_data =
-        meshData.indices;
-
-    //! Configure Bullet Mesh
-    //! This part is very likely to cause segfault, if done incorrectly
-    bulletMesh.m_numTriangles = ui_data.size() / 3;
-    bulletMesh.m_triangleIndexBase =
-        reinterpret_cast<const unsigned char*>(ui_data.data());
-    bulletMesh.m_triangleIndexStride = 3 * sizeof(Magnum::UnsignedInt);
-    bulletMesh.m_numVertices = v_data.size();
-    //! Get the pointer to the first float of the first triangle
-    bulletMesh.m_vertexBase =
-        reinterpret_cast<const unsigned char*>(v_data.data()->data());
-    bulletMesh.m_vertexStride = sizeof(Magnum::Vector3);
-    bulletMesh.m_indexType = PHY_INTEGER;
-    bulletMesh.m_vertexType = PHY_FLOAT;
-
-    btTransform t;  // position and rotation
-    t.setIdentity();
-    t.setOrigin(btVector3(0, 0, 0));
-    //! Create convex component
-    bObjectConvexShapes_.emplace_back(std::make_unique<btConvexHullShape>(
-        static_cast<const btScalar*>(meshData.positions.data()->data()),
-        meshData.positions.size(), sizeof(Magnum::Vector3)));
-    bObjectConvexShapes_.back()->setMargin(margin);
-    //! Add to compound shape stucture
-    bObjectShape_->addChildShape(t, bObjectConvexShapes_.back().get());
-  }
-  //! Set properties
-  bObjectShape_->setMargin(margin);
+  //! The components are combined into a convex compound shape, see
+  //! BulletObjectShape::create()
+  bObjectShape_ = std::move(shape);
 
   btVector3 bInertia =
       btVector3(physicsObjectAttributes.getMagnumVec3("inertia"));
 
   if (bInertia[0] == 0. && bInertia[1] == 0. && bInertia[2] == 0.) {
     // allow bullet to compute the inertia tensor if we don't have one
-    bObjectShape_->calculateLocalInertia(
+    bObjectShape_->compoundShape->calculateLocalInertia(
         physicsObjectAttributes.getDouble("mass"),
         bInertia);  // overrides bInertia
     LOG(INFO) << "Automatic object inertia computed: " << bInertia.x() << " "
@@ -176,7 +238,8 @@ bool BulletRigidObject::initializeObject(
   btRigidBody::btRigidBodyConstructionInfo info =
       btRigidBody::btRigidBodyConstructionInfo(
           physicsObjectAttributes.getDouble("mass"),
-          &(bObjectMotionState_->btMotionState()), bObjectShape_.get(),
+          &(bObjectMotionState_->btMotionState()),
+          bObjectShape_->compoundShape.get(),
           bInertia);
   info.m_friction = physicsObjectAttributes.getDouble("frictionCoefficient");
   info.m_restitution =
@@ -212,11 +275,57 @@ bool BulletRigidObject::removeObject() {
   return true;
 }
 
+btCollisionObject* BulletRigidObject::getCollisionObject() {
+  if (rigidObjectType_ == OBJECT) {
+    return bObjectRigidBody_.get();
+  }
+  return nullptr;
+}
+
+RigidObjectState BulletRigidObject::getState() {
+  RigidObjectState state = RigidObject::getState();
+  if (rigidObjectType_ == OBJECT) {
+    state.linearVelocity =
+        Magnum::Vector3(bObjectRigidBody_->getLinearVelocity());
+    state.angularVelocity =
+        Magnum::Vector3(bObjectRigidBody_->getAngularVelocity());
+    state.activationState = bObjectRigidBody_->getActivationState();
+    state.deactivationTime = bObjectRigidBody_->getDeactivationTime();
+  }
+  return state;
+}
+
+void BulletRigidObject::setState(const RigidObjectState& state) {
+  RigidObject::setState(state);
+  if (rigidObjectType_ != OBJECT) {
+    return;
+  }
+  // drop what would carry over from the current state: interpolation,
+  // accumulated forces and cached contacts
+  bObjectRigidBody_->setInterpolationWorldTransform(
+      bObjectRigidBody_->getWorldTransform());
+  bObjectRigidBody_->setLinearVelocity(btVector3(state.linearVelocity));
+  bObjectRigidBody_->setAngularVelocity(btVector3(state.angularVelocity));
+  bObjectRigidBody_->setInterpolationLinearVelocity(
+      btVector3(state.linearVelocity));
+  bObjectRigidBody_->setInterpolationAngularVelocity(
+      btVector3(state.angularVelocity));
+  bObjectRigidBody_->clearForces();
+  bObjectRigidBody_->forceActivationState(state.activationState);
+  bObjectRigidBody_->setDeactivationTime(state.deactivationTime);
+  if (bObjectRigidBody_->getBroadphaseHandle()) {
+    bWorld_->getBroadphase()->getOverlappingPairCache()->cleanProxyFromPairs(
+        bObjectRigidBody_->getBroadphaseHandle(), bWorld_->getDispatcher());
+  }
+}
+
 bool BulletRigidObject::isActive() {
   if (rigidObjectType_ == SCENE) {
     return false;
   } else if (rigidObjectType_ == OBJECT) {
-    return bObjectRigidBody_->isActive();
+    //! Kinematic objects are not simulated, they only need a step when they
+    //! are moved, which marks them active in the PhysicsManager
+    return objectMotionType_ != KINEMATIC && bObjectRigidBody_->isActive();
   } else {
     return false;
   }
@@ -234,6 +343,11 @@ bool BulletRigidObject::setMotionType(MotionType mt) {
   }
 
   if (rigidObjectType_ == OBJECT) {
+    if (objectMotionType_ == KINEMATIC) {
+      //! Simulated again, posed through the motion state
+      bObjectRigidBody_->setMotionState(
+          &(bObjectMotionState_->btMotionState()));
+    }
     if (mt == KINEMATIC) {
       bWorld_->removeRigidBody(bObjectRigidBody_.get());
       bObjectRigidBody_->setCollisionFlags(
@@ -243,7 +357,21 @@ bool BulletRigidObject::setMotionType(MotionType mt) {
           bObjectRigidBody_->getCollisionFlags() &
           ~btCollisionObject::CF_STATIC_OBJECT);
       objectMotionType_ = KINEMATIC;
-      bWorld_->addRigidBody(bObjectRigidBody_.get());
+      //! Kinematic objects are only collision objects of the world: in the
+      //! broadphase for the dynamic objects and collision queries, but not
+      //! integrated, synchronized or put to sleep when stepping. Without a
+      //! motion state, syncPose() poses them straight from the scene node.
+      //! Like static rigid bodies they are not paired with the scene or
+      //! other kinematic and static objects
+      bObjectRigidBody_->setMotionState(nullptr);
+      bObjectRigidBody_->setLinearVelocity(btVector3(0, 0, 0));
+      bObjectRigidBody_->setAngularVelocity(btVector3(0, 0, 0));
+      bObjectRigidBody_->setInterpolationWorldTransform(
+          bObjectRigidBody_->getWorldTransform());
+      bWorld_->addCollisionObject(
+          bObjectRigidBody_.get(), btBroadphaseProxy::StaticFilter,
+          btBroadphaseProxy::AllFilter ^ btBroadphaseProxy::StaticFilter);
+      setActive();
       return true;
     } else if (mt == STATIC) {
       bWorld_->removeRigidBody(bObjectRigidBody_.get());
@@ -315,6 +443,16 @@ void BulletRigidObject::syncPose() {
   } else if (rigidObjectType_ == OBJECT) {
     //! For syncing objects
     bObjectRigidBody_->setWorldTransform(btTransform(transformationMatrix()));
+    //! A moved kinematic object wakes the dynamic objects it touches in the
+    //! next step
+    if (objectMotionType_ == KINEMATIC) {
+      setActive();
+    }
+    //! Bullet only updates the broadphase bounds of moved bodies while
+    //! stepping, collision queries before the next step need them now
+    if (bObjectRigidBody_->getBroadphaseHandle()) {
+      bWorld_->updateSingleAabb(bObjectRigidBody_.get());
+    }
   }
 }
 
@@ -322,10 +460,16 @@ void BulletRigidObject::setMargin(const double margin) {
   if (rigidObjectType_ == SCENE) {
     return;
   } else {
-    for (std::size_t i = 0; i < bObjectConvexShapes_.size(); i++) {
-      bObjectConvexShapes_[i]->setMargin(margin);
+    // the shape may be shared with other objects, which keep their margin
+    if (bObjectShape_.use_count() > 1) {
+      bObjectShape_ = bObjectShape_->copyWithMargin(margin);
+      bObjectRigidBody_->setCollisionShape(bObjectShape_->compoundShape.get());
+      return;
+    }
+    for (std::size_t i = 0; i < bObjectShape_->convexShapes.size(); i++) {
+      bObjectShape_->convexShapes[i]->setMargin(margin);
     }
-    bObjectShape_->setMargin(margin);
+    bObjectShape_->compoundShape->setMargin(margin);
   }
 }
 
@@ -402,7 +546,7 @@ double BulletRigidObject::getMargin() {
   if (rigidObjectType_ == SCENE) {
     return -1.0;
   } else {
-    return bObjectShape_->getMargin();
+    return bObjectShape_->compoundShape->getMargin();
   }
 }
 
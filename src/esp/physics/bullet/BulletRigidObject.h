@@ -13,20 +13,45 @@
 namespace esp {
 namespace physics {
 
+//! Collision shape of an object, built once per collision mesh and margin and
+//! shared by all objects instanced from it: a compound of one convex hull per
+//! mesh component
+struct BulletObjectShape {
+  std::vector<std::unique_ptr<btConvexHullShape>> convexShapes;
+  std::unique_ptr<btCompoundShape> compoundShape;
+
+  static std::shared_ptr<BulletObjectShape> create(
+      const std::vector<assets::CollisionMeshData>& meshGroup,
+      double margin);
+  //! Copy of the hulls with a different margin
+  std::shared_ptr<BulletObjectShape> copyWithMargin(double margin) const;
+};
+
+//! Buffer allocated with btAlignedAlloc
+struct BulletAlignedFree {
+  void operator()(void* buffer) const { btAlignedFree(buffer); }
+};
+using BulletAlignedBuffer = std::unique_ptr<void, BulletAlignedFree>;
+
 class BulletRigidObject : public RigidObject {
  public:
   BulletRigidObject(scene::SceneNode* parent);
 
   ~BulletRigidObject();
 
+  //! The BVHs of the scene meshes are loaded from the binary cache of
+  //! sourceFile if it is up to date, otherwise they are built and the cache
+  //! is written. An empty sourceFile always builds them
   bool initializeScene(
       const assets::PhysicsSceneAttributes& physicsSceneAttributes,
       const std::vector<assets::CollisionMeshData>& meshGroup,
-      std::shared_ptr<btDiscreteDynamicsWorld> bWorld);
+      std::shared_ptr<btDiscreteDynamicsWorld> bWorld,
+      const std::string& sourceFile = "");
 
+  //! The object refers to shape, which can be shared with other objects
   bool initializeObject(
       const assets::PhysicsObjectAttributes& physicsObjectAttributes,
-      const std::vector<assets::CollisionMeshData>& meshGroup,
+      std::shared_ptr<BulletObjectShape> shape,
       std::shared_ptr<btDiscreteDynamicsWorld> bWorld);
 
   //! Check whether object is being actively simulated, or sleeping
@@ -49,6 +74,13 @@ class BulletRigidObject : public RigidObject {
 
   bool removeObject();
 
+  //! Collision object of an object, nullptr for the scene
+  btCollisionObject* getCollisionObject();
+
+  //! Also saves and restores velocities and activation state
+  RigidObjectState getState();
+  void setState(const RigidObjectState& state);
+
   //============ Getter/setter function =============
   double getMass();
   Magnum::Vector3 getCOM();
@@ -87,13 +119,14 @@ class BulletRigidObject : public RigidObject {
   //! All components are stored as a vector of bCollisionBody_
   std::unique_ptr<btTriangleIndexVertexArray> bSceneArray_;
   std::vector<std::unique_ptr<btBvhTriangleMeshShape>> bSceneShapes_;
+  //! Memory of the BVHs of bSceneShapes_ loaded from the cache
+  std::vector<BulletAlignedBuffer> bSceneBvhBuffers_;
   std::vector<std::unique_ptr<btCollisionObject>> bSceneCollisionObjects_;
 
   // Physical object
   //! Object data: Composite convex collision shape
   //! All components are wrapped into one rigidBody_
-  std::vector<std::unique_ptr<btConvexHullShape>> bObjectConvexShapes_;
-  std::unique_ptr<btCompoundShape> bObjectShape_;
+  std::shared_ptr<BulletObjectShape> bObjectShape_;
   std::unique_ptr<btRigidBody> bObjectRigidBody_;
   Magnum::BulletIntegration::MotionState* bObjectMotionState_;
 
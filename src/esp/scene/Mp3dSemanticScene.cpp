@@ -6,11 +6,18 @@
 #include "SemanticScene.h"
 
 #include <algorithm>
-#include <fstream>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
 #include <map>
-#include <sstream>
 #include <string>
+#include <utility>
 
+#include "esp/core/Profiling.h"
+#include "esp/core/ThreadPool.h"
+#include "esp/io/cache.h"
 #include "esp/io/io.h"
 
 namespace esp {
@@ -81,22 +88,195 @@ std::string Mp3dRegionCategory::name(const std::string& mapping) const {
   return kRegionCategoryMap.at(labelCode_);
 }
 
+namespace {
+// Fields of a line of a house file, split on whitespace in place. Numbers are
+// parsed without copying the token; a missing or malformed field marks the
+// line as failed instead of throwing
+class HouseLine {
+ public:
+  HouseLine(const char* begin, const char* end) : pos_(begin), end_(end) {}
+
+  bool failed() const { return failed_; }
+
+  //! Next field, empty and failed if the line has no more
+  std::pair<const char*, const char*> token() {
+    while (pos_ < end_ && isSpace(*pos_)) {
+      ++pos_;
+    }
+    const char* begin = pos_;
+    while (pos_ < end_ && !isSpace(*pos_)) {
+      ++pos_;
+    }
+    if (begin == pos_) {
+      failed_ = true;
+    }
+    return {begin, pos_};
+  }
+
+  std::string string() {
+    const auto t = token();
+    return std::string(t.first, t.second);
+  }
+
+  void skip(int count) {
+    for (int i = 0; i < count; ++i) {
+      token();
+    }
+  }
+
+  int integer() {
+    const auto t = token();
+    const char* c = t.first;
+    const bool negative = c < t.second && *c == '-';
+    if (c < t.second && (*c == '-' || *c == '+')) {
+      ++c;
+    }
+    long value = 0;
+    const char* digits = c;
+    for (; c < t.second && isDigit(*c); ++c) {
+      value = value * 10 + (*c - '0');
+    }
+    if (c == digits || c != t.second) {
+      failed_ = true;
+      return 0;
+    }
+    return static_cast<int>(negative ? -value : value);
+  }
+
+  float real() {
+    const auto t = token();
+    const char* c = t.first;
+    const bool negative = c < t.second && *c == '-';
+    if (c < t.second && (*c == '-' || *c == '+')) {
+      ++c;
+    }
+    // up to 19 significant digits are exact in the mantissa, which is more
+    // than a float needs
+    uint64_t mantissa = 0;
+    int exponent = 0;
+    int numDigits = 0;
+    bool hasDigits = false;
+    for (; c < t.second && isDigit(*c); ++c, hasDigits = true) {
+      if (numDigits < 19) {
+        mantissa = mantissa * 10 + (*c - '0');
+        numDigits += mantissa > 0;
+      } else {
+        ++exponent;
+      }
+    }
+    if (c < t.second && *c == '.') {
+      for (++c; c < t.second && isDigit(*c); ++c, hasDigits = true) {
+        if (numDigits < 19) {
+          mantissa = mantissa * 10 + (*c - '0');
+          numDigits += mantissa > 0;
+          --exponent;
+        }
+      }
+    }
+    if (hasDigits && c < t.second && (*c == 'e' || *c == 'E')) {
+      ++c;
+      const bool negativeExponent = c < t.second && *c == '-';
+      if (c < t.second && (*c == '-' || *c == '+')) {
+        ++c;
+      }
+      int e = 0;
+      const char* digits = c;
+      for (; c < t.second && isDigit(*c); ++c) {
+        e = std::min(e * 10 + (*c - '0'), 9999);
+      }
+      if (c == digits) {
+        hasDigits = false;
+      }
+      exponent += negativeExponent ? -e : e;
+    }
+    if (!hasDigits || c != t.second) {
+      // nan, inf and the like, rare enough to go through a copy
+      const std::string s(t.first, t.second);
+      char* parsedEnd = nullptr;
+      const float value = std::strtof(s.c_str(), &parsedEnd);
+      if (s.empty() || parsedEnd != s.c_str() + s.size()) {
+        failed_ = true;
+      }
+      return value;
+    }
+    double value = static_cast<double>(mantissa);
+    if (exponent < 0) {
+      value /= pow10(-exponent);
+    } else if (exponent > 0) {
+      value *= pow10(exponent);
+    }
+    return static_cast<float>(negative ? -value : value);
+  }
+
+ private:
+  static bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+  }
+  static bool isDigit(char c) { return c >= '0' && c <= '9'; }
+
+  static double pow10(int exponent) {
+    static const double table[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,
+                                   1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                   1e12, 1e13, 1e14, 1e15, 1e16, 1e17,
+                                   1e18, 1e19, 1e20, 1e21, 1e22};
+    return exponent < 23 ? table[exponent] : std::pow(10.0, exponent);
+  }
+
+  const char* pos_;
+  const char* end_;
+  bool failed_ = false;
+};
+
+// Object record parsed off the loading thread, linked into the scene after
+struct HouseObject {
+  int index = ID_UNDEFINED;
+  int regionIndex = ID_UNDEFINED;
+  int categoryIndex = ID_UNDEFINED;
+  geo::OBB obb;
+};
+
+// Run parse(i) for i in [0, count) on up to numThreads threads of the pool
+// in contiguous chunks, false if any of them returned false
+template <typename F>
+bool parallelParse(size_t count, int numThreads, F parse) {
+  // fewer lines than this are not worth handing out
+  const size_t minLinesPerChunk = 1024;
+  std::atomic<bool> failed{false};
+  core::parallelForRange(count, minLinesPerChunk, numThreads,
+                         [&](size_t begin, size_t end) {
+                           for (size_t i = begin; i < end; ++i) {
+                             if (!parse(i)) {
+                               failed = true;
+                             }
+                           }
+                         });
+  return !failed;
+}
+}  // namespace
+
 bool SemanticScene::loadMp3dHouse(
     const std::string& houseFilename,
     SemanticScene& scene,
     const quatf& worldRotation /* = quatf::FromTwoVectors(-vec3f::UnitZ(),
-                                                       geo::ESP_GRAVITY) */ ) {
+                                                     geo::ESP_GRAVITY) */,
+    int numThreads /* = 0 */) {
+  ESP_PROFILE_SCOPE("SemanticScene::loadMp3dHouse");
   if (!io::exists(houseFilename)) {
     LOG(ERROR) << "Could not load file " << houseFilename;
     return false;
   }
+  const io::MappedFile file{houseFilename};
+  if (!file.isValid()) {
+    LOG(ERROR) << "Could not read file " << houseFilename;
+    return false;
+  }
 
   const bool hasWorldRotation = !worldRotation.isApprox(quatf::Identity());
 
-  auto getVec3f = [&](const std::vector<std::string>& tokens, int offset) {
-    const float x = std::stof(tokens[offset]);
-    const float y = std::stof(tokens[offset + 1]);
-    const float z = std::stof(tokens[offset + 2]);
+  auto getVec3f = [&](HouseLine& line) {
+    const float x = line.real();
+    const float y = line.real();
+    const float z = line.real();
     vec3f p = vec3f(x, y, z);
     if (hasWorldRotation) {
       p = worldRotation * p;
@@ -104,160 +284,251 @@ bool SemanticScene::loadMp3dHouse(
     return p;
   };
 
-  auto getBBox = [&](const std::vector<std::string>& tokens, int offset) {
-    return box3f(getVec3f(tokens, offset), getVec3f(tokens, offset + 3));
+  auto getBBox = [&](HouseLine& line) {
+    const vec3f min = getVec3f(line);
+    return box3f(min, getVec3f(line));
   };
 
-  auto getOBB = [&](const std::vector<std::string>& tokens, int offset) {
-    const vec3f center = getVec3f(tokens, offset);
+  auto getOBB = [&](HouseLine& line) {
+    const vec3f center = getVec3f(line);
     mat3f rotation;
-    rotation.col(0) << getVec3f(tokens, offset + 3);
-    rotation.col(1) << getVec3f(tokens, offset + 6);
+    rotation.col(0) << getVec3f(line);
+    rotation.col(1) << getVec3f(line);
     rotation.col(2) << rotation.col(0).cross(rotation.col(1));
-    const vec3f radius = getVec3f(tokens, offset + 9);
-    return geo::OBB(center, 2 * radius, quatf(rotation));
+    // the radii are along the box axes, so they do not rotate with the world
+    const float r0 = line.real();
+    const float r1 = line.real();
+    const float r2 = line.real();
+    return geo::OBB(center, 2 * vec3f(r0, r1, r2), quatf(rotation));
   };
 
-  // open stream and determine house format version
-  std::ifstream ifs = std::ifstream(houseFilename);
-  std::string header;
-  std::getline(ifs, header);
-  if (header != "ASCII 1.1") {
-    LOG(ERROR) << "Unsupported House format header " << header;
+  // one pass over the file to find the lines of each record type; the
+  // records are parsed by type after, in the order the types depend on each
+  // other
+  using Line = std::pair<const char*, const char*>;
+  const char* pos = file.data();
+  const char* const end = file.data() + file.size();
+  auto nextLine = [&]() {
+    const char* lineEnd =
+        static_cast<const char*>(std::memchr(pos, '\n', end - pos));
+    if (lineEnd == nullptr) {
+      lineEnd = end;
+    }
+    Line line{pos, lineEnd};
+    pos = lineEnd < end ? lineEnd + 1 : end;
+    if (line.second > line.first && line.second[-1] == '\r') {
+      --line.second;
+    }
+    return line;
+  };
+
+  // determine house format version
+  const Line header = nextLine();
+  if (std::string(header.first, header.second) != "ASCII 1.1") {
+    LOG(ERROR) << "Unsupported House format header "
+               << std::string(header.first, header.second);
     return false;
   }
 
-  scene.categories_.clear();
-  scene.levels_.clear();
-  scene.regions_.clear();
-  scene.objects_.clear();
-
-  std::string line;
-  while (std::getline(ifs, line)) {
-    if (line.empty()) {
+  std::vector<Line> houseLines, levelLines, regionLines, categoryLines,
+      objectLines, segmentLines;
+  while (pos < end) {
+    const Line line = nextLine();
+    if (line.first == line.second) {
       continue;
     }
-    const std::vector<std::string> tokens = io::tokenize(line, " ", 0, true);
-    switch (line[0]) {
-      case 'H': {  // house
-        // H name label #images #panoramas #vertices #surfaces #segments
-        //   #objects #categories #regions #portals #levels  0 0 0 0 0
-        //   xlo ylo zlo xhi yhi zhi  0 0 0 0 0
-        scene.name_ = tokens[1];
-        scene.label_ = tokens[2];
-        scene.elementCounts_["images"] = std::stoi(tokens[3]);
-        scene.elementCounts_["panoramas"] = std::stoi(tokens[4]);
-        scene.elementCounts_["vertices"] = std::stoi(tokens[5]);
-        scene.elementCounts_["surfaces"] = std::stoi(tokens[6]);
-        scene.elementCounts_["segments"] = std::stoi(tokens[7]);
-        scene.elementCounts_["objects"] = std::stoi(tokens[8]);
-        scene.elementCounts_["categories"] = std::stoi(tokens[9]);
-        scene.elementCounts_["regions"] = std::stoi(tokens[10]);
-        scene.elementCounts_["portals"] = std::stoi(tokens[11]);
-        scene.elementCounts_["levels"] = std::stoi(tokens[12]);
-        scene.bbox_ = getBBox(tokens, 18);
+    switch (*line.first) {
+      case 'H':  // house
+        houseLines.push_back(line);
         break;
-      }
-      case 'L': {  // level
-        // L level_index #regions label  px py pz  xlo ylo zlo xhi yhi zhi  0 0
-        //   0 0 0
-        scene.levels_.emplace_back(SemanticLevel::create());
-        auto& level = scene.levels_.back();
-        level->index_ = std::stoi(tokens[1]);
-        // NOTE tokens[2] is number of regions in level which we don't need
-        level->labelCode_ = tokens[3];
-        level->position_ = getVec3f(tokens, 4);
-        level->bbox_ = getBBox(tokens, 7);
-        break;
-      }
-      case 'R': {  // region
-        // R region_index level_index 0 0 label  px py pz  xlo ylo zlo xhi yhi
-        //   zhi height  0 0 0 0
-        scene.regions_.emplace_back(SemanticRegion::create());
-        auto& region = scene.regions_.back();
-        region->index_ = std::stoi(tokens[1]);
-        region->parentIndex_ = std::stoi(tokens[2]);
-        region->category_ = std::make_shared<Mp3dRegionCategory>(tokens[5][0]);
-        region->position_ = getVec3f(tokens, 6);
-        region->bbox_ = getBBox(tokens, 9);
-        if (region->parentIndex_ >= 0) {
-          region->level_ = scene.levels_[region->parentIndex_];
-          region->level_->regions_.push_back(region);
-        }
+      case 'L':  // level
+        levelLines.push_back(line);
         break;
-      }
-      case 'P': {  // portal or panorama
-        // P portal_index region0_index region1_index label  xlo ylo zlo xhi
-        //   yhi zhi  0 0 0 0
-        // P name  panorama_index region_index 0  px py pz  0 0 0 0 0
-        break;
-      }
-      case 'S': {  // surface
-        // S surface_index region_index 0 label px py pz  nx ny nz  xlo ylo
-        // zlo
-        //   xhi yhi zhi  0 0 0 0 0
+      case 'R':  // region
+        regionLines.push_back(line);
         break;
-      }
-      case 'V': {  // vertex
-        // V vertex_index surface_index label  px py pz  nx ny nz  0 0 0
+      case 'C':  // category
+        categoryLines.push_back(line);
         break;
-      }
-      case 'I': {  // image
-        // I image_index panorama_index  name camera_index yaw_index e00 e01
-        //   e02 e03 e10 e11 e12 e13 e20 e21 e22 e23 e30 e31 e32 e33  i00 i01
-        //   i02  i10 i11 i12 i20 i21 i22  width height  px py pz  0 0 0 0 0
+      case 'O':  // object
+        objectLines.push_back(line);
         break;
-      }
-      case 'C': {  // category
-        // C category_index category_mapping_index category_mapping_name
-        //   mpcat40_index mpcat40_name 0 0 0 0 0
-        scene.categories_.emplace_back(std::make_shared<Mp3dObjectCategory>());
-        auto& category =
-            static_cast<Mp3dObjectCategory&>(*scene.categories_.back());
-        category.index_ = std::stoi(tokens[1]);
-        category.categoryMappingIndex_ = std::stoi(tokens[2]);
-        std::string catName = tokens[3];
-        std::replace(catName.begin(), catName.end(), '#', ' ');
-        category.categoryMappingName_ = catName;
-        category.mpcat40Index_ = std::stoi(tokens[4]);
-        category.mpcat40Name_ = tokens[5];
+      case 'E':  // segment
+        segmentLines.push_back(line);
         break;
-      }
-      case 'O': {  // object
-        // O object_index region_index category_index px py pz  a0x a0y a0z
-        //   a1x a1y a1z  r0 r1 r2 0 0 0 0 0 0 0 0
-        scene.objects_.emplace_back(SemanticObject::create());
-        auto& object = scene.objects_.back();
-        object->index_ = std::stoi(tokens[1]);
-        object->parentIndex_ = std::stoi(tokens[2]);
-        int categoryIndex = std::stoi(tokens[3]);
-        if (categoryIndex < 0) {  // no category
-          object->category_ = std::make_shared<Mp3dObjectCategory>();
-        } else {
-          object->category_ = scene.categories_[categoryIndex];
-        }
-        object->obb_ = getOBB(tokens, 4);
-        if (object->parentIndex_ >= 0) {
-          object->region_ = scene.regions_[object->parentIndex_];
-          object->region_->objects_.push_back(object);
-        }
+      default:
+        // P portal or panorama, S surface, V vertex and I image records are
+        // not used
         break;
-      }
-      case 'E': {  // segment
-        // E segment_index object_index id area px py pz xlo ylo zlo xhi yhi
-        // zhi 0 0 0 0 0
-        const int objectIndex = std::stoi(tokens[2]);
-        const int segmentId = std::stoi(tokens[3]);
-        // NOTE: segmentId = regionIndex * 1000000 + segmentId
-        scene.segmentToObjectIndex_[segmentId] = objectIndex;
-        break;
-      }
-      default: {
-        break;
-      }
     }
   }
 
+  scene.categories_.clear();
+  scene.levels_.clear();
+  scene.regions_.clear();
+  scene.objects_.clear();
+  scene.segmentToObjectIndex_.clear();
+
+  auto malformed = [&](const Line& line) {
+    LOG(ERROR) << "Malformed House record "
+               << std::string(line.first, line.second) << " in "
+               << houseFilename;
+    return false;
+  };
+
+  for (const Line& l : houseLines) {
+    // H name label #images #panoramas #vertices #surfaces #segments
+    //   #objects #categories #regions #portals #levels  0 0 0 0 0
+    //   xlo ylo zlo xhi yhi zhi  0 0 0 0 0
+    HouseLine line{l.first, l.second};
+    line.skip(1);
+    scene.name_ = line.string();
+    scene.label_ = line.string();
+    for (const char* element :
+         {"images", "panoramas", "vertices", "surfaces", "segments",
+          "objects", "categories", "regions", "portals", "levels"}) {
+      scene.elementCounts_[element] = line.integer();
+    }
+    line.skip(5);
+    scene.bbox_ = getBBox(line);
+    if (line.failed()) {
+      return malformed(l);
+    }
+  }
+
+  for (const Line& l : levelLines) {
+    // L level_index #regions label  px py pz  xlo ylo zlo xhi yhi zhi  0 0
+    //   0 0 0
+    HouseLine line{l.first, l.second};
+    line.skip(1);
+    scene.levels_.emplace_back(SemanticLevel::create());
+    auto& level = scene.levels_.back();
+    level->index_ = line.integer();
+    // NOTE the number of regions in the level is not needed
+    line.skip(1);
+    level->labelCode_ = line.string();
+    level->position_ = getVec3f(line);
+    level->bbox_ = getBBox(line);
+    if (line.failed()) {
+      return malformed(l);
+    }
+  }
+
+  for (const Line& l : regionLines) {
+    // R region_index level_index 0 0 label  px py pz  xlo ylo zlo xhi yhi
+    //   zhi height  0 0 0 0
+    HouseLine line{l.first, l.second};
+    line.skip(1);
+    scene.regions_.emplace_back(SemanticRegion::create());
+    auto& region = scene.regions_.back();
+    region->index_ = line.integer();
+    region->parentIndex_ = line.integer();
+    line.skip(2);
+    region->category_ =
+        std::make_shared<Mp3dRegionCategory>(*line.token().first);
+    region->position_ = getVec3f(line);
+    region->bbox_ = getBBox(line);
+    if (line.failed() || region->parentIndex_ >=
+                             static_cast<int>(scene.levels_.size())) {
+      return malformed(l);
+    }
+    if (region->parentIndex_ >= 0) {
+      region->level_ = scene.levels_[region->parentIndex_];
+      region->level_->regions_.push_back(region);
+    }
+  }
+
+  for (const Line& l : categoryLines) {
+    // C category_index category_mapping_index category_mapping_name
+    //   mpcat40_index mpcat40_name 0 0 0 0 0
+    HouseLine line{l.first, l.second};
+    line.skip(1);
+    scene.categories_.emplace_back(std::make_shared<Mp3dObjectCategory>());
+    auto& category =
+        static_cast<Mp3dObjectCategory&>(*scene.categories_.back());
+    category.index_ = line.integer();
+    category.categoryMappingIndex_ = line.integer();
+    std::string catName = line.string();
+    std::replace(catName.begin(), catName.end(), '#', ' ');
+    category.categoryMappingName_ = catName;
+    category.mpcat40Index_ = line.integer();
+    category.mpcat40Name_ = line.string();
+    if (line.failed()) {
+      return malformed(l);
+    }
+  }
+
+  // objects and segments are the bulk of a house and independent of each
+  // other, so they are parsed in parallel
+  std::vector<HouseObject> objects(objectLines.size());
+  std::vector<std::pair<int, int>> segments(segmentLines.size());
+  std::atomic<size_t> failedLine{std::numeric_limits<size_t>::max()};
+  auto parseObject = [&](size_t i) {
+    // O object_index region_index category_index px py pz  a0x a0y a0z
+    //   a1x a1y a1z  r0 r1 r2 0 0 0 0 0 0 0 0
+    HouseLine line{objectLines[i].first, objectLines[i].second};
+    line.skip(1);
+    HouseObject& object = objects[i];
+    object.index = line.integer();
+    object.regionIndex = line.integer();
+    object.categoryIndex = line.integer();
+    object.obb = getOBB(line);
+    if (line.failed()) {
+      failedLine = i;
+    }
+    return !line.failed();
+  };
+  auto parseSegment = [&](size_t i) {
+    // E segment_index object_index id area px py pz xlo ylo zlo xhi yhi
+    // zhi 0 0 0 0 0
+    HouseLine line{segmentLines[i].first, segmentLines[i].second};
+    line.skip(2);
+    const int objectIndex = line.integer();
+    // NOTE: segmentId = regionIndex * 1000000 + segmentId
+    const int segmentId = line.integer();
+    segments[i] = {segmentId, objectIndex};
+    if (line.failed()) {
+      failedLine = objectLines.size() + i;
+    }
+    return !line.failed();
+  };
+  if (!parallelParse(objectLines.size(), numThreads, parseObject) ||
+      !parallelParse(segmentLines.size(), numThreads, parseSegment)) {
+    const size_t i = failedLine;
+    return malformed(i < objectLines.size()
+                         ? objectLines[i]
+                         : segmentLines[i - objectLines.size()]);
+  }
+
+  scene.objects_.reserve(objects.size());
+  for (size_t i = 0; i < objects.size(); ++i) {
+    const HouseObject& parsedObject = objects[i];
+    if (parsedObject.categoryIndex >=
+            static_cast<int>(scene.categories_.size()) ||
+        parsedObject.regionIndex >= static_cast<int>(scene.regions_.size())) {
+      return malformed(objectLines[i]);
+    }
+    scene.objects_.emplace_back(SemanticObject::create());
+    auto& object = scene.objects_.back();
+    object->index_ = parsedObject.index;
+    object->parentIndex_ = parsedObject.regionIndex;
+    if (parsedObject.categoryIndex < 0) {  // no category
+      object->category_ = std::make_shared<Mp3dObjectCategory>();
+    } else {
+      object->category_ = scene.categories_[parsedObject.categoryIndex];
+    }
+    object->obb_ = parsedObject.obb;
+    if (object->parentIndex_ >= 0) {
+      object->region_ = scene.regions_[object->parentIndex_];
+      object->region_->objects_.push_back(object);
+    }
+  }
+
+  scene.segmentToObjectIndex_.reserve(segments.size());
+  for (const std::pair<int, int>& segment : segments) {
+    scene.segmentToObjectIndex_[segment.first] = segment.second;
+  }
+
   return true;
 }
 
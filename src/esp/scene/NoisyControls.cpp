@@ -0,0 +1,210 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#include "NoisyControls.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "SceneNode.h"
+
+namespace esp {
+namespace scene {
+
+namespace {
+// mean and variance of the translation noise along the move and sideways,
+// then of the rotation noise, of the linear and then the rotational motions; by
+// robot and controller, as in pyrobot_noisy_controls.py
+const ControllerNoiseModel noiseModels[2][3] = {
+    // LoCoBot
+    {
+        // ILQR
+        {{{2, {0.014f, 0.009f}, {0.006f, 0.005f}}, {1, {0.008f}, {0.004f}}},
+         {{2, {0.003f, 0.003f}, {0.002f, 0.003f}}, {1, {0.023f}, {0.012f}}}},
+        // Proportional
+        {{{2, {0.017f, 0.042f}, {0.007f, 0.023f}}, {1, {0.031f}, {0.026f}}},
+         {{2, {0.001f, 0.005f}, {0.001f, 0.004f}}, {1, {0.043f}, {0.017f}}}},
+        // Movebase
+        {{{2, {0.074f, 0.036f}, {0.019f, 0.033f}}, {1, {0.189f}, {0.038f}}},
+         {{2, {0.002f, 0.003f}, {0.0f, 0.002f}}, {1, {0.219f}, {0.019f}}}},
+    },
+    // LoCoBot-Lite
+    {
+        // ILQR
+        {{{2, {0.142f, 0.023f}, {0.008f, 0.008f}}, {1, {0.031f}, {0.028f}}},
+         {{2, {0.002f, 0.002f}, {0.001f, 0.002f}}, {1, {0.122f}, {0.03f}}}},
+        // Proportional
+        {{{2, {0.135f, 0.043f}, {0.007f, 0.009f}}, {1, {0.049f}, {0.009f}}},
+         {{2, {0.002f, 0.002f}, {0.002f, 0.001f}}, {1, {0.054f}, {0.061f}}}},
+        // Movebase
+        {{{2, {0.192f, 0.117f}, {0.055f, 0.144f}}, {1, {0.128f}, {0.143f}}},
+         {{2, {0.002f, 0.001f}, {0.001f, 0.001f}}, {1, {0.173f}, {0.025f}}}},
+    },
+};
+
+// after this many rejected normal samples fall back to a uniform one, for
+// truncations far out in a tail
+constexpr int maxRejections = 64;
+
+// Sample dimension i of gaussian, truncated below at the value lower
+float sampleDimension(core::Random& random,
+                      const DiagonalGaussian& gaussian,
+                      int i,
+                      float lower = -INFINITY) {
+  const float mean = gaussian.mean[i];
+  const float stddev = std::sqrt(gaussian.variance[i]);
+  if (stddev == 0.0f) {
+    return mean;
+  }
+  return sampleTruncatedNormal(random, mean, stddev,
+                               std::max((lower - mean) / stddev, -3.0f));
+}
+
+float sign(float x) {
+  // + epsilon to make sure 0 is positive
+  return x + 1e-8f >= 0.0f ? 1.0f : -1.0f;
+}
+
+// Translate by translateAmount along and turn by rotateAmount degrees about
+// the up axis of the node, with the noise of model. The noise of the intended
+// motion is truncated so that the node always moves a little in the intended
+// direction
+SceneNode& noisyMove(SceneNode& object,
+                     float translateAmount,
+                     float rotateAmount,
+                     float multiplier,
+                     const MotionNoiseModel& model,
+                     bool rotational,
+                     core::Random& random) {
+  const float forwardLower =
+      rotational ? -INFINITY : -0.95f * std::abs(translateAmount);
+  // forward and backward both overshoot on average
+  const float translationSign = sign(translateAmount);
+  const float forwardNoise =
+      translationSign * multiplier *
+      sampleDimension(random, model.linear, 0, forwardLower);
+  const float sidewaysNoise =
+      translationSign * multiplier * sampleDimension(random, model.linear, 1);
+
+  // TODO: this assumes no scale is applied, like moveForward
+  const Magnum::Matrix4 transformation = object.transformation();
+  object.translateLocal(-transformation.backward() *
+                            (translateAmount + forwardNoise) +
+                        transformation.right() * sidewaysNoise);
+
+  const Magnum::Rad rotation{Magnum::Deg(rotateAmount)};
+  const float rotationLower =
+      rotational ? -0.95f * std::abs(float(rotation)) : -INFINITY;
+  const float rotationNoise =
+      sign(rotateAmount) * multiplier *
+      sampleDimension(random, model.rotation, 0, rotationLower);
+  object.rotateYLocal(rotation + Magnum::Rad(rotationNoise));
+  object.setRotation(object.rotation().normalized());
+  return object;
+}
+}  // namespace
+
+float sampleTruncatedNormal(core::Random& random,
+                            float mean,
+                            float stddev,
+                            float lower /* = -3 */,
+                            float upper /* = 3 */) {
+  lower = std::max(lower, -3.0f);
+  upper = std::min(upper, 3.0f);
+  if (lower >= upper) {
+    return mean + stddev * lower;
+  }
+  for (int i = 0; i < maxRejections; ++i) {
+    const float x = random.normal_float_01();
+    if (x >= lower && x <= upper) {
+      return mean + stddev * x;
+    }
+  }
+  return mean + stddev * random.uniform_float(lower, upper);
+}
+
+const ControllerNoiseModel& getPyRobotNoiseModel(NoisyRobot robot,
+                                                 NoisyController controller) {
+  return noiseModels[static_cast<int>(robot)][static_cast<int>(controller)];
+}
+
+bool NoisyActuationSpec::fromActuation(
+    const std::map<std::string, float>& actuation,
+    NoisyActuationSpec& spec) {
+  auto it = actuation.find("amount");
+  if (it != actuation.end()) {
+    spec.amount = it->second;
+  }
+  it = actuation.find("noise_multiplier");
+  if (it != actuation.end()) {
+    spec.noiseMultiplier = it->second;
+  }
+  it = actuation.find("robot");
+  if (it != actuation.end()) {
+    if (it->second != 0.0f && it->second != 1.0f) {
+      LOG(ERROR) << "Unknown noisy actuation robot " << it->second;
+      return false;
+    }
+    spec.robot = static_cast<NoisyRobot>(static_cast<int>(it->second));
+  }
+  it = actuation.find("controller");
+  if (it != actuation.end()) {
+    if (it->second != 0.0f && it->second != 1.0f && it->second != 2.0f) {
+      LOG(ERROR) << "Unknown noisy actuation controller " << it->second;
+      return false;
+    }
+    spec.controller =
+        static_cast<NoisyController>(static_cast<int>(it->second));
+  }
+  return true;
+}
+
+NoisyMovePointer getNoisyMovePointer(const std::string& actName) {
+  static const std::map<std::string, NoisyMovePointer> noisyMoves = {
+      {"pyrobotNoisyMoveForward", &pyrobotNoisyMoveForward},
+      {"pyrobotNoisyMoveBackward", &pyrobotNoisyMoveBackward},
+      {"pyrobotNoisyTurnLeft", &pyrobotNoisyTurnLeft},
+      {"pyrobotNoisyTurnRight", &pyrobotNoisyTurnRight}};
+  auto it = noisyMoves.find(actName);
+  return it != noisyMoves.end() ? it->second : nullptr;
+}
+
+SceneNode& pyrobotNoisyMoveForward(SceneNode& object,
+                                   const NoisyActuationSpec& spec,
+                                   core::Random& random) {
+  return noisyMove(
+      object, spec.amount, 0.0f, spec.noiseMultiplier,
+      getPyRobotNoiseModel(spec.robot, spec.controller).linearMotion, false,
+      random);
+}
+
+SceneNode& pyrobotNoisyMoveBackward(SceneNode& object,
+                                    const NoisyActuationSpec& spec,
+                                    core::Random& random) {
+  return noisyMove(
+      object, -spec.amount, 0.0f, spec.noiseMultiplier,
+      getPyRobotNoiseModel(spec.robot, spec.controller).linearMotion, false,
+      random);
+}
+
+SceneNode& pyrobotNoisyTurnLeft(SceneNode& object,
+                                const NoisyActuationSpec& spec,
+                                core::Random& random) {
+  return noisyMove(
+      object, 0.0f, spec.amount, spec.noiseMultiplier,
+      getPyRobotNoiseModel(spec.robot, spec.controller).rotationalMotion,
+      true, random);
+}
+
+SceneNode& pyrobotNoisyTurnRight(SceneNode& object,
+                                 const NoisyActuationSpec& spec,
+                                 core::Random& random) {
+  return noisyMove(
+      object, 0.0f, -spec.amount, spec.noiseMultiplier,
+      getPyRobotNoiseModel(spec.robot, spec.controller).rotationalMotion,
+      true, random);
+}
+
+}  // namespace scene
+}  // namespace esp
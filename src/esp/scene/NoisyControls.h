@@ -0,0 +1,100 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#pragma once
+
+#include <map>
+#include <string>
+
+#include "esp/core/esp.h"
+#include "esp/core/random.h"
+
+namespace esp {
+namespace scene {
+
+// forward declaration
+class SceneNode;
+
+// Noisy actuation of the PyRobot robots, the native counterpart of
+// habitat_sim/agent/controls/pyrobot_noisy_controls.py. Parameters
+// contributed from PyRobot (https://pyrobot.org/), please cite PyRobot if you
+// use this noise model
+
+//! Sample a gaussian of mean and standard deviation truncated to
+//! [lower, upper], given in standard deviations from the mean and at most 3
+//! from it
+float sampleTruncatedNormal(core::Random& random,
+                            float mean,
+                            float stddev,
+                            float lower = -3.0f,
+                            float upper = 3.0f);
+
+//! Diagonal gaussian over up to 2 dimensions
+struct DiagonalGaussian {
+  int size;
+  float mean[2];
+  float variance[2];
+};
+
+//! Noise of the translation, sideways and along the move, and of the
+//! rotation of a motion
+struct MotionNoiseModel {
+  DiagonalGaussian linear;
+  DiagonalGaussian rotation;
+};
+
+//! Noise of the motions of a controller of a robot
+struct ControllerNoiseModel {
+  MotionNoiseModel linearMotion;
+  MotionNoiseModel rotationalMotion;
+};
+
+enum class NoisyRobot { LoCoBot = 0, LoCoBotLite = 1 };
+enum class NoisyController { ILQR = 0, Proportional = 1, Movebase = 2 };
+
+//! Noise model of a robot and controller
+const ControllerNoiseModel& getPyRobotNoiseModel(NoisyRobot robot,
+                                                 NoisyController controller);
+
+//! Parameters of a noisy move, like PyRobotNoisyActuationSpec
+struct NoisyActuationSpec {
+  //! meters to move, or degrees to turn
+  float amount = 0.0f;
+  NoisyRobot robot = NoisyRobot::LoCoBot;
+  NoisyController controller = NoisyController::ILQR;
+  //! scale of the noise, 0 for none
+  float noiseMultiplier = 1.0f;
+
+  //! Read the spec from an actuation map, with "amount", "noise_multiplier"
+  //! and the robot and controller as the numeric values of NoisyRobot and
+  //! NoisyController under "robot" and "controller". Missing entries keep
+  //! their default; false for an unknown robot or controller
+  static bool fromActuation(const std::map<std::string, float>& actuation,
+                            NoisyActuationSpec& spec);
+};
+
+typedef SceneNode& (*NoisyMovePointer)(SceneNode&,
+                                       const NoisyActuationSpec&,
+                                       core::Random&);
+
+//! The noisy move named actName, one of pyrobotNoisyMoveForward,
+//! pyrobotNoisyMoveBackward, pyrobotNoisyTurnLeft and pyrobotNoisyTurnRight,
+//! nullptr if there is none
+NoisyMovePointer getNoisyMovePointer(const std::string& actName);
+
+SceneNode& pyrobotNoisyMoveForward(SceneNode& object,
+                                   const NoisyActuationSpec& spec,
+                                   core::Random& random);
+SceneNode& pyrobotNoisyMoveBackward(SceneNode& object,
+                                    const NoisyActuationSpec& spec,
+                                    core::Random& random);
+SceneNode& pyrobotNoisyTurnLeft(SceneNode& object,
+                                const NoisyActuationSpec& spec,
+                                core::Random& random);
+SceneNode& pyrobotNoisyTurnRight(SceneNode& object,
+                                 const NoisyActuationSpec& spec,
+                                 core::Random& random);
+
+}  // namespace scene
+}  // namespace esp
@@ -64,22 +64,37 @@ SceneNode& lookDown(SceneNode& object, float angleInDegrees) {
   return lookUp(object, -angleInDegrees);
 }
 
+namespace {
+// as EPS of the Python controls
+constexpr float collisionEpsilon = 1e-5f;
+
+const std::map<std::string, ObjectControls::MovePointer> movePointers = {
+    {"moveRight", &moveRight},
+    {"moveLeft", &moveLeft},
+    {"moveUp", &moveUp},
+    {"moveDown", &moveDown},
+    {"moveForward", &moveForward},
+    {"moveBackward", &moveBackward},
+    {"lookLeft", &lookLeft},
+    {"lookRight", &lookRight},
+    {"lookUp", &lookUp},
+    {"lookDown", &lookDown},
+    // TODO Do we need a different function for turnLeft vs. lookLeft?
+    // Those should just be body vs. sensor, but should check
+    {"turnLeft", &lookLeft},
+    {"turnRight", &lookRight}};
+}  // namespace
+
 ObjectControls::ObjectControls() {
-  moveFuncMap_["moveRight"] = &moveRight;
-  moveFuncMap_["moveLeft"] = &moveLeft;
-  moveFuncMap_["moveUp"] = &moveUp;
-  moveFuncMap_["moveDown"] = &moveDown;
-  moveFuncMap_["moveForward"] = &moveForward;
-  moveFuncMap_["moveBackward"] = &moveBackward;
-  moveFuncMap_["lookLeft"] = &lookLeft;
-  moveFuncMap_["lookRight"] = &lookRight;
-  moveFuncMap_["lookUp"] = &lookUp;
-  moveFuncMap_["lookDown"] = &lookDown;
-
-  // TODO Do we need a different function for turnLeft vs. lookLeft?
-  // Those should just be body vs. sensor, but should check
-  moveFuncMap_["turnLeft"] = &lookLeft;
-  moveFuncMap_["turnRight"] = &lookRight;
+  for (const auto& move : movePointers) {
+    moveFuncMap_[move.first] = move.second;
+  }
+}
+
+ObjectControls::MovePointer ObjectControls::getMovePointer(
+    const std::string& actName) {
+  auto it = movePointers.find(actName);
+  return it != movePointers.end() ? it->second : nullptr;
 }
 
 ObjectControls& ObjectControls::setMoveFilterFunction(
@@ -88,23 +103,37 @@ ObjectControls& ObjectControls::setMoveFilterFunction(
   return *this;
 }
 
+template <typename Move>
+void ObjectControls::applyMove(SceneNode& object,
+                               bool applyFilter,
+                               Move move) {
+  if (applyFilter) {
+    // TODO: use magnum math for the filter func as well?
+    const auto startPosition =
+        cast<vec3f>(object.absoluteTransformation().translation());
+    move();
+    const auto endPos =
+        cast<vec3f>(object.absoluteTransformation().translation());
+    const vec3f filteredEndPosition = moveFilterFunc_(startPosition, endPos);
+    object.translate(Magnum::Vector3(vec3f(filteredEndPosition - endPos)));
+    // the filter may move the end a little even without a collision, so only
+    // a shorter move counts as one
+    lastMoveCollided_ =
+        (filteredEndPosition - startPosition).squaredNorm() + collisionEpsilon <
+        (endPos - startPosition).squaredNorm();
+  } else {
+    move();
+    lastMoveCollided_ = false;
+  }
+}
+
 ObjectControls& ObjectControls::action(SceneNode& object,
                                        const std::string& actName,
                                        float distance,
                                        bool applyFilter /* = true */) {
-  if (moveFuncMap_.count(actName)) {
-    if (applyFilter) {
-      // TODO: use magnum math for the filter func as well?
-      const auto startPosition =
-          cast<vec3f>(object.absoluteTransformation().translation());
-      moveFuncMap_[actName](object, distance);
-      const auto endPos =
-          cast<vec3f>(object.absoluteTransformation().translation());
-      const vec3f filteredEndPosition = moveFilterFunc_(startPosition, endPos);
-      object.translate(Magnum::Vector3(vec3f(filteredEndPosition - endPos)));
-    } else {
-      moveFuncMap_[actName](object, distance);
-    }
+  auto it = moveFuncMap_.find(actName);
+  if (it != moveFuncMap_.end()) {
+    applyMove(object, applyFilter, [&]() { it->second(object, distance); });
   } else {
     LOG(ERROR) << "Tried to perform unknown action with name " << actName;
   }
@@ -112,5 +141,40 @@ ObjectControls& ObjectControls::action(SceneNode& object,
   return *this;
 }
 
+ObjectControls& ObjectControls::action(SceneNode& object,
+                                       MovePointer move,
+                                       float distance,
+                                       bool applyFilter /* = true */) {
+  applyMove(object, applyFilter, [&]() { move(object, distance); });
+  return *this;
+}
+
+ObjectControls& ObjectControls::velocityStep(SceneNode& object,
+                                             const vec3f& linearVelocity,
+                                             const vec3f& angularVelocity,
+                                             float dt,
+                                             bool applyFilter /* = true */) {
+  applyMove(object, applyFilter, [&]() {
+    // TODO: this assumes no scale is applied, like moveForward
+    object.translate(object.rotation().transformVector(
+        Magnum::Vector3(vec3f(linearVelocity * dt))));
+    const float angle = angularVelocity.norm() * dt;
+    if (angle > 0.0f) {
+      object.rotateLocal(Magnum::Rad(angle),
+                         Magnum::Vector3(vec3f(angularVelocity.normalized())));
+      object.setRotation(object.rotation().normalized());
+    }
+  });
+  return *this;
+}
+
+ObjectControls& ObjectControls::action(SceneNode& object,
+                                       NoisyMovePointer move,
+                                       const NoisyActuationSpec& spec,
+                                       bool applyFilter /* = true */) {
+  applyMove(object, applyFilter, [&]() { move(object, spec, random_); });
+  return *this;
+}
+
 }  // namespace scene
 }  // namespace esp
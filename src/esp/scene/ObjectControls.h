@@ -9,6 +9,8 @@
 #include <string>
 
 #include "esp/core/esp.h"
+#include "esp/core/random.h"
+#include "esp/scene/NoisyControls.h"
 
 namespace esp {
 namespace scene {
@@ -21,6 +23,9 @@ class ObjectControls {
   ObjectControls();
 
   typedef std::function<SceneNode&(SceneNode&, float)> MoveFunc;
+  //! A builtin move, resolved once so that it can be applied without name
+  //! lookups or std::function calls
+  typedef SceneNode& (*MovePointer)(SceneNode&, float);
   typedef std::function<vec3f(const vec3f&, const vec3f&)> MoveFilterFunc;
   ObjectControls& setMoveFilterFunction(MoveFilterFunc filterFunc);
 
@@ -35,6 +40,42 @@ class ObjectControls {
     return action(object, actName, distance, applyFilter);
   }
 
+  //! Apply a move resolved with getMovePointer(), like action()
+  ObjectControls& action(SceneNode& object,
+                         MovePointer move,
+                         float distance,
+                         bool applyFilter = true);
+
+  //! Apply a noisy move, see NoisyControls.h, drawing its noise from the
+  //! random generator of these controls
+  ObjectControls& action(SceneNode& object,
+                         NoisyMovePointer move,
+                         const NoisyActuationSpec& spec,
+                         bool applyFilter = true);
+
+  //! Move object by linearVelocity * dt along its own axes and rotate it by
+  //! angularVelocity * dt radians about them, filtering where it ends up if
+  //! applyFilter like action(); a substep of Agent::actVelocity()
+  ObjectControls& velocityStep(SceneNode& object,
+                               const vec3f& linearVelocity,
+                               const vec3f& angularVelocity,
+                               float dt,
+                               bool applyFilter = true);
+
+  //! Whether the move filter cut the last action short, like the collided
+  //! flag of the Python controls; false after unfiltered actions
+  bool lastMoveCollided() const { return lastMoveCollided_; }
+
+  //! Seed the random generator of noisy moves
+  void seed(uint32_t newSeed) { random_.seed(newSeed); }
+
+  //! Use random, e.g. a stream split from the generator of the simulator
+  void setRandom(const core::Random& random) { random_ = random; }
+  const core::Random& getRandom() const { return random_; }
+
+  //! The builtin move named actName, nullptr if there is none
+  static MovePointer getMovePointer(const std::string& actName);
+
   inline const std::map<std::string, MoveFunc>& getMoveFuncMap() const {
     return moveFuncMap_;
   }
@@ -44,6 +85,12 @@ class ObjectControls {
     return end;
   };
   std::map<std::string, MoveFunc> moveFuncMap_;
+  core::Random random_;
+  bool lastMoveCollided_ = false;
+
+  //! Apply move to object, filtering where it ends up if applyFilter
+  template <typename Move>
+  void applyMove(SceneNode& object, bool applyFilter, Move move);
 
   ESP_SMART_POINTERS(ObjectControls)
 };
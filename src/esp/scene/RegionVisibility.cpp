@@ -0,0 +1,230 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#include "RegionVisibility.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+#include "esp/geo/BVH.h"
+#include "esp/io/cache.h"
+#include "esp/scene/SemanticScene.h"
+
+namespace esp {
+namespace scene {
+
+namespace {
+const uint32_t regionVisibilityCacheKind = 108;
+const uint32_t regionVisibilityCacheVersion = 1;
+
+// fraction of a segment at either end a hit is ignored in, so that samples
+// on a surface do not block themselves
+constexpr float segmentEpsilon = 1e-4f;
+
+// Triangles of a mesh in a geo::BVH, for segment tests
+class TriangleTree {
+ public:
+  TriangleTree(const std::vector<vec3f>& positions,
+               const std::vector<uint32_t>& indices)
+      : positions_(positions), indices_(indices) {
+    std::vector<box3f> boxes(indices.size() / 3);
+    for (size_t i = 0; i < boxes.size(); ++i) {
+      for (int k = 0; k < 3; ++k) {
+        boxes[i].extend(positions[indices[3 * i + k]]);
+      }
+    }
+    bvh_.build(boxes);
+  }
+
+  // whether any triangle crosses the segment from a to b
+  bool blocks(const vec3f& a, const vec3f& b) const {
+    const vec3f direction = b - a;
+    const vec3f inverseDirection = direction.cwiseInverse();
+    float near;
+    return bvh_.traverse(
+        [&](const box3f& box) {
+          return geo::intersectRayBox(box, a, inverseDirection, 1.0f, near);
+        },
+        [&](int triangle) {
+          return intersectsTriangle(triangle, a, direction);
+        });
+  }
+
+ private:
+  // Moeller-Trumbore, for t in the segment short of its ends
+  bool intersectsTriangle(int triangle,
+                          const vec3f& origin,
+                          const vec3f& direction) const {
+    const vec3f& p0 = positions_[indices_[3 * triangle]];
+    const vec3f edge1 = positions_[indices_[3 * triangle + 1]] - p0;
+    const vec3f edge2 = positions_[indices_[3 * triangle + 2]] - p0;
+    const vec3f p = direction.cross(edge2);
+    const float determinant = edge1.dot(p);
+    if (std::abs(determinant) < 1e-12f) {
+      return false;
+    }
+    const float inverseDeterminant = 1.0f / determinant;
+    const vec3f s = origin - p0;
+    const float u = s.dot(p) * inverseDeterminant;
+    if (u < 0.0f || u > 1.0f) {
+      return false;
+    }
+    const vec3f q = s.cross(edge1);
+    const float v = direction.dot(q) * inverseDeterminant;
+    if (v < 0.0f || u + v > 1.0f) {
+      return false;
+    }
+    const float t = edge2.dot(q) * inverseDeterminant;
+    return t > segmentEpsilon && t < 1.0f - segmentEpsilon;
+  }
+
+  const std::vector<vec3f>& positions_;
+  const std::vector<uint32_t>& indices_;
+  geo::BVH bvh_;
+};
+}  // namespace
+
+RegionVisibility::RegionVisibility(const std::vector<box3f>& regionBoxes)
+    : regionBoxes_(regionBoxes),
+      visible_(regionBoxes.size() * regionBoxes.size(), 1) {}
+
+std::shared_ptr<RegionVisibility> RegionVisibility::compute(
+    const std::vector<box3f>& regionBoxes,
+    const std::vector<vec3f>& positions,
+    const std::vector<uint32_t>& indices,
+    const RegionVisibilitySettings& settings) {
+  auto visibility = RegionVisibility::create(regionBoxes);
+  const int numRegions = regionBoxes.size();
+  std::fill(visibility->visible_.begin(), visibility->visible_.end(), 0);
+
+  std::mt19937 generator(settings.seed);
+  std::uniform_real_distribution<float> uniform(settings.sampleMargin,
+                                                1.0f - settings.sampleMargin);
+  std::vector<std::vector<vec3f>> samples(numRegions);
+  for (int i = 0; i < numRegions; ++i) {
+    const box3f& box = regionBoxes[i];
+    for (int k = 0; k < settings.samplesPerRegion && !box.isEmpty(); ++k) {
+      // one coordinate per statement, as the order arguments are evaluated
+      // in is unspecified
+      vec3f t;
+      for (int axis = 0; axis < 3; ++axis) {
+        t[axis] = uniform(generator);
+      }
+      samples[i].push_back(box.min() + box.sizes().cwiseProduct(t));
+    }
+  }
+
+  const TriangleTree tree(positions, indices);
+  const vec3f margin = vec3f::Constant(settings.adjacencyDistance);
+  for (int i = 0; i < numRegions; ++i) {
+    visibility->visible_[i * numRegions + i] = 1;
+    for (int j = i + 1; j < numRegions; ++j) {
+      bool visible =
+          box3f(regionBoxes[i].min() - margin, regionBoxes[i].max() + margin)
+              .intersects(regionBoxes[j]);
+      for (size_t a = 0; a < samples[i].size() && !visible; ++a) {
+        for (size_t b = 0; b < samples[j].size() && !visible; ++b) {
+          visible = !tree.blocks(samples[i][a], samples[j][b]);
+        }
+      }
+      visibility->visible_[i * numRegions + j] = visible;
+      visibility->visible_[j * numRegions + i] = visible;
+    }
+  }
+  return visibility;
+}
+
+std::vector<box3f> RegionVisibility::regionBoxes(const SemanticScene& scene) {
+  std::vector<box3f> boxes;
+  for (const auto& region : scene.regions()) {
+    boxes.push_back(region->aabb());
+  }
+  return boxes;
+}
+
+int RegionVisibility::regionAt(const vec3f& point) const {
+  int region = ID_UNDEFINED;
+  float volume = 0.0f;
+  for (int i = 0; i < regionBoxes_.size(); ++i) {
+    if (regionBoxes_[i].contains(point) &&
+        (region == ID_UNDEFINED || regionBoxes_[i].volume() < volume)) {
+      region = i;
+      volume = regionBoxes_[i].volume();
+    }
+  }
+  return region;
+}
+
+std::vector<int> RegionVisibility::visibleRegions(int from) const {
+  std::vector<int> regions;
+  for (int i = 0; i < regionBoxes_.size(); ++i) {
+    if (isVisible(from, i)) {
+      regions.push_back(i);
+    }
+  }
+  return regions;
+}
+
+bool RegionVisibility::isBoxVisible(int from, const box3f& box) const {
+  if (from == ID_UNDEFINED) {
+    return true;
+  }
+  bool inAnyRegion = false;
+  for (int i = 0; i < regionBoxes_.size(); ++i) {
+    if (regionBoxes_[i].intersects(box)) {
+      if (isVisible(from, i)) {
+        return true;
+      }
+      inAnyRegion = true;
+    }
+  }
+  return !inAnyRegion;
+}
+
+bool RegionVisibility::save(const std::string& file,
+                            const std::string& sourceFile) const {
+  // the region boxes as min and max, then the matrix of flags
+  std::vector<vec3f> corners;
+  for (const box3f& box : regionBoxes_) {
+    corners.push_back(box.min());
+    corners.push_back(box.max());
+  }
+  io::CacheWriter writer(regionVisibilityCacheKind,
+                         regionVisibilityCacheVersion, sourceFile);
+  writer.addSection(corners);
+  writer.addSection(visible_);
+  return writer.write(file);
+}
+
+std::shared_ptr<RegionVisibility> RegionVisibility::load(
+    const std::string& file,
+    const std::string& sourceFile) {
+  const io::CacheReader reader(file, regionVisibilityCacheKind,
+                               regionVisibilityCacheVersion, sourceFile);
+  std::vector<vec3f> corners;
+  std::vector<uint8_t> visible;
+  if (!reader.isValid() || !reader.readSection(0, corners) ||
+      !reader.readSection(1, visible)) {
+    return nullptr;
+  }
+  const size_t numRegions = corners.size() / 2;
+  if (corners.size() % 2 != 0 || visible.size() != numRegions * numRegions) {
+    return nullptr;
+  }
+  std::vector<box3f> boxes;
+  for (size_t i = 0; i < corners.size(); i += 2) {
+    boxes.emplace_back(corners[i], corners[i + 1]);
+  }
+  auto visibility = RegionVisibility::create(boxes);
+  visibility->visible_ = std::move(visible);
+  return visibility;
+}
+
+std::string regionVisibilityFilename(const std::string& houseFile) {
+  return io::cacheFilename(houseFile + ".pvs");
+}
+
+}  // namespace scene
+}  // namespace esp
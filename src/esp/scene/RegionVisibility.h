@@ -0,0 +1,98 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "esp/core/esp.h"
+
+namespace esp {
+namespace scene {
+
+class SemanticScene;
+
+struct RegionVisibilitySettings {
+  //! Points sampled in the AABB of each region; two regions see each other
+  //! if any segment between a point of one and a point of the other misses
+  //! the scene mesh
+  int samplesPerRegion = 16;
+  //! Regions whose AABBs are closer than this, in meters, see each other
+  //! without any test, as rooms sharing a doorway or an open floor plan do
+  float adjacencyDistance = 0.1f;
+  //! Fraction of the AABB of a region left out around the samples, so that
+  //! they fall inside the room rather than into its walls, floor and ceiling
+  float sampleMargin = 0.1f;
+  //! Seed of the sampling, which makes the sets deterministic
+  uint32_t seed = 0;
+};
+
+// Potentially visible sets of the regions of a SemanticScene: for each
+// region, the regions any point of it might see. They are computed offline
+// from the region AABBs and the scene mesh, by the datatool
+// create_region_visibility task, and stored next to the house file, so that
+// the renderer can skip the drawables of the regions not visible from the
+// region of the camera at no cost beyond a lookup. Sets are conservative up
+// to the sampling: regions seen only through a gap no sampled segment passes
+// may be missed. Regions are indexed like SemanticScene::regions()
+class RegionVisibility {
+ public:
+  //! Regions of boxes that all see each other
+  explicit RegionVisibility(const std::vector<box3f>& regionBoxes);
+
+  //! Visibility of the regions of boxes in the triangle mesh of positions and
+  //! indices, in the same frame
+  static std::shared_ptr<RegionVisibility> compute(
+      const std::vector<box3f>& regionBoxes,
+      const std::vector<vec3f>& positions,
+      const std::vector<uint32_t>& indices,
+      const RegionVisibilitySettings& settings = {});
+
+  //! AABBs of the regions of scene, in the order of its regions()
+  static std::vector<box3f> regionBoxes(const SemanticScene& scene);
+
+  int getNumRegions() const { return regionBoxes_.size(); }
+  const std::vector<box3f>& getRegionBoxes() const { return regionBoxes_; }
+
+  //! Smallest region containing point, ID_UNDEFINED if none does
+  int regionAt(const vec3f& point) const;
+
+  //! Whether region to is in the set of region from, which a region always
+  //! is in its own, and the sets are symmetric
+  bool isVisible(int from, int to) const {
+    return visible_[from * regionBoxes_.size() + to] != 0;
+  }
+
+  //! The set of region from, in index order
+  std::vector<int> visibleRegions(int from) const;
+
+  //! Whether something within the world space box may be visible from region
+  //! from: if the box overlaps a region of its set, or no region at all, as
+  //! the outside and the shell of a house do. Always true for from
+  //! ID_UNDEFINED, a camera outside of all regions
+  bool isBoxVisible(int from, const box3f& box) const;
+
+  //! Save the sets; sourceFile is the house file of the regions
+  bool save(const std::string& file, const std::string& sourceFile) const;
+
+  //! Sets saved by save(), nullptr if the file is missing or was made from
+  //! other contents of the house file
+  static std::shared_ptr<RegionVisibility> load(const std::string& file,
+                                                const std::string& sourceFile);
+
+  ESP_SMART_POINTERS(RegionVisibility)
+
+ protected:
+  std::vector<box3f> regionBoxes_;
+  // row-major matrix of getNumRegions() squared flags, 1 where the region of
+  // the row sees the one of the column
+  std::vector<uint8_t> visible_;
+};
+
+//! File the region visibility of a house is stored in, next to the house
+std::string regionVisibilityFilename(const std::string& houseFile);
+
+}  // namespace scene
+}  // namespace esp
@@ -9,18 +9,52 @@ namespace esp {
 namespace scene {
 
 int SceneManager::initSceneGraph() {
+  // reuse the first released slot, so that IDs stay small and dense however
+  // many scenes are cycled through
+  for (int i = 0; i < sceneGraphs_.size(); ++i) {
+    if (sceneGraphs_[i] == nullptr) {
+      sceneGraphs_[i] = std::make_unique<SceneGraph>();
+      return i;
+    }
+  }
   sceneGraphs_.emplace_back(std::make_unique<SceneGraph>());
   int index = sceneGraphs_.size() - 1;
   return index;
 }
 
+bool SceneManager::releaseSceneGraph(int sceneID) {
+  if (!hasSceneGraph(sceneID)) {
+    LOG(ERROR) << "SceneManager::releaseSceneGraph: no scene graph " << sceneID;
+    return false;
+  }
+  sceneGraphs_[sceneID] = nullptr;
+  // trailing released slots need not be kept
+  while (!sceneGraphs_.empty() && sceneGraphs_.back() == nullptr) {
+    sceneGraphs_.pop_back();
+  }
+  return true;
+}
+
+bool SceneManager::hasSceneGraph(int sceneID) const {
+  return sceneID >= 0 && sceneID < sceneGraphs_.size() &&
+         sceneGraphs_[sceneID] != nullptr;
+}
+
+int SceneManager::getNumSceneGraphs() const {
+  int numSceneGraphs = 0;
+  for (const auto& sceneGraph : sceneGraphs_) {
+    numSceneGraphs += sceneGraph != nullptr;
+  }
+  return numSceneGraphs;
+}
+
 SceneGraph& SceneManager::getSceneGraph(int sceneID) {
-  ASSERT(sceneID >= 0 && sceneID < sceneGraphs_.size());
+  ASSERT(hasSceneGraph(sceneID));
   return (*(sceneGraphs_[sceneID].get()));
 }
 
 const SceneGraph& SceneManager::getSceneGraph(int sceneID) const {
-  ASSERT(sceneID >= 0 && sceneID < sceneGraphs_.size());
+  ASSERT(hasSceneGraph(sceneID));
   return (*(sceneGraphs_[sceneID].get()));
 }
 
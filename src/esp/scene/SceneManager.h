@@ -23,16 +23,29 @@ class SceneManager {
   SceneManager(){};
   ~SceneManager() { LOG(INFO) << "Deconstructing SceneManager"; }
 
-  // returns the scene ID
+  // returns the scene ID; IDs of released scene graphs are reused, lowest
+  // first
   int initSceneGraph();
 
+  // deletes the scene graph and every node and drawable in it, its ID may be
+  // returned by a later initSceneGraph(). Assets the nodes used stay in the
+  // asset cache of their ResourceManager. Returns false if there is no scene
+  // graph sceneID
+  bool releaseSceneGraph(int sceneID);
+
+  // whether sceneID refers to a scene graph that was not released
+  bool hasSceneGraph(int sceneID) const;
+
+  // number of scene graphs that were not released
+  int getNumSceneGraphs() const;
+
   // returns the scene graph
   SceneGraph& getSceneGraph(int sceneID);
   const SceneGraph& getSceneGraph(int sceneID) const;
 
  protected:
   // Each item within is a base node, parent of all in that scene, for easy
-  // manipulation (e.g., rotate the entire scene)
+  // manipulation (e.g., rotate the entire scene). Released slots are null
   std::vector<std::unique_ptr<SceneGraph>> sceneGraphs_;
 
   ESP_SMART_POINTERS(SceneManager)
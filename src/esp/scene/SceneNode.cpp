@@ -4,20 +4,54 @@
 
 #include "SceneNode.h"
 
+#include <Magnum/SceneGraph/AbstractFeature.h>
+
 using namespace Magnum;
 
 namespace esp {
 namespace scene {
 
-SceneNode::SceneNode(SceneNode& parent) {
+// Magnum marks a node and its subtree dirty whenever its transformation or
+// parent changes, and cleaning a node cleans its dirty ancestors first, each
+// once, handing every cached feature its new absolute transformation
+class SceneNode::TransformationCache : public SceneGraph::AbstractFeature3D {
+ public:
+  explicit TransformationCache(SceneNode& node)
+      : SceneGraph::AbstractFeature3D{node} {
+    setCachedTransformations(SceneGraph::CachedTransformation::Absolute);
+  }
+
+  const Matrix4& absoluteTransformation() const {
+    return absoluteTransformation_;
+  }
+
+ protected:
+  void clean(const Matrix4& absoluteTransformationMatrix) override {
+    absoluteTransformation_ = absoluteTransformationMatrix;
+  }
+
+  Matrix4 absoluteTransformation_;
+};
+
+SceneNode::SceneNode(SceneNode& parent)
+    : transformationCache_{new TransformationCache{*this}} {
   setParent(&parent);
   setId(parent.getId());
 }
 
-SceneNode::SceneNode(MagnumScene& parentNode) {
+SceneNode::SceneNode(MagnumScene& parentNode)
+    : transformationCache_{new TransformationCache{*this}} {
   setParent(&parentNode);
 }
 
+Matrix4 SceneNode::absoluteTransformation() const {
+  if (isDirty()) {
+    // the cache is logically const, cleaning only refreshes it
+    const_cast<SceneNode*>(this)->setClean();
+  }
+  return transformationCache_->absoluteTransformation();
+}
+
 SceneNode& SceneNode::createChild() {
   // will set the parent to *this
   SceneNode* node = new SceneNode(*this);
@@ -49,6 +49,11 @@ class SceneNode : public MagnumObject {
   //! Sets node id
   virtual void setId(int id) { id_ = id; }
 
+  //! Transformation relative to the scene, kept until this node or one of
+  //! its ancestors moves so that unchanged nodes are not recomputed. Hides
+  //! Object::absoluteTransformation(), which walks up the parents every time
+  Magnum::Matrix4 absoluteTransformation() const;
+
   Magnum::Vector3 absoluteTranslation() const {
     return this->absoluteTransformation().translation();
   }
@@ -59,6 +64,11 @@ class SceneNode : public MagnumObject {
   friend class SceneGraph;
   SceneNode(MagnumScene& parentNode);
 
+  // feature keeping the absolute transformation while the node is clean,
+  // owned by the node like all of its features
+  class TransformationCache;
+  TransformationCache* transformationCache_;
+
   // the type of the attached object (e.g., sensor, agent etc.)
   SceneNodeType type_ = SceneNodeType::EMPTY;
   int id_ = ID_UNDEFINED;
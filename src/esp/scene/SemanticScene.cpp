@@ -0,0 +1,145 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#include "SemanticScene.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+namespace esp {
+namespace scene {
+
+std::vector<int> SemanticScene::semanticIndexRemap(
+    SemanticIdMapping mapping,
+    const std::string& categoryMapping /* = "" */) const {
+  if (mapping == SemanticIdMapping::Segment || segmentToObjectIndex_.empty()) {
+    return {};
+  }
+  int maxIndex = 0;
+  for (const auto& segment : segmentToObjectIndex_) {
+    maxIndex = std::max(maxIndex, segment.first);
+  }
+
+  std::vector<int> remap(maxIndex + 1, ID_UNDEFINED);
+  for (const auto& segment : segmentToObjectIndex_) {
+    const int objectIndex = segment.second;
+    if (segment.first < 0 || objectIndex < 0 ||
+        objectIndex >= objects_.size()) {
+      continue;
+    }
+    if (mapping == SemanticIdMapping::Object) {
+      remap[segment.first] = objectIndex;
+    } else if (objects_[objectIndex] != nullptr &&
+               objects_[objectIndex]->category() != nullptr) {
+      remap[segment.first] =
+          objects_[objectIndex]->category()->index(categoryMapping);
+    }
+  }
+  return remap;
+}
+
+std::vector<float> SemanticObjectArrays::distances(const vec3f& point) const {
+  std::vector<float> distances(size());
+  for (size_t i = 0; i < distances.size(); ++i) {
+    // the point in the frame of the box, then its distance to the half
+    // extents
+    const vec3f local =
+        Eigen::Map<const quatf>(obbRotation[i].data()).conjugate() *
+        (point - obbCenter[i]);
+    distances[i] = (local.cwiseAbs() - obbHalfExtents[i])
+                       .cwiseMax(vec3f::Zero())
+                       .norm();
+  }
+  return distances;
+}
+
+std::vector<int> SemanticObjectArrays::objectsWithinRadius(
+    const vec3f& point,
+    float radius,
+    int category /* = ID_UNDEFINED */) const {
+  std::vector<int> objects;
+  for (size_t i = 0; i < size(); ++i) {
+    if (category != ID_UNDEFINED && categoryIndex[i] != category) {
+      continue;
+    }
+    // the AABB rejects most objects before the rotation is needed
+    const vec3f outside = (aabbMin[i] - point)
+                              .cwiseMax(point - aabbMax[i])
+                              .cwiseMax(vec3f::Zero());
+    if (outside.squaredNorm() > radius * radius) {
+      continue;
+    }
+    const vec3f local =
+        Eigen::Map<const quatf>(obbRotation[i].data()).conjugate() *
+        (point - obbCenter[i]);
+    if ((local.cwiseAbs() - obbHalfExtents[i])
+            .cwiseMax(vec3f::Zero())
+            .squaredNorm() <= radius * radius) {
+      objects.push_back(i);
+    }
+  }
+  return objects;
+}
+
+std::vector<int> SemanticObjectArrays::objectsOfCategory(int category) const {
+  std::vector<int> objects;
+  for (size_t i = 0; i < size(); ++i) {
+    if (categoryIndex[i] == category) {
+      objects.push_back(i);
+    }
+  }
+  return objects;
+}
+
+std::vector<int> SemanticObjectArrays::objectsInRegion(int region) const {
+  std::vector<int> objects;
+  for (size_t i = 0; i < size(); ++i) {
+    if (regionIndex[i] == region) {
+      objects.push_back(i);
+    }
+  }
+  return objects;
+}
+
+SemanticObjectArrays SemanticScene::objectArrays(
+    const std::string& categoryMapping /* = "" */) const {
+  std::unordered_map<const SemanticRegion*, int> regionIndices;
+  for (size_t i = 0; i < regions_.size(); ++i) {
+    regionIndices[regions_[i].get()] = i;
+  }
+
+  SemanticObjectArrays arrays;
+  const size_t numObjects = objects_.size();
+  arrays.categoryIndex.resize(numObjects, ID_UNDEFINED);
+  arrays.regionIndex.resize(numObjects, ID_UNDEFINED);
+  arrays.obbCenter.resize(numObjects, vec3f::Zero());
+  arrays.obbHalfExtents.resize(numObjects, vec3f::Zero());
+  arrays.obbRotation.resize(numObjects, quatf::Identity().coeffs());
+  arrays.aabbMin.resize(numObjects, vec3f::Zero());
+  arrays.aabbMax.resize(numObjects, vec3f::Zero());
+  for (size_t i = 0; i < numObjects; ++i) {
+    const SemanticObject* object = objects_[i].get();
+    if (object == nullptr) {
+      continue;
+    }
+    if (object->category() != nullptr) {
+      arrays.categoryIndex[i] = object->category()->index(categoryMapping);
+    }
+    auto region = regionIndices.find(object->region().get());
+    if (region != regionIndices.end()) {
+      arrays.regionIndex[i] = region->second;
+    }
+    const geo::OBB& obb = object->obb_;
+    arrays.obbCenter[i] = obb.center();
+    arrays.obbHalfExtents[i] = obb.halfExtents();
+    arrays.obbRotation[i] = obb.rotation().coeffs();
+    const box3f aabb = obb.toAABB();
+    arrays.aabbMin[i] = aabb.min();
+    arrays.aabbMax[i] = aabb.max();
+  }
+  return arrays;
+}
+
+}  // namespace scene
+}  // namespace esp
@@ -28,11 +28,56 @@ class SemanticCategory {
   ESP_SMART_POINTERS(SemanticCategory);
 };
 
+//! What the semantic mesh index of a pixel is mapped to in the object id
+//! image of a semantic sensor
+enum class SemanticIdMapping {
+  //! the mesh index as it is
+  Segment,
+  //! the index of the object, semanticIndexToObjectIndex()
+  Object,
+  //! the index of the category of the object
+  Category
+};
+
 // forward declarations
 class SemanticObject;
 class SemanticRegion;
 class SemanticLevel;
 
+//! The objects of a SemanticScene as contiguous arrays, indexed like
+//! SemanticScene::objects(), for queries over many objects at once
+struct SemanticObjectArrays {
+  //! category index of each object under the mapping the arrays were made
+  //! for, ID_UNDEFINED if it has no category
+  std::vector<int> categoryIndex;
+  //! index into SemanticScene::regions() of the region of each object,
+  //! ID_UNDEFINED if it is in none
+  std::vector<int> regionIndex;
+  std::vector<vec3f> obbCenter;
+  std::vector<vec3f> obbHalfExtents;
+  //! OBB rotation coefficients as x, y, z, w
+  std::vector<vec4f> obbRotation;
+  std::vector<vec3f> aabbMin;
+  std::vector<vec3f> aabbMax;
+
+  size_t size() const { return categoryIndex.size(); }
+
+  //! Distance from point to the OBB of each object, 0 inside
+  std::vector<float> distances(const vec3f& point) const;
+
+  //! Indices of the objects of category (any for ID_UNDEFINED) whose OBB is
+  //! within radius of point, in index order
+  std::vector<int> objectsWithinRadius(const vec3f& point,
+                                       float radius,
+                                       int category = ID_UNDEFINED) const;
+
+  //! Indices of the objects of category, in index order
+  std::vector<int> objectsOfCategory(int category) const;
+
+  //! Indices of the objects in region, in index order
+  std::vector<int> objectsInRegion(int region) const;
+};
+
 //! Represents a scene with containing semantically annotated
 //! levels, regions and objects
 class SemanticScene {
@@ -80,12 +125,28 @@ class SemanticScene {
     }
   }
 
-  //! load SemanticScene from a Matterport3D House format filename
+  //! Objects as contiguous arrays, with category indices under
+  //! categoryMapping. A copy: later loads do not change it
+  SemanticObjectArrays objectArrays(
+      const std::string& categoryMapping = "") const;
+
+  //! Table mapping each semantic mesh index to its object or category index
+  //! (under categoryMapping), ID_UNDEFINED where an index is not mapped, for
+  //! applying the mapping on the GPU. Empty for SemanticIdMapping::Segment or
+  //! if the scene has no semantic mesh indices
+  std::vector<int> semanticIndexRemap(
+      SemanticIdMapping mapping,
+      const std::string& categoryMapping = "") const;
+
+  //! load SemanticScene from a Matterport3D House format filename. Objects
+  //! and segments are parsed on up to numThreads threads of the shared
+  //! core::ThreadPool, 0 for all of them
   static bool loadMp3dHouse(
       const std::string& filename,
       SemanticScene& scene,
       const quatf& rotation = quatf::FromTwoVectors(-vec3f::UnitZ(),
-                                                    geo::ESP_GRAVITY));
+                                                    geo::ESP_GRAVITY),
+      int numThreads = 0);
 
   //! load SemanticScene from a SUNCG house format file
   static bool loadSuncgHouse(const std::string& filename,
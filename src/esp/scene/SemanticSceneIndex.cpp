@@ -0,0 +1,183 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#include "SemanticSceneIndex.h"
+
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <utility>
+
+namespace esp {
+namespace scene {
+
+namespace {
+// tolerance of the containment tests, like OBB::contains()
+constexpr float epsilon = 1e-6f;
+}  // namespace
+
+SemanticSceneIndex::SemanticSceneIndex(const SemanticScene& scene) {
+  const SemanticObjectArrays objects = scene.objectArrays();
+  objectCenters_ = objects.obbCenter;
+  objectHalfExtents_ = objects.obbHalfExtents;
+  objectWorldToLocal_.resize(objects.size());
+  objectBoxes_.resize(objects.size());
+  for (size_t i = 0; i < objects.size(); ++i) {
+    objectWorldToLocal_[i] =
+        Eigen::Map<const quatf>(objects.obbRotation[i].data())
+            .toRotationMatrix()
+            .transpose();
+    objectBoxes_[i] = box3f(objects.aabbMin[i], objects.aabbMax[i]);
+  }
+
+  regionBoxes_.reserve(scene.regions().size());
+  for (const auto& region : scene.regions()) {
+    // an empty box for missing regions, which contains nothing
+    regionBoxes_.push_back(region != nullptr ? region->aabb() : box3f());
+  }
+
+  objectTree_.build(objectBoxes_);
+  regionTree_.build(regionBoxes_);
+}
+
+float SemanticSceneIndex::squaredObjectDistance(int object,
+                                                const vec3f& point) const {
+  const vec3f local =
+      objectWorldToLocal_[object] * (point - objectCenters_[object]);
+  return (local.cwiseAbs() - objectHalfExtents_[object])
+      .cwiseMax(vec3f::Zero())
+      .squaredNorm();
+}
+
+std::vector<int> SemanticSceneIndex::regionsContaining(
+    const vec3f& point) const {
+  std::vector<int> regions;
+  const vec3f margin = vec3f::Constant(epsilon);
+  auto contains = [&](const box3f& box) {
+    return box3f(box.min() - margin, box.max() + margin).contains(point);
+  };
+  regionTree_.traverse(contains, [&](int region) {
+    if (contains(regionBoxes_[region])) {
+      regions.push_back(region);
+    }
+    return false;
+  });
+  std::sort(regions.begin(), regions.end(), [&](int a, int b) {
+    const float volumeA = regionBoxes_[a].volume();
+    const float volumeB = regionBoxes_[b].volume();
+    return volumeA < volumeB || (volumeA == volumeB && a < b);
+  });
+  return regions;
+}
+
+int SemanticSceneIndex::regionAt(const vec3f& point) const {
+  const std::vector<int> regions = regionsContaining(point);
+  return regions.empty() ? ID_UNDEFINED : regions[0];
+}
+
+std::vector<int> SemanticSceneIndex::objectsContaining(
+    const vec3f& point) const {
+  std::vector<int> objects;
+  const vec3f margin = vec3f::Constant(epsilon);
+  objectTree_.traverse(
+      [&](const box3f& box) {
+        return box3f(box.min() - margin, box.max() + margin).contains(point);
+      },
+      [&](int object) {
+        if (squaredObjectDistance(object, point) <= epsilon * epsilon) {
+          objects.push_back(object);
+        }
+        return false;
+      });
+  std::sort(objects.begin(), objects.end());
+  return objects;
+}
+
+std::vector<int> SemanticSceneIndex::nearestObjects(
+    const vec3f& point,
+    int k,
+    float maxDistance /* = inf */) const {
+  if (k <= 0 || objectTree_.empty()) {
+    return {};
+  }
+  // nodes by the squared distance of their box, nearest first, and the k
+  // nearest objects so far as a max heap
+  using Entry = std::pair<float, int>;
+  std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> nodes;
+  std::priority_queue<Entry> nearest;
+  float bound = maxDistance * maxDistance;
+  const std::vector<geo::BVH::Node>& treeNodes = objectTree_.nodes();
+  nodes.emplace(treeNodes[0].box.squaredExteriorDistance(point), 0);
+  while (!nodes.empty() && nodes.top().first <= bound) {
+    const int index = nodes.top().second;
+    nodes.pop();
+    const geo::BVH::Node& node = treeNodes[index];
+    if (node.count == 0) {
+      for (int child : {index + 1, node.second}) {
+        const float distance =
+            treeNodes[child].box.squaredExteriorDistance(point);
+        if (distance <= bound) {
+          nodes.emplace(distance, child);
+        }
+      }
+      continue;
+    }
+    for (int i = node.first; i < node.first + node.count; ++i) {
+      const int object = objectTree_.items()[i];
+      const float distance = squaredObjectDistance(object, point);
+      if (distance > bound) {
+        continue;
+      }
+      nearest.emplace(distance, object);
+      if (nearest.size() > static_cast<size_t>(k)) {
+        nearest.pop();
+      }
+      if (nearest.size() == static_cast<size_t>(k)) {
+        bound = nearest.top().first;
+      }
+    }
+  }
+
+  std::vector<int> objects(nearest.size());
+  for (int i = objects.size() - 1; i >= 0; --i) {
+    objects[i] = nearest.top().second;
+    nearest.pop();
+  }
+  return objects;
+}
+
+SemanticRayHit SemanticSceneIndex::pickObject(
+    const vec3f& origin,
+    const vec3f& direction,
+    float maxDistance /* = inf */) const {
+  SemanticRayHit hit;
+  const vec3f inverseDirection = direction.cwiseInverse();
+  float best = maxDistance;
+  float near;
+  objectTree_.traverse(
+      [&](const box3f& box) {
+        return geo::intersectRayBox(box, origin, inverseDirection, best, near);
+      },
+      [&](int object) {
+        // the ray in the frame of the box, where it is axis aligned
+        const mat3f& worldToLocal = objectWorldToLocal_[object];
+        const vec3f localOrigin =
+            worldToLocal * (origin - objectCenters_[object]);
+        const vec3f localDirection = worldToLocal * direction;
+        const vec3f& halfExtents = objectHalfExtents_[object];
+        if (geo::intersectRayBox(box3f(-halfExtents, halfExtents),
+                                 localOrigin, localDirection.cwiseInverse(),
+                                 best, near) &&
+            (near < best || hit.objectIndex == ID_UNDEFINED)) {
+          best = near;
+          hit.objectIndex = object;
+          hit.distance = near;
+        }
+        return false;
+      });
+  return hit;
+}
+
+}  // namespace scene
+}  // namespace esp
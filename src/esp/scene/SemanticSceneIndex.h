@@ -0,0 +1,76 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#pragma once
+
+#include <limits>
+#include <vector>
+
+#include "esp/core/esp.h"
+#include "esp/geo/BVH.h"
+#include "esp/scene/SemanticScene.h"
+
+namespace esp {
+namespace scene {
+
+//! Object a ray hits first
+struct SemanticRayHit {
+  //! index into SemanticScene::objects(), ID_UNDEFINED if the ray hits none
+  int objectIndex = ID_UNDEFINED;
+  //! distance along the ray, in units of the ray direction
+  float distance = std::numeric_limits<float>::infinity();
+};
+
+// Bounding volume hierarchies over the object OBBs and region AABBs of a
+// SemanticScene for point, nearest neighbor and ray queries. Indices refer to
+// SemanticScene::objects() and regions() at the time the index was built; the
+// index does not follow later loads into the scene.
+class SemanticSceneIndex {
+ public:
+  explicit SemanticSceneIndex(const SemanticScene& scene);
+
+  //! Regions whose AABB contains point, the smallest first
+  std::vector<int> regionsContaining(const vec3f& point) const;
+
+  //! Smallest region containing point, ID_UNDEFINED if none does
+  int regionAt(const vec3f& point) const;
+
+  //! Objects whose OBB contains point, in index order
+  std::vector<int> objectsContaining(const vec3f& point) const;
+
+  //! Up to k objects nearest to point by distance to their OBB, nearest
+  //! first, ignoring those farther than maxDistance
+  std::vector<int> nearestObjects(
+      const vec3f& point,
+      int k,
+      float maxDistance = std::numeric_limits<float>::infinity()) const;
+
+  //! First object OBB hit by the ray origin + t * direction for t in
+  //! [0, maxDistance]; a ray starting inside an OBB hits it at 0
+  SemanticRayHit pickObject(
+      const vec3f& origin,
+      const vec3f& direction,
+      float maxDistance = std::numeric_limits<float>::infinity()) const;
+
+  int getNumObjects() const { return objectBoxes_.size(); }
+  int getNumRegions() const { return regionBoxes_.size(); }
+
+ protected:
+  //! squared distance from point to the OBB of object
+  float squaredObjectDistance(int object, const vec3f& point) const;
+
+  // object OBBs as center, half extents and the world to box rotation
+  std::vector<vec3f> objectCenters_;
+  std::vector<vec3f> objectHalfExtents_;
+  std::vector<mat3f> objectWorldToLocal_;
+  std::vector<box3f> objectBoxes_;
+  std::vector<box3f> regionBoxes_;
+  geo::BVH objectTree_;
+  geo::BVH regionTree_;
+
+  ESP_SMART_POINTERS(SemanticSceneIndex)
+};
+
+}  // namespace scene
+}  // namespace esp
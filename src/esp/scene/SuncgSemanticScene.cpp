@@ -95,7 +95,12 @@ bool SemanticScene::loadSuncgHouse(
 
   // top-level scene
   VLOG(1) << "Parsing " << houseFilename;
-  const auto& json = io::parseJsonFile(houseFilename);
+  // only the fields read below, skipping materials, transforms and the like
+  const auto& json = io::parseJsonFile(
+      houseFilename,
+      {"id", "levels", "bbox", "min", "max", "nodes", "type", "valid",
+       "roomTypes", "nodeIndices", "hideCeiling", "hideFloor", "hideWalls",
+       "modelId"});
   VLOG(1) << "Parsed.";
   scene.name_ = json["id"].GetString();
   const auto& levels = json["levels"].GetArray();
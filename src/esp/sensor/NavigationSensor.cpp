@@ -0,0 +1,145 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#include "NavigationSensor.h"
+
+#include <cmath>
+#include <limits>
+
+#include <Magnum/EigenIntegration/Integration.h>
+
+#include "esp/gfx/Simulator.h"
+#include "esp/nav/PathFinder.h"
+
+namespace Mn = Magnum;
+using Magnum::EigenIntegration::cast;
+
+namespace esp {
+namespace sensor {
+
+NavigationSensor::NavigationSensor(scene::SceneNode& navigationSensorNode,
+                                   SensorSpec::ptr spec)
+    : Sensor(navigationSensorNode, spec) {
+  ASSERT(isNavigation(*spec_));
+}
+
+NavigationSensor::~NavigationSensor() {
+  unregisterGoal();
+}
+
+int NavigationSensor::observationSize(const SensorSpec& spec) {
+  switch (spec.sensorType) {
+    case SensorType::GOAL:
+      return 2;
+    case SensorType::PATH:
+      return 1;
+    case SensorType::TENSOR:
+      if (spec.sensorSubtype == "gps") {
+        return 2;
+      }
+      if (spec.sensorSubtype == "compass") {
+        return 1;
+      }
+      return 0;
+    default:
+      return 0;
+  }
+}
+
+bool NavigationSensor::isNavigation(const SensorSpec& spec) {
+  return observationSize(spec) > 0;
+}
+
+void NavigationSensor::setGoal(const vec3f& goal) {
+  if (hasGoal_ && goal_ == goal) {
+    return;
+  }
+  unregisterGoal();
+  goal_ = goal;
+  hasGoal_ = true;
+}
+
+void NavigationSensor::unregisterGoal() {
+  if (goalPathFinder_ != nullptr) {
+    goalPathFinder_->unregisterGoalSet(goalSetId_);
+  }
+  goalPathFinder_ = nullptr;
+  goalSetId_ = ID_UNDEFINED;
+}
+
+const scene::SceneNode& NavigationSensor::agentNode() const {
+  const auto* parent = dynamic_cast<const scene::SceneNode*>(node().parent());
+  return parent != nullptr ? *parent : node();
+}
+
+float NavigationSensor::geodesicDistance(gfx::Simulator& sim,
+                                         const vec3f& position) {
+  std::shared_ptr<nav::PathFinder> pathFinder = sim.getPathFinder();
+  if (pathFinder == nullptr || !pathFinder->isLoaded()) {
+    return std::numeric_limits<float>::infinity();
+  }
+  // the set is kept up to date with the navmesh by the PathFinder itself
+  if (goalPathFinder_ != pathFinder) {
+    unregisterGoal();
+    goalSetId_ = pathFinder->registerGoalSet({goal_});
+    goalPathFinder_ = pathFinder;
+  }
+  return pathFinder->distanceToGoalSet(position, goalSetId_);
+}
+
+bool NavigationSensor::getObservationSpace(ObservationSpace& space) {
+  space.spaceType = ObservationSpaceType::TENSOR;
+  space.dataType = core::DataType::DT_FLOAT;
+  space.shape = {static_cast<size_t>(observationSize(*spec_))};
+  return true;
+}
+
+bool NavigationSensor::getObservation(gfx::Simulator& sim, Observation& obs) {
+  const SensorType type = spec_->sensorType;
+  if ((type == SensorType::GOAL || type == SensorType::PATH) && !hasGoal_) {
+    return false;
+  }
+  if (buffer_ == nullptr) {
+    ObservationSpace space;
+    getObservationSpace(space);
+    buffer_ = core::Buffer::create(space.shape, space.dataType);
+  }
+  obs.buffer = buffer_;
+  float* data = reinterpret_cast<float*>(buffer_->data);
+
+  const Mn::Matrix4 pose = agentNode().absoluteTransformation();
+  if (!episodeStarted_) {
+    episodeStartInverse_ = pose.invertedRigid();
+    episodeStarted_ = true;
+  }
+  switch (type) {
+    case SensorType::GOAL: {
+      // forward is -Z, left is -X
+      const Mn::Vector3 goal =
+          pose.invertedRigid().transformPoint(Mn::Vector3(goal_));
+      data[0] = std::sqrt(goal.x() * goal.x() + goal.z() * goal.z());
+      data[1] = std::atan2(-goal.x(), -goal.z());
+      break;
+    }
+    case SensorType::PATH:
+      data[0] = geodesicDistance(sim, cast<vec3f>(pose.translation()));
+      break;
+    default:
+      if (spec_->sensorSubtype == "gps") {
+        const Mn::Vector3 position =
+            episodeStartInverse_.transformPoint(pose.translation());
+        data[0] = -position.z();
+        data[1] = position.x();
+      } else {
+        const Mn::Vector3 forward = episodeStartInverse_.transformVector(
+            pose.transformVector(-Mn::Vector3::zAxis()));
+        data[0] = std::atan2(-forward.x(), -forward.z());
+      }
+      break;
+  }
+  return true;
+}
+
+}  // namespace sensor
+}  // namespace esp
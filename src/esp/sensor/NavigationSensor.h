@@ -0,0 +1,86 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#pragma once
+
+#include <Magnum/Math/Matrix4.h>
+
+#include "Sensor.h"
+#include "esp/core/esp.h"
+
+namespace esp {
+namespace nav {
+class PathFinder;
+}
+namespace sensor {
+
+// Non-visual sensors of the pose of the agent relative to its episode and
+// goal, in float tensors, so that the task features of navigation are
+// computed in C++ together with the rendered observations. The pose is the
+// one of the node the sensor is attached to the agent through, i.e. of the
+// agent body, so the position and orientation of the spec do not matter.
+// The type of the spec selects the observation:
+//  - GOAL: point goal {distance, angle} to the goal in the ground plane of
+//    the agent, angle in radians counterclockwise from its forward
+//  - PATH: {geodesic distance} over the navmesh of the simulator to the
+//    goal, infinity if it cannot be reached. The goal is registered as a goal
+//    set of the nav::PathFinder once, so a step costs a lookup in its
+//    distance field rather than a path search
+//  - TENSOR, sensorSubtype "gps": {forward, right} position of the agent in
+//    the frame of its pose at the start of the episode
+//  - TENSOR, sensorSubtype "compass": {heading} of the agent in radians
+//    counterclockwise from its heading at the start of the episode
+// GOAL and PATH sensors produce no observation until setGoal() is called.
+class NavigationSensor : public Sensor {
+ public:
+  explicit NavigationSensor(scene::SceneNode& navigationSensorNode,
+                            SensorSpec::ptr spec);
+
+  virtual ~NavigationSensor();
+
+  //! true if spec asks for a navigation sensor rather than a visual one
+  static bool isNavigation(const SensorSpec& spec);
+
+  //! the goal of the episode, in world coordinates
+  void setGoal(const vec3f& goal);
+
+  bool hasGoal() const { return hasGoal_; }
+  vec3f getGoal() const { return goal_; }
+
+  //! start a new episode, whose start pose is the one of the agent at the
+  //! next observation
+  void resetEpisode() { episodeStarted_ = false; }
+
+  virtual bool getObservation(gfx::Simulator& sim, Observation& obs) override;
+  virtual bool getObservationSpace(ObservationSpace& space) override;
+
+ protected:
+  // number of floats of an observation of spec, 0 for no navigation sensor
+  static int observationSize(const SensorSpec& spec);
+
+  // node of the agent the sensor is attached to
+  const scene::SceneNode& agentNode() const;
+
+  // geodesic distance from position to the goal on the navmesh of sim,
+  // registering the goal with its PathFinder first if needed
+  float geodesicDistance(gfx::Simulator& sim, const vec3f& position);
+
+  // drop the goal set of the goal from the PathFinder it is registered with
+  void unregisterGoal();
+
+  vec3f goal_;
+  bool hasGoal_ = false;
+  // inverse of the pose of the agent at the start of the episode
+  bool episodeStarted_ = false;
+  Magnum::Matrix4 episodeStartInverse_;
+
+  // the PathFinder the goal is registered with, and the id of its set
+  std::shared_ptr<nav::PathFinder> goalPathFinder_;
+  int goalSetId_ = ID_UNDEFINED;
+
+  ESP_SMART_POINTERS(NavigationSensor)
+};
+
+}  // namespace sensor
+}  // namespace esp
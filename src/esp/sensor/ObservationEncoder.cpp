@@ -0,0 +1,179 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#include "ObservationEncoder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "esp/core/Arena.h"
+#include "esp/core/Compression.h"
+#include "esp/sensor/Sensor.h"
+
+namespace esp {
+namespace sensor {
+
+namespace {
+const std::string lz4Suffix = "+lz4";
+}  // namespace
+
+bool ObservationEncoder::hasCodec(const std::string& encoding) {
+  return encoding.size() > lz4Suffix.size() &&
+         encoding.compare(encoding.size() - lz4Suffix.size(),
+                          lz4Suffix.size(), lz4Suffix) == 0;
+}
+
+ObservationEncoder::ptr ObservationEncoder::fromSpec(const SensorSpec& spec) {
+  if (!hasCodec(spec.encoding)) {
+    return nullptr;
+  }
+  if (spec.resolution[0] <= 0 || spec.resolution[1] <= 0 ||
+      spec.channels <= 0) {
+    LOG(ERROR) << "Cannot encode observations of sensor " << spec.uuid
+               << ": it has no pixels";
+    return nullptr;
+  }
+  ObservationEncoder::ptr encoder = ObservationEncoder::create();
+  encoder->encoding_ = spec.encoding;
+  ObservationSpace space;
+  getVisualObservationSpace(spec, space);
+  encoder->shape_ = space.shape;
+  encoder->dataType_ = space.dataType;
+  if (space.dataType == core::DataType::DT_FLOAT) {
+    encoder->quantizeDepth_ = true;
+    auto step = spec.parameters.find("depth_quantization");
+    if (step != spec.parameters.end()) {
+      encoder->depthStep_ = std::stof(step->second);
+    }
+    if (!(encoder->depthStep_ > 0.0f)) {
+      LOG(ERROR) << "Invalid depth_quantization " << encoder->depthStep_
+                 << " of sensor " << spec.uuid;
+      return nullptr;
+    }
+  }
+  // depth in millimeters is delta coded as numbers, like quantized depth
+  encoder->deltaUint16_ = encoder->quantizeDepth_ ||
+                          space.dataType == core::DataType::DT_UINT16;
+  const size_t elementBytes =
+      encoder->quantizeDepth_ ? sizeof(uint16_t)
+                              : core::getDataTypeByteSize(encoder->dataType_);
+  encoder->pixelBytes_ = encoder->shape_[2] * elementBytes;
+  encoder->rowBytes_ = encoder->shape_[1] * encoder->pixelBytes_;
+  encoder->numPixels_ = encoder->shape_[0] * encoder->shape_[1];
+  return encoder;
+}
+
+bool ObservationEncoder::encode(const core::Buffer& observation,
+                                core::Buffer& encoded) const {
+  if (observation.shape != shape_ || observation.dataType != dataType_) {
+    LOG(ERROR) << "Cannot encode an observation of another shape or data type "
+                  "than its sensor";
+    return false;
+  }
+  core::ArenaScope scope;
+  const size_t filteredBytes = shape_[0] * rowBytes_;
+  uint8_t* filtered = static_cast<uint8_t*>(
+      core::Arena::threadLocal().allocate(filteredBytes));
+
+  if (deltaUint16_) {
+    // store each depth as the difference to the one to its left, which is
+    // small across the smooth surfaces of a depth image
+    uint16_t* out = reinterpret_cast<uint16_t*>(filtered);
+    const size_t rowSize = rowBytes_ / sizeof(uint16_t);
+    const size_t stride = shape_[2];
+    if (quantizeDepth_) {
+      const float* depth = static_cast<const float*>(observation.data);
+      const float scale = 1.0f / depthStep_;
+      for (size_t i = 0; i < numPixels_ * stride; ++i) {
+        const float steps = depth[i] * scale + 0.5f;
+        out[i] = std::isfinite(steps) && steps > 0.5f
+                     ? uint16_t(std::min(steps, 65535.0f))
+                     : 0;
+      }
+    } else {
+      std::memcpy(out, observation.data, filteredBytes);
+    }
+    for (size_t row = 0; row < shape_[0]; ++row) {
+      uint16_t* values = out + row * rowSize;
+      for (size_t i = rowSize - 1; i >= stride; --i) {
+        values[i] -= values[i - stride];
+      }
+    }
+  } else {
+    // the PNG "sub" filter: each byte minus the same byte of the pixel to
+    // its left
+    const uint8_t* in = static_cast<const uint8_t*>(observation.data);
+    for (size_t row = 0; row < shape_[0]; ++row) {
+      const uint8_t* src = in + row * rowBytes_;
+      uint8_t* dst = filtered + row * rowBytes_;
+      std::memcpy(dst, src, pixelBytes_);
+      for (size_t i = pixelBytes_; i < rowBytes_; ++i) {
+        dst[i] = src[i] - src[i - pixelBytes_];
+      }
+    }
+  }
+
+  // allocates only the first time, later resizes stay within the capacity
+  const size_t bound = core::lz4CompressBound(filteredBytes);
+  if (!encoded.resize({bound}, core::DataType::DT_UINT8)) {
+    return false;
+  }
+  const size_t encodedBytes =
+      core::lz4Compress(filtered, filteredBytes, encoded.data, bound);
+  encoded.resize({encodedBytes}, core::DataType::DT_UINT8);
+  return encodedBytes > 0;
+}
+
+bool ObservationEncoder::decode(const void* encoded,
+                                size_t encodedBytes,
+                                core::Buffer& observation) const {
+  if (!observation.resize(shape_, dataType_)) {
+    return false;
+  }
+  if (!deltaUint16_) {
+    uint8_t* out = static_cast<uint8_t*>(observation.data);
+    if (!core::lz4Decompress(encoded, encodedBytes, out,
+                             observation.totalBytes)) {
+      return false;
+    }
+    for (size_t row = 0; row < shape_[0]; ++row) {
+      uint8_t* values = out + row * rowBytes_;
+      for (size_t i = pixelBytes_; i < rowBytes_; ++i) {
+        values[i] += values[i - pixelBytes_];
+      }
+    }
+    return true;
+  }
+
+  // quantized depth is restored from scratch, millimeters in place
+  core::ArenaScope scope;
+  const size_t filteredBytes = shape_[0] * rowBytes_;
+  uint16_t* values = static_cast<uint16_t*>(observation.data);
+  if (quantizeDepth_) {
+    values = static_cast<uint16_t*>(
+        core::Arena::threadLocal().allocate(filteredBytes, alignof(uint16_t)));
+  }
+  if (!core::lz4Decompress(encoded, encodedBytes, values, filteredBytes)) {
+    return false;
+  }
+  const size_t rowSize = rowBytes_ / sizeof(uint16_t);
+  const size_t stride = shape_[2];
+  for (size_t row = 0; row < shape_[0]; ++row) {
+    uint16_t* rowValues = values + row * rowSize;
+    for (size_t i = stride; i < rowSize; ++i) {
+      rowValues[i] += rowValues[i - stride];
+    }
+  }
+  if (quantizeDepth_) {
+    float* depth = static_cast<float*>(observation.data);
+    for (size_t i = 0; i < numPixels_ * stride; ++i) {
+      depth[i] = values[i] * depthStep_;
+    }
+  }
+  return true;
+}
+
+}  // namespace sensor
+}  // namespace esp
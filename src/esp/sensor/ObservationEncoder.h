@@ -0,0 +1,73 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#pragma once
+
+#include "esp/core/esp.h"
+
+#include "esp/core/Buffer.h"
+
+namespace esp {
+namespace sensor {
+
+struct SensorSpec;
+
+// Compression of observations after rendering, for shipping them to other
+// nodes. It is enabled by a codec suffix on SensorSpec::encoding, e.g.
+// "rgba_uint8+lz4":
+//   - observations are delta coded along their rows, each channel from the
+//     pixel to its left, and compressed with LZ4; bytewise, except for
+//     16-bit depth in millimeters, which is delta coded as numbers
+//   - float depth observations are quantized to 16 bits in steps of the
+//     sensor parameter "depth_quantization" (meters, 0.001 by default)
+//     first, saturating at the largest step; depths of 0 or less, or not
+//     finite, are stored as 0
+// The encoded bytes are the LZ4 block only. The receiving end decodes them
+// with an encoder made from the same spec
+class ObservationEncoder {
+ public:
+  //! Encoder of the codec of spec, nullptr if its encoding has none
+  static std::shared_ptr<ObservationEncoder> fromSpec(const SensorSpec& spec);
+
+  //! Whether encoding has a codec suffix, see fromSpec()
+  static bool hasCodec(const std::string& encoding);
+
+  //! Compress observation into encoded, which keeps its allocation across
+  //! calls once it is large enough. Returns false if observation is not of
+  //! the shape and data type of the spec. Thread safe
+  bool encode(const core::Buffer& observation, core::Buffer& encoded) const;
+
+  //! Restore the observation of encoded bytes into observation, which is
+  //! resized to the shape and data type of the spec. Depths come back at the
+  //! precision of the quantization step. Returns false for corrupted data
+  bool decode(const void* encoded,
+              size_t encodedBytes,
+              core::Buffer& observation) const;
+
+  //! Shape and data type of the observations encoded
+  const std::vector<size_t>& getShape() const { return shape_; }
+  core::DataType getDataType() const { return dataType_; }
+
+  //! The encoding of the spec this was made from
+  const std::string& getEncoding() const { return encoding_; }
+
+  ESP_SMART_POINTERS(ObservationEncoder)
+
+ protected:
+  std::string encoding_;
+  std::vector<size_t> shape_;
+  core::DataType dataType_ = core::DataType::DT_UINT8;
+  // bytes of a pixel, and of the pixels of a row
+  size_t pixelBytes_ = 0;
+  size_t rowBytes_ = 0;
+  size_t numPixels_ = 0;
+  // float depth is quantized to uint16 in steps of depthStep_ meters, and
+  // uint16 values are delta coded as numbers rather than bytes
+  bool quantizeDepth_ = false;
+  bool deltaUint16_ = false;
+  float depthStep_ = 0.001f;
+};
+
+}  // namespace sensor
+}  // namespace esp
@@ -0,0 +1,60 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#include "PanoramicSensor.h"
+
+#include <algorithm>
+
+#include "esp/gfx/Simulator.h"
+
+namespace esp {
+namespace sensor {
+
+PanoramicSensor::PanoramicSensor(scene::SceneNode& panoramicSensorNode,
+                                 sensor::SensorSpec::ptr spec)
+    : PinholeCamera(panoramicSensorNode, spec) {
+  ASSERT(isPanoramic(*spec_));
+  if (spec_->sensorSubtype == "cubemap") {
+    projection_ = gfx::PanoramaProjection::CubeMap;
+    faceSize_ = height_;
+    if (width_ != 6 * faceSize_) {
+      LOG(ERROR) << "Cube map sensor " << spec_->uuid
+                 << " needs a resolution of {faceSize, 6 * faceSize}, got {"
+                 << height_ << ", " << width_ << "}";
+    }
+    ASSERT(width_ == 6 * faceSize_);
+  } else {
+    projection_ = gfx::PanoramaProjection::Equirectangular;
+    auto faceSize = spec_->parameters.find("face_size");
+    faceSize_ = faceSize != spec_->parameters.end()
+                    ? std::atoi(faceSize->second.c_str())
+                    : std::max(1, width_ / 4);
+    ASSERT(faceSize_ > 0);
+  }
+  // the faces are drawn with a 90 degree square projection
+  cacheProjection({faceSize_, faceSize_}, 90.0f);
+}
+
+bool PanoramicSensor::isPanoramic(const SensorSpec& spec) {
+  return spec.sensorSubtype == "equirect" || spec.sensorSubtype == "cubemap";
+}
+
+bool PanoramicSensor::getObservation(gfx::Simulator& sim, Observation& obs) {
+  prepareObservationBuffer(obs);
+
+  std::shared_ptr<gfx::Renderer> renderer = sim.getRenderer();
+  vec3i resolution = renderer->getSize();
+  if (resolution[0] != width_ || resolution[1] != height_) {
+    renderer->setSize(width_, height_);
+  }
+  renderer->drawPanorama(*this, observedSceneGraph(sim), faceSize_,
+                         projection_);
+  applyNoise(*renderer);
+
+  renderer->readFrame(gfx::getFrameFormat(*spec_), buffer_->data);
+  return true;
+}
+
+}  // namespace sensor
+}  // namespace esp
@@ -0,0 +1,64 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#pragma once
+
+#include "PinholeCamera.h"
+#include "esp/core/esp.h"
+#include "esp/gfx/Renderer.h"
+
+namespace esp {
+namespace sensor {
+
+// Observes the full sphere around its node in a single observation, rather
+// than through six pinhole sensors. The sensorSubtype of the spec selects
+// the layout of the observation:
+//  - "equirect": equirectangular panorama of spec resolution, drawn from
+//    faces of parameters "face_size" pixels (default a quarter of the width,
+//    which is where the equator has as many pixels as the panorama), depth
+//    is the distance along the ray
+//  - "cubemap": the six faces side by side (front, right, back, left, up,
+//    down), spec resolution has to be {faceSize, 6 * faceSize}
+// parameters "near" and "far" are as for PinholeCamera, "hfov" is ignored
+class PanoramicSensor : public PinholeCamera {
+ public:
+  explicit PanoramicSensor(scene::SceneNode& panoramicSensorNode,
+                           SensorSpec::ptr spec);
+
+  virtual ~PanoramicSensor() {}
+
+  //! true if spec asks for a panoramic sensor rather than a pinhole camera
+  static bool isPanoramic(const SensorSpec& spec);
+
+  gfx::PanoramaProjection getProjection() const { return projection_; }
+
+  //! width and height of the faces in pixels
+  int getFaceSize() const { return faceSize_; }
+
+  virtual bool getObservation(gfx::Simulator& sim, Observation& obs) override;
+
+  // panoramas are drawn by gfx::Renderer::drawPanorama, not in batches
+  virtual scene::SceneGraph* getObservedSceneGraph(
+      gfx::Simulator& sim) override {
+    return nullptr;
+  }
+  virtual bool readBatchObservation(gfx::Simulator& sim,
+                                    int batchIndex,
+                                    Observation& obs) override {
+    return false;
+  }
+  virtual int readBatchObservationAsync(gfx::Simulator& sim,
+                                        int batchIndex) override {
+    return ID_UNDEFINED;
+  }
+
+ protected:
+  gfx::PanoramaProjection projection_;
+  int faceSize_;
+
+  ESP_SMART_POINTERS(PanoramicSensor)
+};
+
+}  // namespace sensor
+}  // namespace esp
@@ -3,6 +3,7 @@
 // LICENSE file in the root directory of this source tree.
 
 #include "PinholeCamera.h"
+#include "esp/gfx/DepthUnprojection.h"
 #include "esp/gfx/Renderer.h"
 #include "esp/gfx/Simulator.h"
 
@@ -22,64 +23,157 @@ void PinholeCamera::setProjectionParameters(SensorSpec::ptr spec) {
   near_ = std::atof(spec_->parameters.at("near").c_str());
   far_ = std::atof(spec_->parameters.at("far").c_str());
   hfov_ = std::atof(spec_->parameters.at("hfov").c_str());
+  supersampling_ = 1;
+  if (spec_->sensorType == SensorType::COLOR) {
+    const int factor = spec_->supersampling;
+    if (factor >= 1 && (factor & (factor - 1)) == 0) {
+      supersampling_ = factor;
+    } else {
+      LOG(ERROR) << "Supersampling of sensor " << spec_->uuid << " is "
+                 << factor << ", not a power of two; rendering without it";
+    }
+  }
+  noise_ = gfx::getSensorNoiseModel(*spec_);
+  // FNV-1a
+  uint64_t uuidHash = 14695981039346656037ull;
+  for (const char c : spec_->uuid) {
+    uuidHash = (uuidHash ^ uint8_t(c)) * 1099511628211ull;
+  }
+  noiseRandom_ = core::Random(noise_.seed).split(uuidHash);
+  cacheProjection({width_, height_}, hfov_);
+  frameValid_ = false;
+}
+
+void PinholeCamera::cacheProjection(const Magnum::Vector2i& size,
+                                    float hfov) {
+  projectionSize_ = size;
+  projectionMatrix_ = Magnum::Matrix4::perspectiveProjection(
+      Magnum::Deg{hfov}, static_cast<float>(size.x()) / size.y(), near_, far_);
+  depthUnprojection_ = gfx::calculateDepthUnprojection(projectionMatrix_);
 }
 
 void PinholeCamera::setProjectionMatrix(gfx::RenderCamera& targetCamera) {
-  targetCamera.setProjectionMatrix(width_, height_, near_, far_, hfov_);
+  targetCamera.setProjection(projectionMatrix_, projectionSize_,
+                             depthUnprojection_);
 }
 
 bool PinholeCamera::getObservationSpace(ObservationSpace& space) {
-  space.spaceType = ObservationSpaceType::TENSOR;
-  space.shape = {static_cast<size_t>(spec_->resolution[0]),
-                 static_cast<size_t>(spec_->resolution[1]),
-                 static_cast<size_t>(spec_->channels)};
-  space.dataType = core::DataType::DT_UINT8;
-  if (spec_->sensorType == SensorType::SEMANTIC) {
-    space.dataType = core::DataType::DT_UINT32;
-  } else if (spec_->sensorType == SensorType::DEPTH) {
-    space.dataType = core::DataType::DT_FLOAT;
-  }
+  getVisualObservationSpace(*spec_, space);
   return true;
 }
 
-bool PinholeCamera::getObservation(gfx::Simulator& sim, Observation& obs) {
-  // TODO: check if sensor is valid?
-  // TODO: have different classes for the different types of sensors
-
-  // Make sure we have memory
+void PinholeCamera::prepareObservationBuffer(Observation& obs) {
+  // Make sure we have memory, and reuse it if the sensor was resized
+  ObservationSpace space;
+  getObservationSpace(space);
   if (buffer_ == nullptr) {
-    // TODO: check if our sensor was resized and resize our buffer if needed
-    ObservationSpace space;
-    getObservationSpace(space);
     buffer_ = core::Buffer::create(space.shape, space.dataType);
+  } else if (buffer_->shape != space.shape ||
+             buffer_->dataType != space.dataType) {
+    if (!buffer_->resize(space.shape, space.dataType)) {
+      LOG(WARNING) << "Observation buffer of sensor " << spec_->uuid
+                   << " is too small for its resolution, allocating one";
+      buffer_ = core::Buffer::create(space.shape, space.dataType);
+    }
   }
   obs.buffer = buffer_;
+}
+
+scene::SceneGraph& PinholeCamera::observedSceneGraph(gfx::Simulator& sim) {
+  if (spec_->sensorType == SensorType::SEMANTIC) {
+    // TODO: check sim has semantic scene graph
+    return sim.getActiveSemanticSceneGraph();
+  }
+  // SensorType is DEPTH or any other type
+  return sim.getActiveSceneGraph();
+}
+
+scene::SceneGraph* PinholeCamera::getObservedSceneGraph(gfx::Simulator& sim) {
+  if (noise_.type != gfx::SensorNoiseType::None) {
+    return nullptr;
+  }
+  return &observedSceneGraph(sim);
+}
+
+void PinholeCamera::applyNoise(gfx::Renderer& renderer) {
+  if (noise_.type != gfx::SensorNoiseType::None) {
+    renderer.applySensorNoise(noise_, noiseRandom_.uniform_uint());
+  }
+}
+
+bool PinholeCamera::getObservation(gfx::Simulator& sim, Observation& obs) {
+  // TODO: check if sensor is valid?
+  // TODO: have different classes for the different types of sensors
+  prepareObservationBuffer(obs);
 
   // TODO: Get appropriate render with correct resolution
   std::shared_ptr<gfx::Renderer> renderer = sim.getRenderer();
   vec3i resolution = renderer->getSize();
-  if (resolution[0] != width_ || resolution[1] != height_) {
-    renderer->setSize(width_, height_);
+  const int width = supersampling_ * width_;
+  const int height = supersampling_ * height_;
+  if (resolution[0] != width || resolution[1] != height) {
+    renderer->setSize(width, height);
   }
-  if (spec_->sensorType == SensorType::SEMANTIC) {
-    // TODO: check sim has semantic scene graph
-    renderer->draw(*this, sim.getActiveSemanticSceneGraph());
-  } else {
-    // SensorType is DEPTH or any other type
-    renderer->draw(*this, sim.getActiveSceneGraph());
+  scene::SceneGraph& sceneGraph = observedSceneGraph(sim);
+  // a frame with noise is never the same
+  const bool frameReuse =
+      spec_->frameReuse && noise_.type == gfx::SensorNoiseType::None;
+  if (frameReuse) {
+    const Magnum::Matrix4 transformation =
+        node().absoluteTransformationMatrix();
+    const uint64_t revision = renderer->getDrawablesRevision(sceneGraph);
+    if (frameValid_ && frameRenderer_ == renderer.get() &&
+        frameSceneGraph_ == &sceneGraph && frameData_ == buffer_->data &&
+        frameRevision_ == revision && frameTransformation_ == transformation) {
+      return true;
+    }
+    frameRenderer_ = renderer.get();
+    frameSceneGraph_ = &sceneGraph;
+    frameData_ = buffer_->data;
+    frameTransformation_ = transformation;
+    frameRevision_ = revision;
   }
+  frameValid_ = frameReuse;
+  renderer->draw(*this, sceneGraph);
+  applyNoise(*renderer);
 
-  // TODO: have different classes for the different types of sensors
   // TODO: do we need to flip axis?
-  if (spec_->sensorType == SensorType::SEMANTIC) {
-    renderer->readFrameObjectId((uint32_t*)buffer_->data);
-  } else if (spec_->sensorType == SensorType::DEPTH) {
-    renderer->readFrameDepth((float*)buffer_->data);
+  // the GPU converts the frame to the format of the spec as it is read
+  const gfx::FrameFormat format = gfx::getFrameFormat(*spec_);
+  if (supersampling_ > 1) {
+    renderer->readFrameDownsampled(supersampling_, format, buffer_->data);
   } else {
-    renderer->readFrameRgba((uint8_t*)buffer_->data);
+    renderer->readFrame(format, buffer_->data);
   }
   return true;
 }
 
+bool PinholeCamera::readBatchObservation(gfx::Simulator& sim,
+                                         int batchIndex,
+                                         Observation& obs) {
+  prepareObservationBuffer(obs);
+  frameValid_ = false;
+
+  sim.getRenderer()->readBatchFrame(batchIndex, gfx::getFrameFormat(*spec_),
+                                    buffer_->data);
+  return true;
+}
+
+int PinholeCamera::readBatchObservationAsync(gfx::Simulator& sim,
+                                             int batchIndex) {
+  frameValid_ = false;
+  return sim.getRenderer()->readBatchFrameAsync(batchIndex,
+                                                gfx::getFrameFormat(*spec_));
+}
+
+bool PinholeCamera::waitBatchObservation(gfx::Simulator& sim,
+                                         int ticket,
+                                         Observation& obs) {
+  prepareObservationBuffer(obs);
+  // the frame of the buffer is no longer the one frame reuse compares with
+  frameValid_ = false;
+  return sim.getRenderer()->waitFrame(ticket, buffer_->data);
+}
+
 }  // namespace sensor
 }  // namespace esp
@@ -6,8 +6,13 @@
 
 #include "Sensor.h"
 #include "esp/core/esp.h"
+#include "esp/core/random.h"
+#include "esp/gfx/SensorNoise.h"
 
 namespace esp {
+namespace gfx {
+class Renderer;
+}
 namespace sensor {
 
 // TODO:
@@ -38,13 +43,65 @@ class PinholeCamera : public Sensor {
   virtual bool getObservation(gfx::Simulator& sim, Observation& obs) override;
   virtual bool getObservationSpace(ObservationSpace& space) override;
 
+  // nullptr for a sensor with noise, whose frames the batch cannot add noise
+  // to, so that they are drawn by getObservation()
+  virtual scene::SceneGraph* getObservedSceneGraph(
+      gfx::Simulator& sim) override;
+  virtual bool readBatchObservation(gfx::Simulator& sim,
+                                    int batchIndex,
+                                    Observation& obs) override;
+  virtual int readBatchObservationAsync(gfx::Simulator& sim,
+                                        int batchIndex) override;
+  virtual bool waitBatchObservation(gfx::Simulator& sim,
+                                    int ticket,
+                                    Observation& obs) override;
+
+  // the stream the noise of the next frames is seeded from, e.g. for a fork
+  // of a simulator to continue it rather than replay it from the start
+  void setNoiseRandom(const core::Random& random) { noiseRandom_ = random; }
+  const core::Random& getNoiseRandom() const { return noiseRandom_; }
+
  protected:
+  // make sure buffer_ is allocated and hand it to obs
+  void prepareObservationBuffer(Observation& obs);
+
+  // the scene graph of the type of the sensor in sim
+  scene::SceneGraph& observedSceneGraph(gfx::Simulator& sim);
+
+  // add the noise of the spec, if any, to the frame renderer drew last
+  void applyNoise(gfx::Renderer& renderer);
+
+  // cache the projection of a viewport of size with a horizontal field of
+  // view of hfov degrees, and its depth unprojection
+  void cacheProjection(const Magnum::Vector2i& size, float hfov);
+
   // projection parameters
   int width_ = 640;      // canvas width
   int height_ = 480;     // canvas height
   float near_ = 0.001f;  // near clipping plane
   float far_ = 1000.0f;  // far clipping plane
   float hfov_ = 35.0f;   // field of vision (in degrees)
+  int supersampling_ = 1;  // of color, see SensorSpec::supersampling
+
+  // what setProjectionMatrix() sets, only computed again when the projection
+  // parameters change rather than on every draw
+  Magnum::Vector2i projectionSize_;
+  Magnum::Matrix4 projectionMatrix_;
+  Magnum::Vector2 depthUnprojection_;
+
+  // noise of the spec, and the stream the seed of the noise of every frame
+  // is drawn from, split by the uuid of the sensor from the seed of the
+  // model, so sensors with the same seed still get different noise
+  gfx::SensorNoiseModel noise_;
+  core::Random noiseRandom_{0};
+
+  // what the frame in buffer_ shows, for SensorSpec::frameReuse
+  bool frameValid_ = false;
+  const gfx::Renderer* frameRenderer_ = nullptr;
+  const scene::SceneGraph* frameSceneGraph_ = nullptr;
+  const void* frameData_ = nullptr;
+  Magnum::Matrix4 frameTransformation_;
+  uint64_t frameRevision_ = 0;
 
   ESP_SMART_POINTERS(PinholeCamera)
 };
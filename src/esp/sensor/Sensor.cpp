@@ -6,6 +6,8 @@
 
 #include <Magnum/EigenIntegration/Integration.h>
 
+#include "esp/gfx/Renderer.h"
+
 namespace esp {
 namespace sensor {
 
@@ -30,6 +32,56 @@ bool Sensor::getObservationSpace(ObservationSpace& space) {
   return false;
 }
 
+bool Sensor::setObservationBuffer(void* data, size_t sizeInBytes) {
+  ObservationSpace space;
+  if (!getObservationSpace(space)) {
+    LOG(ERROR) << "Cannot set observation buffer of sensor " << spec_->uuid
+               << ": it has no observation space";
+    return false;
+  }
+  core::Buffer::ptr buffer =
+      core::Buffer::create(data, space.shape, space.dataType);
+  if (data == nullptr || buffer->totalBytes != sizeInBytes) {
+    LOG(ERROR) << "Cannot set observation buffer of sensor " << spec_->uuid
+               << ": expected " << buffer->totalBytes << " bytes, got "
+               << sizeInBytes;
+    return false;
+  }
+  buffer_ = buffer;
+  return true;
+}
+
+bool Sensor::encodeObservation(Observation& obs) {
+  if (encoder_ == nullptr || encoderSpec_ != *spec_) {
+    encoder_ = ObservationEncoder::fromSpec(*spec_);
+    encoderSpec_ = *spec_;
+  }
+  if (encoder_ == nullptr || obs.buffer == nullptr) {
+    return false;
+  }
+  if (encodedBuffer_ == nullptr) {
+    encodedBuffer_ = core::Buffer::create();
+  }
+  if (!encoder_->encode(*obs.buffer, *encodedBuffer_)) {
+    return false;
+  }
+  obs.encoded = encodedBuffer_;
+  return true;
+}
+
+void getVisualObservationSpace(const SensorSpec& spec,
+                               ObservationSpace& space) {
+  const gfx::FrameFormat format = gfx::getFrameFormat(spec);
+  size_t channels = spec.channels;
+  if (spec.sensorType == SensorType::COLOR) {
+    channels = format == gfx::FrameFormat::Rgb8 ? 3 : 4;
+  }
+  space.spaceType = ObservationSpaceType::TENSOR;
+  space.shape = {static_cast<size_t>(spec.resolution[0]),
+                 static_cast<size_t>(spec.resolution[1]), channels};
+  space.dataType = gfx::getFrameFormatDataType(format);
+}
+
 void SensorSuite::add(Sensor::ptr sensor) {
   const std::string uuid = sensor->specification()->uuid;
   sensors_[uuid] = sensor;
@@ -62,7 +114,9 @@ bool operator==(const SensorSpec& a, const SensorSpec& b) {
          a.sensorSubtype == b.sensorSubtype && a.parameters == b.parameters &&
          a.position == b.position && a.orientation == b.orientation &&
          a.resolution == b.resolution && a.channels == b.channels &&
-         a.encoding == b.encoding && a.observationSpace == b.observationSpace;
+         a.encoding == b.encoding && a.frameReuse == b.frameReuse &&
+         a.supersampling == b.supersampling &&
+         a.observationSpace == b.observationSpace;
 }
 bool operator!=(const SensorSpec& a, const SensorSpec& b) {
   return !(a == b);
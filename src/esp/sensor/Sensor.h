@@ -9,11 +9,15 @@
 #include "esp/core/Buffer.h"
 #include "esp/gfx/RenderCamera.h"
 #include "esp/scene/SceneNode.h"
+#include "esp/sensor/ObservationEncoder.h"
 
 namespace esp {
 namespace gfx {
 class Simulator;
 }
+namespace scene {
+class SceneGraph;
+}
 
 namespace sensor {
 
@@ -49,7 +53,16 @@ struct SensorSpec {
   vec3f orientation = {0, 0, 0};
   vec2i resolution = {84, 84};
   int channels = 4;
+  // pixel format of the observations; a codec suffix, e.g. "+lz4", also
+  // compresses them into Observation::encoded, see ObservationEncoder
   std::string encoding = "rgba_uint8";
+  // keep the last observation of a visual sensor while neither its pose nor
+  // the drawables of the scene changed, instead of rendering it again
+  bool frameReuse = false;
+  // render color sensors at supersampling times the resolution, a power of
+  // two, and box-filter down on the GPU, for anti-aliased images; depth and
+  // semantic sensors always render at their resolution
+  int supersampling = 1;
   // description of Sensor observation space as gym.spaces.Dict()
   std::string observationSpace = "";
   ESP_SMART_POINTERS(SensorSpec)
@@ -61,6 +74,9 @@ bool operator!=(const SensorSpec& a, const SensorSpec& b);
 struct Observation {
   // TODO: populate this struct with raw data
   core::Buffer::ptr buffer;
+  // the observation compressed by the codec of SensorSpec::encoding, if it
+  // has one, see Sensor::encodeObservation()
+  core::Buffer::ptr encoded;
   ESP_SMART_POINTERS(Observation)
 };
 
@@ -71,6 +87,11 @@ struct ObservationSpace {
   ESP_SMART_POINTERS(ObservationSpace)
 };
 
+// The observation space of the frames of a visual sensor of spec, in the
+// gfx::FrameFormat of the spec: for color of the channels of the format, and
+// otherwise of the channels of the spec
+void getVisualObservationSpace(const SensorSpec& spec, ObservationSpace& space);
+
 // Represents a sensor that provides data from the environment to an agent
 class Sensor : public Magnum::SceneGraph::AbstractFeature3D {
  public:
@@ -106,9 +127,63 @@ class Sensor : public Magnum::SceneGraph::AbstractFeature3D {
   virtual bool getObservation(gfx::Simulator& sim, Observation& obs);
   virtual bool getObservationSpace(ObservationSpace& space);
 
+  // Register caller-owned memory (e.g., a numpy array or a pinned host tensor)
+  // that observations are written into directly, without intermediate copies.
+  // sizeInBytes must match the observation space of this sensor. The memory
+  // must stay alive until it is replaced or resetObservationBuffer() is called
+  bool setObservationBuffer(void* data, size_t sizeInBytes);
+
+  // go back to an internally allocated observation buffer
+  void resetObservationBuffer() { buffer_ = nullptr; }
+
+  // whether the encoding of the spec has a codec, see ObservationEncoder
+  bool hasObservationEncoding() const {
+    return ObservationEncoder::hasCodec(spec_->encoding);
+  }
+
+  // compress obs.buffer into obs.encoded with the codec of the spec, writing
+  // into a buffer of this sensor that is reused every step. Different
+  // sensors can encode on different threads at once. Returns false if the
+  // spec has no codec or obs does not match it
+  bool encodeObservation(Observation& obs);
+
+  // visual sensors that can be rendered together with other sensors through
+  // gfx::Renderer::drawBatch override the following two functions, and may
+  // also read their frames asynchronously with the two after them
+
+  // the scene graph this sensor observes in sim, nullptr if not batchable
+  virtual scene::SceneGraph* getObservedSceneGraph(gfx::Simulator& sim) {
+    return nullptr;
+  }
+
+  // fill obs from the batchIndex-th frame of the last drawBatch call
+  virtual bool readBatchObservation(gfx::Simulator& sim,
+                                    int batchIndex,
+                                    Observation& obs) {
+    return false;
+  }
+
+  // queue the readback of the batchIndex-th frame of the last drawBatch call
+  // and return its ticket, or ID_UNDEFINED if the frame is only read by
+  // readBatchObservation()
+  virtual int readBatchObservationAsync(gfx::Simulator& sim, int batchIndex) {
+    return ID_UNDEFINED;
+  }
+
+  // fill obs from the readback of ticket, waiting for it to complete
+  virtual bool waitBatchObservation(gfx::Simulator& sim,
+                                    int ticket,
+                                    Observation& obs) {
+    return false;
+  }
+
  protected:
   SensorSpec::ptr spec_ = nullptr;
   core::Buffer::ptr buffer_ = nullptr;
+  // made again when the spec changes from encoderSpec_
+  ObservationEncoder::ptr encoder_ = nullptr;
+  SensorSpec encoderSpec_;
+  core::Buffer::ptr encodedBuffer_ = nullptr;
 
   ESP_SMART_POINTERS(Sensor)
 };
@@ -0,0 +1,177 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#include "BatchSimulatorWithAgents.h"
+
+#include <iterator>
+
+#include "esp/gfx/Renderer.h"
+
+namespace esp {
+namespace sim {
+
+BatchSimulatorWithAgents::BatchSimulatorWithAgents(
+    const gfx::SimulatorConfiguration& cfg,
+    int numEnvironments)
+    : gfx::BatchSimulator(cfg, numEnvironments), agents_(numEnvironments) {}
+
+BatchSimulatorWithAgents::~BatchSimulatorWithAgents() {}
+
+void BatchSimulatorWithAgents::reconfigureEnvironment(
+    int envIndex,
+    const scene::SceneConfiguration& sceneConfig) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  // the base class keeps the scene graph, and so its ID, when it loads another
+  // scene, and loads nothing if the environment already shows sceneConfig
+  const Environment& env = getEnvironment(envIndex);
+  const bool reload = env.sceneID == ID_UNDEFINED || env.scene != sceneConfig;
+  gfx::BatchSimulator::reconfigureEnvironment(envIndex, sceneConfig);
+  // agents_ is empty while the base class is constructed
+  if (reload && envIndex < agents_.size()) {
+    removeAgents(envIndex);
+  }
+}
+
+void BatchSimulatorWithAgents::removeAgents(int envIndex) {
+  for (agent::Agent::ptr& agent : agents_[envIndex]) {
+    // the node owns the features attached to it and deletes them with it, so
+    // it only goes if nothing outside holds the agent or one of its sensors
+    bool owned = agent.use_count() == 1;
+    for (const std::pair<const std::string, sensor::Sensor::ptr>& s :
+         agent->getSensorSuite().getSensors()) {
+      owned = owned && s.second.use_count() == 1;
+    }
+    scene::SceneNode* agentNode = &agent->node();
+    agent = nullptr;
+    if (owned) {
+      delete agentNode;
+    }
+  }
+  agents_[envIndex].clear();
+}
+
+agent::Agent::ptr BatchSimulatorWithAgents::addAgent(
+    int envIndex,
+    const agent::AgentConfiguration& agentConfig) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  scene::SceneNode& agentNode =
+      getSceneGraph(envIndex).getRootNode().createChild();
+  agent::Agent::ptr ag = agent::Agent::create(agentNode, agentConfig);
+  ag->getControls()->setRandom(random_.split(numAgentsAdded_++));
+  agents_[envIndex].push_back(ag);
+  return ag;
+}
+
+agent::Agent::ptr BatchSimulatorWithAgents::getAgent(int envIndex,
+                                                     int agentId) {
+  ASSERT(0 <= envIndex && envIndex < agents_.size());
+  ASSERT(0 <= agentId && agentId < agents_[envIndex].size());
+  return agents_[envIndex][agentId];
+}
+
+int BatchSimulatorWithAgents::getNumAgents(int envIndex) const {
+  ASSERT(0 <= envIndex && envIndex < agents_.size());
+  return agents_[envIndex].size();
+}
+
+bool BatchSimulatorWithAgents::step(
+    const std::vector<std::vector<int>>& actionIds,
+    std::vector<std::vector<std::map<std::string, sensor::Observation>>>&
+        observations,
+    double dt /* = 1.0 / 60.0 */) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  if (actionIds.size() != agents_.size()) {
+    LOG(ERROR) << "Got actions for " << actionIds.size() << " of "
+               << agents_.size() << " environments";
+    return false;
+  }
+  for (int iEnv = 0; iEnv < agents_.size(); ++iEnv) {
+    if (actionIds[iEnv].size() != agents_[iEnv].size()) {
+      LOG(ERROR) << "Got " << actionIds[iEnv].size() << " actions for "
+                 << agents_[iEnv].size() << " agents of environment " << iEnv;
+      return false;
+    }
+    for (int iAgent = 0; iAgent < agents_[iEnv].size(); ++iAgent) {
+      const int actionId = actionIds[iEnv][iAgent];
+      if (actionId != ID_UNDEFINED &&
+          (actionId < 0 ||
+           actionId >= agents_[iEnv][iAgent]->getNumActions())) {
+        LOG(ERROR) << "Invalid action " << actionId << " for agent " << iAgent
+                   << " of environment " << iEnv;
+        return false;
+      }
+    }
+  }
+
+  for (int iEnv = 0; iEnv < agents_.size(); ++iEnv) {
+    for (int iAgent = 0; iAgent < agents_[iEnv].size(); ++iAgent) {
+      if (actionIds[iEnv][iAgent] != ID_UNDEFINED) {
+        agents_[iEnv][iAgent]->act(actionIds[iEnv][iAgent]);
+      }
+    }
+  }
+  // the worlds of all environments, in parallel
+  stepWorld(dt);
+
+  // visual sensors of all environments are rendered together in a single
+  // batch; everything else produces its observation on its own, in the
+  // environment of its agent
+  batchSensors_.clear();
+  batchEnvironments_.clear();
+  batchTargets_.clear();
+  const bool render = getRenderer() != nullptr;
+  const int previousEnvironment = activeEnvironment_;
+  observations.resize(agents_.size());
+  for (int iEnv = 0; iEnv < agents_.size(); ++iEnv) {
+    setActiveEnvironment(iEnv);
+    observations[iEnv].resize(agents_[iEnv].size());
+    for (int iAgent = 0; iAgent < agents_[iEnv].size(); ++iAgent) {
+      std::map<std::string, sensor::Observation>& agentObservations =
+          observations[iEnv][iAgent];
+      const std::map<std::string, sensor::Sensor::ptr>& sensors =
+          agents_[iEnv][iAgent]->getSensorSuite().getSensors();
+      for (auto it = agentObservations.begin();
+           it != agentObservations.end();) {
+        it = sensors.count(it->first) ? std::next(it)
+                                      : agentObservations.erase(it);
+      }
+      for (const std::pair<const std::string, sensor::Sensor::ptr>& s :
+           sensors) {
+        if (render && s.second->isVisualSensor() &&
+            s.second->getObservedSceneGraph(*this) != nullptr) {
+          batchSensors_.push_back(s.second.get());
+          batchEnvironments_.push_back(iEnv);
+          batchTargets_.emplace_back(&agentObservations, &s.first);
+          continue;
+        }
+        sensor::Observation obs;
+        if (s.second->getObservation(*this, obs)) {
+          agentObservations[s.first] = obs;
+        } else {
+          agentObservations.erase(s.first);
+        }
+      }
+    }
+  }
+  setActiveEnvironment(previousEnvironment);
+
+  if (!batchSensors_.empty()) {
+    drawBatch(batchSensors_, batchEnvironments_);
+    for (int iSensor = 0; iSensor < batchSensors_.size(); ++iSensor) {
+      std::map<std::string, sensor::Observation>& agentObservations =
+          *batchTargets_[iSensor].first;
+      const std::string& sensorId = *batchTargets_[iSensor].second;
+      sensor::Observation obs;
+      if (batchSensors_[iSensor]->readBatchObservation(*this, iSensor, obs)) {
+        agentObservations[sensorId] = obs;
+      } else {
+        agentObservations.erase(sensorId);
+      }
+    }
+  }
+  return true;
+}
+
+}  // namespace sim
+}  // namespace esp
@@ -0,0 +1,74 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "esp/agent/Agent.h"
+#include "esp/gfx/BatchSimulator.h"
+
+namespace esp {
+namespace sim {
+
+// A gfx::BatchSimulator whose environments have agents of their own, so that
+// all environments step in one call: step() takes the actions of the agents
+// of every environment, steps the physics worlds of all environments
+// together and renders the visual sensors of all agents in a single batch.
+// The moves of the agents are not filtered by a navmesh, as the environments
+// may show different scenes
+class BatchSimulatorWithAgents : public gfx::BatchSimulator {
+ public:
+  BatchSimulatorWithAgents(const gfx::SimulatorConfiguration& cfg,
+                           int numEnvironments);
+  virtual ~BatchSimulatorWithAgents();
+
+  //! Drops the agents of the environment, and their scene nodes, if it loads
+  //! a scene other than the one it shows; so does reconfigure()
+  virtual void reconfigureEnvironment(
+      int envIndex,
+      const scene::SceneConfiguration& sceneConfig) override;
+
+  //! Add an agent to the scene graph of environment envIndex
+  agent::Agent::ptr addAgent(int envIndex,
+                             const agent::AgentConfiguration& agentConfig);
+  agent::Agent::ptr getAgent(int envIndex, int agentId);
+  int getNumAgents(int envIndex) const;
+
+  //! Take action actionIds[e][i] with agent i of environment e, for all
+  //! environments at once, by action index (ID_UNDEFINED to leave an agent
+  //! be), step the physics worlds of all environments by dt if physics is
+  //! enabled, and get the observations of all agents, rendering the visual
+  //! sensors of all environments in one batch. observations[e][i] receives
+  //! the observations of agent i of environment e; like in
+  //! SimulatorWithAgents::stepAgents(), the maps are reused. Returns false
+  //! without acting if actionIds does not hold a valid index for each agent
+  bool step(const std::vector<std::vector<int>>& actionIds,
+            std::vector<std::vector<std::map<std::string, sensor::Observation>>>&
+                observations,
+            double dt = 1.0 / 60.0);
+
+ protected:
+  // agents_[e] are the agents of environment e, in the order they were added
+  std::vector<std::vector<agent::Agent::ptr>> agents_;
+  int numAgentsAdded_ = 0;
+  // visual sensors of the current batch, their environments and where their
+  // observations go, see step()
+  std::vector<sensor::Sensor*> batchSensors_;
+  std::vector<int> batchEnvironments_;
+  std::vector<std::pair<std::map<std::string, sensor::Observation>*,
+                        const std::string*>>
+      batchTargets_;
+
+  //! Drop the agents of environment envIndex, deleting their scene nodes
+  //! unless an agent or one of its sensors is still held elsewhere
+  void removeAgents(int envIndex);
+
+  ESP_SMART_POINTERS(BatchSimulatorWithAgents)
+};
+
+}  // namespace sim
+}  // namespace esp
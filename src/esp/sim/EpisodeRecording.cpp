@@ -0,0 +1,357 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#include "EpisodeRecording.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#include "esp/core/Compression.h"
+
+namespace esp {
+namespace sim {
+
+namespace {
+// layout of a file written by save(): the header, numAgents uint32 sensor
+// counts, then compressedSize bytes of LZ4 block of the dataSize bytes of
+// the steps
+struct EpisodeFileHeader {
+  char magic[4];
+  uint32_t version;
+  uint32_t numAgents;
+  uint32_t numSteps;
+  uint64_t dataSize;
+  uint64_t compressedSize;
+};
+const char episodeMagic[4] = {'H', 'S', 'E', 'P'};
+const uint32_t episodeVersion = 1;
+
+// bits of the flags a step starts with
+enum StepFlags : uint64_t {
+  // the objects changed, their IDs follow
+  ObjectsChanged = 1,
+};
+
+void writeVarint(std::vector<uint8_t>& out, uint64_t value) {
+  for (; value >= 0x80; value >>= 7) {
+    out.push_back(uint8_t(value | 0x80));
+  }
+  out.push_back(uint8_t(value));
+}
+
+bool readVarint(const std::vector<uint8_t>& data,
+                size_t& offset,
+                uint64_t& value) {
+  value = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    if (offset >= data.size()) {
+      return false;
+    }
+    const uint8_t byte = data[offset++];
+    value |= uint64_t(byte & 0x7f) << shift;
+    if (!(byte & 0x80)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// small negative numbers, like ID_UNDEFINED, as small unsigned ones
+inline uint64_t zigzag(int64_t value) {
+  return (uint64_t(value) << 1) ^ uint64_t(value >> 63);
+}
+inline int64_t unzigzag(uint64_t value) {
+  return int64_t(value >> 1) ^ -int64_t(value & 1);
+}
+
+inline uint32_t floatBits(float value) {
+  uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+// values XORed with previous, in groups of 8 behind a mask of the changed
+// ones
+void writeValues(const float* previous,
+                 const float* values,
+                 size_t size,
+                 std::vector<uint8_t>& out) {
+  for (size_t begin = 0; begin < size; begin += 8) {
+    const size_t end = std::min(begin + 8, size);
+    uint32_t deltas[8];
+    uint8_t mask = 0;
+    for (size_t i = begin; i < end; ++i) {
+      deltas[i - begin] = floatBits(values[i]) ^ floatBits(previous[i]);
+      if (deltas[i - begin] != 0) {
+        mask |= uint8_t(1 << (i - begin));
+      }
+    }
+    out.push_back(mask);
+    for (size_t i = begin; i < end; ++i) {
+      if (mask & (1 << (i - begin))) {
+        writeVarint(out, deltas[i - begin]);
+      }
+    }
+  }
+}
+
+// the inverse of writeValues(), values hold the previous ones
+bool readValues(const std::vector<uint8_t>& data,
+                size_t& offset,
+                float* values,
+                size_t size) {
+  for (size_t begin = 0; begin < size; begin += 8) {
+    if (offset >= data.size()) {
+      return false;
+    }
+    const uint8_t mask = data[offset++];
+    const size_t end = std::min(begin + 8, size);
+    for (size_t i = begin; i < end; ++i) {
+      if (!(mask & (1 << (i - begin)))) {
+        continue;
+      }
+      uint64_t delta;
+      if (!readVarint(data, offset, delta) || delta > 0xffffffffu) {
+        return false;
+      }
+      const uint32_t bits = floatBits(values[i]) ^ uint32_t(delta);
+      std::memcpy(&values[i], &bits, sizeof(bits));
+    }
+  }
+  return true;
+}
+
+// transformations of the objects newIDs, taken from the ones of the same
+// objects in oldIDs, 0 for objects that are new. Both are ascending
+void remapTransformations(const std::vector<int>& oldIDs,
+                          const std::vector<float>& oldTransformations,
+                          const std::vector<int>& newIDs,
+                          std::vector<float>& newTransformations) {
+  constexpr int size = EpisodeRecording::transformationSize;
+  newTransformations.assign(newIDs.size() * size, 0.0f);
+  size_t iOld = 0;
+  for (size_t iNew = 0; iNew < newIDs.size(); ++iNew) {
+    while (iOld < oldIDs.size() && oldIDs[iOld] < newIDs[iNew]) {
+      ++iOld;
+    }
+    if (iOld < oldIDs.size() && oldIDs[iOld] == newIDs[iNew]) {
+      std::copy_n(&oldTransformations[iOld * size], size,
+                  &newTransformations[iNew * size]);
+    }
+  }
+}
+}  // namespace
+
+constexpr int EpisodeRecording::poseSize;
+constexpr int EpisodeRecording::transformationSize;
+
+EpisodeRecording::EpisodeRecording(const std::vector<int>& numAgentSensors)
+    : numAgentSensors_(numAgentSensors) {
+  for (const int numSensors : numAgentSensors_) {
+    agentPosesSize_ += (1 + numSensors) * poseSize;
+  }
+  last_.actionIds.assign(numAgentSensors_.size(), ID_UNDEFINED);
+  last_.agentPoses.assign(agentPosesSize_, 0.0f);
+}
+
+bool EpisodeRecording::append(const EpisodeStep& step) {
+  if (step.actionIds.size() != numAgentSensors_.size() ||
+      step.agentPoses.size() != agentPosesSize_ ||
+      step.objectTransformations.size() !=
+          step.objectIDs.size() * transformationSize) {
+    LOG(ERROR) << "EpisodeRecording::append: the step does not match the "
+                  "agents and sensors of the recording";
+    return false;
+  }
+  for (size_t i = 0; i < step.objectIDs.size(); ++i) {
+    if (step.objectIDs[i] < 0 ||
+        (i > 0 && step.objectIDs[i] <= step.objectIDs[i - 1])) {
+      LOG(ERROR) << "EpisodeRecording::append: object IDs are not ascending";
+      return false;
+    }
+  }
+
+  const bool objectsChanged = step.objectIDs != last_.objectIDs;
+  writeVarint(data_, objectsChanged ? uint64_t(ObjectsChanged) : 0);
+  uint64_t timeBits, lastTimeBits;
+  std::memcpy(&timeBits, &step.worldTime, sizeof(timeBits));
+  std::memcpy(&lastTimeBits, &last_.worldTime, sizeof(lastTimeBits));
+  writeVarint(data_, timeBits ^ lastTimeBits);
+  for (const int actionId : step.actionIds) {
+    writeVarint(data_, zigzag(actionId));
+  }
+  writeValues(last_.agentPoses.data(), step.agentPoses.data(),
+              agentPosesSize_, data_);
+  if (objectsChanged) {
+    writeVarint(data_, step.objectIDs.size());
+    int previousID = -1;
+    for (const int objectID : step.objectIDs) {
+      writeVarint(data_, objectID - previousID - 1);
+      previousID = objectID;
+    }
+    std::vector<float> previous;
+    remapTransformations(last_.objectIDs, last_.objectTransformations,
+                         step.objectIDs, previous);
+    last_.objectTransformations.swap(previous);
+  }
+  writeValues(last_.objectTransformations.data(),
+              step.objectTransformations.data(),
+              step.objectTransformations.size(), data_);
+
+  last_ = step;
+  ++numSteps_;
+  return true;
+}
+
+bool EpisodeRecording::readStep(size_t& offset, EpisodeStep& step) const {
+  if (offset >= data_.size()) {
+    return false;
+  }
+  step.actionIds.resize(numAgentSensors_.size(), ID_UNDEFINED);
+  step.agentPoses.resize(agentPosesSize_, 0.0f);
+  step.objectTransformations.resize(step.objectIDs.size() * transformationSize,
+                                    0.0f);
+
+  uint64_t flags, timeDelta, timeBits;
+  if (!readVarint(data_, offset, flags) ||
+      !readVarint(data_, offset, timeDelta)) {
+    return false;
+  }
+  std::memcpy(&timeBits, &step.worldTime, sizeof(timeBits));
+  timeBits ^= timeDelta;
+  std::memcpy(&step.worldTime, &timeBits, sizeof(timeBits));
+  for (int& actionId : step.actionIds) {
+    uint64_t value;
+    if (!readVarint(data_, offset, value)) {
+      return false;
+    }
+    actionId = int(unzigzag(value));
+  }
+  if (!readValues(data_, offset, step.agentPoses.data(), agentPosesSize_)) {
+    return false;
+  }
+  if (flags & ObjectsChanged) {
+    uint64_t numObjects;
+    // every ID takes a byte at least
+    if (!readVarint(data_, offset, numObjects) ||
+        numObjects > data_.size() - offset) {
+      return false;
+    }
+    std::vector<int> objectIDs(numObjects);
+    int64_t previousID = -1;
+    for (int& objectID : objectIDs) {
+      uint64_t gap;
+      if (!readVarint(data_, offset, gap) || gap > 0x7fffffff) {
+        return false;
+      }
+      previousID += int64_t(gap) + 1;
+      if (previousID > 0x7fffffff) {
+        return false;
+      }
+      objectID = int(previousID);
+    }
+    std::vector<float> transformations;
+    remapTransformations(step.objectIDs, step.objectTransformations,
+                         objectIDs, transformations);
+    step.objectIDs.swap(objectIDs);
+    step.objectTransformations.swap(transformations);
+  }
+  return readValues(data_, offset, step.objectTransformations.data(),
+                    step.objectTransformations.size());
+}
+
+bool EpisodeRecording::save(const std::string& file) const {
+  std::vector<char> compressed(core::lz4CompressBound(data_.size()));
+  const size_t compressedSize = core::lz4Compress(
+      data_.data(), data_.size(), compressed.data(), compressed.size());
+  if (compressedSize == 0) {
+    return false;
+  }
+
+  EpisodeFileHeader header;
+  std::memcpy(header.magic, episodeMagic, sizeof(episodeMagic));
+  header.version = episodeVersion;
+  header.numAgents = numAgentSensors_.size();
+  header.numSteps = numSteps_;
+  header.dataSize = data_.size();
+  header.compressedSize = compressedSize;
+  std::vector<uint32_t> numAgentSensors(numAgentSensors_.begin(),
+                                        numAgentSensors_.end());
+
+  std::ofstream ofs(file, std::ios::binary | std::ios::trunc);
+  ofs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  ofs.write(reinterpret_cast<const char*>(numAgentSensors.data()),
+            numAgentSensors.size() * sizeof(uint32_t));
+  ofs.write(compressed.data(), compressedSize);
+  if (!ofs.good()) {
+    LOG(ERROR) << "Cannot write episode recording " << file;
+    return false;
+  }
+  return true;
+}
+
+EpisodeRecording::ptr EpisodeRecording::load(const std::string& file) {
+  std::ifstream ifs(file, std::ios::binary);
+  if (!ifs.good()) {
+    LOG(ERROR) << "Cannot read episode recording " << file;
+    return nullptr;
+  }
+  const std::vector<char> contents{std::istreambuf_iterator<char>(ifs),
+                                   std::istreambuf_iterator<char>()};
+  EpisodeFileHeader header;
+  if (contents.size() < sizeof(header)) {
+    LOG(ERROR) << "Invalid episode recording " << file;
+    return nullptr;
+  }
+  std::memcpy(&header, contents.data(), sizeof(header));
+  const size_t sensorsSize = size_t(header.numAgents) * sizeof(uint32_t);
+  if (std::memcmp(header.magic, episodeMagic, sizeof(episodeMagic)) != 0 ||
+      header.version != episodeVersion ||
+      contents.size() - sizeof(header) < sensorsSize ||
+      contents.size() - sizeof(header) - sensorsSize !=
+          header.compressedSize) {
+    LOG(ERROR) << "Invalid episode recording " << file;
+    return nullptr;
+  }
+
+  std::vector<uint32_t> numAgentSensors(header.numAgents);
+  std::memcpy(numAgentSensors.data(), contents.data() + sizeof(header),
+              sensorsSize);
+  EpisodeRecording::ptr recording = EpisodeRecording::create(
+      std::vector<int>(numAgentSensors.begin(), numAgentSensors.end()));
+  recording->data_.resize(header.dataSize);
+  if (!core::lz4Decompress(contents.data() + sizeof(header) + sensorsSize,
+                           header.compressedSize, recording->data_.data(),
+                           recording->data_.size())) {
+    LOG(ERROR) << "Corrupted episode recording " << file;
+    return nullptr;
+  }
+
+  // decoding every step validates the data, and leaves the last one to
+  // append to
+  size_t offset = 0;
+  EpisodeStep step;
+  int numSteps = 0;
+  while (offset < recording->data_.size()) {
+    if (!recording->readStep(offset, step)) {
+      LOG(ERROR) << "Corrupted episode recording " << file;
+      return nullptr;
+    }
+    ++numSteps;
+  }
+  if (numSteps != int(header.numSteps)) {
+    LOG(ERROR) << "Corrupted episode recording " << file;
+    return nullptr;
+  }
+  if (numSteps > 0) {
+    recording->last_ = step;
+  }
+  recording->numSteps_ = numSteps;
+  return recording;
+}
+
+}  // namespace sim
+}  // namespace esp
@@ -0,0 +1,88 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "esp/core/esp.h"
+
+namespace esp {
+namespace sim {
+
+//! The state a step of an episode left a SimulatorWithAgents in, see
+//! SimulatorWithAgents::recordStep()
+struct EpisodeStep {
+  //! Time of the physics world of the active scene, 0 without physics
+  double worldTime = 0.0;
+  //! Action index each agent took, ID_UNDEFINED for none
+  std::vector<int> actionIds;
+  //! Per agent, the pose of its body, then the poses of its sensors relative
+  //! to it in the order of their ids, EpisodeRecording::poseSize values each
+  std::vector<float> agentPoses;
+  //! Physics objects of the active scene, in ascending order
+  std::vector<int> objectIDs;
+  //! EpisodeRecording::transformationSize values per object
+  std::vector<float> objectTransformations;
+};
+
+// A compact binary stream of the steps of an episode, to replay it without
+// physics or a policy. Every value is delta coded against the same value of
+// the step before: each float as the XOR of its bits with the previous one,
+// which leaves only the low mantissa bits of small changes, written as a
+// variable-length integer, with a bitmask per 8 values that skips unchanged
+// ones. A static object costs 2 bytes a step, an agent that moved a few
+// dozen. Files are additionally compressed with LZ4
+class EpisodeRecording {
+ public:
+  //! Values of a pose: the position x, y, z, then the rotation x, y, z, w
+  static constexpr int poseSize = 7;
+  //! Values of the transformation of an object: the first 3 rows of its
+  //! matrix, column by column
+  static constexpr int transformationSize = 12;
+
+  //! Recording of agents with numAgentSensors[i] sensors each
+  explicit EpisodeRecording(const std::vector<int>& numAgentSensors);
+
+  //! Append step, which has to have an action and poses for the agents of
+  //! the recording. Returns false, appending nothing, if it does not
+  bool append(const EpisodeStep& step);
+
+  //! Decode the steps in order, each delta coded against the one before:
+  //! start with offset 0 and a default step, and pass the same offset and
+  //! step for each following one. Returns false past the last step or for
+  //! corrupted data
+  bool readStep(size_t& offset, EpisodeStep& step) const;
+
+  int getNumSteps() const { return numSteps_; }
+  int getNumAgents() const { return numAgentSensors_.size(); }
+  const std::vector<int>& getNumAgentSensors() const {
+    return numAgentSensors_;
+  }
+  //! Values of EpisodeStep::agentPoses
+  size_t getAgentPosesSize() const { return agentPosesSize_; }
+
+  //! The encoded steps, uncompressed
+  const std::vector<uint8_t>& getData() const { return data_; }
+
+  //! Write the recording LZ4 compressed to file
+  bool save(const std::string& file) const;
+  //! Recording of a file written by save(), nullptr if it cannot be read or
+  //! is corrupted. More steps can be appended to it
+  static std::shared_ptr<EpisodeRecording> load(const std::string& file);
+
+  ESP_SMART_POINTERS(EpisodeRecording)
+
+ protected:
+  std::vector<int> numAgentSensors_;
+  size_t agentPosesSize_ = 0;
+  std::vector<uint8_t> data_;
+  int numSteps_ = 0;
+  // the last step appended, which the next one is delta coded against
+  EpisodeStep last_;
+};
+
+}  // namespace sim
+}  // namespace esp
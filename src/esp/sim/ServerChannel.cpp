@@ -0,0 +1,147 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#include "ServerChannel.h"
+
+#include <cstring>
+#include <new>
+
+namespace esp {
+namespace sim {
+
+namespace {
+const char channelMagic[8] = {'E', 'S', 'P', 'S', 'E', 'R', 'V', 'E'};
+const uint32_t channelVersion = 1;
+
+uint64_t alignTo(uint64_t offset, uint64_t alignment) {
+  return (offset + alignment - 1) / alignment * alignment;
+}
+
+// observations are aligned for the readback of the renderer, and frames
+// start on pages
+const uint64_t observationAlignment = 64;
+const uint64_t frameAlignment = 4096;
+}  // namespace
+
+std::string ServerChannel::segmentName(const std::string& serverName,
+                                       int env) {
+  return "/" + serverName + "." + std::to_string(env);
+}
+
+std::string ServerChannel::infoSegmentName(const std::string& serverName) {
+  return "/" + serverName;
+}
+
+size_t ServerChannel::getRequestBytes() const {
+  return sizeof(ServerRequest) + header_->numAgents * sizeof(int32_t);
+}
+
+ServerChannel::ServerChannel(const std::string& name,
+                             int numAgents,
+                             std::vector<ServerObservation> observations,
+                             uint32_t numFrames)
+    : observations_(std::move(observations)) {
+  uint64_t frameBytes = 0;
+  for (ServerObservation& observation : observations_) {
+    frameBytes = alignTo(frameBytes, observationAlignment);
+    observation.offset = frameBytes;
+    frameBytes += observation.sizeInBytes;
+  }
+  const uint64_t agentStatesOffset = alignTo(frameBytes, observationAlignment);
+  frameBytes = agentStatesOffset + numAgents * agentStateSize * sizeof(float);
+  frameBytes = alignTo(frameBytes, frameAlignment);
+
+  const size_t requestBytes =
+      sizeof(ServerRequest) + numAgents * sizeof(int32_t);
+  const uint64_t observationsOffset = alignTo(sizeof(Header), 64);
+  const uint64_t requestsOffset = alignTo(
+      observationsOffset + observations_.size() * sizeof(ServerObservation),
+      64);
+  const uint64_t responsesOffset = alignTo(
+      requestsOffset +
+          core::SharedRing::memorySize(numMessageSlots, requestBytes),
+      64);
+  const uint64_t framesOffset = alignTo(
+      responsesOffset + core::SharedRing::memorySize(numMessageSlots,
+                                                     sizeof(ServerResponse)),
+      frameAlignment);
+
+  memory_ = std::make_unique<core::SharedMemory>(
+      name, framesOffset + numFrames * frameBytes);
+  if (!memory_->isValid()) {
+    return;
+  }
+  char* data = memory_->data();
+  header_ = new (data) Header();
+  header_->version = channelVersion;
+  header_->numAgents = numAgents;
+  header_->numFrames = numFrames;
+  header_->numObservations = observations_.size();
+  header_->frameBytes = frameBytes;
+  header_->agentStatesOffset = agentStatesOffset;
+  header_->requestsOffset = requestsOffset;
+  header_->responsesOffset = responsesOffset;
+  header_->observationsOffset = observationsOffset;
+  header_->framesOffset = framesOffset;
+  header_->ready = 0;
+  if (!observations_.empty()) {
+    std::memcpy(data + observationsOffset, observations_.data(),
+                observations_.size() * sizeof(ServerObservation));
+  }
+  requests_ = core::SharedRing::create(data + requestsOffset, numMessageSlots,
+                                       requestBytes);
+  responses_ = core::SharedRing::create(
+      data + responsesOffset, numMessageSlots, sizeof(ServerResponse));
+  // clients may open the segment as soon as it exists, the magic tells them
+  // the rest is written
+  std::atomic_thread_fence(std::memory_order_release);
+  std::memcpy(header_->magic, channelMagic, sizeof(channelMagic));
+}
+
+ServerChannel::ServerChannel(const std::string& name) {
+  memory_ = std::make_unique<core::SharedMemory>(name);
+  if (!memory_->isValid() || memory_->size() < sizeof(Header)) {
+    return;
+  }
+  char* data = memory_->data();
+  Header* header = reinterpret_cast<Header*>(data);
+  if (std::memcmp(header->magic, channelMagic, sizeof(channelMagic)) != 0) {
+    // not written yet
+    return;
+  }
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if (header->version != channelVersion ||
+      header->framesOffset + header->numFrames * header->frameBytes >
+          memory_->size()) {
+    LOG(ERROR) << "Shared memory " << name << " is not a simulator channel";
+    return;
+  }
+  const ServerObservation* table = reinterpret_cast<const ServerObservation*>(
+      data + header->observationsOffset);
+  observations_.assign(table, table + header->numObservations);
+  requests_ = core::SharedRing(data + header->requestsOffset);
+  responses_ = core::SharedRing(data + header->responsesOffset);
+  header_ = header;
+}
+
+bool ServerChannel::isReady() const {
+  return header_->ready.load(std::memory_order_acquire) != 0;
+}
+
+void ServerChannel::setReady(bool ready) {
+  header_->ready.store(ready ? 1 : 0, std::memory_order_release);
+}
+
+char* ServerChannel::frame(uint32_t index) const {
+  return memory_->data() + header_->framesOffset +
+         (index % header_->numFrames) * header_->frameBytes;
+}
+
+float* ServerChannel::agentStates(uint32_t frameIndex) const {
+  return reinterpret_cast<float*>(frame(frameIndex) +
+                                  header_->agentStatesOffset);
+}
+
+}  // namespace sim
+}  // namespace esp
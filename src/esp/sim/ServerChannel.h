@@ -0,0 +1,146 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "esp/core/Buffer.h"
+#include "esp/core/SharedMemory.h"
+#include "esp/core/esp.h"
+
+namespace esp {
+namespace sim {
+
+// A SimulatorServer talks to its clients through a shared memory segment per
+// environment, created by the server:
+// - a header describing the environment: its agents and their observations
+// - a ring of requests from the client and one of responses from the server
+// - numFrames frames, each holding the observations of every sensor of every
+//   agent at the offsets of the observation table, followed by the agent
+//   states, laid out like SimulatorWithAgents::getAgentStates()
+// The server renders into the frames directly, so observations are never
+// copied or serialized. The n-th Reset or Step request of a channel writes
+// frame n % numFrames, which stays valid for numFrames - 1 more of them
+
+enum class ServerRequestType : uint32_t {
+  //! Reset the environment and observe
+  Reset = 0,
+  //! Act with the action index of each agent and observe
+  Step = 1,
+  //! Seed the environment, without observing
+  Seed = 2,
+  //! Stop serving the environment
+  Stop = 3,
+};
+
+//! Header of a message of the request ring. Step requests are followed by
+//! one action index per agent, ID_UNDEFINED to leave an agent be
+struct ServerRequest {
+  uint64_t id;
+  ServerRequestType type;
+  uint32_t seed;
+};
+
+//! Message of the response ring, one per request but Stop
+struct ServerResponse {
+  uint64_t id;
+  //! frame holding the observations, if any
+  uint32_t frame;
+  uint32_t success;
+};
+
+//! Entry of the observation table of a channel
+struct ServerObservation {
+  char sensorUuid[64];
+  int32_t agentId;
+  core::DataType dataType;
+  uint32_t numDims;
+  uint64_t shape[4];
+  //! of the observation in each frame
+  uint64_t offset;
+  uint64_t sizeInBytes;
+};
+
+class ServerChannel {
+ public:
+  //! Messages the request and the response rings hold
+  static constexpr uint32_t numMessageSlots = 8;
+
+  //! Floats of the state of an agent in a frame, as
+  //! SimulatorWithAgents::agentStateSize
+  static constexpr int agentStateSize = 7;
+
+  //! Name of the segment of environment env of server serverName
+  static std::string segmentName(const std::string& serverName, int env);
+
+  //! Name of the segment announcing the environments of server serverName,
+  //! a std::atomic<uint32_t> count that is 0 until they all serve
+  static std::string infoSegmentName(const std::string& serverName);
+
+  //! Create the segment name for numAgents agents with observations, at
+  //! offsets that are set here, in numFrames frames. It is not ready for
+  //! clients until setReady()
+  ServerChannel(const std::string& name,
+                int numAgents,
+                std::vector<ServerObservation> observations,
+                uint32_t numFrames);
+
+  //! Open the segment name created by a server, invalid if there is none
+  //! or it is not a channel of this version
+  explicit ServerChannel(const std::string& name);
+
+  bool isValid() const { return header_ != nullptr; }
+
+  //! Whether the server has set up the environment and serves requests
+  bool isReady() const;
+  void setReady(bool ready);
+
+  int getNumAgents() const { return header_->numAgents; }
+  uint32_t getNumFrames() const { return header_->numFrames; }
+  size_t getFrameBytes() const { return header_->frameBytes; }
+  const std::vector<ServerObservation>& getObservations() const {
+    return observations_;
+  }
+
+  //! Bytes of a request message for the agents of the channel
+  size_t getRequestBytes() const;
+
+  core::SharedRing& requests() { return requests_; }
+  core::SharedRing& responses() { return responses_; }
+
+  char* frame(uint32_t index) const;
+  float* agentStates(uint32_t frameIndex) const;
+
+ protected:
+  struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t numAgents;
+    uint32_t numFrames;
+    uint32_t numObservations;
+    uint64_t frameBytes;
+    // of the agent states in each frame
+    uint64_t agentStatesOffset;
+    uint64_t requestsOffset;
+    uint64_t responsesOffset;
+    uint64_t observationsOffset;
+    uint64_t framesOffset;
+    std::atomic<uint32_t> ready;
+  };
+
+  core::SharedMemory::uptr memory_;
+  Header* header_ = nullptr;
+  std::vector<ServerObservation> observations_;
+  core::SharedRing requests_;
+  core::SharedRing responses_;
+
+  ESP_SMART_POINTERS(ServerChannel)
+};
+
+}  // namespace sim
+}  // namespace esp
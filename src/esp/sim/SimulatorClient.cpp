@@ -0,0 +1,192 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#include "SimulatorClient.h"
+
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+#include "esp/core/SharedMemory.h"
+#include "esp/core/random.h"
+
+namespace esp {
+namespace sim {
+
+namespace {
+typedef std::chrono::steady_clock Clock;
+
+// interval of polling for the server to come up
+const std::chrono::milliseconds connectPollInterval(10);
+}  // namespace
+
+SimulatorClient::SimulatorClient(const std::string& name,
+                                 int64_t timeoutMicros /* = 60000000 */)
+    : timeoutMicros_(timeoutMicros) {
+  const Clock::time_point deadline =
+      Clock::now() + std::chrono::microseconds(timeoutMicros);
+  uint32_t numEnvs = 0;
+  while (true) {
+    core::SharedMemory info(ServerChannel::infoSegmentName(name));
+    if (info.isValid() && info.size() >= sizeof(std::atomic<uint32_t>)) {
+      numEnvs = reinterpret_cast<std::atomic<uint32_t>*>(info.data())
+                    ->load(std::memory_order_acquire);
+    }
+    if (numEnvs > 0 || Clock::now() >= deadline) {
+      break;
+    }
+    std::this_thread::sleep_for(connectPollInterval);
+  }
+  if (numEnvs == 0) {
+    LOG(ERROR) << "SimulatorClient: server " << name << " is not serving";
+    return;
+  }
+
+  std::vector<ServerChannel::uptr> channels;
+  for (uint32_t env = 0; env < numEnvs; ++env) {
+    auto channel = std::make_unique<ServerChannel>(
+        ServerChannel::segmentName(name, env));
+    if (!channel->isValid() || !channel->isReady()) {
+      LOG(ERROR) << "SimulatorClient: environment " << env << " of server "
+                 << name << " is not serving";
+      return;
+    }
+    channels.push_back(std::move(channel));
+  }
+  channels_ = std::move(channels);
+  pending_.resize(numEnvs);
+  frames_.assign(numEnvs, -1);
+}
+
+bool SimulatorClient::submit(int env,
+                             ServerRequestType type,
+                             uint32_t seed,
+                             const int* ids) {
+  ServerChannel& channel = *channels_[env];
+  void* slot = channel.requests().beginWrite(timeoutMicros_);
+  if (slot == nullptr) {
+    LOG(ERROR) << "SimulatorClient: environment " << env
+               << " takes no more requests";
+    return false;
+  }
+  ServerRequest request{nextRequestId_++, type, seed};
+  std::memcpy(slot, &request, sizeof(request));
+  if (ids != nullptr) {
+    std::memcpy(static_cast<char*>(slot) + sizeof(request), ids,
+                channel.getNumAgents() * sizeof(int32_t));
+  }
+  channel.requests().endWrite();
+  if (type != ServerRequestType::Stop) {
+    pending_[env].push_back(type);
+  }
+  return true;
+}
+
+bool SimulatorClient::submitReset(int env) {
+  return submit(env, ServerRequestType::Reset, 0, nullptr);
+}
+
+bool SimulatorClient::submitStep(int env, const int* actionIds) {
+  return submit(env, ServerRequestType::Step, 0, actionIds);
+}
+
+bool SimulatorClient::submitSeed(int env, uint32_t seed) {
+  return submit(env, ServerRequestType::Seed, seed, nullptr);
+}
+
+bool SimulatorClient::wait(int env) {
+  if (pending_[env].empty()) {
+    LOG(ERROR) << "SimulatorClient: environment " << env
+               << " has no request to wait for";
+    return false;
+  }
+  ServerChannel& channel = *channels_[env];
+  const void* message = channel.responses().beginRead(timeoutMicros_);
+  if (message == nullptr) {
+    LOG(ERROR) << "SimulatorClient: environment " << env
+               << " did not respond in time";
+    return false;
+  }
+  ServerResponse response;
+  std::memcpy(&response, message, sizeof(response));
+  channel.responses().endRead();
+  const ServerRequestType type = pending_[env].front();
+  pending_[env].pop_front();
+  if (type == ServerRequestType::Reset || type == ServerRequestType::Step) {
+    frames_[env] = response.frame;
+  }
+  return response.success != 0;
+}
+
+bool SimulatorClient::reset() {
+  bool success = true;
+  for (int env = 0; env < getNumEnvs(); ++env) {
+    success = submitReset(env) && success;
+  }
+  for (int env = 0; env < getNumEnvs(); ++env) {
+    success = wait(env) && success;
+  }
+  return success;
+}
+
+bool SimulatorClient::step(const std::vector<int>& actionIds) {
+  size_t numAgents = 0;
+  for (int env = 0; env < getNumEnvs(); ++env) {
+    numAgents += getNumAgents(env);
+  }
+  if (actionIds.size() != numAgents) {
+    LOG(ERROR) << "SimulatorClient::step: expected " << numAgents
+               << " action ids, got " << actionIds.size();
+    return false;
+  }
+  bool success = true;
+  const int* envActionIds = actionIds.data();
+  for (int env = 0; env < getNumEnvs(); ++env) {
+    success = submitStep(env, envActionIds) && success;
+    envActionIds += getNumAgents(env);
+  }
+  for (int env = 0; env < getNumEnvs(); ++env) {
+    success = wait(env) && success;
+  }
+  return success;
+}
+
+bool SimulatorClient::seed(uint32_t seed) {
+  const core::Random random(seed);
+  bool success = true;
+  for (int env = 0; env < getNumEnvs(); ++env) {
+    success = submitSeed(env, random.split(env).uniform_uint()) && success;
+  }
+  for (int env = 0; env < getNumEnvs(); ++env) {
+    success = wait(env) && success;
+  }
+  return success;
+}
+
+core::Buffer::ptr SimulatorClient::getObservation(int env,
+                                                  size_t index) const {
+  const std::vector<ServerObservation>& observations = getObservations(env);
+  if (frames_[env] < 0 || index >= observations.size()) {
+    return nullptr;
+  }
+  const ServerObservation& observation = observations[index];
+  return core::Buffer::create(
+      channels_[env]->frame(frames_[env]) + observation.offset,
+      std::vector<size_t>(observation.shape,
+                          observation.shape + observation.numDims),
+      observation.dataType);
+}
+
+const float* SimulatorClient::getAgentStates(int env) const {
+  return frames_[env] < 0 ? nullptr : channels_[env]->agentStates(frames_[env]);
+}
+
+void SimulatorClient::stop() {
+  for (int env = 0; env < getNumEnvs(); ++env) {
+    submit(env, ServerRequestType::Stop, 0, nullptr);
+  }
+}
+
+}  // namespace sim
+}  // namespace esp
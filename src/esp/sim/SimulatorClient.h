@@ -0,0 +1,89 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "esp/core/Buffer.h"
+#include "esp/sim/ServerChannel.h"
+
+namespace esp {
+namespace sim {
+
+// Client of the environments of a SimulatorServer in another process. Requests
+// and responses go through the rings of their ServerChannels, and
+// observations are views of the shared frames the server renders into, so a
+// step copies nothing but the action indices. Requests of an environment can
+// be submitted ahead and waited for later, e.g. to step all environments at
+// once; every request but Stop gets a response, in order
+class SimulatorClient {
+ public:
+  //! Connect to the environments of server name, waiting for at most
+  //! timeoutMicros for them to serve; invalid if they do not meanwhile.
+  //! Responses are waited for at most timeoutMicros as well
+  explicit SimulatorClient(const std::string& name,
+                           int64_t timeoutMicros = 60000000);
+
+  bool isValid() const { return !channels_.empty(); }
+
+  int getNumEnvs() const { return channels_.size(); }
+  int getNumAgents(int env) const { return channels_[env]->getNumAgents(); }
+
+  //! Observations of each frame of env, in the order of their views
+  const std::vector<ServerObservation>& getObservations(int env) const {
+    return channels_[env]->getObservations();
+  }
+
+  //! Queue requests for env, false if its request ring stays full. Step
+  //! takes the action index of each agent of env, see
+  //! SimulatorWithAgents::stepAgents()
+  bool submitReset(int env);
+  bool submitStep(int env, const int* actionIds);
+  bool submitSeed(int env, uint32_t seed);
+
+  //! Wait for the oldest request of env submitted and not yet waited for.
+  //! False if it failed, timed out or there is none
+  bool wait(int env);
+
+  //! Reset, step or seed every environment, waiting for all of them. Step
+  //! takes the action indices of the agents of each environment in turn;
+  //! environment env is seeded with stream env of seed
+  bool reset();
+  bool step(const std::vector<int>& actionIds);
+  bool seed(uint32_t seed);
+
+  //! The observations of the last Reset or Step of env waited for, viewing
+  //! the shared frame. Valid until the server writes the frame again,
+  //! ServerChannel::getNumFrames() - 1 requests later, or the client is
+  //! destroyed; null if there is no such observation yet
+  core::Buffer::ptr getObservation(int env, size_t index) const;
+
+  //! The agent states of that frame, ServerChannel::agentStateSize floats
+  //! per agent as in SimulatorWithAgents::getAgentStates(); nullptr if there
+  //! is none yet
+  const float* getAgentStates(int env) const;
+
+  //! Ask every environment to stop serving
+  void stop();
+
+ protected:
+  bool submit(int env, ServerRequestType type, uint32_t seed, const int* ids);
+
+  std::vector<ServerChannel::uptr> channels_;
+  // request types of each environment waiting for their responses
+  std::vector<std::deque<ServerRequestType>> pending_;
+  // frame of the last observation of each environment, -1 if none
+  std::vector<int64_t> frames_;
+  uint64_t nextRequestId_ = 0;
+  int64_t timeoutMicros_;
+
+  ESP_SMART_POINTERS(SimulatorClient)
+};
+
+}  // namespace sim
+}  // namespace esp
@@ -0,0 +1,223 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#include "SimulatorServer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+
+#include "esp/core/random.h"
+#include "esp/sim/SimulatorWithAgents.h"
+
+namespace esp {
+namespace sim {
+
+namespace {
+// how long the environments block on their rings before checking whether the
+// server stops
+const int64_t pollMicros = 100000;
+}  // namespace
+
+static_assert(ServerChannel::agentStateSize ==
+                  SimulatorWithAgents::agentStateSize,
+              "frames hold the agent states of SimulatorWithAgents");
+
+SimulatorServer::SimulatorServer(
+    const std::string& name,
+    int numEnvs,
+    const gfx::SimulatorConfiguration& cfg,
+    const std::vector<agent::AgentConfiguration>& agentConfigs,
+    uint32_t numFrames /* = 2 */,
+    uint32_t seed /* = 0 */)
+    : name_(name),
+      numEnvs_(numEnvs),
+      cfg_(cfg),
+      agentConfigs_(agentConfigs),
+      numFrames_(std::max(1u, numFrames)),
+      seed_(seed) {}
+
+SimulatorServer::~SimulatorServer() {
+  stop();
+  wait();
+}
+
+bool SimulatorServer::start() {
+  if (!threads_.empty()) {
+    LOG(ERROR) << "SimulatorServer " << name_ << " is already started";
+    return false;
+  }
+  if (numEnvs_ <= 0 || agentConfigs_.empty()) {
+    LOG(ERROR) << "SimulatorServer " << name_
+               << " needs at least an environment and an agent";
+    return false;
+  }
+  info_ = std::make_unique<core::SharedMemory>(
+      ServerChannel::infoSegmentName(name_), sizeof(std::atomic<uint32_t>));
+  if (!info_->isValid()) {
+    return false;
+  }
+  stopping_ = false;
+  numSetUp_ = 0;
+  setUpFailed_ = false;
+  for (int env = 0; env < numEnvs_; ++env) {
+    threads_.emplace_back(&SimulatorServer::serve, this, env);
+  }
+  std::unique_lock<std::mutex> lock(setUpMutex_);
+  setUpDone_.wait(lock, [&]() { return numSetUp_ == numEnvs_; });
+  if (setUpFailed_) {
+    lock.unlock();
+    stop();
+    wait();
+    return false;
+  }
+  // the segment was zero filled when it was created
+  reinterpret_cast<std::atomic<uint32_t>*>(info_->data())
+      ->store(numEnvs_, std::memory_order_release);
+  LOG(INFO) << "SimulatorServer " << name_ << " serves " << numEnvs_
+            << " environments";
+  return true;
+}
+
+void SimulatorServer::wait() {
+  for (std::thread& thread : threads_) {
+    thread.join();
+  }
+  threads_.clear();
+  info_ = nullptr;
+}
+
+void SimulatorServer::stop() {
+  stopping_ = true;
+}
+
+void SimulatorServer::setUp(bool success) {
+  std::lock_guard<std::mutex> lock(setUpMutex_);
+  ++numSetUp_;
+  setUpFailed_ = setUpFailed_ || !success;
+  setUpDone_.notify_all();
+}
+
+void SimulatorServer::serve(int env) {
+  // the simulator is created on this thread, which its GL context is
+  // current on
+  SimulatorWithAgents simulator{cfg_};
+  for (const agent::AgentConfiguration& agentConfig : agentConfigs_) {
+    simulator.addAgent(agentConfig);
+  }
+  simulator.seed(core::Random(seed_).split(env).uniform_uint());
+  simulator.reset();
+
+  // every tensor observation of every agent, in the order of their suites
+  const int numAgents = agentConfigs_.size();
+  std::vector<ServerObservation> observations;
+  std::vector<sensor::Sensor*> sensors;
+  for (int agentId = 0; agentId < numAgents; ++agentId) {
+    for (auto& entry :
+         simulator.getAgent(agentId)->getSensorSuite().getSensors()) {
+      sensor::ObservationSpace space;
+      if (!entry.second->getObservationSpace(space) ||
+          space.spaceType != sensor::ObservationSpaceType::TENSOR ||
+          space.shape.size() > 4 || entry.first.size() >= 64) {
+        LOG(WARNING) << "SimulatorServer: sensor " << entry.first
+                     << " has no observations that can be served";
+        continue;
+      }
+      ServerObservation observation{};
+      std::strncpy(observation.sensorUuid, entry.first.c_str(),
+                   sizeof(observation.sensorUuid) - 1);
+      observation.agentId = agentId;
+      observation.dataType = space.dataType;
+      observation.numDims = space.shape.size();
+      observation.sizeInBytes = core::getDataTypeByteSize(space.dataType);
+      for (size_t i = 0; i < space.shape.size(); ++i) {
+        observation.shape[i] = space.shape[i];
+        observation.sizeInBytes *= space.shape[i];
+      }
+      observations.push_back(observation);
+      sensors.push_back(entry.second.get());
+    }
+  }
+  ServerChannel channel(ServerChannel::segmentName(name_, env), numAgents,
+                        observations, numFrames_);
+  if (!channel.isValid()) {
+    setUp(false);
+    return;
+  }
+  channel.setReady(true);
+  ++numServing_;
+  setUp(true);
+
+  std::vector<char> request(channel.getRequestBytes());
+  std::vector<int> actionIds(numAgents);
+  std::vector<std::map<std::string, sensor::Observation>> agentObservations(
+      numAgents);
+  std::vector<float> states;
+  uint32_t frameIndex = 0;
+  while (!stopping_) {
+    const void* message = channel.requests().beginRead(pollMicros);
+    if (message == nullptr) {
+      continue;
+    }
+    std::memcpy(request.data(), message, request.size());
+    channel.requests().endRead();
+    ServerRequest header;
+    std::memcpy(&header, request.data(), sizeof(header));
+    if (header.type == ServerRequestType::Stop) {
+      break;
+    }
+
+    ServerResponse response{header.id, frameIndex, 0};
+    if (header.type == ServerRequestType::Seed) {
+      simulator.seed(header.seed);
+      response.success = 1;
+    } else if (header.type == ServerRequestType::Reset ||
+               header.type == ServerRequestType::Step) {
+      // the sensors render and read back into the frame in place
+      char* frame = channel.frame(frameIndex);
+      for (size_t i = 0; i < sensors.size(); ++i) {
+        sensors[i]->setObservationBuffer(
+            frame + channel.getObservations()[i].offset,
+            channel.getObservations()[i].sizeInBytes);
+      }
+      bool success = true;
+      if (header.type == ServerRequestType::Reset) {
+        simulator.reset();
+        for (int agentId = 0; agentId < numAgents; ++agentId) {
+          simulator.getAgentObservations(agentId, agentObservations[agentId]);
+        }
+      } else {
+        std::memcpy(actionIds.data(), request.data() + sizeof(header),
+                    numAgents * sizeof(int32_t));
+        success = simulator.stepAgents(actionIds, agentObservations);
+      }
+      simulator.getAgentStates(states);
+      std::memcpy(channel.agentStates(frameIndex), states.data(),
+                  states.size() * sizeof(float));
+      response.success = success ? 1 : 0;
+      frameIndex = (frameIndex + 1) % channel.getNumFrames();
+    } else {
+      LOG(ERROR) << "SimulatorServer: unknown request "
+                 << static_cast<uint32_t>(header.type);
+    }
+
+    void* slot = nullptr;
+    while (slot == nullptr && !stopping_) {
+      slot = channel.responses().beginWrite(pollMicros);
+    }
+    if (slot != nullptr) {
+      std::memcpy(slot, &response, sizeof(response));
+      channel.responses().endWrite();
+    }
+  }
+  channel.setReady(false);
+  --numServing_;
+  // the sensors outlive the channel they render into
+  for (sensor::Sensor* sensor : sensors) {
+    sensor->resetObservationBuffer();
+  }
+}
+
+}  // namespace sim
+}  // namespace esp
@@ -0,0 +1,85 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "esp/agent/Agent.h"
+#include "esp/core/SharedMemory.h"
+#include "esp/gfx/Simulator.h"
+#include "esp/sim/ServerChannel.h"
+
+namespace esp {
+namespace sim {
+
+// Hosts numEnvs SimulatorWithAgents for clients in other processes, see
+// SimulatorClient. Each environment runs on a thread of its own with its own
+// GL context and serves the requests of its ServerChannel, rendering the
+// observations straight into the shared frames. The server also publishes a
+// segment named "/" + name holding the number of environments once they are
+// all serving, which is what clients wait for
+class SimulatorServer {
+ public:
+  //! Environments configured with cfg, each with an agent of every one of
+  //! agentConfigs, and seeded with streams of seed. Observations are kept in
+  //! numFrames frames per environment, see ServerChannel
+  SimulatorServer(const std::string& name,
+                  int numEnvs,
+                  const gfx::SimulatorConfiguration& cfg,
+                  const std::vector<agent::AgentConfiguration>& agentConfigs,
+                  uint32_t numFrames = 2,
+                  uint32_t seed = 0);
+  //! Stops serving
+  ~SimulatorServer();
+
+  //! Create the environments and start serving; returns once they all serve,
+  //! false, stopping the others, if one of them could not be set up
+  bool start();
+
+  //! Block until every environment got a Stop request or stop() is called
+  void wait();
+
+  //! Stop serving, within the polling interval of the environments
+  void stop();
+
+  int getNumEnvs() const { return numEnvs_; }
+  //! Environments that did not stop serving yet
+  int getNumServing() const { return numServing_; }
+  const std::string& getName() const { return name_; }
+
+ protected:
+  // body of the thread of environment env
+  void serve(int env);
+  // count an environment as set up, successfully or not
+  void setUp(bool success);
+
+  std::string name_;
+  int numEnvs_;
+  gfx::SimulatorConfiguration cfg_;
+  std::vector<agent::AgentConfiguration> agentConfigs_;
+  uint32_t numFrames_;
+  uint32_t seed_;
+
+  std::vector<std::thread> threads_;
+  std::atomic<bool> stopping_{false};
+  std::atomic<int> numServing_{0};
+  std::mutex setUpMutex_;
+  std::condition_variable setUpDone_;
+  int numSetUp_ = 0;
+  bool setUpFailed_ = false;
+  // the segment announcing the environments
+  core::SharedMemory::uptr info_;
+
+  ESP_SMART_POINTERS(SimulatorServer)
+};
+
+}  // namespace sim
+}  // namespace esp
@@ -3,11 +3,46 @@
 // LICENSE file in the root directory of this source tree.
 
 #include "SimulatorWithAgents.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <numeric>
+
+#include <Magnum/EigenIntegration/Integration.h>
+
+#include "esp/core/Arena.h"
+#include "esp/core/Metrics.h"
+#include "esp/core/ThreadPool.h"
+#include "esp/geo/geo.h"
 #include "esp/io/io.h"
+#include "esp/physics/PhysicsManager.h"
+#include "esp/sensor/PinholeCamera.h"
+
+using Magnum::EigenIntegration::cast;
 
 namespace esp {
 namespace sim {
 
+namespace {
+// height of the steps the physics body of an agent walks over, the default
+// agentMaxClimb of the navmesh settings
+constexpr float agentStepHeight = 0.2f;
+
+core::Counter& stepsTotal() {
+  static core::Counter& counter = core::MetricsRegistry::get().counter(
+      "habitat_steps_total", "Steps of the agents, synchronous and async");
+  return counter;
+}
+
+core::Histogram& stepSeconds() {
+  static core::Histogram& histogram = core::MetricsRegistry::get().histogram(
+      "habitat_step_seconds",
+      "Time of a synchronous step, acting, rendering and reading back");
+  return histogram;
+}
+}  // namespace
+
 SimulatorWithAgents::SimulatorWithAgents(const gfx::SimulatorConfiguration& cfg)
     : gfx::Simulator() {
   // NOTE: NOT SO GREAT NOW THAT WE HAVE virtual functions
@@ -20,9 +55,17 @@ SimulatorWithAgents::~SimulatorWithAgents() {}
 void SimulatorWithAgents::seed(uint32_t newSeed) {
   gfx::Simulator::seed(newSeed);
   pathfinder_->seed(newSeed);
+  // a stream per agent, so that the noise of an agent does not depend on how
+  // many numbers the others or the simulator draw
+  for (int iAgent = 0; iAgent < agents_.size(); ++iAgent) {
+    agents_[iAgent]->getControls()->setRandom(random_.split(iAgent));
+  }
 }
 
 void SimulatorWithAgents::reset() {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  // the frames of steps in flight are from before the reset
+  pendingSteps_.clear();
   // connect controls to navmesh if loaded
   gfx::Simulator::reset();
 
@@ -38,6 +81,7 @@ void SimulatorWithAgents::reset() {
 }
 
 void SimulatorWithAgents::reconfigure(const gfx::SimulatorConfiguration& cfg) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
   LOG(INFO) << "SimulatorWithAgents::reconfigure";
   if (cfg == config_) {
     reset();
@@ -51,6 +95,7 @@ void SimulatorWithAgents::reconfigure(const gfx::SimulatorConfiguration& cfg) {
 
   // create pathfinder and load navmesh if available
   pathfinder_ = nav::PathFinder::create();
+  pathFinderShare_ = nullptr;
   std::string navmeshFilename = io::changeExtension(sceneFilename, ".navmesh");
   if (cfg.scene.filepaths.count("navmesh")) {
     navmeshFilename = cfg.scene.filepaths.at("navmesh");
@@ -66,6 +111,52 @@ void SimulatorWithAgents::reconfigure(const gfx::SimulatorConfiguration& cfg) {
   gfx::Simulator::reconfigure(cfg);
 }
 
+std::shared_ptr<gfx::Simulator> SimulatorWithAgents::clone() {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  SimulatorWithAgents::ptr fork{new SimulatorWithAgents()};
+  fork->cloneFrom(*this);
+  return fork;
+}
+
+void SimulatorWithAgents::cloneFrom(gfx::Simulator& source) {
+  gfx::Simulator::cloneFrom(source);
+  SimulatorWithAgents& sourceSim = static_cast<SimulatorWithAgents&>(source);
+  pathfinder_ = sourceSim.pathfinder_;
+  if (!sourceSim.pathFinderShare_) {
+    sourceSim.pathFinderShare_ = std::make_shared<int>(0);
+  }
+  pathFinderShare_ = sourceSim.pathFinderShare_;
+  maxStepsInFlight_ = sourceSim.maxStepsInFlight_;
+
+  agent::AgentState::ptr state = agent::AgentState::create();
+  for (const agent::Agent::ptr& sourceAgent : sourceSim.agents_) {
+    agent::Agent::ptr fork = addAgent(sourceAgent->getConfig());
+    sourceAgent->getState(state);
+    fork->setState(*state, /* resetSensors = */ false);
+    fork->getControls()->setRandom(sourceAgent->getControls()->getRandom());
+    const std::map<std::string, sensor::Sensor::ptr>& forkSensors =
+        fork->getSensorSuite().getSensors();
+    for (const auto& sensor : sourceAgent->getSensorSuite().getSensors()) {
+      auto forkSensor = forkSensors.find(sensor.first);
+      if (forkSensor != forkSensors.end()) {
+        const scene::SceneNode& node = sensor.second->node();
+        forkSensor->second->node()
+            .setTranslation(node.translation())
+            .setRotation(node.rotation())
+            .setScaling(node.scaling());
+        // the noise continues where the source is rather than from the start
+        auto* camera =
+            dynamic_cast<sensor::PinholeCamera*>(sensor.second.get());
+        auto* forkCamera =
+            dynamic_cast<sensor::PinholeCamera*>(forkSensor->second.get());
+        if (camera != nullptr && forkCamera != nullptr) {
+          forkCamera->setNoiseRandom(camera->getNoiseRandom());
+        }
+      }
+    }
+  }
+}
+
 // Agents
 void SimulatorWithAgents::sampleRandomAgentState(
     agent::AgentState::ptr agentState) {
@@ -87,14 +178,16 @@ agent::Agent::ptr SimulatorWithAgents::addAgent(
 
   auto& agentNode = agentParentNode.createChild();
   agent::Agent::ptr ag = agent::Agent::create(agentNode, agentConfig);
+  ag->getControls()->setRandom(random_.split(agents_.size()));
   agents_.push_back(ag);
-  // TODO: just do this once
-  if (pathfinder_->isLoaded()) {
-    ag->getControls()->setMoveFilterFunction(
-        [&](const vec3f& start, const vec3f& end) {
-          return pathfinder_->tryStep(start, end);
-        });
-  }
+  // the active pathfinder, also after a reconfigure loads another navmesh
+  ag->getControls()->setMoveFilterFunction(
+      [this](const vec3f& start, const vec3f& end) {
+        if (!config_.navMeshMoveFilter || !pathfinder_->isLoaded()) {
+          return end;
+        }
+        return pathfinder_->tryStep(start, end);
+      });
 
   return ag;
 }
@@ -108,10 +201,93 @@ agent::Agent::ptr SimulatorWithAgents::getAgent(int agentId) {
   return agents_[agentId];
 }
 
+constexpr int SimulatorWithAgents::agentStateSize;
+
+void SimulatorWithAgents::getAgentStates(std::vector<float>& states) {
+  states.resize(agents_.size() * agentStateSize);
+  agent::AgentState::ptr state = agent::AgentState::create();
+  for (int iAgent = 0; iAgent < agents_.size(); ++iAgent) {
+    agents_[iAgent]->getState(state);
+    Eigen::Map<vec3f>(&states[iAgent * agentStateSize]) = state->position;
+    Eigen::Map<vec4f>(&states[iAgent * agentStateSize + 3]) = state->rotation;
+  }
+}
+
+bool SimulatorWithAgents::setAgentStates(const std::vector<float>& states,
+                                         bool resetSensors /* = true */) {
+  if (states.size() != agents_.size() * agentStateSize) {
+    LOG(ERROR) << "Got " << states.size() << " state values for "
+               << agents_.size() << " agents, expected " << agentStateSize
+               << " per agent";
+    return false;
+  }
+  // same tolerance as Agent::setState()
+  const float epsilon = 2.0f * Magnum::Math::TypeTraits<float>::epsilon();
+  for (int iAgent = 0; iAgent < agents_.size(); ++iAgent) {
+    const Eigen::Map<const vec4f> rotation(
+        &states[iAgent * agentStateSize + 3]);
+    if (std::abs(rotation.norm() - 1.0f) >= epsilon) {
+      LOG(ERROR) << "Rotation " << rotation.transpose() << " of agent "
+                 << iAgent << " is not a valid rotation";
+      return false;
+    }
+  }
+
+  agent::AgentState state;
+  for (int iAgent = 0; iAgent < agents_.size(); ++iAgent) {
+    state.position =
+        Eigen::Map<const vec3f>(&states[iAgent * agentStateSize]);
+    state.rotation =
+        Eigen::Map<const vec4f>(&states[iAgent * agentStateSize + 3]);
+    agents_[iAgent]->setState(state, resetSensors);
+  }
+  return true;
+}
+
+bool SimulatorWithAgents::setAgentPositions(
+    const std::vector<float>& positions) {
+  if (positions.size() != agents_.size() * 3) {
+    LOG(ERROR) << "Got " << positions.size() << " position values for "
+               << agents_.size() << " agents";
+    return false;
+  }
+  for (int iAgent = 0; iAgent < agents_.size(); ++iAgent) {
+    agents_[iAgent]->setPosition(
+        Eigen::Map<const vec3f>(&positions[iAgent * 3]));
+  }
+  return true;
+}
+
 nav::PathFinder::ptr SimulatorWithAgents::getPathFinder() {
   return pathfinder_;
 }
 
+bool SimulatorWithAgents::updateNavMeshObstacle(const int objectID,
+                                                const int sceneID) {
+  if (physicsManager_ == nullptr || !sceneManager_.hasSceneGraph(sceneID)) {
+    return false;
+  }
+  if (isNavMeshShared()) {
+    LOG(ERROR) << "SimulatorWithAgents::updateNavMeshObstacle: the navmesh is "
+                  "shared with a fork and read only";
+    return false;
+  }
+  assets::MeshData mesh;
+  if (!physicsManager_->getObjectCollisionMesh(objectID, mesh)) {
+    return false;
+  }
+  return pathfinder_->updateObstacle(objectID, mesh);
+}
+
+bool SimulatorWithAgents::removeNavMeshObstacle(const int objectID) {
+  if (isNavMeshShared()) {
+    LOG(ERROR) << "SimulatorWithAgents::removeNavMeshObstacle: the navmesh is "
+                  "shared with a fork and read only";
+    return false;
+  }
+  return pathfinder_->removeObstacle(objectID);
+}
+
 bool SimulatorWithAgents::getAgentObservation(
     int agentId,
     const std::string& sensorId,
@@ -120,7 +296,13 @@ bool SimulatorWithAgents::getAgentObservation(
   if (ag != nullptr) {
     sensor::Sensor::ptr sensor = ag->getSensorSuite().get(sensorId);
     if (sensor != nullptr) {
-      return sensor->getObservation(*this, observation);
+      if (!sensor->getObservation(*this, observation)) {
+        return false;
+      }
+      if (sensor->hasObservationEncoding()) {
+        sensor->encodeObservation(observation);
+      }
+      return true;
     }
   }
   return false;
@@ -129,19 +311,444 @@ bool SimulatorWithAgents::getAgentObservation(
 int SimulatorWithAgents::getAgentObservations(
     int agentId,
     std::map<std::string, sensor::Observation>& observations) {
-  observations.clear();
-  agent::Agent::ptr ag = getAgent(agentId);
-  if (ag != nullptr) {
+  // scratch of the observations, released on return
+  core::ArenaScope scope;
+  // hand the map of the caller through, so that a map reused across steps
+  // keeps its entries
+  getAgentsObservations(&agentId, 1, &observations);
+  return observations.size();
+}
+
+bool SimulatorWithAgents::stepAgents(
+    const std::vector<int>& actionIds,
+    std::vector<std::map<std::string, sensor::Observation>>& observations) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  core::HistogramTimer stepTimer(stepSeconds());
+  // scratch of the step, released at its end; the arena keeps its memory,
+  // so that steady-state steps do not allocate it again
+  core::ArenaScope scope;
+  if (!actAgents(actionIds)) {
+    return false;
+  }
+  if (core::MetricsRegistry::get().isEnabled()) {
+    stepsTotal().add();
+  }
+  if (recording_ != nullptr) {
+    recordStep(actionIds);
+  }
+  core::ArenaVector<int> agentIds(agents_.size());
+  std::iota(agentIds.begin(), agentIds.end(), 0);
+  observations.resize(agentIds.size());
+  getAgentsObservations(agentIds.data(), agentIds.size(), observations.data());
+  return true;
+}
+
+int SimulatorWithAgents::stepAsync(const std::vector<int>& actionIds) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  core::ArenaScope scope;
+  if (pendingSteps_.size() >= maxStepsInFlight_) {
+    LOG(ERROR) << "SimulatorWithAgents::stepAsync: " << pendingSteps_.size()
+               << " steps are in flight already";
+    return ID_UNDEFINED;
+  }
+  // every visual sensor of every step in flight holds a slot of the ring
+  int numVisualSensors = 0;
+  for (const agent::Agent::ptr& agent : agents_) {
+    for (const auto& sensor : agent->getSensorSuite().getSensors()) {
+      numVisualSensors += sensor.second->isVisualSensor();
+    }
+  }
+  if (numVisualSensors > 0 && getRenderer() != nullptr) {
+    const int numFrames = maxStepsInFlight_ * numVisualSensors;
+    if (renderer_->getAsyncReadbackFrames() < numFrames) {
+      if (!pendingSteps_.empty()) {
+        LOG(ERROR) << "SimulatorWithAgents::stepAsync: sensors were added "
+                      "while steps are in flight";
+        return ID_UNDEFINED;
+      }
+      renderer_->setAsyncReadbackFrames(numFrames);
+    }
+  }
+  if (!actAgents(actionIds)) {
+    return ID_UNDEFINED;
+  }
+  if (core::MetricsRegistry::get().isEnabled()) {
+    stepsTotal().add();
+  }
+  if (recording_ != nullptr) {
+    recordStep(actionIds);
+  }
+
+  pendingSteps_.emplace_back();
+  PendingStep& step = pendingSteps_.back();
+  step.handle = nextStepHandle_++;
+  step.observations.resize(agents_.size());
+  core::ArenaVector<int> agentIds(agents_.size());
+  std::iota(agentIds.begin(), agentIds.end(), 0);
+  getAgentsObservations(agentIds.data(), agentIds.size(),
+                        step.observations.data(), &step);
+  return step.handle;
+}
+
+bool SimulatorWithAgents::stepWait(
+    int handle,
+    std::vector<std::map<std::string, sensor::Observation>>& observations) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  while (!pendingSteps_.empty() && pendingSteps_.front().handle < handle) {
+    pendingSteps_.pop_front();
+  }
+  if (pendingSteps_.empty() || pendingSteps_.front().handle != handle) {
+    LOG(ERROR) << "SimulatorWithAgents::stepWait: step " << handle
+               << " is not in flight";
+    return false;
+  }
+  PendingStep& step = pendingSteps_.front();
+  bool success = true;
+  // assigning the maps reuses their entries
+  observations.resize(step.observations.size());
+  for (int iAgent = 0; iAgent < step.observations.size(); ++iAgent) {
+    observations[iAgent] = step.observations[iAgent];
+  }
+  for (const PendingStep::Readback& readback : step.readbacks) {
+    sensor::Observation obs;
+    if (readback.sensor->waitBatchObservation(*this, readback.ticket, obs)) {
+      observations[readback.agent][readback.sensorId] = obs;
+    } else {
+      observations[readback.agent].erase(readback.sensorId);
+      success = false;
+    }
+  }
+  core::ArenaScope scope;
+  core::ArenaVector<int> agentIds(observations.size());
+  std::iota(agentIds.begin(), agentIds.end(), 0);
+  encodeAgentsObservations(agentIds.data(), agentIds.size(),
+                           observations.data());
+  pendingSteps_.pop_front();
+  return success;
+}
+
+void SimulatorWithAgents::setMaxStepsInFlight(int numSteps) {
+  ASSERT(numSteps >= 1);
+  maxStepsInFlight_ = numSteps;
+}
+
+std::vector<int> SimulatorWithAgents::getNumAgentSensors() const {
+  std::vector<int> numAgentSensors;
+  numAgentSensors.reserve(agents_.size());
+  for (const agent::Agent::ptr& agent : agents_) {
+    numAgentSensors.push_back(agent->getSensorSuite().getSensors().size());
+  }
+  return numAgentSensors;
+}
+
+void SimulatorWithAgents::startRecording() {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  recording_ = EpisodeRecording::create(getNumAgentSensors());
+  recordStep(std::vector<int>(agents_.size(), ID_UNDEFINED));
+}
+
+EpisodeRecording::ptr SimulatorWithAgents::stopRecording() {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  EpisodeRecording::ptr recording = std::move(recording_);
+  recording_ = nullptr;
+  return recording;
+}
+
+bool SimulatorWithAgents::recordStep(const std::vector<int>& actionIds) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  if (recording_ == nullptr) {
+    LOG(ERROR) << "SimulatorWithAgents::recordStep: not recording";
+    return false;
+  }
+  if (recording_->getNumAgentSensors() != getNumAgentSensors()) {
+    LOG(ERROR) << "SimulatorWithAgents::recordStep: agents or sensors were "
+                  "added since the recording started";
+    return false;
+  }
+  captureStep(actionIds, recordedStep_);
+  return recording_->append(recordedStep_);
+}
+
+void SimulatorWithAgents::captureStep(const std::vector<int>& actionIds,
+                                      EpisodeStep& step) {
+  step.actionIds = actionIds;
+  step.agentPoses.clear();
+  auto appendPose = [&step](const scene::SceneNode& node) {
+    const Magnum::Vector3 translation = node.translation();
+    const Magnum::Quaternion rotation = node.rotation();
+    step.agentPoses.insert(
+        step.agentPoses.end(),
+        {translation.x(), translation.y(), translation.z(),
+         rotation.vector().x(), rotation.vector().y(), rotation.vector().z(),
+         rotation.scalar()});
+  };
+  for (const agent::Agent::ptr& agent : agents_) {
+    appendPose(agent->node());
+    for (const auto& sensor : agent->getSensorSuite().getSensors()) {
+      appendPose(sensor.second->node());
+    }
+  }
+
+  step.worldTime = 0.0;
+  step.objectIDs.clear();
+  step.objectTransformations.clear();
+  physics::PhysicsManager* world = getPhysicsWorld(activeSceneID_);
+  if (world == nullptr) {
+    return;
+  }
+  step.worldTime = world->getWorldTime();
+  step.objectIDs = world->getExistingObjectIDs();
+  for (const Magnum::Matrix4& transformation :
+       world->getTransformations(step.objectIDs)) {
+    for (int col = 0; col < 4; ++col) {
+      for (int row = 0; row < 3; ++row) {
+        step.objectTransformations.push_back(transformation[col][row]);
+      }
+    }
+  }
+}
+
+bool SimulatorWithAgents::startReplay(EpisodeRecording::ptr recording) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  if (recording->getNumAgentSensors() != getNumAgentSensors()) {
+    LOG(ERROR) << "SimulatorWithAgents::startReplay: the recording has other "
+                  "agents or sensors than the simulator";
+    return false;
+  }
+  replay_ = std::move(recording);
+  replayOffset_ = 0;
+  replayedStep_ = EpisodeStep{};
+  return true;
+}
+
+bool SimulatorWithAgents::replayStep(
+    std::vector<std::map<std::string, sensor::Observation>>& observations,
+    EpisodeStep* step /* = nullptr */) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  core::ArenaScope scope;
+  if (replay_ == nullptr ||
+      replay_->getNumAgentSensors() != getNumAgentSensors() ||
+      !replay_->readStep(replayOffset_, replayedStep_)) {
+    return false;
+  }
+  const EpisodeStep& replayed = replayedStep_;
+  physics::PhysicsManager* world = getPhysicsWorld(activeSceneID_);
+  for (const int objectID : replayed.objectIDs) {
+    if (world == nullptr || !world->hasObject(objectID)) {
+      LOG(ERROR) << "SimulatorWithAgents::replayStep: no physics object with "
+                    "ID "
+                 << objectID;
+      return false;
+    }
+  }
+
+  const float* pose = replayed.agentPoses.data();
+  auto applyPose = [&pose](scene::SceneNode& node) {
+    node.setTranslation(Magnum::Vector3{pose[0], pose[1], pose[2]});
+    node.setRotation(Magnum::Quaternion{{pose[3], pose[4], pose[5]}, pose[6]});
+    pose += EpisodeRecording::poseSize;
+  };
+  for (const agent::Agent::ptr& agent : agents_) {
+    applyPose(agent->node());
+    for (const auto& sensor : agent->getSensorSuite().getSensors()) {
+      applyPose(sensor.second->node());
+    }
+  }
+  if (!replayed.objectIDs.empty()) {
+    std::vector<Magnum::Matrix4> transformations(replayed.objectIDs.size());
+    const float* values = replayed.objectTransformations.data();
+    for (Magnum::Matrix4& transformation : transformations) {
+      for (int col = 0; col < 4; ++col) {
+        for (int row = 0; row < 3; ++row) {
+          transformation[col][row] = *values++;
+        }
+      }
+    }
+    world->setTransformations(replayed.objectIDs, transformations);
+  }
+
+  core::ArenaVector<int> agentIds(agents_.size());
+  std::iota(agentIds.begin(), agentIds.end(), 0);
+  observations.resize(agentIds.size());
+  getAgentsObservations(agentIds.data(), agentIds.size(), observations.data());
+  if (step != nullptr) {
+    *step = replayed;
+  }
+  return true;
+}
+
+bool SimulatorWithAgents::actAgents(const std::vector<int>& actionIds) {
+  if (actionIds.size() != agents_.size()) {
+    LOG(ERROR) << "Got " << actionIds.size() << " actions for "
+               << agents_.size() << " agents";
+    return false;
+  }
+  for (int iAgent = 0; iAgent < agents_.size(); ++iAgent) {
+    const int actionId = actionIds[iAgent];
+    if (actionId != ID_UNDEFINED &&
+        (actionId < 0 || actionId >= agents_[iAgent]->getNumActions())) {
+      LOG(ERROR) << "Invalid action " << actionId << " for agent " << iAgent;
+      return false;
+    }
+  }
+
+  core::ArenaVector<int> movedIds;
+  core::ArenaVector<vec3f> starts;
+  movedIds.reserve(agents_.size());
+  starts.reserve(agents_.size());
+  for (int iAgent = 0; iAgent < agents_.size(); ++iAgent) {
+    if (actionIds[iAgent] != ID_UNDEFINED) {
+      const vec3f start = cast<vec3f>(agents_[iAgent]->node().translation());
+      agents_[iAgent]->act(actionIds[iAgent]);
+      movedIds.push_back(iAgent);
+      starts.push_back(start);
+    }
+  }
+  if (config_.agentPhysicsBodies) {
+    resolveAgentMoves(movedIds.data(), starts.data(), movedIds.size());
+  }
+  return true;
+}
+
+void SimulatorWithAgents::resolveAgentMoves(const int* agentIds,
+                                            const vec3f* starts,
+                                            size_t numAgents) {
+  physics::PhysicsManager* world = getPhysicsWorld(activeSceneID_);
+  if (world == nullptr) {
+    return;
+  }
+  // the capsule floats agentStepHeight above the feet of the agent, so that
+  // it clears the floor and the steps the navmesh climbs, which keeps the
+  // height of the agent
+  core::ArenaVector<physics::CharacterMove> moves(numAgents);
+  core::ArenaVector<float> centerHeights(numAgents);
+  for (int i = 0; i < numAgents; ++i) {
+    agent::Agent& agent = *agents_[agentIds[i]];
+    const agent::AgentConfiguration& config = agent.getConfig();
+    const float bodyHeight = std::max(config.height - agentStepHeight, 0.0f);
+    physics::CharacterMove& move = moves[i];
+    move.shape.radius = config.radius;
+    move.shape.halfHeight = std::max(0.5f * bodyHeight - config.radius, 0.0f);
+    move.mass = config.mass;
+    centerHeights[i] = config.height - 0.5f * bodyHeight;
+    const Magnum::Vector3 up = Magnum::Vector3(geo::ESP_UP) * centerHeights[i];
+    move.start = Magnum::Vector3(starts[i]) + up;
+    move.end = agent.node().translation() + up;
+  }
+  world->moveCharacters(moves.data(), numAgents, world->getTimestep());
+  for (int i = 0; i < numAgents; ++i) {
+    const physics::CharacterMove& move = moves[i];
+    agents_[agentIds[i]]->resolveMove(
+        cast<vec3f>(move.position) - geo::ESP_UP * centerHeights[i],
+        move.collided);
+  }
+}
+
+void SimulatorWithAgents::getAgentsObservations(
+    const int* agentIds,
+    size_t numAgents,
+    std::map<std::string, sensor::Observation>* observations,
+    PendingStep* pending /* = nullptr */) {
+  // the maps are reused: entries of sensors that still exist are overwritten
+  // in place, and only stale ones are erased
+
+  // visual sensors are rendered together in a single batch; everything
+  // else produces its observation on its own. The batch lives in the arena
+  // of the step and refers to the ids of the sensor suites, only the vectors
+  // handed to the renderer are members that keep their capacity
+  core::ArenaVector<const std::pair<const std::string, sensor::Sensor::ptr>*>
+      batchEntries;
+  core::ArenaVector<int> batchAgents;
+  std::vector<sensor::Sensor*>& batchSensors = batchSensors_;
+  std::vector<scene::SceneGraph*>& batchSceneGraphs = batchSceneGraphs_;
+  batchSensors.clear();
+  batchSceneGraphs.clear();
+  for (int i = 0; i < numAgents; ++i) {
+    agent::Agent::ptr ag = getAgent(agentIds[i]);
+    if (ag == nullptr) {
+      observations[i].clear();
+      continue;
+    }
     const std::map<std::string, sensor::Sensor::ptr>& sensors =
         ag->getSensorSuite().getSensors();
-    for (std::pair<std::string, sensor::Sensor::ptr> s : sensors) {
+    for (auto it = observations[i].begin(); it != observations[i].end();) {
+      it = sensors.count(it->first) ? std::next(it) : observations[i].erase(it);
+    }
+    for (const std::pair<const std::string, sensor::Sensor::ptr>& s :
+         sensors) {
+      scene::SceneGraph* sceneGraph = nullptr;
+      if (s.second->isVisualSensor() && getRenderer() != nullptr) {
+        sceneGraph = s.second->getObservedSceneGraph(*this);
+      }
+      if (sceneGraph != nullptr) {
+        batchEntries.push_back(&s);
+        batchAgents.push_back(i);
+        batchSensors.push_back(s.second.get());
+        batchSceneGraphs.push_back(sceneGraph);
+        continue;
+      }
       sensor::Observation obs;
       if (s.second->getObservation(*this, obs)) {
-        observations[s.first] = obs;
+        observations[i][s.first] = obs;
+      } else {
+        observations[i].erase(s.first);
       }
     }
   }
-  return observations.size();
+
+  if (!batchSensors.empty()) {
+    renderer_->drawBatch(batchSensors, batchSceneGraphs);
+    for (int iSensor = 0; iSensor < batchSensors.size(); ++iSensor) {
+      const std::string& sensorId = batchEntries[iSensor]->first;
+      if (pending != nullptr) {
+        const int ticket =
+            batchSensors[iSensor]->readBatchObservationAsync(*this, iSensor);
+        if (ticket != ID_UNDEFINED) {
+          pending->readbacks.push_back({batchAgents[iSensor], sensorId,
+                                        batchEntries[iSensor]->second,
+                                        ticket});
+          continue;
+        }
+      }
+      sensor::Observation obs;
+      if (batchSensors[iSensor]->readBatchObservation(*this, iSensor, obs)) {
+        observations[batchAgents[iSensor]][sensorId] = obs;
+      } else {
+        observations[batchAgents[iSensor]].erase(sensorId);
+      }
+    }
+  }
+  // the observations of a step in flight are encoded once complete
+  if (pending == nullptr) {
+    encodeAgentsObservations(agentIds, numAgents, observations);
+  }
+}
+
+void SimulatorWithAgents::encodeAgentsObservations(
+    const int* agentIds,
+    size_t numAgents,
+    std::map<std::string, sensor::Observation>* observations) {
+  core::ArenaVector<std::pair<sensor::Sensor*, sensor::Observation*>> encodes;
+  for (int i = 0; i < numAgents; ++i) {
+    agent::Agent::ptr ag = getAgent(agentIds[i]);
+    if (ag == nullptr) {
+      continue;
+    }
+    const std::map<std::string, sensor::Sensor::ptr>& sensors =
+        ag->getSensorSuite().getSensors();
+    for (std::pair<const std::string, sensor::Observation>& obs :
+         observations[i]) {
+      auto sensor = sensors.find(obs.first);
+      if (sensor != sensors.end() && sensor->second->hasObservationEncoding()) {
+        encodes.emplace_back(sensor->second.get(), &obs.second);
+      }
+    }
+  }
+  // each sensor writes into its own encoded buffer, so that the sensors can
+  // compress at once
+  core::parallelFor(encodes.size(), 0, [&encodes](size_t i) {
+    encodes[i].first->encodeObservation(*encodes[i].second);
+  });
 }
 
 bool SimulatorWithAgents::getAgentObservationSpace(
@@ -4,10 +4,13 @@
 
 #pragma once
 
+#include <deque>
+
 #include "esp/gfx/Simulator.h"
 
 #include "esp/agent/Agent.h"
 #include "esp/nav/PathFinder.h"
+#include "esp/sim/EpisodeRecording.h"
 
 namespace esp {
 namespace sim {
@@ -18,6 +21,11 @@ class SimulatorWithAgents : public gfx::Simulator {
   virtual ~SimulatorWithAgents();
 
   virtual void reconfigure(const gfx::SimulatorConfiguration& cfg) override;
+  //! A SimulatorWithAgents fork, see gfx::Simulator::clone(), that also has
+  //! copies of the agents, with their states, sensor poses and the streams
+  //! of their noisy moves and sensor noise, and shares the PathFinder, whose
+  //! navmesh then is read only in both, see isNavMeshShared()
+  virtual std::shared_ptr<gfx::Simulator> clone() override;
   virtual void reset() override;
   virtual void seed(uint32_t newSeed) override;
 
@@ -29,12 +37,97 @@ class SimulatorWithAgents : public gfx::Simulator {
                              scene::SceneNode& agentParentNode);
   agent::Agent::ptr addAgent(const agent::AgentConfiguration& agentConfig);
 
+  //! Floats per agent in getAgentStates() and setAgentStates(): the position,
+  //! then the rotation coefficients x, y, z, w
+  static constexpr int agentStateSize = 7;
+
+  //! States of all agents at once, agentStateSize floats per agent in the
+  //! order they were added
+  void getAgentStates(std::vector<float>& states);
+
+  //! Set the states of all agents at once from states laid out like in
+  //! getAgentStates(), see Agent::setState(). Returns false, changing no
+  //! agent, if states does not hold one state per agent or a rotation is not
+  //! a unit quaternion
+  bool setAgentStates(const std::vector<float>& states,
+                      bool resetSensors = true);
+
+  //! Teleport all agents at once to positions, 3 floats per agent, leaving
+  //! their rotations and sensors as they are, see Agent::setPosition().
+  //! Returns false, moving no agent, if there is not one position per agent
+  bool setAgentPositions(const std::vector<float>& positions);
+
   bool getAgentObservation(int agentId,
                            const std::string& sensorId,
                            sensor::Observation& observation);
+  //! Fill observations with one entry per sensor of the agent; pass the same
+  //! map every step to have its entries and their buffers reused
   int getAgentObservations(
       int agentId,
       std::map<std::string, sensor::Observation>& observations);
+
+  //! Take action actionIds[i] with agent i, for all agents at once, by action
+  //! index (see Agent::getActionId(), ID_UNDEFINED to leave an agent be), and
+  //! get the observations of all agents, rendering every visual sensor in one
+  //! batch. Like in getAgentObservations(), the maps of observations are
+  //! reused. Returns false without acting if actionIds does not hold a valid
+  //! index for each agent
+  bool stepAgents(
+      const std::vector<int>& actionIds,
+      std::vector<std::map<std::string, sensor::Observation>>& observations);
+
+  //! Like stepAgents(), but return as soon as the agents acted and their
+  //! visual sensors were drawn, with a handle to collect the observations
+  //! with stepWait(). The GPU renders the step and reads its frames back
+  //! through the asynchronous readback ring of the renderer meanwhile, so
+  //! the caller, e.g. a policy, runs while the GPU is busy, and the next
+  //! step can act while this one is still transferring. At most
+  //! getMaxStepsInFlight() steps are in flight; other readbacks through the
+  //! ring in between, like Renderer::renderPoses(), recycle their frames.
+  //! Returns ID_UNDEFINED if actionIds is invalid or too many steps are in
+  //! flight
+  int stepAsync(const std::vector<int>& actionIds);
+
+  //! Wait for the step of handle and fill observations as stepAgents()
+  //! does. Steps complete in order: waiting for one drops the steps before
+  //! it, whose handles become invalid. All steps write into the buffers of
+  //! the sensors, which hold the step waited for last. Returns false for an
+  //! unknown handle or if a frame of the step was recycled
+  bool stepWait(
+      int handle,
+      std::vector<std::map<std::string, sensor::Observation>>& observations);
+
+  //! Steps stepAsync() keeps in flight at most, 2 by default
+  void setMaxStepsInFlight(int numSteps);
+  int getMaxStepsInFlight() const { return maxStepsInFlight_; }
+
+  //! Start recording the episode into a new EpisodeRecording: the state of
+  //! the agents, their sensors and the physics objects of the active scene
+  //! now, then after every step of stepAgents() and stepAsync()
+  void startRecording();
+  //! Stop recording and return the recording, nullptr if not recording
+  EpisodeRecording::ptr stopRecording();
+  bool isRecording() const { return recording_ != nullptr; }
+  //! Append actionIds and the state they left the simulator in to the
+  //! recording, for loops that act and step physics on their own, e.g. from
+  //! Python. Returns false if not recording or agents or sensors were added
+  //! since it started
+  bool recordStep(const std::vector<int>& actionIds);
+
+  //! Replay recording from its first step with replayStep(). The agents and
+  //! sensors have to be the ones it was recorded with, and its physics
+  //! objects have to exist with the same IDs, as for restorePhysicsState().
+  //! Returns false if the agents or sensors do not match
+  bool startReplay(EpisodeRecording::ptr recording);
+  //! Put the agents, sensors and physics objects where the next step of the
+  //! replay left them and render their observations as stepAgents() does,
+  //! without actions, physics or a policy, so that replaying costs only the
+  //! rendering. step, if given, receives the recorded step. Returns false
+  //! after the last step, for corrupted data or if an object is missing
+  bool replayStep(
+      std::vector<std::map<std::string, sensor::Observation>>& observations,
+      EpisodeStep* step = nullptr);
+
   bool getAgentObservationSpace(int agentId,
                                 const std::string& sensorId,
                                 sensor::ObservationSpace& space);
@@ -42,11 +135,96 @@ class SimulatorWithAgents : public gfx::Simulator {
       int agentId,
       std::map<std::string, sensor::ObservationSpace>& spaces);
 
-  nav::PathFinder::ptr getPathFinder();
+  virtual nav::PathFinder::ptr getPathFinder() override;
+
+  //! Cut the collision mesh of physics object objectID, at its current
+  //! transformation, into the navmesh. Call again after moving the object;
+  //! only the tiles it overlaps are rebuilt. Needs a tiled navmesh built by
+  //! the PathFinder, see PathFinder::updateObstacle. Fails while the navmesh
+  //! is shared, see isNavMeshShared()
+  bool updateNavMeshObstacle(const int objectID, const int sceneID = 0);
+  //! Restore the navmesh under a removed physics object
+  bool removeNavMeshObstacle(const int objectID);
+  //! Whether a fork of clone(), or the simulator this one is a fork of, is
+  //! alive and shares the navmesh, which then is read only
+  bool isNavMeshShared() const { return pathFinderShare_.use_count() > 1; }
 
  protected:
+  SimulatorWithAgents() {}
+
+  virtual void cloneFrom(gfx::Simulator& source) override;
+
+  // a step of stepAsync() whose frames are in flight
+  struct PendingStep {
+    // the visual sensor of agent whose frame transfers in ticket
+    struct Readback {
+      int agent;
+      std::string sensorId;
+      sensor::Sensor::ptr sensor;
+      int ticket;
+    };
+    int handle;
+    // per agent, the observations that were read right away
+    std::vector<std::map<std::string, sensor::Observation>> observations;
+    std::vector<Readback> readbacks;
+  };
+
+  //! Validate actionIds, one per agent, and take them, see stepAgents()
+  bool actAgents(const std::vector<int>& actionIds);
+
+  //! Observations of each of agentIds, with the visual sensors of all of them
+  //! rendered in a single batch. If pending is given, the frames of the batch
+  //! are queued for readback in it instead of read, where the sensors can
+  void getAgentsObservations(
+      const int* agentIds,
+      size_t numAgents,
+      std::map<std::string, sensor::Observation>* observations,
+      PendingStep* pending = nullptr);
+
+  //! Compress the observations of the sensors of agentIds whose encoding has
+  //! a codec, on the threads of the global pool, see
+  //! Sensor::encodeObservation()
+  void encodeAgentsObservations(
+      const int* agentIds,
+      size_t numAgents,
+      std::map<std::string, sensor::Observation>* observations);
+
+  //! Capture actionIds and the state of the agents, their sensors and the
+  //! physics objects of the active scene into step
+  void captureStep(const std::vector<int>& actionIds, EpisodeStep& step);
+  //! Number of sensors of each agent, in the order of addAgent()
+  std::vector<int> getNumAgentSensors() const;
+
+  //! Resolve the moves of agentIds from starts, where they were before
+  //! acting, against the physics world of the active scene in one batch, see
+  //! SimulatorConfiguration::agentPhysicsBodies
+  void resolveAgentMoves(const int* agentIds,
+                         const vec3f* starts,
+                         size_t numAgents);
+
   std::vector<agent::Agent::ptr> agents_;
   nav::PathFinder::ptr pathfinder_;
+  // held by the simulators sharing pathfinder_ through clone(), null if it
+  // never was. Counting these rather than the owners of pathfinder_ leaves
+  // out the references of users, e.g. the Python Simulator
+  std::shared_ptr<void> pathFinderShare_;
+  // visual sensors of the current batch and their scene graphs, see
+  // getAgentsObservations()
+  std::vector<sensor::Sensor*> batchSensors_;
+  std::vector<scene::SceneGraph*> batchSceneGraphs_;
+  // steps of stepAsync() not waited for yet, oldest first
+  std::deque<PendingStep> pendingSteps_;
+  int nextStepHandle_ = 0;
+  int maxStepsInFlight_ = 2;
+  // the recording of startRecording(), nullptr if not recording, and the
+  // step captured into, whose vectors keep their capacity
+  EpisodeRecording::ptr recording_ = nullptr;
+  EpisodeStep recordedStep_;
+  // the recording of startReplay(), the offset of its next step and the
+  // step decoded last, which the next one is decoded against
+  EpisodeRecording::ptr replay_ = nullptr;
+  size_t replayOffset_ = 0;
+  EpisodeStep replayedStep_;
   ESP_SMART_POINTERS(SimulatorWithAgents)
 };
 
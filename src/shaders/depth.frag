@@ -1,8 +1,6 @@
 #ifdef UNPROJECT_EXISTING_DEPTH
 uniform highp sampler2D depthTexture;
 uniform highp vec2 depthUnprojection;
-
-in highp vec2 textureCoordinates;
 #else
 in highp float depth;
 #endif
@@ -11,7 +9,9 @@ out highp float originalDepth;
 
 void main() {
   #ifdef UNPROJECT_EXISTING_DEPTH
-  highp float depth = texture(depthTexture, textureCoordinates).r;
+  /* Fetching at the fragment position instead of interpolating texture
+     coordinates makes it possible to unproject just a viewport region */
+  highp float depth = texelFetch(depthTexture, ivec2(gl_FragCoord.xy), 0).r;
   originalDepth =
     #ifndef NO_FAR_PLANE_PATCHING
     /* We can afford using == for comparison as 1.0f has an exact
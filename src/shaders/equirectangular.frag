@@ -0,0 +1,48 @@
+// the six faces of a cube, each a 90 degree pinhole image of a layer
+uniform highp sampler2DArray colorTexture;
+uniform highp usampler2DArray objectIdTexture;
+uniform highp sampler2DArray depthTexture;
+
+// rotations from the panorama camera into the camera of each face
+uniform highp mat3 faceRotations[6];
+uniform highp vec2 viewportSize;
+// unprojection of the depth of the faces, see calculateDepthUnprojection()
+uniform highp vec2 depthUnprojection;
+
+layout(location = 0) out mediump vec4 color;
+layout(location = 1) out uint objectId;
+
+const highp float pi = 3.14159265358979;
+
+void main() {
+  // longitude goes right from the forward direction, latitude up
+  highp vec2 angles = (gl_FragCoord.xy / viewportSize - 0.5) * vec2(2.0*pi, pi);
+  highp vec3 direction = vec3(cos(angles.y)*sin(angles.x), sin(angles.y),
+                              -cos(angles.y)*cos(angles.x));
+
+  // faces in the order of CubeMapFace
+  highp vec3 a = abs(direction);
+  int face;
+  if (a.z >= a.x && a.z >= a.y) {
+    face = direction.z < 0.0 ? 0 : 2;
+  } else if (a.x >= a.y) {
+    face = direction.x > 0.0 ? 1 : 3;
+  } else {
+    face = direction.y > 0.0 ? 4 : 5;
+  }
+  highp vec3 f = faceRotations[face]*direction;
+  highp vec3 coords = vec3(f.xy/-f.z*0.5 + 0.5, float(face));
+
+  color = texture(colorTexture, coords);
+  objectId = texture(objectIdTexture, coords).r;
+
+  // the faces store depth along their axis, the panorama the distance along
+  // the ray, projected back so that it unprojects like the depth of a face
+  highp float depth = texture(depthTexture, coords).r;
+  if (depth < 1.0) {
+    highp float z = depthUnprojection[1]/(depth + depthUnprojection[0]);
+    highp float distance = z*length(f)/-f.z;
+    depth = min(depthUnprojection[1]/distance - depthUnprojection[0], 1.0);
+  }
+  gl_FragDepth = depth;
+}
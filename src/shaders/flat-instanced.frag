@@ -0,0 +1,26 @@
+#ifdef TEXTURED
+uniform lowp sampler2D textureData;
+in mediump vec2 interpolatedTextureCoordinates;
+#endif
+#ifdef VERTEX_COLOR
+in lowp vec4 interpolatedVertexColor;
+#endif
+
+flat in lowp vec4 interpolatedColor;
+flat in highp uint interpolatedObjectId;
+
+layout(location = 0) out lowp vec4 fragmentColor;
+layout(location = 1) out highp uint fragmentObjectId;
+
+void main() {
+  // same as the Magnum flat shader: vertex color and texture are multiplied
+  // with the color
+  fragmentColor = interpolatedColor;
+#ifdef VERTEX_COLOR
+  fragmentColor *= interpolatedVertexColor;
+#endif
+#ifdef TEXTURED
+  fragmentColor *= texture(textureData, interpolatedTextureCoordinates);
+#endif
+  fragmentObjectId = interpolatedObjectId;
+}
@@ -0,0 +1,31 @@
+uniform highp mat4 projectionMatrix;
+
+in highp vec4 position;
+#ifdef TEXTURED
+in mediump vec2 textureCoordinates;
+out mediump vec2 interpolatedTextureCoordinates;
+#endif
+#ifdef VERTEX_COLOR
+in lowp vec4 vertexColor;
+out lowp vec4 interpolatedVertexColor;
+#endif
+
+// per instance
+in highp mat4 instanceTransformationMatrix;
+in lowp vec4 instanceColor;
+in highp uint instanceObjectId;
+
+flat out lowp vec4 interpolatedColor;
+flat out highp uint interpolatedObjectId;
+
+void main() {
+  gl_Position = projectionMatrix * instanceTransformationMatrix * position;
+#ifdef TEXTURED
+  interpolatedTextureCoordinates = textureCoordinates;
+#endif
+#ifdef VERTEX_COLOR
+  interpolatedVertexColor = vertexColor;
+#endif
+  interpolatedColor = instanceColor;
+  interpolatedObjectId = instanceObjectId;
+}
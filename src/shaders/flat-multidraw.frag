@@ -0,0 +1,37 @@
+#ifndef BINDLESS
+uniform lowp sampler2DArray textureData;
+#endif
+
+in mediump vec2 interpolatedTextureCoordinates;
+in lowp vec4 interpolatedVertexColor;
+flat in lowp vec4 interpolatedColor;
+flat in highp uint interpolatedObjectId;
+flat in highp uint interpolatedFlags;
+flat in highp uvec2 interpolatedTexture;
+
+layout(location = 0) out lowp vec4 fragmentColor;
+layout(location = 1) out highp uint fragmentObjectId;
+
+// flags of a draw, see MultiDrawFlatShader
+const highp uint DRAW_VERTEX_COLOR = 1u;
+const highp uint DRAW_TEXTURED = 2u;
+
+void main() {
+  // same as the Magnum flat shader: vertex color and texture are multiplied
+  // with the color
+  fragmentColor = interpolatedColor;
+  if ((interpolatedFlags & DRAW_VERTEX_COLOR) != 0u) {
+    fragmentColor *= interpolatedVertexColor;
+  }
+  if ((interpolatedFlags & DRAW_TEXTURED) != 0u) {
+#ifdef BINDLESS
+    fragmentColor *= texture(sampler2D(interpolatedTexture),
+                             interpolatedTextureCoordinates);
+#else
+    fragmentColor *=
+        texture(textureData, vec3(interpolatedTextureCoordinates,
+                                  float(interpolatedTexture.x)));
+#endif
+  }
+  fragmentObjectId = interpolatedObjectId;
+}
@@ -0,0 +1,38 @@
+uniform highp mat4 projectionMatrix;
+
+in highp vec4 position;
+in mediump vec2 textureCoordinates;
+in lowp vec4 vertexColor;
+// per draw, through the base instance
+in highp uint drawIndex;
+
+struct Draw {
+  highp mat4 transformationMatrix;
+  lowp vec4 color;
+  highp uint objectId;
+  highp uint flags;
+  // the bindless handle, or the texture array layer in x
+  highp uvec2 textureSlot;
+};
+
+layout(std430, binding = 0) readonly buffer Draws {
+  Draw draws[];
+};
+
+out mediump vec2 interpolatedTextureCoordinates;
+out lowp vec4 interpolatedVertexColor;
+flat out lowp vec4 interpolatedColor;
+flat out highp uint interpolatedObjectId;
+flat out highp uint interpolatedFlags;
+flat out highp uvec2 interpolatedTexture;
+
+void main() {
+  Draw draw = draws[drawIndex];
+  gl_Position = projectionMatrix * draw.transformationMatrix * position;
+  interpolatedTextureCoordinates = textureCoordinates;
+  interpolatedVertexColor = vertexColor;
+  interpolatedColor = draw.color;
+  interpolatedObjectId = draw.objectId;
+  interpolatedFlags = draw.flags;
+  interpolatedTexture = draw.textureSlot;
+}
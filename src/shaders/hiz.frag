@@ -0,0 +1,19 @@
+// the level below: the depth buffer or the previous reduction
+uniform highp sampler2D sourceTexture;
+
+out highp float maxDepth;
+
+void main() {
+  // the farthest of the 2x2 texels below, clamped to the edge of levels of
+  // odd size, whose last texel covers only one
+  highp ivec2 lastTexel = textureSize(sourceTexture, 0) - 1;
+  highp ivec2 texel = ivec2(gl_FragCoord.xy) * 2;
+  highp float depth = 0.0;
+  for (int y = 0; y < 2; ++y) {
+    for (int x = 0; x < 2; ++x) {
+      depth = max(depth, texelFetch(sourceTexture,
+                                    min(texel + ivec2(x, y), lastTexel), 0).r);
+    }
+  }
+  maxDepth = depth;
+}
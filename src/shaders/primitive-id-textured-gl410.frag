@@ -1,16 +1,40 @@
 in mediump vec3 v_color;
 
+#ifdef OBJECT_ID_ATTRIBUTE
+flat in highp uint v_objectId;
+#else
 uniform highp sampler2D primTexture;
-uniform highp int texSize;
+#endif
+
+#ifdef ID_REMAP
+// maps the ids in primTexture to the ids written, a table of idRemapSize
+// entries idRemapWidth wide
+uniform highp isampler2D idRemapTexture;
+uniform highp int idRemapWidth;
+uniform highp int idRemapSize;
+#endif
 
 layout(location = 0) out mediump vec4 color;
 layout(location = 1) out uint objectId;
 
 void main () {
   color = vec4(v_color, 1.0);
-  objectId = uint(
-      texture(primTexture,
-              vec2((float(gl_PrimitiveID % texSize) + 0.5f) / float(texSize),
-                   (float(gl_PrimitiveID / texSize) + 0.5f) / float(texSize)))
+#ifdef OBJECT_ID_ATTRIBUTE
+  highp int id = int(v_objectId);
+#else
+  // fetched by integer texel, without the normalized coordinates and
+  // filtering of texture()
+  highp int texSize = textureSize(primTexture, 0).x;
+  highp int id = int(
+      texelFetch(primTexture,
+                 ivec2(gl_PrimitiveID % texSize, gl_PrimitiveID / texSize), 0)
           .r + 0.5);
+#endif
+#ifdef ID_REMAP
+  id = id >= 0 && id < idRemapSize
+           ? texelFetch(idRemapTexture,
+                        ivec2(id % idRemapWidth, id / idRemapWidth), 0).r
+           : -1;
+#endif
+  objectId = uint(id);
 }
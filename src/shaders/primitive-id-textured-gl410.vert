@@ -5,7 +5,16 @@ layout(location = 1) in mediump vec3 color;
 
 out mediump vec3 v_color;
 
+#ifdef OBJECT_ID_ATTRIBUTE
+layout(location = 2) in highp uint vertexObjectId;
+
+flat out highp uint v_objectId;
+#endif
+
 void main() {
   gl_Position = transformationProjectionMatrix * vec4(position.xyz, 1.0);
   v_color = color;
+#ifdef OBJECT_ID_ATTRIBUTE
+  v_objectId = vertexObjectId;
+#endif
 }
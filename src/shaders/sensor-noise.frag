@@ -0,0 +1,83 @@
+// the copy of the color of the frame, or its depth texture for REDWOOD
+uniform highp sampler2D sourceTexture;
+uniform highp uint seed;
+
+#ifdef REDWOOD
+uniform highp float multiplier;
+uniform highp vec2 depthUnprojection;
+uniform highp float depthScale;
+
+out highp float noisyDepth;
+#else
+uniform mediump float mean;
+uniform mediump float sigma;
+uniform mediump float intensity;
+uniform mediump float amount;
+uniform mediump float saltRatio;
+
+out lowp vec4 noisyColor;
+#endif
+
+// PCG hash (Jarzynski and Olano, "Hash Functions for GPU Rendering")
+highp uint hash(highp uint x) {
+  highp uint state = x * 747796405u + 2891336453u;
+  highp uint word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+  return (word >> 22u) ^ word;
+}
+
+// the k-th uniform number in [0, 1) of pixel, from the top 24 bits of a hash
+// of the frame seed, the number and the pixel
+highp float uniformRandom(highp uvec2 pixel, highp uint k) {
+  highp uint h = hash(hash(hash(seed ^ hash(k)) + pixel.x) + pixel.y);
+  return float(h >> 8u) * (1.0 / 16777216.0);
+}
+
+// the k-th standard normal number of pixel, by Box-Muller
+highp float normalRandom(highp uvec2 pixel, highp uint k) {
+  // in (0, 1], so that the log is finite
+  highp float u1 = 1.0 - uniformRandom(pixel, 2u * k);
+  highp float u2 = uniformRandom(pixel, 2u * k + 1u);
+  return sqrt(-2.0 * log(u1)) * cos(6.2831853 * u2);
+}
+
+void main() {
+  highp uvec2 pixel = uvec2(gl_FragCoord.xy);
+
+  #ifdef REDWOOD
+  // jitter the pixel, then sample the depth at half the resolution
+  highp vec2 lastTexel = vec2(textureSize(sourceTexture, 0) - 1);
+  highp vec2 jittered = vec2(pixel) + 0.25 * multiplier *
+      vec2(normalRandom(pixel, 0u), normalRandom(pixel, 1u));
+  highp ivec2 texel = ivec2(clamp(jittered, vec2(0.0), lastTexel) + 0.5);
+  highp float depth = texelFetch(sourceTexture, texel - texel % 2, 0).r;
+  // the depth cleared on the far plane reads as 0, and so do depths beyond
+  // the range of the sensor, 10 m
+  highp float meters = depth == 1.0 ? 0.0 :
+      depthUnprojection[1] / (depth + depthUnprojection[0]);
+  noisyDepth = 0.0;
+  if (meters > 0.0 && meters < 10.0) {
+    // disparity noise, quantized to eighths
+    highp float disparity = round((35.130 / meters +
+        normalRandom(pixel, 2u) * 0.027778 * multiplier) * 8.0);
+    if (disparity > 1.0e-5) {
+      noisyDepth = 35.130 * 8.0 / disparity * depthScale;
+    }
+  }
+  #else
+  mediump vec4 color = texelFetch(sourceTexture, ivec2(pixel), 0);
+  #if defined(GAUSSIAN)
+  color.rgb += intensity * (mean + sigma * vec3(normalRandom(pixel, 0u),
+                                                normalRandom(pixel, 1u),
+                                                normalRandom(pixel, 2u)));
+  #elif defined(SPECKLE)
+  color.rgb *= 1.0 + intensity * (mean + sigma * vec3(normalRandom(pixel, 0u),
+                                                      normalRandom(pixel, 1u),
+                                                      normalRandom(pixel, 2u)));
+  #elif defined(SALT_AND_PEPPER)
+  if (uniformRandom(pixel, 0u) < amount) {
+    color.rgb = vec3(uniformRandom(pixel, 1u) < saltRatio ? 1.0 : 0.0);
+  }
+  #endif
+  noisyColor = clamp(color, 0.0, 1.0);
+  #endif
+}
@@ -0,0 +1,34 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#pragma once
+
+// Replaces the global operator new and delete of a test binary to count its
+// heap allocations in numAllocations, e.g. to check that a hot path does not
+// allocate. Include it in a single source file of the binary only
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+// heap allocations of the test, counted by the operator new below
+std::atomic<size_t> numAllocations{0};
+}  // namespace
+
+void* operator new(size_t size) {
+  ++numAllocations;
+  if (void* p = std::malloc(size > 0 ? size : 1)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+  std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+  std::free(p);
+}
@@ -3,11 +3,36 @@
 // LICENSE file in the root directory of this source tree.
 
 #include <gtest/gtest.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
 
+#include "esp/core/Arena.h"
+#include "esp/core/Buffer.h"
+#include "esp/core/Compression.h"
 #include "esp/core/Configuration.h"
+#include "esp/core/MemoryTracking.h"
+#include "esp/core/Metrics.h"
+#include "esp/core/Profiling.h"
+#include "esp/core/SharedMemory.h"
+#include "esp/core/ThreadPool.h"
 #include "esp/core/esp.h"
+#include "esp/core/random.h"
 #include "esp/io/json.h"
 
+#include "AllocationCounter.h"
+
+#ifdef __linux__
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
 using namespace esp::core;
 
 TEST(CoreTest, ConfigurationTest) {
@@ -28,3 +53,453 @@ TEST(CoreTest, JsonTest) {
   EXPECT_EQ(t[1], 2);
   EXPECT_EQ(esp::io::jsonToString(json), "{\"test\":[1,2,3,4]}");
 }
+
+TEST(CoreTest, ProfilerTest) {
+  Profiler& profiler = Profiler::get();
+  profiler.clear();
+  profiler.setEnabled(false);
+  { ScopedTimer timer{"disabled"}; }
+  EXPECT_TRUE(profiler.getEvents().empty());
+
+  profiler.setEnabled(true);
+  { ScopedTimer timer{"scope"}; }
+  std::thread([]() { ScopedTimer timer{"scope"}; }).join();
+  profiler.record("gpu", 0, 2000000, Profiler::GpuThreadId);
+  profiler.setEnabled(false);
+
+  const std::vector<ProfileEvent> events = profiler.getEvents();
+  ASSERT_EQ(events.size(), 3);
+  EXPECT_EQ(std::string{events[0].name}, "gpu");
+  EXPECT_EQ(events[0].threadId, Profiler::GpuThreadId);
+  // each thread has its own track
+  EXPECT_NE(events[1].threadId, events[2].threadId);
+  EXPECT_NE(events[1].threadId, Profiler::GpuThreadId);
+  EXPECT_LE(events[1].startNs, events[2].startNs);
+
+  const std::map<std::string, ProfileSummary> summary = profiler.getSummary();
+  EXPECT_EQ(summary.at("scope").count, 2);
+  EXPECT_DOUBLE_EQ(summary.at("gpu").totalMs, 2.0);
+
+  const std::string trace = profiler.getChromeTrace();
+  EXPECT_NE(trace.find("\"name\":\"scope\",\"ph\":\"X\""),
+            std::string::npos);
+  EXPECT_NE(trace.find("{\"name\":\"GPU\"}"), std::string::npos);
+
+  // the ring buffer keeps the latest events
+  profiler.setBufferCapacity(2);
+  for (int64_t i = 0; i < 5; ++i) {
+    profiler.record("ring", i, 1);
+  }
+  const std::vector<ProfileEvent> ring = profiler.getEvents();
+  ASSERT_EQ(ring.size(), 2);
+  EXPECT_EQ(ring[0].startNs, 3);
+  EXPECT_EQ(ring[1].startNs, 4);
+  profiler.setBufferCapacity(1 << 16);
+}
+
+TEST(CoreTest, MetricsTest) {
+  MetricsRegistry& registry = MetricsRegistry::get();
+  Counter& counter = registry.counter("test_total", "A test counter");
+  Histogram& histogram =
+      registry.histogram("test_seconds", "A test histogram", {0.1, 1.0});
+  EXPECT_EQ(&registry.counter("test_total", "A test counter"), &counter);
+  registry.reset();
+
+  registry.setEnabled(false);
+  { HistogramTimer timer{histogram}; }
+  EXPECT_EQ(histogram.getCount(), 0);
+  registry.setEnabled(true);
+  { HistogramTimer timer{histogram}; }
+  EXPECT_EQ(histogram.getCount(), 1);
+  histogram.observe(0.5);
+  histogram.observe(0.7);
+  histogram.observe(3.0);
+  EXPECT_EQ(histogram.getBucketCounts(), (std::vector<uint64_t>{1, 2, 1}));
+  EXPECT_GE(histogram.getSum(), 4.2);
+  counter.add(2);
+  registry.setEnabled(false);
+
+  const int collector = registry.addCollector(
+      [](std::vector<MetricSample>& samples) {
+        samples.push_back({"test_bytes", {{"asset", "a \"b\".glb"}}, 42});
+      },
+      {{"test_bytes", "A test gauge"}});
+  const std::string text = registry.getPrometheusText();
+  EXPECT_NE(text.find("# TYPE test_total counter\ntest_total 2\n"),
+            std::string::npos);
+  EXPECT_NE(text.find("# TYPE test_seconds histogram\n"
+                      "test_seconds_bucket{le=\"0.1\"} 1\n"
+                      "test_seconds_bucket{le=\"1\"} 3\n"
+                      "test_seconds_bucket{le=\"+Inf\"} 4\n"),
+            std::string::npos);
+  EXPECT_NE(text.find("test_seconds_count 4\n"), std::string::npos);
+  EXPECT_NE(text.find("# HELP test_bytes A test gauge\n"
+                      "# TYPE test_bytes gauge\n"
+                      "test_bytes{asset=\"a \\\"b\\\".glb\"} 42\n"),
+            std::string::npos);
+  EXPECT_NE(text.find("process_resident_memory_bytes "), std::string::npos);
+  registry.removeCollector(collector);
+  EXPECT_EQ(registry.getPrometheusText().find("test_bytes"),
+            std::string::npos);
+
+  // scraped over HTTP
+  MetricsServer server{0};
+  ASSERT_TRUE(server.isRunning());
+  const int client = socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in address{};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = htons(server.getPort());
+  ASSERT_EQ(
+      connect(client, reinterpret_cast<sockaddr*>(&address), sizeof(address)),
+      0);
+  const std::string request = "GET /metrics HTTP/1.1\r\n\r\n";
+  ASSERT_EQ(send(client, request.data(), request.size(), 0), request.size());
+  std::string response;
+  char buffer[4096];
+  ssize_t received;
+  while ((received = recv(client, buffer, sizeof(buffer), 0)) > 0) {
+    response.append(buffer, received);
+  }
+  close(client);
+  EXPECT_EQ(response.compare(0, 15, "HTTP/1.1 200 OK"), 0);
+  EXPECT_NE(response.find("test_total 2\n"), std::string::npos);
+  registry.reset();
+}
+
+TEST(CoreTest, BufferTest) {
+  releaseBufferPool();
+  void* data = nullptr;
+  {
+    Buffer buffer({480, 640, 4}, DataType::DT_UINT8);
+    data = buffer.data;
+    ASSERT_NE(data, nullptr);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(data) % bufferPageBytes, 0);
+    EXPECT_EQ(buffer.totalBytes, 480 * 640 * 4);
+
+    // shrinking and growing within the allocation keeps it
+    ASSERT_TRUE(buffer.resize({240, 320, 1}, DataType::DT_FLOAT));
+    EXPECT_EQ(buffer.data, data);
+    EXPECT_EQ(buffer.totalSize, 240 * 320);
+    EXPECT_EQ(buffer.totalBytes, 240 * 320 * sizeof(float));
+    ASSERT_TRUE(buffer.resize({480, 640, 4}, DataType::DT_UINT8));
+    EXPECT_EQ(buffer.data, data);
+    ASSERT_TRUE(buffer.resize({480, 640, 4}, DataType::DT_FLOAT));
+    EXPECT_NE(buffer.data, nullptr);
+    EXPECT_GE(buffer.capacityBytes(), buffer.totalBytes);
+    data = buffer.data;
+  }
+
+  // freed memory goes to the pool and back to the next buffer of its size
+  EXPECT_GT(getBufferPoolBytes(), 0);
+  Buffer buffer({480, 640, 4}, DataType::DT_FLOAT);
+  EXPECT_EQ(buffer.data, data);
+
+  // small buffers are still aligned for SIMD
+  Buffer small({3}, DataType::DT_UINT8);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(small.data) % bufferAlignment, 0);
+
+  // external memory cannot grow
+  float external[4];
+  Buffer wrapped(external, {4}, DataType::DT_FLOAT);
+  EXPECT_TRUE(wrapped.resize({2}, DataType::DT_FLOAT));
+  EXPECT_EQ(wrapped.data, external);
+  EXPECT_FALSE(wrapped.resize({8}, DataType::DT_FLOAT));
+  EXPECT_EQ(wrapped.totalSize, 2);
+  releaseBufferPool();
+  EXPECT_EQ(getBufferPoolBytes(), 0);
+}
+
+TEST(CoreTest, MemoryTrackingTest) {
+  const MemoryTagStats assetsBefore = getMemoryTagStats(MemoryTag::Assets);
+  const MemoryTagStats buffersBefore = getMemoryTagStats(MemoryTag::Buffers);
+  void* data = trackedMalloc(MemoryTag::Assets, 100);
+  ASSERT_NE(data, nullptr);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(data) % alignof(std::max_align_t), 0);
+  std::vector<int, TrackedAllocator<int, MemoryTag::Assets>> ints(10);
+  Buffer buffer({64, 64}, DataType::DT_UINT8);
+
+  const MemoryTagStats assets = getMemoryTagStats(MemoryTag::Assets);
+  const MemoryTagStats buffers = getMemoryTagStats(MemoryTag::Buffers);
+  if (isMemoryTrackingCompiledIn()) {
+    EXPECT_EQ(assets.liveBytes,
+              assetsBefore.liveBytes + 100 + 10 * sizeof(int));
+    EXPECT_EQ(assets.liveAllocations, assetsBefore.liveAllocations + 2);
+    EXPECT_EQ(assets.allocations, assetsBefore.allocations + 2);
+    EXPECT_GE(buffers.liveBytes, buffersBefore.liveBytes + 64 * 64);
+    EXPECT_EQ(buffers.liveAllocations, buffersBefore.liveAllocations + 1);
+  } else {
+    EXPECT_EQ(assets.allocations, 0);
+    EXPECT_EQ(buffers.allocations, 0);
+  }
+
+  trackedFree(MemoryTag::Assets, data);
+  trackedFree(MemoryTag::Assets, nullptr);
+  decltype(ints)().swap(ints);
+  EXPECT_EQ(getMemoryTagStats(MemoryTag::Assets).liveBytes,
+            assetsBefore.liveBytes);
+  EXPECT_EQ(getMemoryTagStats(MemoryTag::Assets).liveAllocations,
+            assetsBefore.liveAllocations);
+
+  const std::string text = MetricsRegistry::get().getPrometheusText();
+  EXPECT_EQ(text.find("habitat_memory_live_bytes{tag=\"assets\"}") !=
+                std::string::npos,
+            isMemoryTrackingCompiledIn());
+}
+
+TEST(CoreTest, RandomTest) {
+  // known answer of Philox4x32-10 for a zero key and counter
+  Philox4x32 philox;
+  EXPECT_EQ(philox(), 0x6627e8d5u);
+  EXPECT_EQ(philox(), 0xe169c58du);
+  EXPECT_EQ(philox(), 0xbc57ac4cu);
+  EXPECT_EQ(philox(), 0x9b00dbd8u);
+
+  // skipping ahead lands where drawing does
+  Philox4x32 drawn(7, 3), skipped(7, 3);
+  for (int i = 0; i < 10; ++i) {
+    drawn();
+  }
+  skipped();
+  skipped.discard(9);
+  EXPECT_EQ(drawn(), skipped());
+
+  // split streams only depend on the seed and the ids
+  Random random(42);
+  Random first = random.split(0);
+  random.uniform_uint();
+  Random again = random.split(0);
+  Random second = random.split(1);
+  int equal = 0;
+  for (int i = 0; i < 1000; ++i) {
+    const uint32_t x = first.uniform_uint();
+    EXPECT_EQ(x, again.uniform_uint());
+    equal += x == second.uniform_uint();
+  }
+  EXPECT_LT(equal, 2);
+
+  // bulk draws match single ones
+  Random single(5), bulk(5);
+  std::vector<float> floats(101), normals(101);
+  bulk.fill_uniform_float(floats.data(), floats.size(), -1.0f, 1.0f);
+  bulk.fill_normal_float_01(normals.data(), normals.size());
+  for (size_t i = 0; i < floats.size(); ++i) {
+    EXPECT_EQ(floats[i], single.uniform_float(-1.0f, 1.0f));
+  }
+  for (size_t i = 0; i < normals.size(); ++i) {
+    EXPECT_EQ(normals[i], single.normal_float_01());
+  }
+
+  std::vector<float> samples(100000);
+  random.fill_normal_float_01(samples.data(), samples.size());
+  double mean = 0, variance = 0;
+  for (float x : samples) {
+    mean += x;
+    variance += x * x;
+  }
+  mean /= samples.size();
+  variance = variance / samples.size() - mean * mean;
+  EXPECT_NEAR(mean, 0.0, 0.02);
+  EXPECT_NEAR(variance, 1.0, 0.02);
+}
+
+TEST(CoreTest, ThreadPoolTest) {
+  ThreadPool pool(4);
+  EXPECT_EQ(pool.getNumThreads(), 4);
+  std::future<int> answer = pool.async([]() { return 42; });
+  EXPECT_EQ(answer.get(), 42);
+
+  // the first exception of a group reaches wait()
+  TaskGroup group(pool);
+  std::atomic<int> numRun{0};
+  for (int i = 0; i < 100; ++i) {
+    group.run([&numRun, i]() {
+      ++numRun;
+      if (i == 50) {
+        throw std::runtime_error("task failed");
+      }
+    });
+  }
+  EXPECT_THROW(group.wait(), std::runtime_error);
+  EXPECT_EQ(numRun, 100);
+
+  // nested loops run on the same threads, and each index once
+  ThreadPool::global().setNumThreads(4);
+  std::vector<std::atomic<int>> counts(64 * 64);
+  for (std::atomic<int>& count : counts) {
+    count = 0;
+  }
+  parallelFor(64, 0, [&](size_t i) {
+    parallelFor(64, 0, [&](size_t j) { ++counts[i * 64 + j]; });
+  });
+  for (std::atomic<int>& count : counts) {
+    EXPECT_EQ(count, 1);
+  }
+
+  // no two threads share a slot at once
+  std::vector<std::atomic<int>> inSlot(4);
+  for (std::atomic<int>& count : inSlot) {
+    count = 0;
+  }
+  std::atomic<bool> shared{false};
+  const int numSlots = parallelForWithSlots(1000, 0, [&](size_t, int slot) {
+    if (++inSlot[slot] > 1) {
+      shared = true;
+    }
+    std::this_thread::yield();
+    --inSlot[slot];
+  });
+  EXPECT_LE(numSlots, 4);
+  EXPECT_FALSE(shared);
+
+  std::atomic<size_t> total{0};
+  parallelForRange(1001, 64, 0, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      total += i;
+    }
+  });
+  EXPECT_EQ(total, 1000 * 1001 / 2);
+  ThreadPool::global().setNumThreads(0);
+
+  // the pool of the process is in use, so its size is fixed
+  const int numThreads = ThreadPool::global().getNumThreads();
+  EXPECT_TRUE(ThreadPool::setGlobalNumThreads(0));
+  EXPECT_FALSE(ThreadPool::setGlobalNumThreads(numThreads + 1));
+  EXPECT_EQ(ThreadPool::global().getNumThreads(), numThreads);
+}
+
+TEST(CoreTest, Lz4Test) {
+  Random random(7);
+  for (size_t size : {0, 1, 12, 13, 100, 70000}) {
+    // runs, repeats further back than a match can reach, and noise
+    std::vector<uint8_t> data(size);
+    for (size_t i = 0; i < size; ++i) {
+      data[i] = i % 3 == 0 ? uint8_t(random.uniform_int() & 3)
+                           : uint8_t((i / 100) % 7);
+    }
+    std::vector<uint8_t> compressed(lz4CompressBound(size));
+    const size_t compressedSize =
+        lz4Compress(data.data(), size, compressed.data(), compressed.size());
+    ASSERT_GT(compressedSize, 0u);
+    std::vector<uint8_t> decompressed(size);
+    EXPECT_TRUE(lz4Decompress(compressed.data(), compressedSize,
+                              decompressed.data(), size));
+    EXPECT_EQ(decompressed, data);
+    // truncated data, or data of another size, is rejected
+    if (size > 0) {
+      EXPECT_FALSE(lz4Decompress(compressed.data(), compressedSize - 1,
+                                 decompressed.data(), size));
+      EXPECT_FALSE(lz4Decompress(compressed.data(), compressedSize,
+                                 decompressed.data(), size - 1));
+    }
+  }
+
+  // random data does not compress, and needs the whole bound
+  std::vector<uint8_t> noise(4096);
+  for (uint8_t& byte : noise) {
+    byte = uint8_t(random.uniform_int());
+  }
+  std::vector<uint8_t> compressed(lz4CompressBound(noise.size()));
+  EXPECT_GT(lz4Compress(noise.data(), noise.size(), compressed.data(),
+                        compressed.size()),
+            noise.size());
+  EXPECT_EQ(lz4Compress(noise.data(), noise.size(), compressed.data(),
+                        noise.size()),
+            0u);
+}
+
+TEST(CoreTest, ArenaTest) {
+  Arena arena(256);
+  auto step = [&arena]() {
+    ArenaScope scope(arena);
+    std::vector<int, ArenaAllocator<int>> values{ArenaAllocator<int>(arena)};
+    for (int i = 0; i < 1000; ++i) {
+      values.push_back(i);
+    }
+    return values.back();
+  };
+  EXPECT_EQ(step(), 999);
+  // leaving the outermost scope merges the blocks the step grew
+  EXPECT_EQ(arena.getNumBlocks(), 1);
+  const size_t capacity = arena.getCapacity();
+  EXPECT_GE(capacity, 1000 * sizeof(int));
+
+  // steps of the same size draw from that block only
+  const size_t allocationsBefore = numAllocations;
+  step();
+  step();
+  EXPECT_EQ(numAllocations - allocationsBefore, 0);
+  EXPECT_EQ(arena.getCapacity(), capacity);
+
+  void* aligned = arena.allocate(3, 64);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(aligned) % 64, 0);
+  // rewinding hands out the same memory again
+  const Arena::Mark mark = arena.mark();
+  void* first = arena.allocate(16);
+  arena.rewind(mark);
+  EXPECT_EQ(arena.allocate(16), first);
+  arena.reset();
+  EXPECT_EQ(arena.allocate(3, 64), aligned);
+}
+
+#ifdef __linux__
+TEST(CoreTest, SharedRingTest) {
+  const std::string name = "/CoreTest.SharedRingTest";
+  const uint32_t numMessages = 10000;
+  // requests and responses, small enough to fill up now and then
+  const size_t ringBytes = SharedRing::memorySize(4, sizeof(uint64_t));
+  SharedMemory memory(name, 2 * ringBytes);
+  ASSERT_TRUE(memory.isValid());
+  SharedRing requests = SharedRing::create(memory.data(), 3, sizeof(uint64_t));
+  SharedRing::create(memory.data() + ringBytes, 4, sizeof(uint64_t));
+  EXPECT_EQ(requests.getNumSlots(), 4);
+  EXPECT_EQ(requests.size(), 0);
+  EXPECT_EQ(requests.beginRead(0), nullptr);
+
+  // another process doubles every request
+  const pid_t child = fork();
+  ASSERT_GE(child, 0);
+  if (child == 0) {
+    SharedMemory shared(name);
+    SharedRing childRequests(shared.data());
+    SharedRing childResponses(shared.data() + ringBytes);
+    for (uint32_t i = 0; i < numMessages; ++i) {
+      uint64_t value = 0;
+      std::memcpy(&value, childRequests.beginRead(), sizeof(value));
+      childRequests.endRead();
+      value *= 2;
+      std::memcpy(childResponses.beginWrite(), &value, sizeof(value));
+      childResponses.endWrite();
+    }
+    _exit(0);
+  }
+
+  SharedRing responses(memory.data() + ringBytes);
+  uint32_t numSent = 0;
+  uint64_t sum = 0;
+  for (uint32_t numReceived = 0; numReceived < numMessages;) {
+    // send ahead while there is room
+    void* slot = nullptr;
+    while (numSent < numMessages && (slot = requests.beginWrite(0))) {
+      const uint64_t value = numSent++;
+      std::memcpy(slot, &value, sizeof(value));
+      requests.endWrite();
+    }
+    const void* response = responses.beginRead(10000000);
+    ASSERT_NE(response, nullptr);
+    uint64_t value = 0;
+    std::memcpy(&value, response, sizeof(value));
+    responses.endRead();
+    EXPECT_EQ(value, 2 * numReceived++);
+    sum += value;
+  }
+  EXPECT_EQ(sum, uint64_t(numMessages) * (numMessages - 1));
+  int status = -1;
+  ASSERT_EQ(waitpid(child, &status, 0), child);
+  EXPECT_EQ(status, 0);
+
+  // the creator removes the segment
+  { SharedMemory stale(name + ".stale", 64); }
+  EXPECT_FALSE(SharedMemory(name + ".stale").isValid());
+}
+#endif
@@ -3,13 +3,78 @@
 // LICENSE file in the root directory of this source tree.
 
 #include <gtest/gtest.h>
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include "esp/geo/BVH.h"
+#include "esp/geo/ConvexDecomposition.h"
 #include "esp/geo/CoordinateFrame.h"
+#include "esp/geo/MeshOptimization.h"
+#include "esp/geo/MeshSimplification.h"
 #include "esp/geo/OBB.h"
 #include "esp/geo/geo.h"
 
 using namespace esp;
 using namespace esp::geo;
 
+TEST(GeoTest, BVH) {
+  // random boxes, and empty ones the hierarchy leaves out
+  std::mt19937 generator(3);
+  std::uniform_real_distribution<float> uniform(0.0f, 10.0f);
+  std::vector<box3f> boxes(200);
+  for (size_t i = 0; i < boxes.size(); ++i) {
+    if (i % 10 == 0) {
+      continue;
+    }
+    const vec3f min(uniform(generator), uniform(generator), uniform(generator));
+    const vec3f size = vec3f::Constant(1.0f + uniform(generator) * 0.1f);
+    boxes[i] = box3f(min, min + size);
+  }
+  BVH bvh;
+  bvh.build(boxes);
+  EXPECT_EQ(bvh.items().size(), 180u);
+
+  // the items reached are those whose boxes pass the test
+  const box3f query(vec3f(2, 2, 2), vec3f(6, 6, 6));
+  std::vector<int> found;
+  EXPECT_FALSE(bvh.traverse(
+      [&](const box3f& box) { return box.intersects(query); },
+      [&](int item) {
+        if (boxes[item].intersects(query)) {
+          found.push_back(item);
+        }
+        return false;
+      }));
+  std::sort(found.begin(), found.end());
+  std::vector<int> expected;
+  for (int i = 0; i < static_cast<int>(boxes.size()); ++i) {
+    if (!boxes[i].isEmpty() && boxes[i].intersects(query)) {
+      expected.push_back(i);
+    }
+  }
+  EXPECT_FALSE(expected.empty());
+  EXPECT_EQ(found, expected);
+
+  // a visit returning true ends the traversal
+  int numVisited = 0;
+  EXPECT_TRUE(bvh.traverse([](const box3f&) { return true; },
+                           [&](int) { return ++numVisited == 3; }));
+  EXPECT_EQ(numVisited, 3);
+
+  // a ray along x through the middle of a box enters it at its face
+  const box3f unit(vec3f(1, 0, 0), vec3f(2, 1, 1));
+  const vec3f direction(1, 0, 0);
+  float near = -1.0f;
+  EXPECT_TRUE(intersectRayBox(unit, vec3f(0, 0.5f, 0.5f),
+                              direction.cwiseInverse(), 10.0f, near));
+  EXPECT_FLOAT_EQ(near, 1.0f);
+  EXPECT_FALSE(intersectRayBox(unit, vec3f(0, 0.5f, 0.5f),
+                               direction.cwiseInverse(), 0.5f, near));
+  EXPECT_FALSE(intersectRayBox(unit, vec3f(0, 2.0f, 0.5f),
+                               direction.cwiseInverse(), 10.0f, near));
+}
+
 TEST(GeoTest, OBBConstruction) {
   OBB obb1;
   // LOG(INFO) << obb1;
@@ -59,6 +124,75 @@ TEST(GeoTest, OBBfunctions) {
   EXPECT_FLOAT_EQ(obb2.distance(vec3f(-10, -5, 2)), 1);
 }
 
+TEST(GeoTest, ConvexHull2D) {
+  // a square with points inside and on its edges, counterclockwise from the
+  // lowest then leftmost corner
+  const std::vector<vec2f> square = {vec2f(0, 0), vec2f(2, 1), vec2f(1, 1),
+                                     vec2f(2, 2), vec2f(0, 2), vec2f(1, 0),
+                                     vec2f(2, 0), vec2f(0.5, 1.5)};
+  const std::vector<vec2f> hull = convexHull2D(square);
+  const std::vector<vec2f> expected = {vec2f(0, 0), vec2f(2, 0), vec2f(2, 2),
+                                       vec2f(0, 2)};
+  EXPECT_EQ(hull, expected);
+
+  // batches give the hull of each set, whatever the number of threads
+  std::mt19937 rng(0);
+  std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+  std::vector<std::vector<vec2f>> pointSets(50);
+  for (size_t i = 0; i < pointSets.size(); ++i) {
+    for (size_t j = 0; j < 3 + i * 7; ++j) {
+      pointSets[i].emplace_back(uniform(rng), uniform(rng));
+    }
+  }
+  pointSets[7] = square;
+  for (int numThreads : {1, 4}) {
+    const std::vector<std::vector<vec2f>> hulls =
+        convexHull2DBatch(pointSets, numThreads);
+    ASSERT_EQ(hulls.size(), pointSets.size());
+    for (size_t i = 0; i < hulls.size(); ++i) {
+      EXPECT_EQ(hulls[i], convexHull2D(pointSets[i]));
+    }
+    EXPECT_EQ(hulls[7], expected);
+  }
+}
+
+TEST(GeoTest, GravityAlignedMOBB) {
+  // corners and interior points of a box rotated about gravity
+  const vec3f sizes(4, 2, 1);
+  const quatf rotation(Eigen::AngleAxisf(0.4f, ESP_UP));
+  std::mt19937 rng(0);
+  std::uniform_real_distribution<float> uniform(-0.5f, 0.5f);
+  std::vector<vec3f> points;
+  for (int i = 0; i < 8; ++i) {
+    points.push_back(rotation * vec3f(i & 1 ? 2 : -2, i & 2 ? 1 : -1,
+                                      i & 4 ? 0.5 : -0.5));
+  }
+  for (int i = 0; i < 20; ++i) {
+    points.push_back(rotation * vec3f(uniform(rng), uniform(rng), 0));
+  }
+
+  const OBB obb = computeGravityAlignedMOBB(ESP_GRAVITY, points);
+  EXPECT_NEAR(obb.sizes().prod(), sizes.prod(), 1e-3f);
+  for (const vec3f& point : points) {
+    EXPECT_TRUE(obb.contains(point, 1e-4f));
+  }
+
+  std::vector<std::vector<vec3f>> pointSets(20, points);
+  for (size_t i = 0; i < pointSets.size(); ++i) {
+    for (vec3f& point : pointSets[i]) {
+      point += vec3f(i, 0, 0);
+    }
+  }
+  const std::vector<OBB> obbs =
+      computeGravityAlignedMOBBBatch(ESP_GRAVITY, pointSets, 4);
+  ASSERT_EQ(obbs.size(), pointSets.size());
+  for (size_t i = 0; i < obbs.size(); ++i) {
+    const OBB expected = computeGravityAlignedMOBB(ESP_GRAVITY, pointSets[i]);
+    EXPECT_TRUE(obbs[i].center().isApprox(expected.center()));
+    EXPECT_TRUE(obbs[i].sizes().isApprox(expected.sizes()));
+  }
+}
+
 TEST(GeoTest, CoordinateFrame) {
   const vec3f origin(1, -2, 3);
   const vec3f up(0, 0, 1);
@@ -98,3 +232,259 @@ TEST(GeoTest, CoordinateFrame) {
   c4.fromJson(j);
   EXPECT_EQ(c3, c4);
 }
+
+namespace {
+// closed triangle mesh of an axis-aligned box, appended to vertices/indices
+void addBox(const box3f& box,
+            std::vector<vec3f>& vertices,
+            std::vector<uint32_t>& indices) {
+  const uint32_t first = vertices.size();
+  for (int i = 0; i < 8; ++i) {
+    vertices.emplace_back(i & 1 ? box.max()[0] : box.min()[0],
+                          i & 2 ? box.max()[1] : box.min()[1],
+                          i & 4 ? box.max()[2] : box.min()[2]);
+  }
+  for (uint32_t i : {0, 2, 1, 1, 2, 3, 4, 5, 6, 5, 7, 6, 0, 1, 4, 1, 5, 4,
+                     2, 6, 3, 3, 6, 7, 0, 4, 2, 2, 4, 6, 1, 3, 5, 3, 7, 5}) {
+    indices.push_back(first + i);
+  }
+}
+}  // namespace
+
+TEST(GeoTest, ConvexHull) {
+  std::vector<vec3f> points;
+  std::vector<uint32_t> indices;
+  addBox(box3f(vec3f(-1, -2, -3), vec3f(1, 2, 3)), points, indices);
+  // interior points do not end up in the hull
+  points.emplace_back(0, 0, 0);
+  points.emplace_back(0.5, -1, 2);
+  const ConvexHull hull = convexHull(points);
+  EXPECT_EQ(hull.vertices.size(), 8);
+  EXPECT_EQ(hull.indices.size(), 12 * 3);
+  EXPECT_FLOAT_EQ(convexHullVolume(hull), 2 * 4 * 6);
+
+  // coplanar points have no hull
+  EXPECT_TRUE(convexHull({vec3f(0, 0, 0), vec3f(1, 0, 0), vec3f(0, 1, 0),
+                          vec3f(1, 1, 0)})
+                  .indices.empty());
+}
+
+TEST(GeoTest, ConvexDecomposition) {
+  std::vector<vec3f> vertices;
+  std::vector<uint32_t> indices;
+  addBox(box3f(vec3f(0, 0, 0), vec3f(2, 1, 1)), vertices, indices);
+
+  // a convex mesh is its own hull
+  std::vector<ConvexHull> hulls = convexDecomposition(vertices, indices);
+  ASSERT_EQ(hulls.size(), 1);
+  EXPECT_EQ(hulls[0].vertices.size(), 8);
+  EXPECT_FLOAT_EQ(convexHullVolume(hulls[0]), 2);
+
+  // an L shape is split into two boxes, each about its part of the shape
+  addBox(box3f(vec3f(0, 0, 0), vec3f(1, 2, 1)), vertices, indices);
+  hulls = convexDecomposition(vertices, indices);
+  ASSERT_EQ(hulls.size(), 2);
+  float volume = 0;
+  for (const ConvexHull& hull : hulls) {
+    volume += convexHullVolume(hull);
+  }
+  // hulls of voxel parts exceed the mesh by half a voxel on each side
+  EXPECT_GT(volume, 3);
+  EXPECT_LT(volume, 3.5);
+
+  ConvexDecompositionSettings settings;
+  settings.maxHulls = 1;
+  EXPECT_EQ(convexDecomposition(vertices, indices, settings).size(), 1);
+}
+
+TEST(GeoTest, SimplifyMesh) {
+  // a wavy 64x64 quad grid
+  const int n = 64;
+  std::vector<vec3f> positions;
+  std::vector<uint32_t> indices;
+  for (int y = 0; y <= n; ++y) {
+    for (int x = 0; x <= n; ++x) {
+      positions.emplace_back(x, y, std::sin(x * 0.2f) * 4);
+    }
+  }
+  for (int y = 0; y < n; ++y) {
+    for (int x = 0; x < n; ++x) {
+      const uint32_t i = y * (n + 1) + x;
+      for (uint32_t k : {i, i + 1, i + n + 2, i, i + n + 2, i + n + 1}) {
+        indices.push_back(k);
+      }
+    }
+  }
+
+  // the full mesh is its own finest level
+  MeshLOD lod = simplifyMesh(positions, indices, 1);
+  EXPECT_EQ(lod.indices, indices);
+  EXPECT_EQ(lod.error, 0);
+
+  std::vector<MeshLOD> lods;
+  for (float ratio : {0.5f, 0.25f, 0.05f}) {
+    lod = simplifyMesh(positions, indices, ratio);
+    EXPECT_LE(lod.indices.size(), indices.size() * ratio);
+    // not collapsed much further than needed
+    EXPECT_GT(lod.indices.size(), indices.size() * ratio / 8);
+    if (!lods.empty()) {
+      EXPECT_GT(lod.error, lods.back().error);
+    }
+    for (size_t i = 0; i < lod.indices.size(); i += 3) {
+      ASSERT_LT(lod.indices[i], positions.size());
+      EXPECT_NE(lod.indices[i], lod.indices[i + 1]);
+      EXPECT_NE(lod.indices[i + 1], lod.indices[i + 2]);
+      EXPECT_NE(lod.indices[i + 2], lod.indices[i]);
+      // the grid faces +z everywhere, so must the simplified triangles
+      const vec3f normal =
+          (positions[lod.indices[i + 1]] - positions[lod.indices[i]])
+              .cross(positions[lod.indices[i + 2]] - positions[lod.indices[i]]);
+      EXPECT_GE(normal[2], 0);
+    }
+    lods.push_back(lod);
+  }
+
+  const std::string file = "GeoTest.lods";
+  const std::string source = "GeoTest.lods.glb";
+  std::ofstream(source) << "scene";
+  ASSERT_TRUE(saveMeshLODs(file, {lods, {}}, source));
+  std::vector<std::vector<MeshLOD>> loaded;
+  ASSERT_TRUE(loadMeshLODs(file, source, loaded));
+  ASSERT_EQ(loaded.size(), 2);
+  ASSERT_EQ(loaded[0].size(), lods.size());
+  EXPECT_TRUE(loaded[1].empty());
+  for (size_t i = 0; i < lods.size(); ++i) {
+    EXPECT_EQ(loaded[0][i].indices, lods[i].indices);
+    EXPECT_EQ(loaded[0][i].error, lods[i].error);
+  }
+  // made from another scene
+  std::ofstream(source) << "another scene";
+  EXPECT_FALSE(loadMeshLODs(file, source, loaded));
+  std::remove(file.c_str());
+  std::remove(source.c_str());
+}
+
+TEST(GeoTest, SimplifyCollisionMesh) {
+  // a 1m square of 1cm quads with a 20cm square hole in the middle
+  const int n = 100;
+  std::vector<vec3f> positions;
+  std::vector<uint32_t> indices;
+  for (int y = 0; y <= n; ++y) {
+    for (int x = 0; x <= n; ++x) {
+      positions.emplace_back(0.01f * x, 0.01f * y, 0);
+    }
+  }
+  for (int y = 0; y < n; ++y) {
+    for (int x = 0; x < n; ++x) {
+      if (x >= 40 && x < 60 && y >= 40 && y < 60) {
+        continue;
+      }
+      const uint32_t i = y * (n + 1) + x;
+      for (uint32_t k : {i, i + 1, i + n + 2, i, i + n + 2, i + n + 1}) {
+        indices.push_back(k);
+      }
+    }
+  }
+
+  const CollisionMesh mesh = simplifyCollisionMesh(positions, indices, 0.05f);
+  EXPECT_LT(mesh.indices.size(), indices.size() / 20);
+  EXPECT_GT(mesh.indices.size(), 0);
+  std::vector<bool> used(mesh.positions.size(), false);
+  for (size_t i = 0; i < mesh.indices.size(); i += 3) {
+    vec3f centroid = vec3f::Zero();
+    for (int k = 0; k < 3; ++k) {
+      ASSERT_LT(mesh.indices[i + k], mesh.positions.size());
+      used[mesh.indices[i + k]] = true;
+      centroid += mesh.positions[mesh.indices[i + k]] / 3;
+    }
+    // no slivers, and the hole stays open
+    const vec3f& a = mesh.positions[mesh.indices[i]];
+    EXPECT_GT((mesh.positions[mesh.indices[i + 1]] - a)
+                  .cross(mesh.positions[mesh.indices[i + 2]] - a)
+                  .norm(),
+              0);
+    EXPECT_FALSE(centroid[0] > 0.45f && centroid[0] < 0.55f &&
+                 centroid[1] > 0.45f && centroid[1] < 0.55f);
+  }
+  // only the vertices still used are kept
+  EXPECT_EQ(std::count(used.begin(), used.end(), false), 0);
+
+  const std::string file = "GeoTest.collision";
+  const std::string source = "GeoTest.collision.glb";
+  std::ofstream(source) << "scene";
+  ASSERT_TRUE(saveCollisionMeshes(file, {mesh, {}}, source));
+  std::vector<CollisionMesh> loaded;
+  ASSERT_TRUE(loadCollisionMeshes(file, source, loaded));
+  ASSERT_EQ(loaded.size(), 2);
+  EXPECT_EQ(loaded[0].positions, mesh.positions);
+  EXPECT_EQ(loaded[0].indices, mesh.indices);
+  EXPECT_TRUE(loaded[1].indices.empty());
+  // made from another scene
+  std::ofstream(source) << "another scene";
+  EXPECT_FALSE(loadCollisionMeshes(file, source, loaded));
+  std::remove(file.c_str());
+  std::remove(source.c_str());
+}
+
+TEST(GeoTest, OptimizeVertexCache) {
+  // a 64x64 quad grid, its triangles shuffled
+  const int n = 64;
+  std::vector<vec3f> positions;
+  std::vector<uint32_t> triangles;
+  for (int y = 0; y <= n; ++y) {
+    for (int x = 0; x <= n; ++x) {
+      positions.emplace_back(x, y, 0);
+    }
+  }
+  for (int y = 0; y < n; ++y) {
+    for (int x = 0; x < n; ++x) {
+      triangles.push_back(2 * (y * n + x));
+      triangles.push_back(2 * (y * n + x) + 1);
+    }
+  }
+  std::shuffle(triangles.begin(), triangles.end(), std::mt19937(0));
+  std::vector<uint32_t> indices;
+  for (uint32_t t : triangles) {
+    const uint32_t q = t / 2, i = q / n * (n + 1) + q % n;
+    for (uint32_t k : t % 2 ? std::vector<uint32_t>{i, i + n + 2, i + n + 1}
+                            : std::vector<uint32_t>{i, i + 1, i + n + 2}) {
+      indices.push_back(k);
+    }
+  }
+  const float shuffledRatio = vertexCacheMissRatio(indices, positions.size());
+  EXPECT_GT(shuffledRatio, 2);
+
+  auto isPermutation = [](std::vector<uint32_t> order, size_t size) {
+    std::sort(order.begin(), order.end());
+    for (size_t i = 0; i < order.size(); ++i) {
+      if (order[i] != i) {
+        return false;
+      }
+    }
+    return order.size() == size;
+  };
+
+  const std::vector<uint32_t> cacheOrder =
+      vertexCacheTriangleOrder(indices, positions.size());
+  ASSERT_TRUE(isPermutation(cacheOrder, indices.size() / 3));
+  const float cacheRatio = vertexCacheMissRatio(
+      reorderTriangles(indices, cacheOrder), positions.size());
+  EXPECT_LT(cacheRatio, 0.8);
+
+  // splitting into clusters costs few extra misses
+  const std::vector<uint32_t> overdrawOrder =
+      overdrawTriangleOrder(indices, positions, cacheOrder);
+  ASSERT_TRUE(isPermutation(overdrawOrder, indices.size() / 3));
+  EXPECT_LT(vertexCacheMissRatio(reorderTriangles(indices, overdrawOrder),
+                                 positions.size()),
+            cacheRatio * 1.2);
+
+  // vertices in order of first use
+  const std::vector<uint32_t> optimized = reorderTriangles(indices, cacheOrder);
+  const std::vector<uint32_t> fetchOrder =
+      vertexFetchOrder(optimized, positions.size() + 1);
+  ASSERT_TRUE(isPermutation(fetchOrder, positions.size() + 1));
+  EXPECT_EQ(fetchOrder[0], optimized[0]);
+  // the unused vertex goes last
+  EXPECT_EQ(fetchOrder.back(), positions.size());
+}
@@ -3,8 +3,15 @@
 // LICENSE file in the root directory of this source tree.
 
 #include <gtest/gtest.h>
+#include <cstdio>
+#include <fstream>
+#include <utime.h>
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/writer.h>
 #include "esp/core/esp.h"
+#include "esp/io/cache.h"
 #include "esp/io/io.h"
+#include "esp/io/json.h"
 
 #include "configure.h"
 
@@ -30,6 +37,183 @@ TEST(IOTest, fileSizeTest) {
   LOG(INFO) << "File size of " << nonexistingFile << " is " << result;
 }
 
+TEST(IOTest, absolutePathTest) {
+  std::string existingFile = FILE_THAT_EXISTS;
+  // FILE_THAT_EXISTS is already absolute, a detour through ".." must resolve
+  // to the same path
+  const std::string detour =
+      existingFile.substr(0, existingFile.find_last_of('/')) +
+      "/../tests/IOTest.cpp";
+  EXPECT_EQ(absolutePath(existingFile), absolutePath(detour));
+  EXPECT_EQ(absolutePath(existingFile)[0], '/');
+
+  std::string nonexistingFile = "Foo.bar";
+  EXPECT_EQ(absolutePath(nonexistingFile), nonexistingFile);
+}
+
+TEST(IOTest, mappedFileTest) {
+  std::string existingFile = FILE_THAT_EXISTS;
+  MappedFile mapped(existingFile);
+  ASSERT_TRUE(mapped.isValid());
+  EXPECT_EQ(mapped.size(), fileSize(existingFile));
+  EXPECT_EQ(std::string(mapped.data(), 2), "//");
+
+  MappedFile missing("Foo.bar");
+  EXPECT_FALSE(missing.isValid());
+}
+
+TEST(IOTest, cacheRoundTripTest) {
+  const std::string cacheFile = "IOTest.cache";
+  const std::vector<float> floats = {1.0f, 2.0f, 3.0f};
+  const std::vector<uint8_t> bytes = {4, 5, 6, 7, 8};
+  const std::vector<uint32_t> empty;
+
+  const std::string source = "IOTest.source";
+  std::ofstream(source) << "source";
+  CacheWriter writer(42, 1, source);
+  writer.addSection(bytes);
+  writer.addSection(floats);
+  writer.addSection(empty);
+  ASSERT_TRUE(writer.write(cacheFile));
+
+  CacheReader reader(cacheFile, 42, 1, source);
+  ASSERT_TRUE(reader.isValid());
+  ASSERT_EQ(reader.getNumSections(), 3u);
+  std::vector<uint8_t> readBytes;
+  std::vector<float> readFloats;
+  std::vector<uint32_t> readEmpty = {9};
+  EXPECT_TRUE(reader.readSection(0, readBytes));
+  EXPECT_TRUE(reader.readSection(1, readFloats));
+  EXPECT_TRUE(reader.readSection(2, readEmpty));
+  EXPECT_EQ(readBytes, bytes);
+  EXPECT_EQ(readFloats, floats);
+  EXPECT_TRUE(readEmpty.empty());
+  // section data is aligned for use in place
+  const char* data = nullptr;
+  size_t size = 0;
+  EXPECT_TRUE(reader.getSection(1, data, size));
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(data) % 16, 0);
+  // 5 bytes are not a whole number of floats
+  EXPECT_FALSE(reader.readSection(0, readFloats));
+  EXPECT_FALSE(reader.readSection(3, readFloats));
+
+  // a mismatching kind, version or source is rejected
+  EXPECT_FALSE(CacheReader(cacheFile, 43, 1, source).isValid());
+  EXPECT_FALSE(CacheReader(cacheFile, 42, 2, source).isValid());
+  EXPECT_FALSE(CacheReader(cacheFile, 42, 1, FILE_THAT_EXISTS).isValid());
+  EXPECT_FALSE(CacheReader("Foo.bar", 42, 1, source).isValid());
+  std::remove(cacheFile.c_str());
+  std::remove(source.c_str());
+}
+
+TEST(IOTest, cacheSourceStampTest) {
+  const std::string cacheFile = "IOTestStamp.cache";
+  const std::string source = "IOTestStamp.source";
+  std::ofstream(source) << "source";
+  utimbuf times{1000000, 1000000};
+  ASSERT_EQ(utime(source.c_str(), &times), 0);
+  const SourceStamp stamp = getSourceStamp(source, true);
+  EXPECT_EQ(stamp.size, 6u);
+  EXPECT_EQ(stamp.mtime, int64_t(1000000) * 1000000000);
+  EXPECT_EQ(stamp.crc, crc32("source", 6));
+  ASSERT_TRUE(CacheWriter(42, 1, source).write(cacheFile));
+  EXPECT_TRUE(CacheReader(cacheFile, 42, 1, source).isValid());
+
+  // touched or copied, but the same contents
+  times = {2000000, 2000000};
+  ASSERT_EQ(utime(source.c_str(), &times), 0);
+  EXPECT_TRUE(CacheReader(cacheFile, 42, 1, source).isValid());
+
+  // edited in place to the same size
+  std::ofstream(source) << "SOURCE";
+  times = {3000000, 3000000};
+  ASSERT_EQ(utime(source.c_str(), &times), 0);
+  EXPECT_EQ(getSourceStamp(source, false).size, 6u);
+  EXPECT_FALSE(CacheReader(cacheFile, 42, 1, source).isValid());
+
+  // caches without a source
+  ASSERT_TRUE(CacheWriter(42, 1, "").write(cacheFile));
+  EXPECT_TRUE(CacheReader(cacheFile, 42, 1, "").isValid());
+  std::remove(cacheFile.c_str());
+  std::remove(source.c_str());
+}
+
+TEST(IOTest, sharedCacheDirTest) {
+  const std::string source = FILE_THAT_EXISTS;
+  EXPECT_EQ(cacheFilename(source), source + ".cache");
+
+  const std::string dir = "IOTestSharedCache";
+  setSharedCacheDir(dir);
+  ASSERT_EQ(getSharedCacheDir(), dir);
+  const std::string cacheFile = cacheFilename(source);
+  EXPECT_EQ(cacheFile.find(dir + "/"), 0u);
+  EXPECT_EQ(cacheFile.substr(cacheFile.size() - 6), ".cache");
+  // sources of the same name in other directories do not collide
+  EXPECT_NE(cacheFilename("other/" + source), cacheFile);
+  {
+    CacheLock lock(cacheFile);
+    const std::vector<uint32_t> data = {1, 2, 3};
+    CacheWriter writer(42, 1, source);
+    writer.addSection(data);
+    ASSERT_TRUE(writer.write(cacheFile));
+  }
+  std::vector<uint32_t> readData;
+  EXPECT_TRUE(
+      CacheReader(cacheFile, 42, 1, source).readSection(0, readData));
+  EXPECT_EQ(readData.size(), 3u);
+
+  // a cache next to the source takes precedence
+  const std::string localFile = source + ".cache";
+  std::ofstream(localFile).put('\0');
+  EXPECT_EQ(cacheFilename(source), localFile);
+  std::remove(localFile.c_str());
+
+  setSharedCacheDir("");
+  std::remove(cacheFile.c_str());
+  std::remove((cacheFile + ".lock").c_str());
+  std::remove(dir.c_str());
+}
+
+TEST(IOTest, crc32Test) {
+  const std::string data = "123456789";
+  EXPECT_EQ(crc32(data.data(), data.size()), 0xcbf43926u);
+  // continuing from the crc of a prefix gives the crc of the whole data
+  EXPECT_EQ(crc32(data.data() + 4, data.size() - 4, crc32(data.data(), 4)),
+            0xcbf43926u);
+  EXPECT_EQ(crc32(nullptr, 0), 0u);
+}
+
+TEST(IOTest, jsonKeyFilterTest) {
+  const std::string jsonFile = "IOTest.json";
+  std::ofstream(jsonFile)
+      << R"({"id": "house", "materials": [{"id": 1, "texture": "t"}],)"
+      << R"( "levels": [{"id": "0", "nodes": [{"id": "0_0", "bbox": )"
+      << R"({"min": [0, 1, 2], "max": [3, 4, 5]}, "transform": [1, 0]},)"
+      << R"( {"id": "0_1", "extra": {"nested": [null, true]}}]}]})";
+
+  const JsonDocument json =
+      parseJsonFile(jsonFile, {"id", "levels", "nodes", "bbox", "max"});
+  EXPECT_EQ(jsonToString(json),
+            R"({"id":"house","levels":[{"id":"0","nodes":)"
+            R"([{"id":"0_0","bbox":{"max":[3,4,5]}},{"id":"0_1"}]}]})");
+  EXPECT_EQ(json["levels"][0]["nodes"].Size(), 2u);
+  EXPECT_EQ(json["levels"][0]["nodes"][0]["bbox"].MemberCount(), 1u);
+
+  // streaming to any SAX handler, here a writer
+  rapidjson::StringBuffer buffer;
+  rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+  JsonKeyFilter<rapidjson::Writer<rapidjson::StringBuffer>> filter(
+      writer, {"materials", "texture"});
+  EXPECT_TRUE(streamJsonFile(jsonFile, filter));
+  EXPECT_EQ(std::string(buffer.GetString()),
+            R"({"materials":[{"texture":"t"}]})");
+
+  std::ofstream(jsonFile) << R"({"id": [1, 2})";
+  EXPECT_THROW(parseJsonFile(jsonFile, {"id"}), std::runtime_error);
+  EXPECT_THROW(parseJsonFile("Foo.bar", {"id"}), std::runtime_error);
+  std::remove(jsonFile.c_str());
+}
+
 TEST(IOTest, fileRmExtTest) {
   std::string filename = "/foo/bar.jpeg";
 
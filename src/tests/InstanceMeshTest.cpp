@@ -0,0 +1,69 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#include <gtest/gtest.h>
+
+#include "esp/assets/GenericInstanceMeshData.h"
+#include "esp/core/esp.h"
+
+using namespace esp;
+using namespace esp::assets;
+
+TEST(InstanceMeshTest, ChunksRebuildTheMesh) {
+  // a grid of more vertices than 16-bit indices reach, with the left and the
+  // right half of its triangles in different objects
+  const uint32_t n = 300;
+  std::vector<vec3f> positions;
+  std::vector<vec3uc> colors;
+  for (uint32_t y = 0; y < n; ++y) {
+    for (uint32_t x = 0; x < n; ++x) {
+      positions.emplace_back(x, 0, y);
+      colors.emplace_back(x % 256, y % 256, 7);
+    }
+  }
+  std::vector<vec3ui> triangles;
+  std::vector<uint32_t> objectIds;
+  for (uint32_t y = 0; y + 1 < n; ++y) {
+    for (uint32_t x = 0; x + 1 < n; ++x) {
+      const uint32_t v = y * n + x;
+      triangles.emplace_back(v, v + n, v + 1);
+      triangles.emplace_back(v + 1, v + n, v + n + 1);
+      objectIds.push_back(x < n / 2 ? 3 : 5);
+      objectIds.push_back(x < n / 2 ? 3 : 5);
+    }
+  }
+
+  std::vector<InstanceMeshVertex> vertices;
+  std::vector<uint16_t> indices;
+  std::vector<InstanceMeshChunk> chunks;
+  buildInstanceMeshChunks(positions, colors, triangles, objectIds, vertices,
+                          indices, chunks);
+  ASSERT_GT(chunks.size(), 1u);
+  ASSERT_EQ(indices.size(), 3 * triangles.size());
+  // the column of vertices between the objects is in both
+  EXPECT_GE(vertices.size(), positions.size() + n);
+
+  size_t t = 0;
+  for (size_t c = 0; c < chunks.size(); ++c) {
+    const InstanceMeshChunk& chunk = chunks[c];
+    const size_t endVertex =
+        c + 1 < chunks.size() ? chunks[c + 1].firstVertex : vertices.size();
+    EXPECT_LE(endVertex - chunk.firstVertex, 1u << 16);
+    EXPECT_EQ(chunk.firstIndex, 3 * t);
+    for (size_t i = 0; i < chunk.numIndices; ++i) {
+      const size_t v = chunk.firstVertex + indices[chunk.firstIndex + i];
+      ASSERT_LT(v, endVertex);
+      const uint32_t original = triangles[t][i % 3];
+      EXPECT_EQ(vec3f(vertices[v].position[0], vertices[v].position[1],
+                      vertices[v].position[2]),
+                positions[original]);
+      EXPECT_EQ(vertices[v].color[0], colors[original][0]);
+      EXPECT_EQ(vertices[v].objectId, objectIds[t]);
+      if (i % 3 == 2) {
+        ++t;
+      }
+    }
+  }
+  EXPECT_EQ(t, triangles.size());
+}
@@ -4,8 +4,14 @@
 
 #include <Corrade/Utility/Directory.h>
 #include <gtest/gtest.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
 
+#include "esp/scene/RegionVisibility.h"
 #include "esp/scene/SemanticScene.h"
+#include "esp/scene/SemanticSceneIndex.h"
 
 #include "configure.h"
 
@@ -48,3 +54,275 @@ TEST(Mp3dTest, Load) {
     }
   }
 }
+
+TEST(Mp3dTest, SemanticIndexRemap) {
+  const std::string filename = Cr::Utility::Directory::join(
+      SCENE_DATASETS, "mp3d/1LXtFkjw3qL/1LXtFkjw3qL.house");
+  if (!Cr::Utility::Directory::exists(filename))
+    GTEST_SKIP_("MP3D dataset not found.");
+
+  SemanticScene house;
+  SemanticScene::loadMp3dHouse(filename, house);
+  EXPECT_TRUE(house.semanticIndexRemap(SemanticIdMapping::Segment).empty());
+
+  // the tables agree with the per-index lookup
+  const std::vector<int> objects =
+      house.semanticIndexRemap(SemanticIdMapping::Object);
+  const std::vector<int> categories =
+      house.semanticIndexRemap(SemanticIdMapping::Category);
+  ASSERT_FALSE(objects.empty());
+  ASSERT_EQ(objects.size(), categories.size());
+  for (int i = 0; i < objects.size(); ++i) {
+    const int objectIndex = house.semanticIndexToObjectIndex(i);
+    EXPECT_EQ(objects[i], objectIndex);
+    if (objectIndex != ID_UNDEFINED) {
+      EXPECT_EQ(categories[i],
+                house.objects()[objectIndex]->category()->index(""));
+    } else {
+      EXPECT_EQ(categories[i], ID_UNDEFINED);
+    }
+  }
+}
+
+namespace {
+// Write a synthetic house of numObjects objects, object i in region i % 2 and
+// category i % 3 - 1, at x = i + 0.5
+void writeTestHouse(const std::string& filename, int numObjects) {
+  std::ofstream os(filename);
+  os << "ASCII 1.1\n"
+     << "H test house 0 0 0 0 " << numObjects << " " << numObjects
+     << " 2 2 0 1  0 0 0 0 0  -1 -2 -3 4 5 6  0 0 0 0 0\n"
+     << "L 0 2 -  0 0 0  -1 -2 -3 4 5 6  0 0 0 0 0\n"
+     << "R 0 0 0 0 k  1 1 0  0 0 0 2 2 2.5 2.5  0 0 0 0\r\n"
+     << "R 1 0 0 0 b  3 1 0  2 0 0 4 2 2.5 2.5  0 0 0 0\n"
+     << "P 0 0 1 -  2 0 0 2 2 2  0 0 0 0\n"
+     << "C 0 5 kitchen#cabinet 7 cabinet 0 0 0 0 0\n"
+     << "C 1 9 chair 3 chair 0 0 0 0 0\n";
+  for (int i = 0; i < numObjects; ++i) {
+    os << "O " << i << " " << i % 2 << " " << (i % 3) - 1 << "  " << i
+       << ".5 -2.25e-1 +3  1 0 0  0 1 0  0.5 1.5 .25  0 0 0 0 0 0 0 0\n";
+  }
+  for (int i = 0; i < numObjects; ++i) {
+    os << "E " << i << " " << i << " " << 1000000 + i
+       << " 1.0  0 0 0  0 0 0 1 1 1  0 0 0 0 0\n";
+  }
+}
+}  // namespace
+
+TEST(Mp3dTest, ParseHouse) {
+  // enough objects and segments to be parsed in parallel
+  const int numObjects = 5000;
+  const std::string filename = Cr::Utility::Directory::join(
+      Cr::Utility::Directory::tmp(), "Mp3dTest.house");
+  writeTestHouse(filename, numObjects);
+
+  for (int numThreads : {1, 4}) {
+    SemanticScene house;
+    ASSERT_TRUE(SemanticScene::loadMp3dHouse(filename, house,
+                                             quatf::Identity(), numThreads));
+    EXPECT_EQ(house.count("objects"), numObjects);
+    EXPECT_EQ(house.count("levels"), 1);
+    EXPECT_TRUE(house.aabb().min().isApprox(vec3f(-1, -2, -3)));
+    ASSERT_EQ(house.levels().size(), 1);
+    ASSERT_EQ(house.regions().size(), 2);
+    EXPECT_EQ(house.regions()[0]->category()->name(), "kitchen");
+    EXPECT_EQ(house.levels()[0]->regions().size(), 2);
+    ASSERT_EQ(house.categories().size(), 2);
+    EXPECT_EQ(house.categories()[0]->name("raw"), "kitchen cabinet");
+    EXPECT_EQ(house.categories()[0]->index(""), 7);
+
+    ASSERT_EQ(house.objects().size(), numObjects);
+    EXPECT_EQ(house.regions()[1]->objects().size(), numObjects / 2);
+    for (int i = 0; i < numObjects; ++i) {
+      const SemanticObject& object = *house.objects()[i];
+      EXPECT_EQ(object.region(), house.regions()[i % 2]);
+      const geo::OBB obb = object.obb();
+      EXPECT_TRUE(obb.center().isApprox(vec3f(i + 0.5f, -0.225f, 3.0f)));
+      EXPECT_TRUE(obb.sizes().isApprox(vec3f(1.0f, 3.0f, 0.5f)));
+      if (i % 3 == 0) {
+        EXPECT_EQ(object.category()->index(""), ID_UNDEFINED);
+      } else {
+        EXPECT_EQ(object.category(), house.categories()[(i % 3) - 1]);
+      }
+      EXPECT_EQ(house.semanticIndexToObjectIndex(1000000 + i), i);
+    }
+  }
+
+  // a malformed record fails the load instead of throwing
+  {
+    std::ofstream os(filename, std::ios::app);
+    os << "O 5000 0 0  1 2\n";
+  }
+  SemanticScene house;
+  EXPECT_FALSE(SemanticScene::loadMp3dHouse(filename, house));
+  std::remove(filename.c_str());
+}
+
+TEST(Mp3dTest, ObjectArrays) {
+  const std::string filename = Cr::Utility::Directory::join(
+      Cr::Utility::Directory::tmp(), "Mp3dTestArrays.house");
+  writeTestHouse(filename, 30);
+  SemanticScene house;
+  // rotated, so that the OBBs are not axis aligned
+  const quatf rotation(Eigen::AngleAxisf(0.3f, vec3f(1, 2, 3).normalized()));
+  ASSERT_TRUE(SemanticScene::loadMp3dHouse(filename, house, rotation));
+  std::remove(filename.c_str());
+
+  const SemanticObjectArrays arrays = house.objectArrays("raw");
+  ASSERT_EQ(arrays.size(), house.objects().size());
+  for (int i = 0; i < arrays.size(); ++i) {
+    const SemanticObject& object = *house.objects()[i];
+    EXPECT_EQ(arrays.categoryIndex[i], object.category()->index("raw"));
+    EXPECT_EQ(arrays.regionIndex[i], i % 2);
+    EXPECT_TRUE(arrays.obbCenter[i].isApprox(object.obb().center()));
+    EXPECT_TRUE(arrays.aabbMax[i].isApprox(object.aabb().max()));
+  }
+
+  const vec3f point = rotation * vec3f(10.0f, 1.0f, 2.5f);
+  const std::vector<float> distances = arrays.distances(point);
+  std::vector<int> within, chairsWithin;
+  for (int i = 0; i < arrays.size(); ++i) {
+    const float distance = house.objects()[i]->obb().distance(point);
+    EXPECT_NEAR(distances[i], distance, 1e-4f);
+    if (distance <= 3.0f) {
+      within.push_back(i);
+      if (i % 3 == 2) {
+        chairsWithin.push_back(i);
+      }
+    }
+  }
+  EXPECT_FALSE(within.empty());
+  EXPECT_EQ(arrays.objectsWithinRadius(point, 3.0f), within);
+  EXPECT_EQ(arrays.objectsWithinRadius(point, 3.0f, 9), chairsWithin);
+  EXPECT_EQ(arrays.objectsOfCategory(5).size(), 10);
+  EXPECT_EQ(arrays.objectsInRegion(1).size(), 15);
+}
+
+TEST(Mp3dTest, SemanticSceneIndex) {
+  const std::string filename = Cr::Utility::Directory::join(
+      Cr::Utility::Directory::tmp(), "Mp3dTestIndex.house");
+  writeTestHouse(filename, 200);
+  SemanticScene house;
+  const quatf rotation(Eigen::AngleAxisf(0.3f, vec3f(1, 2, 3).normalized()));
+  ASSERT_TRUE(SemanticScene::loadMp3dHouse(filename, house, rotation));
+  std::remove(filename.c_str());
+  const SemanticSceneIndex index{house};
+  ASSERT_EQ(index.getNumObjects(), 200);
+  ASSERT_EQ(index.getNumRegions(), 2);
+
+  // the queries agree with a scan over all objects and regions
+  const SemanticObjectArrays arrays = house.objectArrays();
+  std::srand(0);
+  auto random = [](float min, float max) {
+    return min + (max - min) * std::rand() / static_cast<float>(RAND_MAX);
+  };
+  for (int iPoint = 0; iPoint < 100; ++iPoint) {
+    const vec3f point = rotation * vec3f(random(-5.0f, 205.0f),
+                                         random(-2.0f, 2.0f),
+                                         random(1.0f, 5.0f));
+    const std::vector<float> distances = arrays.distances(point);
+    std::vector<int> containing;
+    std::vector<int> byDistance(distances.size());
+    for (int i = 0; i < distances.size(); ++i) {
+      byDistance[i] = i;
+      if (house.objects()[i]->obb().contains(point)) {
+        containing.push_back(i);
+      }
+    }
+    EXPECT_EQ(index.objectsContaining(point), containing);
+
+    std::stable_sort(byDistance.begin(), byDistance.end(),
+                     [&](int a, int b) { return distances[a] < distances[b]; });
+    const std::vector<int> nearest = index.nearestObjects(point, 5);
+    ASSERT_EQ(nearest.size(), 5);
+    for (int i = 0; i < nearest.size(); ++i) {
+      EXPECT_NEAR(distances[nearest[i]], distances[byDistance[i]], 1e-4f);
+    }
+    for (int object : index.nearestObjects(point, 5, 1.0f)) {
+      EXPECT_LE(distances[object], 1.0f + 1e-4f);
+    }
+
+    int region = ID_UNDEFINED;
+    float volume = 0.0f;
+    for (int i = 0; i < house.regions().size(); ++i) {
+      const box3f aabb = house.regions()[i]->aabb();
+      if (aabb.contains(point) &&
+          (region == ID_UNDEFINED || aabb.volume() < volume)) {
+        region = i;
+        volume = aabb.volume();
+      }
+    }
+    EXPECT_EQ(index.regionAt(point), region);
+  }
+
+  // objects are in a row along rotated x, a ray along it from the left hits
+  // the first one, one from inside an object hits it at 0
+  const vec3f direction = rotation * vec3f::UnitX();
+  SemanticRayHit hit =
+      index.pickObject(rotation * vec3f(-10.0f, -0.225f, 3.0f), direction);
+  EXPECT_EQ(hit.objectIndex, 0);
+  EXPECT_NEAR(hit.distance, 10.0f, 1e-3f);
+  hit = index.pickObject(rotation * vec3f(42.5f, -0.225f, 3.0f), -direction);
+  EXPECT_EQ(hit.objectIndex, 42);
+  EXPECT_NEAR(hit.distance, 0.0f, 1e-3f);
+  hit = index.pickObject(rotation * vec3f(-10.0f, -0.225f, 3.0f), direction,
+                         5.0f);
+  EXPECT_EQ(hit.objectIndex, ID_UNDEFINED);
+  // a ray missing all objects above them
+  hit = index.pickObject(rotation * vec3f(-10.0f, -0.225f, 10.0f), direction);
+  EXPECT_EQ(hit.objectIndex, ID_UNDEFINED);
+}
+
+TEST(Mp3dTest, RegionVisibility) {
+  // rooms a and d side by side along z, b and c along x behind a wall at
+  // x = 4.25, with an open gap between b and c
+  const std::vector<box3f> regions = {
+      box3f(vec3f(0, 0, 0), vec3f(4, 3, 4)),
+      box3f(vec3f(4.5f, 0, 0), vec3f(8.5f, 3, 4)),
+      box3f(vec3f(9, 0, 0), vec3f(13, 3, 4)),
+      box3f(vec3f(0, 0, 4), vec3f(4, 3, 8)),
+  };
+  const std::vector<vec3f> positions = {
+      vec3f(4.25f, -1, -1), vec3f(4.25f, 4, -1), vec3f(4.25f, 4, 9),
+      vec3f(4.25f, -1, 9)};
+  const std::vector<uint32_t> indices = {0, 1, 2, 0, 2, 3};
+  const RegionVisibility::ptr visibility =
+      RegionVisibility::compute(regions, positions, indices);
+  ASSERT_EQ(visibility->getNumRegions(), 4);
+  EXPECT_EQ(visibility->visibleRegions(0), (std::vector<int>{0, 3}));
+  EXPECT_EQ(visibility->visibleRegions(1), (std::vector<int>{1, 2}));
+  EXPECT_EQ(visibility->visibleRegions(2), (std::vector<int>{1, 2}));
+  EXPECT_EQ(visibility->visibleRegions(3), (std::vector<int>{0, 3}));
+
+  EXPECT_EQ(visibility->regionAt(vec3f(10, 1, 1)), 2);
+  EXPECT_EQ(visibility->regionAt(vec3f(20, 1, 1)), ID_UNDEFINED);
+  const box3f inC(vec3f(10, 0, 1), vec3f(11, 1, 2));
+  const box3f outside(vec3f(20, 0, 1), vec3f(21, 1, 2));
+  const box3f acrossAAndB(vec3f(3, 0, 1), vec3f(5, 1, 2));
+  EXPECT_FALSE(visibility->isBoxVisible(0, inC));
+  EXPECT_TRUE(visibility->isBoxVisible(1, inC));
+  EXPECT_TRUE(visibility->isBoxVisible(0, outside));
+  EXPECT_TRUE(visibility->isBoxVisible(0, acrossAAndB));
+  EXPECT_TRUE(visibility->isBoxVisible(ID_UNDEFINED, inC));
+
+  // the sets survive a round trip, for the same house file only
+  const std::string filename = Cr::Utility::Directory::join(
+      Cr::Utility::Directory::tmp(), "Mp3dTestRegions.pvs");
+  const std::string houseFile = Cr::Utility::Directory::join(
+      Cr::Utility::Directory::tmp(), "Mp3dTestRegions.house");
+  std::ofstream(houseFile) << "house";
+  ASSERT_TRUE(visibility->save(filename, houseFile));
+  const RegionVisibility::ptr loaded =
+      RegionVisibility::load(filename, houseFile);
+  std::ofstream(houseFile) << "another house";
+  EXPECT_EQ(RegionVisibility::load(filename, houseFile), nullptr);
+  std::remove(filename.c_str());
+  std::remove(houseFile.c_str());
+  ASSERT_NE(loaded, nullptr);
+  ASSERT_EQ(loaded->getNumRegions(), 4);
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_EQ(loaded->getRegionBoxes()[i].min(), regions[i].min());
+    EXPECT_EQ(loaded->getRegionBoxes()[i].max(), regions[i].max());
+    EXPECT_EQ(loaded->visibleRegions(i), visibility->visibleRegions(i));
+  }
+}
@@ -4,16 +4,27 @@
 
 #include <Corrade/Utility/Directory.h>
 #include <gtest/gtest.h>
+#include <algorithm>
+#include <cstdio>
+
+#include <utime.h>
 
 #include "esp/agent/Agent.h"
+#include "esp/assets/MeshData.h"
 #include "esp/core/esp.h"
 #include "esp/core/random.h"
+#include "esp/io/cache.h"
+#include "esp/io/io.h"
+#include "esp/nav/EpisodeSampler.h"
+#include "esp/nav/GeodesicDistanceField.h"
 #include "esp/nav/PathFinder.h"
 #include "esp/scene/ObjectControls.h"
 #include "esp/scene/SceneGraph.h"
 
 #include "configure.h"
 
+#include "AllocationCounter.h"
+
 namespace Cr = Corrade;
 
 using namespace esp;
@@ -24,6 +35,25 @@ void printPathPoint(int run, int step, const vec3f& p, float distance) {
             << "," << distance;
 }
 
+// size x size meters floor made of 1m quads
+esp::assets::MeshData floorMesh(int size) {
+  esp::assets::MeshData mesh;
+  for (int z = 0; z <= size; z++) {
+    for (int x = 0; x <= size; x++) {
+      mesh.vbo.emplace_back(x, 0, z);
+    }
+  }
+  for (int z = 0; z < size; z++) {
+    for (int x = 0; x < size; x++) {
+      const uint32_t v = z * (size + 1) + x;
+      mesh.ibo.insert(mesh.ibo.end(),
+                      {v, v + size + 1, v + 1, v + 1, v + size + 1,
+                       v + size + 2});
+    }
+  }
+  return mesh;
+}
+
 void testPathFinder(PathFinder& pf) {
   for (int i = 0; i < 100000; i++) {
     ShortestPath path;
@@ -107,3 +137,571 @@ TEST(NavTest, PathFinderTestCases) {
                     (testPath.requestedStart - testPath.requestedEnd).norm()),
            0.001);
 }
+
+TEST(NavTest, PathFinderBatchMatchesSequential) {
+  PathFinder pf;
+  pf.loadNavMesh(Cr::Utility::Directory::join(
+      SCENE_DATASETS, "habitat-test-scenes/skokloster-castle.navmesh"));
+  std::vector<ShortestPath> paths(1000);
+  for (auto& path : paths) {
+    path.requestedStart = pf.getRandomNavigablePoint();
+    path.requestedEnd = pf.getRandomNavigablePoint();
+  }
+  std::vector<ShortestPath> sequential = paths;
+
+  const std::vector<bool> found = pf.findPaths(paths, 4);
+  ASSERT_EQ(found.size(), paths.size());
+  for (int i = 0; i < paths.size(); i++) {
+    EXPECT_EQ(found[i], pf.findPath(sequential[i]));
+    EXPECT_EQ(paths[i].geodesicDistance, sequential[i].geodesicDistance);
+    EXPECT_EQ(paths[i].points.size(), sequential[i].points.size());
+  }
+}
+
+TEST(NavTest, GeodesicDistanceFieldMatchesFindPath) {
+  PathFinder::ptr pf = PathFinder::create();
+  pf->loadNavMesh(Cr::Utility::Directory::join(
+      SCENE_DATASETS, "habitat-test-scenes/skokloster-castle.navmesh"));
+  const vec3f goal = pf->getRandomNavigablePoint();
+  GeodesicDistanceField field(pf, {goal});
+  EXPECT_LT(field.distanceFrom(goal), 1e-3);
+
+  float totalError = 0;
+  int numFound = 0;
+  for (int i = 0; i < 1000; i++) {
+    ShortestPath path;
+    path.requestedStart = pf->getRandomNavigablePoint();
+    path.requestedEnd = goal;
+    const float distance = field.distanceFrom(path.requestedStart);
+    if (pf->findPath(path)) {
+      ASSERT_LT(distance, std::numeric_limits<float>::infinity());
+      totalError += std::abs(distance - path.geodesicDistance) /
+                    std::max(path.geodesicDistance, 1.0f);
+      ++numFound;
+    }
+  }
+  ASSERT_GT(numFound, 0);
+  // the field follows vertices instead of the exact corridor
+  EXPECT_LT(totalError / numFound, 0.1);
+}
+
+TEST(NavTest, GoalSetMatchesMultiGoalPath) {
+  const std::string navMeshFile = Cr::Utility::Directory::join(
+      SCENE_DATASETS, "habitat-test-scenes/skokloster-castle.navmesh");
+  PathFinder::ptr pf = PathFinder::create();
+  pf->loadNavMesh(navMeshFile);
+  std::vector<vec3f> goals;
+  for (int i = 0; i < 200; i++) {
+    goals.push_back(pf->getRandomNavigablePoint());
+  }
+  const int goalSet = pf->registerGoalSet(goals);
+  GeodesicDistanceField field(pf, goals);
+
+  for (int i = 0; i < 20; i++) {
+    MultiGoalShortestPath multi;
+    multi.requestedStart = pf->getRandomNavigablePoint();
+    multi.requestedEnds = goals;
+    ShortestPath path;
+    path.requestedStart = multi.requestedStart;
+    const bool found = pf->findPath(multi);
+    ASSERT_EQ(pf->findPathToGoalSet(path, goalSet), found);
+    EXPECT_EQ(pf->distanceToGoalSet(path.requestedStart, goalSet),
+              field.distanceFrom(path.requestedStart));
+    if (!found)
+      continue;
+    EXPECT_NE(std::find(goals.begin(), goals.end(), path.requestedEnd),
+              goals.end());
+    // the field picks the goal along vertices, close to the best one
+    EXPECT_GE(path.geodesicDistance, multi.geodesicDistance - 1e-3f);
+    EXPECT_LT(path.geodesicDistance, 1.25f * multi.geodesicDistance + 1.0f);
+  }
+
+  // goal sets survive reloading the navmesh, until unregistered
+  pf->loadNavMesh(navMeshFile);
+  EXPECT_LT(pf->distanceToGoalSet(goals[0], goalSet), 1e-3);
+  pf->unregisterGoalSet(goalSet);
+  EXPECT_EQ(pf->distanceToGoalSet(goals[0], goalSet),
+            std::numeric_limits<float>::infinity());
+}
+
+TEST(NavTest, PathFinderSaveLoadKeepsIslands) {
+  PathFinder pf;
+  pf.loadNavMesh(Cr::Utility::Directory::join(
+      SCENE_DATASETS, "habitat-test-scenes/skokloster-castle.navmesh"));
+  // the saved navmesh carries its islands
+  const std::string savedNavMesh = "NavTest.navmesh";
+  ASSERT_TRUE(pf.saveNavMesh(savedNavMesh));
+  PathFinder reloaded;
+  ASSERT_TRUE(reloaded.loadNavMesh(savedNavMesh));
+
+  for (int i = 0; i < 1000; i++) {
+    ShortestPath path;
+    path.requestedStart = pf.getRandomNavigablePoint();
+    path.requestedEnd = pf.getRandomNavigablePoint();
+    ShortestPath reloadedPath = path;
+    EXPECT_EQ(pf.islandRadius(path.requestedStart),
+              reloaded.islandRadius(path.requestedStart));
+    EXPECT_EQ(pf.findPath(path), reloaded.findPath(reloadedPath));
+    EXPECT_EQ(path.geodesicDistance, reloadedPath.geodesicDistance);
+  }
+  std::remove(savedNavMesh.c_str());
+}
+
+TEST(NavTest, PathFinderTiledBuildMatchesSolo) {
+  const esp::assets::MeshData mesh = floorMesh(10);
+  NavMeshSettings bs;
+  bs.setDefaults();
+  PathFinder solo;
+  ASSERT_TRUE(solo.build(bs, mesh));
+  bs.tileSize = 64;
+  PathFinder tiled;
+  ASSERT_TRUE(tiled.build(bs, mesh));
+
+  // paths cross tile borders as if the navmesh was a single tile
+  for (int i = 0; i < 100; i++) {
+    ShortestPath soloPath;
+    soloPath.requestedStart = tiled.getRandomNavigablePoint();
+    soloPath.requestedEnd = tiled.getRandomNavigablePoint();
+    ShortestPath tiledPath = soloPath;
+    EXPECT_TRUE(solo.isNavigable(tiledPath.requestedStart));
+    ASSERT_TRUE(tiled.findPath(tiledPath));
+    ASSERT_TRUE(solo.findPath(soloPath));
+    EXPECT_NEAR(tiledPath.geodesicDistance, soloPath.geodesicDistance, 0.1);
+  }
+}
+
+TEST(NavTest, PathFinderObstacleRebuildsTiles) {
+  NavMeshSettings bs;
+  bs.setDefaults();
+  bs.tileSize = 64;
+  PathFinder pf;
+  ASSERT_TRUE(pf.build(bs, floorMesh(10)));
+  const vec3f center(5, 0, 5);
+  ASSERT_TRUE(pf.isNavigable(center));
+
+  // 2m box in the middle of the floor, taller than the agent
+  esp::assets::MeshData box;
+  for (int i = 0; i < 8; i++) {
+    box.vbo.emplace_back(i & 1 ? 6 : 4, i & 2 ? 3 : -1, i & 4 ? 6 : 4);
+  }
+  box.ibo = {0, 1, 3, 0, 3, 2, 4, 6, 7, 4, 7, 5, 0, 4, 5, 0, 5, 1,
+             2, 3, 7, 2, 7, 6, 0, 2, 6, 0, 6, 4, 1, 5, 7, 1, 7, 3};
+  const uint64_t builtRevision = pf.getNavMeshRevision();
+  ASSERT_TRUE(pf.updateObstacle(0, box));
+  EXPECT_FALSE(pf.isNavigable(center));
+  // so that cached paths and moves are dropped
+  const uint64_t obstacleRevision = pf.getNavMeshRevision();
+  EXPECT_NE(obstacleRevision, builtRevision);
+
+  // paths now go around the box
+  ShortestPath path;
+  path.requestedStart = vec3f(3, 0, 5);
+  path.requestedEnd = vec3f(7, 0, 5);
+  ASSERT_TRUE(pf.findPath(path));
+  EXPECT_GT(path.geodesicDistance, 4.2);
+
+  ASSERT_TRUE(pf.removeObstacle(0));
+  EXPECT_TRUE(pf.isNavigable(center));
+  EXPECT_NE(pf.getNavMeshRevision(), obstacleRevision);
+  EXPECT_FALSE(pf.removeObstacle(0));
+}
+
+TEST(NavTest, HeightfieldCacheMatchesRasterizing) {
+  const esp::assets::MeshData mesh = floorMesh(10);
+  // navigable cells of pf on the floor
+  auto navigableCells = [](PathFinder& pf) {
+    TopDownView::ptr view = pf.getTopDownView(0.1, 0);
+    const uint8_t* navigable = static_cast<uint8_t*>(view->navigable->data);
+    return std::vector<uint8_t>(
+        navigable, navigable + view->navigable->shape[0] *
+                                   view->navigable->shape[1]);
+  };
+
+  for (float tileSize : {0.0f, 64.0f}) {
+    NavMeshSettings bs;
+    bs.setDefaults();
+    bs.tileSize = tileSize;
+    PathFinder cached;
+    cached.setHeightfieldCache(true);
+    ASSERT_TRUE(cached.build(bs, mesh));
+    const HeightfieldCacheStats rasterized = cached.getHeightfieldCacheStats();
+    EXPECT_EQ(rasterized.hits, 0u);
+    EXPECT_GT(rasterized.misses, 0u);
+    EXPECT_EQ(rasterized.size, rasterized.misses);
+    EXPECT_GT(rasterized.bytes, 0u);
+
+    // other agents reuse the heightfields
+    for (float agentRadius : {0.2f, 0.15f}) {
+      bs.agentRadius = agentRadius;
+      bs.agentHeight += 0.1f;
+      ASSERT_TRUE(cached.build(bs, mesh));
+      PathFinder uncached;
+      ASSERT_TRUE(uncached.build(bs, mesh));
+      const std::vector<uint8_t> expected = navigableCells(uncached);
+      const std::vector<uint8_t> actual = navigableCells(cached);
+      ASSERT_EQ(actual.size(), expected.size());
+      if (tileSize == 0) {
+        EXPECT_EQ(actual, expected);
+      } else {
+        // tiles are cropped from a wider heightfield, whose cells may differ
+        // by rounding at their edges
+        int agreeing = 0;
+        for (size_t i = 0; i < actual.size(); ++i) {
+          agreeing += actual[i] == expected[i];
+        }
+        EXPECT_GT(agreeing, 0.99 * actual.size());
+      }
+    }
+    const HeightfieldCacheStats stats = cached.getHeightfieldCacheStats();
+    EXPECT_EQ(stats.misses, rasterized.misses);
+    EXPECT_EQ(stats.hits, 2 * rasterized.misses);
+    EXPECT_EQ(stats.size, rasterized.size);
+  }
+
+  // cached on disk, another PathFinder does not rasterize
+  const std::string cacheFile = "NavTest.heightfields";
+  NavMeshSettings bs;
+  bs.setDefaults();
+  {
+    PathFinder pf;
+    pf.setHeightfieldCache(true, cacheFile);
+    ASSERT_TRUE(pf.build(bs, mesh));
+    EXPECT_EQ(pf.getHeightfieldCacheStats().misses, 1u);
+  }
+  PathFinder pf;
+  pf.setHeightfieldCache(true, cacheFile);
+  EXPECT_EQ(pf.getHeightfieldCacheStats().size, 1u);
+  bs.agentRadius = 0.3f;
+  ASSERT_TRUE(pf.build(bs, mesh));
+  EXPECT_EQ(pf.getHeightfieldCacheStats().hits, 1u);
+  EXPECT_EQ(pf.getHeightfieldCacheStats().misses, 0u);
+
+  // another climb rasterizes again
+  bs.agentMaxClimb = 0.4f;
+  ASSERT_TRUE(pf.build(bs, mesh));
+  EXPECT_EQ(pf.getHeightfieldCacheStats().misses, 1u);
+  pf.setHeightfieldCache(false);
+  EXPECT_FALSE(pf.isHeightfieldCacheEnabled());
+  std::remove(cacheFile.c_str());
+}
+
+TEST(NavTest, PathFinderLoadRejectsCorruptedTiles) {
+  PathFinder pf;
+  pf.loadNavMesh(Cr::Utility::Directory::join(
+      SCENE_DATASETS, "habitat-test-scenes/skokloster-castle.navmesh"));
+  const std::string savedNavMesh = "NavTestCorrupted.navmesh";
+  ASSERT_TRUE(pf.saveNavMesh(savedNavMesh));
+  PathFinder reloaded;
+  ASSERT_TRUE(reloaded.loadNavMesh(savedNavMesh));
+
+  // flip a byte of tile data, which fills most of the file
+  FILE* fp = fopen(savedNavMesh.c_str(), "r+b");
+  ASSERT_NE(fp, nullptr);
+  fseek(fp, 0, SEEK_END);
+  const long offset = ftell(fp) / 4;
+  fseek(fp, offset, SEEK_SET);
+  const int byte = fgetc(fp);
+  fseek(fp, offset, SEEK_SET);
+  fputc(byte ^ 0xff, fp);
+  fclose(fp);
+
+  PathFinder corrupted;
+  EXPECT_FALSE(corrupted.loadNavMesh(savedNavMesh));
+  EXPECT_FALSE(corrupted.isLoaded());
+  std::remove(savedNavMesh.c_str());
+}
+
+TEST(NavTest, PathFinderSharedCopyFollowsSource) {
+  // the streamed navmesh is converted into the shared cache directory
+  const std::string source = "NavTestShared.navmesh";
+  ASSERT_TRUE(Cr::Utility::Directory::copy(
+      Cr::Utility::Directory::join(
+          SCENE_DATASETS, "habitat-test-scenes/skokloster-castle.navmesh"),
+      source));
+  utimbuf times{1000000, 1000000};
+  ASSERT_EQ(utime(source.c_str(), &times), 0);
+  const std::string dir = "NavTestSharedCache";
+  io::setSharedCacheDir(dir);
+  const std::string sharedFile = io::cacheFilename(source + ".navmesh");
+  PathFinder pf;
+  ASSERT_TRUE(pf.loadNavMesh(source));
+  ASSERT_TRUE(io::exists(sharedFile));
+
+  // a copy converted from another navmesh stands in for a stale one
+  PathFinder floor;
+  NavMeshSettings bs;
+  bs.setDefaults();
+  ASSERT_TRUE(floor.build(bs, floorMesh(2)));
+  ASSERT_TRUE(floor.saveNavMesh(sharedFile));
+  vec3f pt = pf.getRandomNavigablePoint();
+  while (floor.isNavigable(pt)) {
+    pt = pf.getRandomNavigablePoint();
+  }
+
+  // it is served while the source has the same contents, even if touched
+  times = {2000000, 2000000};
+  ASSERT_EQ(utime(source.c_str(), &times), 0);
+  PathFinder touched;
+  ASSERT_TRUE(touched.loadNavMesh(source));
+  EXPECT_FALSE(touched.isNavigable(pt));
+
+  // but not once the source is edited in place to the same size: the height
+  // of the origin of the tile grid moves by a fraction of a micrometer
+  FILE* fp = fopen(source.c_str(), "r+b");
+  ASSERT_NE(fp, nullptr);
+  const long offset = 3 * sizeof(int) + sizeof(float);
+  fseek(fp, offset, SEEK_SET);
+  const int byte = fgetc(fp);
+  fseek(fp, offset, SEEK_SET);
+  fputc(byte ^ 1, fp);
+  fclose(fp);
+  times = {3000000, 3000000};
+  ASSERT_EQ(utime(source.c_str(), &times), 0);
+  PathFinder edited;
+  ASSERT_TRUE(edited.loadNavMesh(source));
+  EXPECT_TRUE(edited.isNavigable(pt));
+
+  io::setSharedCacheDir("");
+  std::remove(source.c_str());
+  std::remove(sharedFile.c_str());
+  std::remove((sharedFile + ".source").c_str());
+  std::remove((sharedFile + ".lock").c_str());
+  std::remove(dir.c_str());
+}
+
+TEST(NavTest, EpisodeSamplerMeetsConstraints) {
+  PathFinder::ptr pf = PathFinder::create();
+  pf->loadNavMesh(Cr::Utility::Directory::join(
+      SCENE_DATASETS, "habitat-test-scenes/skokloster-castle.navmesh"));
+  EpisodeConstraints constraints;
+  constraints.minGeodesicDistance = 2.0f;
+  constraints.maxGeodesicDistance = 20.0f;
+  constraints.maxHeightDifference = 0.5f;
+
+  EpisodeSampler sampler(pf, 7);
+  const EpisodeBatch batch = sampler.sample(200, constraints, 4);
+  ASSERT_EQ(batch.size(), 200u);
+  for (size_t i = 0; i < batch.size(); i++) {
+    EXPECT_GE(batch.geodesicDistances[i], constraints.minGeodesicDistance);
+    EXPECT_LE(batch.geodesicDistances[i], constraints.maxGeodesicDistance);
+    EXPECT_GE(batch.geodesicDistances[i],
+              constraints.minGeodesicToEuclideanRatio *
+                  (batch.goals[i] - batch.starts[i]).norm());
+    EXPECT_LE(std::abs(batch.goals[i][1] - batch.starts[i][1]), 0.5f);
+    EXPECT_GE(pf->islandRadius(batch.starts[i]),
+              constraints.minIslandRadius);
+  }
+
+  // the episodes only depend on the seed
+  sampler.seed(7);
+  const EpisodeBatch serial = sampler.sample(200, constraints, 1);
+  EXPECT_EQ(serial.starts, batch.starts);
+  EXPECT_EQ(serial.goals, batch.goals);
+  EXPECT_EQ(serial.startHeadings, batch.startHeadings);
+}
+
+TEST(NavTest, PathFinderTryStepBatchMatchesTryStep) {
+  PathFinder pf;
+  pf.loadNavMesh(Cr::Utility::Directory::join(
+      SCENE_DATASETS, "habitat-test-scenes/skokloster-castle.navmesh"));
+  std::vector<vec3f> starts, ends;
+  for (int i = 0; i < 1000; i++) {
+    starts.emplace_back(pf.getRandomNavigablePoint());
+    ends.emplace_back(starts.back() + vec3f(0.25, 0, 0.25));
+  }
+  const std::vector<vec3f> batch = pf.tryStepBatch(starts, ends, 4);
+  ASSERT_EQ(batch.size(), starts.size());
+  for (size_t i = 0; i < starts.size(); i++) {
+    EXPECT_EQ(batch[i], pf.tryStep(starts[i], ends[i]));
+  }
+}
+
+TEST(NavTest, ObstacleQueryBatchMatchesSequential) {
+  PathFinder pf;
+  pf.loadNavMesh(Cr::Utility::Directory::join(
+      SCENE_DATASETS, "habitat-test-scenes/skokloster-castle.navmesh"));
+  std::vector<vec3f> pts;
+  for (int i = 0; i < 1000; i++) {
+    pts.emplace_back(pf.getRandomNavigablePoint());
+  }
+  const std::vector<HitRecord> hits =
+      pf.closestObstacleSurfacePoints(pts, 2.0, 4);
+  const std::vector<float> distances =
+      pf.distancesToClosestObstacle(pts, 2.0, 4);
+  ASSERT_EQ(hits.size(), pts.size());
+  ASSERT_EQ(distances.size(), pts.size());
+  for (size_t i = 0; i < pts.size(); i++) {
+    const HitRecord hit = pf.closestObstacleSurfacePoint(pts[i]);
+    EXPECT_EQ(hits[i].hitPos, hit.hitPos);
+    EXPECT_EQ(hits[i].hitDist, hit.hitDist);
+    EXPECT_EQ(distances[i], pf.distanceToClosestObstacle(pts[i]));
+  }
+}
+
+TEST(NavTest, PathCacheMatchesUncached) {
+  const std::string navMeshFile = Cr::Utility::Directory::join(
+      SCENE_DATASETS, "habitat-test-scenes/skokloster-castle.navmesh");
+  PathFinder pf;
+  pf.loadNavMesh(navMeshFile);
+  std::vector<ShortestPath> paths(50);
+  for (ShortestPath& path : paths) {
+    path.requestedStart = pf.getRandomNavigablePoint();
+    path.requestedEnd = pf.getRandomNavigablePoint();
+  }
+  std::vector<ShortestPath> uncached = paths;
+  const std::vector<bool> found = pf.findPaths(uncached, 1);
+
+  pf.setPathCacheCapacity(100);
+  for (int pass = 0; pass < 2; pass++) {
+    std::vector<ShortestPath> cached = paths;
+    EXPECT_EQ(pf.findPaths(cached, 4), found);
+    for (size_t i = 0; i < paths.size(); i++) {
+      EXPECT_EQ(cached[i].points, uncached[i].points);
+      EXPECT_EQ(cached[i].geodesicDistance, uncached[i].geodesicDistance);
+    }
+  }
+  PathCacheStats stats = pf.getPathCacheStats();
+  EXPECT_EQ(stats.misses, paths.size());
+  EXPECT_EQ(stats.hits, paths.size());
+  EXPECT_EQ(stats.size, paths.size());
+
+  // the least recently used paths are evicted
+  pf.setPathCacheCapacity(10);
+  EXPECT_EQ(pf.getPathCacheStats().size, 10u);
+
+  // a new navmesh drops the cache
+  pf.loadNavMesh(navMeshFile);
+  pf.resetPathCacheStats();
+  ShortestPath path = paths[0];
+  pf.findPath(path);
+  stats = pf.getPathCacheStats();
+  EXPECT_EQ(stats.hits, 0u);
+  EXPECT_EQ(stats.misses, 1u);
+}
+
+TEST(NavTest, PathHierarchyFindsSameReachability) {
+  const std::string navMeshFile = Cr::Utility::Directory::join(
+      SCENE_DATASETS, "habitat-test-scenes/skokloster-castle.navmesh");
+  PathFinder pf;
+  pf.loadNavMesh(navMeshFile);
+  std::vector<ShortestPath> paths(50);
+  for (ShortestPath& path : paths) {
+    path.requestedStart = pf.getRandomNavigablePoint();
+    path.requestedEnd = pf.getRandomNavigablePoint();
+  }
+  std::vector<ShortestPath> flat = paths;
+  const std::vector<bool> found = pf.findPaths(flat, 1);
+
+  pf.setPathHierarchy(4.0f);
+  EXPECT_EQ(pf.getPathHierarchyClusterSize(), 4.0f);
+  EXPECT_GT(pf.getPathHierarchyNumClusters(), 0u);
+  std::vector<ShortestPath> hierarchical = paths;
+  EXPECT_EQ(pf.findPaths(hierarchical, 1), found);
+  for (size_t i = 0; i < paths.size(); i++) {
+    if (!found[i])
+      continue;
+    // the corridor may miss the shortest path, but never by much
+    EXPECT_GE(hierarchical[i].geodesicDistance,
+              flat[i].geodesicDistance - 1e-3f);
+    EXPECT_LE(hierarchical[i].geodesicDistance,
+              1.5f * flat[i].geodesicDistance + 4.0f);
+  }
+
+  // the hierarchy is kept over navmesh changes and can be turned off
+  pf.loadNavMesh(navMeshFile);
+  EXPECT_GT(pf.getPathHierarchyNumClusters(), 0u);
+  pf.setPathHierarchy(0.0f);
+  EXPECT_EQ(pf.getPathHierarchyNumClusters(), 0u);
+}
+
+TEST(NavTest, PathFinderSeedIsReproducible) {
+  const std::string navMeshFile = Cr::Utility::Directory::join(
+      SCENE_DATASETS, "habitat-test-scenes/skokloster-castle.navmesh");
+  PathFinder pf1, pf2;
+  pf1.loadNavMesh(navMeshFile);
+  pf2.loadNavMesh(navMeshFile);
+  pf1.seed(3);
+  pf2.seed(3);
+  // PathFinders have their own generators, so interleaving does not matter
+  for (int i = 0; i < 100; i++) {
+    EXPECT_EQ(pf1.getRandomNavigablePoint(), pf2.getRandomNavigablePoint());
+  }
+
+  const std::vector<vec3f> points = pf1.getRandomNavigablePoints(100, 1.0);
+  ASSERT_EQ(points.size(), 100u);
+  for (const vec3f& point : points) {
+    EXPECT_GE(pf1.islandRadius(point), 1.0);
+  }
+  EXPECT_EQ(points, pf2.getRandomNavigablePoints(100, 1.0));
+}
+
+TEST(NavTest, TopDownViewMatchesIsNavigable) {
+  PathFinder pf;
+  pf.loadNavMesh(Cr::Utility::Directory::join(
+      SCENE_DATASETS, "habitat-test-scenes/skokloster-castle.navmesh"));
+  const vec3f start = pf.getRandomNavigablePoint();
+  const float metersPerPixel = 0.1;
+  TopDownView::ptr view =
+      pf.getTopDownView(metersPerPixel, start.y(), true, true);
+  ASSERT_NE(view, nullptr);
+  ASSERT_EQ(view->navigable->shape.size(), 2);
+  const int rows = view->navigable->shape[0];
+  const int cols = view->navigable->shape[1];
+  const uint8_t* navigable = static_cast<uint8_t*>(view->navigable->data);
+  const int32_t* islands = static_cast<int32_t*>(view->islands->data);
+  const float* distance = static_cast<float*>(view->obstacleDistance->data);
+
+  int agreeing = 0;
+  int navigableCells = 0;
+  for (int row = 0; row < rows; ++row) {
+    for (int col = 0; col < cols; ++col) {
+      const int cell = row * cols + col;
+      const vec3f pt =
+          view->origin +
+          metersPerPixel * vec3f(col + 0.5f, 0.0f, row + 0.5f);
+      agreeing += pf.isNavigable(pt) == bool(navigable[cell]);
+      if (navigable[cell]) {
+        ++navigableCells;
+        EXPECT_GE(islands[cell], 0);
+        EXPECT_GE(distance[cell], metersPerPixel);
+      } else {
+        EXPECT_EQ(islands[cell], -1);
+        EXPECT_EQ(distance[cell], 0.0f);
+      }
+    }
+  }
+  EXPECT_GT(navigableCells, 0);
+  // cells centered on polygon edges may go either way
+  EXPECT_GT(agreeing, 0.98 * rows * cols);
+}
+
+TEST(NavTest, FindPathSteadyStateDoesNotAllocate) {
+  NavMeshSettings bs;
+  bs.setDefaults();
+  PathFinder pf;
+  ASSERT_TRUE(pf.build(bs, floorMesh(10)));
+  pf.setPathHierarchy(2.0f);
+  std::vector<ShortestPath> paths(20);
+  std::vector<MultiGoalShortestPath> multiPaths(20);
+  for (int i = 0; i < paths.size(); ++i) {
+    paths[i].requestedStart = pf.getRandomNavigablePoint();
+    paths[i].requestedEnd = pf.getRandomNavigablePoint();
+    multiPaths[i].requestedStart = paths[i].requestedStart;
+    for (int j = 0; j < 3; ++j) {
+      multiPaths[i].requestedEnds.push_back(pf.getRandomNavigablePoint());
+    }
+  }
+  auto step = [&]() {
+    bool found = true;
+    for (int i = 0; i < paths.size(); ++i) {
+      found = pf.findPath(paths[i]) && pf.findPath(multiPaths[i]) && found;
+    }
+    return found;
+  };
+  // the first step grows the scratch memory and the vectors of the paths
+  EXPECT_TRUE(step());
+  const size_t allocationsBefore = numAllocations;
+  const bool found = step();
+  EXPECT_EQ(numAllocations - allocationsBefore, 0);
+  EXPECT_TRUE(found);
+}
@@ -0,0 +1,94 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#include <gtest/gtest.h>
+
+#include "esp/core/esp.h"
+#include "esp/scene/NoisyControls.h"
+#include "esp/scene/ObjectControls.h"
+#include "esp/scene/SceneGraph.h"
+#include "esp/scene/SceneNode.h"
+
+using namespace esp;
+using namespace esp::scene;
+
+TEST(NoisyControlsTest, TruncatedNormal) {
+  core::Random random(0);
+  double sum = 0.0;
+  const int numSamples = 10000;
+  for (int i = 0; i < numSamples; ++i) {
+    const float x = sampleTruncatedNormal(random, 1.0f, 0.5f, -1.0f);
+    ASSERT_GE(x, 0.5f);
+    ASSERT_LE(x, 2.5f);
+    sum += x;
+  }
+  // the mean of a standard normal truncated to [-1, 3] is about 0.28
+  EXPECT_NEAR(sum / numSamples, 1.0 + 0.5 * 0.28, 0.02);
+  // truncations beyond 3 standard deviations are clamped
+  EXPECT_EQ(sampleTruncatedNormal(random, 0.0f, 1.0f, 5.0f), 3.0f);
+}
+
+TEST(NoisyControlsTest, ActuationSpec) {
+  NoisyActuationSpec spec;
+  ASSERT_TRUE(NoisyActuationSpec::fromActuation(
+      {{"amount", 0.25f}, {"robot", 1.0f}, {"controller", 2.0f}}, spec));
+  EXPECT_EQ(spec.amount, 0.25f);
+  EXPECT_EQ(spec.robot, NoisyRobot::LoCoBotLite);
+  EXPECT_EQ(spec.controller, NoisyController::Movebase);
+  EXPECT_EQ(spec.noiseMultiplier, 1.0f);
+  EXPECT_FALSE(NoisyActuationSpec::fromActuation({{"robot", 2.0f}}, spec));
+  EXPECT_FALSE(
+      NoisyActuationSpec::fromActuation({{"controller", 0.5f}}, spec));
+
+  EXPECT_EQ(getNoisyMovePointer("pyrobotNoisyTurnLeft"),
+            &pyrobotNoisyTurnLeft);
+  EXPECT_EQ(getNoisyMovePointer("moveForward"), nullptr);
+}
+
+TEST(NoisyControlsTest, NoisyMoves) {
+  SceneGraph graph;
+  SceneNode& node = graph.getRootNode().createChild();
+  ObjectControls controls;
+  NoisyActuationSpec spec;
+  spec.amount = 0.25f;
+
+  // without noise, the moves are exact
+  spec.noiseMultiplier = 0.0f;
+  controls.action(node, &pyrobotNoisyMoveForward, spec);
+  EXPECT_TRUE(node.translation().z() == -0.25f);
+  EXPECT_TRUE(node.translation().x() == 0.0f);
+
+  // with it, the node always moves forward and overshoots on average
+  spec.noiseMultiplier = 1.0f;
+  controls.seed(0);
+  float sum = 0.0f;
+  const int numMoves = 1000;
+  for (int i = 0; i < numMoves; ++i) {
+    node.resetTransformation();
+    controls.action(node, &pyrobotNoisyMoveForward, spec);
+    ASSERT_LT(node.translation().z(), -0.05f * spec.amount);
+    sum -= node.translation().z();
+  }
+  EXPECT_GT(sum / numMoves, spec.amount);
+
+  // turns always turn the intended way
+  for (int i = 0; i < numMoves; ++i) {
+    node.resetTransformation();
+    controls.action(node, &pyrobotNoisyTurnLeft,
+                    NoisyActuationSpec{10.0f, NoisyRobot::LoCoBot,
+                                       NoisyController::ILQR, 1.0f});
+    // turning left about +Y swings the backward vector towards +X
+    ASSERT_GT(node.transformation().backward().x(), 0.0f);
+  }
+
+  // the same seed repeats the same noise
+  controls.seed(1);
+  node.resetTransformation();
+  controls.action(node, &pyrobotNoisyMoveForward, spec);
+  const Magnum::Vector3 first = node.translation();
+  controls.seed(1);
+  node.resetTransformation();
+  controls.action(node, &pyrobotNoisyMoveForward, spec);
+  EXPECT_EQ(node.translation(), first);
+}
@@ -0,0 +1,339 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#include <gtest/gtest.h>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "esp/assets/ResourceManager.h"
+#include "esp/physics/PhysicsManager.h"
+#include "esp/scene/SceneGraph.h"
+
+using esp::assets::AssetInfo;
+using esp::assets::PhysicsManagerAttributes;
+using esp::assets::ResourceManager;
+using esp::physics::PhysicsManager;
+
+namespace {
+
+// a box of 1 m around its origin, as glTF with an embedded buffer of 36
+// indices and 8 positions
+const std::string boxGltf = R"({
+  "asset": {"version": "2.0"},
+  "scene": 0,
+  "scenes": [{"nodes": [0]}],
+  "nodes": [{"mesh": 0}],
+  "meshes": [{"primitives": [{"attributes": {"POSITION": 1}, "indices": 0}]}],
+  "accessors": [
+    {"bufferView": 0, "componentType": 5123, "count": 36, "type": "SCALAR"},
+    {"bufferView": 1, "componentType": 5126, "count": 8, "type": "VEC3",
+     "min": [-0.5, -0.5, -0.5], "max": [0.5, 0.5, 0.5]}
+  ],
+  "bufferViews": [
+    {"buffer": 0, "byteOffset": 0, "byteLength": 72},
+    {"buffer": 0, "byteOffset": 72, "byteLength": 96}
+  ],
+  "buffers": [{"byteLength": 168, "uri": "data:application/octet-stream;base64,BAAGAAcABAAHAAUAAAABAAMAAAADAAIAAgADAAcAAgAHAAYAAAAEAAUAAAAFAAEAAQAFAAcAAQAHAAMAAAACAAYAAAAGAAQAAAAAvwAAAL8AAAC/AAAAvwAAAL8AAAA/AAAAvwAAAD8AAAC/AAAAvwAAAD8AAAA/AAAAPwAAAL8AAAC/AAAAPwAAAL8AAAA/AAAAPwAAAD8AAAC/AAAAPwAAAD8AAAA/"}]
+})";
+
+const std::string boxConfig = "./PhysicsTest.box.phys_properties.json";
+// the same box, heavier
+const std::string heavyBoxConfig =
+    "./PhysicsTest.heavyBox.phys_properties.json";
+
+// an empty scene with the box in its object library, in Bullet if it is
+// built, without the GPU
+struct PhysicsWorld {
+  PhysicsWorld() {
+    std::ofstream("PhysicsTest.box.gltf") << boxGltf;
+    std::ofstream(boxConfig) << R"({
+      "render mesh": "PhysicsTest.box.gltf",
+      "collision mesh": "PhysicsTest.box.gltf",
+      "mass": 1.0,
+      "COM": [0, 0, 0]
+    })";
+    std::ofstream(heavyBoxConfig) << R"({
+      "render mesh": "PhysicsTest.box.gltf",
+      "collision mesh": "PhysicsTest.box.gltf",
+      "mass": 5.0,
+      "COM": [0, 0, 0]
+    })";
+
+#ifdef PHYSICS_WITH_BULLET
+    attributes.setString("simulator", "bullet");
+#endif
+    attributes.setMagnumVec3("gravity", {0.0f, -9.8f, 0.0f});
+    attributes.setDouble("frictionCoefficient", 0.4);
+    attributes.setDouble("restitutionCoefficient", 0.1);
+    attributes.setVecStrings("objectLibraryPaths", {boxConfig, heavyBoxConfig});
+    resourceManager.setGpuEnabled(false);
+    resourceManager.loadScene(AssetInfo(), physicsManager, attributes,
+                              &sceneGraph.getRootNode(), nullptr);
+  }
+
+  PhysicsManager& world() { return *physicsManager; }
+  //! Add a world of the same settings, with a scene node of its own
+  int addWorld() {
+    return physicsManager->addWorld(&sceneGraph.getRootNode().createChild(),
+                                    attributes);
+  }
+  int addBox(const Magnum::Vector3& translation,
+             int worldID = 0,
+             const std::string& configFile = boxConfig) {
+    PhysicsManager& world = physicsManager->getWorld(worldID);
+    const int objectID = world.addObject(configFile, nullptr);
+    world.setTranslation(objectID, translation);
+    return objectID;
+  }
+
+  PhysicsManagerAttributes attributes;
+  ResourceManager resourceManager;
+  esp::scene::SceneGraph sceneGraph;
+  std::shared_ptr<PhysicsManager> physicsManager;
+};
+
+}  // namespace
+
+TEST(PhysicsTest, RestoreState) {
+  PhysicsWorld physics;
+  PhysicsManager& world = physics.world();
+  const int first = physics.addBox({0.0f, 2.0f, 0.0f});
+  const int second = physics.addBox({3.0f, 2.0f, 0.0f});
+  ASSERT_GE(first, 0);
+  ASSERT_GE(second, 0);
+  world.applyImpulse(second, {1.0f, 0.0f, 0.0f}, {});
+  const std::vector<char> snapshot = world.saveState();
+  const Magnum::Matrix4 firstPose = world.getTransformation(first);
+  const Magnum::Matrix4 secondPose = world.getTransformation(second);
+
+  // an episode that moves both boxes and spawns a third
+  world.stepPhysics(0.5);
+  world.setTranslation(first, {5.0f, 5.0f, 5.0f});
+  const int spawned = physics.addBox({-3.0f, 2.0f, 0.0f});
+  ASSERT_GE(spawned, 0);
+
+  // restores the poses, velocities and world time, and drops the spawned box
+  ASSERT_TRUE(world.restoreState(snapshot));
+  EXPECT_FALSE(world.hasObject(spawned));
+  EXPECT_EQ(world.getNumRigidObjects(), 2);
+  EXPECT_EQ(world.getTransformation(first), firstPose);
+  EXPECT_EQ(world.getTransformation(second), secondPose);
+  EXPECT_EQ(world.saveState(), snapshot);
+
+  // a box removed since comes back with its ID, also after an object of
+  // another config took the ID, which is replaced rather than posed as the
+  // box
+  world.removeObject(second);
+  ASSERT_EQ(physics.addBox({1.0f, 1.0f, 1.0f}, 0, heavyBoxConfig), second);
+  ASSERT_TRUE(world.restoreState(snapshot));
+  EXPECT_EQ(world.getNumRigidObjects(), 2);
+  EXPECT_EQ(world.getTransformation(second), secondPose);
+  EXPECT_EQ(world.saveState(), snapshot);
+  world.removeObject(second);
+  ASSERT_TRUE(world.restoreState(snapshot));
+  EXPECT_EQ(world.getNumRigidObjects(), 2);
+  EXPECT_EQ(world.saveState(), snapshot);
+
+  // a snapshot of an object that is not in the library is rejected, leaving
+  // the world be; the last byte is the end of the config of the last object
+  std::vector<char> unknownConfig = snapshot;
+  unknownConfig.back() = 'x';
+  world.setTranslation(first, {1.0f, 1.0f, 1.0f});
+  EXPECT_FALSE(world.restoreState(unknownConfig));
+  EXPECT_EQ(world.getTranslation(first), Magnum::Vector3(1.0f, 1.0f, 1.0f));
+  EXPECT_EQ(world.getNumRigidObjects(), 2);
+
+  // so is a truncated one
+  std::vector<char> truncated = snapshot;
+  truncated.pop_back();
+  EXPECT_FALSE(world.restoreState(truncated));
+}
+
+TEST(PhysicsTest, Worlds) {
+  PhysicsWorld physics;
+  PhysicsManager& world = physics.world();
+  const int worldID = physics.addWorld();
+  ASSERT_EQ(worldID, 1);
+  ASSERT_TRUE(world.hasWorld(worldID));
+  EXPECT_EQ(world.getNumWorlds(), 2);
+  PhysicsManager& other = world.getWorld(worldID);
+
+  // boxes in the same place of two worlds do not collide, and each world
+  // only holds its own objects
+  const int box = physics.addBox({0.0f, 2.0f, 0.0f});
+  const int otherBox = physics.addBox({0.0f, 2.0f, 0.0f}, worldID);
+  ASSERT_GE(box, 0);
+  ASSERT_GE(otherBox, 0);
+  EXPECT_EQ(world.getNumRigidObjects(), 1);
+  EXPECT_EQ(other.getNumRigidObjects(), 1);
+  world.stepPhysics(0.1, 5);
+  EXPECT_DOUBLE_EQ(world.getWorldTime(), other.getWorldTime());
+  EXPECT_GT(world.getWorldTime(), 0.0);
+  EXPECT_EQ(world.getTranslation(box), other.getTranslation(otherBox));
+  EXPECT_EQ(world.getTranslation(box).x(), 0.0f);
+  EXPECT_EQ(world.getTranslation(box).z(), 0.0f);
+
+  // moving the box of one world leaves the other be
+  const Magnum::Vector3 otherTranslation = other.getTranslation(otherBox);
+  world.setTranslation(box, {3.0f, 0.0f, 0.0f});
+  EXPECT_EQ(other.getTranslation(otherBox), otherTranslation);
+
+  // removed worlds free their slot for the next one, world 0 stays
+  EXPECT_FALSE(world.removeWorld(0));
+  EXPECT_TRUE(world.removeWorld(worldID));
+  EXPECT_FALSE(world.hasWorld(worldID));
+  EXPECT_FALSE(world.removeWorld(worldID));
+  EXPECT_EQ(world.getNumWorlds(), 1);
+  EXPECT_EQ(physics.addWorld(), worldID);
+  EXPECT_EQ(world.getWorld(worldID).getNumRigidObjects(), 0);
+}
+
+TEST(PhysicsTest, StepMany) {
+  PhysicsWorld physics;
+  PhysicsManager& world = physics.world();
+  // a power of two, so that steps of it add up exactly
+  const double dt = 1.0 / 64.0;
+  world.setTimestep(dt);
+  physics.addWorld();
+  const int box = physics.addBox({0.0f, 2.0f, 0.0f});
+  const int otherBox = physics.addBox({1.0f, 3.0f, 0.0f}, 1);
+  PhysicsManager& other = world.getWorld(1);
+  const std::vector<char> snapshot = world.saveState();
+  const std::vector<char> otherSnapshot = other.saveState();
+
+  const int numSteps = 8;
+  for (int i = 0; i < numSteps; ++i) {
+    world.stepPhysics(dt);
+  }
+  const double worldTime = world.getWorldTime();
+  const Magnum::Vector3 translation = world.getTranslation(box);
+  const Magnum::Vector3 otherTranslation = other.getTranslation(otherBox);
+  EXPECT_DOUBLE_EQ(worldTime, numSteps * dt);
+  EXPECT_DOUBLE_EQ(other.getWorldTime(), numSteps * dt);
+
+  // step(N) takes the same substeps as N steps, in all worlds
+  ASSERT_TRUE(world.restoreState(snapshot));
+  ASSERT_TRUE(other.restoreState(otherSnapshot));
+  world.stepPhysics(dt, numSteps);
+  EXPECT_DOUBLE_EQ(world.getWorldTime(), worldTime);
+  EXPECT_DOUBLE_EQ(other.getWorldTime(), worldTime);
+  EXPECT_LT((world.getTranslation(box) - translation).length(), 1e-5f);
+  EXPECT_LT((other.getTranslation(otherBox) - otherTranslation).length(),
+            1e-5f);
+}
+
+#ifdef PHYSICS_WITH_BULLET
+TEST(PhysicsTest, CastRays) {
+  PhysicsWorld physics;
+  PhysicsManager& world = physics.world();
+  const int box = physics.addBox({0.0f, 0.0f, 0.0f});
+  // the collision shapes of the box are a margin larger than its mesh
+  const float tolerance = 0.05f;
+
+  const std::vector<esp::physics::RaycastHit> hits = world.castRays(
+      {{-5.0f, 0.0f, 0.0f}, {-5.0f, 3.0f, 0.0f}, {-5.0f, 0.0f, 0.0f},
+       {0.0f, 5.0f, 0.2f}},
+      {{1.0f, 0.0f, 0.0f}, {1.0f, 0.0f, 0.0f}, {}, {0.0f, -2.0f, 0.0f}},
+      10.0f);
+  ASSERT_EQ(hits.size(), 4);
+  EXPECT_TRUE(hits[0].hit);
+  EXPECT_EQ(hits[0].objectID, box);
+  EXPECT_NEAR(hits[0].distance, 4.5f, tolerance);
+  EXPECT_NEAR(hits[0].point.x(), -0.5f, tolerance);
+  EXPECT_NEAR(hits[0].normal.x(), -1.0f, tolerance);
+  // above the box, and without a direction
+  EXPECT_FALSE(hits[1].hit);
+  EXPECT_FALSE(hits[2].hit);
+  // the direction need not be normalized
+  EXPECT_TRUE(hits[3].hit);
+  EXPECT_NEAR(hits[3].distance, 4.5f, tolerance);
+  EXPECT_NEAR(hits[3].normal.y(), 1.0f, tolerance);
+
+  // a sphere stops its radius short of the box
+  esp::physics::SweepShape sphere;
+  sphere.radius = 0.25f;
+  const std::vector<esp::physics::RaycastHit> sweeps = world.sweepShapes(
+      sphere, {{-5.0f, 0.0f, 0.0f}, {-5.0f, 0.8f, 0.0f}},
+      {{1.0f, 0.0f, 0.0f}, {1.0f, 0.0f, 0.0f}}, 10.0f);
+  ASSERT_EQ(sweeps.size(), 2);
+  EXPECT_TRUE(sweeps[0].hit);
+  EXPECT_EQ(sweeps[0].objectID, box);
+  EXPECT_NEAR(sweeps[0].distance, 4.25f, tolerance);
+  EXPECT_NEAR(sweeps[0].normal.x(), -1.0f, tolerance);
+  EXPECT_FALSE(sweeps[1].hit);
+
+  // the same for many rays, cast in blocks on several threads
+  std::vector<Magnum::Vector3> origins(1000, {-5.0f, 0.0f, 0.0f});
+  std::vector<Magnum::Vector3> directions(1000, {1.0f, 0.0f, 0.0f});
+  for (const esp::physics::RaycastHit& hit :
+       world.castRays(origins, directions, 10.0f)) {
+    EXPECT_TRUE(hit.hit);
+    EXPECT_EQ(hit.distance, hits[0].distance);
+  }
+}
+
+TEST(PhysicsTest, ContactsAndOverlaps) {
+  PhysicsWorld physics;
+  PhysicsManager& world = physics.world();
+  const int first = physics.addBox({0.0f, 0.0f, 0.0f});
+  const int second = physics.addBox({0.5f, 0.0f, 0.0f});
+  const int apart = physics.addBox({5.0f, 0.0f, 0.0f});
+
+  const std::vector<esp::physics::ContactPoint> contacts =
+      world.contactTest(first);
+  ASSERT_FALSE(contacts.empty());
+  for (const esp::physics::ContactPoint& contact : contacts) {
+    EXPECT_EQ(contact.objectIDA, first);
+    EXPECT_EQ(contact.objectIDB, second);
+    EXPECT_LE(contact.distance, 0.0f);
+  }
+  EXPECT_TRUE(world.contactTest(apart).empty());
+  EXPECT_TRUE(world.contactTest(42).empty());
+
+  EXPECT_EQ(world.overlapAABB({{4.0f, -1.0f, -1.0f}, {6.0f, 1.0f, 1.0f}}),
+            std::vector<int>{apart});
+  EXPECT_EQ(world.overlapAABB({{-1.0f, -1.0f, -1.0f}, {6.0f, 1.0f, 1.0f}}),
+            (std::vector<int>{first, second, apart}));
+  EXPECT_TRUE(
+      world.overlapAABB({{10.0f, 10.0f, 10.0f}, {11.0f, 11.0f, 11.0f}})
+          .empty());
+}
+
+TEST(PhysicsTest, MoveCharacters) {
+  PhysicsWorld physics;
+  PhysicsManager& world = physics.world();
+  world.setGravity({});
+  const int box = physics.addBox({0.0f, 0.0f, 0.0f});
+  const float tolerance = 0.05f;
+
+  std::vector<esp::physics::CharacterMove> moves(3);
+  for (esp::physics::CharacterMove& move : moves) {
+    move.shape.radius = 0.25f;
+  }
+  // into the box head on, past it, and at it at an angle, sliding along it
+  moves[0].start = {-5.0f, 0.0f, 0.0f};
+  moves[0].end = {5.0f, 0.0f, 0.0f};
+  moves[0].mass = 10.0f;
+  moves[1].start = {-5.0f, 3.0f, 0.0f};
+  moves[1].end = {5.0f, 3.0f, 0.0f};
+  moves[2].start = {-2.0f, 0.0f, -0.5f};
+  moves[2].end = {0.0f, 0.0f, 0.5f};
+  world.moveCharacters(moves, 0.1);
+
+  EXPECT_TRUE(moves[0].collided);
+  EXPECT_EQ(moves[0].objectID, box);
+  EXPECT_NEAR(moves[0].position.x(), -0.75f, tolerance);
+  EXPECT_FALSE(moves[1].collided);
+  EXPECT_EQ(moves[1].position, moves[1].end);
+  EXPECT_TRUE(moves[2].collided);
+  EXPECT_NEAR(moves[2].position.x(), -0.75f, tolerance);
+  EXPECT_NEAR(moves[2].position.z(), 0.5f, tolerance);
+
+  // the first character pushed the box away from it
+  world.stepPhysics(0.1);
+  EXPECT_GT(world.getTranslation(box).x(), 0.0f);
+}
+#endif
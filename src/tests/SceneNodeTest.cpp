@@ -0,0 +1,60 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#include <gtest/gtest.h>
+
+#include "esp/scene/SceneGraph.h"
+#include "esp/scene/SceneManager.h"
+#include "esp/scene/SceneNode.h"
+
+using namespace esp;
+using namespace esp::scene;
+
+TEST(SceneNodeTest, CachedAbsoluteTransformation) {
+  SceneGraph graph;
+  SceneNode& parent = graph.getRootNode().createChild();
+  SceneNode& child = parent.createChild();
+  child.translate({0.0f, 1.0f, 0.0f});
+  EXPECT_EQ(child.absoluteTranslation(), Magnum::Vector3(0.0f, 1.0f, 0.0f));
+
+  // moving an ancestor invalidates the cache of the whole subtree
+  parent.translate({1.0f, 0.0f, 0.0f});
+  EXPECT_EQ(child.absoluteTranslation(), Magnum::Vector3(1.0f, 1.0f, 0.0f));
+  parent.rotateY(Magnum::Deg(90.0f));
+  child.translateLocal({0.0f, 0.0f, -1.0f});
+  // the uncached transformation of the base class
+  const MagnumObject& object = child;
+  EXPECT_EQ(child.absoluteTransformation(), object.absoluteTransformation());
+
+  // and so does moving the node itself or changing its parent
+  child.setTransformation(Magnum::Matrix4::translation({0.0f, 2.0f, 0.0f}));
+  EXPECT_EQ(child.absoluteTransformation(), object.absoluteTransformation());
+  child.setParent(&graph.getRootNode());
+  EXPECT_EQ(child.absoluteTranslation(), Magnum::Vector3(0.0f, 2.0f, 0.0f));
+}
+
+TEST(SceneManagerTest, ReleaseSceneGraph) {
+  SceneManager sceneManager;
+  const int first = sceneManager.initSceneGraph();
+  const int second = sceneManager.initSceneGraph();
+  const int third = sceneManager.initSceneGraph();
+  sceneManager.getSceneGraph(second).getRootNode().createChild().createChild();
+  EXPECT_EQ(sceneManager.getNumSceneGraphs(), 3);
+
+  // released slots are reused, lowest first
+  EXPECT_TRUE(sceneManager.releaseSceneGraph(second));
+  EXPECT_FALSE(sceneManager.releaseSceneGraph(second));
+  EXPECT_FALSE(sceneManager.hasSceneGraph(second));
+  EXPECT_TRUE(sceneManager.hasSceneGraph(third));
+  EXPECT_EQ(sceneManager.getNumSceneGraphs(), 2);
+  EXPECT_EQ(sceneManager.initSceneGraph(), second);
+
+  // cycling through scenes keeps the number of graphs flat
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_TRUE(sceneManager.releaseSceneGraph(third));
+    EXPECT_EQ(sceneManager.initSceneGraph(), third);
+  }
+  EXPECT_EQ(sceneManager.getNumSceneGraphs(), 3);
+  EXPECT_TRUE(sceneManager.hasSceneGraph(first));
+}
@@ -3,18 +3,44 @@
 // LICENSE file in the root directory of this source tree.
 
 #include <Corrade/Utility/Directory.h>
+#include <Magnum/Math/Packing.h>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
 #include <gtest/gtest.h>
 #include <string>
 
+#include "esp/gfx/DepthUnprojection.h"
+#include "esp/scene/SceneGraph.h"
+#include "esp/sensor/NavigationSensor.h"
+#include "esp/sensor/PinholeCamera.h"
+#include "esp/sim/BatchSimulatorWithAgents.h"
+#include "esp/sim/SimulatorClient.h"
+#include "esp/sim/SimulatorServer.h"
 #include "esp/sim/SimulatorWithAgents.h"
 
 #include "configure.h"
 
 namespace Cr = Corrade;
 
+using esp::agent::Agent;
+using esp::agent::AgentConfiguration;
+using esp::agent::AgentState;
+using esp::core::Buffer;
 using esp::gfx::SimulatorConfiguration;
+using esp::sim::EpisodeRecording;
+using esp::sim::EpisodeStep;
 using esp::nav::PathFinder;
 using esp::scene::SceneConfiguration;
+using esp::sim::BatchSimulatorWithAgents;
+using esp::sensor::NavigationSensor;
+using esp::sensor::Observation;
+using esp::sensor::ObservationEncoder;
+using esp::sensor::SensorSpec;
+using esp::sensor::SensorType;
+using esp::sim::SimulatorClient;
+using esp::sim::SimulatorServer;
 using esp::sim::SimulatorWithAgents;
 
 const std::string vangogh =
@@ -53,3 +79,837 @@ TEST(SimTest, Reset) {
   simulator.reset();
   ASSERT_EQ(pathfinder, simulator.getPathFinder());
 }
+
+TEST(SimTest, PrefetchScene) {
+  SimulatorConfiguration cfg;
+  cfg.scene.id = vangogh;
+  SimulatorWithAgents simulator(cfg);
+  PathFinder::ptr pathfinder = simulator.getPathFinder();
+  SimulatorConfiguration cfg2;
+  cfg2.scene.id = skokloster;
+  ASSERT_TRUE(simulator.prefetchScene(cfg2.scene));
+  // prefetching the same scene again is a no-op
+  ASSERT_TRUE(simulator.prefetchScene(cfg2.scene));
+  simulator.reconfigure(cfg2);
+  ASSERT_NE(pathfinder, simulator.getPathFinder());
+  SceneConfiguration missing;
+  missing.id = "missing.glb";
+  ASSERT_FALSE(simulator.prefetchScene(missing));
+}
+
+TEST(SimTest, CancelPrefetch) {
+  esp::assets::ResourceManager resourceManager;
+  const esp::assets::AssetInfo first =
+      esp::assets::AssetInfo::fromPath(vangogh);
+  const esp::assets::AssetInfo second =
+      esp::assets::AssetInfo::fromPath(skokloster);
+  ASSERT_TRUE(resourceManager.prefetchScene(first));
+  ASSERT_TRUE(resourceManager.cancelPrefetch(first));
+  ASSERT_FALSE(resourceManager.cancelPrefetch(first));
+
+  // beyond the cap, the oldest unconsumed prefetch is dropped
+  resourceManager.setMaxPrefetchedScenes(1);
+  ASSERT_TRUE(resourceManager.prefetchScene(first));
+  ASSERT_TRUE(resourceManager.prefetchScene(second));
+  ASSERT_FALSE(resourceManager.cancelPrefetch(first));
+  ASSERT_TRUE(resourceManager.cancelPrefetch(second));
+
+  // a reconfigure drops the prefetches it did not use, which later loads
+  // then decode themselves
+  SimulatorConfiguration cfg;
+  cfg.scene.id = vangogh;
+  SimulatorWithAgents simulator(cfg);
+  PathFinder::ptr pathfinder = simulator.getPathFinder();
+  SimulatorConfiguration cfg2;
+  cfg2.scene.id = skokloster;
+  ASSERT_TRUE(simulator.prefetchScene(cfg2.scene));
+  simulator.reconfigure(cfg);
+  ASSERT_EQ(pathfinder, simulator.getPathFinder());
+  simulator.reconfigure(cfg2);
+  ASSERT_NE(pathfinder, simulator.getPathFinder());
+}
+
+TEST(SimTest, StreamTextures) {
+  SimulatorConfiguration cfg;
+  cfg.scene.id = vangogh;
+  size_t wholeTextureBytes = 0;
+  {
+    SimulatorWithAgents simulator(cfg);
+    wholeTextureBytes = simulator.getMemoryStats().textureBytes;
+  }
+  ASSERT_GT(wholeTextureBytes, 0u);
+
+  cfg.streamTextures = true;
+  SimulatorWithAgents simulator(cfg);
+  // only placeholders until something is drawn
+  const size_t placeholderBytes = simulator.getMemoryStats().textureBytes;
+  EXPECT_LT(placeholderBytes, wholeTextureBytes);
+
+  Agent::ptr agent = simulator.addAgent(AgentConfiguration());
+  std::vector<std::map<std::string, esp::sensor::Observation>> observations;
+  ASSERT_TRUE(
+      simulator.stepAgents({agent->getActionId("lookLeft")}, observations));
+  simulator.finishStreamedTextures();
+  const size_t streamedBytes = simulator.getMemoryStats().textureBytes;
+  EXPECT_GT(streamedBytes, placeholderBytes);
+  EXPECT_LE(streamedBytes, wholeTextureBytes);
+}
+
+TEST(SimTest, LoadTrace) {
+  SimulatorConfiguration cfg;
+  cfg.scene.id = vangogh;
+  SimulatorWithAgents simulator(cfg);
+  const esp::assets::LoadTrace trace = simulator.getLoadTrace();
+  EXPECT_NE(trace.asset.find("van-gogh-room"), std::string::npos);
+  EXPECT_GT(trace.seconds(esp::assets::LoadStage::Read), 0.0);
+  EXPECT_GT(trace.seconds(esp::assets::LoadStage::Upload), 0.0);
+  EXPECT_GT(trace.gpuBytes, 0u);
+  EXPECT_GT(trace.peakResidentBytes, 0u);
+  // the stages split the whole load between them
+  double stageSeconds = 0.0;
+  for (double seconds : trace.stageSeconds) {
+    stageSeconds += seconds;
+  }
+  EXPECT_NEAR(stageSeconds, trace.totalSeconds, 1e-3);
+}
+
+TEST(SimTest, LazyRenderer) {
+  SimulatorConfiguration cfg;
+  cfg.scene.id = vangogh;
+  cfg.createRenderer = false;
+  {
+    // navigation only, no GPU at all
+    SimulatorWithAgents simulator(cfg);
+    EXPECT_EQ(simulator.getRenderer(), nullptr);
+    EXPECT_EQ(simulator.getGpuDevice(), esp::ID_UNDEFINED);
+    ASSERT_NE(simulator.getPathFinder(), nullptr);
+    EXPECT_TRUE(simulator.getPathFinder()->isLoaded());
+    ASSERT_NE(simulator.getSemanticScene(), nullptr);
+  }
+
+  cfg.createRenderer = true;
+  cfg.lazyRenderer = true;
+  SimulatorWithAgents simulator(cfg);
+  EXPECT_EQ(simulator.getGpuDevice(), esp::ID_UNDEFINED);
+  EXPECT_EQ(simulator.getMemoryStats().meshBytes, 0u);
+  EXPECT_TRUE(simulator.getPathFinder()->isLoaded());
+
+  // the first observation creates the renderer and uploads the scene
+  Agent::ptr agent = simulator.addAgent(AgentConfiguration());
+  std::vector<std::map<std::string, esp::sensor::Observation>> observations;
+  ASSERT_TRUE(
+      simulator.stepAgents({agent->getActionId("lookLeft")}, observations));
+  EXPECT_NE(simulator.getGpuDevice(), esp::ID_UNDEFINED);
+  EXPECT_GT(simulator.getMemoryStats().meshBytes, 0u);
+  const Buffer& frame = *observations[0].at("rgba_camera").buffer;
+  const uint8_t* pixels = static_cast<const uint8_t*>(frame.data);
+  bool drawn = false;
+  for (size_t i = 0; i < frame.totalBytes && !drawn; ++i) {
+    drawn = pixels[i] != 0;
+  }
+  EXPECT_TRUE(drawn);
+}
+
+TEST(SimTest, CachedSensorProjection) {
+  esp::scene::SceneGraph sceneGraph;
+  esp::scene::SceneNode& node = sceneGraph.getRootNode().createChild();
+  SensorSpec::ptr spec = SensorSpec::create();
+  spec->resolution = {120, 160};
+  auto sensor = esp::sensor::PinholeCamera::create(node, spec);
+  const Magnum::Matrix4 projection = Magnum::Matrix4::perspectiveProjection(
+      Magnum::Deg{90.0f}, 160.0f / 120.0f, 0.01f, 1000.0f);
+
+  sceneGraph.setDefaultRenderCamera(*sensor);
+  esp::gfx::RenderCamera& camera = sceneGraph.getDefaultRenderCamera();
+  EXPECT_EQ(camera.getMagnumCamera().projectionMatrix(), projection);
+  EXPECT_EQ(camera.getMagnumCamera().viewport(), Magnum::Vector2i(160, 120));
+  EXPECT_EQ(camera.getDepthUnprojection(),
+            esp::gfx::calculateDepthUnprojection(projection));
+
+  // a projection set from its parameters gets its own unprojection
+  camera.setProjectionMatrix(64, 64, 0.1f, 10.0f, 60.0f);
+  EXPECT_EQ(camera.getDepthUnprojection(),
+            esp::gfx::calculateDepthUnprojection(
+                camera.getMagnumCamera().projectionMatrix()));
+
+  // and the sensor sets its cached one back
+  sceneGraph.setDefaultRenderCamera(*sensor);
+  EXPECT_EQ(camera.getMagnumCamera().projectionMatrix(), projection);
+  EXPECT_EQ(camera.getDepthUnprojection(),
+            esp::gfx::calculateDepthUnprojection(projection));
+}
+
+TEST(SimTest, StepAgents) {
+  SimulatorConfiguration cfg;
+  cfg.scene.id = vangogh;
+  SimulatorWithAgents simulator(cfg);
+  Agent::ptr first = simulator.addAgent(AgentConfiguration());
+  Agent::ptr second = simulator.addAgent(AgentConfiguration());
+  const int moveForward = first->getActionId("moveForward");
+  ASSERT_NE(moveForward, esp::ID_UNDEFINED);
+  EXPECT_EQ(first->getActionId("fly"), esp::ID_UNDEFINED);
+  EXPECT_EQ(first->getNumActions(), 3);
+
+  AgentState::ptr before = AgentState::create();
+  second->getState(before);
+  std::vector<std::map<std::string, esp::sensor::Observation>> observations;
+  ASSERT_TRUE(
+      simulator.stepAgents({moveForward, esp::ID_UNDEFINED}, observations));
+  ASSERT_EQ(observations.size(), 2u);
+  for (const auto& agentObservations : observations) {
+    EXPECT_EQ(agentObservations.count("rgba_camera"), 1u);
+  }
+  // the agent without an action stays in place
+  AgentState::ptr after = AgentState::create();
+  second->getState(after);
+  EXPECT_EQ(before->position, after->position);
+
+  // one valid action per agent, or nothing happens
+  EXPECT_FALSE(simulator.stepAgents({moveForward}, observations));
+  EXPECT_FALSE(simulator.stepAgents({moveForward, 3}, observations));
+}
+
+TEST(SimTest, StepBatch) {
+  // physics without objects, for the world time
+  const std::string physicsConfig = "SimTestBatch.phys_scene_config.json";
+  std::ofstream(physicsConfig) << R"({"timestep": 0.01})";
+  SimulatorConfiguration cfg;
+  cfg.scene.id = vangogh;
+  cfg.enablePhysics = true;
+  cfg.physicsConfigFile = physicsConfig;
+  BatchSimulatorWithAgents simulator(cfg, 2);
+  Agent::ptr first = simulator.addAgent(0, AgentConfiguration());
+  Agent::ptr second = simulator.addAgent(1, AgentConfiguration());
+  EXPECT_EQ(simulator.getNumAgents(0), 1);
+  EXPECT_EQ(simulator.getNumAgents(1), 1);
+  const int moveForward = first->getActionId("moveForward");
+  auto frame = [](const Observation& obs) {
+    const uint8_t* data = static_cast<const uint8_t*>(obs.buffer->data);
+    return std::vector<uint8_t>(data, data + obs.buffer->totalBytes);
+  };
+
+  // agents in the same place of the same scene observe the same
+  std::vector<std::vector<std::map<std::string, Observation>>> observations;
+  ASSERT_TRUE(simulator.step({{esp::ID_UNDEFINED}, {esp::ID_UNDEFINED}},
+                             observations, 0.1));
+  const double firstTime = simulator.getWorldTime();
+  EXPECT_GT(firstTime, 0.0);
+  ASSERT_EQ(observations.size(), 2u);
+  ASSERT_EQ(observations[0].size(), 1u);
+  ASSERT_EQ(observations[1].size(), 1u);
+  EXPECT_EQ(frame(observations[0][0].at("rgba_camera")),
+            frame(observations[1][0].at("rgba_camera")));
+
+  // every environment takes its own actions, the worlds step together
+  AgentState::ptr before = AgentState::create();
+  second->getState(before);
+  ASSERT_TRUE(simulator.step({{moveForward}, {esp::ID_UNDEFINED}},
+                             observations, 0.1));
+  EXPECT_GT(simulator.getWorldTime(), firstTime);
+  AgentState::ptr moved = AgentState::create();
+  AgentState::ptr after = AgentState::create();
+  first->getState(moved);
+  second->getState(after);
+  EXPECT_NE(moved->position, before->position);
+  EXPECT_EQ(after->position, before->position);
+  EXPECT_NE(frame(observations[0][0].at("rgba_camera")),
+            frame(observations[1][0].at("rgba_camera")));
+
+  // one valid action per agent of every environment, or nothing happens
+  EXPECT_FALSE(simulator.step({{moveForward}}, observations));
+  EXPECT_FALSE(simulator.step({{moveForward}, {}}, observations));
+  EXPECT_FALSE(simulator.step({{moveForward}, {3}}, observations));
+  AgentState::ptr unmoved = AgentState::create();
+  first->getState(unmoved);
+  EXPECT_EQ(unmoved->position, moved->position);
+
+  // loading the scene an environment shows keeps its agents, loading another
+  // one drops them and their nodes; the scene node of the old scene is
+  // replaced by the one of the new scene
+  simulator.reconfigureEnvironment(1, cfg.scene);
+  EXPECT_EQ(simulator.getNumAgents(1), 1);
+  auto numChildren = [](esp::scene::SceneNode& node) {
+    int count = 0;
+    for (auto* child = node.children().first(); child != nullptr;
+         child = child->nextSibling()) {
+      ++count;
+    }
+    return count;
+  };
+  second = nullptr;
+  const int numRootChildren =
+      numChildren(simulator.getSceneGraph(1).getRootNode());
+  SceneConfiguration otherScene;
+  otherScene.id = skokloster;
+  simulator.reconfigureEnvironment(1, otherScene);
+  EXPECT_EQ(simulator.getNumAgents(0), 1);
+  EXPECT_EQ(simulator.getNumAgents(1), 0);
+  EXPECT_EQ(numChildren(simulator.getSceneGraph(1).getRootNode()),
+            numRootChildren - 1);
+  std::remove(physicsConfig.c_str());
+}
+
+TEST(SimTest, StepAsync) {
+  SimulatorConfiguration cfg;
+  cfg.scene.id = vangogh;
+  SimulatorWithAgents simulator(cfg);
+  Agent::ptr first = simulator.addAgent(AgentConfiguration());
+  Agent::ptr second = simulator.addAgent(AgentConfiguration());
+  AgentState::ptr state = AgentState::create();
+  first->getState(state);
+  second->setState(*state);
+  const int moveForward = first->getActionId("moveForward");
+
+  // the same move observes the same, in flight or not
+  std::vector<std::map<std::string, esp::sensor::Observation>> observations;
+  const int handle = simulator.stepAsync({moveForward, esp::ID_UNDEFINED});
+  ASSERT_NE(handle, esp::ID_UNDEFINED);
+  ASSERT_TRUE(simulator.stepWait(handle, observations));
+  ASSERT_EQ(observations.size(), 2u);
+  const Buffer::ptr asyncBuffer = observations[0].at("rgba_camera").buffer;
+  const uint8_t* asyncData = static_cast<const uint8_t*>(asyncBuffer->data);
+  const std::vector<uint8_t> asyncFrame(asyncData,
+                                        asyncData + asyncBuffer->totalBytes);
+  ASSERT_TRUE(
+      simulator.stepAgents({esp::ID_UNDEFINED, moveForward}, observations));
+  const Buffer::ptr syncBuffer = observations[1].at("rgba_camera").buffer;
+  const uint8_t* syncData = static_cast<const uint8_t*>(syncBuffer->data);
+  EXPECT_EQ(asyncFrame, std::vector<uint8_t>(
+                            syncData, syncData + syncBuffer->totalBytes));
+
+  // two steps in flight by default, which complete in order
+  const int firstStep = simulator.stepAsync({moveForward, moveForward});
+  const int secondStep = simulator.stepAsync({moveForward, moveForward});
+  ASSERT_NE(firstStep, esp::ID_UNDEFINED);
+  ASSERT_NE(secondStep, esp::ID_UNDEFINED);
+  EXPECT_EQ(simulator.stepAsync({moveForward, moveForward}),
+            esp::ID_UNDEFINED);
+  EXPECT_TRUE(simulator.stepWait(secondStep, observations));
+  EXPECT_FALSE(simulator.stepWait(firstStep, observations));
+
+  EXPECT_EQ(simulator.stepAsync({moveForward}), esp::ID_UNDEFINED);
+}
+
+TEST(SimTest, EncodedObservations) {
+  SimulatorConfiguration cfg;
+  cfg.scene.id = vangogh;
+  SimulatorWithAgents simulator(cfg);
+  AgentConfiguration agentConfig;
+  agentConfig.sensorSpecifications[0]->encoding = "rgba_uint8+lz4";
+  esp::sensor::SensorSpec::ptr depthSpec = esp::sensor::SensorSpec::create();
+  depthSpec->uuid = "depth";
+  depthSpec->sensorType = esp::sensor::SensorType::DEPTH;
+  depthSpec->channels = 1;
+  depthSpec->encoding = "depth_float+lz4";
+  agentConfig.sensorSpecifications.push_back(depthSpec);
+  Agent::ptr agent = simulator.addAgent(agentConfig);
+  const int moveForward = agent->getActionId("moveForward");
+
+  std::vector<std::map<std::string, esp::sensor::Observation>> observations;
+  ASSERT_TRUE(simulator.stepAgents({moveForward}, observations));
+  const esp::sensor::Observation& color = observations[0].at("rgba_camera");
+  ASSERT_NE(color.encoded, nullptr);
+  EXPECT_LT(color.encoded->totalBytes, color.buffer->totalBytes);
+  // color is lossless
+  ObservationEncoder::ptr colorEncoder =
+      ObservationEncoder::fromSpec(*agentConfig.sensorSpecifications[0]);
+  ASSERT_NE(colorEncoder, nullptr);
+  Buffer decoded;
+  ASSERT_TRUE(colorEncoder->decode(color.encoded->data,
+                                   color.encoded->totalBytes, decoded));
+  ASSERT_EQ(decoded.totalBytes, color.buffer->totalBytes);
+  EXPECT_EQ(std::memcmp(decoded.data, color.buffer->data, decoded.totalBytes),
+            0);
+
+  // depth is within half a millimeter
+  const esp::sensor::Observation& depth = observations[0].at("depth");
+  ASSERT_NE(depth.encoded, nullptr);
+  ObservationEncoder::ptr depthEncoder =
+      ObservationEncoder::fromSpec(*depthSpec);
+  ASSERT_TRUE(depthEncoder->decode(depth.encoded->data,
+                                   depth.encoded->totalBytes, decoded));
+  ASSERT_EQ(decoded.totalSize, depth.buffer->totalSize);
+  const float* expected = static_cast<const float*>(depth.buffer->data);
+  const float* actual = static_cast<const float*>(decoded.data);
+  for (size_t i = 0; i < decoded.totalSize; ++i) {
+    EXPECT_NEAR(actual[i], expected[i], 0.0005f + 1e-6f * expected[i]);
+  }
+
+  // the encoded buffer of a sensor is reused every step
+  const void* encodedData = color.encoded->data;
+  ASSERT_TRUE(simulator.stepAgents({moveForward}, observations));
+  EXPECT_EQ(observations[0].at("rgba_camera").encoded->data, encodedData);
+  EXPECT_FALSE(colorEncoder->decode(encodedData, 3, decoded));
+}
+
+TEST(SimTest, CompactObservations) {
+  SimulatorConfiguration cfg;
+  cfg.scene.id = vangogh;
+  SimulatorWithAgents simulator(cfg);
+  AgentConfiguration agentConfig;
+  esp::sensor::SensorSpec::ptr rgbSpec = esp::sensor::SensorSpec::create();
+  *rgbSpec = *agentConfig.sensorSpecifications[0];
+  rgbSpec->uuid = "rgb";
+  rgbSpec->channels = 3;
+  rgbSpec->encoding = "rgb_uint8";
+  agentConfig.sensorSpecifications.push_back(rgbSpec);
+  for (const std::string encoding :
+       {"depth_float", "depth_float16", "depth_uint16_mm"}) {
+    esp::sensor::SensorSpec::ptr depthSpec = esp::sensor::SensorSpec::create();
+    depthSpec->uuid = encoding;
+    depthSpec->sensorType = esp::sensor::SensorType::DEPTH;
+    depthSpec->channels = 1;
+    depthSpec->encoding = encoding;
+    agentConfig.sensorSpecifications.push_back(depthSpec);
+  }
+  simulator.addAgent(agentConfig);
+
+  std::vector<std::map<std::string, esp::sensor::Observation>> observations;
+  ASSERT_TRUE(simulator.stepAgents({esp::ID_UNDEFINED}, observations));
+  const std::map<std::string, esp::sensor::Observation>& obs = observations[0];
+
+  // RGB is RGBA without the alpha
+  const Buffer& rgba = *obs.at("rgba_camera").buffer;
+  const Buffer& rgb = *obs.at("rgb").buffer;
+  ASSERT_EQ(rgb.dataType, esp::core::DataType::DT_UINT8);
+  ASSERT_EQ(rgb.shape, std::vector<size_t>({rgba.shape[0], rgba.shape[1], 3}));
+  const uint8_t* rgbaData = static_cast<const uint8_t*>(rgba.data);
+  const uint8_t* rgbData = static_cast<const uint8_t*>(rgb.data);
+  for (size_t i = 0; i < rgba.shape[0] * rgba.shape[1]; ++i) {
+    for (size_t c = 0; c < 3; ++c) {
+      EXPECT_EQ(rgbData[3 * i + c], rgbaData[4 * i + c]);
+    }
+  }
+
+  // 16-bit depth is within its precision of float depth
+  const Buffer& depth = *obs.at("depth_float").buffer;
+  const Buffer& half = *obs.at("depth_float16").buffer;
+  const Buffer& mm = *obs.at("depth_uint16_mm").buffer;
+  ASSERT_EQ(half.dataType, esp::core::DataType::DT_FLOAT16);
+  ASSERT_EQ(mm.dataType, esp::core::DataType::DT_UINT16);
+  ASSERT_EQ(half.totalSize, depth.totalSize);
+  ASSERT_EQ(mm.totalSize, depth.totalSize);
+  EXPECT_EQ(half.totalBytes * 2, depth.totalBytes);
+  const float* depthData = static_cast<const float*>(depth.data);
+  const uint16_t* halfData = static_cast<const uint16_t*>(half.data);
+  const uint16_t* mmData = static_cast<const uint16_t*>(mm.data);
+  for (size_t i = 0; i < depth.totalSize; ++i) {
+    EXPECT_NEAR(Magnum::Math::unpackHalf(halfData[i]), depthData[i],
+                depthData[i] / 1024.0f + 1e-6f);
+    EXPECT_NEAR(mmData[i], depthData[i] * 1000.0f, 1.0f);
+  }
+}
+
+TEST(SimTest, ActById) {
+  SimulatorConfiguration cfg;
+  cfg.scene.id = vangogh;
+  SimulatorWithAgents simulator(cfg);
+  Agent::ptr byName = simulator.addAgent(AgentConfiguration());
+  Agent::ptr byId = simulator.addAgent(AgentConfiguration());
+  AgentState::ptr state = AgentState::create();
+  byName->getState(state);
+  byId->setState(*state);
+
+  // compiled actions move exactly like the named ones
+  for (const std::string action : {"moveForward", "lookLeft", "moveForward",
+                                   "lookRight", "moveForward"}) {
+    ASSERT_TRUE(byName->act(action));
+    ASSERT_TRUE(byId->act(byId->getActionId(action)));
+  }
+  AgentState::ptr nameState = AgentState::create();
+  AgentState::ptr idState = AgentState::create();
+  byName->getState(nameState);
+  byId->getState(idState);
+  EXPECT_EQ(nameState->position, idState->position);
+  EXPECT_EQ(nameState->rotation, idState->rotation);
+  EXPECT_FALSE(byId->act(byId->getNumActions()));
+  EXPECT_FALSE(byId->act(esp::ID_UNDEFINED));
+}
+
+TEST(SimTest, EpisodeRecordingCoding) {
+  EpisodeRecording recording({1});
+  EpisodeStep step;
+  step.actionIds = {esp::ID_UNDEFINED};
+  step.agentPoses.assign(2 * EpisodeRecording::poseSize, 0.5f);
+  step.objectIDs = {0, 3};
+  step.objectTransformations.assign(
+      2 * EpisodeRecording::transformationSize, 1.0f);
+  std::vector<EpisodeStep> steps;
+  for (int i = 0; i < 4; ++i) {
+    step.worldTime += 1.0 / 60.0;
+    step.actionIds = {i};
+    step.agentPoses[2] -= 0.25f;
+    if (i == 2) {
+      // an object is added and one removed
+      step.objectIDs = {3, 7};
+      step.objectTransformations[EpisodeRecording::transformationSize] = 2.0f;
+    }
+    ASSERT_TRUE(recording.append(step));
+    steps.push_back(step);
+  }
+  step.objectIDs = {7, 3};
+  EXPECT_FALSE(recording.append(step));
+  EXPECT_EQ(recording.getNumSteps(), 4);
+
+  const std::string file = Cr::Utility::Directory::join(
+      Cr::Utility::Directory::tmp(), "SimTestEpisode.bin");
+  ASSERT_TRUE(recording.save(file));
+  EpisodeRecording::ptr loaded = EpisodeRecording::load(file);
+  ASSERT_NE(loaded, nullptr);
+  EXPECT_EQ(loaded->getData(), recording.getData());
+
+  size_t offset = 0;
+  EpisodeStep decoded;
+  for (const EpisodeStep& expected : steps) {
+    ASSERT_TRUE(loaded->readStep(offset, decoded));
+    EXPECT_EQ(decoded.worldTime, expected.worldTime);
+    EXPECT_EQ(decoded.actionIds, expected.actionIds);
+    EXPECT_EQ(decoded.agentPoses, expected.agentPoses);
+    EXPECT_EQ(decoded.objectIDs, expected.objectIDs);
+    EXPECT_EQ(decoded.objectTransformations, expected.objectTransformations);
+  }
+  EXPECT_FALSE(loaded->readStep(offset, decoded));
+}
+
+TEST(SimTest, EpisodeReplay) {
+  SimulatorConfiguration cfg;
+  cfg.scene.id = vangogh;
+  SimulatorWithAgents simulator(cfg);
+  Agent::ptr agent = simulator.addAgent(AgentConfiguration());
+  const int moveForward = agent->getActionId("moveForward");
+  const int lookLeft = agent->getActionId("lookLeft");
+
+  simulator.startRecording();
+  std::vector<std::map<std::string, esp::sensor::Observation>> observations;
+  std::vector<std::vector<uint8_t>> frames;
+  for (const int action : {moveForward, lookLeft, moveForward}) {
+    ASSERT_TRUE(simulator.stepAgents({action}, observations));
+    const Buffer& frame = *observations[0].at("rgba_camera").buffer;
+    const uint8_t* data = static_cast<const uint8_t*>(frame.data);
+    frames.emplace_back(data, data + frame.totalBytes);
+  }
+  AgentState::ptr recordedState = AgentState::create();
+  agent->getState(recordedState);
+  EpisodeRecording::ptr recording = simulator.stopRecording();
+  ASSERT_NE(recording, nullptr);
+  EXPECT_FALSE(simulator.isRecording());
+  // the state at the start, then one per step
+  ASSERT_EQ(recording->getNumSteps(), 4);
+
+  simulator.reset();
+  ASSERT_TRUE(simulator.startReplay(recording));
+  EpisodeStep step;
+  ASSERT_TRUE(simulator.replayStep(observations, &step));
+  EXPECT_EQ(step.actionIds, std::vector<int>({esp::ID_UNDEFINED}));
+  for (size_t i = 0; i < frames.size(); ++i) {
+    ASSERT_TRUE(simulator.replayStep(observations, &step));
+    const Buffer& frame = *observations[0].at("rgba_camera").buffer;
+    ASSERT_EQ(frame.totalBytes, frames[i].size());
+    EXPECT_EQ(std::memcmp(frame.data, frames[i].data(), frame.totalBytes), 0);
+  }
+  EXPECT_EQ(step.actionIds, std::vector<int>({moveForward}));
+  AgentState::ptr replayedState = AgentState::create();
+  agent->getState(replayedState);
+  EXPECT_EQ(replayedState->position, recordedState->position);
+  EXPECT_EQ(replayedState->rotation, recordedState->rotation);
+  EXPECT_FALSE(simulator.replayStep(observations));
+
+  // another set of agents cannot replay it
+  simulator.addAgent(AgentConfiguration());
+  EXPECT_FALSE(simulator.startReplay(recording));
+}
+
+TEST(SimTest, Clone) {
+  SimulatorConfiguration cfg;
+  cfg.scene.id = vangogh;
+  SimulatorWithAgents simulator(cfg);
+  Agent::ptr agent = simulator.addAgent(AgentConfiguration());
+  const int moveForward = agent->getActionId("moveForward");
+  const int lookLeft = agent->getActionId("lookLeft");
+  std::vector<std::map<std::string, esp::sensor::Observation>> observations;
+  ASSERT_TRUE(simulator.stepAgents({lookLeft}, observations));
+  auto* camera = dynamic_cast<esp::sensor::PinholeCamera*>(
+      agent->getSensorSuite().get("rgba_camera").get());
+  ASSERT_NE(camera, nullptr);
+  // a noise stream some frames in
+  esp::core::Random noiseRandom(7);
+  noiseRandom.uniform_uint();
+  camera->setNoiseRandom(noiseRandom);
+
+  auto fork =
+      std::dynamic_pointer_cast<SimulatorWithAgents>(simulator.clone());
+  ASSERT_NE(fork, nullptr);
+  // the sensor noise continues from where it is in the source
+  auto* forkCamera = dynamic_cast<esp::sensor::PinholeCamera*>(
+      fork->getAgent(0)->getSensorSuite().get("rgba_camera").get());
+  ASSERT_NE(forkCamera, nullptr);
+  esp::core::Random forkNoise = forkCamera->getNoiseRandom();
+  EXPECT_EQ(forkNoise.uniform_uint(), noiseRandom.uniform_uint());
+  // the assets are shared, not loaded again
+  EXPECT_EQ(fork->getRenderer(), simulator.getRenderer());
+  EXPECT_EQ(fork->getPathFinder(), simulator.getPathFinder());
+  EXPECT_EQ(fork->getMemoryStats().meshBytes,
+            simulator.getMemoryStats().meshBytes);
+
+  // both continue from the same state, and branch independently
+  std::vector<std::map<std::string, esp::sensor::Observation>> forkObservations;
+  ASSERT_TRUE(simulator.stepAgents({moveForward}, observations));
+  ASSERT_TRUE(fork->stepAgents({moveForward}, forkObservations));
+  AgentState::ptr state = AgentState::create();
+  AgentState::ptr forkState = AgentState::create();
+  agent->getState(state);
+  fork->getAgent(0)->getState(forkState);
+  EXPECT_EQ(forkState->position, state->position);
+  EXPECT_EQ(forkState->rotation, state->rotation);
+  const Buffer& frame = *observations[0].at("rgba_camera").buffer;
+  const Buffer& forkFrame = *forkObservations[0].at("rgba_camera").buffer;
+  ASSERT_EQ(forkFrame.totalBytes, frame.totalBytes);
+  EXPECT_EQ(std::memcmp(forkFrame.data, frame.data, frame.totalBytes), 0);
+
+  ASSERT_TRUE(fork->stepAgents({moveForward}, forkObservations));
+  agent->getState(state);
+  fork->getAgent(0)->getState(forkState);
+  EXPECT_NE(forkState->position, state->position);
+  // the shared navmesh is read only, until the fork is gone; holding the
+  // pathfinder does not count as sharing it
+  EXPECT_TRUE(simulator.isNavMeshShared());
+  EXPECT_FALSE(simulator.removeNavMeshObstacle(0));
+  fork = nullptr;
+  PathFinder::ptr pathfinder = simulator.getPathFinder();
+  EXPECT_FALSE(simulator.isNavMeshShared());
+}
+
+TEST(SimTest, NavMeshMoveFilter) {
+  SimulatorConfiguration cfg;
+  cfg.scene.id = vangogh;
+  SimulatorWithAgents simulator(cfg);
+  ASSERT_TRUE(simulator.getPathFinder()->isLoaded());
+  Agent::ptr agent = simulator.addAgent(AgentConfiguration());
+  AgentState::ptr start = AgentState::create();
+  simulator.sampleRandomAgentState(start);
+  agent->setState(*start);
+
+  // walking straight ahead runs into a wall of the room eventually
+  AgentState::ptr state = AgentState::create();
+  bool collided = false;
+  for (int i = 0; i < 100 && !collided; ++i) {
+    agent->act("moveForward");
+    agent->getState(state);
+    collided = state->collided;
+  }
+  EXPECT_TRUE(collided);
+  AgentState::ptr stopped = AgentState::create();
+  agent->getState(stopped);
+
+  // unfiltered, the walls stop nothing
+  SimulatorConfiguration unfiltered = cfg;
+  unfiltered.navMeshMoveFilter = false;
+  SimulatorWithAgents unfilteredSimulator(unfiltered);
+  Agent::ptr unfilteredAgent =
+      unfilteredSimulator.addAgent(AgentConfiguration());
+  unfilteredAgent->setState(*stopped);
+  unfilteredAgent->act("moveForward");
+  unfilteredAgent->getState(state);
+  EXPECT_FALSE(state->collided);
+  EXPECT_NEAR((state->position - stopped->position).norm(), 0.25f, 1e-4f);
+}
+
+TEST(SimTest, NavigationSensors) {
+  SimulatorConfiguration cfg;
+  cfg.scene.id = vangogh;
+  SimulatorWithAgents simulator(cfg);
+  AgentConfiguration agentConfig;
+  agentConfig.sensorSpecifications.clear();
+  for (const auto& type :
+       std::vector<std::pair<SensorType, std::string>>{
+           {SensorType::GOAL, "pointgoal"},
+           {SensorType::PATH, "geodesic"},
+           {SensorType::TENSOR, "gps"},
+           {SensorType::TENSOR, "compass"}}) {
+    SensorSpec::ptr spec = SensorSpec::create();
+    spec->uuid = type.second;
+    spec->sensorType = type.first;
+    spec->sensorSubtype = type.second;
+    agentConfig.sensorSpecifications.push_back(spec);
+  }
+  Agent::ptr agent = simulator.addAgent(agentConfig);
+  AgentState::ptr start = AgentState::create();
+  simulator.sampleRandomAgentState(start);
+  agent->setState(*start);
+
+  // nothing to measure without a goal
+  std::map<std::string, Observation> observations;
+  ASSERT_EQ(simulator.getAgentObservations(0, observations), 2);
+  const esp::vec3f goal =
+      simulator.getPathFinder()->getRandomNavigablePoint();
+  for (const char* uuid : {"pointgoal", "geodesic"}) {
+    auto sensor = std::dynamic_pointer_cast<NavigationSensor>(
+        agent->getSensorSuite().get(uuid));
+    ASSERT_NE(sensor, nullptr);
+    sensor->setGoal(goal);
+  }
+  ASSERT_EQ(simulator.getAgentObservations(0, observations), 4);
+  auto value = [&](const std::string& uuid, int i) {
+    return reinterpret_cast<const float*>(observations[uuid].buffer->data)[i];
+  };
+  EXPECT_EQ(value("gps", 0), 0.0f);
+  EXPECT_EQ(value("gps", 1), 0.0f);
+  EXPECT_NEAR(value("compass", 0), 0.0f, 1e-5f);
+  esp::vec3f toGoal = goal - start->position;
+  toGoal[1] = 0.0f;
+  EXPECT_NEAR(value("pointgoal", 0), toGoal.norm(), 1e-4f);
+  // the path on the navmesh is no shorter than the straight line
+  EXPECT_GE(value("geodesic", 0), value("pointgoal", 0) - 1e-3f);
+
+  // turning changes the heading, and the direction of the goal by as much
+  const float angle = value("pointgoal", 1);
+  agent->act("lookLeft");
+  simulator.getAgentObservations(0, observations);
+  const float turn = 10.0f * M_PI / 180.0f;
+  EXPECT_NEAR(value("compass", 0), turn, 1e-4f);
+  EXPECT_NEAR(std::remainder(value("pointgoal", 1) - angle + turn, 2 * M_PI),
+              0.0f, 1e-4f);
+  EXPECT_NEAR(value("pointgoal", 0), toGoal.norm(), 1e-4f);
+
+  // a new episode starts where the agent is
+  std::dynamic_pointer_cast<NavigationSensor>(
+      agent->getSensorSuite().get("compass"))
+      ->resetEpisode();
+  simulator.getAgentObservations(0, observations);
+  EXPECT_NEAR(value("compass", 0), 0.0f, 1e-5f);
+}
+
+TEST(SimTest, AgentStates) {
+  SimulatorConfiguration cfg;
+  cfg.scene.id = vangogh;
+  SimulatorWithAgents simulator(cfg);
+  Agent::ptr first = simulator.addAgent(AgentConfiguration());
+  Agent::ptr second = simulator.addAgent(AgentConfiguration());
+
+  std::vector<float> states;
+  simulator.getAgentStates(states);
+  ASSERT_EQ(states.size(), 2 * SimulatorWithAgents::agentStateSize);
+  AgentState::ptr state = AgentState::create();
+  second->getState(state);
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_EQ(states[SimulatorWithAgents::agentStateSize + i],
+              state->position[i]);
+  }
+
+  // a quarter turn about +Y for both agents, at new positions
+  const float halfSqrt2 = std::sqrt(0.5f);
+  states = {1.0f, 0.0f, 2.0f, 0.0f, halfSqrt2, 0.0f, halfSqrt2,
+            -1.0f, 0.5f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f};
+  ASSERT_TRUE(simulator.setAgentStates(states));
+  first->getState(state);
+  EXPECT_EQ(state->position, esp::vec3f(1.0f, 0.0f, 2.0f));
+  EXPECT_TRUE(state->rotation.isApprox(
+      esp::vec4f(0.0f, halfSqrt2, 0.0f, halfSqrt2)));
+  std::vector<float> roundTrip;
+  simulator.getAgentStates(roundTrip);
+  for (int i = 0; i < states.size(); ++i) {
+    EXPECT_NEAR(roundTrip[i], states[i], 1e-6f);
+  }
+
+  // positions only keep the rotations
+  ASSERT_TRUE(
+      simulator.setAgentPositions({0.0f, 1.0f, 0.0f, 3.0f, 0.0f, 3.0f}));
+  second->getState(state);
+  EXPECT_EQ(state->position, esp::vec3f(3.0f, 0.0f, 3.0f));
+  EXPECT_TRUE(state->rotation.isApprox(esp::vec4f(0.0f, 0.0f, 0.0f, 1.0f)));
+
+  // nothing changes on malformed input
+  EXPECT_FALSE(simulator.setAgentPositions({0.0f, 0.0f, 0.0f}));
+  states[SimulatorWithAgents::agentStateSize + 6] = 2.0f;
+  EXPECT_FALSE(simulator.setAgentStates(states));
+  second->getState(state);
+  EXPECT_EQ(state->position, esp::vec3f(3.0f, 0.0f, 3.0f));
+}
+
+TEST(SimTest, ActVelocity) {
+  SimulatorConfiguration cfg;
+  cfg.scene.id = vangogh;
+  // unfiltered, so that the motion is exact
+  cfg.navMeshMoveFilter = false;
+  SimulatorWithAgents simulator(cfg);
+  AgentConfiguration agentConfig;
+  agentConfig.angularAcceleration = 0.0f;
+  Agent::ptr agent = simulator.addAgent(agentConfig);
+  AgentState::ptr state = AgentState::create();
+  agent->getState(state);
+  const esp::vec3f start = state->position;
+
+  // 1 m/s forward for 1 s in 60 substeps: the speed ramps up at 20 m/s^2
+  // over the first 3 substeps, which cost a substep of travel
+  EXPECT_FALSE(agent->actVelocity(esp::vec3f(0.0f, 0.0f, -1.0f),
+                                  esp::vec3f::Zero(), 1.0f));
+  agent->getState(state);
+  EXPECT_NEAR(state->position.z(), start.z() - 59.0f / 60.0f, 1e-4f);
+  EXPECT_NEAR(state->position.x(), start.x(), 1e-4f);
+  EXPECT_TRUE(state->velocity.isApprox(esp::vec3f(0.0f, 0.0f, -1.0f)));
+
+  // a quarter turn about +Y without angular acceleration limits, while the
+  // agent keeps driving forward from the velocity it has
+  const float halfSqrt2 = std::sqrt(0.5f);
+  agent->actVelocity(esp::vec3f(0.0f, 0.0f, -1.0f),
+                     esp::vec3f(0.0f, float(M_PI) / 2.0f, 0.0f), 1.0f);
+  agent->getState(state);
+  EXPECT_TRUE(state->rotation.isApprox(
+      esp::vec4f(0.0f, halfSqrt2, 0.0f, halfSqrt2), 1e-4f));
+  EXPECT_EQ(state->angularVelocity, esp::vec3f(0.0f, float(M_PI) / 2.0f, 0.0f));
+
+  // the velocities come back through setState
+  state->velocity = esp::vec3f::Zero();
+  agent->setState(*state);
+  agent->actVelocity(esp::vec3f::Zero(), esp::vec3f::Zero(), 0.5f);
+  const esp::vec3f stopped = state->position;
+  agent->getState(state);
+  EXPECT_TRUE(state->position.isApprox(stopped));
+}
+
+TEST(SimTest, SimulatorServer) {
+  SimulatorConfiguration cfg;
+  cfg.scene.id = vangogh;
+  const std::string name = "SimTest.SimulatorServer";
+  SimulatorServer server(name, 2, cfg, {AgentConfiguration()});
+  ASSERT_TRUE(server.start());
+  EXPECT_EQ(server.getNumServing(), 2);
+
+  SimulatorClient client(name, 10000000);
+  ASSERT_TRUE(client.isValid());
+  ASSERT_EQ(client.getNumEnvs(), 2);
+  ASSERT_EQ(client.getNumAgents(0), 1);
+  ASSERT_EQ(client.getObservations(0).size(), 1u);
+  EXPECT_STREQ(client.getObservations(0)[0].sensorUuid, "rgba_camera");
+  EXPECT_EQ(client.getObservation(0, 0), nullptr);
+
+  ASSERT_TRUE(client.seed(1));
+  ASSERT_TRUE(client.reset());
+  Buffer::ptr observation = client.getObservation(1, 0);
+  ASSERT_NE(observation, nullptr);
+  EXPECT_EQ(observation->shape, (std::vector<size_t>{84, 84, 4}));
+  const std::vector<float> start(client.getAgentStates(0),
+                                 client.getAgentStates(0) + 3);
+
+  // the frames of the server take turns, so the previous one stays intact;
+  // action ids go by name: lookLeft, lookRight, moveForward
+  const int moveForward = 2;
+  ASSERT_TRUE(client.step({moveForward, esp::ID_UNDEFINED}));
+  EXPECT_NE(client.getObservation(1, 0)->data, observation->data);
+  EXPECT_NE(std::vector<float>(client.getAgentStates(0),
+                               client.getAgentStates(0) + 3),
+            start);
+  // a wrong number of actions is rejected before anything is sent
+  EXPECT_FALSE(client.step({moveForward}));
+
+  // requests can be queued ahead
+  ASSERT_TRUE(client.submitStep(0, &moveForward));
+  ASSERT_TRUE(client.submitStep(0, &moveForward));
+  EXPECT_TRUE(client.wait(0));
+  EXPECT_TRUE(client.wait(0));
+  EXPECT_FALSE(client.wait(0));
+
+  client.stop();
+  server.wait();
+  EXPECT_EQ(server.getNumServing(), 0);
+}
@@ -0,0 +1,118 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <fstream>
+#include "esp/assets/TextureAtlas.h"
+#include "esp/core/esp.h"
+
+namespace Mn = Magnum;
+
+using namespace esp::assets;
+
+TEST(TextureAtlasTest, Pack) {
+  const std::vector<Mn::Vector2i> sizes{
+      {64, 64}, {30, 10}, {128, 32}, {1, 1}, {64, 64}};
+  std::vector<AtlasPlacement> placements;
+  Mn::Vector2i atlasSize;
+  ASSERT_TRUE(packTextureAtlas(sizes, 1024, placements, atlasSize));
+  ASSERT_EQ(placements.size(), sizes.size());
+  EXPECT_LE(atlasSize.y(), atlasSize.x());
+
+  const int p = textureAtlasPadding;
+  for (size_t i = 0; i < sizes.size(); ++i) {
+    const AtlasPlacement& a = placements[i];
+    EXPECT_EQ(a.width, sizes[i].x());
+    EXPECT_EQ(a.height, sizes[i].y());
+    // padded rectangles start at multiples of the padding inside the atlas
+    EXPECT_EQ((a.x - p) % p, 0);
+    EXPECT_EQ((a.y - p) % p, 0);
+    EXPECT_GE(a.x - p, 0);
+    EXPECT_GE(a.y - p, 0);
+    EXPECT_LE(a.x + a.width + p, atlasSize.x());
+    EXPECT_LE(a.y + a.height + p, atlasSize.y());
+    for (size_t j = 0; j < i; ++j) {
+      const AtlasPlacement& b = placements[j];
+      const bool apart = a.x + a.width + p <= b.x - p ||
+                         b.x + b.width + p <= a.x - p ||
+                         a.y + a.height + p <= b.y - p ||
+                         b.y + b.height + p <= a.y - p;
+      EXPECT_TRUE(apart) << i << " overlaps " << j;
+    }
+  }
+
+  // too large for the limit
+  EXPECT_FALSE(packTextureAtlas({{1024, 1024}, {1024, 1024}}, 1024,
+                                placements, atlasSize));
+}
+
+TEST(TextureAtlasTest, CopyAndRemap) {
+  TextureAtlas atlas;
+  atlas.channels = 4;
+  atlas.placements.resize(1);
+  Mn::Vector2i atlasSize;
+  ASSERT_TRUE(packTextureAtlas({{2, 2}}, 64, atlas.placements, atlasSize));
+  atlas.width = atlasSize.x();
+  atlas.height = atlasSize.y();
+  atlas.pixels.assign(size_t(atlas.width) * atlas.height * atlas.channels, 0);
+
+  // RGB texels get an opaque alpha, the padding repeats the edges
+  const std::vector<uint8_t> rgb{10, 11, 12, 20, 21, 22, 30, 31, 32, 40, 41,
+                                 42};
+  const AtlasPlacement& placement = atlas.placements[0];
+  copyIntoTextureAtlas(atlas, placement, rgb.data(), 3);
+  auto texel = [&](int x, int y) {
+    return &atlas.pixels[(size_t(y) * atlas.width + x) * atlas.channels];
+  };
+  EXPECT_EQ(texel(placement.x, placement.y)[0], 10);
+  EXPECT_EQ(texel(placement.x, placement.y)[3], 255);
+  EXPECT_EQ(texel(placement.x + 1, placement.y + 1)[2], 42);
+  EXPECT_EQ(texel(placement.x - textureAtlasPadding, placement.y)[0], 10);
+  EXPECT_EQ(texel(placement.x + 1 + textureAtlasPadding,
+                  placement.y + 1 + textureAtlasPadding)[0],
+            40);
+
+  // corners of the texture map to corners of its placement
+  const Mn::Vector2 origin = atlas.remap(0, {0.0f, 0.0f});
+  const Mn::Vector2 corner = atlas.remap(0, {1.0f, 1.0f});
+  EXPECT_FLOAT_EQ(origin.x(), float(placement.x) / atlas.width);
+  EXPECT_FLOAT_EQ(origin.y(), float(placement.y) / atlas.height);
+  EXPECT_FLOAT_EQ(corner.x(), float(placement.x + 2) / atlas.width);
+  EXPECT_FLOAT_EQ(corner.y(), float(placement.y + 2) / atlas.height);
+  EXPECT_TRUE(atlas.hasPackedTextures());
+  EXPECT_LE(atlas.levels(), 4);
+}
+
+TEST(TextureAtlasTest, SaveLoad) {
+  TextureAtlas atlas;
+  atlas.width = 16;
+  atlas.height = 8;
+  atlas.channels = 3;
+  atlas.pixels.assign(16 * 8 * 3, 7);
+  atlas.placements.resize(3);
+  atlas.placements[1] = {8, 0, 4, 4};
+  atlas.meshTextures = {-1, 1};
+
+  const std::string file = "TextureAtlasTest.atlas.cache";
+  const std::string source = "TextureAtlasTest.glb";
+  std::ofstream(source) << "scene";
+  ASSERT_TRUE(saveTextureAtlas(file, atlas, source));
+  TextureAtlas loaded;
+  ASSERT_TRUE(loadTextureAtlas(file, source, loaded));
+  EXPECT_EQ(loaded.width, 16);
+  EXPECT_EQ(loaded.height, 8);
+  EXPECT_EQ(loaded.channels, 3);
+  EXPECT_EQ(loaded.pixels, atlas.pixels);
+  ASSERT_EQ(loaded.placements.size(), 3u);
+  EXPECT_FALSE(loaded.placements[0].isPacked());
+  EXPECT_EQ(loaded.placements[1].x, 8);
+  EXPECT_EQ(loaded.placements[1].width, 4);
+  EXPECT_EQ(loaded.meshTextures, atlas.meshTextures);
+  // made from another scene file
+  std::ofstream(source) << "another scene";
+  EXPECT_FALSE(loadTextureAtlas(file, source, loaded));
+  std::remove(file.c_str());
+  std::remove(source.c_str());
+}
@@ -0,0 +1,117 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include "esp/assets/TextureCompression.h"
+#include "esp/core/esp.h"
+
+using namespace esp::assets;
+
+namespace {
+int maxError(const std::vector<uint8_t>& a, const std::vector<uint8_t>& b) {
+  int error = 0;
+  for (size_t i = 0; i < a.size(); ++i) {
+    error = std::max(error, std::abs(int(a[i]) - int(b[i])));
+  }
+  return error;
+}
+}  // namespace
+
+TEST(TextureCompressionTest, BC1) {
+  // a gradient along one axis per block is exact up to the 565 quantization
+  // and the palette interpolation
+  const int width = 10, height = 6;
+  std::vector<uint8_t> rgb(width * height * 3);
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      uint8_t* texel = &rgb[3 * (y * width + x)];
+      texel[0] = 40 + 16 * (x % 4);
+      texel[1] = 200 - 16 * (x % 4);
+      texel[2] = 100;
+    }
+  }
+  const std::vector<uint8_t> blocks = compressBC1(rgb.data(), width, height);
+  // sizes not divisible by 4 get partial blocks
+  EXPECT_EQ(blocks.size(), 3 * 2 * 8);
+  const std::vector<uint8_t> decompressed =
+      decompressBC1(blocks, width, height);
+  ASSERT_EQ(decompressed.size(), rgb.size());
+  EXPECT_LE(maxError(rgb, decompressed), 8);
+
+  // a single color per block
+  std::vector<uint8_t> flat(4 * 4 * 3, 0);
+  for (size_t i = 0; i < flat.size(); i += 3) {
+    flat[i] = 255;
+  }
+  EXPECT_EQ(decompressBC1(compressBC1(flat.data(), 4, 4), 4, 4), flat);
+}
+
+TEST(TextureCompressionTest, CompressedAtlasFile) {
+  const int width = 8, height = 8;
+  std::vector<uint8_t> rgb(width * height * 3);
+  for (size_t i = 0; i < rgb.size(); ++i) {
+    rgb[i] = i * 7 % 256;
+  }
+  const std::vector<uint8_t> blocks = compressBC1(rgb.data(), width, height);
+
+  const std::string file = "TextureCompressionTest.bc1";
+  const std::string source = "TextureCompressionTest.rgb";
+  std::ofstream(source).write(reinterpret_cast<const char*>(rgb.data()),
+                              rgb.size());
+  ASSERT_TRUE(saveCompressedAtlas(file, blocks, width, height, source));
+  std::vector<uint8_t> loaded;
+  int loadedWidth = 0, loadedHeight = 0;
+  ASSERT_TRUE(
+      loadCompressedAtlas(file, source, loaded, loadedWidth, loadedHeight));
+  EXPECT_EQ(loaded, blocks);
+  EXPECT_EQ(loadedWidth, width);
+  EXPECT_EQ(loadedHeight, height);
+
+  // made from another atlas
+  std::ofstream(source) << "another atlas";
+  EXPECT_FALSE(
+      loadCompressedAtlas(file, source, loaded, loadedWidth, loadedHeight));
+  std::remove(file.c_str());
+  std::remove(source.c_str());
+
+  EXPECT_EQ(compressedAtlasFilename("atlas/0-color-ptex.rgb"),
+            "atlas/0-color-ptex.bc1");
+}
+
+TEST(TextureCompressionTest, MipChain) {
+  const int width = 8, height = 4;
+  std::vector<uint8_t> rgb(width * height * 3, 128);
+  const CompressedTexture texture =
+      compressBC1MipChain(rgb.data(), width, height);
+  EXPECT_EQ(texture.width, width);
+  EXPECT_EQ(texture.height, height);
+  // 8x4, 4x2, 2x1 and 1x1, one block each but the first
+  ASSERT_EQ(texture.levels.size(), 4);
+  EXPECT_EQ(texture.levels[0].size(), 2 * 8);
+  for (size_t level = 1; level < texture.levels.size(); ++level) {
+    EXPECT_EQ(texture.levels[level].size(), 8);
+    EXPECT_EQ(decompressBC1(texture.levels[level], 1, 1),
+              decompressBC1(texture.levels[0], 1, 1));
+  }
+
+  // textures without levels are kept in place
+  const std::vector<CompressedTexture> textures{texture, {}, texture};
+  const std::string file = "TextureCompressionTest.textures";
+  const std::string source = "TextureCompressionTest.glb";
+  std::ofstream(source) << "scene";
+  ASSERT_TRUE(saveCompressedTextures(file, textures, source));
+  std::vector<CompressedTexture> loaded;
+  ASSERT_TRUE(loadCompressedTextures(file, source, loaded));
+  ASSERT_EQ(loaded.size(), 3);
+  EXPECT_EQ(loaded[0].levels, texture.levels);
+  EXPECT_TRUE(loaded[1].levels.empty());
+  EXPECT_EQ(loaded[2].height, height);
+  std::ofstream(source) << "another scene";
+  EXPECT_FALSE(loadCompressedTextures(file, source, loaded));
+  std::remove(file.c_str());
+  std::remove(source.c_str());
+}
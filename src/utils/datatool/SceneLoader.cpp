@@ -4,8 +4,10 @@
 
 #include "SceneLoader.h"
 
+#include <cmath>
 #include <iostream>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "esp/assets/FRLInstanceMeshData.h"
@@ -16,6 +18,7 @@
 
 #include <sophus/so3.hpp>
 
+#include <assimp/config.h>
 #include <assimp/postprocess.h>
 #include <assimp/scene.h>
 #include <assimp/Importer.hpp>
@@ -23,6 +26,79 @@
 namespace esp {
 namespace assets {
 
+namespace {
+
+// Appends vertices to a mesh, merging each with an earlier one closer than
+// distance, found in a hash grid of cells of that size that keeps the first
+// vertex of each cell
+class VertexWelder {
+ public:
+  VertexWelder(std::vector<vec3f>& vertices, float distance)
+      : vertices_(vertices), distance_(distance) {}
+
+  uint32_t add(const vec3f& position) {
+    if (distance_ <= 0) {
+      vertices_.push_back(position);
+      return vertices_.size() - 1;
+    }
+    const Cell cell = cellOf(position);
+    for (int dx = -1; dx <= 1; ++dx) {
+      for (int dy = -1; dy <= 1; ++dy) {
+        for (int dz = -1; dz <= 1; ++dz) {
+          auto it = grid_.find({cell.x + dx, cell.y + dy, cell.z + dz});
+          if (it != grid_.end() &&
+              (vertices_[it->second] - position).squaredNorm() <=
+                  distance_ * distance_) {
+            return it->second;
+          }
+        }
+      }
+    }
+    const uint32_t index = vertices_.size();
+    vertices_.push_back(position);
+    grid_.emplace(cell, index);
+    return index;
+  }
+
+ private:
+  struct Cell {
+    int64_t x, y, z;
+    bool operator==(const Cell& other) const {
+      return x == other.x && y == other.y && z == other.z;
+    }
+  };
+  struct CellHash {
+    size_t operator()(const Cell& cell) const {
+      return std::hash<int64_t>()(cell.x * 73856093 ^ cell.y * 19349663 ^
+                                  cell.z * 83492791);
+    }
+  };
+
+  Cell cellOf(const vec3f& position) const {
+    return {static_cast<int64_t>(std::floor(position.x() / distance_)),
+            static_cast<int64_t>(std::floor(position.y() / distance_)),
+            static_cast<int64_t>(std::floor(position.z() / distance_))};
+  }
+
+  std::vector<vec3f>& vertices_;
+  const float distance_;
+  std::unordered_map<Cell, uint32_t, CellHash> grid_;
+};
+
+// Appends the triangle (a, b, c) unless welding collapsed it
+void addTriangle(std::vector<uint32_t>& indices,
+                 uint32_t a,
+                 uint32_t b,
+                 uint32_t c) {
+  if (a != b && b != c && c != a) {
+    indices.push_back(a);
+    indices.push_back(b);
+    indices.push_back(c);
+  }
+}
+
+}  // namespace
+
 MeshData SceneLoader::load(const AssetInfo& info) {
   MeshData mesh;
   if (!esp::io::exists(info.filepath)) {
@@ -130,5 +206,90 @@ MeshData SceneLoader::load(const AssetInfo& info) {
   return mesh;
 };
 
+MeshData SceneLoader::loadCollisionMesh(const AssetInfo& info,
+                                        float weldDistance) {
+  MeshData mesh;
+  if (!esp::io::exists(info.filepath)) {
+    LOG(ERROR) << "Could not find file " << info.filepath;
+    return mesh;
+  }
+
+  if (info.type == AssetType::FRL_INSTANCE_MESH ||
+      info.type == AssetType::INSTANCE_MESH) {
+    // instance meshes are small, weld the full load
+    const MeshData full = load(info);
+    VertexWelder welder(mesh.vbo, weldDistance);
+    std::vector<uint32_t> remap(full.vbo.size());
+    for (size_t i = 0; i < full.vbo.size(); ++i) {
+      remap[i] = welder.add(full.vbo[i]);
+    }
+    mesh.ibo.reserve(full.ibo.size());
+    for (size_t i = 0; i + 2 < full.ibo.size(); i += 3) {
+      addTriangle(mesh.ibo, remap[full.ibo[i]], remap[full.ibo[i + 1]],
+                  remap[full.ibo[i + 2]]);
+    }
+  } else {
+    Assimp::Importer importer;
+    // only the positions are kept; points and lines are split into meshes of
+    // their own to be skipped
+    importer.SetPropertyInteger(
+        AI_CONFIG_PP_RVC_FLAGS,
+        aiComponent_NORMALS | aiComponent_TANGENTS_AND_BITANGENTS |
+            aiComponent_COLORS | aiComponent_TEXCOORDS |
+            aiComponent_BONEWEIGHTS | aiComponent_ANIMATIONS |
+            aiComponent_TEXTURES | aiComponent_LIGHTS | aiComponent_CAMERAS |
+            aiComponent_MATERIALS);
+    static const int assimpFlags =
+        aiProcess_RemoveComponent | aiProcess_Triangulate |
+        aiProcess_PreTransformVertices | aiProcess_SortByPType;
+    const aiScene* scene =
+        importer.ReadFile(info.filepath.c_str(), assimpFlags);
+    if (!scene) {
+      LOG(ERROR) << "Could not load " << info.filepath << ": "
+                 << importer.GetErrorString();
+      return mesh;
+    }
+
+    const quatf alignSceneToEspGravity =
+        quatf::FromTwoVectors(info.frame.gravity(), esp::geo::ESP_GRAVITY);
+
+    // allocate once for all meshes, welding only shrinks them
+    size_t numVertices = 0, numFaces = 0;
+    for (uint32_t m = 0; m < scene->mNumMeshes; ++m) {
+      const aiMesh& assimpMesh = *scene->mMeshes[m];
+      if (assimpMesh.mPrimitiveTypes == aiPrimitiveType_TRIANGLE) {
+        numVertices += assimpMesh.mNumVertices;
+        numFaces += assimpMesh.mNumFaces;
+      }
+    }
+    mesh.vbo.reserve(numVertices);
+    mesh.ibo.reserve(3 * numFaces);
+
+    VertexWelder welder(mesh.vbo, weldDistance);
+    std::vector<uint32_t> remap;
+    for (uint32_t m = 0; m < scene->mNumMeshes; ++m) {
+      const aiMesh& assimpMesh = *scene->mMeshes[m];
+      if (assimpMesh.mPrimitiveTypes != aiPrimitiveType_TRIANGLE) {
+        continue;
+      }
+      remap.resize(assimpMesh.mNumVertices);
+      for (uint32_t v = 0; v < assimpMesh.mNumVertices; ++v) {
+        const Eigen::Map<const vec3f> xyz_scene(&assimpMesh.mVertices[v].x);
+        remap[v] = welder.add(alignSceneToEspGravity * xyz_scene);
+      }
+      for (uint32_t f = 0; f < assimpMesh.mNumFaces; ++f) {
+        const aiFace& face = assimpMesh.mFaces[f];
+        addTriangle(mesh.ibo, remap[face.mIndices[0]],
+                    remap[face.mIndices[1]], remap[face.mIndices[2]]);
+      }
+    }
+  }
+
+  LOG(INFO) << "Loaded " << mesh.vbo.size() << " welded vertices, "
+            << mesh.ibo.size() / 3 << " triangles";
+
+  return mesh;
+}
+
 }  // namespace assets
 }  // namespace esp
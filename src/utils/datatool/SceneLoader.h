@@ -16,6 +16,12 @@ namespace assets {
 class SceneLoader {
  public:
   MeshData load(const AssetInfo& info);
+
+  //! Load only the triangles of info, for navmeshes and collision shapes:
+  //! positions and indices, without points, lines and degenerate triangles,
+  //! and with vertices closer than weldDistance merged
+  MeshData loadCollisionMesh(const AssetInfo& info,
+                             float weldDistance = 1e-4f);
 };
 
 }  // namespace assets
@@ -2,17 +2,52 @@
 // This source code is licensed under the MIT license found in the
 // LICENSE file in the root directory of this source tree.
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <fstream>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <set>
 #include <string>
+#include <thread>
 #include <unordered_map>
 
+#include <Corrade/Containers/Optional.h>
+#include <Corrade/PluginManager/Manager.h>
+#include <Magnum/PixelFormat.h>
+#include <Magnum/Trade/AbstractImporter.h>
+#include <Magnum/Trade/ImageData.h>
+#include <Magnum/Trade/MeshData3D.h>
+#include <Magnum/Trade/MeshObjectData3D.h>
+#include <Magnum/Trade/PhongMaterialData.h>
+#include <Magnum/Trade/TextureData.h>
+
 #include "SceneLoader.h"
 
+#include "esp/assets/GenericInstanceMeshData.h"
 #include "esp/assets/Mp3dInstanceMeshData.h"
+#include "esp/assets/TextureAtlas.h"
+#include "esp/assets/TextureCompression.h"
 #include "esp/core/esp.h"
+#include "esp/geo/ConvexDecomposition.h"
+#include "esp/geo/MeshSimplification.h"
+#include "esp/io/cache.h"
+#include "esp/io/io.h"
+#include "esp/io/json.h"
 #include "esp/nav/PathFinder.h"
+#include "esp/scene/RegionVisibility.h"
 #include "esp/scene/SemanticScene.h"
 
+#ifdef ESP_BUILD_PTEX_SUPPORT
+#include <Corrade/Utility/String.h>
+#include "esp/assets/PTexMeshData.h"
+#endif
+
 using namespace esp::assets;
 using namespace esp::scene;
 using namespace esp::nav;
@@ -20,7 +55,7 @@ using namespace esp::nav;
 int createNavMesh(const std::string& meshFile, const std::string& navmeshFile) {
   SceneLoader loader;
   const AssetInfo info = AssetInfo::fromPath(meshFile);
-  const MeshData mesh = loader.load(info);
+  const MeshData mesh = loader.loadCollisionMesh(info);
   NavMeshSettings bs;
   bs.setDefaults();
   PathFinder pf;
@@ -64,25 +99,772 @@ int createMp3dSemanticMesh(const std::string& plyFile,
   return 0;
 }
 
-int main(int argc, char** argv) {
-  if (argc < 4) {
-    std::cout << "Usage: datatool task input_file output_file" << std::endl;
-    return 64;
+int createSceneCache(const std::string& meshFile,
+                     const std::string& cacheFile) {
+  const AssetInfo info = AssetInfo::fromPath(meshFile);
+  if (info.type == AssetType::INSTANCE_MESH) {
+    GenericInstanceMeshData mesh;
+    if (!mesh.loadPLY(meshFile)) {
+      LOG(ERROR) << "Failed parsing instance mesh PLY " << meshFile;
+      return 1;
+    }
+    if (!mesh.saveCache(meshFile, cacheFile)) {
+      return 1;
+    }
+#ifdef ESP_BUILD_PTEX_SUPPORT
+  } else if (info.type == AssetType::FRL_PTEX_MESH) {
+    const std::string atlasFolder =
+        Corrade::Utility::String::stripSuffix(meshFile, "ptex_quad_mesh.ply") +
+        "ptex_textures";
+    PTexMeshData mesh;
+    mesh.load(meshFile, atlasFolder);
+    if (!mesh.saveCache(meshFile, cacheFile)) {
+      return 1;
+    }
+#endif
+  } else {
+    LOG(ERROR) << "No binary cache format for " << meshFile;
+    return 1;
   }
-  const std::string task = argv[1];
-  if (task == "create_navmesh") {
-    createNavMesh(argv[2], argv[3]);
-  } else if (task == "create_mp3d_semantic_mesh") {
-    if (argc < 5) {
+  if (cacheFile != esp::io::cacheFilename(meshFile)) {
+    LOG(WARNING) << "Scenes only pick up caches at "
+                 << esp::io::cacheFilename(meshFile);
+  }
+  return 0;
+}
+
+int createCollisionHulls(const std::string& objectConfigFile,
+                         const std::string& hullsFile) {
+  esp::io::JsonDocument config;
+  try {
+    config = esp::io::parseJsonFile(objectConfigFile);
+  } catch (...) {
+    LOG(ERROR) << "Failed to parse JSON: " << objectConfigFile;
+    return 1;
+  }
+  // same mesh, relative to the config, as ResourceManager::loadObject() uses
+  // for collisions
+  std::string meshFile;
+  for (const char* key : {"collision mesh", "render mesh"}) {
+    if (config.HasMember(key) && config[key].IsString()) {
+      meshFile = objectConfigFile.substr(0, objectConfigFile.find_last_of("/"))
+                     .append("/")
+                     .append(config[key].GetString());
+      break;
+    }
+  }
+  if (meshFile.empty() || !esp::io::exists(meshFile)) {
+    LOG(ERROR) << "No collision mesh for " << objectConfigFile;
+    return 1;
+  }
+
+  SceneLoader loader;
+  const MeshData mesh =
+      loader.loadCollisionMesh(AssetInfo::fromPath(meshFile));
+  const std::vector<esp::geo::ConvexHull> hulls =
+      esp::geo::convexDecomposition(mesh.vbo, mesh.ibo);
+  if (hulls.empty()) {
+    LOG(ERROR) << "Failed to decompose " << meshFile;
+    return 2;
+  }
+  if (!esp::geo::saveConvexHulls(hullsFile, hulls, meshFile)) {
+    LOG(ERROR) << "Failed to save collision hulls";
+    return 3;
+  }
+  LOG(INFO) << "Decomposed " << meshFile << " into " << hulls.size()
+            << " convex hulls";
+  if (hullsFile != esp::geo::convexHullsFilename(objectConfigFile)) {
+    LOG(WARNING) << "Objects only pick up collision hulls at "
+                 << esp::geo::convexHullsFilename(objectConfigFile);
+  }
+  return 0;
+}
+
+int createCompressedAtlases(const std::string& atlasFolder,
+                            const std::string& outputFolder) {
+  int numAtlases = 0;
+  for (;; ++numAtlases) {
+    const std::string name = std::to_string(numAtlases) + "-color-ptex.rgb";
+    const std::string rgbFile = atlasFolder + "/" + name;
+    if (!esp::io::exists(rgbFile)) {
+      break;
+    }
+    const esp::io::MappedFile atlas(rgbFile);
+    const int dim = static_cast<int>(std::sqrt(atlas.size() / 3));  // square
+    if (!atlas.isValid() || size_t(dim) * dim * 3 != atlas.size()) {
+      LOG(ERROR) << "Not a square RGB atlas: " << rgbFile;
+      return 2;
+    }
+    const std::vector<uint8_t> blocks = compressBC1(
+        reinterpret_cast<const uint8_t*>(atlas.data()), dim, dim);
+    const std::string outputFile =
+        compressedAtlasFilename(outputFolder + "/" + name);
+    if (!saveCompressedAtlas(outputFile, blocks, dim, dim, rgbFile)) {
+      LOG(ERROR) << "Failed to save " << outputFile;
+      return 3;
+    }
+  }
+  if (numAtlases == 0) {
+    LOG(ERROR) << "No PTex atlases in " << atlasFolder;
+    return 1;
+  }
+  LOG(INFO) << "Compressed " << numAtlases << " atlases";
+  if (esp::io::absolutePath(outputFolder) !=
+      esp::io::absolutePath(atlasFolder)) {
+    LOG(WARNING) << "Scenes only pick up compressed atlases in "
+                 << atlasFolder;
+  }
+  return 0;
+}
+
+int createCompressedTextures(const std::string& sceneFile,
+                             const std::string& texturesFile) {
+  Corrade::PluginManager::Manager<Magnum::Trade::AbstractImporter> manager;
+  std::unique_ptr<Magnum::Trade::AbstractImporter> importer =
+      manager.loadAndInstantiate("AnySceneImporter");
+  manager.setPreferredPlugins("GltfImporter", {"TinyGltfImporter"});
+  if (!importer || !importer->openFile(sceneFile)) {
+    LOG(ERROR) << "Cannot open " << sceneFile;
+    return 1;
+  }
+
+  // same images as ResourceManager::loadTextures() uploads, in the same order
+  std::vector<CompressedTexture> textures(importer->textureCount());
+  int numCompressed = 0;
+  for (int iTexture = 0; iTexture < textures.size(); ++iTexture) {
+    Corrade::Containers::Optional<Magnum::Trade::TextureData> textureData =
+        importer->texture(iTexture);
+    if (!textureData ||
+        textureData->type() != Magnum::Trade::TextureData::Type::Texture2D) {
+      continue;
+    }
+    Corrade::Containers::Optional<Magnum::Trade::ImageData2D> image =
+        importer->image2D(textureData->image());
+    int components = 0;
+    if (image && image->format() == Magnum::PixelFormat::RGB8Unorm) {
+      components = 3;
+    } else if (image && image->format() == Magnum::PixelFormat::RGBA8Unorm) {
+      components = 4;
+    } else {
+      LOG(WARNING) << "Texture " << iTexture << " is not RGB8 or RGBA8, "
+                   << "leaving it uncompressed";
+      continue;
+    }
+
+    // BC1 has no (smooth) alpha, so the alpha channel is dropped; rows of the
+    // image may be padded
+    const Magnum::Vector2i size = image->size();
+    const size_t rowStride = image->dataProperties().second.x();
+    const char* data = image->data() + image->dataProperties().first.sum();
+    std::vector<uint8_t> rgb(size_t(size.product()) * 3);
+    for (int y = 0; y < size.y(); ++y) {
+      for (int x = 0; x < size.x(); ++x) {
+        for (int k = 0; k < 3; ++k) {
+          rgb[3 * (size_t(y) * size.x() + x) + k] =
+              data[y * rowStride + x * components + k];
+        }
+      }
+    }
+    textures[iTexture] = compressBC1MipChain(rgb.data(), size.x(), size.y());
+    ++numCompressed;
+  }
+
+  if (!saveCompressedTextures(texturesFile, textures, sceneFile)) {
+    LOG(ERROR) << "Failed to save " << texturesFile;
+    return 3;
+  }
+  LOG(INFO) << "Compressed " << numCompressed << " of " << textures.size()
+            << " textures";
+  if (texturesFile != compressedTexturesFilename(sceneFile)) {
+    LOG(WARNING) << "Scenes only pick up compressed textures at "
+                 << compressedTexturesFilename(sceneFile);
+  }
+  return 0;
+}
+
+// Packs the textures of an object with many small textures, e.g. of an object
+// library or a SUNCG model, into one atlas that its meshes are remapped into
+int createTextureAtlas(const std::string& sceneFile,
+                       const std::string& atlasFile) {
+  Corrade::PluginManager::Manager<Magnum::Trade::AbstractImporter> manager;
+  std::unique_ptr<Magnum::Trade::AbstractImporter> importer =
+      manager.loadAndInstantiate("AnySceneImporter");
+  manager.setPreferredPlugins("GltfImporter", {"TinyGltfImporter"});
+  if (!importer || !importer->openFile(sceneFile)) {
+    LOG(ERROR) << "Cannot open " << sceneFile;
+    return 1;
+  }
+
+  // larger textures gain little from sharing a bind with others
+  const int maxPackedSize = 1024;
+  const int maxAtlasSize = 4096;
+  // texture coordinates this far outside [0, 1] still fall in the padding
+  const float maxOverhang = 1e-3f;
+
+  // diffuse textures each mesh is drawn with, -1 for none, the way
+  // ResourceManager::addMeshToDrawables() picks them
+  const int numMeshes = importer->mesh3DCount();
+  const int numTextures = importer->textureCount();
+  std::vector<std::set<int>> meshTextures(numMeshes);
+  for (Magnum::UnsignedInt i = 0; i < importer->object3DCount(); ++i) {
+    std::unique_ptr<Magnum::Trade::ObjectData3D> object =
+        importer->object3D(i);
+    if (!object ||
+        object->instanceType() != Magnum::Trade::ObjectInstanceType3D::Mesh ||
+        object->instance() < 0 || object->instance() >= numMeshes) {
+      continue;
+    }
+    const int material =
+        static_cast<Magnum::Trade::MeshObjectData3D*>(object.get())
+            ->material();
+    int texture = -1;
+    std::unique_ptr<Magnum::Trade::AbstractMaterialData> materialData;
+    if (material >= 0) {
+      materialData = importer->material(material);
+    }
+    if (materialData &&
+        materialData->type() == Magnum::Trade::MaterialType::Phong) {
+      const auto& phong =
+          static_cast<const Magnum::Trade::PhongMaterialData&>(*materialData);
+      if (phong.flags() &
+          Magnum::Trade::PhongMaterialData::Flag::DiffuseTexture) {
+        texture = phong.diffuseTexture();
+      }
+    }
+    meshTextures[object->instance()].insert(texture);
+  }
+
+  // a texture is packed if every mesh drawn with it is drawn with it alone
+  // and samples it within [0, 1]
+  std::vector<bool> packable(numTextures, true);
+  std::vector<bool> remappable(numMeshes, false);
+  for (int iMesh = 0; iMesh < numMeshes; ++iMesh) {
+    const std::set<int>& textures = meshTextures[iMesh];
+    bool inRange = false;
+    if (textures.size() == 1 && *textures.begin() >= 0) {
+      Corrade::Containers::Optional<Magnum::Trade::MeshData3D> meshData =
+          importer->mesh3D(iMesh);
+      inRange = meshData && meshData->hasTextureCoords2D();
+      for (size_t i = 0; inRange && i < meshData->textureCoords2D(0).size();
+           ++i) {
+        const Magnum::Vector2& uv = meshData->textureCoords2D(0)[i];
+        inRange = uv.min() >= -maxOverhang && uv.max() <= 1.0f + maxOverhang;
+      }
+    }
+    remappable[iMesh] = inRange;
+    for (int texture : textures) {
+      if (texture >= 0 && texture < numTextures && !inRange) {
+        packable[texture] = false;
+      }
+    }
+  }
+
+  // the same images as ResourceManager::loadTextures() uploads, rows
+  // without padding
+  TextureAtlas atlas;
+  atlas.channels = 3;
+  std::vector<std::vector<uint8_t>> images(numTextures);
+  std::vector<int> components(numTextures, 0);
+  std::vector<Magnum::Vector2i> sizes(numTextures);
+  std::vector<int> candidates;
+  for (int iTexture = 0; iTexture < numTextures; ++iTexture) {
+    Corrade::Containers::Optional<Magnum::Trade::TextureData> textureData =
+        importer->texture(iTexture);
+    if (!packable[iTexture] || !textureData ||
+        textureData->type() != Magnum::Trade::TextureData::Type::Texture2D) {
+      continue;
+    }
+    Corrade::Containers::Optional<Magnum::Trade::ImageData2D> image =
+        importer->image2D(textureData->image());
+    if (image && image->format() == Magnum::PixelFormat::RGB8Unorm) {
+      components[iTexture] = 3;
+    } else if (image && image->format() == Magnum::PixelFormat::RGBA8Unorm) {
+      components[iTexture] = 4;
+    } else {
+      continue;
+    }
+    sizes[iTexture] = image->size();
+    if (sizes[iTexture].max() > maxPackedSize) {
+      continue;
+    }
+    const size_t rowStride = image->dataProperties().second.x();
+    const size_t rowBytes = size_t(sizes[iTexture].x()) * components[iTexture];
+    const char* data = image->data() + image->dataProperties().first.sum();
+    for (int y = 0; y < sizes[iTexture].y(); ++y) {
+      images[iTexture].insert(images[iTexture].end(), data + y * rowStride,
+                              data + y * rowStride + rowBytes);
+    }
+    candidates.push_back(iTexture);
+  }
+
+  // leave out the largest textures until the rest fit
+  std::sort(candidates.begin(), candidates.end(), [&](int a, int b) {
+    return sizes[a].product() < sizes[b].product();
+  });
+  std::vector<AtlasPlacement> placements;
+  Magnum::Vector2i atlasSize;
+  while (candidates.size() >= 2) {
+    std::vector<Magnum::Vector2i> candidateSizes;
+    for (int texture : candidates) {
+      candidateSizes.push_back(sizes[texture]);
+    }
+    if (packTextureAtlas(candidateSizes, maxAtlasSize,
+                                      placements, atlasSize)) {
+      break;
+    }
+    candidates.pop_back();
+  }
+  if (candidates.size() < 2) {
+    // an atlas of a single texture saves no binds
+    candidates.clear();
+    placements.clear();
+    atlasSize = {textureAtlasPadding, textureAtlasPadding};
+  }
+
+  atlas.width = atlasSize.x();
+  atlas.height = atlasSize.y();
+  for (int texture : candidates) {
+    if (components[texture] == 4) {
+      atlas.channels = 4;
+    }
+  }
+  atlas.pixels.assign(size_t(atlas.width) * atlas.height * atlas.channels, 0);
+  atlas.placements.resize(numTextures);
+  for (size_t i = 0; i < candidates.size(); ++i) {
+    atlas.placements[candidates[i]] = placements[i];
+    copyIntoTextureAtlas(atlas, placements[i],
+                                      images[candidates[i]].data(),
+                                      components[candidates[i]]);
+  }
+  for (int iMesh = 0; iMesh < numMeshes; ++iMesh) {
+    const int texture =
+        remappable[iMesh] ? *meshTextures[iMesh].begin() : -1;
+    atlas.meshTextures.push_back(
+        texture >= 0 && atlas.placements[texture].isPacked() ? texture : -1);
+  }
+
+  if (!saveTextureAtlas(atlasFile, atlas, sceneFile)) {
+    LOG(ERROR) << "Failed to save " << atlasFile;
+    return 3;
+  }
+  LOG(INFO) << "Packed " << candidates.size() << " of " << numTextures
+            << " textures into a " << atlas.width << "x" << atlas.height
+            << " atlas";
+  if (atlasFile != textureAtlasFilename(sceneFile)) {
+    LOG(WARNING) << "Scenes only pick up texture atlases at "
+                 << textureAtlasFilename(sceneFile);
+  }
+  return 0;
+}
+
+int createMeshLODs(const std::string& sceneFile, const std::string& lodsFile) {
+  Corrade::PluginManager::Manager<Magnum::Trade::AbstractImporter> manager;
+  std::unique_ptr<Magnum::Trade::AbstractImporter> importer =
+      manager.loadAndInstantiate("AnySceneImporter");
+  manager.setPreferredPlugins("GltfImporter", {"TinyGltfImporter"});
+  if (!importer || !importer->openFile(sceneFile)) {
+    LOG(ERROR) << "Cannot open " << sceneFile;
+    return 1;
+  }
+
+  // three levels per mesh, same meshes as ResourceManager::loadMeshes() loads
+  const std::vector<float> triangleRatios = {0.5f, 0.2f, 0.05f};
+  std::vector<std::vector<esp::geo::MeshLOD>> meshLODs(
+      importer->mesh3DCount());
+  size_t numTriangles = 0, numLODTriangles = 0;
+  for (int iMesh = 0; iMesh < meshLODs.size(); ++iMesh) {
+    Corrade::Containers::Optional<Magnum::Trade::MeshData3D> meshData =
+        importer->mesh3D(iMesh);
+    if (!meshData || !meshData->isIndexed() ||
+        meshData->primitive() != Magnum::MeshPrimitive::Triangles) {
+      LOG(WARNING) << "Mesh " << iMesh << " is not an indexed triangle mesh, "
+                   << "leaving it without levels of detail";
+      continue;
+    }
+    std::vector<esp::vec3f> positions;
+    for (const Magnum::Vector3& position : meshData->positions(0)) {
+      positions.emplace_back(position.x(), position.y(), position.z());
+    }
+    const std::vector<uint32_t> indices(meshData->indices().begin(),
+                                        meshData->indices().end());
+    numTriangles += indices.size() / 3;
+    for (float ratio : triangleRatios) {
+      esp::geo::MeshLOD lod = esp::geo::simplifyMesh(positions, indices, ratio);
+      // stop before levels collapse to nothing
+      if (lod.indices.empty()) {
+        break;
+      }
+      numLODTriangles += lod.indices.size() / 3;
+      meshLODs[iMesh].push_back(std::move(lod));
+    }
+  }
+
+  if (!esp::geo::saveMeshLODs(lodsFile, meshLODs, sceneFile)) {
+    LOG(ERROR) << "Failed to save " << lodsFile;
+    return 3;
+  }
+  LOG(INFO) << "Simplified " << meshLODs.size() << " meshes of "
+            << numTriangles << " triangles into levels of detail of "
+            << numLODTriangles << " triangles";
+  if (lodsFile != esp::geo::meshLODsFilename(sceneFile)) {
+    LOG(WARNING) << "Scenes only pick up levels of detail at "
+                 << esp::geo::meshLODsFilename(sceneFile);
+  }
+  return 0;
+}
+
+// Simplifies the meshes of a scene into the static collision meshes the
+// scene collider loads instead of the render meshes
+int createCollisionMesh(const std::string& sceneFile,
+                        const std::string& collisionFile) {
+  Corrade::PluginManager::Manager<Magnum::Trade::AbstractImporter> manager;
+  std::unique_ptr<Magnum::Trade::AbstractImporter> importer =
+      manager.loadAndInstantiate("AnySceneImporter");
+  manager.setPreferredPlugins("GltfImporter", {"TinyGltfImporter"});
+  if (!importer || !importer->openFile(sceneFile)) {
+    LOG(ERROR) << "Cannot open " << sceneFile;
+    return 1;
+  }
+
+  // largest distance in meters a collision surface moves from the render
+  // surface, well below the radius of an agent
+  const float maxError = 0.05f;
+  std::vector<esp::geo::CollisionMesh> collisionMeshes(
+      importer->mesh3DCount());
+  size_t numTriangles = 0, numCollisionTriangles = 0;
+  for (int iMesh = 0; iMesh < collisionMeshes.size(); ++iMesh) {
+    Corrade::Containers::Optional<Magnum::Trade::MeshData3D> meshData =
+        importer->mesh3D(iMesh);
+    if (!meshData || !meshData->isIndexed() ||
+        meshData->primitive() != Magnum::MeshPrimitive::Triangles) {
+      LOG(WARNING) << "Mesh " << iMesh << " is not an indexed triangle mesh, "
+                   << "leaving it without a collision mesh";
+      continue;
+    }
+    std::vector<esp::vec3f> positions;
+    for (const Magnum::Vector3& position : meshData->positions(0)) {
+      positions.emplace_back(position.x(), position.y(), position.z());
+    }
+    const std::vector<uint32_t> indices(meshData->indices().begin(),
+                                        meshData->indices().end());
+    numTriangles += indices.size() / 3;
+    collisionMeshes[iMesh] =
+        esp::geo::simplifyCollisionMesh(positions, indices, maxError);
+    numCollisionTriangles += collisionMeshes[iMesh].indices.size() / 3;
+  }
+
+  if (!esp::geo::saveCollisionMeshes(collisionFile, collisionMeshes,
+                                     sceneFile)) {
+    LOG(ERROR) << "Failed to save " << collisionFile;
+    return 3;
+  }
+  LOG(INFO) << "Simplified " << collisionMeshes.size() << " meshes of "
+            << numTriangles << " triangles into collision meshes of "
+            << numCollisionTriangles << " triangles";
+  if (collisionFile != esp::geo::collisionMeshesFilename(sceneFile)) {
+    LOG(WARNING) << "Scenes only pick up collision meshes at "
+                 << esp::geo::collisionMeshesFilename(sceneFile);
+  }
+  return 0;
+}
+
+// Samples which regions of a house see each other through the scene mesh,
+// for the renderer to skip the regions not visible from the camera
+int createRegionVisibility(const std::string& houseFile,
+                           const std::string& meshFile,
+                           const std::string& visibilityFile) {
+  // regions the way the simulator loads them, in the frame of the mesh
+  SemanticScene semanticScene;
+  if (!SemanticScene::loadMp3dHouse(houseFile, semanticScene)) {
+    LOG(ERROR) << "Failed loading MP3D house file " << houseFile;
+    return 1;
+  }
+  const std::vector<esp::box3f> regionBoxes =
+      RegionVisibility::regionBoxes(semanticScene);
+  if (regionBoxes.empty()) {
+    LOG(ERROR) << "No regions in " << houseFile;
+    return 1;
+  }
+  SceneLoader loader;
+  const MeshData mesh =
+      loader.loadCollisionMesh(AssetInfo::fromPath(meshFile));
+  if (mesh.ibo.empty()) {
+    LOG(ERROR) << "Failed loading mesh " << meshFile;
+    return 1;
+  }
+
+  const RegionVisibility::ptr visibility =
+      RegionVisibility::compute(regionBoxes, mesh.vbo, mesh.ibo);
+  if (!visibility->save(visibilityFile, houseFile)) {
+    LOG(ERROR) << "Failed to save " << visibilityFile;
+    return 3;
+  }
+  size_t numVisible = 0;
+  for (int i = 0; i < visibility->getNumRegions(); ++i) {
+    numVisible += visibility->visibleRegions(i).size();
+  }
+  LOG(INFO) << "Each of " << regionBoxes.size() << " regions sees "
+            << float(numVisible) / regionBoxes.size() << " on average";
+  if (visibilityFile != regionVisibilityFilename(houseFile)) {
+    LOG(WARNING) << "Scenes only pick up region visibility at "
+                 << regionVisibilityFilename(houseFile);
+  }
+  return 0;
+}
+
+// Runs the task args[0] on the remaining args, 64 for bad arguments
+int runTask(const std::vector<std::string>& args) {
+  const std::string& task = args[0];
+  const size_t numArgs = task == "create_mp3d_semantic_mesh" ||
+                                 task == "create_region_visibility"
+                             ? 4
+                             : 3;
+  if (args.size() < numArgs) {
+    if (task == "create_mp3d_semantic_mesh") {
       std::cout << "Usage: datatool create_mp3d_semantic_mesh input_ply "
                    "input_house output_mesh"
                 << std::endl;
+    } else if (task == "create_region_visibility") {
+      std::cout << "Usage: datatool create_region_visibility input_house "
+                   "input_mesh output_file"
+                << std::endl;
+    } else {
+      std::cout << "Usage: datatool task input_file output_file" << std::endl;
+    }
+    return 64;
+  }
+  if (task == "create_navmesh") {
+    return createNavMesh(args[1], args[2]);
+  } else if (task == "create_mp3d_semantic_mesh") {
+    return createMp3dSemanticMesh(args[1], args[2], args[3]);
+  } else if (task == "create_scene_cache") {
+    return createSceneCache(args[1], args[2]);
+  } else if (task == "create_collision_hulls") {
+    return createCollisionHulls(args[1], args[2]);
+  } else if (task == "create_compressed_atlases") {
+    return createCompressedAtlases(args[1], args[2]);
+  } else if (task == "create_compressed_textures") {
+    return createCompressedTextures(args[1], args[2]);
+  } else if (task == "create_texture_atlas") {
+    return createTextureAtlas(args[1], args[2]);
+  } else if (task == "create_mesh_lods") {
+    return createMeshLODs(args[1], args[2]);
+  } else if (task == "create_collision_mesh") {
+    return createCollisionMesh(args[1], args[2]);
+  } else if (task == "create_region_visibility") {
+    return createRegionVisibility(args[1], args[2], args[3]);
+  }
+  LOG(ERROR) << "Unrecognized task " << task;
+  return 1;
+}
+
+// A task of a batch manifest, the arguments of a datatool invocation
+struct BatchJob {
+  std::vector<std::string> args;
+  // bytes of the input files, hashed to tell whether the output is up to date
+  std::vector<std::string> inputs;
+  size_t inputSize = 0;
+
+  const std::string& output() const { return args.back(); }
+  // the hash of the inputs of the last successful run is kept next to the
+  // output
+  std::string stampFile() const { return output() + ".stamp"; }
+};
+
+// Files the task of job reads
+std::vector<std::string> batchJobInputs(const BatchJob& job) {
+  const std::vector<std::string>& args = job.args;
+  if (args[0] == "create_compressed_atlases") {
+    std::vector<std::string> atlases;
+    for (int i = 0;; ++i) {
+      const std::string rgbFile =
+          args[1] + "/" + std::to_string(i) + "-color-ptex.rgb";
+      if (!esp::io::exists(rgbFile)) {
+        return atlases;
+      }
+      atlases.push_back(rgbFile);
+    }
+  }
+  return std::vector<std::string>(args.begin() + 1, args.end() - 1);
+}
+
+// CRC-32 of the arguments and the contents of the inputs of job
+std::string batchJobHash(const BatchJob& job) {
+  uint32_t crc = 0;
+  for (const std::string& arg : job.args) {
+    crc = esp::io::crc32(arg.c_str(), arg.size() + 1, crc);
+  }
+  for (const std::string& input : job.inputs) {
+    const esp::io::MappedFile file(input);
+    if (file.isValid()) {
+      crc = esp::io::crc32(file.data(), file.size(), crc);
+    }
+  }
+  char hex[9];
+  std::snprintf(hex, sizeof(hex), "%08x", crc);
+  return hex;
+}
+
+// Bytes of input that may be loaded at the same time. A job larger than the
+// whole budget waits until it can run alone
+class MemoryBudget {
+ public:
+  explicit MemoryBudget(size_t bytes) : total_(bytes), available_(bytes) {}
+
+  size_t acquire(size_t bytes) {
+    bytes = std::min(bytes, total_);
+    std::unique_lock<std::mutex> lock(mutex_);
+    released_.wait(lock, [&]() { return available_ >= bytes; });
+    available_ -= bytes;
+    return bytes;
+  }
+
+  void release(size_t bytes) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      available_ += bytes;
+    }
+    released_.notify_all();
+  }
+
+ private:
+  const size_t total_;
+  size_t available_;
+  std::mutex mutex_;
+  std::condition_variable released_;
+};
+
+// Runs the tasks listed in manifestFile, one per line with the arguments of
+// a datatool invocation, e.g. "create_navmesh scene.glb scene.navmesh".
+// Blank lines and lines starting with # are ignored. Tasks run on numThreads
+// threads, with at most maxMemoryMB megabytes of input files loaded at once.
+// Tasks whose output exists and whose inputs hash to the stamp of their last
+// successful run are skipped. A table of the status and time of each task is
+// written to summaryFile
+int runBatch(const std::string& manifestFile,
+             const std::string& summaryFile,
+             int numThreads,
+             size_t maxMemoryMB) {
+  std::ifstream manifest(manifestFile);
+  if (!manifest.good()) {
+    LOG(ERROR) << "Cannot open manifest " << manifestFile;
+    return 1;
+  }
+  std::vector<BatchJob> jobs;
+  std::string line;
+  for (int lineNumber = 1; std::getline(manifest, line); ++lineNumber) {
+    BatchJob job;
+    for (const std::string& token : esp::io::tokenize(line, " \t", 0, true)) {
+      if (!token.empty()) {
+        job.args.push_back(token);
+      }
+    }
+    if (job.args.empty() || job.args[0][0] == '#') {
+      continue;
+    }
+    if (job.args[0] == "batch" || job.args.size() < 3) {
+      LOG(ERROR) << manifestFile << ":" << lineNumber << ": invalid task "
+                 << line;
       return 64;
     }
-    createMp3dSemanticMesh(argv[2], argv[3], argv[4]);
+    job.inputs = batchJobInputs(job);
+    for (const std::string& input : job.inputs) {
+      if (esp::io::exists(input)) {
+        job.inputSize += esp::io::fileSize(input);
+      }
+    }
+    jobs.push_back(std::move(job));
+  }
+
+  if (numThreads <= 0) {
+    numThreads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  numThreads = std::min<int>(numThreads, std::max<size_t>(jobs.size(), 1));
+  MemoryBudget budget(maxMemoryMB << 20);
+
+  typedef std::chrono::steady_clock Clock;
+  enum class Status { Done, Skipped, Failed };
+  std::vector<Status> statuses(jobs.size());
+  std::vector<double> times(jobs.size(), 0.0);
+  std::atomic<size_t> next{0};
+  auto worker = [&]() {
+    for (size_t i = next++; i < jobs.size(); i = next++) {
+      const BatchJob& job = jobs[i];
+      const size_t reserved = budget.acquire(job.inputSize);
+      const Clock::time_point start = Clock::now();
+      const std::string hash = batchJobHash(job);
+      std::string stamp;
+      std::ifstream(job.stampFile()) >> stamp;
+      if (stamp == hash && esp::io::exists(job.output())) {
+        statuses[i] = Status::Skipped;
+      } else if (runTask(job.args) == 0) {
+        std::ofstream(job.stampFile()) << hash << std::endl;
+        statuses[i] = Status::Done;
+      } else {
+        std::remove(job.stampFile().c_str());
+        statuses[i] = Status::Failed;
+      }
+      times[i] = std::chrono::duration<double>(Clock::now() - start).count();
+      budget.release(reserved);
+    }
+  };
+  const Clock::time_point start = Clock::now();
+  std::vector<std::thread> threads;
+  for (int i = 1; i < numThreads; ++i) {
+    threads.emplace_back(worker);
+  }
+  worker();
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  const double wallTime =
+      std::chrono::duration<double>(Clock::now() - start).count();
+
+  std::ofstream summary(summaryFile);
+  summary << "status\tseconds\ttask\toutput\n";
+  int counts[3] = {0, 0, 0};
+  double taskTime = 0.0;
+  for (size_t i = 0; i < jobs.size(); ++i) {
+    static const char* names[] = {"done", "skipped", "failed"};
+    const int status = static_cast<int>(statuses[i]);
+    ++counts[status];
+    taskTime += times[i];
+    summary << names[status] << "\t" << times[i] << "\t" << jobs[i].args[0]
+            << "\t" << jobs[i].output() << "\n";
+    if (statuses[i] == Status::Failed) {
+      LOG(ERROR) << "Failed: " << jobs[i].args[0] << " " << jobs[i].output();
+    }
+  }
+  if (!summary.good()) {
+    LOG(ERROR) << "Failed to write summary " << summaryFile;
+  }
+  LOG(INFO) << jobs.size() << " tasks on " << numThreads << " threads: "
+            << counts[0] << " done, " << counts[1] << " up to date, "
+            << counts[2] << " failed in " << wallTime << " s (" << taskTime
+            << " s of tasks)";
+  return counts[2] > 0 ? 2 : 0;
+}
+
+int main(int argc, char** argv) {
+  if (argc < 4) {
+    std::cout << "Usage: datatool task input_file output_file\n"
+                 "       datatool batch manifest summary_file [num_threads] "
+                 "[max_memory_mb]"
+              << std::endl;
+    return 64;
+  }
+  const std::string task = argv[1];
+  int result = 0;
+  if (task == "batch") {
+    // 0 threads uses all cores
+    const int numThreads = argc > 4 ? std::atoi(argv[4]) : 0;
+    const size_t maxMemoryMB = argc > 5 ? std::atol(argv[5]) : 8192;
+    result = runBatch(argv[2], argv[3], numThreads, maxMemoryMB);
   } else {
-    LOG(ERROR) << "Unrecognized task " << task;
-    return 1;
+    result = runTask(std::vector<std::string>(argv + 1, argv + argc));
+  }
+  if (result != 0) {
+    return result;
   }
 
   LOG(INFO) << "task: \"" << task << "\" done";
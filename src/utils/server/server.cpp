@@ -0,0 +1,128 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+// Serves environments of a scene to clients in other processes through
+// shared memory, see esp::sim::SimulatorServer and the SimulatorClient of the
+// Python bindings. Runs until the clients stop every environment or it is
+// interrupted.
+
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <Corrade/Utility/Arguments.h>
+#include <Corrade/Utility/String.h>
+
+#include "esp/agent/Agent.h"
+#include "esp/core/esp.h"
+#include "esp/sim/SimulatorServer.h"
+
+namespace Cr = Corrade;
+
+using namespace esp;
+
+namespace {
+
+std::atomic<bool> interrupted{false};
+
+void onSignal(int) {
+  interrupted = true;
+}
+
+bool parseSensorType(const std::string& name, sensor::SensorType& type) {
+  const std::map<std::string, sensor::SensorType> types = {
+      {"color", sensor::SensorType::COLOR},
+      {"depth", sensor::SensorType::DEPTH},
+      {"semantic", sensor::SensorType::SEMANTIC}};
+  auto it = types.find(name);
+  if (it == types.end()) {
+    LOG(ERROR) << "Unknown sensor type " << name
+               << ", expected color, depth or semantic";
+    return false;
+  }
+  type = it->second;
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Cr::Utility::Arguments args;
+  args.addArgument("name")
+      .setHelp("name", "name of the server, which clients connect to")
+      .addArgument("scene")
+      .setHelp("scene", "scene file to load")
+      .addOption("envs", "1")
+      .setHelp("envs", "environments to serve, each on a thread of its own")
+      .addOption("agents", "1")
+      .setHelp("agents", "agents per environment")
+      .addOption("sensors", "color")
+      .setHelp("sensors", "comma-separated sensor types of each agent")
+      .addOption("resolution", "256")
+      .setHelp("resolution", "square resolution of the sensors")
+      .addOption("frames", "2")
+      .setHelp("frames", "observation frames per environment")
+      .addOption("gpu-device", "0")
+      .setHelp("gpu-device", "CUDA device to render on, -1 picks one")
+      .addOption("seed", "0")
+      .addBooleanOption("enable-physics")
+      .addOption("physics-config", "./data/default.phys_scene_config.json")
+      .setHelp("physics-config", "physics scene config file")
+      .addOption("shared-cache-dir", "")
+      .setHelp("shared-cache-dir",
+               "directory to share decoded assets in with other processes")
+      .setGlobalHelp(
+          "Serves simulator environments to other processes through shared "
+          "memory")
+      .parse(argc, argv);
+
+  gfx::SimulatorConfiguration cfg;
+  cfg.scene.id = args.value("scene");
+  cfg.gpuDeviceId = args.value<int>("gpu-device");
+  cfg.enablePhysics = args.isSet("enable-physics");
+  cfg.physicsConfigFile = args.value("physics-config");
+  cfg.sharedCacheDir = args.value("shared-cache-dir");
+  const int resolution = args.value<int>("resolution");
+  cfg.width = resolution;
+  cfg.height = resolution;
+
+  agent::AgentConfiguration agentConfig;
+  agentConfig.sensorSpecifications.clear();
+  for (const std::string& sensorName :
+       Cr::Utility::String::splitWithoutEmptyParts(args.value("sensors"),
+                                                   ',')) {
+    auto spec = sensor::SensorSpec::create();
+    if (!parseSensorType(sensorName, spec->sensorType)) {
+      return 1;
+    }
+    spec->uuid = sensorName;
+    spec->resolution = {resolution, resolution};
+    spec->channels = spec->sensorType == sensor::SensorType::COLOR ? 4 : 1;
+    agentConfig.sensorSpecifications.push_back(spec);
+  }
+  const std::vector<agent::AgentConfiguration> agentConfigs(
+      args.value<int>("agents"), agentConfig);
+
+  sim::SimulatorServer server{args.value("name"),
+                              args.value<int>("envs"),
+                              cfg,
+                              agentConfigs,
+                              args.value<uint32_t>("frames"),
+                              args.value<uint32_t>("seed")};
+  if (!server.start()) {
+    return 1;
+  }
+  std::signal(SIGINT, onSignal);
+  std::signal(SIGTERM, onSignal);
+  while (!interrupted && server.getNumServing() > 0) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  }
+  server.stop();
+  server.wait();
+  return 0;
+}
@@ -117,3 +117,77 @@ def test_greedy_follower(test_navmesh, scene_graph, pbar):
 
     if test_all:
         pbar.update()
+
+
+@pytest.mark.parametrize("test_navmesh", test_navmeshes)
+def test_greedy_follower_states(test_navmesh, scene_graph):
+    if not osp.exists(test_navmesh):
+        pytest.skip(f"{test_navmesh} not found")
+
+    pathfinder = hsim.PathFinder()
+    pathfinder.load_nav_mesh(test_navmesh)
+    assert pathfinder.is_loaded
+    pathfinder.seed(0)
+
+    agent = habitat_sim.Agent(scene_graph.get_root_node().create_child())
+    agent.controls.move_filter_fn = pathfinder.try_step
+    follower = habitat_sim.GreedyGeodesicFollower(pathfinder, agent)
+
+    for _ in range(10):
+        state = agent.state
+        state.position = pathfinder.get_random_navigable_point()
+        goal_pos = pathfinder.get_random_navigable_point()
+        agent.state = state
+
+        try:
+            expected = follower.find_path(goal_pos)
+        except habitat_sim.errors.GreedyFollowerError:
+            continue
+        actions, positions, rotations = follower.find_path_with_states(goal_pos)
+        assert actions == expected
+        assert positions.shape == (len(actions), 3)
+        assert rotations.shape == (len(actions), 4)
+        assert np.allclose(positions[0], state.position)
+
+
+@pytest.mark.parametrize("test_navmesh", test_navmeshes)
+def test_optimal_follower(test_navmesh, scene_graph):
+    if not osp.exists(test_navmesh):
+        pytest.skip(f"{test_navmesh} not found")
+
+    pathfinder = hsim.PathFinder()
+    pathfinder.load_nav_mesh(test_navmesh)
+    assert pathfinder.is_loaded
+    pathfinder.seed(0)
+
+    agent = habitat_sim.Agent(scene_graph.get_root_node().create_child())
+    agent.controls.move_filter_fn = pathfinder.try_step
+    greedy = habitat_sim.GreedyGeodesicFollower(pathfinder, agent)
+    optimal = habitat_sim.GreedyGeodesicFollower(pathfinder, agent, optimal=True)
+
+    for _ in range(10):
+        state = agent.state
+        state.position = pathfinder.get_random_navigable_point()
+        goal_pos = pathfinder.get_random_navigable_point()
+        agent.state = state
+
+        try:
+            greedy_path = greedy.find_path(goal_pos)
+        except habitat_sim.errors.GreedyFollowerError:
+            continue
+        path = optimal.find_path(goal_pos)
+        assert path[-1] is None
+        # the lattice snaps poses to its cells, so it may lose a few steps
+        assert len(path) <= len(greedy_path) + 4
+
+        # the start of the path is on it, so asking again is a lookup
+        num_nodes = optimal.impl.num_nodes
+        assert optimal.next_action_along(goal_pos) == path[0]
+        assert optimal.impl.num_nodes == num_nodes
+
+        for action in path[:-1]:
+            agent.act(action)
+        assert (
+            np.linalg.norm(agent.state.position - goal_pos)
+            <= 2 * optimal.forward_spec.amount
+        )
@@ -113,3 +113,169 @@ def test_smoke_no_sensors(make_cfg_settings):
         cfg = make_cfg(make_cfg_settings)
         cfg.agents[0].sensor_specifications = []
         sims.append(habitat_sim.Simulator(cfg))
+
+
+@pytest.mark.gfxtest
+def test_observation_buffer_view(sim, make_cfg_settings):
+    scene = _test_scenes[1]
+    if not osp.exists(scene):
+        pytest.skip("Skipping {}".format(scene))
+
+    make_cfg_settings = {k: v for k, v in make_cfg_settings.items()}
+    make_cfg_settings["semantic_sensor"] = False
+    make_cfg_settings["scene"] = scene
+    sim.reconfigure(make_cfg(make_cfg_settings))
+
+    sensor = sim._sensors["depth_sensor"]._sensor_object
+    obs = hsim.Observation()
+    assert sensor.get_observation(sim._sim, obs)
+    depth = obs.data
+    assert depth.dtype == np.float32
+    assert depth.shape == tuple(obs.buffer.shape)
+    # both the array and the buffer protocol export the sensor's memory
+    assert np.shares_memory(depth, np.asarray(obs.buffer))
+
+    # the view keeps the buffer alive
+    del obs
+    assert np.isfinite(depth).all()
+
+
+@pytest.mark.gfxtest
+@pytest.mark.parametrize("sensor_type", ["color_sensor", "depth_sensor"])
+def test_render_poses(sensor_type, sim, make_cfg_settings):
+    scene = _test_scenes[1]
+    if not osp.exists(scene):
+        pytest.skip("Skipping {}".format(scene))
+
+    make_cfg_settings = {k: v for k, v in make_cfg_settings.items()}
+    make_cfg_settings["semantic_sensor"] = False
+    make_cfg_settings["scene"] = scene
+    sim.reconfigure(make_cfg(make_cfg_settings))
+    sim.initialize_agent(0)
+
+    # the pose of the sensor after each of a few actions
+    sensor = sim._sensors[sensor_type]._sensor_object
+    poses = []
+    observations = []
+    for action in ["move_forward", "turn_left", "move_forward"]:
+        observations.append(sim.step(action)[sensor_type])
+        poses.append(np.array(sensor.node.absolute_transformation()))
+
+    frames = sim.render_poses(np.stack(poses), sensor.specification())
+    assert frames.shape[0] == len(poses)
+    for frame, obs in zip(frames, observations):
+        assert frame.shape[:2] == obs.shape[:2]
+        assert np.allclose(
+            frame.reshape(obs.shape).astype(np.float), obs.astype(np.float), atol=1e-3
+        )
+
+
+@pytest.mark.gfxtest
+def test_frame_reuse(sim, make_cfg_settings):
+    scene = _test_scenes[1]
+    if not osp.exists(scene):
+        pytest.skip("Skipping {}".format(scene))
+
+    make_cfg_settings = {k: v for k, v in make_cfg_settings.items()}
+    make_cfg_settings["semantic_sensor"] = False
+    make_cfg_settings["scene"] = scene
+    cfg = make_cfg(make_cfg_settings)
+    actions = ["move_forward", "turn_left"]
+    sim.reconfigure(cfg)
+    sim.initialize_agent(0)
+    expected = [sim.step(action)["color_sensor"] for action in actions]
+
+    for spec in cfg.agents[0].sensor_specifications:
+        spec.frame_reuse = True
+    sim.reconfigure(cfg)
+    sim.initialize_agent(0)
+    # standing still reuses the frame, moving renders a new one
+    first = sim.step(actions[0])["color_sensor"]
+    assert np.array_equal(first, expected[0])
+    assert np.array_equal(sim.get_sensor_observations()["color_sensor"], first)
+    assert np.array_equal(sim.step(actions[1])["color_sensor"], expected[1])
+
+
+@pytest.mark.gfxtest
+def test_supersampling(sim, make_cfg_settings):
+    scene = _test_scenes[1]
+    if not osp.exists(scene):
+        pytest.skip("Skipping {}".format(scene))
+
+    make_cfg_settings = {k: v for k, v in make_cfg_settings.items()}
+    make_cfg_settings["semantic_sensor"] = False
+    make_cfg_settings["depth_sensor"] = False
+    make_cfg_settings["scene"] = scene
+    make_cfg_settings["width"] = 128
+    make_cfg_settings["height"] = 128
+    sim.reconfigure(make_cfg(make_cfg_settings))
+    sim.initialize_agent(0)
+    full = sim.step("move_forward")["color_sensor"].astype(np.float32)
+    # box filter of the 2x2 blocks
+    expected = full.reshape(64, 2, 64, 2, -1).mean(axis=(1, 3))
+
+    make_cfg_settings["width"] = 64
+    make_cfg_settings["height"] = 64
+    cfg = make_cfg(make_cfg_settings)
+    cfg.agents[0].sensor_specifications[0].supersampling = 2
+    sim.reconfigure(cfg)
+    sim.initialize_agent(0)
+    obs = sim.step("move_forward")["color_sensor"]
+    assert obs.shape == expected.shape
+    # rounding of the blits
+    assert np.abs(obs.astype(np.float32) - expected).max() <= 1.0
+
+
+@pytest.mark.gfxtest
+@pytest.mark.parametrize("sensor_type", ["depth_sensor", "semantic_sensor"])
+def test_sensor_specific_passes(sensor_type, sim, make_cfg_settings):
+    scene = _test_scenes[0]
+    if not osp.exists(scene):
+        pytest.skip("Skipping {}".format(scene))
+
+    make_cfg_settings = {k: v for k, v in make_cfg_settings.items()}
+    make_cfg_settings["semantic_sensor"] = True
+    make_cfg_settings["scene"] = scene
+    sim.reconfigure(make_cfg(make_cfg_settings))
+    sim.initialize_agent(0)
+    renderer = sim._sim.renderer
+    assert renderer.sensor_specific_passes
+    fast = sim.step("move_forward")[sensor_type]
+
+    # the full pass draws the same depth and ids
+    renderer.sensor_specific_passes = False
+    assert np.array_equal(sim.get_sensor_observations()[sensor_type], fast)
+    renderer.sensor_specific_passes = True
+
+
+@pytest.mark.gfxtest
+def test_sensor_frame_sharing(sim, make_cfg_settings):
+    scene = _test_scenes[0]
+    if not osp.exists(scene):
+        pytest.skip("Skipping {}".format(scene))
+
+    make_cfg_settings = {k: v for k, v in make_cfg_settings.items()}
+    make_cfg_settings["semantic_sensor"] = False
+    make_cfg_settings["scene"] = scene
+    sim.reconfigure(make_cfg(make_cfg_settings))
+    sim.initialize_agent(0)
+    renderer = sim._sim.renderer
+    assert renderer.sensor_frame_sharing
+
+    def count_frames(observe):
+        renderer.render_stats_frames = 8
+        observations = observe()
+        num_frames = len(renderer.get_render_stats())
+        renderer.render_stats_frames = 0
+        return observations, num_frames
+
+    # the depth sensor at the pose of the color sensor keeps its frame
+    shared, num_frames = count_frames(lambda: sim.step("move_forward"))
+    assert num_frames == 1
+
+    renderer.sensor_frame_sharing = False
+    separate, num_frames = count_frames(sim.get_sensor_observations)
+    renderer.sensor_frame_sharing = True
+    assert num_frames == 2
+    for uuid in ["color_sensor", "depth_sensor"]:
+        assert np.array_equal(shared[uuid], separate[uuid])
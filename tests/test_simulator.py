@@ -23,3 +23,18 @@ def test_no_navmesh_smoke():
         obs = sim.step(random.choice(list(agent_config.action_space.keys())))
         # Can't collide with no navmesh
         assert not obs["collided"]
+
+
+def test_memory_stats():
+    sim_cfg = habitat_sim.SimulatorConfiguration()
+    agent_config = habitat_sim.AgentConfiguration()
+    agent_config.sensor_specifications = []
+    sim_cfg.scene.id = "data/scene_datasets/habitat-test-scenes/van-gogh-room.glb"
+
+    sim = habitat_sim.Simulator(habitat_sim.Configuration(sim_cfg, [agent_config]))
+
+    stats = sim.get_memory_stats()
+    assert stats.mesh_bytes > 0
+    assert stats.texture_bytes > 0
+    assert 0 < sum(stats.asset_bytes.values()) <= stats.mesh_bytes + stats.texture_bytes
+    sim.close()